@@ -0,0 +1,351 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "batchgrep.h"
+
+#include <algorithm>
+#include <iostream>
+#include <numeric>
+
+#include <QFileInfo>
+#include <QTextCodec>
+#include <QTextDecoder>
+
+#include <tbb/parallel_for_each.h>
+#include <tbb/parallel_pipeline.h>
+#include <tbb/task_arena.h>
+
+#include "configuration.h"
+#include "encodingdetector.h"
+#include "fileholder.h"
+#include "indexcache.h"
+#include "log.h"
+#include "persistentsearchcache.h"
+#include "workscheduler.h"
+
+namespace {
+constexpr qint64 ReadBlockSize = 1024 * 1024;
+
+// Lines read from a file, the last one may be not terminated at the end of file
+struct Chunk {
+    QByteArray data;
+    std::vector<std::string_view> lines;
+    std::vector<uint32_t> matchingLines;
+};
+
+using ChunkPtr = std::shared_ptr<Chunk>;
+
+// Lines are matched without end of line characters
+void splitLines( const QByteArray& data, std::vector<std::string_view>& lines )
+{
+    const auto text = std::string_view( data.constData(), static_cast<size_t>( data.size() ) );
+
+    size_t lineStart = 0;
+    while ( lineStart < text.size() ) {
+        auto lineEnd = text.find( '\n', lineStart );
+        if ( lineEnd == std::string_view::npos ) {
+            lineEnd = text.size();
+        }
+
+        auto line = text.substr( lineStart, lineEnd - lineStart );
+        if ( !line.empty() && line.back() == '\r' ) {
+            line.remove_suffix( 1 );
+        }
+        lines.push_back( line );
+
+        lineStart = lineEnd + 1;
+    }
+}
+
+// Raw line as it is in the file including trailing carriage return
+std::string_view rawLine( const Chunk& chunk, std::string_view line )
+{
+    const auto lineEnd = line.data() + line.size();
+    if ( lineEnd < chunk.data.constData() + chunk.data.size() && *lineEnd == '\r' ) {
+        return std::string_view( line.data(), line.size() + 1 );
+    }
+    return line;
+}
+} // namespace
+
+BatchGrep::BatchGrep( const BatchGrepOptions& options, std::FILE* output )
+    : options_( options )
+    , output_( output )
+    , regularExpression_( options.pattern )
+    , matchers_( [ this ]() { return regularExpression_.createMatcher(); } )
+    , matchDurations_( std::chrono::microseconds{ 0 } )
+{
+}
+
+int BatchGrep::run( const std::vector<QString>& fileNames )
+{
+    using namespace std::chrono;
+    const auto startTime = high_resolution_clock::now();
+
+    tbb::task_arena arena( configuredArenaConstraints() );
+
+    // One big file gets all threads, many files get a few each
+    const auto concurrency = static_cast<size_t>( arena.max_concurrency() );
+    const auto filesInParallel = std::max( size_t{ 1 }, std::min( fileNames.size(), concurrency ) );
+    const auto maxChunksInFlight = std::max( size_t{ 4 }, concurrency / filesInParallel );
+
+    std::vector<FileResult> results( fileNames.size() );
+    std::vector<size_t> fileIndexes( fileNames.size() );
+    std::iota( fileIndexes.begin(), fileIndexes.end(), 0 );
+
+    arena.execute( [ & ] {
+        tbb::parallel_for_each( fileIndexes.begin(), fileIndexes.end(), [ & ]( size_t index ) {
+            results[ index ] = searchFile( fileNames[ index ], maxChunksInFlight );
+        } );
+    } );
+
+    std::fflush( output_ );
+    duration_ = duration_cast<microseconds>( high_resolution_clock::now() - startTime );
+
+    const auto hasErrors = std::any_of( results.begin(), results.end(),
+                                        []( const FileResult& result ) { return !result.isRead; } );
+    const auto hasMatches
+        = std::any_of( results.begin(), results.end(),
+                       []( const FileResult& result ) { return result.matchesCount > 0; } );
+
+    return hasErrors ? 2 : hasMatches ? 0 : 1;
+}
+
+OperationStats BatchGrep::stats() const
+{
+    OperationStats stats;
+    stats.updatePeakMemory();
+
+    stats.duration = duration_;
+    stats.bytesRead = bytesRead_;
+    stats.ioDuration = std::chrono::microseconds( ioDurationUs_.load() );
+    stats.combiningDuration = std::chrono::microseconds( outputDurationUs_.load() );
+    for ( const auto& matchDuration : matchDurations_ ) {
+        stats.matchDurations.push_back( matchDuration );
+    }
+    return stats;
+}
+
+BatchGrep::FileResult BatchGrep::searchFile( const QString& fileName, size_t maxChunksInFlight )
+{
+    using namespace std::chrono;
+    using clock = high_resolution_clock;
+
+    if ( options_.printCount || options_.printFileNames ) {
+        if ( const auto cachedCount = cachedMatchesCount( fileName ) ) {
+            LOG_INFO << "Using cached search results for " << fileName;
+            const auto matchesCount
+                = options_.maxCount ? std::min( *cachedCount, *options_.maxCount ) : *cachedCount;
+            printSummary( fileName, matchesCount );
+            return { true, matchesCount };
+        }
+    }
+
+    auto file = makeLogFileDevice( fileName );
+    if ( !file->open( QIODevice::ReadOnly ) ) {
+        std::cerr << "klogg_grep: " << fileName.toStdString() << ": "
+                  << file->errorString().toStdString() << "\n";
+        return {};
+    }
+
+    const auto printLines = !options_.printCount && !options_.printFileNames;
+    const auto linePrefix
+        = options_.prefixFileNames ? fileName.toUtf8().append( ':' ) : QByteArray{};
+
+    FileResult result{ true, 0 };
+
+    // Text in encodings that are not compatible with UTF-8 is matched and printed as UTF-8
+    std::unique_ptr<QTextDecoder> decoder;
+    bool isEncodingDetected = false;
+    QByteArray incompleteLine;
+    bool isReadDone = false;
+
+    // Only the first match is needed to print the name of file,
+    // only the first maxCount ones to print lines or count them
+    std::atomic<bool> isSearchDone{ options_.maxCount == uint64_t{ 0 } };
+    uint64_t linesBeforeChunk = 0;
+
+    tbb::parallel_pipeline(
+        maxChunksInFlight,
+        tbb::make_filter<void, ChunkPtr>(
+            tbb::filter_mode::serial_in_order,
+            [ & ]( tbb::flow_control& flowControl ) -> ChunkPtr {
+                if ( isSearchDone || isReadDone ) {
+                    flowControl.stop();
+                    return {};
+                }
+
+                const auto readStartTime = clock::now();
+                auto block = file->read( ReadBlockSize );
+                ioDurationUs_
+                    += duration_cast<microseconds>( clock::now() - readStartTime ).count();
+                bytesRead_ += static_cast<uint64_t>( block.size() );
+
+                // Gzip data can end before the end of device is reported
+                isReadDone = block.isEmpty() || file->atEnd();
+                if ( block.isEmpty() && !file->atEnd() ) {
+                    std::cerr << "klogg_grep: " << fileName.toStdString() << ": "
+                              << file->errorString().toStdString() << "\n";
+                    result.isRead = false;
+                }
+
+                if ( !isEncodingDetected && !block.isEmpty() ) {
+                    isEncodingDetected = true;
+                    const auto codec = EncodingDetector::getInstance().detectEncoding( block );
+                    if ( codec && !EncodingParameters( codec ).isUtf8Compatible ) {
+                        LOG_INFO << "Decoding " << fileName << " from "
+                                 << codec->name().toStdString();
+                        decoder.reset( codec->makeDecoder() );
+                    }
+                }
+
+                if ( decoder ) {
+                    block = decoder->toUnicode( block ).toUtf8();
+                }
+
+                auto chunk = std::make_shared<Chunk>();
+                chunk->data = std::move( incompleteLine );
+                chunk->data.append( block );
+                incompleteLine.clear();
+
+                if ( !isReadDone ) {
+                    const auto lastLineEnd = chunk->data.lastIndexOf( '\n' );
+                    incompleteLine = chunk->data.mid( lastLineEnd + 1 );
+                    chunk->data.truncate( lastLineEnd + 1 );
+                }
+
+                return chunk;
+            } )
+            & tbb::make_filter<ChunkPtr, ChunkPtr>(
+                tbb::filter_mode::parallel,
+                [ this ]( ChunkPtr chunk ) {
+                    const auto matchStartTime = clock::now();
+
+                    splitLines( chunk->data, chunk->lines );
+                    matchers_.local()->withSpecializedMatcher( [ &chunk ]( const auto& matcher ) {
+                        matcher.matchLines( chunk->lines, chunk->matchingLines );
+                    } );
+
+                    matchDurations_.local()
+                        += duration_cast<microseconds>( clock::now() - matchStartTime );
+                    return chunk;
+                } )
+            & tbb::make_filter<ChunkPtr, void>(
+                tbb::filter_mode::serial_in_order, [ & ]( ChunkPtr chunk ) {
+                    const auto outputStartTime = clock::now();
+
+                    // Chunks already read when the search is done are dropped
+                    if ( isSearchDone ) {
+                        return;
+                    }
+
+                    if ( options_.maxCount ) {
+                        const auto missingMatches = *options_.maxCount - result.matchesCount;
+                        if ( chunk->matchingLines.size() >= missingMatches ) {
+                            chunk->matchingLines.resize( static_cast<size_t>( missingMatches ) );
+                            isSearchDone = true;
+                        }
+                    }
+
+                    result.matchesCount += chunk->matchingLines.size();
+                    if ( options_.printFileNames && result.matchesCount > 0 ) {
+                        isSearchDone = true;
+                    }
+
+                    if ( printLines && !chunk->matchingLines.empty() ) {
+                        std::string output;
+                        for ( const auto index : chunk->matchingLines ) {
+                            output.append( linePrefix.constData(),
+                                           static_cast<size_t>( linePrefix.size() ) );
+                            if ( options_.printLineNumbers ) {
+                                output.append( std::to_string( linesBeforeChunk + index + 1 ) );
+                                output.push_back( ':' );
+                            }
+                            output.append( rawLine( *chunk, chunk->lines[ index ] ) );
+                            output.push_back( '\n' );
+                        }
+                        write( output );
+                    }
+
+                    linesBeforeChunk += chunk->lines.size();
+                    outputDurationUs_
+                        += duration_cast<microseconds>( clock::now() - outputStartTime ).count();
+                } ) );
+
+    printSummary( fileName, result.matchesCount );
+
+    LOG_INFO << "Searched " << fileName << ", " << linesBeforeChunk << " lines, "
+             << result.matchesCount << " matches";
+    return result;
+}
+
+std::optional<uint64_t> BatchGrep::cachedMatchesCount( const QString& fileName ) const
+{
+    const auto& config = Configuration::get();
+    if ( !config.useIndexCache() || !config.fastModificationDetection()
+         || !config.useSearchResultsCache() || !config.usePersistentSearchCache() ) {
+        return {};
+    }
+
+    auto nbLines = 0_lcount;
+    {
+        IndexingData indexingData;
+        IndexingData::MutateAccessor scopedAccessor{ &indexingData };
+        if ( !IndexCache( fileName ).load( scopedAccessor )
+             || scopedAccessor.getIndexedSize() != QFileInfo( fileName ).size() ) {
+            return {};
+        }
+        nbLines = scopedAccessor.getNbLines();
+    }
+
+    for ( const auto& entry : PersistentSearchCache( fileName ).load() ) {
+        if ( entry.pattern == options_.pattern && entry.startLine == 0_lnum
+             && entry.endLine.get() == nbLines.get() ) {
+            return entry.matchingLines.cardinality();
+        }
+    }
+
+    return {};
+}
+
+void BatchGrep::printSummary( const QString& fileName, uint64_t matchesCount )
+{
+    std::string summary;
+    if ( options_.printFileNames ) {
+        if ( matchesCount > 0 ) {
+            summary = fileName.toStdString() + "\n";
+        }
+    }
+    else if ( options_.printCount ) {
+        if ( options_.prefixFileNames ) {
+            summary = fileName.toStdString() + ":";
+        }
+        summary += std::to_string( matchesCount ) + "\n";
+    }
+
+    if ( !summary.empty() ) {
+        write( summary );
+    }
+}
+
+void BatchGrep::write( std::string_view data )
+{
+    // Each call writes whole lines, stdio locks the stream for it
+    std::fwrite( data.data(), 1, data.size(), output_ );
+}
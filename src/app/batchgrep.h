@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_BATCHGREP_H
+#define KLOGG_BATCHGREP_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#include <QString>
+
+#include <tbb/enumerable_thread_specific.h>
+
+#include "operationstats.h"
+#include "regularexpression.h"
+#include "regularexpressionpattern.h"
+
+struct BatchGrepOptions {
+    RegularExpressionPattern pattern;
+
+    // Print number of matching lines of each file
+    bool printCount = false;
+    // Print only names of files with matching lines
+    bool printFileNames = false;
+    bool printLineNumbers = false;
+    // Stop reading a file after this number of matching lines
+    std::optional<uint64_t> maxCount;
+    // Prefix lines and counts with name of the file
+    bool prefixFileNames = false;
+};
+
+// Searches files without building their index.
+// Each file is read once, blocks of whole lines are matched
+// by a pool of threads and matching lines are written to the output
+// as raw bytes in order of the file. Several files are searched at once,
+// so blocks of lines of different files can be interleaved.
+class BatchGrep {
+  public:
+    BatchGrep( const BatchGrepOptions& options, std::FILE* output );
+
+    // Returns exit status of grep: 0 if some line matched, 1 if none did,
+    // 2 if a file could not be read
+    int run( const std::vector<QString>& fileNames );
+
+    OperationStats stats() const;
+
+  private:
+    struct FileResult {
+        bool isRead = false;
+        uint64_t matchesCount = 0;
+    };
+
+    FileResult searchFile( const QString& fileName, size_t maxChunksInFlight );
+
+    // Count of matching lines saved in search results cache,
+    // empty unless the cached index shows they cover the whole file
+    std::optional<uint64_t> cachedMatchesCount( const QString& fileName ) const;
+
+    void printSummary( const QString& fileName, uint64_t matchesCount );
+    void write( std::string_view data );
+
+  private:
+    BatchGrepOptions options_;
+    std::FILE* output_;
+
+    RegularExpression regularExpression_;
+    tbb::enumerable_thread_specific<std::unique_ptr<PatternMatcher>> matchers_;
+
+    std::atomic<uint64_t> bytesRead_{ 0 };
+    std::atomic<int64_t> ioDurationUs_{ 0 };
+    std::atomic<int64_t> outputDurationUs_{ 0 };
+    tbb::enumerable_thread_specific<std::chrono::microseconds> matchDurations_;
+    std::chrono::microseconds duration_{};
+};
+
+#endif
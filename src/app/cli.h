@@ -48,6 +48,14 @@ struct CliParameters {
     int window_height = 0;
 
     QString pattern;
+    bool print_stats = false;
+    bool print_count = false;
+    bool print_file_names = false;
+    bool print_line_numbers = false;
+    int64_t max_count = -1;
+    int numa_node = -1;
+    // host[:port] of agents to search files on
+    std::vector<QString> agents;
 
     CliParameters( QCoreApplication& app, bool console = false )
     {
@@ -83,6 +91,34 @@ struct CliParameters {
                                                               << "pattern",
                                                 "pattern to search for", "pattern" );
 
+        const QCommandLineOption statsOption(
+            "stats", "print time spent in phases of indexing and search to stderr" );
+
+        const QCommandLineOption countOption( QStringList() << "c"
+                                                            << "count",
+                                              "print only a count of matching lines per file" );
+
+        const QCommandLineOption filesWithMatchesOption(
+            QStringList() << "l"
+                          << "files-with-matches",
+            "print only names of files with matching lines" );
+
+        const QCommandLineOption lineNumberOption( QStringList() << "n"
+                                                                 << "line-number",
+                                                   "prefix each matching line with its number" );
+
+        const QCommandLineOption maxCountOption( QStringList() << "m"
+                                                               << "max-count",
+                                                 "stop reading a file after this number of "
+                                                 "matching lines",
+                                                 "num" );
+
+        const QCommandLineOption numaNodeOption(
+            "numa-node", "run search threads only on this NUMA node", "node" );
+
+        const QCommandLineOption agentOption(
+            "agent", "search files on klogg_agent at host[:port], may be repeated", "host" );
+
         const QCommandLineOption debugOption(
             QStringList() << "d"
                           << "debug",
@@ -105,6 +141,13 @@ struct CliParameters {
         }
         else {
             parser.addOption( patternOption );
+            parser.addOption( statsOption );
+            parser.addOption( countOption );
+            parser.addOption( filesWithMatchesOption );
+            parser.addOption( lineNumberOption );
+            parser.addOption( maxCountOption );
+            parser.addOption( numaNodeOption );
+            parser.addOption( agentOption );
         }
 
         parser.process( app );
@@ -150,9 +193,35 @@ struct CliParameters {
             if ( parser.isSet( patternOption ) ) {
                 pattern = parser.value( patternOption );
             }
+
+            if ( parser.isSet( statsOption ) ) {
+                print_stats = true;
+            }
+
+            print_count = parser.isSet( countOption );
+            print_file_names = parser.isSet( filesWithMatchesOption );
+            print_line_numbers = parser.isSet( lineNumberOption );
+
+            if ( parser.isSet( maxCountOption ) ) {
+                max_count = parser.value( maxCountOption ).toLongLong();
+            }
+
+            if ( parser.isSet( numaNodeOption ) ) {
+                numa_node = parser.value( numaNodeOption ).toInt();
+            }
+
+            for ( const auto& agent : parser.values( agentOption ) ) {
+                agents.emplace_back( agent );
+            }
         }
 
         for ( const auto& file : parser.positionalArguments() ) {
+            // Files on agents are named as they are on their hosts
+            if ( !agents.empty() ) {
+                filenames.emplace_back( file );
+                continue;
+            }
+
             const auto fileInfo = QFileInfo( file );
             filenames.emplace_back( fileInfo.absoluteFilePath() );
         }
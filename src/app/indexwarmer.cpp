@@ -0,0 +1,130 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "indexwarmer.h"
+
+#include <QDir>
+#include <QFileInfo>
+
+#include "filewatcher.h"
+#include "indexcache.h"
+#include "log.h"
+#include "logdata.h"
+
+IndexWarmer::IndexWarmer( const QStringList& nameFilters, QObject* parent )
+    : QObject( parent )
+    , nameFilters_( nameFilters )
+{
+    connect( &directoryWatcher_, &QFileSystemWatcher::directoryChanged, this,
+             &IndexWarmer::scanDirectory );
+    connect( &FileWatcher::getFileWatcher(), &FileWatcher::fileChanged, this,
+             &IndexWarmer::fileChanged, Qt::QueuedConnection );
+}
+
+IndexWarmer::~IndexWarmer() = default;
+
+void IndexWarmer::watchDirectory( const QString& path )
+{
+    LOG_INFO << "Watching directory " << path;
+    directoryWatcher_.addPath( path );
+    scanDirectory( path );
+}
+
+void IndexWarmer::scanDirectory( const QString& path )
+{
+    const auto files = QDir( path ).entryInfoList( nameFilters_, QDir::Files, QDir::Time );
+    for ( const auto& file : files ) {
+        enqueueFile( file.absoluteFilePath() );
+    }
+}
+
+void IndexWarmer::fileChanged( const QString& fileName )
+{
+    if ( indexedFiles_.contains( fileName ) ) {
+        enqueueFile( fileName );
+    }
+}
+
+void IndexWarmer::enqueueFile( const QString& fileName )
+{
+    const QFileInfo fileInfo( fileName );
+
+    // Index of small files is not cached
+    if ( !fileInfo.exists() || fileInfo.size() < IndexCache::MinCachedFileSize ) {
+        return;
+    }
+
+    const auto indexedFile = indexedFiles_.find( fileName );
+    if ( indexedFile != indexedFiles_.end() && indexedFile->size == fileInfo.size()
+         && indexedFile->lastModified == fileInfo.lastModified() ) {
+        return;
+    }
+
+    if ( queuedFiles_.contains( fileName ) ) {
+        return;
+    }
+
+    LOG_INFO << "Queued " << fileName << " for indexing";
+    queuedFiles_.insert( fileName );
+    queue_.push_back( fileName );
+
+    // Finished indexing always starts the next file
+    if ( !logData_ && queue_.size() == 1 ) {
+        QMetaObject::invokeMethod( this, &IndexWarmer::indexNextFile, Qt::QueuedConnection );
+    }
+}
+
+void IndexWarmer::indexNextFile()
+{
+    logData_.reset();
+    indexingFileName_.clear();
+
+    if ( queue_.empty() ) {
+        return;
+    }
+
+    indexingFileName_ = queue_.front();
+    queue_.pop_front();
+    queuedFiles_.remove( indexingFileName_ );
+
+    // Size is taken before indexing, data appended meanwhile is indexed next time
+    const QFileInfo fileInfo( indexingFileName_ );
+    indexedFiles_.insert( indexingFileName_, { fileInfo.size(), fileInfo.lastModified() } );
+
+    LOG_INFO << "Indexing " << indexingFileName_;
+    logData_ = std::make_unique<LogData>();
+    connect( logData_.get(), &LogData::loadingFinished, this, &IndexWarmer::indexingFinished );
+    logData_->attachFile( indexingFileName_ );
+}
+
+void IndexWarmer::indexingFinished( LoadingStatus status )
+{
+    if ( status == LoadingStatus::Successful ) {
+        LOG_INFO << "Indexed " << indexingFileName_ << ", "
+                 << logData_->getIndexingStats().toString().replace( '\n', ", " );
+        FileWatcher::getFileWatcher().addFile( indexingFileName_ );
+    }
+    else {
+        LOG_WARNING << "Failed to index " << indexingFileName_;
+        indexedFiles_.remove( indexingFileName_ );
+    }
+
+    // Log data is destroyed outside of its signal
+    QMetaObject::invokeMethod( this, &IndexWarmer::indexNextFile, Qt::QueuedConnection );
+}
@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_INDEXWARMER_H
+#define KLOGG_INDEXWARMER_H
+
+#include <deque>
+#include <memory>
+
+#include <QDateTime>
+#include <QFileSystemWatcher>
+#include <QHash>
+#include <QObject>
+#include <QSet>
+#include <QStringList>
+
+#include "loadingstatus.h"
+
+class LogData;
+
+// Keeps persistent index cache of files in watched directories up to date,
+// so they are opened without being read again. New and changed files are
+// queued and indexed one at a time, appended data is indexed starting
+// from the cached index.
+class IndexWarmer : public QObject {
+    Q_OBJECT
+
+  public:
+    explicit IndexWarmer( const QStringList& nameFilters, QObject* parent = nullptr );
+    ~IndexWarmer() override;
+
+    void watchDirectory( const QString& path );
+
+  private Q_SLOTS:
+    void scanDirectory( const QString& path );
+    void fileChanged( const QString& fileName );
+    void indexingFinished( LoadingStatus status );
+    void indexNextFile();
+
+  private:
+    struct FileState {
+        qint64 size = 0;
+        QDateTime lastModified;
+    };
+
+    void enqueueFile( const QString& fileName );
+
+  private:
+    QStringList nameFilters_;
+    QFileSystemWatcher directoryWatcher_;
+
+    std::deque<QString> queue_;
+    QSet<QString> queuedFiles_;
+    QHash<QString, FileState> indexedFiles_;
+
+    QString indexingFileName_;
+    std::unique_ptr<LogData> logData_;
+};
+
+#endif
@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#if defined( KLOGG_USE_TBBMALLOC )
+#include <tbb/tbbmalloc_proxy.h>
+#elif defined( KLOGG_USE_MIMALLOC )
+#include <mimalloc.h>
+#endif
+
+#include <iostream>
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QHostAddress>
+
+#include "configuration.h"
+#include "klogg_version.h"
+#include "logagent.h"
+#include "logger.h"
+#include "persistentinfo.h"
+
+// Settings and caches are shared with klogg
+const bool PersistentInfo::ForcePortable = false;
+
+int main( int argc, char* argv[] )
+{
+#ifdef KLOGG_USE_MIMALLOC
+    mi_stats_reset();
+#endif
+
+    QCoreApplication app( argc, argv );
+    // Cache directory is named after the application
+    QCoreApplication::setApplicationName( "klogg" );
+    QCoreApplication::setApplicationVersion( kloggVersion().data() );
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(
+        "Indexes and searches log files in directories for klogg connected over network" );
+    parser.addHelpOption();
+    parser.addVersionOption();
+
+    const QCommandLineOption listenOption(
+        QStringList() << "l"
+                      << "listen",
+        "address to listen on, only local connections are accepted by default", "address",
+        "127.0.0.1" );
+    const QCommandLineOption portOption( QStringList() << "p"
+                                                       << "port",
+                                         "port to listen on", "port",
+                                         QString::number( remote::DefaultPort ) );
+    const QCommandLineOption debugOption(
+        QStringList() << "d"
+                      << "debug",
+        "output more debug (increase number for more verbosity)", "debug_level", "0" );
+
+    parser.addOption( listenOption );
+    parser.addOption( portOption );
+    parser.addOption( debugOption );
+    parser.addPositionalArgument( "directories", "directories with files to serve" );
+    parser.process( app );
+
+    const auto logLevel = 3 + parser.value( debugOption ).toInt();
+    logging::enableLogging( true, static_cast<logging::LogLevel>( logLevel ) );
+
+    Configuration::getSynced();
+
+    const auto directories = parser.positionalArguments();
+    if ( directories.isEmpty() ) {
+        parser.showHelp( EXIT_FAILURE );
+    }
+
+    const QHostAddress address( parser.value( listenOption ) );
+    bool isPortValid = false;
+    const auto port = parser.value( portOption ).toUShort( &isPortValid );
+    if ( address.isNull() || !isPortValid ) {
+        std::cerr << "klogg_agent: invalid address or port\n";
+        return EXIT_FAILURE;
+    }
+
+    LogAgent agent( directories );
+    if ( !agent.listen( address, port ) ) {
+        std::cerr << "klogg_agent: " << agent.errorString().toStdString() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    return app.exec();
+}
@@ -23,62 +23,192 @@
 #include <mimalloc.h>
 #endif
 
+#include <cstdio>
+
+#include <QDir>
+#include <QFileInfo>
+
+#ifdef Q_OS_WIN
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+#include "batchgrep.h"
 #include "configuration.h"
-#include "logdata.h"
-#include "logfiltereddata.h"
-#include "dispatch_to.h"
+#include "fanoutsearch.h"
 #include "logger.h"
 #include "persistentinfo.h"
+#include "remoteprotocol.h"
 
 #include "cli.h"
 
 const bool PersistentInfo::ForcePortable = true;
 
+namespace {
+constexpr size_t OutputBufferSize = 1024 * 1024;
+
+// Shells on Windows do not expand wildcards, so names with them
+// that are not existing files are matched against files of their directory
+std::vector<QString> expandFileNames( const std::vector<QString>& fileNames )
+{
+    std::vector<QString> expandedNames;
+    for ( const auto& fileName : fileNames ) {
+        const QFileInfo fileInfo( fileName );
+        const auto hasWildcards = fileInfo.fileName().contains( QChar( '*' ) )
+                                  || fileInfo.fileName().contains( QChar( '?' ) )
+                                  || fileInfo.fileName().contains( QChar( '[' ) );
+
+        const auto matchingFiles
+            = hasWildcards && !fileInfo.exists()
+                  ? fileInfo.absoluteDir().entryInfoList( { fileInfo.fileName() }, QDir::Files,
+                                                          QDir::Name )
+                  : QFileInfoList{};
+
+        if ( matchingFiles.isEmpty() ) {
+            expandedNames.push_back( fileName );
+        }
+        for ( const auto& matchingFile : matchingFiles ) {
+            expandedNames.push_back( matchingFile.absoluteFilePath() );
+        }
+    }
+    return expandedNames;
+}
+
+// Each file is searched on each of agents given as host[:port]
+std::vector<FanOutSearch::Endpoint> agentEndpoints( const std::vector<QString>& agents,
+                                                    const std::vector<QString>& fileNames )
+{
+    std::vector<FanOutSearch::Endpoint> endpoints;
+    for ( const auto& agent : agents ) {
+        FanOutSearch::Endpoint endpoint;
+        endpoint.host = agent;
+        endpoint.port = remote::DefaultPort;
+
+        const auto portSeparator = agent.lastIndexOf( QChar( ':' ) );
+        bool isPortValid = false;
+        const auto port = agent.mid( portSeparator + 1 ).toUShort( &isPortValid );
+        if ( portSeparator > 0 && isPortValid ) {
+            endpoint.host = agent.left( portSeparator );
+            endpoint.port = port;
+        }
+
+        for ( const auto& fileName : fileNames ) {
+            endpoint.fileName = fileName;
+            endpoints.push_back( endpoint );
+        }
+    }
+    return endpoints;
+}
+
+// Matching lines of all agents are printed ordered by their timestamps,
+// progress of each agent is printed to stderr
+int searchOnAgents( QCoreApplication& app, const std::vector<FanOutSearch::Endpoint>& endpoints,
+                    const RegularExpressionPattern& pattern, bool printCount )
+{
+    FanOutSearch search( endpoints );
+
+    QObject::connect( &search, &FanOutSearch::hostProgressed, [ &search ]( size_t host ) {
+        const auto progress = search.getHostProgress( host );
+        if ( !progress.isFinished ) {
+            return;
+        }
+
+        std::cerr << progress.host.toStdString() << ": ";
+        if ( !progress.error.isEmpty() ) {
+            std::cerr << "error: " << progress.error.toStdString() << "\n";
+        }
+        else {
+            std::cerr << progress.nbMatches.get() << " matching lines, "
+                      << static_cast<uint64_t>( progress.throughput ) << " lines/s\n";
+        }
+    } );
+
+    QObject::connect( &search, &FanOutSearch::searchFinished, [ & ]() {
+        bool hasMatches = false;
+        bool hasErrors = false;
+        for ( auto host = 0u; host < search.getHostsCount(); ++host ) {
+            const auto progress = search.getHostProgress( host );
+            hasMatches = hasMatches || progress.nbMatches.get() > 0;
+            hasErrors = hasErrors || !progress.error.isEmpty();
+            if ( printCount ) {
+                std::cout << progress.host.toStdString() << ":" << progress.nbMatches.get()
+                          << "\n";
+            }
+        }
+
+        if ( !printCount ) {
+            for ( const auto& line : search.getLines( 0_lnum, search.getNbLine() ) ) {
+                std::cout << line.toStdString() << "\n";
+            }
+        }
+        std::cout.flush();
+
+        app.exit( hasErrors ? 2 : hasMatches ? 0 : 1 );
+    } );
+
+    search.runSearch( pattern );
+    return app.exec();
+}
+} // namespace
+
 int main( int argc, char* argv[] )
 {
 #ifdef KLOGG_USE_MIMALLOC
     mi_stats_reset();
 #endif
-    qRegisterMetaType<LinesCount>( "LinesCount" );
-    qRegisterMetaType<LineNumber>( "LineNumber" );
 
+    // Application is needed only for parsing of arguments and settings,
+    // search runs without an event loop unless files are on agents
     QCoreApplication app( argc, argv );
     CliParameters parameters( app, true );
 
     logging::enableLogging( true, static_cast<logging::LogLevel>( parameters.log_level ) );
 
-    auto configuration = Configuration::getSynced();
+    auto& configuration = Configuration::getSynced();
+    if ( parameters.numa_node >= 0 ) {
+        configuration.setNumaNode( parameters.numa_node );
+    }
 
-    LogData logData;
-    auto filteredData = logData.getNewFilteredData();
+    const auto fileNames = parameters.agents.empty() ? expandFileNames( parameters.filenames )
+                                                     : parameters.filenames;
+    if ( fileNames.empty() || parameters.pattern.isEmpty() ) {
+        std::cerr << "klogg_grep: pattern and at least one file are required\n";
+        return 2;
+    }
 
-    filteredData->connect(
-        filteredData.get(), &LogFilteredData::searchProgressed,
-        [ & ]( LinesCount nbMatches, int progress, LineNumber ) {
-            if ( progress == 100 ) {
+    BatchGrepOptions options;
+    options.pattern = RegularExpressionPattern( parameters.pattern );
+    options.printCount = parameters.print_count;
+    options.printFileNames = parameters.print_file_names;
+    options.printLineNumbers = parameters.print_line_numbers;
+    if ( parameters.max_count >= 0 ) {
+        options.maxCount = static_cast<uint64_t>( parameters.max_count );
+    }
+    options.prefixFileNames = fileNames.size() > 1;
 
-                LOG_INFO << "Searched finished, got " << nbMatches.get() << " matches";
+    const RegularExpression regularExpression( options.pattern );
+    if ( !regularExpression.isValid() ) {
+        std::cerr << "klogg_grep: " << regularExpression.errorString().toStdString() << "\n";
+        return 2;
+    }
 
-                const auto defaultChunkSize = 1000_lcount;
-                for ( auto chunkStart = 0_lnum; chunkStart < nbMatches;
-                      chunkStart = chunkStart + defaultChunkSize ) {
-                    auto chunkSize
-                        = std::min( defaultChunkSize.get(), nbMatches.get() - chunkStart.get() );
-                    auto lines = filteredData->getLines( chunkStart, LinesCount( chunkSize ) );
-                    for ( const auto& l : lines ) {
-                        std::cout << l.toStdString() << "\n";
-                    }
-                }
+    if ( !parameters.agents.empty() ) {
+        return searchOnAgents( app, agentEndpoints( parameters.agents, fileNames ),
+                               options.pattern, options.printCount );
+    }
 
-                exit( EXIT_SUCCESS );
-            }
-        } );
+#ifdef Q_OS_WIN
+    // Matching lines are written as they are in the file
+    _setmode( _fileno( stdout ), _O_BINARY );
+#endif
+    std::setvbuf( stdout, nullptr, _IOFBF, OutputBufferSize );
 
-    logData.connect( &logData, &LogData::loadingFinished, [ & ]() {
-        dispatchToMainThread(
-            [ & ] { filteredData->runSearch( RegularExpressionPattern( parameters.pattern ) ); } );
-    } );
+    BatchGrep grep( options, stdout );
+    const auto exitCode = grep.run( fileNames );
 
-    logData.attachFile( parameters.filenames.front() );
-    return app.exec();
-}
\ No newline at end of file
+    if ( parameters.print_stats ) {
+        std::cerr << "Search\n" << grep.stats().toString().toStdString() << "\n";
+    }
+
+    return exitCode;
+}
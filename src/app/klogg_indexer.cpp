@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#if defined( KLOGG_USE_TBBMALLOC )
+#include <tbb/tbbmalloc_proxy.h>
+#elif defined( KLOGG_USE_MIMALLOC )
+#include <mimalloc.h>
+#endif
+
+#include <iostream>
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QFileInfo>
+
+#if defined( Q_OS_WIN )
+#include <windows.h>
+#elif defined( Q_OS_MAC )
+#include <sys/resource.h>
+#elif defined( Q_OS_LINUX )
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "configuration.h"
+#include "indexwarmer.h"
+#include "klogg_version.h"
+#include "logger.h"
+#include "persistentinfo.h"
+
+// Settings and caches are shared with klogg
+const bool PersistentInfo::ForcePortable = false;
+
+namespace {
+// Indexing should not slow down the services that write the logs
+void lowerProcessPriority()
+{
+#if defined( Q_OS_WIN )
+    SetPriorityClass( GetCurrentProcess(), PROCESS_MODE_BACKGROUND_BEGIN );
+#elif defined( Q_OS_MAC )
+    setiopolicy_np( IOPOL_TYPE_DISK, IOPOL_SCOPE_PROCESS, IOPOL_THROTTLE );
+    setpriority( PRIO_PROCESS, 0, 19 );
+#elif defined( Q_OS_LINUX )
+    // Threads started later inherit priorities of the main thread
+    constexpr int IoprioWhoProcess = 1;
+    constexpr int IoprioClassIdle = 3;
+    constexpr int IoprioClassShift = 13;
+    syscall( SYS_ioprio_set, IoprioWhoProcess, 0, IoprioClassIdle << IoprioClassShift );
+    setpriority( PRIO_PROCESS, 0, 19 );
+#endif
+}
+} // namespace
+
+int main( int argc, char* argv[] )
+{
+#ifdef KLOGG_USE_MIMALLOC
+    mi_stats_reset();
+#endif
+
+    // Before any threads are started
+    lowerProcessPriority();
+
+    QCoreApplication app( argc, argv );
+    // Cache directory is named after the application
+    QCoreApplication::setApplicationName( "klogg" );
+    QCoreApplication::setApplicationVersion( kloggVersion().data() );
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(
+        "Builds klogg index cache of log files in directories ahead of time" );
+    parser.addHelpOption();
+    parser.addVersionOption();
+
+    const QCommandLineOption filterOption( QStringList() << "f"
+                                                         << "filter",
+                                           "index only files matching wildcard", "filter" );
+    const QCommandLineOption debugOption(
+        QStringList() << "d"
+                      << "debug",
+        "output more debug (increase number for more verbosity)", "debug_level", "0" );
+
+    parser.addOption( filterOption );
+    parser.addOption( debugOption );
+    parser.addPositionalArgument( "directories", "directories to watch" );
+    parser.process( app );
+
+    const auto logLevel = 3 + parser.value( debugOption ).toInt();
+    logging::enableLogging( true, static_cast<logging::LogLevel>( logLevel ) );
+
+    const auto& configuration = Configuration::getSynced();
+    if ( !configuration.useIndexCache() || !configuration.fastModificationDetection() ) {
+        std::cerr << "klogg_indexer: index cache is disabled in klogg settings\n";
+        return EXIT_FAILURE;
+    }
+
+    const auto directories = parser.positionalArguments();
+    if ( directories.isEmpty() ) {
+        parser.showHelp( EXIT_FAILURE );
+    }
+
+    IndexWarmer indexWarmer( parser.isSet( filterOption ) ? parser.values( filterOption )
+                                                          : QStringList{} );
+    for ( const auto& directory : directories ) {
+        indexWarmer.watchDirectory( QFileInfo( directory ).absoluteFilePath() );
+    }
+
+    return app.exec();
+}
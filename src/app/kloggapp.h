@@ -34,6 +34,8 @@
 #endif
 
 #include <QDir>
+#include <QElapsedTimer>
+#include <QEvent>
 #include <QFontDatabase>
 #include <QMessageBox>
 #include <QNetworkProxyFactory>
@@ -72,6 +74,7 @@ class KloggApp : public SingleApplication {
         QNetworkProxyFactory::setUseSystemConfiguration( true );
 
         qRegisterMetaType<LoadingStatus>( "LoadingStatus" );
+        qRegisterMetaType<OperationStats>( "OperationStats" );
         qRegisterMetaType<LinesCount>( "LinesCount" );
         qRegisterMetaType<LineNumber>( "LineNumber" );
         qRegisterMetaType<std::vector<LineNumber>>( "std::vector<LineNumber>" );
@@ -213,6 +216,45 @@ class KloggApp : public SingleApplication {
         versionChecker_.startCheck();
     }
 
+    void setStartupTimer( QElapsedTimer startupTimer )
+    {
+        startupTimer_ = startupTimer;
+    }
+
+    // Crash handler and background tasks are not needed to show the first
+    // lines, they are started once the window has been painted.
+    void startDeferredInitialization( MainWindow* window, bool clearSessions )
+    {
+        clearInactiveSessions_ = clearSessions;
+        firstPaintWindow_ = window;
+        window->installEventFilter( this );
+
+        // Window can stay hidden, e.g. when it is restored minimized
+        QTimer::singleShot( DeferredInitializationTimeout, this,
+                            [ this ] { runDeferredInitialization(); } );
+    }
+
+    bool eventFilter( QObject* watched, QEvent* event ) override
+    {
+        if ( watched == firstPaintWindow_ && event->type() == QEvent::Paint ) {
+            firstPaintWindow_->removeEventFilter( this );
+            firstPaintWindow_ = nullptr;
+            logStartupStep( "first paint" );
+
+            // Let the paint finish before doing anything else
+            QTimer::singleShot( 0, this, [ this ] { runDeferredInitialization(); } );
+        }
+
+        return SingleApplication::eventFilter( watched, event );
+    }
+
+    void logStartupStep( const char* step ) const
+    {
+        if ( startupTimer_.isValid() ) {
+            LOG_INFO << "Startup: " << step << " at " << startupTimer_.elapsed() << " ms";
+        }
+    }
+
 #ifdef Q_OS_MAC
     bool event( QEvent* event ) override
     {
@@ -233,6 +275,29 @@ class KloggApp : public SingleApplication {
 #endif
 
   private:
+    void runDeferredInitialization()
+    {
+        if ( isDeferredInitializationDone_ ) {
+            return;
+        }
+        isDeferredInitializationDone_ = true;
+
+        if ( firstPaintWindow_ ) {
+            firstPaintWindow_->removeEventFilter( this );
+            firstPaintWindow_ = nullptr;
+        }
+
+        initCrashHandler();
+        logStartupStep( "crash handler initialized" );
+
+        if ( clearInactiveSessions_ ) {
+            clearInactiveSessions();
+        }
+
+        startBackgroundTasks();
+        logStartupStep( "deferred initialization done" );
+    }
+
     MainWindow* newWindow( WindowSession&& session )
     {
         mainWindows_.emplace_back( session, new MainWindow( session ) );
@@ -330,6 +395,13 @@ class KloggApp : public SingleApplication {
     std::stack<QPointer<MainWindow>> activeWindows_;
 
     VersionChecker versionChecker_;
+
+    static constexpr int DeferredInitializationTimeout = 2000;
+
+    QElapsedTimer startupTimer_;
+    QPointer<MainWindow> firstPaintWindow_;
+    bool clearInactiveSessions_ = false;
+    bool isDeferredInitializationDone_ = false;
 };
 
 #endif // KLOGG_KLOGGAPP_H
@@ -0,0 +1,372 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "logagent.h"
+
+#include <algorithm>
+#include <iterator>
+
+#include <QFileInfo>
+#include <QTcpSocket>
+#include <QTextCodec>
+
+#include "log.h"
+#include "logdata.h"
+#include "logfiltereddata.h"
+
+AgentSession::AgentSession( QTcpSocket* socket, const QStringList& allowedDirectories,
+                            QObject* parent )
+    : QObject( parent )
+    , socket_( socket )
+    , allowedDirectories_( allowedDirectories )
+{
+    socket_->setParent( this );
+    connect( socket_, &QTcpSocket::readyRead, this, &AgentSession::readMessages );
+    connect( socket_, &QTcpSocket::disconnected, this, &QObject::deleteLater );
+
+    LOG_INFO << "Connection from " << socket_->peerAddress().toString();
+}
+
+AgentSession::~AgentSession()
+{
+    LOG_INFO << "Closing connection from " << socket_->peerAddress().toString();
+
+    if ( filteredData_ ) {
+        filteredData_->interruptSearch();
+    }
+    if ( logData_ ) {
+        logData_->interruptLoading();
+    }
+}
+
+void AgentSession::readMessages()
+{
+    received_.append( socket_->readAll() );
+
+    bool isBroken = false;
+    while ( const auto message = remote::takeMessage( received_, isBroken ) ) {
+        handleMessage( *message );
+    }
+
+    if ( isBroken ) {
+        LOG_ERROR << "Broken message from " << socket_->peerAddress().toString();
+        socket_->abort();
+    }
+}
+
+void AgentSession::handleMessage( const remote::Message& message )
+{
+    if ( !logData_ && message.type != remote::MessageType::Open ) {
+        sendError( "File is not opened" );
+        return;
+    }
+
+    switch ( message.type ) {
+    case remote::MessageType::Open:
+        if ( const auto request = remote::decode<remote::OpenRequest>( message ) ) {
+            openFile( *request );
+        }
+        break;
+    case remote::MessageType::GetLines:
+        if ( const auto request = remote::decode<remote::LinesRequest>( message ) ) {
+            sendLines( *request );
+        }
+        break;
+    case remote::MessageType::Search:
+        if ( const auto request = remote::decode<remote::SearchRequest>( message ) ) {
+            startSearch( *request );
+        }
+        break;
+    case remote::MessageType::InterruptSearch:
+        if ( const auto request = remote::decode<remote::InterruptRequest>( message ) ) {
+            if ( search_ && search_->searchId == request->searchId ) {
+                filteredData_->interruptSearch();
+                search_.reset();
+            }
+        }
+        break;
+    case remote::MessageType::GetMatchedLines:
+        if ( const auto request = remote::decode<remote::MatchedLinesRequest>( message ) ) {
+            sendMatchedLines( *request );
+        }
+        break;
+    case remote::MessageType::SetEncoding:
+        if ( const auto request = remote::decode<remote::EncodingRequest>( message ) ) {
+            setEncoding( *request );
+        }
+        break;
+    default:
+        sendError( QString( "Unexpected message %1" ).arg( static_cast<int>( message.type ) ) );
+        break;
+    }
+}
+
+void AgentSession::openFile( const remote::OpenRequest& request )
+{
+    if ( request.magic != remote::ProtocolMagic || request.version != remote::ProtocolVersion ) {
+        sendError( "Unsupported protocol version" );
+        socket_->disconnectFromHost();
+        return;
+    }
+
+    if ( logData_ ) {
+        sendError( "File is already opened" );
+        return;
+    }
+
+    if ( !isAllowedFile( request.fileName ) ) {
+        LOG_WARNING << "Refused to open " << request.fileName;
+        sendError( "File is not in directories served by agent" );
+        socket_->disconnectFromHost();
+        return;
+    }
+
+    LOG_INFO << "Opening " << request.fileName;
+
+    logData_ = std::make_unique<LogData>();
+    filteredData_ = logData_->getNewFilteredData();
+
+    connect( logData_.get(), &LogData::loadingProgressed, this,
+             &AgentSession::loadingProgressed );
+    connect( logData_.get(), &LogData::loadingFinished, this, &AgentSession::loadingFinished );
+    connect( logData_.get(), &LogData::fileChanged, this, &AgentSession::fileChanged );
+    connect( filteredData_.get(), &LogFilteredData::searchProgressed, this,
+             [ this ]( LinesCount nbMatches, int progress, LineNumber ) {
+                 searchProgressed( nbMatches, progress );
+             } );
+
+    logData_->attachFile( request.fileName );
+}
+
+void AgentSession::sendLines( const remote::LinesRequest& request )
+{
+    const auto nbLines = logData_->getNbLine().get();
+    const auto firstLine = std::min( request.firstLine, nbLines );
+    const auto count = std::min( { request.count, nbLines - firstLine, MaxLinesPerRequest } );
+
+    remote::LinesReply reply;
+    reply.generation = generation_;
+    reply.firstLine = firstLine;
+    reply.lines = logData_->getLines( LineNumber( firstLine ), LinesCount( count ) );
+    socket_->write( remote::encode( reply ) );
+}
+
+void AgentSession::sendMatchedLines( const remote::MatchedLinesRequest& request )
+{
+    if ( !search_ || search_->searchId != request.searchId ) {
+        sendError( "Search is not running" );
+        return;
+    }
+
+    remote::MatchedLinesReply reply;
+    reply.searchId = request.searchId;
+    reply.firstIndex = request.firstIndex;
+
+    const auto matches = filteredData_->getMatchingLines();
+    uint64_t firstMatch = 0;
+    const auto count = std::min( request.count, MaxLinesPerRequest );
+    if ( count == 0 || !matches.select( request.firstIndex, &firstMatch ) ) {
+        socket_->write( remote::encode( reply ) );
+        return;
+    }
+
+    // Consecutive matches are read together
+    auto match = matches.begin();
+    match.move( firstMatch );
+    uint64_t runStart = *match;
+    uint64_t runLength = 0;
+    const auto readRun = [ this, &reply, &runStart, &runLength ]() {
+        auto lines = logData_->getLines( LineNumber( runStart ), LinesCount( runLength ) );
+        std::move( lines.begin(), lines.end(), std::back_inserter( reply.lines ) );
+    };
+
+    for ( auto taken = 0u; taken < count && match != matches.end(); ++taken, ++match ) {
+        if ( *match != runStart + runLength ) {
+            readRun();
+            runStart = *match;
+            runLength = 0;
+        }
+        ++runLength;
+    }
+    readRun();
+
+    socket_->write( remote::encode( reply ) );
+}
+
+void AgentSession::startSearch( const remote::SearchRequest& request )
+{
+    filteredData_->interruptSearch();
+    search_ = request;
+
+    // Search of a file that is not indexed yet starts when it is
+    isSearchStarted_ = logData_->isLoaded();
+    if ( isSearchStarted_ ) {
+        filteredData_->runSearch( request.pattern );
+    }
+}
+
+void AgentSession::setEncoding( const remote::EncodingRequest& request )
+{
+    auto encoding = request.encoding;
+    if ( encoding.isEmpty() ) {
+        const auto* detectedEncoding = logData_->getDetectedEncoding();
+        encoding = detectedEncoding ? detectedEncoding->name()
+                                    : QTextCodec::codecForLocale()->name();
+    }
+    logData_->setDisplayEncoding( encoding.constData() );
+
+    // Lines sent before were decoded in other encoding
+    ++generation_;
+    sendFileInfo();
+}
+
+void AgentSession::loadingProgressed( int percent )
+{
+    // Lines added later are announced when they are indexed
+    if ( logData_->isLoaded() ) {
+        return;
+    }
+
+    progress_ = std::min( percent, 99 );
+    sendFileInfo();
+}
+
+void AgentSession::loadingFinished( LoadingStatus status )
+{
+    if ( status != LoadingStatus::Successful ) {
+        sendError( "Failed to index file" );
+    }
+
+    progress_ = 100;
+    sendFileInfo();
+
+    if ( !search_ ) {
+        return;
+    }
+
+    // Matches in lines added to the file are added to the results
+    if ( isTruncated_ || !isSearchStarted_ ) {
+        filteredData_->runSearch( search_->pattern );
+    }
+    else {
+        filteredData_->updateSearch( 0_lnum, LineNumber( logData_->getNbLine().get() ) );
+    }
+    isSearchStarted_ = true;
+    isTruncated_ = false;
+}
+
+void AgentSession::fileChanged( MonitoredFileStatus status )
+{
+    if ( status == MonitoredFileStatus::Truncated ) {
+        ++generation_;
+        isTruncated_ = true;
+    }
+}
+
+void AgentSession::searchProgressed( LinesCount nbMatches, int progress )
+{
+    if ( !search_ ) {
+        return;
+    }
+
+    remote::SearchProgress searchProgress;
+    searchProgress.searchId = search_->searchId;
+    searchProgress.nbMatches = nbMatches.get();
+    searchProgress.progress = progress;
+    socket_->write( remote::encode( searchProgress ) );
+
+    if ( progress == 100 ) {
+        remote::SearchResults results;
+        results.searchId = search_->searchId;
+        results.matches = filteredData_->getMatchingLines();
+        socket_->write( remote::encode( results ) );
+    }
+}
+
+void AgentSession::sendFileInfo()
+{
+    remote::FileInfo fileInfo;
+    fileInfo.generation = generation_;
+    fileInfo.nbLines = logData_->getNbLine().get();
+    fileInfo.fileSize = logData_->getFileSize();
+    fileInfo.maxLength = static_cast<qint32>( logData_->getMaxLength().get() );
+    fileInfo.progress = progress_;
+    fileInfo.encoding = logData_->getDisplayEncoding()->name();
+    socket_->write( remote::encode( fileInfo ) );
+}
+
+void AgentSession::sendError( const QString& message )
+{
+    remote::ErrorReply error;
+    error.message = message;
+    socket_->write( remote::encode( error ) );
+}
+
+bool AgentSession::isAllowedFile( const QString& fileName ) const
+{
+    // Links and relative parts are resolved, so paths can be compared
+    const auto canonicalName = QFileInfo( fileName ).canonicalFilePath();
+    if ( canonicalName.isEmpty() ) {
+        return false;
+    }
+
+    return std::any_of( allowedDirectories_.begin(), allowedDirectories_.end(),
+                        [ &canonicalName ]( const QString& directory ) {
+                            return canonicalName.startsWith( directory );
+                        } );
+}
+
+LogAgent::LogAgent( const QStringList& allowedDirectories, QObject* parent )
+    : QObject( parent )
+{
+    for ( const auto& directory : allowedDirectories ) {
+        const auto canonicalPath = QFileInfo( directory ).canonicalFilePath();
+        if ( canonicalPath.isEmpty() ) {
+            LOG_WARNING << "Directory " << directory << " does not exist";
+            continue;
+        }
+        // Separator is kept, so /var/log does not allow /var/logs
+        allowedDirectories_.append( canonicalPath.endsWith( '/' ) ? canonicalPath
+                                                                  : canonicalPath + '/' );
+    }
+
+    connect( &server_, &QTcpServer::newConnection, this, &LogAgent::acceptConnections );
+}
+
+bool LogAgent::listen( const QHostAddress& address, quint16 port )
+{
+    if ( !server_.listen( address, port ) ) {
+        return false;
+    }
+
+    LOG_INFO << "Listening on " << address.toString() << ":" << server_.serverPort();
+    return true;
+}
+
+QString LogAgent::errorString() const
+{
+    return server_.errorString();
+}
+
+void LogAgent::acceptConnections()
+{
+    while ( auto* socket = server_.nextPendingConnection() ) {
+        new AgentSession( socket, allowedDirectories_, this );
+    }
+}
@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_LOGAGENT_H
+#define KLOGG_LOGAGENT_H
+
+#include <memory>
+#include <optional>
+
+#include <QHostAddress>
+#include <QObject>
+#include <QStringList>
+#include <QTcpServer>
+
+#include "loadingstatus.h"
+#include "remoteprotocol.h"
+
+class LogData;
+class LogFilteredData;
+class QTcpSocket;
+
+// Connection of one klogg tab to the agent. The file is indexed and
+// searched here, only lines asked for and bitmaps of matching lines
+// are sent back. Search is updated when lines are added to the file.
+class AgentSession : public QObject {
+    Q_OBJECT
+
+  public:
+    // Lines sent in one reply at most
+    static constexpr quint64 MaxLinesPerRequest = 64 * 1024;
+
+    AgentSession( QTcpSocket* socket, const QStringList& allowedDirectories,
+                  QObject* parent = nullptr );
+    ~AgentSession() override;
+
+  private:
+    void readMessages();
+    void handleMessage( const remote::Message& message );
+
+    void openFile( const remote::OpenRequest& request );
+    void sendLines( const remote::LinesRequest& request );
+    void sendMatchedLines( const remote::MatchedLinesRequest& request );
+    void startSearch( const remote::SearchRequest& request );
+    void setEncoding( const remote::EncodingRequest& request );
+
+    void loadingProgressed( int percent );
+    void loadingFinished( LoadingStatus status );
+    void fileChanged( MonitoredFileStatus status );
+    void searchProgressed( LinesCount nbMatches, int progress );
+
+    void sendFileInfo();
+    void sendError( const QString& message );
+    bool isAllowedFile( const QString& fileName ) const;
+
+  private:
+    QTcpSocket* socket_;
+    QStringList allowedDirectories_;
+    QByteArray received_;
+
+    std::unique_ptr<LogData> logData_;
+    std::unique_ptr<LogFilteredData> filteredData_;
+
+    // Changed when lines sent before are not valid anymore
+    quint32 generation_ = 0;
+    int progress_ = 0;
+    bool isTruncated_ = false;
+
+    std::optional<remote::SearchRequest> search_;
+    bool isSearchStarted_ = false;
+};
+
+// Accepts connections of klogg and serves files from allowed directories
+class LogAgent : public QObject {
+    Q_OBJECT
+
+  public:
+    LogAgent( const QStringList& allowedDirectories, QObject* parent = nullptr );
+
+    bool listen( const QHostAddress& address, quint16 port );
+    QString errorString() const;
+
+  private:
+    void acceptConnections();
+
+  private:
+    QStringList allowedDirectories_;
+    QTcpServer server_;
+};
+
+#endif
@@ -37,6 +37,7 @@
  */
 
 #include "log.h"
+#include <QElapsedTimer>
 #include <QMessageBox>
 #include <QtGlobal>
 #include <qapplication.h>
@@ -62,6 +63,7 @@
 #include "cpu_info.h"
 #include "logger.h"
 #include "mainwindow.h"
+#include "memory_info.h"
 #include "styles.h"
 
 #include "cli.h"
@@ -121,12 +123,17 @@ int main( int argc, char* argv[] )
 {
 #ifdef KLOGG_USE_MIMALLOC
     mi_process_init();
+    setAllocatorReleaser( []() { mi_collect( true ); } );
 #endif
 
+    QElapsedTimer startupTimer;
+    startupTimer.start();
+
     const auto& config = Configuration::getSynced();
     setApplicationAttributes( config.enableQtHighDpi(), config.scaleFactorRounding() );
 
     KloggApp app( argc, argv );
+    app.setStartupTimer( startupTimer );
     CliParameters parameters( app );
 
     const auto logLevel
@@ -134,8 +141,6 @@ int main( int argc, char* argv[] )
     logging::enableLogging( parameters.enable_logging || config.enableLogging(), logLevel );
     logging::enableFileLogging( parameters.log_to_file || config.enableLogging(), logLevel );
 
-    app.initCrashHandler();
-
     auto maxConcurrency
         = tbb::global_control::active_value( tbb::global_control::max_allowed_parallelism );
 
@@ -161,6 +166,10 @@ int main( int argc, char* argv[] )
         app.sendFilesToPrimaryInstance( parameters.filenames );
     }
     else {
+        app.logStartupStep( "application created" );
+
+        // Style is applied before the window is shown,
+        // changing it later repaints every widget.
         StyleManager::applyStyle( config.style() );
 
         auto startNewSession = true;
@@ -185,12 +194,14 @@ int main( int argc, char* argv[] )
             mw->loadInitialFile( filename, parameters.follow_file );
         }
 
-        if ( startNewSession ) {
-            app.clearInactiveSessions();
-        }
-
-        app.startBackgroundTasks();
+        app.startDeferredInitialization( mw, startNewSession );
+        app.logStartupStep( "window shown" );
     }
 
-    return app.exec();
+    const auto exitCode = app.exec();
+
+    // Settings saved while closing windows are still pending
+    PersistentInfo::flush();
+
+    return exitCode;
 }
@@ -24,5 +24,15 @@
 
 uint64_t physicalMemory();
 uint64_t usedMemory();
+// Physical memory the process occupies
+uint64_t residentMemory();
+
+// Called by releaseFreedMemory to release caches of malloc replacement,
+// like mi_collect of mimalloc. Set by the application that links it.
+void setAllocatorReleaser( void ( *releaser )() );
+
+// Gives memory freed by the process back to the system, including
+// pages kept by the allocator. Returns the decrease of resident memory.
+uint64_t releaseFreedMemory();
 
 #endif
\ No newline at end of file
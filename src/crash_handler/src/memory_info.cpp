@@ -17,12 +17,20 @@
  * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <atomic>
 #include <mutex>
 
 #include <QtGlobal>
 
 #include "memory_info.h"
 
+namespace {
+std::atomic<void ( * )()> allocatorReleaser{ nullptr };
+
+// Pages of the heap kept by the system allocator
+void releaseSystemHeap();
+} // namespace
+
 #if defined( Q_OS_WIN )
 
 #include <windows.h>
@@ -44,6 +52,20 @@ uint64_t usedMemory()
     return static_cast<uint64_t>( pmc.PagefileUsage );
 }
 
+uint64_t residentMemory()
+{
+    PROCESS_MEMORY_COUNTERS pmc;
+    GetProcessMemoryInfo( GetCurrentProcess(), &pmc, sizeof( pmc ) );
+    return static_cast<uint64_t>( pmc.WorkingSetSize );
+}
+
+namespace {
+void releaseSystemHeap()
+{
+    HeapCompact( GetProcessHeap(), 0 );
+}
+} // namespace
+
 #elif defined( Q_OS_APPLE )
 
 #include <sys/sysctl.h>
@@ -51,6 +73,7 @@ uint64_t usedMemory()
 
 #include <AvailabilityMacros.h>
 #include <mach/mach.h>
+#include <malloc/malloc.h>
 #include <mach/shared_region.h>
 #include <unistd.h>
 
@@ -83,12 +106,36 @@ uint64_t usedMemory()
     }
 }
 
+uint64_t residentMemory()
+{
+    task_basic_info info;
+    mach_msg_type_number_t msgType = TASK_BASIC_INFO_COUNT;
+    if ( task_info( mach_task_self(), TASK_BASIC_INFO, reinterpret_cast<task_info_t>( &info ),
+                    &msgType )
+         != KERN_SUCCESS ) {
+        return 0;
+    }
+    return info.resident_size;
+}
+
+namespace {
+void releaseSystemHeap()
+{
+    malloc_zone_pressure_relief( nullptr, 0 );
+}
+} // namespace
+
 #else
 
 #include <stdint.h>
 #include <unistd.h>
 
+#if defined( __GLIBC__ )
+#include <malloc.h>
+#endif
+
 #include <array>
+#include <cstring>
 
 uint64_t systemPhysicalMemory()
 {
@@ -97,7 +144,9 @@ uint64_t systemPhysicalMemory()
     return pages * pageSize;
 }
 
-uint64_t usedMemory()
+namespace {
+// Size in kB of a field of process status, like "VmSize:"
+uint64_t statusValue( const char* field )
 {
     long unsigned size = 0;
     FILE* statusFile = fopen( "/proc/self/status", "r" );
@@ -105,10 +154,11 @@ uint64_t usedMemory()
         return 0;
     }
 
+    const auto fieldLength = strlen( field );
     std::array<char, 200> status;
-    static constexpr auto pattern = "VmSize: %lu";
     while ( NULL != fgets( status.data(), status.size(), statusFile ) ) {
-        if ( 1 == sscanf( status.data(), pattern, &size ) ) {
+        if ( 0 == strncmp( status.data(), field, fieldLength )
+             && 1 == sscanf( status.data() + fieldLength, "%lu", &size ) ) {
             break;
         }
     }
@@ -117,6 +167,24 @@ uint64_t usedMemory()
     return size * 1024;
 }
 
+void releaseSystemHeap()
+{
+#if defined( __GLIBC__ )
+    malloc_trim( 0 );
+#endif
+}
+} // namespace
+
+uint64_t usedMemory()
+{
+    return statusValue( "VmSize:" );
+}
+
+uint64_t residentMemory()
+{
+    return statusValue( "VmRSS:" );
+}
+
 #endif
 
 namespace {
@@ -128,4 +196,23 @@ uint64_t physicalMemory()
 {
     std::call_once( totalMemoryFlag, []() { totalMemory = systemPhysicalMemory(); } );
     return totalMemory;
+}
+
+void setAllocatorReleaser( void ( *releaser )() )
+{
+    allocatorReleaser = releaser;
+}
+
+uint64_t releaseFreedMemory()
+{
+    const auto residentBefore = residentMemory();
+
+    // Replacement keeps freed pages in its own caches first
+    if ( const auto releaser = allocatorReleaser.load() ) {
+        releaser();
+    }
+    releaseSystemHeap();
+
+    const auto residentAfter = residentMemory();
+    return residentBefore > residentAfter ? residentBefore - residentAfter : 0;
 }
\ No newline at end of file
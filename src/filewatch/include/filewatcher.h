@@ -73,6 +73,9 @@ class FileWatcher : public QObject {
     // (do nothing if said file is not monitored)
     void removeFile( const QString& fileName );
 
+    // Files of inactive tabs are polled less often
+    void setFileActive( const QString& fileName, bool isActive );
+
     void updateConfiguration();
 
   public Q_SLOTS:
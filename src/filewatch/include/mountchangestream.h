@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_MOUNTCHANGESTREAM_H
+#define KLOGG_MOUNTCHANGESTREAM_H
+
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Writes to any file on whole mounts reported by the OS as a single
+// stream of changed paths, so files on these mounts do not have to be
+// polled one by one. Uses fanotify on Linux, which needs CAP_SYS_ADMIN;
+// the stream is not available elsewhere or without the capability.
+// Only writes done through the local kernel are reported, so mounts of
+// network filesystems are not watched.
+class MountChangeStream {
+  public:
+    // Called from the thread of the stream with the path of changed file,
+    // or with an empty path if some changes were lost
+    using ChangeCallback = std::function<void( const std::string& )>;
+
+    explicit MountChangeStream( ChangeCallback callback );
+    ~MountChangeStream();
+
+    MountChangeStream( const MountChangeStream& ) = delete;
+    MountChangeStream& operator=( const MountChangeStream& ) = delete;
+
+    bool isAvailable() const;
+
+    // Watches the mount of the directory (do nothing if it is already
+    // watched), returns false if changes on it can't be reported
+    bool watchMount( const std::string& directory );
+
+  private:
+    void readChanges();
+
+  private:
+    ChangeCallback callback_;
+
+    int notifyFd_ = -1;
+    int stopFd_ = -1;
+
+    // Devices of watched mounts
+    std::vector<unsigned long long> mounts_;
+    std::thread thread_;
+};
+
+#endif
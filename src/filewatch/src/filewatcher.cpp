@@ -22,11 +22,15 @@
 #include "configuration.h"
 #include "dispatch_to.h"
 #include "log.h"
+#include "mountchangestream.h"
 #include "synchronization.h"
 
 #include <KDSignalThrottler.h>
 #include <efsw/efsw.hpp>
 
+#include <algorithm>
+#include <limits>
+#include <memory>
 #include <vector>
 
 #include <QDateTime>
@@ -36,11 +40,25 @@
 
 namespace {
 
+// Files that do not change are polled less often,
+// down to once in this number of poll intervals
+constexpr int64_t MaxPollBackoff = 32;
+
+// Files of inactive tabs are polled this many times less often
+constexpr int64_t InactivePollFactor = 4;
+
 struct WatchedFile {
     std::string name;
     int64_t mTime;
     int64_t size;
 
+    // Number of poll intervals until the next poll and its time
+    int64_t pollBackoff = 1;
+    int64_t nextPollTime = 0;
+
+    // File is shown in the current tab
+    bool isActive = true;
+
     bool operator==( const std::string& filename ) const
     {
         return name == filename;
@@ -58,6 +76,11 @@ struct WatchedDirecotry {
     // filenames are in utf8
     std::string name;
     std::vector<WatchedFile> files;
+
+    // Changes are reported by the stream of the whole mount,
+    // with paths that do not have symlinks
+    bool hasChangeStream = false;
+    std::string canonicalName;
 };
 
 bool isOnlyForPolling( const WatchedDirecotry& wd )
@@ -74,6 +97,11 @@ class EfswFileWatcher final : public efsw::FileWatchListener {
     {
     }
 
+    ~EfswFileWatcher() override
+    {
+        enableChangeStream( false );
+    }
+
     void enableWatch( bool enable )
     {
         ScopedRecursiveLock lock( mutex_ );
@@ -98,6 +126,36 @@ class EfswFileWatcher final : public efsw::FileWatchListener {
         }
     }
 
+    void enableChangeStream( bool enable )
+    {
+        std::unique_ptr<MountChangeStream> disabledStream;
+        {
+            ScopedRecursiveLock lock( mutex_ );
+
+            if ( ( changeStream_ != nullptr ) == enable ) {
+                return;
+            }
+
+            if ( enable ) {
+                changeStream_ = std::make_unique<MountChangeStream>(
+                    [ this ]( const std::string& path ) { notifyOnMountChange( path ); } );
+
+                for ( auto& dir : watchedPaths_ ) {
+                    watchMount( dir );
+                }
+            }
+            else {
+                for ( auto& dir : watchedPaths_ ) {
+                    dir.hasChangeStream = false;
+                }
+                disabledStream = std::move( changeStream_ );
+            }
+        }
+
+        // Thread of the stream may wait for the lock until it is stopped
+        disabledStream.reset();
+    }
+
     void addFile( const QString& fullFileName )
     {
         ScopedRecursiveLock lock( mutex_ );
@@ -131,6 +189,7 @@ class EfswFileWatcher final : public efsw::FileWatchListener {
         if ( watchedDirectory == watchedPaths_.end() ) {
             watchedPaths_.push_back(
                 { tryWatchDirectory( directory ), directory, { std::move( watchedFile ) } } );
+            watchMount( watchedPaths_.back() );
         }
         else {
 
@@ -153,6 +212,35 @@ class EfswFileWatcher final : public efsw::FileWatchListener {
         }
     }
 
+    void setFileActive( const QString& fullFileName, bool isActive )
+    {
+        ScopedRecursiveLock lock( mutex_ );
+
+        const QFileInfo fileInfo = QFileInfo( fullFileName );
+
+        const auto directory = fileInfo.absolutePath().toStdString();
+
+        auto watchedDirectory
+            = std::find_if( watchedPaths_.begin(), watchedPaths_.end(),
+                            [ &directory ]( const auto& wd ) { return wd.name == directory; } );
+
+        if ( watchedDirectory == watchedPaths_.end() ) {
+            return;
+        }
+
+        auto& files = watchedDirectory->files;
+        auto watchedFile = std::find( files.begin(), files.end(), fileInfo.fileName().toStdString() );
+        if ( watchedFile != files.end() ) {
+            watchedFile->isActive = isActive;
+
+            // File shown again is polled at the next interval
+            if ( isActive ) {
+                watchedFile->pollBackoff = 1;
+                watchedFile->nextPollTime = 0;
+            }
+        }
+    }
+
     void removeFile( const QString& fullFileName )
     {
         ScopedRecursiveLock lock( mutex_ );
@@ -196,15 +284,24 @@ class EfswFileWatcher final : public efsw::FileWatchListener {
         }
     }
 
-    void checkWatches()
+    // Polls the files that are due, returns time until the next poll
+    int64_t checkWatches( int64_t pollIntervalMs )
     {
-        const auto collectChangedFiles = [ this ]() {
+        const auto now = QDateTime::currentMSecsSinceEpoch();
+        auto nextPollTime = std::numeric_limits<int64_t>::max();
+
+        const auto collectChangedFiles = [ this, now, pollIntervalMs, &nextPollTime ]() {
             ScopedRecursiveLock lock( mutex_ );
 
             std::vector<QString> changedFiles;
 
             for ( auto& dir : watchedPaths_ ) {
                 for ( auto& file : dir.files ) {
+                    if ( file.nextPollTime > now ) {
+                        nextPollTime = std::min( nextPollTime, file.nextPollTime );
+                        continue;
+                    }
+
                     const auto path
                         = QDir::cleanPath( QString::fromStdString( dir.name ) + QDir::separator()
                                            + QString::fromStdString( file.name ) );
@@ -218,9 +315,22 @@ class EfswFileWatcher final : public efsw::FileWatchListener {
                     if ( file != watchedFile ) {
                         changedFiles.push_back( path );
                         LOG_INFO << "will notify for " << path;
+                        file.pollBackoff = 1;
+                    }
+                    else if ( dir.hasChangeStream ) {
+                        // Changes come from the stream, polls only catch up on missed ones
+                        file.pollBackoff = MaxPollBackoff;
+                    }
+                    else {
+                        file.pollBackoff = std::min( 2 * file.pollBackoff, MaxPollBackoff );
                     }
 
-                    file = std::move( watchedFile );
+                    file.mTime = watchedFile.mTime;
+                    file.size = watchedFile.size;
+                    file.nextPollTime = now
+                                        + file.pollBackoff * pollIntervalMs
+                                              * ( file.isActive ? 1 : InactivePollFactor );
+                    nextPollTime = std::min( nextPollTime, file.nextPollTime );
                 }
             }
 
@@ -232,6 +342,8 @@ class EfswFileWatcher final : public efsw::FileWatchListener {
                 watcher->fileChangedOnDisk( changedFile );
             } );
         }
+
+        return std::max( nextPollTime - now, pollIntervalMs );
     }
 
     void handleFileAction( efsw::WatchID watchid, const std::string& dir,
@@ -270,6 +382,53 @@ class EfswFileWatcher final : public efsw::FileWatchListener {
         }
     }
 
+    // Called from the thread of the mount change stream for any file on watched mounts
+    void notifyOnMountChange( const std::string& path )
+    {
+        const auto separator = path.rfind( '/' );
+        const auto directory = path.substr( 0, separator == std::string::npos ? 0 : separator );
+        const auto filename = path.substr( separator == std::string::npos ? 0 : separator + 1 );
+
+        std::vector<QString> changedFiles;
+        {
+            ScopedRecursiveLock lock( mutex_ );
+
+            for ( const auto& dir : watchedPaths_ ) {
+                // Empty path means some changes were lost
+                if ( !dir.hasChangeStream
+                     || ( !path.empty() && dir.canonicalName != directory ) ) {
+                    continue;
+                }
+
+                for ( const auto& file : dir.files ) {
+                    if ( path.empty() || file.name == filename ) {
+                        changedFiles.push_back(
+                            QDir::cleanPath( QString::fromStdString( dir.name ) + QDir::separator()
+                                             + QString::fromStdString( file.name ) ) );
+                    }
+                }
+            }
+        }
+
+        for ( const auto& changedFile : changedFiles ) {
+            dispatchToMainThread( [ watcher = parent_, changedFile ]() {
+                watcher->fileChangedOnDisk( changedFile );
+            } );
+        }
+    }
+
+    void watchMount( WatchedDirecotry& dir )
+    {
+        if ( !changeStream_ ) {
+            return;
+        }
+
+        dir.canonicalName
+            = QDir( QString::fromStdString( dir.name ) ).canonicalPath().toStdString();
+        dir.hasChangeStream
+            = !dir.canonicalName.empty() && changeStream_->watchMount( dir.canonicalName );
+    }
+
     QString findChangedFilename( const std::string& directory, const std::string& filename,
                                  const std::string& oldFilename )
     {
@@ -280,25 +439,22 @@ class EfswFileWatcher final : public efsw::FileWatchListener {
                             [ &directory ]( const auto& wd ) { return wd.name == directory; } );
 
         if ( watchedDirectory != watchedPaths_.end() ) {
-            std::string changedFilename;
+            auto watchedFile
+                = std::find_if( watchedDirectory->files.begin(), watchedDirectory->files.end(),
+                                [ &filename, &oldFilename ]( const auto& f ) {
+                                    return f.name == filename || f.name == oldFilename;
+                                } );
 
-            const auto isFileWatched
-                = std::any_of( watchedDirectory->files.begin(), watchedDirectory->files.end(),
-                               [ &filename, &oldFilename, &changedFilename ]( const auto& f ) {
-                                   if ( f.name == filename || f.name == oldFilename ) {
-                                       changedFilename = f.name;
-                                       return true;
-                                   }
-
-                                   return false;
-                               } );
-
-            if ( isFileWatched ) {
+            if ( watchedFile != watchedDirectory->files.end() ) {
                 LOG_DEBUG << "fileChangedOnDisk - will notify for " << filename << ", old name "
                           << oldFilename;
 
+                // Active file is polled again at the next interval
+                watchedFile->pollBackoff = 1;
+                watchedFile->nextPollTime = 0;
+
                 return QDir::cleanPath( QString::fromStdString( directory ) + QDir::separator()
-                                        + QString::fromStdString( changedFilename ) );
+                                        + QString::fromStdString( watchedFile->name ) );
             }
             else {
                 LOG_DEBUG << "fileChangedOnDisk - call but no file monitored";
@@ -313,6 +469,7 @@ class EfswFileWatcher final : public efsw::FileWatchListener {
 
   private:
     efsw::FileWatcher watcher_;
+    std::unique_ptr<MountChangeStream> changeStream_;
     std::vector<WatchedDirecotry> watchedPaths_;
     FileWatcher* parent_;
 
@@ -328,7 +485,7 @@ void EfswFileWatcherDeleter::operator()( EfswFileWatcher* watcher ) const
 
 FileWatcher::FileWatcher()
     : checkTimer_{ new QTimer( this ) }
-    , throttler_{ new KDToolBox::KDSignalThrottler( this ) }
+    , throttler_{ new KDToolBox::KDSignalLeadingThrottler( this ) }
     , efswWatcher_{ new EfswFileWatcher( this ) }
 {
     connect( checkTimer_, &QTimer::timeout, this, &FileWatcher::checkWatches );
@@ -360,8 +517,24 @@ void FileWatcher::removeFile( const QString& fileName )
     updateConfiguration();
 }
 
+void FileWatcher::setFileActive( const QString& fileName, bool isActive )
+{
+    efswWatcher_->setFileActive( fileName, isActive );
+
+    const auto pollIntervalMs = Configuration::get().pollIntervalMs();
+    if ( isActive && checkTimer_->isActive() && checkTimer_->interval() > pollIntervalMs ) {
+        checkTimer_->start( pollIntervalMs );
+    }
+}
+
 void FileWatcher::fileChangedOnDisk( const QString& fileName )
 {
+    // Changed file is polled at the next interval
+    const auto pollIntervalMs = Configuration::get().pollIntervalMs();
+    if ( checkTimer_->isActive() && checkTimer_->interval() > pollIntervalMs ) {
+        checkTimer_->start( pollIntervalMs );
+    }
+
     if ( std::find( changes_.begin(), changes_.end(), fileName ) == changes_.end() ) {
         changes_.push_back( fileName );
     }
@@ -392,9 +565,12 @@ void FileWatcher::updateConfiguration()
     }
 
     efswWatcher_->enableWatch( config.nativeFileWatchEnabled() );
+    efswWatcher_->enableChangeStream( config.mountChangeStreamEnabled() );
 }
 
 void FileWatcher::checkWatches()
 {
-    efswWatcher_->checkWatches();
+    // Timer is set to the time when the next file is due
+    const auto nextPollMs = efswWatcher_->checkWatches( Configuration::get().pollIntervalMs() );
+    checkTimer_->start( static_cast<int>( nextPollMs ) );
 }
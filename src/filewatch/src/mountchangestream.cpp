@@ -0,0 +1,209 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "mountchangestream.h"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstdint>
+
+#include <QtGlobal>
+
+#ifdef Q_OS_LINUX
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/fanotify.h>
+#include <sys/stat.h>
+#include <sys/vfs.h>
+#include <unistd.h>
+#define KLOGG_HAS_FANOTIFY
+#endif
+
+#include "log.h"
+
+namespace {
+#ifdef KLOGG_HAS_FANOTIFY
+// Writes of other clients of these filesystems are not seen by the local kernel
+constexpr std::array<unsigned long, 6> NetworkFilesystems = {
+    0x6969,     // NFS
+    0x517B,     // SMB
+    0xFF534D42, // CIFS
+    0xFE534D42, // SMB2
+    0x65735546, // FUSE, sshfs among others
+    0x00C36400, // Ceph
+};
+
+bool isNetworkFilesystem( const std::string& directory )
+{
+    struct statfs info {};
+    if ( ::statfs( directory.c_str(), &info ) != 0 ) {
+        return true;
+    }
+
+    const auto type = static_cast<unsigned long>( info.f_type );
+    return std::find( NetworkFilesystems.begin(), NetworkFilesystems.end(), type )
+           != NetworkFilesystems.end();
+}
+
+std::string pathOfDescriptor( int fd )
+{
+    const auto link = "/proc/self/fd/" + std::to_string( fd );
+    std::array<char, 4096> path;
+    const auto length = ::readlink( link.c_str(), path.data(), path.size() );
+    if ( length <= 0 ) {
+        return {};
+    }
+
+    return std::string( path.data(), static_cast<size_t>( length ) );
+}
+#endif
+} // namespace
+
+MountChangeStream::MountChangeStream( ChangeCallback callback )
+    : callback_{ std::move( callback ) }
+{
+#ifdef KLOGG_HAS_FANOTIFY
+    notifyFd_ = ::fanotify_init( FAN_CLASS_NOTIF | FAN_CLOEXEC | FAN_NONBLOCK,
+                                 O_RDONLY | O_LARGEFILE | O_CLOEXEC );
+    if ( notifyFd_ < 0 ) {
+        LOG_INFO << "fanotify is not available, error " << errno;
+        return;
+    }
+
+    stopFd_ = ::eventfd( 0, EFD_CLOEXEC );
+    if ( stopFd_ < 0 ) {
+        LOG_WARNING << "failed to create eventfd, error " << errno;
+        ::close( notifyFd_ );
+        notifyFd_ = -1;
+    }
+#endif
+}
+
+MountChangeStream::~MountChangeStream()
+{
+#ifdef KLOGG_HAS_FANOTIFY
+    if ( thread_.joinable() ) {
+        const uint64_t stop = 1;
+        if ( ::write( stopFd_, &stop, sizeof( stop ) ) != sizeof( stop ) ) {
+            LOG_WARNING << "failed to stop mount change stream, error " << errno;
+        }
+        thread_.join();
+    }
+
+    if ( stopFd_ >= 0 ) {
+        ::close( stopFd_ );
+    }
+    if ( notifyFd_ >= 0 ) {
+        ::close( notifyFd_ );
+    }
+#endif
+}
+
+bool MountChangeStream::isAvailable() const
+{
+    return notifyFd_ >= 0;
+}
+
+bool MountChangeStream::watchMount( const std::string& directory )
+{
+#ifdef KLOGG_HAS_FANOTIFY
+    if ( !isAvailable() || isNetworkFilesystem( directory ) ) {
+        return false;
+    }
+
+    struct stat info {};
+    if ( ::stat( directory.c_str(), &info ) != 0 ) {
+        return false;
+    }
+
+    const auto device = static_cast<unsigned long long>( info.st_dev );
+    if ( std::find( mounts_.begin(), mounts_.end(), device ) != mounts_.end() ) {
+        return true;
+    }
+
+    if ( ::fanotify_mark( notifyFd_, FAN_MARK_ADD | FAN_MARK_MOUNT, FAN_MODIFY | FAN_CLOSE_WRITE,
+                          AT_FDCWD, directory.c_str() )
+         != 0 ) {
+        LOG_WARNING << "failed to watch mount of " << directory << " error " << errno;
+        return false;
+    }
+
+    LOG_INFO << "Watching mount of " << directory;
+    mounts_.push_back( device );
+
+    if ( !thread_.joinable() ) {
+        thread_ = std::thread( [ this ] { readChanges(); } );
+    }
+
+    return true;
+#else
+    Q_UNUSED( directory );
+    return false;
+#endif
+}
+
+void MountChangeStream::readChanges()
+{
+#ifdef KLOGG_HAS_FANOTIFY
+    std::array<pollfd, 2> descriptors = { pollfd{ notifyFd_, POLLIN, 0 },
+                                          pollfd{ stopFd_, POLLIN, 0 } };
+
+    alignas( fanotify_event_metadata ) std::array<char, 16 * 1024> buffer;
+
+    while ( true ) {
+        if ( ::poll( descriptors.data(), descriptors.size(), -1 ) < 0 ) {
+            if ( errno == EINTR ) {
+                continue;
+            }
+            LOG_WARNING << "mount change stream failed, error " << errno;
+            return;
+        }
+
+        if ( descriptors[ 1 ].revents != 0 ) {
+            return;
+        }
+
+        auto length = ::read( notifyFd_, buffer.data(), buffer.size() );
+        if ( length <= 0 ) {
+            continue;
+        }
+
+        auto* event = reinterpret_cast<const fanotify_event_metadata*>( buffer.data() );
+        while ( FAN_EVENT_OK( event, length ) ) {
+            if ( event->mask & FAN_Q_OVERFLOW ) {
+                LOG_WARNING << "mount change stream overflow";
+                callback_( {} );
+            }
+
+            if ( event->fd >= 0 ) {
+                const auto path = pathOfDescriptor( event->fd );
+                ::close( event->fd );
+
+                if ( !path.empty() ) {
+                    callback_( path );
+                }
+            }
+
+            event = FAN_EVENT_NEXT( event, length );
+        }
+    }
+#endif
+}
@@ -44,6 +44,8 @@
 #include <QStringList>
 #include <QTextCodec>
 
+#include "ansicolors.h"
+#include "linebatch.h"
 #include "linetypes.h"
 
 // Base class representing a set of data.
@@ -60,6 +62,19 @@ class AbstractLogData : public QObject {
     std::vector<QString> getLines( LineNumber first_line, LinesCount number ) const;
     // Returns a set of lines with tabs expanded
     std::vector<QString> getExpandedLines( LineNumber first_line, LinesCount number ) const;
+    // Reads a set of lines into batch replacing its lines, used by
+    // consumers of many lines to avoid a string for each line
+    void getLinesBatch( LineNumber first_line, LinesCount number, LineBatch& batch ) const;
+    // Returns nb_columns of a set of lines with tabs expanded,
+    // starting at first_column
+    std::vector<QString> getExpandedLinesWindow( LineNumber first_line, LinesCount number,
+                                                 int first_column, int nb_columns ) const;
+    // Returns parts of the line colored by ANSI sequences,
+    // empty if sequences are not removed from lines
+    std::vector<AnsiColorSpan> getLineColors( LineNumber line ) const;
+    // Long lines are only read up to a limit for display, this reads
+    // more of the line. Returns false if the line is already read whole.
+    bool loadMoreOfLine( LineNumber line ) const;
     // Returns the total number of lines
     LinesCount getNbLine() const;
     // Returns the visible length of the longest line
@@ -68,6 +83,11 @@ class AbstractLogData : public QObject {
     // Returns the visible length of the passed line
     // Tabs are expanded
     LineLength getLineLength( LineNumber line ) const;
+    // Starts reading the lines in background, so they are
+    // ready when asked for later
+    void prefetchLines( LineNumber first_line, LinesCount number ) const;
+    // Returns true if the lines can be read without waiting for the file
+    bool areLinesCached( LineNumber first_line, LinesCount number ) const;
 
     // Set the view to use the passed encoding for display
     void setDisplayEncoding( const char* encoding_name );
@@ -86,6 +106,7 @@ class AbstractLogData : public QObject {
         Plain = 0, // 0 can be checked like a proper flag in QFlags
         Match = 1 << 0,
         Mark = 1 << 1,
+        Context = 1 << 2, // shown around matches, not a match itself
     };
     Q_DECLARE_FLAGS( LineType, LineTypeFlags )
 
@@ -99,12 +120,29 @@ class AbstractLogData : public QObject {
     // Internal function called to get a set of expanded lines
     virtual std::vector<QString> doGetExpandedLines( LineNumber first_line,
                                                      LinesCount number ) const = 0;
+    // Internal function called to get a set of lines into batch,
+    // by default lines are copied from doGetLines
+    virtual void doGetLinesBatch( LineNumber first_line, LinesCount number,
+                                  LineBatch& batch ) const;
+    // Internal function called to get columns of a set of expanded lines
+    virtual std::vector<QString> doGetExpandedLinesWindow( LineNumber first_line,
+                                                           LinesCount number, int first_column,
+                                                           int nb_columns ) const = 0;
+    // Internal function called to get colors of a line,
+    // by default lines have no colors
+    virtual std::vector<AnsiColorSpan> doGetLineColors( LineNumber line ) const;
+    virtual bool doLoadMoreOfLine( LineNumber line ) const;
     // Internal function called to get the number of lines
     virtual LinesCount doGetNbLine() const = 0;
     // Internal function called to get the maximum length
     virtual LineLength doGetMaxLength() const = 0;
     // Internal function called to get the line length
     virtual LineLength doGetLineLength( LineNumber line ) const = 0;
+    // Internal function called to prefetch a set of lines
+    virtual void doPrefetchLines( LineNumber first_line, LinesCount number ) const = 0;
+    // Internal function called to check lines are cached,
+    // by default lines are always at hand
+    virtual bool doAreLinesCached( LineNumber first_line, LinesCount number ) const;
     // Internal function called to set the encoding
     virtual void doSetDisplayEncoding( const char* encoding ) = 0;
     virtual QTextCodec* doGetDisplayEncoding() const = 0;
@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_ANALYSISBUNDLE_H
+#define KLOGG_ANALYSISBUNDLE_H
+
+#include <vector>
+
+#include <QByteArray>
+#include <QString>
+
+#include "linetypes.h"
+#include "logdataworker.h"
+#include "persistentsearchcache.h"
+
+// Single file with the state of analysis of a log file: index of lines
+// and timestamps, cached search results, marks and highlighters.
+// Bundle is bound to the file by hashes of its indexed part, so whoever
+// has the same file opens it without reading the whole file again.
+// Index and search results are in the formats of index and search caches.
+class AnalysisBundle {
+  public:
+    // Name of the bundled file without directory, to suggest where to find it
+    QString fileName;
+
+    std::vector<PersistentSearchCache::Entry> searchResults;
+    SearchResultArray marks;
+
+    // Highlighter sets in the format of exported highlighters
+    QByteArray highlighters;
+
+    // Takes index and its hashes from the accessor, returns false if there
+    // is no index yet
+    bool setIndex( const IndexingData::ConstAccessor& scopedAccessor );
+
+    bool save( const QString& bundlePath ) const;
+
+    bool load( const QString& bundlePath );
+
+    // Returns true if indexed part of the file is the same as the bundled one
+    bool isBundleOf( const QString& localFileName ) const;
+
+    // Index and search results are kept until the file is indexed
+    // and searched, they are used instead of index cache and search cache
+    void attach( const QString& localFileName ) const;
+
+    // Returns true if accessor was populated from attached bundle
+    static bool loadAttachedIndex( const QString& fileName,
+                                   IndexingData::MutateAccessor& scopedAccessor );
+
+    // Returns empty list if no bundle was attached to the file
+    static std::vector<PersistentSearchCache::Entry>
+    takeAttachedSearchResults( const QString& fileName );
+
+  private:
+    IndexedHash hash_;
+    QByteArray forcedEncoding_;
+    QByteArray index_;
+};
+
+#endif
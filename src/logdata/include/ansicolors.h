@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef KLOGG_ANSICOLORS_H
+#define KLOGG_ANSICOLORS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// Color set by ANSI SGR sequence, palette index of 256 color
+// terminal or 24-bit RGB value
+struct AnsiColor {
+    enum class Type : uint8_t { Default, Indexed, Rgb };
+
+    Type type = Type::Default;
+    uint32_t value = 0;
+
+    bool operator==( const AnsiColor& other ) const
+    {
+        return type == other.type && value == other.value;
+    }
+
+    bool operator!=( const AnsiColor& other ) const
+    {
+        return !( *this == other );
+    }
+};
+
+// Part of a line shown in colors set by sequences before it
+struct AnsiColorSpan {
+    int startColumn;
+    int length;
+    AnsiColor foreColor;
+    AnsiColor backColor;
+};
+
+namespace ansi_colors {
+
+constexpr size_t MaxParameterDigits = 3;
+
+// Returns end of color (SGR) or erase in line sequence starting
+// with escape character, nullptr if there is no sequence at this position.
+// Sequence has up to MaxParameterDigits digits in each parameter.
+const char* sequenceEnd( const char* escape, const char* end );
+
+// Parses UTF-8 line in one pass. Columns of spans are UTF-16 characters
+// of the line with sequences removed, parts in default colors are skipped.
+std::vector<AnsiColorSpan> parseLine( std::string_view line );
+
+} // namespace ansi_colors
+
+#endif
@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_BINARYREGIONINDEX_H
+#define KLOGG_BINARYREGIONINDEX_H
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include <QtGlobal>
+
+#include <roaring64map.hh>
+
+#include "encodingdetector.h"
+
+class QDataStream;
+
+// Regions of indexed file that hold binary data, like blobs written into
+// logs or zero filled space left by preallocation. File is split into chunks
+// of ChunkSize bytes, chunk is binary if many of its bytes are control
+// characters, see line_scanner::countBinaryBytes. Only lines overlapping
+// binary chunks are checked when they are read, the same way.
+// Text of wide encodings has zero bytes, binary data is not looked for in it.
+class BinaryRegionIndex {
+  public:
+    static constexpr qint64 ChunkSize = 4096;
+    // Text is binary if more than one of this many bytes are control ones
+    static constexpr size_t BinaryRatio = 16;
+
+    // Numbers of binary chunks of the block at offset of the file,
+    // parts of chunks at the block edges are checked by themselves
+    static std::vector<uint64_t> findBinaryChunks( qint64 offset, std::string_view block,
+                                                   const EncodingParameters& encodingParams );
+
+    static bool isBinary( std::string_view text );
+
+    // Adds chunks found in the next block
+    void append( const std::vector<uint64_t>& chunks );
+
+    // Drops chunks past size bytes, they are added again
+    void truncate( qint64 size );
+
+    void clear();
+
+    // True if bytes in [begin, end) overlap binary chunks
+    bool hasBinaryChunks( qint64 begin, qint64 end ) const;
+
+    size_t allocatedSize() const;
+
+    void save( QDataStream& stream ) const;
+    bool load( QDataStream& stream );
+
+  private:
+    roaring::Roaring64Map chunks_;
+};
+
+#endif // KLOGG_BINARYREGIONINDEX_H
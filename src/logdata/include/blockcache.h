@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef KLOGG_BLOCKCACHE_H
+#define KLOGG_BLOCKCACHE_H
+
+#include <list>
+#include <map>
+#include <utility>
+
+#include <QByteArray>
+#include <QString>
+
+#include "fileholder.h"
+#include "synchronization.h"
+
+// Copies of indexed blocks of files kept on local disk, so files on slow
+// network shares are read over the network only while they are indexed.
+// Blocks are keyed by file id, offset and the digest computed while the
+// block was indexed, so blocks of a rewritten file are never read back.
+// Least recently used blocks are removed when the cache grows over
+// its configured size.
+class BlockCache {
+  public:
+    struct Key {
+        FileId fileId;
+        qint64 offset = 0;
+        quint64 digest = 0;
+    };
+
+    static BlockCache& get();
+
+    BlockCache( const BlockCache& ) = delete;
+    BlockCache& operator=( const BlockCache& ) = delete;
+
+    bool isEnabled() const;
+
+    // Stores a copy of the block if it is not cached yet
+    void store( const Key& key, const QByteArray& block );
+
+    // Reads length bytes at offset from the start of the cached block,
+    // returns false if block is not cached
+    bool read( const Key& key, qint64 offset, char* data, qint64 length );
+
+  private:
+    BlockCache();
+    ~BlockCache() = default;
+
+    static QString entryName( const Key& key );
+
+    // Finds blocks stored by previous runs, oldest are evicted first
+    void loadEntries();
+
+    // Removes least recently used blocks over the size limit, called under lock
+    void evict();
+
+  private:
+    Mutex mutex_;
+    QString directory_;
+    bool isLoaded_ = false;
+    qint64 size_ = 0;
+
+    // Names and sizes of blocks, the most recently used first
+    using Entries = std::list<std::pair<QString, qint64>>;
+    Entries entries_;
+    std::map<QString, Entries::iterator> entryByName_;
+};
+
+#endif // KLOGG_BLOCKCACHE_H
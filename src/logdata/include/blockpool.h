@@ -23,16 +23,28 @@
 #include <vector>
 #include <cstddef>
 #include <cstdint>
+#include <memory>
 
+class QDataStream;
+class QTemporaryFile;
+
+// Blocks are allocated from fixed size chunks, so growing the pool
+// never moves existing blocks. Chunks are either allocated on heap
+// or mapped from a temporary file to let OS page out cold parts of index.
+// Heap chunks can be backed by large pages to reduce TLB misses.
 class BlockPoolBase
 {
 public:
+    static constexpr size_t ChunkSize = 4 * 1024 * 1024;
+
     BlockPoolBase( const BlockPoolBase& ) = delete;
     BlockPoolBase& operator =( const BlockPoolBase& ) = delete;
 
     BlockPoolBase( BlockPoolBase&& other ) noexcept ;
     BlockPoolBase& operator=( BlockPoolBase&& other ) noexcept ;
 
+    ~BlockPoolBase();
+
     size_t getElementSize() const;
     size_t getPaddedElementSize() const;
 
@@ -41,10 +53,21 @@ public:
 
     uint32_t currentBlock() const;
 
+    // Size used by blocks
     size_t allocatedSize() const;
+    // Size of all chunks
+    size_t virtualSize() const;
+    // Size of chunks in RAM, can be less than
+    // virtual size for file backed pools
+    size_t residentSize() const;
+
+    void save( QDataStream& stream ) const;
+    bool load( QDataStream& stream );
 
 protected:
+    // Chunks are kept in a temporary file if configured, see Configuration::useFileBackedIndex
     BlockPoolBase( size_t elementSize, size_t alignment );
+    BlockPoolBase( size_t elementSize, size_t alignment, bool isFileBacked );
 
     uint8_t* getBlock( size_t elementsCount );
     uint8_t* resizeLastBlock( size_t newSize );
@@ -54,7 +77,30 @@ protected:
     size_t lastBlockSize() const;
 
 private:
-  std::vector<uint8_t> pool_;
+  uint8_t* dataAt( size_t offset ) const;
+
+  // Returns offset where block of blockSize can start
+  // so that it does not cross chunk boundary
+  size_t reserve( size_t offset, size_t blockSize );
+  void addChunk();
+
+private:
+  // Frees chunk the way it was allocated
+  struct HeapChunkDeleter {
+      enum class Allocation { Heap, Aligned, Virtual };
+      Allocation allocation = Allocation::Heap;
+
+      void operator()( uint8_t* chunk ) const;
+  };
+  using HeapChunk = std::unique_ptr<uint8_t[], HeapChunkDeleter>;
+
+  static HeapChunk allocateHeapChunk( bool useLargePages );
+
+private:
+  std::vector<uint8_t*> chunks_;
+  std::vector<HeapChunk> heapChunks_;
+  bool useLargePages_ = false;
+  std::unique_ptr<QTemporaryFile> backingFile_;
 
   size_t elementSize_;
   size_t alignment_;
@@ -71,6 +117,10 @@ public:
     BlockPool() : BlockPoolBase( sizeof( ElementType ), alignof( ElementType ) )
     {}
 
+    explicit BlockPool( bool isFileBacked )
+        : BlockPoolBase( sizeof( ElementType ), alignof( ElementType ), isFileBacked )
+    {}
+
     uint32_t get_block( size_t block_elements_count, ElementType initial_position, size_t* next_offset )
     {
         auto ptr = getBlock( block_elements_count );
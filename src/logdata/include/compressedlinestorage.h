@@ -40,58 +40,46 @@
 #include <cstdint>
 #include <vector>
 
+#include <QtGlobal>
+
 #include "blockpool.h"
 #include "linetypes.h"
 
+class QDataStream;
+
 // This class is a compressed storage backend for LinePositionArray
 // It emulates the interface of a vector, but take advantage of the nature
 // of the stored data (increasing end of line addresses) to apply some
 // compression in memory, while still providing fast, constant-time look-up.
 
-/* The current algorithm takes advantage of the fact most lines are reasonably
- * short, it codes each line on:
- * - Line < 127 bytes    : 1 byte
- * - 127 < line < 16383  : 2 bytes
- * - line > 16383        : 6 bytes (or 10 bytes)
- * Uncompressed backend stores line on 4 bytes or 8 bytes.
+/* The algorithm takes advantage of the fact that lines close to each other
+ * usually have similar length, so differences between consecutive end of line
+ * addresses fit in a small number of bits.
  *
- * The algorithm is quite simple, the file is first divided in two parts:
+ * The file is first divided in two parts:
  * - The lines whose end are located before UINT32_MAX
  * - The lines whose end are located after UINT32_MAX
  * Those end of lines are stored separately in the table32 and the table64
  * respectively.
  *
- * The EOL list is then divided in blocks of IndexBlockSize (256) lines.
- * A block index vector (per table) contains pointers to each block.
- *
- * Each block is then defined as such:
- * Block32 (sizes in byte)
- * 00 - Absolute EOF address (4 bytes)
- * 04 - ( 0xxx xxxx  if second line is < 127 ) (1 byte, relative)
- *    - ( 10xx xxxx
- *        xxxx xxxx  if second line is < 16383 ) (2 bytes, relative)
- *    - ( 1111 1111
- *        xxxx xxxx
- *        xxxx xxxx  if second line is > 16383 ) (6 bytes, absolute)
- * ...
- * (126 more lines)
+ * The EOL list is then divided in blocks of IndexBlockSize (256) lines,
+ * each block is divided in 4 groups of IndexGroupSize (64) lines.
+ * Lines of the block being filled are kept uncompressed until the block
+ * is complete, then the block is packed into the pool.
  *
- * Block64 (sizes in byte)
- * 00 - Absolute EOF address (8 bytes)
- * 08 - ( 0xxx xxxx  if second line is < 127 ) (1 byte, relative)
- *    - ( 10xx xxxx
- *        xxxx xxxx  if second line is < 16383 ) (2 bytes, relative)
- *    - ( 1111 1111
- *        xxxx xxxx
- *        xxxx xxxx
- *        xxxx xxxx
- *        xxxx xxxx  if second line is > 16383 ) (10 bytes, absolute)
- * ...
- * (126 more lines)
+ * Each block is then defined as such (ElementType is uint32_t or uint64_t):
+ * 00 - Absolute EOL address of the first line (ElementType)
+ * 1x - EOL addresses of the first lines of groups 1-3, relative to
+ *      the first line of the block (3 * ElementType)
+ * 4x - Width in bits of deltas in each group (4 * uint8_t)
+ * 4x - Deltas between consecutive lines of each group. Group starts at byte
+ *      boundary and has 63 deltas of the same width packed one after another.
  *
- * Absolute addressing has been adopted for line > 16383 to bound memory usage in case
- * of pathologically long (MBs or GBs) lines, even if it is a bit less efficient for
- * long-ish (30 KB) lines.
+ * Fixed width deltas have no per-line markers to test, so any line is found
+ * by summing at most 63 deltas of its group, and whole groups can be
+ * unpacked without branches (or with SIMD).
+ * Width is at most 56 bits or exactly 64 bits, so each delta
+ * can be read with a single unaligned 64 bit load.
  *
  * The table32 always starts at 0, the table64 starts at first_long_line_
  */
@@ -102,11 +90,9 @@
 class CompressedLinePositionStorage {
   public:
     // Default constructor
-    CompressedLinePositionStorage()
-        : block_index_{ 0 }
-        , long_block_index_{ 0 }
-    {
-    }
+    CompressedLinePositionStorage();
+    // Pools are kept in memory mapped temporary files if isFileBacked is set
+    explicit CompressedLinePositionStorage( bool isFileBacked );
 
     // Copy constructor would be slow, delete!
     CompressedLinePositionStorage( const CompressedLinePositionStorage& orig ) = delete;
@@ -131,16 +117,13 @@ class CompressedLinePositionStorage {
     }
 
     size_t allocatedSize() const;
-
-   using BlockOffset = fluent::NamedType<size_t, struct block_offset, fluent::Incrementable, fluent::PreIncrementable,
-                                          fluent::Addable, fluent::Comparable>;
+    size_t residentSize() const;
 
     // Cache the last position read
     // This is to speed up consecutive reads (whole page)
     struct Cache {
         LineNumber index {std::numeric_limits<LineNumber::UnderlyingType>::max() - 1U};
         LineOffset position {0};
-        BlockOffset offset {0};
     };
 
     // Element at index
@@ -150,16 +133,32 @@ class CompressedLinePositionStorage {
     }
     LineOffset at( LineNumber i, Cache* lastPosition = nullptr ) const;
 
-    // Add one list to the other
+    // Append count elements starting at first to positions,
+    // each block is decoded only once
+    void range( LineNumber first, LinesCount count, std::vector<qint64>& positions ) const;
+
+    // Add one list to the other, whole blocks are packed straight from the list
     void append_list( const std::vector<LineOffset>& positions );
 
     // Pop the last element of the storage
     void pop_back();
 
+    // Binary (de)serialization of the storage,
+    // the format is machine dependent.
+    void save( QDataStream& stream ) const;
+    bool load( QDataStream& stream );
+
   private:
     // Utility for move ctor/assign
     void move_from( CompressedLinePositionStorage&& orig ) noexcept;
 
+    // Pack positions into a new block of the pool they belong to
+    void seal_block( const LineOffset* positions, size_t count );
+    // Pack current block into the pool it belongs to
+    void seal_current_block();
+    // Move last packed block of the pool back to current block
+    void unseal_last_block();
+
     // The two indexes
     BlockPool<uint32_t> pool32_;
     BlockPool<uint64_t> pool64_;
@@ -170,25 +169,13 @@ class CompressedLinePositionStorage {
     // Current position (position of the end of the last line added)
     LineOffset current_pos_;
 
-    uint32_t block_index_;
-    uint32_t long_block_index_;
-
     // The index of the first line whose end is stored in a block64
     // this is the origin point for all calculations in block64
     OptionalLineNumber first_long_line_;
 
-    // Offset of the next position (not yet written) within the current
-    // block. null means there is no current block (previous block
-    // finished or no data)
-    BlockOffset block_offset_;
-
-    // For pop_back:
-
-    // Previous offset to block element, it is restored when we
-    // "pop_back" the last element.
-    // A null here means pop_back need to free the block
-    // that has just been created.
-    BlockOffset previous_block_offset_;
+    // Uncompressed positions of the block being filled,
+    // it is packed when IndexBlockSize lines are added.
+    std::vector<LineOffset> current_block_;
 };
 
 #endif
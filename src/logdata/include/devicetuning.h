@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_DEVICETUNING_H
+#define KLOGG_DEVICETUNING_H
+
+#include <map>
+#include <set>
+#include <vector>
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QString>
+
+#include "atomicflag.h"
+#include "synchronization.h"
+
+// Search threads and read buffers tuned for the storage a file is on.
+// Each mount point is calibrated once, the first time a big enough file
+// on it is indexed: sequential read speed and latency of random reads are
+// measured on that file, and matching speed of one thread on its data.
+// Calibrations are kept in the cache directory.
+class DeviceTuning {
+  public:
+    // Files smaller than this are mostly read from page cache
+    static constexpr qint64 MinCalibrationFileSize = 16 * 1024 * 1024;
+    static constexpr qint64 SequentialReadSize = 32 * 1024 * 1024;
+    static constexpr int RandomReads = 16;
+
+    struct Parameters {
+        int searchThreadPoolSize = 0;
+        int indexReadBufferSizeMb = 0;
+        int searchReadBufferSizeLines = 0;
+    };
+
+    struct Calibration {
+        QString mountPoint;
+        QByteArray device;
+        QDateTime time;
+
+        double readMbPerSecond = 0;
+        double readLatencyMs = 0;
+        double matchMbPerSecond = 0;
+
+        Parameters parameters;
+    };
+
+    static DeviceTuning& get();
+
+    DeviceTuning( const DeviceTuning& ) = delete;
+    DeviceTuning& operator=( const DeviceTuning& ) = delete;
+
+    bool isEnabled() const;
+
+    // Calibrates the mount point of the file, unless it is calibrated already
+    // or the file is too small. Blocks for up to a couple of seconds.
+    void calibrate( const QString& fileName, const AtomicFlag& interruptRequested );
+
+    // Configured parameters, replaced by the tuned ones if the mount point
+    // of the file is calibrated and tuning is enabled
+    Parameters parameters( const QString& fileName ) const;
+
+    std::vector<Calibration> calibrations() const;
+
+    // Mount points are calibrated again when files on them are opened
+    void clear();
+
+    // Parameters for the measured speeds, threads are limited to cores
+    static Parameters tune( double readMbPerSecond, double readLatencyMs,
+                            double matchMbPerSecond, int cores );
+
+  private:
+    DeviceTuning();
+    ~DeviceTuning() = default;
+
+    static QString mountPoint( const QString& fileName );
+
+    // Reads calibrations saved by previous runs, called under lock
+    void load() const;
+    void save() const;
+
+  private:
+    mutable Mutex mutex_;
+    QString path_;
+    mutable bool isLoaded_ = false;
+    mutable std::map<QString, Calibration> calibrations_;
+    std::set<QString> calibrating_;
+};
+
+#endif
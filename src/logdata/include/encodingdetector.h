@@ -24,6 +24,7 @@
 
 #include <QByteArray>
 #include <memory>
+#include <vector>
 
 class QTextCodec;
 class QTextDecoder;
@@ -35,6 +36,10 @@ struct EncodingParameters {
     bool isUtf8Compatible{ false };
     bool isUtf16LE{ false };
 
+    // Encodings decoded in bulk without QTextDecoder
+    bool isUtf8{ false };
+    bool isLatin1{ false };
+
     int lineFeedWidth{ 1 };
     int lineFeedIndex{ 0 };
 
@@ -74,11 +79,13 @@ class EncodingDetector {
 
     QTextCodec* detectEncoding( const QByteArray& block ) const;
 
+    // Guesses encoding of samples taken from different parts of a file in parallel,
+    // byte order mark is only looked for in the first one
+    QTextCodec* detectEncoding( const std::vector<QByteArray>& samples ) const;
+
   private:
     EncodingDetector() = default;
     ~EncodingDetector() = default;
-
-    mutable SharedMutex mutex_;
 };
 
 struct TextDecoder {
@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_FANOUTSEARCH_H
+#define KLOGG_FANOUTSEARCH_H
+
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include <QElapsedTimer>
+#include <QTimer>
+
+#include "abstractlogdata.h"
+#include "mergedlinemap.h"
+#include "regularexpressionpattern.h"
+#include "timestampindex.h"
+
+class RemoteSearch;
+
+// One search of files on several hosts, each served by klogg_agent, see
+// RemoteSearch. Agents search their files at the same time. Matching
+// lines are fetched from each agent as soon as its search is finished
+// and are merged by their timestamps, see MergedLineMap. Lines of the
+// merge are prefixed with the name of their host. Lines without timestamp
+// stay after the previous line of the same host.
+// This class must be used from the thread it was created in.
+class FanOutSearch : public AbstractLogData {
+    Q_OBJECT
+
+  public:
+    struct Endpoint {
+        QString host;
+        quint16 port = 0;
+        QString fileName;
+    };
+
+    struct HostProgress {
+        QString host;
+        int progress = 0;
+        LinesCount nbMatches;
+        // Matching lines received and merged
+        LinesCount fetchedLines;
+        // Lines searched per second
+        double throughput = 0.0;
+        bool isFinished = false;
+        QString error;
+    };
+
+    // Matching lines fetched from one agent, the rest are only counted
+    static constexpr quint64 MaxLinesPerHost = 1000 * 1000;
+    static constexpr quint64 FetchChunkLines = 4096;
+
+    explicit FanOutSearch( std::vector<Endpoint> endpoints );
+    ~FanOutSearch() override;
+
+    void runSearch( const RegularExpressionPattern& pattern );
+    void interruptSearch();
+
+    size_t getHostsCount() const;
+    HostProgress getHostProgress( size_t host ) const;
+    bool isFinished() const;
+
+    // Host of the merged line and index of the line among its matches
+    MergedLineMap::SourceLine getSourceLine( LineNumber line ) const;
+
+    // Order of lines of several hosts by timestamps, lines with the same
+    // timestamp are taken from hosts in the order they were passed
+    static MergedLineMap mergeByTimestamps( const std::vector<std::vector<qint64>>& timestamps );
+
+  Q_SIGNALS:
+    void hostProgressed( size_t host );
+    // Sent when lines were added to the merge, at most a few times a second
+    void linesMerged();
+    // Sent when all agents finished search and sent matching lines
+    void searchFinished();
+
+  private:
+    // Implementation of virtual functions
+    QString doGetLineString( LineNumber line ) const override;
+    QString doGetExpandedLineString( LineNumber line ) const override;
+    std::vector<QString> doGetLines( LineNumber first, LinesCount number ) const override;
+    std::vector<QString> doGetExpandedLines( LineNumber first, LinesCount number ) const override;
+    std::vector<QString> doGetExpandedLinesWindow( LineNumber first, LinesCount number,
+                                                   int firstColumn,
+                                                   int nbColumns ) const override;
+    LinesCount doGetNbLine() const override;
+    LineLength doGetMaxLength() const override;
+    LineLength doGetLineLength( LineNumber line ) const override;
+    void doPrefetchLines( LineNumber first, LinesCount number ) const override;
+    void doSetDisplayEncoding( const char* encoding ) override;
+    QTextCodec* doGetDisplayEncoding() const override;
+    void doAttachReader() const override;
+    void doDetachReader() const override;
+
+    struct Host {
+        Endpoint endpoint;
+        std::unique_ptr<RemoteSearch> search;
+        HostProgress progress;
+
+        std::vector<QString> lines;
+        std::vector<qint64> timestamps;
+        std::optional<TimestampParser> parser;
+        bool isFetching = false;
+    };
+
+    void searchProgressed( size_t host, LinesCount nbMatches, int progress );
+    void hostSearchFinished( size_t host );
+    void matchedLinesReceived( size_t host, quint64 firstIndex,
+                               const std::vector<QString>& lines );
+    void fetchNextLines( size_t host );
+    void finishHost( size_t host, const QString& error = {} );
+
+    void parseTimestamps( Host& host, size_t firstLine );
+    void scheduleMerge();
+    void merge();
+
+  private:
+    std::vector<Host> hosts_;
+    QElapsedTimer searchTimer_;
+
+    MergedLineMap lineMap_;
+    LineLength maxLength_;
+    QTimer mergeTimer_;
+};
+
+#endif
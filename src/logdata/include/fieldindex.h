@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_FIELDINDEX_H
+#define KLOGG_FIELDINDEX_H
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <QString>
+#include <QStringList>
+
+#include <roaring64map.hh>
+
+#include "linetypes.h"
+
+// Field of structured log lines compared to a value
+struct FieldCondition {
+    QString field;
+    QString value;
+};
+
+// Parses queries like "level=ERROR and service=payments" with only
+// the passed fields, empty if text is not such a query
+std::optional<std::vector<FieldCondition>> parseFieldQuery( const QString& text,
+                                                            const QStringList& fields );
+
+// Values of configured fields of structured log lines: keys of JSON objects
+// like {"level":"ERROR"}, logfmt pairs like level=ERROR or columns of CSV
+// files named by their first line. Each field is a column with value id of
+// every line, each value is kept once in the dictionary of the column.
+// Lines are matched by comparing ids, no text is decoded or matched.
+class FieldIndex {
+  public:
+    explicit FieldIndex( const QStringList& fields = {} );
+
+    const QStringList& fields() const
+    {
+        return fields_;
+    }
+
+    // Number of lines added so far
+    LinesCount size() const;
+
+    // Adds UTF-8 lines following the lines added before
+    void append( const std::vector<std::string_view>& lines );
+
+    // Drops values of lines past count, they are added again
+    void truncate( LinesCount count );
+
+    // Lines in [first, last) where all fields have the values
+    roaring::Roaring64Map find( const std::vector<FieldCondition>& conditions, LineNumber first,
+                                LineNumber last ) const;
+
+    size_t allocatedSize() const;
+
+    // Value of key in JSON object or logfmt pairs of the line
+    static std::optional<std::string_view> keyValueField( std::string_view line,
+                                                          std::string_view key );
+
+    // CSV columns of the line, quotes are kept around quoted columns
+    static std::vector<std::string_view> csvColumns( std::string_view line );
+
+  private:
+    // Id 0 is used for lines without the field
+    using ValueId = uint32_t;
+
+    struct Column {
+        std::string key;
+        std::unordered_map<std::string, ValueId> dictionary;
+        std::vector<ValueId> values;
+        std::optional<size_t> csvIndex;
+    };
+
+    void appendValue( Column& column, std::optional<std::string_view> value );
+
+  private:
+    QStringList fields_;
+    std::vector<Column> columns_;
+
+    bool isFormatKnown_ = false;
+    bool isCsv_ = false;
+    uint64_t size_ = 0;
+};
+
+#endif
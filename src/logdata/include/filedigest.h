@@ -36,6 +36,10 @@ class FileDigest {
 
     QByteArray hash() const;
 
+    // Digest of one block of data hashed on its own, so that blocks
+    // can be hashed in parallel and their digests combined in order
+    static uint64_t blockDigest( const char* data, size_t length );
+
     void reset();
 
   private:
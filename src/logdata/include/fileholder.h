@@ -1,8 +1,12 @@
 #ifndef FILEHOLDER_H
 #define FILEHOLDER_H
 
+#include <QDateTime>
 #include <QFile>
+#include <QIODevice>
+#include <cstdint>
 #include <memory>
+#include <string_view>
 
 #include "synchronization.h"
 
@@ -18,24 +22,93 @@ struct FileId {
     static FileId getFileId( const QString& filename );
 };
 
+// Read-only memory mapping of a file.
+// Mapping owns a duplicate of the handle of the mapped file, so it stays
+// valid after FileHolder reopens the file; it is unmapped when the last
+// reference is released. Touching pages cut off by truncation of the file
+// raises SIGBUS, so only files that do not change may be mapped.
+class FileMapping {
+  public:
+    static std::shared_ptr<const FileMapping> map( const QFile& attachedFile );
+
+    ~FileMapping();
+
+    FileMapping( const FileMapping& ) = delete;
+    FileMapping& operator=( const FileMapping& ) = delete;
+
+    qint64 size() const
+    {
+        return size_;
+    }
+
+    // Returns a view of the mapped data, empty if the range
+    // is not inside the mapped region
+    std::string_view view( qint64 offset, qint64 length ) const;
+
+  private:
+    FileMapping( std::unique_ptr<QFile> file, uchar* data, qint64 size );
+
+    std::unique_ptr<QFile> file_;
+    uchar* data_;
+    qint64 size_;
+};
+
+// Reads data at given offsets of a file without a shared file position
+// (pread on POSIX, overlapped ReadFile on Windows), so threads read it
+// concurrently. Like mapping it owns a duplicate of the handle of the open
+// file and stays valid after FileHolder reopens the file.
+class PositionalFileReader {
+  public:
+    // Returns nullptr if the handle of the file can't be duplicated
+    static std::shared_ptr<const PositionalFileReader> duplicate( const QFile& file );
+
+    ~PositionalFileReader();
+
+    PositionalFileReader( const PositionalFileReader& ) = delete;
+    PositionalFileReader& operator=( const PositionalFileReader& ) = delete;
+
+    // Returns number of bytes read, it is less than length
+    // only at the end of file, or -1 on error
+    qint64 read( qint64 offset, char* data, qint64 length ) const;
+
+  private:
+    explicit PositionalFileReader( intptr_t handle );
+
+    // File descriptor on POSIX, HANDLE on Windows
+    intptr_t handle_;
+};
+
+// Returns device that reads data of the log file, gzip compressed files
+// are decompressed on the fly and remote files are fetched. Device is not opened.
+std::unique_ptr<QIODevice> makeLogFileDevice( const QString& fileName );
+
+// Opens the file for reading, it still can be renamed or deleted
+// by other processes while open. Returns nullptr on failure.
+std::unique_ptr<QFile> openSharedFile( const QString& fileName );
+
+// Keeps the file open while data is read from it. Reads of plain
+// files are not serialized, only compressed files are read under lock.
 template <typename T> class ScopedFileHolder {
   public:
     explicit ScopedFileHolder( T* file )
         : file_holder_( file )
     {
-        file_holder_->lock();
         file_holder_->attachReader();
     }
 
     ~ScopedFileHolder()
     {
-        file_holder_->unlock();
         file_holder_->detachReader();
     }
 
-    QFile* getFile()
+    qint64 read( qint64 offset, char* data, qint64 length )
     {
-        return file_holder_->getFile();
+        return file_holder_->read( offset, data, length );
+    }
+
+    std::shared_ptr<const FileMapping> getMapping( qint64 requiredSize )
+    {
+        return file_holder_->getMapping( requiredSize );
     }
 
   private:
@@ -48,7 +121,7 @@ class FileHolder {
     friend class ScopedFileHolder<FileHolder>;
 
   public:
-    explicit FileHolder( bool keepClosed );
+    explicit FileHolder( bool keepClosed, bool useMapping = false );
     ~FileHolder();
     FileId getFileId();
     qint64 size();
@@ -57,28 +130,41 @@ class FileHolder {
 
     void open( const QString& fileName );
 
-    void lock();
-    void unlock();
-
     void attachReader();
     void detachReader();
 
     void reOpenFile();
 
+    // Reads go through positional reads from now on, mappings already
+    // handed out stay valid until they are released
+    void stopMapping();
+
   private:
     Q_DISABLE_COPY( FileHolder )
 
-    QFile* getFile();
+    // Reads with positional reader of the attached file if it has one,
+    // otherwise seeks and reads the attached device under lock
+    qint64 read( qint64 offset, char* data, qint64 length );
+
+    // Returns mapping of the attached file that covers at least requiredSize bytes,
+    // or nullptr if mapping is disabled or failed. Compressed files and files
+    // modified recently are never mapped, mapping stops once the file changes.
+    std::shared_ptr<const FileMapping> getMapping( qint64 requiredSize );
 
   private:
     RecursiveMutex file_mutex_;
 
     QString file_name_;
-    std::unique_ptr<QFile> attached_file_;
+    std::unique_ptr<QIODevice> attached_file_;
     FileId attached_file_id_;
 
+    std::shared_ptr<const FileMapping> mapping_;
+    QDateTime mapping_modified_;
+    std::shared_ptr<const PositionalFileReader> reader_;
+
     uint32_t counter_ = 0;
     bool keep_closed_ = false;
+    bool use_mapping_ = false;
 };
 
 #endif // FILEHOLDER_H
@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_FROZENSEARCHRESULTS_H
+#define KLOGG_FROZENSEARCHRESULTS_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include <QByteArray>
+
+#include "logfiltereddataworker.h"
+
+// Search results that are not changed any more, like the ones in search results cache.
+// They are run optimized and kept in portable serialized form, which is smaller than
+// bitmap containers with their allocations, especially for dense ranges of matches.
+class FrozenSearchResults {
+  public:
+    FrozenSearchResults() = default;
+    explicit FrozenSearchResults( SearchResultArray lines );
+
+    SearchResultArray thaw() const;
+
+    uint64_t cardinality() const
+    {
+        return cardinality_;
+    }
+
+    size_t sizeInBytes() const
+    {
+        return static_cast<size_t>( data_.size() );
+    }
+
+  private:
+    QByteArray data_;
+    uint64_t cardinality_ = 0;
+};
+
+// Compacts results of a finished search
+void compactSearchResults( SearchResultArray& lines );
+
+#endif
@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_GZIPFILE_H
+#define KLOGG_GZIPFILE_H
+
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include <QByteArray>
+#include <QFile>
+#include <QIODevice>
+
+#include <zlib.h>
+
+#include "synchronization.h"
+
+// Read-only random access device for gzip compressed files.
+// Offsets are positions in decompressed data. While the file is read
+// checkpoints with the state of decompressor are recorded every few megabytes
+// of output, so seeking restarts decompression from the nearest checkpoint
+// instead of the beginning of the file. Checkpoints are shared between all
+// devices opened for the same version of the file, so the ones recorded
+// while the file is indexed are used by later reads of lines.
+// Members of block compressed (bgzip) files are independent and their sizes
+// are stored in headers, so batches of members are decompressed in parallel.
+class GzipFile : public QIODevice {
+    Q_OBJECT
+
+  public:
+    explicit GzipFile( const QString& fileName, QObject* parent = nullptr );
+    ~GzipFile() override;
+
+    // Returns true if file starts with gzip magic bytes
+    static bool isGzipFile( const QString& fileName );
+
+    bool open( OpenMode mode ) override;
+    void close() override;
+
+    bool isSequential() const override
+    {
+        return false;
+    }
+
+    // Size of decompressed data, until the whole file has been
+    // decompressed it is not less than the part known so far
+    qint64 size() const override;
+    bool atEnd() const override;
+
+    QString fileName() const
+    {
+        return fileName_;
+    }
+
+  protected:
+    qint64 readData( char* data, qint64 maxSize ) override;
+    qint64 writeData( const char* data, qint64 maxSize ) override;
+
+  private:
+    struct Checkpoint {
+        qint64 uncompressedOffset = 0;
+        qint64 compressedOffset = 0;
+        // Bits of the byte before compressedOffset that are not consumed yet,
+        // the window is empty for checkpoints at the start of a member
+        int bits = 0;
+        QByteArray window;
+    };
+
+    struct Index {
+        mutable SharedMutex mutex;
+        std::vector<Checkpoint> checkpoints;
+        std::optional<qint64> size;
+    };
+
+    static std::shared_ptr<Index> sharedIndex( const QString& fileName );
+
+    // Returns size of the member if header is a bgzip member header
+    static std::optional<qint64> blockCompressedMemberSize( const QByteArray& header );
+
+    std::optional<Checkpoint> findCheckpoint( qint64 offset ) const;
+
+    void resetStream();
+    void restoreCheckpoint( const Checkpoint& checkpoint );
+    bool seekStream( qint64 offset );
+
+    // Decompresses up to maxSize bytes to data, output is only kept
+    // in window if data is nullptr. Returns -1 on error, 0 at the end of data.
+    qint64 inflateInto( char* data, qint64 maxSize );
+    bool fillInput();
+    void startNextMember();
+    void addCheckpoint();
+    void finishStream();
+
+    qint64 readBlockCompressed( char* data, qint64 maxSize );
+    bool decodeNextBatch();
+
+  private:
+    QString fileName_;
+    QFile compressed_;
+    std::shared_ptr<Index> index_;
+
+    z_stream stream_{};
+    bool isStreamInitialized_ = false;
+    bool isRawStream_ = false;
+    bool isStreamFinished_ = false;
+
+    QByteArray input_;
+    QByteArray window_;
+    int windowPosition_ = 0;
+
+    qint64 compressedPosition_ = 0;
+    qint64 uncompressedPosition_ = 0;
+
+    bool isBlockCompressed_ = false;
+    QByteArray decodedBatch_;
+    qint64 batchOffset_ = 0;
+    qint64 nextMemberOffset_ = 0;
+};
+
+#endif
@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_INDEXCACHE_H
+#define KLOGG_INDEXCACHE_H
+
+#include <QDataStream>
+#include <QString>
+
+#include "logdataworker.h"
+
+// On-disk cache of file index.
+// Index is stored in cache directory with header and tail hashes of
+// the indexed part of the file. It is loaded back only if these hashes
+// still match, so the caller has to index just the data appended since then.
+class IndexCache {
+  public:
+    // Files smaller than this are indexed fast enough without cache
+    static constexpr qint64 MinCachedFileSize = 32 * 1024 * 1024;
+
+    explicit IndexCache( const QString& fileName );
+
+    // Returns true if accessor was populated from cache
+    bool load( IndexingData::MutateAccessor& scopedAccessor ) const;
+
+    void save( const IndexingData::ConstAccessor& scopedAccessor ) const;
+
+    // Returns true if header and tail of file still have the saved digests
+    static bool isIndexedPartUnchanged( const QString& fileName, const IndexedHash& hash );
+
+    // Hashes in the format of index cache, also used by analysis bundles
+    static void saveHash( QDataStream& stream, const IndexedHash& hash );
+    static IndexedHash loadHash( QDataStream& stream );
+
+  private:
+    QString fileName_;
+    QString cachePath_;
+};
+
+#endif
@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_INDEXESTIMATE_H
+#define KLOGG_INDEXESTIMATE_H
+
+#include <chrono>
+#include <cstddef>
+#include <optional>
+
+#include <QtGlobal>
+
+#include "linetypes.h"
+
+class QIODevice;
+
+// Expected number of lines of a file, memory used by its index and time to
+// build it, found before indexing from a few blocks spread across the file.
+// Memory is counted for line positions and indexes that keep a few bytes
+// per line, see LineLengthIndex and LineHashIndex.
+struct IndexEstimate {
+    // Where line positions are kept, see IndexingData
+    enum class Storage {
+        // Compressed positions in memory, see CompressedLinePositionStorage
+        Compressed,
+        // Every few positions, the rest is read from file, see SparseLinePositionStorage
+        Sparse,
+        // Compressed positions in a memory mapped temporary file, see BlockPool
+        FileBacked,
+    };
+
+    static constexpr int SampleBlocks = 8;
+    static constexpr qint64 SampleBlockSize = 1024 * 1024;
+
+    qint64 fileSize = 0;
+    LinesCount lines;
+    size_t compressedBytes = 0;
+    size_t sparseBytes = 0;
+    // Time to read the whole file at the speed the samples were read and scanned
+    std::chrono::milliseconds indexingTime{};
+    Storage storage = Storage::Compressed;
+
+    std::chrono::steady_clock::time_point startTime;
+
+    // Samples file that can seek cheaply, files smaller than all samples are read whole.
+    // Returns nothing if the file can't be read.
+    static std::optional<IndexEstimate> sample( QIODevice& file, size_t perLineIndexBytes );
+
+    // Storage that fits into the memory limit, compressed positions are
+    // preferred, then sparse ones, then the file backed ones. No limit is 0.
+    Storage chooseStorage( size_t memoryLimit ) const;
+
+    size_t memoryUsage() const
+    {
+        return storage == Storage::Sparse ? sparseBytes : compressedBytes;
+    }
+
+    // Time left to index the file, from the estimate until the indexing
+    // progress is known well enough, then from the time it took so far
+    std::chrono::milliseconds remainingTime( int progress ) const;
+};
+
+#endif // KLOGG_INDEXESTIMATE_H
@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_INGESTRATE_H
+#define KLOGG_INGESTRATE_H
+
+#include <cstdint>
+
+#include <QtGlobal>
+
+// Rate at which data is appended to a followed file, smoothed over
+// the last few seconds of appends. Views and searches are refreshed
+// less often while the file grows fast, as their updates could not be
+// shown anyway, and immediately for slowly growing files.
+class IngestRate {
+  public:
+    // Rates follow changes with this time constant
+    static constexpr qint64 TimeConstantMs = 2000;
+    // File is not growing if nothing was appended for this long
+    static constexpr qint64 IdleTimeMs = 5000;
+
+    // Refresh interval grows by 1 ms for each this number of lines/s,
+    // so files growing at 200k lines/s are refreshed 4 times a second
+    static constexpr double LinesPerSecondPerMs = 800.0;
+    static constexpr qint64 MinRefreshIntervalMs = 20;
+    static constexpr qint64 MaxRefreshIntervalMs = 1000;
+
+    // Starts measuring from the file indexed at the time
+    void reset( qint64 timeMs );
+
+    // Data appended to the file since the previous call was indexed at the time
+    void addAppend( qint64 timeMs, uint64_t bytes, uint64_t lines );
+
+    // Zero if the file is not growing at the time
+    double bytesPerSecond( qint64 timeMs ) const;
+    double linesPerSecond( qint64 timeMs ) const;
+
+    // Time to wait after the last refresh before refreshing again
+    qint64 refreshIntervalMs( qint64 timeMs ) const;
+
+  private:
+    bool isIdle( qint64 timeMs ) const;
+
+  private:
+    qint64 lastAppendMs_ = -1;
+    double bytesPerSecond_ = 0;
+    double linesPerSecond_ = 0;
+};
+
+#endif
@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_FORMATPLUGIN_ABI_H
+#define KLOGG_FORMATPLUGIN_ABI_H
+
+/*
+ * Stable C interface of plugins that let klogg open files in formats
+ * that are not text, like binary framed or compressed records.
+ *
+ * Plugin is a shared library exporting klogg_format_plugin_entry. It decodes
+ * batches of whole records to UTF-8 text with one line per record, so files
+ * are indexed, shown and searched as text by klogg itself. There are no
+ * callbacks for single lines, each call decodes as many records as fit.
+ *
+ * Records have to be decoded independently of each other: klogg restarts
+ * decoding at any input offset where a previous decode call stopped, so
+ * decoder must not keep state about records between calls.
+ *
+ * Functions may be called from several threads at once for different
+ * decoders, calls for one decoder are never concurrent.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define KLOGG_FORMAT_PLUGIN_ABI_VERSION 1
+
+typedef enum klogg_decode_status {
+    KLOGG_DECODE_OK = 0,
+    /* Output can't hold the first record, it is enlarged and the call is repeated */
+    KLOGG_DECODE_OUTPUT_TOO_SMALL = 1,
+    /* Data is corrupted, records consumed before the broken one are kept
+     * and the file ends after them */
+    KLOGG_DECODE_ERROR = 2
+} klogg_decode_status;
+
+typedef struct klogg_format_decoder klogg_format_decoder;
+
+typedef struct klogg_format_plugin {
+    /* KLOGG_FORMAT_PLUGIN_ABI_VERSION the plugin was built with */
+    uint32_t abi_version;
+
+    /* Name of the format shown to user */
+    const char* name;
+
+    /* Returns nonzero if the file is in the format of the plugin, name of
+     * the file is in UTF-8 and header holds its first bytes, up to 4 KiB */
+    int ( *probe )( const char* file_name, const unsigned char* header, size_t header_size );
+
+    /* Decoder holds buffers used while one file is read */
+    klogg_format_decoder* ( *create_decoder )( void );
+    void ( *destroy_decoder )( klogg_format_decoder* decoder );
+
+    /*
+     * Decodes whole records from input to output and sets the number of
+     * bytes consumed from input and written to output. Each record is
+     * written as UTF-8 text ending with a line feed.
+     * Record that is not complete at the end of input is left for the next
+     * call, which gets it again with more data. If is_last is nonzero input
+     * reaches the end of file and nothing consumed means there is nothing
+     * more to decode.
+     */
+    klogg_decode_status ( *decode )( klogg_format_decoder* decoder, const unsigned char* input,
+                                     size_t input_size, int is_last, char* output,
+                                     size_t output_capacity, size_t* consumed,
+                                     size_t* written );
+} klogg_format_plugin;
+
+/* Exported by the plugin library */
+typedef const klogg_format_plugin* ( *klogg_format_plugin_entry_function )( void );
+#define KLOGG_FORMAT_PLUGIN_ENTRY "klogg_format_plugin_entry"
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
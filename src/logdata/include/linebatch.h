@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef KLOGG_LINEBATCH_H
+#define KLOGG_LINEBATCH_H
+
+#include <cstddef>
+#include <vector>
+
+#include <QString>
+#include <QStringView>
+
+// Lines stored one after another in a single UTF-16 buffer and read as
+// views of it. Buffers are kept when the batch is filled again, so reading
+// lines in batches does not allocate a string for each line.
+// Views are valid until the batch is changed.
+class LineBatch {
+  public:
+    size_t size() const
+    {
+        return ends_.size();
+    }
+
+    bool empty() const
+    {
+        return ends_.empty();
+    }
+
+    QStringView line( size_t index ) const;
+
+    // Drops lines, keeps memory for the next ones
+    void clear();
+    void reserve( size_t codeUnits, size_t lines );
+
+    void append( QStringView line );
+
+    // Makes room for a line of at most maxLength code units and returns
+    // where to write it, finishLine has to be called with the written length
+    char16_t* beginLine( size_t maxLength );
+    void finishLine( size_t length );
+
+  private:
+    std::vector<char16_t> text_;
+    size_t textSize_ = 0;
+    std::vector<size_t> ends_;
+};
+
+#endif
@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_LINECACHE_H
+#define KLOGG_LINECACHE_H
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include <QString>
+
+#include "linetypes.h"
+#include "synchronization.h"
+
+// Decoded lines of a file kept by pages of consecutive lines.
+// Least recently used pages are dropped when the cache is full.
+// Pages read before the last clear are not inserted, so readers
+// can fill the cache from other threads without holding any lock
+// while reading the file.
+class LineCache {
+  public:
+    static constexpr LinesCount::UnderlyingType PageLines = 128;
+    static constexpr size_t MaxPages = 512;
+
+    using Page = std::shared_ptr<const std::vector<QString>>;
+
+    static uint64_t pageIndex( LineNumber line )
+    {
+        return line.get() / PageLines;
+    }
+
+    static LineNumber pageStart( uint64_t page )
+    {
+        return LineNumber( page * PageLines );
+    }
+
+    // Returns empty page if it is not cached
+    Page find( uint64_t page ) const;
+    bool contains( uint64_t page ) const;
+
+    // Generation has to be taken before reading the page
+    uint64_t generation() const;
+    void insert( uint64_t generation, uint64_t page, Page lines );
+
+    void clear();
+
+    // Approximate memory used by cached lines
+    size_t allocatedSize() const;
+
+  private:
+    mutable Mutex mutex_;
+    uint64_t generation_ = 0;
+    size_t allocatedSize_ = 0;
+
+    // Most recently used pages first
+    mutable std::list<uint64_t> usage_;
+    std::unordered_map<uint64_t, std::pair<Page, std::list<uint64_t>::iterator>> pages_;
+};
+
+#endif
@@ -0,0 +1,44 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_LINECHUNKS_H
+#define KLOGG_LINECHUNKS_H
+
+#include <vector>
+
+#include "linetypes.h"
+#include "logfiltereddataworker.h"
+
+// Consecutive lines read at once
+struct LinesRun {
+    LineNumber first;
+    LinesCount count;
+};
+
+// Lines processed by one task of a parallel loop
+using LinesChunk = std::vector<LinesRun>;
+
+// Splits count lines starting at first into chunks of chunkLines lines
+std::vector<LinesChunk> splitLines( LineNumber first, LinesCount count, LinesCount chunkLines );
+
+// Splits the set of lines into chunks of chunkLines lines,
+// consecutive lines of a chunk are joined into runs
+std::vector<LinesChunk> splitLines( const SearchResultArray& lines, LinesCount chunkLines );
+
+#endif
@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef KLOGG_LINEHASHDIFF_H
+#define KLOGG_LINEHASHDIFF_H
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include "atomicflag.h"
+#include "linetypes.h"
+#include "logfiltereddataworker.h"
+
+class LogData;
+
+// Lines of each of two files that are not in the other one. Lines are
+// compared by hashes stored in the index, see LineHashIndex, so files are
+// not read and not diffed as text. Hashes of each file are copied in chunks
+// of lines and sorted in parallel, then hashes of lines of each file are
+// looked up in sorted hashes of the other one. Order of lines is not
+// compared, a line moved to another place is in both files. Lines without
+// hash are in neither of the results.
+class LineHashDiff {
+  public:
+    struct Result {
+        SearchResultArray onlyInFirst;
+        SearchResultArray onlyInSecond;
+    };
+
+    LineHashDiff( const LogData* first, const LogData* second );
+
+    // Lines of both files, each of them is counted twice
+    // in processed lines: when its hash is copied and looked up
+    LinesCount linesCount() const;
+
+    // Empty results are returned if interruption is requested
+    Result compare( const AtomicFlag& interruptRequested,
+                    std::atomic<uint64_t>& processedLines ) const;
+
+    // Distinct hashes in ascending order without unknown ones
+    static std::vector<uint64_t> sortedHashes( std::vector<uint64_t> hashes );
+
+    // Lines with known hashes that are not in sorted hashes,
+    // hashes are of lines starting from the first one
+    static SearchResultArray linesNotIn( const std::vector<uint64_t>& hashes,
+                                         const std::vector<uint64_t>& sortedHashes,
+                                         const AtomicFlag& interruptRequested,
+                                         std::atomic<uint64_t>& processedLines );
+
+  private:
+    std::vector<uint64_t> lineHashes( const LogData* logData, const AtomicFlag& interruptRequested,
+                                      std::atomic<uint64_t>& processedLines ) const;
+
+  private:
+    const LogData* first_;
+    const LogData* second_;
+};
+
+#endif // KLOGG_LINEHASHDIFF_H
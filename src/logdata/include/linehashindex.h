@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef KLOGG_LINEHASHINDEX_H
+#define KLOGG_LINEHASHINDEX_H
+
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#include "linetypes.h"
+
+class QDataStream;
+
+// 64-bit hashes of lines of indexed file, so lines can be compared
+// without reading them. Lines are added as texts without the line feed,
+// default constructed views are lines with unknown text. Equal hashes
+// are equal lines unless there is a collision.
+class LineHashIndex {
+  public:
+    // Hash of lines with unknown text, hashes of lines are never zero
+    static constexpr uint64_t UnknownHash = 0;
+
+    // Disabled index, nothing is added to it
+    LineHashIndex() = default;
+    explicit LineHashIndex( bool isEnabled );
+
+    bool isEnabled() const
+    {
+        return isEnabled_;
+    }
+
+    // Number of lines added so far
+    LinesCount size() const;
+
+    // Adds lines following the lines added before
+    void append( const std::vector<std::string_view>& lines );
+
+    // Drops lines past count, they are added again
+    void truncate( LinesCount count );
+
+    // Empty if the line is not added or its text is not known
+    std::optional<uint64_t> hash( LineNumber line ) const;
+
+    // Appends hashes of count lines starting at first,
+    // UnknownHash for lines past the added ones
+    void hashes( LineNumber first, LinesCount count, std::vector<uint64_t>& hashes ) const;
+
+    size_t allocatedSize() const;
+
+    void save( QDataStream& stream ) const;
+    // Index saved when it was disabled is loaded empty
+    bool load( QDataStream& stream );
+
+  private:
+    bool isEnabled_ = false;
+
+    std::vector<uint64_t> hashes_;
+};
+
+#endif // KLOGG_LINEHASHINDEX_H
@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_LINELENGTHINDEX_H
+#define KLOGG_LINELENGTHINDEX_H
+
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "linetypes.h"
+
+// Lengths of lines of indexed file with tabs expanded, as they are displayed.
+// One byte is kept per line, longer lines are kept aside. Length is known
+// only for ASCII lines, other ones depend on the encoding and are decoded.
+// Lines are added as texts without the line feed, default constructed
+// views are lines with unknown text.
+class LineLengthIndex {
+  public:
+    // Disabled index, nothing is added to it
+    LineLengthIndex() = default;
+    explicit LineLengthIndex( bool isEnabled );
+
+    bool isEnabled() const
+    {
+        return isEnabled_;
+    }
+
+    // Number of lines added so far
+    LinesCount size() const;
+
+    // Adds lines following the lines added before
+    void append( const std::vector<std::string_view>& lines );
+
+    // Drops lines past count, they are added again
+    void truncate( LinesCount count );
+
+    // Empty if the line is not added or its length is not known
+    std::optional<LineLength> length( LineNumber line ) const;
+
+    size_t allocatedSize() const;
+
+  private:
+    static constexpr uint8_t UnknownLength = 0xff;
+    static constexpr uint8_t LongLength = 0xfe;
+
+  private:
+    bool isEnabled_ = false;
+
+    std::vector<uint8_t> lengths_;
+    std::unordered_map<LineNumber::UnderlyingType, LineLength::UnderlyingType> longLines_;
+};
+
+#endif // KLOGG_LINELENGTHINDEX_H
@@ -39,11 +39,16 @@
 #ifndef LINEPOSITIONARRAY_H
 #define LINEPOSITIONARRAY_H
 
+#include <algorithm>
 #include <cstddef>
+#include <iterator>
 #include <vector>
 
+#include <QDataStream>
+
 #include "compressedlinestorage.h"
 #include "log.h"
+#include "sparselinestorage.h"
 
 class SimpleLinePositionStorage {
   public:
@@ -81,6 +86,11 @@ class SimpleLinePositionStorage {
         return storage_.capacity();
     }
 
+    size_t residentSize() const
+    {
+        return allocatedSize();
+    }
+
     // Element at index
     LineOffset at( size_t i, Cache* = nullptr ) const
     {
@@ -92,6 +102,15 @@ class SimpleLinePositionStorage {
         return at( i.get() );
     }
 
+    // Append count elements starting at first to positions
+    void range( LineNumber first, LinesCount count, std::vector<qint64>& positions ) const
+    {
+        const auto begin = storage_.begin() + static_cast<std::ptrdiff_t>( first.get() );
+        std::transform( begin, begin + static_cast<std::ptrdiff_t>( count.get() ),
+                        std::back_inserter( positions ),
+                        []( const LineOffset& pos ) { return pos.get(); } );
+    }
+
     // Add one list to the other
     void append_list( const SimpleLinePositionStorage& positions )
     {
@@ -124,6 +143,11 @@ class LinePosition {
     friend class LinePosition;
 
     LinePosition() = default;
+    explicit LinePosition( Storage&& storage )
+        : array( std::move( storage ) )
+    {
+    }
+
     LinePosition( const LinePosition& ) = delete;
     LinePosition& operator=( const LinePosition& ) = delete;
 
@@ -161,6 +185,11 @@ class LinePosition {
         return array.allocatedSize();
     }
 
+    size_t residentSize() const
+    {
+        return array.residentSize();
+    }
+
     // Extract an element
     inline LineOffset at( LineNumber::UnderlyingType i,
                           typename Storage::Cache* lastPosition = nullptr ) const
@@ -170,6 +199,13 @@ class LinePosition {
         return pos;
     }
 
+    // Extract count elements starting at first,
+    // appending them to positions
+    inline void range( LineNumber first, LinesCount count, std::vector<qint64>& positions ) const
+    {
+        array.range( first, count, positions );
+    }
+
     // Set the presence of a fake final LF
     // Must be used after 'append'-ing a fake LF at the end.
     void setFakeFinalLF( bool finalLF = true )
@@ -177,6 +213,38 @@ class LinePosition {
         fakeFinalLF_ = finalLF;
     }
 
+    // Drop lines that end past size bytes of the file. Line continued
+    // past size gets a fake final LF, as if the file ended there.
+    void truncate( LineOffset::UnderlyingType size )
+    {
+        const auto endOf = [ this ]( LineNumber::UnderlyingType line ) {
+            return static_cast<LineOffset::UnderlyingType>( array.at( line ).get() );
+        };
+
+        // Number of lines ending at or before size
+        LineNumber::UnderlyingType keptLines = 0;
+        auto lastLine = array.size().get();
+        while ( keptLines < lastLine ) {
+            const auto middle = keptLines + ( lastLine - keptLines ) / 2;
+            if ( endOf( middle ) <= size ) {
+                keptLines = middle + 1;
+            }
+            else {
+                lastLine = middle;
+            }
+        }
+
+        while ( array.size().get() > keptLines ) {
+            array.pop_back();
+        }
+
+        const auto keptSize = keptLines > 0 ? endOf( keptLines - 1 ) : 0;
+        fakeFinalLF_ = keptSize < size;
+        if ( fakeFinalLF_ ) {
+            array.push_back( LineOffset( size + 1 ) );
+        }
+    }
+
     // Add another list to this one, removing any fake LF on this list.
     // Invariant: all pos in other must be greater than any pos in this
     // (this is NOT checked!)
@@ -194,6 +262,35 @@ class LinePosition {
         this->fakeFinalLF_ = other.fakeFinalLF_;
     }
 
+    void save( QDataStream& stream ) const
+    {
+        stream << fakeFinalLF_;
+        array.save( stream );
+    }
+
+    bool load( QDataStream& stream )
+    {
+        bool fakeFinalLF = false;
+        stream >> fakeFinalLF;
+
+        if ( stream.status() != QDataStream::Ok || !array.load( stream ) ) {
+            return false;
+        }
+
+        fakeFinalLF_ = fakeFinalLF;
+        return true;
+    }
+
+    Storage& storage()
+    {
+        return array;
+    }
+
+    const Storage& storage() const
+    {
+        return array;
+    }
+
   private:
     Storage array;
     bool fakeFinalLF_ = false;
@@ -202,5 +299,7 @@ class LinePosition {
 // Use the non-optimised storage
 using FastLinePositionArray = LinePosition<SimpleLinePositionStorage>;
 using LinePositionArray = LinePosition<CompressedLinePositionStorage>;
+// Keeps only checkpoints in memory, for files that are too big to index fully
+using SparseLinePositionArray = LinePosition<SparseLinePositionStorage>;
 
 #endif
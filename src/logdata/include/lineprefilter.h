@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_LINEPREFILTER_H
+#define KLOGG_LINEPREFILTER_H
+
+#include <cstddef>
+
+#include <QRegularExpression>
+#include <QString>
+
+// Removes parts of lines matching a pattern before lines are shown or searched.
+// Pattern is compiled once. ANSI color sequences are removed from UTF-8
+// bytes without decoding lines and running regular expression on them.
+class LinePrefilter {
+  public:
+    static constexpr char AnsiColorSequences[]
+        = "\\x1B\\[([0-9]{1,3}(;[0-9]{1,3})*)?[mK]";
+
+    LinePrefilter() = default;
+    explicit LinePrefilter( const QString& pattern );
+
+    bool isActive() const
+    {
+        return isActive_;
+    }
+
+    bool canStripBytes() const
+    {
+        return isAnsiColorSequences_;
+    }
+
+    // Copies UTF-8 data to output without removed parts and returns
+    // the number of bytes written, output may be the same as data
+    size_t stripBytes( const char* data, size_t size, char* output ) const;
+
+    void strip( QString& text ) const;
+
+  private:
+    bool isActive_ = false;
+    bool isAnsiColorSequences_ = false;
+    QRegularExpression regex_;
+};
+
+#endif
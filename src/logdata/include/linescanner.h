@@ -0,0 +1,167 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_LINESCANNER_H
+#define KLOGG_LINESCANNER_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#if defined( _MSC_VER ) && !defined( __clang__ )
+#include <intrin.h>
+#endif
+
+#include "encodingdetector.h"
+
+namespace line_scanner {
+
+constexpr std::size_t StrideSize = 64;
+
+// Bit i is set if byte i of the stride is a line feed (or a tab)
+struct DelimeterMasks {
+    uint64_t lineFeeds;
+    uint64_t tabs;
+};
+
+// Scans up to StrideSize bytes, bits after size are always zero
+using ScanStride = DelimeterMasks ( * )( const char* data, std::size_t size );
+
+// Returns the fastest implementation supported by current cpu
+ScanStride strideScanner();
+
+inline int countTrailingZeros( uint64_t mask )
+{
+#if defined( _MSC_VER ) && !defined( __clang__ )
+    unsigned long index = 0;
+    _BitScanForward64( &index, mask );
+    return static_cast<int>( index );
+#else
+    return __builtin_ctzll( mask );
+#endif
+}
+
+// In wide encodings '\n' and '\t' bytes can be a part of
+// some other character, so the rest of the code unit must be zero
+inline bool isWideDelimeter( const EncodingParameters& encodingParams, std::string_view data,
+                             std::string_view::size_type checkPos )
+{
+    const auto lineFeedWidth
+        = static_cast<std::string_view::size_type>( encodingParams.lineFeedWidth );
+
+    const auto isCheckForward = encodingParams.lineFeedIndex == 0;
+
+    if ( isCheckForward && checkPos + lineFeedWidth > data.size() ) {
+        return false;
+    }
+    else if ( !isCheckForward && checkPos < lineFeedWidth - 1 ) {
+        return false;
+    }
+
+    for ( auto i = 1u; i < lineFeedWidth; ++i ) {
+        const auto nextByte = isCheckForward ? data[ checkPos + i ] : data[ checkPos - i ];
+        if ( nextByte != '\0' ) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Calls handler( charOffsetWithinData, isLineFeed ) for each line feed and tab
+// starting from startPos until handler returns false.
+// Both delimeters are found in a single pass over the data.
+template <typename Handler>
+void forEachDelimeter( std::string_view data, int startPos, const EncodingParameters& encodingParams,
+                       Handler&& handler )
+{
+    const auto scanStride = strideScanner();
+    const auto isWideEncoding = encodingParams.lineFeedWidth > 1;
+
+    for ( auto strideStart = static_cast<size_t>( startPos ); strideStart < data.size();
+          strideStart += StrideSize ) {
+        const auto masks = scanStride( data.data() + strideStart,
+                                       std::min( StrideSize, data.size() - strideStart ) );
+
+        auto delimeters = masks.lineFeeds | masks.tabs;
+        while ( delimeters != 0 ) {
+            const auto bit = countTrailingZeros( delimeters );
+            delimeters &= delimeters - 1;
+
+            const auto delimeterPos = strideStart + static_cast<size_t>( bit );
+            if ( isWideEncoding && !isWideDelimeter( encodingParams, data, delimeterPos ) ) {
+                continue;
+            }
+
+            const auto isLineFeed = ( ( masks.lineFeeds >> bit ) & 1u ) != 0;
+            if ( !handler( static_cast<int>( delimeterPos ) - encodingParams.getBeforeCrOffset(),
+                           isLineFeed ) ) {
+                return;
+            }
+        }
+    }
+}
+
+// Calls handler( charOffsetWithinData ) for each line feed
+// starting from startPos until handler returns false.
+// Returns true if a tab byte was found in the scanned strides,
+// in wide encodings it may also be a part of some other character.
+template <typename Handler>
+bool forEachLineFeed( std::string_view data, int startPos, const EncodingParameters& encodingParams,
+                      Handler&& handler )
+{
+    const auto scanStride = strideScanner();
+    const auto isWideEncoding = encodingParams.lineFeedWidth > 1;
+
+    uint64_t tabs = 0;
+    for ( auto strideStart = static_cast<size_t>( startPos ); strideStart < data.size();
+          strideStart += StrideSize ) {
+        const auto masks = scanStride( data.data() + strideStart,
+                                       std::min( StrideSize, data.size() - strideStart ) );
+        tabs |= masks.tabs;
+
+        auto lineFeeds = masks.lineFeeds;
+        while ( lineFeeds != 0 ) {
+            const auto bit = countTrailingZeros( lineFeeds );
+            lineFeeds &= lineFeeds - 1;
+
+            const auto lineFeedPos = strideStart + static_cast<size_t>( bit );
+            if ( isWideEncoding && !isWideDelimeter( encodingParams, data, lineFeedPos ) ) {
+                continue;
+            }
+
+            const auto lineFeedOffset
+                = static_cast<int>( lineFeedPos ) - encodingParams.getBeforeCrOffset();
+            if ( !handler( lineFeedOffset ) ) {
+                return tabs != 0;
+            }
+        }
+    }
+
+    return tabs != 0;
+}
+
+// Number of control bytes of data other than whitespace and escape,
+// text of single byte and UTF-8 encodings almost never has them
+std::size_t countBinaryBytes( std::string_view data );
+
+} // namespace line_scanner
+
+#endif
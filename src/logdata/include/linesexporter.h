@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_LINESEXPORTER_H
+#define KLOGG_LINESEXPORTER_H
+
+#include <atomic>
+#include <cstdint>
+#include <optional>
+
+#include "atomicflag.h"
+#include "linetypes.h"
+#include "logfiltereddataworker.h"
+
+class LogData;
+class QIODevice;
+
+// Writes lines of a file to a device as they are stored in the file, without
+// decoding them. Lines are read in chunks, so memory used does not depend on
+// the number of lines written and the device can be written on a worker thread.
+class LinesExporter {
+  public:
+    // Exports count lines of the file starting at first
+    LinesExporter( const LogData* logData, LineNumber first, LinesCount count );
+
+    // Exports count lines of the file from the passed set starting with the one at
+    // index first, set is a copy, so it can be changed while lines are written
+    LinesExporter( const LogData* logData, SearchResultArray lines, LineNumber first,
+                   LinesCount count );
+
+    LinesCount linesCount() const
+    {
+        return count_;
+    }
+
+    // Returns false if reading the file or writing the device failed,
+    // number of lines written so far is stored in writtenLines
+    bool write( QIODevice& device, const AtomicFlag& interruptRequested,
+                std::atomic<uint64_t>& writtenLines ) const;
+
+  private:
+    bool writeRange( QIODevice& device, LineNumber first, LinesCount count,
+                     const AtomicFlag& interruptRequested,
+                     std::atomic<uint64_t>& writtenLines ) const;
+
+    const LogData* logData_;
+    std::optional<SearchResultArray> lines_;
+    LineNumber first_;
+    LinesCount count_;
+};
+
+#endif
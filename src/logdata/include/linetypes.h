@@ -158,25 +158,6 @@ Q_DECLARE_METATYPE( LinesCount )
 // Length of a tab stop
 constexpr int TabStop = 8;
 
-inline QString untabify( QString&& line, int initialPosition = 0 )
-{
-    LineLength::UnderlyingType totalSpaces = 0;
-    line.replace( QChar::Null, QChar::Space );
-
-    LineLength::UnderlyingType position = 0;
-    position
-        = static_cast<LineLength::UnderlyingType>( line.indexOf( QChar::Tabulation, position ) );
-    while ( position >= 0 ) {
-        const auto spaces = TabStop - ( ( initialPosition + position + totalSpaces ) % TabStop );
-        line.replace( position, 1, QString( spaces, QChar::Space ) );
-        totalSpaces += spaces - 1;
-        position = static_cast<LineLength::UnderlyingType>(
-            line.indexOf( QChar::Tabulation, position ) );
-    }
-
-    return std::move( line );
-}
-
 template <typename LineType>
 LineLength getUntabifiedLength( const LineType& utf8Line )
 {
@@ -39,23 +39,38 @@
 #ifndef LOGDATA_H
 #define LOGDATA_H
 
+#include <atomic>
 #include <memory>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
+#include <QBasicTimer>
 #include <QDateTime>
 #include <QFile>
 #include <QObject>
 #include <QString>
 #include <QTextCodec>
+#include <QThreadPool>
 #include <qregularexpression.h>
 #include <qtextcodec.h>
 #include <string_view>
 
 #include "abstractlogdata.h"
+#include "analysisbundle.h"
 #include "fileholder.h"
 #include "filewatcher.h"
+#include "ingestrate.h"
+#include "linecache.h"
+#include "lineprefilter.h"
 #include "loadingstatus.h"
 #include "logdataoperation.h"
 #include "logdataworker.h"
+#include "memorygovernor.h"
+#include "operationstats.h"
+#include "synchronization.h"
+#include "tabexpansionindex.h"
 
 class LogFilteredData;
 
@@ -63,9 +78,25 @@ class LogFilteredData;
 class CantReattachErr {
 };
 
+// Consecutive time intervals of equal duration and their lines
+struct TimeBuckets {
+    // Start of the first interval and duration of each, in milliseconds
+    qint64 begin = 0;
+    qint64 duration = 0;
+    // First line of each interval followed by the end of the last one
+    std::vector<LineNumber> boundaries;
+};
+
+// Lines read directly from a file without its index
+struct LinesPreview {
+    // Offset of the first line in the file
+    qint64 offset = 0;
+    std::vector<QString> lines;
+};
+
 // Represents a complete set of data to be displayed (ie. a log file content)
 // This class is thread-safe.
-class LogData : public AbstractLogData {
+class LogData : public AbstractLogData, public MemoryConsumer {
     Q_OBJECT
 
   public:
@@ -92,9 +123,76 @@ class LogData : public AbstractLogData {
     std::unique_ptr<LogFilteredData> getNewFilteredData() const;
     // Returns the size if the file in bytes
     qint64 getFileSize() const;
+    // Returns true while the file is being indexed,
+    // lines indexed so far can already be read.
+    bool isIndexing() const;
+    // Returns true once the first loading of the attached file is finished
+    bool isLoaded() const;
+    // Returns number of lines of the whole file estimated from lines
+    // indexed so far, the number of lines if indexing is done
+    LinesCount getEstimatedNbLines() const;
+    // Returns size of the index and time to build it estimated before
+    // indexing, nothing if the file was not sampled
+    std::optional<IndexEstimate> getIndexEstimate() const;
+    // Reads up to count lines starting after the first line feed
+    // past offset, lines do not have to be indexed yet. Used to show
+    // parts of the file indexing has not reached.
+    LinesPreview getLinesAtOffset( qint64 offset, LinesCount count ) const;
+    // Returns the line starting at offset, empty if it is not indexed yet
+    OptionalLineNumber getIndexedLineAtOffset( qint64 offset ) const;
+    // Returns the name of the attached file
+    QString getFileName() const;
+    // Returns hashes of indexed part of the file
+    IndexedHash getIndexedHash() const;
+    // Puts index of the file into the bundle, returns false
+    // if the file is being indexed
+    bool addIndexToBundle( AnalysisBundle& bundle ) const;
+    // Returns false if count lines starting at first can not
+    // contain text with the passed trigrams, see TrigramFilter.
+    bool mayContainTrigrams( LineNumber first, LinesCount count,
+                             const TrigramFilter::Hashes& hashes ) const;
+    // Returns lines [first, last) with timestamps between begin and end,
+    // empty if file was not indexed with timestamps, see TimestampIndex.
+    std::optional<std::pair<LineNumber, LineNumber>>
+    getLinesInTimeRange( const QDateTime& begin, const QDateTime& end ) const;
+    // Returns format of timestamps the file was indexed with, see TimestampIndex.
+    QString getTimestampFormat() const;
+    // Splits time of indexed lines into count intervals, empty if
+    // file was not indexed with timestamps. Lines before the first
+    // timestamp are in the first interval and lines past the last
+    // sampled one are in the last interval.
+    std::optional<TimeBuckets> getTimeBuckets( int count ) const;
+    // Returns fields of structured lines the file was indexed with, see FieldIndex.
+    QStringList getIndexedFields() const;
+    // Returns lines in [first, last) where indexed fields have the values of
+    // conditions, empty if some lines are not in field index, see FieldIndex.
+    std::optional<roaring::Roaring64Map>
+    findLinesWithFields( const std::vector<FieldCondition>& conditions, LineNumber first,
+                         LineNumber last ) const;
+    // Returns lines in [first, last) that may contain the text as a whole token,
+    // empty if text is not a token or some lines are not indexed, see TokenIndex.
+    std::optional<roaring::Roaring64Map> findLinesWithToken( const QString& text, LineNumber first,
+                                                             LineNumber last ) const;
+    // Returns true if lines of the file are hashed while indexing, see LineHashIndex.
+    bool hasLineHashes() const;
+    // Returns lines of the set equal to the line before them in the set, found
+    // by their hashes without reading them. Lines without hash are not repeated.
+    roaring::Roaring64Map findRepeatedLines( const roaring::Roaring64Map& lines ) const;
+    // Appends hashes of count lines starting at first, lines
+    // without hash are LineHashIndex::UnknownHash.
+    void getLineHashes( LineNumber first, LinesCount count, std::vector<uint64_t>& hashes ) const;
+    // Returns true if starts of multi-line records are indexed, see RecordIndex.
+    bool hasRecordIndex() const;
+    // Returns all lines of records that have any of the lines,
+    // found in the index without matching lines again.
+    roaring::Roaring64Map expandToRecords( const roaring::Roaring64Map& lines ) const;
     // Returns the last modification date for the file.
     // Null if the file is not on disk.
     QDateTime getLastModifiedDate() const;
+    // Returns time spent in phases of the last indexing
+    OperationStats getIndexingStats() const;
+    // Returns the rate of data appended to the file since it was indexed
+    IngestRate getIngestRate() const;
     // Throw away all the file data and reload/reindex.
     void reload( QTextCodec* forcedEncoding = nullptr );
 
@@ -103,25 +201,91 @@ class LogData : public AbstractLogData {
 
     void setPrefilter(const QString& prefilterPattern);
 
+    // Memory of index and line cache, see MemoryGovernor
+    QString memoryConsumerFile() const override;
+    size_t memoryUsage() const override;
+    std::vector<MemoryUsagePart> memoryUsageParts() const override;
+    void releaseMemory( Release release ) override;
+
+    // Lines longer than this are not read whole for search, the rest
+    // of them is matched in windows read by getLinePart
+    static constexpr qint64 GiantLineBytes = 16 * 1024 * 1024;
+    // Bytes of a line read for views until more of it is loaded,
+    // see loadMoreOfLine
+    static constexpr qint64 DisplayedLineBytes = 4 * 1024 * 1024;
+
+    enum class LineLimit {
+        // Lines are read whole
+        None,
+        // Lines are cut to GiantLineBytes
+        Search,
+        // Lines are cut to bytes loaded for views
+        Display,
+    };
+
     struct RawLines {
         LineNumber startLine;
 
         std::vector<char> buffer;
         std::vector<qint64> endOfLines;
 
+        // Lines read only up to the limit, the rest of them is not in buffer
+        struct CutLine {
+            size_t index = 0;
+            qint64 lineBytes = 0;
+            qint64 readBytes = 0;
+        };
+        std::vector<CutLine> cutLines;
+
+        // Indexes of lines with binary data, see BinaryRegionIndex. They are only
+        // found when lines are read with a limit, matchers see them as empty
+        // lines and they are decoded as a placeholder.
+        std::vector<size_t> binaryLines;
+
+        // When file is memory mapped lines point directly into the mapping,
+        // guard keeps mapping alive for the lifetime of RawLines
+        std::shared_ptr<const FileMapping> mappingGuard;
+        std::string_view mappedData;
+
         TextDecoder textDecoder;
 
-        QRegularExpression prefilterPattern;
+        LinePrefilter prefilter;
 
       public:
+        std::string_view data() const
+        {
+            return mappingGuard ? mappedData : std::string_view( buffer.data(), buffer.size() );
+        }
+
         std::vector<QString> decodeLines() const;
+        // Decodes lines into batch replacing its lines,
+        // carriage returns at ends of lines are dropped
+        void decodeLines( LineBatch& batch ) const;
         std::vector<std::string_view> buildUtf8View() const;
 
+        // Reuses memory of lines from previous call
+        void buildUtf8View( std::vector<std::string_view>& lines ) const;
+
       private:
         mutable QByteArray utf8Data_;
     };
 
-    RawLines getLinesRaw( LineNumber first, LinesCount number ) const;
+    // Starts reading pages of line cache with the passed lines
+    // in background, pages already in cache are skipped
+    void prefetchLinesAt( std::vector<LineNumber> lines ) const;
+    // Returns true if pages of line cache with the passed lines are all cached
+    bool areLinesCachedAt( const std::vector<LineNumber>& lines ) const;
+
+    RawLines getLinesRaw( LineNumber first, LinesCount number,
+                          LineLimit limit = LineLimit::None ) const;
+
+    // Reads lines into rawLines reusing its buffers
+    void getLinesRaw( LineNumber first, LinesCount number, RawLines& rawLines,
+                      LineLimit limit = LineLimit::None ) const;
+
+    // Reads at most size bytes of the line starting at offset from its
+    // beginning into rawLines, as if they were the whole line
+    void getLinePart( LineNumber line, qint64 offset, qint64 size, RawLines& rawLines ) const;
 
   Q_SIGNALS:
     // Sent during the 'attach' process to signal progress
@@ -137,19 +301,31 @@ class LogData : public AbstractLogData {
     // Consider reloading the file when it changes on disk updated
     void fileChangedOnDisk( const QString& filename );
     // Called when the worker thread signals the current operation ended
-    void indexingFinished( LoadingStatus status );
+    void indexingFinished( LoadingStatus status, const OperationStats& stats );
     // Called when the worker thread signals the current operation ended
     void checkFileChangesFinished( MonitoredFileStatus status );
 
+  protected:
+    // Checks changes of the file postponed while it grows fast
+    void timerEvent( QTimerEvent* event ) override;
+
   private:
     // Implementation of virtual functions
     QString doGetLineString( LineNumber line ) const override;
     QString doGetExpandedLineString( LineNumber line ) const override;
     std::vector<QString> doGetLines( LineNumber first, LinesCount number ) const override;
     std::vector<QString> doGetExpandedLines( LineNumber first, LinesCount number ) const override;
+    std::vector<QString> doGetExpandedLinesWindow( LineNumber first, LinesCount number,
+                                                   int firstColumn,
+                                                   int nbColumns ) const override;
+    void doGetLinesBatch( LineNumber first, LinesCount number, LineBatch& batch ) const override;
+    std::vector<AnsiColorSpan> doGetLineColors( LineNumber line ) const override;
+    bool doLoadMoreOfLine( LineNumber line ) const override;
     LinesCount doGetNbLine() const override;
     LineLength doGetMaxLength() const override;
     LineLength doGetLineLength( LineNumber line ) const override;
+    void doPrefetchLines( LineNumber first, LinesCount number ) const override;
+    bool doAreLinesCached( LineNumber first, LinesCount number ) const override;
     void doSetDisplayEncoding( const char* encoding ) override;
     QTextCodec* doGetDisplayEncoding() const override;
     void doAttachReader() const override;
@@ -160,6 +336,37 @@ class LogData : public AbstractLogData {
     std::vector<QString> getLinesFromFile( LineNumber first, LinesCount number,
                                            QString ( *processLine )( QString&& ) ) const;
 
+    // Reads and decodes the page, then puts it into line cache
+    LineCache::Page readPage( uint64_t page ) const;
+
+    // Returns tab expansion of a long line, kept until line cache is cleared.
+    // Generation of line cache has to be taken before reading the line.
+    std::shared_ptr<const TabExpansionIndex>
+    tabExpansionIndex( uint64_t generation, LineNumber line, const QString& lineData ) const;
+
+    // Returns the first line in [first, last) with timestamp not less than
+    // the passed one, last if there is no such line
+    LineNumber findLineAtTime( const TimestampParser& parser, qint64 timestamp, LineNumber first,
+                               LineNumber last ) const;
+
+    // Widens max length to the length of a displayed line with expanded tabs
+    void updateExpandedMaxLength( int expandedLength ) const;
+
+    qint64 maxLineBytes( LineLimit limit, LineNumber line ) const;
+
+    // Decodes blocks of sparse index covering the lines before locking
+    // the index for reading them, so the indexer is not blocked on IO
+    void decodeSparseIndexBlocks( LineNumber firstLine, LinesCount number ) const;
+
+    // Reads lines of rawLines.endOfLines from block cache, mapping or file
+    void readLines( qint64 firstByte, qint64 lastByte,
+                    const std::vector<IndexedHash::BlockDigest>& cachedBlocks,
+                    ScopedFileHolder<FileHolder>& fileHolder, RawLines& rawLines ) const;
+
+    // Reads lines of rawLines.endOfLines without the cut parts of rawLines.cutLines
+    void readCutLines( qint64 firstByte, qint64 lastByte,
+                       ScopedFileHolder<FileHolder>& fileHolder, RawLines& rawLines ) const;
+
   private:
     mutable std::unique_ptr<FileHolder> attached_file_;
 
@@ -169,18 +376,54 @@ class LogData : public AbstractLogData {
     OperationQueue operationQueue_;
 
     QString indexingFileName_;
+    // Name the indexed file was renamed to, if it was rotated
+    QString rotatedFileName_;
     // mutable std::unique_ptr<QFile> attached_file_;
     // mutable FileId attached_file_id_;
 
     bool keepFileClosed_;
+    bool useMemoryMappedFiles_;
 
     QDateTime lastModifiedDate_;
+    OperationStats indexingStats_;
+
+    // Changes of fast growing file are checked once per refresh interval,
+    // so indexing, views and searches are not updated more often
+    IngestRate ingestRate_;
+    QBasicTimer refreshTimer_;
+    qint64 lastRefreshMs_ = 0;
+    qint64 ingestedSize_ = 0;
+    LinesCount ingestedLines_;
+    std::atomic<bool> isLoaded_{ false };
 
     // Codec to decode text
     TextCodecHolder codec_;
     MonitoredFileStatus fileChangedOnDisk_;
 
-    QString prefilterPattern_;
+    LinePrefilter prefilter_;
+
+    // Decoded lines read for views, cleared when file or encoding changes
+    mutable LineCache lineCache_;
+
+    // Tab expansion of long lines shown in views and line cache generation
+    // it was built for
+    static constexpr size_t MaxTabExpansionIndexes = 64;
+    mutable Mutex tabExpansionMutex_;
+    mutable std::unordered_map<LineNumber::UnderlyingType,
+                               std::pair<uint64_t, std::shared_ptr<const TabExpansionIndex>>>
+        tabExpansionIndexes_;
+
+    // Indexer counts tabs as one character, widths of lines with tabs
+    // are only known after they are expanded for views
+    mutable std::atomic<LineLength::UnderlyingType> expandedMaxLength_{};
+
+    // Bytes of long lines loaded for views past DisplayedLineBytes,
+    // cleared when the file changes
+    mutable Mutex loadedLinesMutex_;
+    mutable std::unordered_map<LineNumber::UnderlyingType, qint64> loadedLineBytes_;
+
+    // Has to be destroyed first, as prefetch tasks use the data above
+    mutable QThreadPool prefetchPool_;
 };
 
 #endif
@@ -39,8 +39,11 @@
 #ifndef LOGDATAOPERATION_H
 #define LOGDATAOPERATION_H
 
+#include <chrono>
 #include <variant>
 
+#include <QTimer>
+
 #include "logdataworker.h"
 
 #include "synchronization.h"
@@ -88,8 +91,15 @@ class AttachOperation : public LogDataOperation {
 // Reindexing the current file
 class FullReindexOperation : public LogDataOperation {
   public:
-    explicit FullReindexOperation( QTextCodec* forcedEncoding = nullptr )
+    // If the indexed file was renamed by log rotation,
+    // its index is saved to the cache under the new name.
+    // File changed on disk can keep index of its unchanged beginning.
+    explicit FullReindexOperation( QTextCodec* forcedEncoding = nullptr,
+                                   const QString& rotatedFileName = {},
+                                   bool keepUnchangedPrefix = false )
         : forcedEncoding_( forcedEncoding )
+        , rotatedFileName_( rotatedFileName )
+        , keepUnchangedPrefix_( keepUnchangedPrefix )
     {
     }
 
@@ -98,6 +108,8 @@ class FullReindexOperation : public LogDataOperation {
 
   private:
     QTextCodec* forcedEncoding_;
+    QString rotatedFileName_;
+    bool keepUnchangedPrefix_;
 };
 
 // Indexing part of the current file (from fileSize)
@@ -112,6 +124,10 @@ class CheckDataChangesOperation : public LogDataOperation {
     void doStart( LogDataWorker& workerThread ) const override;
 };
 
+// Runs one operation at a time and keeps one pending operation. Checks and
+// partial reindexes enqueued while one of them is pending are merged into it.
+// When the file keeps growing while it is indexed, partial reindexes
+// are started after a delay growing with the rate of appends.
 class OperationQueue {
   public:
     explicit OperationQueue( std::function<void()> beforeOperationStart );
@@ -135,15 +151,20 @@ class OperationQueue {
 
     void enqueueOperation( OperationVariant&& operation );
     void tryStartPendingOperation();
+    void updateFollowDelay( bool isFileGrowing );
 
     std::function<void()> beforeOperationStart_;
 
   private:
     mutable Mutex mutex_;
-    
+
     OperationVariant executingOperation_;
     OperationVariant pendingOperation_;
 
+    // Pending check or partial reindex waits for this timer
+    QTimer followTimer_;
+    std::chrono::milliseconds followDelay_{ 0 };
+
     std::unique_ptr<LogDataWorker> worker_;
 };
 
@@ -39,8 +39,13 @@
 #ifndef LOGDATAWORKERTHREAD_H
 #define LOGDATAWORKERTHREAD_H
 
+#include <atomic>
+#include <optional>
 #include <qthreadpool.h>
+#include <string>
+#include <string_view>
 #include <variant>
+#include <vector>
 
 #include <QObject>
 #include <QFile>
@@ -54,22 +59,70 @@
 
 #include "atomicflag.h"
 #include "filedigest.h"
+#include "operationstats.h"
+#include "pipelinetrace.h"
 #include "synchronization.h"
 
+#include "binaryregionindex.h"
 #include "encodingdetector.h"
+#include "fieldindex.h"
+#include "fileholder.h"
+#include "indexestimate.h"
+#include "linehashindex.h"
+#include "linelengthindex.h"
 #include "linepositionarray.h"
 #include "loadingstatus.h"
+#include "recordindex.h"
+#include "timestampindex.h"
+#include "tokenindex.h"
+#include "trigramindex.h"
+
+// Memory used by each part of the index, line positions
+// read from disk by sparse or file backed index are not counted
+struct IndexMemoryUsage {
+    size_t linePositions = 0;
+    size_t trigramIndex = 0;
+    size_t timestampIndex = 0;
+    size_t fieldIndex = 0;
+    size_t tokenIndex = 0;
+    size_t lineLengths = 0;
+    size_t lineHashes = 0;
+    size_t recordStarts = 0;
+    size_t binaryRegions = 0;
+};
 
 struct IndexedHash {
     qint64 size = 0;
+    // Digest of block digests, see FileDigest::blockDigest
     quint64 fullDigest = 0;
 
+    // Digests of indexed blocks in file order, blocks are hashed in
+    // parallel while indexing and checked one by one for modifications
+    struct BlockDigest {
+        qint64 offset = 0;
+        qint64 size = 0;
+        quint64 digest = 0;
+    };
+    std::vector<BlockDigest> blockDigests;
+
     qint64 headerSize = 0;
     quint64 headerDigest = 0;
 
     qint64 tailSize = 0;
     qint64 tailOffset = 0;
     quint64 tailDigest = 0;
+
+    // Digests of the beginning of indexed blocks taken at regular offsets,
+    // used to check that indexed data is unchanged without reading all of it
+    struct SampleDigest {
+        qint64 offset = 0;
+        qint64 size = 0;
+        quint64 digest = 0;
+    };
+    std::vector<SampleDigest> sampleDigests;
+
+    // Modification time of the file before it was indexed, msecs since epoch
+    qint64 lastModified = 0;
 };
 
 template <typename Data, typename LockGuard>
@@ -93,6 +146,11 @@ class IndexingDataAccessor {
         return data_->getHash();
     }
 
+    std::vector<IndexedHash::BlockDigest> getBlockDigests( qint64 begin, qint64 end ) const
+    {
+        return data_->getBlockDigests( begin, end );
+    }
+
     // Get the length of the longest line
     LineLength getMaxLength() const
     {
@@ -112,6 +170,117 @@ class IndexingDataAccessor {
         return data_->getEndOfLineOffset( line );
     }
 
+    // Append end of line positions of count lines starting at first.
+    void getEndOfLineOffsets( LineNumber first, LinesCount count,
+                              std::vector<qint64>& offsets ) const
+    {
+        data_->getEndOfLineOffsets( first, count, offsets );
+    }
+
+    // Returns false if count lines starting at first
+    // can not contain text with the passed trigrams.
+    bool mayContainTrigrams( LineNumber first, LinesCount count,
+                             const TrigramFilter::Hashes& hashes ) const
+    {
+        return data_->mayContainTrigrams( first, count, hashes );
+    }
+
+    // Get the line that contains the byte at offset,
+    // number of lines if offset is past the indexed data.
+    LineNumber getLineAtOffset( LineOffset::UnderlyingType offset ) const
+    {
+        return data_->getLineAtOffset( offset );
+    }
+
+    QString getTimestampFormat() const
+    {
+        return data_->timestampIndex_.format();
+    }
+
+    // Get bytes where the first line with timestamp not less
+    // than the passed one starts, see TimestampIndex.
+    std::optional<TimestampIndex::Range> findTimestamp( qint64 timestamp ) const
+    {
+        return data_->timestampIndex_.find( timestamp );
+    }
+
+    std::optional<std::pair<qint64, qint64>> getTimeSpan() const
+    {
+        return data_->timestampIndex_.timeSpan();
+    }
+
+    QStringList getIndexedFields() const
+    {
+        return data_->fieldIndex_.fields();
+    }
+
+    // Get lines in [first, last) where indexed fields have the values,
+    // empty if some lines were indexed without fields, see FieldIndex.
+    std::optional<roaring::Roaring64Map> findFieldValues( const std::vector<FieldCondition>& conditions,
+                                                          LineNumber first, LineNumber last ) const
+    {
+        return data_->findFieldValues( conditions, first, last );
+    }
+
+    bool isTokenIndexEnabled() const
+    {
+        return data_->tokenIndex_.isEnabled();
+    }
+
+    bool isLineLengthIndexEnabled() const
+    {
+        return data_->lineLengthIndex_.isEnabled();
+    }
+
+    // Get the length of the line with tabs expanded,
+    // empty if it is not known, see LineLengthIndex.
+    std::optional<LineLength> getLineLength( LineNumber line ) const
+    {
+        return data_->lineLengthIndex_.length( line );
+    }
+
+    bool isLineHashIndexEnabled() const
+    {
+        return data_->lineHashIndex_.isEnabled();
+    }
+
+    // Get the hash of the line bytes, empty if it is not known, see LineHashIndex.
+    std::optional<uint64_t> getLineHash( LineNumber line ) const
+    {
+        return data_->lineHashIndex_.hash( line );
+    }
+
+    // Append hashes of count lines starting at first, see LineHashIndex::hashes.
+    void getLineHashes( LineNumber first, LinesCount count, std::vector<uint64_t>& hashes ) const
+    {
+        data_->lineHashIndex_.hashes( first, count, hashes );
+    }
+
+    bool isRecordIndexEnabled() const
+    {
+        return data_->recordIndex_.isEnabled();
+    }
+
+    // Get all lines of records with any of the lines, see RecordIndex.
+    roaring::Roaring64Map expandToRecords( const roaring::Roaring64Map& lines ) const
+    {
+        return data_->recordIndex_.expand( lines );
+    }
+
+    // True if bytes in [begin, end) may hold binary data, see BinaryRegionIndex
+    bool hasBinaryChunks( qint64 begin, qint64 end ) const
+    {
+        return data_->binaryRegionIndex_.hasBinaryChunks( begin, end );
+    }
+
+    // Get lines in [first, last) that may contain the text as a token,
+    // empty if text is not a token or some lines are not indexed, see TokenIndex.
+    std::optional<roaring::Roaring64Map> findToken( std::string_view text, LineNumber first,
+                                                    LineNumber last ) const
+    {
+        return data_->findToken( text, first, last );
+    }
+
     // Get the guessed encoding for the content.
     QTextCodec* getEncodingGuess() const
     {
@@ -133,10 +302,21 @@ class IndexingDataAccessor {
 
     // Atomically add to all the existing
     // indexing data.
-    void addAll( const QByteArray& block, LineLength length,
-                 const FastLinePositionArray& linePosition, QTextCodec* encoding )
+    void addAll( const QByteArray& block, LineLength length, bool hasTabs,
+                 const FastLinePositionArray& linePosition, QTextCodec* encoding,
+                 std::shared_ptr<TrigramFilter> trigramFilter = {},
+                 std::optional<TimestampSample> timestamp = {},
+                 const std::vector<std::string_view>& lineTexts = {},
+                 std::optional<quint64> blockDigest = {},
+                 const std::vector<uint64_t>& binaryChunks = {} )
     {
-        data_->addAll( block, length, linePosition, encoding );
+        data_->addAll( block, length, hasTabs, linePosition, encoding, std::move( trigramFilter ),
+                       timestamp, lineTexts, blockDigest, binaryChunks );
+    }
+
+    bool isHashingBlocks() const
+    {
+        return !data_->useFastModificationDetection_;
     }
 
     void setHeaderHash( quint64 digest, qint64 size )
@@ -152,6 +332,11 @@ class IndexingDataAccessor {
         data_->hash_.tailDigest = digest;
     }
 
+    void setLastModified( qint64 lastModified )
+    {
+        data_->hash_.lastModified = lastModified;
+    }
+
     int getProgress() const
     {
         return data_->getProgress();
@@ -168,11 +353,96 @@ class IndexingDataAccessor {
         data_->clear();
     }
 
+    // Keep only lines of the first size bytes, see IndexingData::truncate
+    bool truncate( qint64 size )
+    {
+        return data_->truncate( size );
+    }
+
+    // Take all lines and indexes of other data, see IndexingData::replace
+    void replace( IndexingData& other )
+    {
+        data_->replace( other );
+    }
+
     size_t allocatedSize() const
     {
         return data_->allocatedSize();
     }
 
+    size_t residentSize() const
+    {
+        return data_->residentSize();
+    }
+
+    IndexMemoryUsage memoryUsage() const
+    {
+        return data_->memoryUsage();
+    }
+
+    // Serialize line positions, max length and encoding guess,
+    // hash is stored separately to validate the data before loading it
+    void saveIndex( QDataStream& stream ) const
+    {
+        data_->saveIndex( stream );
+    }
+
+    bool loadIndex( QDataStream& stream, const IndexedHash& hash )
+    {
+        return data_->loadIndex( stream, hash );
+    }
+
+    // Switch to sparse line positions storage, must be called on empty data
+    void useSparseIndex()
+    {
+        data_->useSparseIndex();
+    }
+
+    bool isSparseIndex() const
+    {
+        return data_->isSparseIndex();
+    }
+
+    // Sparse index reads the file with it, it is set when the file is opened for indexing
+    void setSparseIndexReader( SparseLinePositionStorage::DataReader reader )
+    {
+        data_->setSparseIndexReader( std::move( reader ) );
+    }
+
+    // See SparseLinePositionStorage::missingBlocks, nothing is missing in other storages
+    SparseLinePositionStorage::MissingBlocks missingSparseBlocks( LineNumber first,
+                                                                  LinesCount count ) const
+    {
+        return data_->missingSparseBlocks( first, count );
+    }
+
+    void addSparseBlocks( const SparseLinePositionStorage::MissingBlocks& missing ) const
+    {
+        data_->addSparseBlocks( missing );
+    }
+
+    // Keep compressed line positions in temporary files, must be called on empty data
+    void useFileBackedIndex()
+    {
+        data_->useFileBackedIndex();
+    }
+
+    void setEncodingParameters( const EncodingParameters& encodingParams )
+    {
+        data_->setEncodingParameters( encodingParams );
+    }
+
+    // See TimestampIndex::detectFormat
+    void detectTimestampFormat( std::string_view sample )
+    {
+        data_->timestampIndex_.detectFormat( sample );
+    }
+
+    void setIndexingInProgress( bool inProgress )
+    {
+        data_->indexingInProgress_.store( inProgress, std::memory_order_release );
+    }
+
   private:
     Data data_;
     LockGuard guard_;
@@ -184,11 +454,44 @@ class IndexingData {
     using ConstAccessor = IndexingDataAccessor<const IndexingData*, SharedLock>;
     using MutateAccessor = IndexingDataAccessor<IndexingData*, UniqueLock>;
 
+    // Values published at the end of each update, they can be read
+    // without locking, so readers do not wait for the indexer.
+    LinesCount getPublishedNbLines() const;
+    LineLength getPublishedMaxLength() const;
+    // Set if some lines may be wider than max length once tabs are expanded
+    bool hasPublishedTabs() const;
+    qint64 getPublishedIndexedSize() const;
+
+    // Changed when offsets of indexed lines may have changed: data is cleared,
+    // truncated, replaced or loaded. Lines read from the file without holding
+    // the lock are dropped if it changed since their offsets were taken.
+    uint64_t getGeneration() const;
+
+    // True while an index operation is adding lines
+    bool isIndexingInProgress() const;
+
+    // Requests sparse line positions for the next full indexing even
+    // if they are not enabled in configuration, kept until data is destroyed
+    void preferSparseIndex();
+    bool isSparseIndexPreferred() const;
+
+    // Memory the index built by the next full indexing may use,
+    // 0 for no limit, see IndexEstimate::chooseStorage
+    void setIndexMemoryLimit( size_t limit );
+    size_t getIndexMemoryLimit() const;
+
+    // Estimate of the index made when the last full indexing started
+    std::optional<IndexEstimate> getIndexEstimate() const;
+    void setIndexEstimate( const std::optional<IndexEstimate>& estimate );
+
   private:
     qint64 getIndexedSize() const;
 
     IndexedHash getHash() const;
 
+    // Digests of hashed blocks that overlap [begin, end)
+    std::vector<IndexedHash::BlockDigest> getBlockDigests( qint64 begin, qint64 end ) const;
+
     // Get the length of the longest line
     LineLength getMaxLength() const;
 
@@ -199,6 +502,21 @@ class IndexingData {
     // of the end of the passed line.
     LineOffset getEndOfLineOffset( LineNumber line ) const;
 
+    // Append end of line positions of count lines starting at first.
+    void getEndOfLineOffsets( LineNumber first, LinesCount count,
+                              std::vector<qint64>& offsets ) const;
+
+    bool mayContainTrigrams( LineNumber first, LinesCount count,
+                             const TrigramFilter::Hashes& hashes ) const;
+
+    LineNumber getLineAtOffset( LineOffset::UnderlyingType offset ) const;
+
+    std::optional<roaring::Roaring64Map> findFieldValues( const std::vector<FieldCondition>& conditions,
+                                                          LineNumber first, LineNumber last ) const;
+
+    std::optional<roaring::Roaring64Map> findToken( std::string_view text, LineNumber first,
+                                                    LineNumber last ) const;
+
     // Get the guessed encoding for the content.
     QTextCodec* getEncodingGuess() const;
     void setEncodingGuess( QTextCodec* codec );
@@ -208,27 +526,98 @@ class IndexingData {
 
     // Atomically add to all the existing
     // indexing data.
-    void addAll( const QByteArray& block, LineLength length,
-                 const FastLinePositionArray& linePosition, QTextCodec* encoding );
+    // Trigram filter of the block is optional, searches
+    // do not skip lines of blocks indexed without it.
+    // Timestamp of one of the lines of the block is optional too.
+    // Line texts are the lines ending in the block, lines added
+    // without them are not in the field and token indexes.
+    // Length is in characters with tabs not expanded, hasTabs
+    // is set if lines of the block may be wider when displayed.
+    // Block digest is computed by the caller outside of the lock,
+    // blocks are not hashed if it is missing.
+    // Binary chunks of the block are found by the parallel scan too.
+    void addAll( const QByteArray& block, LineLength length, bool hasTabs,
+                 const FastLinePositionArray& linePosition, QTextCodec* encoding,
+                 std::shared_ptr<TrigramFilter> trigramFilter,
+                 std::optional<TimestampSample> timestamp,
+                 const std::vector<std::string_view>& lineTexts,
+                 std::optional<quint64> blockDigest,
+                 const std::vector<uint64_t>& binaryChunks );
 
     // Completely clear the indexing data.
     void clear();
 
+    // Keeps lines of the first size bytes of file, size must be the end of
+    // a hashed block. Line continued past size ends with a fake final line feed.
+    // Returns false without changing data if the index can't be kept: it has
+    // sparse line positions or was built with other configuration.
+    bool truncate( qint64 size );
+
+    // Moves lines and indexes of data built in the background to this one,
+    // readers see either all the old lines or all the new ones. Other data
+    // must not be used by other threads, it is left empty.
+    void replace( IndexingData& other );
+
+    // Adds digest of the next block to the full digest
+    void addBlockDigest( const IndexedHash::BlockDigest& blockDigest );
+
     size_t allocatedSize() const;
+    size_t residentSize() const;
+    IndexMemoryUsage memoryUsage() const;
 
     int getProgress() const;
     void setProgress( int progress );
 
+    void saveIndex( QDataStream& stream ) const;
+    bool loadIndex( QDataStream& stream, const IndexedHash& hash );
+
+    void useSparseIndex();
+    bool isSparseIndex() const;
+    void setSparseIndexReader( SparseLinePositionStorage::DataReader reader );
+    SparseLinePositionStorage::MissingBlocks missingSparseBlocks( LineNumber first,
+                                                                  LinesCount count ) const;
+    void addSparseBlocks( const SparseLinePositionStorage::MissingBlocks& missing ) const;
+    void useFileBackedIndex();
+    void setEncodingParameters( const EncodingParameters& encodingParams );
+
+    // Must be called with dataMutex_ held for writing
+    void publish();
+
   private:
     mutable SharedMutex dataMutex_;
 
-    LinePositionArray linePosition_;
+    std::atomic<LinesCount::UnderlyingType> publishedNbLines_{};
+    std::atomic<LineLength::UnderlyingType> publishedMaxLength_{};
+    std::atomic<bool> publishedHasTabs_{};
+    std::atomic<qint64> publishedIndexedSize_{};
+    std::atomic<uint64_t> generation_{};
+    std::atomic<bool> indexingInProgress_{};
+    std::atomic<bool> sparseIndexPreferred_{};
+    std::atomic<size_t> indexMemoryLimit_{};
+
+    mutable Mutex estimateMutex_;
+    std::optional<IndexEstimate> indexEstimate_;
+
+    std::variant<LinePositionArray, SparseLinePositionArray> linePosition_;
     mutable tbb::enumerable_thread_specific<CompressedLinePositionStorage::Cache> linePositionCache_;
+    mutable tbb::enumerable_thread_specific<SparseLinePositionStorage::Cache>
+        sparseLinePositionCache_;
 
     LineLength maxLength_;
+    bool hasTabs_{};
+
+    TrigramIndex trigramIndex_;
+    TimestampIndex timestampIndex_;
+    FieldIndex fieldIndex_;
+    TokenIndex tokenIndex_;
+    LineLengthIndex lineLengthIndex_;
+    LineHashIndex lineHashIndex_;
+    RecordIndex recordIndex_;
+    BinaryRegionIndex binaryRegionIndex_;
 
     int progress_{};
 
+    // Combines digests of blocks into the full digest
     FileDigest hashBuilder_;
     IndexedHash hash_;
 
@@ -246,16 +635,35 @@ struct IndexingState {
     EncodingParameters encodingParams;
     LineOffset::UnderlyingType pos{};
     int64_t max_length{};
-    LineLength::UnderlyingType additional_spaces{};
+    bool has_tabs{};
     LineOffset::UnderlyingType end{};
     LineOffset::UnderlyingType file_size{};
 
     QTextCodec* encodingGuess{};
     QTextCodec* fileTextCodec{};
+
+    // Lines are split for field, token, line length and hash indexes only if one
+    // of them is enabled, bytes of the line continued in the next block are
+    // kept while its start is known. Lines without known text are default
+    // constructed views.
+    bool splitLines{};
+    bool isLineHeadKnown{};
+    std::string lineHead;
+
+    // Blocks are hashed by the parallel scan unless
+    // fast modification detection is used
+    bool hashBlocks{};
 };
 
 using OperationResult = std::variant<bool, MonitoredFileStatus>;
 
+// Log file kept open between partial indexings, so lines
+// appended to a followed file are read without opening it again
+struct TailFile {
+    std::unique_ptr<QFile> file;
+    FileId fileId;
+};
+
 class IndexOperation : public QObject {
     Q_OBJECT
   public:
@@ -273,16 +681,42 @@ class IndexOperation : public QObject {
 
   Q_SIGNALS:
     void indexingProgressed( int );
-    void indexingFinished( bool );
+    void indexingFinished( bool, const OperationStats& stats );
     void fileCheckFinished( MonitoredFileStatus );
 
   protected:
-    using BlockData = std::pair<LineOffset::UnderlyingType, QByteArray>;
+    struct BlockData {
+        // Sequential number of the block within current indexing run
+        std::size_t index;
+        LineOffset::UnderlyingType beginning;
+        QByteArray data;
+    };
+
+    // Result of the parallel scan of one block: positions of all lines that
+    // start inside the block, the part before the first line feed
+    // is left for the serial stage as it depends on the previous blocks.
+    struct ScannedBlock {
+        BlockData block;
+        int headSize{};
+        bool hasLineFeed{};
+        // Line positions are move only, but flow graph messages have to be copyable
+        std::shared_ptr<const FastLinePositionArray> linePositions;
+        IndexingState tailState;
+        std::shared_ptr<TrigramFilter> trigramFilter;
+        std::optional<TimestampSample> timestamp;
+        std::optional<quint64> digest;
+        std::vector<uint64_t> binaryChunks;
+    };
+
     using BlockPrefetcher = tbb::flow::limiter_node<BlockData>;
 
-    // Returns the total size indexed
+    // Returns the time spent in each phase
     // Modify the passed linePosition and maxLength
-    void doIndex( LineOffset initialPosition );
+    OperationStats doIndex( LineOffset initialPosition );
+
+    // Indexes lines appended after initialPosition reading only them from
+    // the opened file, returns nothing if the whole pipeline is needed
+    std::optional<OperationStats> doIndexTail( QFile& file, LineOffset initialPosition );
 
     QString fileName_;
     std::shared_ptr<IndexingData> indexing_data_;
@@ -292,26 +726,59 @@ class IndexOperation : public QObject {
     FastLinePositionArray parseDataBlock( LineOffset::UnderlyingType blockBegining,
                                           const QByteArray& block, IndexingState& state ) const;
 
-    void guessEncoding( const QByteArray& block, IndexingData::MutateAccessor& scopedAccessor,
-                        IndexingState& state ) const;
-
-    std::chrono::microseconds readFileInBlocks( QFile& file, BlockPrefetcher& blockPrefetcher );
-    void indexNextBlock( IndexingState& state, const BlockData& blockData );
+    void guessEncoding( const std::vector<QByteArray>& samples,
+                        IndexingData::MutateAccessor& scopedAccessor, IndexingState& state ) const;
+
+    ScannedBlock scanDataBlock( BlockData blockData, EncodingParameters encodingParams,
+                                bool hashBlock, bool buildTrigramFilter,
+                                const std::optional<TimestampParser>& timestampParser ) const;
+
+    // I/O time, read bytes and waits for the prefetcher are added to stats
+    void readFileInBlocks( QIODevice& file, BlockPrefetcher& blockPrefetcher,
+                           OperationStats& stats, PipelineTrace& trace,
+                           std::atomic<int64_t>& blocksInFlight );
+    void indexNextBlock( IndexingState& state, const ScannedBlock& scannedBlock );
+
+    // Reads encoding and line head of the already indexed part
+    IndexingState initialState( LineOffset initialPosition ) const;
+    // Adds the line that is not terminated at the end of the file
+    void addFakeFinalLineFeed( IndexingData::MutateAccessor& scopedAccessor,
+                               const IndexingState& state ) const;
+    // Saves index of the part of the file parsed so far to index cache,
+    // the line continued in the next block ends with a fake line feed
+    void saveCheckpoint( const IndexingState& state, qint64 lastModified );
+
+    // Returns lines that end in the block, the one started in previous
+    // blocks is joined in lineHead, see IndexingState
+    std::vector<std::string_view> splitLineTexts( IndexingState& state,
+                                                  LineOffset::UnderlyingType lineStart,
+                                                  const BlockData& blockData,
+                                                  const FastLinePositionArray& linePositions,
+                                                  std::string& lineHead ) const;
 };
 
 class FullIndexOperation : public IndexOperation {
     Q_OBJECT
   public:
     FullIndexOperation( const QString& fileName, const std::shared_ptr<IndexingData>& indexingData,
-                        AtomicFlag& interruptRequest, QTextCodec* forcedEncoding = nullptr )
+                        AtomicFlag& interruptRequest, QTextCodec* forcedEncoding = nullptr,
+                        const QString& rotatedFileName = {}, bool keepUnchangedPrefix = false )
         : IndexOperation( fileName, indexingData, interruptRequest )
         , forcedEncoding_( forcedEncoding )
+        , rotatedFileName_( rotatedFileName )
+        , keepUnchangedPrefix_( keepUnchangedPrefix )
     {
     }
     OperationResult run() override;
 
+  private:
+    // Size of the beginning of file where hashed blocks are unchanged
+    qint64 unchangedPrefixSize() const;
+
   private:
     QTextCodec* forcedEncoding_;
+    QString rotatedFileName_;
+    bool keepUnchangedPrefix_;
 };
 
 class PartialIndexOperation : public IndexOperation {
@@ -319,12 +786,20 @@ class PartialIndexOperation : public IndexOperation {
   public:
     PartialIndexOperation( const QString& fileName,
                            const std::shared_ptr<IndexingData>& indexingData,
-                           AtomicFlag& interruptRequest )
+                           AtomicFlag& interruptRequest, TailFile& tailFile )
         : IndexOperation( fileName, indexingData, interruptRequest )
+        , tailFile_( tailFile )
     {
     }
 
     OperationResult run() override;
+
+  private:
+    // Returns nothing if the appended lines can't be read from the tail file
+    std::optional<OperationStats> indexTail( LineOffset initialPosition );
+
+  private:
+    TailFile& tailFile_;
 };
 
 class CheckFileChangesOperation : public IndexOperation {
@@ -362,8 +837,10 @@ class LogDataWorker : public QObject {
     // will work, it will just appear as an empty file.
     void attachFile( const QString& fileName );
     // Instructs the thread to start a new full indexing of the file, sending
-    // signals as it progresses.
-    void indexAll( QTextCodec* forcedEncoding = nullptr );
+    // signals as it progresses. Index of the unchanged beginning of a rewritten
+    // file can be kept, only lines after it are indexed again.
+    void indexAll( QTextCodec* forcedEncoding = nullptr, const QString& rotatedFileName = {},
+                   bool keepUnchangedPrefix = false );
     // Instructs the thread to start a partial indexing (starting at
     // the end of the file as indexed).
     void indexAdditionalLines();
@@ -379,14 +856,14 @@ class LogDataWorker : public QObject {
     void indexingProgressed( int percent );
     // Sent when indexing is finished, signals the client
     // to copy the new data back.
-    void indexingFinished( LoadingStatus status );
+    void indexingFinished( LoadingStatus status, const OperationStats& stats );
 
     // Sent when check file is finished, signals the client
     // to copy the new data back.
     void checkFileChangesFinished( MonitoredFileStatus status );
 
   private Q_SLOTS:
-    void onIndexingFinished( bool result );
+    void onIndexingFinished( bool result, const OperationStats& stats );
     void onCheckFileFinished( MonitoredFileStatus result );
 
   private:
@@ -399,6 +876,9 @@ class LogDataWorker : public QObject {
 
     QString fileName_;
 
+    // Used only by operations running in the pool
+    TailFile tailFile_;
+
     // Pointer to the owner's indexing data (we modify it)
     std::shared_ptr<IndexingData> indexing_data_;
 };
@@ -42,8 +42,11 @@
 #include <cstdint>
 #include <functional>
 #include <memory>
+#include <optional>
 #include <tuple>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include <QByteArray>
 #include <QList>
@@ -53,10 +56,19 @@
 #include <KDSignalThrottler.h>
 
 #include "abstractlogdata.h"
+#include "frozensearchresults.h"
 #include "hsregularexpression.h"
+#include "linesexporter.h"
 #include "linetypes.h"
+#include "loadingstatus.h"
 #include "logfiltereddataworker.h"
+#include "memorygovernor.h"
+#include "operationstats.h"
+#include "persistentsearchcache.h"
 #include "synchronization.h"
+#include "templateclusterer.h"
+#include "timeorder.h"
+#include "valueaggregator.h"
 
 class LogData;
 class QTimer;
@@ -66,20 +78,54 @@ class QTimer;
 // the original line number where they were found.
 // Constructing such objet does not start the search.
 // This object should be constructed by a LogData.
-class LogFilteredData : public AbstractLogData {
+class LogFilteredData : public AbstractLogData, public MemoryConsumer {
     Q_OBJECT
 
   public:
     // Constructor used by LogData
     explicit LogFilteredData( const LogData* logData );
+    ~LogFilteredData();
 
     // Starts the async search, sending newDataAvailable() when new data found.
     // If a search is already in progress this function will block until
     // it is done, so the application should call interruptSearch() first.
+    // Additional patterns are searched in the same pass and their
+    // results are only placed in the search results cache.
+    // Expression compiled from regExp can be passed to be shared
+    // by searches of several files instead of compiling it again.
+    // Lines around focusLine, e.g. the one the user looks at, are searched first.
     void runSearch( const RegularExpressionPattern& regExp, LineNumber startLine,
-                    LineNumber endLine );
+                    LineNumber endLine,
+                    const std::vector<RegularExpressionPattern>& additionalPatterns = {},
+                    std::shared_ptr<const RegularExpression> compiledExpression = {},
+                    OptionalLineNumber focusLine = {} );
     // Shortcut for runSearch on all file
     void runSearch( const RegularExpressionPattern& regExp );
+    // Starts the async search on lines indexed so far and keeps
+    // searching new lines until LogData finishes indexing,
+    // results are not cached.
+    void runSearchWhileIndexing( const RegularExpressionPattern& regExp );
+    // Starts the async search of all lines that stops after the first
+    // or the last matches, see SearchLimit. Results are not cached
+    // and are not updated when lines are added to the file.
+    void runBoundedSearch( const RegularExpressionPattern& regExp, SearchLimit limit );
+    // Starts the async search of a chain of stages, each stage only matches lines
+    // kept by the ones before it and exclude patterns drop lines they match.
+    // Shown results are lines kept by the last stage. Matches of each stage
+    // are cached, so stages before the first changed one are not searched
+    // again by the next chain. Results are not updated when lines are added.
+    void runFilterChain( const std::vector<RegularExpressionPattern>& stages );
+
+    // Searches patterns the user is likely to search for later, like pinned filters,
+    // in all lines in one pass with background priority. Results are only placed
+    // in the search results cache, cached patterns are not searched again.
+    // The current search is not changed.
+    void prerunSearches( const std::vector<RegularExpressionPattern>& patterns );
+
+    // Counts lines matching regExp in all lines without keeping them,
+    // see CountSearchOperation. The current search is not changed,
+    // the count is sent with matchesCounted. Previous count is interrupted.
+    void countMatches( const RegularExpressionPattern& regExp );
 
     // Add to the existing search, starting at the line when the search was
     // last stopped. Used when the file on disk has been added too.
@@ -90,6 +136,23 @@ class LogFilteredData : public AbstractLogData {
     // Clear the search and the list of results.
     void clearSearch( bool dropCache = false );
 
+    enum class SearchCombination { Union, Intersection, Difference };
+    // Combines results of the finished search with cached results of
+    // the pattern for the same lines, without searching the file.
+    // Returns false if there are no such results.
+    bool combineWithCachedSearch( const RegularExpressionPattern& regExp,
+                                  SearchCombination combination );
+
+    // Shows the passed lines as matches of a finished search,
+    // e.g. lines of a message template, without searching the file
+    void showLines( const SearchResultArray& lines );
+
+    // Returns cached results of a search for the whole file with the same
+    // regular expression, together with the line where this search ended.
+    // Returns empty if there are no such results.
+    std::optional<std::pair<SearchResultArray, LineNumber>>
+    getCachedMatches( const QRegularExpression& regexp ) const;
+
     // Returns the line number in the original LogData where the element
     // 'index' was found.
     LineNumber getMatchingLineNumber( LineNumber index ) const;
@@ -101,6 +164,8 @@ class LogFilteredData : public AbstractLogData {
     LinesCount getNbTotalLines() const;
     // Returns the number of matches (independently of the visibility)
     LinesCount getNbMatches() const;
+    // Returns all lines matched by the current search so far
+    SearchResultArray getMatchingLines() const;
     // Returns the number of marks (independently of the visibility)
     LinesCount getNbMarks() const;
 
@@ -111,6 +176,17 @@ class LogFilteredData : public AbstractLogData {
 
     // Add a mark at the given line
     void addMark( LineNumber line );
+    // Add marks at all the given lines at once
+    void addMarks( const SearchResultArray& lines );
+
+    enum class MarksChange { Add, Remove, Toggle };
+    // Changes marks of all the given lines at once. The longest
+    // mark is found again only when the max length is asked for.
+    void changeMarks( const SearchResultArray& lines, MarksChange change );
+    // Marks all lines matched by the current search
+    void markAllMatches();
+    // Removes marks of lines in [first, last)
+    void unmarkRange( LineNumber first, LineNumber last );
     // Get the first mark after the line passed
     OptionalLineNumber getMarkAfter( LineNumber line ) const;
     // Get the first mark before the line passed
@@ -123,6 +199,12 @@ class LogFilteredData : public AbstractLogData {
     void clearMarks();
     // Get all marked lines
     QList<LineNumber> getMarks() const;
+    // Get all marked lines as bitmap
+    SearchResultArray getMarkedLines() const;
+
+    // Cached results of searches in the whole file or in its parts,
+    // in the format they are saved in
+    std::vector<PersistentSearchCache::Entry> getCachedSearchResults() const;
 
     // Changes what the AbstractLogData returns via its getXLines/getNbLines
     // API.
@@ -135,16 +217,99 @@ class LogFilteredData : public AbstractLogData {
     Q_DECLARE_FLAGS( Visibility, VisibilityFlags )
     void setVisibility( Visibility visibility );
 
-    void iterateOverLines( const std::function<void( LineNumber )>& callback ) const;
+    // Shows count lines before and after each match together with matches.
+    // Context lines are found from matches without searching again.
+    void setContextLines( LinesCount count );
+
+    // Shows visible lines ordered by timestamps written in them instead
+    // of their order in the file. Lines are ordered when search is not
+    // running, visible lines are in the file order until it finishes.
+    void setTimeOrdered( bool isTimeOrdered );
+    bool isTimeOrdered() const;
+
+    // Hides visible lines equal to the visible line before them, lines are
+    // compared by hashes stored in the index, see LogData::findRepeatedLines.
+    // Like time order, lines are hidden when search is not running.
+    void setRepeatedLinesHidden( bool isHidden );
+    bool isRepeatedLinesHidden() const;
+
+    // Shows all lines of multi-line records that have visible lines, records
+    // are found in the index, see LogData::expandToRecords. Added lines are
+    // shown as context. Like time order, records are shown when search is
+    // not running.
+    void setWholeRecordsShown( bool isShown );
+    bool isWholeRecordsShown() const;
+
+    // Returns numbers of visible lines before the passed one shown
+    // as matches and as marks that are not matches. Differences of these
+    // counts describe a range of lines without iterating over its lines.
+    std::pair<LinesCount, LinesCount> countLinesBefore( LineNumber line ) const;
+
+    // Returns numbers of matches and marks in lines between consecutive
+    // boundaries, independently of the visibility. Only ranks of boundary
+    // lines are taken, so lines are not iterated over.
+    std::pair<std::vector<uint64_t>, std::vector<uint64_t>>
+    countLinesBetween( const std::vector<LineNumber>& boundaries ) const;
+
+    // Lines matched since the last call and the ones of them that were
+    // shown as marks, empty if matches are not visible
+    struct NewMatches {
+        SearchResultArray matches;
+        SearchResultArray marked;
+    };
+    NewMatches takeNewMatches() const;
+
+    // Matches expected in lines the search has not processed yet,
+    // zero if the search was not estimated from a sample
+    LinesCount getEstimatedMatches( LineNumber begin, LineNumber end ) const;
+
+    // Estimate of the running search, empty if it was not sampled
+    const std::optional<SearchEstimate>& getSearchEstimate() const
+    {
+        return searchEstimate_;
+    }
+
+    // Exporter of count visible lines starting at index first
+    LinesExporter getLinesExporter( LineNumber first, LinesCount count ) const;
+
+    // Aggregator of values in all visible lines
+    ValueAggregator getValueAggregator() const;
+
+    // Clusterer of all visible lines into message templates
+    TemplateClusterer getTemplateClusterer() const;
+
+    // Returns time spent in phases of the last search,
+    // empty if results were taken from cache
+    OperationStats getSearchStats() const;
+
+    // Memory of search results and their cache, see MemoryGovernor
+    QString memoryConsumerFile() const override;
+    size_t memoryUsage() const override;
+    std::vector<MemoryUsagePart> memoryUsageParts() const override;
+    void releaseMemory( Release release ) override;
+
   Q_SIGNALS:
     // Sent when the search has progressed, give the number of matches (so far)
     // and the percentage of completion
     void searchProgressed( LinesCount nbMatches, int progress, LineNumber initialLine );
     void searchProgressedThrottled();
+    // Sent after the last searchProgressed of a search operation
+    void searchFinished( const OperationStats& stats );
+    // Sent before first results of a large file, estimatedMatches
+    // is the number of matches expected in all searched lines
+    void searchEstimated( LinesCount estimatedMatches );
+    // Sent when countMatches is done, not sent if it was interrupted
+    void matchesCounted( LinesCount nbMatches );
 
   private Q_SLOTS:
     void handleSearchProgressed( LinesCount nbMatches, int progress, LineNumber initialLine );
+    void handlePrerunProgressed( LinesCount nbMatches, int progress, LineNumber initialLine );
+    void handleCountProgressed( LinesCount nbMatches, int progress, LineNumber initialLine );
     void handleSearchProgressedThrottled();
+    void handleSearchEstimated( LinesCount estimatedMatches );
+    void handleSearchFinished( const OperationStats& stats );
+    void handleFileChanged( MonitoredFileStatus status );
+    void handleLoadingFinished( LoadingStatus status );
 
   private:
     // Implementation of virtual functions
@@ -152,11 +317,20 @@ class LogFilteredData : public AbstractLogData {
     QString doGetExpandedLineString( LineNumber line ) const override;
     std::vector<QString> doGetLines( LineNumber first, LinesCount number ) const override;
     std::vector<QString> doGetExpandedLines( LineNumber first, LinesCount number ) const override;
+    std::vector<QString> doGetExpandedLinesWindow( LineNumber first, LinesCount number,
+                                                   int firstColumn,
+                                                   int nbColumns ) const override;
+    using SourceLinesGetter = std::function<std::vector<QString>( LineNumber, LinesCount )>;
     std::vector<QString> doGetLines( LineNumber first, LinesCount number,
-                                     const std::function<QString( LineNumber )>& lineGetter ) const;
+                                     const SourceLinesGetter& sourceLinesGetter ) const;
+    void doGetLinesBatch( LineNumber first, LinesCount number, LineBatch& batch ) const override;
+    std::vector<AnsiColorSpan> doGetLineColors( LineNumber line ) const override;
+    bool doLoadMoreOfLine( LineNumber line ) const override;
     LinesCount doGetNbLine() const override;
     LineLength doGetMaxLength() const override;
     LineLength doGetLineLength( LineNumber line ) const override;
+    void doPrefetchLines( LineNumber first, LinesCount number ) const override;
+    bool doAreLinesCached( LineNumber first, LinesCount number ) const override;
 
     void doSetDisplayEncoding( const char* encoding ) override;
     QTextCodec* doGetDisplayEncoding() const override;
@@ -177,11 +351,25 @@ class LogFilteredData : public AbstractLogData {
     SearchResultArray marks_;
     SearchResultArray marks_and_matches_;
 
+    // Lines around matches that are not matches themselves
+    SearchResultArray context_lines_;
+    // Visible lines together with context lines, if they are shown
+    SearchResultArray lines_with_context_;
+    LinesCount contextLines_;
+
+    // Matches added by the search since they were last taken
+    mutable SearchResultArray newMatches_;
+
     const LogData* sourceLogData_;
 
     RegularExpressionPattern currentRegExp_;
+    std::vector<RegularExpressionPattern> additionalPatterns_;
     LineLength maxLength_;
-    LineLength maxLengthMarks_;
+    // Recalculated when it is not valid
+    mutable LineLength maxLengthMarks_;
+    mutable bool isMaxLengthMarksValid_ = true;
+    mutable LineLength maxLengthContext_;
+    mutable bool isMaxLengthContextValid_ = true;
     // Number of lines of the LogData that has been searched for:
     LinesCount nbLinesProcessed_;
 
@@ -189,15 +377,69 @@ class LogFilteredData : public AbstractLogData {
 
     LogFilteredDataWorker workerThread_;
 
+    // Searches patterns of prerunSearches, its matches are collected until it finishes
+    LogFilteredDataWorker prerunWorker_;
+    std::vector<RegularExpressionPattern> prerunPatterns_;
+    LineNumber prerunEndLine_;
+    SearchResultArray prerunMatches_;
+
+    // Counts matches of countMatches
+    LogFilteredDataWorker countWorker_;
+
     Mutex searchProgressMutex_;
     std::tuple<LinesCount, int, LineNumber> searchProgress_;
 
-    KDToolBox::KDSignalThrottler searchProgressThrottler_;
+    OperationStats searchStats_;
+    std::optional<SearchEstimate> searchEstimate_;
+
+    // Set while results are those of a bounded search
+    std::optional<SearchLimit> searchLimit_;
+
+    // Stages of the filter chain, set while its results are shown
+    std::vector<RegularExpressionPattern> filterChain_;
+
+    // Matches of stages of the last filter chains, each one of lines kept by
+    // the stages before it. They are valid while the file has the same lines.
+    struct FilterStage {
+        RegularExpressionPattern pattern;
+        FrozenSearchResults matches;
+    };
+    std::vector<FilterStage> filterStages_;
+    LineNumber filterStagesEndLine_;
+
+    // Last index found in current results, lookups of the following
+    // indexes walk from it instead of selecting from the first line
+    struct LineCursor {
+        LineNumber index;
+        LineNumber line;
+    };
+    mutable Mutex lineCursorMutex_;
+    mutable std::optional<LineCursor> lineCursor_;
+
+    bool isTimeOrdered_ = false;
+    bool isSearching_ = false;
+    // Order of visible lines if they are ordered by time
+    std::optional<TimeOrder> timeOrder_;
+
+    bool isWholeRecordsShown_ = false;
+    // Visible lines with the rest of their records if they are shown
+    std::optional<SearchResultArray> recordLines_;
+    LineLength maxLengthRecords_;
+
+    bool isRepeatedLinesHidden_ = false;
+    // Visible lines without repeated ones if they are hidden
+    std::optional<SearchResultArray> uniqueLines_;
+
+    // First matches are shown as soon as they are found
+    KDToolBox::KDSignalLeadingThrottler searchProgressThrottler_;
 
   private:
     struct CachedSearchResult {
-        SearchResultArray matching_lines;
+        FrozenSearchResults matching_lines;
         LineLength maxLength;
+
+        // Milliseconds since epoch
+        qint64 lastUsed = 0;
     };
 
     using SearchCacheKey = std::tuple<RegularExpressionPattern, LineNumber::UnderlyingType, LineNumber::UnderlyingType>;
@@ -224,6 +466,26 @@ class LogFilteredData : public AbstractLogData {
     std::unordered_map<SearchCacheKey, CachedSearchResult, SearchCacheKeyHash> searchResultsCache_;
     SearchCacheKey currentSearchKey_;
 
+    // Results of the last finished search, a search
+    // for a narrower pattern only reads these lines
+    std::optional<std::pair<SearchCacheKey, CachedSearchResult>> lastCompletedSearch_;
+
+    // Lines that can still match a search cleared before it finished:
+    // its matches and lines it did not process yet. Live search refines
+    // it when a pattern is typed further.
+    std::optional<std::pair<SearchCacheKey, SearchResultArray>> interruptedSearch_;
+
+    // Results saved in previous sessions are loaded on first search
+    bool isPersistentCacheLoaded_ = false;
+
+    // File changed on disk and its cached results are
+    // cut to the unchanged lines once it is indexed again
+    bool isSourceChanged_ = false;
+
+    // Matches are combined with other searches and
+    // must not be cached for currentSearchKey_
+    bool hasCombinedResults_ = false;
+
     SearchCacheKey makeCacheKey( const RegularExpressionPattern& regExp, LineNumber startLine,
                                  LineNumber endLine )
     {
@@ -231,6 +493,16 @@ class LogFilteredData : public AbstractLogData {
     }
 
     void updateSearchResultsCache();
+    void cacheFilterStages();
+    void cacheAdditionalSearchResults();
+    void insertIntoSearchResultsCache( const SearchCacheKey& cacheKey,
+                                       CachedSearchResult result );
+    void loadPersistentSearchCache();
+    void savePersistentSearchCache() const;
+    // Results of analysis bundle attached to the file are cached
+    // whatever the settings of persistent search cache are
+    void loadAttachedSearchResults();
+    void addCachedSearchResults( std::vector<PersistentSearchCache::Entry> entries );
 
     inline LineNumber getExpectedSearchEnd( const SearchCacheKey& cacheKey ) const
     {
@@ -239,11 +511,33 @@ class LogFilteredData : public AbstractLogData {
 
     // Utility functions
     const SearchResultArray& currentResultArray() const;
+    // Lines shown by visibility flags before records are expanded
+    const SearchResultArray& visibleResultArray() const;
+    // Visible lines with their records before repeated lines are hidden
+    const SearchResultArray& recordResultArray() const;
     LineNumber findLogDataLine( LineNumber lineNum ) const;
     LineNumber findFilteredLine( LineNumber lineNum ) const;
+    // Walks current results once for a range of indexes,
+    // indexes past the end are mapped to maxValue
+    std::vector<LineNumber> findLogDataLines( LineNumber firstIndex, LinesCount number ) const;
+    // Has to be called when current results change
+    void resetLineCursor();
+    void updateRecordLines();
+    void updateUniqueLines();
+    void updateTimeOrder();
 
     // update maxLengthMarks_ when a Marks was changed.
     void updateMaxLengthMarks( OptionalLineNumber added_line, OptionalLineNumber removed_line );
+    // Longest of the lines, file's longest line when there are many of them
+    LineLength measureLines( const SearchResultArray& lines ) const;
+
+    bool isShowingContext() const;
+    // Lines at most contextLines_ before or after matches, except matches
+    SearchResultArray findContextLines( const SearchResultArray& matches ) const;
+    // Have to be called when all matches change
+    void updateContextLines();
+    // Has to be called when matches, marks or visibility change
+    void updateLinesWithContext();
 };
 
 Q_DECLARE_OPERATORS_FOR_FLAGS( LogFilteredData::Visibility )
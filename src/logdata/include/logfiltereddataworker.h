@@ -39,6 +39,14 @@
 #ifndef LOGFILTEREDDATAWORKERTHREAD_H
 #define LOGFILTEREDDATAWORKERTHREAD_H
 
+#include <chrono>
+#include <map>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
 #include <QObject>
 
 #include <qthreadpool.h>
@@ -50,8 +58,10 @@
 #endif
 
 #include "atomicflag.h"
+#include "fieldindex.h"
 #include "regularexpression.h"
 #include "linetypes.h"
+#include "operationstats.h"
 #include "synchronization.h"
 
 class LogData;
@@ -85,12 +95,47 @@ class MatchingLine {
 // a fixed "in-place" array (vector) is probably fine.
 using SearchResultArray = roaring::Roaring64Map;
 
+// Results of earlier searches for whole files by their patterns
+using PatternSearchResults = std::vector<std::pair<RegularExpressionPattern, SearchResultArray>>;
+
 struct SearchResults {
     SearchResultArray newMatches;
     LineLength maxLength;
     LinesCount processedLines;
 };
 
+// Results of a pattern searched along with the main one
+struct AdditionalSearchResults {
+    SearchResultArray matches;
+    LineLength maxLength;
+};
+
+// Matches expected from a sample of searched lines before all of them are read.
+// Density is the share of matching lines in each of equal parts of the lines.
+struct SearchEstimate {
+    LinesCount matches;
+    LinesCount sampledLines;
+    LineNumber startLine;
+    LineNumber endLine;
+    std::vector<float> density;
+
+    // Cost of matching measured on the sample
+    QString engine;
+    uint64_t bytesPerSecond = 0;
+    // Time matching threads need for the whole range,
+    // a search can't be faster than it
+    std::chrono::milliseconds duration{};
+};
+
+// Search that stops after the first or the last matches of its lines,
+// lines after the last of them or before the first are not searched
+struct SearchLimit {
+    enum class Direction { FromStart, FromEnd };
+
+    uint64_t matches = 0;
+    Direction direction = Direction::FromStart;
+};
+
 // This class is a mutex protected set of search result data.
 // It is thread safe.
 class SearchData {
@@ -98,8 +143,14 @@ class SearchData {
     // will clear new matches
     SearchResults takeCurrentResults() const;
 
-    // Atomically add to all the existing search data.
-    void addAll( LineLength length, const SearchResultArray& matches, LinesCount nbLinesProcessed );
+    // Lines before the passed one are not searched and are counted as processed
+    void startProcessingAt( LineNumber line );
+
+    // Atomically add matches of a chunk to all the existing search data.
+    // Chunks can be added in any order, processed lines are
+    // counted up to the first chunk that is not done yet.
+    void addAll( LineLength length, const SearchResultArray& matches, LineNumber chunkStart,
+                 LinesCount chunkLines );
     // Get the number of matches
     LinesCount getNbMatches() const;
     // Get the last matched line number
@@ -112,44 +163,137 @@ class SearchData {
     // Delete the match for the passed line (if it exist)
     void deleteMatch( LineNumber line );
 
+    // Results of additional patterns are accumulated
+    // separately and taken at once when search is done
+    void resetAdditionalResults( size_t patternsCount );
+    void addAdditionalMatches( size_t patternIndex, LineLength length,
+                               const SearchResultArray& matches );
+    std::vector<AdditionalSearchResults> takeAdditionalResults();
+
+    // Matches of the stages of a filter chain before the last one,
+    // see FilterChainOperation
+    void addStageMatches( SearchResultArray matches );
+    std::vector<SearchResultArray> takeStageMatches();
+
+    void setEstimate( SearchEstimate estimate );
+    std::optional<SearchEstimate> getEstimate() const;
+
+    // Lines matched by each sub pattern of a boolean search,
+    // hits of update searches are added to the previous ones
+    std::vector<uint64_t> addSubPatternHits( const std::vector<uint64_t>& hits );
+
     // Atomically clear the data.
     void clear();
 
   private:
     mutable SharedMutex dataMutex_;
 
+    std::vector<AdditionalSearchResults> additionalResults_;
+    std::vector<SearchResultArray> stageMatches_;
+    std::optional<SearchEstimate> estimate_;
+    std::vector<uint64_t> subPatternHits_;
+
     SearchResultArray matches_;
     mutable SearchResultArray newMatches_;
     LineLength maxLength_{ 0 };
     LinesCount nbLinesProcessed_{ 0 };
     LinesCount nbMatches_{ 0 };
+
+    // End lines of chunks done after some earlier ones, by their first lines
+    std::map<LineNumber::UnderlyingType, LineNumber::UnderlyingType> completedRanges_;
 };
 
+// Compiled expressions, matchers and buffers kept between searches
+class SearchEngine;
+
 class SearchOperation : public QObject {
     Q_OBJECT
   public:
     SearchOperation( const LogData& sourceLogData, AtomicFlag& interruptRequested,
                      const RegularExpressionPattern& regExp, LineNumber startLine,
-                     LineNumber endLine );
+                     LineNumber endLine, bool followIndexing = false,
+                     std::vector<RegularExpressionPattern> additionalPatterns = {},
+                     std::shared_ptr<const RegularExpression> compiledExpression = {} );
 
     // Run the search operation, returns true if it has been done
     // and false if it has been cancelled (results not copied)
     virtual void run( SearchData& result ) = 0;
 
+    // Search reuses the engine instead of setting up its own
+    void setSearchEngine( SearchEngine* engine )
+    {
+        searchEngine_ = engine;
+    }
+
   Q_SIGNALS:
     void searchProgressed( LinesCount nbMatches, int percent, LineNumber initialLine );
-    void searchFinished();
+    void searchEstimated( LinesCount estimatedMatches );
+    void searchFinished( const OperationStats& stats );
 
   protected:
     // Implement the common part of the search, passing
     // the shared results and the line to begin the search from.
     void doSearch( SearchData& result, LineNumber initialLine );
 
+    // Matches a random chunk of each part of lines for a short time
+    // to estimate the number of matches before the full search
+    void estimateMatches( SearchData& result, const PatternMatcher& matcher,
+                          LineNumber initialLine, LineNumber endLine, uint32_t matchingThreads );
+
+    // Takes matches of field query from the field index of the file,
+    // returns false if the index does not have all searched lines
+    bool searchFieldIndex( SearchData& result, LineNumber initialLine, LineNumber endLine );
+
+    // Looks up terms of the expression in indexes and earlier results, see SearchPlanner.
+    // Lines matched by looked up terms are added without reading them, search scope is
+    // limited to lines that still have to be matched. Returns true if none of them are left.
+    bool planSearch( SearchData& result, const RegularExpression& expression,
+                     LineNumber initialLine, LineNumber endLine );
+
     AtomicFlag& interruptRequested_;
     const RegularExpressionPattern regexp_;
     const LogData& sourceLogData_;
     LineNumber startLine_;
     LineNumber endLine_;
+
+    // Keep searching lines added by the indexer until it finishes
+    bool followIndexing_;
+
+    // Matched in the same pass as regexp_, results are kept in SearchData
+    std::vector<RegularExpressionPattern> additionalPatterns_;
+
+    // If set, only these lines are read and matched
+    std::optional<SearchResultArray> searchScope_;
+
+    // Matches of a large file are estimated from a sample first
+    bool estimateMatches_ = false;
+
+    // Compiled from regexp_ by the caller, compiled for this search if not set
+    std::shared_ptr<const RegularExpression> compiledExpression_;
+
+    // Set if regexp_ is a query of fields indexed by the source,
+    // like "level=ERROR and service=payments"
+    std::optional<std::vector<FieldCondition>> fieldConditions_;
+
+    // Results of searches for terms of regexp_, used by planSearch
+    PatternSearchResults termResults_;
+
+    // If set, chunks around this line are searched first,
+    // moving away from it in both directions
+    OptionalLineNumber focusLine_;
+
+    // Search the user has not asked for, it has background priority
+    bool isBackgroundWork_ = false;
+
+    // If set, chunks are combined in order and the search
+    // is cancelled once the limit of matches is reached
+    std::optional<SearchLimit> limit_;
+
+    // Owned by the worker, not used by other operations at the same time
+    SearchEngine* searchEngine_ = nullptr;
+
+    // Matching lines are only counted, nothing is added to search data
+    bool isCountOnly_ = false;
 };
 
 class FullSearchOperation : public SearchOperation {
@@ -157,9 +301,19 @@ class FullSearchOperation : public SearchOperation {
   public:
     FullSearchOperation( const LogData& sourceLogData, AtomicFlag& interruptRequested,
                          const RegularExpressionPattern& regExp, LineNumber startLine,
-                         LineNumber endLine )
-        : SearchOperation( sourceLogData, interruptRequested, regExp, startLine, endLine )
+                         LineNumber endLine, bool followIndexing,
+                         std::vector<RegularExpressionPattern> additionalPatterns,
+                         std::shared_ptr<const RegularExpression> compiledExpression,
+                         OptionalLineNumber focusLine, PatternSearchResults termResults,
+                         std::optional<SearchLimit> limit )
+        : SearchOperation( sourceLogData, interruptRequested, regExp, startLine, endLine,
+                           followIndexing, std::move( additionalPatterns ),
+                           std::move( compiledExpression ) )
     {
+        estimateMatches_ = !followIndexing_ && additionalPatterns_.empty() && !limit;
+        focusLine_ = focusLine;
+        termResults_ = std::move( termResults );
+        limit_ = limit;
     }
 
     void run( SearchData& result ) override;
@@ -182,6 +336,103 @@ class UpdateSearchOperation : public SearchOperation {
     LineNumber initialPosition_;
 };
 
+// Continues cached results of the same search, that cover lines
+// before position, on lines added to the file since then
+class ExtendSearchOperation : public SearchOperation {
+    Q_OBJECT
+  public:
+    ExtendSearchOperation( const LogData& sourceLogData, AtomicFlag& interruptRequested,
+                           const RegularExpressionPattern& regExp, LineNumber startLine,
+                           LineNumber endLine, LineNumber position, LineLength cachedMaxLength )
+        : SearchOperation( sourceLogData, interruptRequested, regExp, startLine, endLine )
+        , initialPosition_( position )
+        , cachedMaxLength_( cachedMaxLength )
+    {
+    }
+
+    void run( SearchData& result ) override;
+
+  private:
+    LineNumber initialPosition_;
+    LineLength cachedMaxLength_;
+};
+
+// Searches only lines matched by a previous search
+// with a pattern implied by the new one
+class RefineSearchOperation : public SearchOperation {
+    Q_OBJECT
+  public:
+    RefineSearchOperation( const LogData& sourceLogData, AtomicFlag& interruptRequested,
+                           const RegularExpressionPattern& regExp, LineNumber startLine,
+                           LineNumber endLine, SearchResultArray previousMatches )
+        : SearchOperation( sourceLogData, interruptRequested, regExp, startLine, endLine )
+    {
+        searchScope_ = std::move( previousMatches );
+    }
+
+    void run( SearchData& result ) override;
+};
+
+// Searches patterns the user is likely to search for later, like pinned
+// filters, in one pass with background priority. The first pattern is
+// the main one, results of the others are additional results.
+class PrerunSearchOperation : public SearchOperation {
+    Q_OBJECT
+  public:
+    PrerunSearchOperation( const LogData& sourceLogData, AtomicFlag& interruptRequested,
+                           const std::vector<RegularExpressionPattern>& patterns,
+                           LineNumber startLine, LineNumber endLine )
+        : SearchOperation( sourceLogData, interruptRequested, patterns.front(), startLine,
+                           endLine, false, { std::next( patterns.begin() ), patterns.end() } )
+    {
+        isBackgroundWork_ = true;
+    }
+
+    void run( SearchData& result ) override;
+};
+
+// Counts lines matching the pattern, for counts of patterns that are not shown.
+// Matchers only count lines of their chunks, so no bitmaps of matches are built
+// and merged. The count is passed with the last searchProgressed.
+class CountSearchOperation : public SearchOperation {
+    Q_OBJECT
+  public:
+    CountSearchOperation( const LogData& sourceLogData, AtomicFlag& interruptRequested,
+                          const RegularExpressionPattern& regExp, LineNumber startLine,
+                          LineNumber endLine )
+        : SearchOperation( sourceLogData, interruptRequested, regExp, startLine, endLine )
+    {
+        isCountOnly_ = true;
+    }
+
+    void run( SearchData& result ) override;
+};
+
+// Runs stages of a filter chain one after another, each stage only matches
+// lines kept by the stage before it. Exclude patterns keep lines they do not match.
+// The first stage matches lines of scope if it is set, or all lines.
+// Matches of the last stage are results of the search, matches of the
+// stages before it are kept in search data to be cached by the caller.
+class FilterChainOperation : public SearchOperation {
+    Q_OBJECT
+  public:
+    FilterChainOperation( const LogData& sourceLogData, AtomicFlag& interruptRequested,
+                          const std::vector<RegularExpressionPattern>& stages,
+                          LineNumber startLine, LineNumber endLine,
+                          std::optional<SearchResultArray> scope )
+        : SearchOperation( sourceLogData, interruptRequested, stages.back(), startLine,
+                           endLine )
+        , stages_( stages.begin(), std::prev( stages.end() ) )
+    {
+        searchScope_ = std::move( scope );
+    }
+
+    void run( SearchData& result ) override;
+
+  private:
+    std::vector<RegularExpressionPattern> stages_;
+};
+
 class LogFilteredDataWorker : public QObject {
     Q_OBJECT
 
@@ -196,11 +447,48 @@ class LogFilteredDataWorker : public QObject {
     LogFilteredDataWorker& operator=( LogFilteredDataWorker&& ) = delete;
 
     // Start the search with the passed regexp
-    void search( const RegularExpressionPattern& regExp, LineNumber startLine, LineNumber endLine );
+    // If followIndexing is set, search continues with lines
+    // added by the indexer until indexing is finished.
+    // Additional patterns are matched in the same pass,
+    // see getAdditionalSearchResults.
+    // Expression compiled from regExp is optional.
+    // If focusLine is set, lines around it are searched first.
+    // Term results are results of searches for sub patterns of regExp
+    // in the same lines, terms found in them are not matched again.
+    // If limit is set, only the first or the last matches are searched for.
+    void search( const RegularExpressionPattern& regExp, LineNumber startLine, LineNumber endLine,
+                 bool followIndexing = false,
+                 const std::vector<RegularExpressionPattern>& additionalPatterns = {},
+                 std::shared_ptr<const RegularExpression> compiledExpression = {},
+                 OptionalLineNumber focusLine = {}, PatternSearchResults termResults = {},
+                 std::optional<SearchLimit> limit = {} );
+    // Start the search of not empty patterns with background priority,
+    // see PrerunSearchOperation
+    void prerunSearch( const std::vector<RegularExpressionPattern>& patterns,
+                       LineNumber startLine, LineNumber endLine );
+    // Start the search with the passed regexp only on lines
+    // matched by previous search, every line matching regExp
+    // must be in previousMatches
+    void refineSearch( const RegularExpressionPattern& regExp, LineNumber startLine,
+                       LineNumber endLine, SearchResultArray previousMatches );
+    // Start the search of not empty stages, see FilterChainOperation
+    void runFilterChain( const std::vector<RegularExpressionPattern>& stages,
+                         LineNumber startLine, LineNumber endLine,
+                         std::optional<SearchResultArray> scope );
+    // Start counting lines matching regExp, see CountSearchOperation
+    void countMatches( const RegularExpressionPattern& regExp, LineNumber startLine,
+                       LineNumber endLine );
     // Continue the previous search starting at the passed position
-    // in the source file (line number)
-    void updateSearch( const RegularExpressionPattern& regExp, LineNumber startLine,
+    // in the source file (line number). Caller does not wait for the update,
+    // if one is still waiting to start its lines are extended instead and
+    // false is returned.
+    bool updateSearch( const RegularExpressionPattern& regExp, LineNumber startLine,
                        LineNumber endLine, LineNumber position );
+    // Start the search with the passed regexp from position, lines before
+    // it were searched earlier and their results are kept by the caller.
+    // The line before position is searched again.
+    void extendSearch( const RegularExpressionPattern& regExp, LineNumber startLine,
+                       LineNumber endLine, LineNumber position, LineLength cachedMaxLength );
 
     // Interrupts the search if one is in progress
     void interrupt();
@@ -208,16 +496,32 @@ class LogFilteredDataWorker : public QObject {
     // get the current indexing data
     SearchResults getSearchResults() const;
 
+    // Results of additional patterns in the order they were
+    // passed to search, empty until search is finished
+    std::vector<AdditionalSearchResults> getAdditionalSearchResults();
+
+    // Matches of stages of the filter chain before its last stage,
+    // empty until the search is finished
+    std::vector<SearchResultArray> getFilterStageMatches();
+
+    // Estimate of the running search, if it was sampled
+    std::optional<SearchEstimate> getSearchEstimate() const;
+
   Q_SIGNALS:
     // Sent during the indexing process to signal progress
     // percent being the percentage of completion.
     void searchProgressed( LinesCount nbMatches, int percent, LineNumber initialLine );
+    // Sent when matches of a large file are estimated from a sample
+    void searchEstimated( LinesCount estimatedMatches );
     // Sent when indexing is finished, signals the client
     // to copy the new data back.
-    void searchFinished();
+    void searchFinished( const OperationStats& stats );
 
   private:
     void connectSignalsAndRun( SearchOperation* operationRequested );
+    // Waits for the interrupted operation and logs how long it took to stop
+    void waitForPreviousOperation();
+    void runPendingUpdate();
 
   private:
     const LogData& sourceLogData_;
@@ -226,8 +530,22 @@ class LogFilteredDataWorker : public QObject {
     QThreadPool operationsPool_;
     Mutex operationsMutex_;
 
+    // Update that is waiting in the pool, later updates are merged into it.
+    // Interruption drops it.
+    struct PendingUpdate {
+        RegularExpressionPattern regExp;
+        LineNumber startLine;
+        LineNumber endLine;
+        LineNumber position;
+    };
+    Mutex pendingUpdateMutex_;
+    std::optional<PendingUpdate> pendingUpdate_;
+
     // Shared indexing data
     SearchData searchData_;
+
+    // Used by the operations that run one at a time
+    std::unique_ptr<SearchEngine> searchEngine_;
 };
 
 #endif
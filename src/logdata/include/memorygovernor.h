@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_MEMORYGOVERNOR_H
+#define KLOGG_MEMORYGOVERNOR_H
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include <QHash>
+#include <QString>
+
+class QTimer;
+
+// Part of an open file that keeps memory it can give back, like
+// LogData with its index and line cache or LogFilteredData with search results.
+class MemoryConsumer {
+  public:
+    // Ways to release memory, from the cheapest to restore to the most expensive
+    enum class Release {
+        // Drops caches that are rebuilt on demand
+        Caches,
+        // Compacts search results bitmaps
+        CompactResults,
+        // Reindexes file into sparse line positions, which are read from disk
+        SparseIndex,
+    };
+
+    // Name of a part shown to the user and its size in bytes
+    using MemoryUsagePart = std::pair<QString, size_t>;
+
+    virtual ~MemoryConsumer() = default;
+
+    virtual QString memoryConsumerFile() const = 0;
+    virtual size_t memoryUsage() const = 0;
+    // Memory usage split into parts, adds up to memoryUsage
+    virtual std::vector<MemoryUsagePart> memoryUsageParts() const = 0;
+    virtual void releaseMemory( Release release ) = 0;
+};
+
+// Process-wide budget for memory used by all open files, see
+// Configuration::memoryBudgetMb. When open files use more memory than the budget,
+// memory is released from files that have not been shown for the longest time,
+// the file shown last is only asked to drop caches.
+// Memory freed by closed files and finished searches is given back to the system,
+// see releaseFreedMemory, allocators keep it for later allocations otherwise.
+// Must be used from the main thread.
+class MemoryGovernor {
+  public:
+    static MemoryGovernor& get();
+
+    MemoryGovernor( const MemoryGovernor& ) = delete;
+    MemoryGovernor& operator=( const MemoryGovernor& ) = delete;
+
+    void addConsumer( MemoryConsumer* consumer );
+    void removeConsumer( MemoryConsumer* consumer );
+
+    // Called when the file is shown to the user
+    void markUsed( const QString& fileName );
+
+    // Releases memory of consumers until their usage fits into the budget,
+    // called when consumers have allocated more memory
+    void enforceBudget();
+
+    size_t memoryUsage() const;
+
+    // Releases freed memory in background after a short delay, requests made
+    // until then are merged. Also done periodically while files are open.
+    void scheduleRelease();
+
+  private:
+    MemoryGovernor() = default;
+
+    // Consumers of least recently used files first
+    std::vector<MemoryConsumer*> consumersByUsage() const;
+
+    std::vector<MemoryConsumer*> consumers_;
+
+    // Counter value when the file was shown last
+    QHash<QString, quint64> fileUsage_;
+    quint64 usageCounter_ = 0;
+
+    // Set from scheduling of release until it is done
+    std::atomic<bool> isReleaseScheduled_{ false };
+    QTimer* idleReleaseTimer_ = nullptr;
+};
+
+#endif
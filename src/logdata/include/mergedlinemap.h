@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_MERGEDLINEMAP_H
+#define KLOGG_MERGEDLINEMAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "linetypes.h"
+
+// Maps lines of several files merged into one sequence to lines of the files.
+// Only the file of each merged line is stored, packed in as few bits as
+// the number of files needs. Lines within files are counted from checkpoints
+// that keep the number of lines of each file before every CheckpointInterval lines.
+class MergedLineMap {
+  public:
+    static constexpr uint64_t CheckpointInterval = 256;
+
+    struct SourceLine {
+        size_t source;
+        LineNumber line;
+    };
+
+    // Consecutive lines of one file
+    struct Run {
+        size_t source;
+        LineNumber firstLine;
+        LinesCount count;
+    };
+
+    explicit MergedLineMap( size_t sourcesCount );
+
+    // Adds the next line of the source file
+    void append( size_t source );
+
+    LinesCount size() const;
+
+    size_t sourcesCount() const
+    {
+        return sourcesCount_;
+    }
+
+    SourceLine sourceLine( LineNumber line ) const;
+
+    // Splits count merged lines starting at first by files
+    std::vector<Run> runs( LineNumber first, LinesCount count ) const;
+
+    // Merged line number of the line of source file, empty if it was not merged
+    OptionalLineNumber mergedLine( size_t source, LineNumber line ) const;
+
+    size_t allocatedSize() const;
+
+  private:
+    size_t sourceAt( uint64_t index ) const;
+
+    // Lines of each file before the passed merged line
+    std::vector<LineNumber::UnderlyingType> sourceLinesBefore( uint64_t index ) const;
+
+  private:
+    size_t sourcesCount_;
+
+    // Power of two, so that entries never cross words
+    unsigned bitsPerLine_;
+    std::vector<uint64_t> words_;
+
+    std::vector<LineNumber::UnderlyingType> checkpoints_;
+    std::vector<LineNumber::UnderlyingType> sourceLines_;
+    uint64_t size_ = 0;
+};
+
+#endif
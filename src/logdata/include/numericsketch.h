@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_NUMERICSKETCH_H
+#define KLOGG_NUMERICSKETCH_H
+
+#include <cstdint>
+#include <map>
+
+// Summary of a stream of numbers answering quantiles with bounded relative
+// error. Values are counted in buckets growing exponentially from zero,
+// so each bucket covers values within RelativeAccuracy of its middle.
+// Sketches of parts of the stream are merged by adding their buckets,
+// merged sketch is the same as if it had all values added to it.
+class NumericSketch {
+  public:
+    static constexpr double RelativeAccuracy = 0.01;
+
+    void add( double value );
+    void merge( const NumericSketch& other );
+
+    uint64_t count() const
+    {
+        return count_;
+    }
+
+    double sum() const
+    {
+        return sum_;
+    }
+
+    // Exact smallest and largest values, 0 if sketch is empty
+    double min() const
+    {
+        return count_ > 0 ? min_ : 0.0;
+    }
+
+    double max() const
+    {
+        return count_ > 0 ? max_ : 0.0;
+    }
+
+    double mean() const
+    {
+        return count_ > 0 ? sum_ / static_cast<double>( count_ ) : 0.0;
+    }
+
+    // Value with rank q in [0, 1] among added values, 0 if sketch is empty
+    double quantile( double q ) const;
+
+  private:
+    static int bucketIndex( double magnitude );
+    static double bucketValue( int index );
+
+  private:
+    // Buckets of magnitudes of positive and negative values
+    std::map<int, uint64_t> positive_;
+    std::map<int, uint64_t> negative_;
+    uint64_t zeros_ = 0;
+
+    uint64_t count_ = 0;
+    double sum_ = 0.0;
+    double min_ = 0.0;
+    double max_ = 0.0;
+};
+
+#endif // KLOGG_NUMERICSKETCH_H
@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_OPERATIONSTATS_H
+#define KLOGG_OPERATIONSTATS_H
+
+#include <chrono>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include <QMetaType>
+#include <QString>
+
+// Time spent in phases of an indexing or a search operation,
+// tells if it was limited by the disk or by the CPU.
+struct OperationStats {
+    uint64_t bytesRead = 0;
+    std::chrono::microseconds duration{};
+
+    // Reading from the file
+    std::chrono::microseconds ioDuration{};
+    // Finding lines in read blocks, summed for all threads
+    std::chrono::microseconds parseDuration{};
+    // Matching of each thread
+    std::vector<std::chrono::microseconds> matchDurations;
+    // Merging results of blocks in order
+    std::chrono::microseconds combiningDuration{};
+    // Reader waiting for processing of blocks already read,
+    // it grows when operation is CPU bound
+    std::chrono::microseconds queueStallDuration{};
+
+    uint64_t peakMemory = 0;
+
+    // Lines of the previous index that are still valid after full indexing
+    uint64_t keptLines = 0;
+
+    // Lines matched by each quoted pattern of a boolean search
+    std::vector<std::pair<QString, uint64_t>> patternHits;
+
+    void updatePeakMemory();
+
+    // One phase per line
+    QString toString() const;
+
+    // Patterns with their hits in one line, empty if there are none
+    QString patternHitsString() const;
+};
+
+Q_DECLARE_METATYPE( OperationStats )
+
+#endif
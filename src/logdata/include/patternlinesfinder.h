@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_PATTERNLINESFINDER_H
+#define KLOGG_PATTERNLINESFINDER_H
+
+#include <vector>
+
+#include "atomicflag.h"
+#include "linetypes.h"
+#include "logfiltereddataworker.h"
+#include "regularexpressionpattern.h"
+
+class LogData;
+
+// Finds lines of a file matched by each of several patterns with one pass
+// over the file, e.g. lines of highlighters shown in the overview. Patterns
+// are compiled into a single multi-pattern expression, and lines are read
+// in chunks matched in parallel, each thread with its own matcher.
+class PatternLinesFinder {
+  public:
+    // Lines are looked for in count lines of the file starting at first
+    PatternLinesFinder( const LogData* logData, LineNumber first, LinesCount count );
+
+    // Returns lines matched by each pattern in the order of patterns,
+    // nothing if patterns can't be compiled. Lines found before
+    // interruption are returned if it is requested.
+    std::vector<SearchResultArray> find( const std::vector<RegularExpressionPattern>& patterns,
+                                         const AtomicFlag& interruptRequested ) const;
+
+  private:
+    const LogData* logData_;
+    LineNumber first_;
+    LinesCount count_;
+};
+
+#endif
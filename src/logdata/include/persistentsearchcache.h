@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_PERSISTENTSEARCHCACHE_H
+#define KLOGG_PERSISTENTSEARCHCACHE_H
+
+#include <vector>
+
+#include <QByteArray>
+#include <QDataStream>
+#include <QString>
+
+#include "linetypes.h"
+#include "logdataworker.h"
+#include "logfiltereddataworker.h"
+#include "regularexpressionpattern.h"
+
+// On-disk copy of search results cache of a file.
+// Results are stored in cache directory together with header and tail hashes
+// of the indexed part of the file and are loaded back only if these hashes
+// still match. Matching lines are saved in portable Roaring format.
+class PersistentSearchCache {
+  public:
+    struct Entry {
+        RegularExpressionPattern pattern;
+        LineNumber startLine;
+        LineNumber endLine;
+
+        SearchResultArray matchingLines;
+        LineLength maxLength;
+
+        // Milliseconds since epoch
+        qint64 lastUsed = 0;
+    };
+
+    explicit PersistentSearchCache( const QString& fileName );
+
+    // Returns empty list if there are no results for the file
+    // or the file has changed since they were saved
+    std::vector<Entry> load() const;
+
+    // Most recently used entries that fit into the configured size are saved,
+    // then least recently used cache files are removed to fit all of them into it
+    void save( const IndexedHash& hash, std::vector<Entry> entries ) const;
+
+    // Entry in the format of search cache, also used by analysis bundles.
+    // Lines of the entry are serialized by the caller, so their size can be checked.
+    static QByteArray serializeLines( const SearchResultArray& lines );
+    static void saveEntry( QDataStream& stream, const Entry& entry, const QByteArray& lines );
+    // Returns false if the entry can't be read or its lines are damaged
+    static bool loadEntry( QDataStream& stream, Entry& entry );
+
+  private:
+    QString fileName_;
+    QString cachePath_;
+};
+
+#endif
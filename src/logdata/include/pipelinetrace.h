@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_PIPELINETRACE_H
+#define KLOGG_PIPELINETRACE_H
+
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <QString>
+
+#include "synchronization.h"
+
+// Events of indexing or search pipeline saved as a Chrome trace
+// (trace_event JSON, can be opened in chrome://tracing or Perfetto).
+// Only the last events are kept in a ring buffer to bound memory
+// used by long operations. Nothing is recorded unless pipeline
+// tracing is enabled in configuration.
+class PipelineTrace {
+  public:
+    using Clock = std::chrono::high_resolution_clock;
+
+    explicit PipelineTrace( const QString& name );
+
+    // Saves the trace into temporary directory
+    ~PipelineTrace();
+
+    PipelineTrace( const PipelineTrace& ) = delete;
+    PipelineTrace& operator=( const PipelineTrace& ) = delete;
+
+    bool isEnabled() const
+    {
+        return isEnabled_;
+    }
+
+    // Work done by the calling thread
+    void addSpan( const char* name, Clock::time_point start, Clock::time_point end );
+
+    // Sampled value, like number of blocks waiting in a queue
+    void addCounter( const char* name, int64_t value );
+
+  private:
+    struct Event {
+        const char* name;
+        char phase;
+        uint32_t threadId;
+        int64_t timestampUs;
+        int64_t durationUs;
+        int64_t value;
+    };
+
+    void addEvent( const char* name, char phase, Clock::time_point time, int64_t durationUs,
+                   int64_t value );
+
+    void save() const;
+
+    bool isEnabled_;
+    QString name_;
+    Clock::time_point start_;
+
+    Mutex mutex_;
+    std::vector<Event> events_;
+    size_t nextEvent_ = 0;
+    std::unordered_map<std::thread::id, uint32_t> threadIds_;
+};
+
+#endif
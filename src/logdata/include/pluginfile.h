@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_PLUGINFILE_H
+#define KLOGG_PLUGINFILE_H
+
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include <QFile>
+#include <QIODevice>
+
+#include "kloggformatplugin.h"
+#include "synchronization.h"
+
+// Read-only random access device for files in formats decoded by plugins,
+// see kloggformatplugin.h. Offsets are positions in decoded text. Raw data
+// is passed to the plugin in big batches and decoded text of a whole batch
+// is kept, so lines are read from it without calling the plugin again.
+// While the file is read checkpoints with offsets of raw and decoded data
+// are recorded every few megabytes of text, seeking restarts decoding from
+// the nearest one. Checkpoints are shared between all devices opened for
+// the same version of the file.
+class PluginFile : public QIODevice {
+    Q_OBJECT
+
+  public:
+    PluginFile( const QString& fileName, const klogg_format_plugin* plugin,
+                QObject* parent = nullptr );
+    ~PluginFile() override;
+
+    // Returns the plugin decoding the file, nullptr if it is read as is.
+    // Plugins are loaded from the directory set in configuration
+    // when this is called for the first time.
+    static const klogg_format_plugin* findPlugin( const QString& fileName );
+
+    // Adds plugin linked into the application, returns false if its
+    // version of interface is not supported
+    static bool addPlugin( const klogg_format_plugin* plugin );
+
+    bool open( OpenMode mode ) override;
+    void close() override;
+
+    bool isSequential() const override
+    {
+        return false;
+    }
+
+    // Size of decoded data, until the whole file has been
+    // decoded it is not less than the part known so far
+    qint64 size() const override;
+    bool atEnd() const override;
+
+    QString fileName() const
+    {
+        return fileName_;
+    }
+
+  protected:
+    qint64 readData( char* data, qint64 maxSize ) override;
+    qint64 writeData( const char* data, qint64 maxSize ) override;
+
+  private:
+    struct Checkpoint {
+        qint64 decodedOffset = 0;
+        qint64 rawOffset = 0;
+    };
+
+    struct Index {
+        mutable SharedMutex mutex;
+        std::vector<Checkpoint> checkpoints;
+        std::optional<qint64> size;
+    };
+
+    static std::shared_ptr<Index> sharedIndex( const QString& fileName );
+
+    void restartAt( const Checkpoint& checkpoint );
+    bool seekBatch( qint64 offset );
+
+    // Decodes the batch following the current one, returns false at the end of data
+    bool decodeNextBatch();
+    bool fillInput();
+    void addCheckpoint();
+    void finishDecoding();
+
+  private:
+    QString fileName_;
+    const klogg_format_plugin* plugin_;
+    klogg_format_decoder* decoder_ = nullptr;
+
+    QFile raw_;
+    std::shared_ptr<Index> index_;
+
+    // Raw data not consumed by the plugin yet starts at rawOffset_ in the file
+    std::vector<unsigned char> input_;
+    size_t inputBegin_ = 0;
+    size_t inputEnd_ = 0;
+    qint64 rawOffset_ = 0;
+    bool isRawFinished_ = false;
+
+    std::vector<char> batch_;
+    size_t batchSize_ = 0;
+    qint64 batchOffset_ = 0;
+    bool isDecodingFinished_ = false;
+};
+
+#endif
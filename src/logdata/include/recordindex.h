@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef KLOGG_RECORDINDEX_H
+#define KLOGG_RECORDINDEX_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <QRegularExpression>
+
+#include <roaring64map.hh>
+
+#include "linetypes.h"
+
+class QDataStream;
+
+// First lines of records of indexed file, records are log entries that take
+// several lines, like stack traces. A record starts at a line matching the
+// start pattern and continues until the next such line, lines before the
+// first matching one are a record too. Patterns like ^text are tested as
+// a prefix of line bytes, other ones are matched as regular expressions.
+class RecordIndex {
+  public:
+    // Disabled index, nothing is added to it
+    RecordIndex() = default;
+    explicit RecordIndex( const std::string& startPattern );
+
+    bool isEnabled() const
+    {
+        return isEnabled_;
+    }
+
+    const std::string& startPattern() const
+    {
+        return startPattern_;
+    }
+
+    // Number of lines added so far
+    LinesCount size() const;
+
+    // Adds lines following the lines added before,
+    // lines with unknown text don't start records
+    void append( const std::vector<std::string_view>& lines );
+
+    // Drops lines past count, they are added again
+    void truncate( LinesCount count );
+
+    // First line of the record with the line
+    LineNumber recordStart( LineNumber line ) const;
+
+    // All lines of records that have any of the lines, the last record
+    // continues to the last added line. Lines that are not added are
+    // kept as they are.
+    roaring::Roaring64Map expand( const roaring::Roaring64Map& lines ) const;
+
+    size_t allocatedSize() const;
+
+    void save( QDataStream& stream ) const;
+    // Index saved with other start pattern is not loaded
+    bool load( QDataStream& stream );
+
+  private:
+    bool isRecordStart( std::string_view line ) const;
+
+  private:
+    bool isEnabled_ = false;
+    std::string startPattern_;
+    std::string startPrefix_;
+    bool isPrefixPattern_ = false;
+    QRegularExpression startRegexp_;
+
+    roaring::Roaring64Map starts_;
+    uint64_t size_ = 0;
+};
+
+#endif // KLOGG_RECORDINDEX_H
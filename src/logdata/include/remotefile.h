@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef KLOGG_REMOTEFILE_H
+#define KLOGG_REMOTEFILE_H
+
+#include <map>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include <QFile>
+#include <QIODevice>
+#include <QUrl>
+
+#include "synchronization.h"
+
+// Read-only random access device for a file served over HTTP(S) by a server
+// that supports range requests, like object storages do. Remote file is
+// attached to a local cache file of the same size and the rest of klogg
+// opens that one. Devices of the cache file fetch missing blocks with
+// parallel range requests, fetched blocks are read from the cache, so
+// the file is downloaded at most once while it is indexed, scrolled
+// and searched.
+class RemoteFile : public QIODevice {
+    Q_OBJECT
+
+  public:
+    static constexpr qint64 BlockSize = 1024 * 1024;
+
+    // Blocks fetched together when a block is missing
+    static constexpr qint64 ReadAheadBlocks = 8;
+
+    // Returns size of the remote file if its server supports range requests
+    static std::optional<qint64> remoteSize( const QUrl& url, QString& error );
+
+    // Creates the cache file and makes its devices read the remote file
+    static bool attach( const QUrl& url, qint64 size, const QString& cacheFileName );
+
+    // Returns true if file is a cache of an attached remote file
+    static bool isRemoteFile( const QString& fileName );
+
+    explicit RemoteFile( const QString& fileName, QObject* parent = nullptr );
+    ~RemoteFile() override;
+
+    bool open( OpenMode mode ) override;
+    void close() override;
+
+    bool isSequential() const override
+    {
+        return false;
+    }
+
+    qint64 size() const override;
+
+  protected:
+    qint64 readData( char* data, qint64 maxSize ) override;
+    qint64 writeData( const char* data, qint64 maxSize ) override;
+
+  private:
+    struct Source {
+        QUrl url;
+        qint64 size = 0;
+
+        mutable SharedMutex mutex;
+        std::vector<bool> fetchedBlocks;
+    };
+
+    static std::shared_ptr<Source> findSource( const QString& fileName );
+
+    // Sources of attached files by absolute paths of their cache files
+    static SharedMutex sourcesMutex_;
+    static std::map<QString, std::shared_ptr<Source>> sources_;
+
+    // Fetches missing blocks in [firstBlock, endBlock) to the cache
+    bool fetchBlocks( qint64 firstBlock, qint64 endBlock );
+
+  private:
+    QString fileName_;
+    QFile cache_;
+    std::shared_ptr<Source> source_;
+};
+
+#endif // KLOGG_REMOTEFILE_H
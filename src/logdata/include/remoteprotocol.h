@@ -0,0 +1,221 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_REMOTEPROTOCOL_H
+#define KLOGG_REMOTEPROTOCOL_H
+
+#include <optional>
+#include <vector>
+
+#include <QByteArray>
+#include <QString>
+
+#include "linetypes.h"
+#include "logfiltereddataworker.h"
+#include "regularexpressionpattern.h"
+
+// Messages exchanged by klogg and klogg_agent, that indexes and searches
+// files on the host they are stored on. Only lines that are shown and
+// bitmaps of matching lines are sent over the connection.
+// Each message is prefixed with its size and type, its fields are
+// written by QDataStream. Lines are sent as compressed UTF-8 text.
+namespace remote {
+
+constexpr quint32 ProtocolMagic = 0x4b4c4741;
+constexpr quint32 ProtocolVersion = 1;
+constexpr quint16 DefaultPort = 7340;
+
+// Bigger messages are treated as a broken connection
+constexpr quint32 MaxMessageSize = 256 * 1024 * 1024;
+
+enum class MessageType : quint8 {
+    // Sent by klogg
+    Open = 1,
+    GetLines = 2,
+    Search = 3,
+    InterruptSearch = 4,
+    SetEncoding = 5,
+    GetMatchedLines = 6,
+
+    // Sent by agent
+    FileInfo = 64,
+    Lines = 65,
+    SearchProgress = 66,
+    SearchResults = 67,
+    Error = 68,
+    MatchedLines = 69,
+};
+
+struct Message {
+    MessageType type;
+    QByteArray body;
+};
+
+// First message of a connection, agent starts indexing the file
+struct OpenRequest {
+    static constexpr auto Type = MessageType::Open;
+
+    quint32 magic = ProtocolMagic;
+    quint32 version = ProtocolVersion;
+    QString fileName;
+};
+
+// Sent while the file is indexed and each time lines are added to it.
+// Generation changes when the file is truncated or indexed again,
+// lines received before that are not valid anymore.
+struct FileInfo {
+    static constexpr auto Type = MessageType::FileInfo;
+
+    quint32 generation = 0;
+    quint64 nbLines = 0;
+    qint64 fileSize = 0;
+    qint32 maxLength = 0;
+    qint32 progress = 0;
+    QByteArray encoding;
+};
+
+struct LinesRequest {
+    static constexpr auto Type = MessageType::GetLines;
+
+    quint64 firstLine = 0;
+    quint64 count = 0;
+};
+
+struct LinesReply {
+    static constexpr auto Type = MessageType::Lines;
+
+    quint32 generation = 0;
+    quint64 firstLine = 0;
+    std::vector<QString> lines;
+};
+
+// Search of all lines, it is updated by agent when lines are added
+struct SearchRequest {
+    static constexpr auto Type = MessageType::Search;
+
+    quint32 searchId = 0;
+    RegularExpressionPattern pattern;
+};
+
+struct InterruptRequest {
+    static constexpr auto Type = MessageType::InterruptSearch;
+
+    quint32 searchId = 0;
+};
+
+// Lines are decoded by agent in this encoding, empty for detected one
+struct EncodingRequest {
+    static constexpr auto Type = MessageType::SetEncoding;
+
+    QByteArray encoding;
+};
+
+struct SearchProgress {
+    static constexpr auto Type = MessageType::SearchProgress;
+
+    quint32 searchId = 0;
+    quint64 nbMatches = 0;
+    qint32 progress = 0;
+};
+
+// All matching lines, sent when the search or its update is finished
+struct SearchResults {
+    static constexpr auto Type = MessageType::SearchResults;
+
+    quint32 searchId = 0;
+    SearchResultArray matches;
+};
+
+// Matching lines of the search by their index among matches
+struct MatchedLinesRequest {
+    static constexpr auto Type = MessageType::GetMatchedLines;
+
+    quint32 searchId = 0;
+    quint64 firstIndex = 0;
+    quint64 count = 0;
+};
+
+struct MatchedLinesReply {
+    static constexpr auto Type = MessageType::MatchedLines;
+
+    quint32 searchId = 0;
+    quint64 firstIndex = 0;
+    std::vector<QString> lines;
+};
+
+struct ErrorReply {
+    static constexpr auto Type = MessageType::Error;
+
+    QString message;
+};
+
+QByteArray encodeBody( const OpenRequest& message );
+QByteArray encodeBody( const FileInfo& message );
+QByteArray encodeBody( const LinesRequest& message );
+QByteArray encodeBody( const LinesReply& message );
+QByteArray encodeBody( const SearchRequest& message );
+QByteArray encodeBody( const InterruptRequest& message );
+QByteArray encodeBody( const EncodingRequest& message );
+QByteArray encodeBody( const SearchProgress& message );
+QByteArray encodeBody( const SearchResults& message );
+QByteArray encodeBody( const MatchedLinesRequest& message );
+QByteArray encodeBody( const MatchedLinesReply& message );
+QByteArray encodeBody( const ErrorReply& message );
+
+// Return false if body is truncated or malformed
+bool decodeBody( const QByteArray& body, OpenRequest& message );
+bool decodeBody( const QByteArray& body, FileInfo& message );
+bool decodeBody( const QByteArray& body, LinesRequest& message );
+bool decodeBody( const QByteArray& body, LinesReply& message );
+bool decodeBody( const QByteArray& body, SearchRequest& message );
+bool decodeBody( const QByteArray& body, InterruptRequest& message );
+bool decodeBody( const QByteArray& body, EncodingRequest& message );
+bool decodeBody( const QByteArray& body, SearchProgress& message );
+bool decodeBody( const QByteArray& body, SearchResults& message );
+bool decodeBody( const QByteArray& body, MatchedLinesRequest& message );
+bool decodeBody( const QByteArray& body, MatchedLinesReply& message );
+bool decodeBody( const QByteArray& body, ErrorReply& message );
+
+// Size and type prefixed message ready to be written to connection
+QByteArray frame( MessageType type, const QByteArray& body );
+
+template <typename MessageT>
+QByteArray encode( const MessageT& message )
+{
+    return frame( MessageT::Type, encodeBody( message ) );
+}
+
+template <typename MessageT>
+std::optional<MessageT> decode( const Message& message )
+{
+    MessageT decoded;
+    if ( message.type != MessageT::Type || !decodeBody( message.body, decoded ) ) {
+        return {};
+    }
+    return decoded;
+}
+
+// Removes the first complete message from the start of received data.
+// Returns empty if the message is not fully received yet. Sets isBroken
+// if data can not be a message, the connection should be closed then.
+std::optional<Message> takeMessage( QByteArray& received, bool& isBroken );
+
+} // namespace remote
+
+#endif
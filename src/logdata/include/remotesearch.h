@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_REMOTESEARCH_H
+#define KLOGG_REMOTESEARCH_H
+
+#include <QObject>
+#include <QTcpSocket>
+
+#include "linetypes.h"
+#include "remoteprotocol.h"
+
+class QTextCodec;
+
+// Search of a file indexed by klogg_agent on the host it is stored on,
+// see remoteprotocol.h. Only bitmaps of matching lines and text of the
+// matching lines asked for are received. Search is updated by agent
+// when lines are added to the file.
+// This class must be used from the thread it was created in.
+class RemoteSearch : public QObject {
+    Q_OBJECT
+
+  public:
+    RemoteSearch();
+
+    // Connects to agent and starts indexing of the file on its host
+    void attachFile( const QString& host, quint16 port, const QString& fileName );
+
+    QString getFileName() const;
+    qint64 getFileSize() const;
+    // Lines indexed by agent so far
+    LinesCount getNbLines() const;
+    bool isConnected() const;
+
+    // Lines are decoded by agent in this encoding, detected one by default
+    void setDisplayEncoding( const char* encoding );
+    QTextCodec* getDisplayEncoding() const;
+
+    // Starts search of all lines by agent, it is updated when lines are added
+    void runSearch( const RegularExpressionPattern& pattern );
+    void interruptSearch();
+    // Matching lines of the last finished search or its update
+    const SearchResultArray& getMatchingLines() const;
+    // Asks for text of count matching lines starting at index among matches,
+    // see matchedLinesReceived
+    void fetchMatchedLines( quint64 firstIndex, quint64 count );
+
+  Q_SIGNALS:
+    void searchProgressed( LinesCount nbMatches, int progress );
+    void searchFinished();
+    void matchedLinesReceived( quint64 firstIndex, const std::vector<QString>& lines );
+    void errorReceived( const QString& message );
+
+  private:
+    void send( const QByteArray& message );
+    void readMessages();
+    void handleMessage( const remote::Message& message );
+
+  private:
+    QString fileName_;
+    QTcpSocket socket_;
+    QByteArray received_;
+
+    remote::FileInfo fileInfo_;
+    QTextCodec* displayEncoding_ = nullptr;
+
+    quint32 searchId_ = 0;
+    SearchResultArray matchingLines_;
+};
+
+#endif
@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef KLOGG_SEARCHPLANNER_H
+#define KLOGG_SEARCHPLANNER_H
+
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#include <roaring.hh>
+#include <roaring64map.hh>
+
+#include "linetypes.h"
+
+// Chooses lines a search has to read. Terms of the search, like quoted patterns
+// of a boolean combination, are looked up without reading the file first. A term
+// can have lines it may match, like lines of a token from the token index, or
+// lines it matches exactly, like results of an earlier search for it. Other lines
+// do not match the term. Lines where the expression of terms is true whatever
+// unknown terms are match without reading them, lines where it is false for all
+// of them are skipped, and only the rest is matched by scanning.
+class SearchPlanner {
+  public:
+    // Gets a byte per term, not zero if the term matches the line
+    using Expression = std::function<bool( std::string_view matchedTerms )>;
+
+    // Expression is evaluated for every combination of terms
+    static constexpr size_t MaxTerms = 16;
+    // Lines are split by each looked up term, only so many are used
+    static constexpr size_t MaxLookedUpTerms = 8;
+
+    struct Plan {
+        // Lines matching the expression, they don't have to be read
+        roaring::Roaring64Map matchingLines;
+        // Lines that have to be matched
+        roaring::Roaring64Map scannedLines;
+    };
+
+    // Plans search of lines in [first, last)
+    SearchPlanner( size_t termsCount, const Expression& expression, LineNumber first,
+                   LineNumber last );
+
+    // Term can match only these lines, they still have to be matched
+    void setCandidateLines( size_t term, roaring::Roaring64Map lines );
+    // Term matches exactly these lines
+    void setMatchingLines( size_t term, roaring::Roaring64Map lines );
+
+    // Empty if all lines have to be scanned, like when no term was looked up or
+    // when the expression is true for lines without any term
+    std::optional<Plan> plan() const;
+
+  private:
+    struct TermLines {
+        size_t term = 0;
+        roaring::Roaring64Map lines;
+        bool isExact = false;
+    };
+
+    struct LinesOutcome {
+        roaring::Roaring64Map mayMatch;
+        roaring::Roaring64Map mustMatch;
+    };
+
+    void addTermLines( size_t term, roaring::Roaring64Map lines, bool isExact );
+
+    LinesOutcome planLines( const std::vector<const TermLines*>& terms, size_t nextTerm,
+                            uint32_t knownTerms, uint32_t matchedTerms,
+                            const roaring::Roaring64Map& lines ) const;
+
+  private:
+    size_t termsCount_ = 0;
+    LineNumber first_;
+    LineNumber last_;
+
+    // Bit N is set if expression is true when terms from bits of N match
+    std::vector<bool> truthTable_;
+
+    std::vector<TermLines> lookedUpTerms_;
+};
+
+#endif // KLOGG_SEARCHPLANNER_H
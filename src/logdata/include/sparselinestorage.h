@@ -0,0 +1,163 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_SPARSELINESTORAGE_H
+#define KLOGG_SPARSELINESTORAGE_H
+
+#include <functional>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include <QByteArray>
+
+#include "encodingdetector.h"
+#include "linetypes.h"
+#include "synchronization.h"
+
+class QDataStream;
+
+// This class is a storage backend for LinePositionArray that keeps
+// only every CheckpointInterval-th end of line. Positions between checkpoints
+// are found again by scanning the file when requested, a few recently
+// used blocks of positions are kept in memory.
+// Memory usage is about CheckpointInterval times lower than
+// CompressedLinePositionStorage at the cost of file reads on random access.
+class SparseLinePositionStorage {
+  public:
+    // Reads size bytes of the indexed file starting at offset
+    using DataReader = std::function<QByteArray( LineOffset::UnderlyingType offset,
+                                                 LineOffset::UnderlyingType size )>;
+
+    using Positions = std::vector<LineOffset>;
+
+    // Keeps the last used block to avoid locking on sequential reads
+    struct Cache {
+        size_t block = std::numeric_limits<size_t>::max();
+        std::shared_ptr<const Positions> positions;
+    };
+
+    // Blocks that are not decoded yet, they are read and decoded without
+    // access to the storage, so file is not read while the index is locked
+    struct MissingBlocks {
+        struct Block {
+            size_t index;
+            LineOffset start;
+            LineOffset end;
+            std::shared_ptr<const Positions> positions;
+        };
+
+        DataReader reader;
+        EncodingParameters encodingParams;
+        std::vector<Block> blocks;
+
+        void decode();
+    };
+
+    static constexpr size_t CheckpointInterval = 1024;
+
+    SparseLinePositionStorage() = default;
+    explicit SparseLinePositionStorage( DataReader reader );
+
+    SparseLinePositionStorage( const SparseLinePositionStorage& ) = delete;
+    SparseLinePositionStorage& operator=( const SparseLinePositionStorage& ) = delete;
+
+    SparseLinePositionStorage( SparseLinePositionStorage&& orig ) noexcept;
+    SparseLinePositionStorage& operator=( SparseLinePositionStorage&& orig ) noexcept;
+
+    // Reader of the data is replaced when the file is opened again for indexing
+    void setReader( DataReader reader );
+
+    // Line feeds have to be recognized the same way as during indexing
+    void setEncodingParameters( const EncodingParameters& encodingParams );
+
+    // Append the passed end-of-line to the storage
+    void append( LineOffset pos );
+    void push_back( LineOffset pos )
+    {
+        append( pos );
+    }
+
+    // Size of the array
+    LinesCount size() const
+    {
+        return LinesCount( static_cast<LinesCount::UnderlyingType>(
+            checkpoints_.size() * CheckpointInterval + tail_.size() ) );
+    }
+
+    size_t allocatedSize() const;
+    size_t residentSize() const
+    {
+        return allocatedSize();
+    }
+
+    // Element at index
+    LineOffset at( size_t i, Cache* lastPosition = nullptr ) const
+    {
+        return at( LineNumber( i ), lastPosition );
+    }
+    LineOffset at( LineNumber i, Cache* lastPosition = nullptr ) const;
+
+    // Append count elements starting at first to positions
+    void range( LineNumber first, LinesCount count, std::vector<qint64>& positions ) const;
+
+    // Blocks of count lines starting at first that have to be decoded
+    MissingBlocks missingBlocks( LineNumber first, LinesCount count ) const;
+
+    // Keeps blocks decoded by MissingBlocks::decode that still match the checkpoints
+    void addDecodedBlocks( const MissingBlocks& missing ) const;
+
+    // Add one list to the other
+    void append_list( const std::vector<LineOffset>& positions );
+
+    // Pop the last element of the storage
+    void pop_back();
+
+    void save( QDataStream& stream ) const;
+    bool load( QDataStream& stream );
+
+  private:
+    std::shared_ptr<const Positions> getBlock( size_t block ) const;
+    std::shared_ptr<const Positions> decodeBlock( size_t block ) const;
+
+    LineOffset blockStart( size_t block ) const
+    {
+        return block == 0 ? 0_offset : checkpoints_[ block - 1 ];
+    }
+
+    void addRecentBlock( size_t block, std::shared_ptr<const Positions> positions ) const;
+    void clearRecentBlocks();
+
+  private:
+    DataReader reader_;
+    EncodingParameters encodingParams_;
+
+    // End of every CheckpointInterval-th line
+    Positions checkpoints_;
+    // Lines after the last checkpoint
+    Positions tail_;
+
+    static constexpr size_t RecentBlocksCount = 16;
+
+    mutable Mutex recentBlocksMutex_;
+    // Most recently used block is at the back
+    mutable std::vector<std::pair<size_t, std::shared_ptr<const Positions>>> recentBlocks_;
+};
+
+#endif
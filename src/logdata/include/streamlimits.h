@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_STREAMLIMITS_H
+#define KLOGG_STREAMLIMITS_H
+
+#include <exception>
+#include <optional>
+
+#include <QByteArray>
+#include <QDataStream>
+#include <QIODevice>
+
+// Returns true if the stream still has data for count items of at least
+// bytesPerItem bytes each. Counts read from index and search caches are
+// checked before anything is allocated for them, so a truncated or damaged
+// file fails to load instead of allocating whatever size it claims.
+// Caches are read from files and buffers, data left in sequential
+// devices can't be known and they are never trusted.
+inline bool isCountInStream( const QDataStream& stream, quint64 count, quint64 bytesPerItem )
+{
+    const auto* device = stream.device();
+    if ( device == nullptr || device->isSequential() ) {
+        return false;
+    }
+
+    const auto available = device->size() - device->pos();
+    if ( available < 0 ) {
+        return false;
+    }
+
+    return bytesPerItem == 0 || count <= static_cast<quint64>( available ) / bytesPerItem;
+}
+
+// Returns bitmap serialized in portable format, or nothing if the data is
+// truncated or damaged. Bitmaps are read from caches and network the same
+// way, so they are never read past the end of data they came in.
+template <typename Bitmap>
+std::optional<Bitmap> readBitmap( const QByteArray& data )
+{
+    try {
+        return Bitmap::readSafe( data.constData(), static_cast<size_t>( data.size() ) );
+    } catch ( const std::exception& ) {
+        return {};
+    }
+}
+
+#endif
@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_TABEXPANSIONINDEX_H
+#define KLOGG_TABEXPANSIONINDEX_H
+
+#include <utility>
+#include <vector>
+
+#include <QString>
+
+#include "tabpositions.h"
+
+// Columns of a line with tabs expanded, remembered for every tab.
+// Parts of a long line can be expanded without going through
+// the text before them.
+class TabExpansionIndex {
+  public:
+    // Lines shorter than this are faster to expand as a whole
+    static constexpr int LongLineLength = 4096;
+
+    explicit TabExpansionIndex( const QString& line );
+
+    // Returns the column of a character when tabs are expanded,
+    // position can be the length of the line
+    int expandedColumn( int position ) const;
+
+    int expandedLength() const
+    {
+        return expandedLength_;
+    }
+
+    // Returns the whole line with tabs expanded
+    QString expandedLine() const;
+
+    // Returns nbColumns of the line with tabs expanded,
+    // starting at firstColumn
+    QString expandedWindow( int firstColumn, int nbColumns ) const;
+
+  private:
+    // Position and column of the character covering the column,
+    // the length of the line past its end
+    std::pair<int, int> characterAt( int column ) const;
+
+  private:
+    QString line_;
+    TabPositions tabPositions_;
+
+    // Expanded column of each tab and of the character after it
+    std::vector<int> tabColumns_;
+    std::vector<int> tabEndColumns_;
+    int expandedLength_ = 0;
+};
+
+#endif
@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_TABPOSITIONS_H
+#define KLOGG_TABPOSITIONS_H
+
+#include <vector>
+
+#include <QString>
+#include <QStringView>
+
+// Positions of tabs and null characters of a line. Line is scanned
+// a vector of characters at a time, so lines without them cost
+// one comparison per vector.
+class TabPositions {
+  public:
+    TabPositions() = default;
+    explicit TabPositions( QStringView line );
+
+    bool isEmpty() const
+    {
+        return tabs_.empty() && !hasNulls_;
+    }
+
+    const std::vector<int>& tabs() const
+    {
+        return tabs_;
+    }
+
+    bool hasNulls() const
+    {
+        return hasNulls_;
+    }
+
+    // Length of the line when tabs are expanded, line starts
+    // at initialPosition column
+    int expandedLength( int lineLength, int initialPosition = 0 ) const;
+
+    // Expands tabs to spaces and replaces null characters by spaces,
+    // line is returned as is if it has neither of them
+    QString expand( QString&& line, int initialPosition = 0 ) const;
+
+  private:
+    std::vector<int> tabs_;
+    bool hasNulls_ = false;
+};
+
+// Expands tabs of a line that starts at initialPosition column
+QString untabify( QString&& line, int initialPosition = 0 );
+
+#endif
@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_TAILWATCHER_H
+#define KLOGG_TAILWATCHER_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "atomicflag.h"
+#include "linetypes.h"
+#include "regularexpressionpattern.h"
+
+class LogData;
+class MultiRegularExpression;
+class MultiPatternMatcher;
+
+// Counts matches of watched patterns in lines appended to a followed file.
+// Patterns are compiled into a single multi-pattern expression once and its
+// matcher is kept between calls, so each call only reads and matches the
+// lines added since the previous one. Calls must not run concurrently.
+class TailWatcher {
+  public:
+    TailWatcher( const LogData* logData, std::vector<RegularExpressionPattern> patterns );
+    ~TailWatcher();
+
+    size_t size() const;
+
+    // Lines before count are not matched, like lines of the file when watching starts
+    void skipLines( LinesCount count );
+
+    // Matches lines from the last watched one up to count lines of the file
+    // and returns the number of new matching lines of each pattern, nothing
+    // if patterns can't be compiled. If the file has fewer lines than were
+    // watched, it was truncated and lines added again are matched.
+    // Lines left on interruption are matched by the next call.
+    std::vector<uint64_t> watch( LinesCount count, const AtomicFlag& interruptRequested );
+
+  private:
+    const LogData* logData_;
+    std::vector<RegularExpressionPattern> patterns_;
+
+    // Compiled by the first call to watch, so it doesn't block the caller
+    std::unique_ptr<MultiRegularExpression> expression_;
+    std::unique_ptr<MultiPatternMatcher> matcher_;
+
+    LinesCount watchedLines_;
+};
+
+#endif
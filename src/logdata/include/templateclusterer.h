@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_TEMPLATECLUSTERER_H
+#define KLOGG_TEMPLATECLUSTERER_H
+
+#include <atomic>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <QString>
+
+#include "atomicflag.h"
+#include "linetypes.h"
+#include "logfiltereddataworker.h"
+
+class LogData;
+
+// Groups lines into message templates the way Drain does. Lines are
+// split into tokens by whitespace, tokens with digits are replaced by
+// wildcards. Lines with the same number of tokens and the same first
+// token are compared with templates of their group, a line joins the most
+// similar template if at least SimilarityThreshold of tokens are equal,
+// and tokens that differ become wildcards of the template.
+class TemplateMiner {
+  public:
+    using TemplateId = uint32_t;
+
+    static constexpr std::string_view Wildcard = "<*>";
+    static constexpr double SimilarityThreshold = 0.5;
+    static constexpr size_t MaxTokens = 128;
+
+    // Returns id of the template of the line, ids do not change
+    // when templates get more wildcards
+    TemplateId add( std::string_view line );
+
+    // Adds a template of another miner, its wildcards match any token
+    TemplateId addTemplate( const std::vector<std::string>& tokens );
+
+    size_t size() const
+    {
+        return templates_.size();
+    }
+
+    const std::vector<std::string>& tokens( TemplateId id ) const
+    {
+        return templates_[ id ];
+    }
+
+    std::string text( TemplateId id ) const;
+
+  private:
+    TemplateId addTokens( const std::vector<std::string_view>& tokens, bool isTemplate );
+
+  private:
+    std::vector<std::vector<std::string>> templates_;
+    // Templates with the same number of tokens and first token
+    std::unordered_map<std::string, std::vector<TemplateId>> groups_;
+    std::vector<std::string_view> lineTokens_;
+};
+
+// Template with lines of the file that have it
+struct LogTemplate {
+    QString text;
+    SearchResultArray lines;
+};
+
+// Finds message templates of lines of a file. Lines are read in chunks
+// processed in parallel, each thread builds its own templates and they
+// are merged into templates of the whole file at the end.
+class TemplateClusterer {
+  public:
+    // Clusters count lines of the file starting at first
+    TemplateClusterer( const LogData* logData, LineNumber first, LinesCount count );
+
+    // Clusters the passed set of lines, set is a copy,
+    // so it can be changed while lines are clustered
+    TemplateClusterer( const LogData* logData, SearchResultArray lines );
+
+    LinesCount linesCount() const;
+
+    // Returns templates from the one with most lines, lines processed so
+    // far are stored in processedLines. Returns nothing if interrupted.
+    std::vector<LogTemplate> cluster( const AtomicFlag& interruptRequested,
+                                      std::atomic<uint64_t>& processedLines ) const;
+
+  private:
+    const LogData* logData_;
+    std::optional<SearchResultArray> lines_;
+    LineNumber first_;
+    LinesCount count_;
+};
+
+#endif
@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_TIMEORDER_H
+#define KLOGG_TIMEORDER_H
+
+#include <cstdint>
+#include <vector>
+
+#include <QtGlobal>
+
+#include "linetypes.h"
+#include "logfiltereddataworker.h"
+
+class LogData;
+class TimestampParser;
+
+// Lines of a filtered view ordered by timestamps written in them.
+// Timestamps are extracted from chunks of lines in parallel and sorted
+// by a parallel radix sort, so building the order costs time proportional
+// to the number of lines, not to the size of the file.
+// Lines without a timestamp, like continuation lines of a message,
+// stay right after the line before them.
+class TimeOrder {
+  public:
+    TimeOrder( const LogData& logData, const SearchResultArray& lines,
+               const TimestampParser& parser );
+
+    LinesCount size() const;
+
+    // Line shown at the index, maxValue for indexes past the end
+    LineNumber line( LineNumber index ) const;
+
+    // Index of the line that has the rank in the set of lines
+    LineNumber index( LineNumber::UnderlyingType rank ) const;
+
+    size_t allocatedSize() const;
+
+    // Positions of timestamps in the order they are sorted in,
+    // equal timestamps keep their positions order
+    static std::vector<uint64_t> sortedRanks( const std::vector<qint64>& timestamps );
+
+  private:
+    std::vector<LineNumber::UnderlyingType> lines_;
+    std::vector<LineNumber::UnderlyingType> indexes_;
+};
+
+#endif
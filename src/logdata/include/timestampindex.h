@@ -0,0 +1,170 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_TIMESTAMPINDEX_H
+#define KLOGG_TIMESTAMPINDEX_H
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <QDateTime>
+#include <QString>
+
+#include "linetypes.h"
+
+class QDataStream;
+
+// Timestamp of the line starting at offset, in milliseconds
+// since epoch of the time written in the line taken as UTC
+struct TimestampSample {
+    LineOffset::UnderlyingType offset;
+    qint64 timestamp;
+};
+
+// Reads time written at the beginning of lines. Fields of the format
+// must have fixed width, like in "yyyy-MM-dd HH:mm:ss.zzz".
+// Formats made of yyyy, MM, MMM, dd, HH, mm, ss and zzz fields and literals
+// are compiled to a layout of bytes. Line is checked against it and its digits
+// are converted by a few operations on 8 byte words, without branches for
+// each character, other formats are read by QDateTime. Day can be padded
+// with a space, like in syslog. Format starting with '[' is read after
+// the first '[' of the line, like time of Apache access logs.
+class TimestampParser {
+  public:
+    // Setting of the format that is detected from the beginning of file
+    static constexpr const char* AutoFormat = "auto";
+    // 13 digits of milliseconds since epoch
+    static constexpr const char* EpochMillisFormat = "epoch_ms";
+
+    explicit TimestampParser( const QString& format );
+
+    std::optional<qint64> parse( std::string_view line ) const;
+
+    // Timestamp of one of the first lines of block starting at firstLine,
+    // offset of the sample is relative to the block
+    std::optional<TimestampSample> findInBlock( std::string_view block, size_t firstLine ) const;
+
+    // The common format most of the first lines of sample start with,
+    // empty if there is none
+    static QString detectFormat( std::string_view sample );
+
+    static qint64 toTimestamp( const QDateTime& dateTime );
+
+  private:
+    enum class Kind { QtFormat, Layout, EpochMillis };
+
+    static constexpr size_t MaxLayoutLength = 32;
+    static constexpr size_t LayoutWords = MaxLayoutLength / 8;
+
+    // Positions of fields in the layout, -1 if format does not have the field
+    struct Fields {
+        int year = -1;
+        int month = -1;
+        int monthName = -1;
+        int day = -1;
+        int hour = -1;
+        int minute = -1;
+        int second = -1;
+        int millis = -1;
+    };
+
+    bool compileLayout();
+
+    // Fields of the line start that matches the layout
+    std::optional<qint64> parseLayout( const char* bytes ) const;
+    std::optional<qint64> parseEpochMillis( const char* bytes, std::string_view line ) const;
+
+  private:
+    QString format_;
+    size_t length_;
+    Kind kind_ = Kind::QtFormat;
+    bool isBracketed_ = false;
+
+    Fields fields_;
+    // Bytes of literals and masks of literal and digit bytes of the layout
+    // in words of 8 bytes, padded with zeros
+    std::array<uint64_t, LayoutWords> literals_{};
+    std::array<uint64_t, LayoutWords> literalMask_{};
+    std::array<uint64_t, LayoutWords> digitMask_{};
+};
+
+// Timestamps sampled from consecutive blocks of indexed file.
+// Timestamps are expected to grow through the file.
+class TimestampIndex {
+  public:
+    // Bytes of file where the first line with some timestamp starts
+    struct Range {
+        LineOffset::UnderlyingType begin;
+        LineOffset::UnderlyingType end;
+    };
+
+    // Drops all samples, lines will be sampled using the new format.
+    // With TimestampParser::AutoFormat the format is detected later.
+    void reset( const QString& setting );
+
+    // Format lines are sampled with, empty until it is detected
+    const QString& format() const
+    {
+        return format_;
+    }
+
+    const QString& setting() const
+    {
+        return setting_;
+    }
+
+    // Detects the format from the beginning of file if it is not known yet
+    // and no blocks were added
+    void detectFormat( std::string_view sample );
+
+    // Adds block of [beginning, end) bytes of file with optional sample.
+    // Blocks that do not follow the previous one make the index incomplete.
+    void append( LineOffset::UnderlyingType beginning, LineOffset::UnderlyingType end,
+                 std::optional<TimestampSample> sample );
+
+    // Drops samples of lines that start past end bytes of file
+    void truncate( LineOffset::UnderlyingType end );
+
+    // Empty if index does not cover all indexed data
+    std::optional<Range> find( qint64 timestamp ) const;
+
+    // Timestamps of the first and the last sample,
+    // empty if index does not cover all indexed data
+    std::optional<std::pair<qint64, qint64>> timeSpan() const;
+
+    size_t allocatedSize() const;
+
+    // Samples saved with another format are dropped on load
+    void save( QDataStream& stream ) const;
+    bool load( QDataStream& stream );
+
+  private:
+    QString setting_;
+    QString format_;
+    std::vector<TimestampSample> samples_;
+
+    LineOffset::UnderlyingType coveredEnd_{};
+    bool isComplete_ = true;
+};
+
+#endif // KLOGG_TIMESTAMPINDEX_H
@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_TOKENINDEX_H
+#define KLOGG_TOKENINDEX_H
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <roaring.hh>
+#include <roaring64map.hh>
+
+#include "linetypes.h"
+
+class QDataStream;
+
+// Lines of indexed file where each token was found. Tokens are runs of
+// at least MinTokenSize bytes between delimiters, like identifiers, UUIDs
+// or numbers. They are ASCII case folded and hashed, so lines of a token
+// are only candidates that still have to be matched.
+// Line numbers are 32-bit, lines past that are not indexed.
+class TokenIndex {
+  public:
+    static constexpr size_t MinTokenSize = 3;
+    static constexpr std::string_view DefaultDelimiters = " \t\r\"'`,;:=()[]{}<>|/\\";
+
+    // Disabled index, nothing is added to it
+    TokenIndex() = default;
+    explicit TokenIndex( std::string_view delimiters );
+
+    bool isEnabled() const
+    {
+        return isEnabled_;
+    }
+
+    const std::string& delimiters() const
+    {
+        return delimiters_;
+    }
+
+    // Number of lines added so far
+    LinesCount size() const;
+
+    // Adds lines following the lines added before
+    void append( const std::vector<std::string_view>& lines );
+
+    // Drops lines past count, they are added again. Only the last
+    // line is removed from lines of its tokens, dropping more
+    // goes through lines of all tokens.
+    void truncate( LinesCount count );
+
+    // Lines in [first, last) that may contain the text as a whole token,
+    // empty if text is not a single ASCII token
+    std::optional<roaring::Roaring64Map> find( std::string_view text, LineNumber first,
+                                               LineNumber last ) const;
+
+    size_t allocatedSize() const;
+
+    void save( QDataStream& stream ) const;
+    // Index saved with other delimiters is not loaded
+    bool load( QDataStream& stream );
+
+  private:
+    using TokenHash = uint64_t;
+
+    static TokenHash hash( std::string_view token );
+
+    bool isDelimiter( char c ) const
+    {
+        return isDelimiter_[ static_cast<uint8_t>( c ) ];
+    }
+
+  private:
+    bool isEnabled_ = false;
+    std::string delimiters_;
+    std::vector<bool> isDelimiter_;
+
+    std::unordered_map<TokenHash, roaring::Roaring> lines_;
+    uint64_t size_ = 0;
+
+    // Tokens of the last line to remove it
+    std::vector<TokenHash> lastLineTokens_;
+};
+
+#endif // KLOGG_TOKENINDEX_H
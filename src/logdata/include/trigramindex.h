@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_TRIGRAMINDEX_H
+#define KLOGG_TRIGRAMINDEX_H
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include "linetypes.h"
+
+class QDataStream;
+
+// Summary of all byte trigrams found in a block of file data.
+// Trigrams are ASCII case folded and hashed into a bitset
+// (a bloom filter with one hash function), so the filter can only
+// tell that a block does not contain some text.
+class TrigramFilter {
+  public:
+    static constexpr size_t HashBits = 16;
+
+    using Hashes = std::vector<uint16_t>;
+
+    // Adds all trigrams that are fully inside the data
+    void addData( std::string_view data );
+    void addTrigram( uint32_t trigram );
+
+    bool mayContain( uint16_t hash ) const;
+
+    static uint32_t fold( char c );
+    static uint16_t hash( uint32_t trigram );
+
+    // Returns hashes of trigrams of a text to search for literally,
+    // empty if the text can not be checked by a filter.
+    static Hashes textHashes( std::string_view text, bool isCaseSensitive );
+
+    void save( QDataStream& stream ) const;
+    bool load( QDataStream& stream );
+
+  private:
+    std::array<uint64_t, ( size_t{ 1 } << HashBits ) / 64> bits_{};
+};
+
+// Trigram filters of consecutive blocks of indexed file
+class TrigramIndex {
+  public:
+    // Adds filter of block that starts at beginning, trigrams that
+    // cross the boundary with the previous block are added to it.
+    void append( LineOffset::UnderlyingType beginning, std::shared_ptr<TrigramFilter> filter,
+                 std::string_view block );
+
+    // Returns false only if blocks covering [begin, end) bytes
+    // of file can not contain all trigrams
+    bool mayContain( LineOffset::UnderlyingType begin, LineOffset::UnderlyingType end,
+                     const TrigramFilter::Hashes& hashes ) const;
+
+    void clear();
+
+    // Drops blocks that end past end bytes of file
+    void truncate( LineOffset::UnderlyingType end );
+
+    size_t allocatedSize() const;
+
+    void save( QDataStream& stream ) const;
+    bool load( QDataStream& stream );
+
+  private:
+    struct Block {
+        LineOffset::UnderlyingType beginning;
+        LineOffset::UnderlyingType end;
+        std::shared_ptr<const TrigramFilter> filter;
+    };
+
+    std::vector<Block> blocks_;
+
+    // Folded last bytes of the previous block
+    uint32_t tail_{};
+    size_t tailSize_{};
+};
+
+#endif // KLOGG_TRIGRAMINDEX_H
@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_VALUEAGGREGATOR_H
+#define KLOGG_VALUEAGGREGATOR_H
+
+#include <atomic>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include <QRegularExpression>
+#include <QString>
+
+#include "atomicflag.h"
+#include "linechunks.h"
+#include "linetypes.h"
+#include "logfiltereddataworker.h"
+#include "numericsketch.h"
+
+class LogData;
+
+// Number of lines where a value was found, with the first and the last of them
+struct AggregatedValue {
+    QString value;
+    uint64_t count = 0;
+    LineNumber firstLine;
+    LineNumber lastLine;
+};
+
+// Statistics of numeric values, with values of consecutive line intervals
+// of the counted range to see how they change through the file
+struct NumericStatistics {
+    NumericSketch values;
+    std::vector<NumericSketch> intervals;
+};
+
+// Counts values extracted from lines of a file by a regular expression.
+// Value is the first capture group of the expression, or the whole match
+// if it has no groups. Lines are read in chunks matched in parallel, values
+// of each thread are counted in its own table and tables are merged at the end.
+class ValueAggregator {
+  public:
+    // Counts values in count lines of the file starting at first
+    ValueAggregator( const LogData* logData, LineNumber first, LinesCount count );
+
+    // Counts values in the passed set of lines, set is a copy,
+    // so it can be changed while values are counted
+    ValueAggregator( const LogData* logData, SearchResultArray lines );
+
+    LinesCount linesCount() const;
+
+    // Returns values from the most frequent one, lines matched so far
+    // are stored in processedLines. Values found before interruption
+    // are returned if it is requested.
+    std::vector<AggregatedValue> aggregate( const QRegularExpression& regexp,
+                                            const AtomicFlag& interruptRequested,
+                                            std::atomic<uint64_t>& processedLines ) const;
+
+    // Values that are numbers are summarized, others are skipped.
+    // Counted range is split into intervalsCount intervals of equal number
+    // of lines, in the filtered view the range is the whole file.
+    NumericStatistics summarize( const QRegularExpression& regexp, size_t intervalsCount,
+                                 const AtomicFlag& interruptRequested,
+                                 std::atomic<uint64_t>& processedLines ) const;
+
+  private:
+    std::vector<LinesChunk> chunks() const;
+
+  private:
+    const LogData* logData_;
+    std::optional<SearchResultArray> lines_;
+    LineNumber first_;
+    LinesCount count_;
+};
+
+#endif
@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_WORKSCHEDULER_H
+#define KLOGG_WORKSCHEDULER_H
+
+#include <condition_variable>
+#include <map>
+#include <utility>
+
+#include <QString>
+
+#include <tbb/task_arena.h>
+
+#include "atomicflag.h"
+#include "synchronization.h"
+
+// Constraints of arenas running indexing and search, threads are kept on
+// the NUMA node from configuration. Buffers allocated by these threads are
+// first touched there, so they end up in memory of the same node.
+tbb::task_arena::constraints configuredArenaConstraints();
+
+// Process-wide scheduler of indexing and search work of all open files.
+// Files shown to the user are foreground, their flow graphs run in a TBB arena
+// with high priority and their sequential reads are let onto the disk before
+// reads of background files. Background files share the rest fairly.
+class WorkScheduler {
+  public:
+    static WorkScheduler& get();
+
+    WorkScheduler( const WorkScheduler& ) = delete;
+    WorkScheduler& operator=( const WorkScheduler& ) = delete;
+
+    // A file can be shown in several windows, it stays
+    // foreground until all of them stop showing it
+    void setForeground( const QString& fileName, bool isForeground );
+    bool isForeground( const QString& fileName ) const;
+
+    // Runs function on the calling thread inside the arena for priority of the file,
+    // so flow graphs created by the function spawn their tasks there
+    template <typename Function> void execute( const QString& fileName, Function&& function )
+    {
+        auto& arena = isForeground( fileName ) ? foregroundArena_ : backgroundArena_;
+        arena.execute( std::forward<Function>( function ) );
+    }
+
+    // Runs function with background priority even for foreground files,
+    // for work the user has not asked for yet, like searching pinned filters
+    template <typename Function> void executeInBackground( Function&& function )
+    {
+        backgroundArena_.execute( std::forward<Function>( function ) );
+    }
+
+    // Permission to read a file sequentially. At most maxDiskStreamsPerDevice streams
+    // read from the same device at once, waiting foreground streams go first.
+    class DiskStream {
+      public:
+        ~DiskStream();
+
+        DiskStream( const DiskStream& ) = delete;
+        DiskStream& operator=( const DiskStream& ) = delete;
+
+        // Called between blocks, background stream gives its slot
+        // to waiting foreground streams and waits for it again.
+        // Paused stream waits for a slot here.
+        void yield();
+
+        // Gives the slot away while the stream waits for something else
+        void pause();
+
+      private:
+        friend class WorkScheduler;
+
+        DiskStream( WorkScheduler* scheduler, const QString& fileName,
+                    const AtomicFlag& interruptRequested, bool isBackgroundWork );
+
+        bool isForeground() const;
+
+        void acquire();
+        void release();
+
+      private:
+        WorkScheduler* scheduler_;
+        QString fileName_;
+        uint64_t device_;
+        const AtomicFlag& interruptRequested_;
+        bool isBackgroundWork_ = false;
+        bool isAcquired_ = false;
+    };
+
+    // Waits until the stream can read or interrupt is requested.
+    // Stream of background work is background even for foreground files.
+    DiskStream openDiskStream( const QString& fileName, const AtomicFlag& interruptRequested,
+                               bool isBackgroundWork = false );
+
+  private:
+    WorkScheduler();
+
+    struct Device {
+        int activeStreams = 0;
+        int foregroundWaiters = 0;
+    };
+
+  private:
+    mutable SharedMutex foregroundMutex_;
+    std::map<QString, int> foregroundFiles_;
+
+    Mutex streamsMutex_;
+    std::condition_variable_any streamsChanged_;
+    std::map<uint64_t, Device> devices_;
+
+    tbb::task_arena foregroundArena_;
+    tbb::task_arena backgroundArena_;
+};
+
+#endif
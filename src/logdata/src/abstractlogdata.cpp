@@ -68,6 +68,52 @@ std::vector<QString> AbstractLogData::getExpandedLines( LineNumber first_line, L
     return doGetExpandedLines( first_line, number );
 }
 
+// Simple wrapper in order to use a clean Template Method
+std::vector<QString> AbstractLogData::getExpandedLinesWindow( LineNumber first_line,
+                                                              LinesCount number, int first_column,
+                                                              int nb_columns ) const
+{
+    return doGetExpandedLinesWindow( first_line, number, first_column, nb_columns );
+}
+
+// Simple wrapper in order to use a clean Template Method
+void AbstractLogData::getLinesBatch( LineNumber first_line, LinesCount number,
+                                     LineBatch& batch ) const
+{
+    doGetLinesBatch( first_line, number, batch );
+}
+
+void AbstractLogData::doGetLinesBatch( LineNumber first_line, LinesCount number,
+                                       LineBatch& batch ) const
+{
+    batch.clear();
+    for ( const auto& line : doGetLines( first_line, number ) ) {
+        batch.append( line );
+    }
+}
+
+// Simple wrapper in order to use a clean Template Method
+std::vector<AnsiColorSpan> AbstractLogData::getLineColors( LineNumber line ) const
+{
+    return doGetLineColors( line );
+}
+
+std::vector<AnsiColorSpan> AbstractLogData::doGetLineColors( LineNumber ) const
+{
+    return {};
+}
+
+// Simple wrapper in order to use a clean Template Method
+bool AbstractLogData::loadMoreOfLine( LineNumber line ) const
+{
+    return doLoadMoreOfLine( line );
+}
+
+bool AbstractLogData::doLoadMoreOfLine( LineNumber ) const
+{
+    return false;
+}
+
 // Simple wrapper in order to use a clean Template Method
 LinesCount AbstractLogData::getNbLine() const
 {
@@ -86,6 +132,23 @@ LineLength AbstractLogData::getLineLength( LineNumber line ) const
     return doGetLineLength( line );
 }
 
+// Simple wrapper in order to use a clean Template Method
+void AbstractLogData::prefetchLines( LineNumber first_line, LinesCount number ) const
+{
+    doPrefetchLines( first_line, number );
+}
+
+// Simple wrapper in order to use a clean Template Method
+bool AbstractLogData::areLinesCached( LineNumber first_line, LinesCount number ) const
+{
+    return doAreLinesCached( first_line, number );
+}
+
+bool AbstractLogData::doAreLinesCached( LineNumber, LinesCount ) const
+{
+    return true;
+}
+
 void AbstractLogData::setDisplayEncoding( const char* encoding )
 {
     doSetDisplayEncoding( encoding );
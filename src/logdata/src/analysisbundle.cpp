@@ -0,0 +1,267 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "analysisbundle.h"
+
+#include <limits>
+#include <map>
+#include <utility>
+
+#include <QDataStream>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QSysInfo>
+#include <QTextCodec>
+
+#include "filedigest.h"
+#include "indexcache.h"
+#include "log.h"
+#include "streamlimits.h"
+#include "synchronization.h"
+
+namespace {
+constexpr quint32 AnalysisBundleMagic = 0x4B4C4142; // KLAB
+constexpr quint32 AnalysisBundleVersion = 2;
+
+// Every search result has at least its line range and digest
+constexpr quint64 MinSearchResultBytes = 3 * sizeof( quint64 );
+
+QByteArray codecName( QTextCodec* codec )
+{
+    return codec != nullptr ? codec->name() : QByteArray{};
+}
+
+quint64 dataDigest( const QByteArray& data )
+{
+    FileDigest digest;
+    digest.addData( data );
+    return digest.digest();
+}
+
+struct AttachedBundles {
+    SharedMutex mutex;
+    std::map<QString, AnalysisBundle> bundles;
+};
+
+AttachedBundles& attachedBundles()
+{
+    static AttachedBundles attached;
+    return attached;
+}
+} // namespace
+
+bool AnalysisBundle::setIndex( const IndexingData::ConstAccessor& scopedAccessor )
+{
+    hash_ = scopedAccessor.getHash();
+    if ( hash_.size == 0
+         || scopedAccessor.allocatedSize() > std::numeric_limits<int>::max() / 2 ) {
+        return false;
+    }
+
+    forcedEncoding_ = codecName( scopedAccessor.getForcedEncoding() );
+
+    index_.clear();
+    QDataStream stream( &index_, QIODevice::WriteOnly );
+    stream.setVersion( QDataStream::Qt_5_9 );
+    scopedAccessor.saveIndex( stream );
+    return stream.status() == QDataStream::Ok;
+}
+
+bool AnalysisBundle::save( const QString& bundlePath ) const
+{
+    QSaveFile bundleFile( bundlePath );
+    if ( !bundleFile.open( QIODevice::WriteOnly ) ) {
+        LOG_WARNING << "Failed to open analysis bundle " << bundlePath;
+        return false;
+    }
+
+    QDataStream stream( &bundleFile );
+    stream.setVersion( QDataStream::Qt_5_9 );
+
+    stream << AnalysisBundleMagic << AnalysisBundleVersion
+           << static_cast<qint32>( QSysInfo::ByteOrder ) << fileName << forcedEncoding_;
+    IndexCache::saveHash( stream, hash_ );
+    stream << dataDigest( index_ ) << index_;
+
+    stream << static_cast<quint32>( searchResults.size() );
+    for ( const auto& entry : searchResults ) {
+        PersistentSearchCache::saveEntry(
+            stream, entry, PersistentSearchCache::serializeLines( entry.matchingLines ) );
+    }
+
+    const auto serializedMarks = PersistentSearchCache::serializeLines( marks );
+    stream << dataDigest( serializedMarks ) << serializedMarks << highlighters;
+
+    if ( stream.status() != QDataStream::Ok || !bundleFile.commit() ) {
+        LOG_WARNING << "Failed to save analysis bundle " << bundlePath;
+        return false;
+    }
+
+    LOG_INFO << "Saved analysis bundle of " << fileName << " to " << bundlePath << ", "
+             << searchResults.size() << " search results";
+    return true;
+}
+
+bool AnalysisBundle::load( const QString& bundlePath )
+{
+    QFile bundleFile( bundlePath );
+    if ( !bundleFile.open( QIODevice::ReadOnly ) ) {
+        LOG_WARNING << "Failed to open analysis bundle " << bundlePath;
+        return false;
+    }
+
+    QDataStream stream( &bundleFile );
+    stream.setVersion( QDataStream::Qt_5_9 );
+
+    quint32 magic = 0;
+    quint32 version = 0;
+    qint32 byteOrder = 0;
+    stream >> magic >> version >> byteOrder >> fileName >> forcedEncoding_;
+
+    // Index is stored in native byte order
+    if ( stream.status() != QDataStream::Ok || magic != AnalysisBundleMagic
+         || version != AnalysisBundleVersion || byteOrder != QSysInfo::ByteOrder ) {
+        LOG_WARNING << "Analysis bundle " << bundlePath << " is not compatible";
+        return false;
+    }
+
+    // Damaged index is found by its digest, as it is parsed later
+    hash_ = IndexCache::loadHash( stream );
+    quint64 indexDigest = 0;
+    stream >> indexDigest >> index_;
+    if ( stream.status() != QDataStream::Ok || dataDigest( index_ ) != indexDigest ) {
+        LOG_WARNING << "Failed to read index of analysis bundle " << bundlePath;
+        return false;
+    }
+
+    quint32 entriesCount = 0;
+    stream >> entriesCount;
+    if ( !isCountInStream( stream, entriesCount, MinSearchResultBytes ) ) {
+        LOG_WARNING << "Analysis bundle " << bundlePath << " has more search results than data";
+        return false;
+    }
+
+    searchResults.clear();
+    for ( auto index = 0u; index < entriesCount && stream.status() == QDataStream::Ok;
+          ++index ) {
+        PersistentSearchCache::Entry entry;
+        if ( !PersistentSearchCache::loadEntry( stream, entry ) ) {
+            LOG_WARNING << "Failed to read search results of analysis bundle " << bundlePath;
+            return false;
+        }
+        searchResults.push_back( std::move( entry ) );
+    }
+
+    quint64 marksDigest = 0;
+    QByteArray serializedMarks;
+    stream >> marksDigest >> serializedMarks >> highlighters;
+    if ( stream.status() != QDataStream::Ok || dataDigest( serializedMarks ) != marksDigest ) {
+        LOG_WARNING << "Failed to read analysis bundle " << bundlePath;
+        return false;
+    }
+
+    auto loadedMarks = readBitmap<SearchResultArray>( serializedMarks );
+    if ( !loadedMarks ) {
+        LOG_WARNING << "Failed to read marks of analysis bundle " << bundlePath;
+        return false;
+    }
+    marks = std::move( *loadedMarks );
+
+    LOG_INFO << "Loaded analysis bundle " << bundlePath << " of " << fileName
+             << ", indexed size " << hash_.size << ", " << searchResults.size()
+             << " search results";
+    return true;
+}
+
+bool AnalysisBundle::isBundleOf( const QString& localFileName ) const
+{
+    return !index_.isEmpty() && IndexCache::isIndexedPartUnchanged( localFileName, hash_ );
+}
+
+void AnalysisBundle::attach( const QString& localFileName ) const
+{
+    auto& attached = attachedBundles();
+    UniqueLock lock( attached.mutex );
+    attached.bundles[ QFileInfo( localFileName ).absoluteFilePath() ] = *this;
+}
+
+bool AnalysisBundle::loadAttachedIndex( const QString& fileName,
+                                        IndexingData::MutateAccessor& scopedAccessor )
+{
+    IndexedHash hash;
+    QByteArray forcedEncoding;
+    QByteArray index;
+    {
+        auto& attached = attachedBundles();
+        UniqueLock lock( attached.mutex );
+        auto bundle = attached.bundles.find( QFileInfo( fileName ).absoluteFilePath() );
+        if ( bundle == attached.bundles.end() || bundle->second.index_.isEmpty() ) {
+            return false;
+        }
+
+        // Index is used once, the file is indexed as usual after that
+        hash = std::move( bundle->second.hash_ );
+        forcedEncoding = std::move( bundle->second.forcedEncoding_ );
+        index = std::move( bundle->second.index_ );
+        bundle->second.index_.clear();
+        if ( bundle->second.searchResults.empty() ) {
+            attached.bundles.erase( bundle );
+        }
+    }
+
+    if ( forcedEncoding != codecName( scopedAccessor.getForcedEncoding() ) ) {
+        LOG_INFO << "Analysis bundle has different forced encoding";
+        return false;
+    }
+
+    if ( !IndexCache::isIndexedPartUnchanged( fileName, hash ) ) {
+        LOG_INFO << "File changed since analysis bundle was attached";
+        return false;
+    }
+
+    QDataStream stream( index );
+    stream.setVersion( QDataStream::Qt_5_9 );
+    if ( !scopedAccessor.loadIndex( stream, hash ) ) {
+        LOG_WARNING << "Failed to load index of analysis bundle for " << fileName;
+        return false;
+    }
+
+    LOG_INFO << "Loaded index of analysis bundle for " << fileName << ", "
+             << scopedAccessor.getNbLines() << " lines, indexed size " << hash.size;
+    return true;
+}
+
+std::vector<PersistentSearchCache::Entry>
+AnalysisBundle::takeAttachedSearchResults( const QString& fileName )
+{
+    auto& attached = attachedBundles();
+    UniqueLock lock( attached.mutex );
+    auto bundle = attached.bundles.find( QFileInfo( fileName ).absoluteFilePath() );
+    if ( bundle == attached.bundles.end() ) {
+        return {};
+    }
+
+    auto searchResults = std::move( bundle->second.searchResults );
+    bundle->second.searchResults.clear();
+    if ( bundle->second.index_.isEmpty() ) {
+        attached.bundles.erase( bundle );
+    }
+    return searchResults;
+}
@@ -0,0 +1,218 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "ansicolors.h"
+
+#include <array>
+#include <cstring>
+
+namespace ansi_colors {
+
+namespace {
+constexpr char Escape = '\x1B';
+constexpr size_t MaxParameters = 16;
+
+struct Colors {
+    AnsiColor fore;
+    AnsiColor back;
+
+    bool isDefault() const
+    {
+        return fore == AnsiColor{} && back == AnsiColor{};
+    }
+
+    bool operator!=( const Colors& other ) const
+    {
+        return fore != other.fore || back != other.back;
+    }
+};
+
+bool isDigit( char c )
+{
+    return c >= '0' && c <= '9';
+}
+
+// Sequences are matched case insensitive, like the prefilter pattern
+bool isSequenceEnd( char c )
+{
+    return c == 'm' || c == 'M' || c == 'k' || c == 'K';
+}
+
+bool isColorSequenceEnd( char c )
+{
+    return c == 'm' || c == 'M';
+}
+
+// Continuation bytes are not counted, characters of four bytes are surrogate pairs
+int utf16Length( const char* begin, const char* end )
+{
+    int length = 0;
+    for ( auto pos = begin; pos < end; ++pos ) {
+        const auto byte = static_cast<uint8_t>( *pos );
+        length += static_cast<int>( ( byte & 0xC0 ) != 0x80 ) + static_cast<int>( byte >= 0xF0 );
+    }
+    return length;
+}
+
+AnsiColor indexedColor( uint32_t index )
+{
+    return { AnsiColor::Type::Indexed, index & 0xFF };
+}
+
+// Applies parameters of a valid SGR sequence between '[' and 'm'
+void applyColorSequence( const char* begin, const char* end, Colors& colors )
+{
+    std::array<uint32_t, MaxParameters> parameters{};
+    size_t count = 1;
+    for ( auto pos = begin; pos < end; ++pos ) {
+        if ( *pos == ';' ) {
+            if ( count == MaxParameters ) {
+                break;
+            }
+            ++count;
+        }
+        else {
+            auto& parameter = parameters[ count - 1 ];
+            parameter = parameter * 10 + static_cast<uint32_t>( *pos - '0' );
+        }
+    }
+
+    for ( size_t i = 0; i < count; ++i ) {
+        const auto parameter = parameters[ i ];
+        if ( parameter == 0 ) {
+            colors = {};
+        }
+        else if ( parameter >= 30 && parameter <= 37 ) {
+            colors.fore = indexedColor( parameter - 30 );
+        }
+        else if ( parameter >= 90 && parameter <= 97 ) {
+            colors.fore = indexedColor( parameter - 90 + 8 );
+        }
+        else if ( parameter == 39 ) {
+            colors.fore = {};
+        }
+        else if ( parameter >= 40 && parameter <= 47 ) {
+            colors.back = indexedColor( parameter - 40 );
+        }
+        else if ( parameter >= 100 && parameter <= 107 ) {
+            colors.back = indexedColor( parameter - 100 + 8 );
+        }
+        else if ( parameter == 49 ) {
+            colors.back = {};
+        }
+        else if ( parameter == 38 || parameter == 48 ) {
+            // Extended color is 5;index or 2;red;green;blue
+            auto& color = parameter == 38 ? colors.fore : colors.back;
+            if ( i + 2 < count && parameters[ i + 1 ] == 5 ) {
+                color = indexedColor( parameters[ i + 2 ] );
+                i += 2;
+            }
+            else if ( i + 4 < count && parameters[ i + 1 ] == 2 ) {
+                color = { AnsiColor::Type::Rgb, ( parameters[ i + 2 ] & 0xFF ) << 16
+                                                    | ( parameters[ i + 3 ] & 0xFF ) << 8
+                                                    | ( parameters[ i + 4 ] & 0xFF ) };
+                i += 4;
+            }
+            else {
+                break;
+            }
+        }
+    }
+}
+} // namespace
+
+const char* sequenceEnd( const char* escape, const char* end )
+{
+    auto pos = escape + 1;
+    if ( pos >= end || *pos != '[' ) {
+        return nullptr;
+    }
+    ++pos;
+
+    // Parameters are numbers separated by semicolons, none of them is empty
+    size_t digits = 0;
+    while ( pos < end && ( isDigit( *pos ) || *pos == ';' ) ) {
+        if ( *pos == ';' ) {
+            if ( digits == 0 ) {
+                return nullptr;
+            }
+            digits = 0;
+        }
+        else if ( ++digits > MaxParameterDigits ) {
+            return nullptr;
+        }
+        ++pos;
+    }
+
+    if ( pos >= end || !isSequenceEnd( *pos ) || ( digits == 0 && *( pos - 1 ) == ';' ) ) {
+        return nullptr;
+    }
+    return pos + 1;
+}
+
+std::vector<AnsiColorSpan> parseLine( std::string_view line )
+{
+    std::vector<AnsiColorSpan> spans;
+
+    Colors colors;
+    int column = 0;
+    int spanStart = 0;
+    const auto closeSpan = [ & ]() {
+        if ( column > spanStart && !colors.isDefault() ) {
+            spans.push_back( { spanStart, column - spanStart, colors.fore, colors.back } );
+        }
+        spanStart = column;
+    };
+
+    const auto* pos = line.data();
+    const auto* end = line.data() + line.size();
+    while ( pos < end ) {
+        const auto* escape
+            = static_cast<const char*>( std::memchr( pos, Escape, static_cast<size_t>( end - pos ) ) );
+        column += utf16Length( pos, escape ? escape : end );
+
+        if ( !escape ) {
+            break;
+        }
+
+        const auto* escapeEnd = sequenceEnd( escape, end );
+        if ( !escapeEnd ) {
+            // Lone escape character stays in the line
+            ++column;
+            pos = escape + 1;
+            continue;
+        }
+
+        if ( isColorSequenceEnd( *( escapeEnd - 1 ) ) ) {
+            auto newColors = colors;
+            applyColorSequence( escape + 2, escapeEnd - 1, newColors );
+            if ( newColors != colors ) {
+                closeSpan();
+                colors = newColors;
+            }
+        }
+        pos = escapeEnd;
+    }
+
+    closeSpan();
+    return spans;
+}
+
+} // namespace ansi_colors
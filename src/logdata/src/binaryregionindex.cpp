@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "binaryregionindex.h"
+
+#include <algorithm>
+#include <utility>
+
+#include <QByteArray>
+#include <QDataStream>
+
+#include "linescanner.h"
+#include "streamlimits.h"
+
+std::vector<uint64_t>
+BinaryRegionIndex::findBinaryChunks( qint64 offset, std::string_view block,
+                                     const EncodingParameters& encodingParams )
+{
+    std::vector<uint64_t> chunks;
+    if ( encodingParams.lineFeedWidth > 1 ) {
+        return chunks;
+    }
+
+    auto position = offset;
+    const auto end = offset + static_cast<qint64>( block.size() );
+    while ( position < end ) {
+        const auto chunk = position / ChunkSize;
+        const auto chunkEnd = std::min( end, ( chunk + 1 ) * ChunkSize );
+        if ( isBinary( block.substr( static_cast<size_t>( position - offset ),
+                                     static_cast<size_t>( chunkEnd - position ) ) ) ) {
+            chunks.push_back( static_cast<uint64_t>( chunk ) );
+        }
+        position = chunkEnd;
+    }
+    return chunks;
+}
+
+bool BinaryRegionIndex::isBinary( std::string_view text )
+{
+    return !text.empty() && line_scanner::countBinaryBytes( text ) * BinaryRatio > text.size();
+}
+
+void BinaryRegionIndex::append( const std::vector<uint64_t>& chunks )
+{
+    if ( chunks.empty() ) {
+        return;
+    }
+
+    chunks_.addMany( chunks.size(), chunks.data() );
+    chunks_.runOptimize();
+}
+
+void BinaryRegionIndex::truncate( qint64 size )
+{
+    if ( chunks_.isEmpty() ) {
+        return;
+    }
+
+    // Chunk continued past size is kept, lines are checked by their bytes anyway
+    roaring::Roaring64Map kept;
+    kept.addRange( 0, static_cast<uint64_t>( ( size + ChunkSize - 1 ) / ChunkSize ) );
+    chunks_ &= kept;
+}
+
+void BinaryRegionIndex::clear()
+{
+    chunks_ = {};
+}
+
+bool BinaryRegionIndex::hasBinaryChunks( qint64 begin, qint64 end ) const
+{
+    if ( chunks_.isEmpty() || end <= begin ) {
+        return false;
+    }
+
+    const auto firstChunk = static_cast<uint64_t>( begin / ChunkSize );
+    const auto lastChunk = static_cast<uint64_t>( ( end - 1 ) / ChunkSize );
+    const auto chunksBefore = firstChunk > 0 ? chunks_.rank( firstChunk - 1 ) : 0;
+    return chunks_.rank( lastChunk ) > chunksBefore;
+}
+
+size_t BinaryRegionIndex::allocatedSize() const
+{
+    return chunks_.getSizeInBytes( false );
+}
+
+void BinaryRegionIndex::save( QDataStream& stream ) const
+{
+    QByteArray data;
+    data.resize( static_cast<int>( chunks_.getSizeInBytes( true ) ) );
+    chunks_.write( data.data(), true );
+    stream << data;
+}
+
+bool BinaryRegionIndex::load( QDataStream& stream )
+{
+    QByteArray data;
+    stream >> data;
+
+    if ( stream.status() != QDataStream::Ok ) {
+        return false;
+    }
+
+    if ( data.isEmpty() ) {
+        chunks_ = {};
+        return true;
+    }
+
+    auto chunks = readBitmap<roaring::Roaring64Map>( data );
+    if ( !chunks ) {
+        return false;
+    }
+    chunks_ = std::move( *chunks );
+    return true;
+}
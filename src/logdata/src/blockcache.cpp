@@ -0,0 +1,158 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "blockcache.h"
+
+#include <algorithm>
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#include "configuration.h"
+#include "log.h"
+
+BlockCache& BlockCache::get()
+{
+    static BlockCache cache;
+    return cache;
+}
+
+BlockCache::BlockCache()
+    : directory_( QStandardPaths::writableLocation( QStandardPaths::CacheLocation )
+                  + QDir::separator() + "blocks" )
+{
+}
+
+bool BlockCache::isEnabled() const
+{
+    return Configuration::get().useLocalBlockCache();
+}
+
+QString BlockCache::entryName( const Key& key )
+{
+    return QString( "%1-%2-%3-%4.blk" )
+        .arg( key.fileId.volumeIndex, 0, 16 )
+        .arg( key.fileId.fileIndex, 0, 16 )
+        .arg( key.offset, 0, 16 )
+        .arg( key.digest, 16, 16, QChar( '0' ) );
+}
+
+void BlockCache::loadEntries()
+{
+    if ( isLoaded_ ) {
+        return;
+    }
+    isLoaded_ = true;
+
+    if ( !QDir().mkpath( directory_ ) ) {
+        LOG_WARNING << "Failed to create block cache directory " << directory_;
+        return;
+    }
+
+    const auto files = QDir( directory_ ).entryInfoList( { "*.blk" }, QDir::Files, QDir::Time );
+    for ( const auto& file : files ) {
+        entries_.emplace_back( file.fileName(), file.size() );
+        entryByName_.emplace( file.fileName(), std::prev( entries_.end() ) );
+        size_ += file.size();
+    }
+
+    LOG_INFO << "Block cache has " << entries_.size() << " blocks, " << size_ << " bytes";
+    evict();
+}
+
+void BlockCache::store( const Key& key, const QByteArray& block )
+{
+    const auto name = entryName( key );
+    {
+        ScopedLock lock( mutex_ );
+        loadEntries();
+        if ( entryByName_.count( name ) ) {
+            return;
+        }
+    }
+
+    // Readers never see partially written blocks
+    QSaveFile file( directory_ + QDir::separator() + name );
+    if ( !file.open( QIODevice::WriteOnly ) || file.write( block ) != block.size()
+         || !file.commit() ) {
+        LOG_WARNING << "Failed to store block in " << file.fileName() << ": "
+                    << file.errorString();
+        return;
+    }
+
+    ScopedLock lock( mutex_ );
+    if ( entryByName_.count( name ) ) {
+        return;
+    }
+
+    entries_.emplace_front( name, block.size() );
+    entryByName_.emplace( name, entries_.begin() );
+    size_ += block.size();
+    evict();
+}
+
+bool BlockCache::read( const Key& key, qint64 offset, char* data, qint64 length )
+{
+    const auto name = entryName( key );
+    {
+        ScopedLock lock( mutex_ );
+        loadEntries();
+        const auto entry = entryByName_.find( name );
+        if ( entry == entryByName_.end() ) {
+            return false;
+        }
+        entries_.splice( entries_.begin(), entries_, entry->second );
+    }
+
+    QFile file( directory_ + QDir::separator() + name );
+    if ( file.open( QIODevice::ReadOnly ) && file.seek( offset )
+         && file.read( data, length ) == length ) {
+        return true;
+    }
+
+    LOG_WARNING << "Failed to read cached block " << file.fileName();
+
+    ScopedLock lock( mutex_ );
+    const auto entry = entryByName_.find( name );
+    if ( entry != entryByName_.end() ) {
+        size_ -= entry->second->second;
+        entries_.erase( entry->second );
+        entryByName_.erase( entry );
+    }
+    return false;
+}
+
+void BlockCache::evict()
+{
+    const auto maxSize
+        = static_cast<qint64>( std::max( 0, Configuration::get().localBlockCacheSizeMb() ) )
+          * 1024 * 1024;
+
+    while ( size_ > maxSize && !entries_.empty() ) {
+        const auto& [ name, size ] = entries_.back();
+        QFile::remove( directory_ + QDir::separator() + name );
+        size_ -= size;
+        entryByName_.erase( name );
+        entries_.pop_back();
+    }
+}
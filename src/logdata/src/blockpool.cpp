@@ -19,7 +19,27 @@
 
 #include "blockpool.h"
 
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#include <QDataStream>
+#include <QTemporaryFile>
+#include <QtGlobal>
+
+#ifdef Q_OS_UNIX
+#include <sys/mman.h>
+#include <unistd.h>
+#include <cstdlib>
+#endif
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#endif
+
+#include "configuration.h"
 #include "log.h"
+#include "streamlimits.h"
 
 namespace {
 
@@ -40,24 +60,94 @@ size_t getBlockStorageSize( size_t elementsCount, std::size_t elementSize, size_
     return getAlignedSize( elementSize + 2 * elementsCount * getElementSizeWithHeader( elementSize ), alignement );
 }
 
-template<typename PoolType>
-void increasePool(PoolType& pool)
+size_t chunkIndex( size_t offset )
+{
+    return offset / BlockPoolBase::ChunkSize;
+}
+
+// Chunks aligned to the size of huge pages can be backed by them
+// entirely when transparent huge pages are enabled
+constexpr size_t HugePageSize = 2 * 1024 * 1024;
+
+}
+
+void BlockPoolBase::HeapChunkDeleter::operator()( uint8_t* chunk ) const
 {
-    const auto oldSize = pool.size();
-    pool.resize( oldSize + (oldSize >> 1 ) );
+    switch ( allocation ) {
+    case Allocation::Heap:
+        delete[] chunk;
+        break;
+    case Allocation::Aligned:
+#ifdef Q_OS_UNIX
+        std::free( chunk );
+#endif
+        break;
+    case Allocation::Virtual:
+#ifdef Q_OS_WIN
+        VirtualFree( chunk, 0, MEM_RELEASE );
+#endif
+        break;
+    }
 }
 
+BlockPoolBase::HeapChunk BlockPoolBase::allocateHeapChunk( bool useLargePages )
+{
+    using Allocation = HeapChunkDeleter::Allocation;
+
+    if ( useLargePages ) {
+#if defined( Q_OS_UNIX )
+        void* chunk = nullptr;
+        if ( posix_memalign( &chunk, HugePageSize, ChunkSize ) == 0 ) {
+#ifdef MADV_HUGEPAGE
+            madvise( chunk, ChunkSize, MADV_HUGEPAGE );
+#endif
+            return HeapChunk{ static_cast<uint8_t*>( chunk ),
+                              HeapChunkDeleter{ Allocation::Aligned } };
+        }
+#elif defined( Q_OS_WIN )
+        // Requires the 'Lock pages in memory' privilege, without it regular pages are used
+        const auto largePageSize = GetLargePageMinimum();
+        if ( largePageSize > 0 && ChunkSize % largePageSize == 0 ) {
+            if ( auto chunk = VirtualAlloc( nullptr, ChunkSize,
+                                            MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES,
+                                            PAGE_READWRITE ) ) {
+                return HeapChunk{ static_cast<uint8_t*>( chunk ),
+                                  HeapChunkDeleter{ Allocation::Virtual } };
+            }
+        }
+#endif
+        LOG_DEBUG << "Failed to allocate index chunk in large pages";
+    }
+
+    return HeapChunk{ new uint8_t[ ChunkSize ], HeapChunkDeleter{ Allocation::Heap } };
 }
 
 BlockPoolBase::BlockPoolBase( size_t elementSize, size_t alignment )
-    : pool_(1024*1024)
-    , elementSize_ {elementSize}
+    : BlockPoolBase( elementSize, alignment, Configuration::get().useFileBackedIndex() )
+{
+}
+
+BlockPoolBase::BlockPoolBase( size_t elementSize, size_t alignment, bool isFileBacked )
+    : elementSize_ {elementSize}
     , alignment_ {alignment}
     , allocationSize_{}
 {
     blockIndex_.reserve( 10000 );
+
+    const auto& config = Configuration::get();
+    useLargePages_ = config.useLargePages();
+
+    if ( isFileBacked ) {
+        backingFile_ = std::make_unique<QTemporaryFile>();
+        if ( !backingFile_->open() ) {
+            LOG_WARNING << "Failed to create index backing file, using memory";
+            backingFile_.reset();
+        }
+    }
 }
 
+BlockPoolBase::~BlockPoolBase() = default;
+
 BlockPoolBase::BlockPoolBase( BlockPoolBase&& other ) noexcept
 {
     *this = std::move( other );
@@ -65,7 +155,10 @@ BlockPoolBase::BlockPoolBase( BlockPoolBase&& other ) noexcept
 
 BlockPoolBase& BlockPoolBase::operator=( BlockPoolBase&& other ) noexcept
 {
-    pool_ = std::move( other.pool_ );
+    chunks_ = std::move( other.chunks_ );
+    heapChunks_ = std::move( other.heapChunks_ );
+    backingFile_ = std::move( other.backingFile_ );
+    useLargePages_ = other.useLargePages_;
 
     elementSize_ = other.elementSize_;
     alignment_ = other.alignment_;
@@ -74,17 +167,26 @@ BlockPoolBase& BlockPoolBase::operator=( BlockPoolBase&& other ) noexcept
 
     blockIndex_ = std::move( other.blockIndex_ );
 
+    other.chunks_.clear();
+    other.allocationSize_ = 0;
+    other.blockIndex_.clear();
+
     return *this;
 }
 
+uint8_t* BlockPoolBase::dataAt( size_t offset ) const
+{
+    return chunks_[ chunkIndex( offset ) ] + offset % ChunkSize;
+}
+
 uint8_t* BlockPoolBase::at(size_t index)
 {
-    return pool_.data() + blockIndex_.at( index );
+    return dataAt( blockIndex_.at( index ) );
 }
 
 const uint8_t* BlockPoolBase::at(size_t index) const
 {
-    return pool_.data() + blockIndex_.at( index );
+    return dataAt( blockIndex_.at( index ) );
 }
 
 size_t BlockPoolBase::getElementSize() const
@@ -102,25 +204,53 @@ uint32_t BlockPoolBase::currentBlock() const
     return static_cast<uint32_t>( blockIndex_.size() - 1 );
 }
 
+void BlockPoolBase::addChunk()
+{
+    if ( backingFile_ ) {
+        const auto chunkOffset = static_cast<qint64>( chunks_.size() * ChunkSize );
+        if ( backingFile_->resize( chunkOffset + static_cast<qint64>( ChunkSize ) ) ) {
+            if ( auto mappedChunk = backingFile_->map( chunkOffset, ChunkSize ) ) {
+                chunks_.push_back( mappedChunk );
+                return;
+            }
+        }
+
+        LOG_WARNING << "Failed to map index chunk: " << backingFile_->errorString();
+    }
+
+    heapChunks_.push_back( allocateHeapChunk( useLargePages_ ) );
+    chunks_.push_back( heapChunks_.back().get() );
+}
+
+size_t BlockPoolBase::reserve( size_t offset, size_t blockSize )
+{
+    if ( chunkIndex( offset ) != chunkIndex( offset + blockSize - 1 ) ) {
+        // Block would cross chunk boundary, move it to the next chunk
+        offset = ( chunkIndex( offset ) + 1 ) * ChunkSize;
+    }
+
+    while ( chunks_.size() <= chunkIndex( offset + blockSize - 1 ) ) {
+        addChunk();
+    }
+
+    return offset;
+}
+
 uint8_t* BlockPoolBase::getBlock( size_t elementsCount )
 {
     const auto requiredSize = getBlockStorageSize( elementsCount, elementSize_, alignment_ );
 
-    const auto alignedAllocationSize = getAlignedSize(allocationSize_, alignment_);
+    const auto blockOffset = reserve( getAlignedSize(allocationSize_, alignment_), requiredSize );
 
     LOG_DEBUG << "Get block " << elementSize_
-                   << " pool " << pool_.size()
+                   << " chunks " << chunks_.size()
                    << " alloc " << allocationSize_
                    << " blocks " << blockIndex_.size();
 
-    if ( alignedAllocationSize + requiredSize >= pool_.size() ) {
-        increasePool( pool_ );
-    }
-
-    blockIndex_.push_back( alignedAllocationSize );
-    allocationSize_ = alignedAllocationSize + requiredSize;
+    blockIndex_.push_back( blockOffset );
+    allocationSize_ = blockOffset + requiredSize;
 
-    return pool_.data() + blockIndex_.back();
+    return dataAt( blockIndex_.back() );
 }
 
 uint8_t* BlockPoolBase::resizeLastBlock( size_t newSize )
@@ -141,15 +271,18 @@ uint8_t* BlockPoolBase::resizeLastBlock( size_t newSize )
         const auto delta = alignedNewSize - currentBlockSize;
         LOG_DEBUG << "Increasing last block size by " << delta;
 
-        if ( allocationSize_ + delta >= pool_.size() ) {
-            increasePool( pool_ );
+        const auto blockOffset = reserve( blockIndex_.back(), alignedNewSize );
+        if ( blockOffset != blockIndex_.back() ) {
+            std::memmove( dataAt( blockOffset ), dataAt( blockIndex_.back() ), currentBlockSize );
+            blockIndex_.back() = blockOffset;
         }
-        allocationSize_ += delta;
+
+        allocationSize_ = blockOffset + alignedNewSize;
     }
 
     LOG_DEBUG << "Resized block, alloc " << allocationSize_;
 
-    return pool_.data() + blockIndex_.back();
+    return dataAt( blockIndex_.back() );
 }
 
 size_t BlockPoolBase::lastBlockSize() const
@@ -181,3 +314,108 @@ size_t BlockPoolBase::allocatedSize() const
 {
     return allocationSize_;
 }
+
+size_t BlockPoolBase::virtualSize() const
+{
+    return chunks_.size() * ChunkSize;
+}
+
+size_t BlockPoolBase::residentSize() const
+{
+#ifdef Q_OS_UNIX
+    if ( backingFile_ ) {
+        const auto pageSize = static_cast<size_t>( sysconf( _SC_PAGESIZE ) );
+#ifdef Q_OS_MACOS
+        std::vector<char> residentPages( ChunkSize / pageSize );
+#else
+        std::vector<unsigned char> residentPages( ChunkSize / pageSize );
+#endif
+        size_t resident = 0;
+        for ( const auto chunk : chunks_ ) {
+            if ( mincore( chunk, ChunkSize, residentPages.data() ) == 0 ) {
+                resident += pageSize
+                            * static_cast<size_t>( std::count_if(
+                                residentPages.begin(), residentPages.end(),
+                                []( auto page ) { return ( page & 1 ) != 0; } ) );
+            }
+            else {
+                resident += ChunkSize;
+            }
+        }
+        return resident;
+    }
+#endif
+
+    return virtualSize();
+}
+
+void BlockPoolBase::save( QDataStream& stream ) const
+{
+    stream << static_cast<quint64>( elementSize_ ) << static_cast<quint64>( alignment_ )
+           << static_cast<quint64>( allocationSize_ );
+
+    stream << static_cast<quint64>( blockIndex_.size() );
+    for ( const auto blockOffset : blockIndex_ ) {
+        stream << static_cast<quint64>( blockOffset );
+    }
+
+    for ( auto offset = 0u; offset < allocationSize_; offset += ChunkSize ) {
+        const auto size = std::min( ChunkSize, allocationSize_ - offset );
+        stream.writeRawData( reinterpret_cast<const char*>( dataAt( offset ) ),
+                             static_cast<int>( size ) );
+    }
+}
+
+bool BlockPoolBase::load( QDataStream& stream )
+{
+    quint64 elementSize = 0;
+    quint64 alignment = 0;
+    quint64 allocationSize = 0;
+    quint64 blocksCount = 0;
+    stream >> elementSize >> alignment >> allocationSize >> blocksCount;
+
+    if ( stream.status() != QDataStream::Ok || elementSize != elementSize_
+         || alignment != alignment_ ) {
+        LOG_WARNING << "Invalid block pool header";
+        return false;
+    }
+
+    // Offsets of blocks are followed by all allocated data
+    if ( !isCountInStream( stream, blocksCount, sizeof( quint64 ) )
+         || !isCountInStream( stream, allocationSize, 1 )
+         || !isCountInStream( stream, blocksCount * sizeof( quint64 ) + allocationSize, 1 ) ) {
+        LOG_WARNING << "Block pool is bigger than the data left";
+        return false;
+    }
+
+    std::vector<size_t> blockIndex( static_cast<size_t>( blocksCount ) );
+    for ( auto& blockOffset : blockIndex ) {
+        quint64 offset = 0;
+        stream >> offset;
+        if ( offset >= allocationSize ) {
+            LOG_WARNING << "Invalid block offset " << offset;
+            return false;
+        }
+        blockOffset = static_cast<size_t>( offset );
+    }
+
+    BlockPoolBase loaded( elementSize_, alignment_ );
+    if ( allocationSize > 0 ) {
+        loaded.reserve( 0, static_cast<size_t>( allocationSize ) );
+    }
+
+    for ( auto offset = 0u; offset < allocationSize; offset += ChunkSize ) {
+        const auto size = static_cast<int>( std::min( ChunkSize, allocationSize - offset ) );
+        if ( stream.readRawData( reinterpret_cast<char*>( loaded.dataAt( offset ) ), size )
+             != size ) {
+            LOG_WARNING << "Failed to read block pool data";
+            return false;
+        }
+    }
+
+    loaded.blockIndex_ = std::move( blockIndex );
+    loaded.allocationSize_ = static_cast<size_t>( allocationSize );
+
+    *this = std::move( loaded );
+    return true;
+}
@@ -37,147 +37,269 @@
  */
 
 #include <QtEndian>
+#include <array>
 #include <cassert>
 #include <cstdlib>
+#include <cstring>
 #include <limits>
 #include <stdexcept>
 
+#include <QDataStream>
+
 #include "compressedlinestorage.h"
-#include "configuration.h"
 #include "log.h"
+#include "streamlimits.h"
 
 static constexpr size_t IndexBlockSize = 256;
+static constexpr size_t IndexGroupSize = 64;
+static constexpr size_t IndexGroupsCount = IndexBlockSize / IndexGroupSize;
 
 namespace {
 // Functions to manipulate blocks
 
-using BlockOffset = CompressedLinePositionStorage::BlockOffset;
+// Deltas are read with unaligned 64 bit loads,
+// block is padded to keep them inside allocation
+constexpr size_t ReadPadding = sizeof( uint64_t );
+constexpr uint8_t MaxPackedWidth = 56;
+
+template <typename ElementType>
+struct BlockHeader {
+    ElementType initialPosition;
+    std::array<ElementType, IndexGroupsCount - 1> groupPositions;
+    std::array<uint8_t, IndexGroupsCount> widths;
+};
 
-// Add a one byte relative delta (0-127) and inc pointer
-// First bit is always 0
-void block_add_one_byte_relative( uint8_t* block, BlockOffset& offset, uint8_t value )
+uint8_t delta_width( uint64_t maxDelta )
 {
-    *( block + offset.get() ) = value;
-    offset += BlockOffset( sizeof( value ) );
+    uint8_t width = 0;
+    while ( width < 64 && ( maxDelta >> width ) != 0 ) {
+        ++width;
+    }
+
+    // Wider deltas could span more than 8 bytes
+    return width > MaxPackedWidth ? 64 : width;
 }
 
-uint8_t block_get_alignment_offset( uint8_t alignment, const uint64_t& offset )
+uint64_t delta_mask( uint8_t width )
 {
-    return static_cast<uint8_t>( alignment - offset % alignment );
+    return width == 64 ? std::numeric_limits<uint64_t>::max() : ( uint64_t{ 1 } << width ) - 1;
 }
 
-// Add a two bytes relative delta (0-16383) and inc pointer
-// First 2 bits are always 10
-void block_add_two_bytes_relative( uint8_t* block, BlockOffset& offset, uint16_t value )
+size_t group_data_size( uint8_t width )
 {
-    const uint8_t alignmentOffset = block_get_alignment_offset( alignof( uint16_t ), offset.get() );
-    if ( alignmentOffset != 0 ) {
-        *( block + offset.get() ) = 0xC0 | alignmentOffset;
-        offset += BlockOffset( alignmentOffset );
-    }
+    return ( ( IndexGroupSize - 1 ) * width + 7 ) / 8;
+}
 
-    // Stored in big endian format in order to recognise the initial pattern:
-    // 10xx xxxx xxxx xxxx
-    //  HO byte | LO byte
+// Read delta for line at indexInGroup (1-63)
+uint64_t group_delta( const uint8_t* group, uint8_t width, size_t indexInGroup )
+{
+    const auto bitOffset = ( indexInGroup - 1 ) * width;
 
-    *( reinterpret_cast<uint16_t*>( block + offset.get() ) )
-        = qToBigEndian( static_cast<uint16_t>( value | ( 1 << 15 ) ) );
-    offset += BlockOffset( sizeof( value ) );
+    uint64_t word;
+    std::memcpy( &word, group + bitOffset / 8, sizeof( word ) );
+    return ( qFromLittleEndian( word ) >> ( bitOffset % 8 ) ) & delta_mask( width );
 }
 
-template <typename ElementType>
-void block_add_absolute( uint8_t* block, BlockOffset& offset, ElementType value )
+// Sum of deltas for lines 1..count of the group
+uint64_t group_sum( const uint8_t* group, uint8_t width, size_t count )
 {
-    uint8_t alignmentOffset = block_get_alignment_offset( alignof( uint16_t ), offset.get() );
-    if ( alignmentOffset != 0 ) {
-        *( block + offset.get() ) = 0xC0 | alignmentOffset;
-        offset += BlockOffset( alignmentOffset );
+    uint64_t sum = 0;
+    for ( size_t i = 1; i <= count; ++i ) {
+        sum += group_delta( group, width, i );
     }
+    return sum;
+}
 
-    alignmentOffset
-        = block_get_alignment_offset( alignof( ElementType ), offset.get() + sizeof( uint16_t ) );
+template <typename ElementType>
+const BlockHeader<ElementType>* block_header( const uint8_t* block )
+{
+    return reinterpret_cast<const BlockHeader<ElementType>*>( block );
+}
 
-    // 2 bytes marker (actually only the first two bits are tested)
-    *( block + offset.get() ) = 0xFF;
-    *( block + offset.get() + 1 ) = alignmentOffset;
-    offset += BlockOffset( sizeof( uint16_t ) + alignmentOffset );
+template <typename ElementType>
+const uint8_t* block_group( const uint8_t* block, size_t group )
+{
+    const auto header = block_header<ElementType>( block );
 
-    // Absolute value (machine endian)
-    // This might be unaligned, can cause problem on some CPUs
-    *( reinterpret_cast<ElementType*>( block + offset.get() ) ) = value;
-    offset += BlockOffset( sizeof( ElementType ) );
+    auto data = block + sizeof( BlockHeader<ElementType> );
+    for ( size_t i = 0; i < group; ++i ) {
+        data += group_data_size( header->widths[ i ] );
+    }
+    return data;
 }
 
-// Initialise the passed block for reading, returning
-// the initial position and a pointer to the second entry.
+// Give the position of line at indexInBlock
 template <typename ElementType>
-LineOffset block_initial_pos( const uint8_t* block, BlockOffset& offset )
+LineOffset block_pos( const uint8_t* block, size_t indexInBlock )
 {
-    offset = BlockOffset( sizeof( ElementType ) );
-    return LineOffset( static_cast<LineOffset::UnderlyingType>(
-        *( reinterpret_cast<const ElementType*>( block ) ) ) );
+    const auto header = block_header<ElementType>( block );
+    const auto group = indexInBlock / IndexGroupSize;
+    const auto indexInGroup = indexInBlock % IndexGroupSize;
+
+    uint64_t pos = header->initialPosition;
+    if ( group > 0 ) {
+        pos += header->groupPositions[ group - 1 ];
+    }
+    if ( indexInGroup > 0 ) {
+        pos += group_sum( block_group<ElementType>( block, group ), header->widths[ group ],
+                          indexInGroup );
+    }
+
+    return LineOffset( static_cast<LineOffset::UnderlyingType>( static_cast<ElementType>( pos ) ) );
 }
 
-// Give the next position in the block based on the previous
-// position, then increase the pointer.
+// Give the position of line at indexInBlock based on the previous
+// position, line must not be the first in its group.
 template <typename ElementType>
-LineOffset block_next_pos( const uint8_t* block, BlockOffset& offset, LineOffset previous_pos )
+LineOffset block_next_pos( const uint8_t* block, size_t indexInBlock, LineOffset previousPos )
 {
-    LineOffset pos = previous_pos;
+    const auto header = block_header<ElementType>( block );
+    const auto group = indexInBlock / IndexGroupSize;
 
-    uint8_t byte = *( block + offset.get() );
+    const auto pos = static_cast<uint64_t>( previousPos.get() )
+                     + group_delta( block_group<ElementType>( block, group ),
+                                    header->widths[ group ], indexInBlock % IndexGroupSize );
 
-    if ( !( byte & 0x80 ) ) {
-        // High order bit is 0
-        pos += LineOffset( byte );
-        ++offset;
-        return pos;
+    return LineOffset( static_cast<LineOffset::UnderlyingType>( static_cast<ElementType>( pos ) ) );
+}
+
+// Pack deltas of the group one after another, data must have
+// group_data_size( width ) bytes
+void group_pack( uint8_t* group, uint8_t width, const uint64_t* deltas, size_t count )
+{
+    if ( width == 64 ) {
+        for ( size_t i = 0; i < count; ++i ) {
+            const auto delta = qToLittleEndian( deltas[ i ] );
+            std::memcpy( group + i * sizeof( delta ), &delta, sizeof( delta ) );
+        }
+        return;
     }
 
-    if ( byte != 0xFF && ( byte & 0xC0 ) == 0xC0 ) {
-        // need to skip aligned bytes;
-        const auto alignmentOffset = static_cast<uint8_t>( byte & ( ~0xC0 ) );
-        offset += BlockOffset( alignmentOffset );
-        byte = *( block + offset.get() );
+    // Whole bytes are written as soon as they are filled, so at most 7 bits
+    // are pending and a delta of up to 56 bits always fits the accumulator
+    uint64_t pending = 0;
+    uint8_t pendingBits = 0;
+    for ( size_t i = 0; i < count; ++i ) {
+        pending |= deltas[ i ] << pendingBits;
+        pendingBits = static_cast<uint8_t>( pendingBits + width );
+        while ( pendingBits >= 8 ) {
+            *group++ = static_cast<uint8_t>( pending );
+            pending >>= 8;
+            pendingBits = static_cast<uint8_t>( pendingBits - 8 );
+        }
     }
-    ++offset;
+    if ( pendingBits > 0 ) {
+        *group = static_cast<uint8_t>( pending );
+    }
+}
+
+// Pack count (up to IndexBlockSize) positions into the block, returning the size used
+template <typename ElementType>
+size_t block_pack( uint8_t* block, const LineOffset* positions, size_t count )
+{
+    auto header = reinterpret_cast<BlockHeader<ElementType>*>( block );
+    header->initialPosition = static_cast<ElementType>( positions[ 0 ].get() );
+    header->groupPositions.fill( 0 );
+    header->widths.fill( 0 );
 
-    if ( ( byte & 0xC0 ) == 0x80 ) {
-        // Remove the starting 10b
-        const auto hi_byte = static_cast<uint16_t>( byte & ( ~0xC0 ) );
-        // We need to read the low order byte
-        const auto lo_byte = static_cast<uint16_t>( *( block + offset.get() ) );
-        // And form the displacement (stored as big endian)
-        pos += LineOffset( ( hi_byte << 8 ) | lo_byte );
+    std::array<uint64_t, IndexGroupSize - 1> deltas;
 
-        ++offset;
+    auto data = block + sizeof( BlockHeader<ElementType> );
+    for ( size_t group = 0; group * IndexGroupSize < count; ++group ) {
+        const auto begin = positions + group * IndexGroupSize;
+        const auto groupSize = std::min( count - group * IndexGroupSize, IndexGroupSize );
+
+        if ( group > 0 ) {
+            header->groupPositions[ group - 1 ]
+                = static_cast<ElementType>( ( begin[ 0 ] - positions[ 0 ] ).get() );
+        }
+
+        // Independent subtractions and a bitwise or of all deltas instead of
+        // their maximum, it has the same width and the loop is vectorized
+        uint64_t deltaBits = 0;
+        for ( size_t i = 1; i < groupSize; ++i ) {
+            deltas[ i - 1 ] = static_cast<uint64_t>( begin[ i ].get() - begin[ i - 1 ].get() );
+            deltaBits |= deltas[ i - 1 ];
+        }
+
+        const auto width = delta_width( deltaBits );
+        header->widths[ group ] = width;
+
+        std::memset( data, 0, group_data_size( width ) );
+        group_pack( data, width, deltas.data(), groupSize - 1 );
+
+        data += group_data_size( width );
     }
-    else {
-        // skip aligned bytes
-        const auto alignmentOffset = *( block + offset.get() );
-        offset += BlockOffset( alignmentOffset + 1u );
 
-        // And read the new absolute pos (machine endian)
-        pos = LineOffset( static_cast<LineOffset::UnderlyingType>(
-            *( reinterpret_cast<const ElementType*>( block + offset.get() ) ) ) );
-        offset += BlockOffset( sizeof( ElementType ) );
+    std::memset( data, 0, ReadPadding );
+    return static_cast<size_t>( data - block ) + ReadPadding;
+}
+
+// Append first count positions of the block to the vector
+template <typename ElementType>
+void block_unpack( const uint8_t* block, size_t count, std::vector<LineOffset>& positions )
+{
+    LineOffset position;
+    for ( size_t i = 0; i < count; ++i ) {
+        position = ( i % IndexGroupSize == 0 ) ? block_pos<ElementType>( block, i )
+                                                : block_next_pos<ElementType>( block, i, position );
+        positions.push_back( position );
+    }
+}
+
+// Append positions of lines [first, last) of the pool
+template <typename ElementType>
+void pool_range( const BlockPool<ElementType>& pool, uint64_t first, uint64_t last,
+                 std::vector<qint64>& positions )
+{
+    LineOffset position;
+    for ( auto index = first; index < last; ++index ) {
+        const auto block = pool.at( static_cast<size_t>( index / IndexBlockSize ) );
+        const auto indexInBlock = static_cast<size_t>( index % IndexBlockSize );
+
+        position = ( index == first || indexInBlock % IndexGroupSize == 0 )
+                       ? block_pos<ElementType>( block, indexInBlock )
+                       : block_next_pos<ElementType>( block, indexInBlock, position );
+        positions.push_back( position.get() );
+    }
+}
+
+template <typename ElementType>
+LineOffset pool_pos( const BlockPool<ElementType>& pool, uint64_t indexInPool,
+                     const std::optional<LineOffset>& previousPos )
+{
+    const auto block = pool.at( static_cast<size_t>( indexInPool / IndexBlockSize ) );
+    const auto indexInBlock = static_cast<size_t>( indexInPool % IndexBlockSize );
+
+    if ( previousPos && indexInBlock % IndexGroupSize != 0 ) {
+        return block_next_pos<ElementType>( block, indexInBlock, *previousPos );
     }
 
-    return pos;
+    return block_pos<ElementType>( block, indexInBlock );
 }
 } // namespace
 
+CompressedLinePositionStorage::CompressedLinePositionStorage()
+{
+    current_block_.reserve( IndexBlockSize );
+}
+
+CompressedLinePositionStorage::CompressedLinePositionStorage( bool isFileBacked )
+    : pool32_( isFileBacked )
+    , pool64_( isFileBacked )
+{
+    current_block_.reserve( IndexBlockSize );
+}
+
 void CompressedLinePositionStorage::move_from( CompressedLinePositionStorage&& orig ) noexcept
 {
     nb_lines_ = orig.nb_lines_;
     first_long_line_ = orig.first_long_line_;
     current_pos_ = orig.current_pos_;
-    block_index_ = orig.block_index_;
-    long_block_index_ = orig.long_block_index_;
-    block_offset_ = orig.block_offset_;
-    previous_block_offset_ = orig.previous_block_offset_;
+    current_block_ = std::move( orig.current_block_ );
 
     orig.nb_lines_ = 0_lcount;
+    orig.current_block_.clear();
 }
 
 // Move constructor
@@ -199,90 +321,68 @@ CompressedLinePositionStorage::operator=( CompressedLinePositionStorage&& orig )
     return *this;
 }
 
-void CompressedLinePositionStorage::append( LineOffset pos )
+void CompressedLinePositionStorage::seal_block( const LineOffset* positions, size_t count )
 {
-    // Lines must be stored in order
-    assert( ( pos > current_pos_ ) || ( pos == 0_offset ) );
-
-    // Save the pointer in case we need to "pop_back"
-    previous_block_offset_ = block_offset_;
-
-    bool store_in_big = false;
-    if ( pos.get() > std::numeric_limits<uint32_t>::max() ) {
-        store_in_big = true;
-        if ( !first_long_line_ ) {
-            // First "big" end of line, we will start a new (64) block
-            first_long_line_ = LineNumber( nb_lines_.get() );
-            block_offset_ = {};
-        }
-    }
-
-    if ( !block_offset_.get() ) {
-        // We need to start a new block
-        if ( !store_in_big ) {
-            block_index_ = pool32_.get_block( IndexBlockSize, static_cast<uint32_t>( pos.get() ),
-                                              &block_offset_.get() );
-        }
-        else {
-            long_block_index_ = pool64_.get_block(
-                IndexBlockSize, static_cast<uint64_t>( pos.get() ), &block_offset_.get() );
-        }
+    if ( !first_long_line_ ) {
+        const auto blockIndex = pool32_.get_block(
+            IndexBlockSize, static_cast<uint32_t>( positions[ 0 ].get() ), nullptr );
+        const auto blockSize = block_pack<uint32_t>( pool32_.at( blockIndex ), positions, count );
+        pool32_.resize_last_block( blockSize );
     }
     else {
-        const auto block
-            = ( !store_in_big ) ? pool32_.at(block_index_) : pool64_.at(long_block_index_);
-        auto delta = pos - current_pos_;
-        if ( delta < 128_offset ) {
-            // Code relative on one byte
-            block_add_one_byte_relative( block, block_offset_,
-                                         static_cast<uint8_t>( delta.get() ) );
-        }
-        else if ( delta < 16384_offset ) {
-            // Code relative on two bytes
-            block_add_two_bytes_relative( block, block_offset_,
-                                          static_cast<uint16_t>( delta.get() ) );
-        }
-        else {
-            // Code absolute
-            if ( !store_in_big )
-                block_add_absolute<uint32_t>( block, block_offset_,
-                                              static_cast<uint32_t>( pos.get() ) );
-            else
-                block_add_absolute<uint64_t>( block, block_offset_,
-                                              static_cast<uint64_t>( pos.get() ) );
-        }
+        const auto blockIndex = pool64_.get_block(
+            IndexBlockSize, static_cast<uint64_t>( positions[ 0 ].get() ), nullptr );
+        const auto blockSize = block_pack<uint64_t>( pool64_.at( blockIndex ), positions, count );
+        pool64_.resize_last_block( blockSize );
     }
+}
 
-    current_pos_ = pos;
-    ++nb_lines_;
-
-    const auto shrinkBlock = [ this ]( auto& blockPool ) {
-        const auto effective_block_size = previous_block_offset_.get();
+void CompressedLinePositionStorage::seal_current_block()
+{
+    seal_block( current_block_.data(), current_block_.size() );
+    current_block_.clear();
+}
 
-        // We allocate extra space for the last element in case it
-        // is replaced by an absolute value in the future (following a pop_back)
-        const auto new_size = effective_block_size + blockPool.getPaddedElementSize();
-        blockPool.resize_last_block( new_size );
+void CompressedLinePositionStorage::unseal_last_block()
+{
+    assert( current_block_.empty() );
 
-        block_offset_ = {};
-        previous_block_offset_ = BlockOffset( effective_block_size );
-    };
+    if ( !first_long_line_ ) {
+        const auto linesInBlock = ( nb_lines_.get() - 1 ) % IndexBlockSize + 1;
+        block_unpack<uint32_t>( pool32_.at( pool32_.currentBlock() ), linesInBlock,
+                                current_block_ );
+        pool32_.free_last_block();
+    }
+    else {
+        const auto linesInBlock
+            = ( nb_lines_.get() - first_long_line_->get() - 1 ) % IndexBlockSize + 1;
+        block_unpack<uint64_t>( pool64_.at( pool64_.currentBlock() ), linesInBlock,
+                                current_block_ );
+        pool64_.free_last_block();
+    }
+}
 
-    if ( !store_in_big ) {
-        if ( nb_lines_.get() % IndexBlockSize == 0 ) {
-            // We have finished the block
+void CompressedLinePositionStorage::append( LineOffset pos )
+{
+    // Lines must be stored in order
+    assert( ( pos > current_pos_ ) || ( pos == 0_offset ) );
 
-            // Let's reduce its size to what is actually used
-            shrinkBlock( pool32_ );
+    if ( pos.get() > std::numeric_limits<uint32_t>::max() && !first_long_line_ ) {
+        // First "big" end of line, we will start a new (64) block
+        if ( !current_block_.empty() ) {
+            seal_current_block();
         }
+        first_long_line_ = LineNumber( nb_lines_.get() );
     }
-    else {
-        if ( ( nb_lines_.get() - first_long_line_->get() ) % IndexBlockSize == 0 ) {
-            // We have finished the block
 
-            // Let's reduce its size to what is actually used
-            shrinkBlock( pool64_ );
-        }
+    current_block_.push_back( pos );
+
+    current_pos_ = pos;
+    ++nb_lines_;
+
+    if ( current_block_.size() == IndexBlockSize ) {
+        // We have finished the block
+        seal_current_block();
     }
 }
 
@@ -293,100 +393,176 @@ LineOffset CompressedLinePositionStorage::at( LineNumber index, Cache* lastPosit
         throw std::runtime_error("Line number not in storage");
     }
 
-    auto last_read = lastPosition != nullptr ? *lastPosition : Cache{};
-
-    const uint8_t* block = nullptr;
-    BlockOffset offset;
-    LineOffset position;
-
-    if ( !first_long_line_ || index < *first_long_line_ ) {
-        block = pool32_.at(index.get() / IndexBlockSize);
-
-        if ( ( index.get() == last_read.index.get() + 1 )
-             && ( index.get() % IndexBlockSize != 0 ) ) {
-            position = last_read.position;
-            offset = last_read.offset;
+    std::optional<LineOffset> previousPos;
+    if ( lastPosition != nullptr && index.get() == lastPosition->index.get() + 1 ) {
+        previousPos = lastPosition->position;
+    }
 
-            position = block_next_pos<uint32_t>( block, offset, position );
-        }
-        else {
-            position = block_initial_pos<uint32_t>( block, offset );
+    const auto currentBlockStart = nb_lines_.get() - current_block_.size();
 
-            for ( uint32_t i = 0; i < index.get() % IndexBlockSize; i++ ) {
-                // Go through all the lines in the block till the one we want
-                position = block_next_pos<uint32_t>( block, offset, position );
-            }
-        }
+    LineOffset position;
+    if ( index.get() >= currentBlockStart ) {
+        position = current_block_[ static_cast<size_t>( index.get() - currentBlockStart ) ];
+    }
+    else if ( !first_long_line_ || index < *first_long_line_ ) {
+        position = pool_pos( pool32_, index.get(), previousPos );
     }
     else {
-        const auto index_in_64 = index - *first_long_line_;
-        block = pool64_.at(index_in_64.get() / IndexBlockSize);
-
-        if ( ( index.get() == last_read.index.get() + 1 )
-             && ( index_in_64.get() % IndexBlockSize != 0 ) ) {
-            position = last_read.position;
-            offset = last_read.offset;
-
-            position = block_next_pos<uint64_t>( block, offset, position );
-        }
-        else {
-            position = block_initial_pos<uint64_t>( block, offset );
-
-            for ( uint32_t i = 0; i < index_in_64.get() % IndexBlockSize; i++ ) {
-                // Go through all the lines in the block till the one we want
-                position = block_next_pos<uint64_t>( block, offset, position );
-            }
-        }
+        position = pool_pos( pool64_, index.get() - first_long_line_->get(), previousPos );
     }
 
     // Populate our cache ready for next consecutive read
     if ( lastPosition != nullptr ) {
         lastPosition->index = index;
         lastPosition->position = position;
-        lastPosition->offset = offset;
     }
 
     return position;
 }
 
-void CompressedLinePositionStorage::append_list( const std::vector<LineOffset>& positions )
+void CompressedLinePositionStorage::range( LineNumber first, LinesCount count,
+                                           std::vector<qint64>& positions ) const
 {
-    // This is not very clever, but caching should make it
-    // reasonably fast.
-    for ( auto position : positions )
-        append( position );
-}
+    const auto last = first.get() + count.get();
+    if ( last > nb_lines_.get() ) {
+        LOG_ERROR << "Line range not in storage: " << first.get() << " " << count.get()
+                  << ", storage size is " << nb_lines_;
+        throw std::runtime_error( "Line range not in storage" );
+    }
 
-void CompressedLinePositionStorage::pop_back()
-{
-    // Removing the last entered data, there are two cases
-    if ( previous_block_offset_.get() ) {
-        // The last append was a normal entry in an existing block,
-        // so we can just revert the pointer
-        block_offset_ = previous_block_offset_;
-        previous_block_offset_ = {};
+    positions.reserve( positions.size() + static_cast<size_t>( count.get() ) );
+
+    const auto currentBlockStart = nb_lines_.get() - current_block_.size();
+    const auto longLinesStart = first_long_line_ ? first_long_line_->get() : currentBlockStart;
+
+    if ( first.get() < longLinesStart ) {
+        pool_range( pool32_, first.get(), std::min( last, longLinesStart ), positions );
+    }
+
+    if ( first_long_line_ && last > longLinesStart && first.get() < currentBlockStart ) {
+        pool_range( pool64_, std::max( first.get(), longLinesStart ) - longLinesStart,
+                    std::min( last, currentBlockStart ) - longLinesStart, positions );
     }
-    else {
-        // A new block has been created for the last entry, we need
-        // to de-alloc it.
 
-        if ( !first_long_line_ ) {
-            assert( ( nb_lines_.get() - 1 ) % IndexBlockSize == 0 );
-            block_index_ = pool32_.free_last_block();
+    for ( auto index = std::max( first.get(), currentBlockStart ); index < last; ++index ) {
+        positions.push_back(
+            current_block_[ static_cast<size_t>( index - currentBlockStart ) ].get() );
+    }
+}
+
+void CompressedLinePositionStorage::append_list( const std::vector<LineOffset>& positions )
+{
+    auto next = positions.data();
+    const auto end = next + positions.size();
+
+    while ( next != end ) {
+        // Whole blocks are packed straight from the list, without copying
+        // positions to the current block. Lines before them complete the
+        // current block, and block that has the first position past
+        // UINT32_MAX is added line by line to start the 64 bit pool.
+        const auto isWholeBlock = current_block_.empty()
+                                  && static_cast<size_t>( end - next ) >= IndexBlockSize;
+        if ( isWholeBlock
+             && ( first_long_line_
+                  || next[ IndexBlockSize - 1 ].get() <= std::numeric_limits<uint32_t>::max() ) ) {
+            assert( next[ 0 ] > current_pos_ || next[ 0 ] == 0_offset );
+
+            seal_block( next, IndexBlockSize );
+            next += IndexBlockSize;
+
+            current_pos_ = *( next - 1 );
+            nb_lines_ += LinesCount( IndexBlockSize );
         }
         else {
-            assert( ( nb_lines_.get() - first_long_line_->get() - 1 ) % IndexBlockSize == 0 );
-            long_block_index_ = pool64_.free_last_block();
+            append( *next++ );
         }
+    }
+}
 
-        block_offset_ = {};
+void CompressedLinePositionStorage::pop_back()
+{
+    if ( current_block_.empty() ) {
+        // The last append finished a block, we need
+        // to unpack it to remove the entry.
+        unseal_last_block();
     }
 
+    current_block_.pop_back();
     --nb_lines_;
+
+    if ( first_long_line_ && nb_lines_.get() == first_long_line_->get() ) {
+        // No more "big" lines, continue last block32 if it was not finished
+        first_long_line_ = {};
+        if ( nb_lines_.get() % IndexBlockSize != 0 ) {
+            unseal_last_block();
+        }
+    }
+
     current_pos_ = nb_lines_.get() > 0 ? at( nb_lines_.get() - 1 ) : 0_offset;
 }
 
 size_t CompressedLinePositionStorage::allocatedSize() const
 {
-    return pool32_.allocatedSize() + pool64_.allocatedSize();
-}
\ No newline at end of file
+    return pool32_.allocatedSize() + pool64_.allocatedSize()
+           + current_block_.capacity() * sizeof( LineOffset );
+}
+
+size_t CompressedLinePositionStorage::residentSize() const
+{
+    return pool32_.residentSize() + pool64_.residentSize()
+           + current_block_.capacity() * sizeof( LineOffset );
+}
+
+void CompressedLinePositionStorage::save( QDataStream& stream ) const
+{
+    stream << static_cast<quint64>( nb_lines_.get() )
+           << static_cast<qint64>( current_pos_.get() )
+           << static_cast<bool>( first_long_line_ )
+           << static_cast<quint64>( first_long_line_.value_or( 0_lnum ).get() );
+
+    stream << static_cast<quint64>( current_block_.size() );
+    for ( const auto& position : current_block_ ) {
+        stream << static_cast<qint64>( position.get() );
+    }
+
+    pool32_.save( stream );
+    pool64_.save( stream );
+}
+
+bool CompressedLinePositionStorage::load( QDataStream& stream )
+{
+    quint64 nbLines = 0;
+    qint64 currentPos = 0;
+    bool hasLongLines = false;
+    quint64 firstLongLine = 0;
+    quint64 currentBlockSize = 0;
+
+    stream >> nbLines >> currentPos >> hasLongLines >> firstLongLine >> currentBlockSize;
+
+    if ( stream.status() != QDataStream::Ok || currentBlockSize >= IndexBlockSize
+         || currentBlockSize > nbLines
+         || !isCountInStream( stream, currentBlockSize, sizeof( qint64 ) ) ) {
+        return false;
+    }
+
+    CompressedLinePositionStorage loaded;
+    for ( auto i = 0u; i < currentBlockSize; ++i ) {
+        qint64 position = 0;
+        stream >> position;
+        loaded.current_block_.emplace_back( position );
+    }
+
+    if ( stream.status() != QDataStream::Ok || !loaded.pool32_.load( stream )
+         || !loaded.pool64_.load( stream ) ) {
+        return false;
+    }
+
+    loaded.nb_lines_ = LinesCount( nbLines );
+    loaded.current_pos_ = LineOffset( currentPos );
+    if ( hasLongLines ) {
+        loaded.first_long_line_ = LineNumber( firstLongLine );
+    }
+
+    *this = std::move( loaded );
+    return true;
+}
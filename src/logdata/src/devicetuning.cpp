@@ -0,0 +1,368 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "devicetuning.h"
+
+#include <algorithm>
+#include <cmath>
+#include <optional>
+#include <string_view>
+#include <thread>
+
+#include <QDataStream>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QStorageInfo>
+
+#if defined( Q_OS_LINUX ) || defined( Q_OS_FREEBSD )
+#include <fcntl.h>
+#define KLOGG_HAS_FADVISE
+#endif
+
+#include "configuration.h"
+#include "log.h"
+#include "regularexpression.h"
+
+namespace {
+constexpr quint32 DeviceTuningMagic = 0x4B4C4454; // KLDT
+constexpr quint32 DeviceTuningVersion = 1;
+
+constexpr qint64 SequentialReadBlock = 1024 * 1024;
+constexpr qint64 RandomReadSize = 4096;
+// Matching speed is measured on the beginning of sequentially read data
+constexpr qint64 MatchedSize = 4 * 1024 * 1024;
+constexpr int BaseSearchReadBufferLines = 100000;
+constexpr int MaxSearchReadBufferLines = 1000000;
+
+double megabytes( qint64 bytes )
+{
+    return static_cast<double>( bytes ) / ( 1024 * 1024 );
+}
+
+double seconds( qint64 nanoseconds )
+{
+    return static_cast<double>( std::max( qint64{ 1 }, nanoseconds ) ) / 1e9;
+}
+
+// Drops pages of the range from page cache, so they are read from the device
+void dropCachedRange( QFile& file, qint64 offset, qint64 length )
+{
+#ifdef KLOGG_HAS_FADVISE
+    const auto result = ::posix_fadvise( file.handle(), offset, length, POSIX_FADV_DONTNEED );
+    if ( result != 0 ) {
+        LOG_DEBUG << "posix_fadvise failed " << result;
+    }
+#else
+    Q_UNUSED( file );
+    Q_UNUSED( offset );
+    Q_UNUSED( length );
+#endif
+}
+
+std::optional<DeviceTuning::Calibration> measure( QFile& file,
+                                                  const AtomicFlag& interruptRequested )
+{
+    DeviceTuning::Calibration calibration;
+    QElapsedTimer timer;
+
+    const auto sequentialSize = std::min( file.size(), DeviceTuning::SequentialReadSize );
+    dropCachedRange( file, 0, sequentialSize );
+
+    QByteArray matchedData;
+    QByteArray buffer( static_cast<int>( SequentialReadBlock ), Qt::Uninitialized );
+    qint64 readBytes = 0;
+    timer.start();
+    while ( readBytes < sequentialSize ) {
+        if ( interruptRequested ) {
+            return {};
+        }
+        const auto read = file.read( buffer.data(), SequentialReadBlock );
+        if ( read <= 0 ) {
+            return {};
+        }
+        if ( readBytes < MatchedSize ) {
+            matchedData.append( buffer.constData(), static_cast<int>( read ) );
+        }
+        readBytes += read;
+    }
+    calibration.readMbPerSecond = megabytes( readBytes ) / seconds( timer.nsecsElapsed() );
+
+    // Random reads are spread over the file, each page is dropped
+    // from page cache first in case it was just read
+    const auto randomRange = file.size() - RandomReadSize;
+    qint64 randomReadNs = 0;
+    for ( auto i = 0; i < DeviceTuning::RandomReads; ++i ) {
+        const auto offset = randomRange * ( 2 * i + 1 ) / ( 2 * DeviceTuning::RandomReads );
+        dropCachedRange( file, offset, RandomReadSize );
+
+        timer.start();
+        if ( interruptRequested || !file.seek( offset )
+             || file.read( buffer.data(), RandomReadSize ) <= 0 ) {
+            return {};
+        }
+        randomReadNs += timer.nsecsElapsed();
+    }
+    calibration.readLatencyMs = static_cast<double>( randomReadNs ) / 1e6
+                                / static_cast<double>( DeviceTuning::RandomReads );
+
+    // Pattern that has to be tried at every position of lines, like most searches
+    const RegularExpression expression( RegularExpressionPattern(
+        "calibration [0-9]+ (failed|timed out)", false, false, false, false ) );
+    const auto matcher = expression.createMatcher();
+
+    std::vector<std::string_view> lines;
+    std::string_view data( matchedData.constData(), static_cast<size_t>( matchedData.size() ) );
+    while ( !data.empty() ) {
+        const auto lineEnd = std::min( data.find( '\n' ), data.size() );
+        lines.push_back( data.substr( 0, lineEnd ) );
+        data.remove_prefix( std::min( lineEnd + 1, data.size() ) );
+    }
+
+    timer.start();
+    size_t matches = 0;
+    for ( const auto& line : lines ) {
+        matches += matcher->hasMatch( line ) ? 1 : 0;
+    }
+    calibration.matchMbPerSecond
+        = megabytes( matchedData.size() ) / seconds( timer.nsecsElapsed() );
+
+    LOG_DEBUG << "Calibration matched " << matches << " of " << lines.size() << " lines";
+    return calibration;
+}
+
+QDataStream& operator<<( QDataStream& stream, const DeviceTuning::Calibration& calibration )
+{
+    return stream << calibration.mountPoint << calibration.device << calibration.time
+                  << calibration.readMbPerSecond << calibration.readLatencyMs
+                  << calibration.matchMbPerSecond;
+}
+
+QDataStream& operator>>( QDataStream& stream, DeviceTuning::Calibration& calibration )
+{
+    return stream >> calibration.mountPoint >> calibration.device >> calibration.time
+           >> calibration.readMbPerSecond >> calibration.readLatencyMs
+           >> calibration.matchMbPerSecond;
+}
+} // namespace
+
+DeviceTuning& DeviceTuning::get()
+{
+    static DeviceTuning tuning;
+    return tuning;
+}
+
+DeviceTuning::DeviceTuning()
+    : path_( QStandardPaths::writableLocation( QStandardPaths::CacheLocation )
+             + QDir::separator() + "device_tuning" )
+{
+}
+
+bool DeviceTuning::isEnabled() const
+{
+    return Configuration::get().useDeviceTuning();
+}
+
+QString DeviceTuning::mountPoint( const QString& fileName )
+{
+    const QStorageInfo storage( QFileInfo( fileName ).absolutePath() );
+    return storage.isValid() ? storage.rootPath() : QString{};
+}
+
+DeviceTuning::Parameters DeviceTuning::tune( double readMbPerSecond, double readLatencyMs,
+                                             double matchMbPerSecond, int cores )
+{
+    Parameters parameters;
+
+    // Enough threads to match data as fast as the device reads it,
+    // searches of cached files still use at least half of the cores
+    const auto readingThreads
+        = std::ceil( readMbPerSecond / std::max( 1.0, matchMbPerSecond ) );
+    parameters.searchThreadPoolSize
+        = qBound( qMax( 1, cores / 2 ), static_cast<int>( std::min( readingThreads, 1024.0 ) ),
+                  qMax( 1, cores ) );
+
+    // Read ahead covers a quarter of a second of reading
+    // and a few requests waiting for the device
+    const auto readAheadMb = readMbPerSecond * ( 0.25 + 8 * readLatencyMs / 1000 );
+    parameters.indexReadBufferSizeMb
+        = qBound( 4, static_cast<int>( std::ceil( std::min( readAheadMb, 1e6 ) ) ), 256 );
+
+    // Slow requests are amortized over bigger chunks of lines
+    const auto chunkScale = qBound( 1.0, 1 + readLatencyMs / 2, 10.0 );
+    parameters.searchReadBufferSizeLines = std::min(
+        MaxSearchReadBufferLines, static_cast<int>( BaseSearchReadBufferLines * chunkScale ) );
+
+    return parameters;
+}
+
+void DeviceTuning::calibrate( const QString& fileName, const AtomicFlag& interruptRequested )
+{
+    if ( !isEnabled() ) {
+        return;
+    }
+
+    QFile file( fileName );
+    const QStorageInfo storage( QFileInfo( fileName ).absolutePath() );
+    if ( file.size() < MinCalibrationFileSize || !storage.isValid() ) {
+        return;
+    }
+
+    const auto mountPoint = storage.rootPath();
+    {
+        ScopedLock lock( mutex_ );
+        load();
+        if ( calibrations_.count( mountPoint ) > 0 || !calibrating_.insert( mountPoint ).second ) {
+            return;
+        }
+    }
+
+    LOG_INFO << "Calibrating " << mountPoint << " with " << fileName;
+
+    std::optional<Calibration> calibration;
+    if ( file.open( QIODevice::ReadOnly ) ) {
+        calibration = measure( file, interruptRequested );
+    }
+
+    ScopedLock lock( mutex_ );
+    calibrating_.erase( mountPoint );
+    if ( !calibration ) {
+        LOG_INFO << "Calibration of " << mountPoint << " did not finish";
+        return;
+    }
+
+    calibration->mountPoint = mountPoint;
+    calibration->device = storage.device();
+    calibration->time = QDateTime::currentDateTime();
+    calibration->parameters = tune( calibration->readMbPerSecond, calibration->readLatencyMs,
+                                    calibration->matchMbPerSecond,
+                                    static_cast<int>( std::thread::hardware_concurrency() ) );
+
+    LOG_INFO << "Calibrated " << mountPoint << ": read " << calibration->readMbPerSecond
+             << " MiB/s, latency " << calibration->readLatencyMs << " ms, match "
+             << calibration->matchMbPerSecond << " MiB/s per thread";
+
+    calibrations_[ mountPoint ] = *calibration;
+    save();
+}
+
+DeviceTuning::Parameters DeviceTuning::parameters( const QString& fileName ) const
+{
+    const auto& config = Configuration::get();
+    Parameters parameters{ config.searchThreadPoolSize(), config.indexReadBufferSizeMb(),
+                           config.searchReadBufferSizeLines() };
+    if ( !isEnabled() ) {
+        return parameters;
+    }
+
+    const auto mount = mountPoint( fileName );
+
+    ScopedLock lock( mutex_ );
+    load();
+    const auto calibration = calibrations_.find( mount );
+    return calibration != calibrations_.end() ? calibration->second.parameters : parameters;
+}
+
+std::vector<DeviceTuning::Calibration> DeviceTuning::calibrations() const
+{
+    ScopedLock lock( mutex_ );
+    load();
+
+    std::vector<Calibration> calibrations;
+    for ( const auto& calibration : calibrations_ ) {
+        calibrations.push_back( calibration.second );
+    }
+    return calibrations;
+}
+
+void DeviceTuning::clear()
+{
+    ScopedLock lock( mutex_ );
+    isLoaded_ = true;
+    calibrations_.clear();
+    QFile::remove( path_ );
+}
+
+void DeviceTuning::load() const
+{
+    if ( isLoaded_ ) {
+        return;
+    }
+    isLoaded_ = true;
+
+    QFile file( path_ );
+    if ( !file.open( QIODevice::ReadOnly ) ) {
+        return;
+    }
+
+    QDataStream stream( &file );
+    stream.setVersion( QDataStream::Qt_5_9 );
+
+    quint32 magic = 0;
+    quint32 version = 0;
+    quint32 count = 0;
+    stream >> magic >> version >> count;
+    if ( stream.status() != QDataStream::Ok || magic != DeviceTuningMagic
+         || version != DeviceTuningVersion ) {
+        LOG_WARNING << "Ignoring device calibrations in " << path_;
+        return;
+    }
+
+    const auto cores = static_cast<int>( std::thread::hardware_concurrency() );
+    for ( auto i = 0u; i < count && stream.status() == QDataStream::Ok; ++i ) {
+        Calibration calibration;
+        stream >> calibration;
+        // Parameters follow changes of the tuning and of the number of cores
+        calibration.parameters
+            = tune( calibration.readMbPerSecond, calibration.readLatencyMs,
+                    calibration.matchMbPerSecond, cores );
+        calibrations_[ calibration.mountPoint ] = calibration;
+    }
+
+    LOG_INFO << "Loaded calibrations of " << calibrations_.size() << " mount points";
+}
+
+void DeviceTuning::save() const
+{
+    if ( !QDir().mkpath( QFileInfo( path_ ).absolutePath() ) ) {
+        LOG_WARNING << "Failed to create directory for " << path_;
+        return;
+    }
+
+    QSaveFile file( path_ );
+    if ( !file.open( QIODevice::WriteOnly ) ) {
+        LOG_WARNING << "Failed to open " << path_;
+        return;
+    }
+
+    QDataStream stream( &file );
+    stream.setVersion( QDataStream::Qt_5_9 );
+    stream << DeviceTuningMagic << DeviceTuningVersion
+           << static_cast<quint32>( calibrations_.size() );
+    for ( const auto& calibration : calibrations_ ) {
+        stream << calibration.second;
+    }
+
+    if ( stream.status() != QDataStream::Ok || !file.commit() ) {
+        LOG_WARNING << "Failed to save device calibrations to " << path_;
+    }
+}
@@ -19,8 +19,14 @@
 
 #include "encodingdetector.h"
 
+#include <algorithm>
+#include <cstdint>
+#include <map>
+
 #include <QTextCodec>
 
+#include <tbb/parallel_for.h>
+
 #include "log.h"
 #include <uchardet.h>
 
@@ -62,6 +68,28 @@ class UchardetHolder {
     uchardet_t ud_;
 };
 
+struct SampleGuess {
+    QByteArray charset;
+    size_t nonAsciiBytes = 0;
+};
+
+// Each sample uses its own uchardet instance, so samples can be guessed in parallel
+SampleGuess guessSampleEncoding( const QByteArray& sample )
+{
+    SampleGuess guess;
+    guess.nonAsciiBytes = static_cast<size_t>(
+        std::count_if( sample.begin(), sample.end(),
+                       []( char c ) { return static_cast<uint8_t>( c ) >= 0x80; } ) );
+
+    UchardetHolder ud;
+    if ( ud.handle_data( sample.data(), static_cast<size_t>( sample.size() ) ) == 0 ) {
+        ud.data_end();
+        guess.charset = ud.get_charset();
+    }
+
+    return guess;
+}
+
 } // namespace
 
 EncodingParameters::EncodingParameters( const QTextCodec* codec )
@@ -70,9 +98,12 @@ EncodingParameters::EncodingParameters( const QTextCodec* codec )
     static constexpr int Utf8Mib = 106;
     static constexpr int Utf16LEMib = 1014;
     static constexpr int UsAsciiMib = 3;
+    static constexpr int Latin1Mib = 4;
 
     isUtf8Compatible = codec->mibEnum() == Utf8Mib || codec->mibEnum() == UsAsciiMib;
     isUtf16LE = codec->mibEnum() == Utf16LEMib;
+    isUtf8 = codec->mibEnum() == Utf8Mib;
+    isLatin1 = codec->mibEnum() == Latin1Mib;
 
     QTextCodec::ConverterState convertState( QTextCodec::IgnoreHeader );
     QByteArray encodedLineFeed = codec->fromUnicode( &LineFeed, 1, &convertState );
@@ -84,30 +115,56 @@ EncodingParameters::EncodingParameters( const QTextCodec* codec )
 
 QTextCodec* EncodingDetector::detectEncoding( const QByteArray& block ) const
 {
-    UniqueLock lock( mutex_ );
+    return detectEncoding( std::vector<QByteArray>{ block } );
+}
 
-    UchardetHolder ud;
+QTextCodec* EncodingDetector::detectEncoding( const std::vector<QByteArray>& samples ) const
+{
+    if ( samples.empty() ) {
+        return QTextCodec::codecForUtfText( QByteArray{} );
+    }
 
-    auto rc = ud.handle_data( block.data(), static_cast<size_t>( block.size() ) );
-    if ( rc == 0 ) {
-        ud.data_end();
+    std::vector<SampleGuess> guesses( samples.size() );
+    tbb::parallel_for( size_t{ 0 }, samples.size(), [ &samples, &guesses ]( size_t index ) {
+        guesses[ index ] = guessSampleEncoding( samples[ index ] );
+    } );
+
+    // Samples with more non ASCII text give more reliable guesses,
+    // ASCII text is valid in all the encodings guessed for other samples
+    std::map<QByteArray, size_t> charsetWeights;
+    for ( const auto& guess : guesses ) {
+        LOG_DEBUG << "Uchardet sample guess " << guess.charset.constData() << ", non ASCII bytes "
+                  << guess.nonAsciiBytes;
+        if ( !guess.charset.isEmpty() && guess.nonAsciiBytes > 0 ) {
+            charsetWeights[ guess.charset ] += guess.nonAsciiBytes;
+        }
+    }
+
+    auto uchardetGuess = guesses.front().charset;
+    if ( !charsetWeights.empty() ) {
+        uchardetGuess = std::max_element( charsetWeights.begin(), charsetWeights.end(),
+                                          []( const auto& lhs, const auto& rhs ) {
+                                              return lhs.second < rhs.second;
+                                          } )
+                            ->first;
     }
 
     QTextCodec* uchardetCodec = nullptr;
-    if ( rc == 0 ) {
-        auto uchardetGuess = ud.get_charset();
-        LOG_DEBUG << "Uchardet encoding guess " << uchardetGuess;
+    if ( !uchardetGuess.isEmpty() ) {
+        LOG_DEBUG << "Uchardet encoding guess " << uchardetGuess.constData();
         uchardetCodec = QTextCodec::codecForName( uchardetGuess );
         if ( uchardetCodec ) {
             LOG_DEBUG << "Uchardet codec selected " << uchardetCodec->name().constData();
         }
         else {
-            LOG_DEBUG << "Uchardet codec not found for guess " << uchardetGuess;
+            LOG_DEBUG << "Uchardet codec not found for guess " << uchardetGuess.constData();
         }
     }
 
-    auto encodingGuess = uchardetCodec ? QTextCodec::codecForUtfText( block, uchardetCodec )
-                                       : QTextCodec::codecForUtfText( block );
+    // Byte order mark can only be at the beginning of the first sample
+    const auto& firstSample = samples.front();
+    auto encodingGuess = uchardetCodec ? QTextCodec::codecForUtfText( firstSample, uchardetCodec )
+                                       : QTextCodec::codecForUtfText( firstSample );
 
     LOG_DEBUG << "Final encoding guess " << encodingGuess->name().constData();
 
@@ -0,0 +1,407 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "fanoutsearch.h"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <utility>
+
+#include "log.h"
+#include "remotesearch.h"
+#include "tabpositions.h"
+
+namespace {
+constexpr int MergeIntervalMs = 300;
+
+// Lines of the first chunk used to detect format of timestamps
+constexpr size_t FormatSampleLines = 200;
+
+QString hostPrefix( const QString& host )
+{
+    return host + QStringLiteral( ": " );
+}
+} // namespace
+
+FanOutSearch::FanOutSearch( std::vector<Endpoint> endpoints )
+    : lineMap_( endpoints.size() )
+{
+    hosts_.resize( endpoints.size() );
+    for ( auto index = 0u; index < endpoints.size(); ++index ) {
+        auto& host = hosts_[ index ];
+        host.endpoint = std::move( endpoints[ index ] );
+        host.progress.host = host.endpoint.host;
+        host.search = std::make_unique<RemoteSearch>();
+
+        const auto* search = host.search.get();
+        connect( search, &RemoteSearch::searchProgressed, this,
+                 [ this, index ]( LinesCount nbMatches, int progress ) {
+                     searchProgressed( index, nbMatches, progress );
+                 } );
+        connect( search, &RemoteSearch::searchFinished, this,
+                 [ this, index ]() { hostSearchFinished( index ); } );
+        connect( search, &RemoteSearch::matchedLinesReceived, this,
+                 [ this, index ]( quint64 firstIndex, const std::vector<QString>& lines ) {
+                     matchedLinesReceived( index, firstIndex, lines );
+                 } );
+        connect( search, &RemoteSearch::errorReceived, this,
+                 [ this, index ]( const QString& error ) { finishHost( index, error ); } );
+
+        host.search->attachFile( host.endpoint.host, host.endpoint.port,
+                                 host.endpoint.fileName );
+    }
+
+    mergeTimer_.setSingleShot( true );
+    mergeTimer_.setInterval( MergeIntervalMs );
+    connect( &mergeTimer_, &QTimer::timeout, this, &FanOutSearch::merge );
+}
+
+FanOutSearch::~FanOutSearch()
+{
+    interruptSearch();
+}
+
+void FanOutSearch::runSearch( const RegularExpressionPattern& pattern )
+{
+    LOG_INFO << "Searching " << pattern.pattern << " on " << hosts_.size() << " hosts";
+
+    searchTimer_.start();
+    for ( auto& host : hosts_ ) {
+        host.progress = HostProgress{};
+        host.progress.host = host.endpoint.host;
+        host.lines.clear();
+        host.timestamps.clear();
+        host.parser.reset();
+        host.isFetching = false;
+
+        host.search->runSearch( pattern );
+    }
+
+    lineMap_ = MergedLineMap( hosts_.size() );
+    maxLength_ = {};
+    Q_EMIT linesMerged();
+}
+
+void FanOutSearch::interruptSearch()
+{
+    for ( auto& host : hosts_ ) {
+        if ( !host.progress.isFinished ) {
+            host.search->interruptSearch();
+        }
+    }
+}
+
+size_t FanOutSearch::getHostsCount() const
+{
+    return hosts_.size();
+}
+
+FanOutSearch::HostProgress FanOutSearch::getHostProgress( size_t host ) const
+{
+    return hosts_[ host ].progress;
+}
+
+bool FanOutSearch::isFinished() const
+{
+    return std::all_of( hosts_.begin(), hosts_.end(),
+                        []( const Host& host ) { return host.progress.isFinished; } );
+}
+
+MergedLineMap::SourceLine FanOutSearch::getSourceLine( LineNumber line ) const
+{
+    return lineMap_.sourceLine( line );
+}
+
+MergedLineMap
+FanOutSearch::mergeByTimestamps( const std::vector<std::vector<qint64>>& timestamps )
+{
+    MergedLineMap lineMap( timestamps.size() );
+    std::vector<size_t> positions( timestamps.size(), 0 );
+
+    using Head = std::pair<qint64, size_t>;
+    std::priority_queue<Head, std::vector<Head>, std::greater<>> heads;
+    for ( auto source = 0u; source < timestamps.size(); ++source ) {
+        if ( !timestamps[ source ].empty() ) {
+            heads.emplace( timestamps[ source ].front(), source );
+        }
+    }
+
+    while ( !heads.empty() ) {
+        const auto source = heads.top().second;
+        heads.pop();
+
+        lineMap.append( source );
+        const auto position = ++positions[ source ];
+        if ( position < timestamps[ source ].size() ) {
+            heads.emplace( timestamps[ source ][ position ], source );
+        }
+    }
+
+    return lineMap;
+}
+
+void FanOutSearch::searchProgressed( size_t host, LinesCount nbMatches, int progress )
+{
+    auto& hostProgress = hosts_[ host ].progress;
+    hostProgress.progress = progress;
+    hostProgress.nbMatches = nbMatches;
+
+    const auto elapsedMs = searchTimer_.elapsed();
+    if ( elapsedMs > 0 ) {
+        const auto searchedLines = static_cast<double>( hosts_[ host ].search->getNbLines().get() )
+                                   * progress / 100.0;
+        hostProgress.throughput = searchedLines * 1000.0 / static_cast<double>( elapsedMs );
+    }
+
+    Q_EMIT hostProgressed( host );
+}
+
+void FanOutSearch::hostSearchFinished( size_t host )
+{
+    auto& hostProgress = hosts_[ host ].progress;
+    hostProgress.progress = 100;
+    hostProgress.nbMatches
+        = LinesCount( hosts_[ host ].search->getMatchingLines().cardinality() );
+
+    LOG_INFO << "Search on " << hostProgress.host << " found " << hostProgress.nbMatches
+             << " lines";
+
+    // Search is updated when lines are added to the file
+    hostProgress.isFinished = false;
+    fetchNextLines( host );
+}
+
+void FanOutSearch::matchedLinesReceived( size_t index, quint64 firstIndex,
+                                         const std::vector<QString>& lines )
+{
+    auto& host = hosts_[ index ];
+    host.isFetching = false;
+
+    // Lines of a previous search
+    if ( firstIndex != host.lines.size() ) {
+        return;
+    }
+
+    const auto prefixLength = hostPrefix( host.endpoint.host ).length();
+    for ( const auto& line : lines ) {
+        host.lines.push_back( line );
+        const auto length = prefixLength + untabify( QString( line ) ).length();
+        maxLength_ = qMax( maxLength_, LineLength( static_cast<int>( length ) ) );
+    }
+    host.progress.fetchedLines = LinesCount( host.lines.size() );
+
+    parseTimestamps( host, static_cast<size_t>( firstIndex ) );
+    scheduleMerge();
+
+    Q_EMIT hostProgressed( index );
+
+    // Agent sends fewer lines if some matches were not found anymore
+    if ( lines.empty() ) {
+        finishHost( index );
+        return;
+    }
+
+    fetchNextLines( index );
+}
+
+void FanOutSearch::fetchNextLines( size_t index )
+{
+    auto& host = hosts_[ index ];
+    if ( host.isFetching ) {
+        return;
+    }
+
+    const auto fetchedLines = static_cast<quint64>( host.lines.size() );
+    const auto linesToFetch = std::min( host.progress.nbMatches.get(), MaxLinesPerHost );
+    if ( fetchedLines >= linesToFetch ) {
+        finishHost( index );
+        return;
+    }
+
+    host.isFetching = true;
+    host.search->fetchMatchedLines( fetchedLines,
+                                    std::min( FetchChunkLines, linesToFetch - fetchedLines ) );
+}
+
+void FanOutSearch::finishHost( size_t index, const QString& error )
+{
+    auto& hostProgress = hosts_[ index ].progress;
+    if ( !error.isEmpty() ) {
+        LOG_WARNING << "Search on " << hostProgress.host << " failed: " << error;
+        hostProgress.error = error;
+    }
+
+    hostProgress.isFinished = true;
+    Q_EMIT hostProgressed( index );
+
+    if ( isFinished() ) {
+        mergeTimer_.stop();
+        merge();
+
+        LOG_INFO << "Search on " << hosts_.size() << " hosts finished in "
+                 << searchTimer_.elapsed() << " ms, " << lineMap_.size() << " lines merged";
+        Q_EMIT searchFinished();
+    }
+}
+
+void FanOutSearch::parseTimestamps( Host& host, size_t firstLine )
+{
+    if ( firstLine == 0 && !host.lines.empty() ) {
+        QByteArray sample;
+        const auto sampleLines = std::min( host.lines.size(), FormatSampleLines );
+        for ( auto line = 0u; line < sampleLines; ++line ) {
+            sample.append( host.lines[ line ].toUtf8() ).append( '\n' );
+        }
+
+        const auto format = TimestampParser::detectFormat(
+            std::string_view( sample.constData(), static_cast<size_t>( sample.size() ) ) );
+        if ( !format.isEmpty() ) {
+            LOG_INFO << "Timestamps of " << host.endpoint.host << " are in " << format;
+            host.parser.emplace( format );
+        }
+    }
+
+    // Lines without timestamp get the timestamp of the previous line
+    auto lastTimestamp = host.timestamps.empty() ? std::numeric_limits<qint64>::min()
+                                                 : host.timestamps.back();
+    for ( auto line = firstLine; line < host.lines.size(); ++line ) {
+        if ( host.parser ) {
+            const auto utf8Line = host.lines[ line ].toUtf8();
+            const auto timestamp = host.parser->parse(
+                std::string_view( utf8Line.constData(), static_cast<size_t>( utf8Line.size() ) ) );
+            if ( timestamp ) {
+                lastTimestamp = *timestamp;
+            }
+        }
+        host.timestamps.push_back( lastTimestamp );
+    }
+}
+
+void FanOutSearch::scheduleMerge()
+{
+    if ( !mergeTimer_.isActive() ) {
+        mergeTimer_.start();
+    }
+}
+
+void FanOutSearch::merge()
+{
+    std::vector<std::vector<qint64>> timestamps;
+    timestamps.reserve( hosts_.size() );
+    for ( const auto& host : hosts_ ) {
+        timestamps.push_back( host.timestamps );
+    }
+
+    lineMap_ = mergeByTimestamps( timestamps );
+    Q_EMIT linesMerged();
+}
+
+QString FanOutSearch::doGetLineString( LineNumber line ) const
+{
+    const auto sourceLine = lineMap_.sourceLine( line );
+    const auto& host = hosts_[ sourceLine.source ];
+    return hostPrefix( host.endpoint.host ) + host.lines[ sourceLine.line.get() ];
+}
+
+QString FanOutSearch::doGetExpandedLineString( LineNumber line ) const
+{
+    return untabify( doGetLineString( line ) );
+}
+
+std::vector<QString> FanOutSearch::doGetLines( LineNumber first, LinesCount number ) const
+{
+    std::vector<QString> lines;
+    lines.reserve( number.get() );
+
+    for ( const auto& run : lineMap_.runs( first, number ) ) {
+        const auto& host = hosts_[ run.source ];
+        const auto prefix = hostPrefix( host.endpoint.host );
+        for ( auto line = run.firstLine.get(); line < run.firstLine.get() + run.count.get();
+              ++line ) {
+            lines.push_back( prefix + host.lines[ line ] );
+        }
+    }
+
+    return lines;
+}
+
+std::vector<QString> FanOutSearch::doGetExpandedLines( LineNumber first,
+                                                       LinesCount number ) const
+{
+    auto lines = doGetLines( first, number );
+    for ( auto& line : lines ) {
+        line = untabify( std::move( line ) );
+    }
+    return lines;
+}
+
+std::vector<QString> FanOutSearch::doGetExpandedLinesWindow( LineNumber first,
+                                                             LinesCount number,
+                                                             int firstColumn,
+                                                             int nbColumns ) const
+{
+    auto lines = doGetExpandedLines( first, number );
+    for ( auto& line : lines ) {
+        line = line.mid( firstColumn, nbColumns );
+    }
+    return lines;
+}
+
+LinesCount FanOutSearch::doGetNbLine() const
+{
+    return lineMap_.size();
+}
+
+LineLength FanOutSearch::doGetMaxLength() const
+{
+    return maxLength_;
+}
+
+LineLength FanOutSearch::doGetLineLength( LineNumber line ) const
+{
+    return LineLength( doGetExpandedLineString( line ).length() );
+}
+
+void FanOutSearch::doPrefetchLines( LineNumber, LinesCount ) const
+{
+    // Merged lines are already received
+}
+
+void FanOutSearch::doSetDisplayEncoding( const char* encoding )
+{
+    for ( auto& host : hosts_ ) {
+        host.search->setDisplayEncoding( encoding );
+    }
+}
+
+QTextCodec* FanOutSearch::doGetDisplayEncoding() const
+{
+    return hosts_.empty() ? QTextCodec::codecForLocale()
+                          : hosts_.front().search->getDisplayEncoding();
+}
+
+void FanOutSearch::doAttachReader() const
+{
+}
+
+void FanOutSearch::doDetachReader() const
+{
+}
@@ -0,0 +1,299 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "fieldindex.h"
+
+#include <algorithm>
+
+#include <QRegularExpression>
+
+namespace {
+bool isSpace( char c )
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+std::string_view trimmed( std::string_view text )
+{
+    while ( !text.empty() && isSpace( text.front() ) ) {
+        text.remove_prefix( 1 );
+    }
+    while ( !text.empty() && isSpace( text.back() ) ) {
+        text.remove_suffix( 1 );
+    }
+    return text;
+}
+
+std::string_view unquoted( std::string_view text )
+{
+    if ( text.size() >= 2 && text.front() == '"' && text.back() == '"' ) {
+        return text.substr( 1, text.size() - 2 );
+    }
+    return text;
+}
+
+// Value starting at pos, quoted one ends with the first not escaped
+// quote, other ends with separator of JSON or logfmt
+std::string_view valueAt( std::string_view line, size_t pos )
+{
+    if ( pos < line.size() && line[ pos ] == '"' ) {
+        auto end = pos + 1;
+        while ( end < line.size() && line[ end ] != '"' ) {
+            end += line[ end ] == '\\' ? 2 : 1;
+        }
+        return line.substr( pos + 1, std::min( end, line.size() ) - pos - 1 );
+    }
+
+    auto end = pos;
+    while ( end < line.size() && !isSpace( line[ end ] ) && line[ end ] != ','
+            && line[ end ] != '}' ) {
+        ++end;
+    }
+    return line.substr( pos, end - pos );
+}
+} // namespace
+
+std::optional<std::vector<FieldCondition>> parseFieldQuery( const QString& text,
+                                                            const QStringList& fields )
+{
+    if ( fields.isEmpty() ) {
+        return {};
+    }
+
+    static const QRegularExpression AndSeparator( "\\s+and\\s+",
+                                                  QRegularExpression::CaseInsensitiveOption );
+    static const QRegularExpression Condition( "^\\s*([\\w.\\-]+)\\s*=\\s*(\"[^\"]*\"|\\S+)\\s*$" );
+
+    std::vector<FieldCondition> conditions;
+    for ( const auto& part : text.split( AndSeparator ) ) {
+        const auto match = Condition.match( part );
+        if ( !match.hasMatch() || !fields.contains( match.captured( 1 ) ) ) {
+            return {};
+        }
+
+        auto value = match.captured( 2 );
+        if ( value.size() >= 2 && value.startsWith( '"' ) && value.endsWith( '"' ) ) {
+            value = value.mid( 1, value.size() - 2 );
+        }
+        conditions.push_back( { match.captured( 1 ), value } );
+    }
+
+    return conditions;
+}
+
+FieldIndex::FieldIndex( const QStringList& fields )
+    : fields_( fields )
+{
+    for ( const auto& field : fields_ ) {
+        Column column;
+        column.key = field.toStdString();
+        columns_.push_back( std::move( column ) );
+    }
+}
+
+LinesCount FieldIndex::size() const
+{
+    return LinesCount( size_ );
+}
+
+std::optional<std::string_view> FieldIndex::keyValueField( std::string_view line,
+                                                           std::string_view key )
+{
+    for ( auto keyPos = line.find( key ); keyPos != std::string_view::npos;
+          keyPos = line.find( key, keyPos + 1 ) ) {
+        const auto keyEnd = keyPos + key.size();
+
+        // "key": value
+        if ( keyPos > 0 && line[ keyPos - 1 ] == '"' && keyEnd < line.size()
+             && line[ keyEnd ] == '"' ) {
+            auto pos = keyEnd + 1;
+            while ( pos < line.size() && isSpace( line[ pos ] ) ) {
+                ++pos;
+            }
+            if ( pos < line.size() && line[ pos ] == ':' ) {
+                ++pos;
+                while ( pos < line.size() && isSpace( line[ pos ] ) ) {
+                    ++pos;
+                }
+                return valueAt( line, pos );
+            }
+        }
+
+        // key=value
+        if ( ( keyPos == 0 || isSpace( line[ keyPos - 1 ] ) ) && keyEnd < line.size()
+             && line[ keyEnd ] == '=' ) {
+            return valueAt( line, keyEnd + 1 );
+        }
+    }
+
+    return {};
+}
+
+std::vector<std::string_view> FieldIndex::csvColumns( std::string_view line )
+{
+    std::vector<std::string_view> columns;
+
+    size_t columnStart = 0;
+    auto isQuoted = false;
+    for ( size_t pos = 0; pos < line.size(); ++pos ) {
+        if ( line[ pos ] == '"' ) {
+            isQuoted = !isQuoted;
+        }
+        else if ( line[ pos ] == ',' && !isQuoted ) {
+            columns.push_back( trimmed( line.substr( columnStart, pos - columnStart ) ) );
+            columnStart = pos + 1;
+        }
+    }
+    columns.push_back( trimmed( line.substr( columnStart ) ) );
+
+    return columns;
+}
+
+void FieldIndex::appendValue( Column& column, std::optional<std::string_view> value )
+{
+    if ( !value ) {
+        column.values.push_back( 0 );
+        return;
+    }
+
+    const auto nextId = static_cast<ValueId>( column.dictionary.size() + 1 );
+    const auto id = column.dictionary.emplace( std::string( *value ), nextId ).first->second;
+    column.values.push_back( id );
+}
+
+void FieldIndex::append( const std::vector<std::string_view>& lines )
+{
+    auto firstLine = lines.begin();
+
+    // File is CSV if its first line names all the fields
+    if ( !isFormatKnown_ && firstLine != lines.end() ) {
+        isFormatKnown_ = true;
+
+        const auto header = csvColumns( *firstLine );
+        for ( auto& column : columns_ ) {
+            const auto headerColumn
+                = std::find_if( header.begin(), header.end(), [ &column ]( auto name ) {
+                      return unquoted( name ) == column.key;
+                  } );
+            if ( headerColumn != header.end() ) {
+                column.csvIndex = static_cast<size_t>( headerColumn - header.begin() );
+            }
+        }
+
+        isCsv_ = header.size() > 1
+                 && std::all_of( columns_.begin(), columns_.end(),
+                                 []( const auto& column ) { return column.csvIndex.has_value(); } );
+        if ( isCsv_ ) {
+            for ( auto& column : columns_ ) {
+                appendValue( column, {} );
+            }
+            ++size_;
+            ++firstLine;
+        }
+    }
+
+    for ( auto& column : columns_ ) {
+        column.values.reserve( column.values.size() + lines.size() );
+    }
+
+    std::vector<std::string_view> csvLine;
+    for ( auto line = firstLine; line != lines.end(); ++line ) {
+        if ( isCsv_ ) {
+            csvLine = csvColumns( *line );
+        }
+
+        for ( auto& column : columns_ ) {
+            if ( isCsv_ ) {
+                appendValue( column, *column.csvIndex < csvLine.size()
+                                         ? std::make_optional( unquoted( csvLine[ *column.csvIndex ] ) )
+                                         : std::nullopt );
+            }
+            else {
+                appendValue( column, keyValueField( *line, column.key ) );
+            }
+        }
+        ++size_;
+    }
+}
+
+void FieldIndex::truncate( LinesCount count )
+{
+    if ( count.get() >= size_ ) {
+        return;
+    }
+
+    for ( auto& column : columns_ ) {
+        column.values.resize( count.get() );
+    }
+    size_ = count.get();
+
+    // CSV header is the first line
+    if ( size_ == 0 ) {
+        isFormatKnown_ = false;
+        isCsv_ = false;
+    }
+}
+
+roaring::Roaring64Map FieldIndex::find( const std::vector<FieldCondition>& conditions,
+                                        LineNumber first, LineNumber last ) const
+{
+    roaring::Roaring64Map lines;
+
+    // Columns are compared to ids of values, value missing
+    // from dictionary of its column is not on any line
+    std::vector<std::pair<const std::vector<ValueId>*, ValueId>> comparisons;
+    for ( const auto& condition : conditions ) {
+        const auto fieldIndex = fields_.indexOf( condition.field );
+        if ( fieldIndex < 0 ) {
+            return lines;
+        }
+
+        const auto& column = columns_[ static_cast<size_t>( fieldIndex ) ];
+        const auto id = column.dictionary.find( condition.value.toStdString() );
+        if ( id == column.dictionary.end() ) {
+            return lines;
+        }
+        comparisons.emplace_back( &column.values, id->second );
+    }
+
+    const auto end = std::min( last.get(), size_ );
+    for ( auto line = first.get(); line < end; ++line ) {
+        const auto isMatching
+            = std::all_of( comparisons.begin(), comparisons.end(), [ line ]( const auto& comparison ) {
+                  return ( *comparison.first )[ line ] == comparison.second;
+              } );
+        if ( isMatching ) {
+            lines.add( line );
+        }
+    }
+
+    return lines;
+}
+
+size_t FieldIndex::allocatedSize() const
+{
+    size_t size = 0;
+    for ( const auto& column : columns_ ) {
+        size += column.values.capacity() * sizeof( ValueId );
+        for ( const auto& value : column.dictionary ) {
+            size += value.first.capacity() + sizeof( value );
+        }
+    }
+    return size;
+}
@@ -77,6 +77,11 @@ uint64_t FileDigest::digest() const
     return m_state->digest();
 }
 
+uint64_t FileDigest::blockDigest( const char* data, size_t length )
+{
+    return XXH3_64bits( reinterpret_cast<const void*>( data ), length );
+}
+
 void FileDigest::reset()
 {
     m_state->reset();
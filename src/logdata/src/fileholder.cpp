@@ -7,13 +7,26 @@
 #include <windows.h>
 #include <io.h>
 #else
+#include <cerrno>
+#include <fcntl.h>
 #include <sys/stat.h>
+#include <unistd.h>
 #endif
 
+#include <algorithm>
+#include <limits>
+
+#include "gzipfile.h"
 #include "log.h"
+#include "pluginfile.h"
+#include "remotefile.h"
+#include <QtCore/QDateTime>
 #include <QtCore/QFileInfo>
 
 namespace {
+// Files modified recently are likely still written to and are not mapped
+constexpr qint64 UnchangedForSecs = 60;
+
 void openFileByHandle( QFile* file )
 {
     bool openedByHandle = false;
@@ -57,10 +70,208 @@ void openFileByHandle( QFile* file )
         file->open( QIODevice::ReadOnly );
     }
 }
+
+#ifdef Q_OS_WIN
+// Returns number of bytes read, 0 at the end of file or -1 on error
+qint64 readOverlapped( HANDLE fileHandle, qint64 offset, char* data, DWORD length )
+{
+    OVERLAPPED overlapped{};
+    overlapped.Offset = static_cast<DWORD>( offset & 0xffffffff );
+    overlapped.OffsetHigh = static_cast<DWORD>( offset >> 32 );
+    overlapped.hEvent = ::CreateEventW( NULL, TRUE, FALSE, NULL );
+    if ( overlapped.hEvent == NULL ) {
+        return -1;
+    }
+
+    using EventGuard = std::unique_ptr<void, decltype( &CloseHandle )>;
+    auto eventGuard = EventGuard{ overlapped.hEvent, CloseHandle };
+
+    DWORD bytesRead = 0;
+    if ( !::ReadFile( fileHandle, data, length, NULL, &overlapped )
+         && ::GetLastError() != ERROR_IO_PENDING ) {
+        return ::GetLastError() == ERROR_HANDLE_EOF ? 0 : -1;
+    }
+
+    if ( !::GetOverlappedResult( fileHandle, &overlapped, &bytesRead, TRUE ) ) {
+        return ::GetLastError() == ERROR_HANDLE_EOF ? 0 : -1;
+    }
+
+    return static_cast<qint64>( bytesRead );
+}
+#endif
 } // namespace
 
-FileHolder::FileHolder( bool keepClosed )
+PositionalFileReader::PositionalFileReader( intptr_t handle )
+    : handle_{ handle }
+{
+}
+
+PositionalFileReader::~PositionalFileReader()
+{
+#ifdef Q_OS_WIN
+    ::CloseHandle( reinterpret_cast<HANDLE>( handle_ ) );
+#else
+    ::close( static_cast<int>( handle_ ) );
+#endif
+}
+
+std::shared_ptr<const PositionalFileReader> PositionalFileReader::duplicate( const QFile& file )
+{
+    // Duplicate of the open handle reads the file that was opened,
+    // even if another file has been moved to its path since then
+    const auto fileName = file.fileName();
+#ifdef Q_OS_WIN
+    // Overlapped handle, reads of synchronous one are serialized by the system
+    const auto fileHandle = ::ReOpenFile(
+        reinterpret_cast<HANDLE>( ::_get_osfhandle( file.handle() ) ), GENERIC_READ,
+        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, FILE_FLAG_OVERLAPPED );
+
+    if ( fileHandle == INVALID_HANDLE_VALUE ) {
+        LOG_WARNING << "Failed to duplicate handle of " << fileName
+                    << " for positional reads, gle " << ::GetLastError();
+        return nullptr;
+    }
+
+    return std::shared_ptr<const PositionalFileReader>(
+        new PositionalFileReader( reinterpret_cast<intptr_t>( fileHandle ) ) );
+#else
+    const auto fd = ::fcntl( file.handle(), F_DUPFD_CLOEXEC, 0 );
+    if ( fd < 0 ) {
+        LOG_WARNING << "Failed to duplicate handle of " << fileName
+                    << " for positional reads, errno " << errno;
+        return nullptr;
+    }
+
+    return std::shared_ptr<const PositionalFileReader>( new PositionalFileReader( fd ) );
+#endif
+}
+
+qint64 PositionalFileReader::read( qint64 offset, char* data, qint64 length ) const
+{
+    // Single call can read less than asked for
+    qint64 totalRead = 0;
+    while ( totalRead < length ) {
+#ifdef Q_OS_WIN
+        const auto chunkSize = static_cast<DWORD>(
+            std::min( length - totalRead, qint64{ std::numeric_limits<int32_t>::max() } ) );
+        const auto bytesRead = readOverlapped( reinterpret_cast<HANDLE>( handle_ ),
+                                               offset + totalRead, data + totalRead, chunkSize );
+#else
+        const auto bytesRead
+            = ::pread( static_cast<int>( handle_ ), data + totalRead,
+                       static_cast<size_t>( length - totalRead ),
+                       static_cast<off_t>( offset + totalRead ) );
+        if ( bytesRead < 0 && errno == EINTR ) {
+            continue;
+        }
+#endif
+        if ( bytesRead < 0 ) {
+            return -1;
+        }
+        if ( bytesRead == 0 ) {
+            break;
+        }
+        totalRead += bytesRead;
+    }
+
+    return totalRead;
+}
+
+FileMapping::FileMapping( std::unique_ptr<QFile> file, uchar* data, qint64 size )
+    : file_{ std::move( file ) }
+    , data_{ data }
+    , size_{ size }
+{
+}
+
+FileMapping::~FileMapping()
+{
+    file_->unmap( data_ );
+}
+
+std::shared_ptr<const FileMapping> FileMapping::map( const QFile& attachedFile )
+{
+    // Duplicate of the attached handle maps the file that was indexed,
+    // even if another file has been moved to its path since then
+    const auto fileName = attachedFile.fileName();
+#ifdef Q_OS_WIN
+    const auto fd = ::_dup( attachedFile.handle() );
+#else
+    const auto fd = ::fcntl( attachedFile.handle(), F_DUPFD_CLOEXEC, 0 );
+#endif
+    if ( fd < 0 ) {
+        LOG_WARNING << "Failed to duplicate handle of " << fileName << " for mapping";
+        return nullptr;
+    }
+
+    auto file = std::make_unique<QFile>();
+    if ( !file->open( fd, QIODevice::ReadOnly, QFile::AutoCloseHandle ) ) {
+#ifdef Q_OS_WIN
+        ::_close( fd );
+#else
+        ::close( fd );
+#endif
+        return nullptr;
+    }
+
+    const auto size = file->size();
+    if ( size <= 0
+         || static_cast<quint64>( size ) > std::numeric_limits<std::size_t>::max() / 2 ) {
+        return nullptr;
+    }
+
+    auto data = file->map( 0, size );
+    if ( data == nullptr ) {
+        LOG_WARNING << "Failed to map " << fileName << ": " << file->errorString();
+        return nullptr;
+    }
+
+    LOG_DEBUG << "Mapped " << size << " bytes of " << fileName;
+
+    return std::shared_ptr<const FileMapping>( new FileMapping( std::move( file ), data, size ) );
+}
+
+std::string_view FileMapping::view( qint64 offset, qint64 length ) const
+{
+    if ( offset < 0 || length < 0 || offset + length > size_ ) {
+        return {};
+    }
+
+    return std::string_view( reinterpret_cast<const char*>( data_ + offset ),
+                             static_cast<std::size_t>( length ) );
+}
+
+std::unique_ptr<QIODevice> makeLogFileDevice( const QString& fileName )
+{
+    if ( RemoteFile::isRemoteFile( fileName ) ) {
+        return std::make_unique<RemoteFile>( fileName );
+    }
+    if ( GzipFile::isGzipFile( fileName ) ) {
+        return std::make_unique<GzipFile>( fileName );
+    }
+    if ( const auto* plugin = PluginFile::findPlugin( fileName ) ) {
+        return std::make_unique<PluginFile>( fileName, plugin );
+    }
+    return std::make_unique<QFile>( fileName );
+}
+
+std::unique_ptr<QFile> openSharedFile( const QString& fileName )
+{
+    auto file = std::make_unique<QFile>( fileName );
+    if ( !QFileInfo( fileName ).isReadable() ) {
+        return nullptr;
+    }
+
+    openFileByHandle( file.get() );
+    if ( !file->isOpen() ) {
+        return nullptr;
+    }
+    return file;
+}
+
+FileHolder::FileHolder( bool keepClosed, bool useMapping )
     : keep_closed_{ keepClosed }
+    , use_mapping_{ useMapping && !keepClosed }
 {
 }
 
@@ -107,16 +318,6 @@ void FileHolder::open( const QString& fileName )
     }
 }
 
-void FileHolder::lock()
-{
-    file_mutex_.lock();
-}
-
-void FileHolder::unlock()
-{
-    file_mutex_.unlock();
-}
-
 void FileHolder::attachReader()
 {
     ScopedRecursiveLock locker( file_mutex_ );
@@ -140,6 +341,7 @@ void FileHolder::detachReader()
 
     if ( keep_closed_ && counter_ == 0 ) {
         attached_file_->close();
+        reader_.reset();
         LOG_DEBUG << "last reader closed for " << file_name_;
     }
 }
@@ -148,19 +350,95 @@ void FileHolder::reOpenFile()
 {
     LOG_DEBUG << "reopen " << file_name_;
 
-    auto reopened = std::make_unique<QFile>( file_name_ );
+    auto reopened = makeLogFileDevice( file_name_ );
+    std::shared_ptr<const PositionalFileReader> reader;
     if ( QFileInfo( file_name_ ).isReadable() ) {
-        openFileByHandle( reopened.get() );
+        if ( auto* file = qobject_cast<QFile*>( reopened.get() ) ) {
+            openFileByHandle( file );
+            if ( file->isOpen() ) {
+                reader = PositionalFileReader::duplicate( *file );
+            }
+        }
+        else {
+            reopened->open( QIODevice::ReadOnly );
+        }
     }
 
     ScopedRecursiveLock locker( file_mutex_ );
     attached_file_ = std::move( reopened );
     attached_file_id_ = FileId::getFileId( file_name_ );
+    mapping_.reset();
+    reader_ = std::move( reader );
+}
+
+qint64 FileHolder::read( qint64 offset, char* data, qint64 length )
+{
+    std::shared_ptr<const PositionalFileReader> reader;
+    {
+        ScopedRecursiveLock locker( file_mutex_ );
+        if ( !attached_file_ ) {
+            return -1;
+        }
+
+        // Compressed data is decompressed sequentially by the device
+        if ( !reader_ ) {
+            return attached_file_->seek( offset ) ? attached_file_->read( data, length ) : -1;
+        }
+
+        reader = reader_;
+    }
+
+    return reader->read( offset, data, length );
+}
+
+void FileHolder::stopMapping()
+{
+    ScopedRecursiveLock locker( file_mutex_ );
+    if ( use_mapping_ ) {
+        LOG_INFO << "Not mapping " << file_name_ << " any more, it has changed";
+    }
+    use_mapping_ = false;
+    mapping_.reset();
 }
 
-QFile* FileHolder::getFile()
+std::shared_ptr<const FileMapping> FileHolder::getMapping( qint64 requiredSize )
 {
-    return attached_file_.get();
+    ScopedRecursiveLock locker( file_mutex_ );
+    const auto* attachedFile = qobject_cast<const QFile*>( attached_file_.get() );
+    if ( !use_mapping_ || attachedFile == nullptr || !attachedFile->isOpen() ) {
+        return nullptr;
+    }
+
+    // Pages of the mapping cut off by truncation of the file raise SIGBUS
+    // when touched, and nothing watches files that are mapped. A file is
+    // mapped only after it has not been modified for a while, and any change
+    // of its size or modification time seen later stops mapping for good.
+    const auto currentSize = attachedFile->size();
+    const auto modified = attachedFile->fileTime( QFileDevice::FileModificationTime );
+    if ( mapping_
+         && ( mapping_->size() != currentSize || mapping_modified_ != modified ) ) {
+        stopMapping();
+        return nullptr;
+    }
+
+    if ( currentSize < requiredSize ) {
+        return nullptr;
+    }
+
+    if ( !mapping_ ) {
+        if ( !modified.isValid()
+             || modified.secsTo( QDateTime::currentDateTimeUtc() ) < UnchangedForSecs ) {
+            return nullptr;
+        }
+        mapping_ = FileMapping::map( *attachedFile );
+        mapping_modified_ = modified;
+    }
+
+    if ( mapping_ && mapping_->size() < requiredSize ) {
+        return nullptr;
+    }
+
+    return mapping_;
 }
 
 FileId FileId::getFileId( const QString& filename )
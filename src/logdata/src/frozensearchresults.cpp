@@ -0,0 +1,43 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "frozensearchresults.h"
+
+FrozenSearchResults::FrozenSearchResults( SearchResultArray lines )
+    : cardinality_( lines.cardinality() )
+{
+    lines.runOptimize();
+    data_ = QByteArray( static_cast<int>( lines.getSizeInBytes( true ) ), Qt::Uninitialized );
+    lines.write( data_.data(), true );
+}
+
+SearchResultArray FrozenSearchResults::thaw() const
+{
+    if ( data_.isEmpty() ) {
+        return {};
+    }
+
+    return SearchResultArray::read( data_.constData(), true );
+}
+
+void compactSearchResults( SearchResultArray& lines )
+{
+    lines.runOptimize();
+    lines.shrinkToFit();
+}
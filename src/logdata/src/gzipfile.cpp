@@ -0,0 +1,562 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gzipfile.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <map>
+
+#include <QDateTime>
+#include <QFileInfo>
+
+#include <tbb/parallel_for.h>
+
+#include "log.h"
+
+namespace {
+// Automatic header detection is not used, only gzip streams
+constexpr int GzipWindowBits = 15 + 16;
+constexpr int RawWindowBits = -15;
+
+constexpr int WindowSize = 32 * 1024;
+constexpr int InputBufferSize = 64 * 1024;
+constexpr qint64 CheckpointSpan = 8 * 1024 * 1024;
+
+constexpr int GzipTrailerSize = 8;
+constexpr uchar GzipMagic[] = { 0x1f, 0x8b };
+
+// Header with single BC extra field that holds size of the member
+constexpr int BgzfHeaderSize = 18;
+constexpr quint32 BgzfMaxMemberSize = 64 * 1024;
+constexpr size_t BgzfBatchMembers = 256;
+
+quint32 readLittleEndian( const char* data, int size )
+{
+    quint32 value = 0;
+    for ( auto byte = size - 1; byte >= 0; --byte ) {
+        value = ( value << 8 ) | static_cast<uchar>( data[ byte ] );
+    }
+    return value;
+}
+
+bool inflateMember( const QByteArray& member, char* output, qint64 outputSize )
+{
+    z_stream stream{};
+    if ( inflateInit2( &stream, GzipWindowBits ) != Z_OK ) {
+        return false;
+    }
+
+    stream.next_in = reinterpret_cast<Bytef*>( const_cast<char*>( member.constData() ) );
+    stream.avail_in = static_cast<uInt>( member.size() );
+    stream.next_out = reinterpret_cast<Bytef*>( output );
+    stream.avail_out = static_cast<uInt>( outputSize );
+
+    const auto result = inflate( &stream, Z_FINISH );
+    const auto isComplete
+        = result == Z_STREAM_END && static_cast<qint64>( stream.total_out ) == outputSize;
+
+    inflateEnd( &stream );
+    return isComplete;
+}
+} // namespace
+
+GzipFile::GzipFile( const QString& fileName, QObject* parent )
+    : QIODevice( parent )
+    , fileName_( fileName )
+    , compressed_( fileName )
+{
+}
+
+GzipFile::~GzipFile()
+{
+    close();
+}
+
+bool GzipFile::isGzipFile( const QString& fileName )
+{
+    QFile file( fileName );
+    if ( !file.open( QIODevice::ReadOnly ) ) {
+        return false;
+    }
+
+    const auto header = file.read( sizeof( GzipMagic ) );
+    return header.size() == sizeof( GzipMagic )
+           && std::memcmp( header.constData(), GzipMagic, sizeof( GzipMagic ) ) == 0;
+}
+
+std::shared_ptr<GzipFile::Index> GzipFile::sharedIndex( const QString& fileName )
+{
+    static SharedMutex registryMutex;
+    static std::map<QString, std::weak_ptr<Index>> registry;
+
+    // Checkpoints of previous versions of the file are not valid
+    const QFileInfo fileInfo( fileName );
+    const auto key = QString( "%1:%2:%3" )
+                         .arg( fileInfo.absoluteFilePath() )
+                         .arg( fileInfo.size() )
+                         .arg( fileInfo.lastModified().toMSecsSinceEpoch() );
+
+    UniqueLock lock( registryMutex );
+    for ( auto entry = registry.begin(); entry != registry.end(); ) {
+        entry = entry->second.expired() ? registry.erase( entry ) : std::next( entry );
+    }
+
+    auto& entry = registry[ key ];
+    auto index = entry.lock();
+    if ( !index ) {
+        index = std::make_shared<Index>();
+        entry = index;
+    }
+    return index;
+}
+
+std::optional<qint64> GzipFile::blockCompressedMemberSize( const QByteArray& header )
+{
+    const auto* data = header.constData();
+    const auto hasExtraField = header.size() >= BgzfHeaderSize
+                               && static_cast<uchar>( data[ 0 ] ) == GzipMagic[ 0 ]
+                               && static_cast<uchar>( data[ 1 ] ) == GzipMagic[ 1 ]
+                               && ( data[ 3 ] & 0x04 ) != 0;
+    if ( !hasExtraField || readLittleEndian( data + 10, 2 ) != 6 || data[ 12 ] != 'B'
+         || data[ 13 ] != 'C' || readLittleEndian( data + 14, 2 ) != 2 ) {
+        return {};
+    }
+
+    return static_cast<qint64>( readLittleEndian( data + 16, 2 ) ) + 1;
+}
+
+bool GzipFile::open( OpenMode mode )
+{
+    if ( mode & QIODevice::WriteOnly ) {
+        setErrorString( "Gzip files can only be read" );
+        return false;
+    }
+
+    if ( !compressed_.open( QIODevice::ReadOnly ) ) {
+        setErrorString( compressed_.errorString() );
+        return false;
+    }
+
+    if ( inflateInit2( &stream_, GzipWindowBits ) != Z_OK ) {
+        setErrorString( "Failed to initialize decompressor" );
+        compressed_.close();
+        return false;
+    }
+
+    isBlockCompressed_
+        = blockCompressedMemberSize( compressed_.read( BgzfHeaderSize ) ).has_value();
+    if ( isBlockCompressed_ ) {
+        LOG_INFO << fileName_ << " is block compressed";
+    }
+
+    isStreamInitialized_ = true;
+    input_.resize( InputBufferSize );
+    window_.resize( WindowSize );
+    index_ = sharedIndex( fileName_ );
+    resetStream();
+
+    return QIODevice::open( QIODevice::ReadOnly | QIODevice::Unbuffered );
+}
+
+void GzipFile::close()
+{
+    if ( isStreamInitialized_ ) {
+        inflateEnd( &stream_ );
+        isStreamInitialized_ = false;
+    }
+
+    compressed_.close();
+    QIODevice::close();
+}
+
+qint64 GzipFile::size() const
+{
+    if ( !index_ ) {
+        return 0;
+    }
+
+    {
+        SharedLock lock( index_->mutex );
+        if ( index_->size ) {
+            return *index_->size;
+        }
+    }
+
+    return std::max( uncompressedPosition_, compressed_.size() );
+}
+
+bool GzipFile::atEnd() const
+{
+    if ( !isStreamInitialized_ ) {
+        return true;
+    }
+
+    SharedLock lock( index_->mutex );
+    return index_->size && pos() >= *index_->size;
+}
+
+qint64 GzipFile::readData( char* data, qint64 maxSize )
+{
+    if ( !isStreamInitialized_ ) {
+        return -1;
+    }
+
+    if ( isBlockCompressed_ ) {
+        return readBlockCompressed( data, maxSize );
+    }
+
+    if ( pos() != uncompressedPosition_ && !seekStream( pos() ) ) {
+        return isStreamFinished_ ? 0 : -1;
+    }
+
+    return inflateInto( data, maxSize );
+}
+
+qint64 GzipFile::writeData( const char* data, qint64 maxSize )
+{
+    Q_UNUSED( data );
+    Q_UNUSED( maxSize );
+    return -1;
+}
+
+void GzipFile::resetStream()
+{
+    inflateReset2( &stream_, GzipWindowBits );
+    isRawStream_ = false;
+    isStreamFinished_ = false;
+
+    compressed_.seek( 0 );
+    stream_.avail_in = 0;
+    compressedPosition_ = 0;
+    uncompressedPosition_ = 0;
+    windowPosition_ = 0;
+
+    decodedBatch_.clear();
+    batchOffset_ = 0;
+    nextMemberOffset_ = 0;
+}
+
+void GzipFile::restoreCheckpoint( const Checkpoint& checkpoint )
+{
+    LOG_DEBUG << "Restoring gzip checkpoint at " << checkpoint.uncompressedOffset;
+
+    // Deflate blocks are not byte aligned, so decompression
+    // starts inside of the member without gzip header
+    inflateReset2( &stream_, RawWindowBits );
+    isRawStream_ = true;
+    isStreamFinished_ = false;
+
+    compressed_.seek( checkpoint.compressedOffset - ( checkpoint.bits > 0 ? 1 : 0 ) );
+    stream_.avail_in = 0;
+    if ( checkpoint.bits > 0 ) {
+        char partialByte = 0;
+        compressed_.getChar( &partialByte );
+        inflatePrime( &stream_, checkpoint.bits,
+                      static_cast<uchar>( partialByte ) >> ( 8 - checkpoint.bits ) );
+    }
+
+    inflateSetDictionary( &stream_,
+                          reinterpret_cast<const Bytef*>( checkpoint.window.constData() ),
+                          static_cast<uInt>( checkpoint.window.size() ) );
+
+    std::memcpy( window_.data(), checkpoint.window.constData(), WindowSize );
+    windowPosition_ = 0;
+
+    compressedPosition_ = checkpoint.compressedOffset;
+    uncompressedPosition_ = checkpoint.uncompressedOffset;
+}
+
+std::optional<GzipFile::Checkpoint> GzipFile::findCheckpoint( qint64 offset ) const
+{
+    SharedLock lock( index_->mutex );
+    const auto& checkpoints = index_->checkpoints;
+    const auto next = std::upper_bound( checkpoints.begin(), checkpoints.end(), offset,
+                                        []( qint64 value, const Checkpoint& point ) {
+                                            return value < point.uncompressedOffset;
+                                        } );
+    if ( next == checkpoints.begin() ) {
+        return {};
+    }
+    return *std::prev( next );
+}
+
+bool GzipFile::seekStream( qint64 offset )
+{
+    const auto checkpoint = findCheckpoint( offset );
+
+    // Continue from current position if it is closer than any checkpoint
+    const auto restartOffset = checkpoint ? checkpoint->uncompressedOffset : 0;
+    if ( offset < uncompressedPosition_ || uncompressedPosition_ < restartOffset ) {
+        if ( checkpoint ) {
+            restoreCheckpoint( *checkpoint );
+        }
+        else {
+            resetStream();
+        }
+    }
+
+    while ( uncompressedPosition_ < offset ) {
+        if ( inflateInto( nullptr, offset - uncompressedPosition_ ) <= 0 ) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+qint64 GzipFile::inflateInto( char* data, qint64 maxSize )
+{
+    qint64 produced = 0;
+    while ( produced < maxSize && !isStreamFinished_ ) {
+        if ( stream_.avail_in == 0 && !fillInput() ) {
+            // Data that was decompressed from truncated file is still usable
+            LOG_WARNING << "Unexpected end of gzip data in " << fileName_;
+            finishStream();
+            break;
+        }
+
+        if ( windowPosition_ == WindowSize ) {
+            windowPosition_ = 0;
+        }
+
+        auto* output = reinterpret_cast<Bytef*>( window_.data() ) + windowPosition_;
+        const auto outputSize = static_cast<uInt>(
+            std::min( static_cast<qint64>( WindowSize - windowPosition_ ), maxSize - produced ) );
+
+        stream_.next_out = output;
+        stream_.avail_out = outputSize;
+
+        const auto inputSize = stream_.avail_in;
+        const auto result = inflate( &stream_, Z_BLOCK );
+
+        const auto outputBytes = static_cast<int>( outputSize - stream_.avail_out );
+        if ( data != nullptr ) {
+            std::memcpy( data + produced, output, static_cast<size_t>( outputBytes ) );
+        }
+
+        compressedPosition_ += inputSize - stream_.avail_in;
+        uncompressedPosition_ += outputBytes;
+        windowPosition_ += outputBytes;
+        produced += outputBytes;
+
+        if ( result == Z_STREAM_END ) {
+            startNextMember();
+        }
+        else if ( result != Z_OK && result != Z_BUF_ERROR ) {
+            LOG_ERROR << "Failed to decompress " << fileName_ << ": "
+                      << ( stream_.msg != nullptr ? stream_.msg : "unknown error" );
+            setErrorString( "Failed to decompress gzip data" );
+            return produced > 0 ? produced : -1;
+        }
+        else if ( ( stream_.data_type & 128 ) && !( stream_.data_type & 64 ) ) {
+            // Stopped at the end of a block that is not the last one
+            addCheckpoint();
+        }
+    }
+
+    return produced;
+}
+
+bool GzipFile::fillInput()
+{
+    const auto readBytes = compressed_.read( input_.data(), input_.size() );
+    if ( readBytes <= 0 ) {
+        return false;
+    }
+
+    stream_.next_in = reinterpret_cast<Bytef*>( input_.data() );
+    stream_.avail_in = static_cast<uInt>( readBytes );
+    return true;
+}
+
+void GzipFile::startNextMember()
+{
+    if ( isRawStream_ ) {
+        // Raw stream does not consume gzip trailer of the member
+        auto trailerSize = static_cast<uInt>( GzipTrailerSize );
+        while ( trailerSize > 0 ) {
+            if ( stream_.avail_in == 0 && !fillInput() ) {
+                finishStream();
+                return;
+            }
+
+            const auto skipped = std::min( stream_.avail_in, trailerSize );
+            stream_.next_in += skipped;
+            stream_.avail_in -= skipped;
+            compressedPosition_ += skipped;
+            trailerSize -= skipped;
+        }
+    }
+
+    if ( stream_.avail_in == 0 && !fillInput() ) {
+        finishStream();
+        return;
+    }
+
+    // Concatenated gzip members form a single file,
+    // anything else after the last member is padding
+    if ( stream_.next_in[ 0 ] != GzipMagic[ 0 ] ) {
+        finishStream();
+        return;
+    }
+
+    inflateReset2( &stream_, GzipWindowBits );
+    isRawStream_ = false;
+}
+
+void GzipFile::addCheckpoint()
+{
+    UniqueLock lock( index_->mutex );
+    auto& checkpoints = index_->checkpoints;
+
+    const auto lastOffset = checkpoints.empty() ? 0 : checkpoints.back().uncompressedOffset;
+    const auto offset = isBlockCompressed_ ? batchOffset_ : uncompressedPosition_;
+    if ( offset - lastOffset < CheckpointSpan ) {
+        return;
+    }
+
+    // Members do not depend on previous data
+    if ( isBlockCompressed_ ) {
+        Checkpoint checkpoint;
+        checkpoint.uncompressedOffset = batchOffset_;
+        checkpoint.compressedOffset = nextMemberOffset_;
+        checkpoints.push_back( std::move( checkpoint ) );
+        return;
+    }
+
+    // Window is circular, it starts from the oldest byte
+    const auto oldest = windowPosition_ % WindowSize;
+
+    Checkpoint checkpoint;
+    checkpoint.uncompressedOffset = uncompressedPosition_;
+    checkpoint.compressedOffset = compressedPosition_;
+    checkpoint.bits = stream_.data_type & 7;
+    checkpoint.window = window_.mid( oldest ) + window_.left( oldest );
+
+    checkpoints.push_back( std::move( checkpoint ) );
+}
+
+void GzipFile::finishStream()
+{
+    isStreamFinished_ = true;
+
+    UniqueLock lock( index_->mutex );
+    if ( !index_->size ) {
+        index_->size = uncompressedPosition_;
+        LOG_INFO << "Decompressed size of " << fileName_ << " is " << uncompressedPosition_
+                 << ", " << index_->checkpoints.size() << " checkpoints";
+    }
+}
+
+qint64 GzipFile::readBlockCompressed( char* data, qint64 maxSize )
+{
+    const auto offset = pos();
+
+    const auto checkpoint = findCheckpoint( offset );
+    const auto restartOffset = checkpoint ? checkpoint->uncompressedOffset : 0;
+    const auto batchEnd = batchOffset_ + decodedBatch_.size();
+    if ( offset < batchOffset_ || batchEnd < restartOffset ) {
+        decodedBatch_.clear();
+        batchOffset_ = restartOffset;
+        nextMemberOffset_ = checkpoint ? checkpoint->compressedOffset : 0;
+        isStreamFinished_ = false;
+    }
+
+    while ( offset >= batchOffset_ + decodedBatch_.size() ) {
+        if ( !decodeNextBatch() ) {
+            return isStreamFinished_ ? 0 : -1;
+        }
+    }
+
+    const auto batchPosition = offset - batchOffset_;
+    const auto copiedSize = std::min( maxSize, decodedBatch_.size() - batchPosition );
+    std::memcpy( data, decodedBatch_.constData() + batchPosition,
+                 static_cast<size_t>( copiedSize ) );
+    return copiedSize;
+}
+
+bool GzipFile::decodeNextBatch()
+{
+    if ( isStreamFinished_ ) {
+        return false;
+    }
+
+    batchOffset_ += decodedBatch_.size();
+    decodedBatch_.clear();
+    addCheckpoint();
+
+    std::vector<QByteArray> members;
+    std::vector<qint64> memberOffsets{ 0 };
+    compressed_.seek( nextMemberOffset_ );
+    while ( members.size() < BgzfBatchMembers ) {
+        auto member = compressed_.read( BgzfHeaderSize );
+        const auto memberSize = blockCompressedMemberSize( member );
+        if ( !memberSize || *memberSize < BgzfHeaderSize + GzipTrailerSize ) {
+            break;
+        }
+
+        member.append( compressed_.read( *memberSize - BgzfHeaderSize ) );
+        if ( member.size() != *memberSize ) {
+            LOG_WARNING << "Unexpected end of gzip data in " << fileName_;
+            break;
+        }
+
+        // Trailer ends with size of uncompressed data of the member
+        const auto decodedSize = readLittleEndian( member.constData() + member.size() - 4, 4 );
+        if ( decodedSize > BgzfMaxMemberSize ) {
+            LOG_WARNING << "Invalid bgzip member in " << fileName_ << " at " << nextMemberOffset_;
+            break;
+        }
+
+        nextMemberOffset_ += *memberSize;
+        memberOffsets.push_back( memberOffsets.back() + decodedSize );
+        members.push_back( std::move( member ) );
+    }
+
+    if ( members.empty() ) {
+        uncompressedPosition_ = batchOffset_;
+        finishStream();
+        return false;
+    }
+
+    decodedBatch_.resize( static_cast<int>( memberOffsets.back() ) );
+    auto* output = decodedBatch_.data();
+
+    std::atomic<bool> isFailed{ false };
+    tbb::parallel_for( size_t{ 0 }, members.size(), [ & ]( size_t index ) {
+        const auto decodedSize = memberOffsets[ index + 1 ] - memberOffsets[ index ];
+        if ( decodedSize > 0
+             && !inflateMember( members[ index ], output + memberOffsets[ index ],
+                                decodedSize ) ) {
+            isFailed = true;
+        }
+    } );
+
+    if ( isFailed ) {
+        LOG_ERROR << "Failed to decompress " << fileName_ << " after " << batchOffset_;
+        setErrorString( "Failed to decompress gzip data" );
+        decodedBatch_.clear();
+        return false;
+    }
+
+    uncompressedPosition_ = batchOffset_ + decodedBatch_.size();
+    return true;
+}
@@ -0,0 +1,218 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "indexcache.h"
+
+#include <limits>
+#include <vector>
+
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QSysInfo>
+
+#include "filedigest.h"
+#include "fileholder.h"
+#include "log.h"
+#include "streamlimits.h"
+
+namespace {
+constexpr quint32 IndexCacheMagic = 0x4B4C4958; // KLIX
+constexpr quint32 IndexCacheVersion = 10;
+
+QString cacheDirectory()
+{
+    return QStandardPaths::writableLocation( QStandardPaths::CacheLocation )
+           + QDir::separator() + "index";
+}
+
+QByteArray codecName( QTextCodec* codec )
+{
+    return codec != nullptr ? codec->name() : QByteArray{};
+}
+
+quint64 fileRangeDigest( QIODevice& file, qint64 offset, qint64 size )
+{
+    if ( !file.seek( offset ) ) {
+        return 0;
+    }
+
+    const auto buffer = file.read( size );
+    if ( buffer.size() != size ) {
+        return 0;
+    }
+
+    FileDigest digest;
+    digest.addData( buffer );
+    return digest.digest();
+}
+
+template <typename Digest>
+void saveDigests( QDataStream& stream, const std::vector<Digest>& digests )
+{
+    stream << static_cast<quint64>( digests.size() );
+    for ( const auto& digest : digests ) {
+        stream << digest.offset << digest.size << digest.digest;
+    }
+}
+
+template <typename Digest>
+std::vector<Digest> loadDigests( QDataStream& stream )
+{
+    quint64 count = 0;
+    stream >> count;
+
+    std::vector<Digest> digests;
+    constexpr auto DigestBytes
+        = sizeof( Digest::offset ) + sizeof( Digest::size ) + sizeof( Digest::digest );
+    if ( !isCountInStream( stream, count, DigestBytes ) ) {
+        stream.setStatus( QDataStream::ReadCorruptData );
+        return digests;
+    }
+
+    for ( auto i = 0u; i < count && stream.status() == QDataStream::Ok; ++i ) {
+        Digest digest;
+        stream >> digest.offset >> digest.size >> digest.digest;
+        digests.push_back( digest );
+    }
+    return digests;
+}
+} // namespace
+
+bool IndexCache::isIndexedPartUnchanged( const QString& fileName, const IndexedHash& hash )
+{
+    const auto file = makeLogFileDevice( fileName );
+    if ( !file->open( QIODevice::ReadOnly ) || file->size() < hash.size ) {
+        return false;
+    }
+
+    return fileRangeDigest( *file, 0, hash.headerSize ) == hash.headerDigest
+           && fileRangeDigest( *file, hash.tailOffset, hash.tailSize ) == hash.tailDigest;
+}
+
+void IndexCache::saveHash( QDataStream& stream, const IndexedHash& hash )
+{
+    stream << hash.size << hash.headerSize << hash.headerDigest << hash.tailSize
+           << hash.tailOffset << hash.tailDigest << hash.lastModified;
+    saveDigests( stream, hash.blockDigests );
+    saveDigests( stream, hash.sampleDigests );
+}
+
+IndexedHash IndexCache::loadHash( QDataStream& stream )
+{
+    IndexedHash hash;
+    stream >> hash.size >> hash.headerSize >> hash.headerDigest >> hash.tailSize
+        >> hash.tailOffset >> hash.tailDigest >> hash.lastModified;
+    hash.blockDigests = loadDigests<IndexedHash::BlockDigest>( stream );
+    hash.sampleDigests = loadDigests<IndexedHash::SampleDigest>( stream );
+    return hash;
+}
+
+IndexCache::IndexCache( const QString& fileName )
+    : fileName_( QFileInfo( fileName ).absoluteFilePath() )
+{
+    FileDigest pathDigest;
+    pathDigest.addData( fileName_.toUtf8() );
+    cachePath_ = cacheDirectory() + QDir::separator()
+                 + QString::number( pathDigest.digest(), 16 ) + ".idx";
+}
+
+bool IndexCache::load( IndexingData::MutateAccessor& scopedAccessor ) const
+{
+    QFile cacheFile( cachePath_ );
+    if ( !cacheFile.open( QIODevice::ReadOnly ) ) {
+        return false;
+    }
+
+    QDataStream stream( &cacheFile );
+    stream.setVersion( QDataStream::Qt_5_9 );
+
+    quint32 magic = 0;
+    quint32 version = 0;
+    qint32 byteOrder = 0;
+    QString fileName;
+    QByteArray forcedEncoding;
+    stream >> magic >> version >> byteOrder >> fileName >> forcedEncoding;
+
+    if ( stream.status() != QDataStream::Ok || magic != IndexCacheMagic
+         || version != IndexCacheVersion || byteOrder != QSysInfo::ByteOrder
+         || fileName != fileName_ ) {
+        LOG_INFO << "Index cache " << cachePath_ << " is not compatible";
+        return false;
+    }
+
+    if ( forcedEncoding != codecName( scopedAccessor.getForcedEncoding() ) ) {
+        LOG_INFO << "Index cache has different forced encoding";
+        return false;
+    }
+
+    const auto hash = loadHash( stream );
+    if ( stream.status() != QDataStream::Ok || !isIndexedPartUnchanged( fileName_, hash ) ) {
+        LOG_INFO << "File changed since index cache was saved";
+        return false;
+    }
+
+    if ( !scopedAccessor.loadIndex( stream, hash ) ) {
+        LOG_WARNING << "Failed to load index cache " << cachePath_;
+        return false;
+    }
+
+    LOG_INFO << "Loaded index cache for " << fileName_ << ", " << scopedAccessor.getNbLines()
+             << " lines, indexed size " << hash.size;
+    return true;
+}
+
+void IndexCache::save( const IndexingData::ConstAccessor& scopedAccessor ) const
+{
+    const auto hash = scopedAccessor.getHash();
+    if ( hash.size < MinCachedFileSize
+         || scopedAccessor.allocatedSize() > std::numeric_limits<int>::max() / 2 ) {
+        return;
+    }
+
+    if ( !QDir().mkpath( cacheDirectory() ) ) {
+        LOG_WARNING << "Failed to create index cache directory " << cacheDirectory();
+        return;
+    }
+
+    QSaveFile cacheFile( cachePath_ );
+    if ( !cacheFile.open( QIODevice::WriteOnly ) ) {
+        LOG_WARNING << "Failed to open index cache " << cachePath_;
+        return;
+    }
+
+    QDataStream stream( &cacheFile );
+    stream.setVersion( QDataStream::Qt_5_9 );
+
+    stream << IndexCacheMagic << IndexCacheVersion << static_cast<qint32>( QSysInfo::ByteOrder )
+           << fileName_ << codecName( scopedAccessor.getForcedEncoding() );
+
+    saveHash( stream, hash );
+    scopedAccessor.saveIndex( stream );
+
+    if ( stream.status() != QDataStream::Ok || !cacheFile.commit() ) {
+        LOG_WARNING << "Failed to save index cache " << cachePath_;
+        return;
+    }
+
+    LOG_INFO << "Saved index cache for " << fileName_ << " to " << cachePath_;
+}
@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "indexestimate.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QIODevice>
+
+#include "log.h"
+#include "sparselinestorage.h"
+
+namespace {
+// Lines in a block of compressed positions and its header for 64-bit
+// offsets, see CompressedLinePositionStorage
+constexpr double CompressedBlockLines = 256.0;
+constexpr double CompressedBlockHeaderBytes = 4 * 8 + 4;
+
+// Progress below which the estimated time is more reliable than the measured one
+constexpr int MeasuredProgress = 5;
+
+double deltaBytes( double averageLineLength )
+{
+    // Lines of a group are packed with the width of the longest one,
+    // which is taken as twice the average
+    return std::ceil( std::log2( std::max( 2.0, averageLineLength * 2 ) ) + 1 ) / 8;
+}
+} // namespace
+
+std::optional<IndexEstimate> IndexEstimate::sample( QIODevice& file, size_t perLineIndexBytes )
+{
+    IndexEstimate estimate;
+    estimate.startTime = std::chrono::steady_clock::now();
+    estimate.fileSize = file.size();
+    if ( estimate.fileSize <= 0 ) {
+        return {};
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    const auto isReadWhole = estimate.fileSize <= SampleBlocks * SampleBlockSize;
+    const auto samples = isReadWhole ? 1 : SampleBlocks;
+    const auto sampleSize = isReadWhole ? estimate.fileSize : SampleBlockSize;
+    const auto sampleStep = isReadWhole ? 0 : ( estimate.fileSize - sampleSize ) / ( samples - 1 );
+
+    QByteArray buffer( static_cast<int>( sampleSize ), Qt::Uninitialized );
+    qint64 sampledBytes = 0;
+    qint64 lineFeeds = 0;
+    for ( auto index = 0; index < samples; ++index ) {
+        if ( !file.seek( index * sampleStep ) ) {
+            return {};
+        }
+        const auto readBytes = file.read( buffer.data(), sampleSize );
+        if ( readBytes <= 0 ) {
+            return {};
+        }
+        sampledBytes += readBytes;
+        lineFeeds += std::count( buffer.constData(), buffer.constData() + readBytes, '\n' );
+    }
+
+    const auto elapsedMs = std::max( qint64{ 1 }, timer.elapsed() );
+
+    // Text after the last line feed is a line too
+    const auto lines = isReadWhole ? static_cast<double>( lineFeeds + 1 )
+                                   : std::max( 1.0, static_cast<double>( lineFeeds )
+                                                        * static_cast<double>( estimate.fileSize )
+                                                        / static_cast<double>( sampledBytes ) );
+    estimate.lines = LinesCount( static_cast<LinesCount::UnderlyingType>( lines ) );
+
+    const auto perLineBytes = static_cast<double>( perLineIndexBytes );
+    const auto averageLineLength = static_cast<double>( estimate.fileSize ) / lines;
+    estimate.compressedBytes = static_cast<size_t>(
+        lines
+        * ( deltaBytes( averageLineLength ) + CompressedBlockHeaderBytes / CompressedBlockLines
+            + perLineBytes ) );
+    const auto checkpointBytes = static_cast<double>( sizeof( qint64 ) )
+                                 / SparseLinePositionStorage::CheckpointInterval;
+    estimate.sparseBytes = static_cast<size_t>( lines * ( checkpointBytes + perLineBytes ) );
+
+    estimate.indexingTime = std::chrono::milliseconds(
+        elapsedMs * estimate.fileSize / std::max( qint64{ 1 }, sampledBytes ) );
+
+    LOG_INFO << "Estimated " << estimate.lines.get() << " lines, index of "
+             << estimate.compressedBytes << " bytes (" << estimate.sparseBytes
+             << " sparse), indexing for " << estimate.indexingTime.count() << " ms";
+    return estimate;
+}
+
+IndexEstimate::Storage IndexEstimate::chooseStorage( size_t memoryLimit ) const
+{
+    if ( memoryLimit == 0 || compressedBytes <= memoryLimit ) {
+        return Storage::Compressed;
+    }
+    if ( sparseBytes <= memoryLimit ) {
+        return Storage::Sparse;
+    }
+    return Storage::FileBacked;
+}
+
+std::chrono::milliseconds IndexEstimate::remainingTime( int progress ) const
+{
+    using namespace std::chrono;
+    const auto elapsed = duration_cast<milliseconds>( steady_clock::now() - startTime );
+    if ( progress < MeasuredProgress ) {
+        return std::max( milliseconds{ 0 }, indexingTime - elapsed );
+    }
+    return elapsed * ( 100 - std::min( progress, 100 ) ) / progress;
+}
@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ingestrate.h"
+
+#include <algorithm>
+#include <cmath>
+
+void IngestRate::reset( qint64 timeMs )
+{
+    lastAppendMs_ = timeMs;
+    bytesPerSecond_ = 0;
+    linesPerSecond_ = 0;
+}
+
+void IngestRate::addAppend( qint64 timeMs, uint64_t bytes, uint64_t lines )
+{
+    if ( lastAppendMs_ < 0 || timeMs <= lastAppendMs_ ) {
+        lastAppendMs_ = std::max( lastAppendMs_, timeMs );
+        return;
+    }
+
+    const auto intervalMs = static_cast<double>( timeMs - lastAppendMs_ );
+    const auto weight = 1.0 - std::exp( -intervalMs / TimeConstantMs );
+
+    // Rates measured before a long pause are outdated
+    if ( isIdle( timeMs ) ) {
+        bytesPerSecond_ = 0;
+        linesPerSecond_ = 0;
+    }
+
+    bytesPerSecond_ += weight * ( static_cast<double>( bytes ) * 1000.0 / intervalMs
+                                  - bytesPerSecond_ );
+    linesPerSecond_ += weight * ( static_cast<double>( lines ) * 1000.0 / intervalMs
+                                  - linesPerSecond_ );
+    lastAppendMs_ = timeMs;
+}
+
+double IngestRate::bytesPerSecond( qint64 timeMs ) const
+{
+    return isIdle( timeMs ) ? 0.0 : bytesPerSecond_;
+}
+
+double IngestRate::linesPerSecond( qint64 timeMs ) const
+{
+    return isIdle( timeMs ) ? 0.0 : linesPerSecond_;
+}
+
+qint64 IngestRate::refreshIntervalMs( qint64 timeMs ) const
+{
+    const auto intervalMs = static_cast<qint64>( linesPerSecond( timeMs ) / LinesPerSecondPerMs );
+    return intervalMs < MinRefreshIntervalMs ? 0 : std::min( intervalMs, MaxRefreshIntervalMs );
+}
+
+bool IngestRate::isIdle( qint64 timeMs ) const
+{
+    return lastAppendMs_ < 0 || timeMs - lastAppendMs_ > IdleTimeMs;
+}
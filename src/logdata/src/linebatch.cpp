@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "linebatch.h"
+
+#include <algorithm>
+
+QStringView LineBatch::line( size_t index ) const
+{
+    const auto begin = index == 0 ? 0 : ends_[ index - 1 ];
+    return QStringView( text_.data() + begin, static_cast<qsizetype>( ends_[ index ] - begin ) );
+}
+
+void LineBatch::clear()
+{
+    textSize_ = 0;
+    ends_.clear();
+}
+
+void LineBatch::reserve( size_t codeUnits, size_t lines )
+{
+    if ( text_.size() < textSize_ + codeUnits ) {
+        text_.resize( textSize_ + codeUnits );
+    }
+    ends_.reserve( ends_.size() + lines );
+}
+
+void LineBatch::append( QStringView line )
+{
+    const auto length = static_cast<size_t>( line.size() );
+    std::copy_n( line.utf16(), length, beginLine( length ) );
+    finishLine( length );
+}
+
+char16_t* LineBatch::beginLine( size_t maxLength )
+{
+    if ( text_.size() < textSize_ + maxLength ) {
+        text_.resize( std::max( text_.size() * 2, textSize_ + maxLength ) );
+    }
+    return text_.data() + textSize_;
+}
+
+void LineBatch::finishLine( size_t length )
+{
+    textSize_ += length;
+    ends_.push_back( textSize_ );
+}
@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "linecache.h"
+
+#include <numeric>
+
+namespace {
+size_t pageSize( const LineCache::Page& lines )
+{
+    if ( !lines ) {
+        return 0;
+    }
+
+    return std::accumulate(
+        lines->begin(), lines->end(), lines->capacity() * sizeof( QString ),
+        []( size_t size, const QString& line ) {
+            return size + static_cast<size_t>( line.capacity() ) * sizeof( QChar );
+        } );
+}
+} // namespace
+
+LineCache::Page LineCache::find( uint64_t page ) const
+{
+    ScopedLock lock( mutex_ );
+    const auto cachedPage = pages_.find( page );
+    if ( cachedPage == pages_.end() ) {
+        return {};
+    }
+
+    usage_.splice( usage_.begin(), usage_, cachedPage->second.second );
+    return cachedPage->second.first;
+}
+
+bool LineCache::contains( uint64_t page ) const
+{
+    ScopedLock lock( mutex_ );
+    return pages_.count( page ) > 0;
+}
+
+uint64_t LineCache::generation() const
+{
+    ScopedLock lock( mutex_ );
+    return generation_;
+}
+
+void LineCache::insert( uint64_t generation, uint64_t page, Page lines )
+{
+    const auto linesSize = pageSize( lines );
+
+    ScopedLock lock( mutex_ );
+    if ( generation != generation_ ) {
+        return;
+    }
+
+    const auto cachedPage = pages_.find( page );
+    if ( cachedPage != pages_.end() ) {
+        allocatedSize_ += linesSize - pageSize( cachedPage->second.first );
+        cachedPage->second.first = std::move( lines );
+        usage_.splice( usage_.begin(), usage_, cachedPage->second.second );
+        return;
+    }
+
+    if ( pages_.size() >= MaxPages ) {
+        const auto evictedPage = pages_.find( usage_.back() );
+        allocatedSize_ -= pageSize( evictedPage->second.first );
+        pages_.erase( evictedPage );
+        usage_.pop_back();
+    }
+
+    allocatedSize_ += linesSize;
+    usage_.push_front( page );
+    pages_.emplace( page, std::make_pair( std::move( lines ), usage_.begin() ) );
+}
+
+void LineCache::clear()
+{
+    ScopedLock lock( mutex_ );
+    ++generation_;
+    pages_.clear();
+    usage_.clear();
+    allocatedSize_ = 0;
+}
+
+size_t LineCache::allocatedSize() const
+{
+    ScopedLock lock( mutex_ );
+    return allocatedSize_;
+}
@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "linechunks.h"
+
+#include <algorithm>
+#include <utility>
+
+std::vector<LinesChunk> splitLines( LineNumber first, LinesCount count, LinesCount chunkLines )
+{
+    std::vector<LinesChunk> chunks;
+    const auto end = first + count;
+    for ( auto chunkStart = first; chunkStart < end; chunkStart = chunkStart + chunkLines ) {
+        const auto runLines = LinesCount( std::min( chunkLines.get(), ( end - chunkStart ).get() ) );
+        chunks.push_back( LinesChunk{ LinesRun{ chunkStart, runLines } } );
+    }
+    return chunks;
+}
+
+std::vector<LinesChunk> splitLines( const SearchResultArray& lines, LinesCount chunkLines )
+{
+    std::vector<LinesChunk> chunks;
+    LinesChunk chunk;
+    LinesCount::UnderlyingType linesInChunk = 0;
+    for ( const auto line : lines ) {
+        if ( linesInChunk == chunkLines.get() ) {
+            chunks.push_back( std::move( chunk ) );
+            chunk = {};
+            linesInChunk = 0;
+        }
+
+        if ( !chunk.empty() && ( chunk.back().first + chunk.back().count ).get() == line ) {
+            chunk.back().count = chunk.back().count + 1_lcount;
+        }
+        else {
+            chunk.push_back( { LineNumber( line ), 1_lcount } );
+        }
+        ++linesInChunk;
+    }
+    if ( !chunk.empty() ) {
+        chunks.push_back( std::move( chunk ) );
+    }
+    return chunks;
+}
@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "linehashdiff.h"
+
+#include <algorithm>
+#include <cstddef>
+
+#include <tbb/enumerable_thread_specific.h>
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_sort.h>
+
+#include "linehashindex.h"
+#include "log.h"
+#include "logdata.h"
+
+namespace {
+constexpr size_t ChunkLines = 1 << 16;
+} // namespace
+
+LineHashDiff::LineHashDiff( const LogData* first, const LogData* second )
+    : first_( first )
+    , second_( second )
+{
+}
+
+LinesCount LineHashDiff::linesCount() const
+{
+    return first_->getNbLine() + second_->getNbLine();
+}
+
+LineHashDiff::Result LineHashDiff::compare( const AtomicFlag& interruptRequested,
+                                            std::atomic<uint64_t>& processedLines ) const
+{
+    const auto firstHashes = lineHashes( first_, interruptRequested, processedLines );
+    const auto secondHashes = lineHashes( second_, interruptRequested, processedLines );
+
+    Result result;
+    result.onlyInFirst = linesNotIn( firstHashes, sortedHashes( secondHashes ),
+                                     interruptRequested, processedLines );
+    result.onlyInSecond = linesNotIn( secondHashes, sortedHashes( firstHashes ),
+                                      interruptRequested, processedLines );
+
+    if ( interruptRequested ) {
+        return {};
+    }
+
+    LOG_INFO << "Compared " << firstHashes.size() << " and " << secondHashes.size()
+             << " lines, " << result.onlyInFirst.cardinality() << " and "
+             << result.onlyInSecond.cardinality() << " lines are only in one file";
+
+    return result;
+}
+
+std::vector<uint64_t> LineHashDiff::lineHashes( const LogData* logData,
+                                                const AtomicFlag& interruptRequested,
+                                                std::atomic<uint64_t>& processedLines ) const
+{
+    const auto nbLines = static_cast<size_t>( logData->getNbLine().get() );
+    std::vector<uint64_t> hashes( nbLines, LineHashIndex::UnknownHash );
+
+    // Index is locked for one chunk at a time, so indexing is not blocked for long
+    tbb::enumerable_thread_specific<std::vector<uint64_t>> threadHashes;
+    tbb::parallel_for( tbb::blocked_range<size_t>( 0, nbLines, ChunkLines ),
+                       [ & ]( const tbb::blocked_range<size_t>& range ) {
+                           if ( interruptRequested ) {
+                               return;
+                           }
+
+                           auto& chunkHashes = threadHashes.local();
+                           chunkHashes.clear();
+                           logData->getLineHashes( LineNumber( range.begin() ),
+                                                   LinesCount( range.size() ), chunkHashes );
+                           std::copy( chunkHashes.begin(), chunkHashes.end(),
+                                      hashes.begin()
+                                          + static_cast<std::ptrdiff_t>( range.begin() ) );
+
+                           processedLines += range.size();
+                       } );
+
+    return hashes;
+}
+
+std::vector<uint64_t> LineHashDiff::sortedHashes( std::vector<uint64_t> hashes )
+{
+    tbb::parallel_sort( hashes.begin(), hashes.end() );
+    hashes.erase( std::unique( hashes.begin(), hashes.end() ), hashes.end() );
+
+    if ( !hashes.empty() && hashes.front() == LineHashIndex::UnknownHash ) {
+        hashes.erase( hashes.begin() );
+    }
+    return hashes;
+}
+
+SearchResultArray LineHashDiff::linesNotIn( const std::vector<uint64_t>& hashes,
+                                            const std::vector<uint64_t>& sortedHashes,
+                                            const AtomicFlag& interruptRequested,
+                                            std::atomic<uint64_t>& processedLines )
+{
+    tbb::enumerable_thread_specific<SearchResultArray> threadLines;
+    tbb::parallel_for( tbb::blocked_range<size_t>( 0, hashes.size(), ChunkLines ),
+                       [ & ]( const tbb::blocked_range<size_t>& range ) {
+                           if ( interruptRequested ) {
+                               return;
+                           }
+
+                           auto& lines = threadLines.local();
+                           for ( auto line = range.begin(); line != range.end(); ++line ) {
+                               const auto hash = hashes[ line ];
+                               if ( hash != LineHashIndex::UnknownHash
+                                    && !std::binary_search( sortedHashes.begin(),
+                                                            sortedHashes.end(), hash ) ) {
+                                   lines.add( line );
+                               }
+                           }
+
+                           processedLines += range.size();
+                       } );
+
+    SearchResultArray lines;
+    for ( const auto& chunkLines : threadLines ) {
+        lines |= chunkLines;
+    }
+    lines.runOptimize();
+    return lines;
+}
@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "linehashindex.h"
+
+#include <algorithm>
+#include <cstddef>
+
+#include <QDataStream>
+
+#include "filedigest.h"
+#include "streamlimits.h"
+
+namespace {
+uint64_t lineHash( std::string_view line )
+{
+    const auto hash = FileDigest::blockDigest( line.data(), line.size() );
+    // Zero marks lines with unknown text
+    return hash != 0 ? hash : 1;
+}
+} // namespace
+
+LineHashIndex::LineHashIndex( bool isEnabled )
+    : isEnabled_( isEnabled )
+{
+}
+
+LinesCount LineHashIndex::size() const
+{
+    return LinesCount( hashes_.size() );
+}
+
+void LineHashIndex::append( const std::vector<std::string_view>& lines )
+{
+    if ( !isEnabled_ ) {
+        return;
+    }
+
+    hashes_.reserve( hashes_.size() + lines.size() );
+    for ( const auto& line : lines ) {
+        hashes_.push_back( line.data() != nullptr ? lineHash( line ) : UnknownHash );
+    }
+}
+
+void LineHashIndex::truncate( LinesCount count )
+{
+    if ( hashes_.size() > count.get() ) {
+        hashes_.resize( count.get() );
+    }
+}
+
+std::optional<uint64_t> LineHashIndex::hash( LineNumber line ) const
+{
+    if ( line.get() >= hashes_.size() || hashes_[ line.get() ] == UnknownHash ) {
+        return {};
+    }
+    return hashes_[ line.get() ];
+}
+
+void LineHashIndex::hashes( LineNumber first, LinesCount count,
+                            std::vector<uint64_t>& hashes ) const
+{
+    const auto begin = std::min( first.get(), static_cast<uint64_t>( hashes_.size() ) );
+    const auto end = std::min( first.get() + count.get(), static_cast<uint64_t>( hashes_.size() ) );
+    hashes.insert( hashes.end(), hashes_.begin() + static_cast<std::ptrdiff_t>( begin ),
+                   hashes_.begin() + static_cast<std::ptrdiff_t>( end ) );
+    hashes.resize( hashes.size() + count.get() - ( end - begin ), UnknownHash );
+}
+
+size_t LineHashIndex::allocatedSize() const
+{
+    return hashes_.capacity() * sizeof( uint64_t );
+}
+
+void LineHashIndex::save( QDataStream& stream ) const
+{
+    stream << static_cast<quint64>( hashes_.size() );
+    for ( const auto hash : hashes_ ) {
+        stream << static_cast<quint64>( hash );
+    }
+}
+
+bool LineHashIndex::load( QDataStream& stream )
+{
+    quint64 size = 0;
+    stream >> size;
+    if ( !isCountInStream( stream, size, sizeof( quint64 ) ) ) {
+        return false;
+    }
+
+    // Hashes are read even if they are not used, line positions follow them
+    std::vector<uint64_t> hashes;
+    if ( isEnabled_ ) {
+        hashes.reserve( static_cast<size_t>( size ) );
+    }
+    for ( auto i = 0u; i < size && stream.status() == QDataStream::Ok; ++i ) {
+        quint64 hash = 0;
+        stream >> hash;
+        if ( isEnabled_ ) {
+            hashes.push_back( hash );
+        }
+    }
+
+    if ( stream.status() != QDataStream::Ok ) {
+        return false;
+    }
+
+    hashes_ = std::move( hashes );
+    return true;
+}
@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "linelengthindex.h"
+
+#include <limits>
+
+namespace {
+// Expanded length of ASCII line, empty for other lines
+std::optional<uint64_t> expandedLength( std::string_view line )
+{
+    // Carriage return is not displayed
+    if ( !line.empty() && line.back() == '\r' ) {
+        line.remove_suffix( 1 );
+    }
+
+    uint64_t column = 0;
+    for ( const auto c : line ) {
+        if ( static_cast<uint8_t>( c ) >= 0x80 ) {
+            return {};
+        }
+        column = c == '\t' ? column + TabStop - column % TabStop : column + 1;
+    }
+    return column;
+}
+} // namespace
+
+LineLengthIndex::LineLengthIndex( bool isEnabled )
+    : isEnabled_( isEnabled )
+{
+}
+
+LinesCount LineLengthIndex::size() const
+{
+    return LinesCount( lengths_.size() );
+}
+
+void LineLengthIndex::append( const std::vector<std::string_view>& lines )
+{
+    if ( !isEnabled_ ) {
+        return;
+    }
+
+    lengths_.reserve( lengths_.size() + lines.size() );
+    for ( const auto& line : lines ) {
+        const auto length = line.data() != nullptr ? expandedLength( line ) : std::nullopt;
+        if ( !length || *length > std::numeric_limits<LineLength::UnderlyingType>::max() ) {
+            lengths_.push_back( UnknownLength );
+        }
+        else if ( *length >= LongLength ) {
+            longLines_.emplace( lengths_.size(),
+                                static_cast<LineLength::UnderlyingType>( *length ) );
+            lengths_.push_back( LongLength );
+        }
+        else {
+            lengths_.push_back( static_cast<uint8_t>( *length ) );
+        }
+    }
+}
+
+void LineLengthIndex::truncate( LinesCount count )
+{
+    while ( lengths_.size() > count.get() ) {
+        if ( lengths_.back() == LongLength ) {
+            longLines_.erase( lengths_.size() - 1 );
+        }
+        lengths_.pop_back();
+    }
+}
+
+std::optional<LineLength> LineLengthIndex::length( LineNumber line ) const
+{
+    if ( line.get() >= lengths_.size() ) {
+        return {};
+    }
+
+    const auto length = lengths_[ line.get() ];
+    if ( length == UnknownLength ) {
+        return {};
+    }
+    if ( length == LongLength ) {
+        return LineLength( longLines_.at( line.get() ) );
+    }
+    return LineLength( length );
+}
+
+size_t LineLengthIndex::allocatedSize() const
+{
+    return lengths_.capacity()
+           + longLines_.size()
+                 * ( sizeof( LineNumber::UnderlyingType ) + sizeof( LineLength::UnderlyingType )
+                     + sizeof( void* ) );
+}
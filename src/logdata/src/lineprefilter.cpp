@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "lineprefilter.h"
+
+#include <cstring>
+
+#include "ansicolors.h"
+
+namespace {
+constexpr char Escape = '\x1B';
+} // namespace
+
+LinePrefilter::LinePrefilter( const QString& pattern )
+    : isActive_( !pattern.isEmpty() )
+    , isAnsiColorSequences_( pattern == QLatin1String( AnsiColorSequences ) )
+{
+    if ( isActive_ ) {
+        regex_ = QRegularExpression( pattern, QRegularExpression::CaseInsensitiveOption );
+    }
+}
+
+size_t LinePrefilter::stripBytes( const char* data, size_t size, char* output ) const
+{
+    const auto* pos = data;
+    const auto* end = data + size;
+    size_t written = 0;
+
+    while ( pos < end ) {
+        const auto* escape
+            = static_cast<const char*>( std::memchr( pos, Escape, static_cast<size_t>( end - pos ) ) );
+        const auto* copyEnd = escape ? escape : end;
+
+        // Output is never ahead of input, so it can overlap
+        std::memmove( output + written, pos, static_cast<size_t>( copyEnd - pos ) );
+        written += static_cast<size_t>( copyEnd - pos );
+
+        if ( !escape ) {
+            break;
+        }
+
+        if ( const auto* sequenceEnd = ansi_colors::sequenceEnd( escape, end ) ) {
+            pos = sequenceEnd;
+        }
+        else {
+            output[ written++ ] = *escape;
+            pos = escape + 1;
+        }
+    }
+
+    return written;
+}
+
+void LinePrefilter::strip( QString& text ) const
+{
+    if ( isActive_ ) {
+        text.remove( regex_ );
+    }
+}
@@ -0,0 +1,258 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "linescanner.h"
+
+#include <array>
+#include <bitset>
+#include <cstring>
+
+#include "cpu_info.h"
+#include "log.h"
+
+#if defined( __x86_64__ ) || defined( _M_X64 ) || defined( __i386__ ) || defined( _M_IX86 )
+#define KLOGG_SCANNER_X86
+#include <immintrin.h>
+#elif defined( __aarch64__ )
+#define KLOGG_SCANNER_NEON
+#include <arm_neon.h>
+#endif
+
+// Kernels for newer instructions are compiled for them even if the rest
+// of the code is built for a generic CPU, they are chosen at runtime
+#if defined( KLOGG_SCANNER_X86 ) && ( defined( __GNUC__ ) || defined( __clang__ ) )
+#define KLOGG_TARGET_AVX2 __attribute__( ( target( "avx2" ) ) )
+#define KLOGG_TARGET_AVX512BW __attribute__( ( target( "avx512f,avx512bw" ) ) )
+#else
+#define KLOGG_TARGET_AVX2
+#define KLOGG_TARGET_AVX512BW
+#endif
+
+namespace line_scanner {
+
+namespace {
+
+DelimeterMasks scanStrideScalar( const char* data, std::size_t size )
+{
+    DelimeterMasks masks{ 0, 0 };
+    for ( auto i = 0u; i < size; ++i ) {
+        masks.lineFeeds |= static_cast<uint64_t>( data[ i ] == '\n' ) << i;
+        masks.tabs |= static_cast<uint64_t>( data[ i ] == '\t' ) << i;
+    }
+    return masks;
+}
+
+// Vector implementations always read whole stride,
+// the last one in a block goes through zero padded copy.
+template <DelimeterMasks ( *ScanFullStride )( const char* )>
+DelimeterMasks scanStride( const char* data, std::size_t size )
+{
+    if ( size == StrideSize ) {
+        return ScanFullStride( data );
+    }
+
+    std::array<char, StrideSize> paddedStride{};
+    std::memcpy( paddedStride.data(), data, size );
+    return ScanFullStride( paddedStride.data() );
+}
+
+#ifdef KLOGG_SCANNER_X86
+DelimeterMasks scanFullStrideSse2( const char* data )
+{
+    const auto lineFeed = _mm_set1_epi8( '\n' );
+    const auto tab = _mm_set1_epi8( '\t' );
+
+    DelimeterMasks masks{ 0, 0 };
+    for ( auto i = 0u; i < StrideSize / 16; ++i ) {
+        const auto chunk = _mm_loadu_si128( reinterpret_cast<const __m128i*>( data + i * 16 ) );
+        const auto lineFeedBits = static_cast<uint16_t>(
+            _mm_movemask_epi8( _mm_cmpeq_epi8( chunk, lineFeed ) ) );
+        const auto tabBits
+            = static_cast<uint16_t>( _mm_movemask_epi8( _mm_cmpeq_epi8( chunk, tab ) ) );
+
+        masks.lineFeeds |= static_cast<uint64_t>( lineFeedBits ) << ( i * 16 );
+        masks.tabs |= static_cast<uint64_t>( tabBits ) << ( i * 16 );
+    }
+    return masks;
+}
+
+KLOGG_TARGET_AVX2 uint64_t movemaskAvx2( __m256i bytes )
+{
+    return static_cast<uint64_t>( static_cast<uint32_t>( _mm256_movemask_epi8( bytes ) ) );
+}
+
+KLOGG_TARGET_AVX2 DelimeterMasks scanFullStrideAvx2( const char* data )
+{
+    const auto lineFeed = _mm256_set1_epi8( '\n' );
+    const auto tab = _mm256_set1_epi8( '\t' );
+
+    const auto low = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( data ) );
+    const auto high = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( data + 32 ) );
+
+    DelimeterMasks masks;
+    masks.lineFeeds = movemaskAvx2( _mm256_cmpeq_epi8( low, lineFeed ) )
+                      | ( movemaskAvx2( _mm256_cmpeq_epi8( high, lineFeed ) ) << 32 );
+    masks.tabs = movemaskAvx2( _mm256_cmpeq_epi8( low, tab ) )
+                 | ( movemaskAvx2( _mm256_cmpeq_epi8( high, tab ) ) << 32 );
+    return masks;
+}
+
+// Whole stride is one register, comparison gives its masks directly
+KLOGG_TARGET_AVX512BW DelimeterMasks scanFullStrideAvx512( const char* data )
+{
+    const auto bytes = _mm512_loadu_si512( data );
+
+    DelimeterMasks masks;
+    masks.lineFeeds = _mm512_cmpeq_epi8_mask( bytes, _mm512_set1_epi8( '\n' ) );
+    masks.tabs = _mm512_cmpeq_epi8_mask( bytes, _mm512_set1_epi8( '\t' ) );
+    return masks;
+}
+#endif
+
+#ifdef KLOGG_SCANNER_NEON
+uint64_t neonMovemask( uint8x16_t b0, uint8x16_t b1, uint8x16_t b2, uint8x16_t b3 )
+{
+    const uint8x16_t bitMask
+        = { 0x01, 0x02, 0x4, 0x8, 0x10, 0x20, 0x40, 0x80, 0x01, 0x02, 0x4, 0x8, 0x10, 0x20, 0x40, 0x80 };
+    auto t0 = vandq_u8( b0, bitMask );
+    auto t1 = vandq_u8( b1, bitMask );
+    auto t2 = vandq_u8( b2, bitMask );
+    auto t3 = vandq_u8( b3, bitMask );
+    auto sum0 = vpaddq_u8( t0, t1 );
+    auto sum1 = vpaddq_u8( t2, t3 );
+    sum0 = vpaddq_u8( sum0, sum1 );
+    sum0 = vpaddq_u8( sum0, sum0 );
+    return vgetq_lane_u64( vreinterpretq_u64_u8( sum0 ), 0 );
+}
+
+DelimeterMasks scanFullStrideNeon( const char* data )
+{
+    const auto bytes = reinterpret_cast<const uint8_t*>( data );
+    const auto c0 = vld1q_u8( bytes );
+    const auto c1 = vld1q_u8( bytes + 16 );
+    const auto c2 = vld1q_u8( bytes + 32 );
+    const auto c3 = vld1q_u8( bytes + 48 );
+
+    const auto lineFeed = vdupq_n_u8( '\n' );
+    const auto tab = vdupq_n_u8( '\t' );
+
+    DelimeterMasks masks;
+    masks.lineFeeds = neonMovemask( vceqq_u8( c0, lineFeed ), vceqq_u8( c1, lineFeed ),
+                                    vceqq_u8( c2, lineFeed ), vceqq_u8( c3, lineFeed ) );
+    masks.tabs = neonMovemask( vceqq_u8( c0, tab ), vceqq_u8( c1, tab ), vceqq_u8( c2, tab ),
+                               vceqq_u8( c3, tab ) );
+    return masks;
+}
+#endif
+
+// Bit of each control byte that is not whitespace (\t to \r) or escape
+constexpr uint32_t BinaryControlBytes = ~( ( 0x1fu << '\t' ) | ( 1u << 0x1b ) );
+
+using CountBinary = std::size_t ( * )( const char* data, std::size_t size );
+
+std::size_t countBinaryBytesScalar( const char* data, std::size_t size )
+{
+    std::size_t count = 0;
+    for ( auto i = 0u; i < size; ++i ) {
+        const auto byte = static_cast<uint8_t>( data[ i ] );
+        count += ( byte < 0x20 ) & ( BinaryControlBytes >> ( byte & 0x1f ) );
+    }
+    return count;
+}
+
+#ifdef KLOGG_SCANNER_X86
+std::size_t countBinaryBytesSse2( const char* data, std::size_t size )
+{
+    const auto maxControl = _mm_set1_epi8( 0x1f );
+    const auto firstWhitespace = _mm_set1_epi8( '\t' );
+    const auto whitespaceRange = _mm_set1_epi8( '\r' - '\t' );
+    const auto escape = _mm_set1_epi8( 0x1b );
+
+    std::size_t count = 0;
+    std::size_t position = 0;
+    for ( ; position + 16 <= size; position += 16 ) {
+        const auto chunk = _mm_loadu_si128( reinterpret_cast<const __m128i*>( data + position ) );
+
+        // Unsigned comparisons are done as min( a, b ) == a
+        const auto isControl = _mm_cmpeq_epi8( _mm_min_epu8( chunk, maxControl ), chunk );
+        const auto whitespace = _mm_sub_epi8( chunk, firstWhitespace );
+        const auto isWhitespace
+            = _mm_cmpeq_epi8( _mm_min_epu8( whitespace, whitespaceRange ), whitespace );
+        const auto isAllowed = _mm_or_si128( isWhitespace, _mm_cmpeq_epi8( chunk, escape ) );
+
+        const auto binaryBits = static_cast<uint32_t>(
+            _mm_movemask_epi8( _mm_andnot_si128( isAllowed, isControl ) ) );
+        count += std::bitset<16>( binaryBits ).count();
+    }
+
+    return count + countBinaryBytesScalar( data + position, size - position );
+}
+#endif
+
+CountBinary selectBinaryCounter()
+{
+#if defined( KLOGG_SCANNER_X86 )
+    if ( hasRequiredInstructions( supportedCpuInstructions(), CpuInstructions::SSE2 ) ) {
+        return countBinaryBytesSse2;
+    }
+#endif
+    // Loop is simple enough to be vectorized by compiler on other platforms
+    return countBinaryBytesScalar;
+}
+
+ScanStride selectStrideScanner()
+{
+#if defined( KLOGG_SCANNER_X86 )
+    const auto cpuInstructions = supportedCpuInstructions();
+    if ( hasRequiredInstructions( cpuInstructions, CpuInstructions::AVX512BW ) ) {
+        LOG_INFO << "Using AVX-512 line scanner";
+        return scanStride<scanFullStrideAvx512>;
+    }
+    if ( hasRequiredInstructions( cpuInstructions, CpuInstructions::AVX2 ) ) {
+        LOG_INFO << "Using AVX2 line scanner";
+        return scanStride<scanFullStrideAvx2>;
+    }
+    if ( hasRequiredInstructions( cpuInstructions, CpuInstructions::SSE2 ) ) {
+        LOG_INFO << "Using SSE2 line scanner";
+        return scanStride<scanFullStrideSse2>;
+    }
+#elif defined( KLOGG_SCANNER_NEON )
+    LOG_INFO << "Using NEON line scanner";
+    return scanStride<scanFullStrideNeon>;
+#endif
+
+    LOG_INFO << "Using scalar line scanner";
+    return scanStrideScalar;
+}
+
+} // namespace
+
+ScanStride strideScanner()
+{
+    static const auto scanner = selectStrideScanner();
+    return scanner;
+}
+
+std::size_t countBinaryBytes( std::string_view data )
+{
+    static const auto countBinary = selectBinaryCounter();
+    return countBinary( data.data(), data.size() );
+}
+
+} // namespace line_scanner
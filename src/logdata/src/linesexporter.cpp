@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "linesexporter.h"
+
+#include <algorithm>
+#include <utility>
+
+#include <QIODevice>
+
+#include "log.h"
+#include "logdata.h"
+
+namespace {
+constexpr LinesCount::UnderlyingType ChunkLines = 5000;
+}
+
+LinesExporter::LinesExporter( const LogData* logData, LineNumber first, LinesCount count )
+    : logData_( logData )
+    , first_( first )
+    , count_( count )
+{
+}
+
+LinesExporter::LinesExporter( const LogData* logData, SearchResultArray lines, LineNumber first,
+                              LinesCount count )
+    : logData_( logData )
+    , lines_( std::move( lines ) )
+    , first_( first )
+    , count_( count )
+{
+}
+
+bool LinesExporter::write( QIODevice& device, const AtomicFlag& interruptRequested,
+                           std::atomic<uint64_t>& writtenLines ) const
+{
+    if ( !lines_ ) {
+        return writeRange( device, first_, count_, interruptRequested, writtenLines );
+    }
+
+    uint64_t firstLine = 0;
+    if ( count_.get() == 0 || !lines_->select( first_.get(), &firstLine ) ) {
+        return true;
+    }
+
+    // Consecutive lines are read at once
+    auto line = lines_->begin();
+    line.move( firstLine );
+
+    auto rangeStart = *line;
+    LinesCount::UnderlyingType rangeSize = 0;
+    for ( auto index = 0u; index < count_.get() && line != lines_->end(); ++index, ++line ) {
+        if ( *line != rangeStart + rangeSize || rangeSize == ChunkLines ) {
+            if ( !writeRange( device, LineNumber( rangeStart ), LinesCount( rangeSize ),
+                              interruptRequested, writtenLines ) ) {
+                return false;
+            }
+
+            rangeStart = *line;
+            rangeSize = 0;
+        }
+        ++rangeSize;
+    }
+
+    return writeRange( device, LineNumber( rangeStart ), LinesCount( rangeSize ),
+                       interruptRequested, writtenLines );
+}
+
+bool LinesExporter::writeRange( QIODevice& device, LineNumber first, LinesCount count,
+                                const AtomicFlag& interruptRequested,
+                                std::atomic<uint64_t>& writtenLines ) const
+{
+    LogData::RawLines rawLines;
+    const auto end = first + count;
+    for ( auto chunkStart = first; chunkStart < end;
+          chunkStart = chunkStart + LinesCount( ChunkLines ) ) {
+        if ( interruptRequested ) {
+            return true;
+        }
+
+        const auto chunkLines = LinesCount( std::min( ChunkLines, ( end - chunkStart ).get() ) );
+        logData_->getLinesRaw( chunkStart, chunkLines, rawLines );
+
+        const auto data = rawLines.data();
+        if ( rawLines.endOfLines.empty()
+             || static_cast<qint64>( data.size() ) != rawLines.endOfLines.back() ) {
+            LOG_ERROR << "Failed to read lines from " << chunkStart << " for export";
+            return false;
+        }
+
+        const auto size = static_cast<qint64>( data.size() );
+        if ( device.write( data.data(), size ) != size ) {
+            LOG_ERROR << "Failed to write exported lines: " << device.errorString();
+            return false;
+        }
+
+        writtenLines += chunkLines.get();
+    }
+
+    return true;
+}
@@ -41,24 +41,33 @@
 #include <algorithm>
 #include <cassert>
 #include <cstddef>
+#include <cstring>
 #include <iostream>
 #include <iterator>
-#include <numeric>
 #include <qregularexpression.h>
 #include <qtextcodec.h>
+#include <string>
 #include <string_view>
 #include <utility>
 #include <vector>
 
+#include <QDir>
 #include <QFileInfo>
 #include <QIODevice>
+#include <QTimerEvent>
 
 #include <simdutf.h>
 
+#include "blockcache.h"
 #include "configuration.h"
+#include "runnable_lambda.h"
 #include "linetypes.h"
 #include "log.h"
 #include "logfiltereddata.h"
+#include "memory_info.h"
+#include "remotefile.h"
+#include "tabpositions.h"
+#include "tracezone.h"
 
 #include "logdata.h"
 
@@ -83,6 +92,8 @@ LogData::LogData()
 
     operationQueue_.setWorker( std::move( worker ) );
 
+    prefetchPool_.setMaxThreadCount( 1 );
+
     const auto& config = Configuration::get();
     keepFileClosed_ = config.keepFileClosed();
 
@@ -90,22 +101,99 @@ LogData::LogData()
         LOG_INFO << "Keep file closed option is set";
     }
 
+    // Pages of a mapped file cut off by its truncation raise SIGBUS
+    // when a search touches them, so files that are watched, and can be
+    // truncated or grow under a search, are read with positional reads
+    useMemoryMappedFiles_ = config.useMemoryMappedFiles() && !config.anyFileWatchEnabled();
+
     const auto defaultEncodingMib = config.defaultEncodingMib();
     if ( defaultEncodingMib >= 0 ) {
         codec_.setCodec( QTextCodec::codecForMib( defaultEncodingMib ) );
     }
+
+    MemoryGovernor::get().addConsumer( this );
 }
 
 LogData::~LogData()
 {
     LOG_DEBUG << "Destroying log data";
+    MemoryGovernor::get().removeConsumer( this );
+    prefetchPool_.clear();
+    prefetchPool_.waitForDone();
     operationQueue_.shutdown();
 }
 
 void LogData::setPrefilter( const QString& prefilterPattern )
 {
     IndexingData::MutateAccessor scopedAccessor{ indexing_data_.get() };
-    prefilterPattern_ = prefilterPattern;
+    prefilter_ = LinePrefilter( prefilterPattern );
+    lineCache_.clear();
+}
+
+QString LogData::memoryConsumerFile() const
+{
+    return indexingFileName_;
+}
+
+size_t LogData::memoryUsage() const
+{
+    return IndexingData::ConstAccessor{ indexing_data_.get() }.residentSize()
+           + lineCache_.allocatedSize();
+}
+
+std::vector<MemoryConsumer::MemoryUsagePart> LogData::memoryUsageParts() const
+{
+    const auto indexUsage = IndexingData::ConstAccessor{ indexing_data_.get() }.memoryUsage();
+
+    std::vector<MemoryUsagePart> parts;
+    parts.emplace_back( "Line index", indexUsage.linePositions );
+
+    // Optional indexes are listed only if they are used
+    const auto addPart = [ &parts ]( const char* name, size_t size ) {
+        if ( size > 0 ) {
+            parts.emplace_back( name, size );
+        }
+    };
+    addPart( "Trigram index", indexUsage.trigramIndex );
+    addPart( "Timestamp index", indexUsage.timestampIndex );
+    addPart( "Field index", indexUsage.fieldIndex );
+    addPart( "Token index", indexUsage.tokenIndex );
+    addPart( "Line lengths", indexUsage.lineLengths );
+    addPart( "Line hashes", indexUsage.lineHashes );
+    addPart( "Record starts", indexUsage.recordStarts );
+    addPart( "Binary regions", indexUsage.binaryRegions );
+
+    parts.emplace_back( "Decoded lines", lineCache_.allocatedSize() );
+    return parts;
+}
+
+void LogData::releaseMemory( Release release )
+{
+    switch ( release ) {
+    case Release::Caches: {
+        lineCache_.clear();
+        ScopedLock lock( tabExpansionMutex_ );
+        tabExpansionIndexes_.clear();
+        break;
+    }
+    case Release::CompactResults:
+        break;
+    case Release::SparseIndex: {
+        QTextCodec* forcedEncoding = nullptr;
+        {
+            IndexingData::ConstAccessor scopedAccessor{ indexing_data_.get() };
+            if ( !attached_file_ || isIndexing() || scopedAccessor.isSparseIndex() ) {
+                return;
+            }
+            forcedEncoding = scopedAccessor.getForcedEncoding();
+        }
+
+        LOG_INFO << "Reindexing " << indexingFileName_ << " with sparse index to save memory";
+        indexing_data_->preferSparseIndex();
+        reload( forcedEncoding );
+        break;
+    }
+    }
 }
 
 void LogData::attachFile( const QString& fileName )
@@ -118,9 +206,21 @@ void LogData::attachFile( const QString& fileName )
     }
 
     indexingFileName_ = fileName;
-    attached_file_.reset( new FileHolder( keepFileClosed_ ) );
+    attached_file_.reset( new FileHolder( keepFileClosed_, useMemoryMappedFiles_ ) );
     attached_file_->open( indexingFileName_ );
 
+    // Index should fit into memory the budget leaves, or into half
+    // of physical memory when there is no budget
+    const auto budgetMb = Configuration::get().memoryBudgetMb();
+    const uint64_t memoryLimit = budgetMb > 0 ? static_cast<uint64_t>( budgetMb ) * 1024 * 1024
+                                              : physicalMemory() / 2;
+    const uint64_t usedMemory
+        = budgetMb > 0 ? MemoryGovernor::get().memoryUsage() : residentMemory();
+    if ( memoryLimit > 0 ) {
+        indexing_data_->setIndexMemoryLimit(
+            static_cast<size_t>( memoryLimit > usedMemory ? memoryLimit - usedMemory : 1 ) );
+    }
+
     operationQueue_.enqueueOperation<AttachOperation>( fileName );
 }
 
@@ -131,7 +231,326 @@ void LogData::interruptLoading()
 
 qint64 LogData::getFileSize() const
 {
-    return IndexingData::ConstAccessor{ indexing_data_.get() }.getIndexedSize();
+    return indexing_data_->getPublishedIndexedSize();
+}
+
+bool LogData::isIndexing() const
+{
+    return indexing_data_->isIndexingInProgress();
+}
+
+bool LogData::isLoaded() const
+{
+    return isLoaded_;
+}
+
+LinesCount LogData::getEstimatedNbLines() const
+{
+    const auto nbLines = getNbLine();
+    if ( !isIndexing() || !attached_file_ ) {
+        return nbLines;
+    }
+
+    const auto indexedSize = getFileSize();
+    const auto fileSize = attached_file_->size();
+    if ( indexedSize <= 0 ) {
+        const auto estimate = getIndexEstimate();
+        return estimate ? qMax( nbLines, estimate->lines ) : nbLines;
+    }
+    if ( fileSize <= indexedSize ) {
+        return nbLines;
+    }
+
+    const auto estimatedLines = static_cast<double>( nbLines.get() )
+                                * static_cast<double>( fileSize )
+                                / static_cast<double>( indexedSize );
+    return qMax( nbLines,
+                 LinesCount( static_cast<LinesCount::UnderlyingType>( estimatedLines ) ) );
+}
+
+std::optional<IndexEstimate> LogData::getIndexEstimate() const
+{
+    return indexing_data_->getIndexEstimate();
+}
+
+LinesPreview LogData::getLinesAtOffset( qint64 offset, LinesCount count ) const
+{
+    // Enough for a screen of lines, longer lines are cut
+    constexpr qint64 MaxPreviewBytes = 1024 * 1024;
+
+    LinesPreview preview;
+    if ( !attached_file_ || count.get() == 0 ) {
+        return preview;
+    }
+
+    try {
+        RawLines rawLines;
+        rawLines.textDecoder = codec_.makeDecoder();
+        const auto lineFeedWidth = rawLines.textDecoder.encodingParams.lineFeedWidth;
+        const auto lineFeedIndex = rawLines.textDecoder.encodingParams.lineFeedIndex;
+
+        ScopedFileHolder<FileHolder> fileHolder( attached_file_.get() );
+        const auto fileSize = attached_file_->size();
+        offset = qBound( qint64{ 0 }, offset - offset % lineFeedWidth, fileSize );
+
+        rawLines.buffer.resize( static_cast<size_t>( qMin( MaxPreviewBytes, fileSize - offset ) ) );
+        const auto bytesRead = fileHolder.read( offset, rawLines.buffer.data(),
+                                                static_cast<qint64>( rawLines.buffer.size() ) );
+        rawLines.buffer.resize( static_cast<size_t>( qMax( qint64{ 0 }, bytesRead ) ) );
+
+        // Offset is in the middle of a line unless it is the beginning of file
+        std::optional<qint64> firstLineStart;
+        if ( offset == 0 ) {
+            firstLineStart = 0;
+        }
+
+        const auto bufferSize = static_cast<qint64>( rawLines.buffer.size() );
+        for ( qint64 pos = lineFeedIndex; pos < bufferSize; pos += lineFeedWidth ) {
+            if ( rawLines.buffer[ static_cast<size_t>( pos ) ] != '\n' ) {
+                continue;
+            }
+
+            const auto lineEnd = pos - lineFeedIndex + lineFeedWidth;
+            if ( !firstLineStart ) {
+                firstLineStart = lineEnd;
+                continue;
+            }
+
+            rawLines.endOfLines.push_back( lineEnd - *firstLineStart );
+            if ( rawLines.endOfLines.size() == count.get() ) {
+                break;
+            }
+        }
+
+        if ( !firstLineStart ) {
+            return preview;
+        }
+
+        rawLines.buffer.erase( rawLines.buffer.begin(),
+                               rawLines.buffer.begin() + static_cast<ptrdiff_t>( *firstLineStart ) );
+        preview.offset = offset + *firstLineStart;
+        preview.lines = rawLines.decodeLines();
+
+    } catch ( const std::bad_alloc& ) {
+        LOG_ERROR << "not enough memory";
+        preview.lines.clear();
+    }
+
+    return preview;
+}
+
+OptionalLineNumber LogData::getIndexedLineAtOffset( qint64 offset ) const
+{
+    IndexingData::ConstAccessor scopedAccessor{ indexing_data_.get() };
+    if ( offset >= scopedAccessor.getIndexedSize() ) {
+        return {};
+    }
+
+    return scopedAccessor.getLineAtOffset( static_cast<LineOffset::UnderlyingType>( offset ) );
+}
+
+QString LogData::getFileName() const
+{
+    return indexingFileName_;
+}
+
+IndexedHash LogData::getIndexedHash() const
+{
+    return IndexingData::ConstAccessor{ indexing_data_.get() }.getHash();
+}
+
+bool LogData::addIndexToBundle( AnalysisBundle& bundle ) const
+{
+    if ( isIndexing() ) {
+        return false;
+    }
+
+    return bundle.setIndex( IndexingData::ConstAccessor{ indexing_data_.get() } );
+}
+
+bool LogData::mayContainTrigrams( LineNumber first, LinesCount count,
+                                  const TrigramFilter::Hashes& hashes ) const
+{
+    return IndexingData::ConstAccessor{ indexing_data_.get() }.mayContainTrigrams( first, count,
+                                                                                 hashes );
+}
+
+std::optional<std::pair<LineNumber, LineNumber>>
+LogData::getLinesInTimeRange( const QDateTime& begin, const QDateTime& end ) const
+{
+    const auto beginTimestamp = TimestampParser::toTimestamp( begin );
+    // Lines up to the last one written at the end are included
+    const auto endTimestamp = TimestampParser::toTimestamp( end ) + 1;
+
+    QString timestampFormat;
+    std::pair<LineNumber, LineNumber> beginLines;
+    std::pair<LineNumber, LineNumber> endLines;
+    {
+        IndexingData::ConstAccessor scopedAccessor{ indexing_data_.get() };
+        const auto beginRange = scopedAccessor.findTimestamp( beginTimestamp );
+        const auto endRange = scopedAccessor.findTimestamp( endTimestamp );
+        if ( !beginRange || !endRange ) {
+            return {};
+        }
+
+        timestampFormat = scopedAccessor.getTimestampFormat();
+        beginLines = { scopedAccessor.getLineAtOffset( beginRange->begin ),
+                       scopedAccessor.getLineAtOffset( beginRange->end ) };
+        endLines = { scopedAccessor.getLineAtOffset( endRange->begin ),
+                     scopedAccessor.getLineAtOffset( endRange->end ) };
+    }
+
+    // Index gives blocks of lines, exact lines are found
+    // by reading timestamps of all lines in them
+    const TimestampParser parser( timestampFormat );
+    const auto firstLine
+        = findLineAtTime( parser, beginTimestamp, beginLines.first, beginLines.second );
+    const auto lastLine = findLineAtTime( parser, endTimestamp, qMax( firstLine, endLines.first ),
+                                          qMax( firstLine, endLines.second ) );
+
+    LOG_INFO << "Lines in time range: " << firstLine << " - " << lastLine;
+    return std::make_pair( firstLine, lastLine );
+}
+
+QString LogData::getTimestampFormat() const
+{
+    return IndexingData::ConstAccessor{ indexing_data_.get() }.getTimestampFormat();
+}
+
+std::optional<TimeBuckets> LogData::getTimeBuckets( int count ) const
+{
+    if ( count <= 0 ) {
+        return {};
+    }
+
+    QString timestampFormat;
+    TimeBuckets buckets;
+    std::vector<std::pair<LineNumber, LineNumber>> bucketLines;
+    LineNumber endLine;
+    {
+        IndexingData::ConstAccessor scopedAccessor{ indexing_data_.get() };
+        const auto timeSpan = scopedAccessor.getTimeSpan();
+        if ( !timeSpan ) {
+            return {};
+        }
+
+        timestampFormat = scopedAccessor.getTimestampFormat();
+        buckets.begin = timeSpan->first;
+        buckets.duration = qMax( qint64{ 1 }, ( timeSpan->second - timeSpan->first ) / count + 1 );
+        endLine = LineNumber( scopedAccessor.getNbLines().get() );
+
+        for ( auto bucket = 1; bucket < count; ++bucket ) {
+            const auto range
+                = scopedAccessor.findTimestamp( buckets.begin + bucket * buckets.duration );
+            if ( !range ) {
+                return {};
+            }
+            bucketLines.emplace_back( scopedAccessor.getLineAtOffset( range->begin ),
+                                      scopedAccessor.getLineAtOffset( range->end ) );
+        }
+    }
+
+    // Index gives blocks of lines, first lines of buckets are found in them
+    const TimestampParser parser( timestampFormat );
+    buckets.boundaries.reserve( static_cast<size_t>( count ) + 1 );
+    buckets.boundaries.push_back( 0_lnum );
+    for ( auto bucket = 1; bucket < count; ++bucket ) {
+        const auto& lines = bucketLines[ static_cast<size_t>( bucket - 1 ) ];
+        const auto previous = buckets.boundaries.back();
+        buckets.boundaries.push_back(
+            findLineAtTime( parser, buckets.begin + bucket * buckets.duration,
+                            qMax( previous, lines.first ), qMax( previous, lines.second ) ) );
+    }
+    buckets.boundaries.push_back( qMax( buckets.boundaries.back(), endLine ) );
+
+    return buckets;
+}
+
+QStringList LogData::getIndexedFields() const
+{
+    return IndexingData::ConstAccessor{ indexing_data_.get() }.getIndexedFields();
+}
+
+std::optional<roaring::Roaring64Map>
+LogData::findLinesWithFields( const std::vector<FieldCondition>& conditions, LineNumber first,
+                              LineNumber last ) const
+{
+    return IndexingData::ConstAccessor{ indexing_data_.get() }.findFieldValues( conditions, first,
+                                                                              last );
+}
+
+std::optional<roaring::Roaring64Map>
+LogData::findLinesWithToken( const QString& text, LineNumber first, LineNumber last ) const
+{
+    const auto token = text.toUtf8();
+    return IndexingData::ConstAccessor{ indexing_data_.get() }.findToken(
+        std::string_view( token.constData(), static_cast<size_t>( token.size() ) ), first, last );
+}
+
+bool LogData::hasLineHashes() const
+{
+    return IndexingData::ConstAccessor{ indexing_data_.get() }.isLineHashIndexEnabled();
+}
+
+roaring::Roaring64Map LogData::findRepeatedLines( const roaring::Roaring64Map& lines ) const
+{
+    roaring::Roaring64Map repeatedLines;
+
+    const IndexingData::ConstAccessor scopedAccessor{ indexing_data_.get() };
+    std::optional<uint64_t> previousHash;
+    for ( const auto line : lines ) {
+        const auto hash = scopedAccessor.getLineHash( LineNumber( line ) );
+        if ( hash && hash == previousHash ) {
+            repeatedLines.add( line );
+        }
+        previousHash = hash;
+    }
+
+    repeatedLines.runOptimize();
+    return repeatedLines;
+}
+
+void LogData::getLineHashes( LineNumber first, LinesCount count,
+                             std::vector<uint64_t>& hashes ) const
+{
+    IndexingData::ConstAccessor{ indexing_data_.get() }.getLineHashes( first, count, hashes );
+}
+
+bool LogData::hasRecordIndex() const
+{
+    return IndexingData::ConstAccessor{ indexing_data_.get() }.isRecordIndexEnabled();
+}
+
+roaring::Roaring64Map LogData::expandToRecords( const roaring::Roaring64Map& lines ) const
+{
+    return IndexingData::ConstAccessor{ indexing_data_.get() }.expandToRecords( lines );
+}
+
+LineNumber LogData::findLineAtTime( const TimestampParser& parser, qint64 timestamp,
+                                    LineNumber first, LineNumber last ) const
+{
+    constexpr LinesCount::UnderlyingType LinesToRead = 1000;
+
+    RawLines rawLines;
+    std::vector<std::string_view> lines;
+    for ( auto chunkStart = first; chunkStart < last; ) {
+        const auto linesInChunk = LinesCount( qMin( LinesToRead, ( last - chunkStart ).get() ) );
+        getLinesRaw( chunkStart, linesInChunk, rawLines, LineLimit::Search );
+        rawLines.buildUtf8View( lines );
+        if ( lines.empty() ) {
+            break;
+        }
+
+        for ( auto offset = 0u; offset < lines.size(); ++offset ) {
+            const auto lineTimestamp = parser.parse( lines[ offset ] );
+            if ( lineTimestamp && *lineTimestamp >= timestamp ) {
+                return chunkStart + LinesCount( offset );
+            }
+        }
+        chunkStart = chunkStart + linesInChunk;
+    }
+
+    return last;
 }
 
 QDateTime LogData::getLastModifiedDate() const
@@ -139,6 +558,16 @@ QDateTime LogData::getLastModifiedDate() const
     return lastModifiedDate_;
 }
 
+OperationStats LogData::getIndexingStats() const
+{
+    return indexingStats_;
+}
+
+IngestRate LogData::getIngestRate() const
+{
+    return ingestRate_;
+}
+
 // Return an initialised LogFilteredData. The search is not started.
 std::unique_ptr<LogFilteredData> LogData::getNewFilteredData() const
 {
@@ -147,7 +576,10 @@ std::unique_ptr<LogFilteredData> LogData::getNewFilteredData() const
 
 void LogData::reload( QTextCodec* forcedEncoding )
 {
+    // Old index is shown until the new one replaces it,
+    // cached lines are dropped when indexing finishes
     operationQueue_.interrupt();
+    expandedMaxLength_.store( 0, std::memory_order_relaxed );
 
     // Re-open the file, useful in case the file has been moved
     attached_file_->reOpenFile();
@@ -155,6 +587,27 @@ void LogData::reload( QTextCodec* forcedEncoding )
     operationQueue_.enqueueOperation<FullReindexOperation>( forcedEncoding );
 }
 
+namespace {
+// Returns the file with the id in the same directory, which log rotation
+// names after the original file, empty if the file is not found
+QString findRotatedFile( const QString& fileName, const FileId& fileId )
+{
+    const QFileInfo fileInfo( fileName );
+    const auto candidates
+        = fileInfo.dir().entryInfoList( { fileInfo.baseName() + "*" }, QDir::Files );
+
+    for ( const auto& candidate : candidates ) {
+        const auto candidateName = candidate.absoluteFilePath();
+        if ( candidateName != fileInfo.absoluteFilePath()
+             && !( FileId::getFileId( candidateName ) != fileId ) ) {
+            return candidateName;
+        }
+    }
+
+    return {};
+}
+} // namespace
+
 void LogData::fileChangedOnDisk( const QString& filename )
 {
     LOG_INFO << "signalFileChanged " << filename << ", indexed file " << indexingFileName_;
@@ -193,22 +646,79 @@ void LogData::fileChangedOnDisk( const QString& filename )
 
         LOG_INFO << "Inconsistent size, or file index, the file might have changed, re-opening";
 
+        if ( isFileIdChanged && attachedFileId != FileId{} ) {
+            rotatedFileName_ = findRotatedFile( indexingFileName_, attachedFileId );
+            if ( !rotatedFileName_.isEmpty() ) {
+                LOG_INFO << "File was rotated to " << rotatedFileName_;
+            }
+        }
+
         attached_file_->reOpenFile();
     }
 
+    // Fast growing file is checked again after its refresh interval
+    const auto now = QDateTime::currentMSecsSinceEpoch();
+    const auto waitMs = lastRefreshMs_ + ingestRate_.refreshIntervalMs( now ) - now;
+    if ( !isFileIdChanged && waitMs > 0 ) {
+        if ( !refreshTimer_.isActive() ) {
+            LOG_DEBUG << "postponing check of changes for " << waitMs << " ms";
+            refreshTimer_.start( static_cast<int>( waitMs ), this );
+        }
+        return;
+    }
+
+    refreshTimer_.stop();
     operationQueue_.enqueueOperation<CheckDataChangesOperation>();
 }
 
-void LogData::indexingFinished( LoadingStatus status )
+void LogData::timerEvent( QTimerEvent* event )
+{
+    if ( event->timerId() == refreshTimer_.timerId() ) {
+        refreshTimer_.stop();
+        operationQueue_.enqueueOperation<CheckDataChangesOperation>();
+    }
+    else {
+        AbstractLogData::timerEvent( event );
+    }
+}
+
+void LogData::indexingFinished( LoadingStatus status, const OperationStats& stats )
 {
     attached_file_->detachReader();
+    indexingStats_ = stats;
 
     LOG_INFO << "indexingFinished for: " << indexingFileName_
              << ( status == LoadingStatus::Successful ) << ", found "
              << IndexingData::ConstAccessor{ indexing_data_.get() }.getNbLines() << " lines.";
 
     if ( status == LoadingStatus::Successful ) {
-        FileWatcher::getFileWatcher().addFile( indexingFileName_ );
+        // Fetched blocks are written to the cache of remote file,
+        // it would be seen as changing while it is read
+        if ( !RemoteFile::isRemoteFile( indexingFileName_ ) ) {
+            FileWatcher::getFileWatcher().addFile( indexingFileName_ );
+        }
+
+        // Appended data is measured between partial indexings,
+        // any other indexing starts measuring again
+        const auto now = QDateTime::currentMSecsSinceEpoch();
+        qint64 indexedSize;
+        LinesCount nbLines;
+        {
+            const IndexingData::ConstAccessor scopedAccessor{ indexing_data_.get() };
+            indexedSize = scopedAccessor.getIndexedSize();
+            nbLines = scopedAccessor.getNbLines();
+        }
+        if ( fileChangedOnDisk_ == MonitoredFileStatus::DataAdded && indexedSize >= ingestedSize_
+             && nbLines >= ingestedLines_ ) {
+            ingestRate_.addAppend( now, static_cast<uint64_t>( indexedSize - ingestedSize_ ),
+                                   nbLines.get() - ingestedLines_.get() );
+        }
+        else {
+            ingestRate_.reset( now );
+        }
+        ingestedSize_ = indexedSize;
+        ingestedLines_ = nbLines;
+        lastRefreshMs_ = now;
 
         // Update the modified date/time if the file exists
         lastModifiedDate_ = QDateTime();
@@ -217,12 +727,22 @@ void LogData::indexingFinished( LoadingStatus status )
             lastModifiedDate_ = fileInfo.lastModified();
     }
 
+    // Lines read before data was added to the file are still valid
+    if ( fileChangedOnDisk_ != MonitoredFileStatus::DataAdded ) {
+        lineCache_.clear();
+        ScopedLock lock( loadedLinesMutex_ );
+        loadedLineBytes_.clear();
+    }
+
     fileChangedOnDisk_ = MonitoredFileStatus::Unchanged;
+    isLoaded_ = true;
 
     LOG_DEBUG << "Sending indexingFinished.";
     Q_EMIT loadingFinished( status );
 
     operationQueue_.finishOperationAndStartNext();
+
+    MemoryGovernor::get().enforceBudget();
 }
 
 void LogData::checkFileChangesFinished( MonitoredFileStatus status )
@@ -235,7 +755,9 @@ void LogData::checkFileChangesFinished( MonitoredFileStatus status )
         switch ( status ) {
         case MonitoredFileStatus::Truncated:
             fileChangedOnDisk_ = MonitoredFileStatus::Truncated;
-            operationQueue_.enqueueOperation<FullReindexOperation>();
+            lineCache_.clear();
+            operationQueue_.enqueueOperation<FullReindexOperation>(
+                nullptr, std::exchange( rotatedFileName_, QString{} ), true );
             break;
         case MonitoredFileStatus::DataAdded:
             fileChangedOnDisk_ = MonitoredFileStatus::DataAdded;
@@ -247,11 +769,14 @@ void LogData::checkFileChangesFinished( MonitoredFileStatus status )
         }
     }
     else {
-        operationQueue_.enqueueOperation<FullReindexOperation>();
+        operationQueue_.enqueueOperation<FullReindexOperation>(
+            nullptr, std::exchange( rotatedFileName_, QString{} ), true );
     }
+    rotatedFileName_.clear();
 
     if ( status != MonitoredFileStatus::Unchanged
          || fileChangedOnDisk_ == MonitoredFileStatus::Truncated ) {
+        attached_file_->stopMapping();
         Q_EMIT fileChanged( fileChangedOnDisk_ );
     }
 
@@ -263,33 +788,57 @@ void LogData::checkFileChangesFinished( MonitoredFileStatus status )
 //
 LinesCount LogData::doGetNbLine() const
 {
-    return IndexingData::ConstAccessor{ indexing_data_.get() }.getNbLines();
+    return indexing_data_->getPublishedNbLines();
 }
 
 LineLength LogData::doGetMaxLength() const
 {
-    return IndexingData::ConstAccessor{ indexing_data_.get() }.getMaxLength();
+    return qMax( indexing_data_->getPublishedMaxLength(),
+                 LineLength( expandedMaxLength_.load( std::memory_order_relaxed ) ) );
+}
+
+void LogData::updateExpandedMaxLength( int expandedLength ) const
+{
+    const auto length = static_cast<LineLength::UnderlyingType>( expandedLength );
+    auto maxLength = expandedMaxLength_.load( std::memory_order_relaxed );
+    while ( length > maxLength
+            && !expandedMaxLength_.compare_exchange_weak( maxLength, length,
+                                                          std::memory_order_relaxed ) ) {
+    }
 }
 
 LineLength LogData::doGetLineLength( LineNumber line ) const
 {
-    if ( line >= IndexingData::ConstAccessor{ indexing_data_.get() }.getNbLines() ) {
+    if ( line >= indexing_data_->getPublishedNbLines() ) {
         return 0_length; /* exception? */
     }
 
-    return LineLength(
-        static_cast<LineLength::UnderlyingType>( doGetExpandedLineString( line ).length() ) );
+    // Prefilter changes the displayed text, so its length is not indexed
+    std::optional<LineLength> indexedLength;
+    if ( !prefilter_.isActive() ) {
+        indexedLength = IndexingData::ConstAccessor{ indexing_data_.get() }.getLineLength( line );
+    }
+
+    const auto expandedLength
+        = indexedLength ? indexedLength->get()
+                        : TabExpansionIndex( doGetLineString( line ) ).expandedLength();
+    if ( indexing_data_->hasPublishedTabs() ) {
+        updateExpandedMaxLength( expandedLength );
+    }
+
+    return LineLength( static_cast<LineLength::UnderlyingType>( expandedLength ) );
 }
 
 void LogData::doSetDisplayEncoding( const char* encoding )
 {
     LOG_DEBUG << "AbstractLogData::setDisplayEncoding: " << encoding;
     codec_.setCodec( QTextCodec::codecForName( encoding ) );
+    lineCache_.clear();
     auto needReload = false;
     auto useGuessedCodec = false;
 
     {
-        IndexingData::ConstAccessor scopedAccessor{ indexing_data_.get() };
+        IndexingData::MutateAccessor scopedAccessor{ indexing_data_.get() };
 
         const QTextCodec* currentIndexCodec = scopedAccessor.getForcedEncoding();
         if ( !currentIndexCodec ) {
@@ -297,9 +846,20 @@ void LogData::doSetDisplayEncoding( const char* encoding )
         }
 
         if ( currentIndexCodec && codec_.mibEnum() != currentIndexCodec->mibEnum() ) {
+            const auto* guessedCodec = scopedAccessor.getEncodingGuess();
+            useGuessedCodec = guessedCodec && codec_.mibEnum() == guessedCodec->mibEnum();
+
             if ( codec_.encodingParameters() != EncodingParameters( currentIndexCodec ) ) {
                 needReload = true;
-                useGuessedCodec = codec_.mibEnum() == scopedAccessor.getEncodingGuess()->mibEnum();
+            }
+            else {
+                // Line positions and byte lengths of lines do not depend
+                // on encoding when line feeds are encoded the same way,
+                // so the index is kept and only remembers the new encoding
+                // for the following partial and full reloads
+                LOG_INFO << "Keeping index of " << indexingFileName_ << " for encoding "
+                         << codec_.codec()->name().constData();
+                scopedAccessor.forceEncoding( useGuessedCodec ? nullptr : codec_.codec() );
             }
         }
     }
@@ -338,71 +898,515 @@ std::vector<QString> LogData::doGetLines( LineNumber first_line, LinesCount numb
     } );
 }
 
+// Lines are read past the line cache, like large requests of getLines,
+// and decoded right into the batch
+void LogData::doGetLinesBatch( LineNumber first_line, LinesCount number, LineBatch& batch ) const
+{
+    try {
+        getLinesRaw( first_line, number, LineLimit::Display ).decodeLines( batch );
+    } catch ( const std::bad_alloc& e ) {
+        LOG_ERROR << "not enough memory " << e.what();
+        batch.clear();
+    }
+
+    while ( batch.size() < number.get() ) {
+        batch.append( u"KLOGG WARNING: failed to read some lines before this one" );
+    }
+}
+
+// Colors are parsed from the line as it is in the file, sequences are
+// only found in UTF-8 compatible encodings, like the prefilter does
+std::vector<AnsiColorSpan> LogData::doGetLineColors( LineNumber line ) const
+{
+    if ( !prefilter_.canStripBytes() ) {
+        return {};
+    }
+
+    const auto rawLines = getLinesRaw( line, 1_lcount, LineLimit::Display );
+    if ( !rawLines.textDecoder.encodingParams.isUtf8Compatible ) {
+        return {};
+    }
+
+    auto lineData = rawLines.data();
+    lineData = lineData.substr( 0, lineData.find( '\n' ) );
+    return ansi_colors::parseLine( lineData );
+}
+
+// Long lines are expanded from the tab positions cached
+// for the windowed fetch
 std::vector<QString> LogData::doGetExpandedLines( LineNumber first_line, LinesCount number ) const
 {
-    return getLinesFromFile( first_line, number, []( QString&& lineData ) {
-        return untabify( std::move( lineData ) );
-    } );
+    const auto generation = lineCache_.generation();
+    auto lines = getLinesFromFile( first_line, number,
+                                   []( QString&& lineData ) { return std::move( lineData ); } );
+
+    const auto hasTabs = indexing_data_->hasPublishedTabs();
+    for ( auto index = 0u; index < lines.size(); ++index ) {
+        auto& line = lines[ index ];
+        if ( line.size() < TabExpansionIndex::LongLineLength ) {
+            line = untabify( std::move( line ) );
+            if ( hasTabs ) {
+                updateExpandedMaxLength( line.size() );
+            }
+        }
+        else {
+            const auto expansion
+                = tabExpansionIndex( generation, first_line + LinesCount( index ), line );
+            if ( hasTabs ) {
+                updateExpandedMaxLength( expansion->expandedLength() );
+            }
+            line = expansion->expandedLine();
+        }
+    }
+
+    return lines;
+}
+
+std::vector<QString> LogData::doGetExpandedLinesWindow( LineNumber first_line, LinesCount number,
+                                                        int firstColumn, int nbColumns ) const
+{
+    const auto generation = lineCache_.generation();
+    auto lines = getLinesFromFile( first_line, number,
+                                   []( QString&& lineData ) { return std::move( lineData ); } );
+
+    const auto hasTabs = indexing_data_->hasPublishedTabs();
+    for ( auto index = 0u; index < lines.size(); ++index ) {
+        auto& line = lines[ index ];
+        if ( line.size() < TabExpansionIndex::LongLineLength ) {
+            auto expandedLine = untabify( std::move( line ) );
+            if ( hasTabs ) {
+                updateExpandedMaxLength( expandedLine.size() );
+            }
+            line = expandedLine.mid( firstColumn, nbColumns );
+        }
+        else {
+            const auto expansion
+                = tabExpansionIndex( generation, first_line + LinesCount( index ), line );
+            if ( hasTabs ) {
+                updateExpandedMaxLength( expansion->expandedLength() );
+            }
+            line = expansion->expandedWindow( firstColumn, nbColumns );
+        }
+    }
+
+    return lines;
+}
+
+std::shared_ptr<const TabExpansionIndex>
+LogData::tabExpansionIndex( uint64_t generation, LineNumber line, const QString& lineData ) const
+{
+    ScopedLock lock( tabExpansionMutex_ );
+    auto cachedIndex = tabExpansionIndexes_.find( line.get() );
+    if ( cachedIndex != tabExpansionIndexes_.end()
+         && cachedIndex->second.first == generation ) {
+        return cachedIndex->second.second;
+    }
+
+    if ( tabExpansionIndexes_.size() >= MaxTabExpansionIndexes ) {
+        tabExpansionIndexes_.clear();
+    }
+
+    auto index = std::make_shared<const TabExpansionIndex>( lineData );
+    tabExpansionIndexes_[ line.get() ] = std::make_pair( generation, index );
+    return index;
+}
+
+namespace {
+// Reads [firstByte, lastByte) from the local copies of indexed
+// blocks, fails if any part of the range is not cached
+bool readCachedBlocks( const FileId& fileId, const std::vector<IndexedHash::BlockDigest>& blocks,
+                       qint64 firstByte, qint64 lastByte, char* data )
+{
+    auto& cache = BlockCache::get();
+    auto position = firstByte;
+    for ( const auto& block : blocks ) {
+        if ( block.offset > position ) {
+            return false;
+        }
+
+        const auto end = std::min( lastByte, block.offset + block.size );
+        if ( end <= position ) {
+            continue;
+        }
+
+        if ( !cache.read( { fileId, block.offset, block.digest }, position - block.offset,
+                          data + ( position - firstByte ), end - position ) ) {
+            return false;
+        }
+        position = end;
+    }
+
+    return position == lastByte;
 }
 
-LogData::RawLines LogData::getLinesRaw( LineNumber firstLine, LinesCount number ) const
+// Lines overlapping binary chunks are binary only if their own bytes are,
+// lines of cut ones are checked by their read part
+void keepBinaryLines( LogData::RawLines& rawLines )
+{
+    const auto lineFeedWidth = rawLines.textDecoder.encodingParams.lineFeedWidth;
+    if ( lineFeedWidth > 1 ) {
+        rawLines.binaryLines.clear();
+        return;
+    }
+
+    const auto lineData = rawLines.data();
+    const auto isBinary = [ &rawLines, lineData, lineFeedWidth ]( size_t index ) {
+        const auto lineStart = index > 0 ? rawLines.endOfLines[ index - 1 ] : 0;
+        const auto lineEnd = rawLines.endOfLines[ index ] - lineFeedWidth;
+        if ( lineEnd > static_cast<qint64>( lineData.size() ) ) {
+            return false;
+        }
+        return BinaryRegionIndex::isBinary( lineData.substr(
+            static_cast<size_t>( lineStart ), static_cast<size_t>( lineEnd - lineStart ) ) );
+    };
+
+    rawLines.binaryLines.erase( std::remove_if( rawLines.binaryLines.begin(),
+                                                rawLines.binaryLines.end(),
+                                                [ &isBinary ]( size_t index ) {
+                                                    return !isBinary( index );
+                                                } ),
+                                rawLines.binaryLines.end() );
+}
+} // namespace
+
+LogData::RawLines LogData::getLinesRaw( LineNumber firstLine, LinesCount number,
+                                       LineLimit limit ) const
 {
     RawLines rawLines;
+    getLinesRaw( firstLine, number, rawLines, limit );
+    return rawLines;
+}
+
+qint64 LogData::maxLineBytes( LineLimit limit, LineNumber line ) const
+{
+    switch ( limit ) {
+    case LineLimit::None:
+        return std::numeric_limits<qint64>::max();
+    case LineLimit::Search:
+        return GiantLineBytes;
+    case LineLimit::Display: {
+        ScopedLock lock( loadedLinesMutex_ );
+        const auto loaded = loadedLineBytes_.find( line.get() );
+        return loaded != loadedLineBytes_.end() ? loaded->second : DisplayedLineBytes;
+    }
+    }
+    return std::numeric_limits<qint64>::max();
+}
+
+void LogData::getLinesRaw( LineNumber firstLine, LinesCount number, RawLines& rawLines,
+                           LineLimit limit ) const
+{
+    KLOGG_ZONE( "LogData::getLinesRaw" );
     rawLines.startLine = firstLine;
+    rawLines.endOfLines.clear();
+    rawLines.buffer.clear();
+    rawLines.cutLines.clear();
+    rawLines.binaryLines.clear();
+    rawLines.mappingGuard.reset();
+    rawLines.mappedData = {};
 
     try {
-        rawLines.endOfLines.reserve( number.get() );
-        std::vector<LineNumber> lineNumbers{ static_cast<size_t>( number.get() ) };
-        std::iota( lineNumbers.begin(), lineNumbers.end(), firstLine );
+        qint64 firstByte = 0;
+        qint64 lastByte = 0;
+        uint64_t indexGeneration = 0;
+        std::vector<IndexedHash::BlockDigest> cachedBlocks;
+
+        decodeSparseIndexBlocks( firstLine, number );
+
+        {
+            // Lock is released before reading the file,
+            // so indexer is not blocked on IO
+            IndexingData::ConstAccessor scopedAccessor{ indexing_data_.get() };
+            rawLines.prefilter = prefilter_;
+            indexGeneration = indexing_data_->getGeneration();
+
+            if ( number.get() == 0
+                 || firstLine.get() + number.get() > scopedAccessor.getNbLines().get() ) {
+                LOG_WARNING << "Lines out of bound asked for";
+                return; /* exception? */
+            }
 
-        IndexingData::ConstAccessor scopedAccessor{ indexing_data_.get() };
-        rawLines.prefilterPattern
-            = !prefilterPattern_.isEmpty() ? QRegularExpression(
-                  prefilterPattern_, QRegularExpression::CaseInsensitiveOption )
-                                           : QRegularExpression{};
+            firstByte = ( firstLine == 0_lnum )
+                            ? 0
+                            : scopedAccessor.getEndOfLineOffset( firstLine - 1_lcount ).get();
+
+            scopedAccessor.getEndOfLineOffsets( firstLine, number, rawLines.endOfLines );
+            lastByte = rawLines.endOfLines.back();
+
+            // Lines overlapping binary chunks are checked once they are read
+            if ( limit != LineLimit::None
+                 && scopedAccessor.hasBinaryChunks( firstByte, lastByte ) ) {
+                auto lineStart = firstByte;
+                for ( auto index = 0u; index < rawLines.endOfLines.size(); ++index ) {
+                    const auto lineEnd = rawLines.endOfLines[ index ];
+                    if ( scopedAccessor.hasBinaryChunks( lineStart, lineEnd ) ) {
+                        rawLines.binaryLines.push_back( index );
+                    }
+                    lineStart = lineEnd;
+                }
+            }
 
-        if ( lineNumbers.back() >= scopedAccessor.getNbLines() ) {
-            LOG_WARNING << "Lines out of bound asked for";
-            return {}; /* exception? */
+            if ( BlockCache::get().isEnabled() ) {
+                cachedBlocks = scopedAccessor.getBlockDigests( firstByte, lastByte );
+            }
         }
 
         ScopedFileHolder<FileHolder> fileHolder( attached_file_.get() );
 
-        const auto firstByte
-            = ( firstLine == 0_lnum )
-                  ? 0
-                  : scopedAccessor.getEndOfLineOffset( firstLine - 1_lcount ).get();
-        const auto lastByte = scopedAccessor.getEndOfLineOffset( lineNumbers.back() ).get();
-
-        std::transform( lineNumbers.begin(), lineNumbers.end(),
-                        std::back_inserter( rawLines.endOfLines ),
-                        [ &scopedAccessor, firstByte ]( const LineNumber& line ) {
-                            return scopedAccessor.getEndOfLineOffset( line ).get() - firstByte;
-                        } );
+        for ( auto& endOfLine : rawLines.endOfLines ) {
+            endOfLine -= firstByte;
+        }
 
         const auto bytesToRead = lastByte - firstByte;
-        LOG_DEBUG << "will try to read:" << bytesToRead << " bytes";
+
+        rawLines.textDecoder = codec_.makeDecoder();
+
+        // Limits are only looked up for lines longer than the smallest one
+        const auto lineFeedWidth = rawLines.textDecoder.encodingParams.lineFeedWidth;
+        const auto minLimit = limit == LineLimit::Search ? GiantLineBytes : DisplayedLineBytes;
+        if ( limit != LineLimit::None && bytesToRead > minLimit ) {
+            qint64 lineStart = 0;
+            for ( auto index = 0u; index < rawLines.endOfLines.size(); ++index ) {
+                const auto lineBytes = rawLines.endOfLines[ index ] - lineStart - lineFeedWidth;
+                lineStart = rawLines.endOfLines[ index ];
+                if ( lineBytes <= minLimit ) {
+                    continue;
+                }
+
+                const auto lineLimit = maxLineBytes( limit, firstLine + LinesCount( index ) );
+                if ( lineBytes > lineLimit ) {
+                    rawLines.cutLines.push_back(
+                        { index, lineBytes, lineLimit - lineLimit % lineFeedWidth } );
+                }
+            }
+        }
+
+        if ( !rawLines.cutLines.empty() ) {
+            readCutLines( firstByte, lastByte, fileHolder, rawLines );
+        }
+        else {
+            readLines( firstByte, lastByte, cachedBlocks, fileHolder, rawLines );
+        }
+
+        if ( indexing_data_->getGeneration() != indexGeneration ) {
+            LOG_INFO << "Index changed while lines were read, dropping them";
+            rawLines.endOfLines.clear();
+            rawLines.buffer.clear();
+            rawLines.cutLines.clear();
+            rawLines.binaryLines.clear();
+            rawLines.mappingGuard.reset();
+            rawLines.mappedData = {};
+            return;
+        }
+
+        if ( !rawLines.binaryLines.empty() ) {
+            keepBinaryLines( rawLines );
+        }
+
+    } catch ( const std::bad_alloc& ) {
+        LOG_ERROR << "not enough memory";
+        rawLines.endOfLines.clear();
+        rawLines.buffer.clear();
+        rawLines.mappingGuard.reset();
+        rawLines.mappedData = {};
+    }
+}
+
+void LogData::decodeSparseIndexBlocks( LineNumber firstLine, LinesCount number ) const
+{
+    // End of the line before the first one is needed too
+    const auto first = firstLine == 0_lnum ? firstLine : firstLine - 1_lcount;
+    const auto count = number + ( firstLine - first );
+
+    auto missing
+        = IndexingData::ConstAccessor{ indexing_data_.get() }.missingSparseBlocks( first, count );
+    if ( missing.blocks.empty() ) {
+        return;
+    }
+
+    missing.decode();
+    IndexingData::ConstAccessor{ indexing_data_.get() }.addSparseBlocks( missing );
+}
+
+void LogData::readLines( qint64 firstByte, qint64 lastByte,
+                         const std::vector<IndexedHash::BlockDigest>& cachedBlocks,
+                         ScopedFileHolder<FileHolder>& fileHolder, RawLines& rawLines ) const
+{
+    const auto bytesToRead = lastByte - firstByte;
+
+    if ( !cachedBlocks.empty() ) {
         rawLines.buffer.resize( static_cast<std::size_t>( bytesToRead ) );
+        if ( readCachedBlocks( attached_file_->getFileId(), cachedBlocks, firstByte, lastByte,
+                               rawLines.buffer.data() ) ) {
+            LOG_DEBUG << "read lines from block cache:" << rawLines.buffer.size();
+            return;
+        }
+        rawLines.buffer.clear();
+    }
+
+    if ( auto mapping = fileHolder.getMapping( lastByte ) ) {
+        rawLines.mappedData = mapping->view( firstByte, bytesToRead );
+        rawLines.mappingGuard = std::move( mapping );
+        LOG_DEBUG << "using mapped lines:" << rawLines.mappedData.size();
+        return;
+    }
+
+    LOG_DEBUG << "will try to read:" << bytesToRead << " bytes";
+    rawLines.buffer.resize( static_cast<std::size_t>( bytesToRead ) );
+
+    const auto bytesRead = fileHolder.read( firstByte, rawLines.buffer.data(), bytesToRead );
+
+    if ( bytesRead != bytesToRead ) {
+        LOG_DEBUG << "failed to read " << bytesToRead << " bytes, got " << bytesRead;
+    }
+
+    LOG_DEBUG << "done reading lines:" << rawLines.buffer.size();
+}
+
+// Cut lines are copied without their ends, followed by their line feeds,
+// so lines in buffer look like shorter lines of the file
+void LogData::readCutLines( qint64 firstByte, qint64 lastByte,
+                            ScopedFileHolder<FileHolder>& fileHolder, RawLines& rawLines ) const
+{
+    const auto lineFeedWidth = rawLines.textDecoder.encodingParams.lineFeedWidth;
+
+    const auto mapping = fileHolder.getMapping( lastByte );
+    const auto mappedData
+        = mapping ? mapping->view( firstByte, lastByte - firstByte ) : std::string_view{};
+
+    qint64 skippedBytes = 0;
+    for ( const auto& cutLine : rawLines.cutLines ) {
+        skippedBytes += cutLine.lineBytes - cutLine.readBytes;
+    }
+    rawLines.buffer.reserve( static_cast<size_t>( lastByte - firstByte - skippedBytes ) );
+
+    // Bytes [start, start + size) from the first read line
+    const auto copyBytes = [ & ]( qint64 start, qint64 size ) {
+        if ( size <= 0 ) {
+            return;
+        }
+        const auto offset = rawLines.buffer.size();
+        rawLines.buffer.resize( offset + static_cast<size_t>( size ) );
+        auto* destination = rawLines.buffer.data() + offset;
+        if ( mapping ) {
+            std::memcpy( destination, mappedData.data() + start, static_cast<size_t>( size ) );
+        }
+        else if ( fileHolder.read( firstByte + start, destination, size ) != size ) {
+            LOG_DEBUG << "failed to read " << size << " bytes at " << firstByte + start;
+        }
+    };
+
+    qint64 copiedUntil = 0;
+    qint64 removedBytes = 0;
+    auto cutLine = rawLines.cutLines.cbegin();
+    for ( auto index = 0u; index < rawLines.endOfLines.size(); ++index ) {
+        auto& endOfLine = rawLines.endOfLines[ index ];
+        if ( cutLine != rawLines.cutLines.cend() && cutLine->index == index ) {
+            const auto lineStart = endOfLine - lineFeedWidth - cutLine->lineBytes;
+            copyBytes( copiedUntil, lineStart + cutLine->readBytes - copiedUntil );
+            copiedUntil = endOfLine - lineFeedWidth;
+            removedBytes += cutLine->lineBytes - cutLine->readBytes;
+            ++cutLine;
+        }
+        endOfLine -= removedBytes;
+    }
+    copyBytes( copiedUntil, lastByte - firstByte - copiedUntil );
+
+    LOG_DEBUG << "read lines with " << rawLines.cutLines.size()
+              << " cut lines:" << rawLines.buffer.size();
+}
 
-        fileHolder.getFile()->seek( firstByte );
-        const auto bytesRead = fileHolder.getFile()->read( rawLines.buffer.data(), bytesToRead );
+void LogData::getLinePart( LineNumber line, qint64 offset, qint64 size,
+                           RawLines& rawLines ) const
+{
+    rawLines.startLine = line;
+    rawLines.endOfLines.clear();
+    rawLines.buffer.clear();
+    rawLines.cutLines.clear();
+    rawLines.binaryLines.clear();
+    rawLines.mappingGuard.reset();
+    rawLines.mappedData = {};
 
-        if ( bytesRead != bytesToRead ) {
-            LOG_DEBUG << "failed to read " << bytesToRead << " bytes, got " << bytesRead;
+    try {
+        qint64 lineStart = 0;
+        qint64 lineEnd = 0;
+        uint64_t indexGeneration = 0;
+        {
+            IndexingData::ConstAccessor scopedAccessor{ indexing_data_.get() };
+            rawLines.prefilter = prefilter_;
+            indexGeneration = indexing_data_->getGeneration();
+            if ( line.get() >= scopedAccessor.getNbLines().get() ) {
+                return;
+            }
+            lineStart = line == 0_lnum
+                            ? 0
+                            : scopedAccessor.getEndOfLineOffset( line - 1_lcount ).get();
+            lineEnd = scopedAccessor.getEndOfLineOffset( line ).get();
         }
 
-        LOG_DEBUG << "done reading lines:" << rawLines.buffer.size();
         rawLines.textDecoder = codec_.makeDecoder();
-        return rawLines;
+        const auto lineFeedWidth = rawLines.textDecoder.encodingParams.lineFeedWidth;
+
+        offset -= offset % lineFeedWidth;
+        const auto partStart = lineStart + offset;
+        const auto lineFeedStart = lineEnd - lineFeedWidth;
+        if ( partStart >= lineFeedStart ) {
+            return;
+        }
+        const auto partBytes = std::min( size - size % lineFeedWidth, lineFeedStart - partStart );
+
+        ScopedFileHolder<FileHolder> fileHolder( attached_file_.get() );
+        rawLines.buffer.resize( static_cast<size_t>( partBytes + lineFeedWidth ) );
+        const auto bytesRead = fileHolder.read( partStart, rawLines.buffer.data(), partBytes )
+                               + fileHolder.read( lineFeedStart, rawLines.buffer.data() + partBytes,
+                                                  lineFeedWidth );
+        if ( bytesRead != partBytes + lineFeedWidth
+             || indexing_data_->getGeneration() != indexGeneration ) {
+            LOG_DEBUG << "failed to read part of line " << line;
+            rawLines.buffer.clear();
+            return;
+        }
+        rawLines.endOfLines.push_back( partBytes + lineFeedWidth );
 
     } catch ( const std::bad_alloc& ) {
         LOG_ERROR << "not enough memory";
         rawLines.endOfLines.clear();
         rawLines.buffer.clear();
-        return rawLines;
     }
 }
 
+bool LogData::doLoadMoreOfLine( LineNumber line ) const
+{
+    qint64 lineBytes = 0;
+    {
+        IndexingData::ConstAccessor scopedAccessor{ indexing_data_.get() };
+        if ( line.get() >= scopedAccessor.getNbLines().get() ) {
+            return false;
+        }
+        const auto lineStart = line == 0_lnum
+                                   ? 0
+                                   : scopedAccessor.getEndOfLineOffset( line - 1_lcount ).get();
+        lineBytes = scopedAccessor.getEndOfLineOffset( line ).get() - lineStart;
+    }
+
+    {
+        ScopedLock lock( loadedLinesMutex_ );
+        auto loaded = loadedLineBytes_.emplace( line.get(), DisplayedLineBytes ).first;
+        if ( lineBytes <= loaded->second ) {
+            return false;
+        }
+        loaded->second = std::min( lineBytes, loaded->second * 2 );
+        LOG_INFO << "Loaded " << loaded->second << " bytes of line " << line;
+    }
+
+    lineCache_.clear();
+    return true;
+}
+
+namespace {
+constexpr LinesCount::UnderlyingType MaxCachedRequestLines = 4 * LineCache::PageLines;
+} // namespace
+
 std::vector<QString> LogData::getLinesFromFile( LineNumber firstLine, LinesCount number,
                                                 QString ( *processLine )( QString&& ) ) const
 {
@@ -414,13 +1418,43 @@ std::vector<QString> LogData::getLinesFromFile( LineNumber firstLine, LinesCount
 
     std::vector<QString> processedLines;
     try {
-        const auto rawLines = getLinesRaw( firstLine, number );
-        auto decodedLines = rawLines.decodeLines();
+        // Large requests (e.g. copy of selection) are read directly,
+        // so they do not evict the lines visible in views
+        if ( number.get() > MaxCachedRequestLines ) {
+            const auto rawLines = getLinesRaw( firstLine, number, LineLimit::Display );
+            auto decodedLines = rawLines.decodeLines();
 
-        processedLines.reserve( decodedLines.size() );
+            processedLines.reserve( decodedLines.size() );
 
-        for ( auto&& line : decodedLines ) {
-            processedLines.push_back( processLine( std::move( line ) ) );
+            for ( auto&& line : decodedLines ) {
+                processedLines.push_back( processLine( std::move( line ) ) );
+            }
+        }
+        else {
+            processedLines.reserve( number.get() );
+
+            const auto endLine = firstLine.get() + number.get();
+            auto line = firstLine.get();
+            while ( line < endLine ) {
+                const auto pageIndex = LineCache::pageIndex( LineNumber( line ) );
+                const auto pageStart = LineCache::pageStart( pageIndex ).get();
+                const auto pageEnd = std::min( endLine, pageStart + LineCache::PageLines );
+
+                auto page = lineCache_.find( pageIndex );
+                if ( !page || page->size() < pageEnd - pageStart ) {
+                    // Last page can grow while the file is followed
+                    page = readPage( pageIndex );
+                }
+
+                if ( !page || page->size() < pageEnd - pageStart ) {
+                    break;
+                }
+
+                for ( ; line < pageEnd; ++line ) {
+                    auto lineData = ( *page )[ line - pageStart ];
+                    processedLines.push_back( processLine( std::move( lineData ) ) );
+                }
+            }
         }
 
     } catch ( const std::bad_alloc& e ) {
@@ -435,6 +1469,99 @@ std::vector<QString> LogData::getLinesFromFile( LineNumber firstLine, LinesCount
     return processedLines;
 }
 
+LineCache::Page LogData::readPage( uint64_t page ) const
+{
+    const auto generation = lineCache_.generation();
+
+    const auto pageStart = LineCache::pageStart( page );
+    const auto nbLines = indexing_data_->getPublishedNbLines();
+    if ( pageStart.get() >= nbLines.get() ) {
+        return {};
+    }
+
+    const auto pageLines
+        = LinesCount( std::min( LineCache::PageLines, nbLines.get() - pageStart.get() ) );
+
+    auto lines = std::make_shared<std::vector<QString>>(
+        getLinesRaw( pageStart, pageLines, LineLimit::Display ).decodeLines() );
+
+    if ( lines->size() == pageLines.get() ) {
+        lineCache_.insert( generation, page, lines );
+    }
+
+    return lines;
+}
+
+void LogData::doPrefetchLines( LineNumber first, LinesCount number ) const
+{
+    const auto nbLines = indexing_data_->getPublishedNbLines();
+    if ( number.get() == 0 || first.get() >= nbLines.get() ) {
+        return;
+    }
+
+    const auto endLine = std::min( first.get() + number.get(), nbLines.get() );
+
+    std::vector<LineNumber> lines;
+    for ( auto line = first.get(); line < endLine; line += LineCache::PageLines ) {
+        lines.emplace_back( line );
+    }
+    lines.emplace_back( endLine - 1 );
+
+    prefetchLinesAt( std::move( lines ) );
+}
+
+void LogData::prefetchLinesAt( std::vector<LineNumber> lines ) const
+{
+    std::vector<uint64_t> pages;
+    pages.reserve( lines.size() );
+    std::transform( lines.begin(), lines.end(), std::back_inserter( pages ),
+                    []( const auto& line ) { return LineCache::pageIndex( line ); } );
+
+    std::sort( pages.begin(), pages.end() );
+    pages.erase( std::unique( pages.begin(), pages.end() ), pages.end() );
+    pages.erase( std::remove_if( pages.begin(), pages.end(),
+                                 [ this ]( auto page ) { return lineCache_.contains( page ); } ),
+                 pages.end() );
+
+    if ( pages.empty() ) {
+        return;
+    }
+
+    // Pages around previous position of the views are not needed anymore
+    prefetchPool_.clear();
+    prefetchPool_.start( createRunnable( [ this, pages = std::move( pages ) ] {
+        for ( const auto page : pages ) {
+            if ( !lineCache_.contains( page ) ) {
+                readPage( page );
+            }
+        }
+    } ) );
+}
+
+bool LogData::doAreLinesCached( LineNumber first, LinesCount number ) const
+{
+    const auto nbLines = indexing_data_->getPublishedNbLines();
+    const auto endLine = std::min( first.get() + number.get(), nbLines.get() );
+    if ( first.get() >= endLine ) {
+        return true;
+    }
+
+    for ( auto page = LineCache::pageIndex( first );
+          page <= LineCache::pageIndex( LineNumber( endLine - 1 ) ); ++page ) {
+        if ( !lineCache_.contains( page ) ) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool LogData::areLinesCachedAt( const std::vector<LineNumber>& lines ) const
+{
+    return std::all_of( lines.begin(), lines.end(), [ this ]( const auto& line ) {
+        return lineCache_.contains( LineCache::pageIndex( line ) );
+    } );
+}
+
 QTextCodec* LogData::getDetectedEncoding() const
 {
     return IndexingData::ConstAccessor{ indexing_data_.get() }.getEncodingGuess();
@@ -450,8 +1577,100 @@ void LogData::doDetachReader() const
     attached_file_->detachReader();
 }
 
+namespace {
+// Decodes UTF-8 and Latin-1 lines without QTextDecoder,
+// returns false if line has to be decoded by codec
+bool decodeLineInBulk( const EncodingParameters& encodingParams, const char* lineData,
+                       size_t length, QString& line )
+{
+    if ( encodingParams.isLatin1 ) {
+        line = QString::fromLatin1( lineData, static_cast<int>( length ) );
+        return true;
+    }
+
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+    if ( encodingParams.isUtf8 ) {
+        if ( length == 0 ) {
+            line.clear();
+            return true;
+        }
+
+        // Byte order mark is removed by codec
+        static constexpr std::string_view Utf8Bom = "\xEF\xBB\xBF";
+        if ( std::string_view( lineData, std::min( length, Utf8Bom.size() ) ) == Utf8Bom ) {
+            return false;
+        }
+
+        // Text takes at most as many UTF-16 code units as UTF-8 bytes,
+        // invalid text is decoded by codec to get replacement characters
+        line.resize( static_cast<int>( length ) );
+        const auto utf16Length = simdutf::convert_utf8_to_utf16(
+            lineData, length, reinterpret_cast<char16_t*>( line.data() ) );
+        if ( utf16Length == 0 ) {
+            return false;
+        }
+
+        line.resize( static_cast<int>( utf16Length ) );
+        return true;
+    }
+#endif
+
+    return false;
+}
+
+// Decodes line to output that has room for length code units,
+// returns empty if line has to be decoded by codec
+std::optional<size_t> decodeLineInBulk( const EncodingParameters& encodingParams,
+                                        const char* lineData, size_t length, char16_t* output )
+{
+    if ( encodingParams.isLatin1 ) {
+        std::transform( lineData, lineData + length, output, []( char c ) {
+            return static_cast<char16_t>( static_cast<uint8_t>( c ) );
+        } );
+        return length;
+    }
+
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+    if ( encodingParams.isUtf8 ) {
+        if ( length == 0 ) {
+            return 0;
+        }
+
+        static constexpr std::string_view Utf8Bom = "\xEF\xBB\xBF";
+        if ( std::string_view( lineData, std::min( length, Utf8Bom.size() ) ) == Utf8Bom ) {
+            return {};
+        }
+
+        const auto utf16Length = simdutf::convert_utf8_to_utf16( lineData, length, output );
+        if ( utf16Length == 0 ) {
+            return {};
+        }
+        return utf16Length;
+    }
+#endif
+
+    return {};
+}
+} // namespace
+
+namespace {
+// Shown at the end of a line that is not read whole
+QString cutLineMarker( const LogData::RawLines::CutLine& cutLine )
+{
+    return QString( " [KLOGG: %1 more bytes of this line are not loaded]" )
+        .arg( cutLine.lineBytes - cutLine.readBytes );
+}
+
+// Shown instead of a line with binary data
+QString binaryLinePlaceholder( qint64 lineBytes )
+{
+    return QString( "[KLOGG: %1 bytes of binary data]" ).arg( lineBytes );
+}
+} // namespace
+
 std::vector<QString> LogData::RawLines::decodeLines() const
 {
+    KLOGG_ZONE( "RawLines::decodeLines" );
     if ( this->endOfLines.empty() ) {
         return std::vector<QString>();
     }
@@ -459,36 +1678,81 @@ std::vector<QString> LogData::RawLines::decodeLines() const
     std::vector<QString> decodedLines;
     decodedLines.reserve( this->endOfLines.size() );
 
+    const auto lineData = data();
+
+    const auto stripBytes
+        = prefilter.canStripBytes() && textDecoder.encodingParams.isUtf8Compatible;
+    std::string strippedLine;
+
     try {
         qint64 lineStart = 0;
         size_t currentLineIndex = 0;
+        auto cutLine = cutLines.cbegin();
+        auto binaryLine = binaryLines.cbegin();
         const auto lineFeedWidth = textDecoder.encodingParams.lineFeedWidth;
         for ( const auto& lineEnd : this->endOfLines ) {
             const auto length = lineEnd - lineStart - lineFeedWidth;
             LOG_DEBUG << "line " << this->startLine.get() + currentLineIndex << ", length "
                       << length;
 
+            if ( binaryLine != binaryLines.cend() && *binaryLine == currentLineIndex ) {
+                const auto isCut
+                    = cutLine != cutLines.cend() && cutLine->index == currentLineIndex;
+                decodedLines.push_back(
+                    binaryLinePlaceholder( isCut ? cutLine->lineBytes : length ) );
+                if ( isCut ) {
+                    ++cutLine;
+                }
+                ++binaryLine;
+                lineStart = lineEnd;
+                ++currentLineIndex;
+                continue;
+            }
+
             if ( length >= std::numeric_limits<LineLength::UnderlyingType>::max() / 2 ) {
                 decodedLines.emplace_back( "KLOGG WARNING: this line is too long" );
                 break;
             }
 
-            if ( lineStart + length > static_cast<qint64>( buffer.size() ) ) {
+            if ( lineStart + length > static_cast<qint64>( lineData.size() ) ) {
                 decodedLines.emplace_back( "KLOGG WARNING: file read failed" );
                 LOG_WARNING << "not enough data in buffer";
                 break;
             }
 
-            auto decodedLine = textDecoder.decoder->toUnicode( buffer.data() + lineStart,
-                                                               static_cast<int>( length ) );
+            const auto* lineBegin = lineData.data() + lineStart;
+            auto lineLength = static_cast<size_t>( length );
+
+            // Only lines with escape characters are copied to remove sequences
+            if ( stripBytes && std::memchr( lineBegin, '\x1B', lineLength ) != nullptr ) {
+                strippedLine.resize( lineLength );
+                lineLength = prefilter.stripBytes( lineBegin, lineLength, strippedLine.data() );
+                lineBegin = strippedLine.data();
+            }
 
-            if ( !prefilterPattern.pattern().isEmpty() ) {
-                decodedLine.remove( prefilterPattern );
+            QString decodedLine;
+            if ( !decodeLineInBulk( textDecoder.encodingParams, lineBegin, lineLength,
+                                    decodedLine ) ) {
+                decodedLine
+                    = textDecoder.decoder->toUnicode( lineBegin, static_cast<int>( lineLength ) );
+            }
+
+            if ( !stripBytes ) {
+                prefilter.strip( decodedLine );
+            }
+
+            if ( cutLine != cutLines.cend() && cutLine->index == currentLineIndex ) {
+                if ( decodedLine.endsWith( QChar::CarriageReturn ) ) {
+                    decodedLine.chop( 1 );
+                }
+                decodedLine.append( cutLineMarker( *cutLine ) );
+                ++cutLine;
             }
 
             decodedLines.push_back( std::move( decodedLine ) );
 
             lineStart = lineEnd;
+            ++currentLineIndex;
         }
     } catch ( const std::bad_alloc& ) {
         LOG_ERROR << "not enough memory";
@@ -502,11 +1766,145 @@ std::vector<QString> LogData::RawLines::decodeLines() const
     return decodedLines;
 }
 
+void LogData::RawLines::decodeLines( LineBatch& batch ) const
+{
+    KLOGG_ZONE( "RawLines::decodeLines" );
+    batch.clear();
+    if ( this->endOfLines.empty() ) {
+        return;
+    }
+
+    const auto lineData = data();
+
+    // Text takes at most as many UTF-16 code units as bytes of
+    // single byte and UTF-8 encodings, so buffer is allocated once
+    batch.reserve( lineData.size(), this->endOfLines.size() );
+
+    const auto stripBytes
+        = prefilter.canStripBytes() && textDecoder.encodingParams.isUtf8Compatible;
+    const auto canDecodeInBulk = stripBytes || !prefilter.isActive();
+    std::string strippedLine;
+
+    const auto appendLine = [ &batch ]( QStringView line ) {
+        if ( line.endsWith( QChar::CarriageReturn ) ) {
+            line.chop( 1 );
+        }
+        batch.append( line );
+    };
+
+    try {
+        qint64 lineStart = 0;
+        size_t lineIndex = 0;
+        auto cutLine = cutLines.cbegin();
+        auto binaryLine = binaryLines.cbegin();
+        const auto lineFeedWidth = textDecoder.encodingParams.lineFeedWidth;
+        for ( const auto& lineEnd : this->endOfLines ) {
+            const auto length = lineEnd - lineStart - lineFeedWidth;
+            const auto isCut = cutLine != cutLines.cend() && cutLine->index == lineIndex;
+            const auto isBinary = binaryLine != binaryLines.cend() && *binaryLine == lineIndex;
+            ++lineIndex;
+
+            if ( isBinary ) {
+                appendLine( binaryLinePlaceholder( isCut ? cutLine->lineBytes : length ) );
+                if ( isCut ) {
+                    ++cutLine;
+                }
+                ++binaryLine;
+                lineStart = lineEnd;
+                continue;
+            }
+
+            if ( length >= std::numeric_limits<LineLength::UnderlyingType>::max() / 2 ) {
+                appendLine( u"KLOGG WARNING: this line is too long" );
+                break;
+            }
+
+            if ( lineStart + length > static_cast<qint64>( lineData.size() ) ) {
+                appendLine( u"KLOGG WARNING: file read failed" );
+                LOG_WARNING << "not enough data in buffer";
+                break;
+            }
+
+            const auto* lineBegin = lineData.data() + lineStart;
+            auto lineLength = static_cast<size_t>( length );
+            lineStart = lineEnd;
+
+            if ( stripBytes && std::memchr( lineBegin, '\x1B', lineLength ) != nullptr ) {
+                strippedLine.resize( lineLength );
+                lineLength = prefilter.stripBytes( lineBegin, lineLength, strippedLine.data() );
+                lineBegin = strippedLine.data();
+            }
+
+            if ( canDecodeInBulk && !isCut ) {
+                auto* output = batch.beginLine( lineLength );
+                if ( const auto decodedLength = decodeLineInBulk( textDecoder.encodingParams,
+                                                                  lineBegin, lineLength, output ) ) {
+                    const auto hasCarriageReturn
+                        = *decodedLength > 0 && output[ *decodedLength - 1 ] == u'\r';
+                    batch.finishLine( *decodedLength - ( hasCarriageReturn ? 1 : 0 ) );
+                    continue;
+                }
+            }
+
+            auto decodedLine
+                = textDecoder.decoder->toUnicode( lineBegin, static_cast<int>( lineLength ) );
+            if ( !stripBytes ) {
+                prefilter.strip( decodedLine );
+            }
+            if ( isCut ) {
+                if ( decodedLine.endsWith( QChar::CarriageReturn ) ) {
+                    decodedLine.chop( 1 );
+                }
+                decodedLine.append( cutLineMarker( *cutLine ) );
+                ++cutLine;
+            }
+            appendLine( decodedLine );
+        }
+    } catch ( const std::bad_alloc& ) {
+        LOG_ERROR << "not enough memory";
+        appendLine( u"KLOGG WARNING: not enough memory" );
+    }
+
+    while ( batch.size() < this->endOfLines.size() ) {
+        appendLine( u"KLOGG WARNING: failed to decode some lines before this one" );
+    }
+}
+
+namespace {
+// Converts UTF-16LE text to UTF-8 in bulk without decoding it to QString,
+// returns 0 if text is not valid UTF-16 and has to be decoded by codec.
+size_t convertUtf16LeToUtf8( std::string_view utf16Data, QByteArray& utf8Data )
+{
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+    const auto utf16Length = utf16Data.size() / 2;
+    if ( utf16Length == 0 ) {
+        return 0;
+    }
+
+    // Each UTF-16 code unit takes at most 3 bytes of UTF-8
+    utf8Data.resize( static_cast<int>( utf16Length * 3 ) );
+    return simdutf::convert_utf16_to_utf8( reinterpret_cast<const char16_t*>( utf16Data.data() ),
+                                           utf16Length, utf8Data.data() );
+#else
+    Q_UNUSED( utf16Data );
+    Q_UNUSED( utf8Data );
+    return 0;
+#endif
+}
+} // namespace
+
 std::vector<std::string_view> LogData::RawLines::buildUtf8View() const
 {
     std::vector<std::string_view> lines;
+    buildUtf8View( lines );
+    return lines;
+}
+
+void LogData::RawLines::buildUtf8View( std::vector<std::string_view>& lines ) const
+{
+    lines.clear();
     if ( this->endOfLines.empty() || textDecoder.decoder == nullptr ) {
-        return lines;
+        return;
     }
 
     try {
@@ -515,26 +1913,42 @@ std::vector<std::string_view> LogData::RawLines::buildUtf8View() const
 
         lines.reserve( endOfLines.size() );
 
+        const auto rawData = data();
         std::string_view wholeString;
 
-        if ( prefilterPattern.pattern().isEmpty() && textDecoder.encodingParams.isUtf8Compatible ) {
-            wholeString = std::string_view( buffer.data(), buffer.size() );
+        const auto hasPrefilter = prefilter.isActive();
+        const auto stripBytes
+            = prefilter.canStripBytes() && textDecoder.encodingParams.isUtf8Compatible;
+        const auto utf16ConvertedSize = ( !hasPrefilter && textDecoder.encodingParams.isUtf16LE )
+                                            ? convertUtf16LeToUtf8( rawData, utf8Data_ )
+                                            : 0;
+
+        if ( !hasPrefilter && textDecoder.encodingParams.isUtf8Compatible ) {
+            wholeString = rawData;
+        }
+        else if ( stripBytes ) {
+            // Sequences never contain line feeds, so lines stay in place
+            utf8Data_.resize( static_cast<int>( rawData.size() ) );
+            const auto strippedSize
+                = prefilter.stripBytes( rawData.data(), rawData.size(), utf8Data_.data() );
+            wholeString = { utf8Data_.data(), strippedSize };
+        }
+        else if ( utf16ConvertedSize > 0 ) {
+            wholeString = { utf8Data_.data(), utf16ConvertedSize };
         }
         else {
 
             QString utf16Data;
-            if ( prefilterPattern.pattern().isEmpty() && textDecoder.encodingParams.isUtf16LE ) {
-                utf16Data = QString::fromRawData( reinterpret_cast<const QChar*>( buffer.data() ),
-                                                  static_cast<int>( buffer.size() / 2 ) );
+            if ( !hasPrefilter && textDecoder.encodingParams.isUtf16LE ) {
+                utf16Data = QString::fromRawData( reinterpret_cast<const QChar*>( rawData.data() ),
+                                                  static_cast<int>( rawData.size() / 2 ) );
             }
             else {
-                utf16Data = textDecoder.decoder->toUnicode( buffer.data(),
-                                                            static_cast<int>( buffer.size() ) );
+                utf16Data = textDecoder.decoder->toUnicode( rawData.data(),
+                                                            static_cast<int>( rawData.size() ) );
             }
 
-            if ( !prefilterPattern.pattern().isEmpty() ) {
-                utf16Data.remove( prefilterPattern );
-            }
+            prefilter.strip( utf16Data );
 
             size_t resultSize = 0;
             if ( !optimizeForNotLatinEncodings ) {
@@ -542,10 +1956,16 @@ std::vector<std::string_view> LogData::RawLines::buildUtf8View() const
                 resultSize = static_cast<size_t>( utf8Data_.size() );
             }
             else {
-                utf8Data_.resize( static_cast<int>( buffer.size() * 2 ) );
+                utf8Data_.resize( static_cast<int>( rawData.size() * 2 ) );
                 resultSize = simdutf::convert_utf16_to_utf8(
                     reinterpret_cast<const char16_t*>( utf16Data.utf16() ),
                     static_cast<size_t>( utf16Data.length() ), utf8Data_.data() );
+
+                if ( resultSize == 0 && !utf16Data.isEmpty() ) {
+                    // Invalid surrogates are replaced by Qt
+                    utf8Data_ = utf16Data.toUtf8();
+                    resultSize = static_cast<size_t>( utf8Data_.size() );
+                }
             }
 
             wholeString = { utf8Data_.data(), resultSize };
@@ -562,6 +1982,13 @@ std::vector<std::string_view> LogData::RawLines::buildUtf8View() const
             lines.push_back( wholeString );
         }
 
+        // Views keep their place in data, entries of several lines stay whole
+        for ( const auto index : binaryLines ) {
+            if ( index < lines.size() ) {
+                lines[ index ] = lines[ index ].substr( 0, 0 );
+            }
+        }
+
     } catch ( const std::exception& e ) {
         LOG_ERROR << "failed to transform lines to utf8 " << e.what();
         const auto lastLineOffset = utf8Data_.size();
@@ -571,6 +1998,4 @@ std::vector<std::string_view> LogData::RawLines::buildUtf8View() const
                                 utf8Data_.size() - lastLineOffset );
         }
     }
-
-    return lines;
 }
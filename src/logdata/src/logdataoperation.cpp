@@ -43,6 +43,32 @@
 #include "overload_visitor.h"
 #include "synchronization.h"
 
+namespace {
+// Delay before partial reindex of a growing file, it is doubled
+// while data is added during each reindex and halved otherwise
+constexpr std::chrono::milliseconds MinFollowDelay{ 20 };
+constexpr std::chrono::milliseconds MaxFollowDelay{ 1000 };
+
+// Pending operation is replaced only by operations of the same or higher rank,
+// checks and partial reindexes of a growing file are merged into one
+template <typename Variant>
+int operationRank( const Variant& operation )
+{
+    return std::visit( makeOverloadVisitor( []( std::monostate ) { return 0; },
+                                            []( const CheckDataChangesOperation& ) { return 1; },
+                                            []( const PartialReindexOperation& ) { return 1; },
+                                            []( const FullReindexOperation& ) { return 2; },
+                                            []( const AttachOperation& ) { return 3; } ),
+                       operation );
+}
+
+template <typename Variant>
+bool isFollowOperation( const Variant& operation )
+{
+    return operationRank( operation ) == 1;
+}
+} // namespace
+
 void AttachOperation::doStart( LogDataWorker& workerThread ) const
 {
     const auto defaultEncodingMib = Configuration::get().defaultEncodingMib();
@@ -55,7 +81,7 @@ void AttachOperation::doStart( LogDataWorker& workerThread ) const
 void FullReindexOperation::doStart( LogDataWorker& workerThread ) const
 {
     LOG_INFO << "Reindexing (full)";
-    workerThread.indexAll( forcedEncoding_ );
+    workerThread.indexAll( forcedEncoding_, rotatedFileName_, keepUnchangedPrefix_ );
 }
 
 void PartialReindexOperation::doStart( LogDataWorker& workerThread ) const
@@ -73,6 +99,13 @@ void CheckDataChangesOperation::doStart( LogDataWorker& workerThread ) const
 OperationQueue::OperationQueue( std::function<void()> beforeOperationStart )
     : beforeOperationStart_( std::move( beforeOperationStart ) )
 {
+    followTimer_.setSingleShot( true );
+    QObject::connect( &followTimer_, &QTimer::timeout, [ this ] {
+        ScopedLock guard( mutex_ );
+        if ( executingOperation_.index() == 0 ) {
+            tryStartPendingOperation();
+        }
+    } );
 }
 
 void OperationQueue::setWorker( std::unique_ptr<LogDataWorker>&& worker )
@@ -91,6 +124,7 @@ void OperationQueue::interrupt()
 void OperationQueue::shutdown()
 {
     ScopedLock guard( mutex_ );
+    followTimer_.stop();
     if ( auto worker = std::move( worker_ ) ) {
         worker->interrupt();
     }
@@ -124,10 +158,36 @@ void OperationQueue::enqueueOperation( OperationVariant&& operation )
     LOG_INFO << "Enqueue operation " << operation.index() << ", now executing "
              << executingOperation_.index();
 
-    pendingOperation_ = std::move(operation);
+    if ( operationRank( operation ) < operationRank( pendingOperation_ ) ) {
+        LOG_INFO << "Operation merged into pending " << pendingOperation_.index();
+        return;
+    }
+
+    pendingOperation_ = std::move( operation );
+
+    if ( executingOperation_.index() != 0 ) {
+        return;
+    }
 
-    if ( executingOperation_.index() == 0 ) {
-        tryStartPendingOperation();
+    if ( followTimer_.isActive() && isFollowOperation( pendingOperation_ ) ) {
+        // Started by the timer
+        return;
+    }
+
+    followTimer_.stop();
+    tryStartPendingOperation();
+}
+
+void OperationQueue::updateFollowDelay( bool isFileGrowing )
+{
+    if ( isFileGrowing ) {
+        followDelay_ = qBound( MinFollowDelay, followDelay_ * 2, MaxFollowDelay );
+    }
+    else {
+        followDelay_ /= 2;
+        if ( followDelay_ < MinFollowDelay ) {
+            followDelay_ = std::chrono::milliseconds::zero();
+        }
     }
 }
 
@@ -137,5 +197,19 @@ void OperationQueue::finishOperationAndStartNext()
     LOG_INFO << "Finished operation " << executingOperation_.index() << ", next operation "
              << pendingOperation_.index();
 
+    // File is growing if it changed again while new data was indexed
+    const auto isPartialReindex
+        = std::holds_alternative<PartialReindexOperation>( executingOperation_ );
+    if ( isPartialReindex ) {
+        updateFollowDelay( isFollowOperation( pendingOperation_ ) );
+    }
+    executingOperation_ = {};
+
+    if ( isPartialReindex && isFollowOperation( pendingOperation_ ) && followDelay_.count() > 0 ) {
+        LOG_DEBUG << "Next operation delayed for " << followDelay_.count() << " ms";
+        followTimer_.start( followDelay_ );
+        return;
+    }
+
     tryStartPendingOperation();
 }
\ No newline at end of file
@@ -41,12 +41,22 @@
 #include <cmath>
 #include <exception>
 #include <functional>
+#include <numeric>
 #include <qrunnable.h>
 #include <qthread.h>
 #include <qthreadpool.h>
 #include <string_view>
 #include <thread>
+#include <utility>
 
+#include <QtGlobal>
+
+#if defined( Q_OS_LINUX ) || defined( Q_OS_FREEBSD )
+#include <fcntl.h>
+#define KLOGG_HAS_FADVISE
+#endif
+
+#include <QDateTime>
 #include <QFile>
 #include <QFileInfo>
 #include <QMessageBox>
@@ -54,23 +64,227 @@
 #include <QThreadPool>
 #include <tuple>
 
+#include "analysisbundle.h"
+#include "blockcache.h"
 #include "configuration.h"
+#include "devicetuning.h"
 #include "dispatch_to.h"
 #include "encodingdetector.h"
+#include "fileholder.h"
+#include "gzipfile.h"
+#include "indexcache.h"
+#include "remotefile.h"
 #include "issuereporter.h"
+#include "linescanner.h"
 #include "linetypes.h"
+#include "pluginfile.h"
 #include "log.h"
 #include "logdata.h"
 #include "memory_info.h"
+#include "overload_visitor.h"
 #include "progress.h"
 #include "readablesize.h"
 #include "runnable_lambda.h"
 
 #include "logdataworker.h"
 #include "synchronization.h"
+#include "tracezone.h"
+#include "workscheduler.h"
 
 constexpr int IndexingBlockSize = 1 * 1024 * 1024;
 
+// Files starting with ASCII headers are guessed by samples from the rest of the file
+constexpr int EncodingSamplesCount = 8;
+constexpr int EncodingSampleSize = 256 * 1024;
+
+// Indexed data is sampled once in this many bytes
+// to check for modifications when the file grows
+constexpr qint64 SampleDigestInterval = 64 * 1024 * 1024;
+constexpr qint64 SampleDigestSize = 4 * 1024;
+
+namespace {
+// Marks indexing data as being updated while the operation runs,
+// so that readers following the indexer know when to stop
+class IndexingInProgressGuard {
+  public:
+    explicit IndexingInProgressGuard( IndexingData* indexingData )
+        : indexingData_( indexingData )
+    {
+        IndexingData::MutateAccessor{ indexingData_ }.setIndexingInProgress( true );
+    }
+
+    ~IndexingInProgressGuard()
+    {
+        IndexingData::MutateAccessor{ indexingData_ }.setIndexingInProgress( false );
+    }
+
+    IndexingInProgressGuard( const IndexingInProgressGuard& ) = delete;
+    IndexingInProgressGuard& operator=( const IndexingInProgressGuard& ) = delete;
+
+  private:
+    IndexingData* indexingData_;
+};
+
+enum class FileAccessAdvice { Sequential, WillNeed, DontNeed };
+
+// Hint OS page cache about how the part of file will be used
+void adviseFileAccess( QIODevice& device, qint64 offset, qint64 length, FileAccessAdvice advice )
+{
+#ifdef KLOGG_HAS_FADVISE
+    // Compressed files are not read sequentially from page cache
+    auto* file = qobject_cast<QFile*>( &device );
+    if ( file == nullptr ) {
+        return;
+    }
+
+    const auto fadvice = [ advice ]() {
+        switch ( advice ) {
+        case FileAccessAdvice::Sequential:
+            return POSIX_FADV_SEQUENTIAL;
+        case FileAccessAdvice::WillNeed:
+            return POSIX_FADV_WILLNEED;
+        case FileAccessAdvice::DontNeed:
+            return POSIX_FADV_DONTNEED;
+        }
+        return POSIX_FADV_NORMAL;
+    }();
+
+    const auto result = ::posix_fadvise( file->handle(), offset, length, fadvice );
+    if ( result != 0 ) {
+        LOG_DEBUG << "posix_fadvise failed " << result;
+    }
+#else
+    Q_UNUSED( device );
+    Q_UNUSED( offset );
+    Q_UNUSED( length );
+    Q_UNUSED( advice );
+#endif
+}
+
+// Sparse index reads the file through a duplicate of the handle opened for
+// indexing, so it reads the indexed file even after it has been renamed
+SparseLinePositionStorage::DataReader makeFileDataReader( QIODevice& device,
+                                                          const QString& fileName )
+{
+    const auto* file = qobject_cast<const QFile*>( &device );
+    if ( auto reader = file != nullptr ? PositionalFileReader::duplicate( *file ) : nullptr ) {
+        return [ reader, fileName ]( LineOffset::UnderlyingType offset,
+                                     LineOffset::UnderlyingType size ) {
+            QByteArray data( static_cast<int>( size ), Qt::Uninitialized );
+            const auto bytesRead = reader->read( offset, data.data(), size );
+            if ( bytesRead < 0 ) {
+                LOG_WARNING << "Failed to read " << fileName << " at " << offset;
+                return QByteArray{};
+            }
+            data.resize( static_cast<int>( bytesRead ) );
+            return data;
+        };
+    }
+
+    // Compressed data is decompressed up to the offset by the device,
+    // it is opened once and read by one reader at a time
+    const auto compressedFile = std::shared_ptr<QIODevice>( makeLogFileDevice( fileName ) );
+    const auto compressedFileMutex = std::make_shared<Mutex>();
+    return [ compressedFile, compressedFileMutex, fileName ](
+               LineOffset::UnderlyingType offset, LineOffset::UnderlyingType size ) {
+        ScopedLock lock( *compressedFileMutex );
+        if ( !( compressedFile->isOpen() || compressedFile->open( QIODevice::ReadOnly ) )
+             || !compressedFile->seek( offset ) ) {
+            LOG_WARNING << "Failed to read " << fileName << " at " << offset;
+            return QByteArray{};
+        }
+        return compressedFile->read( size );
+    };
+}
+
+struct IndexedPartDigests {
+    quint64 headerDigest = 0;
+    qint64 headerSize = 0;
+    quint64 tailDigest = 0;
+    qint64 tailOffset = 0;
+    qint64 tailSize = 0;
+};
+
+// Digests of the first and the last block of the first indexedSize bytes
+IndexedPartDigests indexedPartDigests( QIODevice& file, qint64 indexedSize )
+{
+    IndexedPartDigests digests;
+
+    file.reset();
+    QByteArray hashBuffer( IndexingBlockSize, Qt::Uninitialized );
+    digests.headerSize = file.read( hashBuffer.data(), hashBuffer.size() );
+    FileDigest fastHashDigest;
+    fastHashDigest.addData( hashBuffer.data(), static_cast<size_t>( digests.headerSize ) );
+    digests.headerDigest = fastHashDigest.digest();
+
+    digests.tailDigest = digests.headerDigest;
+    digests.tailSize = digests.headerSize;
+    if ( indexedSize > hashBuffer.size() ) {
+        digests.tailOffset = indexedSize - hashBuffer.size();
+        file.seek( digests.tailOffset );
+        digests.tailSize = file.read( hashBuffer.data(), hashBuffer.size() );
+        fastHashDigest.reset();
+        fastHashDigest.addData( hashBuffer.data(), static_cast<size_t>( digests.tailSize ) );
+        digests.tailDigest = fastHashDigest.digest();
+    }
+
+    return digests;
+}
+
+// Reads the first indexing block and, if encoding has to be guessed,
+// samples evenly spread over the rest of the file
+std::vector<QByteArray> readEncodingSamples( QIODevice& file, qint64 start, bool spreadSamples )
+{
+    std::vector<QByteArray> samples;
+
+    const auto readSample = [ &file, &samples ]( qint64 offset, int size ) {
+        QByteArray sample{ size, Qt::Uninitialized };
+        if ( !file.seek( offset ) ) {
+            return;
+        }
+        const auto sampleSize = file.read( sample.data(), sample.size() );
+        if ( sampleSize > 0 ) {
+            sample.resize( static_cast<int>( sampleSize ) );
+            samples.push_back( std::move( sample ) );
+        }
+    };
+
+    readSample( start, IndexingBlockSize );
+
+    // Seeking in compressed files means decompressing everything before the offset
+    if ( samples.empty() || !spreadSamples || qobject_cast<QFile*>( &file ) == nullptr ) {
+        return samples;
+    }
+
+    const auto sampledStart = start + IndexingBlockSize;
+    const auto sampledSize = file.size() - sampledStart;
+    if ( sampledSize <= 0 ) {
+        return samples;
+    }
+
+    const auto samplesCount = sampledSize > EncodingSampleSize ? EncodingSamplesCount - 1 : 1;
+    const auto step = sampledSize / samplesCount;
+    for ( auto index = 0; index < samplesCount; ++index ) {
+        // Keep multibyte code units of UTF-16 and UTF-32 aligned
+        const auto offset = ( sampledStart + step * index ) & ~qint64{ 3 };
+        readSample( offset, EncodingSampleSize );
+    }
+
+    return samples;
+}
+
+// Index has lines before firstLine, texts of the following lines are added
+template <typename Index>
+void appendLineTexts( Index& index, LinesCount firstLine,
+                      const std::vector<std::string_view>& lineTexts )
+{
+    index.truncate( firstLine );
+    if ( index.size() == firstLine ) {
+        index.append( lineTexts );
+    }
+}
+} // namespace
+
 qint64 IndexingData::getIndexedSize() const
 {
     return hash_.size;
@@ -81,6 +295,104 @@ IndexedHash IndexingData::getHash() const
     return hash_;
 }
 
+std::vector<IndexedHash::BlockDigest> IndexingData::getBlockDigests( qint64 begin,
+                                                                   qint64 end ) const
+{
+    const auto& blocks = hash_.blockDigests;
+    auto first = std::upper_bound(
+        blocks.begin(), blocks.end(), begin,
+        []( qint64 offset, const auto& block ) { return offset < block.offset; } );
+    if ( first != blocks.begin() ) {
+        --first;
+    }
+
+    std::vector<IndexedHash::BlockDigest> overlapping;
+    for ( auto block = first; block != blocks.end() && block->offset < end; ++block ) {
+        if ( block->offset + block->size > begin ) {
+            overlapping.push_back( *block );
+        }
+    }
+    return overlapping;
+}
+
+void IndexingData::addBlockDigest( const IndexedHash::BlockDigest& blockDigest )
+{
+    hash_.blockDigests.push_back( blockDigest );
+    hashBuilder_.addData( reinterpret_cast<const char*>( &blockDigest.digest ),
+                          sizeof( blockDigest.digest ) );
+    hash_.fullDigest = hashBuilder_.digest();
+}
+
+LinesCount IndexingData::getPublishedNbLines() const
+{
+    return LinesCount( publishedNbLines_.load( std::memory_order_acquire ) );
+}
+
+LineLength IndexingData::getPublishedMaxLength() const
+{
+    return LineLength( publishedMaxLength_.load( std::memory_order_acquire ) );
+}
+
+bool IndexingData::hasPublishedTabs() const
+{
+    return publishedHasTabs_.load( std::memory_order_acquire );
+}
+
+qint64 IndexingData::getPublishedIndexedSize() const
+{
+    return publishedIndexedSize_.load( std::memory_order_acquire );
+}
+
+uint64_t IndexingData::getGeneration() const
+{
+    return generation_.load( std::memory_order_acquire );
+}
+
+bool IndexingData::isIndexingInProgress() const
+{
+    return indexingInProgress_.load( std::memory_order_acquire );
+}
+
+void IndexingData::preferSparseIndex()
+{
+    sparseIndexPreferred_.store( true, std::memory_order_release );
+}
+
+bool IndexingData::isSparseIndexPreferred() const
+{
+    return sparseIndexPreferred_.load( std::memory_order_acquire );
+}
+
+void IndexingData::setIndexMemoryLimit( size_t limit )
+{
+    indexMemoryLimit_.store( limit, std::memory_order_release );
+}
+
+size_t IndexingData::getIndexMemoryLimit() const
+{
+    return indexMemoryLimit_.load( std::memory_order_acquire );
+}
+
+std::optional<IndexEstimate> IndexingData::getIndexEstimate() const
+{
+    ScopedLock lock( estimateMutex_ );
+    return indexEstimate_;
+}
+
+void IndexingData::setIndexEstimate( const std::optional<IndexEstimate>& estimate )
+{
+    ScopedLock lock( estimateMutex_ );
+    indexEstimate_ = estimate;
+}
+
+void IndexingData::publish()
+{
+    publishedMaxLength_.store( maxLength_.get(), std::memory_order_release );
+    publishedHasTabs_.store( hasTabs_, std::memory_order_release );
+    publishedIndexedSize_.store( hash_.size, std::memory_order_release );
+    publishedNbLines_.store( getNbLines().get(), std::memory_order_release );
+}
+
 LineLength IndexingData::getMaxLength() const
 {
     return maxLength_;
@@ -88,12 +400,87 @@ LineLength IndexingData::getMaxLength() const
 
 LinesCount IndexingData::getNbLines() const
 {
-    return LinesCount( linePosition_.size() );
+    return std::visit( []( const auto& linePosition ) { return linePosition.size(); },
+                       linePosition_ );
 }
 
 LineOffset IndexingData::getEndOfLineOffset( LineNumber line ) const
 {
-    return linePosition_.at( line.get(), &linePositionCache_.local() );
+    return std::visit( makeOverloadVisitor(
+                           [ this, line ]( const LinePositionArray& linePosition ) {
+                               return linePosition.at( line.get(), &linePositionCache_.local() );
+                           },
+                           [ this, line ]( const SparseLinePositionArray& linePosition ) {
+                               return linePosition.at( line.get(),
+                                                       &sparseLinePositionCache_.local() );
+                           } ),
+                       linePosition_ );
+}
+
+void IndexingData::getEndOfLineOffsets( LineNumber first, LinesCount count,
+                                        std::vector<qint64>& offsets ) const
+{
+    std::visit(
+        [ first, count, &offsets ]( const auto& linePosition ) {
+            linePosition.range( first, count, offsets );
+        },
+        linePosition_ );
+}
+
+bool IndexingData::mayContainTrigrams( LineNumber first, LinesCount count,
+                                       const TrigramFilter::Hashes& hashes ) const
+{
+    if ( count.get() == 0 || first.get() + count.get() > getNbLines().get() ) {
+        return true;
+    }
+
+    const auto beginning
+        = ( first == 0_lnum ) ? 0 : getEndOfLineOffset( first - 1_lcount ).get();
+    // Fake final line feed is past the end of indexed data
+    const auto end = qMin( getEndOfLineOffset( first + count - 1_lcount ).get(), hash_.size );
+
+    return trigramIndex_.mayContain( beginning, end, hashes );
+}
+
+std::optional<roaring::Roaring64Map>
+IndexingData::findFieldValues( const std::vector<FieldCondition>& conditions, LineNumber first,
+                               LineNumber last ) const
+{
+    if ( fieldIndex_.fields().isEmpty() || fieldIndex_.size() != getNbLines() ) {
+        return {};
+    }
+
+    return fieldIndex_.find( conditions, first, last );
+}
+
+std::optional<roaring::Roaring64Map> IndexingData::findToken( std::string_view text,
+                                                              LineNumber first,
+                                                              LineNumber last ) const
+{
+    if ( tokenIndex_.size() != getNbLines() ) {
+        return {};
+    }
+
+    return tokenIndex_.find( text, first, last );
+}
+
+LineNumber IndexingData::getLineAtOffset( LineOffset::UnderlyingType offset ) const
+{
+    // First line that ends after the offset
+    auto first = LineNumber::UnderlyingType{ 0 };
+    auto count = getNbLines().get();
+    while ( count > 0 ) {
+        const auto step = count / 2;
+        const auto middle = first + step;
+        if ( getEndOfLineOffset( LineNumber( middle ) ).get() <= offset ) {
+            first = middle + 1;
+            count -= step + 1;
+        }
+        else {
+            count = step;
+        }
+    }
+    return LineNumber( first );
 }
 
 QTextCodec* IndexingData::getEncodingGuess() const
@@ -116,23 +503,72 @@ QTextCodec* IndexingData::getForcedEncoding() const
     return encodingForced_;
 }
 
-void IndexingData::addAll( const QByteArray& block, LineLength length,
-                           const FastLinePositionArray& linePosition, QTextCodec* encoding )
+void IndexingData::addAll( const QByteArray& block, LineLength length, bool hasTabs,
+                           const FastLinePositionArray& linePosition, QTextCodec* encoding,
+                           std::shared_ptr<TrigramFilter> trigramFilter,
+                           std::optional<TimestampSample> timestamp,
+                           const std::vector<std::string_view>& lineTexts,
+                           std::optional<quint64> blockDigest,
+                           const std::vector<uint64_t>& binaryChunks )
 
 {
+    KLOGG_ZONE( "IndexingData::addAll" );
     maxLength_ = qMax( maxLength_, length );
-    linePosition_.append_list( linePosition );
+    hasTabs_ = hasTabs_ || hasTabs;
+    std::visit( [ &linePosition ]( auto& positions ) { positions.append_list( linePosition ); },
+                linePosition_ );
+
+    // Fake final line is replaced by the line continued in this block,
+    // once some lines are added without texts the indexes stay behind
+    const auto nbLines = getNbLines().get();
+    const auto firstLine
+        = LinesCount( nbLines - qMin( nbLines, static_cast<uint64_t>( lineTexts.size() ) ) );
+    if ( !fieldIndex_.fields().isEmpty() ) {
+        appendLineTexts( fieldIndex_, firstLine, lineTexts );
+    }
+    if ( tokenIndex_.isEnabled() ) {
+        appendLineTexts( tokenIndex_, firstLine, lineTexts );
+    }
+    if ( lineLengthIndex_.isEnabled() ) {
+        appendLineTexts( lineLengthIndex_, firstLine, lineTexts );
+    }
+    if ( lineHashIndex_.isEnabled() ) {
+        appendLineTexts( lineHashIndex_, firstLine, lineTexts );
+    }
+    if ( recordIndex_.isEnabled() ) {
+        appendLineTexts( recordIndex_, firstLine, lineTexts );
+    }
 
     if ( !block.isEmpty() ) {
+        if ( trigramFilter ) {
+            trigramIndex_.append(
+                hash_.size, std::move( trigramFilter ),
+                std::string_view( block.constData(), static_cast<size_t>( block.size() ) ) );
+        }
+
+        timestampIndex_.append( hash_.size, hash_.size + block.size(), timestamp );
+        binaryRegionIndex_.append( binaryChunks );
+
         hash_.size += block.size();
 
-        if ( !useFastModificationDetection_ ) {
-            hashBuilder_.addData( block.data(), static_cast<size_t>( block.size() ) );
-            hash_.fullDigest = hashBuilder_.digest();
+        if ( !useFastModificationDetection_ && blockDigest ) {
+            const auto blockStart = hash_.size - block.size();
+            addBlockDigest( { blockStart, block.size(), *blockDigest } );
+
+            if ( blockStart == 0
+                 || blockStart / SampleDigestInterval != hash_.size / SampleDigestInterval ) {
+                const auto sampleSize
+                    = std::min( SampleDigestSize, static_cast<qint64>( block.size() ) );
+                FileDigest sampleDigest;
+                sampleDigest.addData( block.data(), static_cast<size_t>( sampleSize ) );
+                hash_.sampleDigests.push_back( { blockStart, sampleSize, sampleDigest.digest() } );
+            }
         }
     }
 
     encodingGuess_ = encoding;
+
+    publish();
 }
 
 int IndexingData::getProgress() const
@@ -148,22 +584,306 @@ void IndexingData::setProgress( int progress )
 void IndexingData::clear()
 {
     maxLength_ = 0_length;
+    hasTabs_ = false;
     hash_ = {};
     hashBuilder_.reset();
     linePosition_ = LinePositionArray();
+    trigramIndex_.clear();
+    binaryRegionIndex_.clear();
     encodingGuess_ = nullptr;
     encodingForced_ = nullptr;
 
     progress_ = {};
     linePositionCache_.clear();
+    sparseLinePositionCache_.clear();
 
     const auto& config = Configuration::get();
     useFastModificationDetection_ = config.fastModificationDetection();
+    timestampIndex_.reset( config.timestampFormat() );
+    fieldIndex_ = FieldIndex( config.indexedFields() );
+    tokenIndex_ = config.useTokenIndex()
+                      ? TokenIndex( config.tokenDelimiters().toStdString() )
+                      : TokenIndex();
+    lineLengthIndex_ = LineLengthIndex( config.useLineLengthIndex() );
+    lineHashIndex_ = LineHashIndex( config.useLineHashIndex() );
+    recordIndex_ = config.useRecordIndex()
+                       ? RecordIndex( config.searchEntryStartPattern().toStdString() )
+                       : RecordIndex();
+
+    ++generation_;
+    publish();
+}
+
+bool IndexingData::truncate( qint64 size )
+{
+    const auto& config = Configuration::get();
+    const auto isBuiltWithConfig
+        = !useFastModificationDetection_ && !config.fastModificationDetection()
+          && timestampIndex_.setting() == config.timestampFormat()
+          && fieldIndex_.fields() == config.indexedFields()
+          && tokenIndex_.isEnabled() == config.useTokenIndex()
+          && ( !tokenIndex_.isEnabled()
+               || tokenIndex_.delimiters() == config.tokenDelimiters().toStdString() )
+          && lineLengthIndex_.isEnabled() == config.useLineLengthIndex()
+          && lineHashIndex_.isEnabled() == config.useLineHashIndex()
+          && recordIndex_.startPattern()
+                 == ( config.useRecordIndex() ? config.searchEntryStartPattern().toStdString()
+                                              : std::string{} );
+
+    auto keptBlocks = std::find_if(
+        hash_.blockDigests.begin(), hash_.blockDigests.end(),
+        [ size ]( const auto& block ) { return block.offset + block.size == size; } );
+    if ( !isBuiltWithConfig || isSparseIndex() || keptBlocks == hash_.blockDigests.end() ) {
+        return false;
+    }
+    ++keptBlocks;
+
+    auto& linePosition = std::get<LinePositionArray>( linePosition_ );
+    linePosition.truncate( static_cast<LineOffset::UnderlyingType>( size ) );
+    linePositionCache_.clear();
+
+    // Line continued past size is added again with its text
+    const auto nbLines = linePosition.size();
+    const auto completeLines
+        = LinesCount( nbLines.get() > 0
+                              && linePosition.at( nbLines.get() - 1 ).get() > size
+                          ? nbLines.get() - 1
+                          : nbLines.get() );
+    fieldIndex_.truncate( completeLines );
+    tokenIndex_.truncate( completeLines );
+    lineLengthIndex_.truncate( completeLines );
+    lineHashIndex_.truncate( completeLines );
+    recordIndex_.truncate( completeLines );
+
+    const auto end = static_cast<LineOffset::UnderlyingType>( size );
+    trigramIndex_.truncate( end );
+    timestampIndex_.truncate( end );
+    binaryRegionIndex_.truncate( size );
+
+    // Max length is kept, it is only an upper bound of the kept lines
+    const auto blockDigests
+        = std::vector<IndexedHash::BlockDigest>( hash_.blockDigests.begin(), keptBlocks );
+    hash_.blockDigests.clear();
+    hashBuilder_.reset();
+    for ( const auto& blockDigest : blockDigests ) {
+        addBlockDigest( blockDigest );
+    }
+    hash_.sampleDigests.erase(
+        std::find_if( hash_.sampleDigests.begin(), hash_.sampleDigests.end(),
+                      [ size ]( const auto& sample ) { return sample.offset >= size; } ),
+        hash_.sampleDigests.end() );
+    hash_.size = size;
+
+    progress_ = {};
+
+    ++generation_;
+    publish();
+
+    return true;
+}
+
+void IndexingData::replace( IndexingData& other )
+{
+    linePosition_ = std::exchange( other.linePosition_, LinePositionArray() );
+    linePositionCache_.clear();
+    sparseLinePositionCache_.clear();
+
+    maxLength_ = std::exchange( other.maxLength_, 0_length );
+    hasTabs_ = std::exchange( other.hasTabs_, false );
+
+    trigramIndex_ = std::move( other.trigramIndex_ );
+    timestampIndex_ = std::move( other.timestampIndex_ );
+    fieldIndex_ = std::move( other.fieldIndex_ );
+    tokenIndex_ = std::move( other.tokenIndex_ );
+    lineLengthIndex_ = std::move( other.lineLengthIndex_ );
+    lineHashIndex_ = std::move( other.lineHashIndex_ );
+    recordIndex_ = std::move( other.recordIndex_ );
+    binaryRegionIndex_ = std::move( other.binaryRegionIndex_ );
+    other.binaryRegionIndex_.clear();
+
+    // Digest builder is not movable, it is fed again with digests of the blocks
+    hash_ = std::exchange( other.hash_, {} );
+    const auto blockDigests = std::exchange( hash_.blockDigests, {} );
+    hashBuilder_.reset();
+    for ( const auto& blockDigest : blockDigests ) {
+        addBlockDigest( blockDigest );
+    }
+
+    encodingGuess_ = other.encodingGuess_;
+    encodingForced_ = other.encodingForced_;
+    useFastModificationDetection_ = other.useFastModificationDetection_;
+    progress_ = other.progress_;
+
+    ++generation_;
+    publish();
 }
 
 size_t IndexingData::allocatedSize() const
 {
-    return linePosition_.allocatedSize();
+    return std::visit( []( const auto& linePosition ) { return linePosition.allocatedSize(); },
+                       linePosition_ )
+           + trigramIndex_.allocatedSize() + timestampIndex_.allocatedSize()
+           + fieldIndex_.allocatedSize() + tokenIndex_.allocatedSize()
+           + lineLengthIndex_.allocatedSize() + lineHashIndex_.allocatedSize()
+           + recordIndex_.allocatedSize() + binaryRegionIndex_.allocatedSize();
+}
+
+size_t IndexingData::residentSize() const
+{
+    const auto usage = memoryUsage();
+    return usage.linePositions + usage.trigramIndex + usage.timestampIndex + usage.fieldIndex
+           + usage.tokenIndex + usage.lineLengths + usage.lineHashes + usage.recordStarts
+           + usage.binaryRegions;
+}
+
+IndexMemoryUsage IndexingData::memoryUsage() const
+{
+    IndexMemoryUsage usage;
+    usage.linePositions = std::visit(
+        []( const auto& linePosition ) { return linePosition.residentSize(); }, linePosition_ );
+    usage.trigramIndex = trigramIndex_.allocatedSize();
+    usage.timestampIndex = timestampIndex_.allocatedSize();
+    usage.fieldIndex = fieldIndex_.allocatedSize();
+    usage.tokenIndex = tokenIndex_.allocatedSize();
+    usage.lineLengths = lineLengthIndex_.allocatedSize();
+    usage.lineHashes = lineHashIndex_.allocatedSize();
+    usage.recordStarts = recordIndex_.allocatedSize();
+    usage.binaryRegions = binaryRegionIndex_.allocatedSize();
+    return usage;
+}
+
+void IndexingData::useSparseIndex()
+{
+    linePosition_ = SparseLinePositionArray();
+    sparseLinePositionCache_.clear();
+}
+
+bool IndexingData::isSparseIndex() const
+{
+    return std::holds_alternative<SparseLinePositionArray>( linePosition_ );
+}
+
+void IndexingData::setSparseIndexReader( SparseLinePositionStorage::DataReader reader )
+{
+    if ( auto sparseLinePosition = std::get_if<SparseLinePositionArray>( &linePosition_ ) ) {
+        sparseLinePosition->storage().setReader( std::move( reader ) );
+        sparseLinePositionCache_.clear();
+    }
+}
+
+SparseLinePositionStorage::MissingBlocks
+IndexingData::missingSparseBlocks( LineNumber first, LinesCount count ) const
+{
+    if ( const auto sparseLinePosition = std::get_if<SparseLinePositionArray>( &linePosition_ ) ) {
+        return sparseLinePosition->storage().missingBlocks( first, count );
+    }
+    return {};
+}
+
+void IndexingData::addSparseBlocks( const SparseLinePositionStorage::MissingBlocks& missing ) const
+{
+    if ( const auto sparseLinePosition = std::get_if<SparseLinePositionArray>( &linePosition_ ) ) {
+        sparseLinePosition->storage().addDecodedBlocks( missing );
+    }
+}
+
+void IndexingData::useFileBackedIndex()
+{
+    linePosition_ = LinePositionArray( CompressedLinePositionStorage( true ) );
+    linePositionCache_.clear();
+}
+
+void IndexingData::setEncodingParameters( const EncodingParameters& encodingParams )
+{
+    if ( auto sparseLinePosition = std::get_if<SparseLinePositionArray>( &linePosition_ ) ) {
+        sparseLinePosition->storage().setEncodingParameters( encodingParams );
+        sparseLinePositionCache_.clear();
+    }
+}
+
+void IndexingData::saveIndex( QDataStream& stream ) const
+{
+    stream << maxLength_.get();
+    stream << hasTabs_;
+    stream << ( encodingGuess_ != nullptr ? encodingGuess_->name() : QByteArray{} );
+    stream << isSparseIndex();
+    trigramIndex_.save( stream );
+    timestampIndex_.save( stream );
+    tokenIndex_.save( stream );
+    lineHashIndex_.save( stream );
+    recordIndex_.save( stream );
+    binaryRegionIndex_.save( stream );
+    std::visit( [ &stream ]( const auto& linePosition ) { linePosition.save( stream ); },
+                linePosition_ );
+}
+
+bool IndexingData::loadIndex( QDataStream& stream, const IndexedHash& hash )
+{
+    LineLength::UnderlyingType maxLength = 0;
+    bool hasTabs = false;
+    QByteArray encodingName;
+    bool isSparse = false;
+    stream >> maxLength >> hasTabs >> encodingName >> isSparse;
+
+    // Storage type is chosen before loading
+    if ( stream.status() != QDataStream::Ok || isSparse != isSparseIndex() ) {
+        return false;
+    }
+
+    // Modifications of the indexed part are found by digests of its blocks
+    const auto hashedSize = std::accumulate(
+        hash.blockDigests.begin(), hash.blockDigests.end(), qint64{ 0 },
+        []( qint64 size, const auto& blockDigest ) { return size + blockDigest.size; } );
+    if ( !useFastModificationDetection_ && hashedSize != hash.size ) {
+        return false;
+    }
+
+    // Lines of the rest of file are appended to loaded indexes
+    TrigramIndex trigramIndex;
+    TimestampIndex timestampIndex;
+    timestampIndex.reset( timestampIndex_.setting() );
+    auto tokenIndex = tokenIndex_.isEnabled() ? TokenIndex( tokenIndex_.delimiters() ) : TokenIndex();
+    auto lineHashIndex = LineHashIndex( lineHashIndex_.isEnabled() );
+    auto recordIndex
+        = recordIndex_.isEnabled() ? RecordIndex( recordIndex_.startPattern() ) : RecordIndex();
+    BinaryRegionIndex binaryRegionIndex;
+    if ( !trigramIndex.load( stream ) || !timestampIndex.load( stream )
+         || !tokenIndex.load( stream ) || !lineHashIndex.load( stream )
+         || !recordIndex.load( stream ) || !binaryRegionIndex.load( stream ) ) {
+        return false;
+    }
+
+    const auto isLoaded = std::visit(
+        [ &stream ]( auto& linePosition ) { return linePosition.load( stream ); }, linePosition_ );
+    if ( !isLoaded ) {
+        return false;
+    }
+
+    maxLength_ = LineLength( maxLength );
+    hasTabs_ = hasTabs;
+    trigramIndex_ = std::move( trigramIndex );
+    timestampIndex_ = std::move( timestampIndex );
+    tokenIndex_ = std::move( tokenIndex );
+    lineHashIndex_ = std::move( lineHashIndex );
+    recordIndex_ = std::move( recordIndex );
+    binaryRegionIndex_ = std::move( binaryRegionIndex );
+    // Field and line length indexes are not saved, loaded lines are not in them
+    fieldIndex_ = FieldIndex( fieldIndex_.fields() );
+    lineLengthIndex_ = LineLengthIndex( lineLengthIndex_.isEnabled() );
+    encodingGuess_ = !encodingName.isEmpty() ? QTextCodec::codecForName( encodingName ) : nullptr;
+    linePositionCache_.clear();
+    sparseLinePositionCache_.clear();
+    hash_ = hash;
+    hash_.blockDigests.clear();
+    hashBuilder_.reset();
+    for ( const auto& blockDigest : hash.blockDigests ) {
+        addBlockDigest( blockDigest );
+    }
+
+    ++generation_;
+    publish();
+
+    return true;
 }
 
 LogDataWorker::LogDataWorker( const std::shared_ptr<IndexingData>& indexing_data )
@@ -189,9 +909,11 @@ void LogDataWorker::attachFile( const QString& fileName )
     ScopedLock locker( operationsMutex_ );
     interruptRequest_.clear();
     fileName_ = fileName;
+    tailFile_ = {};
 }
 
-void LogDataWorker::indexAll( QTextCodec* forcedEncoding )
+void LogDataWorker::indexAll( QTextCodec* forcedEncoding, const QString& rotatedFileName,
+                              bool keepUnchangedPrefix )
 {
     ScopedLock locker( operationsMutex_ );
     operationsPool_.waitForDone();
@@ -202,12 +924,15 @@ void LogDataWorker::indexAll( QTextCodec* forcedEncoding )
                                             : std::string{ "none" } );
     QSemaphore operationStarted;
     operationsPool_.start(
-        createRunnable( [ this, &operationStarted, forcedEncoding, fileName = fileName_ ] {
+        createRunnable( [ this, &operationStarted, forcedEncoding, rotatedFileName,
+                          keepUnchangedPrefix, fileName = fileName_ ] {
             LOG_INFO << "FullIndex thread started";
             operationStarted.release();
             ScopedLock operationLock( operationsMutex_ );
+            tailFile_ = {};
             auto operationRequested = std::make_unique<FullIndexOperation>(
-                fileName, indexing_data_, interruptRequest_, forcedEncoding );
+                fileName, indexing_data_, interruptRequest_, forcedEncoding, rotatedFileName,
+                keepUnchangedPrefix );
             return connectSignalsAndRun( operationRequested.get() );
         } ) );
     operationStarted.acquire();
@@ -227,8 +952,8 @@ void LogDataWorker::indexAdditionalLines()
         LOG_INFO << "PartialIndex thread started";
         operationStarted.release();
         ScopedLock operationLock( operationsMutex_ );
-        auto operationRequested = std::make_unique<PartialIndexOperation>( fileName, indexing_data_,
-                                                                           interruptRequest_ );
+        auto operationRequested = std::make_unique<PartialIndexOperation>(
+            fileName, indexing_data_, interruptRequest_, tailFile_ );
         return connectSignalsAndRun( operationRequested.get() );
     } ) );
     operationStarted.acquire();
@@ -278,15 +1003,15 @@ void LogDataWorker::interrupt()
     interruptRequest_.set();
 }
 
-void LogDataWorker::onIndexingFinished( bool result )
+void LogDataWorker::onIndexingFinished( bool result, const OperationStats& stats )
 {
     if ( result ) {
         LOG_INFO << "finished indexing in worker thread";
-        Q_EMIT indexingFinished( LoadingStatus::Successful );
+        Q_EMIT indexingFinished( LoadingStatus::Successful, stats );
     }
     else {
         LOG_INFO << "indexing interrupted in worker thread";
-        Q_EMIT indexingFinished( LoadingStatus::Interrupted );
+        Q_EMIT indexingFinished( LoadingStatus::Interrupted, stats );
     }
 }
 
@@ -299,175 +1024,130 @@ void LogDataWorker::onCheckFileFinished( const MonitoredFileStatus result )
 //
 // Operations implementation
 //
-namespace parse_data_block {
-
-std::string_view::size_type findNextMultiByteDelimeter( EncodingParameters encodingParams,
-                                                        std::string_view data, char delimeter )
+FastLinePositionArray IndexOperation::parseDataBlock( LineOffset::UnderlyingType blockBeginning,
+                                                      const QByteArray& block,
+                                                      IndexingState& state ) const
 {
-    auto nextDelimeter = data.find( delimeter );
+    KLOGG_ZONE( "IndexOperation::parseDataBlock" );
+    using namespace line_scanner;
 
-    if ( nextDelimeter == std::string_view::npos ) {
-        return nextDelimeter;
-    }
-
-    const auto isNotDelimeter = [ &encodingParams, data ]( std::string_view::size_type checkPos ) {
-        const auto lineFeedWidth
-            = static_cast<std::string_view::size_type>( encodingParams.lineFeedWidth );
-
-        const auto isCheckForward = encodingParams.lineFeedIndex == 0;
-
-        if ( isCheckForward && checkPos + lineFeedWidth > data.size() ) {
-            return true;
-        }
-        else if ( !isCheckForward && checkPos < lineFeedWidth - 1 ) {
-            return true;
-        }
-
-        for ( auto i = 1u; i < lineFeedWidth; ++i ) {
-            const auto nextByte = isCheckForward ? data[ checkPos + i ] : data[ checkPos - i ];
-            if ( nextByte != '\0' ) {
-                return true;
-            }
-        }
-
-        return false;
-    };
+    FastLinePositionArray linePositions;
 
-    while ( nextDelimeter != std::string_view::npos && isNotDelimeter( nextDelimeter ) ) {
-        nextDelimeter = data.find( delimeter, nextDelimeter + 1 );
+    if ( state.pos > blockBeginning + block.size() ) {
+        LOG_ERROR << "Trying to parse out of block: " << state.pos << " " << blockBeginning << " "
+                  << block.size();
+        return linePositions;
     }
 
-    return nextDelimeter;
-}
+    const auto posWithinBlock
+        = static_cast<int>( state.pos >= blockBeginning ? ( state.pos - blockBeginning ) : 0u );
 
-std::string_view::size_type findNextSingleByteDelimeter( EncodingParameters, std::string_view data,
-                                                         char delimeter )
-{
-    return data.find( delimeter );
-}
-
-int charOffsetWithinBlock( const char* blockStart, const char* pointer,
-                           const EncodingParameters& encodingParams )
-{
-    return static_cast<int>( std::distance( blockStart, pointer ) )
-           - encodingParams.getBeforeCrOffset();
-}
-
-using FindDelimeter = std::string_view::size_type ( * )( EncodingParameters encodingParams,
-                                                         std::string_view, char );
-
-LineLength::UnderlyingType
-expandTabsInLine( const QByteArray& block, std::string_view blockToExpand, int posWithinBlock,
-                  EncodingParameters encodingParams, FindDelimeter findNextDelimeter,
-                  LineLength::UnderlyingType initialAdditionalSpaces = 0 )
-{
-    auto additionalSpaces = initialAdditionalSpaces;
-    while ( !blockToExpand.empty() ) {
-        const auto nextTab = findNextDelimeter( encodingParams, blockToExpand, '\t' );
-        if ( nextTab == std::string_view::npos ) {
-            break;
-        }
-
-        const auto tabPosWithinBlock
-            = charOffsetWithinBlock( block.data(), blockToExpand.data() + nextTab, encodingParams );
-
-        LOG_DEBUG << "Tab at " << tabPosWithinBlock;
-
-        const auto currentExpandedSize = tabPosWithinBlock - posWithinBlock + additionalSpaces;
-
-        additionalSpaces += TabStop - ( currentExpandedSize % TabStop ) - 1;
-        if ( nextTab >= blockToExpand.size() ) {
-            break;
-        }
-
-        blockToExpand.remove_prefix( nextTab + 1 );
-    }
+    const auto lineFeedWidth = state.encodingParams.lineFeedWidth;
 
-    return additionalSpaces;
-}
+    // Length of current line up to dataEnd, tabs are expanded
+    // only when lines are displayed
+    const auto lineLength = [ &state, lineFeedWidth ]( LineOffset::UnderlyingType dataEnd ) {
+        return ( dataEnd - state.pos ) / lineFeedWidth;
+    };
 
-std::tuple<bool, int, LineLength::UnderlyingType>
-findNextLineFeed( const QByteArray& block, int posWithinBlock, const IndexingState& state,
-                  FindDelimeter findNextDelimeter )
-{
-    const auto searchStart = block.data() + posWithinBlock;
-    const auto searchLineSize = static_cast<size_t>( block.size() - posWithinBlock );
+    const auto hasTabs = forEachLineFeed(
+        std::string_view( block.data(), static_cast<size_t>( block.size() ) ), posWithinBlock,
+        state.encodingParams, [ & ]( int lineFeedPosWithinBlock ) {
+            const auto currentDataEnd = blockBeginning + lineFeedPosWithinBlock;
 
-    const auto blockView = std::string_view( searchStart, searchLineSize );
-    const auto nextLineFeed = findNextDelimeter( state.encodingParams, blockView, '\n' );
+            state.max_length = std::max( state.max_length, lineLength( currentDataEnd ) );
 
-    const auto isEndOfBlock = nextLineFeed == std::string_view::npos;
-    const auto nextLineSize = !isEndOfBlock ? nextLineFeed : searchLineSize;
+            state.end = currentDataEnd;
+            state.pos = state.end + lineFeedWidth;
+            linePositions.append( LineOffset( state.pos ) );
 
-    posWithinBlock
-        = charOffsetWithinBlock( block.data(), searchStart + nextLineSize, state.encodingParams );
+            return true;
+        } );
 
-    const auto additionalSpaces
-        = expandTabsInLine( block, blockView.substr( 0, nextLineSize ), posWithinBlock,
-                            state.encodingParams, findNextDelimeter, state.additional_spaces );
+    state.has_tabs = state.has_tabs || hasTabs;
 
-    return std::make_tuple( isEndOfBlock, posWithinBlock, additionalSpaces );
-}
-} // namespace parse_data_block
+    // The last line of block continues in the next one
+    state.max_length = std::max( state.max_length, lineLength( blockBeginning + block.size() ) );
 
-FastLinePositionArray IndexOperation::parseDataBlock( LineOffset::UnderlyingType blockBeginning,
-                                                      const QByteArray& block,
-                                                      IndexingState& state ) const
-{
-    using namespace parse_data_block;
-
-    FindDelimeter findNextDelimeter;
-    if ( state.encodingParams.lineFeedWidth == 1 ) {
-        findNextDelimeter = findNextSingleByteDelimeter;
-    }
-    else {
-        findNextDelimeter = findNextMultiByteDelimeter;
-    }
+    return linePositions;
+}
 
-    bool isEndOfBlock = false;
-    FastLinePositionArray linePositions;
+IndexOperation::ScannedBlock
+IndexOperation::scanDataBlock( BlockData blockData, EncodingParameters encodingParams,
+                               bool hashBlock, bool buildTrigramFilter,
+                               const std::optional<TimestampParser>& timestampParser ) const
+{
+    using namespace line_scanner;
 
-    while ( !isEndOfBlock ) {
-        if ( state.pos > blockBeginning + block.size() ) {
-            LOG_ERROR << "Trying to parse out of block: " << state.pos << " " << blockBeginning
-                      << " " << block.size();
-            break;
-        }
+    ScannedBlock scannedBlock;
+    scannedBlock.block = std::move( blockData );
 
-        auto posWithinBlock
-            = static_cast<int>( state.pos >= blockBeginning ? ( state.pos - blockBeginning ) : 0u );
+    const auto& blockBeginning = scannedBlock.block.beginning;
+    const auto& block = scannedBlock.block.data;
 
-        isEndOfBlock = posWithinBlock == block.size();
+    if ( blockBeginning < 0 || block.isEmpty() ) {
+        return scannedBlock;
+    }
 
-        if ( !isEndOfBlock ) {
-            std::tie( isEndOfBlock, posWithinBlock, state.additional_spaces )
-                = findNextLineFeed( block, posWithinBlock, state, findNextDelimeter );
-        }
+    if ( hashBlock ) {
+        scannedBlock.digest
+            = FileDigest::blockDigest( block.constData(), static_cast<size_t>( block.size() ) );
+    }
 
-        const auto currentDataEnd = posWithinBlock + blockBeginning;
+    if ( buildTrigramFilter ) {
+        scannedBlock.trigramFilter = std::make_shared<TrigramFilter>();
+        scannedBlock.trigramFilter->addData(
+            std::string_view( block.constData(), static_cast<size_t>( block.size() ) ) );
+    }
 
-        const auto length = ( currentDataEnd - state.pos ) / state.encodingParams.lineFeedWidth
-                            + state.additional_spaces;
+    // Binary data often has no line feeds, so it is looked for in all blocks
+    scannedBlock.binaryChunks = BinaryRegionIndex::findBinaryChunks(
+        blockBeginning, std::string_view( block.constData(), static_cast<size_t>( block.size() ) ),
+        encodingParams );
+
+    // Line that ends in this block can start in any of the previous ones,
+    // so only find where it ends and treat everything after that
+    // as if this block was indexed alone.
+    int headEnd = -1;
+    forEachDelimeter( std::string_view( block.data(), static_cast<size_t>( block.size() ) ), 0,
+                      encodingParams, [ &headEnd ]( int delimeterPos, bool isLineFeed ) {
+                          if ( isLineFeed ) {
+                              headEnd = delimeterPos;
+                          }
+                          return !isLineFeed;
+                      } );
+
+    if ( headEnd < 0 ) {
+        return scannedBlock;
+    }
 
-        state.max_length = std::max( state.max_length, length );
+    scannedBlock.hasLineFeed = true;
+    scannedBlock.headSize = headEnd + encodingParams.lineFeedWidth;
 
-        if ( !isEndOfBlock ) {
-            state.end = currentDataEnd;
-            state.pos = state.end + state.encodingParams.lineFeedWidth;
-            state.additional_spaces = 0;
-            linePositions.append( LineOffset( state.pos ) );
+    if ( timestampParser ) {
+        scannedBlock.timestamp = timestampParser->findInBlock(
+            std::string_view( block.constData(), static_cast<size_t>( block.size() ) ),
+            static_cast<size_t>( scannedBlock.headSize ) );
+        if ( scannedBlock.timestamp ) {
+            scannedBlock.timestamp->offset += blockBeginning;
         }
     }
 
-    return linePositions;
+    scannedBlock.tailState.encodingParams = encodingParams;
+    scannedBlock.tailState.pos = blockBeginning + scannedBlock.headSize;
+    scannedBlock.tailState.end = blockBeginning + headEnd;
+    scannedBlock.linePositions = std::make_shared<FastLinePositionArray>(
+        parseDataBlock( blockBeginning, block, scannedBlock.tailState ) );
+
+    return scannedBlock;
 }
 
-void IndexOperation::guessEncoding( const QByteArray& block,
+void IndexOperation::guessEncoding( const std::vector<QByteArray>& samples,
                                     IndexingData::MutateAccessor& scopedAccessor,
                                     IndexingState& state ) const
 {
     if ( !state.encodingGuess ) {
-        state.encodingGuess = EncodingDetector::getInstance().detectEncoding( block );
+        state.encodingGuess = EncodingDetector::getInstance().detectEncoding( samples );
         LOG_INFO << "Encoding guess " << state.encodingGuess->name().toStdString();
     }
 
@@ -489,60 +1169,99 @@ void IndexOperation::guessEncoding( const QByteArray& block,
               << state.encodingParams.lineFeedWidth;
 }
 
-std::chrono::microseconds IndexOperation::readFileInBlocks( QFile& file,
-                                                            BlockPrefetcher& blockPrefetcher )
+void IndexOperation::readFileInBlocks( QIODevice& file, BlockPrefetcher& blockPrefetcher,
+                                       OperationStats& stats, PipelineTrace& trace,
+                                       std::atomic<int64_t>& blocksInFlight )
 {
+    KLOGG_ZONE( "IndexOperation::readFileInBlocks" );
     using namespace std::chrono;
     using clock = high_resolution_clock;
 
     LOG_INFO << "Starting IO thread";
 
-    microseconds ioDuration{};
+    // Ask OS to read ahead as many blocks as prefetcher can hold,
+    // each read block moves the window forward
+    const auto& config = Configuration::get();
+    const auto readBufferSizeMb = DeviceTuning::get().parameters( fileName_ ).indexReadBufferSizeMb;
+    const auto readAheadSize
+        = static_cast<qint64>( std::max( 1, readBufferSizeMb ) ) * IndexingBlockSize;
+    const auto dropFileCache = config.dropIndexedFileCache();
+
+    adviseFileAccess( file, file.pos(), 0, FileAccessAdvice::Sequential );
+    adviseFileAccess( file, file.pos(), readAheadSize, FileAccessAdvice::WillNeed );
+
+    auto diskStream = WorkScheduler::get().openDiskStream( fileName_, interruptRequest_ );
+
+    std::size_t blockIndex = 0;
     while ( !file.atEnd() ) {
 
+        diskStream.yield();
         if ( interruptRequest_ ) {
             break;
         }
 
-        BlockData blockData{ file.pos(), QByteArray{ IndexingBlockSize, Qt::Uninitialized } };
+        BlockData blockData{ blockIndex, file.pos(),
+                             QByteArray{ IndexingBlockSize, Qt::Uninitialized } };
 
         clock::time_point ioT1 = clock::now();
         const auto readBytes
-            = static_cast<int>( file.read( blockData.second.data(), blockData.second.size() ) );
+            = static_cast<int>( file.read( blockData.data.data(), blockData.data.size() ) );
 
         if ( readBytes < 0 ) {
             LOG_ERROR << "Reading past the end of file";
             break;
         }
 
-        if ( readBytes < blockData.second.size() ) {
-            blockData.second.resize( readBytes );
+        // End of compressed data is found only when it is read
+        if ( readBytes == 0 ) {
+            break;
+        }
+
+        if ( readBytes < blockData.data.size() ) {
+            blockData.data.resize( readBytes );
+        }
+
+        adviseFileAccess( file, blockData.beginning + readAheadSize, IndexingBlockSize,
+                          FileAccessAdvice::WillNeed );
+
+        if ( dropFileCache ) {
+            // Data is already copied to the block, so a scan of huge
+            // file does not evict everything else from page cache
+            adviseFileAccess( file, blockData.beginning, readBytes, FileAccessAdvice::DontNeed );
         }
 
+        ++blockIndex;
+
         clock::time_point ioT2 = clock::now();
 
-        ioDuration += duration_cast<microseconds>( ioT2 - ioT1 );
+        stats.ioDuration += duration_cast<microseconds>( ioT2 - ioT1 );
+        stats.bytesRead += static_cast<uint64_t>( readBytes );
+        trace.addSpan( "read", ioT1, ioT2 );
 
-        LOG_DEBUG << "Sending block " << blockData.first << " size " << blockData.second.size();
+        LOG_DEBUG << "Sending block " << blockData.beginning << " size " << blockData.data.size();
 
+        trace.addCounter( "blocks in flight", ++blocksInFlight );
         while ( !blockPrefetcher.try_put( blockData ) && !interruptRequest_ ) {
             std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
         }
+
+        const auto putTime = clock::now();
+        stats.queueStallDuration += duration_cast<microseconds>( putTime - ioT2 );
+        trace.addSpan( "blocked", ioT2, putTime );
     }
 
-    auto lastBlock = std::make_pair( -1, QByteArray{} );
+    auto lastBlock = BlockData{ blockIndex, -1, QByteArray{} };
     while ( !blockPrefetcher.try_put( lastBlock ) && !interruptRequest_ ) {
         std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
     }
 
     LOG_INFO << "IO thread done";
-    return ioDuration;
 }
 
-void IndexOperation::indexNextBlock( IndexingState& state, const BlockData& blockData )
+void IndexOperation::indexNextBlock( IndexingState& state, const ScannedBlock& scannedBlock )
 {
-    const auto& blockBeginning = blockData.first;
-    const auto& block = blockData.second;
+    const auto& blockBeginning = scannedBlock.block.beginning;
+    const auto& block = scannedBlock.block.data;
 
     LOG_DEBUG << "Indexing block " << blockBeginning << " start";
 
@@ -550,21 +1269,49 @@ void IndexOperation::indexNextBlock( IndexingState& state, const BlockData& bloc
         return;
     }
 
-    IndexingData::MutateAccessor scopedAccessor{ indexing_data_.get() };
+    if ( !block.isEmpty() ) {
+        const auto lineStart = state.pos;
+
+        // Block is parsed before taking the lock,
+        // readers are blocked only while lines are appended
+        FastLinePositionArray linePositions;
+        if ( !scannedBlock.hasLineFeed ) {
+            linePositions = parseDataBlock( blockBeginning, block, state );
+        }
+        else {
+            // Finish the line started in previous blocks and
+            // stitch it with lines found by the parallel scan
+            const auto blockHead = QByteArray::fromRawData( block.constData(), scannedBlock.headSize );
+            linePositions = parseDataBlock( blockBeginning, blockHead, state );
+            linePositions.append_list( *scannedBlock.linePositions );
+
+            const auto& tailState = scannedBlock.tailState;
+            state.pos = tailState.pos;
+            state.end = tailState.end;
+            state.max_length = std::max( state.max_length, tailState.max_length );
+            state.has_tabs = state.has_tabs || tailState.has_tabs;
+        }
 
-    guessEncoding( block, scopedAccessor, state );
+        std::string lineHead;
+        std::vector<std::string_view> lineTexts;
+        if ( state.splitLines ) {
+            lineTexts = splitLineTexts( state, lineStart, scannedBlock.block, linePositions,
+                                        lineHead );
+        }
 
-    if ( !block.isEmpty() ) {
-        const auto linePositions = parseDataBlock( blockBeginning, block, state );
         auto maxLength = state.max_length;
         if ( maxLength > std::numeric_limits<LineLength::UnderlyingType>::max() ) {
             LOG_ERROR << "Too long lines " << maxLength;
             maxLength = std::numeric_limits<LineLength::UnderlyingType>::max();
         }
 
+        IndexingData::MutateAccessor scopedAccessor{ indexing_data_.get() };
         scopedAccessor.addAll( block,
                                LineLength( static_cast<LineLength::UnderlyingType>( maxLength ) ),
-                               linePositions, state.encodingGuess );
+                               state.has_tabs, linePositions, state.encodingGuess,
+                               scannedBlock.trigramFilter, scannedBlock.timestamp, lineTexts,
+                               scannedBlock.digest, scannedBlock.binaryChunks );
+        state.has_tabs = false;
 
         // Update the caller for progress indication
         const auto progress
@@ -577,15 +1324,124 @@ void IndexOperation::indexNextBlock( IndexingState& state, const BlockData& bloc
         }
     }
     else {
+        IndexingData::MutateAccessor scopedAccessor{ indexing_data_.get() };
         scopedAccessor.setEncodingGuess( state.encodingGuess );
     }
 
     LOG_DEBUG << "Indexing block " << blockBeginning << " done";
 }
 
-void IndexOperation::doIndex( LineOffset initialPosition )
+std::vector<std::string_view>
+IndexOperation::splitLineTexts( IndexingState& state, LineOffset::UnderlyingType lineStart,
+                                const BlockData& blockData,
+                                const FastLinePositionArray& linePositions,
+                                std::string& lineHead ) const
 {
-    QFile file( fileName_ );
+    const auto& block = blockData.data;
+    const auto blockBeginning = blockData.beginning;
+
+    std::vector<std::string_view> lines;
+    lines.reserve( linePositions.size().get() );
+
+    // Line feed is one byte, lines are split only for such encodings
+    for ( LineNumber::UnderlyingType i = 0; i < linePositions.size().get(); ++i ) {
+        const auto lineEnd = linePositions.at( i ).get() - 1;
+        if ( lineStart >= blockBeginning ) {
+            lines.emplace_back( block.constData() + ( lineStart - blockBeginning ),
+                                static_cast<size_t>( lineEnd - lineStart ) );
+        }
+        else if ( state.isLineHeadKnown ) {
+            lineHead = std::move( state.lineHead );
+            lineHead.append( block.constData(), static_cast<size_t>( lineEnd - blockBeginning ) );
+            lines.emplace_back( lineHead );
+        }
+        else {
+            lines.emplace_back();
+        }
+
+        lineStart = lineEnd + 1;
+        state.isLineHeadKnown = true;
+    }
+
+    // Keep the rest of the block for the next one, lines
+    // longer than a block are indexed without text
+    const auto tailStart = qMax( lineStart, blockBeginning ) - blockBeginning;
+    const auto tailSize = static_cast<size_t>( block.size() - tailStart );
+    if ( linePositions.size().get() > 0 ) {
+        state.lineHead.clear();
+    }
+    if ( state.isLineHeadKnown
+         && state.lineHead.size() + tailSize <= static_cast<size_t>( IndexingBlockSize ) ) {
+        state.lineHead.append( block.constData() + tailStart, tailSize );
+    }
+    else {
+        state.isLineHeadKnown = false;
+        state.lineHead.clear();
+    }
+
+    return lines;
+}
+
+IndexingState IndexOperation::initialState( LineOffset initialPosition ) const
+{
+    IndexingState state;
+    state.pos = initialPosition.get();
+
+    IndexingData::ConstAccessor scopedAccessor{ indexing_data_.get() };
+
+    state.fileTextCodec = scopedAccessor.getForcedEncoding();
+    if ( !state.fileTextCodec ) {
+        state.fileTextCodec = scopedAccessor.getEncodingGuess();
+    }
+
+    state.encodingGuess = scopedAccessor.getEncodingGuess();
+    LOG_INFO << "Initial encoding "
+             << ( state.fileTextCodec != nullptr ? state.fileTextCodec->name().toStdString()
+                                                 : std::string{ "auto" } );
+
+    // Start of the line continued after a fake final line feed is not read again
+    const auto nbLines = scopedAccessor.getNbLines();
+    state.isLineHeadKnown
+        = nbLines.get() == 0
+          || scopedAccessor.getEndOfLineOffset( LineNumber( nbLines.get() - 1 ) ).get()
+                 == state.pos;
+    state.splitLines = !scopedAccessor.getIndexedFields().isEmpty()
+                       || scopedAccessor.isTokenIndexEnabled()
+                       || scopedAccessor.isLineLengthIndexEnabled()
+                       || scopedAccessor.isLineHashIndexEnabled()
+                       || scopedAccessor.isRecordIndexEnabled();
+    state.hashBlocks = scopedAccessor.isHashingBlocks();
+
+    return state;
+}
+
+void IndexOperation::addFakeFinalLineFeed( IndexingData::MutateAccessor& scopedAccessor,
+                                           const IndexingState& state ) const
+{
+    // Check if there is a non LF terminated line at the end of the file
+    if ( state.file_size <= state.pos ) {
+        return;
+    }
+
+    LOG_WARNING << "Non LF terminated file, adding a fake end of line";
+
+    FastLinePositionArray line_position;
+    line_position.append( LineOffset( state.file_size + 1 ) );
+    line_position.setFakeFinalLF();
+
+    std::vector<std::string_view> lineTexts;
+    if ( state.splitLines ) {
+        lineTexts.emplace_back( state.isLineHeadKnown ? state.lineHead : std::string_view{} );
+    }
+
+    scopedAccessor.addAll( {}, 0_length, false, line_position, state.encodingGuess, {}, {},
+                           lineTexts );
+}
+
+OperationStats IndexOperation::doIndex( LineOffset initialPosition )
+{
+    const auto fileDevice = makeLogFileDevice( fileName_ );
+    auto& file = *fileDevice;
 
     if ( !( file.isOpen() || file.open( QIODevice::ReadOnly ) ) ) {
         // TODO: Check that the file is seekable?
@@ -599,35 +1455,69 @@ void IndexOperation::doIndex( LineOffset initialPosition )
 
         scopedAccessor.setProgress( 100 );
         Q_EMIT indexingProgressed( 100 );
-        return;
+        return {};
     }
 
-    IndexingState state;
-    state.pos = initialPosition.get();
+    {
+        IndexingData::MutateAccessor scopedAccessor{ indexing_data_.get() };
+        if ( scopedAccessor.isSparseIndex() ) {
+            scopedAccessor.setSparseIndexReader( makeFileDataReader( file, fileName_ ) );
+        }
+    }
+
+    // Taken before reading, so that any later write changes it
+    const auto lastModified = QFileInfo( fileName_ ).lastModified().toMSecsSinceEpoch();
+
+    auto state = initialState( initialPosition );
     state.file_size = file.size();
 
-    {
-        IndexingData::ConstAccessor scopedAccessor{ indexing_data_.get() };
+    // Big files are checkpointed to index cache while they are indexed, so closing
+    // klogg in the middle does not lose the work. Decompressed data is not,
+    // as reaching the checkpoint means decompressing all of it again.
+    const auto& config = Configuration::get();
+    const auto checkpointInterval
+        = static_cast<qint64>( std::max( config.indexCheckpointIntervalMb(), 1 ) ) * 1024 * 1024;
+    std::optional<qint64> nextCheckpoint;
+    if ( config.useIndexCache() && config.fastModificationDetection()
+         && qobject_cast<QFile*>( &file ) != nullptr
+         && state.file_size - state.pos > checkpointInterval ) {
+        nextCheckpoint = ( state.pos / checkpointInterval + 1 ) * checkpointInterval;
+    }
 
-        state.fileTextCodec = scopedAccessor.getForcedEncoding();
-        if ( !state.fileTextCodec ) {
-            state.fileTextCodec = scopedAccessor.getEncodingGuess();
+    {
+        // Blocks are scanned in parallel, so encoding
+        // has to be known before the first one is read
+        const auto encodingSamples = readEncodingSamples( file, state.pos, !state.encodingGuess );
+        if ( !encodingSamples.empty() ) {
+            IndexingData::MutateAccessor scopedAccessor{ indexing_data_.get() };
+            guessEncoding( encodingSamples, scopedAccessor, state );
+            scopedAccessor.setEncodingParameters( state.encodingParams );
+
+            // Timestamps are sampled by scanner threads with the format
+            // found at the beginning of file
+            if ( state.encodingParams.lineFeedWidth == 1 ) {
+                const auto& headSample = encodingSamples.front();
+                scopedAccessor.detectTimestampFormat( std::string_view(
+                    headSample.constData(), static_cast<size_t>( headSample.size() ) ) );
+            }
         }
-
-        state.encodingGuess = scopedAccessor.getEncodingGuess();
-        LOG_INFO << "Initial encoding "
-                 << ( state.fileTextCodec != nullptr ? state.fileTextCodec->name().toStdString()
-                                                     : std::string{ "auto" } );
     }
 
-    const auto& config = Configuration::get();
-    const auto prefetchBufferSize = static_cast<size_t>( config.indexReadBufferSizeMb() );
+    const auto prefetchBufferSize
+        = static_cast<size_t>( DeviceTuning::get().parameters( fileName_ ).indexReadBufferSizeMb );
 
     LOG_INFO << "Prefetch buffer " << readableSize( prefetchBufferSize * IndexingBlockSize );
 
     using namespace std::chrono;
     using clock = high_resolution_clock;
-    microseconds ioDuration{};
+    OperationStats stats;
+    stats.updatePeakMemory();
+
+    // Summed by scanner threads and the parser
+    std::atomic<int64_t> parseDurationUs{ 0 };
+
+    PipelineTrace trace( "indexing" );
+    std::atomic<int64_t> blocksInFlight{ 0 };
 
     const auto indexingStartTime = clock::now();
 
@@ -635,62 +1525,115 @@ void IndexOperation::doIndex( LineOffset initialPosition )
     auto blockPrefetcher = tbb::flow::limiter_node<BlockData>( indexingGraph, prefetchBufferSize );
     auto blockQueue = tbb::flow::queue_node<BlockData>( indexingGraph );
 
-    auto blockParser = tbb::flow::function_node<BlockData, tbb::flow::continue_msg>(
-        indexingGraph, tbb::flow::serial, [ this, &state ]( const BlockData& blockData ) {
-            indexNextBlock( state, blockData );
+    const auto encodingParams = state.encodingParams;
+
+    // Filters work on bytes of ASCII text, so multi-byte
+    // encodings are not supported
+    const auto buildTrigramFilter
+        = config.useTrigramIndex() && encodingParams.lineFeedWidth == 1;
+
+    state.splitLines = state.splitLines && encodingParams.lineFeedWidth == 1;
+
+    std::optional<TimestampParser> timestampParser;
+    if ( encodingParams.lineFeedWidth == 1 ) {
+        const auto timestampFormat
+            = IndexingData::ConstAccessor{ indexing_data_.get() }.getTimestampFormat();
+        if ( !timestampFormat.isEmpty() ) {
+            timestampParser.emplace( timestampFormat );
+        }
+    }
+
+    // Blocks are cached by their digests, lines are read
+    // from the cache only if blocks are hashed
+    std::optional<FileId> cachedFileId;
+    if ( state.hashBlocks && BlockCache::get().isEnabled() ) {
+        cachedFileId = FileId::getFileId( fileName_ );
+    }
+
+    auto blockScanner = tbb::flow::function_node<BlockData, ScannedBlock>(
+        indexingGraph, tbb::flow::unlimited,
+        [ this, encodingParams, hashBlocks = state.hashBlocks, buildTrigramFilter,
+          &timestampParser, &cachedFileId, &parseDurationUs, &trace ]( const BlockData& blockData ) {
+            const auto scanStartTime = clock::now();
+            auto scannedBlock = scanDataBlock( blockData, encodingParams, hashBlocks,
+                                               buildTrigramFilter, timestampParser );
+            if ( cachedFileId && scannedBlock.digest ) {
+                BlockCache::get().store(
+                    { *cachedFileId, blockData.beginning, *scannedBlock.digest }, blockData.data );
+            }
+            const auto scanEndTime = clock::now();
+            parseDurationUs += duration_cast<microseconds>( scanEndTime - scanStartTime ).count();
+            trace.addSpan( "scan", scanStartTime, scanEndTime );
+            return scannedBlock;
+        } );
+
+    auto blockSequencer = tbb::flow::sequencer_node<ScannedBlock>(
+        indexingGraph, []( const ScannedBlock& scannedBlock ) { return scannedBlock.block.index; } );
+
+    auto blockParser = tbb::flow::function_node<ScannedBlock, tbb::flow::continue_msg>(
+        indexingGraph, tbb::flow::serial,
+        [ this, &state, &stats, &parseDurationUs, &trace, &blocksInFlight, &nextCheckpoint,
+          checkpointInterval, lastModified ]( const ScannedBlock& scannedBlock ) {
+            const auto parseStartTime = clock::now();
+            indexNextBlock( state, scannedBlock );
+
+            const auto blockEnd = scannedBlock.block.beginning + scannedBlock.block.data.size();
+            if ( nextCheckpoint && blockEnd >= *nextCheckpoint && !interruptRequest_ ) {
+                saveCheckpoint( state, lastModified );
+                while ( *nextCheckpoint <= blockEnd ) {
+                    *nextCheckpoint += checkpointInterval;
+                }
+            }
+            const auto parseEndTime = clock::now();
+            parseDurationUs
+                += duration_cast<microseconds>( parseEndTime - parseStartTime ).count();
+            trace.addSpan( "parse", parseStartTime, parseEndTime );
+            trace.addCounter( "blocks in flight", --blocksInFlight );
+            stats.updatePeakMemory();
             return tbb::flow::continue_msg{};
         } );
 
     tbb::flow::make_edge( blockPrefetcher, blockQueue );
-    tbb::flow::make_edge( blockQueue, blockParser );
+    tbb::flow::make_edge( blockQueue, blockScanner );
+    tbb::flow::make_edge( blockScanner, blockSequencer );
+    tbb::flow::make_edge( blockSequencer, blockParser );
     tbb::flow::make_edge( blockParser, blockPrefetcher.decrementer() );
 
     file.seek( state.pos );
-    ioDuration = readFileInBlocks( file, blockPrefetcher );
+    readFileInBlocks( file, blockPrefetcher, stats, trace, blocksInFlight );
     indexingGraph.wait_for_all();
+    stats.parseDuration = microseconds( parseDurationUs.load() );
 
-    IndexingData::MutateAccessor scopedAccessor{ indexing_data_.get() };
+    // Decompressed size is only known after all data was read
+    if ( !interruptRequest_ && qobject_cast<QFile*>( &file ) == nullptr ) {
+        state.file_size = file.size();
+    }
 
     LOG_DEBUG << "Indexed up to " << state.pos;
 
-    // Check if there is a non LF terminated line at the end of the file
-    if ( !interruptRequest_ && state.file_size > state.pos ) {
-        LOG_WARNING << "Non LF terminated file, adding a fake end of line";
+    // Digests are computed before taking the lock to not block readers on IO
+    const auto digests = indexedPartDigests( file, file.pos() );
 
-        FastLinePositionArray line_position;
-        line_position.append( LineOffset( state.file_size + 1 ) );
-        line_position.setFakeFinalLF();
+    IndexingData::MutateAccessor scopedAccessor{ indexing_data_.get() };
 
-        scopedAccessor.addAll( {}, 0_length, line_position, state.encodingGuess );
+    if ( !interruptRequest_ ) {
+        addFakeFinalLineFeed( scopedAccessor, state );
     }
 
-    const auto endFilePos = file.pos();
-    file.reset();
-    QByteArray hashBuffer( IndexingBlockSize, Qt::Uninitialized );
-    const auto headerHashSize = file.read( hashBuffer.data(), hashBuffer.size() );
-    FileDigest fastHashDigest;
-    fastHashDigest.addData( hashBuffer.data(), static_cast<size_t>( headerHashSize ) );
-
-    scopedAccessor.setHeaderHash( fastHashDigest.digest(), headerHashSize );
-
-    if ( endFilePos <= hashBuffer.size() ) {
-        scopedAccessor.setTailHash( fastHashDigest.digest(), 0, headerHashSize );
-    }
-    else {
-        const auto tailHashOffset = endFilePos - hashBuffer.size();
-        file.seek( tailHashOffset );
-        const auto tailHashSize = file.read( hashBuffer.data(), hashBuffer.size() );
-        fastHashDigest.reset();
-        fastHashDigest.addData( hashBuffer.data(), static_cast<size_t>( tailHashSize ) );
-        scopedAccessor.setTailHash( fastHashDigest.digest(), tailHashOffset, tailHashSize );
-    }
+    scopedAccessor.setHeaderHash( digests.headerDigest, digests.headerSize );
+    scopedAccessor.setTailHash( digests.tailDigest, digests.tailOffset, digests.tailSize );
+    scopedAccessor.setLastModified( lastModified );
 
     const auto indexingEndTime = high_resolution_clock::now();
     const auto duration = duration_cast<microseconds>( indexingEndTime - indexingStartTime );
+    stats.duration = duration;
 
-    LOG_INFO << "Indexing done, took " << duration << ", io " << ioDuration;
+    LOG_INFO << "Indexing done, took " << duration << ", io " << stats.ioDuration << ", parsing "
+             << stats.parseDuration << ", waiting for parser " << stats.queueStallDuration;
     LOG_INFO << "Index size "
-             << readableSize( static_cast<uint64_t>( scopedAccessor.allocatedSize() ) );
+             << readableSize( static_cast<uint64_t>( scopedAccessor.allocatedSize() ) )
+             << ", resident "
+             << readableSize( static_cast<uint64_t>( scopedAccessor.residentSize() ) );
     LOG_INFO << "Indexed lines " << scopedAccessor.getNbLines();
     LOG_INFO << "Max line " << scopedAccessor.getMaxLength();
     LOG_INFO << "Indexing perf "
@@ -717,29 +1660,269 @@ void IndexOperation::doIndex( LineOffset initialPosition )
     if ( !scopedAccessor.getEncodingGuess() ) {
         scopedAccessor.setEncodingGuess( QTextCodec::codecForLocale() );
     }
+
+    return stats;
+}
+
+void IndexOperation::saveCheckpoint( const IndexingState& state, qint64 lastModified )
+{
+    const auto indexedSize = IndexingData::ConstAccessor{ indexing_data_.get() }.getIndexedSize();
+
+    QFile file( fileName_ );
+    if ( !file.open( QIODevice::ReadOnly ) ) {
+        return;
+    }
+    const auto digests = indexedPartDigests( file, indexedSize );
+
+    LOG_INFO << "Saving checkpoint of index of " << fileName_ << " at " << indexedSize;
+    {
+        // Next block replaces the fake line feed, the same way lines
+        // appended to a file without final line feed do
+        IndexingData::MutateAccessor scopedAccessor{ indexing_data_.get() };
+        auto checkpointState = state;
+        checkpointState.file_size = indexedSize;
+        addFakeFinalLineFeed( scopedAccessor, checkpointState );
+
+        scopedAccessor.setHeaderHash( digests.headerDigest, digests.headerSize );
+        scopedAccessor.setTailHash( digests.tailDigest, digests.tailOffset, digests.tailSize );
+        scopedAccessor.setLastModified( lastModified );
+    }
+
+    IndexCache( fileName_ ).save( IndexingData::ConstAccessor{ indexing_data_.get() } );
+}
+
+std::optional<OperationStats> IndexOperation::doIndexTail( QFile& file,
+                                                          LineOffset initialPosition )
+{
+    using namespace std::chrono;
+    using clock = high_resolution_clock;
+
+    const auto indexingStartTime = clock::now();
+    const auto lastModified = QFileInfo( fileName_ ).lastModified().toMSecsSinceEpoch();
+
+    // Header digest changes while the file is shorter than the header,
+    // larger appends are better read by the pipeline
+    const auto fileSize = file.size();
+    const auto appendedSize = fileSize - initialPosition.get();
+    if ( initialPosition.get() < IndexingBlockSize || appendedSize <= 0
+         || appendedSize > IndexingBlockSize ) {
+        return {};
+    }
+
+    auto state = initialState( initialPosition );
+    if ( !state.fileTextCodec || !state.encodingGuess ) {
+        return {};
+    }
+    state.file_size = fileSize;
+    state.encodingParams = EncodingParameters( state.fileTextCodec );
+    state.splitLines = state.splitLines && state.encodingParams.lineFeedWidth == 1;
+
+    OperationStats stats;
+
+    // Tail digest window always contains the appended bytes,
+    // so both are taken from a single read
+    const auto tailHashOffset = fileSize - IndexingBlockSize;
+    QByteArray tailData{ IndexingBlockSize, Qt::Uninitialized };
+    const auto ioStartTime = clock::now();
+    if ( !file.seek( tailHashOffset )
+         || file.read( tailData.data(), tailData.size() ) != tailData.size() ) {
+        LOG_WARNING << "Failed to read appended data of " << fileName_;
+        return {};
+    }
+    stats.ioDuration = duration_cast<microseconds>( clock::now() - ioStartTime );
+    stats.bytesRead = static_cast<uint64_t>( tailData.size() );
+
+    FileDigest fastHashDigest;
+    fastHashDigest.addData( tailData.data(), static_cast<size_t>( tailData.size() ) );
+    const auto tailDigest = fastHashDigest.digest();
+
+    const auto& config = Configuration::get();
+    const auto buildTrigramFilter
+        = config.useTrigramIndex() && state.encodingParams.lineFeedWidth == 1;
+
+    std::optional<TimestampParser> timestampParser;
+    if ( state.encodingParams.lineFeedWidth == 1 ) {
+        const auto timestampFormat
+            = IndexingData::ConstAccessor{ indexing_data_.get() }.getTimestampFormat();
+        if ( !timestampFormat.isEmpty() ) {
+            timestampParser.emplace( timestampFormat );
+        }
+    }
+
+    const auto parseStartTime = clock::now();
+    BlockData blockData{ 0, initialPosition.get(),
+                         tailData.mid( static_cast<int>( initialPosition.get() - tailHashOffset ) ) };
+    indexNextBlock( state, scanDataBlock( std::move( blockData ), state.encodingParams,
+                                          state.hashBlocks, buildTrigramFilter,
+                                          timestampParser ) );
+    stats.parseDuration = duration_cast<microseconds>( clock::now() - parseStartTime );
+
+    IndexingData::MutateAccessor scopedAccessor{ indexing_data_.get() };
+    addFakeFinalLineFeed( scopedAccessor, state );
+    scopedAccessor.setTailHash( tailDigest, tailHashOffset, tailData.size() );
+    scopedAccessor.setLastModified( lastModified );
+
+    if ( scopedAccessor.getMaxLength().get()
+         == std::numeric_limits<LineLength::UnderlyingType>::max() ) {
+        dispatchToMainThread( [] {
+            QMessageBox::critical( nullptr, "Klogg", "Can't index file: some lines are too long",
+                                   QMessageBox::Close );
+        } );
+
+        scopedAccessor.clear();
+    }
+
+    stats.duration = duration_cast<microseconds>( clock::now() - indexingStartTime );
+    LOG_INFO << "Indexed " << appendedSize << " appended bytes, took " << stats.duration;
+    LOG_INFO << "Indexed lines " << scopedAccessor.getNbLines();
+
+    return stats;
 }
 
 // Called in the worker thread's context
 OperationResult FullIndexOperation::run()
 {
+    // Data shown by views and searched while the new index is built
+    const auto liveData = indexing_data_;
     try {
         LOG_INFO << "FullIndexOperation::run(), file " << fileName_.toStdString();
 
+        const auto& config = Configuration::get();
+        const auto useIndexCache = config.useIndexCache() && config.fastModificationDetection();
+        const IndexCache indexCache( fileName_ );
+
+        // Index of the rotated file is kept, so it opens without reading it again
+        if ( useIndexCache && !rotatedFileName_.isEmpty() ) {
+            LOG_INFO << "Saving index of " << fileName_ << " for rotated file " << rotatedFileName_;
+            const IndexCache rotatedIndexCache( rotatedFileName_ );
+            rotatedIndexCache.save( IndexingData::ConstAccessor{ liveData.get() } );
+        }
+
+        // Unchanged beginning of the file is read before taking the lock,
+        // so readers are not blocked by the check
+        const auto keptSize = keepUnchangedPrefix_ ? unchangedPrefixSize() : 0;
+
+        // Size of the index is estimated before reading the whole file, storage
+        // of line positions is chosen by it. Seeking in compressed files or files
+        // decoded by plugins means decoding everything before the offset,
+        // so they are not sampled.
+        std::optional<IndexEstimate> estimate;
+        if ( !RemoteFile::isRemoteFile( fileName_ ) ) {
+            // Storage of the file is calibrated the first time a file on it is opened
+            DeviceTuning::get().calibrate( fileName_, interruptRequest_ );
+        }
+        if ( !GzipFile::isGzipFile( fileName_ ) && !RemoteFile::isRemoteFile( fileName_ )
+             && !PluginFile::findPlugin( fileName_ ) ) {
+            QFile file( fileName_ );
+            if ( file.open( QIODevice::ReadOnly ) ) {
+                const auto perLineIndexBytes
+                    = ( config.useLineLengthIndex() ? sizeof( uint8_t ) : 0 )
+                      + ( config.useLineHashIndex() ? sizeof( uint64_t ) : 0 );
+                estimate = IndexEstimate::sample( file, perLineIndexBytes );
+            }
+        }
+
+        // Index that can't be kept stays live until the new one is built
+        // in separate data, unless reindexing is meant to free its memory
+        // or the file got smaller than the indexed part
+        auto isPrefixKept = false;
+        auto keptLines = 0_lcount;
+        {
+            IndexingData::MutateAccessor scopedAccessor{ liveData.get() };
+            const auto linesBeforeKeptSize = scopedAccessor.getLineAtOffset(
+                static_cast<LineOffset::UnderlyingType>( keptSize ) );
+            if ( keptSize > 0 && scopedAccessor.getForcedEncoding() == forcedEncoding_
+                 && scopedAccessor.truncate( keptSize ) ) {
+                isPrefixKept = true;
+                keptLines = LinesCount( linesBeforeKeptSize.get() );
+            }
+            else if ( scopedAccessor.getNbLines() > 0_lcount
+                      && !( liveData->isSparseIndexPreferred()
+                            && !scopedAccessor.isSparseIndex() )
+                      && QFileInfo( fileName_ ).size() >= scopedAccessor.getIndexedSize() ) {
+                LOG_INFO << "Keeping old index of " << fileName_ << " until it is reindexed";
+                indexing_data_ = std::make_shared<IndexingData>();
+                if ( liveData->isSparseIndexPreferred() ) {
+                    indexing_data_->preferSparseIndex();
+                }
+            }
+        }
+        const auto isIndexStaged = indexing_data_ != liveData;
+
+        const IndexingInProgressGuard indexingGuard{ indexing_data_.get() };
         Q_EMIT indexingProgressed( 0 );
 
+        auto initialPosition = 0_offset;
         {
             IndexingData::MutateAccessor scopedAccessor{ indexing_data_.get() };
-            scopedAccessor.clear();
-            scopedAccessor.forceEncoding( forcedEncoding_ );
+            if ( isPrefixKept ) {
+                LOG_INFO << "Keeping index of the first " << keptSize << " bytes of "
+                         << fileName_;
+                initialPosition = LineOffset( keptSize );
+            }
+            else {
+                scopedAccessor.clear();
+                scopedAccessor.forceEncoding( forcedEncoding_ );
+
+                const auto sparseIndexMinSize
+                    = static_cast<qint64>( config.sparseIndexMinFileSizeMb() ) * 1024 * 1024;
+                const auto storage
+                    = estimate ? estimate->chooseStorage( liveData->getIndexMemoryLimit() )
+                               : IndexEstimate::Storage::Compressed;
+                if ( indexing_data_->isSparseIndexPreferred()
+                     || ( config.useSparseIndex()
+                          && QFileInfo( fileName_ ).size() >= sparseIndexMinSize )
+                     || storage == IndexEstimate::Storage::Sparse ) {
+                    LOG_INFO << "Using sparse index for " << fileName_;
+                    scopedAccessor.useSparseIndex();
+                }
+                else if ( storage == IndexEstimate::Storage::FileBacked
+                          && !config.useFileBackedIndex() ) {
+                    LOG_INFO << "Using file backed index for " << fileName_;
+                    scopedAccessor.useFileBackedIndex();
+                }
+
+                if ( estimate ) {
+                    estimate->storage = scopedAccessor.isSparseIndex()
+                                            ? IndexEstimate::Storage::Sparse
+                                            : storage;
+                }
+
+                // Index of attached analysis bundle is used whatever
+                // the settings of index cache are
+                if ( AnalysisBundle::loadAttachedIndex( fileName_, scopedAccessor )
+                     || ( useIndexCache && indexCache.load( scopedAccessor ) ) ) {
+                    initialPosition = LineOffset( scopedAccessor.getIndexedSize() );
+                }
+            }
         }
 
-        doIndex( 0_offset );
+        liveData->setIndexEstimate( estimate );
+
+        OperationStats stats;
+        WorkScheduler::get().execute( fileName_, [ this, initialPosition, &stats ] {
+            stats = doIndex( initialPosition );
+        } );
+        stats.keptLines = keptLines.get();
 
         LOG_INFO << "FullIndexOperation: ... finished, interrupt = "
                  << static_cast<bool>( interruptRequest_ );
 
+        // Interrupted index is dropped, the old one stays
+        if ( isIndexStaged ) {
+            const auto stagedData = std::exchange( indexing_data_, liveData );
+            if ( !interruptRequest_ ) {
+                IndexingData::MutateAccessor scopedAccessor{ liveData.get() };
+                scopedAccessor.replace( *stagedData );
+            }
+        }
+
+        if ( useIndexCache && !interruptRequest_ ) {
+            indexCache.save( IndexingData::ConstAccessor{ indexing_data_.get() } );
+        }
+
         const auto result = interruptRequest_ ? false : true;
-        Q_EMIT indexingFinished( result );
+        Q_EMIT indexingFinished( result, stats );
         return result;
     } catch ( const std::exception& err ) {
         const auto errorString = QString( "FullIndexOperation failed: %1" ).arg( err.what() );
@@ -748,16 +1931,55 @@ OperationResult FullIndexOperation::run()
             IssueReporter::askUserAndReportIssue( IssueTemplate::Exception, errorString );
         } );
 
+        indexing_data_ = liveData;
         {
             IndexingData::MutateAccessor scopedAccessor{ indexing_data_.get() };
             scopedAccessor.clear();
         }
 
-        Q_EMIT indexingFinished( false );
+        Q_EMIT indexingFinished( false, {} );
         return false;
     }
 }
 
+qint64 FullIndexOperation::unchangedPrefixSize() const
+{
+    const auto indexedHash = IndexingData::ConstAccessor{ indexing_data_.get() }.getHash();
+    if ( indexedHash.blockDigests.empty() ) {
+        return 0;
+    }
+
+    const auto fileDevice = makeLogFileDevice( fileName_ );
+    auto& file = *fileDevice;
+    if ( !file.open( QIODevice::ReadOnly ) ) {
+        return 0;
+    }
+
+    // Blocks are read in file order, so the check
+    // stops at the first block that was rewritten
+    QByteArray buffer{ IndexingBlockSize, Qt::Uninitialized };
+    qint64 unchangedSize = 0;
+    for ( const auto& block : indexedHash.blockDigests ) {
+        if ( interruptRequest_ || block.offset != unchangedSize ) {
+            break;
+        }
+
+        if ( block.size > buffer.size() ) {
+            buffer.resize( static_cast<int>( block.size ) );
+        }
+        if ( !file.seek( block.offset ) || file.read( buffer.data(), block.size ) != block.size
+             || FileDigest::blockDigest( buffer.constData(), static_cast<size_t>( block.size ) )
+                    != block.digest ) {
+            break;
+        }
+
+        unchangedSize += block.size;
+    }
+
+    LOG_INFO << "Unchanged " << unchangedSize << " of " << indexedHash.size << " indexed bytes";
+    return unchangedSize;
+}
+
 OperationResult PartialIndexOperation::run()
 {
     try {
@@ -768,16 +1990,25 @@ OperationResult PartialIndexOperation::run()
 
         LOG_INFO << "PartialIndexOperation: Starting the count at " << initialPosition << " ...";
 
+        const IndexingInProgressGuard indexingGuard{ indexing_data_.get() };
         Q_EMIT indexingProgressed( 0 );
 
-        doIndex( initialPosition );
+        // Appended lines of a followed file are read right away,
+        // they do not wait for the disk queue
+        auto stats = indexTail( initialPosition );
+        if ( !stats ) {
+            WorkScheduler::get().execute( fileName_, [ this, initialPosition, &stats ] {
+                stats = doIndex( initialPosition );
+            } );
+        }
 
         LOG_INFO << "PartialIndexOperation: ... finished counting.";
 
         const auto result = interruptRequest_ ? false : true;
-        Q_EMIT indexingFinished( result );
+        Q_EMIT indexingFinished( result, *stats );
         return result;
     } catch ( const std::exception& err ) {
+        tailFile_ = {};
         const auto errorString = QString( "PartialIndexOperation failed: %1" ).arg( err.what() );
         LOG_ERROR << errorString;
         dispatchToMainThread( [ errorString ]() {
@@ -789,11 +2020,38 @@ OperationResult PartialIndexOperation::run()
             scopedAccessor.clear();
         }
 
-        Q_EMIT indexingFinished( false );
+        Q_EMIT indexingFinished( false, {} );
         return false;
     }
 }
 
+std::optional<OperationStats> PartialIndexOperation::indexTail( LineOffset initialPosition )
+{
+    if ( GzipFile::isGzipFile( fileName_ ) || RemoteFile::isRemoteFile( fileName_ )
+         || PluginFile::findPlugin( fileName_ ) ) {
+        return {};
+    }
+
+    // File could be replaced by another one with the same name
+    const auto fileId = FileId::getFileId( fileName_ );
+    if ( !tailFile_.file || tailFile_.fileId != fileId ) {
+        tailFile_.file = openSharedFile( fileName_ );
+        tailFile_.fileId = fileId;
+    }
+
+    if ( !tailFile_.file ) {
+        return {};
+    }
+
+    auto stats = doIndexTail( *tailFile_.file, initialPosition );
+
+    if ( Configuration::get().keepFileClosed() ) {
+        tailFile_ = {};
+    }
+
+    return stats;
+}
+
 OperationResult CheckFileChangesOperation::run()
 {
     try {
@@ -817,25 +2075,27 @@ MonitoredFileStatus CheckFileChangesOperation::doCheckFileChanges()
 {
     QFileInfo info( fileName_ );
     const auto indexedHash = IndexingData::ConstAccessor{ indexing_data_.get() }.getHash();
-    const auto realFileSize = info.size();
+
+    const auto fileDevice = makeLogFileDevice( fileName_ );
+    auto& file = *fileDevice;
+    if ( !file.open( QIODevice::ReadOnly ) ) {
+        LOG_INFO << "File failed to open";
+        return MonitoredFileStatus::Truncated;
+    }
+
+    // Indexed size of compressed files is the size of decompressed data
+    const auto realFileSize = file.size();
 
     if ( realFileSize == 0 || realFileSize < indexedHash.size ) {
         LOG_INFO << "File truncated";
         return MonitoredFileStatus::Truncated;
     }
     else {
-        QFile file( fileName_ );
-
         QByteArray buffer{ IndexingBlockSize, Qt::Uninitialized };
 
         bool isFileModified = false;
         const auto& config = Configuration::get();
 
-        if ( !file.isOpen() && !file.open( QIODevice::ReadOnly ) ) {
-            LOG_INFO << "File failed to open";
-            return MonitoredFileStatus::Truncated;
-        }
-
         const auto getDigest = [ &file, &buffer ]( const qint64 indexedSize ) {
             FileDigest fileDigest;
             auto readSize = 0ll;
@@ -854,34 +2114,77 @@ MonitoredFileStatus CheckFileChangesOperation::doCheckFileChanges()
 
             return fileDigest.digest();
         };
-        if ( config.fastModificationDetection() ) {
+
+        const auto isHeaderOrTailModified = [ &file, &getDigest, &indexedHash ]() {
+            file.seek( 0 );
             const auto headerDigest = getDigest( indexedHash.headerSize );
 
             LOG_INFO << "indexed header xxhash " << indexedHash.headerDigest;
             LOG_INFO << "current header xxhash " << headerDigest << ", size "
                      << indexedHash.headerSize;
 
-            isFileModified = headerDigest != indexedHash.headerDigest;
-
-            if ( !isFileModified ) {
-                file.seek( indexedHash.tailOffset );
-                const auto tailDigest = getDigest( indexedHash.tailSize );
+            if ( headerDigest != indexedHash.headerDigest ) {
+                return true;
+            }
 
-                LOG_INFO << "indexed tail xxhash " << indexedHash.tailDigest;
-                LOG_INFO << "current tail xxhash " << tailDigest << ", size "
-                         << indexedHash.tailSize;
+            file.seek( indexedHash.tailOffset );
+            const auto tailDigest = getDigest( indexedHash.tailSize );
 
-                isFileModified = tailDigest != indexedHash.tailDigest;
-            }
-        }
-        else {
+            LOG_INFO << "indexed tail xxhash " << indexedHash.tailDigest;
+            LOG_INFO << "current tail xxhash " << tailDigest << ", size "
+                     << indexedHash.tailSize;
 
-            const auto realHashDigest = getDigest( indexedHash.size );
+            return tailDigest != indexedHash.tailDigest;
+        };
 
-            LOG_INFO << "indexed xxhash " << indexedHash.fullDigest;
-            LOG_INFO << "current xxhash " << realHashDigest;
+        const auto isSampleModified = [ &file, &getDigest, &indexedHash ]() {
+            return std::any_of( indexedHash.sampleDigests.begin(),
+                                indexedHash.sampleDigests.end(),
+                                [ &file, &getDigest ]( const auto& sample ) {
+                                    file.seek( sample.offset );
+                                    return getDigest( sample.size ) != sample.digest;
+                                } );
+        };
 
-            isFileModified = realHashDigest != indexedHash.fullDigest;
+        if ( config.fastModificationDetection() ) {
+            isFileModified = isHeaderOrTailModified();
+        }
+        else if ( realFileSize == indexedHash.size
+                  && info.lastModified().toMSecsSinceEpoch() == indexedHash.lastModified ) {
+            LOG_INFO << "File size and modification time unchanged";
+            return MonitoredFileStatus::Unchanged;
+        }
+        else if ( isHeaderOrTailModified() ) {
+            isFileModified = true;
+        }
+        else if ( realFileSize > indexedHash.size && !indexedHash.sampleDigests.empty() ) {
+            // Data was appended, samples of the indexed part are enough to tell
+            // that it was not rewritten
+            LOG_INFO << "Checking " << indexedHash.sampleDigests.size() << " sampled blocks";
+            isFileModified = isSampleModified();
+        }
+        else {
+            // Blocks are read in file order, so the check
+            // stops at the first block that was rewritten
+            LOG_INFO << "indexed xxhash " << indexedHash.fullDigest << ", checking "
+                     << indexedHash.blockDigests.size() << " blocks";
+
+            // File indexed without hashing can't be checked
+            const auto hashedSize = indexedHash.blockDigests.empty()
+                                        ? 0
+                                        : indexedHash.blockDigests.back().offset
+                                              + indexedHash.blockDigests.back().size;
+            isFileModified = hashedSize != indexedHash.size || std::any_of(
+                indexedHash.blockDigests.begin(), indexedHash.blockDigests.end(),
+                [ &file, &buffer ]( const auto& block ) {
+                    if ( !file.seek( block.offset )
+                         || file.read( buffer.data(), block.size ) != block.size ) {
+                        return true;
+                    }
+                    return FileDigest::blockDigest( buffer.constData(),
+                                                    static_cast<size_t>( block.size ) )
+                           != block.digest;
+                } );
         }
 
         if ( isFileModified ) {
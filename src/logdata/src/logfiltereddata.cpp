@@ -43,13 +43,17 @@
 #include "log.h"
 
 #include <KDSignalThrottler.h>
+#include <QDateTime>
+#include <QRegularExpression>
 #include <QString>
 #include <QTimer>
 
 #include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <cstdint>
 #include <functional>
+#include <iterator>
 #include <limits>
 #include <numeric>
 #include <tuple>
@@ -59,9 +63,92 @@
 #include "logdata.h"
 #include "logfiltereddata.h"
 
+#include "analysisbundle.h"
 #include "configuration.h"
+#include "persistentsearchcache.h"
 #include "readablesize.h"
 #include "synchronization.h"
+#include "timestampindex.h"
+
+namespace {
+
+// Filtered lines separated by at most so many lines are read from source together
+constexpr LinesCount::UnderlyingType MaxCoalescedLinesGap = 8;
+
+// Runs of close lines are read from source at once,
+// lines between matches are read too and dropped
+template <typename RunReader>
+void forEachSourceRun( const std::vector<LineNumber>& sourceLines, RunReader&& readRun )
+{
+    auto runStart = sourceLines.cbegin();
+    while ( runStart != sourceLines.cend() ) {
+        auto runEnd = std::next( runStart );
+        while ( runEnd != sourceLines.cend()
+                && ( *runEnd - *std::prev( runEnd ) ).get() <= MaxCoalescedLinesGap + 1 ) {
+            ++runEnd;
+        }
+
+        readRun( runStart, runEnd );
+        runStart = runEnd;
+    }
+}
+
+// Longest of more marks or context lines is not looked for,
+// the longest line of file is used
+constexpr uint64_t MaxMeasuredMarks = 10000;
+
+// Text that regular expression matches literally
+bool isLiteralRegex( const QString& pattern )
+{
+    static const QString metaCharacters = QStringLiteral( "\\.^$|?*+()[]{}" );
+    return std::none_of( pattern.begin(), pattern.end(),
+                         []( QChar c ) { return metaCharacters.contains( c ); } );
+}
+
+// Boolean expression that is a conjunction, possibly of negated terms
+bool isConjunction( QString expression )
+{
+    static const QRegularExpression quotedPattern( R"("(?:[^"\\]|\\.)*")" );
+    static const QRegularExpression conjunction( R"(^(and|not|[ ()]|p)+$)" );
+    expression.replace( quotedPattern, "p" );
+    return conjunction.match( expression ).hasMatch();
+}
+
+// Returns true if every line matching nextPattern also matches previousPattern,
+// for example when text is added to a plain text pattern or a new condition
+// is added with "and" to a boolean expression.
+bool isRefinedPattern( const RegularExpressionPattern& previousPattern,
+                       const RegularExpressionPattern& nextPattern )
+{
+    if ( previousPattern.pattern.isEmpty() || previousPattern.isExclude || nextPattern.isExclude
+         || previousPattern.isCaseSensitive != nextPattern.isCaseSensitive
+         || previousPattern.isBoolean != nextPattern.isBoolean
+         || previousPattern.isPlainText != nextPattern.isPlainText ) {
+        return false;
+    }
+
+    if ( nextPattern.isBoolean ) {
+        if ( !nextPattern.pattern.startsWith( previousPattern.pattern ) ) {
+            return false;
+        }
+
+        static const QRegularExpression andOperator( R"(^\s*and[ ("])" );
+        const auto addedCondition = nextPattern.pattern.mid( previousPattern.pattern.size() );
+        return andOperator.match( addedCondition ).hasMatch()
+               && isConjunction( nextPattern.pattern );
+    }
+
+    if ( !nextPattern.isPlainText
+         && !( isLiteralRegex( previousPattern.pattern )
+               && isLiteralRegex( nextPattern.pattern ) ) ) {
+        return false;
+    }
+
+    return nextPattern.pattern.size() > previousPattern.pattern.size()
+           && nextPattern.pattern.contains( previousPattern.pattern );
+}
+
+} // namespace
 
 // Usual constructor: just copy the data, the search is started by runSearch()
 LogFilteredData::LogFilteredData( const LogData* logData )
@@ -70,6 +157,8 @@ LogFilteredData::LogFilteredData( const LogData* logData )
     , currentRegExp_()
     , visibility_()
     , workerThread_( *logData )
+    , prerunWorker_( *logData )
+    , countWorker_( *logData )
 {
     // Starts with an empty result list
     maxLength_ = 0_length;
@@ -83,6 +172,19 @@ LogFilteredData::LogFilteredData( const LogData* logData )
     // Forward the update signal
     connect( &workerThread_, &LogFilteredDataWorker::searchProgressed, this,
              &LogFilteredData::handleSearchProgressed );
+    connect( &workerThread_, &LogFilteredDataWorker::searchFinished, this,
+             &LogFilteredData::handleSearchFinished );
+    connect( &workerThread_, &LogFilteredDataWorker::searchEstimated, this,
+             &LogFilteredData::handleSearchEstimated );
+    connect( &prerunWorker_, &LogFilteredDataWorker::searchProgressed, this,
+             &LogFilteredData::handlePrerunProgressed );
+    connect( &countWorker_, &LogFilteredDataWorker::searchProgressed, this,
+             &LogFilteredData::handleCountProgressed );
+
+    // Cached results are extended when the file grows, so when its
+    // indexed part changes they are cut to the lines reindexing kept
+    connect( logData, &LogData::fileChanged, this, &LogFilteredData::handleFileChanged );
+    connect( logData, &LogData::loadingFinished, this, &LogFilteredData::handleLoadingFinished );
 
     searchProgressThrottler_.setTimeout( 100 );
     connect( this, &LogFilteredData::searchProgressedThrottled, &searchProgressThrottler_,
@@ -90,6 +192,13 @@ LogFilteredData::LogFilteredData( const LogData* logData )
 
     connect( &searchProgressThrottler_, &KDToolBox::KDGenericSignalThrottler::triggered, this,
              &LogFilteredData::handleSearchProgressedThrottled );
+
+    MemoryGovernor::get().addConsumer( this );
+}
+
+LogFilteredData::~LogFilteredData()
+{
+    MemoryGovernor::get().removeConsumer( this );
 }
 
 void LogFilteredData::runSearch( const RegularExpressionPattern& regExp )
@@ -99,7 +208,10 @@ void LogFilteredData::runSearch( const RegularExpressionPattern& regExp )
 
 // Run the search and send newDataAvailable() signals.
 void LogFilteredData::runSearch( const RegularExpressionPattern& regExp, LineNumber startLine,
-                                 LineNumber endLine )
+                                 LineNumber endLine,
+                                 const std::vector<RegularExpressionPattern>& additionalPatterns,
+                                 std::shared_ptr<const RegularExpression> compiledExpression,
+                                 OptionalLineNumber focusLine )
 {
     LOG_DEBUG << "Entering runSearch";
 
@@ -107,40 +219,318 @@ void LogFilteredData::runSearch( const RegularExpressionPattern& regExp, LineNum
 
     clearSearch();
     currentRegExp_ = regExp;
-    currentSearchKey_ = makeCacheKey( regExp, startLine, endLine );
+    contextLines_ = LinesCount( static_cast<LinesCount::UnderlyingType>(
+        std::max( 0, config.searchContextLines() ) ) );
+
+    // Results of searches by entries depend on entry start pattern,
+    // they are not cached and not refined
+    const auto isEntrySearch = !config.searchEntryStartPattern().isEmpty();
+    const auto useSearchResultsCache = config.useSearchResultsCache() && !isEntrySearch;
+    currentSearchKey_
+        = isEntrySearch ? SearchCacheKey{} : makeCacheKey( regExp, startLine, endLine );
+
+    if ( useSearchResultsCache ) {
+        loadAttachedSearchResults();
+    }
+    if ( useSearchResultsCache && config.usePersistentSearchCache() ) {
+        loadPersistentSearchCache();
+    }
     LOG_INFO << "Search cache key: " << regExp.pattern << "_" << startLine.get() << "_"
              << endLine.get();
 
+    // Results of additional patterns are useful only for the cache
+    if ( useSearchResultsCache ) {
+        std::copy_if( additionalPatterns.begin(), additionalPatterns.end(),
+                      std::back_inserter( additionalPatterns_ ),
+                      [ this, startLine, endLine ]( const auto& pattern ) {
+                          const auto cacheKey = makeCacheKey( pattern, startLine, endLine );
+                          return cacheKey != currentSearchKey_
+                                 && searchResultsCache_.count( cacheKey ) == 0;
+                      } );
+    }
+
     bool shouldRunSearch = true;
-    if ( config.useSearchResultsCache() ) {
+    if ( useSearchResultsCache && additionalPatterns_.empty() ) {
         const auto cachedResults = searchResultsCache_.find( currentSearchKey_ );
         if ( cachedResults != std::end( searchResultsCache_ ) ) {
             LOG_INFO << "Got result from cache";
             shouldRunSearch = false;
-            matching_lines_ = cachedResults->second.matching_lines;
+            cachedResults->second.lastUsed = QDateTime::currentMSecsSinceEpoch();
+            matching_lines_ = cachedResults->second.matching_lines.thaw();
             maxLength_ = cachedResults->second.maxLength;
+            lastCompletedSearch_ = { currentSearchKey_, cachedResults->second };
 
             marks_and_matches_ = matching_lines_ | marks_;
+            updateContextLines();
+            resetLineCursor();
 
             Q_EMIT searchProgressed( LinesCount( matching_lines_.cardinality() ), 100, startLine );
         }
     }
 
-    if ( shouldRunSearch ) {
+    // Results of the same search made before the file has grown
+    // are shown at once, only lines added since then are searched
+    if ( shouldRunSearch && useSearchResultsCache && additionalPatterns_.empty() ) {
+        auto prefixResults = std::end( searchResultsCache_ );
+        for ( auto cachedResult = std::begin( searchResultsCache_ );
+              cachedResult != std::end( searchResultsCache_ ); ++cachedResult ) {
+            const auto& cacheKey = cachedResult->first;
+            if ( std::get<0>( cacheKey ) == regExp && std::get<1>( cacheKey ) == startLine.get()
+                 && std::get<2>( cacheKey ) > startLine.get()
+                 && std::get<2>( cacheKey ) < endLine.get()
+                 && ( prefixResults == std::end( searchResultsCache_ )
+                      || std::get<2>( cacheKey ) > std::get<2>( prefixResults->first ) ) ) {
+                prefixResults = cachedResult;
+            }
+        }
+
+        if ( prefixResults != std::end( searchResultsCache_ ) ) {
+            const auto cachedEnd = getExpectedSearchEnd( prefixResults->first );
+            LOG_INFO << "Extending cached result up to line " << cachedEnd.get();
+            shouldRunSearch = false;
+            prefixResults->second.lastUsed = QDateTime::currentMSecsSinceEpoch();
+            matching_lines_ = prefixResults->second.matching_lines.thaw();
+            maxLength_ = prefixResults->second.maxLength;
+
+            // Last cached line is searched again, it could have been incomplete
+            matching_lines_.remove( cachedEnd.get() - 1 );
+            nbLinesProcessed_ = LinesCount( cachedEnd.get() - 1 );
+
+            marks_and_matches_ = matching_lines_ | marks_;
+            updateContextLines();
+            resetLineCursor();
+
+            const auto progress = static_cast<int>( ( nbLinesProcessed_.get() - startLine.get() )
+                                                    * 100 / ( endLine.get() - startLine.get() ) );
+            Q_EMIT searchProgressed( LinesCount( matching_lines_.cardinality() ), progress,
+                                     startLine );
+
+            attachReader();
+            isSearching_ = true;
+            workerThread_.extendSearch( currentRegExp_, startLine, endLine, cachedEnd,
+                                        maxLength_ );
+        }
+    }
+
+    const auto canRefineSearch = shouldRunSearch && !isEntrySearch && additionalPatterns_.empty();
+    const auto isRefinedSearch = [ &regExp, startLine, endLine ]( const SearchCacheKey& key ) {
+        return std::get<1>( key ) == startLine.get() && std::get<2>( key ) == endLine.get()
+               && isRefinedPattern( std::get<0>( key ), regExp );
+    };
+    const auto refinesCompletedSearch
+        = canRefineSearch && lastCompletedSearch_ && isRefinedSearch( lastCompletedSearch_->first );
+    // Interrupted search for the same pattern is resumed the same way
+    const auto refinesInterruptedSearch
+        = canRefineSearch && interruptedSearch_
+          && ( interruptedSearch_->first == currentSearchKey_
+               || isRefinedSearch( interruptedSearch_->first ) );
+
+    if ( refinesCompletedSearch || refinesInterruptedSearch ) {
+        SearchResultArray previousMatches;
+        if ( refinesCompletedSearch ) {
+            LOG_INFO << "Refining previous search for "
+                     << std::get<0>( lastCompletedSearch_->first ).pattern;
+            previousMatches = lastCompletedSearch_->second.matching_lines.thaw();
+        }
+        if ( refinesInterruptedSearch ) {
+            LOG_INFO << "Refining interrupted search for "
+                     << std::get<0>( interruptedSearch_->first ).pattern;
+            if ( refinesCompletedSearch ) {
+                previousMatches &= interruptedSearch_->second;
+            }
+            else {
+                previousMatches = interruptedSearch_->second;
+            }
+        }
+        attachReader();
+        isSearching_ = true;
+        workerThread_.refineSearch( currentRegExp_, startLine, endLine,
+                                    std::move( previousMatches ) );
+    }
+    else if ( shouldRunSearch ) {
+        // Cached results of quoted patterns of a boolean search are
+        // combined by the search planner instead of matching them again
+        PatternSearchResults termResults;
+        if ( useSearchResultsCache && regExp.isBoolean ) {
+            for ( const auto& [ cacheKey, cachedResult ] : searchResultsCache_ ) {
+                const auto& cachedPattern = std::get<0>( cacheKey );
+                const auto quotedPattern = QString( "\"%1\"" ).arg( cachedPattern.pattern );
+                if ( std::get<1>( cacheKey ) == startLine.get()
+                     && std::get<2>( cacheKey ) == endLine.get() && !cachedPattern.isBoolean
+                     && !cachedPattern.isExclude && regExp.pattern.contains( quotedPattern ) ) {
+                    termResults.emplace_back( cachedPattern, cachedResult.matching_lines.thaw() );
+                }
+            }
+        }
+
         attachReader();
-        workerThread_.search( currentRegExp_, startLine, endLine );
+        isSearching_ = true;
+        workerThread_.search( currentRegExp_, startLine, endLine, false, additionalPatterns_,
+                              std::move( compiledExpression ), focusLine,
+                              std::move( termResults ) );
+    }
+}
+
+void LogFilteredData::runSearchWhileIndexing( const RegularExpressionPattern& regExp )
+{
+    LOG_DEBUG << "Entering runSearchWhileIndexing";
+
+    clearSearch();
+    currentRegExp_ = regExp;
+    currentSearchKey_ = {};
+    contextLines_ = LinesCount( static_cast<LinesCount::UnderlyingType>(
+        std::max( 0, Configuration::get().searchContextLines() ) ) );
+
+    attachReader();
+    isSearching_ = true;
+    workerThread_.search( currentRegExp_, 0_lnum, maxValue<LineNumber>(), true );
+}
+
+void LogFilteredData::runBoundedSearch( const RegularExpressionPattern& regExp,
+                                        SearchLimit limit )
+{
+    LOG_DEBUG << "Entering runBoundedSearch";
+
+    clearSearch();
+    currentRegExp_ = regExp;
+    currentSearchKey_ = {};
+    searchLimit_ = limit;
+    contextLines_ = LinesCount( static_cast<LinesCount::UnderlyingType>(
+        std::max( 0, Configuration::get().searchContextLines() ) ) );
+
+    attachReader();
+    isSearching_ = true;
+    workerThread_.search( currentRegExp_, 0_lnum, LineNumber( getNbTotalLines().get() ), false,
+                          {}, {}, {}, {}, limit );
+}
+
+void LogFilteredData::runFilterChain( const std::vector<RegularExpressionPattern>& stages )
+{
+    LOG_DEBUG << "Entering runFilterChain";
+
+    clearSearch();
+    if ( stages.empty() ) {
+        return;
+    }
+
+    const auto endLine = LineNumber( getNbTotalLines().get() );
+    if ( endLine != filterStagesEndLine_ ) {
+        filterStages_.clear();
+        filterStagesEndLine_ = endLine;
+    }
+
+    // Last stage is searched again to show its results
+    auto keptStages = 0u;
+    while ( keptStages < filterStages_.size() && keptStages + 1 < stages.size()
+            && filterStages_[ keptStages ].pattern == stages[ keptStages ] ) {
+        ++keptStages;
+    }
+    filterStages_.resize( keptStages );
+
+    LOG_INFO << "Running filter chain of " << stages.size() << " stages, " << keptStages
+             << " stages are cached";
+
+    currentRegExp_ = stages.back();
+    currentSearchKey_ = {};
+    filterChain_ = stages;
+    contextLines_ = LinesCount( static_cast<LinesCount::UnderlyingType>(
+        std::max( 0, Configuration::get().searchContextLines() ) ) );
+
+    auto scope = filterStages_.empty()
+                     ? std::optional<SearchResultArray>{}
+                     : std::optional<SearchResultArray>{ filterStages_.back().matches.thaw() };
+
+    attachReader();
+    isSearching_ = true;
+    workerThread_.runFilterChain( { stages.begin() + keptStages, stages.end() }, 0_lnum, endLine,
+                                  std::move( scope ) );
+}
+
+void LogFilteredData::cacheFilterStages()
+{
+    auto stageMatches = workerThread_.getFilterStageMatches();
+
+    // Interrupted chain has not processed all lines
+    if ( nbLinesProcessed_.get() != filterStagesEndLine_.get() ) {
+        return;
+    }
+
+    for ( auto& matches : stageMatches ) {
+        if ( filterStages_.size() + 1 >= filterChain_.size() ) {
+            break;
+        }
+        filterStages_.push_back(
+            { filterChain_[ filterStages_.size() ], FrozenSearchResults( std::move( matches ) ) } );
+    }
+
+    if ( filterStages_.size() + 1 == filterChain_.size() ) {
+        filterStages_.push_back( { filterChain_.back(), FrozenSearchResults( matching_lines_ ) } );
+    }
+}
+
+void LogFilteredData::prerunSearches( const std::vector<RegularExpressionPattern>& patterns )
+{
+    // Results of the running background search would be mixed with the new one
+    const auto& config = Configuration::get();
+    if ( !config.useSearchResultsCache() || !config.searchEntryStartPattern().isEmpty()
+         || !prerunPatterns_.empty() ) {
+        return;
+    }
+
+    loadAttachedSearchResults();
+    if ( config.usePersistentSearchCache() ) {
+        loadPersistentSearchCache();
     }
+
+    const auto endLine = LineNumber( sourceLogData_->getNbLine().get() );
+    std::vector<RegularExpressionPattern> uncachedPatterns;
+    std::copy_if( patterns.begin(), patterns.end(), std::back_inserter( uncachedPatterns ),
+                  [ this, endLine ]( const auto& pattern ) {
+                      return !pattern.pattern.isEmpty()
+                             && searchResultsCache_.count(
+                                    makeCacheKey( pattern, 0_lnum, endLine ) )
+                                    == 0;
+                  } );
+    if ( uncachedPatterns.empty() ) {
+        return;
+    }
+
+    LOG_INFO << "Searching " << uncachedPatterns.size() << " patterns in the background";
+
+    prerunPatterns_ = uncachedPatterns;
+    prerunEndLine_ = endLine;
+    prerunMatches_ = {};
+    prerunWorker_.prerunSearch( uncachedPatterns, 0_lnum, endLine );
+}
+
+void LogFilteredData::countMatches( const RegularExpressionPattern& regExp )
+{
+    LOG_INFO << "Counting matches of " << regExp.pattern;
+    countWorker_.interrupt();
+    countWorker_.countMatches( regExp, 0_lnum, LineNumber( sourceLogData_->getNbLine().get() ) );
 }
 
 void LogFilteredData::updateSearch( LineNumber startLine, LineNumber endLine )
 {
     LOG_DEBUG << "Entering updateSearch";
 
+    // Matches in added lines would be past the limit,
+    // added lines of a filter chain would have to pass all of its stages
+    if ( searchLimit_ || !filterChain_.empty() ) {
+        return;
+    }
+
     currentSearchKey_ = {};
 
     attachReader();
-    workerThread_.updateSearch( currentRegExp_, startLine, endLine,
-                                LineNumber( nbLinesProcessed_.get() ) );
+    if ( workerThread_.updateSearch( currentRegExp_, startLine, endLine,
+                                     LineNumber( nbLinesProcessed_.get() ) ) ) {
+        isSearching_ = true;
+    }
+    else {
+        // Lines are searched by the update that has not started yet
+        detachReader();
+    }
 }
 
 void LogFilteredData::interruptSearch()
@@ -154,15 +544,134 @@ void LogFilteredData::clearSearch( bool dropCache )
 {
     interruptSearch();
 
+    // Keep what the unfinished search has found so far
+    const auto searchStart = std::get<1>( currentSearchKey_ );
+    const auto searchEnd = getExpectedSearchEnd( currentSearchKey_ ).get();
+    if ( currentSearchKey_ != SearchCacheKey{} && !hasCombinedResults_
+         && nbLinesProcessed_.get() > searchStart && nbLinesProcessed_.get() < searchEnd ) {
+        auto remainingLines = matching_lines_;
+        remainingLines.addRange( nbLinesProcessed_.get(), searchEnd );
+        interruptedSearch_ = { currentSearchKey_, std::move( remainingLines ) };
+    }
+
     currentRegExp_ = {};
+    additionalPatterns_.clear();
+    hasCombinedResults_ = false;
+    isSearching_ = false;
     matching_lines_ = {};
     marks_and_matches_ = marks_;
+    updateContextLines();
+    resetLineCursor();
+    newMatches_ = {};
     maxLength_ = 0_length;
     nbLinesProcessed_ = 0_lcount;
+    searchStats_ = {};
+    searchEstimate_.reset();
+    searchLimit_.reset();
+    filterChain_.clear();
 
     if ( dropCache ) {
         searchResultsCache_.clear();
+        lastCompletedSearch_.reset();
+        interruptedSearch_.reset();
+        isPersistentCacheLoaded_ = false;
+    }
+}
+
+bool LogFilteredData::combineWithCachedSearch( const RegularExpressionPattern& regExp,
+                                               SearchCombination combination )
+{
+    if ( currentSearchKey_ == SearchCacheKey{}
+         || nbLinesProcessed_.get() != getExpectedSearchEnd( currentSearchKey_ ).get() ) {
+        LOG_INFO << "Search is not finished, can't combine results";
+        return false;
+    }
+
+    const auto cacheKey = makeCacheKey( regExp, LineNumber( std::get<1>( currentSearchKey_ ) ),
+                                        getExpectedSearchEnd( currentSearchKey_ ) );
+    const auto cachedResults = searchResultsCache_.find( cacheKey );
+    if ( cachedResults == std::end( searchResultsCache_ ) ) {
+        LOG_INFO << "No cached results for " << regExp.pattern;
+        return false;
+    }
+
+    cachedResults->second.lastUsed = QDateTime::currentMSecsSinceEpoch();
+    const auto otherMatches = cachedResults->second.matching_lines.thaw();
+
+    switch ( combination ) {
+    case SearchCombination::Union:
+        matching_lines_ |= otherMatches;
+        maxLength_ = qMax( maxLength_, cachedResults->second.maxLength );
+        break;
+    case SearchCombination::Intersection:
+        matching_lines_ &= otherMatches;
+        break;
+    case SearchCombination::Difference:
+        matching_lines_ -= otherMatches;
+        break;
+    }
+
+    marks_and_matches_ = matching_lines_ | marks_;
+    updateContextLines();
+    resetLineCursor();
+    hasCombinedResults_ = true;
+    lastCompletedSearch_.reset();
+
+    LOG_INFO << "Combined search results with " << regExp.pattern << ", "
+             << matching_lines_.cardinality() << " matches";
+
+    Q_EMIT searchProgressed( LinesCount( matching_lines_.cardinality() ), 100,
+                             LineNumber( std::get<1>( currentSearchKey_ ) ) );
+    return true;
+}
+
+void LogFilteredData::showLines( const SearchResultArray& lines )
+{
+    clearSearch();
+    currentSearchKey_ = {};
+
+    matching_lines_ = lines;
+    maxLength_ = measureLines( matching_lines_ );
+    marks_and_matches_ = matching_lines_ | marks_;
+    updateContextLines();
+    resetLineCursor();
+    hasCombinedResults_ = true;
+
+    LOG_INFO << "Showing " << matching_lines_.cardinality() << " lines without search";
+
+    Q_EMIT searchProgressed( LinesCount( matching_lines_.cardinality() ), 100, 0_lnum );
+}
+
+std::optional<std::pair<SearchResultArray, LineNumber>>
+LogFilteredData::getCachedMatches( const QRegularExpression& regexp ) const
+{
+    const auto isSameSearch = [ &regexp ]( const SearchCacheKey& cacheKey ) {
+        const auto& pattern = std::get<0>( cacheKey );
+        if ( pattern.isExclude || pattern.isBoolean || std::get<1>( cacheKey ) != 0 ) {
+            return false;
+        }
+
+        const auto searchRegexp = static_cast<QRegularExpression>( pattern );
+        return searchRegexp.pattern() == regexp.pattern()
+               && searchRegexp.patternOptions().testFlag(
+                      QRegularExpression::CaseInsensitiveOption )
+                      == regexp.patternOptions().testFlag(
+                          QRegularExpression::CaseInsensitiveOption );
+    };
+
+    if ( lastCompletedSearch_ && isSameSearch( lastCompletedSearch_->first ) ) {
+        return std::make_pair( lastCompletedSearch_->second.matching_lines.thaw(),
+                               getExpectedSearchEnd( lastCompletedSearch_->first ) );
     }
+
+    for ( const auto& [ cacheKey, cachedResult ] : searchResultsCache_ ) {
+        if ( isSameSearch( cacheKey ) ) {
+            return std::make_pair( cachedResult.matching_lines.thaw(),
+                                   getExpectedSearchEnd( cacheKey ) );
+        }
+    }
+
+    return {};
 }
 
 LineNumber LogFilteredData::getMatchingLineNumber( LineNumber matchNum ) const
@@ -211,183 +720,664 @@ LogFilteredData::LineType LogFilteredData::lineTypeByLine( LineNumber lineNumber
     if ( isLineMatched( lineNumber ) )
         line_type |= LineTypeFlags::Match;
 
-    return line_type;
-}
+    if ( isShowingContext() && context_lines_.contains( lineNumber.get() ) )
+        line_type |= LineTypeFlags::Context;
 
-void LogFilteredData::iterateOverLines( const std::function<void( LineNumber )>& callback ) const
-{
-    using CallbackFn = std::function<void( LineNumber )>;
-    const auto& currentResults = currentResultArray();
-    currentResults.iterate(
-        []( uint64_t line, void* context ) -> bool {
-            auto* callbackFn = static_cast<CallbackFn*>( context );
-            callbackFn->operator()( LineNumber( line ) );
-            return true;
-        },
-        static_cast<void*>( const_cast<CallbackFn*>( &callback ) ) );
-}
+    if ( !line_type && recordLines_ && recordLines_->contains( lineNumber.get() ) )
+        line_type |= LineTypeFlags::Context;
 
-// Delegation to our Marks object
+    return line_type;
+}
 
-void LogFilteredData::toggleMark( LineNumber line )
+std::pair<LinesCount, LinesCount> LogFilteredData::countLinesBefore( LineNumber line ) const
 {
-    if ( ( line >= 0_lnum ) && line < sourceLogData_->getNbLine() ) {
-        if ( !marks_.addChecked( line.get() ) ) {
-            marks_.remove( line.get() );
-            updateMaxLengthMarks( {}, line );
-        }
-        else {
-            updateMaxLengthMarks( line, {} );
-        }
+    if ( line == 0_lnum ) {
+        return { 0_lcount, 0_lcount };
     }
-    else {
-        LOG_ERROR << "LogFilteredData::toggleMark trying to toggle a mark outside of the file.";
-    }
-}
 
-void LogFilteredData::addMark( LineNumber line )
-{
-    if ( ( line >= 0_lnum ) && line < sourceLogData_->getNbLine() ) {
-        marks_.add( line.get() );
-        updateMaxLengthMarks( line, {} );
+    const auto lastLine = line.get() - 1;
+    if ( !visibility_.testFlag( VisibilityFlags::Matches ) ) {
+        return { 0_lcount, LinesCount( marks_.rank( lastLine ) ) };
     }
-    else {
-        LOG_ERROR << "LogFilteredData::addMark trying to create a mark outside of the file.";
+
+    const auto matches = LinesCount( matching_lines_.rank( lastLine ) );
+    if ( !visibility_.testFlag( VisibilityFlags::Marks ) ) {
+        return { matches, 0_lcount };
     }
+
+    return { matches, LinesCount( marks_and_matches_.rank( lastLine ) ) - matches };
 }
 
-bool LogFilteredData::isLineMarked( LineNumber line ) const
+std::pair<std::vector<uint64_t>, std::vector<uint64_t>>
+LogFilteredData::countLinesBetween( const std::vector<LineNumber>& boundaries ) const
 {
-    return marks_.contains( line.get() );
+    const auto countBefore = []( const SearchResultArray& lines, LineNumber line ) {
+        return line == 0_lnum ? uint64_t{ 0 } : lines.rank( line.get() - 1 );
+    };
+
+    std::vector<uint64_t> matches;
+    std::vector<uint64_t> marks;
+    for ( auto i = 1u; i < boundaries.size(); ++i ) {
+        matches.push_back( countBefore( matching_lines_, boundaries[ i ] )
+                           - countBefore( matching_lines_, boundaries[ i - 1 ] ) );
+        marks.push_back( countBefore( marks_, boundaries[ i ] )
+                         - countBefore( marks_, boundaries[ i - 1 ] ) );
+    }
+    return { std::move( matches ), std::move( marks ) };
 }
 
-OptionalLineNumber LogFilteredData::getMarkAfter( LineNumber line ) const
+LogFilteredData::NewMatches LogFilteredData::takeNewMatches() const
 {
-    OptionalLineNumber marked_line;
-    const LineNumber::UnderlyingType rank = marks_.rank( line.get() );
-    LineNumber::UnderlyingType nextMark;
-    if ( marks_.select( rank, &nextMark ) ) {
-        marked_line = LineNumber( nextMark );
+    NewMatches newMatches;
+    if ( !visibility_.testFlag( VisibilityFlags::Matches ) ) {
+        newMatches_ = {};
+        return newMatches;
     }
 
-    return marked_line;
+    newMatches.matches = std::exchange( newMatches_, {} );
+    if ( visibility_.testFlag( VisibilityFlags::Marks ) ) {
+        newMatches.marked = newMatches.matches & marks_;
+    }
+    return newMatches;
 }
 
-OptionalLineNumber LogFilteredData::getMarkBefore( LineNumber line ) const
+LinesCount LogFilteredData::getEstimatedMatches( LineNumber begin, LineNumber end ) const
 {
-    OptionalLineNumber marked_line;
-
-    const LineNumber::UnderlyingType rank = marks_.rank( line.get() );
+    if ( !searchEstimate_ || searchEstimate_->density.empty()
+         || !visibility_.testFlag( VisibilityFlags::Matches ) ) {
+        return 0_lcount;
+    }
 
-    if ( rank < 2 ) {
-        return marked_line;
+    const auto& estimate = *searchEstimate_;
+    begin = qMax( begin, qMax( estimate.startLine, LineNumber( nbLinesProcessed_.get() ) ) );
+    end = qMin( end, estimate.endLine );
+    if ( begin >= end ) {
+        return 0_lcount;
     }
 
-    LineNumber::UnderlyingType nextMark;
-    if ( marks_.select( rank - 2, &nextMark ) ) {
-        marked_line = LineNumber( nextMark );
+    // Lines of the range are counted by density of each part they are in
+    const auto partLines = static_cast<double>( ( estimate.endLine - estimate.startLine ).get() )
+                           / static_cast<double>( estimate.density.size() );
+    const auto lastLine = static_cast<double>( ( end - estimate.startLine ).get() );
+    auto line = static_cast<double>( ( begin - estimate.startLine ).get() );
+    double matches = 0;
+    while ( line < lastLine ) {
+        const auto part
+            = qMin( static_cast<size_t>( line / partLines ), estimate.density.size() - 1 );
+        const auto partEnd = qMin( lastLine, static_cast<double>( part + 1 ) * partLines );
+        if ( partEnd <= line ) {
+            break;
+        }
+        matches += ( partEnd - line ) * static_cast<double>( estimate.density[ part ] );
+        line = partEnd;
     }
 
-    return marked_line;
+    return LinesCount( static_cast<LinesCount::UnderlyingType>( std::llround( matches ) ) );
 }
 
-void LogFilteredData::deleteMark( LineNumber line )
+OperationStats LogFilteredData::getSearchStats() const
 {
-    marks_.remove( line.get() );
-    updateMaxLengthMarks( {}, line );
+    return searchStats_;
 }
 
-void LogFilteredData::updateMaxLengthMarks( OptionalLineNumber added_line,
-                                            OptionalLineNumber removed_line )
-{
-    marks_and_matches_ = matching_lines_ | marks_;
-
-    if ( added_line.has_value() ) {
-        maxLengthMarks_ = qMax( maxLengthMarks_, sourceLogData_->getLineLength( *added_line ) );
-    }
+// Delegation to our Marks object
 
-    // Now update the max length if needed
-    if ( removed_line.has_value()
-         && sourceLogData_->getLineLength( *removed_line ) >= maxLengthMarks_ ) {
-        LOG_DEBUG << "deleteMark recalculating longest mark";
-        maxLengthMarks_ = 0_length;
-        marks_.iterate(
-            []( uint64_t line, void* context ) -> bool {
-                auto* self = static_cast<LogFilteredData*>( context );
-                self->maxLengthMarks_
-                    = qMax( self->maxLengthMarks_,
-                            self->sourceLogData_->getLineLength( LineNumber( line ) ) );
-                return true;
-            },
-            static_cast<void*>( this ) );
-    }
+LinesExporter LogFilteredData::getLinesExporter( LineNumber first, LinesCount count ) const
+{
+    return LinesExporter( sourceLogData_, currentResultArray(), first, count );
 }
 
-void LogFilteredData::clearMarks()
+ValueAggregator LogFilteredData::getValueAggregator() const
 {
-    marks_ = {};
-    maxLengthMarks_ = 0_length;
+    return ValueAggregator( sourceLogData_, currentResultArray() );
 }
 
-QList<LineNumber> LogFilteredData::getMarks() const
+TemplateClusterer LogFilteredData::getTemplateClusterer() const
 {
-    QList<LineNumber> markedLines;
-    marks_.iterate(
-        []( uint64_t line, void* context ) -> bool {
-            static_cast<QList<LineNumber>*>( context )->append( LineNumber( line ) );
-            return true;
-        },
-        static_cast<void*>( &markedLines ) );
+    return TemplateClusterer( sourceLogData_, currentResultArray() );
+}
 
-    return markedLines;
+QString LogFilteredData::memoryConsumerFile() const
+{
+    return sourceLogData_->getFileName();
 }
 
-void LogFilteredData::setVisibility( Visibility visi )
+size_t LogFilteredData::memoryUsage() const
 {
-    visibility_ = visi;
+    const auto parts = memoryUsageParts();
+    return std::accumulate( parts.begin(), parts.end(), size_t{ 0 },
+                            []( size_t usage, const MemoryUsagePart& part ) {
+                                return usage + part.second;
+                            } );
 }
 
-void LogFilteredData::updateSearchResultsCache()
+std::vector<MemoryConsumer::MemoryUsagePart> LogFilteredData::memoryUsageParts() const
 {
-    const auto& config = Configuration::get();
-    if ( !config.useSearchResultsCache() ) {
-        return;
+    const auto resultsUsage
+        = matching_lines_.getSizeInBytes( false ) + marks_.getSizeInBytes( false )
+          + marks_and_matches_.getSizeInBytes( false ) + newMatches_.getSizeInBytes( false )
+          + context_lines_.getSizeInBytes( false ) + lines_with_context_.getSizeInBytes( false )
+          + ( recordLines_ ? recordLines_->getSizeInBytes( false ) : 0 )
+          + ( uniqueLines_ ? uniqueLines_->getSizeInBytes( false ) : 0 );
+
+    size_t cacheUsage = 0;
+    for ( const auto& [ cacheKey, cachedResult ] : searchResultsCache_ ) {
+        cacheUsage += cachedResult.matching_lines.sizeInBytes();
     }
 
-    if ( currentSearchKey_ == SearchCacheKey{} ) {
-        return;
+    if ( lastCompletedSearch_ ) {
+        cacheUsage += lastCompletedSearch_->second.matching_lines.sizeInBytes();
     }
 
-    const uint64_t maxCacheLines = config.searchResultsCacheLines();
-
-    if ( matching_lines_.cardinality() > maxCacheLines ) {
-        LOG_DEBUG << "LogFilteredData: too many matches to place in cache";
+    if ( interruptedSearch_ ) {
+        cacheUsage += interruptedSearch_->second.getSizeInBytes( false );
     }
-    else {
-        LOG_INFO << "LogFilteredData: caching results for key "
-                 << std::get<0>( currentSearchKey_ ).pattern << "_"
-                 << std::get<1>( currentSearchKey_ ) << "_" << std::get<2>( currentSearchKey_ );
 
-        searchResultsCache_[ currentSearchKey_ ] = { matching_lines_, maxLength_ };
-        auto cacheSize = std::accumulate( searchResultsCache_.cbegin(), searchResultsCache_.cend(),
-                                          uint64_t{ 0 }, []( const auto& acc, const auto& next ) {
-                                              return acc + next.second.matching_lines.cardinality();
-                                          } );
+    return { { "Search results", resultsUsage },
+             { "Search cache", cacheUsage },
+             { "Time order", timeOrder_ ? timeOrder_->allocatedSize() : 0 } };
+}
 
-        LOG_INFO << "LogFilteredData: cache size " << cacheSize;
+void LogFilteredData::releaseMemory( Release release )
+{
+    switch ( release ) {
+    case Release::Caches: {
+        // Dropped results are loaded back from persistent cache on next search
+        savePersistentSearchCache();
+        isPersistentCacheLoaded_ = false;
 
         auto cachedResult = std::begin( searchResultsCache_ );
-        while ( cachedResult != std::end( searchResultsCache_ ) && cacheSize > maxCacheLines ) {
-
+        while ( cachedResult != std::end( searchResultsCache_ ) ) {
             if ( cachedResult->first == currentSearchKey_ ) {
                 ++cachedResult;
-                continue;
             }
+            else {
+                cachedResult = searchResultsCache_.erase( cachedResult );
+            }
+        }
+
+        lastCompletedSearch_.reset();
+        interruptedSearch_.reset();
+        filterStages_.clear();
+        break;
+    }
+    case Release::CompactResults:
+        // Cached results are already frozen
+        for ( auto* lines : { &matching_lines_, &marks_, &marks_and_matches_, &newMatches_,
+                              &context_lines_, &lines_with_context_ } ) {
+            compactSearchResults( *lines );
+        }
+        break;
+    case Release::SparseIndex:
+        break;
+    }
+}
+
+void LogFilteredData::toggleMark( LineNumber line )
+{
+    if ( ( line >= 0_lnum ) && line < sourceLogData_->getNbLine() ) {
+        if ( !marks_.addChecked( line.get() ) ) {
+            marks_.remove( line.get() );
+            updateMaxLengthMarks( {}, line );
+        }
+        else {
+            updateMaxLengthMarks( line, {} );
+        }
+    }
+    else {
+        LOG_ERROR << "LogFilteredData::toggleMark trying to toggle a mark outside of the file.";
+    }
+}
+
+void LogFilteredData::addMark( LineNumber line )
+{
+    if ( ( line >= 0_lnum ) && line < sourceLogData_->getNbLine() ) {
+        marks_.add( line.get() );
+        updateMaxLengthMarks( line, {} );
+    }
+    else {
+        LOG_ERROR << "LogFilteredData::addMark trying to create a mark outside of the file.";
+    }
+}
+
+void LogFilteredData::addMarks( const SearchResultArray& lines )
+{
+    changeMarks( lines, MarksChange::Add );
+}
+
+void LogFilteredData::changeMarks( const SearchResultArray& lines, MarksChange change )
+{
+    if ( lines.isEmpty() ) {
+        return;
+    }
+
+    const auto nbLines = sourceLogData_->getNbLine().get();
+    SearchResultArray changedLines;
+    if ( lines.maximum() < nbLines ) {
+        changedLines = lines;
+    }
+    else {
+        LOG_ERROR << "LogFilteredData::changeMarks trying to change marks outside of the file.";
+        for ( const auto line : lines ) {
+            if ( line < nbLines ) {
+                changedLines.add( line );
+            }
+        }
+    }
+
+    switch ( change ) {
+    case MarksChange::Add:
+        marks_ |= changedLines;
+        break;
+    case MarksChange::Remove:
+        marks_ -= changedLines;
+        break;
+    case MarksChange::Toggle:
+        marks_ ^= changedLines;
+        break;
+    }
+
+    marks_and_matches_ = matching_lines_ | marks_;
+    updateLinesWithContext();
+    resetLineCursor();
+
+    // Longest line does not change if lines are only added and it is longer
+    if ( change != MarksChange::Add || changedLines.cardinality() > MaxMeasuredMarks ) {
+        isMaxLengthMarksValid_ = false;
+    }
+    else if ( isMaxLengthMarksValid_ ) {
+        for ( const auto line : changedLines ) {
+            maxLengthMarks_
+                = qMax( maxLengthMarks_, sourceLogData_->getLineLength( LineNumber( line ) ) );
+        }
+    }
+}
+
+void LogFilteredData::markAllMatches()
+{
+    changeMarks( matching_lines_, MarksChange::Add );
+}
+
+void LogFilteredData::unmarkRange( LineNumber first, LineNumber last )
+{
+    if ( first >= last ) {
+        return;
+    }
+
+    SearchResultArray range;
+    range.addRange( first.get(), last.get() );
+    changeMarks( range, MarksChange::Remove );
+}
+
+bool LogFilteredData::isLineMarked( LineNumber line ) const
+{
+    return marks_.contains( line.get() );
+}
+
+OptionalLineNumber LogFilteredData::getMarkAfter( LineNumber line ) const
+{
+    OptionalLineNumber marked_line;
+    const LineNumber::UnderlyingType rank = marks_.rank( line.get() );
+    LineNumber::UnderlyingType nextMark;
+    if ( marks_.select( rank, &nextMark ) ) {
+        marked_line = LineNumber( nextMark );
+    }
+
+    return marked_line;
+}
+
+OptionalLineNumber LogFilteredData::getMarkBefore( LineNumber line ) const
+{
+    OptionalLineNumber marked_line;
+
+    const LineNumber::UnderlyingType rank = marks_.rank( line.get() );
+
+    if ( rank < 2 ) {
+        return marked_line;
+    }
+
+    LineNumber::UnderlyingType nextMark;
+    if ( marks_.select( rank - 2, &nextMark ) ) {
+        marked_line = LineNumber( nextMark );
+    }
+
+    return marked_line;
+}
+
+void LogFilteredData::deleteMark( LineNumber line )
+{
+    marks_.remove( line.get() );
+    updateMaxLengthMarks( {}, line );
+}
+
+void LogFilteredData::updateMaxLengthMarks( OptionalLineNumber added_line,
+                                            OptionalLineNumber removed_line )
+{
+    marks_and_matches_ = matching_lines_ | marks_;
+    updateLinesWithContext();
+    resetLineCursor();
+
+    if ( !isMaxLengthMarksValid_ ) {
+        return;
+    }
+
+    if ( added_line.has_value() ) {
+        maxLengthMarks_ = qMax( maxLengthMarks_, sourceLogData_->getLineLength( *added_line ) );
+    }
+
+    // Longest mark is found again when it is needed
+    if ( removed_line.has_value()
+         && sourceLogData_->getLineLength( *removed_line ) >= maxLengthMarks_ ) {
+        isMaxLengthMarksValid_ = false;
+    }
+}
+
+LineLength LogFilteredData::measureLines( const SearchResultArray& lines ) const
+{
+    if ( lines.cardinality() > MaxMeasuredMarks ) {
+        return sourceLogData_->getMaxLength();
+    }
+
+    LOG_DEBUG << "recalculating longest line";
+    auto maxLength = 0_length;
+    for ( const auto line : lines ) {
+        maxLength = qMax( maxLength, sourceLogData_->getLineLength( LineNumber( line ) ) );
+    }
+    return maxLength;
+}
+
+void LogFilteredData::clearMarks()
+{
+    marks_ = {};
+    maxLengthMarks_ = 0_length;
+    isMaxLengthMarksValid_ = true;
+    resetLineCursor();
+}
 
-            cacheSize -= cachedResult->second.matching_lines.cardinality();
-            cachedResult = searchResultsCache_.erase( cachedResult );
+QList<LineNumber> LogFilteredData::getMarks() const
+{
+    QList<LineNumber> markedLines;
+    marks_.iterate(
+        []( uint64_t line, void* context ) -> bool {
+            static_cast<QList<LineNumber>*>( context )->append( LineNumber( line ) );
+            return true;
+        },
+        static_cast<void*>( &markedLines ) );
+
+    return markedLines;
+}
+
+SearchResultArray LogFilteredData::getMatchingLines() const
+{
+    return matching_lines_;
+}
+
+SearchResultArray LogFilteredData::getMarkedLines() const
+{
+    return marks_;
+}
+
+void LogFilteredData::setVisibility( Visibility visi )
+{
+    visibility_ = visi;
+    updateLinesWithContext();
+    resetLineCursor();
+}
+
+void LogFilteredData::setContextLines( LinesCount count )
+{
+    if ( count == contextLines_ ) {
+        return;
+    }
+
+    contextLines_ = count;
+    updateContextLines();
+    resetLineCursor();
+}
+
+void LogFilteredData::setTimeOrdered( bool isTimeOrdered )
+{
+    if ( isTimeOrdered == isTimeOrdered_ ) {
+        return;
+    }
+
+    isTimeOrdered_ = isTimeOrdered;
+    resetLineCursor();
+}
+
+bool LogFilteredData::isTimeOrdered() const
+{
+    return isTimeOrdered_;
+}
+
+void LogFilteredData::setRepeatedLinesHidden( bool isHidden )
+{
+    if ( isHidden == isRepeatedLinesHidden_ ) {
+        return;
+    }
+
+    isRepeatedLinesHidden_ = isHidden;
+    resetLineCursor();
+}
+
+bool LogFilteredData::isRepeatedLinesHidden() const
+{
+    return isRepeatedLinesHidden_;
+}
+
+void LogFilteredData::setWholeRecordsShown( bool isShown )
+{
+    if ( isShown == isWholeRecordsShown_ ) {
+        return;
+    }
+
+    isWholeRecordsShown_ = isShown;
+    resetLineCursor();
+}
+
+bool LogFilteredData::isWholeRecordsShown() const
+{
+    return isWholeRecordsShown_;
+}
+
+bool LogFilteredData::isShowingContext() const
+{
+    return contextLines_ > 0_lcount && visibility_.testFlag( VisibilityFlags::Matches );
+}
+
+SearchResultArray LogFilteredData::findContextLines( const SearchResultArray& matches ) const
+{
+    SearchResultArray contextLines;
+    if ( contextLines_ == 0_lcount || matches.isEmpty() ) {
+        return contextLines;
+    }
+
+    const auto nbLines = sourceLogData_->getNbLine().get();
+    const auto distance = contextLines_.get();
+
+    // Ranges of close matches overlap, they are merged and
+    // added once, so dense matches produce few ranges
+    uint64_t rangeBegin = 0;
+    uint64_t rangeEnd = 0;
+    for ( const auto line : matches ) {
+        const auto begin = line > distance ? line - distance : 0;
+        const auto end = std::min( line + distance + 1, nbLines );
+        if ( begin > rangeEnd ) {
+            contextLines.addRange( rangeBegin, rangeEnd );
+            rangeBegin = begin;
         }
+        rangeEnd = std::max( rangeEnd, end );
+    }
+    contextLines.addRange( rangeBegin, rangeEnd );
+
+    contextLines -= matches;
+    contextLines.runOptimize();
+    return contextLines;
+}
+
+void LogFilteredData::updateContextLines()
+{
+    context_lines_ = findContextLines( matching_lines_ );
+    isMaxLengthContextValid_ = false;
+    updateLinesWithContext();
+}
+
+void LogFilteredData::updateLinesWithContext()
+{
+    if ( !isShowingContext() ) {
+        lines_with_context_ = {};
+        return;
     }
+
+    lines_with_context_ = visibility_.testFlag( VisibilityFlags::Marks )
+                              ? marks_and_matches_ | context_lines_
+                              : matching_lines_ | context_lines_;
+}
+
+void LogFilteredData::updateSearchResultsCache()
+{
+    const auto& config = Configuration::get();
+    if ( !config.useSearchResultsCache() ) {
+        return;
+    }
+
+    if ( currentSearchKey_ == SearchCacheKey{} || hasCombinedResults_ ) {
+        return;
+    }
+
+    const uint64_t maxCacheLines = config.searchResultsCacheLines();
+
+    if ( matching_lines_.cardinality() > maxCacheLines ) {
+        LOG_DEBUG << "LogFilteredData: too many matches to place in cache";
+    }
+    else {
+        insertIntoSearchResultsCache( currentSearchKey_,
+                                      { FrozenSearchResults( matching_lines_ ), maxLength_ } );
+    }
+}
+
+void LogFilteredData::cacheAdditionalSearchResults()
+{
+    auto results = workerThread_.getAdditionalSearchResults();
+    if ( results.size() != additionalPatterns_.size() ) {
+        return;
+    }
+
+    const auto& config = Configuration::get();
+    if ( !config.useSearchResultsCache() ) {
+        return;
+    }
+
+    const uint64_t maxCacheLines = config.searchResultsCacheLines();
+
+    for ( auto index = 0u; index < results.size(); ++index ) {
+        auto& patternResults = results[ index ];
+        if ( patternResults.matches.cardinality() > maxCacheLines ) {
+            LOG_DEBUG << "LogFilteredData: too many matches to place in cache";
+            continue;
+        }
+
+        insertIntoSearchResultsCache( makeCacheKey( additionalPatterns_[ index ],
+                                                    LineNumber( std::get<1>( currentSearchKey_ ) ),
+                                                    LineNumber( std::get<2>( currentSearchKey_ ) ) ),
+                                      { FrozenSearchResults( std::move( patternResults.matches ) ),
+                                        patternResults.maxLength } );
+    }
+}
+
+void LogFilteredData::insertIntoSearchResultsCache( const SearchCacheKey& cacheKey,
+                                                    CachedSearchResult result )
+{
+    const uint64_t maxCacheLines = Configuration::get().searchResultsCacheLines();
+
+    LOG_INFO << "LogFilteredData: caching results for key " << std::get<0>( cacheKey ).pattern
+             << "_" << std::get<1>( cacheKey ) << "_" << std::get<2>( cacheKey );
+
+    result.lastUsed = QDateTime::currentMSecsSinceEpoch();
+    searchResultsCache_[ cacheKey ] = std::move( result );
+    auto cacheSize = std::accumulate( searchResultsCache_.cbegin(), searchResultsCache_.cend(),
+                                      uint64_t{ 0 }, []( const auto& acc, const auto& next ) {
+                                          return acc + next.second.matching_lines.cardinality();
+                                      } );
+
+    LOG_INFO << "LogFilteredData: cache size " << cacheSize;
+
+    auto cachedResult = std::begin( searchResultsCache_ );
+    while ( cachedResult != std::end( searchResultsCache_ ) && cacheSize > maxCacheLines ) {
+
+        if ( cachedResult->first == cacheKey || cachedResult->first == currentSearchKey_ ) {
+            ++cachedResult;
+            continue;
+        }
+
+        cacheSize -= cachedResult->second.matching_lines.cardinality();
+        cachedResult = searchResultsCache_.erase( cachedResult );
+    }
+}
+
+void LogFilteredData::loadPersistentSearchCache()
+{
+    if ( isPersistentCacheLoaded_ ) {
+        return;
+    }
+    isPersistentCacheLoaded_ = true;
+
+    const PersistentSearchCache persistentCache( sourceLogData_->getFileName() );
+    addCachedSearchResults( persistentCache.load() );
+}
+
+void LogFilteredData::loadAttachedSearchResults()
+{
+    addCachedSearchResults(
+        AnalysisBundle::takeAttachedSearchResults( sourceLogData_->getFileName() ) );
+}
+
+void LogFilteredData::addCachedSearchResults( std::vector<PersistentSearchCache::Entry> entries )
+{
+    // Most recently used entries are kept
+    std::sort( entries.begin(), entries.end(), []( const auto& lhs, const auto& rhs ) {
+        return lhs.lastUsed > rhs.lastUsed;
+    } );
+
+    const uint64_t maxCacheLines = Configuration::get().searchResultsCacheLines();
+    uint64_t cacheSize = 0;
+    for ( auto& entry : entries ) {
+        cacheSize += entry.matchingLines.cardinality();
+        if ( cacheSize > maxCacheLines ) {
+            break;
+        }
+
+        searchResultsCache_.emplace(
+            makeCacheKey( entry.pattern, entry.startLine, entry.endLine ),
+            CachedSearchResult{ FrozenSearchResults( std::move( entry.matchingLines ) ),
+                                entry.maxLength,
+                                entry.lastUsed } );
+    }
+}
+
+void LogFilteredData::savePersistentSearchCache() const
+{
+    const auto& config = Configuration::get();
+    if ( !config.useSearchResultsCache() || !config.usePersistentSearchCache()
+         || sourceLogData_->isIndexing() ) {
+        return;
+    }
+
+    const PersistentSearchCache persistentCache( sourceLogData_->getFileName() );
+    persistentCache.save( sourceLogData_->getIndexedHash(), getCachedSearchResults() );
+}
+
+std::vector<PersistentSearchCache::Entry> LogFilteredData::getCachedSearchResults() const
+{
+    std::vector<PersistentSearchCache::Entry> entries;
+    entries.reserve( searchResultsCache_.size() );
+    for ( const auto& [ cacheKey, cachedResult ] : searchResultsCache_ ) {
+        entries.push_back( { std::get<0>( cacheKey ), LineNumber( std::get<1>( cacheKey ) ),
+                             LineNumber( std::get<2>( cacheKey ) ),
+                             cachedResult.matching_lines.thaw(),
+                             cachedResult.maxLength, cachedResult.lastUsed } );
+    }
+    return entries;
 }
 
 //
@@ -402,13 +1392,71 @@ void LogFilteredData::handleSearchProgressed( LinesCount nbMatches, int progress
 
     matching_lines_ |= searchResults.newMatches;
     marks_and_matches_ |= searchResults.newMatches;
+    newMatches_ |= searchResults.newMatches;
+
+    // Only context of new matches is added, lines that were
+    // context of earlier matches can be matches now
+    if ( contextLines_ > 0_lcount && !searchResults.newMatches.isEmpty() ) {
+        auto newContextLines = findContextLines( searchResults.newMatches );
+        newContextLines -= matching_lines_;
+
+        context_lines_ -= searchResults.newMatches;
+        context_lines_ |= newContextLines;
+        isMaxLengthContextValid_ = false;
+
+        if ( isShowingContext() ) {
+            lines_with_context_ |= searchResults.newMatches;
+            lines_with_context_ |= newContextLines;
+        }
+    }
+    isSearching_ = progress < 100;
+    resetLineCursor();
 
-    maxLength_ = searchResults.maxLength;
     nbLinesProcessed_ = searchResults.processedLines;
 
+    // Worker counts matches of the searched pattern only, combined
+    // results keep lines added and removed by other searches
+    if ( hasCombinedResults_ ) {
+        nbMatches = LinesCount( matching_lines_.cardinality() );
+        maxLength_ = qMax( maxLength_, searchResults.maxLength );
+    }
+    else {
+        maxLength_ = searchResults.maxLength;
+    }
+
+    if ( progress == 100 ) {
+        // Buffers of the finished search are freed
+        MemoryGovernor::get().scheduleRelease();
+
+        compactSearchResults( matching_lines_ );
+        compactSearchResults( marks_and_matches_ );
+        compactSearchResults( context_lines_ );
+        compactSearchResults( lines_with_context_ );
+    }
+
+    if ( progress == 100 && !filterChain_.empty() ) {
+        cacheFilterStages();
+    }
+
     if ( progress == 100
          && nbLinesProcessed_.get() == getExpectedSearchEnd( currentSearchKey_ ).get() ) {
+        // Main results are cached last to keep them when cache is full
+        cacheAdditionalSearchResults();
         updateSearchResultsCache();
+        savePersistentSearchCache();
+
+        if ( currentSearchKey_ != SearchCacheKey{} && !hasCombinedResults_ ) {
+            // Frozen results share their data with the cached ones
+            const auto cachedResults = searchResultsCache_.find( currentSearchKey_ );
+            if ( cachedResults != std::end( searchResultsCache_ ) ) {
+                lastCompletedSearch_ = { currentSearchKey_, cachedResults->second };
+            }
+            else {
+                lastCompletedSearch_
+                    = { currentSearchKey_, { FrozenSearchResults( matching_lines_ ), maxLength_ } };
+            }
+            interruptedSearch_.reset();
+        }
     }
 
     {
@@ -424,9 +1472,142 @@ void LogFilteredData::handleSearchProgressed( LinesCount nbMatches, int progress
         LOG_INFO << "Matches size " << readableSize( matching_lines_.getSizeInBytes( false ) )
                  << ", marks size " << readableSize( marks_.getSizeInBytes( false ) )
                  << ", union size " << readableSize( marks_and_matches_.getSizeInBytes( false ) );
+
+        MemoryGovernor::get().enforceBudget();
+    }
+}
+
+void LogFilteredData::handlePrerunProgressed( LinesCount nbMatches, int progress,
+                                              LineNumber initialLine )
+{
+    Q_UNUSED( nbMatches )
+    Q_UNUSED( initialLine )
+
+    if ( prerunPatterns_.empty() ) {
+        return;
+    }
+
+    auto searchResults = prerunWorker_.getSearchResults();
+    prerunMatches_ |= searchResults.newMatches;
+    if ( progress < 100 ) {
+        return;
+    }
+
+    // Interrupted search has not processed all lines
+    const auto patterns = std::move( prerunPatterns_ );
+    prerunPatterns_.clear();
+    auto matches = std::move( prerunMatches_ );
+    prerunMatches_ = {};
+    if ( searchResults.processedLines.get() != prerunEndLine_.get() ) {
+        LOG_INFO << "Background search was interrupted";
+        return;
+    }
+
+    const uint64_t maxCacheLines = Configuration::get().searchResultsCacheLines();
+    const auto cacheResults = [ this, maxCacheLines ]( const RegularExpressionPattern& pattern,
+                                                       SearchResultArray lines,
+                                                       LineLength maxLength ) {
+        if ( lines.cardinality() > maxCacheLines ) {
+            LOG_DEBUG << "LogFilteredData: too many matches to place in cache";
+            return;
+        }
+
+        insertIntoSearchResultsCache( makeCacheKey( pattern, 0_lnum, prerunEndLine_ ),
+                                      { FrozenSearchResults( std::move( lines ) ), maxLength } );
+    };
+
+    cacheResults( patterns.front(), std::move( matches ), searchResults.maxLength );
+
+    auto additionalResults = prerunWorker_.getAdditionalSearchResults();
+    if ( additionalResults.size() + 1 == patterns.size() ) {
+        for ( auto index = 0u; index < additionalResults.size(); ++index ) {
+            cacheResults( patterns[ index + 1 ], std::move( additionalResults[ index ].matches ),
+                          additionalResults[ index ].maxLength );
+        }
+    }
+
+    savePersistentSearchCache();
+}
+
+void LogFilteredData::handleCountProgressed( LinesCount nbMatches, int progress,
+                                             LineNumber initialLine )
+{
+    Q_UNUSED( initialLine )
+
+    if ( progress == 100 ) {
+        Q_EMIT matchesCounted( nbMatches );
     }
 }
 
+void LogFilteredData::handleFileChanged( MonitoredFileStatus status )
+{
+    if ( status != MonitoredFileStatus::Truncated ) {
+        return;
+    }
+
+    prerunWorker_.interrupt();
+    prerunPatterns_.clear();
+    countWorker_.interrupt();
+    filterStages_.clear();
+
+    // Old index is live until the file is indexed again,
+    // it tells which cached results are still valid
+    isSourceChanged_ = true;
+}
+
+void LogFilteredData::handleLoadingFinished( LoadingStatus status )
+{
+    if ( !isSourceChanged_ ) {
+        return;
+    }
+    isSourceChanged_ = false;
+
+    const auto keptLines = status == LoadingStatus::Successful
+                               ? sourceLogData_->getIndexingStats().keptLines
+                               : LinesCount::UnderlyingType{ 0 };
+    LOG_INFO << "File changed, keeping cached search results of the first " << keptLines
+             << " lines";
+
+    decltype( searchResultsCache_ ) keptResults;
+    for ( const auto& [ cacheKey, cachedResult ] : searchResultsCache_ ) {
+        const auto& [ pattern, startLine, endLine ] = cacheKey;
+        const auto keptEnd = std::min( endLine, keptLines );
+        if ( keptEnd <= startLine ) {
+            continue;
+        }
+
+        SearchResultArray keptRange;
+        keptRange.addRange( startLine, keptEnd );
+        auto matchingLines = cachedResult.matching_lines.thaw();
+        matchingLines &= keptRange;
+        // Max length is kept, it is only an upper bound of the kept matches
+        keptResults.emplace( SearchCacheKey{ pattern, startLine, keptEnd },
+                             CachedSearchResult{ FrozenSearchResults( std::move( matchingLines ) ),
+                                                 cachedResult.maxLength,
+                                                 cachedResult.lastUsed } );
+    }
+
+    searchResultsCache_ = std::move( keptResults );
+    lastCompletedSearch_.reset();
+    interruptedSearch_.reset();
+    // Persistent cache is checked against the indexed part of the file when loaded
+    isPersistentCacheLoaded_ = false;
+}
+
+void LogFilteredData::handleSearchEstimated( LinesCount estimatedMatches )
+{
+    searchEstimate_ = workerThread_.getSearchEstimate();
+    if ( searchEstimate_ ) {
+        Q_EMIT searchEstimated( estimatedMatches );
+    }
+}
+
+void LogFilteredData::handleSearchFinished( const OperationStats& stats )
+{
+    searchStats_ = stats;
+    Q_EMIT searchFinished( stats );
+}
+
 void LogFilteredData::handleSearchProgressedThrottled()
 {
     LinesCount nbMatches;
@@ -441,24 +1622,164 @@ void LogFilteredData::handleSearchProgressedThrottled()
 
 LineNumber LogFilteredData::findLogDataLine( LineNumber index ) const
 {
+    const auto lines = findLogDataLines( index, 1_lcount );
+    if ( lines.front() == maxValue<LineNumber>() ) {
+        const auto& currentResults = currentResultArray();
+        if ( !currentResults.isEmpty() ) {
+            LOG_ERROR << "Index too big in LogFilteredData: " << index << " cache size "
+                      << currentResults.cardinality();
+        }
+    }
+    return lines.front();
+}
+
+std::vector<LineNumber> LogFilteredData::findLogDataLines( LineNumber firstIndex,
+                                                           LinesCount number ) const
+{
+    // Roaring select counts from the first bucket,
+    // moving iterator only looks the line up
+    static constexpr LineNumber::UnderlyingType MaxCursorSteps = 1024;
+
+    if ( timeOrder_ ) {
+        std::vector<LineNumber> lines;
+        lines.reserve( number.get() );
+        for ( auto index = firstIndex; lines.size() < number.get(); ++index ) {
+            lines.push_back( timeOrder_->line( index ) );
+        }
+        return lines;
+    }
+
     const auto& currentResults = currentResultArray();
 
-    LineNumber::UnderlyingType line = {};
-    if ( currentResults.select( index.get(), &line ) ) {
-        return LineNumber( line );
+    std::optional<LineCursor> cursor;
+    {
+        ScopedLock lock( lineCursorMutex_ );
+        cursor = lineCursor_;
+    }
+
+    auto resultsIterator = currentResults.begin();
+    const auto resultsEnd = currentResults.end();
+    auto skippedLines = firstIndex.get();
+    if ( cursor && cursor->index <= firstIndex
+         && firstIndex.get() - cursor->index.get() <= MaxCursorSteps
+         && resultsIterator.move( cursor->line.get() )
+         && *resultsIterator == cursor->line.get() ) {
+        skippedLines = firstIndex.get() - cursor->index.get();
     }
     else {
-        if ( !currentResults.isEmpty() ) {
-            LOG_ERROR << "Index too big in LogFilteredData: " << index << " cache size "
-                      << currentResults.cardinality();
+        LineNumber::UnderlyingType firstLine = {};
+        if ( !currentResults.select( firstIndex.get(), &firstLine )
+             || !resultsIterator.move( firstLine ) ) {
+            return std::vector<LineNumber>( number.get(), maxValue<LineNumber>() );
         }
-        return maxValue<LineNumber>();
+        skippedLines = 0;
+    }
+
+    for ( ; skippedLines > 0 && resultsIterator != resultsEnd; --skippedLines ) {
+        ++resultsIterator;
+    }
+
+    std::vector<LineNumber> lines;
+    lines.reserve( number.get() );
+    for ( ; lines.size() < number.get() && resultsIterator != resultsEnd; ++resultsIterator ) {
+        lines.emplace_back( *resultsIterator );
+    }
+
+    if ( !lines.empty() ) {
+        ScopedLock lock( lineCursorMutex_ );
+        lineCursor_ = LineCursor{ firstIndex + LinesCount( lines.size() - 1 ), lines.back() };
+    }
+
+    lines.resize( number.get(), maxValue<LineNumber>() );
+    return lines;
+}
+
+void LogFilteredData::resetLineCursor()
+{
+    {
+        ScopedLock lock( lineCursorMutex_ );
+        lineCursor_.reset();
+    }
+    updateRecordLines();
+    updateUniqueLines();
+    updateTimeOrder();
+}
+
+void LogFilteredData::updateRecordLines()
+{
+    recordLines_.reset();
+    maxLengthRecords_ = 0_length;
+
+    if ( !isWholeRecordsShown_ || isSearching_ ) {
+        return;
+    }
+
+    if ( !sourceLogData_->hasRecordIndex() ) {
+        LOG_WARNING << "Whole records are not shown, file has no record index";
+        return;
+    }
+
+    recordLines_ = sourceLogData_->expandToRecords( visibleResultArray() );
+    maxLengthRecords_ = measureLines( *recordLines_ );
+}
+
+void LogFilteredData::updateUniqueLines()
+{
+    uniqueLines_.reset();
+
+    if ( !isRepeatedLinesHidden_ || isSearching_ ) {
+        return;
+    }
+
+    if ( !sourceLogData_->hasLineHashes() ) {
+        LOG_WARNING << "Repeated lines are not hidden, file has no line hashes";
+        return;
+    }
+
+    const auto& visibleLines = recordResultArray();
+    const auto repeatedLines = sourceLogData_->findRepeatedLines( visibleLines );
+    if ( !repeatedLines.isEmpty() ) {
+        uniqueLines_ = visibleLines;
+        *uniqueLines_ -= repeatedLines;
+        uniqueLines_->runOptimize();
+    }
+}
+
+void LogFilteredData::updateTimeOrder()
+{
+    timeOrder_.reset();
+
+    // Order is built once when the search finishes,
+    // not each time it finds more lines
+    if ( !isTimeOrdered_ || isSearching_ ) {
+        return;
+    }
+
+    const auto timestampFormat = sourceLogData_->getTimestampFormat();
+    if ( timestampFormat.isEmpty() ) {
+        LOG_WARNING << "Lines are not ordered by time, file has no timestamp format";
+        return;
     }
+
+    timeOrder_.emplace( *sourceLogData_, currentResultArray(), TimestampParser( timestampFormat ) );
 }
 
 const SearchResultArray& LogFilteredData::currentResultArray() const
 {
-    if ( visibility_.testFlag( VisibilityFlags::Marks )
+    return uniqueLines_ ? *uniqueLines_ : recordResultArray();
+}
+
+const SearchResultArray& LogFilteredData::recordResultArray() const
+{
+    return recordLines_ ? *recordLines_ : visibleResultArray();
+}
+
+const SearchResultArray& LogFilteredData::visibleResultArray() const
+{
+    if ( isShowingContext() ) {
+        return lines_with_context_;
+    }
+    else if ( visibility_.testFlag( VisibilityFlags::Marks )
          && visibility_.testFlag( VisibilityFlags::Matches ) ) {
         return marks_and_matches_;
     }
@@ -472,11 +1793,21 @@ const SearchResultArray& LogFilteredData::currentResultArray() const
 
 LineNumber LogFilteredData::findFilteredLine( LineNumber lineNum ) const
 {
+    {
+        ScopedLock lock( lineCursorMutex_ );
+        if ( lineCursor_ && lineCursor_->line == lineNum ) {
+            return lineCursor_->index;
+        }
+    }
+
     LineNumber::UnderlyingType index = currentResultArray().rank( lineNum.get() );
 
     if ( index > 0 ) {
         index--;
     }
+    if ( timeOrder_ && index < timeOrder_->size().get() ) {
+        return timeOrder_->index( index );
+    }
     return LineNumber( index );
 }
 
@@ -487,6 +1818,18 @@ QString LogFilteredData::doGetLineString( LineNumber index ) const
     return sourceLogData_->getLineString( line );
 }
 
+std::vector<AnsiColorSpan> LogFilteredData::doGetLineColors( LineNumber index ) const
+{
+    const auto line = findLogDataLine( index );
+    return sourceLogData_->getLineColors( line );
+}
+
+bool LogFilteredData::doLoadMoreOfLine( LineNumber index ) const
+{
+    const auto line = findLogDataLine( index );
+    return sourceLogData_->loadMoreOfLine( line );
+}
+
 // Implementation of the virtual function.
 QString LogFilteredData::doGetExpandedLineString( LineNumber index ) const
 {
@@ -497,33 +1840,82 @@ QString LogFilteredData::doGetExpandedLineString( LineNumber index ) const
 // Implementation of the virtual function.
 std::vector<QString> LogFilteredData::doGetLines( LineNumber first_line, LinesCount number ) const
 {
-    return doGetLines( first_line, number,
-                       [ this ]( const auto& line ) { return doGetLineString( line ); } );
+    return doGetLines( first_line, number, [ this ]( LineNumber first, LinesCount count ) {
+        return sourceLogData_->getLines( first, count );
+    } );
 }
 
 // Implementation of the virtual function.
 std::vector<QString> LogFilteredData::doGetExpandedLines( LineNumber first_line,
                                                           LinesCount number ) const
+{
+    return doGetLines( first_line, number, [ this ]( LineNumber first, LinesCount count ) {
+        return sourceLogData_->getExpandedLines( first, count );
+    } );
+}
+
+// Implementation of the virtual function.
+std::vector<QString> LogFilteredData::doGetExpandedLinesWindow( LineNumber first_line,
+                                                                LinesCount number,
+                                                                int firstColumn,
+                                                                int nbColumns ) const
 {
     return doGetLines( first_line, number,
-                       [ this ]( const auto& line ) { return doGetExpandedLineString( line ); } );
+                       [ this, firstColumn, nbColumns ]( LineNumber first, LinesCount count ) {
+                           return sourceLogData_->getExpandedLinesWindow( first, count,
+                                                                          firstColumn, nbColumns );
+                       } );
 }
 
-std::vector<QString>
-LogFilteredData::doGetLines( LineNumber first_line, LinesCount number,
-                             const std::function<QString( LineNumber )>& lineGetter ) const
+std::vector<QString> LogFilteredData::doGetLines( LineNumber first_line, LinesCount number,
+                                                  const SourceLinesGetter& sourceLinesGetter ) const
 {
-    std::vector<LineNumber::UnderlyingType> lineNumbers( number.get() );
-    std::iota( lineNumbers.begin(), lineNumbers.end(), first_line.get() );
+    const auto sourceLines = findLogDataLines( first_line, number );
+
+    std::vector<QString> lines;
+    lines.reserve( number.get() );
 
-    std::vector<QString> lines( number.get() );
-    std::transform(
-        lineNumbers.cbegin(), lineNumbers.cend(), lines.begin(),
-        [ &lineGetter ]( const auto& line ) { return lineGetter( LineNumber( line ) ); } );
+    forEachSourceRun( sourceLines, [ & ]( auto runStart, auto runEnd ) {
+        const auto runFirstLine = *runStart;
+        auto runLines
+            = sourceLinesGetter( runFirstLine, ( *std::prev( runEnd ) - runFirstLine ) + 1_lcount );
 
+        for ( auto line = runStart; line != runEnd; ++line ) {
+            const auto offset = ( *line - runFirstLine ).get();
+            lines.push_back( offset < runLines.size() ? std::move( runLines[ offset ] )
+                                                      : QString{} );
+        }
+    } );
+
+    lines.resize( number.get() );
     return lines;
 }
 
+void LogFilteredData::doGetLinesBatch( LineNumber first_line, LinesCount number,
+                                       LineBatch& batch ) const
+{
+    const auto sourceLines = findLogDataLines( first_line, number );
+
+    batch.clear();
+
+    // Runs are read into one batch reused for all of them
+    LineBatch runBatch;
+    forEachSourceRun( sourceLines, [ & ]( auto runStart, auto runEnd ) {
+        const auto runFirstLine = *runStart;
+        sourceLogData_->getLinesBatch(
+            runFirstLine, ( *std::prev( runEnd ) - runFirstLine ) + 1_lcount, runBatch );
+
+        for ( auto line = runStart; line != runEnd; ++line ) {
+            const auto offset = ( *line - runFirstLine ).get();
+            batch.append( offset < runBatch.size() ? runBatch.line( offset ) : QStringView{} );
+        }
+    } );
+
+    while ( batch.size() < number.get() ) {
+        batch.append( QStringView{} );
+    }
+}
+
 // Implementation of the virtual function.
 LinesCount LogFilteredData::doGetNbLine() const
 {
@@ -534,7 +1926,18 @@ LinesCount LogFilteredData::doGetNbLine() const
 // Implementation of the virtual function.
 LineLength LogFilteredData::doGetMaxLength() const
 {
-    return qMax( maxLength_, maxLengthMarks_ );
+    if ( !isMaxLengthMarksValid_ ) {
+        maxLengthMarks_ = measureLines( marks_ );
+        isMaxLengthMarksValid_ = true;
+    }
+
+    if ( isShowingContext() && !isMaxLengthContextValid_ ) {
+        maxLengthContext_ = measureLines( context_lines_ );
+        isMaxLengthContextValid_ = true;
+    }
+
+    const auto maxLength = qMax( qMax( maxLength_, maxLengthMarks_ ), maxLengthRecords_ );
+    return isShowingContext() ? qMax( maxLength, maxLengthContext_ ) : maxLength;
 }
 
 // Implementation of the virtual function.
@@ -544,6 +1947,33 @@ LineLength LogFilteredData::doGetLineLength( LineNumber lineNum ) const
     return sourceLogData_->getLineLength( line );
 }
 
+// Implementation of the virtual function.
+void LogFilteredData::doPrefetchLines( LineNumber first, LinesCount number ) const
+{
+    const auto nbLines = doGetNbLine();
+    if ( first.get() >= nbLines.get() ) {
+        return;
+    }
+
+    const auto endIndex = std::min( first.get() + number.get(), nbLines.get() );
+
+    sourceLogData_->prefetchLinesAt(
+        findLogDataLines( first, LinesCount( endIndex - first.get() ) ) );
+}
+
+bool LogFilteredData::doAreLinesCached( LineNumber first, LinesCount number ) const
+{
+    const auto nbLines = doGetNbLine();
+    if ( first.get() >= nbLines.get() ) {
+        return true;
+    }
+
+    const auto endIndex = std::min( first.get() + number.get(), nbLines.get() );
+
+    return sourceLogData_->areLinesCachedAt(
+        findLogDataLines( first, LinesCount( endIndex - first.get() ) ) );
+}
+
 void LogFilteredData::doSetDisplayEncoding( const char* encoding )
 {
     LOG_DEBUG << "AbstractLogData::setDisplayEncoding: " << encoding;
@@ -36,33 +36,73 @@
  * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <cmath>
 #include <exception>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <random>
 #include <qsemaphore.h>
 #include <qthreadpool.h>
 #include <stdexcept>
+#include <string_view>
 #include <utility>
+#include <vector>
 
 #include <QThreadPool>
 
+#include <tbb/concurrent_queue.h>
+#include <tbb/enumerable_thread_specific.h>
 #include <tbb/flow_graph.h>
-#include <tbb/info.h>
+#include <tbb/task_arena.h>
 
 #include "configuration.h"
+#include "devicetuning.h"
 #include "dispatch_to.h"
 #include "issuereporter.h"
 #include "log.h"
 #include "overload_visitor.h"
+#include "pipelinetrace.h"
 #include "progress.h"
 #include "runnable_lambda.h"
+#include "tracezone.h"
 
+#include "booleanevaluator.h"
 #include "logdata.h"
 #include "regularexpression.h"
+#include "searchplanner.h"
+#include "workscheduler.h"
 
 #include "logfiltereddataworker.h"
 
 namespace {
+// Chunk is sized to be matched in about this time
+constexpr uint64_t TargetChunkMatchNs = 5'000'000;
+// Limits of chunk size in bytes
+constexpr uint64_t MinChunkBytes = 4 * 1024 * 1024;
+constexpr uint64_t MaxChunkBytes = 16 * 1024 * 1024;
+// Longer entries are split between chunks
+constexpr LinesCount::UnderlyingType MaxEntryLines = 10000;
+// Lines read at once to find where the last entry of a chunk ends
+constexpr LinesCount::UnderlyingType EntryProbeLines = 64;
+// Windows of giant lines overlap by this many bytes, see matchCutLines
+constexpr qint64 GiantLineOverlapBytes = 64 * 1024;
+// Chunks read at the same time, one reader is enough for slow disks
+// and more readers than that only take threads from matchers
+constexpr uint32_t MaxReaderThreads = 4;
+
+// Matches of files with more lines are estimated before the search
+constexpr LinesCount::UnderlyingType EstimateMinLines = 1'000'000;
+// Lines are sampled in this many equal parts of the searched range
+constexpr size_t EstimateParts = 100;
+// About 1% of lines of each part are sampled, at most this many
+constexpr LinesCount::UnderlyingType EstimateMaxPartLines = 5000;
+// Parts not sampled in this time are estimated from the sampled ones
+constexpr std::chrono::milliseconds EstimateDuration{ 300 };
+
 struct PartialSearchResults {
     PartialSearchResults() = default;
 
@@ -78,13 +118,106 @@ struct PartialSearchResults {
     LinesCount processedLines;
 };
 
+// Memory used while matching one chunk, kept between chunks
+// to avoid allocating it again for each of them
+struct LineBuffers {
+    std::vector<std::string_view> utf8Lines;
+    std::vector<uint32_t> matchingOffsets;
+    std::vector<uint32_t> matchingLines;
+};
+
+// Matching lines of a chunk by their offsets from its first line.
+// Files with less than 2^32 lines only use the first 32-bit bitmap of the
+// 64-bit map, so lines are added to a flat bitmap at once instead of
+// looking the bitmap up in the map for each line. Runs of consecutive
+// lines are added as ranges, so dense results take time and memory
+// by the number of runs, not lines.
+SearchResultArray makeMatchingLines( LineNumber chunkStart, const std::vector<uint32_t>& offsets,
+                                     LineBuffers& buffers )
+{
+    SearchResultArray matchingLines;
+    if ( offsets.empty() ) {
+        return matchingLines;
+    }
+
+    const auto forEachRun = [ &offsets ]( auto&& addRun ) {
+        size_t runStart = 0;
+        for ( auto index = 1u; index <= offsets.size(); ++index ) {
+            if ( index == offsets.size() || offsets[ index ] != offsets[ index - 1 ] + 1 ) {
+                addRun( offsets[ runStart ], index - runStart );
+                runStart = index;
+            }
+        }
+    };
+
+    if ( chunkStart.get() + offsets.back() > std::numeric_limits<uint32_t>::max() ) {
+        forEachRun( [ &matchingLines, chunkStart ]( uint32_t offset, size_t length ) {
+            const auto first = ( chunkStart + LinesCount{ offset } ).get();
+            matchingLines.addRange( first, first + length );
+        } );
+        matchingLines.runOptimize();
+        return matchingLines;
+    }
+
+    // Single lines are collected to be added together
+    auto& lines = buffers.matchingLines;
+    lines.clear();
+    roaring::Roaring flatLines;
+    const auto firstLine = static_cast<uint32_t>( chunkStart.get() );
+    forEachRun( [ &lines, &flatLines, firstLine ]( uint32_t offset, size_t length ) {
+        if ( length == 1 ) {
+            lines.push_back( firstLine + offset );
+        }
+        else {
+            flatLines.addRange( uint64_t{ firstLine } + offset,
+                                uint64_t{ firstLine } + offset + length );
+        }
+    } );
+    flatLines.addMany( lines.size(), lines.data() );
+    flatLines.runOptimize();
+    return SearchResultArray( flatLines );
+}
+
+// Lines of a chunk except rejected ones, they are given by offsets
+// from its first line. The complement is built by flipping the range
+// of the chunk, so it takes time by the number of rejected lines.
+SearchResultArray makeComplementLines( LineNumber chunkStart, LinesCount chunkLines,
+                                       const std::vector<uint32_t>& rejectedOffsets,
+                                       LineBuffers& buffers )
+{
+    if ( chunkLines.get() == 0 ) {
+        return {};
+    }
+
+    const auto chunkEnd = chunkStart.get() + chunkLines.get();
+    if ( chunkEnd - 1 > std::numeric_limits<uint32_t>::max() ) {
+        SearchResultArray matchingLines;
+        auto runStart = chunkStart.get();
+        for ( const auto offset : rejectedOffsets ) {
+            const auto rejectedLine = chunkStart.get() + offset;
+            matchingLines.addRange( runStart, rejectedLine );
+            runStart = rejectedLine + 1;
+        }
+        matchingLines.addRange( runStart, chunkEnd );
+        matchingLines.runOptimize();
+        return matchingLines;
+    }
+
+    auto& lines = buffers.matchingLines;
+    lines.resize( rejectedOffsets.size() );
+    const auto firstLine = static_cast<uint32_t>( chunkStart.get() );
+    std::transform( rejectedOffsets.begin(), rejectedOffsets.end(), lines.begin(),
+                    [ firstLine ]( uint32_t offset ) { return firstLine + offset; } );
+
+    roaring::Roaring flatLines;
+    flatLines.addMany( lines.size(), lines.data() );
+    flatLines.flip( firstLine, chunkEnd );
+    flatLines.runOptimize();
+    return SearchResultArray( flatLines );
+}
+
 struct SearchBlockData {
     SearchBlockData() = default;
-    SearchBlockData( LineNumber start, LogData::RawLines blockLines )
-        : chunkStart( start )
-        , lines( std::move( blockLines ) )
-    {
-    }
 
     SearchBlockData( const SearchBlockData& ) = delete;
     SearchBlockData( SearchBlockData&& ) = default;
@@ -95,35 +228,464 @@ struct SearchBlockData {
     LineNumber chunkStart;
     LogData::RawLines lines;
 
+    // Chunk that can not contain matches is not read,
+    // it is only counted as processed
+    bool isSkipped = false;
+
+    // Lines of the chunk to be read by one of the readers,
+    // blocks filled before they are queued have none
+    LinesCount linesToRead;
+
     PartialSearchResults searchResults;
+    std::vector<PartialSearchResults> additionalResults;
+
+    // Matching lines of the chunk when they are only counted
+    uint64_t matchesCount = 0;
+
+    // Runs of consecutive lines read instead of the whole chunk
+    // when search is limited to some lines
+    std::vector<LogData::RawLines> sparseLines;
+
+    LineBuffers buffers;
+
+    // Prepares block to be filled with the next chunk,
+    // memory of lines and buffers is kept
+    void reset( LineNumber start )
+    {
+        chunkStart = start;
+        lines.endOfLines.clear();
+        lines.mappingGuard.reset();
+        lines.mappedData = {};
+        isSkipped = false;
+        linesToRead = 0_lcount;
+        matchesCount = 0;
+        searchResults = {};
+        additionalResults.clear();
+        sparseLines.clear();
+    }
+
+    // Memory kept by the block for the next chunks
+    size_t allocatedSize() const
+    {
+        return lines.buffer.capacity() + lines.endOfLines.capacity() * sizeof( qint64 )
+               + buffers.utf8Lines.capacity() * sizeof( std::string_view )
+               + ( buffers.matchingOffsets.capacity() + buffers.matchingLines.capacity() )
+                     * sizeof( uint32_t );
+    }
+};
+
+// Matchers of an expression, one for each thread that matches lines.
+// They are created when a thread matches its first chunk and are kept
+// while searches use the same expression.
+template <typename Expression, typename Matcher>
+class MatcherSlots {
+  public:
+    // Called before the search starts, not while threads use the matchers
+    void prepare( std::shared_ptr<const Expression> expression )
+    {
+        if ( expression != expression_ ) {
+            matchers_.clear();
+            expression_ = std::move( expression );
+        }
+    }
+
+    Matcher& local()
+    {
+        auto& matcher = matchers_.local();
+        if ( !matcher ) {
+            matcher = expression_->createMatcher();
+        }
+        return *matcher;
+    }
+
+    template <typename Func>
+    void forEach( Func&& func )
+    {
+        for ( auto& matcher : matchers_ ) {
+            if ( matcher ) {
+                func( *matcher );
+            }
+        }
+    }
+
+  private:
+    std::shared_ptr<const Expression> expression_;
+    tbb::enumerable_thread_specific<std::unique_ptr<Matcher>> matchers_;
+};
+} // namespace
+
+// State of the search pipeline kept by the worker between searches.
+// Many searches are short updates of a followed file or of a live search,
+// they reuse compiled expressions, matchers with their scratch space
+// and small blocks of the previous search instead of creating them again.
+// Searches of a worker run one at a time, so it is not locked.
+class SearchEngine {
+  public:
+    using BlockDataType = std::shared_ptr<SearchBlockData>;
+
+    // Expression compiled for the pattern, compiled again if the pattern changes
+    std::shared_ptr<const RegularExpression> expression( const RegularExpressionPattern& pattern )
+    {
+        if ( !expression_ || !( expressionPattern_ == pattern ) ) {
+            expression_ = std::make_shared<const RegularExpression>( pattern );
+            expressionPattern_ = pattern;
+        }
+        return expression_;
+    }
+
+    std::shared_ptr<const MultiRegularExpression>
+    multiExpression( const std::vector<RegularExpressionPattern>& patterns )
+    {
+        if ( !multiExpression_ || multiExpressionPatterns_ != patterns ) {
+            multiExpression_ = std::make_shared<const MultiRegularExpression>( patterns );
+            multiExpressionPatterns_ = patterns;
+        }
+        return multiExpression_;
+    }
+
+    std::shared_ptr<const RegularExpression> entryStartExpression( const QString& pattern )
+    {
+        if ( !entryStartExpression_ || entryStartPattern_ != pattern ) {
+            entryStartExpression_
+                = std::make_shared<const RegularExpression>( RegularExpressionPattern( pattern ) );
+            entryStartPattern_ = pattern;
+        }
+        return entryStartExpression_;
+    }
+
+    MatcherSlots<RegularExpression, PatternMatcher> matchers;
+    MatcherSlots<RegularExpression, PatternMatcher> entryStartMatchers;
+    MatcherSlots<MultiRegularExpression, MultiPatternMatcher> multiMatchers;
+
+    BlockDataType acquireBlock( LineNumber start )
+    {
+        BlockDataType blockData;
+        if ( !freeBlocks_.try_pop( blockData ) ) {
+            blockData = std::make_shared<SearchBlockData>();
+        }
+        blockData->reset( start );
+        return blockData;
+    }
+
+    void releaseBlock( BlockDataType blockData )
+    {
+        freeBlocks_.push( std::move( blockData ) );
+    }
+
+    // Called after the search, blocks of large chunks are not kept,
+    // only short searches that need few lines reuse them
+    void trimBlocks()
+    {
+        std::vector<BlockDataType> blocks;
+        BlockDataType blockData;
+        while ( freeBlocks_.try_pop( blockData ) ) {
+            blocks.push_back( std::move( blockData ) );
+        }
+
+        for ( auto& block : blocks ) {
+            if ( block->allocatedSize() <= MaxKeptBlockBytes ) {
+                block->reset( 0_lnum );
+                freeBlocks_.push( std::move( block ) );
+            }
+        }
+    }
+
+  private:
+    static constexpr size_t MaxKeptBlockBytes = 1024 * 1024;
+
+    RegularExpressionPattern expressionPattern_;
+    std::shared_ptr<const RegularExpression> expression_;
+
+    std::vector<RegularExpressionPattern> multiExpressionPatterns_;
+    std::shared_ptr<const MultiRegularExpression> multiExpression_;
+
+    QString entryStartPattern_;
+    std::shared_ptr<const RegularExpression> entryStartExpression_;
+
+    tbb::concurrent_queue<BlockDataType> freeBlocks_;
 };
 
+namespace {
+
+// Matching stops when interrupt is set, results of such chunk are incomplete
+// Binary lines are seen by matchers as empty lines, they never match
+void dropBinaryLines( const std::vector<size_t>& binaryLines, std::vector<uint32_t>& offsets )
+{
+    if ( binaryLines.empty() ) {
+        return;
+    }
+    offsets.erase( std::remove_if( offsets.begin(), offsets.end(),
+                                   [ &binaryLines ]( uint32_t offset ) {
+                                       return std::binary_search( binaryLines.begin(),
+                                                                  binaryLines.end(), offset );
+                                   } ),
+                   offsets.end() );
+}
+
+void rejectBinaryLines( const std::vector<size_t>& binaryLines,
+                        std::vector<uint32_t>& rejectedOffsets )
+{
+    if ( binaryLines.empty() ) {
+        return;
+    }
+    const auto rejectedCount = rejectedOffsets.size();
+    for ( const auto index : binaryLines ) {
+        rejectedOffsets.push_back( static_cast<uint32_t>( index ) );
+    }
+    std::inplace_merge( rejectedOffsets.begin(),
+                        rejectedOffsets.begin() + static_cast<std::ptrdiff_t>( rejectedCount ),
+                        rejectedOffsets.end() );
+    rejectedOffsets.erase( std::unique( rejectedOffsets.begin(), rejectedOffsets.end() ),
+                           rejectedOffsets.end() );
+}
+
+template <typename Matcher>
+PartialSearchResults filterLines( const Matcher& matcher, const LogData::RawLines& rawLines,
+                                  LineNumber chunkStart, LineBuffers& buffers,
+                                  const AtomicFlag* interrupt )
+{
+    KLOGG_ZONE( "filterLines" );
+    PartialSearchResults results;
+    results.chunkStart = chunkStart;
+    results.processedLines = LinesCount{ rawLines.endOfLines.size() };
+
+    auto& lines = buffers.utf8Lines;
+    rawLines.buildUtf8View( lines );
+
+    auto& matchingOffsets = buffers.matchingOffsets;
+    matchingOffsets.clear();
+
+    if constexpr ( Matcher::IsInverseSearch ) {
+        auto& rejectedOffsets = matchingOffsets;
+        matcher.rejectLines( lines, rejectedOffsets, interrupt );
+        rejectBinaryLines( rawLines.binaryLines, rejectedOffsets );
+
+        auto rejected = rejectedOffsets.cbegin();
+        for ( auto offset = 0u; offset < lines.size(); ++offset ) {
+            if ( rejected != rejectedOffsets.cend() && *rejected == offset ) {
+                ++rejected;
+                continue;
+            }
+            results.maxLength = qMax( results.maxLength, getUntabifiedLength( lines[ offset ] ) );
+        }
+        results.matchingLines = makeComplementLines( chunkStart, results.processedLines,
+                                                     rejectedOffsets, buffers );
+        return results;
+    }
+
+    matcher.matchLines( lines, matchingOffsets, interrupt );
+    dropBinaryLines( rawLines.binaryLines, matchingOffsets );
+
+    for ( const auto offset : matchingOffsets ) {
+        const auto& line = lines[ offset ];
+        results.maxLength = qMax( results.maxLength, getUntabifiedLength( line ) );
+    }
+    results.matchingLines = makeMatchingLines( chunkStart, matchingOffsets, buffers );
+    return results;
+}
+
 PartialSearchResults filterLines( const PatternMatcher& matcher, const LogData::RawLines& rawLines,
-                                  LineNumber chunkStart )
+                                  LineNumber chunkStart, LineBuffers& buffers,
+                                  const AtomicFlag* interrupt )
 {
     LOG_DEBUG << "Filter lines at " << chunkStart;
+    return matcher.withSpecializedMatcher(
+        [ &rawLines, chunkStart, &buffers, interrupt ]( const auto& specialized ) {
+            return filterLines( specialized, rawLines, chunkStart, buffers, interrupt );
+        } );
+}
+
+// Giant lines are read only up to LogData::GiantLineBytes, the rest of them
+// is matched in windows of that size overlapping by GiantLineOverlapBytes,
+// so memory used by search doesn't grow with the length of lines.
+// Line matches if its start or any of its windows matches, so parts of
+// a match further apart than the overlap are not matched together.
+void matchCutLines( const PatternMatcher& matcher, bool isInverse, const LogData& logData,
+                    const LogData::RawLines& rawLines, PartialSearchResults& results,
+                    LineBuffers& buffers, const AtomicFlag* interrupt )
+{
+    LogData::RawLines window;
+    for ( const auto& cutLine : rawLines.cutLines ) {
+        const auto line = rawLines.startLine + LinesCount( cutLine.index );
+        if ( std::binary_search( rawLines.binaryLines.begin(), rawLines.binaryLines.end(),
+                                 cutLine.index ) ) {
+            continue;
+        }
+
+        // Start of the line decides a match, or an exclusion of inverse search
+        if ( results.matchingLines.contains( line.get() ) != isInverse ) {
+            continue;
+        }
+
+        for ( auto offset = cutLine.readBytes - GiantLineOverlapBytes;
+              offset < cutLine.lineBytes && !( interrupt && *interrupt );
+              offset += LogData::GiantLineBytes - GiantLineOverlapBytes ) {
+            logData.getLinePart( line, offset, LogData::GiantLineBytes, window );
+            window.buildUtf8View( buffers.utf8Lines );
+            if ( buffers.utf8Lines.empty() ) {
+                break;
+            }
+
+            if ( matcher.hasMatch( buffers.utf8Lines.front() ) != isInverse ) {
+                if ( isInverse ) {
+                    results.matchingLines.remove( line.get() );
+                }
+                else {
+                    results.matchingLines.add( line.get() );
+                }
+                break;
+            }
+        }
+    }
+}
+
+template <typename Matcher>
+uint64_t countLines( const Matcher& matcher, const LogData::RawLines& rawLines,
+                     LineBuffers& buffers, const AtomicFlag* interrupt )
+{
+    KLOGG_ZONE( "countLines" );
+    auto& lines = buffers.utf8Lines;
+    rawLines.buildUtf8View( lines );
+
+    auto& matchingOffsets = buffers.matchingOffsets;
+    matchingOffsets.clear();
+
+    if constexpr ( Matcher::IsInverseSearch ) {
+        matcher.rejectLines( lines, matchingOffsets, interrupt );
+        rejectBinaryLines( rawLines.binaryLines, matchingOffsets );
+        return lines.size() - matchingOffsets.size();
+    }
+
+    matcher.matchLines( lines, matchingOffsets, interrupt );
+    dropBinaryLines( rawLines.binaryLines, matchingOffsets );
+    return matchingOffsets.size();
+}
+
+uint64_t countLines( const PatternMatcher& matcher, const LogData::RawLines& rawLines,
+                     LineBuffers& buffers, const AtomicFlag* interrupt )
+{
+    return matcher.withSpecializedMatcher(
+        [ &rawLines, &buffers, interrupt ]( const auto& specialized ) {
+            return countLines( specialized, rawLines, buffers, interrupt );
+        } );
+}
+
+// Lines are grouped into entries that begin with lines matching entryStart,
+// text of an entry from its first to its last line is matched by the pattern
+// and only the first line of a matching entry is added to results
+PartialSearchResults filterEntries( const PatternMatcher& matcher,
+                                    const PatternMatcher& entryStart,
+                                    const LogData::RawLines& rawLines, LineNumber chunkStart,
+                                    LineBuffers& buffers, const AtomicFlag* interrupt )
+{
+    LOG_DEBUG << "Filter entries at " << chunkStart;
     PartialSearchResults results;
     results.chunkStart = chunkStart;
     results.processedLines = LinesCount{ rawLines.endOfLines.size() };
 
-    const auto& lines = rawLines.buildUtf8View();
+    auto& lines = buffers.utf8Lines;
+    rawLines.buildUtf8View( lines );
+
+    auto& matchingOffsets = buffers.matchingOffsets;
+    matchingOffsets.clear();
+
+    // Lines of a chunk are parts of one buffer, so entry is
+    // the text between them including line feeds
+    const auto matchEntry = [ & ]( size_t firstLine, size_t lastLine ) {
+        const auto* entryBegin = lines[ firstLine ].data();
+        const auto* entryEnd = lines[ lastLine ].data() + lines[ lastLine ].size();
+        const auto entry
+            = std::string_view( entryBegin, static_cast<size_t>( entryEnd - entryBegin ) );
 
+        if ( matcher.hasMatch( entry ) ) {
+            results.maxLength
+                = qMax( results.maxLength, getUntabifiedLength( lines[ firstLine ] ) );
+            matchingOffsets.push_back( static_cast<uint32_t>( firstLine ) );
+        }
+    };
+
+    if ( lines.empty() ) {
+        return results;
+    }
+
+    matching::InterruptCheck interruptCheck( interrupt );
+    size_t entryFirstLine = 0;
+    for ( auto offset = 1u; offset < lines.size(); ++offset ) {
+        if ( entryStart.hasMatch( lines[ offset ] ) ) {
+            matchEntry( entryFirstLine, offset - 1 );
+            entryFirstLine = offset;
+        }
+        if ( interruptCheck.isInterrupted( lines[ offset ] ) ) {
+            return results;
+        }
+    }
+    matchEntry( entryFirstLine, lines.size() - 1 );
+
+    results.matchingLines = makeMatchingLines( chunkStart, matchingOffsets, buffers );
+    return results;
+}
+
+// First results are for the main pattern, then one per additional pattern
+std::vector<PartialSearchResults> filterLines( const MultiPatternMatcher& matcher,
+                                               size_t patternsCount,
+                                               const LogData::RawLines& rawLines,
+                                               LineNumber chunkStart, LineBuffers& buffers,
+                                               const AtomicFlag* interrupt )
+{
+    KLOGG_ZONE( "filterLines multiple patterns" );
+    LOG_DEBUG << "Filter lines with " << patternsCount << " patterns at " << chunkStart;
+    std::vector<PartialSearchResults> results( patternsCount );
+    for ( auto& patternResults : results ) {
+        patternResults.chunkStart = chunkStart;
+        patternResults.processedLines = LinesCount{ rawLines.endOfLines.size() };
+    }
+
+    auto& lines = buffers.utf8Lines;
+    rawLines.buildUtf8View( lines );
+
+    std::vector<std::vector<uint32_t>> matchingOffsets( patternsCount );
+    MatchedPatterns matches( patternsCount, 0 );
+    matching::InterruptCheck interruptCheck( interrupt );
     for ( auto offset = 0u; offset < lines.size(); ++offset ) {
         const auto& line = lines[ offset ];
+        if ( interruptCheck.isInterrupted( line ) ) {
+            break;
+        }
 
-        const auto hasMatch = matcher.hasMatch( line );
-
-        if ( hasMatch ) {
-            results.maxLength = qMax( results.maxLength, getUntabifiedLength( line ) );
-            const auto lineNumber = chunkStart + LinesCount{ offset };
-            results.matchingLines.add( lineNumber.get() );
+        matcher.match( line, matches );
 
-            // LOG_INFO << "Match at " << lineNumber << ": " << line;
+        for ( auto index = 0u; index < patternsCount; ++index ) {
+            if ( matches[ index ] ) {
+                auto& patternResults = results[ index ];
+                patternResults.maxLength
+                    = qMax( patternResults.maxLength, getUntabifiedLength( line ) );
+                matchingOffsets[ index ].push_back( offset );
+            }
         }
     }
+
+    for ( auto index = 0u; index < patternsCount; ++index ) {
+        results[ index ].matchingLines
+            = makeMatchingLines( chunkStart, matchingOffsets[ index ], buffers );
+    }
     return results;
 }
 
+// Hashes of trigrams every matching line must contain,
+// empty if pattern is not a simple text search
+TrigramFilter::Hashes requiredTrigrams( const RegularExpressionPattern& pattern )
+{
+    if ( !Configuration::get().useTrigramIndex() || !pattern.isPlainText || pattern.isExclude
+         || pattern.isBoolean ) {
+        return {};
+    }
+
+    const auto text = pattern.pattern.toUtf8();
+    return TrigramFilter::textHashes(
+        std::string_view( text.constData(), static_cast<size_t>( text.size() ) ),
+        pattern.isCaseSensitive );
+}
+
 } // namespace
 
 SearchResults SearchData::takeCurrentResults() const
@@ -132,15 +694,36 @@ SearchResults SearchData::takeCurrentResults() const
     return SearchResults{ std::exchange( newMatches_, {} ), maxLength_, nbLinesProcessed_ };
 }
 
-void SearchData::addAll( LineLength length, const SearchResultArray& matches, LinesCount lines )
+void SearchData::startProcessingAt( LineNumber line )
+{
+    UniqueLock lock( dataMutex_ );
+
+    nbLinesProcessed_ = qMax( nbLinesProcessed_, LinesCount( line.get() ) );
+    completedRanges_.clear();
+}
+
+void SearchData::addAll( LineLength length, const SearchResultArray& matches,
+                         LineNumber chunkStart, LinesCount chunkLines )
 {
     UniqueLock lock( dataMutex_ );
 
     maxLength_ = qMax( maxLength_, length );
-    nbLinesProcessed_ = qMax( nbLinesProcessed_, lines );
     nbMatches_ += LinesCount( matches.cardinality() );
 
     newMatches_ |= matches;
+
+    const auto chunkEnd = ( chunkStart + chunkLines ).get();
+    if ( chunkStart.get() > nbLinesProcessed_.get() ) {
+        completedRanges_.emplace( chunkStart.get(), chunkEnd );
+        return;
+    }
+
+    nbLinesProcessed_ = qMax( nbLinesProcessed_, LinesCount( chunkEnd ) );
+    auto range = completedRanges_.begin();
+    while ( range != completedRanges_.end() && range->first <= nbLinesProcessed_.get() ) {
+        nbLinesProcessed_ = qMax( nbLinesProcessed_, LinesCount( range->second ) );
+        range = completedRanges_.erase( range );
+    }
 }
 
 LinesCount SearchData::getNbMatches() const
@@ -161,19 +744,83 @@ void SearchData::deleteMatch( LineNumber line )
     matches_.remove( line.get() );
 }
 
+void SearchData::resetAdditionalResults( size_t patternsCount )
+{
+    UniqueLock lock( dataMutex_ );
+    additionalResults_.assign( patternsCount, {} );
+}
+
+void SearchData::addAdditionalMatches( size_t patternIndex, LineLength length,
+                                       const SearchResultArray& matches )
+{
+    UniqueLock lock( dataMutex_ );
+
+    auto& results = additionalResults_.at( patternIndex );
+    results.maxLength = qMax( results.maxLength, length );
+    results.matches |= matches;
+}
+
+std::vector<AdditionalSearchResults> SearchData::takeAdditionalResults()
+{
+    UniqueLock lock( dataMutex_ );
+    return std::exchange( additionalResults_, {} );
+}
+
+void SearchData::addStageMatches( SearchResultArray matches )
+{
+    UniqueLock lock( dataMutex_ );
+    stageMatches_.push_back( std::move( matches ) );
+}
+
+std::vector<SearchResultArray> SearchData::takeStageMatches()
+{
+    UniqueLock lock( dataMutex_ );
+    return std::exchange( stageMatches_, {} );
+}
+
+void SearchData::setEstimate( SearchEstimate estimate )
+{
+    UniqueLock lock( dataMutex_ );
+    estimate_ = std::move( estimate );
+}
+
+std::optional<SearchEstimate> SearchData::getEstimate() const
+{
+    SharedLock lock( dataMutex_ );
+    return estimate_;
+}
+
+std::vector<uint64_t> SearchData::addSubPatternHits( const std::vector<uint64_t>& hits )
+{
+    UniqueLock lock( dataMutex_ );
+    if ( subPatternHits_.size() != hits.size() ) {
+        subPatternHits_.assign( hits.size(), 0 );
+    }
+    std::transform( subPatternHits_.begin(), subPatternHits_.end(), hits.begin(),
+                    subPatternHits_.begin(), std::plus<>() );
+    return subPatternHits_;
+}
+
 void SearchData::clear()
 {
     UniqueLock locker( dataMutex_ );
 
+    additionalResults_.clear();
+    stageMatches_.clear();
+    estimate_.reset();
+    subPatternHits_.clear();
+
     maxLength_ = LineLength( 0 );
     nbLinesProcessed_ = LinesCount( 0 );
     nbMatches_ = LinesCount( 0 );
+    completedRanges_.clear();
     matches_ = {};
     newMatches_ = {};
 }
 
 LogFilteredDataWorker::LogFilteredDataWorker( const LogData& sourceLogData )
     : sourceLogData_( sourceLogData )
+    , searchEngine_( std::make_unique<SearchEngine>() )
 {
     operationsPool_.setMaxThreadCount(1);
 }
@@ -181,7 +828,7 @@ LogFilteredDataWorker::LogFilteredDataWorker( const LogData& sourceLogData )
 LogFilteredDataWorker::~LogFilteredDataWorker() noexcept
 {
     try {
-        interruptRequested_.set();
+        interrupt();
         ScopedLock locker( operationsMutex_ );
         operationsPool_.waitForDone();
         LOG_INFO << "LogFilteredDataWorker shutdown";
@@ -190,63 +837,212 @@ LogFilteredDataWorker::~LogFilteredDataWorker() noexcept
     }
 }
 
+void LogFilteredDataWorker::waitForPreviousOperation()
+{
+    const auto waitStartTime = std::chrono::steady_clock::now();
+    operationsPool_.waitForDone();
+
+    const auto waitDuration = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - waitStartTime );
+    if ( waitDuration.count() > 0 ) {
+        LOG_INFO << "Previous search stopped in " << waitDuration.count() << " ms";
+    }
+}
+
 void LogFilteredDataWorker::connectSignalsAndRun( SearchOperation* operationRequested )
 {
     connect( operationRequested, &SearchOperation::searchProgressed, this,
              &LogFilteredDataWorker::searchProgressed );
+    connect( operationRequested, &SearchOperation::searchEstimated, this,
+             &LogFilteredDataWorker::searchEstimated );
     connect( operationRequested, &SearchOperation::searchFinished, this,
              &LogFilteredDataWorker::searchFinished, Qt::QueuedConnection );
 
+    operationRequested->setSearchEngine( searchEngine_.get() );
     operationRequested->run( searchData_ );
     operationRequested->disconnect( this );
 }
 
 void LogFilteredDataWorker::search( const RegularExpressionPattern& regExp, LineNumber startLine,
-                                    LineNumber endLine )
+                                    LineNumber endLine, bool followIndexing,
+                                    const std::vector<RegularExpressionPattern>& additionalPatterns,
+                                    std::shared_ptr<const RegularExpression> compiledExpression,
+                                    OptionalLineNumber focusLine, PatternSearchResults termResults,
+                                    std::optional<SearchLimit> limit )
 {
     ScopedLock locker( operationsMutex_ ); // to protect operationRequested_
-    operationsPool_.waitForDone();
+    waitForPreviousOperation();
     interruptRequested_.clear();
 
     LOG_INFO << "Search requested";
     QSemaphore operationStarted;
     operationsPool_.start(
-        createRunnable( [ this, &operationStarted, regExp, startLine, endLine ] {
+        createRunnable( [ this, &operationStarted, regExp, startLine, endLine, followIndexing,
+                          additionalPatterns, compiledExpression, focusLine,
+                          termResults = std::move( termResults ), limit ] {
             operationStarted.release();
             ScopedLock operationLock( operationsMutex_ );
             auto operationRequested = std::make_unique<FullSearchOperation>(
-                sourceLogData_, interruptRequested_, regExp, startLine, endLine );
+                sourceLogData_, interruptRequested_, regExp, startLine, endLine, followIndexing,
+                additionalPatterns, compiledExpression, focusLine, termResults, limit );
+            connectSignalsAndRun( operationRequested.get() );
+        } ) );
+    operationStarted.acquire();
+}
+
+void LogFilteredDataWorker::prerunSearch( const std::vector<RegularExpressionPattern>& patterns,
+                                          LineNumber startLine, LineNumber endLine )
+{
+    ScopedLock locker( operationsMutex_ ); // to protect operationRequested_
+    waitForPreviousOperation();
+    interruptRequested_.clear();
+
+    LOG_INFO << "Prerun search of " << patterns.size() << " patterns requested";
+    QSemaphore operationStarted;
+    operationsPool_.start(
+        createRunnable( [ this, &operationStarted, patterns, startLine, endLine ] {
+            operationStarted.release();
+            ScopedLock operationLock( operationsMutex_ );
+            auto operationRequested = std::make_unique<PrerunSearchOperation>(
+                sourceLogData_, interruptRequested_, patterns, startLine, endLine );
             connectSignalsAndRun( operationRequested.get() );
         } ) );
     operationStarted.acquire();
 }
 
-void LogFilteredDataWorker::updateSearch( const RegularExpressionPattern& regExp,
+void LogFilteredDataWorker::refineSearch( const RegularExpressionPattern& regExp,
                                           LineNumber startLine, LineNumber endLine,
-                                          LineNumber position )
+                                          SearchResultArray previousMatches )
 {
     ScopedLock locker( operationsMutex_ ); // to protect operationRequested_
-    operationsPool_.waitForDone();
+    waitForPreviousOperation();
     interruptRequested_.clear();
-    
-    LOG_INFO << "Search update requested from " << position.get();
 
+    LOG_INFO << "Refine search requested";
+    QSemaphore operationStarted;
+    operationsPool_.start( createRunnable( [ this, &operationStarted, regExp, startLine, endLine,
+                                             previousMatches = std::move( previousMatches ) ] {
+        operationStarted.release();
+        ScopedLock operationLock( operationsMutex_ );
+        auto operationRequested = std::make_unique<RefineSearchOperation>(
+            sourceLogData_, interruptRequested_, regExp, startLine, endLine, previousMatches );
+        connectSignalsAndRun( operationRequested.get() );
+    } ) );
+    operationStarted.acquire();
+}
+
+void LogFilteredDataWorker::runFilterChain( const std::vector<RegularExpressionPattern>& stages,
+                                            LineNumber startLine, LineNumber endLine,
+                                            std::optional<SearchResultArray> scope )
+{
+    ScopedLock locker( operationsMutex_ ); // to protect operationRequested_
+    waitForPreviousOperation();
+    interruptRequested_.clear();
+
+    LOG_INFO << "Filter chain of " << stages.size() << " stages requested";
+    QSemaphore operationStarted;
+    operationsPool_.start( createRunnable(
+        [ this, &operationStarted, stages, startLine, endLine, scope = std::move( scope ) ] {
+            operationStarted.release();
+            ScopedLock operationLock( operationsMutex_ );
+            auto operationRequested = std::make_unique<FilterChainOperation>(
+                sourceLogData_, interruptRequested_, stages, startLine, endLine, scope );
+            connectSignalsAndRun( operationRequested.get() );
+        } ) );
+    operationStarted.acquire();
+}
+
+void LogFilteredDataWorker::countMatches( const RegularExpressionPattern& regExp,
+                                          LineNumber startLine, LineNumber endLine )
+{
+    ScopedLock locker( operationsMutex_ ); // to protect operationRequested_
+    waitForPreviousOperation();
+    interruptRequested_.clear();
+
+    LOG_INFO << "Count of matches requested";
     QSemaphore operationStarted;
     operationsPool_.start(
-        createRunnable( [ this, &operationStarted, regExp, startLine, endLine, position ] {
+        createRunnable( [ this, &operationStarted, regExp, startLine, endLine ] {
             operationStarted.release();
             ScopedLock operationLock( operationsMutex_ );
-            auto operationRequested = std::make_unique<UpdateSearchOperation>(
-                sourceLogData_, interruptRequested_, regExp, startLine, endLine, position );
+            auto operationRequested = std::make_unique<CountSearchOperation>(
+                sourceLogData_, interruptRequested_, regExp, startLine, endLine );
             connectSignalsAndRun( operationRequested.get() );
         } ) );
+    operationStarted.acquire();
+}
 
+void LogFilteredDataWorker::extendSearch( const RegularExpressionPattern& regExp,
+                                          LineNumber startLine, LineNumber endLine,
+                                          LineNumber position, LineLength cachedMaxLength )
+{
+    ScopedLock locker( operationsMutex_ ); // to protect operationRequested_
+    waitForPreviousOperation();
+    interruptRequested_.clear();
+
+    LOG_INFO << "Search extension requested from " << position.get();
+    QSemaphore operationStarted;
+    operationsPool_.start( createRunnable(
+        [ this, &operationStarted, regExp, startLine, endLine, position, cachedMaxLength ] {
+            operationStarted.release();
+            ScopedLock operationLock( operationsMutex_ );
+            auto operationRequested = std::make_unique<ExtendSearchOperation>(
+                sourceLogData_, interruptRequested_, regExp, startLine, endLine, position,
+                cachedMaxLength );
+            connectSignalsAndRun( operationRequested.get() );
+        } ) );
     operationStarted.acquire();
 }
 
+bool LogFilteredDataWorker::updateSearch( const RegularExpressionPattern& regExp,
+                                          LineNumber startLine, LineNumber endLine,
+                                          LineNumber position )
+{
+    ScopedLock locker( pendingUpdateMutex_ );
+    if ( pendingUpdate_ ) {
+        LOG_DEBUG << "Search update merged up to " << endLine.get();
+        pendingUpdate_->regExp = regExp;
+        pendingUpdate_->startLine = startLine;
+        pendingUpdate_->endLine = qMax( pendingUpdate_->endLine, endLine );
+        pendingUpdate_->position = qMin( pendingUpdate_->position, position );
+        return false;
+    }
+
+    LOG_INFO << "Search update requested from " << position.get();
+
+    // Operations run one at a time, so the update starts after the current one
+    // without waiting for it here
+    pendingUpdate_ = PendingUpdate{ regExp, startLine, endLine, position };
+    operationsPool_.start( createRunnable( [ this ] { runPendingUpdate(); } ) );
+    return true;
+}
+
+// Called in the pool thread
+void LogFilteredDataWorker::runPendingUpdate()
+{
+    std::optional<PendingUpdate> update;
+    {
+        ScopedLock locker( pendingUpdateMutex_ );
+        update = std::exchange( pendingUpdate_, std::nullopt );
+        if ( !update ) {
+            LOG_DEBUG << "Search update was interrupted before it started";
+            return;
+        }
+        // Interruption takes the same lock, so it can't be lost here
+        interruptRequested_.clear();
+    }
+
+    auto operationRequested = std::make_unique<UpdateSearchOperation>(
+        sourceLogData_, interruptRequested_, update->regExp, update->startLine, update->endLine,
+        update->position );
+    connectSignalsAndRun( operationRequested.get() );
+}
+
 void LogFilteredDataWorker::interrupt()
 {
     LOG_INFO << "Search interruption requested";
+    ScopedLock locker( pendingUpdateMutex_ );
+    pendingUpdate_.reset();
     interruptRequested_.set();
 }
 
@@ -256,21 +1052,258 @@ SearchResults LogFilteredDataWorker::getSearchResults() const
     return searchData_.takeCurrentResults();
 }
 
+std::vector<AdditionalSearchResults> LogFilteredDataWorker::getAdditionalSearchResults()
+{
+    return searchData_.takeAdditionalResults();
+}
+
+std::vector<SearchResultArray> LogFilteredDataWorker::getFilterStageMatches()
+{
+    return searchData_.takeStageMatches();
+}
+
+std::optional<SearchEstimate> LogFilteredDataWorker::getSearchEstimate() const
+{
+    return searchData_.getEstimate();
+}
+
 //
 // Operations implementation
 //
 
 SearchOperation::SearchOperation( const LogData& sourceLogData, AtomicFlag& interruptRequested,
                                   const RegularExpressionPattern& regExp, LineNumber startLine,
-                                  LineNumber endLine )
+                                  LineNumber endLine, bool followIndexing,
+                                  std::vector<RegularExpressionPattern> additionalPatterns,
+                                  std::shared_ptr<const RegularExpression> compiledExpression )
 
     : interruptRequested_( interruptRequested )
     , regexp_( regExp )
     , sourceLogData_( sourceLogData )
     , startLine_( startLine )
     , endLine_( endLine )
+    , followIndexing_( followIndexing )
+    , additionalPatterns_( std::move( additionalPatterns ) )
+    , compiledExpression_( std::move( compiledExpression ) )
+
+{
+    // Lines added while searching are not in the field index yet
+    if ( !regexp_.isExclude && !followIndexing_ && additionalPatterns_.empty() ) {
+        fieldConditions_ = parseFieldQuery( regexp_.pattern, sourceLogData_.getIndexedFields() );
+    }
+}
+
+bool SearchOperation::searchFieldIndex( SearchData& searchData, LineNumber initialLine,
+                                        LineNumber endLine )
+{
+    using namespace std::chrono;
+    const auto startTime = high_resolution_clock::now();
+
+    endLine = qMax( initialLine, endLine );
+    auto matches = sourceLogData_.findLinesWithFields( *fieldConditions_, initialLine, endLine );
+    if ( !matches ) {
+        LOG_INFO << "Field index does not have all lines, searching text";
+        return false;
+    }
+
+    if ( searchScope_ ) {
+        *matches &= *searchScope_;
+    }
+
+    // Matching lines are not read, so their length is not known
+    const auto maxLength = matches->isEmpty() ? 0_length : sourceLogData_.getMaxLength();
+    searchData.addAll( maxLength, *matches, initialLine, endLine - initialLine );
+
+    OperationStats stats;
+    stats.duration = duration_cast<microseconds>( high_resolution_clock::now() - startTime );
+    stats.updatePeakMemory();
+
+    LOG_INFO << "Searched field index in " << stats.duration << ", found "
+             << matches->cardinality() << " lines";
+
+    Q_EMIT searchProgressed( searchData.getNbMatches(), 100, initialLine );
+    Q_EMIT searchFinished( stats );
+    return true;
+}
+
+bool SearchOperation::planSearch( SearchData& searchData, const RegularExpression& expression,
+                                  LineNumber initialLine, LineNumber endLine )
+{
+    const auto& terms = expression.subPatterns();
+    if ( !expression.isValid() || expression.isJsonQuery() || terms.size() > SearchPlanner::MaxTerms
+         || initialLine >= endLine ) {
+        return false;
+    }
+
+    using namespace std::chrono;
+    const auto startTime = high_resolution_clock::now();
+
+    std::optional<BooleanExpressionEvaluator> evaluator;
+    if ( expression.isBooleanCombination() ) {
+        evaluator.emplace( expression.expression().toStdString(), terms );
+    }
+    const auto evaluate = [ &evaluator, &expression ]( std::string_view matchedTerms ) {
+        const auto isMatched
+            = evaluator ? evaluator->evaluate( matchedTerms ) : matchedTerms.front() != 0;
+        return isMatched != expression.isInverse();
+    };
+
+    // Earlier results are exact, token index only has candidates
+    SearchPlanner planner( terms.size(), evaluate, initialLine, endLine );
+    for ( auto term = 0u; term < terms.size(); ++term ) {
+        const auto& pattern = terms[ term ];
+        const auto termResults = std::find_if(
+            termResults_.begin(), termResults_.end(),
+            [ &pattern ]( const auto& results ) { return results.first == pattern; } );
+        if ( termResults != termResults_.end() ) {
+            planner.setMatchingLines( term, termResults->second );
+        }
+        else if ( pattern.isPlainText && !pattern.isExclude ) {
+            auto tokenLines
+                = sourceLogData_.findLinesWithToken( pattern.pattern, initialLine, endLine );
+            if ( tokenLines ) {
+                planner.setCandidateLines( term, std::move( *tokenLines ) );
+            }
+        }
+    }
+
+    auto plan = planner.plan();
+    if ( !plan ) {
+        return false;
+    }
+
+    if ( searchScope_ ) {
+        plan->matchingLines &= *searchScope_;
+        plan->scannedLines &= *searchScope_;
+    }
+    else if ( plan->matchingLines.isEmpty()
+              && plan->scannedLines.cardinality() == ( endLine - initialLine ).get() ) {
+        LOG_INFO << "Search plan has to match all lines";
+        return false;
+    }
+
+    LOG_INFO << "Search plan matches " << plan->matchingLines.cardinality()
+             << " lines without reading them, " << plan->scannedLines.cardinality()
+             << " lines have to be matched";
+
+    // Matching lines are not read, so their length is not known
+    if ( !plan->matchingLines.isEmpty() ) {
+        searchData.addAll( sourceLogData_.getMaxLength(), plan->matchingLines, initialLine,
+                           0_lcount );
+    }
+
+    if ( !plan->scannedLines.isEmpty() ) {
+        searchScope_ = std::move( plan->scannedLines );
+        return false;
+    }
 
+    searchData.addAll( 0_length, {}, initialLine, endLine - initialLine );
+
+    OperationStats stats;
+    stats.duration = duration_cast<microseconds>( high_resolution_clock::now() - startTime );
+    stats.updatePeakMemory();
+
+    LOG_INFO << "Searched indexes in " << stats.duration;
+
+    Q_EMIT searchProgressed( searchData.getNbMatches(), 100, initialLine );
+    Q_EMIT searchFinished( stats );
+    return true;
+}
+
+void SearchOperation::estimateMatches( SearchData& searchData, const PatternMatcher& matcher,
+                                       LineNumber initialLine, LineNumber endLine,
+                                       uint32_t matchingThreads )
 {
+    using namespace std::chrono;
+    const auto startTime = high_resolution_clock::now();
+
+    const auto nbLines = ( endLine - initialLine ).get();
+    const auto partLines = nbLines / EstimateParts;
+    const auto sampleLines = qBound( LinesCount::UnderlyingType{ 1 }, partLines / 100,
+                                     EstimateMaxPartLines );
+
+    // Parts are sampled in random order, so the ones sampled
+    // before the time is out are spread over the whole file
+    std::vector<size_t> parts( EstimateParts );
+    std::iota( parts.begin(), parts.end(), size_t{ 0 } );
+    std::mt19937_64 random{ std::random_device{}() };
+    std::shuffle( parts.begin(), parts.end(), random );
+
+    std::vector<std::optional<float>> partDensity( EstimateParts );
+    LinesCount sampledLines = 0_lcount;
+    LinesCount sampledMatches = 0_lcount;
+    uint64_t sampledBytes = 0;
+    microseconds matchDuration{ 0 };
+    LineBuffers buffers;
+    LogData::RawLines rawLines;
+    for ( const auto part : parts ) {
+        if ( interruptRequested_ || high_resolution_clock::now() - startTime > EstimateDuration ) {
+            break;
+        }
+
+        std::uniform_int_distribution<LinesCount::UnderlyingType> offset(
+            0, partLines - sampleLines );
+        const auto sampleStart = initialLine + LinesCount( part * partLines + offset( random ) );
+        sourceLogData_.getLinesRaw( sampleStart, LinesCount( sampleLines ), rawLines,
+                                    LogData::LineLimit::Search );
+        if ( rawLines.endOfLines.empty() ) {
+            continue;
+        }
+
+        const auto matchStartTime = high_resolution_clock::now();
+        const auto results
+            = filterLines( matcher, rawLines, sampleStart, buffers, &interruptRequested_ );
+        matchDuration
+            += duration_cast<microseconds>( high_resolution_clock::now() - matchStartTime );
+        sampledBytes += rawLines.data().size();
+
+        const auto matches = results.matchingLines.cardinality();
+        partDensity[ part ]
+            = static_cast<float>( matches ) / static_cast<float>( rawLines.endOfLines.size() );
+        sampledLines += LinesCount{ rawLines.endOfLines.size() };
+        sampledMatches += LinesCount{ matches };
+    }
+
+    if ( interruptRequested_ || sampledLines.get() == 0 ) {
+        return;
+    }
+
+    const auto averageDensity
+        = static_cast<float>( sampledMatches.get() ) / static_cast<float>( sampledLines.get() );
+
+    SearchEstimate estimate;
+    estimate.sampledLines = sampledLines;
+    estimate.startLine = initialLine;
+    estimate.endLine = endLine;
+    estimate.density.reserve( EstimateParts );
+    for ( const auto& density : partDensity ) {
+        estimate.density.push_back( density.value_or( averageDensity ) );
+    }
+    estimate.matches = LinesCount( static_cast<LinesCount::UnderlyingType>(
+        std::llround( static_cast<double>( averageDensity ) * static_cast<double>( nbLines ) ) ) );
+
+    // Sampled lines are matched by one thread, the search spreads them over all threads
+    estimate.engine = matcher.engineName();
+    const auto matchSeconds
+        = std::max( static_cast<double>( matchDuration.count() ), 1. ) / 1'000'000.;
+    estimate.bytesPerSecond
+        = static_cast<uint64_t>( static_cast<double>( sampledBytes ) / matchSeconds );
+    const auto estimatedBytes = static_cast<double>( sampledBytes ) * static_cast<double>( nbLines )
+                                / static_cast<double>( sampledLines.get() );
+    estimate.duration = milliseconds( std::llround(
+        1000. * estimatedBytes
+        / ( static_cast<double>( std::max( estimate.bytesPerSecond, uint64_t{ 1 } ) )
+            * std::max( matchingThreads, 1u ) ) ) );
+
+    LOG_INFO << "Estimated " << estimate.matches << " matches from " << sampledLines
+             << " lines in "
+             << duration_cast<milliseconds>( high_resolution_clock::now() - startTime ).count()
+             << " ms, " << estimate.engine << " matches " << estimate.bytesPerSecond
+             << " bytes/s, search takes at least " << estimate.duration.count() << " ms";
+
+    const auto estimatedMatches = estimate.matches;
+    searchData.setEstimate( std::move( estimate ) );
+    Q_EMIT searchEstimated( estimatedMatches );
 }
 
 void SearchOperation::doSearch( SearchData& searchData, LineNumber initialLine )
@@ -283,78 +1316,289 @@ void SearchOperation::doSearch( SearchData& searchData, LineNumber initialLine )
     high_resolution_clock::time_point t1 = high_resolution_clock::now();
 
     const auto& config = Configuration::get();
-    const auto matchingThreadsCount = static_cast<uint32_t>( [ &config ]() {
+    const auto tunedParameters = DeviceTuning::get().parameters( sourceLogData_.getFileName() );
+    const auto matchingThreadsCount = static_cast<uint32_t>( [ &config, &tunedParameters ]() {
         if ( !config.useParallelSearch() ) {
             return 1;
         }
-        const auto configuredThreadPoolSize = config.searchThreadPoolSize();
-        return qMax( 1, configuredThreadPoolSize == 0 ? tbb::info::default_concurrency()
+        const auto configuredThreadPoolSize = tunedParameters.searchThreadPoolSize;
+        return qMax( 1, configuredThreadPoolSize == 0 ? tbb::this_task_arena::max_concurrency()
                                                       : configuredThreadPoolSize );
     }() );
 
-    LOG_INFO << "Using " << matchingThreadsCount << " matching threads";
+    // Readers fetch disjoint chunks with positional reads that do not lock the file
+    const auto readerThreadsCount = qBound( 1u, matchingThreadsCount / 2, MaxReaderThreads );
+
+    LOG_INFO << "Using " << matchingThreadsCount << " matching threads and "
+             << readerThreadsCount << " reader threads";
+
+    PipelineTrace trace( "search" );
+    std::atomic<int64_t> queuedBlocks{ 0 };
+    std::atomic<int64_t> matchedBlocks{ 0 };
 
     tbb::flow::graph searchGraph;
 
     if ( initialLine < startLine_ ) {
         initialLine = startLine_;
     }
+    searchData.startProcessingAt( initialLine );
+
+    auto endLine = qMin( LineNumber( nbSourceLines.get() ), endLine_ );
+
+    // Bounded search reads chunks in order until it has enough matches,
+    // lines found by indexes could be before or after them
+    const auto isFromEnd = limit_ && limit_->direction == SearchLimit::Direction::FromEnd;
+
+    if ( fieldConditions_ && !limit_ && !isCountOnly_ && config.searchEntryStartPattern().isEmpty()
+         && searchFieldIndex( searchData, initialLine, endLine ) ) {
+        return;
+    }
+
+    // Worker keeps the engine between searches, it is only missing
+    // if the operation runs on its own
+    SearchEngine ownEngine;
+    auto& engine = searchEngine_ ? *searchEngine_ : ownEngine;
+
+    // Expression can be shared with searches of other files
+    const auto regularExpression
+        = compiledExpression_ ? compiledExpression_ : engine.expression( regexp_ );
+
+    // Only lines the indexes can't resolve are read and matched
+    if ( !followIndexing_ && additionalPatterns_.empty() && !limit_ && !isCountOnly_
+         && config.searchEntryStartPattern().isEmpty()
+         && planSearch( searchData, *regularExpression, initialLine, endLine ) ) {
+        return;
+    }
 
-    const auto endLine = qMin( LineNumber( nbSourceLines.get() ), endLine_ );
-    const auto nbLinesInChunk = LinesCount(
-        static_cast<LinesCount::UnderlyingType>( config.searchReadBufferSizeLines() ) );
+    // Chunks are sized in bytes by measured matching throughput, so that chunks
+    // of short and long lines take about the same time to match,
+    // configured search buffer only limits the number of lines in a chunk
+    const auto maxLinesInChunk = static_cast<LinesCount::UnderlyingType>(
+        qMax( 1, tunedParameters.searchReadBufferSizeLines ) );
+    auto chunkBytes = MaxChunkBytes;
+    auto nbLinesInChunk = LinesCount( maxLinesInChunk );
+
+    // Average size of lines read last, first estimated for the whole file
+    std::atomic<uint64_t> lineBytes{
+        static_cast<uint64_t>( qMax( qint64{ 1 }, sourceLogData_.getFileSize() ) )
+        / qMax( LinesCount::UnderlyingType{ 1 }, nbSourceLines.get() ) };
+    const auto updateLineBytes = [ &lineBytes ]( uint64_t bytes, size_t lines ) {
+        if ( lines > 0 ) {
+            lineBytes = qMax( uint64_t{ 1 }, bytes / static_cast<uint64_t>( lines ) );
+        }
+    };
 
     std::chrono::microseconds fileReadingDuration{ 0 };
+    tbb::enumerable_thread_specific<microseconds> threadReadDurations( microseconds{ 0 } );
+    std::atomic<uint64_t> bytesRead{ 0 };
+    OperationStats stats;
+    stats.updatePeakMemory();
 
     using BlockDataType = std::shared_ptr<SearchBlockData>;
     auto blockPrefetcher
         = tbb::flow::limiter_node<BlockDataType>( searchGraph, matchingThreadsCount * 3 );
 
+    auto readQueue = tbb::flow::buffer_node<BlockDataType>( searchGraph );
+
+    // Chunks are read in parallel and queued for matchers in the order
+    // the reads finish, results are combined in any order
+    // except for bounded search, see combineLimitedResults
+    auto lineReader
+        = tbb::flow::function_node<BlockDataType, BlockDataType, tbb::flow::rejecting>(
+            searchGraph, readerThreadsCount, [ & ]( const BlockDataType& blockData ) {
+                if ( interruptRequested_ || blockData->linesToRead.get() == 0 ) {
+                    return blockData;
+                }
+
+                const auto readStartTime = high_resolution_clock::now();
+                sourceLogData_.getLinesRaw( blockData->chunkStart, blockData->linesToRead,
+                                            blockData->lines, LogData::LineLimit::Search );
+                updateLineBytes( blockData->lines.data().size(),
+                                 blockData->lines.endOfLines.size() );
+                bytesRead += blockData->lines.data().size();
+
+                const auto readEndTime = high_resolution_clock::now();
+                threadReadDurations.local()
+                    += duration_cast<microseconds>( readEndTime - readStartTime );
+                trace.addSpan( "read", readStartTime, readEndTime );
+                return blockData;
+            } );
+
     auto lineBlocksQueue = tbb::flow::buffer_node<BlockDataType>( searchGraph );
 
-    using RegexMatcherNode
-        = tbb::flow::function_node<BlockDataType, BlockDataType, tbb::flow::rejecting>;
+    // Blocks are returned to the engine after their results are combined
+    // and filled again with next chunks, limiter bounds their number
+    const auto acquireBlock
+        = [ &engine ]( LineNumber start ) { return engine.acquireBlock( start ); };
 
+    // Any free thread takes the next chunk and uses its own matcher,
+    // matchers of the previous search are reused for the same expression
     using PatternMatcherPtr = std::unique_ptr<PatternMatcher>;
-    using MatcherContext = std::tuple<PatternMatcherPtr, microseconds, RegexMatcherNode>;
-
-    std::vector<MatcherContext> regexMatchers;
-    RegularExpression regularExpression{ regexp_ };
-    for ( auto index = 0u; index < matchingThreadsCount; ++index ) {
-        regexMatchers.emplace_back(
-            regularExpression.createMatcher(), microseconds{ 0 },
-            RegexMatcherNode(
-                searchGraph, 1, [ &regexMatchers, index, this ]( const BlockDataType& blockData ) {
-                    if ( interruptRequested_ ) {
-                        LOG_INFO << "Matcher " << index << " interrupted";
-                        auto results = std::make_shared<PartialSearchResults>();
+    engine.matchers.prepare( regularExpression );
+    engine.matchers.forEach( []( PatternMatcher& matcher ) { matcher.resetSubPatternHits(); } );
+
+    // Additional patterns are compiled with the main one
+    // into a single database to match all of them in one scan
+    std::vector<RegularExpressionPattern> allPatterns;
+    if ( !additionalPatterns_.empty() ) {
+        allPatterns.push_back( regexp_ );
+        allPatterns.insert( allPatterns.end(), additionalPatterns_.begin(),
+                            additionalPatterns_.end() );
+    }
+
+    const auto multiExpression = engine.multiExpression( allPatterns );
+    if ( !allPatterns.empty() && !multiExpression->isValid() ) {
+        LOG_WARNING << "Can't search additional patterns: " << multiExpression->errorString();
+    }
+
+    const auto patternsCount = multiExpression->isValid() ? multiExpression->size() : 0u;
+    searchData.resetAdditionalResults( patternsCount > 0 ? patternsCount - 1 : 0u );
+
+    // Lines are grouped into entries only for a full search of the main pattern,
+    // continuation lines of entries can't be found reading backwards
+    std::shared_ptr<const RegularExpression> entryStartExpression;
+    const auto entryStartPattern = config.searchEntryStartPattern();
+    if ( !entryStartPattern.isEmpty() && !searchScope_ && patternsCount == 0 && !isFromEnd
+         && !isCountOnly_ ) {
+        entryStartExpression = engine.entryStartExpression( entryStartPattern );
+        if ( !entryStartExpression->isValid() ) {
+            LOG_WARNING << "Can't split lines into entries: "
+                        << entryStartExpression->errorString();
+            entryStartExpression.reset();
+        }
+    }
+    const auto isEntrySearch = entryStartExpression != nullptr;
+
+    if ( estimateMatches_ && !searchScope_ && !isEntrySearch && config.estimateSearchMatches()
+         && ( endLine - initialLine ).get() >= EstimateMinLines ) {
+        estimateMatches( searchData, *regularExpression->createMatcher(), initialLine, endLine,
+                         matchingThreadsCount );
+    }
+
+    if ( isEntrySearch ) {
+        engine.entryStartMatchers.prepare( entryStartExpression );
+    }
+    if ( patternsCount > 0 ) {
+        engine.multiMatchers.prepare( multiExpression );
+    }
+    tbb::enumerable_thread_specific<microseconds> threadMatchDurations( microseconds{ 0 } );
+
+    // Time matcher threads spent waiting for blocks since the previous match
+    tbb::enumerable_thread_specific<microseconds> threadIdleDurations( microseconds{ 0 } );
+    tbb::enumerable_thread_specific<high_resolution_clock::time_point> threadLastMatchEnd( t1 );
+
+    // Matching throughput of the last matched chunk
+    std::atomic<uint64_t> matchBytesPerMs{ 0 };
+
+    // Chunks read after the limit is reached are dropped without matching
+    std::atomic<bool> isLimitReached{ limit_ && limit_->matches == 0 };
+
+    // Rest of giant lines is matched in windows, see matchCutLines
+    const auto isInverse = regularExpression->isInverse();
+
+    auto regexMatcher
+        = tbb::flow::function_node<BlockDataType, BlockDataType, tbb::flow::rejecting>(
+            searchGraph, matchingThreadsCount, [ & ]( const BlockDataType& blockData ) {
+                if ( interruptRequested_ ) {
+                    LOG_INFO << "Matcher interrupted";
+                    if ( !searchScope_ ) {
                         blockData->searchResults.chunkStart = blockData->chunkStart;
                         blockData->searchResults.processedLines
                             = LinesCount{ blockData->lines.endOfLines.size() };
-                        return blockData;
                     }
+                    return blockData;
+                }
 
-                    const auto& matcher = std::get<PatternMatcherPtr>( regexMatchers.at( index ) );
-                    const auto matchStartTime = high_resolution_clock::now();
+                if ( blockData->isSkipped || isLimitReached ) {
+                    trace.addCounter( "lineBlocksQueue", --queuedBlocks );
+                    trace.addCounter( "resultsQueue", ++matchedBlocks );
+                    return blockData;
+                }
 
+                const auto matchStartTime = high_resolution_clock::now();
+                trace.addCounter( "lineBlocksQueue", --queuedBlocks );
+                threadIdleDurations.local()
+                    += duration_cast<microseconds>( matchStartTime - threadLastMatchEnd.local() );
+                trace.addSpan( "idle", threadLastMatchEnd.local(), matchStartTime );
+
+                uint64_t matchedBytes = blockData->lines.data().size();
+
+                if ( searchScope_ ) {
+                    matchedBytes = 0;
+                    auto& results = blockData->searchResults;
+                    for ( const auto& linesRun : blockData->sparseLines ) {
+                        auto runResults
+                            = filterLines( engine.matchers.local(), linesRun, linesRun.startLine,
+                                           blockData->buffers, &interruptRequested_ );
+                        matchCutLines( engine.matchers.local(), isInverse, sourceLogData_,
+                                       linesRun, runResults, blockData->buffers,
+                                       &interruptRequested_ );
+                        results.maxLength = qMax( results.maxLength, runResults.maxLength );
+                        results.matchingLines |= runResults.matchingLines;
+                        matchedBytes += linesRun.data().size();
+                    }
+                }
+                else if ( isEntrySearch ) {
+                    blockData->searchResults
+                        = filterEntries( engine.matchers.local(), engine.entryStartMatchers.local(),
+                                         blockData->lines, blockData->chunkStart,
+                                         blockData->buffers, &interruptRequested_ );
+                }
+                else if ( isCountOnly_ && blockData->lines.cutLines.empty() ) {
+                    blockData->searchResults.chunkStart = blockData->chunkStart;
+                    blockData->searchResults.processedLines
+                        = LinesCount{ blockData->lines.endOfLines.size() };
+                    blockData->matchesCount
+                        = countLines( engine.matchers.local(), blockData->lines,
+                                      blockData->buffers, &interruptRequested_ );
+                }
+                else if ( patternsCount > 0 ) {
+                    auto results
+                        = filterLines( engine.multiMatchers.local(), patternsCount,
+                                       blockData->lines, blockData->chunkStart, blockData->buffers,
+                                       &interruptRequested_ );
+                    blockData->searchResults = std::move( results.front() );
+                    results.erase( results.begin() );
+                    blockData->additionalResults = std::move( results );
+                }
+                else {
                     blockData->searchResults
-                        = filterLines( *matcher, blockData->lines, blockData->chunkStart );
+                        = filterLines( engine.matchers.local(), blockData->lines,
+                                       blockData->chunkStart, blockData->buffers,
+                                       &interruptRequested_ );
+                    matchCutLines( engine.matchers.local(), isInverse, sourceLogData_,
+                                   blockData->lines, blockData->searchResults,
+                                   blockData->buffers, &interruptRequested_ );
+                    if ( isCountOnly_ ) {
+                        blockData->matchesCount
+                            = blockData->searchResults.matchingLines.cardinality();
+                        blockData->searchResults.matchingLines = {};
+                    }
+                }
 
-                    const auto matchEndTime = high_resolution_clock::now();
+                const auto matchEndTime = high_resolution_clock::now();
+                const auto matchDuration = matchEndTime - matchStartTime;
+
+                threadMatchDurations.local() += duration_cast<microseconds>( matchDuration );
+                threadLastMatchEnd.local() = matchEndTime;
+                trace.addSpan( "match", matchStartTime, matchEndTime );
+                trace.addCounter( "resultsQueue", ++matchedBlocks );
+                if ( matchedBytes > 0 ) {
+                    const auto matchNs = qMax(
+                        uint64_t{ 1 },
+                        static_cast<uint64_t>( duration_cast<nanoseconds>( matchDuration ).count() ) );
+                    matchBytesPerMs = qMax( uint64_t{ 1 }, matchedBytes * 1'000'000 / matchNs );
+                }
 
-                    microseconds& matchDuration
-                        = std::get<microseconds>( regexMatchers.at( index ) );
-                    matchDuration += duration_cast<microseconds>( matchEndTime - matchStartTime );
-                    LOG_DEBUG << "Searcher " << index << " block " << blockData->chunkStart
-                              << " sending matches "
-                              << blockData->searchResults.matchingLines.cardinality();
-                    return blockData;
-                } ) );
-    }
+                LOG_DEBUG << "Searcher block " << blockData->chunkStart << " sending matches "
+                          << blockData->searchResults.matchingLines.cardinality();
+                return blockData;
+            } );
 
     auto resultsQueue = tbb::flow::buffer_node<BlockDataType>( searchGraph );
 
-    const auto totalLines = endLine - initialLine;
+    // Grows if search follows the indexer
+    std::atomic<LinesCount::UnderlyingType> totalLines{ ( endLine - initialLine ).get() };
     LinesCount totalProcessedLines = 0_lcount;
     LineLength maxLength = 0_length;
     LinesCount nbMatches = searchData.getNbMatches();
@@ -363,9 +1607,69 @@ void SearchOperation::doSearch( SearchData& searchData, LineNumber initialLine )
 
     std::chrono::microseconds matchCombiningDuration{ 0 };
 
+    // Results of a bounded search are combined in the order chunks are read,
+    // chunks matched early wait for the ones read before them. They are keyed
+    // by their side next to the chunk read before: the first line reading
+    // forward and the end reading backwards.
+    std::map<LineNumber::UnderlyingType, PartialSearchResults> pendingChunks;
+    auto nextChunkKey = isFromEnd ? endLine.get() : initialLine.get();
+    uint64_t limitedMatches = 0;
+
+    const auto combineResults = [ & ]( const PartialSearchResults& matchResults ) {
+        maxLength = qMax( maxLength, matchResults.maxLength );
+        nbMatches += LinesCount( matchResults.matchingLines.cardinality() );
+
+        totalProcessedLines += matchResults.processedLines;
+
+        // After each block, copy the data to shared data
+        // and update the client
+        searchData.addAll( maxLength, matchResults.matchingLines, matchResults.chunkStart,
+                           matchResults.processedLines );
+    };
+
+    const auto combineLimitedResults = [ & ]( PartialSearchResults&& chunkResults ) {
+        const auto chunkKey = isFromEnd
+                                  ? ( chunkResults.chunkStart + chunkResults.processedLines ).get()
+                                  : chunkResults.chunkStart.get();
+        pendingChunks.emplace( chunkKey, std::move( chunkResults ) );
+
+        for ( auto chunk = pendingChunks.find( nextChunkKey );
+              chunk != pendingChunks.end() && !isLimitReached;
+              chunk = pendingChunks.find( nextChunkKey ) ) {
+            auto& matchResults = chunk->second;
+            nextChunkKey = isFromEnd
+                               ? matchResults.chunkStart.get()
+                               : ( matchResults.chunkStart + matchResults.processedLines ).get();
+
+            // Only the first or the last of the missing matches are kept
+            const auto chunkMatches = matchResults.matchingLines.cardinality();
+            const auto missingMatches = limit_->matches - limitedMatches;
+            if ( chunkMatches >= missingMatches ) {
+                const auto skippedMatches = isFromEnd ? chunkMatches - missingMatches : 0;
+                SearchResultArray keptMatches;
+                uint64_t index = 0;
+                for ( const auto line : matchResults.matchingLines ) {
+                    if ( index >= skippedMatches + missingMatches ) {
+                        break;
+                    }
+                    if ( index++ >= skippedMatches ) {
+                        keptMatches.add( line );
+                    }
+                }
+                matchResults.matchingLines = std::move( keptMatches );
+                isLimitReached = true;
+            }
+
+            limitedMatches += matchResults.matchingLines.cardinality();
+            combineResults( matchResults );
+            pendingChunks.erase( chunk );
+        }
+    };
+
     auto matchProcessor
         = tbb::flow::function_node<BlockDataType, tbb::flow::continue_msg, tbb::flow::rejecting>(
             searchGraph, 1, [ & ]( const BlockDataType& blockData ) {
+                KLOGG_ZONE( "matchProcessor" );
                 if ( interruptRequested_ ) {
                     LOG_INFO << "Match processor interrupted";
                     return tbb::flow::continue_msg{};
@@ -374,27 +1678,32 @@ void SearchOperation::doSearch( SearchData& searchData, LineNumber initialLine )
                 const auto& matchResults = blockData->searchResults;
 
                 const auto matchProcessorStartTime = high_resolution_clock::now();
+                trace.addCounter( "resultsQueue", --matchedBlocks );
 
-                if ( matchResults.processedLines.get() ) {
-
-                    maxLength = qMax( maxLength, matchResults.maxLength );
-                    nbMatches += LinesCount( matchResults.matchingLines.cardinality() );
-
-                    const auto processedLines = LinesCount{ matchResults.chunkStart.get()
-                                                            + matchResults.processedLines.get() };
-
+                if ( isCountOnly_ ) {
+                    nbMatches += LinesCount( blockData->matchesCount );
                     totalProcessedLines += matchResults.processedLines;
+                }
+                else if ( limit_ ) {
+                    if ( !isLimitReached ) {
+                        combineLimitedResults( std::move( blockData->searchResults ) );
+                    }
+                }
+                else if ( matchResults.processedLines.get() ) {
+                    combineResults( matchResults );
 
-                    // After each block, copy the data to shared data
-                    // and update the client
-                    searchData.addAll( maxLength, matchResults.matchingLines, processedLines );
+                    for ( auto index = 0u; index < blockData->additionalResults.size(); ++index ) {
+                        const auto& additionalResults = blockData->additionalResults[ index ];
+                        searchData.addAdditionalMatches( index, additionalResults.maxLength,
+                                                         additionalResults.matchingLines );
+                    }
 
                     LOG_DEBUG << "done Searching chunk starting at " << matchResults.chunkStart
                               << ", " << matchResults.processedLines << " lines read.";
                 }
 
                 const int percentage
-                    = calculateProgress( totalProcessedLines.get(), totalLines.get() );
+                    = calculateProgress( totalProcessedLines.get(), totalLines.load() );
 
                 if ( percentage > reportedPercentage || nbMatches > reportedMatches ) {
 
@@ -407,67 +1716,280 @@ void SearchOperation::doSearch( SearchData& searchData, LineNumber initialLine )
                 const auto matchProcessorEndTime = high_resolution_clock::now();
                 matchCombiningDuration += duration_cast<microseconds>( matchProcessorEndTime
                                                                        - matchProcessorStartTime );
+                trace.addSpan( "combine", matchProcessorStartTime, matchProcessorEndTime );
+                stats.updatePeakMemory();
 
+                engine.releaseBlock( blockData );
                 return tbb::flow::continue_msg{};
             } );
 
-    tbb::flow::make_edge( blockPrefetcher, lineBlocksQueue );
+    tbb::flow::make_edge( blockPrefetcher, readQueue );
+    tbb::flow::make_edge( readQueue, lineReader );
+    tbb::flow::make_edge( lineReader, lineBlocksQueue );
 
-    for ( auto& regexMatcher : regexMatchers ) {
-        tbb::flow::make_edge( lineBlocksQueue, std::get<RegexMatcherNode>( regexMatcher ) );
-        tbb::flow::make_edge( std::get<RegexMatcherNode>( regexMatcher ), resultsQueue );
-    }
+    tbb::flow::make_edge( lineBlocksQueue, regexMatcher );
+    tbb::flow::make_edge( regexMatcher, resultsQueue );
 
     tbb::flow::make_edge( resultsQueue, matchProcessor );
     tbb::flow::make_edge( matchProcessor, blockPrefetcher.decrementer() );
 
-    auto chunkStart = initialLine;
-    while ( chunkStart < endLine && !interruptRequested_ ) {
+    // Chunks skipped for the main pattern can still match additional ones,
+    // chunks of entries are extended past the boundaries checked by trigrams
+    const auto trigrams = additionalPatterns_.empty() && !searchScope_ && !isEntrySearch
+                              ? requiredTrigrams( regexp_ )
+                              : TrigramFilter::Hashes{};
+
+    // Lines after the chunk that belong to its last entry
+    const auto entryStartMatcher
+        = isEntrySearch ? entryStartExpression->createMatcher() : PatternMatcherPtr{};
+    const auto countContinuationLines = [ & ]( LineNumber firstLine ) {
+        auto continuationLines = 0_lcount;
+        while ( firstLine + continuationLines < endLine
+                && continuationLines.get() < MaxEntryLines ) {
+            const auto probeStart = firstLine + continuationLines;
+            const auto probeLines
+                = LinesCount( qMin( EntryProbeLines, ( endLine - probeStart ).get() ) );
+            const auto rawLines = sourceLogData_.getLinesRaw( probeStart, probeLines,
+                                                              LogData::LineLimit::Search );
+            const auto lines = rawLines.buildUtf8View();
+            if ( lines.empty() ) {
+                break;
+            }
+
+            for ( const auto& line : lines ) {
+                if ( entryStartMatcher->hasMatch( line ) ) {
+                    return continuationLines;
+                }
+                ++continuationLines;
+            }
+        }
+        return continuationLines;
+    };
+    LinesCount skippedLines = 0_lcount;
+
+    const SearchResultArray emptyScope;
+    const auto& scope = searchScope_ ? *searchScope_ : emptyScope;
+    const auto scopeEnd = scope.end();
+    auto scopeLine = scope.begin();
+    while ( scopeLine != scopeEnd && *scopeLine < initialLine.get() ) {
+        ++scopeLine;
+    }
+
+    // Time waiting here means that matching is slower than reading
+    const auto putBlock = [ & ]( const BlockDataType& blockData ) {
+        const auto putStartTime = high_resolution_clock::now();
+        trace.addCounter( "lineBlocksQueue", ++queuedBlocks );
+        while ( !blockPrefetcher.try_put( blockData ) && !interruptRequested_
+                && !isLimitReached ) {
+            std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+        }
+        const auto putEndTime = high_resolution_clock::now();
+        stats.queueStallDuration += duration_cast<microseconds>( putEndTime - putStartTime );
+        trace.addSpan( "blocked", putStartTime, putEndTime );
+    };
+
+    auto diskStream = WorkScheduler::get().openDiskStream( sourceLogData_.getFileName(),
+                                                           interruptRequested_, isBackgroundWork_ );
+
+    // Chunks after the focus line alternate with chunks before it read backwards,
+    // so matches near the focus are found first. Lines before backwardEnd
+    // are not searched yet, processed lines are counted when the gap is closed.
+    auto backwardEnd = initialLine;
+    if ( isFromEnd ) {
+        backwardEnd = endLine;
+        LOG_INFO << "Searching for the last " << limit_->matches << " matches";
+    }
+    else if ( focusLine_ && !limit_ && config.searchAroundViewFirst() && !searchScope_
+              && !isEntrySearch ) {
+        backwardEnd = qBound( initialLine, *focusLine_, endLine );
+        LOG_INFO << "Searching around line " << backwardEnd;
+    }
+    bool isBackwardTurn = false;
+
+    auto chunkStart = backwardEnd;
+    while ( !interruptRequested_ && !isLimitReached ) {
+        const auto searchBackward
+            = backwardEnd > initialLine && ( isBackwardTurn || chunkStart >= endLine );
+        isBackwardTurn = !isBackwardTurn;
+
+        if ( chunkStart >= endLine && !searchBackward ) {
+            if ( !followIndexing_ ) {
+                break;
+            }
+
+            // Indexing of new lines needs the disk
+            diskStream.pause();
+
+            // Indexing state is checked first, lines published
+            // before it finished are picked up by the next check
+            const auto isIndexing = sourceLogData_.isIndexing();
+            const auto indexedEndLine
+                = qMin( LineNumber( sourceLogData_.getNbLine().get() ), endLine_ );
+
+            if ( indexedEndLine > endLine ) {
+                endLine = indexedEndLine;
+                totalLines = ( endLine - initialLine ).get();
+            }
+            else if ( isIndexing ) {
+                std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+            }
+            else {
+                break;
+            }
+            continue;
+        }
+
+        diskStream.yield();
+
         const auto lineSourceStartTime = high_resolution_clock::now();
         LOG_DEBUG << "Reading chunk starting at " << chunkStart;
 
-        const auto linesInChunk
-            = LinesCount( qMin( nbLinesInChunk.get(), ( endLine - chunkStart ).get() ) );
-        auto lines = sourceLogData_.getLinesRaw( chunkStart, linesInChunk );
+        if ( const auto bytesPerMs = matchBytesPerMs.load(); bytesPerMs > 0 ) {
+            chunkBytes
+                = qBound( MinChunkBytes, bytesPerMs * TargetChunkMatchNs / 1'000'000, MaxChunkBytes );
+        }
+        nbLinesInChunk = LinesCount( qBound( LinesCount::UnderlyingType{ 1 },
+                                             chunkBytes / lineBytes.load(), maxLinesInChunk ) );
+
+        if ( searchScope_ ) {
+            // Block takes next lines in scope, reading consecutive ones together,
+            // lines between them are counted as processed
+            auto blockData = acquireBlock( chunkStart );
+
+            auto blockEnd = chunkStart;
+            auto linesInBlock = 0_lcount;
+            uint64_t bytesInBlock = 0;
+            while ( scopeLine != scopeEnd && *scopeLine < endLine.get()
+                    && linesInBlock < nbLinesInChunk ) {
+                const auto runStart = LineNumber( *scopeLine );
+                auto runEnd = runStart;
+                while ( scopeLine != scopeEnd && *scopeLine == runEnd.get()
+                        && runEnd < endLine && linesInBlock < nbLinesInChunk ) {
+                    ++scopeLine;
+                    ++runEnd;
+                    ++linesInBlock;
+                }
 
-        /*LOG_DEBUG << "Sending chunk starting at " << chunkStart << ", " <<
-            lines.second.size()
-                << " lines read.";*/
+                blockData->sparseLines.push_back( sourceLogData_.getLinesRaw(
+                    runStart, runEnd - runStart, LogData::LineLimit::Search ) );
+                bytesInBlock += blockData->sparseLines.back().data().size();
+                bytesRead += blockData->sparseLines.back().data().size();
+                blockEnd = runEnd;
+            }
+            updateLineBytes( bytesInBlock, linesInBlock.get() );
 
-        auto blockData = std::make_shared<SearchBlockData>( chunkStart, std::move( lines ) );
+            if ( scopeLine == scopeEnd || *scopeLine >= endLine.get() ) {
+                blockEnd = endLine;
+            }
 
-        const auto lineSourceEndTime = high_resolution_clock::now();
-        const auto chunkReadTime
-            = duration_cast<microseconds>( lineSourceEndTime - lineSourceStartTime );
+            blockData->searchResults.chunkStart = chunkStart;
+            blockData->searchResults.processedLines = blockEnd - chunkStart;
 
-        /*LOG_DEBUG << "Sent chunk starting at " << chunkStart << ", " <<
-        blockData->lines.second.size()
-                << " lines read in " << static_cast<float>( chunkReadTime.count() )
-        / 1000.f
-                << " ms";*/
+            skippedLines += ( blockEnd - chunkStart ) - linesInBlock;
+            chunkStart = blockEnd;
 
-        chunkStart = chunkStart + nbLinesInChunk;
-        fileReadingDuration += chunkReadTime;
+            fileReadingDuration
+                += duration_cast<microseconds>( high_resolution_clock::now() - lineSourceStartTime );
 
-        while ( !blockPrefetcher.try_put( blockData ) && !interruptRequested_ ) {
-            std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+            putBlock( blockData );
+            continue;
         }
+
+        auto linesInChunk = LinesCount( qMin(
+            nbLinesInChunk.get(),
+            searchBackward ? ( backwardEnd - initialLine ).get() : ( endLine - chunkStart ).get() ) );
+        const auto blockStart = searchBackward ? backwardEnd - linesInChunk : chunkStart;
+
+        if ( entryStartMatcher ) {
+            linesInChunk = linesInChunk + countContinuationLines( chunkStart + linesInChunk );
+        }
+
+        const auto advanceChunk = [ & ] {
+            if ( searchBackward ) {
+                backwardEnd = blockStart;
+            }
+            else {
+                chunkStart = chunkStart + linesInChunk;
+            }
+        };
+
+        if ( !trigrams.empty()
+             && !sourceLogData_.mayContainTrigrams( blockStart, linesInChunk, trigrams ) ) {
+            auto blockData = acquireBlock( blockStart );
+            blockData->isSkipped = true;
+            blockData->searchResults.chunkStart = blockStart;
+            blockData->searchResults.processedLines = linesInChunk;
+
+            skippedLines += linesInChunk;
+            advanceChunk();
+
+            putBlock( blockData );
+            continue;
+        }
+
+        auto blockData = acquireBlock( blockStart );
+        blockData->linesToRead = linesInChunk;
+
+        advanceChunk();
+        putBlock( blockData );
     }
 
     searchGraph.wait_for_all();
+    engine.trimBlocks();
+
+    for ( const auto& readDuration : threadReadDurations ) {
+        fileReadingDuration += readDuration;
+    }
+    stats.bytesRead += bytesRead;
 
     high_resolution_clock::time_point t2 = high_resolution_clock::now();
     const auto durationUs = duration_cast<microseconds>( t2 - t1 );
     const auto durationMs = duration_cast<milliseconds>( t2 - t1 );
 
     LOG_INFO << "Searching done, overall duration " << durationUs;
-    LOG_INFO << "Line reading took " << fileReadingDuration;
+    LOG_INFO << "Line reading took " << fileReadingDuration << " in all readers";
+    LOG_INFO << ( searchScope_ ? "Skipped outside of previous matches "
+                               : "Skipped by trigram index " )
+             << skippedLines << " lines";
     LOG_INFO << "Results combining took " << matchCombiningDuration;
 
-    for ( const auto& regexMatcher : regexMatchers ) {
-        LOG_INFO << "Matching took " << std::get<microseconds>( regexMatcher );
+    LOG_INFO << "Waiting for matchers took " << stats.queueStallDuration;
+
+    for ( const auto& matchDuration : threadMatchDurations ) {
+        LOG_INFO << "Matching took " << matchDuration;
+        stats.matchDurations.push_back( matchDuration );
+    }
+    for ( const auto& idleDuration : threadIdleDurations ) {
+        LOG_INFO << "Matcher waited for blocks " << idleDuration;
+    }
+
+    // Sub patterns are matched anyway to evaluate boolean combination,
+    // so their hits are known without searching each of them,
+    // unless they were matched only until the outcome was known
+    if ( regularExpression->isBooleanCombination() ) {
+        std::vector<uint64_t> hits( regularExpression->subPatterns().size(), 0 );
+        bool hasAllHits = true;
+        engine.matchers.forEach( [ &hits, &hasAllHits ]( const PatternMatcher& matcher ) {
+            const auto& matcherHits = matcher.subPatternHits();
+            if ( matcherHits.size() != hits.size() ) {
+                hasAllHits = false;
+                return;
+            }
+            std::transform( hits.begin(), hits.end(), matcherHits.begin(), hits.begin(),
+                            std::plus<>() );
+        } );
+
+        hits = hasAllHits ? searchData.addSubPatternHits( hits ) : std::vector<uint64_t>{};
+        for ( auto index = 0u; index < hits.size(); ++index ) {
+            stats.patternHits.emplace_back( regularExpression->subPatterns()[ index ].pattern,
+                                            hits[ index ] );
+        }
     }
 
+    stats.duration = durationUs;
+    stats.ioDuration = fileReadingDuration;
+    stats.combiningDuration = matchCombiningDuration;
+
     const auto totalFileSize = sourceLogData_.getFileSize();
 
     LOG_INFO << "Searching perf "
@@ -481,8 +2003,11 @@ void SearchOperation::doSearch( SearchData& searchData, LineNumber initialLine )
                     / ( 1024 * 1024 )
              << " MiB/s";
 
-    Q_EMIT searchProgressed( nbMatches, 100, initialLine );
-    Q_EMIT searchFinished();
+    // Count of interrupted search is not complete
+    if ( !isCountOnly_ || !interruptRequested_ ) {
+        Q_EMIT searchProgressed( nbMatches, 100, initialLine );
+    }
+    Q_EMIT searchFinished( stats );
 }
 
 // Called in the worker thread's context
@@ -491,7 +2016,8 @@ void FullSearchOperation::run( SearchData& searchData )
     try {
         // Clear the shared data
         searchData.clear();
-        doSearch( searchData, 0_lnum );
+        WorkScheduler::get().execute( sourceLogData_.getFileName(),
+                                      [ this, &searchData ] { doSearch( searchData, 0_lnum ); } );
     } catch ( const std::exception& err ) {
         const auto errorString = QString( "FullSearchOperation failed: %1" ).arg( err.what() );
         LOG_ERROR << errorString;
@@ -502,6 +2028,88 @@ void FullSearchOperation::run( SearchData& searchData )
     }
 }
 
+// Called in the worker thread's context
+void PrerunSearchOperation::run( SearchData& searchData )
+{
+    try {
+        searchData.clear();
+        WorkScheduler::get().executeInBackground(
+            [ this, &searchData ] { doSearch( searchData, 0_lnum ); } );
+    } catch ( const std::exception& err ) {
+        LOG_ERROR << "PrerunSearchOperation failed: " << err.what();
+        searchData.clear();
+    }
+}
+
+// Called in the worker thread's context
+void FilterChainOperation::run( SearchData& searchData )
+{
+    try {
+        searchData.clear();
+
+        // Stages are searched by chains of one stage that do not
+        // report progress, their matches are the scope of the next stage
+        for ( auto stage = 0u; stage < stages_.size(); ++stage ) {
+            LOG_INFO << "Filter stage " << stage << ": " << stages_[ stage ].pattern;
+
+            FilterChainOperation stageOperation( sourceLogData_, interruptRequested_,
+                                                 { stages_[ stage ] }, startLine_, endLine_,
+                                                 searchScope_ );
+            stageOperation.setSearchEngine( searchEngine_ );
+
+            SearchData stageData;
+            stageOperation.run( stageData );
+            if ( interruptRequested_ ) {
+                Q_EMIT searchProgressed( 0_lcount, 100, startLine_ );
+                Q_EMIT searchFinished( OperationStats{} );
+                return;
+            }
+
+            searchScope_ = stageData.takeCurrentResults().newMatches;
+            searchData.addStageMatches( *searchScope_ );
+
+            const auto progress = ( stage + 1 ) * 100 / ( stages_.size() + 1 );
+            Q_EMIT searchProgressed( 0_lcount, static_cast<int>( progress ), startLine_ );
+        }
+
+        WorkScheduler::get().execute( sourceLogData_.getFileName(),
+                                      [ this, &searchData ] { doSearch( searchData, 0_lnum ); } );
+    } catch ( const std::exception& err ) {
+        LOG_ERROR << "FilterChainOperation failed: " << err.what();
+        searchData.clear();
+    }
+}
+
+// Called in the worker thread's context
+void CountSearchOperation::run( SearchData& searchData )
+{
+    try {
+        searchData.clear();
+        WorkScheduler::get().execute( sourceLogData_.getFileName(),
+                                      [ this, &searchData ] { doSearch( searchData, 0_lnum ); } );
+    } catch ( const std::exception& err ) {
+        LOG_ERROR << "CountSearchOperation failed: " << err.what();
+        searchData.clear();
+    }
+}
+
+// Called in the worker thread's context
+void RefineSearchOperation::run( SearchData& searchData )
+{
+    try {
+        searchData.clear();
+        WorkScheduler::get().execute( sourceLogData_.getFileName(),
+                                      [ this, &searchData ] { doSearch( searchData, 0_lnum ); } );
+    } catch ( const std::exception& err ) {
+        const auto errorString = QString( "RefineSearchOperation failed: %1" ).arg( err.what() );
+        LOG_ERROR << errorString;
+        dispatchToMainThread( [ errorString ]() {
+            IssueReporter::askUserAndReportIssue( IssueTemplate::Exception, errorString );
+        } );
+        searchData.clear();
+    }
+}
+
 // Called in the worker thread's context
 void UpdateSearchOperation::run( SearchData& searchData )
 {
@@ -516,7 +2124,9 @@ void UpdateSearchOperation::run( SearchData& searchData )
             searchData.deleteMatch( initialLine );
         }
 
-        doSearch( searchData, initialLine );
+        WorkScheduler::get().execute(
+            sourceLogData_.getFileName(),
+            [ this, &searchData, initialLine ] { doSearch( searchData, initialLine ); } );
     } catch ( const std::exception& err ) {
         const auto errorString = QString( "UpdateSearchOpertaion failed: %1" ).arg( err.what() );
         LOG_ERROR << errorString;
@@ -526,3 +2136,30 @@ void UpdateSearchOperation::run( SearchData& searchData )
         searchData.clear();
     }
 }
+
+// Called in the worker thread's context
+void ExtendSearchOperation::run( SearchData& searchData )
+{
+    try {
+        searchData.clear();
+        // Longest of the cached matches is still the longest one
+        searchData.addAll( cachedMaxLength_, {}, 0_lnum, 0_lcount );
+
+        // Last cached line might have not been LF-terminated
+        auto initialLine = initialPosition_;
+        if ( initialLine > startLine_ ) {
+            --initialLine;
+        }
+
+        WorkScheduler::get().execute(
+            sourceLogData_.getFileName(),
+            [ this, &searchData, initialLine ] { doSearch( searchData, initialLine ); } );
+    } catch ( const std::exception& err ) {
+        const auto errorString = QString( "ExtendSearchOperation failed: %1" ).arg( err.what() );
+        LOG_ERROR << errorString;
+        dispatchToMainThread( [ errorString ]() {
+            IssueReporter::askUserAndReportIssue( IssueTemplate::Exception, errorString );
+        } );
+        searchData.clear();
+    }
+}
@@ -0,0 +1,174 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "memorygovernor.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <numeric>
+
+#include <QCoreApplication>
+#include <QThreadPool>
+#include <QTimer>
+
+#include "configuration.h"
+#include "log.h"
+#include "memory_info.h"
+#include "readablesize.h"
+#include "runnable_lambda.h"
+
+namespace {
+// Memory of a closed file is freed by its threads shortly after it is closed
+constexpr int ReleaseDelayMs = 2000;
+constexpr int IdleReleaseIntervalMs = 5 * 60 * 1000;
+} // namespace
+
+MemoryGovernor& MemoryGovernor::get()
+{
+    static MemoryGovernor governor;
+    return governor;
+}
+
+void MemoryGovernor::addConsumer( MemoryConsumer* consumer )
+{
+    consumers_.push_back( consumer );
+
+    // Timer lives as long as the application and its event loop
+    if ( idleReleaseTimer_ == nullptr && QCoreApplication::instance() != nullptr ) {
+        idleReleaseTimer_ = new QTimer( QCoreApplication::instance() );
+        QObject::connect( idleReleaseTimer_, &QTimer::timeout,
+                          [ this ]() { scheduleRelease(); } );
+        idleReleaseTimer_->start( IdleReleaseIntervalMs );
+    }
+}
+
+void MemoryGovernor::removeConsumer( MemoryConsumer* consumer )
+{
+    consumers_.erase( std::remove( consumers_.begin(), consumers_.end(), consumer ),
+                      consumers_.end() );
+    scheduleRelease();
+}
+
+void MemoryGovernor::scheduleRelease()
+{
+    if ( QCoreApplication::instance() == nullptr || isReleaseScheduled_.exchange( true ) ) {
+        return;
+    }
+
+    QTimer::singleShot( ReleaseDelayMs, QCoreApplication::instance(), [ this ]() {
+        // Trimming a large heap takes a while, the main thread does not wait for it
+        QThreadPool::globalInstance()->start( createRunnable( [ this ]() {
+            const auto releasedMemory = releaseFreedMemory();
+            LOG_INFO << "Released " << readableSize( releasedMemory )
+                     << " of freed memory, resident memory "
+                     << readableSize( residentMemory() );
+            isReleaseScheduled_ = false;
+        } ) );
+    } );
+}
+
+void MemoryGovernor::markUsed( const QString& fileName )
+{
+    fileUsage_[ fileName ] = ++usageCounter_;
+}
+
+size_t MemoryGovernor::memoryUsage() const
+{
+    return std::accumulate( consumers_.begin(), consumers_.end(), size_t{ 0 },
+                            []( size_t usage, const MemoryConsumer* consumer ) {
+                                return usage + consumer->memoryUsage();
+                            } );
+}
+
+std::vector<MemoryConsumer*> MemoryGovernor::consumersByUsage() const
+{
+    std::vector<std::pair<quint64, MemoryConsumer*>> consumers;
+    consumers.reserve( consumers_.size() );
+    std::transform( consumers_.begin(), consumers_.end(), std::back_inserter( consumers ),
+                    [ this ]( MemoryConsumer* consumer ) {
+                        return std::make_pair(
+                            fileUsage_.value( consumer->memoryConsumerFile() ), consumer );
+                    } );
+
+    std::stable_sort( consumers.begin(), consumers.end(),
+                      []( const auto& lhs, const auto& rhs ) { return lhs.first < rhs.first; } );
+
+    std::vector<MemoryConsumer*> sortedConsumers;
+    sortedConsumers.reserve( consumers.size() );
+    std::transform( consumers.begin(), consumers.end(), std::back_inserter( sortedConsumers ),
+                    []( const auto& consumer ) { return consumer.second; } );
+    return sortedConsumers;
+}
+
+void MemoryGovernor::enforceBudget()
+{
+    const auto budgetMb = Configuration::get().memoryBudgetMb();
+    if ( budgetMb <= 0 ) {
+        return;
+    }
+
+    const auto budget = static_cast<size_t>( budgetMb ) * 1024 * 1024;
+    auto usage = memoryUsage();
+    if ( usage <= budget ) {
+        return;
+    }
+
+    LOG_INFO << "Open files use " << readableSize( usage ) << ", budget is "
+             << readableSize( budget );
+
+    const auto consumers = consumersByUsage();
+    const auto lastUsedFile
+        = consumers.empty() ? QString{} : consumers.back()->memoryConsumerFile();
+
+    for ( const auto release : { MemoryConsumer::Release::Caches,
+                                 MemoryConsumer::Release::CompactResults,
+                                 MemoryConsumer::Release::SparseIndex } ) {
+        for ( auto* consumer : consumers ) {
+            if ( usage <= budget ) {
+                LOG_INFO << "Open files use " << readableSize( usage ) << " after release";
+                scheduleRelease();
+                return;
+            }
+
+            // Reindexing the file shown to the user would make it unusable for a while
+            if ( release == MemoryConsumer::Release::SparseIndex
+                 && consumer->memoryConsumerFile() == lastUsedFile ) {
+                continue;
+            }
+
+            const auto consumerUsage = consumer->memoryUsage();
+            consumer->releaseMemory( release );
+
+            // Index is replaced after reindexing in background,
+            // its new size is counted when indexing finishes
+            usage -= consumerUsage;
+            if ( release != MemoryConsumer::Release::SparseIndex ) {
+                usage += consumer->memoryUsage();
+            }
+        }
+    }
+
+    if ( usage > budget ) {
+        LOG_WARNING << "Open files use " << readableSize( usage ) << " over budget of "
+                    << readableSize( budget );
+    }
+
+    scheduleRelease();
+}
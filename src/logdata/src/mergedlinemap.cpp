@@ -0,0 +1,166 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "mergedlinemap.h"
+
+#include <algorithm>
+
+namespace {
+constexpr unsigned WordBits = 64;
+
+unsigned bitsForSources( size_t sourcesCount )
+{
+    unsigned bits = 1;
+    while ( bits < WordBits && ( uint64_t{ 1 } << bits ) < sourcesCount ) {
+        bits *= 2;
+    }
+    return bits;
+}
+} // namespace
+
+MergedLineMap::MergedLineMap( size_t sourcesCount )
+    : sourcesCount_( std::max( sourcesCount, size_t{ 1 } ) )
+    , bitsPerLine_( bitsForSources( sourcesCount_ ) )
+    , sourceLines_( sourcesCount_ )
+{
+}
+
+void MergedLineMap::append( size_t source )
+{
+    if ( size_ % CheckpointInterval == 0 ) {
+        checkpoints_.insert( checkpoints_.end(), sourceLines_.begin(), sourceLines_.end() );
+    }
+
+    const auto bitPosition = size_ * bitsPerLine_;
+    if ( bitPosition / WordBits >= words_.size() ) {
+        words_.push_back( 0 );
+    }
+    words_.back() |= static_cast<uint64_t>( source ) << ( bitPosition % WordBits );
+
+    ++sourceLines_[ source ];
+    ++size_;
+}
+
+LinesCount MergedLineMap::size() const
+{
+    return LinesCount( size_ );
+}
+
+size_t MergedLineMap::sourceAt( uint64_t index ) const
+{
+    const auto bitPosition = index * bitsPerLine_;
+    const auto mask = bitsPerLine_ == WordBits ? ~uint64_t{ 0 }
+                                               : ( uint64_t{ 1 } << bitsPerLine_ ) - 1;
+    return static_cast<size_t>( ( words_[ bitPosition / WordBits ] >> ( bitPosition % WordBits ) )
+                                & mask );
+}
+
+std::vector<LineNumber::UnderlyingType> MergedLineMap::sourceLinesBefore( uint64_t index ) const
+{
+    const auto checkpoint = index / CheckpointInterval;
+    const auto checkpointBegin = checkpoints_.begin()
+                                 + static_cast<std::ptrdiff_t>( checkpoint * sourcesCount_ );
+    std::vector<LineNumber::UnderlyingType> sourceLines(
+        checkpointBegin, checkpointBegin + static_cast<std::ptrdiff_t>( sourcesCount_ ) );
+
+    for ( auto line = checkpoint * CheckpointInterval; line < index; ++line ) {
+        ++sourceLines[ sourceAt( line ) ];
+    }
+    return sourceLines;
+}
+
+MergedLineMap::SourceLine MergedLineMap::sourceLine( LineNumber line ) const
+{
+    const auto source = sourceAt( line.get() );
+    const auto checkpoint = line.get() / CheckpointInterval;
+
+    auto sourceLine = checkpoints_[ checkpoint * sourcesCount_ + source ];
+    for ( auto index = checkpoint * CheckpointInterval; index < line.get(); ++index ) {
+        if ( sourceAt( index ) == source ) {
+            ++sourceLine;
+        }
+    }
+
+    return { source, LineNumber( sourceLine ) };
+}
+
+std::vector<MergedLineMap::Run> MergedLineMap::runs( LineNumber first, LinesCount count ) const
+{
+    std::vector<Run> runs;
+    if ( first.get() >= size_ ) {
+        return runs;
+    }
+
+    const auto end = std::min( size_, first.get() + count.get() );
+    auto sourceLines = sourceLinesBefore( first.get() );
+
+    for ( auto index = first.get(); index < end; ++index ) {
+        const auto source = sourceAt( index );
+        if ( !runs.empty() && runs.back().source == source ) {
+            ++runs.back().count;
+        }
+        else {
+            runs.push_back( { source, LineNumber( sourceLines[ source ] ), 1_lcount } );
+        }
+        ++sourceLines[ source ];
+    }
+
+    return runs;
+}
+
+OptionalLineNumber MergedLineMap::mergedLine( size_t source, LineNumber line ) const
+{
+    if ( source >= sourcesCount_ || line.get() >= sourceLines_[ source ] ) {
+        return {};
+    }
+
+    // Lines of file before checkpoints grow with checkpoints,
+    // find the last checkpoint that is not past the line
+    const auto checkpointsCount = checkpoints_.size() / sourcesCount_;
+    size_t low = 0;
+    size_t high = checkpointsCount;
+    while ( high - low > 1 ) {
+        const auto middle = low + ( high - low ) / 2;
+        if ( checkpoints_[ middle * sourcesCount_ + source ] <= line.get() ) {
+            low = middle;
+        }
+        else {
+            high = middle;
+        }
+    }
+
+    auto sourceLine = checkpoints_[ low * sourcesCount_ + source ];
+    for ( auto index = low * CheckpointInterval; index < size_; ++index ) {
+        if ( sourceAt( index ) == source ) {
+            if ( sourceLine == line.get() ) {
+                return LineNumber( index );
+            }
+            ++sourceLine;
+        }
+    }
+
+    return {};
+}
+
+size_t MergedLineMap::allocatedSize() const
+{
+    return words_.capacity() * sizeof( uint64_t )
+           + ( checkpoints_.capacity() + sourceLines_.capacity() )
+                 * sizeof( LineNumber::UnderlyingType );
+}
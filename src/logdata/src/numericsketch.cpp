@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "numericsketch.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+constexpr double Gamma
+    = ( 1.0 + NumericSketch::RelativeAccuracy ) / ( 1.0 - NumericSketch::RelativeAccuracy );
+
+// Magnitudes below it are counted as zeros, it keeps indexes in range
+constexpr double MinMagnitude = 1e-9;
+
+const double LogGamma = std::log( Gamma );
+} // namespace
+
+int NumericSketch::bucketIndex( double magnitude )
+{
+    return static_cast<int>( std::ceil( std::log( magnitude ) / LogGamma ) );
+}
+
+double NumericSketch::bucketValue( int index )
+{
+    // Middle of (gamma^(index-1), gamma^index] in relative terms
+    return 2.0 * std::pow( Gamma, index ) / ( Gamma + 1.0 );
+}
+
+void NumericSketch::add( double value )
+{
+    if ( !std::isfinite( value ) ) {
+        return;
+    }
+
+    if ( value >= MinMagnitude ) {
+        ++positive_[ bucketIndex( value ) ];
+    }
+    else if ( value <= -MinMagnitude ) {
+        ++negative_[ bucketIndex( -value ) ];
+    }
+    else {
+        ++zeros_;
+    }
+
+    min_ = count_ > 0 ? std::min( min_, value ) : value;
+    max_ = count_ > 0 ? std::max( max_, value ) : value;
+    sum_ += value;
+    ++count_;
+}
+
+void NumericSketch::merge( const NumericSketch& other )
+{
+    if ( other.count_ == 0 ) {
+        return;
+    }
+
+    for ( const auto& bucket : other.positive_ ) {
+        positive_[ bucket.first ] += bucket.second;
+    }
+    for ( const auto& bucket : other.negative_ ) {
+        negative_[ bucket.first ] += bucket.second;
+    }
+    zeros_ += other.zeros_;
+
+    min_ = count_ > 0 ? std::min( min_, other.min_ ) : other.min_;
+    max_ = count_ > 0 ? std::max( max_, other.max_ ) : other.max_;
+    sum_ += other.sum_;
+    count_ += other.count_;
+}
+
+double NumericSketch::quantile( double q ) const
+{
+    if ( count_ == 0 ) {
+        return 0.0;
+    }
+
+    const auto rank = static_cast<uint64_t>(
+        std::clamp( q, 0.0, 1.0 ) * static_cast<double>( count_ - 1 ) );
+
+    // Buckets are visited from the smallest values
+    const auto clamped = [ this ]( double value ) { return std::clamp( value, min_, max_ ); };
+
+    uint64_t seen = 0;
+    for ( auto bucket = negative_.rbegin(); bucket != negative_.rend(); ++bucket ) {
+        seen += bucket->second;
+        if ( seen > rank ) {
+            return clamped( -bucketValue( bucket->first ) );
+        }
+    }
+
+    seen += zeros_;
+    if ( seen > rank ) {
+        return clamped( 0.0 );
+    }
+
+    for ( const auto& bucket : positive_ ) {
+        seen += bucket.second;
+        if ( seen > rank ) {
+            return clamped( bucketValue( bucket.first ) );
+        }
+    }
+
+    return max_;
+}
@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "operationstats.h"
+
+#include <algorithm>
+
+#include <QStringList>
+
+#include "memory_info.h"
+#include "readablesize.h"
+
+namespace {
+
+QString readableDuration( std::chrono::microseconds duration )
+{
+    return QString( "%1 ms" ).arg( static_cast<double>( duration.count() ) / 1000., 0, 'f', 1 );
+}
+
+} // namespace
+
+void OperationStats::updatePeakMemory()
+{
+    peakMemory = std::max( peakMemory, usedMemory() );
+}
+
+QString OperationStats::toString() const
+{
+    QStringList lines;
+    lines << QString( "Duration: %1" ).arg( readableDuration( duration ) );
+    lines << QString( "Read: %1 in %2" )
+                 .arg( readableSize( bytesRead ), readableDuration( ioDuration ) );
+
+    if ( duration.count() > 0 ) {
+        const auto bytesPerSecond = static_cast<double>( bytesRead ) * 1'000'000.
+                                    / static_cast<double>( duration.count() );
+        lines << QString( "Throughput: %1/s" )
+                     .arg( readableSize( static_cast<uint64_t>( bytesPerSecond ) ) );
+    }
+
+    if ( parseDuration.count() > 0 ) {
+        lines << QString( "Parsing: %1" ).arg( readableDuration( parseDuration ) );
+    }
+
+    for ( auto thread = 0u; thread < matchDurations.size(); ++thread ) {
+        lines << QString( "Matching, thread %1: %2" )
+                     .arg( thread + 1 )
+                     .arg( readableDuration( matchDurations[ thread ] ) );
+    }
+
+    if ( combiningDuration.count() > 0 ) {
+        lines << QString( "Combining results: %1" ).arg( readableDuration( combiningDuration ) );
+    }
+
+    lines << QString( "Waiting for processing: %1" ).arg( readableDuration( queueStallDuration ) );
+    lines << QString( "Peak memory: %1" ).arg( readableSize( peakMemory ) );
+
+    return lines.join( '\n' );
+}
+
+QString OperationStats::patternHitsString() const
+{
+    QStringList hits;
+    for ( const auto& [ pattern, count ] : patternHits ) {
+        hits << QString( "\"%1\": %2" ).arg( pattern ).arg( count );
+    }
+    return hits.join( ", " );
+}
@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "patternlinesfinder.h"
+
+#include <memory>
+#include <string_view>
+
+#include <tbb/enumerable_thread_specific.h>
+#include <tbb/parallel_for.h>
+
+#include "linechunks.h"
+#include "log.h"
+#include "logdata.h"
+#include "regularexpression.h"
+
+namespace {
+constexpr LinesCount::UnderlyingType ChunkLines = 5000;
+} // namespace
+
+PatternLinesFinder::PatternLinesFinder( const LogData* logData, LineNumber first,
+                                        LinesCount count )
+    : logData_( logData )
+    , first_( first )
+    , count_( count )
+{
+}
+
+std::vector<SearchResultArray>
+PatternLinesFinder::find( const std::vector<RegularExpressionPattern>& patterns,
+                          const AtomicFlag& interruptRequested ) const
+{
+    if ( patterns.empty() ) {
+        return {};
+    }
+
+    const MultiRegularExpression expression( patterns );
+    if ( !expression.isValid() ) {
+        LOG_WARNING << "Can't find lines of patterns: " << expression.errorString();
+        return {};
+    }
+
+    const auto patternsCount = expression.size();
+    const auto chunks = splitLines( first_, count_, LinesCount( ChunkLines ) );
+
+    using MultiPatternMatcherPtr = std::unique_ptr<MultiPatternMatcher>;
+    tbb::enumerable_thread_specific<MultiPatternMatcherPtr> threadMatchers(
+        [ &expression ]() { return expression.createMatcher(); } );
+    tbb::enumerable_thread_specific<std::vector<SearchResultArray>> threadLines(
+        [ patternsCount ]() { return std::vector<SearchResultArray>( patternsCount ); } );
+
+    tbb::parallel_for(
+        tbb::blocked_range<size_t>( 0, chunks.size(), 1 ),
+        [ & ]( const tbb::blocked_range<size_t>& range ) {
+            const auto& matcher = *threadMatchers.local();
+            auto& lines = threadLines.local();
+
+            LogData::RawLines rawLines;
+            std::vector<std::string_view> utf8Lines;
+            MatchedPatterns matches( patternsCount, 0 );
+            // Lines of a run are added to bitmaps at once
+            std::vector<std::vector<uint64_t>> matchingLines( patternsCount );
+            for ( auto index = range.begin(); index != range.end(); ++index ) {
+                if ( interruptRequested ) {
+                    return;
+                }
+
+                for ( const auto& run : chunks[ index ] ) {
+                    logData_->getLinesRaw( run.first, run.count, rawLines );
+                    rawLines.buildUtf8View( utf8Lines );
+
+                    for ( auto offset = 0u; offset < utf8Lines.size(); ++offset ) {
+                        matcher.match( utf8Lines[ offset ], matches );
+                        for ( auto pattern = 0u; pattern < patternsCount; ++pattern ) {
+                            if ( matches[ pattern ] ) {
+                                matchingLines[ pattern ].push_back( run.first.get() + offset );
+                            }
+                        }
+                    }
+
+                    for ( auto pattern = 0u; pattern < patternsCount; ++pattern ) {
+                        auto& patternLines = matchingLines[ pattern ];
+                        lines[ pattern ].addMany( patternLines.size(), patternLines.data() );
+                        patternLines.clear();
+                    }
+                }
+            }
+        } );
+
+    std::vector<SearchResultArray> lines( patternsCount );
+    for ( const auto& threadPatternLines : threadLines ) {
+        for ( auto pattern = 0u; pattern < patternsCount; ++pattern ) {
+            lines[ pattern ] |= threadPatternLines[ pattern ];
+        }
+    }
+
+    LOG_INFO << "Found lines of " << patternsCount << " patterns in " << count_ << " lines";
+    return lines;
+}
@@ -0,0 +1,235 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "persistentsearchcache.h"
+
+#include <algorithm>
+#include <utility>
+
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#include "configuration.h"
+#include "filedigest.h"
+#include "indexcache.h"
+#include "log.h"
+#include "streamlimits.h"
+
+namespace {
+constexpr quint32 SearchCacheMagic = 0x4B4C5343; // KLSC
+constexpr quint32 SearchCacheVersion = 1;
+
+QString cacheDirectory()
+{
+    return QStandardPaths::writableLocation( QStandardPaths::CacheLocation )
+           + QDir::separator() + "search";
+}
+
+quint64 dataDigest( const QByteArray& data )
+{
+    FileDigest digest;
+    digest.addData( data );
+    return digest.digest();
+}
+
+// Removes least recently written cache files until all of them fit into size
+void trimCacheDirectory( qint64 maxSize )
+{
+    const auto cacheFiles = QDir( cacheDirectory() )
+                                .entryInfoList( { "*.srch" }, QDir::Files, QDir::Time );
+
+    qint64 cacheSize = 0;
+    for ( const auto& cacheFile : cacheFiles ) {
+        cacheSize += cacheFile.size();
+        if ( cacheSize > maxSize ) {
+            LOG_INFO << "Removing search cache " << cacheFile.absoluteFilePath();
+            QFile::remove( cacheFile.absoluteFilePath() );
+        }
+    }
+}
+} // namespace
+
+QByteArray PersistentSearchCache::serializeLines( const SearchResultArray& lines )
+{
+    QByteArray data( static_cast<int>( lines.getSizeInBytes( true ) ), Qt::Uninitialized );
+    lines.write( data.data(), true );
+    return data;
+}
+
+void PersistentSearchCache::saveEntry( QDataStream& stream, const Entry& entry,
+                                       const QByteArray& lines )
+{
+    stream << entry.pattern.pattern << entry.pattern.isCaseSensitive << entry.pattern.isExclude
+           << entry.pattern.isBoolean << entry.pattern.isPlainText
+           << static_cast<quint64>( entry.startLine.get() )
+           << static_cast<quint64>( entry.endLine.get() )
+           << static_cast<qint32>( entry.maxLength.get() ) << entry.lastUsed
+           << dataDigest( lines ) << lines;
+}
+
+bool PersistentSearchCache::loadEntry( QDataStream& stream, Entry& entry )
+{
+    QString pattern;
+    bool isCaseSensitive = false;
+    bool isExclude = false;
+    bool isBoolean = false;
+    bool isPlainText = false;
+    quint64 startLine = 0;
+    quint64 endLine = 0;
+    qint32 maxLength = 0;
+    quint64 digest = 0;
+    QByteArray lines;
+
+    stream >> pattern >> isCaseSensitive >> isExclude >> isBoolean >> isPlainText >> startLine
+        >> endLine >> maxLength >> entry.lastUsed >> digest >> lines;
+
+    if ( stream.status() != QDataStream::Ok || dataDigest( lines ) != digest ) {
+        return false;
+    }
+
+    auto matchingLines = readBitmap<SearchResultArray>( lines );
+    if ( !matchingLines ) {
+        return false;
+    }
+
+    entry.pattern
+        = RegularExpressionPattern( pattern, isCaseSensitive, isExclude, isBoolean, isPlainText );
+    entry.startLine = LineNumber( startLine );
+    entry.endLine = LineNumber( endLine );
+    entry.maxLength = LineLength( maxLength );
+    entry.matchingLines = std::move( *matchingLines );
+    return true;
+}
+
+PersistentSearchCache::PersistentSearchCache( const QString& fileName )
+    : fileName_( QFileInfo( fileName ).absoluteFilePath() )
+{
+    FileDigest pathDigest;
+    pathDigest.addData( fileName_.toUtf8() );
+    cachePath_ = cacheDirectory() + QDir::separator()
+                 + QString::number( pathDigest.digest(), 16 ) + ".srch";
+}
+
+std::vector<PersistentSearchCache::Entry> PersistentSearchCache::load() const
+{
+    QFile cacheFile( cachePath_ );
+    if ( !cacheFile.open( QIODevice::ReadOnly ) ) {
+        return {};
+    }
+
+    QDataStream stream( &cacheFile );
+    stream.setVersion( QDataStream::Qt_5_9 );
+
+    quint32 magic = 0;
+    quint32 version = 0;
+    QString fileName;
+    stream >> magic >> version >> fileName;
+
+    if ( stream.status() != QDataStream::Ok || magic != SearchCacheMagic
+         || version != SearchCacheVersion || fileName != fileName_ ) {
+        LOG_INFO << "Search cache " << cachePath_ << " is not compatible";
+        return {};
+    }
+
+    IndexedHash hash;
+    stream >> hash.size >> hash.headerSize >> hash.headerDigest >> hash.tailSize
+        >> hash.tailOffset >> hash.tailDigest;
+
+    if ( stream.status() != QDataStream::Ok
+         || !IndexCache::isIndexedPartUnchanged( fileName_, hash ) ) {
+        LOG_INFO << "File changed since search cache was saved";
+        return {};
+    }
+
+    quint32 entriesCount = 0;
+    stream >> entriesCount;
+
+    std::vector<Entry> entries;
+    for ( auto index = 0u; index < entriesCount && stream.status() == QDataStream::Ok;
+          ++index ) {
+        Entry entry;
+        if ( !loadEntry( stream, entry ) ) {
+            LOG_WARNING << "Failed to read search cache " << cachePath_;
+            return {};
+        }
+
+        entries.push_back( std::move( entry ) );
+    }
+
+    LOG_INFO << "Loaded " << entries.size() << " search results for " << fileName_;
+    return entries;
+}
+
+void PersistentSearchCache::save( const IndexedHash& hash, std::vector<Entry> entries ) const
+{
+    if ( !QDir().mkpath( cacheDirectory() ) ) {
+        LOG_WARNING << "Failed to create search cache directory " << cacheDirectory();
+        return;
+    }
+
+    const qint64 maxCacheSize
+        = static_cast<qint64>( Configuration::get().persistentSearchCacheSizeMb() ) * 1024 * 1024;
+
+    std::sort( entries.begin(), entries.end(), []( const Entry& lhs, const Entry& rhs ) {
+        return lhs.lastUsed > rhs.lastUsed;
+    } );
+
+    std::vector<QByteArray> serializedLines;
+    qint64 cacheSize = 0;
+    for ( const auto& entry : entries ) {
+        auto lines = serializeLines( entry.matchingLines );
+        cacheSize += lines.size();
+        if ( cacheSize > maxCacheSize ) {
+            break;
+        }
+        serializedLines.push_back( std::move( lines ) );
+    }
+
+    QSaveFile cacheFile( cachePath_ );
+    if ( !cacheFile.open( QIODevice::WriteOnly ) ) {
+        LOG_WARNING << "Failed to open search cache " << cachePath_;
+        return;
+    }
+
+    QDataStream stream( &cacheFile );
+    stream.setVersion( QDataStream::Qt_5_9 );
+
+    stream << SearchCacheMagic << SearchCacheVersion << fileName_;
+
+    stream << hash.size << hash.headerSize << hash.headerDigest << hash.tailSize
+           << hash.tailOffset << hash.tailDigest;
+
+    stream << static_cast<quint32>( serializedLines.size() );
+    for ( auto index = 0u; index < serializedLines.size(); ++index ) {
+        saveEntry( stream, entries[ index ], serializedLines[ index ] );
+    }
+
+    if ( stream.status() != QDataStream::Ok || !cacheFile.commit() ) {
+        LOG_WARNING << "Failed to save search cache " << cachePath_;
+        return;
+    }
+
+    LOG_INFO << "Saved " << serializedLines.size() << " search results for " << fileName_;
+
+    trimCacheDirectory( maxCacheSize );
+}
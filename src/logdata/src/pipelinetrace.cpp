@@ -0,0 +1,149 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "pipelinetrace.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QSaveFile>
+
+#include "configuration.h"
+#include "log.h"
+
+namespace {
+constexpr size_t MaxTraceEvents = 128 * 1024;
+} // namespace
+
+PipelineTrace::PipelineTrace( const QString& name )
+    : isEnabled_( Configuration::get().pipelineTracing() )
+    , name_( name )
+    , start_( Clock::now() )
+{
+    if ( isEnabled_ ) {
+        events_.reserve( MaxTraceEvents );
+    }
+}
+
+PipelineTrace::~PipelineTrace()
+{
+    if ( isEnabled_ ) {
+        save();
+    }
+}
+
+void PipelineTrace::addSpan( const char* name, Clock::time_point start, Clock::time_point end )
+{
+    if ( isEnabled_ ) {
+        addEvent( name, 'X', start,
+                  std::chrono::duration_cast<std::chrono::microseconds>( end - start ).count(),
+                  0 );
+    }
+}
+
+void PipelineTrace::addCounter( const char* name, int64_t value )
+{
+    if ( isEnabled_ ) {
+        addEvent( name, 'C', Clock::now(), 0, value );
+    }
+}
+
+void PipelineTrace::addEvent( const char* name, char phase, Clock::time_point time,
+                              int64_t durationUs, int64_t value )
+{
+    const auto timestampUs
+        = std::chrono::duration_cast<std::chrono::microseconds>( time - start_ ).count();
+
+    ScopedLock lock( mutex_ );
+
+    const auto threadId = threadIds_
+                              .emplace( std::this_thread::get_id(),
+                                        static_cast<uint32_t>( threadIds_.size() + 1 ) )
+                              .first->second;
+
+    const Event event{ name, phase, threadId, timestampUs, durationUs, value };
+    if ( events_.size() < MaxTraceEvents ) {
+        events_.push_back( event );
+    }
+    else {
+        events_[ nextEvent_ ] = event;
+    }
+    nextEvent_ = ( nextEvent_ + 1 ) % MaxTraceEvents;
+}
+
+void PipelineTrace::save() const
+{
+    const auto tracePath = QDir::temp().filePath(
+        QString( "klogg_%1_%2.json" ).arg( name_ ).arg( QDateTime::currentMSecsSinceEpoch() ) );
+
+    QSaveFile traceFile( tracePath );
+    if ( !traceFile.open( QIODevice::WriteOnly ) ) {
+        LOG_WARNING << "Failed to open pipeline trace " << tracePath;
+        return;
+    }
+
+    QByteArray trace;
+    trace.append( "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[" );
+
+    // Thread names are shown instead of operating system ids
+    for ( auto threadId = 1u; threadId <= threadIds_.size(); ++threadId ) {
+        trace.append( QString( "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%1,"
+                               "\"args\":{\"name\":\"%2 thread %1\"}}," )
+                          .arg( threadId )
+                          .arg( name_ )
+                          .toUtf8() );
+    }
+
+    // Oldest event is the next one to be overwritten
+    const auto firstEvent = events_.size() < MaxTraceEvents ? 0 : nextEvent_;
+    for ( auto index = 0u; index < events_.size(); ++index ) {
+        const auto& event = events_[ ( firstEvent + index ) % events_.size() ];
+
+        if ( event.phase == 'X' ) {
+            trace.append( QString( "{\"name\":\"%1\",\"ph\":\"X\",\"pid\":1,\"tid\":%2,"
+                                   "\"ts\":%3,\"dur\":%4}," )
+                              .arg( event.name )
+                              .arg( event.threadId )
+                              .arg( event.timestampUs )
+                              .arg( event.durationUs )
+                              .toUtf8() );
+        }
+        else {
+            trace.append( QString( "{\"name\":\"%1\",\"ph\":\"C\",\"pid\":1,\"tid\":%2,"
+                                   "\"ts\":%3,\"args\":{\"value\":%4}}," )
+                              .arg( event.name )
+                              .arg( event.threadId )
+                              .arg( event.timestampUs )
+                              .arg( event.value )
+                              .toUtf8() );
+        }
+    }
+
+    if ( trace.endsWith( ',' ) ) {
+        trace.chop( 1 );
+    }
+    trace.append( "]}" );
+
+    traceFile.write( trace );
+    if ( !traceFile.commit() ) {
+        LOG_WARNING << "Failed to save pipeline trace " << tracePath;
+        return;
+    }
+
+    LOG_INFO << "Saved " << events_.size() << " pipeline events to " << tracePath;
+}
@@ -0,0 +1,430 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "pluginfile.h"
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QLibrary>
+
+#include "configuration.h"
+#include "log.h"
+
+namespace {
+constexpr size_t InputBufferSize = 4 * 1024 * 1024;
+constexpr size_t BatchBufferSize = 8 * 1024 * 1024;
+// Single record has to fit into buffers of this size
+constexpr size_t MaxBufferSize = 256 * 1024 * 1024;
+constexpr qint64 CheckpointSpan = 8 * 1024 * 1024;
+constexpr qint64 ProbeSize = 4096;
+
+struct PluginRegistry {
+    SharedMutex mutex;
+    std::vector<const klogg_format_plugin*> plugins;
+    // Libraries are kept loaded until the application exits
+    std::vector<std::unique_ptr<QLibrary>> libraries;
+};
+
+bool isSupported( const klogg_format_plugin* plugin )
+{
+    return plugin != nullptr && plugin->abi_version == KLOGG_FORMAT_PLUGIN_ABI_VERSION
+           && plugin->probe != nullptr && plugin->create_decoder != nullptr
+           && plugin->destroy_decoder != nullptr && plugin->decode != nullptr;
+}
+
+void loadPlugins( PluginRegistry& registry )
+{
+    const auto directory = Configuration::get().formatPluginsDirectory();
+    if ( directory.isEmpty() ) {
+        return;
+    }
+
+    for ( const auto& entry : QDir( directory ).entryInfoList( QDir::Files ) ) {
+        if ( !QLibrary::isLibrary( entry.fileName() ) ) {
+            continue;
+        }
+
+        auto library = std::make_unique<QLibrary>( entry.absoluteFilePath() );
+        const auto entryFunction = reinterpret_cast<klogg_format_plugin_entry_function>(
+            library->resolve( KLOGG_FORMAT_PLUGIN_ENTRY ) );
+        if ( entryFunction == nullptr ) {
+            LOG_WARNING << "Failed to load format plugin " << entry.absoluteFilePath() << ": "
+                        << library->errorString();
+            continue;
+        }
+
+        const auto* plugin = entryFunction();
+        if ( !isSupported( plugin ) ) {
+            LOG_WARNING << "Format plugin " << entry.absoluteFilePath() << " is not supported";
+            continue;
+        }
+
+        LOG_INFO << "Loaded format plugin " << plugin->name << " from "
+                 << entry.absoluteFilePath();
+        registry.plugins.push_back( plugin );
+        registry.libraries.push_back( std::move( library ) );
+    }
+}
+
+PluginRegistry& pluginRegistry()
+{
+    static auto* const registry = [] {
+        auto* loadedRegistry = new PluginRegistry;
+        loadPlugins( *loadedRegistry );
+        return loadedRegistry;
+    }();
+    return *registry;
+}
+} // namespace
+
+PluginFile::PluginFile( const QString& fileName, const klogg_format_plugin* plugin,
+                        QObject* parent )
+    : QIODevice( parent )
+    , fileName_( fileName )
+    , plugin_( plugin )
+    , raw_( fileName )
+{
+}
+
+PluginFile::~PluginFile()
+{
+    close();
+}
+
+const klogg_format_plugin* PluginFile::findPlugin( const QString& fileName )
+{
+    auto& registry = pluginRegistry();
+    {
+        SharedLock lock( registry.mutex );
+        if ( registry.plugins.empty() ) {
+            return nullptr;
+        }
+    }
+
+    QFile file( fileName );
+    if ( !file.open( QIODevice::ReadOnly ) ) {
+        return nullptr;
+    }
+
+    const auto header = file.read( ProbeSize );
+    const auto utf8Name = fileName.toUtf8();
+
+    SharedLock lock( registry.mutex );
+    const auto plugin = std::find_if(
+        registry.plugins.begin(), registry.plugins.end(), [ & ]( const auto* candidate ) {
+            return candidate->probe( utf8Name.constData(),
+                                     reinterpret_cast<const unsigned char*>( header.constData() ),
+                                     static_cast<size_t>( header.size() ) )
+                   != 0;
+        } );
+    return plugin != registry.plugins.end() ? *plugin : nullptr;
+}
+
+bool PluginFile::addPlugin( const klogg_format_plugin* plugin )
+{
+    if ( !isSupported( plugin ) ) {
+        return false;
+    }
+
+    auto& registry = pluginRegistry();
+    UniqueLock lock( registry.mutex );
+    if ( std::find( registry.plugins.begin(), registry.plugins.end(), plugin )
+         == registry.plugins.end() ) {
+        registry.plugins.push_back( plugin );
+    }
+    return true;
+}
+
+std::shared_ptr<PluginFile::Index> PluginFile::sharedIndex( const QString& fileName )
+{
+    static SharedMutex registryMutex;
+    static std::map<QString, std::weak_ptr<Index>> registry;
+
+    // Checkpoints of previous versions of the file are not valid
+    const QFileInfo fileInfo( fileName );
+    const auto key = QString( "%1:%2:%3" )
+                         .arg( fileInfo.absoluteFilePath() )
+                         .arg( fileInfo.size() )
+                         .arg( fileInfo.lastModified().toMSecsSinceEpoch() );
+
+    UniqueLock lock( registryMutex );
+    for ( auto entry = registry.begin(); entry != registry.end(); ) {
+        entry = entry->second.expired() ? registry.erase( entry ) : std::next( entry );
+    }
+
+    auto& entry = registry[ key ];
+    auto index = entry.lock();
+    if ( !index ) {
+        index = std::make_shared<Index>();
+        entry = index;
+    }
+    return index;
+}
+
+bool PluginFile::open( OpenMode mode )
+{
+    if ( mode & QIODevice::WriteOnly ) {
+        setErrorString( "Files decoded by plugins can only be read" );
+        return false;
+    }
+
+    if ( !raw_.open( QIODevice::ReadOnly ) ) {
+        setErrorString( raw_.errorString() );
+        return false;
+    }
+
+    decoder_ = plugin_->create_decoder();
+    if ( decoder_ == nullptr ) {
+        setErrorString( QString( "Failed to create decoder of %1" ).arg( plugin_->name ) );
+        raw_.close();
+        return false;
+    }
+
+    input_.resize( InputBufferSize );
+    batch_.resize( BatchBufferSize );
+    index_ = sharedIndex( fileName_ );
+    restartAt( {} );
+
+    return QIODevice::open( QIODevice::ReadOnly | QIODevice::Unbuffered );
+}
+
+void PluginFile::close()
+{
+    if ( decoder_ != nullptr ) {
+        plugin_->destroy_decoder( decoder_ );
+        decoder_ = nullptr;
+    }
+
+    raw_.close();
+    QIODevice::close();
+}
+
+qint64 PluginFile::size() const
+{
+    if ( !index_ ) {
+        return 0;
+    }
+
+    {
+        SharedLock lock( index_->mutex );
+        if ( index_->size ) {
+            return *index_->size;
+        }
+    }
+
+    return std::max( batchOffset_ + static_cast<qint64>( batchSize_ ), raw_.size() );
+}
+
+bool PluginFile::atEnd() const
+{
+    if ( decoder_ == nullptr ) {
+        return true;
+    }
+
+    SharedLock lock( index_->mutex );
+    return index_->size && pos() >= *index_->size;
+}
+
+qint64 PluginFile::readData( char* data, qint64 maxSize )
+{
+    if ( decoder_ == nullptr ) {
+        return -1;
+    }
+
+    qint64 produced = 0;
+    while ( produced < maxSize ) {
+        const auto offset = pos() + produced;
+        if ( !seekBatch( offset ) ) {
+            break;
+        }
+
+        const auto batchPosition = static_cast<size_t>( offset - batchOffset_ );
+        const auto size
+            = std::min( static_cast<qint64>( batchSize_ - batchPosition ), maxSize - produced );
+        std::memcpy( data + produced, batch_.data() + batchPosition, static_cast<size_t>( size ) );
+        produced += size;
+    }
+
+    return produced;
+}
+
+qint64 PluginFile::writeData( const char* data, qint64 maxSize )
+{
+    Q_UNUSED( data );
+    Q_UNUSED( maxSize );
+    return -1;
+}
+
+void PluginFile::restartAt( const Checkpoint& checkpoint )
+{
+    LOG_DEBUG << "Restarting decoding of " << fileName_ << " at " << checkpoint.decodedOffset;
+
+    raw_.seek( checkpoint.rawOffset );
+    rawOffset_ = checkpoint.rawOffset;
+    inputBegin_ = 0;
+    inputEnd_ = 0;
+    isRawFinished_ = false;
+
+    batchOffset_ = checkpoint.decodedOffset;
+    batchSize_ = 0;
+    isDecodingFinished_ = false;
+}
+
+bool PluginFile::seekBatch( qint64 offset )
+{
+    const auto batchEnd = batchOffset_ + static_cast<qint64>( batchSize_ );
+    if ( offset >= batchOffset_ && offset < batchEnd ) {
+        return true;
+    }
+
+    Checkpoint checkpoint;
+    {
+        SharedLock lock( index_->mutex );
+        const auto& checkpoints = index_->checkpoints;
+        const auto next = std::upper_bound( checkpoints.begin(), checkpoints.end(), offset,
+                                            []( qint64 value, const Checkpoint& point ) {
+                                                return value < point.decodedOffset;
+                                            } );
+        if ( next != checkpoints.begin() ) {
+            checkpoint = *std::prev( next );
+        }
+    }
+
+    // Continue from current batch if it is closer than any checkpoint
+    if ( offset < batchEnd || batchEnd < checkpoint.decodedOffset ) {
+        restartAt( checkpoint );
+    }
+
+    while ( offset >= batchOffset_ + static_cast<qint64>( batchSize_ ) ) {
+        if ( !decodeNextBatch() ) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool PluginFile::decodeNextBatch()
+{
+    batchOffset_ += static_cast<qint64>( batchSize_ );
+    batchSize_ = 0;
+
+    while ( !isDecodingFinished_ ) {
+        if ( inputBegin_ == inputEnd_ && !isRawFinished_ && !fillInput() ) {
+            finishDecoding();
+            break;
+        }
+
+        size_t consumed = 0;
+        size_t written = 0;
+        const auto status = plugin_->decode( decoder_, input_.data() + inputBegin_,
+                                             inputEnd_ - inputBegin_, isRawFinished_ ? 1 : 0,
+                                             batch_.data(), batch_.size(), &consumed, &written );
+
+        if ( status == KLOGG_DECODE_OUTPUT_TOO_SMALL && batch_.size() < MaxBufferSize ) {
+            batch_.resize( batch_.size() * 2 );
+            continue;
+        }
+
+        const auto isBroken = status != KLOGG_DECODE_OK;
+        if ( isBroken ) {
+            LOG_WARNING << "Plugin " << plugin_->name << " failed to decode " << fileName_
+                        << " after " << rawOffset_ + static_cast<qint64>( consumed );
+        }
+
+        if ( consumed == 0 ) {
+            // Record is not complete, it is decoded with more data
+            if ( isBroken || isRawFinished_ || !fillInput() ) {
+                finishDecoding();
+                break;
+            }
+            continue;
+        }
+
+        inputBegin_ += std::min( consumed, inputEnd_ - inputBegin_ );
+        rawOffset_ += static_cast<qint64>( consumed );
+        batchSize_ = std::min( written, batch_.size() );
+        addCheckpoint();
+
+        // Records decoded before the broken one are the end of the file
+        if ( isBroken ) {
+            finishDecoding();
+            return batchSize_ > 0;
+        }
+
+        if ( batchSize_ > 0 ) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool PluginFile::fillInput()
+{
+    if ( inputBegin_ > 0 ) {
+        std::memmove( input_.data(), input_.data() + inputBegin_, inputEnd_ - inputBegin_ );
+        inputEnd_ -= inputBegin_;
+        inputBegin_ = 0;
+    }
+
+    if ( inputEnd_ == input_.size() ) {
+        if ( input_.size() >= MaxBufferSize ) {
+            LOG_WARNING << "Record of " << fileName_ << " at " << rawOffset_ << " is too big";
+            return false;
+        }
+        input_.resize( input_.size() * 2 );
+    }
+
+    const auto read = raw_.read( reinterpret_cast<char*>( input_.data() + inputEnd_ ),
+                                 static_cast<qint64>( input_.size() - inputEnd_ ) );
+    if ( read < 0 ) {
+        LOG_WARNING << "Failed to read " << fileName_ << ": " << raw_.errorString();
+        return false;
+    }
+
+    isRawFinished_ = read == 0;
+    inputEnd_ += static_cast<size_t>( read );
+    return true;
+}
+
+void PluginFile::addCheckpoint()
+{
+    const auto decodedOffset = batchOffset_ + static_cast<qint64>( batchSize_ );
+
+    UniqueLock lock( index_->mutex );
+    auto& checkpoints = index_->checkpoints;
+    const auto lastOffset = checkpoints.empty() ? 0 : checkpoints.back().decodedOffset;
+    if ( decodedOffset >= lastOffset + CheckpointSpan ) {
+        checkpoints.push_back( { decodedOffset, rawOffset_ } );
+    }
+}
+
+void PluginFile::finishDecoding()
+{
+    isDecodingFinished_ = true;
+
+    UniqueLock lock( index_->mutex );
+    index_->size = batchOffset_ + static_cast<qint64>( batchSize_ );
+}
@@ -0,0 +1,208 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "recordindex.h"
+
+#include <cctype>
+#include <optional>
+#include <utility>
+
+#include <QByteArray>
+#include <QDataStream>
+#include <QString>
+
+#include "streamlimits.h"
+
+namespace {
+// Literal text after ^ if the pattern has no other special characters,
+// punctuation escaped by backslash is literal too
+std::optional<std::string> literalPrefix( const std::string& pattern )
+{
+    if ( pattern.size() < 2 || pattern.front() != '^' ) {
+        return {};
+    }
+
+    std::string prefix;
+    for ( auto pos = 1u; pos < pattern.size(); ++pos ) {
+        const auto c = pattern[ pos ];
+        if ( c == '\\' ) {
+            if ( pos + 1 == pattern.size() ) {
+                return {};
+            }
+            const auto escaped = pattern[ ++pos ];
+            if ( std::isalnum( static_cast<unsigned char>( escaped ) )
+                 || static_cast<unsigned char>( escaped ) >= 0x80 ) {
+                return {};
+            }
+            prefix.push_back( escaped );
+        }
+        else if ( std::string_view( ".^$|?*+()[]{}" ).find( c ) != std::string_view::npos ) {
+            return {};
+        }
+        else {
+            prefix.push_back( c );
+        }
+    }
+    return prefix;
+}
+} // namespace
+
+RecordIndex::RecordIndex( const std::string& startPattern )
+    : isEnabled_( !startPattern.empty() )
+    , startPattern_( startPattern )
+{
+    if ( const auto prefix = literalPrefix( startPattern_ ) ) {
+        startPrefix_ = *prefix;
+        isPrefixPattern_ = true;
+    }
+    else {
+        startRegexp_ = QRegularExpression( QString::fromStdString( startPattern_ ) );
+        startRegexp_.optimize();
+        isEnabled_ = isEnabled_ && startRegexp_.isValid();
+    }
+}
+
+LinesCount RecordIndex::size() const
+{
+    return LinesCount( size_ );
+}
+
+bool RecordIndex::isRecordStart( std::string_view line ) const
+{
+    if ( line.data() == nullptr ) {
+        return false;
+    }
+
+    if ( isPrefixPattern_ ) {
+        return line.substr( 0, startPrefix_.size() ) == startPrefix_;
+    }
+
+    return startRegexp_
+        .match( QString::fromUtf8( line.data(), static_cast<int>( line.size() ) ) )
+        .hasMatch();
+}
+
+void RecordIndex::append( const std::vector<std::string_view>& lines )
+{
+    if ( !isEnabled_ ) {
+        return;
+    }
+
+    for ( const auto& line : lines ) {
+        if ( isRecordStart( line ) ) {
+            starts_.add( size_ );
+        }
+        ++size_;
+    }
+}
+
+void RecordIndex::truncate( LinesCount count )
+{
+    if ( count.get() >= size_ ) {
+        return;
+    }
+
+    // Usually only the last line is added again
+    while ( !starts_.isEmpty() && starts_.maximum() >= count.get() ) {
+        starts_.remove( starts_.maximum() );
+    }
+    size_ = count.get();
+}
+
+LineNumber RecordIndex::recordStart( LineNumber line ) const
+{
+    const auto startsBefore = starts_.rank( line.get() );
+    uint64_t start = 0;
+    if ( startsBefore > 0 ) {
+        starts_.select( startsBefore - 1, &start );
+    }
+    return LineNumber( start );
+}
+
+roaring::Roaring64Map RecordIndex::expand( const roaring::Roaring64Map& lines ) const
+{
+    roaring::Roaring64Map records;
+    uint64_t expandedEnd = 0;
+    for ( const auto line : lines ) {
+        if ( line < expandedEnd ) {
+            continue;
+        }
+
+        // Records of lines that are not added are not known
+        if ( line >= size_ ) {
+            records.add( line );
+            continue;
+        }
+
+        const auto startsBefore = starts_.rank( line );
+        uint64_t end = size_;
+        if ( startsBefore < starts_.cardinality() ) {
+            starts_.select( startsBefore, &end );
+        }
+
+        records.addRange( recordStart( LineNumber( line ) ).get(), end );
+        expandedEnd = end;
+    }
+    records.runOptimize();
+    return records;
+}
+
+size_t RecordIndex::allocatedSize() const
+{
+    return starts_.getSizeInBytes( false );
+}
+
+void RecordIndex::save( QDataStream& stream ) const
+{
+    stream << QByteArray::fromStdString( isEnabled_ ? startPattern_ : std::string{} );
+    stream << static_cast<quint64>( size_ );
+
+    QByteArray data;
+    data.resize( static_cast<int>( starts_.getSizeInBytes( true ) ) );
+    starts_.write( data.data(), true );
+    stream << data;
+}
+
+bool RecordIndex::load( QDataStream& stream )
+{
+    QByteArray startPattern;
+    quint64 size = 0;
+    QByteArray data;
+    stream >> startPattern >> size >> data;
+
+    if ( stream.status() != QDataStream::Ok ) {
+        return false;
+    }
+
+    // Unusable index is left empty, so it does not have loaded lines
+    if ( isEnabled_ && startPattern.toStdString() == startPattern_ && !data.isEmpty() ) {
+        auto starts = readBitmap<roaring::Roaring64Map>( data );
+        if ( !starts ) {
+            return false;
+        }
+        starts_ = std::move( *starts );
+        size_ = size;
+    }
+    else {
+        starts_ = {};
+        size_ = 0;
+    }
+    return true;
+}
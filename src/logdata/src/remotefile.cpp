@@ -0,0 +1,307 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "remotefile.h"
+
+#include <algorithm>
+#include <thread>
+
+#include <QEventLoop>
+#include <QFileInfo>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QSslConfiguration>
+
+#include "configuration.h"
+#include "log.h"
+
+SharedMutex RemoteFile::sourcesMutex_;
+std::map<QString, std::shared_ptr<RemoteFile::Source>> RemoteFile::sources_;
+
+namespace {
+QNetworkRequest makeRequest( const QUrl& url )
+{
+    QNetworkRequest request( url );
+
+    if ( !Configuration::get().verifySslPeers() ) {
+        auto sslConfiguration = QSslConfiguration::defaultConfiguration();
+        sslConfiguration.setPeerVerifyMode( QSslSocket::VerifyNone );
+        request.setSslConfiguration( sslConfiguration );
+    }
+
+    return request;
+}
+
+// Replies are handled by an event loop of a separate thread, so reads
+// from the UI thread do not process its events while they wait.
+// Function sends requests and returns true if loop has to wait for them.
+template <typename Function> void runNetworkRequests( Function&& sendRequests )
+{
+    std::thread thread( [ &sendRequests ] {
+        QNetworkAccessManager manager;
+        manager.setRedirectPolicy( QNetworkRequest::NoLessSafeRedirectPolicy );
+
+        QEventLoop loop;
+        if ( sendRequests( manager, loop ) ) {
+            loop.exec();
+        }
+    } );
+    thread.join();
+}
+} // namespace
+
+std::optional<qint64> RemoteFile::remoteSize( const QUrl& url, QString& error )
+{
+    std::optional<qint64> size;
+    runNetworkRequests( [ &url, &error, &size ]( QNetworkAccessManager& manager,
+                                                 QEventLoop& loop ) {
+        auto* reply = manager.head( makeRequest( url ) );
+        QObject::connect( reply, &QNetworkReply::finished, &loop,
+                          [ reply, &loop, &error, &size ] {
+                              reply->deleteLater();
+                              loop.quit();
+
+                              if ( reply->error() != QNetworkReply::NoError ) {
+                                  error = reply->errorString();
+                                  return;
+                              }
+
+                              const auto length
+                                  = reply->header( QNetworkRequest::ContentLengthHeader );
+                              if ( !reply->rawHeader( "Accept-Ranges" ).contains( "bytes" )
+                                   || !length.isValid() || length.toLongLong() <= 0 ) {
+                                  error = "Server does not support range requests";
+                                  return;
+                              }
+
+                              size = length.toLongLong();
+                          } );
+        return true;
+    } );
+
+    LOG_INFO << "Remote file " << url.toEncoded() << " size "
+             << ( size ? QString::number( *size ) : error );
+    return size;
+}
+
+bool RemoteFile::attach( const QUrl& url, qint64 size, const QString& cacheFileName )
+{
+    // Blocks that were not fetched yet are holes of the sparse file
+    QFile cache( cacheFileName );
+    if ( !cache.open( QIODevice::ReadWrite ) || !cache.resize( size ) ) {
+        LOG_ERROR << "Failed to create cache of " << url.toEncoded() << " in " << cacheFileName
+                  << ": " << cache.errorString();
+        return false;
+    }
+
+    auto source = std::make_shared<Source>();
+    source->url = url;
+    source->size = size;
+    source->fetchedBlocks.resize( static_cast<size_t>( ( size + BlockSize - 1 ) / BlockSize ) );
+
+    UniqueLock lock( sourcesMutex_ );
+    sources_[ QFileInfo( cacheFileName ).absoluteFilePath() ] = std::move( source );
+    return true;
+}
+
+bool RemoteFile::isRemoteFile( const QString& fileName )
+{
+    return findSource( fileName ) != nullptr;
+}
+
+std::shared_ptr<RemoteFile::Source> RemoteFile::findSource( const QString& fileName )
+{
+    SharedLock lock( sourcesMutex_ );
+    if ( sources_.empty() ) {
+        return nullptr;
+    }
+
+    const auto source = sources_.find( QFileInfo( fileName ).absoluteFilePath() );
+    return source != sources_.end() ? source->second : nullptr;
+}
+
+RemoteFile::RemoteFile( const QString& fileName, QObject* parent )
+    : QIODevice( parent )
+    , fileName_( fileName )
+    , cache_( fileName )
+{
+}
+
+RemoteFile::~RemoteFile()
+{
+    close();
+}
+
+bool RemoteFile::open( OpenMode mode )
+{
+    if ( mode & QIODevice::WriteOnly ) {
+        setErrorString( "Remote files can only be read" );
+        return false;
+    }
+
+    source_ = findSource( fileName_ );
+    if ( !source_ ) {
+        setErrorString( "Remote file is not attached" );
+        return false;
+    }
+
+    if ( !cache_.open( QIODevice::ReadOnly ) ) {
+        setErrorString( cache_.errorString() );
+        return false;
+    }
+
+    return QIODevice::open( QIODevice::ReadOnly | QIODevice::Unbuffered );
+}
+
+void RemoteFile::close()
+{
+    cache_.close();
+    QIODevice::close();
+}
+
+qint64 RemoteFile::size() const
+{
+    return source_ ? source_->size : 0;
+}
+
+qint64 RemoteFile::readData( char* data, qint64 maxSize )
+{
+    if ( !source_ ) {
+        return -1;
+    }
+
+    const auto offset = pos();
+    if ( offset >= source_->size || maxSize <= 0 ) {
+        return 0;
+    }
+
+    const auto length = std::min( maxSize, source_->size - offset );
+    const auto firstBlock = offset / BlockSize;
+    const auto endBlock = ( offset + length - 1 ) / BlockSize + 1;
+
+    const auto isFetched = [ this, firstBlock, endBlock ] {
+        SharedLock lock( source_->mutex );
+        return std::all_of( source_->fetchedBlocks.begin() + firstBlock,
+                            source_->fetchedBlocks.begin() + endBlock,
+                            []( bool isBlockFetched ) { return isBlockFetched; } );
+    };
+
+    // File is mostly read forward, so blocks after the
+    // missing ones are fetched by the same parallel requests
+    if ( !isFetched() ) {
+        const auto blocksCount = static_cast<qint64>( source_->fetchedBlocks.size() );
+        const auto readAheadEnd = std::min( blocksCount, firstBlock + ReadAheadBlocks );
+        if ( !fetchBlocks( firstBlock, std::max( endBlock, readAheadEnd ) ) ) {
+            return -1;
+        }
+    }
+
+    if ( !cache_.seek( offset ) ) {
+        return -1;
+    }
+    return cache_.read( data, length );
+}
+
+qint64 RemoteFile::writeData( const char* data, qint64 maxSize )
+{
+    Q_UNUSED( data );
+    Q_UNUSED( maxSize );
+    return -1;
+}
+
+bool RemoteFile::fetchBlocks( qint64 firstBlock, qint64 endBlock )
+{
+    std::vector<qint64> missingBlocks;
+    {
+        SharedLock lock( source_->mutex );
+        for ( auto block = firstBlock; block < endBlock; ++block ) {
+            if ( !source_->fetchedBlocks[ static_cast<size_t>( block ) ] ) {
+                missingBlocks.push_back( block );
+            }
+        }
+    }
+
+    if ( missingBlocks.empty() ) {
+        return true;
+    }
+
+    LOG_DEBUG << "Fetching " << missingBlocks.size() << " blocks of " << fileName_
+              << " from block " << missingBlocks.front();
+
+    // Each fetch writes blocks through its own handle,
+    // devices of the cache file read them when they are marked
+    QFile cache( fileName_ );
+    if ( !cache.open( QIODevice::ReadWrite ) ) {
+        setErrorString( cache.errorString() );
+        return false;
+    }
+
+    auto isOk = true;
+    runNetworkRequests( [ this, &missingBlocks, &cache, &isOk ](
+                            QNetworkAccessManager& manager, QEventLoop& loop ) {
+        auto pendingReplies = missingBlocks.size();
+        for ( const auto block : missingBlocks ) {
+            const auto offset = block * BlockSize;
+            const auto length = std::min( BlockSize, source_->size - offset );
+
+            auto request = makeRequest( source_->url );
+            request.setRawHeader(
+                "Range", QString( "bytes=%1-%2" ).arg( offset ).arg( offset + length - 1 ).toLatin1() );
+
+            auto* reply = manager.get( request );
+            QObject::connect(
+                reply, &QNetworkReply::finished, &loop,
+                [ this, reply, block, offset, length, &cache, &isOk, &pendingReplies, &loop ] {
+                    reply->deleteLater();
+
+                    const auto blockData = reply->readAll();
+                    const auto status
+                        = reply->attribute( QNetworkRequest::HttpStatusCodeAttribute ).toInt();
+
+                    if ( reply->error() != QNetworkReply::NoError || status != 206
+                         || blockData.size() != length ) {
+                        LOG_ERROR << "Failed to fetch block " << block << " of "
+                                  << source_->url.toEncoded() << ", status " << status << ": "
+                                  << reply->errorString();
+                        setErrorString( reply->errorString() );
+                        isOk = false;
+                    }
+                    else if ( !cache.seek( offset ) || cache.write( blockData ) != length
+                              || !cache.flush() ) {
+                        LOG_ERROR << "Failed to cache block " << block << " of "
+                                  << source_->url.toEncoded() << ": " << cache.errorString();
+                        setErrorString( cache.errorString() );
+                        isOk = false;
+                    }
+                    else {
+                        UniqueLock lock( source_->mutex );
+                        source_->fetchedBlocks[ static_cast<size_t>( block ) ] = true;
+                    }
+
+                    if ( --pendingReplies == 0 ) {
+                        loop.quit();
+                    }
+                } );
+        }
+        return true;
+    } );
+
+    return isOk;
+}
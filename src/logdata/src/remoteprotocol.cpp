@@ -0,0 +1,326 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "remoteprotocol.h"
+
+#include <utility>
+
+#include <QDataStream>
+#include <QtEndian>
+
+#include "streamlimits.h"
+
+namespace remote {
+
+namespace {
+// Size of the body followed by type of the message
+constexpr int TypeOffset = sizeof( quint32 );
+constexpr int HeaderSize = TypeOffset + sizeof( quint8 );
+
+// Lines are short, fast compression gets most of the gain
+constexpr int LinesCompressionLevel = 1;
+
+template <typename Writer>
+QByteArray write( Writer&& writer )
+{
+    QByteArray body;
+    QDataStream stream( &body, QIODevice::WriteOnly );
+    stream.setVersion( QDataStream::Qt_5_9 );
+    writer( stream );
+    return body;
+}
+
+template <typename Reader>
+bool read( const QByteArray& body, Reader&& reader )
+{
+    QDataStream stream( body );
+    stream.setVersion( QDataStream::Qt_5_9 );
+    reader( stream );
+    return stream.status() == QDataStream::Ok;
+}
+
+// Lines never contain line feeds, they separate lines in the text
+void writeLines( QDataStream& stream, const std::vector<QString>& lines )
+{
+    QByteArray text;
+    for ( auto index = 0u; index < lines.size(); ++index ) {
+        if ( index > 0 ) {
+            text.append( '\n' );
+        }
+        text.append( lines[ index ].toUtf8() );
+    }
+
+    stream << static_cast<quint32>( lines.size() ) << qCompress( text, LinesCompressionLevel );
+}
+
+void readLines( QDataStream& stream, std::vector<QString>& lines )
+{
+    quint32 count = 0;
+    QByteArray compressedText;
+    stream >> count >> compressedText;
+
+    lines.clear();
+    if ( stream.status() != QDataStream::Ok || count == 0 ) {
+        return;
+    }
+
+    const auto splitText = qUncompress( compressedText ).split( '\n' );
+    if ( static_cast<quint32>( splitText.size() ) != count ) {
+        stream.setStatus( QDataStream::ReadCorruptData );
+        return;
+    }
+
+    lines.reserve( count );
+    for ( const auto& line : splitText ) {
+        lines.push_back( QString::fromUtf8( line ) );
+    }
+}
+} // namespace
+
+QByteArray encodeBody( const OpenRequest& message )
+{
+    return write( [ &message ]( QDataStream& stream ) {
+        stream << message.magic << message.version << message.fileName;
+    } );
+}
+
+bool decodeBody( const QByteArray& body, OpenRequest& message )
+{
+    return read( body, [ &message ]( QDataStream& stream ) {
+        stream >> message.magic >> message.version >> message.fileName;
+    } );
+}
+
+QByteArray encodeBody( const FileInfo& message )
+{
+    return write( [ &message ]( QDataStream& stream ) {
+        stream << message.generation << message.nbLines << message.fileSize << message.maxLength
+               << message.progress << message.encoding;
+    } );
+}
+
+bool decodeBody( const QByteArray& body, FileInfo& message )
+{
+    return read( body, [ &message ]( QDataStream& stream ) {
+        stream >> message.generation >> message.nbLines >> message.fileSize >> message.maxLength
+            >> message.progress >> message.encoding;
+    } );
+}
+
+QByteArray encodeBody( const LinesRequest& message )
+{
+    return write( [ &message ]( QDataStream& stream ) {
+        stream << message.firstLine << message.count;
+    } );
+}
+
+bool decodeBody( const QByteArray& body, LinesRequest& message )
+{
+    return read( body, [ &message ]( QDataStream& stream ) {
+        stream >> message.firstLine >> message.count;
+    } );
+}
+
+QByteArray encodeBody( const LinesReply& message )
+{
+    return write( [ &message ]( QDataStream& stream ) {
+        stream << message.generation << message.firstLine;
+        writeLines( stream, message.lines );
+    } );
+}
+
+bool decodeBody( const QByteArray& body, LinesReply& message )
+{
+    return read( body, [ &message ]( QDataStream& stream ) {
+        stream >> message.generation >> message.firstLine;
+        readLines( stream, message.lines );
+    } );
+}
+
+QByteArray encodeBody( const SearchRequest& message )
+{
+    return write( [ &message ]( QDataStream& stream ) {
+        const auto& pattern = message.pattern;
+        stream << message.searchId << pattern.pattern << pattern.isCaseSensitive
+               << pattern.isExclude << pattern.isBoolean << pattern.isPlainText;
+    } );
+}
+
+bool decodeBody( const QByteArray& body, SearchRequest& message )
+{
+    QString pattern;
+    bool isCaseSensitive = false;
+    bool isExclude = false;
+    bool isBoolean = false;
+    bool isPlainText = false;
+    if ( !read( body, [ & ]( QDataStream& stream ) {
+             stream >> message.searchId >> pattern >> isCaseSensitive >> isExclude >> isBoolean
+                 >> isPlainText;
+         } ) ) {
+        return false;
+    }
+
+    message.pattern
+        = RegularExpressionPattern( pattern, isCaseSensitive, isExclude, isBoolean, isPlainText );
+    return true;
+}
+
+QByteArray encodeBody( const InterruptRequest& message )
+{
+    return write( [ &message ]( QDataStream& stream ) { stream << message.searchId; } );
+}
+
+bool decodeBody( const QByteArray& body, InterruptRequest& message )
+{
+    return read( body, [ &message ]( QDataStream& stream ) { stream >> message.searchId; } );
+}
+
+QByteArray encodeBody( const EncodingRequest& message )
+{
+    return write( [ &message ]( QDataStream& stream ) { stream << message.encoding; } );
+}
+
+bool decodeBody( const QByteArray& body, EncodingRequest& message )
+{
+    return read( body, [ &message ]( QDataStream& stream ) { stream >> message.encoding; } );
+}
+
+QByteArray encodeBody( const SearchProgress& message )
+{
+    return write( [ &message ]( QDataStream& stream ) {
+        stream << message.searchId << message.nbMatches << message.progress;
+    } );
+}
+
+bool decodeBody( const QByteArray& body, SearchProgress& message )
+{
+    return read( body, [ &message ]( QDataStream& stream ) {
+        stream >> message.searchId >> message.nbMatches >> message.progress;
+    } );
+}
+
+QByteArray encodeBody( const SearchResults& message )
+{
+    QByteArray matches( static_cast<int>( message.matches.getSizeInBytes( true ) ),
+                        Qt::Uninitialized );
+    message.matches.write( matches.data(), true );
+
+    return write( [ &message, &matches ]( QDataStream& stream ) {
+        stream << message.searchId << matches;
+    } );
+}
+
+bool decodeBody( const QByteArray& body, SearchResults& message )
+{
+    QByteArray matches;
+    if ( !read( body, [ &message, &matches ]( QDataStream& stream ) {
+             stream >> message.searchId >> matches;
+         } ) ) {
+        return false;
+    }
+
+    if ( matches.isEmpty() ) {
+        message.matches = {};
+        return true;
+    }
+
+    // Bitmap comes from the network, it is not trusted to fit the message
+    auto decodedMatches = readBitmap<SearchResultArray>( matches );
+    if ( !decodedMatches ) {
+        return false;
+    }
+
+    message.matches = std::move( *decodedMatches );
+    return message.matches.getSizeInBytes( true ) == static_cast<size_t>( matches.size() );
+}
+
+QByteArray encodeBody( const MatchedLinesRequest& message )
+{
+    return write( [ &message ]( QDataStream& stream ) {
+        stream << message.searchId << message.firstIndex << message.count;
+    } );
+}
+
+bool decodeBody( const QByteArray& body, MatchedLinesRequest& message )
+{
+    return read( body, [ &message ]( QDataStream& stream ) {
+        stream >> message.searchId >> message.firstIndex >> message.count;
+    } );
+}
+
+QByteArray encodeBody( const MatchedLinesReply& message )
+{
+    return write( [ &message ]( QDataStream& stream ) {
+        stream << message.searchId << message.firstIndex;
+        writeLines( stream, message.lines );
+    } );
+}
+
+bool decodeBody( const QByteArray& body, MatchedLinesReply& message )
+{
+    return read( body, [ &message ]( QDataStream& stream ) {
+        stream >> message.searchId >> message.firstIndex;
+        readLines( stream, message.lines );
+    } );
+}
+
+QByteArray encodeBody( const ErrorReply& message )
+{
+    return write( [ &message ]( QDataStream& stream ) { stream << message.message; } );
+}
+
+bool decodeBody( const QByteArray& body, ErrorReply& message )
+{
+    return read( body, [ &message ]( QDataStream& stream ) { stream >> message.message; } );
+}
+
+QByteArray frame( MessageType type, const QByteArray& body )
+{
+    QByteArray message( HeaderSize, Qt::Uninitialized );
+    qToBigEndian( static_cast<quint32>( body.size() ), message.data() );
+    message[ TypeOffset ] = static_cast<char>( type );
+    message.append( body );
+    return message;
+}
+
+std::optional<Message> takeMessage( QByteArray& received, bool& isBroken )
+{
+    isBroken = false;
+    if ( received.size() < HeaderSize ) {
+        return {};
+    }
+
+    const auto bodySize = qFromBigEndian<quint32>( received.constData() );
+    if ( bodySize > MaxMessageSize ) {
+        isBroken = true;
+        return {};
+    }
+
+    const auto messageSize = HeaderSize + static_cast<int>( bodySize );
+    if ( received.size() < messageSize ) {
+        return {};
+    }
+
+    Message message{ static_cast<MessageType>( received.at( TypeOffset ) ),
+                     received.mid( HeaderSize, static_cast<int>( bodySize ) ) };
+    received.remove( 0, messageSize );
+    return message;
+}
+
+} // namespace remote
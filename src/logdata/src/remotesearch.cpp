@@ -0,0 +1,188 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "remotesearch.h"
+
+#include <utility>
+
+#include <QTextCodec>
+
+#include "log.h"
+
+RemoteSearch::RemoteSearch()
+{
+    connect( &socket_, &QTcpSocket::readyRead, this, &RemoteSearch::readMessages );
+
+    const auto handleError = [ this ]() {
+        LOG_WARNING << "Connection to agent failed: " << socket_.errorString();
+        Q_EMIT errorReceived( socket_.errorString() );
+    };
+#if QT_VERSION >= QT_VERSION_CHECK( 5, 15, 0 )
+    connect( &socket_, &QTcpSocket::errorOccurred, this, handleError );
+#else
+    connect( &socket_, QOverload<QAbstractSocket::SocketError>::of( &QTcpSocket::error ), this,
+             handleError );
+#endif
+}
+
+void RemoteSearch::attachFile( const QString& host, quint16 port, const QString& fileName )
+{
+    LOG_INFO << "Opening " << fileName << " on " << host << ":" << port;
+
+    fileName_ = fileName;
+    socket_.connectToHost( host, port );
+
+    remote::OpenRequest request;
+    request.fileName = fileName;
+    send( remote::encode( request ) );
+}
+
+QString RemoteSearch::getFileName() const
+{
+    return fileName_;
+}
+
+qint64 RemoteSearch::getFileSize() const
+{
+    return fileInfo_.fileSize;
+}
+
+LinesCount RemoteSearch::getNbLines() const
+{
+    return LinesCount( fileInfo_.nbLines );
+}
+
+bool RemoteSearch::isConnected() const
+{
+    return socket_.state() == QAbstractSocket::ConnectedState;
+}
+
+void RemoteSearch::setDisplayEncoding( const char* encoding )
+{
+    displayEncoding_ = QTextCodec::codecForName( encoding );
+
+    remote::EncodingRequest request;
+    request.encoding = encoding;
+    send( remote::encode( request ) );
+}
+
+QTextCodec* RemoteSearch::getDisplayEncoding() const
+{
+    if ( displayEncoding_ ) {
+        return displayEncoding_;
+    }
+
+    const auto detectedEncoding = QTextCodec::codecForName( fileInfo_.encoding );
+    return detectedEncoding ? detectedEncoding : QTextCodec::codecForLocale();
+}
+
+void RemoteSearch::runSearch( const RegularExpressionPattern& pattern )
+{
+    remote::SearchRequest request;
+    request.searchId = ++searchId_;
+    request.pattern = pattern;
+    send( remote::encode( request ) );
+
+    matchingLines_ = {};
+}
+
+void RemoteSearch::interruptSearch()
+{
+    remote::InterruptRequest request;
+    request.searchId = searchId_;
+    send( remote::encode( request ) );
+}
+
+const SearchResultArray& RemoteSearch::getMatchingLines() const
+{
+    return matchingLines_;
+}
+
+void RemoteSearch::fetchMatchedLines( quint64 firstIndex, quint64 count )
+{
+    remote::MatchedLinesRequest request;
+    request.searchId = searchId_;
+    request.firstIndex = firstIndex;
+    request.count = count;
+    send( remote::encode( request ) );
+}
+
+void RemoteSearch::send( const QByteArray& message )
+{
+    // Messages written before connection is established are sent after it
+    socket_.write( message );
+}
+
+void RemoteSearch::readMessages()
+{
+    received_.append( socket_.readAll() );
+
+    bool isBroken = false;
+    while ( const auto message = remote::takeMessage( received_, isBroken ) ) {
+        handleMessage( *message );
+    }
+
+    if ( isBroken ) {
+        LOG_ERROR << "Broken message from agent, disconnecting";
+        received_.clear();
+        socket_.abort();
+    }
+}
+
+void RemoteSearch::handleMessage( const remote::Message& message )
+{
+    switch ( message.type ) {
+    case remote::MessageType::FileInfo:
+        if ( const auto fileInfo = remote::decode<remote::FileInfo>( message ) ) {
+            fileInfo_ = *fileInfo;
+        }
+        break;
+    case remote::MessageType::SearchProgress:
+        if ( const auto progress = remote::decode<remote::SearchProgress>( message ) ) {
+            if ( progress->searchId == searchId_ ) {
+                Q_EMIT searchProgressed( LinesCount( progress->nbMatches ), progress->progress );
+            }
+        }
+        break;
+    case remote::MessageType::SearchResults:
+        if ( auto results = remote::decode<remote::SearchResults>( message ) ) {
+            if ( results->searchId == searchId_ ) {
+                matchingLines_ = std::move( results->matches );
+                Q_EMIT searchFinished();
+            }
+        }
+        break;
+    case remote::MessageType::MatchedLines:
+        if ( const auto reply = remote::decode<remote::MatchedLinesReply>( message ) ) {
+            if ( reply->searchId == searchId_ ) {
+                Q_EMIT matchedLinesReceived( reply->firstIndex, reply->lines );
+            }
+        }
+        break;
+    case remote::MessageType::Error:
+        if ( const auto error = remote::decode<remote::ErrorReply>( message ) ) {
+            LOG_WARNING << "Agent error: " << error->message;
+            Q_EMIT errorReceived( error->message );
+        }
+        break;
+    default:
+        LOG_WARNING << "Unexpected message from agent " << static_cast<int>( message.type );
+        break;
+    }
+}
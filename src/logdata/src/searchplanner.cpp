@@ -0,0 +1,154 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "searchplanner.h"
+
+#include <algorithm>
+#include <string>
+
+SearchPlanner::SearchPlanner( size_t termsCount, const Expression& expression, LineNumber first,
+                              LineNumber last )
+    : termsCount_( termsCount )
+    , first_( first )
+    , last_( last )
+{
+    if ( termsCount_ == 0 || termsCount_ > MaxTerms ) {
+        return;
+    }
+
+    const auto combinations = uint32_t{ 1 } << termsCount_;
+    truthTable_.resize( combinations );
+    std::string matchedTerms( termsCount_, '\0' );
+    for ( auto combination = 0u; combination < combinations; ++combination ) {
+        for ( auto term = 0u; term < termsCount_; ++term ) {
+            matchedTerms[ term ] = static_cast<char>( ( combination >> term ) & 1 );
+        }
+        truthTable_[ combination ] = expression( matchedTerms );
+    }
+}
+
+void SearchPlanner::setCandidateLines( size_t term, roaring::Roaring64Map lines )
+{
+    addTermLines( term, std::move( lines ), false );
+}
+
+void SearchPlanner::setMatchingLines( size_t term, roaring::Roaring64Map lines )
+{
+    addTermLines( term, std::move( lines ), true );
+}
+
+void SearchPlanner::addTermLines( size_t term, roaring::Roaring64Map lines, bool isExact )
+{
+    if ( term >= termsCount_ ) {
+        return;
+    }
+
+    const auto termLines
+        = std::find_if( lookedUpTerms_.begin(), lookedUpTerms_.end(),
+                        [ term ]( const TermLines& lookedUp ) { return lookedUp.term == term; } );
+    if ( termLines == lookedUpTerms_.end() ) {
+        lookedUpTerms_.push_back( { term, std::move( lines ), isExact } );
+    }
+    else if ( isExact || !termLines->isExact ) {
+        // Exact lines are better than candidates of any size
+        termLines->lines = std::move( lines );
+        termLines->isExact = isExact;
+    }
+}
+
+std::optional<SearchPlanner::Plan> SearchPlanner::plan() const
+{
+    if ( truthTable_.empty() || lookedUpTerms_.empty() || truthTable_.front()
+         || first_ >= last_ ) {
+        return {};
+    }
+
+    // Smaller sets of lines leave less lines for the next terms
+    std::vector<const TermLines*> terms;
+    for ( const auto& termLines : lookedUpTerms_ ) {
+        terms.push_back( &termLines );
+    }
+    std::sort( terms.begin(), terms.end(), []( const TermLines* lhs, const TermLines* rhs ) {
+        return lhs->lines.cardinality() < rhs->lines.cardinality();
+    } );
+    terms.resize( std::min( terms.size(), MaxLookedUpTerms ) );
+
+    roaring::Roaring64Map lines;
+    lines.addRange( first_.get(), last_.get() );
+    auto outcome = planLines( terms, 0, 0, 0, lines );
+
+    Plan plan;
+    plan.matchingLines = std::move( outcome.mustMatch );
+    plan.scannedLines = std::move( outcome.mayMatch );
+    plan.scannedLines -= plan.matchingLines;
+    plan.matchingLines.runOptimize();
+    plan.scannedLines.runOptimize();
+    return plan;
+}
+
+SearchPlanner::LinesOutcome SearchPlanner::planLines( const std::vector<const TermLines*>& terms,
+                                                      size_t nextTerm, uint32_t knownTerms,
+                                                      uint32_t matchedTerms,
+                                                      const roaring::Roaring64Map& lines ) const
+{
+    if ( lines.isEmpty() ) {
+        return {};
+    }
+
+    // Expression for known terms and any of the unknown ones
+    auto canBeTrue = false;
+    auto canBeFalse = false;
+    for ( auto combination = 0u; combination < truthTable_.size(); ++combination ) {
+        if ( ( combination & knownTerms ) == matchedTerms ) {
+            ( truthTable_[ combination ] ? canBeTrue : canBeFalse ) = true;
+        }
+    }
+
+    if ( !canBeTrue ) {
+        return {};
+    }
+    if ( !canBeFalse ) {
+        return { lines, lines };
+    }
+    if ( nextTerm == terms.size() ) {
+        return { lines, {} };
+    }
+
+    const auto& termLines = *terms[ nextTerm ];
+    const auto termBit = uint32_t{ 1 } << termLines.term;
+    const auto linesWithTerm = lines & termLines.lines;
+
+    const auto withTerm = planLines( terms, nextTerm + 1, knownTerms | termBit,
+                                     matchedTerms | termBit, linesWithTerm );
+    if ( termLines.isExact ) {
+        const auto withoutTerm = planLines( terms, nextTerm + 1, knownTerms | termBit,
+                                            matchedTerms, lines - linesWithTerm );
+        return { withTerm.mayMatch | withoutTerm.mayMatch,
+                 withTerm.mustMatch | withoutTerm.mustMatch };
+    }
+
+    // Candidates may or may not match the term, they
+    // must match the expression in both cases to be resolved
+    const auto withoutTerm
+        = planLines( terms, nextTerm + 1, knownTerms | termBit, matchedTerms, lines );
+    return { withTerm.mayMatch | withoutTerm.mayMatch,
+             ( withoutTerm.mustMatch - linesWithTerm )
+                 | ( withoutTerm.mustMatch & withTerm.mustMatch ) };
+}
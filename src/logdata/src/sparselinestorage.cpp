@@ -0,0 +1,372 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "sparselinestorage.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include <QDataStream>
+
+#include "linescanner.h"
+#include "log.h"
+#include "streamlimits.h"
+
+namespace {
+
+std::shared_ptr<const SparseLinePositionStorage::Positions>
+decodePositions( const SparseLinePositionStorage::DataReader& reader,
+                 const EncodingParameters& encodingParams, size_t block, LineOffset blockStart,
+                 LineOffset blockEnd )
+{
+    constexpr auto CheckpointInterval = SparseLinePositionStorage::CheckpointInterval;
+
+    auto positions = std::make_shared<SparseLinePositionStorage::Positions>();
+    positions->reserve( CheckpointInterval );
+
+    const auto data
+        = reader ? reader( blockStart.get(), ( blockEnd - blockStart ).get() ) : QByteArray{};
+
+    const auto lineFeedWidth = encodingParams.lineFeedWidth;
+    line_scanner::forEachDelimeter(
+        std::string_view( data.data(), static_cast<size_t>( data.size() ) ), 0, encodingParams,
+        [ &positions, blockStart, blockEnd, lineFeedWidth ]( int delimeterPos, bool isLineFeed ) {
+            if ( !isLineFeed ) {
+                return true;
+            }
+
+            const auto lineEnd = blockStart + LineOffset( delimeterPos + lineFeedWidth );
+            if ( lineEnd >= blockEnd ) {
+                return false;
+            }
+
+            positions->push_back( lineEnd );
+            return positions->size() < CheckpointInterval - 1;
+        } );
+
+    // Checkpoint is the end of the last line in the block, it can also be
+    // a fake final line feed that is not in the file
+    positions->push_back( blockEnd );
+
+    if ( positions->size() != CheckpointInterval ) {
+        LOG_WARNING << "Sparse index block " << block << " has " << positions->size()
+                    << " lines, file has changed?";
+    }
+
+    return positions;
+}
+
+} // namespace
+
+void SparseLinePositionStorage::MissingBlocks::decode()
+{
+    for ( auto& block : blocks ) {
+        block.positions
+            = decodePositions( reader, encodingParams, block.index, block.start, block.end );
+    }
+}
+
+SparseLinePositionStorage::SparseLinePositionStorage( DataReader reader )
+    : reader_( std::move( reader ) )
+{
+}
+
+SparseLinePositionStorage::SparseLinePositionStorage( SparseLinePositionStorage&& orig ) noexcept
+{
+    *this = std::move( orig );
+}
+
+SparseLinePositionStorage&
+SparseLinePositionStorage::operator=( SparseLinePositionStorage&& orig ) noexcept
+{
+    reader_ = std::move( orig.reader_ );
+    encodingParams_ = orig.encodingParams_;
+    checkpoints_ = std::move( orig.checkpoints_ );
+    tail_ = std::move( orig.tail_ );
+
+    clearRecentBlocks();
+    orig.clearRecentBlocks();
+
+    return *this;
+}
+
+void SparseLinePositionStorage::setReader( DataReader reader )
+{
+    reader_ = std::move( reader );
+    clearRecentBlocks();
+}
+
+void SparseLinePositionStorage::setEncodingParameters( const EncodingParameters& encodingParams )
+{
+    if ( encodingParams_ != encodingParams ) {
+        encodingParams_ = encodingParams;
+        clearRecentBlocks();
+    }
+}
+
+void SparseLinePositionStorage::append( LineOffset pos )
+{
+    tail_.push_back( pos );
+
+    if ( tail_.size() == CheckpointInterval ) {
+        checkpoints_.push_back( pos );
+        tail_.clear();
+    }
+}
+
+void SparseLinePositionStorage::append_list( const std::vector<LineOffset>& positions )
+{
+    for ( auto position : positions ) {
+        append( position );
+    }
+}
+
+void SparseLinePositionStorage::pop_back()
+{
+    if ( !tail_.empty() ) {
+        tail_.pop_back();
+        return;
+    }
+
+    if ( checkpoints_.empty() ) {
+        return;
+    }
+
+    // Last block has to be restored as tail
+    const auto lastBlock = checkpoints_.size() - 1;
+    const auto blockPositions = getBlock( lastBlock );
+
+    tail_.assign( blockPositions->begin(), blockPositions->end() - 1 );
+    checkpoints_.pop_back();
+
+    clearRecentBlocks();
+}
+
+LineOffset SparseLinePositionStorage::at( LineNumber index, Cache* lastPosition ) const
+{
+    if ( index.get() >= size().get() ) {
+        LOG_ERROR << "Line number not in storage: " << index.get() << ", storage size is "
+                  << size();
+        throw std::runtime_error( "Line number not in storage" );
+    }
+
+    const auto block = static_cast<size_t>( index.get() / CheckpointInterval );
+    const auto indexInBlock = static_cast<size_t>( index.get() % CheckpointInterval );
+
+    if ( block == checkpoints_.size() ) {
+        return tail_[ indexInBlock ];
+    }
+
+    if ( indexInBlock == CheckpointInterval - 1 ) {
+        return checkpoints_[ block ];
+    }
+
+    std::shared_ptr<const Positions> positions;
+    if ( lastPosition != nullptr && lastPosition->block == block && lastPosition->positions ) {
+        positions = lastPosition->positions;
+    }
+    else {
+        positions = getBlock( block );
+        if ( lastPosition != nullptr ) {
+            lastPosition->block = block;
+            lastPosition->positions = positions;
+        }
+    }
+
+    return indexInBlock < positions->size() ? ( *positions )[ indexInBlock ]
+                                            : checkpoints_[ block ];
+}
+
+void SparseLinePositionStorage::range( LineNumber first, LinesCount count,
+                                       std::vector<qint64>& positions ) const
+{
+    positions.reserve( positions.size() + static_cast<size_t>( count.get() ) );
+
+    // Cache keeps decoded block between lines
+    Cache cache;
+    for ( auto index = first.get(); index < first.get() + count.get(); ++index ) {
+        positions.push_back( at( LineNumber( index ), &cache ).get() );
+    }
+}
+
+SparseLinePositionStorage::MissingBlocks
+SparseLinePositionStorage::missingBlocks( LineNumber first, LinesCount count ) const
+{
+    MissingBlocks missing;
+    if ( count.get() == 0 || first.get() + count.get() > size().get() ) {
+        return missing;
+    }
+
+    // Lines of the tail are kept in memory
+    const auto firstBlock = static_cast<size_t>( first.get() / CheckpointInterval );
+    if ( firstBlock >= checkpoints_.size() ) {
+        return missing;
+    }
+
+    // Blocks past the number of kept ones would be decoded in vain
+    const auto lastBlock = std::min(
+        { static_cast<size_t>( ( first.get() + count.get() - 1 ) / CheckpointInterval ),
+          checkpoints_.size() - 1, firstBlock + RecentBlocksCount - 1 } );
+
+    ScopedLock lock( recentBlocksMutex_ );
+    for ( auto block = firstBlock; block <= lastBlock; ++block ) {
+        const auto isDecoded
+            = std::any_of( recentBlocks_.begin(), recentBlocks_.end(),
+                           [ block ]( const auto& recent ) { return recent.first == block; } );
+        if ( !isDecoded ) {
+            missing.blocks.push_back( { block, blockStart( block ), checkpoints_[ block ], {} } );
+        }
+    }
+
+    if ( !missing.blocks.empty() ) {
+        missing.reader = reader_;
+        missing.encodingParams = encodingParams_;
+    }
+
+    return missing;
+}
+
+void SparseLinePositionStorage::addDecodedBlocks( const MissingBlocks& missing ) const
+{
+    // Blocks decoded with other encoding or before the storage
+    // has changed are dropped, they are decoded again when used
+    if ( missing.encodingParams != encodingParams_ ) {
+        return;
+    }
+
+    for ( const auto& block : missing.blocks ) {
+        if ( block.positions && block.index < checkpoints_.size()
+             && blockStart( block.index ) == block.start
+             && checkpoints_[ block.index ] == block.end ) {
+            addRecentBlock( block.index, block.positions );
+        }
+    }
+}
+
+std::shared_ptr<const SparseLinePositionStorage::Positions>
+SparseLinePositionStorage::getBlock( size_t block ) const
+{
+    {
+        ScopedLock lock( recentBlocksMutex_ );
+        const auto recentBlock
+            = std::find_if( recentBlocks_.begin(), recentBlocks_.end(),
+                            [ block ]( const auto& recent ) { return recent.first == block; } );
+        if ( recentBlock != recentBlocks_.end() ) {
+            auto positions = recentBlock->second;
+            std::rotate( recentBlock, recentBlock + 1, recentBlocks_.end() );
+            return positions;
+        }
+    }
+
+    auto positions = decodeBlock( block );
+    addRecentBlock( block, positions );
+    return positions;
+}
+
+std::shared_ptr<const SparseLinePositionStorage::Positions>
+SparseLinePositionStorage::decodeBlock( size_t block ) const
+{
+    return decodePositions( reader_, encodingParams_, block, blockStart( block ),
+                            checkpoints_[ block ] );
+}
+
+void SparseLinePositionStorage::addRecentBlock( size_t block,
+                                                std::shared_ptr<const Positions> positions ) const
+{
+    ScopedLock lock( recentBlocksMutex_ );
+    const auto isDecoded
+        = std::any_of( recentBlocks_.begin(), recentBlocks_.end(),
+                       [ block ]( const auto& recent ) { return recent.first == block; } );
+    if ( isDecoded ) {
+        return;
+    }
+
+    if ( recentBlocks_.size() == RecentBlocksCount ) {
+        recentBlocks_.erase( recentBlocks_.begin() );
+    }
+    recentBlocks_.emplace_back( block, std::move( positions ) );
+}
+
+void SparseLinePositionStorage::clearRecentBlocks()
+{
+    ScopedLock lock( recentBlocksMutex_ );
+    recentBlocks_.clear();
+}
+
+size_t SparseLinePositionStorage::allocatedSize() const
+{
+    const auto positionsSize = ( checkpoints_.capacity() + tail_.capacity() ) * sizeof( LineOffset );
+
+    ScopedLock lock( recentBlocksMutex_ );
+    return positionsSize + recentBlocks_.size() * CheckpointInterval * sizeof( LineOffset );
+}
+
+void SparseLinePositionStorage::save( QDataStream& stream ) const
+{
+    const auto savePositions = [ &stream ]( const Positions& positions ) {
+        stream << static_cast<quint64>( positions.size() );
+        for ( const auto& position : positions ) {
+            stream << static_cast<qint64>( position.get() );
+        }
+    };
+
+    stream << static_cast<quint64>( CheckpointInterval );
+    savePositions( checkpoints_ );
+    savePositions( tail_ );
+}
+
+bool SparseLinePositionStorage::load( QDataStream& stream )
+{
+    const auto loadPositions = [ &stream ]( Positions& positions ) {
+        quint64 count = 0;
+        stream >> count;
+        if ( stream.status() != QDataStream::Ok
+             || !isCountInStream( stream, count, sizeof( qint64 ) ) ) {
+            return false;
+        }
+
+        positions.reserve( static_cast<size_t>( count ) );
+        for ( auto i = 0u; i < count && stream.status() == QDataStream::Ok; ++i ) {
+            qint64 position = 0;
+            stream >> position;
+            positions.emplace_back( position );
+        }
+
+        return stream.status() == QDataStream::Ok;
+    };
+
+    quint64 checkpointInterval = 0;
+    stream >> checkpointInterval;
+    if ( checkpointInterval != CheckpointInterval ) {
+        return false;
+    }
+
+    Positions checkpoints;
+    Positions tail;
+    if ( !loadPositions( checkpoints ) || !loadPositions( tail )
+         || tail.size() >= CheckpointInterval ) {
+        return false;
+    }
+
+    checkpoints_ = std::move( checkpoints );
+    tail_ = std::move( tail );
+    clearRecentBlocks();
+
+    return true;
+}
@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "tabexpansionindex.h"
+
+#include <algorithm>
+
+#include "linetypes.h"
+
+TabExpansionIndex::TabExpansionIndex( const QString& line )
+    : line_( line )
+    , tabPositions_( line_ )
+{
+    const auto& tabs = tabPositions_.tabs();
+    tabColumns_.reserve( tabs.size() );
+    tabEndColumns_.reserve( tabs.size() );
+
+    int column = 0;
+    int position = 0;
+    for ( const auto tab : tabs ) {
+        column += tab - position;
+        tabColumns_.push_back( column );
+        column += TabStop - column % TabStop;
+        tabEndColumns_.push_back( column );
+        position = tab + 1;
+    }
+
+    expandedLength_ = column + line_.size() - position;
+}
+
+int TabExpansionIndex::expandedColumn( int position ) const
+{
+    if ( position >= line_.size() ) {
+        return expandedLength_;
+    }
+
+    const auto& tabs = tabPositions_.tabs();
+    const auto tab
+        = static_cast<size_t>( std::lower_bound( tabs.begin(), tabs.end(), position ) - tabs.begin() );
+    if ( tab < tabs.size() && tabs[ tab ] == position ) {
+        return tabColumns_[ tab ];
+    }
+    if ( tab == 0 ) {
+        return position;
+    }
+
+    return tabEndColumns_[ tab - 1 ] + position - tabs[ tab - 1 ] - 1;
+}
+
+std::pair<int, int> TabExpansionIndex::characterAt( int column ) const
+{
+    if ( column >= expandedLength_ ) {
+        return { line_.size(), expandedLength_ };
+    }
+
+    // Tabs before the column are the ones ending at or before it
+    const auto& tabs = tabPositions_.tabs();
+    const auto tab = static_cast<size_t>(
+        std::upper_bound( tabEndColumns_.begin(), tabEndColumns_.end(), column )
+        - tabEndColumns_.begin() );
+    if ( tab < tabs.size() && tabColumns_[ tab ] <= column ) {
+        return { tabs[ tab ], tabColumns_[ tab ] };
+    }
+    if ( tab == 0 ) {
+        return { column, column };
+    }
+
+    return { tabs[ tab - 1 ] + 1 + column - tabEndColumns_[ tab - 1 ], column };
+}
+
+QString TabExpansionIndex::expandedLine() const
+{
+    return tabPositions_.expand( QString( line_ ) );
+}
+
+QString TabExpansionIndex::expandedWindow( int firstColumn, int nbColumns ) const
+{
+    if ( firstColumn >= expandedLength_ || nbColumns <= 0 ) {
+        return {};
+    }
+
+    const auto [ begin, beginColumn ] = characterAt( firstColumn );
+
+    // Tab partially in the window is a part of it
+    const auto lastColumn = firstColumn + nbColumns;
+    auto [ end, endColumn ] = characterAt( lastColumn );
+    if ( end < line_.size() && endColumn < lastColumn ) {
+        ++end;
+    }
+
+    return untabify( line_.mid( begin, end - begin ), beginColumn )
+        .mid( firstColumn - beginColumn, nbColumns );
+}
@@ -0,0 +1,181 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "tabpositions.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+#include "linescanner.h"
+#include "linetypes.h"
+
+#if defined( __x86_64__ ) || defined( _M_X64 )
+#define KLOGG_TABS_SSE2
+#include <emmintrin.h>
+#elif defined( __aarch64__ )
+#define KLOGG_TABS_NEON
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+constexpr int BlockSize = 16;
+
+// Bit i is set if character i of the block is a tab (or a null)
+struct SpecialMasks {
+    uint32_t tabs;
+    uint32_t nulls;
+};
+
+SpecialMasks scanBlockScalar( const char16_t* data )
+{
+    SpecialMasks masks{ 0, 0 };
+    for ( auto i = 0; i < BlockSize; ++i ) {
+        masks.tabs |= static_cast<uint32_t>( data[ i ] == u'\t' ) << i;
+        masks.nulls |= static_cast<uint32_t>( data[ i ] == u'\0' ) << i;
+    }
+    return masks;
+}
+
+#if defined( KLOGG_TABS_SSE2 )
+// SSE2 is always there on x86-64, no need to choose at runtime
+SpecialMasks scanBlock( const char16_t* data )
+{
+    const auto low = _mm_loadu_si128( reinterpret_cast<const __m128i*>( data ) );
+    const auto high = _mm_loadu_si128( reinterpret_cast<const __m128i*>( data + 8 ) );
+
+    const auto tab = _mm_set1_epi16( '\t' );
+    const auto zero = _mm_setzero_si128();
+
+    // Comparison gives 16-bit lanes of all ones, they are saturated to bytes
+    const auto tabs = _mm_packs_epi16( _mm_cmpeq_epi16( low, tab ), _mm_cmpeq_epi16( high, tab ) );
+    const auto nulls
+        = _mm_packs_epi16( _mm_cmpeq_epi16( low, zero ), _mm_cmpeq_epi16( high, zero ) );
+
+    return { static_cast<uint32_t>( _mm_movemask_epi8( tabs ) ),
+             static_cast<uint32_t>( _mm_movemask_epi8( nulls ) ) };
+}
+#elif defined( KLOGG_TABS_NEON )
+// Blocks are only tested on NEON, ones with tabs are scanned again
+SpecialMasks scanBlock( const char16_t* data )
+{
+    const auto low = vld1q_u16( reinterpret_cast<const uint16_t*>( data ) );
+    const auto high = vld1q_u16( reinterpret_cast<const uint16_t*>( data + 8 ) );
+
+    const auto tab = vdupq_n_u16( '\t' );
+    const auto zero = vdupq_n_u16( 0 );
+
+    const auto special = vorrq_u16( vorrq_u16( vceqq_u16( low, tab ), vceqq_u16( high, tab ) ),
+                                    vorrq_u16( vceqq_u16( low, zero ), vceqq_u16( high, zero ) ) );
+    if ( vmaxvq_u16( special ) == 0 ) {
+        return { 0, 0 };
+    }
+
+    return scanBlockScalar( data );
+}
+#else
+SpecialMasks scanBlock( const char16_t* data )
+{
+    return scanBlockScalar( data );
+}
+#endif
+
+} // namespace
+
+TabPositions::TabPositions( QStringView line )
+{
+    const auto data = reinterpret_cast<const char16_t*>( line.data() );
+    const auto size = static_cast<int>( line.size() );
+
+    const auto addBlock = [ this ]( int blockStart, SpecialMasks masks ) {
+        hasNulls_ = hasNulls_ || masks.nulls != 0;
+        while ( masks.tabs != 0 ) {
+            tabs_.push_back( blockStart + line_scanner::countTrailingZeros( masks.tabs ) );
+            masks.tabs &= masks.tabs - 1;
+        }
+    };
+
+    auto blockStart = 0;
+    for ( ; blockStart + BlockSize <= size; blockStart += BlockSize ) {
+        const auto masks = scanBlock( data + blockStart );
+        if ( ( masks.tabs | masks.nulls ) != 0 ) {
+            addBlock( blockStart, masks );
+        }
+    }
+
+    if ( blockStart < size ) {
+        // Padding is neither a tab nor a null
+        std::array<char16_t, BlockSize> paddedBlock;
+        paddedBlock.fill( u' ' );
+        std::memcpy( paddedBlock.data(), data + blockStart,
+                     static_cast<size_t>( size - blockStart ) * sizeof( char16_t ) );
+        addBlock( blockStart, scanBlock( paddedBlock.data() ) );
+    }
+}
+
+int TabPositions::expandedLength( int lineLength, int initialPosition ) const
+{
+    auto column = initialPosition;
+    auto position = 0;
+    for ( const auto tab : tabs_ ) {
+        column += tab - position;
+        column += TabStop - column % TabStop;
+        position = tab + 1;
+    }
+
+    return column + lineLength - position - initialPosition;
+}
+
+QString TabPositions::expand( QString&& line, int initialPosition ) const
+{
+    if ( hasNulls_ ) {
+        line.replace( QChar::Null, QChar::Space );
+    }
+
+    if ( tabs_.empty() ) {
+        return std::move( line );
+    }
+
+    // Result is built in one allocation, text between tabs is copied as a whole
+    QString expandedLine( expandedLength( line.size(), initialPosition ), QChar::Space );
+    auto output = expandedLine.data();
+
+    auto column = initialPosition;
+    auto position = 0;
+    for ( const auto tab : tabs_ ) {
+        output = std::copy( line.constData() + position, line.constData() + tab, output );
+        column += tab - position;
+
+        const auto spaces = TabStop - column % TabStop;
+        output += spaces;
+        column += spaces;
+        position = tab + 1;
+    }
+    std::copy( line.constData() + position, line.constData() + line.size(), output );
+
+    return expandedLine;
+}
+
+QString untabify( QString&& line, int initialPosition )
+{
+    const auto tabPositions = TabPositions( line );
+    return tabPositions.expand( std::move( line ), initialPosition );
+}
@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "tailwatcher.h"
+
+#include <algorithm>
+#include <string_view>
+#include <utility>
+
+#include "log.h"
+#include "logdata.h"
+#include "regularexpression.h"
+
+namespace {
+constexpr LinesCount::UnderlyingType ChunkLines = 5000;
+} // namespace
+
+TailWatcher::TailWatcher( const LogData* logData, std::vector<RegularExpressionPattern> patterns )
+    : logData_( logData )
+    , patterns_( std::move( patterns ) )
+{
+}
+
+TailWatcher::~TailWatcher() = default;
+
+size_t TailWatcher::size() const
+{
+    return patterns_.size();
+}
+
+void TailWatcher::skipLines( LinesCount count )
+{
+    watchedLines_ = count;
+}
+
+std::vector<uint64_t> TailWatcher::watch( LinesCount count, const AtomicFlag& interruptRequested )
+{
+    if ( patterns_.empty() ) {
+        return {};
+    }
+
+    if ( !expression_ ) {
+        expression_ = std::make_unique<MultiRegularExpression>( patterns_ );
+        if ( !expression_->isValid() ) {
+            LOG_WARNING << "Can't watch patterns: " << expression_->errorString();
+        }
+        else {
+            matcher_ = expression_->createMatcher();
+        }
+    }
+
+    if ( !matcher_ ) {
+        return {};
+    }
+
+    if ( count < watchedLines_ ) {
+        LOG_INFO << "Watched file is truncated to " << count << " lines";
+        watchedLines_ = 0_lcount;
+    }
+
+    const auto patternsCount = expression_->size();
+    std::vector<uint64_t> matchesCount( patternsCount, 0 );
+
+    LogData::RawLines rawLines;
+    std::vector<std::string_view> utf8Lines;
+    MatchedPatterns matches( patternsCount, 0 );
+    while ( watchedLines_ < count && !interruptRequested ) {
+        const auto chunkLines = std::min( count - watchedLines_, LinesCount( ChunkLines ) );
+        logData_->getLinesRaw( LineNumber( watchedLines_.get() ), chunkLines, rawLines );
+        rawLines.buildUtf8View( utf8Lines );
+
+        for ( const auto& line : utf8Lines ) {
+            matcher_->match( line, matches );
+            for ( auto pattern = 0u; pattern < patternsCount; ++pattern ) {
+                matchesCount[ pattern ] += matches[ pattern ] ? 1 : 0;
+            }
+        }
+
+        watchedLines_ = watchedLines_ + chunkLines;
+    }
+
+    return matchesCount;
+}
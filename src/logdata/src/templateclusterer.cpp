@@ -0,0 +1,229 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "templateclusterer.h"
+
+#include <algorithm>
+#include <utility>
+
+#include <tbb/enumerable_thread_specific.h>
+#include <tbb/parallel_for.h>
+
+#include "linechunks.h"
+#include "log.h"
+#include "logdata.h"
+
+namespace {
+constexpr LinesCount::UnderlyingType ChunkLines = 5000;
+
+bool hasDigits( std::string_view token )
+{
+    return std::any_of( token.begin(), token.end(), []( char c ) { return c >= '0' && c <= '9'; } );
+}
+
+bool isSpace( char c )
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+struct ThreadTemplates {
+    TemplateMiner miner;
+    std::vector<SearchResultArray> lines;
+};
+} // namespace
+
+TemplateMiner::TemplateId TemplateMiner::add( std::string_view line )
+{
+    lineTokens_.clear();
+
+    size_t pos = 0;
+    while ( pos < line.size() && lineTokens_.size() < MaxTokens ) {
+        while ( pos < line.size() && isSpace( line[ pos ] ) ) {
+            ++pos;
+        }
+        const auto tokenStart = pos;
+        while ( pos < line.size() && !isSpace( line[ pos ] ) ) {
+            ++pos;
+        }
+        if ( pos > tokenStart ) {
+            const auto token = line.substr( tokenStart, pos - tokenStart );
+            lineTokens_.push_back( hasDigits( token ) ? Wildcard : token );
+        }
+    }
+
+    return addTokens( lineTokens_, false );
+}
+
+TemplateMiner::TemplateId TemplateMiner::addTemplate( const std::vector<std::string>& tokens )
+{
+    std::vector<std::string_view> templateTokens( tokens.begin(), tokens.end() );
+    return addTokens( templateTokens, true );
+}
+
+TemplateMiner::TemplateId TemplateMiner::addTokens( const std::vector<std::string_view>& tokens,
+                                                    bool isTemplate )
+{
+    auto groupKey = std::to_string( tokens.size() );
+    if ( !tokens.empty() ) {
+        groupKey.append( 1, ' ' ).append( tokens.front() );
+    }
+    auto& group = groups_[ groupKey ];
+
+    const auto isSameToken = [ isTemplate ]( const std::string& templateToken,
+                                             std::string_view token ) {
+        return templateToken == token || ( isTemplate && token == Wildcard );
+    };
+
+    std::optional<TemplateId> bestTemplate;
+    double bestSimilarity = 0;
+    for ( const auto id : group ) {
+        const auto& templateTokens = templates_[ id ];
+        size_t sameTokens = 0;
+        for ( auto i = 0u; i < tokens.size(); ++i ) {
+            sameTokens += isSameToken( templateTokens[ i ], tokens[ i ] ) ? 1 : 0;
+        }
+
+        const auto similarity
+            = tokens.empty() ? 1.0 : static_cast<double>( sameTokens ) / tokens.size();
+        if ( similarity >= SimilarityThreshold && similarity > bestSimilarity ) {
+            bestTemplate = id;
+            bestSimilarity = similarity;
+        }
+    }
+
+    // Wildcards of added templates are kept in the merged one
+    if ( bestTemplate ) {
+        auto& templateTokens = templates_[ *bestTemplate ];
+        for ( auto i = 0u; i < tokens.size(); ++i ) {
+            if ( templateTokens[ i ] != tokens[ i ] ) {
+                templateTokens[ i ] = Wildcard;
+            }
+        }
+        return *bestTemplate;
+    }
+
+    const auto id = static_cast<TemplateId>( templates_.size() );
+    templates_.emplace_back( tokens.begin(), tokens.end() );
+    group.push_back( id );
+    return id;
+}
+
+std::string TemplateMiner::text( TemplateId id ) const
+{
+    std::string text;
+    for ( const auto& token : templates_[ id ] ) {
+        if ( !text.empty() ) {
+            text.append( 1, ' ' );
+        }
+        text.append( token );
+    }
+    return text;
+}
+
+TemplateClusterer::TemplateClusterer( const LogData* logData, LineNumber first, LinesCount count )
+    : logData_( logData )
+    , first_( first )
+    , count_( count )
+{
+}
+
+TemplateClusterer::TemplateClusterer( const LogData* logData, SearchResultArray lines )
+    : logData_( logData )
+    , lines_( std::move( lines ) )
+    , count_( lines_->cardinality() )
+{
+}
+
+LinesCount TemplateClusterer::linesCount() const
+{
+    return count_;
+}
+
+std::vector<LogTemplate> TemplateClusterer::cluster( const AtomicFlag& interruptRequested,
+                                                     std::atomic<uint64_t>& processedLines ) const
+{
+    const auto chunks = lines_ ? splitLines( *lines_, LinesCount( ChunkLines ) )
+                               : splitLines( first_, count_, LinesCount( ChunkLines ) );
+
+    tbb::enumerable_thread_specific<ThreadTemplates> threadTemplates;
+
+    tbb::parallel_for(
+        tbb::blocked_range<size_t>( 0, chunks.size(), 1 ),
+        [ & ]( const tbb::blocked_range<size_t>& range ) {
+            auto& templates = threadTemplates.local();
+
+            LogData::RawLines rawLines;
+            std::vector<std::string_view> utf8Lines;
+            for ( auto index = range.begin(); index != range.end(); ++index ) {
+                if ( interruptRequested ) {
+                    return;
+                }
+
+                for ( const auto& run : chunks[ index ] ) {
+                    logData_->getLinesRaw( run.first, run.count, rawLines );
+                    rawLines.buildUtf8View( utf8Lines );
+
+                    for ( auto offset = 0u; offset < utf8Lines.size(); ++offset ) {
+                        const auto id = templates.miner.add( utf8Lines[ offset ] );
+                        if ( id >= templates.lines.size() ) {
+                            templates.lines.resize( id + 1 );
+                        }
+                        templates.lines[ id ].add( ( run.first + LinesCount( offset ) ).get() );
+                    }
+
+                    processedLines += run.count.get();
+                }
+            }
+        } );
+
+    if ( interruptRequested ) {
+        return {};
+    }
+
+    // Templates of threads are clustered again to get templates of all lines
+    TemplateMiner miner;
+    std::vector<SearchResultArray> templateLines;
+    for ( auto& templates : threadTemplates ) {
+        for ( auto id = 0u; id < templates.lines.size(); ++id ) {
+            const auto mergedId = miner.addTemplate( templates.miner.tokens( id ) );
+            if ( mergedId >= templateLines.size() ) {
+                templateLines.resize( mergedId + 1 );
+            }
+            templateLines[ mergedId ] |= templates.lines[ id ];
+        }
+    }
+
+    std::vector<LogTemplate> logTemplates;
+    logTemplates.reserve( templateLines.size() );
+    for ( auto id = 0u; id < templateLines.size(); ++id ) {
+        templateLines[ id ].runOptimize();
+        logTemplates.push_back(
+            { QString::fromStdString( miner.text( id ) ), std::move( templateLines[ id ] ) } );
+    }
+
+    std::stable_sort( logTemplates.begin(), logTemplates.end(),
+                      []( const LogTemplate& lhs, const LogTemplate& rhs ) {
+                          return lhs.lines.cardinality() > rhs.lines.cardinality();
+                      } );
+
+    LOG_INFO << "Found " << logTemplates.size() << " templates in " << processedLines.load()
+             << " lines";
+
+    return logTemplates;
+}
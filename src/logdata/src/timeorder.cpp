@@ -0,0 +1,223 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "timeorder.h"
+
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <string_view>
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_reduce.h>
+
+#include "linechunks.h"
+#include "log.h"
+#include "logdata.h"
+#include "timestampindex.h"
+
+namespace {
+constexpr LinesCount::UnderlyingType ChunkLines = 5000;
+constexpr qint64 MissingTimestamp = std::numeric_limits<qint64>::min();
+
+constexpr size_t SortChunkSize = 64 * 1024;
+constexpr int DigitBits = 8;
+constexpr size_t DigitValues = size_t{ 1 } << DigitBits;
+
+struct RankedKey {
+    uint64_t key;
+    uint64_t rank;
+};
+
+// Unsigned keys keep the order of signed timestamps
+uint64_t toKey( qint64 timestamp )
+{
+    return static_cast<uint64_t>( timestamp ) ^ ( uint64_t{ 1 } << 63 );
+}
+
+size_t digit( uint64_t key, int shift )
+{
+    return static_cast<size_t>( ( key >> shift ) & ( DigitValues - 1 ) );
+}
+} // namespace
+
+TimeOrder::TimeOrder( const LogData& logData, const SearchResultArray& lines,
+                      const TimestampParser& parser )
+{
+    lines_.reserve( lines.cardinality() );
+    for ( const auto line : lines ) {
+        lines_.push_back( line );
+    }
+
+    const auto chunks = splitLines( lines, LinesCount( ChunkLines ) );
+
+    // Chunk timestamps are written after timestamps of chunks before it
+    std::vector<size_t> chunkRanks;
+    chunkRanks.reserve( chunks.size() );
+    size_t rank = 0;
+    for ( const auto& chunk : chunks ) {
+        chunkRanks.push_back( rank );
+        for ( const auto& run : chunk ) {
+            rank += run.count.get();
+        }
+    }
+
+    std::vector<qint64> timestamps( lines_.size(), MissingTimestamp );
+    tbb::parallel_for(
+        tbb::blocked_range<size_t>( 0, chunks.size(), 1 ),
+        [ & ]( const tbb::blocked_range<size_t>& range ) {
+            LogData::RawLines rawLines;
+            std::vector<std::string_view> utf8Lines;
+            for ( auto index = range.begin(); index != range.end(); ++index ) {
+                auto lineRank = chunkRanks[ index ];
+                for ( const auto& run : chunks[ index ] ) {
+                    logData.getLinesRaw( run.first, run.count, rawLines );
+                    rawLines.buildUtf8View( utf8Lines );
+
+                    for ( auto offset = 0u; offset < utf8Lines.size(); ++offset ) {
+                        const auto timestamp = parser.parse( utf8Lines[ offset ] );
+                        if ( timestamp ) {
+                            timestamps[ lineRank + offset ] = *timestamp;
+                        }
+                    }
+                    lineRank += run.count.get();
+                }
+            }
+        } );
+
+    for ( auto i = 1u; i < timestamps.size(); ++i ) {
+        if ( timestamps[ i ] == MissingTimestamp ) {
+            timestamps[ i ] = timestamps[ i - 1 ];
+        }
+    }
+
+    const auto ranks = sortedRanks( timestamps );
+
+    std::vector<LineNumber::UnderlyingType> sortedLines( lines_.size() );
+    indexes_.resize( lines_.size() );
+    for ( auto index = 0u; index < ranks.size(); ++index ) {
+        sortedLines[ index ] = lines_[ ranks[ index ] ];
+        indexes_[ ranks[ index ] ] = index;
+    }
+    lines_ = std::move( sortedLines );
+
+    LOG_INFO << "Ordered " << lines_.size() << " lines by time";
+}
+
+LinesCount TimeOrder::size() const
+{
+    return LinesCount( lines_.size() );
+}
+
+LineNumber TimeOrder::line( LineNumber index ) const
+{
+    return index.get() < lines_.size() ? LineNumber( lines_[ index.get() ] )
+                                       : maxValue<LineNumber>();
+}
+
+LineNumber TimeOrder::index( LineNumber::UnderlyingType rank ) const
+{
+    return rank < indexes_.size() ? LineNumber( indexes_[ rank ] ) : maxValue<LineNumber>();
+}
+
+size_t TimeOrder::allocatedSize() const
+{
+    return ( lines_.capacity() + indexes_.capacity() ) * sizeof( LineNumber::UnderlyingType );
+}
+
+std::vector<uint64_t> TimeOrder::sortedRanks( const std::vector<qint64>& timestamps )
+{
+    const auto size = timestamps.size();
+    std::vector<RankedKey> keys( size );
+    std::vector<RankedKey> sortedKeys( size );
+    tbb::parallel_for(
+        tbb::blocked_range<size_t>( 0, size, SortChunkSize ),
+        [ & ]( const tbb::blocked_range<size_t>& range ) {
+            for ( auto i = range.begin(); i != range.end(); ++i ) {
+                keys[ i ] = { toKey( timestamps[ i ] ), i };
+            }
+        } );
+
+    // Digits that are the same in all keys do not change the order
+    const auto firstKey = size > 0 ? keys.front().key : 0;
+    const auto differentBits = tbb::parallel_reduce(
+        tbb::blocked_range<size_t>( 0, size, SortChunkSize ), uint64_t{ 0 },
+        [ & ]( const tbb::blocked_range<size_t>& range, uint64_t bits ) {
+            for ( auto i = range.begin(); i != range.end(); ++i ) {
+                bits |= keys[ i ].key ^ firstKey;
+            }
+            return bits;
+        },
+        []( uint64_t lhs, uint64_t rhs ) { return lhs | rhs; } );
+
+    const auto nbChunks = ( size + SortChunkSize - 1 ) / SortChunkSize;
+    std::vector<std::array<size_t, DigitValues>> offsets( nbChunks );
+
+    for ( auto shift = 0; shift < 64; shift += DigitBits ) {
+        if ( digit( differentBits, shift ) == 0 ) {
+            continue;
+        }
+
+        tbb::parallel_for(
+            tbb::blocked_range<size_t>( 0, nbChunks, 1 ),
+            [ & ]( const tbb::blocked_range<size_t>& range ) {
+                for ( auto chunk = range.begin(); chunk != range.end(); ++chunk ) {
+                    auto& counts = offsets[ chunk ];
+                    counts.fill( 0 );
+                    const auto end = std::min( size, ( chunk + 1 ) * SortChunkSize );
+                    for ( auto i = chunk * SortChunkSize; i < end; ++i ) {
+                        ++counts[ digit( keys[ i ].key, shift ) ];
+                    }
+                }
+            } );
+
+        // Keys of a chunk go after keys with the same digit from chunks
+        // before it, so keys equal in this digit keep their order
+        size_t offset = 0;
+        for ( auto value = 0u; value < DigitValues; ++value ) {
+            for ( auto& counts : offsets ) {
+                const auto count = counts[ value ];
+                counts[ value ] = offset;
+                offset += count;
+            }
+        }
+
+        tbb::parallel_for(
+            tbb::blocked_range<size_t>( 0, nbChunks, 1 ),
+            [ & ]( const tbb::blocked_range<size_t>& range ) {
+                for ( auto chunk = range.begin(); chunk != range.end(); ++chunk ) {
+                    auto& positions = offsets[ chunk ];
+                    const auto end = std::min( size, ( chunk + 1 ) * SortChunkSize );
+                    for ( auto i = chunk * SortChunkSize; i < end; ++i ) {
+                        sortedKeys[ positions[ digit( keys[ i ].key, shift ) ]++ ]
+                            = keys[ i ];
+                    }
+                }
+            } );
+
+        keys.swap( sortedKeys );
+    }
+
+    std::vector<uint64_t> ranks( size );
+    for ( auto i = 0u; i < size; ++i ) {
+        ranks[ i ] = keys[ i ].rank;
+    }
+    return ranks;
+}
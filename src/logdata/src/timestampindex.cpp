@@ -0,0 +1,521 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "timestampindex.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <QDataStream>
+
+namespace {
+// Lines checked after the beginning of block to find a timestamp,
+// continuation lines of multi-line entries have none
+constexpr int TimestampProbeLines = 16;
+
+// Bytes before the '[' of bracketed format, like host and user of Apache logs
+constexpr size_t MaxBracketOffset = 128;
+
+// Lines of sample the format is detected on
+constexpr int DetectionLines = 256;
+
+constexpr uint64_t EachByte( uint8_t value )
+{
+    return 0x0101010101010101ULL * value;
+}
+
+// Range of milliseconds since epoch taken as timestamps, years 2000 to 2100
+constexpr qint64 MinEpochMillis = 946684800000LL;
+constexpr qint64 MaxEpochMillis = 4102444800000LL;
+constexpr size_t EpochMillisDigits = 13;
+
+constexpr std::string_view MonthNames = "JanFebMarAprMayJunJulAugSepOctNovDec";
+
+// Common formats tried by detection, formats with more fields go first
+// to be chosen when the shorter ones match the same lines
+const std::array<const char*, 8> DetectedFormats = {
+    "yyyy-MM-dd'T'HH:mm:ss.zzz", "yyyy-MM-dd HH:mm:ss.zzz", "yyyy-MM-dd HH:mm:ss,zzz",
+    "yyyy-MM-dd'T'HH:mm:ss",     "yyyy-MM-dd HH:mm:ss",     "[dd/MMM/yyyy:HH:mm:ss",
+    "MMM dd HH:mm:ss",           TimestampParser::EpochMillisFormat,
+};
+
+// Zero for every byte under mask that is an ASCII digit
+uint64_t nonDigits( uint64_t word, uint64_t mask )
+{
+    const auto bytes = word & mask;
+    const auto high = EachByte( 0xF0 ) & mask;
+    const auto digitHigh = EachByte( 0x30 ) & mask;
+    return ( ( bytes & high ) ^ digitHigh ) | ( ( ( bytes + ( EachByte( 0x06 ) & mask ) ) & high )
+                                                ^ digitHigh );
+}
+
+int digitsValue( const char* digits, int count )
+{
+    int value = 0;
+    for ( auto i = 0; i < count; ++i ) {
+        value = value * 10 + ( digits[ i ] - '0' );
+    }
+    return value;
+}
+
+bool isLeapYear( int year )
+{
+    return year % 4 == 0 && ( year % 100 != 0 || year % 400 == 0 );
+}
+
+int daysInMonth( int year, int month )
+{
+    constexpr std::array<int, 12> Days = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+    return Days[ static_cast<size_t>( month - 1 ) ] + ( month == 2 && isLeapYear( year ) ? 1 : 0 );
+}
+
+// Days since 1970-01-01 of proleptic Gregorian date
+qint64 daysFromCivil( int year, int month, int day )
+{
+    year -= month <= 2 ? 1 : 0;
+    const qint64 era = ( year >= 0 ? year : year - 399 ) / 400;
+    const auto yearOfEra = static_cast<qint64>( year - era * 400 );
+    const auto dayOfYear = ( 153 * ( month + ( month > 2 ? -3 : 9 ) ) + 2 ) / 5 + day - 1;
+    const auto dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return era * 146097 + dayOfEra - 719468;
+}
+} // namespace
+
+TimestampParser::TimestampParser( const QString& format )
+    : format_( format )
+    , length_( static_cast<size_t>( format.size() ) )
+{
+    isBracketed_ = format_.startsWith( '[' );
+
+    if ( format_ == QLatin1String( EpochMillisFormat ) ) {
+        std::array<uint8_t, MaxLayoutLength> digitMask{};
+        std::fill_n( digitMask.begin(), EpochMillisDigits, uint8_t{ 0xFF } );
+        std::memcpy( digitMask_.data(), digitMask.data(), MaxLayoutLength );
+
+        kind_ = Kind::EpochMillis;
+        length_ = EpochMillisDigits;
+    }
+    else if ( compileLayout() ) {
+        kind_ = Kind::Layout;
+    }
+}
+
+bool TimestampParser::compileLayout()
+{
+    std::array<char, MaxLayoutLength> literals{};
+    std::array<uint8_t, MaxLayoutLength> literalMask{};
+    std::array<uint8_t, MaxLayoutLength> digitMask{};
+    Fields fields;
+
+    const auto format = format_.toLatin1();
+    size_t length = 0;
+    int index = 0;
+
+    const auto addLiteral = [ & ]( char literal ) {
+        if ( length == MaxLayoutLength ) {
+            return false;
+        }
+        literals[ length ] = literal;
+        literalMask[ length ] = 0xFF;
+        ++length;
+        return true;
+    };
+
+    while ( index < format.size() ) {
+        const auto symbol = format[ index ];
+
+        if ( symbol == '\'' ) {
+            // Quoted literal, two quotes are a quote
+            const auto quoteEnd = format.indexOf( '\'', index + 1 );
+            if ( quoteEnd < 0 ) {
+                return false;
+            }
+            if ( quoteEnd == index + 1 ) {
+                if ( !addLiteral( '\'' ) ) {
+                    return false;
+                }
+            }
+            for ( auto literal = index + 1; literal < quoteEnd; ++literal ) {
+                if ( !addLiteral( format[ literal ] ) ) {
+                    return false;
+                }
+            }
+            index = quoteEnd + 1;
+            continue;
+        }
+
+        if ( !QChar::isLetter( static_cast<uchar>( symbol ) ) ) {
+            if ( !addLiteral( symbol ) ) {
+                return false;
+            }
+            ++index;
+            continue;
+        }
+
+        auto width = 1;
+        while ( index + width < format.size() && format[ index + width ] == symbol ) {
+            ++width;
+        }
+
+        int* field = nullptr;
+        auto digits = width;
+        if ( symbol == 'y' && width == 4 ) {
+            field = &fields.year;
+        }
+        else if ( symbol == 'M' && width == 2 ) {
+            field = &fields.month;
+        }
+        else if ( symbol == 'M' && width == 3 ) {
+            field = &fields.monthName;
+            digits = 0;
+        }
+        else if ( symbol == 'd' && width == 2 ) {
+            // Tens of day can be a space, they are checked when parsed
+            field = &fields.day;
+            digits = 1;
+        }
+        else if ( ( symbol == 'H' || symbol == 'h' ) && width == 2 ) {
+            field = &fields.hour;
+        }
+        else if ( symbol == 'm' && width == 2 ) {
+            field = &fields.minute;
+        }
+        else if ( symbol == 's' && width == 2 ) {
+            field = &fields.second;
+        }
+        else if ( symbol == 'z' && width == 3 ) {
+            field = &fields.millis;
+        }
+
+        if ( field == nullptr || *field >= 0
+             || length + static_cast<size_t>( width ) > MaxLayoutLength ) {
+            return false;
+        }
+
+        *field = static_cast<int>( length );
+        for ( auto digit = width - digits; digit < width; ++digit ) {
+            digitMask[ length + static_cast<size_t>( digit ) ] = 0xFF;
+        }
+        length += static_cast<size_t>( width );
+        index += width;
+    }
+
+    if ( length == 0 || ( fields.month >= 0 && fields.monthName >= 0 ) ) {
+        return false;
+    }
+
+    std::memcpy( literals_.data(), literals.data(), MaxLayoutLength );
+    std::memcpy( literalMask_.data(), literalMask.data(), MaxLayoutLength );
+    std::memcpy( digitMask_.data(), digitMask.data(), MaxLayoutLength );
+    fields_ = fields;
+    length_ = length;
+    return true;
+}
+
+std::optional<qint64> TimestampParser::parse( std::string_view line ) const
+{
+    if ( isBracketed_ ) {
+        const auto bracket = line.substr( 0, MaxBracketOffset + 1 ).find( '[' );
+        if ( bracket == std::string_view::npos ) {
+            return {};
+        }
+        line.remove_prefix( bracket );
+    }
+
+    if ( length_ == 0 || line.size() < length_ ) {
+        return {};
+    }
+
+    if ( kind_ != Kind::QtFormat ) {
+        std::array<char, MaxLayoutLength> bytes{};
+        std::memcpy( bytes.data(), line.data(), length_ );
+
+        std::array<uint64_t, LayoutWords> words;
+        std::memcpy( words.data(), bytes.data(), MaxLayoutLength );
+
+        // All literals and digits are checked at once
+        uint64_t mismatches = 0;
+        for ( auto word = 0u; word < LayoutWords; ++word ) {
+            mismatches |= ( words[ word ] ^ literals_[ word ] ) & literalMask_[ word ];
+            mismatches |= nonDigits( words[ word ], digitMask_[ word ] );
+        }
+        if ( mismatches != 0 ) {
+            return {};
+        }
+
+        return kind_ == Kind::Layout ? parseLayout( bytes.data() )
+                                     : parseEpochMillis( bytes.data(), line );
+    }
+
+    const auto dateTime = QDateTime::fromString(
+        QString::fromLatin1( line.data(), static_cast<int>( length_ ) ), format_ );
+    if ( !dateTime.isValid() ) {
+        return {};
+    }
+
+    return toTimestamp( dateTime );
+}
+
+std::optional<qint64> TimestampParser::parseLayout( const char* bytes ) const
+{
+    // Year is 1900 if format has none, like QDateTime does
+    const auto field = [ bytes ]( int position, int width, int defaultValue ) {
+        return position < 0 ? defaultValue : digitsValue( bytes + position, width );
+    };
+
+    const auto year = field( fields_.year, 4, 1900 );
+    auto month = field( fields_.month, 2, 1 );
+    auto day = 1;
+    if ( fields_.day >= 0 ) {
+        const auto tens = bytes[ fields_.day ];
+        if ( tens != ' ' && ( tens < '0' || tens > '9' ) ) {
+            return {};
+        }
+        day = ( tens == ' ' ? 0 : ( tens - '0' ) * 10 )
+              + ( bytes[ fields_.day + 1 ] - '0' );
+    }
+    if ( fields_.monthName >= 0 ) {
+        const auto name = std::string_view( bytes + fields_.monthName, 3 );
+        const auto nameIndex = MonthNames.find( name );
+        if ( nameIndex == std::string_view::npos || nameIndex % 3 != 0 ) {
+            return {};
+        }
+        month = static_cast<int>( nameIndex / 3 ) + 1;
+    }
+
+    const auto hour = field( fields_.hour, 2, 0 );
+    const auto minute = field( fields_.minute, 2, 0 );
+    const auto second = field( fields_.second, 2, 0 );
+    const auto millis = field( fields_.millis, 3, 0 );
+
+    if ( month < 1 || month > 12 || day < 1 || day > daysInMonth( year, month ) || hour > 23
+         || minute > 59 || second > 59 ) {
+        return {};
+    }
+
+    const auto days = daysFromCivil( year, month, day );
+    return ( ( ( days * 24 + hour ) * 60 + minute ) * 60 + second ) * 1000 + millis;
+}
+
+std::optional<qint64> TimestampParser::parseEpochMillis( const char* bytes,
+                                                         std::string_view line ) const
+{
+    // Longer numbers are not timestamps
+    if ( line.size() > EpochMillisDigits && line[ EpochMillisDigits ] >= '0'
+         && line[ EpochMillisDigits ] <= '9' ) {
+        return {};
+    }
+
+    qint64 timestamp = 0;
+    for ( auto i = 0u; i < EpochMillisDigits; ++i ) {
+        timestamp = timestamp * 10 + ( bytes[ i ] - '0' );
+    }
+
+    if ( timestamp < MinEpochMillis || timestamp >= MaxEpochMillis ) {
+        return {};
+    }
+    return timestamp;
+}
+
+std::optional<TimestampSample> TimestampParser::findInBlock( std::string_view block,
+                                                             size_t firstLine ) const
+{
+    auto lineStart = firstLine;
+    for ( auto probe = 0; probe < TimestampProbeLines && lineStart < block.size(); ++probe ) {
+        const auto lineEnd = block.find( '\n', lineStart );
+        const auto line = block.substr( lineStart, lineEnd == std::string_view::npos
+                                                       ? std::string_view::npos
+                                                       : lineEnd - lineStart );
+
+        if ( const auto timestamp = parse( line ) ) {
+            return TimestampSample{ static_cast<LineOffset::UnderlyingType>( lineStart ),
+                                    *timestamp };
+        }
+
+        if ( lineEnd == std::string_view::npos ) {
+            break;
+        }
+        lineStart = lineEnd + 1;
+    }
+
+    return {};
+}
+
+QString TimestampParser::detectFormat( std::string_view sample )
+{
+    std::vector<std::string_view> lines;
+    size_t lineStart = 0;
+    while ( lineStart < sample.size() && lines.size() < DetectionLines ) {
+        const auto lineEnd = sample.find( '\n', lineStart );
+        if ( lineEnd == std::string_view::npos ) {
+            break;
+        }
+        if ( lineEnd > lineStart ) {
+            lines.push_back( sample.substr( lineStart, lineEnd - lineStart ) );
+        }
+        lineStart = lineEnd + 1;
+    }
+
+    QString detectedFormat;
+    size_t detectedLines = 0;
+    for ( const auto format : DetectedFormats ) {
+        const TimestampParser parser( QString::fromLatin1( format ) );
+        const auto parsedLines = static_cast<size_t>(
+            std::count_if( lines.begin(), lines.end(), [ &parser ]( std::string_view line ) {
+                return parser.parse( line ).has_value();
+            } ) );
+        if ( parsedLines > detectedLines ) {
+            detectedFormat = QString::fromLatin1( format );
+            detectedLines = parsedLines;
+        }
+    }
+
+    // Continuation lines of multi-line entries have no timestamps
+    if ( detectedLines * 8 < lines.size() ) {
+        return {};
+    }
+    return detectedFormat;
+}
+
+qint64 TimestampParser::toTimestamp( const QDateTime& dateTime )
+{
+    return QDateTime( dateTime.date(), dateTime.time(), Qt::UTC ).toMSecsSinceEpoch();
+}
+
+void TimestampIndex::reset( const QString& setting )
+{
+    setting_ = setting;
+    format_ = setting == QLatin1String( TimestampParser::AutoFormat ) ? QString{} : setting;
+    samples_.clear();
+    coveredEnd_ = 0;
+    isComplete_ = true;
+}
+
+void TimestampIndex::detectFormat( std::string_view sample )
+{
+    if ( setting_ != QLatin1String( TimestampParser::AutoFormat ) || !format_.isEmpty()
+         || coveredEnd_ != 0 ) {
+        return;
+    }
+
+    format_ = TimestampParser::detectFormat( sample );
+}
+
+void TimestampIndex::append( LineOffset::UnderlyingType beginning, LineOffset::UnderlyingType end,
+                             std::optional<TimestampSample> sample )
+{
+    if ( beginning != coveredEnd_ ) {
+        isComplete_ = false;
+    }
+    coveredEnd_ = end;
+
+    // Samples are kept sorted for binary search,
+    // lines written out of order are not found by time anyway
+    if ( sample && isComplete_
+         && ( samples_.empty() || samples_.back().timestamp <= sample->timestamp ) ) {
+        samples_.push_back( *sample );
+    }
+}
+
+void TimestampIndex::truncate( LineOffset::UnderlyingType end )
+{
+    while ( !samples_.empty() && samples_.back().offset >= end ) {
+        samples_.pop_back();
+    }
+    coveredEnd_ = std::min( coveredEnd_, end );
+}
+
+std::optional<TimestampIndex::Range> TimestampIndex::find( qint64 timestamp ) const
+{
+    if ( !isComplete_ || samples_.empty() ) {
+        return {};
+    }
+
+    const auto next = std::lower_bound(
+        samples_.begin(), samples_.end(), timestamp,
+        []( const TimestampSample& sample, qint64 value ) { return sample.timestamp < value; } );
+
+    Range range;
+    range.begin = next == samples_.begin() ? 0 : std::prev( next )->offset;
+    range.end = next == samples_.end() ? coveredEnd_ : next->offset;
+    return range;
+}
+
+std::optional<std::pair<qint64, qint64>> TimestampIndex::timeSpan() const
+{
+    if ( !isComplete_ || samples_.empty() ) {
+        return {};
+    }
+
+    return std::make_pair( samples_.front().timestamp, samples_.back().timestamp );
+}
+
+size_t TimestampIndex::allocatedSize() const
+{
+    return samples_.capacity() * sizeof( TimestampSample );
+}
+
+void TimestampIndex::save( QDataStream& stream ) const
+{
+    stream << format_ << static_cast<quint64>( samples_.size() );
+    for ( const auto& sample : samples_ ) {
+        stream << static_cast<qint64>( sample.offset ) << sample.timestamp;
+    }
+    stream << static_cast<qint64>( coveredEnd_ ) << isComplete_;
+}
+
+bool TimestampIndex::load( QDataStream& stream )
+{
+    QString format;
+    quint64 samplesCount = 0;
+    stream >> format >> samplesCount;
+
+    std::vector<TimestampSample> samples;
+    for ( auto i = 0u; i < samplesCount && stream.status() == QDataStream::Ok; ++i ) {
+        qint64 offset = 0;
+        qint64 timestamp = 0;
+        stream >> offset >> timestamp;
+        samples.push_back( { offset, timestamp } );
+    }
+
+    qint64 coveredEnd = 0;
+    bool isComplete = false;
+    stream >> coveredEnd >> isComplete;
+
+    const auto isSorted
+        = std::is_sorted( samples.begin(), samples.end(), []( const auto& lhs, const auto& rhs ) {
+              return lhs.timestamp < rhs.timestamp;
+          } );
+    if ( stream.status() != QDataStream::Ok || !isSorted ) {
+        return false;
+    }
+
+    // Format detected when the index was saved is kept
+    const auto isDetected = setting_ == QLatin1String( TimestampParser::AutoFormat );
+    if ( format != format_ && !( isDetected && format_.isEmpty() ) ) {
+        reset( setting_ );
+        return true;
+    }
+
+    format_ = format;
+    samples_ = std::move( samples );
+    coveredEnd_ = coveredEnd;
+    isComplete_ = isComplete;
+    return true;
+}
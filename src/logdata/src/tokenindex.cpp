@@ -0,0 +1,231 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "tokenindex.h"
+
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <utility>
+
+#include <QByteArray>
+#include <QDataStream>
+
+#include "streamlimits.h"
+
+namespace {
+constexpr uint64_t MaxIndexedLines = uint64_t{ std::numeric_limits<uint32_t>::max() } + 1;
+
+constexpr uint64_t FnvOffset = 0xcbf29ce484222325ull;
+constexpr uint64_t FnvPrime = 0x100000001b3ull;
+
+char fold( char c )
+{
+    return ( c >= 'A' && c <= 'Z' ) ? static_cast<char>( c + ( 'a' - 'A' ) ) : c;
+}
+} // namespace
+
+TokenIndex::TokenIndex( std::string_view delimiters )
+    : isEnabled_( true )
+    , delimiters_( delimiters.empty() ? DefaultDelimiters : delimiters )
+    , isDelimiter_( 256, false )
+{
+    for ( const auto c : delimiters_ ) {
+        isDelimiter_[ static_cast<uint8_t>( c ) ] = true;
+    }
+    isDelimiter_[ static_cast<uint8_t>( '\n' ) ] = true;
+}
+
+LinesCount TokenIndex::size() const
+{
+    return LinesCount( size_ );
+}
+
+TokenIndex::TokenHash TokenIndex::hash( std::string_view token )
+{
+    auto hash = FnvOffset;
+    for ( const auto c : token ) {
+        hash = ( hash ^ static_cast<uint8_t>( fold( c ) ) ) * FnvPrime;
+    }
+    return hash;
+}
+
+void TokenIndex::append( const std::vector<std::string_view>& lines )
+{
+    if ( !isEnabled_ ) {
+        return;
+    }
+
+    for ( const auto& line : lines ) {
+        lastLineTokens_.clear();
+
+        if ( size_ < MaxIndexedLines ) {
+            const auto lineNumber = static_cast<uint32_t>( size_ );
+
+            size_t tokenStart = 0;
+            for ( size_t pos = 0; pos <= line.size(); ++pos ) {
+                if ( pos < line.size() && !isDelimiter( line[ pos ] ) ) {
+                    continue;
+                }
+
+                if ( pos - tokenStart >= MinTokenSize ) {
+                    const auto tokenHash = hash( line.substr( tokenStart, pos - tokenStart ) );
+                    lines_[ tokenHash ].add( lineNumber );
+                    lastLineTokens_.push_back( tokenHash );
+                }
+                tokenStart = pos + 1;
+            }
+        }
+
+        ++size_;
+    }
+}
+
+void TokenIndex::truncate( LinesCount count )
+{
+    if ( count.get() >= size_ ) {
+        return;
+    }
+
+    if ( count.get() + 1 == size_ ) {
+        for ( const auto tokenHash : lastLineTokens_ ) {
+            auto tokenLines = lines_.find( tokenHash );
+            if ( tokenLines != lines_.end() ) {
+                tokenLines->second.remove( static_cast<uint32_t>( count.get() ) );
+            }
+        }
+    }
+    else {
+        roaring::Roaring keptLines;
+        keptLines.addRange( 0, std::min( count.get(), MaxIndexedLines ) );
+        for ( auto tokenLines = lines_.begin(); tokenLines != lines_.end(); ) {
+            tokenLines->second &= keptLines;
+            tokenLines = tokenLines->second.isEmpty() ? lines_.erase( tokenLines )
+                                                      : std::next( tokenLines );
+        }
+    }
+
+    lastLineTokens_.clear();
+    size_ = count.get();
+}
+
+std::optional<roaring::Roaring64Map> TokenIndex::find( std::string_view text, LineNumber first,
+                                                       LineNumber last ) const
+{
+    if ( !isEnabled_ || last.get() > MaxIndexedLines || text.size() < MinTokenSize ) {
+        return {};
+    }
+
+    // Non ASCII text can be encoded differently in the file
+    const auto isToken = std::none_of( text.begin(), text.end(), [ this ]( char c ) {
+        return static_cast<uint8_t>( c ) >= 0x80 || isDelimiter( c );
+    } );
+    if ( !isToken ) {
+        return {};
+    }
+
+    roaring::Roaring64Map lines;
+    const auto tokenLines = lines_.find( hash( text ) );
+    if ( tokenLines == lines_.end() || first >= last ) {
+        return lines;
+    }
+
+    roaring::Roaring range;
+    range.addRange( first.get(), last.get() );
+    lines = roaring::Roaring64Map( tokenLines->second & range );
+    return lines;
+}
+
+size_t TokenIndex::allocatedSize() const
+{
+    size_t size = lastLineTokens_.capacity() * sizeof( TokenHash );
+    for ( const auto& tokenLines : lines_ ) {
+        size += sizeof( tokenLines ) + tokenLines.second.getSizeInBytes( false );
+    }
+    return size;
+}
+
+void TokenIndex::save( QDataStream& stream ) const
+{
+    stream << QByteArray::fromStdString( isEnabled_ ? delimiters_ : std::string{} );
+    stream << static_cast<quint64>( size_ ) << static_cast<quint64>( lines_.size() );
+
+    QByteArray data;
+    for ( const auto& tokenLines : lines_ ) {
+        data.resize( static_cast<int>( tokenLines.second.getSizeInBytes( true ) ) );
+        tokenLines.second.write( data.data(), true );
+        stream << static_cast<quint64>( tokenLines.first ) << data;
+    }
+
+    stream << static_cast<quint64>( lastLineTokens_.size() );
+    for ( const auto tokenHash : lastLineTokens_ ) {
+        stream << static_cast<quint64>( tokenHash );
+    }
+}
+
+bool TokenIndex::load( QDataStream& stream )
+{
+    QByteArray delimiters;
+    quint64 size = 0;
+    quint64 tokensCount = 0;
+    stream >> delimiters >> size >> tokensCount;
+
+    // Index is read even if it is not used, line positions follow it
+    const auto isUsable = isEnabled_ && delimiters.toStdString() == delimiters_;
+
+    std::unordered_map<TokenHash, roaring::Roaring> lines;
+    QByteArray data;
+    for ( auto i = 0u; i < tokensCount && stream.status() == QDataStream::Ok; ++i ) {
+        quint64 tokenHash = 0;
+        stream >> tokenHash >> data;
+        if ( isUsable && stream.status() == QDataStream::Ok && !data.isEmpty() ) {
+            auto tokenLines = readBitmap<roaring::Roaring>( data );
+            if ( !tokenLines ) {
+                return false;
+            }
+            lines.emplace( tokenHash, std::move( *tokenLines ) );
+        }
+    }
+
+    quint64 lastLineTokensCount = 0;
+    stream >> lastLineTokensCount;
+    std::vector<TokenHash> lastLineTokens;
+    for ( auto i = 0u; i < lastLineTokensCount && stream.status() == QDataStream::Ok; ++i ) {
+        quint64 tokenHash = 0;
+        stream >> tokenHash;
+        lastLineTokens.push_back( tokenHash );
+    }
+
+    if ( stream.status() != QDataStream::Ok ) {
+        return false;
+    }
+
+    // Unusable index is left empty, so it does not have loaded lines
+    if ( isUsable ) {
+        lines_ = std::move( lines );
+        size_ = size;
+        lastLineTokens_ = std::move( lastLineTokens );
+    }
+    else {
+        lines_.clear();
+        size_ = 0;
+        lastLineTokens_.clear();
+    }
+    return true;
+}
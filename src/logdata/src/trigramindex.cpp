@@ -0,0 +1,261 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "trigramindex.h"
+
+#include <algorithm>
+
+#include <QDataStream>
+
+#include "streamlimits.h"
+
+namespace {
+constexpr uint32_t TrigramMask = 0xFFFFFF;
+} // namespace
+
+uint32_t TrigramFilter::fold( char c )
+{
+    const auto byte = static_cast<uint8_t>( c );
+    return ( byte >= 'A' && byte <= 'Z' ) ? byte + ( 'a' - 'A' ) : byte;
+}
+
+uint16_t TrigramFilter::hash( uint32_t trigram )
+{
+    return static_cast<uint16_t>( ( trigram * 0x9E3779B1u ) >> ( 32 - HashBits ) );
+}
+
+void TrigramFilter::addTrigram( uint32_t trigram )
+{
+    const auto bit = hash( trigram );
+    bits_[ bit / 64 ] |= uint64_t{ 1 } << ( bit % 64 );
+}
+
+void TrigramFilter::addData( std::string_view data )
+{
+    uint32_t trigram = 0;
+    for ( size_t i = 0; i < data.size(); ++i ) {
+        trigram = ( ( trigram << 8 ) | fold( data[ i ] ) ) & TrigramMask;
+        if ( i >= 2 ) {
+            addTrigram( trigram );
+        }
+    }
+}
+
+void TrigramFilter::save( QDataStream& stream ) const
+{
+    for ( const auto word : bits_ ) {
+        stream << static_cast<quint64>( word );
+    }
+}
+
+bool TrigramFilter::load( QDataStream& stream )
+{
+    for ( auto& word : bits_ ) {
+        quint64 value = 0;
+        stream >> value;
+        word = value;
+    }
+    return stream.status() == QDataStream::Ok;
+}
+
+bool TrigramFilter::mayContain( uint16_t hash ) const
+{
+    return ( bits_[ hash / 64 ] & ( uint64_t{ 1 } << ( hash % 64 ) ) ) != 0;
+}
+
+TrigramFilter::Hashes TrigramFilter::textHashes( std::string_view text, bool isCaseSensitive )
+{
+    Hashes hashes;
+
+    // Non ASCII text can be encoded differently in the file
+    if ( std::any_of( text.begin(), text.end(),
+                      []( char c ) { return static_cast<uint8_t>( c ) >= 0x80; } ) ) {
+        return hashes;
+    }
+
+    uint32_t trigram = 0;
+    for ( size_t i = 0; i < text.size(); ++i ) {
+        trigram = ( ( trigram << 8 ) | fold( text[ i ] ) ) & TrigramMask;
+        if ( i < 2 ) {
+            continue;
+        }
+
+        // Unicode case insensitive match maps Kelvin sign
+        // and long s to 'k' and 's', these are not ASCII in file
+        const auto hasNonAsciiFolding = [ trigram ]() {
+            for ( auto shift : { 0, 8, 16 } ) {
+                const auto c = ( trigram >> shift ) & 0xFF;
+                if ( c == 'k' || c == 's' ) {
+                    return true;
+                }
+            }
+            return false;
+        };
+
+        if ( !isCaseSensitive && hasNonAsciiFolding() ) {
+            continue;
+        }
+
+        hashes.push_back( hash( trigram ) );
+    }
+
+    std::sort( hashes.begin(), hashes.end() );
+    hashes.erase( std::unique( hashes.begin(), hashes.end() ), hashes.end() );
+
+    return hashes;
+}
+
+void TrigramIndex::append( LineOffset::UnderlyingType beginning,
+                           std::shared_ptr<TrigramFilter> filter, std::string_view block )
+{
+    const auto isContinuation = !blocks_.empty() && blocks_.back().end == beginning;
+    if ( !isContinuation ) {
+        tail_ = 0;
+        tailSize_ = 0;
+    }
+
+    const auto headSize = std::min<size_t>( block.size(), 2 );
+    for ( size_t i = 0; i < headSize; ++i ) {
+        tail_ = ( ( tail_ << 8 ) | TrigramFilter::fold( block[ i ] ) ) & TrigramMask;
+        if ( ++tailSize_ >= 3 ) {
+            filter->addTrigram( tail_ );
+        }
+    }
+
+    for ( auto i = std::max( headSize, block.size() - headSize ); i < block.size(); ++i ) {
+        tail_ = ( ( tail_ << 8 ) | TrigramFilter::fold( block[ i ] ) ) & TrigramMask;
+    }
+    tailSize_ += block.size() - headSize;
+
+    const auto end = beginning + static_cast<LineOffset::UnderlyingType>( block.size() );
+    blocks_.push_back( { beginning, end, std::move( filter ) } );
+}
+
+bool TrigramIndex::mayContain( LineOffset::UnderlyingType begin, LineOffset::UnderlyingType end,
+                               const TrigramFilter::Hashes& hashes ) const
+{
+    if ( hashes.empty() || begin >= end ) {
+        return true;
+    }
+
+    const auto first = std::upper_bound(
+        blocks_.begin(), blocks_.end(), begin,
+        []( LineOffset::UnderlyingType offset, const Block& b ) { return offset < b.end; } );
+
+    auto last = first;
+    auto coveredEnd = begin;
+    for ( ; last != blocks_.end() && coveredEnd < end; ++last ) {
+        if ( last->beginning > coveredEnd ) {
+            // Part of range has no filter
+            return true;
+        }
+        coveredEnd = last->end;
+    }
+
+    if ( coveredEnd < end ) {
+        return true;
+    }
+
+    // Text can cross block boundary, so its trigrams
+    // are looked up in all blocks of the range
+    return std::all_of( hashes.begin(), hashes.end(), [ first, last ]( uint16_t hash ) {
+        return std::any_of( first, last,
+                            [ hash ]( const Block& b ) { return b.filter->mayContain( hash ); } );
+    } );
+}
+
+void TrigramIndex::clear()
+{
+    blocks_.clear();
+    tail_ = 0;
+    tailSize_ = 0;
+}
+
+void TrigramIndex::truncate( LineOffset::UnderlyingType end )
+{
+    while ( !blocks_.empty() && blocks_.back().end > end ) {
+        blocks_.pop_back();
+    }
+
+    // Last bytes of the kept blocks are not known, so trigrams crossing into the
+    // next block can't be added to it. Last block stops short of them, ranges
+    // that include them are not covered and are never filtered out.
+    if ( !blocks_.empty() ) {
+        auto& last = blocks_.back();
+        if ( last.end - last.beginning > 2 ) {
+            last.end -= 2;
+        }
+        else {
+            blocks_.pop_back();
+        }
+    }
+
+    tail_ = 0;
+    tailSize_ = 0;
+}
+
+size_t TrigramIndex::allocatedSize() const
+{
+    return blocks_.capacity() * sizeof( Block ) + blocks_.size() * sizeof( TrigramFilter );
+}
+
+void TrigramIndex::save( QDataStream& stream ) const
+{
+    stream << static_cast<quint64>( blocks_.size() );
+    for ( const auto& block : blocks_ ) {
+        stream << static_cast<qint64>( block.beginning ) << static_cast<qint64>( block.end );
+        block.filter->save( stream );
+    }
+    stream << static_cast<quint32>( tail_ ) << static_cast<quint64>( tailSize_ );
+}
+
+bool TrigramIndex::load( QDataStream& stream )
+{
+    quint64 blocksCount = 0;
+    stream >> blocksCount;
+    if ( !isCountInStream( stream, blocksCount, 2 * sizeof( qint64 ) ) ) {
+        return false;
+    }
+
+    std::vector<Block> blocks;
+    for ( auto i = 0u; i < blocksCount && stream.status() == QDataStream::Ok; ++i ) {
+        qint64 beginning = 0;
+        qint64 end = 0;
+        stream >> beginning >> end;
+
+        auto filter = std::make_shared<TrigramFilter>();
+        if ( !filter->load( stream ) || end < beginning ) {
+            return false;
+        }
+        blocks.push_back( { beginning, end, std::move( filter ) } );
+    }
+
+    quint32 tail = 0;
+    quint64 tailSize = 0;
+    stream >> tail >> tailSize;
+
+    if ( stream.status() != QDataStream::Ok ) {
+        return false;
+    }
+
+    blocks_ = std::move( blocks );
+    tail_ = tail;
+    tailSize_ = static_cast<size_t>( tailSize );
+    return true;
+}
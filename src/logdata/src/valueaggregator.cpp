@@ -0,0 +1,236 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "valueaggregator.h"
+
+#include <algorithm>
+#include <string_view>
+#include <tuple>
+#include <utility>
+
+#include <QHash>
+
+#include <tbb/enumerable_thread_specific.h>
+#include <tbb/parallel_for.h>
+
+#include "linechunks.h"
+#include "literalprefilter.h"
+#include "log.h"
+#include "logdata.h"
+
+namespace {
+constexpr LinesCount::UnderlyingType ChunkLines = 5000;
+
+struct ValueLines {
+    uint64_t count = 0;
+    LineNumber firstLine;
+    LineNumber lastLine;
+};
+using ValueTable = QHash<QString, ValueLines>;
+
+void addValueLines( ValueTable& table, const QString& value, const ValueLines& lines )
+{
+    auto& valueLines = table[ value ];
+    if ( valueLines.count == 0 ) {
+        valueLines = lines;
+        return;
+    }
+
+    valueLines.count += lines.count;
+    valueLines.firstLine = std::min( valueLines.firstLine, lines.firstLine );
+    valueLines.lastLine = std::max( valueLines.lastLine, lines.lastLine );
+}
+
+// Matches lines of the chunks in parallel, each matching line is passed
+// to the function with the match and the state of its thread
+template <typename ThreadState, typename OnMatch>
+void matchChunks( const LogData* logData, const std::vector<LinesChunk>& chunks,
+                  const QRegularExpression& regexp, const AtomicFlag& interruptRequested,
+                  std::atomic<uint64_t>& processedLines,
+                  tbb::enumerable_thread_specific<ThreadState>& threadStates, OnMatch onMatch )
+{
+    // Lines without the literal the expression needs are not decoded
+    const auto isCaseSensitive
+        = !regexp.patternOptions().testFlag( QRegularExpression::CaseInsensitiveOption );
+    const auto prefilter
+        = LiteralPrefilter( regexp.pattern().toStdString(), false, isCaseSensitive );
+
+    // Each thread has its own copy of expression, they are not shared
+    tbb::enumerable_thread_specific<QRegularExpression> threadRegexps(
+        [ &regexp ]() { return QRegularExpression( regexp.pattern(), regexp.patternOptions() ); } );
+
+    tbb::parallel_for(
+        tbb::blocked_range<size_t>( 0, chunks.size(), 1 ),
+        [ & ]( const tbb::blocked_range<size_t>& range ) {
+            const auto& threadRegexp = threadRegexps.local();
+            auto& state = threadStates.local();
+
+            LogData::RawLines rawLines;
+            std::vector<std::string_view> utf8Lines;
+            for ( auto index = range.begin(); index != range.end(); ++index ) {
+                if ( interruptRequested ) {
+                    return;
+                }
+
+                for ( const auto& run : chunks[ index ] ) {
+                    logData->getLinesRaw( run.first, run.count, rawLines );
+                    rawLines.buildUtf8View( utf8Lines );
+
+                    for ( auto offset = 0u; offset < utf8Lines.size(); ++offset ) {
+                        const auto& line = utf8Lines[ offset ];
+                        if ( !prefilter.mayMatch( line ) ) {
+                            continue;
+                        }
+
+                        const auto match = threadRegexp.match(
+                            QString::fromUtf8( line.data(), static_cast<int>( line.size() ) ) );
+                        if ( match.hasMatch() ) {
+                            onMatch( state, match, run.first + LinesCount( offset ) );
+                        }
+                    }
+
+                    processedLines += run.count.get();
+                }
+            }
+        } );
+}
+} // namespace
+
+ValueAggregator::ValueAggregator( const LogData* logData, LineNumber first, LinesCount count )
+    : logData_( logData )
+    , first_( first )
+    , count_( count )
+{
+}
+
+ValueAggregator::ValueAggregator( const LogData* logData, SearchResultArray lines )
+    : logData_( logData )
+    , lines_( std::move( lines ) )
+    , count_( lines_->cardinality() )
+{
+}
+
+LinesCount ValueAggregator::linesCount() const
+{
+    return count_;
+}
+
+std::vector<LinesChunk> ValueAggregator::chunks() const
+{
+    return lines_ ? splitLines( *lines_, LinesCount( ChunkLines ) )
+                  : splitLines( first_, count_, LinesCount( ChunkLines ) );
+}
+
+std::vector<AggregatedValue>
+ValueAggregator::aggregate( const QRegularExpression& regexp, const AtomicFlag& interruptRequested,
+                            std::atomic<uint64_t>& processedLines ) const
+{
+    if ( !regexp.isValid() || count_.get() == 0 ) {
+        return {};
+    }
+
+    const auto valueGroup = regexp.captureCount() > 0 ? 1 : 0;
+
+    tbb::enumerable_thread_specific<ValueTable> threadTables;
+    matchChunks( logData_, chunks(), regexp, interruptRequested, processedLines, threadTables,
+                 [ valueGroup ]( ValueTable& table, const QRegularExpressionMatch& match,
+                                 LineNumber lineNumber ) {
+                     addValueLines( table, match.captured( valueGroup ),
+                                    { 1, lineNumber, lineNumber } );
+                 } );
+
+    ValueTable values;
+    for ( const auto& table : threadTables ) {
+        for ( auto value = table.cbegin(); value != table.cend(); ++value ) {
+            addValueLines( values, value.key(), value.value() );
+        }
+    }
+
+    std::vector<AggregatedValue> aggregatedValues;
+    aggregatedValues.reserve( static_cast<size_t>( values.size() ) );
+    for ( auto value = values.cbegin(); value != values.cend(); ++value ) {
+        aggregatedValues.push_back(
+            { value.key(), value.value().count, value.value().firstLine, value.value().lastLine } );
+    }
+
+    std::sort( aggregatedValues.begin(), aggregatedValues.end(),
+               []( const AggregatedValue& lhs, const AggregatedValue& rhs ) {
+                   return std::tie( rhs.count, lhs.firstLine )
+                          < std::tie( lhs.count, rhs.firstLine );
+               } );
+
+    LOG_INFO << "Counted " << aggregatedValues.size() << " values of " << regexp.pattern()
+             << " in " << processedLines.load() << " lines";
+
+    return aggregatedValues;
+}
+
+NumericStatistics ValueAggregator::summarize( const QRegularExpression& regexp,
+                                              size_t intervalsCount,
+                                              const AtomicFlag& interruptRequested,
+                                              std::atomic<uint64_t>& processedLines ) const
+{
+    NumericStatistics statistics;
+    statistics.intervals.resize( intervalsCount );
+    if ( !regexp.isValid() || count_.get() == 0 || intervalsCount == 0 ) {
+        return statistics;
+    }
+
+    const auto valueGroup = regexp.captureCount() > 0 ? 1 : 0;
+
+    // Filtered lines are placed by their line in the file
+    const auto rangeFirst = lines_ ? 0_lnum : first_;
+    const auto rangeLines
+        = std::max( lines_ ? logData_->getNbLine().get() : count_.get(), uint64_t{ 1 } );
+    const auto intervalOf = [ rangeFirst, rangeLines, intervalsCount ]( LineNumber line ) {
+        const auto offset = std::min( line.get() - rangeFirst.get(), rangeLines - 1 );
+        return static_cast<size_t>( offset * intervalsCount / rangeLines );
+    };
+
+    tbb::enumerable_thread_specific<NumericStatistics> threadStatistics(
+        [ intervalsCount ]() {
+            NumericStatistics threadState;
+            threadState.intervals.resize( intervalsCount );
+            return threadState;
+        } );
+    matchChunks( logData_, chunks(), regexp, interruptRequested, processedLines,
+                 threadStatistics,
+                 [ valueGroup, &intervalOf ]( NumericStatistics& state,
+                                              const QRegularExpressionMatch& match,
+                                              LineNumber lineNumber ) {
+                     bool isNumber = false;
+                     const auto value = match.captured( valueGroup ).toDouble( &isNumber );
+                     if ( isNumber ) {
+                         state.values.add( value );
+                         state.intervals[ intervalOf( lineNumber ) ].add( value );
+                     }
+                 } );
+
+    for ( const auto& threadState : threadStatistics ) {
+        statistics.values.merge( threadState.values );
+        for ( auto interval = 0u; interval < intervalsCount; ++interval ) {
+            statistics.intervals[ interval ].merge( threadState.intervals[ interval ] );
+        }
+    }
+
+    LOG_INFO << "Summarized " << statistics.values.count() << " numbers of " << regexp.pattern()
+             << " in " << processedLines.load() << " lines";
+
+    return statistics;
+}
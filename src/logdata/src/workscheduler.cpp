@@ -0,0 +1,187 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "workscheduler.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include <tbb/info.h>
+
+#include "configuration.h"
+#include "fileholder.h"
+#include "log.h"
+
+namespace {
+// Waiting streams wake up to check for interrupts
+constexpr auto StreamWaitInterval = std::chrono::milliseconds( 100 );
+} // namespace
+
+tbb::task_arena::constraints configuredArenaConstraints()
+{
+    tbb::task_arena::constraints constraints;
+
+    const auto numaNode = Configuration::get().numaNode();
+    if ( numaNode < 0 ) {
+        return constraints;
+    }
+
+    // Nodes are known only if TBB found its hwloc binding library
+    const auto nodes = tbb::info::numa_nodes();
+    if ( std::find( nodes.begin(), nodes.end(), numaNode ) == nodes.end() ) {
+        LOG_WARNING << "NUMA node " << numaNode << " is not available, using all nodes";
+        return constraints;
+    }
+
+    LOG_INFO << "Using threads of NUMA node " << numaNode;
+    constraints.set_numa_id( numaNode );
+    return constraints;
+}
+
+WorkScheduler& WorkScheduler::get()
+{
+    static WorkScheduler scheduler;
+    return scheduler;
+}
+
+WorkScheduler::WorkScheduler()
+    : foregroundArena_( configuredArenaConstraints(), 1, tbb::task_arena::priority::high )
+    , backgroundArena_( configuredArenaConstraints(), 1, tbb::task_arena::priority::low )
+{
+}
+
+void WorkScheduler::setForeground( const QString& fileName, bool isForeground )
+{
+    {
+        UniqueLock lock( foregroundMutex_ );
+        if ( isForeground ) {
+            ++foregroundFiles_[ fileName ];
+        }
+        else {
+            const auto file = foregroundFiles_.find( fileName );
+            if ( file != foregroundFiles_.end() && --file->second <= 0 ) {
+                foregroundFiles_.erase( file );
+            }
+        }
+    }
+
+    LOG_DEBUG << fileName << ( isForeground ? " is foreground" : " is background" );
+    streamsChanged_.notify_all();
+}
+
+bool WorkScheduler::isForeground( const QString& fileName ) const
+{
+    SharedLock lock( foregroundMutex_ );
+    return foregroundFiles_.count( fileName ) > 0;
+}
+
+WorkScheduler::DiskStream WorkScheduler::openDiskStream( const QString& fileName,
+                                                         const AtomicFlag& interruptRequested,
+                                                         bool isBackgroundWork )
+{
+    return DiskStream{ this, fileName, interruptRequested, isBackgroundWork };
+}
+
+WorkScheduler::DiskStream::DiskStream( WorkScheduler* scheduler, const QString& fileName,
+                                       const AtomicFlag& interruptRequested,
+                                       bool isBackgroundWork )
+    : scheduler_( scheduler )
+    , fileName_( fileName )
+    , device_( FileId::getFileId( fileName ).volumeIndex )
+    , interruptRequested_( interruptRequested )
+    , isBackgroundWork_( isBackgroundWork )
+{
+    acquire();
+}
+
+WorkScheduler::DiskStream::~DiskStream()
+{
+    release();
+}
+
+bool WorkScheduler::DiskStream::isForeground() const
+{
+    return !isBackgroundWork_ && scheduler_->isForeground( fileName_ );
+}
+
+void WorkScheduler::DiskStream::acquire()
+{
+    const auto maxStreams = std::max( 1, Configuration::get().maxDiskStreamsPerDevice() );
+    const auto isForeground = this->isForeground();
+
+    ScopedLock lock( scheduler_->streamsMutex_ );
+    auto& device = scheduler_->devices_[ device_ ];
+
+    if ( isForeground ) {
+        ++device.foregroundWaiters;
+    }
+
+    while ( !interruptRequested_ ) {
+        if ( device.activeStreams < maxStreams
+             && ( isForeground || device.foregroundWaiters == 0 ) ) {
+            ++device.activeStreams;
+            isAcquired_ = true;
+            break;
+        }
+
+        scheduler_->streamsChanged_.wait_for( lock, StreamWaitInterval );
+    }
+
+    if ( isForeground ) {
+        --device.foregroundWaiters;
+    }
+}
+
+void WorkScheduler::DiskStream::release()
+{
+    if ( !isAcquired_ ) {
+        return;
+    }
+
+    {
+        ScopedLock lock( scheduler_->streamsMutex_ );
+        --scheduler_->devices_[ device_ ].activeStreams;
+        isAcquired_ = false;
+    }
+
+    scheduler_->streamsChanged_.notify_all();
+}
+
+void WorkScheduler::DiskStream::pause()
+{
+    release();
+}
+
+void WorkScheduler::DiskStream::yield()
+{
+    {
+        ScopedLock lock( scheduler_->streamsMutex_ );
+        if ( isAcquired_ && scheduler_->devices_[ device_ ].foregroundWaiters == 0 ) {
+            return;
+        }
+    }
+
+    if ( isAcquired_ && isForeground() ) {
+        return;
+    }
+
+    LOG_DEBUG << "Stream of " << fileName_ << " yields to foreground";
+    release();
+    acquire();
+}
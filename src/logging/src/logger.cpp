@@ -20,18 +20,24 @@
 #include "logger.h"
 #include "log.h"
 
+#include <array>
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <cstdint>
+#include <cstdlib>
+#include <exception>
 #include <iostream>
 #include <memory>
 #include <mutex>
 #include <shared_mutex>
+#include <thread>
+#include <vector>
 
 #include <QCoreApplication>
 #include <QDateTime>
 #include <QDir>
 #include <QFile>
-#include <QTextStream>
 
 namespace logging {
 
@@ -41,6 +47,53 @@ void kloggConsoleMessageHandler( QtMsgType type, const QMessageLogContext& conte
                                  const QString& msg );
 void kloggNoopMessageHandler( QtMsgType, const QMessageLogContext&, const QString& ) {}
 
+// Messages of one thread waiting for the writer thread. Only the owning
+// thread adds messages and only the writer takes them, so neither of them
+// waits for the other. Messages that do not fit are dropped and counted.
+class MessageRing {
+  public:
+    static constexpr size_t Capacity = 4096;
+
+    bool push( QByteArray message )
+    {
+        const auto tail = tail_.load( std::memory_order_relaxed );
+        if ( tail - head_.load( std::memory_order_acquire ) == Capacity ) {
+            dropped_.fetch_add( 1, std::memory_order_relaxed );
+            return false;
+        }
+
+        messages_[ tail % Capacity ] = std::move( message );
+        tail_.store( tail + 1, std::memory_order_release );
+        return tail - head_.load( std::memory_order_relaxed ) >= Capacity / 2;
+    }
+
+    // Appends all waiting messages to the batch, returns their number
+    size_t drain( QByteArray& batch )
+    {
+        const auto head = head_.load( std::memory_order_relaxed );
+        const auto tail = tail_.load( std::memory_order_acquire );
+        for ( auto index = head; index < tail; ++index ) {
+            auto& message = messages_[ index % Capacity ];
+            batch.append( message );
+            batch.append( '\n' );
+            message = QByteArray{};
+        }
+        head_.store( tail, std::memory_order_release );
+
+        if ( const auto dropped = dropped_.exchange( 0, std::memory_order_relaxed ); dropped > 0 ) {
+            batch.append( QString( "%1 log messages dropped\n" ).arg( dropped ).toUtf8() );
+        }
+
+        return tail - head;
+    }
+
+  private:
+    std::array<QByteArray, Capacity> messages_;
+    std::atomic<size_t> head_{ 0 };
+    std::atomic<size_t> tail_{ 0 };
+    std::atomic<uint64_t> dropped_{ 0 };
+};
+
 class Logger {
   public:
     static Logger& instance()
@@ -49,36 +102,20 @@ class Logger {
         return l;
     }
 
-    void fileMessageHandler( QtMsgType type, const QMessageLogContext& context, const QString& msg )
+    ~Logger()
     {
-        if ( !needLogging( type ) ) {
-            return;
-        }
-        
-        const auto formattedMessage = qFormatLogMessage( type, context, msg );
-        const auto messageToPrint = formattedMessage.toUtf8();
-
-        ScopedLock lock( mutex_ );
-        QTextStream ts( logFile_.get() );
-        ts << messageToPrint << '\n';
+        stopWriter();
+    }
 
-        if ( isConsoleLogEnabled_ ) {
-            std::cout << messageToPrint.constData() << std::endl;
-        }
+    void fileMessageHandler( QtMsgType type, const QMessageLogContext& context, const QString& msg )
+    {
+        messageHandler( type, context, msg );
     }
 
     void consoleMessageHandler( QtMsgType type, const QMessageLogContext& context,
                                 const QString& msg )
     {
-        if ( !needLogging( type ) ) {
-            return;
-        }
-
-        const auto formattedMessage = qFormatLogMessage( type, context, msg );
-        const auto messageToPrint = formattedMessage.toUtf8();
-
-        ScopedLock lock( mutex_ );
-        std::cout << messageToPrint.constData() << std::endl;
+        messageHandler( type, context, msg );
     }
 
     void enableLogging( bool isEnabled, uint8_t logLevel )
@@ -134,10 +171,137 @@ class Logger {
     }
 
   private:
-    Logger() = default;
+    Logger()
+    {
+        previousTerminateHandler_ = std::set_terminate( &Logger::terminateHandler );
+    }
+
+    // Messages logged just before an uncaught exception
+    // are written before the application is aborted
+    [[noreturn]] static void terminateHandler()
+    {
+        auto& logger = instance();
+        logger.flush();
+
+        if ( logger.previousTerminateHandler_ != nullptr ) {
+            logger.previousTerminateHandler_();
+        }
+        std::abort();
+    }
+
+    // Messages are formatted by the threads that log them
+    // and written in batches by the writer thread
+    void messageHandler( QtMsgType type, const QMessageLogContext& context, const QString& msg )
+    {
+        if ( !needLogging( type ) ) {
+            return;
+        }
+
+        auto messageToPrint = qFormatLogMessage( type, context, msg ).toUtf8();
+
+        // Application is aborted right after fatal message
+        if ( type == QtFatalMsg ) {
+            flush();
+            ScopedLock lock( mutex_ );
+            messageToPrint.append( '\n' );
+            write( messageToPrint );
+            return;
+        }
+
+        if ( threadRing().push( std::move( messageToPrint ) ) ) {
+            writerWakeup_.notify_one();
+        }
+    }
+
+    MessageRing& threadRing()
+    {
+        thread_local std::shared_ptr<MessageRing> ring;
+        if ( !ring ) {
+            ring = std::make_shared<MessageRing>();
+            std::lock_guard<std::mutex> lock( ringsMutex_ );
+            rings_.push_back( ring );
+        }
+        return *ring;
+    }
+
+    // Must be called with mutex_ held
+    void write( const QByteArray& batch )
+    {
+        if ( logFile_ ) {
+            logFile_->write( batch );
+        }
+
+        if ( isConsoleLogEnabled_ || !logFile_ ) {
+            std::cout.write( batch.constData(), batch.size() );
+            std::cout.flush();
+        }
+    }
+
+    // Writes messages of all threads, returns their number
+    size_t flush()
+    {
+        QByteArray batch;
+        size_t messagesCount = 0;
+        {
+            std::lock_guard<std::mutex> lock( ringsMutex_ );
+            for ( auto ring = rings_.begin(); ring != rings_.end(); ) {
+                messagesCount += ( *ring )->drain( batch );
+
+                // Thread has exited, messages it pushed after the drain above
+                // are taken before its ring is dropped
+                if ( ring->use_count() == 1 ) {
+                    std::atomic_thread_fence( std::memory_order_acquire );
+                    messagesCount += ( *ring )->drain( batch );
+                    ring = rings_.erase( ring );
+                }
+                else {
+                    ++ring;
+                }
+            }
+        }
+
+        if ( !batch.isEmpty() ) {
+            ScopedLock lock( mutex_ );
+            write( batch );
+        }
+        return messagesCount;
+    }
+
+    void startWriter()
+    {
+        if ( writer_.joinable() ) {
+            return;
+        }
+
+        isWriterStopped_ = false;
+        writer_ = std::thread( [ this ] {
+            while ( !isWriterStopped_ ) {
+                if ( flush() == 0 ) {
+                    std::unique_lock<std::mutex> lock( writerMutex_ );
+                    writerWakeup_.wait_for( lock, std::chrono::milliseconds( 20 ) );
+                }
+            }
+            flush();
+        } );
+    }
+
+    void stopWriter()
+    {
+        if ( !writer_.joinable() ) {
+            return;
+        }
+
+        isWriterStopped_ = true;
+        writerWakeup_.notify_one();
+        writer_.join();
+    }
 
     void setMessageHandler()
     {
+        if ( isAnyEnabled() ) {
+            startWriter();
+        }
+
         if ( !isAnyEnabled() ) {
             qInstallMessageHandler( logging::kloggNoopMessageHandler );
         }
@@ -180,6 +344,16 @@ class Logger {
     std::atomic_int logLevel_ = 0;
 
     std::unique_ptr<QFile> logFile_;
+
+    std::mutex ringsMutex_;
+    std::vector<std::shared_ptr<MessageRing>> rings_;
+
+    std::thread writer_;
+    std::atomic_bool isWriterStopped_ = false;
+    std::mutex writerMutex_;
+    std::condition_variable writerWakeup_;
+
+    std::terminate_handler previousTerminateHandler_ = nullptr;
 };
 
 void enableLogging( bool isEnabled, LogLevel logLevel )
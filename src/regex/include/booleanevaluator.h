@@ -17,8 +17,11 @@
  * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <cstdint>
 #include <exprtk.hpp>
+#include <optional>
 #include <string_view>
+#include <vector>
 
 #include "regularexpressionpattern.h"
 
@@ -39,11 +42,34 @@ class BooleanExpressionEvaluator {
 
     bool evaluate( std::string_view variables );
 
+    // Sub patterns can be matched one at a time until the outcome
+    // is known, see setEvaluationOrder and decide
+    bool canDecideEarly() const;
+
+    // Patterns that decide the outcome alone most often for their cost go first,
+    // costs and ratios of matching lines are measured on the first lines
+    std::vector<unsigned> chooseEvaluationOrder( const std::vector<double>& costs,
+                                                 const std::vector<double>& matchRatios ) const;
+
+    void setEvaluationOrder( std::vector<unsigned> order );
+
+    const std::vector<unsigned>& evaluationOrder() const
+    {
+        return evaluationOrder_;
+    }
+
+    // Outcome when the first count patterns of evaluation order are matched,
+    // bit K of matched is set if K-th of them matches. Empty if outcome
+    // depends on patterns that are not matched yet.
+    std::optional<bool> decide( unsigned count, uint32_t matched ) const;
+
+  private:
+    bool isTrue( uint32_t patternCombination ) const;
+
   private:
     bool isValid_ = true;
     std::string errorString_;
 
-    
 
     exprtk::symbol_table<double> symbols_;
     exprtk::expression<double> expression_;
@@ -51,5 +77,12 @@ class BooleanExpressionEvaluator {
 
     std::vector<double*> variables_;
 
-    double precomputedResults_[16];
+    // Result of expression for every combination of matched patterns,
+    // bit N is set if expression is true when patterns from bits of N match
+    std::vector<uint64_t> truthTable_;
+
+    // Outcome for each prefix of evaluation order and its matched patterns:
+    // prefixes of count patterns start at index 2^count - 1
+    std::vector<unsigned> evaluationOrder_;
+    std::vector<int8_t> decisions_;
 };
\ No newline at end of file
@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_HSDATABASECACHE_H
+#define KLOGG_HSDATABASECACHE_H
+
+#ifdef KLOGG_HAS_HS
+
+#include <list>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include <QByteArray>
+#include <QString>
+
+#include "hsregularexpression.h"
+
+// Process-wide cache of compiled Hyperscan databases.
+// Databases are shared by all searches with the same patterns and flags,
+// most recently used ones are kept in memory. If enabled in configuration,
+// serialized databases are also stored in cache directory and loaded
+// instead of compiling patterns again in the next sessions.
+class HsDatabaseCache {
+  public:
+    static HsDatabaseCache& get();
+
+    // Returns empty database and sets errorMessage if patterns can't be compiled
+    HsDatabase database( const std::vector<RegularExpressionPattern>& patterns, unsigned flags,
+                         QString& errorMessage );
+
+  private:
+    HsDatabaseCache();
+
+    HsDatabase find( const QByteArray& key );
+    void insert( const QByteArray& key, const HsDatabase& database );
+
+    HsDatabase load( const QByteArray& key ) const;
+    void save( const QByteArray& key, const HsDatabase& database ) const;
+
+  private:
+    std::mutex mutex_;
+
+    // Most recently used first
+    std::list<std::pair<QByteArray, HsDatabase>> databases_;
+};
+
+#endif
+
+#endif
@@ -21,7 +21,9 @@
 #define KLOGG_HS_REGULAR_EXPRESSION
 
 #include <algorithm>
+#include <chrono>
 #include <cstddef>
+#include <cstdint>
 #include <iterator>
 #include <string>
 #include <string_view>
@@ -34,40 +36,55 @@
 #ifdef KLOGG_HAS_HS
 #include <hs.h>
 
+#include "atomicflag.h"
 #include "resourcewrapper.h"
 #endif
 
+#include "jsonquery.h"
+#include "literalprefilter.h"
 #include "regularexpressionpattern.h"
 
 using MatchedPatterns = std::string;
 
+class BooleanExpressionEvaluator;
+
 class DefaultRegularExpressionMatcher {
   public:
     explicit DefaultRegularExpressionMatcher(
-        const std::vector<RegularExpressionPattern>& patterns )
-    {
-        std::transform(
-            patterns.cbegin(), patterns.cend(), std::back_inserter( regexp_ ),
-            []( const auto& pattern ) { return static_cast<QRegularExpression>( pattern ); } );
-    }
+        const std::vector<RegularExpressionPattern>& patterns );
 
-    MatchedPatterns match( const std::string_view& utf8Data ) const
-    {
-        MatchedPatterns matchedPatterns( regexp_.size(), 0 );
-        std::transform( regexp_.cbegin(), regexp_.cend(), matchedPatterns.begin(),
-                        [ utf8Data ]( const auto& regexp ) {
-                            return regexp
-                                .match( QString::fromUtf8( utf8Data.data(),
-                                                           static_cast<int>( utf8Data.size() ) ) )
-                                .hasMatch();
-                            ;
-                        } );
-
-        return matchedPatterns;
-    }
+    MatchedPatterns match( const std::string_view& utf8Data ) const;
+
+    // Clears candidates found by a prefilter that don't match
+    void confirm( const std::string_view& utf8Data, MatchedPatterns& candidates ) const;
+
+    // Evaluates a boolean combination matching its sub patterns one at a time
+    // until the outcome is known, patterns that are not candidates don't match.
+    // First lines are matched with all patterns to measure their cost
+    // and hits, these choose the order of matching the next lines.
+    bool matchCombination( const std::string_view& utf8Data, BooleanExpressionEvaluator& evaluator,
+                           const MatchedPatterns* candidates = nullptr ) const;
 
   private:
+    // Converts line to UTF-16 reusing the buffer of previous line
+    void decode( const std::string_view& utf8Data ) const;
+
+    bool matchPattern( size_t index, const std::string_view& utf8Data, bool& isDecoded ) const;
+
+    void chooseEvaluationOrder( BooleanExpressionEvaluator& evaluator ) const;
+
     std::vector<QRegularExpression> regexp_;
+    std::vector<LiteralPrefilter> prefilters_;
+
+    // Matcher is used by one thread at a time
+    mutable QString utf16Line_;
+
+    struct PatternCost {
+        std::chrono::nanoseconds duration{};
+        uint64_t hits = 0;
+    };
+    mutable std::vector<PatternCost> costs_;
+    mutable uint64_t sampledLines_ = 0;
 };
 
 #ifdef KLOGG_HAS_HS
@@ -108,9 +125,20 @@ class HsMatcher {
 class HsSingleMatcher : public HsMatcher {
   public:
     HsSingleMatcher() = default;
-    HsSingleMatcher( HsDatabase database, HsScratch scratch );
+    HsSingleMatcher( HsDatabase database, HsScratch scratch, HsDatabase blockDatabase = {} );
 
     MatchedPatterns match( const std::string_view& utf8Data ) const;
+
+    // Scans consecutive lines with one hs_scan call and adds indexes
+    // of matching lines to matchingLines. Returns false if pattern
+    // has no block database or lines are not contiguous.
+    // Scan is stopped at the next match once interrupt is set.
+    bool matchBlock( const std::vector<std::string_view>& lines,
+                     std::vector<uint32_t>& matchingLines,
+                     const AtomicFlag* interrupt = nullptr ) const;
+
+  private:
+    HsDatabase blockDatabase_;
 };
 
 class HsMultiMatcher : public HsMatcher {
@@ -121,13 +149,34 @@ class HsMultiMatcher : public HsMatcher {
     MatchedPatterns match( const std::string_view& utf8Data ) const;
 };
 
+// Matches patterns Hyperscan can't match exactly, like lookarounds
+// or backreferences. Lines are scanned with a database compiled in
+// prefilter mode, which may report lines that don't match but never
+// misses ones that do. Only reported patterns are matched by Qt
+// regular expressions.
+class HsPrefilterMatcher : public HsMatcher {
+  public:
+    HsPrefilterMatcher( HsDatabase database, HsScratch scratch,
+                        const std::vector<RegularExpressionPattern>& patterns );
+
+    MatchedPatterns match( const std::string_view& utf8Data ) const;
+
+    // Only candidates reported by the scan are confirmed until the outcome is known
+    bool matchCombination( const std::string_view& utf8Data,
+                           BooleanExpressionEvaluator& evaluator ) const;
+
+  private:
+    DefaultRegularExpressionMatcher confirmationMatcher_;
+};
+
 class HsNoopMatcher {
   public:
     MatchedPatterns match( const std::string_view& utf8Data ) const;
 };
 
 using MatcherVariant
-    = std::variant<DefaultRegularExpressionMatcher, HsNoopMatcher, HsSingleMatcher, HsMultiMatcher>;
+    = std::variant<DefaultRegularExpressionMatcher, HsNoopMatcher, HsSingleMatcher, HsMultiMatcher,
+                   HsPrefilterMatcher, JsonQueryMatcher>;
 
 class HsRegularExpression {
   public:
@@ -153,6 +202,13 @@ class HsRegularExpression {
     HsDatabase database_;
     HsScratch scratch_;
 
+    // Database without single match flag for scanning many lines at once,
+    // only compiled for plain text patterns that can't span lines
+    HsDatabase blockDatabase_;
+
+    // Database is compiled in prefilter mode, matches are confirmed by Qt
+    bool isPrefilter_ = false;
+
     std::vector<RegularExpressionPattern> patterns_;
 
     bool isValid_ = true;
@@ -160,7 +216,7 @@ class HsRegularExpression {
 };
 #else
 
-using MatcherVariant = std::variant<DefaultRegularExpressionMatcher>;
+using MatcherVariant = std::variant<DefaultRegularExpressionMatcher, JsonQueryMatcher>;
 
 class HsRegularExpression {
   public:
@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_HSSPANMATCHER_H
+#define KLOGG_HSSPANMATCHER_H
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+#ifdef KLOGG_HAS_HS
+#include <hs.h>
+
+#include "resourcewrapper.h"
+#endif
+
+#include "regularexpressionpattern.h"
+
+struct MatchedSpan {
+    unsigned id;
+
+    // Byte offsets in UTF-8 line
+    std::size_t start;
+    std::size_t end;
+};
+
+// Finds where each of the patterns matches a line with one scan of
+// Hyperscan database compiled with start of match reporting.
+// Overlapping matches of a pattern are merged into one span.
+// Patterns rejected by Hyperscan are left out of the database,
+// so the caller has to match them by other means.
+class HsSpanMatcher {
+  public:
+    HsSpanMatcher() = default;
+
+    // Spans of patterns[i] are reported with ids[i]
+    HsSpanMatcher( const std::vector<RegularExpressionPattern>& patterns,
+                   const std::vector<unsigned>& ids );
+
+    bool isSupported( unsigned id ) const;
+
+    // Returns spans ordered by id and start
+    std::vector<MatchedSpan> match( std::string_view utf8Line ) const;
+
+  private:
+#ifdef KLOGG_HAS_HS
+    SharedResource<hs_database_t> database_;
+    UniqueResource<hs_scratch_t, hs_free_scratch> scratch_;
+#endif
+
+    // Sorted
+    std::vector<unsigned> supportedIds_;
+};
+
+#endif
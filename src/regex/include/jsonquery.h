@@ -0,0 +1,155 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef KLOGG_JSONQUERY_H
+#define KLOGG_JSONQUERY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "literalprefilter.h"
+
+// Value of a field of JSON line, strings are only valid
+// while the line is being matched
+struct JsonValue {
+    enum class Type { Missing, Null, Bool, Number, String, Other };
+
+    Type type = Type::Missing;
+    bool boolean = false;
+    double number = 0;
+    std::string_view string;
+};
+
+// Filter of JSON lines like .level == "error" && .latency_ms > 500.
+// Fields are paths like .a.b, .a[0] or ."some key", they are compared
+// with strings, numbers, true, false and null by ==, !=, <, <=, > and >=.
+// A field alone is true if it is present and is not null or false.
+// Conditions are combined by && (and), || (or), ! (not) and parentheses.
+// Missing fields are null, so only != is true for them.
+class JsonQuery {
+  public:
+    // Returns true if text looks like a query, that is starts with a field
+    static bool isJsonQuery( std::string_view text );
+
+    // Throws std::runtime_error if query can't be parsed
+    JsonQuery( std::string_view text, bool isCaseSensitive );
+
+    // Fields used by the query as JSON pointers, like /a/b
+    const std::vector<std::string>& fieldPointers() const
+    {
+        return pointers_;
+    }
+
+    // Literals every matching line contains, quoted keys and string
+    // values of conditions that must be true for the whole query
+    const std::vector<LiteralPrefilter>& prefilters() const
+    {
+        return prefilters_;
+    }
+
+    // Evaluates the query, fieldValue( index ) returns JsonValue
+    // of the field with the index in fieldPointers. Fields are
+    // looked up only if they are needed to get the result.
+    template <typename FieldValue>
+    bool evaluate( FieldValue&& fieldValue ) const
+    {
+        return evaluate( 0, fieldValue );
+    }
+
+  private:
+    enum class Operator { And, Or, Not, IsTrue, Equal, NotEqual, Less, LessEqual, Greater,
+                          GreaterEqual };
+
+    struct Node {
+        Operator op = Operator::IsTrue;
+        // Children of And, Or and Not
+        size_t left = 0;
+        size_t right = 0;
+        // Field and literal of comparisons
+        size_t field = 0;
+        JsonValue::Type literalType = JsonValue::Type::Null;
+        bool boolean = false;
+        double number = 0;
+        std::string string;
+    };
+
+    class Parser;
+
+    template <typename FieldValue>
+    bool evaluate( size_t index, FieldValue& fieldValue ) const
+    {
+        const auto& node = nodes_[ index ];
+        switch ( node.op ) {
+        case Operator::And:
+            return evaluate( node.left, fieldValue ) && evaluate( node.right, fieldValue );
+        case Operator::Or:
+            return evaluate( node.left, fieldValue ) || evaluate( node.right, fieldValue );
+        case Operator::Not:
+            return !evaluate( node.left, fieldValue );
+        default:
+            return compare( node, fieldValue( node.field ) );
+        }
+    }
+
+    bool compare( const Node& node, const JsonValue& value ) const;
+    bool isEqual( const Node& node, const JsonValue& value ) const;
+
+    void addPrefilters( size_t index );
+
+  private:
+    bool isCaseSensitive_ = true;
+    // Root is the first node
+    std::vector<Node> nodes_;
+    std::vector<std::string> pointers_;
+    // Last key of each field, like level of .log.level
+    std::vector<std::string> keys_;
+    std::vector<LiteralPrefilter> prefilters_;
+};
+
+// Matches JSON lines by a query. Lines are parsed by simdjson On-Demand
+// parser, which only parses values of the fields used by the query.
+// Lines without literals required by the query are not parsed.
+class JsonQueryMatcher {
+  public:
+    explicit JsonQueryMatcher( std::shared_ptr<const JsonQuery> query );
+    ~JsonQueryMatcher();
+
+    JsonQueryMatcher( JsonQueryMatcher&& other ) noexcept;
+    JsonQueryMatcher& operator=( JsonQueryMatcher&& other ) noexcept;
+
+    // Single pattern result, like other matchers
+    std::string match( const std::string_view& utf8Data ) const;
+
+    bool hasMatch( std::string_view line ) const;
+
+  private:
+    struct Parser;
+
+    std::shared_ptr<const JsonQuery> query_;
+
+    // Matcher is used by one thread at a time
+    std::unique_ptr<Parser> parser_;
+};
+
+#endif
@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_LITERALPREFILTER_H
+#define KLOGG_LITERALPREFILTER_H
+
+#include <string>
+#include <string_view>
+
+// Literal text that every line matching a pattern must contain.
+// Lines without it are rejected by a plain byte search
+// before they are converted to QString for QRegularExpression.
+// For plain text patterns the literal is often the whole pattern,
+// then the search result is the match result.
+class LiteralPrefilter {
+  public:
+    LiteralPrefilter() = default;
+    LiteralPrefilter( std::string_view utf8Pattern, bool isPlainText, bool isCaseSensitive );
+
+    // Returns false only if line can not match the pattern
+    bool mayMatch( std::string_view utf8Line ) const;
+
+    // Returns true if mayMatch is true only for lines matching the pattern
+    bool isExact() const
+    {
+        return isExact_;
+    }
+
+    const std::string& literal() const
+    {
+        return literal_;
+    }
+
+    // Returns the longest literal required by regular expression,
+    // empty if it can not be found
+    static std::string requiredLiteral( std::string_view utf8Regex );
+
+  private:
+    std::string literal_;
+    bool isCaseSensitive_ = true;
+    bool isExact_ = false;
+};
+
+#endif
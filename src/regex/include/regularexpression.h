@@ -20,15 +20,22 @@
 #ifndef KLOGG_PATTERN_MATHCHER_H
 #define KLOGG_PATTERN_MATHCHER_H
 
+#include <algorithm>
+#include <cstdint>
 #include <memory>
 #include <string_view>
+#include <type_traits>
 #include <unordered_map>
+#include <variant>
+#include <vector>
 
 #include <QString>
 
+#include "atomicflag.h"
 #include "hsregularexpression.h"
 
 class PatternMatcher;
+class MultiPatternMatcher;
 class BooleanExpressionEvaluator;
 
 class RegularExpression {
@@ -40,6 +47,35 @@ class RegularExpression {
     bool isValid() const;
     QString errorString() const;
 
+    bool isInverse() const
+    {
+        return isInverse_;
+    }
+
+    bool isBooleanCombination() const
+    {
+        return isBooleanCombination_;
+    }
+
+    // Boolean combination with sub patterns replaced by their ids
+    const QString& expression() const
+    {
+        return expression_;
+    }
+
+    // Boolean pattern starting with a field, like .level == "error",
+    // is a query of JSON lines, see JsonQuery
+    bool isJsonQuery() const
+    {
+        return jsonQuery_ != nullptr;
+    }
+
+    // Quoted patterns of a boolean combination, or the whole pattern
+    const std::vector<RegularExpressionPattern>& subPatterns() const
+    {
+        return subPatterns_;
+    }
+
   private:
     bool isInverse_ = false;
     bool isBooleanCombination_ = false;
@@ -51,8 +87,219 @@ class RegularExpression {
     QString errorString_;
 
     HsRegularExpression hsExpression_;
+    std::shared_ptr<const JsonQuery> jsonQuery_;
 
     friend class PatternMatcher;
+    friend class MultiRegularExpression;
+};
+
+// Several expressions matched in one pass, sub patterns of all
+// expressions are compiled into a single database.
+class MultiRegularExpression {
+  public:
+    explicit MultiRegularExpression( const std::vector<RegularExpressionPattern>& patterns );
+
+    std::unique_ptr<MultiPatternMatcher> createMatcher() const;
+
+    size_t size() const;
+
+    bool isValid() const;
+    QString errorString() const;
+
+  private:
+    struct Expression {
+        bool isInverse = false;
+        bool isBooleanCombination = false;
+        QString expression;
+        size_t firstSubPattern = 0;
+        size_t subPatternsCount = 0;
+    };
+
+    std::vector<Expression> expressions_;
+    std::vector<RegularExpressionPattern> subPatterns_;
+
+    bool isValid_ = true;
+    QString errorString_;
+
+    HsRegularExpression hsExpression_;
+
+    friend class MultiPatternMatcher;
+};
+
+namespace matching {
+bool evaluateCombination( BooleanExpressionEvaluator* evaluator,
+                          const MatchedPatterns& matchedPatterns );
+
+bool canDecideEarly( const BooleanExpressionEvaluator* evaluator );
+
+// Tells loops over lines when to check if matching is interrupted.
+// Flag is checked after a number of lines or bytes, so a chunk
+// of long lines is left as quickly as a chunk of short ones.
+class InterruptCheck {
+  public:
+    explicit InterruptCheck( const AtomicFlag* interrupt )
+        : interrupt_( interrupt )
+    {
+    }
+
+    bool isInterrupted( std::string_view line )
+    {
+        if ( interrupt_ == nullptr ) {
+            return false;
+        }
+
+        bytes_ += line.size() + 1;
+        if ( ++lines_ < CheckLines && bytes_ < CheckBytes ) {
+            return false;
+        }
+
+        lines_ = 0;
+        bytes_ = 0;
+        return static_cast<bool>( *interrupt_ );
+    }
+
+  private:
+    static constexpr size_t CheckLines = 1024;
+    static constexpr size_t CheckBytes = 256 * 1024;
+
+    const AtomicFlag* interrupt_;
+    size_t lines_ = 0;
+    size_t bytes_ = 0;
+};
+
+template <typename Matcher, typename = void>
+struct HasBlockMatch : std::false_type {};
+
+template <typename Matcher>
+struct HasBlockMatch<Matcher, std::void_t<decltype( std::declval<const Matcher&>().matchBlock(
+                                  std::declval<const std::vector<std::string_view>&>(),
+                                  std::declval<std::vector<uint32_t>&>() ) )>> : std::true_type {
+};
+
+template <typename Matcher, typename = void>
+struct HasCombinationMatch : std::false_type {};
+
+template <typename Matcher>
+struct HasCombinationMatch<
+    Matcher, std::void_t<decltype( std::declval<const Matcher&>().matchCombination(
+                 std::declval<std::string_view>(), std::declval<BooleanExpressionEvaluator&>() ) )>>
+    : std::true_type {};
+} // namespace matching
+
+// Tests lines with a concrete matcher type in one search mode,
+// so that loops over lines need no dispatch for every line
+template <typename Matcher, bool IsInverse, bool IsBooleanCombination>
+class SpecializedPatternMatcher {
+  public:
+    // Lines matching each sub pattern of a boolean combination
+    // are counted in subPatternHits if it is passed
+    SpecializedPatternMatcher( const Matcher& matcher, BooleanExpressionEvaluator* evaluator,
+                               std::vector<uint64_t>* subPatternHits = nullptr )
+        : matcher_( matcher )
+        , evaluator_( evaluator )
+        , subPatternHits_( subPatternHits )
+    {
+    }
+
+    bool hasMatch( std::string_view line ) const
+    {
+        // Sub patterns are matched only until the outcome is known,
+        // their hits are not counted then
+        if constexpr ( IsBooleanCombination && matching::HasCombinationMatch<Matcher>::value ) {
+            if ( matching::canDecideEarly( evaluator_ ) ) {
+                return matcher_.matchCombination( line, *evaluator_ ) != IsInverse;
+            }
+        }
+
+        const auto result = matcher_.match( line );
+
+        bool isMatched = false;
+        if constexpr ( IsBooleanCombination ) {
+            if ( subPatternHits_ != nullptr && result.size() == subPatternHits_->size() ) {
+                for ( auto index = 0u; index < result.size(); ++index ) {
+                    ( *subPatternHits_ )[ index ] += result[ index ] > 0 ? 1 : 0;
+                }
+            }
+            isMatched = matching::evaluateCombination( evaluator_, result );
+        }
+        else {
+            isMatched = !result.empty() && result[ 0 ] > 0;
+        }
+
+        return isMatched != IsInverse;
+    }
+
+    // Inverse search usually matches most lines, so its results
+    // are built from the few lines it rejects
+    static constexpr bool IsInverseSearch = IsInverse;
+
+    // Adds indexes of matching lines to matchingLines,
+    // all lines are scanned at once if the engine supports it.
+    // If interrupt is set, matching stops and results are incomplete.
+    void matchLines( const std::vector<std::string_view>& lines,
+                     std::vector<uint32_t>& matchingLines,
+                     const AtomicFlag* interrupt = nullptr ) const
+    {
+        if constexpr ( IsInverse ) {
+            std::vector<uint32_t> excludedLines;
+            rejectLines( lines, excludedLines, interrupt );
+
+            auto excluded = excludedLines.cbegin();
+            for ( auto index = 0u; index < lines.size(); ++index ) {
+                if ( excluded != excludedLines.cend() && *excluded == index ) {
+                    ++excluded;
+                }
+                else {
+                    matchingLines.push_back( index );
+                }
+            }
+            return;
+        }
+
+        if constexpr ( !IsBooleanCombination && matching::HasBlockMatch<Matcher>::value ) {
+            if ( matcher_.matchBlock( lines, matchingLines, interrupt ) ) {
+                return;
+            }
+        }
+
+        matching::InterruptCheck interruptCheck( interrupt );
+        for ( auto index = 0u; index < lines.size(); ++index ) {
+            if ( hasMatch( lines[ index ] ) ) {
+                matchingLines.push_back( index );
+            }
+            if ( interruptCheck.isInterrupted( lines[ index ] ) ) {
+                return;
+            }
+        }
+    }
+
+    // Adds indexes of lines that don't match in ascending order
+    void rejectLines( const std::vector<std::string_view>& lines,
+                      std::vector<uint32_t>& rejectedLines,
+                      const AtomicFlag* interrupt = nullptr ) const
+    {
+        if constexpr ( IsInverse && !IsBooleanCombination
+                       && matching::HasBlockMatch<Matcher>::value ) {
+            if ( matcher_.matchBlock( lines, rejectedLines, interrupt ) ) {
+                return;
+            }
+        }
+
+        matching::InterruptCheck interruptCheck( interrupt );
+        for ( auto index = 0u; index < lines.size(); ++index ) {
+            if ( !hasMatch( lines[ index ] ) ) {
+                rejectedLines.push_back( index );
+            }
+            if ( interruptCheck.isInterrupted( lines[ index ] ) ) {
+                return;
+            }
+        }
+    }
+
+  private:
+    const Matcher& matcher_;
+    BooleanExpressionEvaluator* evaluator_;
+    std::vector<uint64_t>* subPatternHits_;
 };
 
 class PatternMatcher {
@@ -62,9 +309,46 @@ class PatternMatcher {
 
     bool hasMatch( std::string_view line ) const;
 
-  private:
-    using MatchFunc = bool ( * )( std::string_view line, const MatcherVariant& matcher, BooleanExpressionEvaluator* evaluator );
-    MatchFunc hasMatchImpl_;
+    // Engine that matches lines: Hyperscan, Hyperscan prefilter
+    // confirmed by QRegularExpression, or QRegularExpression only
+    QString engineName() const;
+
+    // Lines matched by each sub pattern of a boolean combination so far.
+    // Empty if sub patterns are matched only until the outcome is known.
+    const std::vector<uint64_t>& subPatternHits() const
+    {
+        return subPatternHits_;
+    }
+
+    // Starts counting hits again when the matcher is reused for another search
+    void resetSubPatternHits()
+    {
+        std::fill( subPatternHits_.begin(), subPatternHits_.end(), 0 );
+    }
+
+    // Calls func with SpecializedPatternMatcher for the engine and mode of this matcher
+    template <typename Func>
+    auto withSpecializedMatcher( Func&& func ) const
+    {
+        return std::visit(
+            [ this, &func ]( const auto& matcher ) {
+                using Matcher = std::decay_t<decltype( matcher )>;
+                auto* evaluator = evaluator_.get();
+
+                if ( isBooleanCombination_ ) {
+                    return isInverse_ ? func( SpecializedPatternMatcher<Matcher, true, true>(
+                               matcher, evaluator, &subPatternHits_ ) )
+                                      : func( SpecializedPatternMatcher<Matcher, false, true>(
+                                          matcher, evaluator, &subPatternHits_ ) );
+                }
+
+                return isInverse_ ? func( SpecializedPatternMatcher<Matcher, true, false>(
+                           matcher, evaluator ) )
+                                  : func( SpecializedPatternMatcher<Matcher, false, false>(
+                                      matcher, evaluator ) );
+            },
+            matcher_ );
+    }
 
   private:
     bool isInverse_ = false;
@@ -74,6 +358,32 @@ class PatternMatcher {
 
     MatcherVariant matcher_;
     std::unique_ptr<BooleanExpressionEvaluator> evaluator_;
+
+    // Matcher is used by one thread, so it counts hits without locking
+    mutable std::vector<uint64_t> subPatternHits_;
+};
+
+class MultiPatternMatcher {
+  public:
+    explicit MultiPatternMatcher( const MultiRegularExpression& expression );
+    ~MultiPatternMatcher();
+
+    // Sets i-th element of matches to non zero if line
+    // matches i-th expression, matches must have an element per expression
+    void match( std::string_view line, MatchedPatterns& matches ) const;
+
+  private:
+    struct Expression {
+        bool isInverse = false;
+        size_t firstSubPattern = 0;
+        size_t subPatternsCount = 0;
+        std::unique_ptr<BooleanExpressionEvaluator> evaluator;
+    };
+
+    std::vector<Expression> expressions_;
+    size_t subPatternsCount_ = 0;
+
+    MatcherVariant matcher_;
 };
 
 #endif
\ No newline at end of file
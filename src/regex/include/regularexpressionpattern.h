@@ -79,8 +79,8 @@ struct RegularExpressionPattern {
     bool operator==( const RegularExpressionPattern& other ) const
     {
         return std::tie( pattern, isCaseSensitive, isExclude, isBoolean, isPlainText )
-               == std::tie( other.pattern, other.isCaseSensitive, isExclude, isBoolean,
-                            isPlainText );
+               == std::tie( other.pattern, other.isCaseSensitive, other.isExclude, other.isBoolean,
+                            other.isPlainText );
     }
 
   private:
@@ -22,16 +22,25 @@
 #include <algorithm>
 #include <cstddef>
 #include <cstdint>
+#include <numeric>
 #include <string>
 
 #include "log.h"
 
 namespace {
 
-static constexpr size_t MaxPrecomputedPatterns = 4;
-static constexpr size_t PrecomputedCombinations[] = { 0, 2, 4, 8, 16 };
+// Truth table for 16 patterns takes 8 KiB
+static constexpr size_t MaxPrecomputedPatterns = 16;
 
-bool isBitSet( unsigned num, unsigned bit )
+// Outcomes of all prefixes of evaluation order take 8 KiB for 12 patterns
+static constexpr size_t MaxLazyPatterns = 12;
+
+// Patterns that never decide the outcome alone are ranked by cost only
+static constexpr double MinDecideChance = 0.001;
+
+static constexpr int8_t Undecided = -1;
+
+bool isBitSet( uint64_t num, unsigned bit )
 {
     return 1 == ( ( num >> bit ) & 1 );
 }
@@ -68,17 +77,22 @@ BooleanExpressionEvaluator::BooleanExpressionEvaluator(
         exprtk::parser_error::update_error( error, expression );
         errorString_ = error.diagnostic + " at " + std::to_string( error.column_no );
     }
-    else if ( patterns.size() <= MaxPrecomputedPatterns ) {
-        const auto patternVariants = PrecomputedCombinations[ patterns.size() ];
+    else if ( variables_.size() <= MaxPrecomputedPatterns ) {
+        // Expression is evaluated once for each combination,
+        // matching lines then only needs a table lookup
+        const auto patternVariants = uint32_t{ 1 } << variables_.size();
+        truthTable_.resize( ( patternVariants + 63 ) / 64, 0 );
         for ( auto patternCombination = 0u; patternCombination < patternVariants;
               ++patternCombination ) {
-            for ( auto p = 0u; p < patterns.size(); ++p ) {
+            for ( auto p = 0u; p < variables_.size(); ++p ) {
                 *variables_[ p ] = isBitSet( patternCombination, p );
             }
-            precomputedResults_[ patternCombination ] = expression_.value();
-            LOG_INFO << "precomputed result for " << patternCombination << " is "
-                     << ( precomputedResults_[ patternCombination ] > 0 );
+            if ( expression_.value() > 0 ) {
+                auto& word = truthTable_[ patternCombination / 64 ];
+                word |= uint64_t{ 1 } << ( patternCombination % 64 );
+            }
         }
+        LOG_INFO << "Precomputed boolean expression for " << patternVariants << " combinations";
     }
 }
 
@@ -93,9 +107,8 @@ bool BooleanExpressionEvaluator::evaluate( std::string_view variables )
         return false;
     }
 
-    if ( variables.size() <= MaxPrecomputedPatterns ) {
-        const auto patternCombination = buildPatternCombination( variables );
-        return precomputedResults_[ patternCombination ] > 0;
+    if ( !truthTable_.empty() ) {
+        return isTrue( buildPatternCombination( variables ) );
     }
 
     for ( auto index = 0u; index < variables_.size(); ++index ) {
@@ -104,3 +117,102 @@ bool BooleanExpressionEvaluator::evaluate( std::string_view variables )
 
     return expression_.value() > 0;
 }
+
+bool BooleanExpressionEvaluator::isTrue( uint32_t patternCombination ) const
+{
+    return isBitSet( truthTable_[ patternCombination / 64 ], patternCombination % 64 );
+}
+
+bool BooleanExpressionEvaluator::canDecideEarly() const
+{
+    return isValid_ && !truthTable_.empty() && variables_.size() <= MaxLazyPatterns;
+}
+
+std::vector<unsigned>
+BooleanExpressionEvaluator::chooseEvaluationOrder( const std::vector<double>& costs,
+                                                   const std::vector<double>& matchRatios ) const
+{
+    const auto patternsCount = static_cast<unsigned>( variables_.size() );
+    std::vector<unsigned> order( patternsCount );
+    std::iota( order.begin(), order.end(), 0u );
+
+    if ( !canDecideEarly() || costs.size() != patternsCount
+         || matchRatios.size() != patternsCount ) {
+        return order;
+    }
+
+    // Pattern decides the outcome alone if all combinations
+    // with its value give the same result, like false for "and"
+    const auto decidesAlone = [ this, patternsCount ]( unsigned pattern, bool value ) {
+        std::optional<bool> outcome;
+        for ( auto combination = 0u; combination < ( 1u << patternsCount ); ++combination ) {
+            if ( isBitSet( combination, pattern ) != value ) {
+                continue;
+            }
+            const auto result = isTrue( combination );
+            if ( outcome && *outcome != result ) {
+                return false;
+            }
+            outcome = result;
+        }
+        return true;
+    };
+
+    std::vector<double> ranks( patternsCount );
+    for ( auto pattern = 0u; pattern < patternsCount; ++pattern ) {
+        const auto ratio = matchRatios[ pattern ];
+        const auto decideChance = ( decidesAlone( pattern, true ) ? ratio : 0.0 )
+                                  + ( decidesAlone( pattern, false ) ? 1.0 - ratio : 0.0 );
+        ranks[ pattern ] = costs[ pattern ] / std::max( decideChance, MinDecideChance );
+    }
+
+    std::stable_sort( order.begin(), order.end(), [ &ranks ]( unsigned lhs, unsigned rhs ) {
+        return ranks[ lhs ] < ranks[ rhs ];
+    } );
+    return order;
+}
+
+void BooleanExpressionEvaluator::setEvaluationOrder( std::vector<unsigned> order )
+{
+    const auto patternsCount = static_cast<unsigned>( variables_.size() );
+    if ( !canDecideEarly() || order.size() != patternsCount ) {
+        evaluationOrder_.clear();
+        decisions_.clear();
+        return;
+    }
+
+    evaluationOrder_ = std::move( order );
+    decisions_.assign( ( size_t{ 1 } << ( patternsCount + 1 ) ) - 1, Undecided );
+
+    // Outcome of all patterns is taken from the truth table, shorter prefix
+    // is decided if both values of its next pattern give the same outcome
+    const auto allPatterns = ( 1u << patternsCount ) - 1;
+    for ( auto matched = 0u; matched <= allPatterns; ++matched ) {
+        uint32_t patternCombination = 0;
+        for ( auto position = 0u; position < patternsCount; ++position ) {
+            if ( isBitSet( matched, position ) ) {
+                patternCombination |= 1u << evaluationOrder_[ position ];
+            }
+        }
+        decisions_[ allPatterns + matched ] = isTrue( patternCombination ) ? 1 : 0;
+    }
+
+    for ( auto count = patternsCount; count-- > 0; ) {
+        const auto prefixStart = ( 1u << count ) - 1;
+        const auto nextPrefixStart = ( 1u << ( count + 1 ) ) - 1;
+        for ( auto matched = 0u; matched < ( 1u << count ); ++matched ) {
+            const auto ifNotMatched = decisions_[ nextPrefixStart + matched ];
+            const auto ifMatched = decisions_[ nextPrefixStart + ( matched | ( 1u << count ) ) ];
+            decisions_[ prefixStart + matched ] = ifNotMatched == ifMatched ? ifMatched : Undecided;
+        }
+    }
+}
+
+std::optional<bool> BooleanExpressionEvaluator::decide( unsigned count, uint32_t matched ) const
+{
+    const auto index = ( size_t{ 1 } << count ) - 1 + matched;
+    if ( index >= decisions_.size() || decisions_[ index ] == Undecided ) {
+        return {};
+    }
+    return decisions_[ index ] == 1;
+}
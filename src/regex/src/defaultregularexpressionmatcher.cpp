@@ -0,0 +1,189 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QtGlobal>
+
+#include <simdutf.h>
+
+#include "booleanevaluator.h"
+#include "hsregularexpression.h"
+
+namespace {
+// Lines matched with all sub patterns of a boolean combination
+// before the order of lazy matching is chosen
+constexpr uint64_t CostSampleLines = 1024;
+} // namespace
+
+DefaultRegularExpressionMatcher::DefaultRegularExpressionMatcher(
+    const std::vector<RegularExpressionPattern>& patterns )
+{
+    std::transform(
+        patterns.cbegin(), patterns.cend(), std::back_inserter( regexp_ ),
+        []( const auto& pattern ) { return static_cast<QRegularExpression>( pattern ); } );
+    std::transform( patterns.cbegin(), patterns.cend(), std::back_inserter( prefilters_ ),
+                    []( const auto& pattern ) {
+                        return LiteralPrefilter( pattern.pattern.toStdString(),
+                                                 pattern.isPlainText, pattern.isCaseSensitive );
+                    } );
+}
+
+void DefaultRegularExpressionMatcher::decode( const std::string_view& utf8Data ) const
+{
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+    if ( utf8Data.empty() ) {
+        utf16Line_.resize( 0 );
+        return;
+    }
+
+    // UTF-16 never takes more code units than UTF-8,
+    // buffer keeps its capacity between lines
+    utf16Line_.resize( static_cast<int>( utf8Data.size() ) );
+    const auto utf16Length = simdutf::convert_utf8_to_utf16(
+        utf8Data.data(), utf8Data.size(), reinterpret_cast<char16_t*>( utf16Line_.data() ) );
+    if ( utf16Length > 0 ) {
+        utf16Line_.resize( static_cast<int>( utf16Length ) );
+        return;
+    }
+#endif
+
+    // Invalid UTF-8 is decoded with replacement characters
+    utf16Line_ = QString::fromUtf8( utf8Data.data(), static_cast<int>( utf8Data.size() ) );
+}
+
+bool DefaultRegularExpressionMatcher::matchPattern( size_t index,
+                                                    const std::string_view& utf8Data,
+                                                    bool& isDecoded ) const
+{
+    const auto& prefilter = prefilters_[ index ];
+    if ( !prefilter.mayMatch( utf8Data ) ) {
+        return false;
+    }
+
+    // Plain text found by byte search needs no regular expression
+    if ( prefilter.isExact() ) {
+        return true;
+    }
+
+    // Line is decoded once for all patterns and only if some of them may match
+    if ( !isDecoded ) {
+        decode( utf8Data );
+        isDecoded = true;
+    }
+    return regexp_[ index ].match( utf16Line_ ).hasMatch();
+}
+
+MatchedPatterns DefaultRegularExpressionMatcher::match( const std::string_view& utf8Data ) const
+{
+    MatchedPatterns matchedPatterns( regexp_.size(), 0 );
+
+    bool isDecoded = false;
+    for ( auto index = 0u; index < regexp_.size(); ++index ) {
+        matchedPatterns[ index ] = matchPattern( index, utf8Data, isDecoded );
+    }
+
+    return matchedPatterns;
+}
+
+void DefaultRegularExpressionMatcher::confirm( const std::string_view& utf8Data,
+                                               MatchedPatterns& candidates ) const
+{
+    bool isDecoded = false;
+    for ( auto index = 0u; index < regexp_.size() && index < candidates.size(); ++index ) {
+        if ( !candidates[ index ] ) {
+            continue;
+        }
+
+        if ( !isDecoded ) {
+            decode( utf8Data );
+            isDecoded = true;
+        }
+        candidates[ index ] = regexp_[ index ].match( utf16Line_ ).hasMatch();
+    }
+}
+
+bool DefaultRegularExpressionMatcher::matchCombination( const std::string_view& utf8Data,
+                                                        BooleanExpressionEvaluator& evaluator,
+                                                        const MatchedPatterns* candidates ) const
+{
+    const auto isCandidate = [ candidates ]( size_t index ) {
+        return candidates == nullptr || ( index < candidates->size() && ( *candidates )[ index ] );
+    };
+
+    if ( !evaluator.canDecideEarly() ) {
+        auto matchedPatterns = candidates != nullptr ? *candidates : match( utf8Data );
+        if ( candidates != nullptr ) {
+            confirm( utf8Data, matchedPatterns );
+        }
+        return evaluator.evaluate( matchedPatterns );
+    }
+
+    if ( sampledLines_ < CostSampleLines ) {
+        MatchedPatterns matchedPatterns( regexp_.size(), 0 );
+        costs_.resize( regexp_.size() );
+
+        // Decoding is shared by patterns, so it is not a cost of any of them
+        decode( utf8Data );
+        bool isDecoded = true;
+        for ( auto index = 0u; index < regexp_.size(); ++index ) {
+            if ( !isCandidate( index ) ) {
+                continue;
+            }
+            const auto start = std::chrono::steady_clock::now();
+            matchedPatterns[ index ] = matchPattern( index, utf8Data, isDecoded );
+            costs_[ index ].duration += std::chrono::steady_clock::now() - start;
+            costs_[ index ].hits += matchedPatterns[ index ] ? 1 : 0;
+        }
+
+        if ( ++sampledLines_ == CostSampleLines ) {
+            chooseEvaluationOrder( evaluator );
+        }
+        return evaluator.evaluate( matchedPatterns );
+    }
+
+    const auto& order = evaluator.evaluationOrder();
+    bool isDecoded = false;
+    uint32_t matched = 0;
+    for ( auto count = 0u; count < order.size(); ++count ) {
+        if ( const auto outcome = evaluator.decide( count, matched ) ) {
+            return *outcome;
+        }
+
+        const auto index = order[ count ];
+        if ( isCandidate( index ) && matchPattern( index, utf8Data, isDecoded ) ) {
+            matched |= 1u << count;
+        }
+    }
+
+    return evaluator.decide( static_cast<unsigned>( order.size() ), matched ).value_or( false );
+}
+
+void DefaultRegularExpressionMatcher::chooseEvaluationOrder(
+    BooleanExpressionEvaluator& evaluator ) const
+{
+    std::vector<double> costs;
+    std::vector<double> matchRatios;
+    for ( const auto& cost : costs_ ) {
+        costs.push_back( static_cast<double>( cost.duration.count() )
+                         / static_cast<double>( sampledLines_ ) );
+        matchRatios.push_back( static_cast<double>( cost.hits )
+                               / static_cast<double>( sampledLines_ ) );
+    }
+
+    evaluator.setEvaluationOrder( evaluator.chooseEvaluationOrder( costs, matchRatios ) );
+}
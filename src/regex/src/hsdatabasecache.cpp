@@ -0,0 +1,314 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef KLOGG_HAS_HS
+#include "hsdatabasecache.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <numeric>
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QRegularExpression>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#include "configuration.h"
+#include "literalprefilter.h"
+#include "log.h"
+
+namespace {
+constexpr size_t MaxCachedDatabases = 32;
+constexpr int MaxStoredDatabases = 128;
+
+constexpr quint32 DatabaseCacheMagic = 0x4B4C4853; // KLHS
+constexpr quint32 DatabaseCacheVersion = 1;
+
+using UniqueDatabase = UniqueResource<hs_database_t, hs_free_database>;
+
+QString cacheDirectory()
+{
+    return QStandardPaths::writableLocation( QStandardPaths::CacheLocation )
+           + QDir::separator() + "hyperscan";
+}
+
+QString cachePath( const QByteArray& key )
+{
+    return cacheDirectory() + QDir::separator()
+           + QCryptographicHash::hash( key, QCryptographicHash::Sha1 ).toHex() + ".hsdb";
+}
+
+QByteArray databaseKey( const std::vector<RegularExpressionPattern>& patterns, unsigned flags )
+{
+    QByteArray key;
+    QDataStream stream( &key, QIODevice::WriteOnly );
+    stream << flags << static_cast<quint32>( patterns.size() );
+    for ( const auto& pattern : patterns ) {
+        stream << pattern.pattern << pattern.isCaseSensitive << pattern.isPlainText;
+    }
+    return key;
+}
+
+// Literal compiler has no UTF-8 mode, so case insensitive
+// literals must be found by ASCII case folding
+bool isLiteralSet( const std::vector<RegularExpressionPattern>& expressions, unsigned flags )
+{
+    return ( flags & HS_FLAG_PREFILTER ) == 0
+           && std::all_of( expressions.cbegin(), expressions.cend(), []( const auto& expression ) {
+                  const auto utf8Pattern = expression.pattern.toStdString();
+                  return expression.isPlainText && !utf8Pattern.empty()
+                         && LiteralPrefilter( utf8Pattern, true, expression.isCaseSensitive )
+                                .isExact();
+              } );
+}
+
+hs_database_t* compileDatabase( const std::vector<RegularExpressionPattern>& expressions,
+                                unsigned commonFlags, QString& errorMessage )
+{
+    hs_database_t* db = nullptr;
+    hs_compile_error_t* error = nullptr;
+
+    const auto isLiteral = isLiteralSet( expressions, commonFlags );
+    if ( isLiteral ) {
+        commonFlags &= ~( HS_FLAG_UTF8 | HS_FLAG_UCP );
+    }
+
+    std::vector<unsigned> flags( expressions.size() );
+    std::transform( expressions.cbegin(), expressions.cend(), flags.begin(),
+                    [ commonFlags ]( const auto& expression ) {
+                        auto expressionFlags = commonFlags;
+                        if ( !expression.isCaseSensitive ) {
+                            expressionFlags |= HS_FLAG_CASELESS;
+                        }
+                        return expressionFlags;
+                    } );
+
+    std::vector<QByteArray> utf8Patterns( expressions.size() );
+    std::transform( expressions.cbegin(), expressions.cend(), utf8Patterns.begin(),
+                    [ isLiteral ]( const auto& expression ) {
+                        auto p = expression.pattern;
+                        if ( expression.isPlainText && !isLiteral ) {
+                            p = QRegularExpression::escape( expression.pattern );
+                        }
+                        return p.toUtf8();
+                    } );
+
+    std::vector<const char*> patternPointers( utf8Patterns.size() );
+    std::transform( utf8Patterns.cbegin(), utf8Patterns.cend(), patternPointers.begin(),
+                    []( const auto& utf8Pattern ) { return utf8Pattern.data(); } );
+
+    std::vector<unsigned> expressionIds( expressions.size() );
+    std::iota( expressionIds.begin(), expressionIds.end(), 0u );
+
+    // Literals skip regex parsing and are matched by Hyperscan
+    // literal matchers that handle sets of literals together
+    hs_error_t compileResult = HS_SUCCESS;
+    if ( isLiteral ) {
+        std::vector<size_t> lengths( utf8Patterns.size() );
+        std::transform( utf8Patterns.cbegin(), utf8Patterns.cend(), lengths.begin(),
+                        []( const auto& utf8Pattern ) {
+                            return static_cast<size_t>( utf8Pattern.size() );
+                        } );
+
+        compileResult = hs_compile_lit_multi(
+            patternPointers.data(), flags.data(), expressionIds.data(), lengths.data(),
+            static_cast<unsigned>( expressions.size() ), HS_MODE_BLOCK, nullptr, &db, &error );
+    }
+    else {
+        compileResult = hs_compile_multi( patternPointers.data(), flags.data(),
+                                          expressionIds.data(),
+                                          static_cast<unsigned>( expressions.size() ),
+                                          HS_MODE_BLOCK, nullptr, &db, &error );
+    }
+
+    if ( compileResult != HS_SUCCESS ) {
+        LOG_ERROR << "Failed to compile pattern " << error->message;
+        errorMessage = error->message;
+        hs_free_compile_error( error );
+        return nullptr;
+    }
+
+    return db;
+}
+
+// Removes least recently written databases above the limit
+void trimCacheDirectory()
+{
+    const auto cacheFiles = QDir( cacheDirectory() )
+                                .entryInfoList( { "*.hsdb" }, QDir::Files, QDir::Time );
+
+    for ( auto index = MaxStoredDatabases; index < cacheFiles.size(); ++index ) {
+        QFile::remove( cacheFiles[ index ].absoluteFilePath() );
+    }
+}
+} // namespace
+
+// Databases are compiled for the platform of the host, with fat runtime
+// Hyperscan also matches them with code for its instructions
+HsDatabaseCache::HsDatabaseCache()
+{
+    hs_platform_info_t platform{};
+    if ( hs_populate_platform( &platform ) == HS_SUCCESS ) {
+        LOG_INFO << "Hyperscan " << hs_version() << " tuned for " << platform.tune
+                 << ", cpu features " << platform.cpu_features << ", platform "
+                 << ( hs_valid_platform() == HS_SUCCESS ? "supported" : "not supported" );
+    }
+}
+
+HsDatabaseCache& HsDatabaseCache::get()
+{
+    static HsDatabaseCache cache;
+    return cache;
+}
+
+HsDatabase HsDatabaseCache::database( const std::vector<RegularExpressionPattern>& patterns,
+                                      unsigned flags, QString& errorMessage )
+{
+    const auto key = databaseKey( patterns, flags );
+
+    if ( auto database = find( key ) ) {
+        return database;
+    }
+
+    const auto usePersistentCache = Configuration::get().useHyperscanDatabaseCache();
+    if ( usePersistentCache ) {
+        if ( auto database = load( key ) ) {
+            insert( key, database );
+            return database;
+        }
+    }
+
+    // Compiling takes long for big sets of patterns, it is done without lock
+    auto database
+        = HsDatabase{ UniqueDatabase{ compileDatabase( patterns, flags, errorMessage ) } };
+    if ( !database ) {
+        return {};
+    }
+
+    insert( key, database );
+    if ( usePersistentCache ) {
+        save( key, database );
+    }
+
+    return database;
+}
+
+HsDatabase HsDatabaseCache::find( const QByteArray& key )
+{
+    std::lock_guard<std::mutex> lock( mutex_ );
+
+    const auto cached = std::find_if( databases_.begin(), databases_.end(),
+                                      [ &key ]( const auto& entry ) { return entry.first == key; } );
+    if ( cached == databases_.end() ) {
+        return {};
+    }
+
+    databases_.splice( databases_.begin(), databases_, cached );
+    return databases_.front().second;
+}
+
+void HsDatabaseCache::insert( const QByteArray& key, const HsDatabase& database )
+{
+    std::lock_guard<std::mutex> lock( mutex_ );
+
+    const auto cached = std::find_if( databases_.begin(), databases_.end(),
+                                      [ &key ]( const auto& entry ) { return entry.first == key; } );
+    if ( cached != databases_.end() ) {
+        databases_.erase( cached );
+    }
+
+    databases_.emplace_front( key, database );
+    if ( databases_.size() > MaxCachedDatabases ) {
+        databases_.pop_back();
+    }
+}
+
+HsDatabase HsDatabaseCache::load( const QByteArray& key ) const
+{
+    QFile cacheFile( cachePath( key ) );
+    if ( !cacheFile.open( QIODevice::ReadOnly ) ) {
+        return {};
+    }
+
+    QDataStream stream( &cacheFile );
+    stream.setVersion( QDataStream::Qt_5_9 );
+
+    quint32 magic = 0;
+    quint32 version = 0;
+    QByteArray storedKey;
+    QByteArray serializedDatabase;
+    stream >> magic >> version >> storedKey >> serializedDatabase;
+
+    if ( stream.status() != QDataStream::Ok || magic != DatabaseCacheMagic
+         || version != DatabaseCacheVersion || storedKey != key ) {
+        return {};
+    }
+
+    // Fails if database was built by another version of Hyperscan or for another platform
+    hs_database_t* db = nullptr;
+    if ( hs_deserialize_database( serializedDatabase.constData(),
+                                  static_cast<size_t>( serializedDatabase.size() ), &db )
+         != HS_SUCCESS ) {
+        LOG_INFO << "Hyperscan database " << cacheFile.fileName() << " can't be used";
+        return {};
+    }
+
+    LOG_INFO << "Loaded hyperscan database " << cacheFile.fileName();
+    return HsDatabase{ UniqueDatabase{ db } };
+}
+
+void HsDatabaseCache::save( const QByteArray& key, const HsDatabase& database ) const
+{
+    if ( !QDir().mkpath( cacheDirectory() ) ) {
+        LOG_WARNING << "Failed to create hyperscan cache directory " << cacheDirectory();
+        return;
+    }
+
+    char* bytes = nullptr;
+    size_t length = 0;
+    if ( hs_serialize_database( database.get(), &bytes, &length ) != HS_SUCCESS ) {
+        LOG_WARNING << "Failed to serialize hyperscan database";
+        return;
+    }
+
+    const auto serializedDatabase = QByteArray( bytes, static_cast<int>( length ) );
+    std::free( bytes );
+
+    QSaveFile cacheFile( cachePath( key ) );
+    if ( !cacheFile.open( QIODevice::WriteOnly ) ) {
+        LOG_WARNING << "Failed to open hyperscan cache " << cacheFile.fileName();
+        return;
+    }
+
+    QDataStream stream( &cacheFile );
+    stream.setVersion( QDataStream::Qt_5_9 );
+    stream << DatabaseCacheMagic << DatabaseCacheVersion << key << serializedDatabase;
+
+    if ( stream.status() != QDataStream::Ok || !cacheFile.commit() ) {
+        LOG_WARNING << "Failed to save hyperscan cache " << cacheFile.fileName();
+        return;
+    }
+
+    trimCacheDirectory();
+}
+#endif
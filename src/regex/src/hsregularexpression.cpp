@@ -19,7 +19,7 @@
 
 #include <algorithm>
 #include <iterator>
-#include <numeric>
+#include <limits>
 #include <qregularexpression.h>
 #include <string_view>
 #include <vector>
@@ -30,6 +30,7 @@
 #include "hsregularexpression.h"
 
 #include "cpu_info.h"
+#include "hsdatabasecache.h"
 #include "log.h"
 
 namespace {
@@ -62,6 +63,54 @@ int matchMultiCallback( unsigned int id, unsigned long long from, unsigned long
     return 0;
 }
 
+struct HsBlockMatchContext {
+    const std::vector<size_t>& lineEnds;
+    std::vector<uint32_t>& matchingLines;
+    const AtomicFlag* interrupt = nullptr;
+    size_t currentLine = 0;
+};
+
+int matchBlockCallback( unsigned int id, unsigned long long from, unsigned long long to,
+                        unsigned int flags, void* context )
+{
+    Q_UNUSED( id );
+    Q_UNUSED( from );
+    Q_UNUSED( flags );
+
+    auto* matchContext = static_cast<HsBlockMatchContext*>( context );
+
+    // Non zero result stops the scan
+    if ( matchContext->interrupt != nullptr && *matchContext->interrupt ) {
+        return 1;
+    }
+
+    // Matches are reported in order of their end offsets
+    while ( matchContext->currentLine < matchContext->lineEnds.size()
+            && matchContext->lineEnds[ matchContext->currentLine ] < to ) {
+        ++matchContext->currentLine;
+    }
+
+    if ( matchContext->currentLine >= matchContext->lineEnds.size() ) {
+        return 1;
+    }
+
+    const auto line = static_cast<uint32_t>( matchContext->currentLine );
+    if ( matchContext->matchingLines.empty() || matchContext->matchingLines.back() != line ) {
+        matchContext->matchingLines.push_back( line );
+    }
+
+    return 0;
+}
+
+constexpr unsigned LineDatabaseFlags = HS_FLAG_UTF8 | HS_FLAG_UCP | HS_FLAG_SINGLEMATCH;
+constexpr unsigned BlockDatabaseFlags = HS_FLAG_UTF8 | HS_FLAG_UCP;
+
+bool canMatchAsBlock( const std::vector<RegularExpressionPattern>& patterns )
+{
+    return patterns.size() == 1 && patterns.front().isPlainText
+           && !patterns.front().pattern.contains( QChar( '\n' ) );
+}
+
 } // namespace
 
 HsMatcherContext::HsMatcherContext( std::size_t numberOfPatterns )
@@ -82,8 +131,9 @@ HsMatcher::HsMatcher( HsDatabase db, HsScratch scratch, std::size_t numberOfPatt
 {
 }
 
-HsSingleMatcher::HsSingleMatcher( HsDatabase db, HsScratch scratch )
+HsSingleMatcher::HsSingleMatcher( HsDatabase db, HsScratch scratch, HsDatabase blockDatabase )
     : HsMatcher( db, std::move( scratch ), 1 )
+    , blockDatabase_( std::move( blockDatabase ) )
 {
 }
 
@@ -97,6 +147,37 @@ MatchedPatterns HsSingleMatcher::match( const std::string_view& utf8Data ) const
     return std::move( context_.matchingPatterns );
 }
 
+bool HsSingleMatcher::matchBlock( const std::vector<std::string_view>& lines,
+                                  std::vector<uint32_t>& matchingLines,
+                                  const AtomicFlag* interrupt ) const
+{
+    if ( !blockDatabase_ || lines.empty() ) {
+        return false;
+    }
+
+    // Lines must be parts of one buffer separated by single line feeds
+    const auto* blockStart = lines.front().data();
+    std::vector<size_t> lineEnds;
+    lineEnds.reserve( lines.size() );
+    for ( const auto& line : lines ) {
+        const auto lineStart = static_cast<size_t>( line.data() - blockStart );
+        if ( !lineEnds.empty() && lineStart != lineEnds.back() + 1 ) {
+            return false;
+        }
+        lineEnds.push_back( lineStart + line.size() );
+    }
+
+    if ( lineEnds.back() > std::numeric_limits<unsigned int>::max() ) {
+        return false;
+    }
+
+    HsBlockMatchContext context{ lineEnds, matchingLines, interrupt };
+    hs_scan( blockDatabase_.get(), blockStart, static_cast<unsigned int>( lineEnds.back() ), 0,
+             scratch_.get(), matchBlockCallback, static_cast<void*>( &context ) );
+
+    return true;
+}
+
 HsMultiMatcher::HsMultiMatcher( HsDatabase db, HsScratch scratch, std::size_t numberOfPatterns )
     : HsMatcher( db, std::move( scratch ), numberOfPatterns )
 {
@@ -112,6 +193,36 @@ MatchedPatterns HsMultiMatcher::match( const std::string_view& utf8Data ) const
     return std::move( context_.matchingPatterns );
 }
 
+HsPrefilterMatcher::HsPrefilterMatcher( HsDatabase db, HsScratch scratch,
+                                        const std::vector<RegularExpressionPattern>& patterns )
+    : HsMatcher( db, std::move( scratch ), patterns.size() )
+    , confirmationMatcher_( patterns )
+{
+}
+
+MatchedPatterns HsPrefilterMatcher::match( const std::string_view& utf8Data ) const
+{
+    context_.reset();
+
+    hs_scan( database_.get(), utf8Data.data(), static_cast<unsigned int>( utf8Data.size() ), 0,
+             scratch_.get(), matchMultiCallback, static_cast<void*>( &context_ ) );
+
+    confirmationMatcher_.confirm( utf8Data, context_.matchingPatterns );
+    return std::move( context_.matchingPatterns );
+}
+
+bool HsPrefilterMatcher::matchCombination( const std::string_view& utf8Data,
+                                           BooleanExpressionEvaluator& evaluator ) const
+{
+    context_.reset();
+
+    hs_scan( database_.get(), utf8Data.data(), static_cast<unsigned int>( utf8Data.size() ), 0,
+             scratch_.get(), matchMultiCallback, static_cast<void*>( &context_ ) );
+
+    return confirmationMatcher_.matchCombination( utf8Data, evaluator,
+                                                  &context_.matchingPatterns );
+}
+
 MatchedPatterns HsNoopMatcher::match( const std::string_view& ) const
 {
     return {};
@@ -129,55 +240,31 @@ HsRegularExpression::HsRegularExpression( const std::vector<RegularExpressionPat
     requiredInstructuins |= CpuInstructions::SSSE3;
 
     if ( hasRequiredInstructions( supportedCpuInstructions(), requiredInstructuins ) ) {
-        database_ = HsDatabase{ makeUniqueResource<hs_database_t, hs_free_database>(
-            []( const std::vector<RegularExpressionPattern>& expressions,
-                QString& errorMessage ) -> hs_database_t* {
-                hs_database_t* db = nullptr;
-                hs_compile_error_t* error = nullptr;
-
-                std::vector<unsigned> flags( expressions.size() );
-                std::transform( expressions.cbegin(), expressions.cend(), flags.begin(),
-                                []( const auto& expression ) {
-                                    auto expressionFlags
-                                        = HS_FLAG_UTF8 | HS_FLAG_UCP | HS_FLAG_SINGLEMATCH;
-                                    if ( !expression.isCaseSensitive ) {
-                                        expressionFlags |= HS_FLAG_CASELESS;
-                                    }
-                                    return expressionFlags;
-                                } );
-
-                std::vector<QByteArray> utf8Patterns( expressions.size() );
-                std::transform( expressions.cbegin(), expressions.cend(), utf8Patterns.begin(),
-                                []( const auto& expression ) {
-                                    auto p = expression.pattern;
-                                    if ( expression.isPlainText ) {
-                                        p = QRegularExpression::escape( expression.pattern );
-                                    }
-                                    return p.toUtf8();
-                                } );
-
-                std::vector<const char*> patternPointers( utf8Patterns.size() );
-                std::transform( utf8Patterns.cbegin(), utf8Patterns.cend(), patternPointers.begin(),
-                                []( const auto& utf8Pattern ) { return utf8Pattern.data(); } );
-
-                std::vector<unsigned> expressionIds( expressions.size() );
-                std::iota( expressionIds.begin(), expressionIds.end(), 0u );
-
-                const auto compileResult
-                    = hs_compile_multi( patternPointers.data(), flags.data(), expressionIds.data(),
-                                        static_cast<unsigned>( expressions.size() ), HS_MODE_BLOCK,
-                                        nullptr, &db, &error );
-
-                if ( compileResult != HS_SUCCESS ) {
-                    LOG_ERROR << "Failed to compile pattern " << error->message;
-                    errorMessage = error->message;
-                    hs_free_compile_error( error );
-                    return nullptr;
-                }
+        auto& databaseCache = HsDatabaseCache::get();
+        database_ = databaseCache.database( patterns, LineDatabaseFlags, errorMessage_ );
+
+        const auto areQtPatternsValid
+            = std::all_of( patterns.begin(), patterns.end(), []( const auto& pattern ) {
+                  return static_cast<QRegularExpression>( pattern ).isValid();
+              } );
+
+        if ( !database_ && areQtPatternsValid ) {
+            LOG_INFO << "Hyperscan can't match patterns exactly: " << errorMessage_;
+
+            QString prefilterErrorMessage;
+            database_ = databaseCache.database( patterns, LineDatabaseFlags | HS_FLAG_PREFILTER,
+                                                prefilterErrorMessage );
+            isPrefilter_ = database_ != nullptr;
+            if ( isPrefilter_ ) {
+                errorMessage_.clear();
+            }
+        }
 
-                return db;
-            },
-            patterns, errorMessage_ ) };
+        if ( database_ && !isPrefilter_ && canMatchAsBlock( patterns ) ) {
+            QString blockErrorMessage;
+            blockDatabase_
+                = databaseCache.database( patterns, BlockDatabaseFlags, blockErrorMessage );
+        }
     }
     else {
         LOG_WARNING << "Cpu doesn't have sse2 or ssse3, use qt regex engine";
@@ -199,6 +286,16 @@ HsRegularExpression::HsRegularExpression( const std::vector<RegularExpressionPat
             database_.get() );
     }
 
+    if ( scratch_ && blockDatabase_ ) {
+        // Same scratch is used to scan single lines and blocks
+        auto* scratch = scratch_.release();
+        if ( hs_alloc_scratch( blockDatabase_.get(), &scratch ) != HS_SUCCESS ) {
+            LOG_WARNING << "Failed to allocate scratch for block matching";
+            blockDatabase_.reset();
+        }
+        scratch_.reset( scratch );
+    }
+
     if ( !isHsValid() ) {
         for ( const auto& pattern : patterns_ ) {
             const auto regex = static_cast<QRegularExpression>( pattern );
@@ -211,7 +308,7 @@ HsRegularExpression::HsRegularExpression( const std::vector<RegularExpressionPat
     }
 
     LOG_INFO << "Finished creating pattern database, patterns: " << patterns_.size()
-             << ", is db valid: " << isValid_;
+             << ", is db valid: " << isValid_ << ", prefilter: " << isPrefilter_;
 }
 
 bool HsRegularExpression::isValid() const
@@ -252,8 +349,11 @@ MatcherVariant HsRegularExpression::createMatcher() const
     if ( !database_ || !scratch_ ) {
         return HsNoopMatcher();
     }
+    else if ( isPrefilter_ ) {
+        return HsPrefilterMatcher{ database_, std::move( matcherScratch ), patterns_ };
+    }
     else if ( patterns_.size() == 1 ) {
-        return HsSingleMatcher{ database_, std::move( matcherScratch ) };
+        return HsSingleMatcher{ database_, std::move( matcherScratch ), blockDatabase_ };
     }
     else {
         return HsMultiMatcher{ database_, std::move( matcherScratch ), patterns_.size() };
@@ -0,0 +1,203 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "hsspanmatcher.h"
+
+#include <algorithm>
+
+#ifdef KLOGG_HAS_HS
+#include <limits>
+#include <tuple>
+
+#include <QByteArray>
+#include <QRegularExpression>
+
+#include "cpu_info.h"
+#include "log.h"
+
+namespace {
+
+constexpr unsigned SpanDatabaseFlags = HS_FLAG_UTF8 | HS_FLAG_UCP | HS_FLAG_SOM_LEFTMOST;
+
+int matchSpanCallback( unsigned int id, unsigned long long from, unsigned long long to,
+                       unsigned int flags, void* context )
+{
+    Q_UNUSED( flags );
+
+    auto* spans = static_cast<std::vector<MatchedSpan>*>( context );
+    spans->push_back(
+        MatchedSpan{ id, static_cast<std::size_t>( from ), static_cast<std::size_t>( to ) } );
+
+    return 0;
+}
+
+// Returns index of the pattern that failed to compile or -1 if all of them failed
+int compileDatabase( const std::vector<RegularExpressionPattern>& patterns,
+                     const std::vector<unsigned>& ids, hs_database_t** database )
+{
+    std::vector<unsigned> flags( patterns.size() );
+    std::transform( patterns.cbegin(), patterns.cend(), flags.begin(),
+                    []( const auto& pattern ) {
+                        return pattern.isCaseSensitive ? SpanDatabaseFlags
+                                                       : SpanDatabaseFlags | HS_FLAG_CASELESS;
+                    } );
+
+    std::vector<QByteArray> utf8Patterns( patterns.size() );
+    std::transform( patterns.cbegin(), patterns.cend(), utf8Patterns.begin(),
+                    []( const auto& pattern ) {
+                        return pattern.isPlainText
+                                   ? QRegularExpression::escape( pattern.pattern ).toUtf8()
+                                   : pattern.pattern.toUtf8();
+                    } );
+
+    std::vector<const char*> patternPointers( utf8Patterns.size() );
+    std::transform( utf8Patterns.cbegin(), utf8Patterns.cend(), patternPointers.begin(),
+                    []( const auto& utf8Pattern ) { return utf8Pattern.data(); } );
+
+    hs_compile_error_t* error = nullptr;
+    const auto compileResult = hs_compile_multi(
+        patternPointers.data(), flags.data(), ids.data(), static_cast<unsigned>( patterns.size() ),
+        HS_MODE_BLOCK, nullptr, database, &error );
+
+    if ( compileResult == HS_SUCCESS ) {
+        return 0;
+    }
+
+    LOG_INFO << "Pattern will be matched by Qt regex engine: " << error->message;
+    const auto failedPattern = error->expression;
+    hs_free_compile_error( error );
+
+    return failedPattern;
+}
+
+} // namespace
+
+HsSpanMatcher::HsSpanMatcher( const std::vector<RegularExpressionPattern>& patterns,
+                              const std::vector<unsigned>& ids )
+{
+    auto requiredInstructions = CpuInstructions::SSE2;
+    requiredInstructions |= CpuInstructions::SSSE3;
+
+    if ( !hasRequiredInstructions( supportedCpuInstructions(), requiredInstructions ) ) {
+        return;
+    }
+
+    auto candidatePatterns = patterns;
+    auto candidateIds = ids;
+
+    // Error tells only about the first rejected pattern,
+    // so the rest are compiled again without it
+    hs_database_t* database = nullptr;
+    while ( !candidatePatterns.empty() ) {
+        const auto failedPattern = compileDatabase( candidatePatterns, candidateIds, &database );
+        if ( database ) {
+            break;
+        }
+
+        if ( failedPattern < 0
+             || static_cast<std::size_t>( failedPattern ) >= candidatePatterns.size() ) {
+            return;
+        }
+
+        candidatePatterns.erase( candidatePatterns.begin() + failedPattern );
+        candidateIds.erase( candidateIds.begin() + failedPattern );
+    }
+
+    if ( !database ) {
+        return;
+    }
+
+    database_ = SharedResource<hs_database_t>( database, hs_free_database );
+
+    scratch_ = makeUniqueResource<hs_scratch_t, hs_free_scratch>(
+        []( hs_database_t* db ) -> hs_scratch_t* {
+            hs_scratch_t* scratch = nullptr;
+            if ( hs_alloc_scratch( db, &scratch ) != HS_SUCCESS ) {
+                LOG_ERROR << "Failed to allocate scratch";
+                return nullptr;
+            }
+            return scratch;
+        },
+        database_.get() );
+
+    if ( !scratch_ ) {
+        database_.reset();
+        return;
+    }
+
+    supportedIds_ = std::move( candidateIds );
+    std::sort( supportedIds_.begin(), supportedIds_.end() );
+
+    LOG_INFO << "Compiled span database, patterns: " << supportedIds_.size() << " of "
+             << patterns.size();
+}
+
+bool HsSpanMatcher::isSupported( unsigned id ) const
+{
+    return std::binary_search( supportedIds_.begin(), supportedIds_.end(), id );
+}
+
+std::vector<MatchedSpan> HsSpanMatcher::match( std::string_view utf8Line ) const
+{
+    std::vector<MatchedSpan> spans;
+    if ( !database_ || utf8Line.size() > std::numeric_limits<unsigned int>::max() ) {
+        return spans;
+    }
+
+    hs_scan( database_.get(), utf8Line.data(), static_cast<unsigned int>( utf8Line.size() ), 0,
+             scratch_.get(), matchSpanCallback, static_cast<void*>( &spans ) );
+
+    std::sort( spans.begin(), spans.end(), []( const auto& lhs, const auto& rhs ) {
+        return std::tie( lhs.id, lhs.start, lhs.end ) < std::tie( rhs.id, rhs.start, rhs.end );
+    } );
+
+    // Leftmost start is reported for each end of match,
+    // so one match of the pattern comes as several overlapping spans
+    std::vector<MatchedSpan> mergedSpans;
+    for ( const auto& span : spans ) {
+        if ( !mergedSpans.empty() && mergedSpans.back().id == span.id
+             && span.start < mergedSpans.back().end ) {
+            mergedSpans.back().end = std::max( mergedSpans.back().end, span.end );
+        }
+        else {
+            mergedSpans.push_back( span );
+        }
+    }
+
+    return mergedSpans;
+}
+
+#else
+
+HsSpanMatcher::HsSpanMatcher( const std::vector<RegularExpressionPattern>&,
+                              const std::vector<unsigned>& )
+{
+}
+
+bool HsSpanMatcher::isSupported( unsigned ) const
+{
+    return false;
+}
+
+std::vector<MatchedSpan> HsSpanMatcher::match( std::string_view ) const
+{
+    return {};
+}
+
+#endif
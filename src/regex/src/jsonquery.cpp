@@ -0,0 +1,523 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "jsonquery.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <stdexcept>
+
+#include <simdjson.h>
+
+namespace {
+bool isIdentifierChar( char c )
+{
+    return std::isalnum( static_cast<unsigned char>( c ) ) || c == '_' || c == '-'
+           || static_cast<unsigned char>( c ) >= 0x80;
+}
+
+// Keys and strings that can't be escaped differently in the line
+bool isPlainLiteral( std::string_view text )
+{
+    return !text.empty() && std::all_of( text.begin(), text.end(), []( char c ) {
+        const auto byte = static_cast<unsigned char>( c );
+        return byte >= 0x20 && byte < 0x80 && c != '"' && c != '\\' && c != '/';
+    } );
+}
+
+char foldCase( char c )
+{
+    return ( c >= 'A' && c <= 'Z' ) ? static_cast<char>( c + ( 'a' - 'A' ) ) : c;
+}
+
+bool isEqualFolded( std::string_view lhs, std::string_view rhs )
+{
+    return lhs.size() == rhs.size()
+           && std::equal( lhs.begin(), lhs.end(), rhs.begin(),
+                          []( char l, char r ) { return foldCase( l ) == foldCase( r ); } );
+}
+} // namespace
+
+class JsonQuery::Parser {
+  public:
+    Parser( std::string_view text, JsonQuery& query )
+        : text_( text )
+        , query_( query )
+    {
+    }
+
+    void parse()
+    {
+        query_.nodes_.emplace_back();
+        parseOr( 0 );
+        skipSpaces();
+        if ( pos_ != text_.size() ) {
+            fail( "Unexpected text" );
+        }
+    }
+
+  private:
+    [[noreturn]] void fail( const char* message ) const
+    {
+        throw std::runtime_error( std::string( message ) + " at position "
+                                  + std::to_string( pos_ + 1 ) + " of JSON query" );
+    }
+
+    void skipSpaces()
+    {
+        while ( pos_ < text_.size() && std::isspace( static_cast<unsigned char>( text_[ pos_ ] ) ) ) {
+            ++pos_;
+        }
+    }
+
+    bool accept( std::string_view token )
+    {
+        skipSpaces();
+        if ( text_.substr( pos_, token.size() ) != token ) {
+            return false;
+        }
+
+        // Word operators are not prefixes of other words
+        const auto end = pos_ + token.size();
+        if ( std::isalpha( static_cast<unsigned char>( token.back() ) ) && end < text_.size()
+             && isIdentifierChar( text_[ end ] ) ) {
+            return false;
+        }
+
+        pos_ = end;
+        return true;
+    }
+
+    size_t addNode()
+    {
+        query_.nodes_.emplace_back();
+        return query_.nodes_.size() - 1;
+    }
+
+    // Parsed node is stored at index, children are added after it
+    void parseOr( size_t index )
+    {
+        parseAnd( index );
+        while ( accept( "||" ) || accept( "or" ) ) {
+            combine( index, Operator::Or, &Parser::parseAnd );
+        }
+    }
+
+    void parseAnd( size_t index )
+    {
+        parseUnary( index );
+        while ( accept( "&&" ) || accept( "and" ) ) {
+            combine( index, Operator::And, &Parser::parseUnary );
+        }
+    }
+
+    void combine( size_t index, Operator op, void ( Parser::*parseRight )( size_t ) )
+    {
+        const auto left = addNode();
+        query_.nodes_[ left ] = std::move( query_.nodes_[ index ] );
+        const auto right = addNode();
+        ( this->*parseRight )( right );
+
+        auto& node = query_.nodes_[ index ];
+        node = Node{};
+        node.op = op;
+        node.left = left;
+        node.right = right;
+    }
+
+    void parseUnary( size_t index )
+    {
+        if ( accept( "!" ) || accept( "not" ) ) {
+            const auto operand = addNode();
+            parseUnary( operand );
+            auto& node = query_.nodes_[ index ];
+            node.op = Operator::Not;
+            node.left = operand;
+        }
+        else if ( accept( "(" ) ) {
+            parseOr( index );
+            if ( !accept( ")" ) ) {
+                fail( "Missing )" );
+            }
+        }
+        else {
+            parseCondition( index );
+        }
+    }
+
+    void parseCondition( size_t index )
+    {
+        const auto field = parseField();
+
+        auto op = Operator::IsTrue;
+        if ( accept( "==" ) ) {
+            op = Operator::Equal;
+        }
+        else if ( accept( "!=" ) ) {
+            op = Operator::NotEqual;
+        }
+        else if ( accept( "<=" ) ) {
+            op = Operator::LessEqual;
+        }
+        else if ( accept( ">=" ) ) {
+            op = Operator::GreaterEqual;
+        }
+        else if ( accept( "<" ) ) {
+            op = Operator::Less;
+        }
+        else if ( accept( ">" ) ) {
+            op = Operator::Greater;
+        }
+
+        auto& node = query_.nodes_[ index ];
+        node.op = op;
+        node.field = field;
+        if ( op != Operator::IsTrue ) {
+            parseLiteral( node );
+        }
+    }
+
+    // Returns index of the field pointer
+    size_t parseField()
+    {
+        skipSpaces();
+        if ( pos_ == text_.size() || text_[ pos_ ] != '.' ) {
+            fail( "Expected field" );
+        }
+
+        std::string pointer;
+        lastKey_.clear();
+        while ( pos_ < text_.size() && ( text_[ pos_ ] == '.' || text_[ pos_ ] == '[' ) ) {
+            std::string key;
+            if ( text_[ pos_ ] == '[' ) {
+                const auto end = text_.find( ']', pos_ );
+                if ( end == std::string_view::npos ) {
+                    fail( "Missing ]" );
+                }
+                key = std::string( text_.substr( pos_ + 1, end - pos_ - 1 ) );
+                if ( key.empty() || !std::all_of( key.begin(), key.end(), []( char c ) {
+                         return std::isdigit( static_cast<unsigned char>( c ) );
+                     } ) ) {
+                    fail( "Expected array index" );
+                }
+                pos_ = end + 1;
+            }
+            else {
+                ++pos_;
+                if ( pos_ < text_.size() && text_[ pos_ ] == '"' ) {
+                    key = parseString();
+                }
+                else {
+                    const auto start = pos_;
+                    while ( pos_ < text_.size() && isIdentifierChar( text_[ pos_ ] ) ) {
+                        ++pos_;
+                    }
+                    key = std::string( text_.substr( start, pos_ - start ) );
+                }
+                if ( key.empty() ) {
+                    fail( "Expected field name" );
+                }
+                lastKey_ = key;
+            }
+
+            pointer.push_back( '/' );
+            for ( const auto c : key ) {
+                if ( c == '~' ) {
+                    pointer.append( "~0" );
+                }
+                else if ( c == '/' ) {
+                    pointer.append( "~1" );
+                }
+                else {
+                    pointer.push_back( c );
+                }
+            }
+        }
+
+        auto& pointers = query_.pointers_;
+        const auto existing = std::find( pointers.begin(), pointers.end(), pointer );
+        if ( existing != pointers.end() ) {
+            return static_cast<size_t>( std::distance( pointers.begin(), existing ) );
+        }
+        pointers.push_back( pointer );
+        query_.keys_.push_back( lastKey_ );
+        return pointers.size() - 1;
+    }
+
+    std::string parseString()
+    {
+        // Opening quote
+        ++pos_;
+
+        std::string text;
+        while ( pos_ < text_.size() && text_[ pos_ ] != '"' ) {
+            if ( text_[ pos_ ] == '\\' && pos_ + 1 < text_.size() ) {
+                ++pos_;
+            }
+            text.push_back( text_[ pos_++ ] );
+        }
+        if ( pos_ == text_.size() ) {
+            fail( "Unmatched quote" );
+        }
+        ++pos_;
+        return text;
+    }
+
+    void parseLiteral( Node& node )
+    {
+        skipSpaces();
+        if ( pos_ < text_.size() && text_[ pos_ ] == '"' ) {
+            node.literalType = JsonValue::Type::String;
+            node.string = parseString();
+        }
+        else if ( accept( "true" ) ) {
+            node.literalType = JsonValue::Type::Bool;
+            node.boolean = true;
+        }
+        else if ( accept( "false" ) ) {
+            node.literalType = JsonValue::Type::Bool;
+            node.boolean = false;
+        }
+        else if ( accept( "null" ) ) {
+            node.literalType = JsonValue::Type::Null;
+        }
+        else {
+            const auto number = std::string( text_.substr( pos_ ) );
+            char* end = nullptr;
+            node.number = std::strtod( number.c_str(), &end );
+            if ( end == number.c_str() ) {
+                fail( "Expected value" );
+            }
+            node.literalType = JsonValue::Type::Number;
+            pos_ += static_cast<size_t>( end - number.c_str() );
+        }
+    }
+
+  private:
+    std::string_view text_;
+    JsonQuery& query_;
+    size_t pos_ = 0;
+    std::string lastKey_;
+};
+
+bool JsonQuery::isJsonQuery( std::string_view text )
+{
+    const auto start = text.find_first_not_of( " \t(!" );
+    return start != std::string_view::npos && text[ start ] == '.' && start + 1 < text.size()
+           && ( isIdentifierChar( text[ start + 1 ] ) || text[ start + 1 ] == '"' );
+}
+
+JsonQuery::JsonQuery( std::string_view text, bool isCaseSensitive )
+    : isCaseSensitive_( isCaseSensitive )
+{
+    Parser parser( text, *this );
+    parser.parse();
+    addPrefilters( 0 );
+}
+
+void JsonQuery::addPrefilters( size_t index )
+{
+    const auto& node = nodes_[ index ];
+    switch ( node.op ) {
+    case Operator::And:
+        addPrefilters( node.left );
+        addPrefilters( node.right );
+        return;
+    case Operator::Or:
+    case Operator::Not:
+    case Operator::NotEqual:
+        return;
+    case Operator::Equal:
+        // Missing field is equal to null
+        if ( node.literalType == JsonValue::Type::Null ) {
+            return;
+        }
+        if ( node.literalType == JsonValue::Type::String && isPlainLiteral( node.string ) ) {
+            prefilters_.emplace_back( "\"" + node.string + "\"", true, isCaseSensitive_ );
+        }
+        break;
+    default:
+        break;
+    }
+
+    const auto& key = keys_[ node.field ];
+    if ( isPlainLiteral( key ) ) {
+        prefilters_.emplace_back( "\"" + key + "\"", true, true );
+    }
+}
+
+bool JsonQuery::isEqual( const Node& node, const JsonValue& value ) const
+{
+    const auto type = value.type == JsonValue::Type::Missing ? JsonValue::Type::Null : value.type;
+    if ( type != node.literalType ) {
+        return false;
+    }
+
+    switch ( type ) {
+    case JsonValue::Type::Null:
+        return true;
+    case JsonValue::Type::Bool:
+        return value.boolean == node.boolean;
+    case JsonValue::Type::Number:
+        return value.number == node.number;
+    case JsonValue::Type::String:
+        return isCaseSensitive_ ? value.string == node.string
+                                : isEqualFolded( value.string, node.string );
+    default:
+        return false;
+    }
+}
+
+bool JsonQuery::compare( const Node& node, const JsonValue& value ) const
+{
+    switch ( node.op ) {
+    case Operator::IsTrue:
+        return value.type != JsonValue::Type::Missing && value.type != JsonValue::Type::Null
+               && ( value.type != JsonValue::Type::Bool || value.boolean );
+    case Operator::Equal:
+        return isEqual( node, value );
+    case Operator::NotEqual:
+        return !isEqual( node, value );
+    default:
+        break;
+    }
+
+    int order = 0;
+    if ( value.type == JsonValue::Type::Number && node.literalType == JsonValue::Type::Number ) {
+        order = value.number < node.number ? -1 : ( value.number > node.number ? 1 : 0 );
+    }
+    else if ( value.type == JsonValue::Type::String
+              && node.literalType == JsonValue::Type::String ) {
+        order = value.string.compare( node.string );
+    }
+    else {
+        return false;
+    }
+
+    switch ( node.op ) {
+    case Operator::Less:
+        return order < 0;
+    case Operator::LessEqual:
+        return order <= 0;
+    case Operator::Greater:
+        return order > 0;
+    case Operator::GreaterEqual:
+        return order >= 0;
+    default:
+        return false;
+    }
+}
+
+struct JsonQueryMatcher::Parser {
+    simdjson::ondemand::parser parser;
+    // Line copy with padding simdjson reads past the end of text
+    std::string paddedLine;
+};
+
+JsonQueryMatcher::JsonQueryMatcher( std::shared_ptr<const JsonQuery> query )
+    : query_( std::move( query ) )
+    , parser_( std::make_unique<Parser>() )
+{
+}
+
+JsonQueryMatcher::~JsonQueryMatcher() = default;
+
+JsonQueryMatcher::JsonQueryMatcher( JsonQueryMatcher&& other ) noexcept = default;
+JsonQueryMatcher& JsonQueryMatcher::operator=( JsonQueryMatcher&& other ) noexcept = default;
+
+std::string JsonQueryMatcher::match( const std::string_view& utf8Data ) const
+{
+    return std::string( 1, hasMatch( utf8Data ) ? 1 : 0 );
+}
+
+bool JsonQueryMatcher::hasMatch( std::string_view line ) const
+{
+    const auto& prefilters = query_->prefilters();
+    const auto mayMatch
+        = std::all_of( prefilters.begin(), prefilters.end(),
+                       [ line ]( const LiteralPrefilter& prefilter ) {
+                           return prefilter.mayMatch( line );
+                       } );
+    const auto objectStart = line.find_first_not_of( " \t\r" );
+    if ( !mayMatch || objectStart == std::string_view::npos || line[ objectStart ] != '{' ) {
+        return false;
+    }
+
+    auto& paddedLine = parser_->paddedLine;
+    paddedLine.assign( line.data(), line.size() );
+    paddedLine.resize( line.size() + simdjson::SIMDJSON_PADDING );
+
+    simdjson::ondemand::document document;
+    if ( parser_->parser.iterate( paddedLine.data(), line.size(), paddedLine.size() )
+             .get( document )
+         != simdjson::SUCCESS ) {
+        return false;
+    }
+
+    const auto& pointers = query_->fieldPointers();
+    auto isValidLine = true;
+    const auto isMatched = query_->evaluate( [ & ]( size_t field ) {
+        JsonValue value;
+        simdjson::ondemand::value fieldValue;
+        const auto error = document.at_pointer( pointers[ field ] ).get( fieldValue );
+        if ( error == simdjson::NO_SUCH_FIELD || error == simdjson::INDEX_OUT_OF_BOUNDS
+             || error == simdjson::INCORRECT_TYPE ) {
+            return value;
+        }
+        if ( error != simdjson::SUCCESS ) {
+            isValidLine = false;
+            return value;
+        }
+
+        simdjson::ondemand::json_type type;
+        if ( fieldValue.type().get( type ) != simdjson::SUCCESS ) {
+            isValidLine = false;
+            return value;
+        }
+
+        switch ( type ) {
+        case simdjson::ondemand::json_type::null:
+            value.type = JsonValue::Type::Null;
+            break;
+        case simdjson::ondemand::json_type::boolean:
+            value.type = fieldValue.get_bool().get( value.boolean ) == simdjson::SUCCESS
+                             ? JsonValue::Type::Bool
+                             : JsonValue::Type::Other;
+            break;
+        case simdjson::ondemand::json_type::number:
+            value.type = fieldValue.get_double().get( value.number ) == simdjson::SUCCESS
+                             ? JsonValue::Type::Number
+                             : JsonValue::Type::Other;
+            break;
+        case simdjson::ondemand::json_type::string:
+            value.type = fieldValue.get_string().get( value.string ) == simdjson::SUCCESS
+                             ? JsonValue::Type::String
+                             : JsonValue::Type::Other;
+            break;
+        default:
+            value.type = JsonValue::Type::Other;
+            break;
+        }
+        return value;
+    } );
+
+    return isMatched && isValidLine;
+}
@@ -0,0 +1,384 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "literalprefilter.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+#define KLOGG_LITERAL_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+bool isAsciiAlnum( char c )
+{
+    return ( c >= '0' && c <= '9' ) || ( c >= 'a' && c <= 'z' ) || ( c >= 'A' && c <= 'Z' );
+}
+
+char foldAscii( char c )
+{
+    return ( c >= 'A' && c <= 'Z' ) ? static_cast<char>( c + ( 'a' - 'A' ) ) : c;
+}
+
+// Removes last UTF-8 encoded character
+void popLastCharacter( std::string& text )
+{
+    while ( !text.empty() && ( static_cast<uint8_t>( text.back() ) & 0xC0 ) == 0x80 ) {
+        text.pop_back();
+    }
+    if ( !text.empty() ) {
+        text.pop_back();
+    }
+}
+
+// Returns position after {n}, {n,} or {n,m} starting at pos
+std::optional<size_t> skipCountedQuantifier( std::string_view regex, size_t pos )
+{
+    auto end = pos + 1;
+    const auto skipDigits = [ &regex, &end ]() {
+        const auto start = end;
+        while ( end < regex.size() && regex[ end ] >= '0' && regex[ end ] <= '9' ) {
+            ++end;
+        }
+        return end > start;
+    };
+
+    if ( !skipDigits() ) {
+        return {};
+    }
+    if ( end < regex.size() && regex[ end ] == ',' ) {
+        ++end;
+        skipDigits();
+    }
+    if ( end < regex.size() && regex[ end ] == '}' ) {
+        return end + 1;
+    }
+    return {};
+}
+
+// Returns position after bracket expression starting at pos
+std::optional<size_t> skipCharacterClass( std::string_view regex, size_t pos )
+{
+    ++pos;
+    if ( pos < regex.size() && regex[ pos ] == '^' ) {
+        ++pos;
+    }
+    if ( pos < regex.size() && regex[ pos ] == ']' ) {
+        ++pos;
+    }
+
+    while ( pos < regex.size() ) {
+        const auto c = regex[ pos ];
+        if ( c == '\\' ) {
+            pos += 2;
+        }
+        else if ( c == '[' && pos + 1 < regex.size() && regex[ pos + 1 ] == ':' ) {
+            const auto classEnd = regex.find( ":]", pos + 2 );
+            if ( classEnd == std::string_view::npos ) {
+                return {};
+            }
+            pos = classEnd + 2;
+        }
+        else if ( c == ']' ) {
+            return pos + 1;
+        }
+        else {
+            ++pos;
+        }
+    }
+
+    return {};
+}
+
+// Returns position after group starting at pos, empty if
+// the group can change options that apply to the rest of pattern
+std::optional<size_t> skipGroup( std::string_view regex, size_t pos )
+{
+    static constexpr std::string_view OptionCharacters = "imsxnJU^-#";
+
+    int depth = 0;
+    while ( pos < regex.size() ) {
+        const auto c = regex[ pos ];
+        if ( c == '\\' ) {
+            pos += 2;
+        }
+        else if ( c == '[' ) {
+            const auto classEnd = skipCharacterClass( regex, pos );
+            if ( !classEnd ) {
+                return {};
+            }
+            pos = *classEnd;
+        }
+        else if ( c == '(' ) {
+            if ( pos + 2 < regex.size() && regex[ pos + 1 ] == '?'
+                 && OptionCharacters.find( regex[ pos + 2 ] ) != std::string_view::npos ) {
+                return {};
+            }
+            ++depth;
+            ++pos;
+        }
+        else if ( c == ')' ) {
+            ++pos;
+            if ( --depth == 0 ) {
+                return pos;
+            }
+        }
+        else {
+            ++pos;
+        }
+    }
+
+    return {};
+}
+
+size_t findFoldedScalar( std::string_view text, std::string_view literal )
+{
+    const auto found = std::search( text.begin(), text.end(), literal.begin(), literal.end(),
+                                    []( char lineChar, char literalChar ) {
+                                        return foldAscii( lineChar ) == literalChar;
+                                    } );
+    return found == text.end() ? std::string_view::npos
+                               : static_cast<size_t>( found - text.begin() );
+}
+
+#ifdef KLOGG_LITERAL_SSE2
+bool equalsFolded( const char* text, std::string_view literal )
+{
+    return std::equal( literal.begin(), literal.end(), text, []( char literalChar, char c ) {
+        return foldAscii( c ) == literalChar;
+    } );
+}
+
+int countTrailingZeros( uint32_t mask )
+{
+#if defined( _MSC_VER ) && !defined( __clang__ )
+    unsigned long index = 0;
+    _BitScanForward( &index, mask );
+    return static_cast<int>( index );
+#else
+    return __builtin_ctz( mask );
+#endif
+}
+
+// Folding letters is OR with 0x20, other bytes are compared as is
+__m128i foldMask( char literalChar )
+{
+    return _mm_set1_epi8( literalChar >= 'a' && literalChar <= 'z' ? 0x20 : 0 );
+}
+
+// Compares first and last bytes of literal with 16 positions at once,
+// only positions where both are equal are compared completely
+size_t findSse2( std::string_view text, std::string_view literal, bool isCaseSensitive )
+{
+    const auto lastOffset = literal.size() - 1;
+
+    const auto first = _mm_set1_epi8( literal.front() );
+    const auto last = _mm_set1_epi8( literal.back() );
+    const auto firstFold = isCaseSensitive ? _mm_setzero_si128() : foldMask( literal.front() );
+    const auto lastFold = isCaseSensitive ? _mm_setzero_si128() : foldMask( literal.back() );
+
+    size_t pos = 0;
+    for ( ; pos + lastOffset + 16 <= text.size(); pos += 16 ) {
+        const auto firstBytes
+            = _mm_loadu_si128( reinterpret_cast<const __m128i*>( text.data() + pos ) );
+        const auto lastBytes = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>( text.data() + pos + lastOffset ) );
+
+        auto candidates = static_cast<uint32_t>( _mm_movemask_epi8(
+            _mm_and_si128( _mm_cmpeq_epi8( _mm_or_si128( firstBytes, firstFold ), first ),
+                           _mm_cmpeq_epi8( _mm_or_si128( lastBytes, lastFold ), last ) ) ) );
+
+        while ( candidates != 0 ) {
+            const auto candidate = pos + static_cast<size_t>( countTrailingZeros( candidates ) );
+            const auto isEqual
+                = isCaseSensitive
+                      ? text.compare( candidate, literal.size(), literal ) == 0
+                      : equalsFolded( text.data() + candidate, literal );
+            if ( isEqual ) {
+                return candidate;
+            }
+            candidates &= candidates - 1;
+        }
+    }
+
+    const auto tail = text.substr( pos );
+    const auto found
+        = isCaseSensitive ? tail.find( literal ) : findFoldedScalar( tail, literal );
+    return found == std::string_view::npos ? found : pos + found;
+}
+#endif
+
+// Returns position of literal in text, it is ASCII case folded
+// if search is case insensitive
+size_t findLiteral( std::string_view text, std::string_view literal, bool isCaseSensitive )
+{
+#ifdef KLOGG_LITERAL_SSE2
+    return findSse2( text, literal, isCaseSensitive );
+#else
+    return isCaseSensitive ? text.find( literal ) : findFoldedScalar( text, literal );
+#endif
+}
+
+// Longest part of literal that can be found by ASCII case folding
+std::string caseFoldedLiteral( std::string_view literal )
+{
+    std::string longestPart;
+    std::string part;
+    for ( const auto c : literal ) {
+        // Unicode case folding maps Kelvin sign and long s to 'k' and 's'
+        const auto folded = foldAscii( c );
+        if ( static_cast<uint8_t>( c ) >= 0x80 || folded == 'k' || folded == 's' ) {
+            part.clear();
+            continue;
+        }
+
+        part.push_back( folded );
+        if ( part.size() > longestPart.size() ) {
+            longestPart = part;
+        }
+    }
+    return longestPart;
+}
+
+} // namespace
+
+std::string LiteralPrefilter::requiredLiteral( std::string_view utf8Regex )
+{
+    std::string longestLiteral;
+    std::string literal;
+
+    const auto finishLiteral = [ &longestLiteral, &literal ]() {
+        if ( literal.size() > longestLiteral.size() ) {
+            longestLiteral = literal;
+        }
+        literal.clear();
+    };
+
+    size_t pos = 0;
+    while ( pos < utf8Regex.size() ) {
+        const auto c = utf8Regex[ pos ];
+        switch ( c ) {
+        case '\\': {
+            if ( pos + 1 >= utf8Regex.size() ) {
+                return {};
+            }
+
+            const auto escaped = utf8Regex[ pos + 1 ];
+            if ( escaped == 'Q' || escaped == 'E' ) {
+                return {};
+            }
+
+            // Arguments of escapes like \x41, \k<name> or \012 are not parsed
+            if ( ( escaped >= '0' && escaped <= '9' )
+                 || std::string_view( "xocgkpPN" ).find( escaped ) != std::string_view::npos ) {
+                return {};
+            }
+
+            // Character types and assertions
+            if ( isAsciiAlnum( escaped ) ) {
+                finishLiteral();
+            }
+            else {
+                literal.push_back( escaped );
+            }
+            pos += 2;
+            break;
+        }
+        case '[': {
+            finishLiteral();
+            const auto classEnd = skipCharacterClass( utf8Regex, pos );
+            if ( !classEnd ) {
+                return {};
+            }
+            pos = *classEnd;
+            break;
+        }
+        case '(': {
+            finishLiteral();
+            const auto groupEnd = skipGroup( utf8Regex, pos );
+            if ( !groupEnd ) {
+                return {};
+            }
+            pos = *groupEnd;
+            break;
+        }
+        case '|':
+        case ')':
+            return {};
+        case '.':
+        case '^':
+        case '$':
+        case '+':
+            finishLiteral();
+            ++pos;
+            break;
+        case '*':
+        case '?':
+            // Previous character can be absent
+            popLastCharacter( literal );
+            finishLiteral();
+            ++pos;
+            break;
+        case '{': {
+            const auto quantifierEnd = skipCountedQuantifier( utf8Regex, pos );
+            if ( quantifierEnd ) {
+                popLastCharacter( literal );
+                pos = *quantifierEnd;
+            }
+            else {
+                ++pos;
+            }
+            finishLiteral();
+            break;
+        }
+        default:
+            literal.push_back( c );
+            ++pos;
+            break;
+        }
+    }
+
+    finishLiteral();
+    return longestLiteral;
+}
+
+LiteralPrefilter::LiteralPrefilter( std::string_view utf8Pattern, bool isPlainText,
+                                    bool isCaseSensitive )
+    : literal_( isPlainText ? std::string( utf8Pattern ) : requiredLiteral( utf8Pattern ) )
+    , isCaseSensitive_( isCaseSensitive )
+{
+    if ( !isCaseSensitive_ ) {
+        literal_ = caseFoldedLiteral( literal_ );
+    }
+
+    isExact_ = isPlainText && literal_.size() == utf8Pattern.size();
+}
+
+bool LiteralPrefilter::mayMatch( std::string_view utf8Line ) const
+{
+    if ( literal_.empty() ) {
+        return true;
+    }
+
+    return findLiteral( utf8Line, literal_, isCaseSensitive_ ) != std::string_view::npos;
+}
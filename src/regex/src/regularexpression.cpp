@@ -17,10 +17,12 @@
  * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <cstddef>
 #include <exception>
 #include <memory>
 #include <qregularexpression.h>
 #include <string>
+#include <type_traits>
 #include <variant>
 
 #include "configuration.h"
@@ -111,6 +113,16 @@ RegularExpression::RegularExpression( const RegularExpressionPattern& pattern )
     , expression_( pattern.pattern )
 {
     try {
+        if ( pattern.isBoolean && JsonQuery::isJsonQuery( pattern.pattern.toStdString() ) ) {
+            jsonQuery_ = std::make_shared<const JsonQuery>( pattern.pattern.toStdString(),
+                                                            pattern.isCaseSensitive );
+            // Query is matched as a single pattern, it is never compiled
+            isBooleanCombination_ = false;
+            subPatterns_.emplace_back( pattern );
+            isValid_ = true;
+            return;
+        }
+
         if ( pattern.isBoolean ) {
             subPatterns_ = parseBooleanExpressions( expression_, pattern.isCaseSensitive,
                                                     pattern.isPlainText );
@@ -154,32 +166,15 @@ std::unique_ptr<PatternMatcher> RegularExpression::createMatcher() const
 
 namespace matching {
 
-bool hasSingleMatch( std::string_view line, const MatcherVariant& matcher,
-                     BooleanExpressionEvaluator* )
-{
-    const auto result
-        = std::visit( [ &line ]( const auto& m ) { return m.match( line ); }, matcher );
-
-    return !result.empty() && result[ 0 ] > 0;
-}
-
-bool hasCombinedMatch( std::string_view line, const MatcherVariant& matcher,
-                       BooleanExpressionEvaluator* evaluator )
-{
-    auto result = std::visit( [ &line ]( const auto& m ) { return m.match( line ); }, matcher );
-    return evaluator && evaluator->evaluate( result );
-}
-
-bool hasInverseSingleMatch( std::string_view line, const MatcherVariant& matcher,
-                            BooleanExpressionEvaluator* evaluator )
+bool evaluateCombination( BooleanExpressionEvaluator* evaluator,
+                          const MatchedPatterns& matchedPatterns )
 {
-    return !hasSingleMatch( line, matcher, evaluator );
+    return evaluator && evaluator->evaluate( matchedPatterns );
 }
 
-bool hasInverseCombinedMatch( std::string_view line, const MatcherVariant& matcher,
-                              BooleanExpressionEvaluator* evaluator )
+bool canDecideEarly( const BooleanExpressionEvaluator* evaluator )
 {
-    return !hasCombinedMatch( line, matcher, evaluator );
+    return evaluator && evaluator->canDecideEarly();
 }
 
 } // namespace matching
@@ -188,24 +183,30 @@ PatternMatcher::PatternMatcher( const RegularExpression& expression )
     : isInverse_( expression.isInverse_ )
     , isBooleanCombination_( expression.isBooleanCombination_ )
     , mainPatternId_( expression.subPatterns_.front().id() )
-    , matcher_( expression.hsExpression_.createMatcher() )
+    , matcher_( expression.jsonQuery_
+                    ? MatcherVariant{ JsonQueryMatcher( expression.jsonQuery_ ) }
+                    : expression.hsExpression_.createMatcher() )
 {
     const auto& config = Configuration::get();
     const auto useHyperscanEngine = config.regexpEngine() == RegexpEngine::Hyperscan;
-    if ( !useHyperscanEngine ) {
+    if ( !useHyperscanEngine && !expression.jsonQuery_ ) {
         matcher_ = DefaultRegularExpressionMatcher( expression.subPatterns_ );
     }
 
     if ( expression.isBooleanCombination_ ) {
         evaluator_ = std::make_unique<BooleanExpressionEvaluator>(
             expression.expression_.toStdString(), expression.subPatterns_ );
-    }
 
-    if ( !isBooleanCombination_ ) {
-        hasMatchImpl_ = isInverse_ ? matching::hasInverseSingleMatch : matching::hasSingleMatch;
-    }
-    else {
-        hasMatchImpl_ = isInverse_ ? matching::hasInverseCombinedMatch : matching::hasCombinedMatch;
+        const auto isEvaluatedLazily = std::visit(
+            [ this ]( const auto& matcher ) {
+                using Matcher = std::decay_t<decltype( matcher )>;
+                return matching::HasCombinationMatch<Matcher>::value
+                       && evaluator_->canDecideEarly();
+            },
+            matcher_ );
+        if ( !isEvaluatedLazily ) {
+            subPatternHits_.assign( expression.subPatterns_.size(), 0 );
+        }
     }
 }
 
@@ -213,5 +214,145 @@ PatternMatcher::~PatternMatcher() = default;
 
 bool PatternMatcher::hasMatch( std::string_view line ) const
 {
-    return hasMatchImpl_( line, matcher_, evaluator_.get() );
-}
\ No newline at end of file
+    return withSpecializedMatcher(
+        [ line ]( const auto& matcher ) { return matcher.hasMatch( line ); } );
+}
+
+QString PatternMatcher::engineName() const
+{
+    return std::visit(
+        []( const auto& matcher ) -> QString {
+            using Matcher = std::decay_t<decltype( matcher )>;
+            if constexpr ( std::is_same_v<Matcher, DefaultRegularExpressionMatcher> ) {
+                return "QRegularExpression";
+            }
+            else if constexpr ( std::is_same_v<Matcher, JsonQueryMatcher> ) {
+                return "JSON query";
+            }
+#ifdef KLOGG_HAS_HS
+            else if constexpr ( std::is_same_v<Matcher, HsPrefilterMatcher> ) {
+                return "Hyperscan prefilter";
+            }
+            else if constexpr ( std::is_same_v<Matcher, HsNoopMatcher> ) {
+                return "None";
+            }
+#endif
+            else {
+                return "Hyperscan";
+            }
+        },
+        matcher_ );
+}
+
+MultiRegularExpression::MultiRegularExpression(
+    const std::vector<RegularExpressionPattern>& patterns )
+{
+    for ( const auto& pattern : patterns ) {
+        // Parses and validates boolean combinations the same way as a single search
+        const RegularExpression regularExpression{ pattern };
+        if ( !regularExpression.isValid() ) {
+            isValid_ = false;
+            errorString_ = regularExpression.errorString();
+            return;
+        }
+        if ( regularExpression.isJsonQuery() ) {
+            isValid_ = false;
+            errorString_ = "JSON queries can't be matched together with other patterns";
+            return;
+        }
+
+        Expression expression;
+        expression.isInverse = regularExpression.isInverse_;
+        expression.isBooleanCombination = regularExpression.isBooleanCombination_;
+        expression.expression = regularExpression.expression_;
+        expression.firstSubPattern = subPatterns_.size();
+        expression.subPatternsCount = regularExpression.subPatterns_.size();
+        expressions_.push_back( std::move( expression ) );
+
+        subPatterns_.insert( subPatterns_.end(), regularExpression.subPatterns_.begin(),
+                             regularExpression.subPatterns_.end() );
+    }
+
+    if ( subPatterns_.empty() ) {
+        isValid_ = false;
+        errorString_ = "No patterns";
+        return;
+    }
+
+    hsExpression_ = HsRegularExpression( subPatterns_ );
+    isValid_ = hsExpression_.isValid();
+    errorString_ = hsExpression_.errorString();
+}
+
+std::unique_ptr<MultiPatternMatcher> MultiRegularExpression::createMatcher() const
+{
+    return std::make_unique<MultiPatternMatcher>( *this );
+}
+
+size_t MultiRegularExpression::size() const
+{
+    return expressions_.size();
+}
+
+bool MultiRegularExpression::isValid() const
+{
+    return isValid_;
+}
+
+QString MultiRegularExpression::errorString() const
+{
+    return errorString_;
+}
+
+MultiPatternMatcher::MultiPatternMatcher( const MultiRegularExpression& expression )
+    : subPatternsCount_( expression.subPatterns_.size() )
+    , matcher_( expression.hsExpression_.createMatcher() )
+{
+    const auto& config = Configuration::get();
+    const auto useHyperscanEngine = config.regexpEngine() == RegexpEngine::Hyperscan;
+    if ( !useHyperscanEngine ) {
+        matcher_ = DefaultRegularExpressionMatcher( expression.subPatterns_ );
+    }
+
+    for ( const auto& e : expression.expressions_ ) {
+        Expression matcherExpression;
+        matcherExpression.isInverse = e.isInverse;
+        matcherExpression.firstSubPattern = e.firstSubPattern;
+        matcherExpression.subPatternsCount = e.subPatternsCount;
+
+        if ( e.isBooleanCombination ) {
+            const auto first = expression.subPatterns_.begin()
+                               + static_cast<std::ptrdiff_t>( e.firstSubPattern );
+            const std::vector<RegularExpressionPattern> subPatterns(
+                first, first + static_cast<std::ptrdiff_t>( e.subPatternsCount ) );
+            matcherExpression.evaluator = std::make_unique<BooleanExpressionEvaluator>(
+                e.expression.toStdString(), subPatterns );
+        }
+
+        expressions_.push_back( std::move( matcherExpression ) );
+    }
+}
+
+MultiPatternMatcher::~MultiPatternMatcher() = default;
+
+void MultiPatternMatcher::match( std::string_view line, MatchedPatterns& matches ) const
+{
+    const auto result
+        = std::visit( [ &line ]( const auto& m ) { return m.match( line ); }, matcher_ );
+    const auto hasResult = result.size() == subPatternsCount_;
+    const auto subPatternMatches = std::string_view( result );
+
+    for ( auto index = 0u; index < expressions_.size(); ++index ) {
+        const auto& expression = expressions_[ index ];
+
+        auto isMatched = false;
+        if ( hasResult ) {
+            const auto variables = subPatternMatches.substr( expression.firstSubPattern,
+                                                             expression.subPatternsCount );
+            isMatched = expression.evaluator ? expression.evaluator->evaluate( variables )
+                                             : variables[ 0 ] > 0;
+        }
+
+        matches[ index ] = ( isMatched != expression.isInverse );
+    }
+}
@@ -97,6 +97,26 @@ class Configuration final : public Persistable<Configuration> {
         quickfindIncremental_ = isIncremental;
     }
 
+    // Main search matches whole entries starting with lines matching this pattern
+    QString searchEntryStartPattern() const
+    {
+        return searchEntryStartPattern_;
+    }
+    void setSearchEntryStartPattern( const QString& pattern )
+    {
+        searchEntryStartPattern_ = pattern;
+    }
+
+    // Lines before and after each match also shown in filtered view
+    int searchContextLines() const
+    {
+        return searchContextLines_;
+    }
+    void setSearchContextLines( int lines )
+    {
+        searchContextLines_ = lines;
+    }
+
     // "Advanced" settings
     bool anyFileWatchEnabled() const
     {
@@ -128,6 +148,17 @@ class Configuration final : public Persistable<Configuration> {
         pollIntervalMs_ = interval;
     }
 
+    // Writes on mounts of watched files are reported by the OS as one stream,
+    // files on these mounts are polled rarely
+    bool mountChangeStreamEnabled() const
+    {
+        return mountChangeStreamEnabled_;
+    }
+    void setMountChangeStreamEnabled( bool enabled )
+    {
+        mountChangeStreamEnabled_ = enabled;
+    }
+
     bool fastModificationDetection() const
     {
         return fastModificationDetection_;
@@ -146,6 +177,16 @@ class Configuration final : public Persistable<Configuration> {
     {
         loadLastSession_ = enabled;
     }
+    // Restored tabs that are not shown are loaded in background
+    // by this many loaders, zero loads them only when activated
+    int sessionBackgroundLoaders() const
+    {
+        return sessionBackgroundLoaders_;
+    }
+    void setSessionBackgroundLoaders( int loaders )
+    {
+        sessionBackgroundLoaders_ = loaders;
+    }
     bool followFileOnLoad() const
     {
         return followFileOnLoad_;
@@ -180,6 +221,176 @@ class Configuration final : public Persistable<Configuration> {
     {
         useSearchResultsCache_ = enabled;
     }
+    bool useIndexCache() const
+    {
+        return useIndexCache_;
+    }
+    void setUseIndexCache( bool useCache )
+    {
+        useIndexCache_ = useCache;
+    }
+    int indexCheckpointIntervalMb() const
+    {
+        return indexCheckpointIntervalMb_;
+    }
+    void setIndexCheckpointIntervalMb( int intervalMb )
+    {
+        indexCheckpointIntervalMb_ = intervalMb;
+    }
+    bool usePersistentSearchCache() const
+    {
+        return usePersistentSearchCache_;
+    }
+    void setUsePersistentSearchCache( bool useCache )
+    {
+        usePersistentSearchCache_ = useCache;
+    }
+    int persistentSearchCacheSizeMb() const
+    {
+        return persistentSearchCacheSizeMb_;
+    }
+    void setPersistentSearchCacheSizeMb( int sizeMb )
+    {
+        persistentSearchCacheSizeMb_ = sizeMb;
+    }
+
+    bool useSparseIndex() const
+    {
+        return useSparseIndex_;
+    }
+    void setUseSparseIndex( bool useSparseIndex )
+    {
+        useSparseIndex_ = useSparseIndex;
+    }
+    int sparseIndexMinFileSizeMb() const
+    {
+        return sparseIndexMinFileSizeMb_;
+    }
+    void setSparseIndexMinFileSizeMb( int sizeMb )
+    {
+        sparseIndexMinFileSizeMb_ = sizeMb;
+    }
+    bool useFileBackedIndex() const
+    {
+        return useFileBackedIndex_;
+    }
+    void setUseFileBackedIndex( bool useFileBackedIndex )
+    {
+        useFileBackedIndex_ = useFileBackedIndex;
+    }
+    bool useLargePages() const
+    {
+        return useLargePages_;
+    }
+    void setUseLargePages( bool useLargePages )
+    {
+        useLargePages_ = useLargePages;
+    }
+    bool useTrigramIndex() const
+    {
+        return useTrigramIndex_;
+    }
+    void setUseTrigramIndex( bool useTrigramIndex )
+    {
+        useTrigramIndex_ = useTrigramIndex;
+    }
+    bool estimateSearchMatches() const
+    {
+        return estimateSearchMatches_;
+    }
+    void setEstimateSearchMatches( bool estimateSearchMatches )
+    {
+        estimateSearchMatches_ = estimateSearchMatches;
+    }
+    bool searchAroundViewFirst() const
+    {
+        return searchAroundViewFirst_;
+    }
+    void setSearchAroundViewFirst( bool searchAroundViewFirst )
+    {
+        searchAroundViewFirst_ = searchAroundViewFirst;
+    }
+    QString timestampFormat() const
+    {
+        return timestampFormat_;
+    }
+    void setTimestampFormat( const QString& format )
+    {
+        timestampFormat_ = format;
+    }
+    QStringList indexedFields() const
+    {
+        return indexedFields_;
+    }
+    void setIndexedFields( const QStringList& fields )
+    {
+        indexedFields_ = fields;
+    }
+    bool useTokenIndex() const
+    {
+        return useTokenIndex_;
+    }
+    void setUseTokenIndex( bool useTokenIndex )
+    {
+        useTokenIndex_ = useTokenIndex;
+    }
+    bool useLineLengthIndex() const
+    {
+        return useLineLengthIndex_;
+    }
+    void setUseLineLengthIndex( bool useLineLengthIndex )
+    {
+        useLineLengthIndex_ = useLineLengthIndex;
+    }
+    bool useLineHashIndex() const
+    {
+        return useLineHashIndex_;
+    }
+    void setUseLineHashIndex( bool useLineHashIndex )
+    {
+        useLineHashIndex_ = useLineHashIndex;
+    }
+    bool useRecordIndex() const
+    {
+        return useRecordIndex_;
+    }
+    void setUseRecordIndex( bool useRecordIndex )
+    {
+        useRecordIndex_ = useRecordIndex;
+    }
+    bool useLocalBlockCache() const
+    {
+        return useLocalBlockCache_;
+    }
+    void setUseLocalBlockCache( bool useLocalBlockCache )
+    {
+        useLocalBlockCache_ = useLocalBlockCache;
+    }
+    int localBlockCacheSizeMb() const
+    {
+        return localBlockCacheSizeMb_;
+    }
+    void setLocalBlockCacheSizeMb( int cacheSizeMb )
+    {
+        localBlockCacheSizeMb_ = cacheSizeMb;
+    }
+    QString tokenDelimiters() const
+    {
+        return tokenDelimiters_;
+    }
+    void setTokenDelimiters( const QString& delimiters )
+    {
+        tokenDelimiters_ = delimiters;
+    }
+    bool useHyperscanDatabaseCache() const
+    {
+        return useHyperscanDatabaseCache_;
+    }
+    void setUseHyperscanDatabaseCache( bool useHyperscanDatabaseCache )
+    {
+        useHyperscanDatabaseCache_ = useHyperscanDatabaseCache;
+    }
+
     unsigned searchResultsCacheLines() const
     {
         return searchResultsCacheLines_;
@@ -188,6 +399,15 @@ class Configuration final : public Persistable<Configuration> {
     {
         searchResultsCacheLines_ = lines;
     }
+    // Indexing and search streams of all files that read the same disk at once
+    int maxDiskStreamsPerDevice() const
+    {
+        return maxDiskStreamsPerDevice_;
+    }
+    void setMaxDiskStreamsPerDevice( int streams )
+    {
+        maxDiskStreamsPerDevice_ = streams;
+    }
     int indexReadBufferSizeMb() const
     {
         return indexReadBufferSizeMb_;
@@ -196,6 +416,30 @@ class Configuration final : public Persistable<Configuration> {
     {
         indexReadBufferSizeMb_ = bufferSizeMb;
     }
+    bool dropIndexedFileCache() const
+    {
+        return dropIndexedFileCache_;
+    }
+    void setDropIndexedFileCache( bool dropCache )
+    {
+        dropIndexedFileCache_ = dropCache;
+    }
+    int memoryBudgetMb() const
+    {
+        return memoryBudgetMb_;
+    }
+    void setMemoryBudgetMb( int budgetMb )
+    {
+        memoryBudgetMb_ = budgetMb;
+    }
+    bool pipelineTracing() const
+    {
+        return pipelineTracing_;
+    }
+    void setPipelineTracing( bool enableTracing )
+    {
+        pipelineTracing_ = enableTracing;
+    }
     int searchReadBufferSizeLines() const
     {
         return searchReadBufferSizeLines_;
@@ -212,6 +456,25 @@ class Configuration final : public Persistable<Configuration> {
     {
         searchThreadPoolSize_ = threads;
     }
+    // Search threads and read buffers are tuned for the storage each file is on,
+    // instead of the values above, see DeviceTuning
+    bool useDeviceTuning() const
+    {
+        return useDeviceTuning_;
+    }
+    void setUseDeviceTuning( bool useDeviceTuning )
+    {
+        useDeviceTuning_ = useDeviceTuning;
+    }
+    // Indexing and search threads run only on this NUMA node, -1 for any node
+    int numaNode() const
+    {
+        return numaNode_;
+    }
+    void setNumaNode( int node )
+    {
+        numaNode_ = node;
+    }
     bool keepFileClosed() const
     {
         return keepFileClosed_;
@@ -345,6 +608,17 @@ class Configuration final : public Persistable<Configuration> {
         extractArchivesAlways_ = extract;
     }
 
+    // Libraries of format plugins in this directory are loaded,
+    // none if it is empty
+    QString formatPluginsDirectory() const
+    {
+        return formatPluginsDirectory_;
+    }
+    void setFormatPluginsDirectory( const QString& directory )
+    {
+        formatPluginsDirectory_ = directory;
+    }
+
     bool verifySslPeers() const
     {
         return verifySslPeers_;
@@ -453,6 +727,25 @@ class Configuration final : public Persistable<Configuration> {
         autoRunSearchOnPatternChange_ = enable;
     }
 
+    // Search is restarted while the pattern is typed
+    bool liveSearch() const
+    {
+        return liveSearch_;
+    }
+    void setLiveSearch( bool enable )
+    {
+        liveSearch_ = enable;
+    }
+
+    int liveSearchDelayMs() const
+    {
+        return liveSearchDelayMs_;
+    }
+    void setLiveSearchDelayMs( int delay )
+    {
+        liveSearchDelayMs_ = delay;
+    }
+
     bool optimizeForNotLatinEncodings() const
     {
         return optimizeForNotLatinEncodings_;
@@ -462,6 +755,15 @@ class Configuration final : public Persistable<Configuration> {
         optimizeForNotLatinEncodings_ = enable;
     }
 
+    bool useMemoryMappedFiles() const
+    {
+        return useMemoryMappedFiles_;
+    }
+    void setUseMemoryMappedFiles( bool enable )
+    {
+        useMemoryMappedFiles_ = enable;
+    }
+
     bool hideAnsiColorSequences() const
     {
         return hideAnsiColorSequences_;
@@ -471,6 +773,26 @@ class Configuration final : public Persistable<Configuration> {
         hideAnsiColorSequences_ = hide;
     }
 
+    // Sequences are removed from lines and their colors are shown
+    bool renderAnsiColors() const
+    {
+        return renderAnsiColors_;
+    }
+    void setRenderAnsiColors( bool render )
+    {
+        renderAnsiColors_ = render;
+    }
+
+    // Text of views is painted into an image by a worker thread
+    bool threadedRendering() const
+    {
+        return threadedRendering_;
+    }
+    void setThreadedRendering( bool threaded )
+    {
+        threadedRendering_ = threaded;
+    }
+
     int defaultEncodingMib() const
     {
         return defaultEncodingMib_;
@@ -494,6 +816,8 @@ class Configuration final : public Persistable<Configuration> {
     SearchRegexpType mainRegexpType_ = SearchRegexpType::ExtendedRegexp;
     SearchRegexpType quickfindRegexpType_ = SearchRegexpType::FixedString;
     bool quickfindIncremental_ = true;
+    QString searchEntryStartPattern_;
+    int searchContextLines_ = 0;
 
     bool nativeFileWatchEnabled_ = true;
 #ifdef Q_OS_WIN
@@ -504,9 +828,12 @@ class Configuration final : public Persistable<Configuration> {
 
     int pollIntervalMs_ = 2000;
 
+    bool mountChangeStreamEnabled_ = false;
+
     bool fastModificationDetection_ = false;
 
     bool loadLastSession_ = true;
+    int sessionBackgroundLoaders_ = 1;
     bool followFileOnLoad_ = false;
     bool allowMultipleWindows_ = false;
 
@@ -525,10 +852,39 @@ class Configuration final : public Persistable<Configuration> {
     // Performance settings
     bool useSearchResultsCache_ = true;
     unsigned searchResultsCacheLines_ = 1000000;
+    bool useIndexCache_ = false;
+    int indexCheckpointIntervalMb_ = 4096;
+    bool usePersistentSearchCache_ = false;
+    int persistentSearchCacheSizeMb_ = 256;
+    bool useSparseIndex_ = false;
+    int sparseIndexMinFileSizeMb_ = 4096;
+    bool useFileBackedIndex_ = false;
+    bool useLargePages_ = false;
+    bool useTrigramIndex_ = false;
+    bool estimateSearchMatches_ = true;
+    bool searchAroundViewFirst_ = true;
+    QString timestampFormat_;
+    QStringList indexedFields_;
+    bool useTokenIndex_ = false;
+    bool useLineLengthIndex_ = false;
+    bool useLineHashIndex_ = false;
+    bool useRecordIndex_ = false;
+    bool useLocalBlockCache_ = false;
+    int localBlockCacheSizeMb_ = 4096;
+    // Empty means default delimiters
+    QString tokenDelimiters_;
+    bool useHyperscanDatabaseCache_ = false;
     bool useParallelSearch_ = true;
     int indexReadBufferSizeMb_ = 16;
-    int searchReadBufferSizeLines_ = 10000;
+    int maxDiskStreamsPerDevice_ = 2;
+    bool dropIndexedFileCache_ = false;
+    // Zero means no limit
+    int memoryBudgetMb_ = 0;
+    bool pipelineTracing_ = false;
+    int searchReadBufferSizeLines_ = 100000;
     int searchThreadPoolSize_ = 0;
+    bool useDeviceTuning_ = true;
+    int numaNode_ = -1;
     bool keepFileClosed_ = false;
 
     bool enableLogging_ = false;
@@ -539,6 +895,8 @@ class Configuration final : public Persistable<Configuration> {
     bool extractArchives_ = true;
     bool extractArchivesAlways_ = false;
 
+    QString formatPluginsDirectory_;
+
     bool verifySslPeers_ = true;
 
     bool forceFontAntialiasing_ = false;
@@ -555,10 +913,15 @@ class Configuration final : public Persistable<Configuration> {
 
     bool allowFollowOnScroll_ = true;
     bool autoRunSearchOnPatternChange_ = false;
+    bool liveSearch_ = false;
+    int liveSearchDelayMs_ = 300;
 
     bool optimizeForNotLatinEncodings_ = false;
+    bool useMemoryMappedFiles_ = false;
 
     bool hideAnsiColorSequences_ = false;
+    bool renderAnsiColors_ = false;
+    bool threadedRendering_ = false;
 
     int defaultEncodingMib_ = -1;
 
@@ -37,17 +37,25 @@ class Persistable {
         return getPersistable( false );
     }
 
+    // Reloads the persistable in case another instance changed it.
+    // While its own changes are not written yet, they are kept.
     static T& getSynced()
     {
         auto& persistable = getPersistable( true );
-        persistable.retrieve();
+        if ( !PersistentInfo::isWriteScheduled( SettingsType{}, T::persistableName() ) ) {
+            persistable.retrieve();
+        }
         return persistable;
     }
 
+    // Writes a copy of the persistable later on a background thread
     void save() const
     {
-        auto& settings = PersistentInfo::getSettings( SettingsType{} );
-        static_cast<const T&>( *this ).saveToStorage( settings );
+        PersistentInfo::scheduleWrite(
+            SettingsType{}, T::persistableName(),
+            [ persistable = static_cast<const T&>( *this ) ]( QSettings& settings ) {
+                persistable.saveToStorage( settings );
+            } );
     }
 
   private:
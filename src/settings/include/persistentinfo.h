@@ -39,6 +39,7 @@
 #ifndef KLOGG_PERSISTENTINFO_H
 #define KLOGG_PERSISTENTINFO_H
 
+#include <functional>
 #include <memory>
 
 #include <QSettings>
@@ -56,6 +57,20 @@ class PersistentInfo {
     static QSettings& getSettings( app_settings );
     static QSettings& getSettings( session_settings );
 
+    using SettingsWriter = std::function<void( QSettings& )>;
+
+    // Writes are done by a background thread some time after the first
+    // scheduled one. A write of the same name replaces the pending one.
+    static void scheduleWrite( app_settings, const char* name, SettingsWriter writer );
+    static void scheduleWrite( session_settings, const char* name, SettingsWriter writer );
+
+    // True while a write of the name is pending or in progress
+    static bool isWriteScheduled( app_settings, const char* name );
+    static bool isWriteScheduled( session_settings, const char* name );
+
+    // Writes everything scheduled before returning
+    static void flush();
+
   private:
     static const bool ForcePortable;
 
@@ -125,6 +125,13 @@ void Configuration::retrieveFromStorage( QSettings& settings )
     quickfindIncremental_
         = settings.value( "quickfind.incremental", DefaultConfiguration.quickfindIncremental_ )
               .toBool();
+    searchEntryStartPattern_ = settings
+                                   .value( "regexpType.entryStartPattern",
+                                           DefaultConfiguration.searchEntryStartPattern_ )
+                                   .toString();
+    searchContextLines_ = std::max(
+        0, settings.value( "regexpType.contextLines", DefaultConfiguration.searchContextLines_ )
+               .toInt() );
 
     enableMainSearchHighlight_
         = settings
@@ -156,6 +163,11 @@ void Configuration::retrieveFromStorage( QSettings& settings )
                                         .value( "regexpType.autoRunSearch",
                                                 DefaultConfiguration.autoRunSearchOnPatternChange_ )
                                         .toBool();
+    liveSearch_
+        = settings.value( "regexpType.liveSearch", DefaultConfiguration.liveSearch_ ).toBool();
+    liveSearchDelayMs_
+        = settings.value( "regexpType.liveSearchDelayMs", DefaultConfiguration.liveSearchDelayMs_ )
+              .toInt();
 
     // "Advanced" settings
     nativeFileWatchEnabled_
@@ -175,6 +187,11 @@ void Configuration::retrieveFromStorage( QSettings& settings )
     settings.remove( "polling.intervalMs" );
     pollIntervalMs_ = settings.value( "filewatch.pollingIntervalMs", pollIntervalMs_ ).toInt();
 
+    mountChangeStreamEnabled_ = settings
+                                    .value( "filewatch.useMountChangeStream",
+                                            DefaultConfiguration.mountChangeStreamEnabled_ )
+                                    .toBool();
+
     fastModificationDetection_ = settings
                                      .value( "filewatch.fastModificationDetection",
                                              DefaultConfiguration.fastModificationDetection_ )
@@ -187,6 +204,10 @@ void Configuration::retrieveFromStorage( QSettings& settings )
 
     loadLastSession_
         = settings.value( "session.loadLast", DefaultConfiguration.loadLastSession_ ).toBool();
+    sessionBackgroundLoaders_ = settings
+                                    .value( "session.backgroundLoaders",
+                                            DefaultConfiguration.sessionBackgroundLoaders_ )
+                                    .toInt();
     allowMultipleWindows_
         = settings.value( "session.multipleWindows", DefaultConfiguration.allowMultipleWindows_ )
               .toBool();
@@ -208,6 +229,11 @@ void Configuration::retrieveFromStorage( QSettings& settings )
         = settings.value( "archives.extractAlways", DefaultConfiguration.extractArchivesAlways_ )
               .toBool();
 
+    formatPluginsDirectory_ = settings
+                                  .value( "formats.pluginsDirectory",
+                                          DefaultConfiguration.formatPluginsDirectory_ )
+                                  .toString();
+
     // "Perf" settings
     useParallelSearch_
         = settings.value( "perf.useParallelSearch", DefaultConfiguration.useParallelSearch_ )
@@ -216,6 +242,72 @@ void Configuration::retrieveFromStorage( QSettings& settings )
         = settings
               .value( "perf.useSearchResultsCache", DefaultConfiguration.useSearchResultsCache_ )
               .toBool();
+    useIndexCache_
+        = settings.value( "perf.useIndexCache", DefaultConfiguration.useIndexCache_ ).toBool();
+    indexCheckpointIntervalMb_ = settings
+                                     .value( "perf.indexCheckpointIntervalMb",
+                                             DefaultConfiguration.indexCheckpointIntervalMb_ )
+                                     .toInt();
+    usePersistentSearchCache_ = settings
+                                    .value( "perf.usePersistentSearchCache",
+                                            DefaultConfiguration.usePersistentSearchCache_ )
+                                    .toBool();
+    persistentSearchCacheSizeMb_ = settings
+                                       .value( "perf.persistentSearchCacheSizeMb",
+                                               DefaultConfiguration.persistentSearchCacheSizeMb_ )
+                                       .toInt();
+    useSparseIndex_
+        = settings.value( "perf.useSparseIndex", DefaultConfiguration.useSparseIndex_ ).toBool();
+    sparseIndexMinFileSizeMb_ = settings
+                                    .value( "perf.sparseIndexMinFileSizeMb",
+                                            DefaultConfiguration.sparseIndexMinFileSizeMb_ )
+                                    .toInt();
+    useFileBackedIndex_ = settings
+                              .value( "perf.useFileBackedIndex",
+                                      DefaultConfiguration.useFileBackedIndex_ )
+                              .toBool();
+    useLargePages_
+        = settings.value( "perf.useLargePages", DefaultConfiguration.useLargePages_ ).toBool();
+    useTrigramIndex_
+        = settings.value( "perf.useTrigramIndex", DefaultConfiguration.useTrigramIndex_ ).toBool();
+    estimateSearchMatches_ = settings
+                                 .value( "perf.estimateSearchMatches",
+                                         DefaultConfiguration.estimateSearchMatches_ )
+                                 .toBool();
+    searchAroundViewFirst_ = settings
+                                 .value( "perf.searchAroundViewFirst",
+                                         DefaultConfiguration.searchAroundViewFirst_ )
+                                 .toBool();
+    timestampFormat_
+        = settings.value( "perf.timestampFormat", DefaultConfiguration.timestampFormat_ ).toString();
+    indexedFields_ = settings.value( "perf.indexedFields", DefaultConfiguration.indexedFields_ )
+                         .toStringList();
+    useTokenIndex_
+        = settings.value( "perf.useTokenIndex", DefaultConfiguration.useTokenIndex_ ).toBool();
+    useLineLengthIndex_ = settings
+                              .value( "perf.useLineLengthIndex",
+                                      DefaultConfiguration.useLineLengthIndex_ )
+                              .toBool();
+    useLineHashIndex_ = settings
+                            .value( "perf.useLineHashIndex",
+                                    DefaultConfiguration.useLineHashIndex_ )
+                            .toBool();
+    useRecordIndex_
+        = settings.value( "perf.useRecordIndex", DefaultConfiguration.useRecordIndex_ ).toBool();
+    useLocalBlockCache_ = settings
+                              .value( "perf.useLocalBlockCache",
+                                      DefaultConfiguration.useLocalBlockCache_ )
+                              .toBool();
+    localBlockCacheSizeMb_ = settings
+                                 .value( "perf.localBlockCacheSizeMb",
+                                         DefaultConfiguration.localBlockCacheSizeMb_ )
+                                 .toInt();
+    tokenDelimiters_
+        = settings.value( "perf.tokenDelimiters", DefaultConfiguration.tokenDelimiters_ ).toString();
+    useHyperscanDatabaseCache_ = settings
+                                     .value( "perf.useHyperscanDatabaseCache",
+                                             DefaultConfiguration.useHyperscanDatabaseCache_ )
+                                     .toBool();
     searchResultsCacheLines_ = settings
                                    .value( "perf.searchResultsCacheLines",
                                            DefaultConfiguration.searchResultsCacheLines_ )
@@ -224,6 +316,18 @@ void Configuration::retrieveFromStorage( QSettings& settings )
         = settings
               .value( "perf.indexReadBufferSizeMb", DefaultConfiguration.indexReadBufferSizeMb_ )
               .toInt();
+    maxDiskStreamsPerDevice_ = settings
+                                   .value( "perf.maxDiskStreamsPerDevice",
+                                           DefaultConfiguration.maxDiskStreamsPerDevice_ )
+                                   .toInt();
+    dropIndexedFileCache_
+        = settings
+              .value( "perf.dropIndexedFileCache", DefaultConfiguration.dropIndexedFileCache_ )
+              .toBool();
+    memoryBudgetMb_
+        = settings.value( "perf.memoryBudgetMb", DefaultConfiguration.memoryBudgetMb_ ).toInt();
+    pipelineTracing_
+        = settings.value( "perf.pipelineTracing", DefaultConfiguration.pipelineTracing_ ).toBool();
     searchReadBufferSizeLines_ = settings
                                      .value( "perf.searchReadBufferSizeLines",
                                              DefaultConfiguration.searchReadBufferSizeLines_ )
@@ -231,6 +335,9 @@ void Configuration::retrieveFromStorage( QSettings& settings )
     searchThreadPoolSize_
         = settings.value( "perf.searchThreadPoolSize", DefaultConfiguration.searchThreadPoolSize_ )
               .toInt();
+    useDeviceTuning_
+        = settings.value( "perf.useDeviceTuning", DefaultConfiguration.useDeviceTuning_ ).toBool();
+    numaNode_ = settings.value( "perf.numaNode", DefaultConfiguration.numaNode_ ).toInt();
     keepFileClosed_
         = settings.value( "perf.keepFileClosed", DefaultConfiguration.keepFileClosed_ ).toBool();
 
@@ -239,6 +346,11 @@ void Configuration::retrieveFromStorage( QSettings& settings )
                                                 DefaultConfiguration.optimizeForNotLatinEncodings_ )
                                         .toBool();
 
+    useMemoryMappedFiles_ = settings
+                                .value( "perf.useMemoryMappedFiles",
+                                        DefaultConfiguration.useMemoryMappedFiles_ )
+                                .toBool();
+
     verifySslPeers_
         = settings.value( "net.verifySslPeers", DefaultConfiguration.verifySslPeers_ ).toBool();
 
@@ -260,6 +372,12 @@ void Configuration::retrieveFromStorage( QSettings& settings )
         = settings
               .value( "view.hideAnsiColorSequences", DefaultConfiguration.hideAnsiColorSequences_ )
               .toBool();
+    renderAnsiColors_
+        = settings.value( "view.renderAnsiColors", DefaultConfiguration.renderAnsiColors_ )
+              .toBool();
+    threadedRendering_
+        = settings.value( "view.threadedRendering", DefaultConfiguration.threadedRendering_ )
+              .toBool();
 
     style_ = settings.value( "view.style", DefaultConfiguration.style_ ).toString();
 
@@ -336,20 +454,26 @@ void Configuration::saveToStorage( QSettings& settings ) const
     settings.setValue( "regexpType.mainHighlight", enableMainSearchHighlight_ );
     settings.setValue( "regexpType.mainHighlightVariate", enableMainSearchHighlightVariance_ );
     settings.setValue( "regexpType.autoRunSearch", autoRunSearchOnPatternChange_ );
+    settings.setValue( "regexpType.liveSearch", liveSearch_ );
+    settings.setValue( "regexpType.liveSearchDelayMs", liveSearchDelayMs_ );
 
     settings.setValue( "regexpType.quickfind", static_cast<int>( quickfindRegexpType_ ) );
     settings.setValue( "regexpType.quickfindBackColor", qfBackColor_.name( QColor::HexArgb ) );
 
     settings.setValue( "quickfind.incremental", quickfindIncremental_ );
+    settings.setValue( "regexpType.entryStartPattern", searchEntryStartPattern_ );
+    settings.setValue( "regexpType.contextLines", searchContextLines_ );
     settings.setValue( "quickfind.ignore_case", qfIgnoreCase_ );
 
     settings.setValue( "filewatch.useNative", nativeFileWatchEnabled_ );
     settings.setValue( "filewatch.usePolling", pollingEnabled_ );
     settings.setValue( "filewatch.pollingIntervalMs", pollIntervalMs_ );
+    settings.setValue( "filewatch.useMountChangeStream", mountChangeStreamEnabled_ );
     settings.setValue( "filewatch.fastModificationDetection", fastModificationDetection_ );
     settings.setValue( "filewatch.allowFollowOnScroll", allowFollowOnScroll_ );
 
     settings.setValue( "session.loadLast", loadLastSession_ );
+    settings.setValue( "session.backgroundLoaders", sessionBackgroundLoaders_ );
     settings.setValue( "session.multipleWindows", allowMultipleWindows_ );
     settings.setValue( "session.followOnLoad", followFileOnLoad_ );
 
@@ -360,15 +484,44 @@ void Configuration::saveToStorage( QSettings& settings ) const
 
     settings.setValue( "archives.extract", extractArchives_ );
     settings.setValue( "archives.extractAlways", extractArchivesAlways_ );
+    settings.setValue( "formats.pluginsDirectory", formatPluginsDirectory_ );
 
     settings.setValue( "perf.useParallelSearch", useParallelSearch_ );
     settings.setValue( "perf.useSearchResultsCache", useSearchResultsCache_ );
     settings.setValue( "perf.searchResultsCacheLines", searchResultsCacheLines_ );
+    settings.setValue( "perf.useIndexCache", useIndexCache_ );
+    settings.setValue( "perf.indexCheckpointIntervalMb", indexCheckpointIntervalMb_ );
+    settings.setValue( "perf.usePersistentSearchCache", usePersistentSearchCache_ );
+    settings.setValue( "perf.persistentSearchCacheSizeMb", persistentSearchCacheSizeMb_ );
+    settings.setValue( "perf.useSparseIndex", useSparseIndex_ );
+    settings.setValue( "perf.sparseIndexMinFileSizeMb", sparseIndexMinFileSizeMb_ );
+    settings.setValue( "perf.useFileBackedIndex", useFileBackedIndex_ );
+    settings.setValue( "perf.useLargePages", useLargePages_ );
+    settings.setValue( "perf.useTrigramIndex", useTrigramIndex_ );
+    settings.setValue( "perf.estimateSearchMatches", estimateSearchMatches_ );
+    settings.setValue( "perf.searchAroundViewFirst", searchAroundViewFirst_ );
+    settings.setValue( "perf.timestampFormat", timestampFormat_ );
+    settings.setValue( "perf.indexedFields", indexedFields_ );
+    settings.setValue( "perf.useTokenIndex", useTokenIndex_ );
+    settings.setValue( "perf.useLineLengthIndex", useLineLengthIndex_ );
+    settings.setValue( "perf.useLineHashIndex", useLineHashIndex_ );
+    settings.setValue( "perf.useRecordIndex", useRecordIndex_ );
+    settings.setValue( "perf.useLocalBlockCache", useLocalBlockCache_ );
+    settings.setValue( "perf.localBlockCacheSizeMb", localBlockCacheSizeMb_ );
+    settings.setValue( "perf.tokenDelimiters", tokenDelimiters_ );
+    settings.setValue( "perf.useHyperscanDatabaseCache", useHyperscanDatabaseCache_ );
     settings.setValue( "perf.indexReadBufferSizeMb", indexReadBufferSizeMb_ );
+    settings.setValue( "perf.maxDiskStreamsPerDevice", maxDiskStreamsPerDevice_ );
+    settings.setValue( "perf.dropIndexedFileCache", dropIndexedFileCache_ );
+    settings.setValue( "perf.memoryBudgetMb", memoryBudgetMb_ );
+    settings.setValue( "perf.pipelineTracing", pipelineTracing_ );
     settings.setValue( "perf.searchReadBufferSizeLines", searchReadBufferSizeLines_ );
     settings.setValue( "perf.searchThreadPoolSize", searchThreadPoolSize_ );
+    settings.setValue( "perf.useDeviceTuning", useDeviceTuning_ );
+    settings.setValue( "perf.numaNode", numaNode_ );
     settings.setValue( "perf.keepFileClosed", keepFileClosed_ );
     settings.setValue( "perf.optimizeForNotLatinEncodings", optimizeForNotLatinEncodings_ );
+    settings.setValue( "perf.useMemoryMappedFiles", useMemoryMappedFiles_ );
 
     settings.setValue( "net.verifySslPeers", verifySslPeers_ );
 
@@ -382,6 +535,8 @@ void Configuration::saveToStorage( QSettings& settings ) const
     settings.setValue( "view.scaleFactorRounding", scaleFactorRounding_ );
 
     settings.setValue( "view.hideAnsiColorSequences", hideAnsiColorSequences_ );
+    settings.setValue( "view.renderAnsiColors", renderAnsiColors_ );
+    settings.setValue( "view.threadedRendering", threadedRendering_ );
 
     settings.setValue( "defaultView.searchAutoRefresh", searchAutoRefresh_ );
     settings.setValue( "defaultView.searchIgnoreCase", searchIgnoreCase_ );
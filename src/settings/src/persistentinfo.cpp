@@ -39,6 +39,12 @@
 // Implements PersistentInfo, a singleton class which store/retrieve objects
 // to persistent storage.
 
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <thread>
+
 #include <QCoreApplication>
 #include <QDir>
 #include <QFileInfo>
@@ -65,6 +71,141 @@ QString makeSessionSettingsPath( const QString& appConfigPath )
         .absoluteDir()
         .filePath( QString( SessionSettingsFile ) + PortableExtension );
 }
+
+// Writes persistables to their own QSettings objects, so the ones used
+// by the GUI thread are only read. Writes of the same settings file
+// are synced to disk together.
+class BackgroundWriter {
+  public:
+    static constexpr std::chrono::milliseconds WriteDelay{ 1000 };
+
+    static BackgroundWriter& get()
+    {
+        static BackgroundWriter writer;
+        return writer;
+    }
+
+    ~BackgroundWriter()
+    {
+        {
+            std::lock_guard<std::mutex> lock( mutex_ );
+            isStopped_ = true;
+        }
+        wakeUp_.notify_one();
+
+        if ( thread_.joinable() ) {
+            thread_.join();
+        }
+
+        flush();
+    }
+
+    void schedule( const QSettings& settings, const char* name,
+                   PersistentInfo::SettingsWriter writer )
+    {
+        {
+            std::lock_guard<std::mutex> lock( mutex_ );
+            if ( pendingWrites_.empty() ) {
+                deadline_ = std::chrono::steady_clock::now() + WriteDelay;
+            }
+
+            pendingWrites_[ { settings.fileName(), name } ]
+                = PendingWrite{ settings.format(), std::move( writer ) };
+
+            if ( !thread_.joinable() && !isStopped_ ) {
+                thread_ = std::thread( [ this ] { run(); } );
+            }
+        }
+        wakeUp_.notify_one();
+    }
+
+    bool isScheduled( const QSettings& settings, const char* name ) const
+    {
+        const auto key = std::make_pair( settings.fileName(), QString( name ) );
+
+        std::lock_guard<std::mutex> lock( mutex_ );
+        return pendingWrites_.count( key ) > 0 || inProgressWrites_.count( key ) > 0;
+    }
+
+    void flush()
+    {
+        std::lock_guard<std::mutex> writeLock( writeMutex_ );
+        write();
+    }
+
+  private:
+    struct PendingWrite {
+        QSettings::Format format;
+        PersistentInfo::SettingsWriter writer;
+    };
+
+    using Writes = std::map<std::pair<QString, QString>, PendingWrite>;
+
+    void run()
+    {
+        std::unique_lock<std::mutex> lock( mutex_ );
+        while ( !isStopped_ ) {
+            if ( pendingWrites_.empty() ) {
+                wakeUp_.wait( lock );
+            }
+            else if ( std::chrono::steady_clock::now() < deadline_ ) {
+                wakeUp_.wait_until( lock, deadline_ );
+            }
+            else {
+                lock.unlock();
+                flush();
+                lock.lock();
+            }
+        }
+    }
+
+    // Called with writeMutex_ held
+    void write()
+    {
+        {
+            std::lock_guard<std::mutex> lock( mutex_ );
+            inProgressWrites_.swap( pendingWrites_ );
+        }
+
+        std::unique_ptr<QSettings> settings;
+        for ( auto& [ key, pendingWrite ] : inProgressWrites_ ) {
+            if ( !settings || settings->fileName() != key.first ) {
+                sync( settings.get() );
+                settings = std::make_unique<QSettings>( key.first, pendingWrite.format );
+            }
+
+            LOG_DEBUG << "Writing " << key.second << " to " << key.first;
+            pendingWrite.writer( *settings );
+        }
+        sync( settings.get() );
+
+        std::lock_guard<std::mutex> lock( mutex_ );
+        inProgressWrites_.clear();
+    }
+
+    static void sync( QSettings* settings )
+    {
+        if ( !settings ) {
+            return;
+        }
+
+        settings->sync();
+        if ( settings->status() != QSettings::NoError ) {
+            LOG_ERROR << "Failed to write settings to " << settings->fileName();
+        }
+    }
+
+  private:
+    mutable std::mutex mutex_;
+    std::condition_variable wakeUp_;
+    std::chrono::steady_clock::time_point deadline_;
+    Writes pendingWrites_;
+    Writes inProgressWrites_;
+    bool isStopped_ = false;
+
+    std::mutex writeMutex_;
+    std::thread thread_;
+};
 } // namespace
 
 PersistentInfo::PersistentInfo()
@@ -243,3 +384,29 @@ QSettings& PersistentInfo::getSettings( session_settings )
 {
     return *getInstance().sessionSettings_;
 }
+
+void PersistentInfo::scheduleWrite( app_settings, const char* name, SettingsWriter writer )
+{
+    BackgroundWriter::get().schedule( getSettings( app_settings{} ), name, std::move( writer ) );
+}
+
+void PersistentInfo::scheduleWrite( session_settings, const char* name, SettingsWriter writer )
+{
+    BackgroundWriter::get().schedule( getSettings( session_settings{} ), name,
+                                      std::move( writer ) );
+}
+
+bool PersistentInfo::isWriteScheduled( app_settings, const char* name )
+{
+    return BackgroundWriter::get().isScheduled( getSettings( app_settings{} ), name );
+}
+
+bool PersistentInfo::isWriteScheduled( session_settings, const char* name )
+{
+    return BackgroundWriter::get().isScheduled( getSettings( session_settings{} ), name );
+}
+
+void PersistentInfo::flush()
+{
+    BackgroundWriter::get().flush();
+}
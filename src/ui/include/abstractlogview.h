@@ -43,7 +43,9 @@
 #include <array>
 #include <cstddef>
 #include <functional>
+#include <optional>
 #include <string_view>
+#include <utility>
 #include <vector>
 
 #include <QAbstractScrollArea>
@@ -51,19 +53,29 @@
 #include <QColor>
 #include <QEvent>
 #include <QFontMetrics>
+#include <QFutureWatcher>
+#include <QHash>
+#include <QImage>
+#include <QStaticText>
 
 #ifdef GLOGG_PERF_MEASURE_FPS
 #include "perfcounter.h"
 #endif
 
 #include "abstractlogdata.h"
+#include "linesexporter.h"
 #include "linetypes.h"
 #include "overviewwidget.h"
 #include "quickfind.h"
 #include "quickfindmux.h"
 #include "regularexpressionpattern.h"
+#include "renderedtilecache.h"
+#include "searchhighlighter.h"
 #include "selection.h"
+#include "templateclusterer.h"
+#include "valueaggregator.h"
 #include "viewtools.h"
+#include "wrapindex.h"
 
 class QMenu;
 class QAction;
@@ -111,6 +123,26 @@ class LineChunk {
     QColor backColor_;
 };
 
+// Text of line chunks laid out once for the current font,
+// drawing them again does not shape the glyphs.
+// Only used for monospace fonts, where layout of a chunk
+// does not depend on the text around it.
+class StaticTextCache {
+  public:
+    struct Text {
+        QStaticText text;
+        int width;
+    };
+
+    const Text& text( const QFontMetrics& fm, const QString& chunk );
+    void clear();
+
+  private:
+    static constexpr int MaxTexts = 4096;
+
+    QHash<QString, Text> texts_;
+};
+
 // Utility class for syntax colouring.
 // It stores the chunks of line to draw
 // each chunk having a different colour
@@ -135,8 +167,9 @@ class LineDrawer {
     // leftExtraBackgroundPx is the an extra margin to start drawing
     // the coloured // background, going all the way to the element
     // left of the line looks better.
+    // Chunks are drawn from textCache if it is passed.
     void draw( QPainter* painter, int xPos, int yPos, int lineWidth, const QString& line,
-               int leftExtraBackgroundPx );
+               int leftExtraBackgroundPx, StaticTextCache* textCache );
 
   private:
     std::vector<LineChunk> chunks_;
@@ -172,6 +205,8 @@ class DigitsBuffer : public QObject {
 };
 
 class Overview;
+class HighlighterCache;
+struct LinesPreview;
 
 // Base class representing the log view widget.
 // It can be either the top (full) or bottom (filtered) view.
@@ -197,9 +232,17 @@ class AbstractLogView : public QAbstractScrollArea, public SearchableWidgetInter
 
     // Refresh the widget when the data set has changed.
     void updateData();
+    // Refresh the widget when lines have been appended to the data set,
+    // rows already drawn are kept.
+    void updateAppendedData();
     // Instructs the widget to update it's content geometry,
     // used when the font is changed.
     void updateDisplaySize();
+    // Drops drawing caches while the view is in an inactive tab. Only
+    // a thumbnail of the last frame is kept, it is shown right after
+    // resume while the view is redrawn.
+    void suspend();
+    void resume();
     // Return the line number of the top line of the view
     LineNumber getTopLine() const;
     // Return the text of the current selection.
@@ -216,11 +259,20 @@ class AbstractLogView : public QAbstractScrollArea, public SearchableWidgetInter
 
     void allowFollowMode( bool allow );
 
-    void setSearchPattern( const RegularExpressionPattern& pattern );
+    // Highlighter of the current search shared by both views, none if
+    // the search is not highlighted
+    void setSearchHighlighter( std::shared_ptr<const SearchHighlighter> searchHighlighter );
 
     using QuickHighlighters = QStringList;
     void setQuickHighlighters( const std::vector<QuickHighlighters>& wordHighlighters );
 
+    // Views of the same file can share the cache.
+    // The caller retains ownership of the cache.
+    void setHighlighterCache( HighlighterCache* highlighterCache );
+
+    // Quick find will look for matches among the provided ones first
+    void setQuickFindMatchesProvider( QuickFind::MatchesProvider provider );
+
     void registerShortcuts();
 
   protected:
@@ -246,6 +298,24 @@ class AbstractLogView : public QAbstractScrollArea, public SearchableWidgetInter
     virtual LineNumber lineIndex( LineNumber lineNumber ) const;
     virtual LineNumber maxDisplayLineNumber() const;
 
+    // Exporter of count lines of the view starting at first
+    virtual LinesExporter linesExporter( LineNumber first, LinesCount count ) const = 0;
+
+    // Aggregator of values in all lines of the view
+    virtual ValueAggregator valueAggregator() const = 0;
+
+    // Clusterer of all lines of the view into message templates
+    virtual TemplateClusterer templateClusterer() const = 0;
+
+    // Lines the view scrolls through, views of files being indexed
+    // can scroll past lines indexed so far
+    virtual LinesCount estimatedNbLines() const;
+    // Lines shown at a line past the indexed ones, read at a byte offset
+    // approximating the line. Empty if the view can't show such lines.
+    virtual LinesPreview linesPreview( LineNumber line, LinesCount count ) const;
+    // Indexed line starting at offset of a preview
+    virtual OptionalLineNumber indexedLineAtOffset( qint64 offset ) const;
+
     // Get the overview associated with this view, or NULL if there is none
     Overview* getOverview() const
     {
@@ -277,6 +347,13 @@ class AbstractLogView : public QAbstractScrollArea, public SearchableWidgetInter
     // Sent when the view ask for a line to be marked
     // (click in the left margin).
     void markLines( const std::vector<LineNumber>& lines );
+    // Sent when the view ask for marks of lines to be removed
+    void unmarkLines( const std::vector<LineNumber>& lines );
+    // Sent when the view ask for all matches to be marked
+    void markAllMatches();
+    // Sent when the view asks to show lines of a message template
+    // in the filtered view
+    void showTemplateLines( const SearchResultArray& lines );
     // Sent up when the user wants to add the selection to the search
     void addToSearch( const QString& selection );
     // Sent up when the user wants to replace the search with the selection
@@ -296,6 +373,8 @@ class AbstractLogView : public QAbstractScrollArea, public SearchableWidgetInter
     void exitView();
 
     void changeSearchLimits( LineNumber startLine, LineNumber endLine );
+    // Sent up when the user wants to limit search by time written in lines
+    void changeSearchTimeRange();
     void clearSearchLimits();
 
     void saveDefaultSplitterSizes();
@@ -355,7 +434,9 @@ class AbstractLogView : public QAbstractScrollArea, public SearchableWidgetInter
     void findPreviousSelected();
     void copy();
     void markSelected();
+    void unmarkSelected();
     void saveToFile();
+    void saveSelectionToFile();
     void setSearchStart();
     void setSearchEnd();
     void setSelectionStart();
@@ -394,6 +475,9 @@ class AbstractLogView : public QAbstractScrollArea, public SearchableWidgetInter
     // Pointer to the Overview object
     Overview* overview_ = nullptr;
 
+    // Highlighters results, lines are matched on each paint if there is none
+    HighlighterCache* highlighterCache_ = nullptr;
+
     // Pointer to the OverviewWidget, this class doesn't own it,
     // but is responsible for displaying it (for purely aesthetic
     // reasons).
@@ -420,7 +504,7 @@ class AbstractLogView : public QAbstractScrollArea, public SearchableWidgetInter
     OptionalLineNumber markingClickLine_;
 
     Selection selection_;
-    RegularExpressionPattern searchPattern_;
+    std::shared_ptr<const SearchHighlighter> searchHighlighter_;
 
     std::vector<QuickHighlighters> quickHighlighters_ = std::vector<QuickHighlighters>{ 9 };
 
@@ -430,8 +514,24 @@ class AbstractLogView : public QAbstractScrollArea, public SearchableWidgetInter
     // rather than the top of the top one.
     LineNumber firstLine_;
     bool lastLineAligned_ = false;
+    // Offset of the first previewed line while the view is past indexed lines,
+    // the line is shown with its number when indexing reaches it
+    std::optional<qint64> previewOffset_;
     int firstCol_ = 0;
 
+    // Long lines are wrapped at the width of the view, the vertical
+    // scroll bar then moves through rows and firstRow_ is the row
+    // of the first line shown at the top
+    bool wrapLines_ = false;
+    int firstRow_ = 0;
+    WrapIndex wrapIndex_;
+    // Measures rows of lines around the view while it is idle
+    QBasicTimer wrapIndexTimer_;
+
+    // Max length the horizontal scroll bar was set up for, it grows
+    // when lines with tabs are expanded for drawing
+    LineLength scrollBarMaxLength_;
+
     LineNumber searchStart_;
     LineNumber searchEnd_;
 
@@ -445,9 +545,15 @@ class AbstractLogView : public QAbstractScrollArea, public SearchableWidgetInter
     QMenu* popupMenu_;
     QAction* copyAction_;
     QAction* markAction_;
+    QAction* unmarkAction_;
+    QAction* markAllMatchesAction_;
     QAction* sendToScratchpadAction_;
     QAction* replaceInScratchpadAction_;
     QAction* saveToFileAction_;
+    QAction* saveSelectionToFileAction_;
+    QAction* countValuesAction_;
+    QAction* summarizeNumbersAction_;
+    QAction* findTemplatesAction_;
     QAction* findNextAction_;
     QAction* findPreviousAction_;
     QAction* addToSearchAction_;
@@ -455,10 +561,13 @@ class AbstractLogView : public QAbstractScrollArea, public SearchableWidgetInter
     QAction* excludeFromSearchAction_;
     QAction* setSearchStartAction_;
     QAction* setSearchEndAction_;
+    QAction* setSearchTimeRangeAction_;
     QAction* clearSearchLimitAction_;
     QAction* setSelectionStartAction_;
     QAction* setSelectionEndAction_;
     QAction* saveDefaultSplitterSizesAction_;
+    QAction* wrapLinesAction_;
+    QAction* loadMoreOfLineAction_;
     QMenu* highlightersMenu_;
     QMenu* colorLabelsMenu_;
 
@@ -484,20 +593,59 @@ class AbstractLogView : public QAbstractScrollArea, public SearchableWidgetInter
         LineNumber first_line_;
         LineNumber last_line_;
         int first_column_;
+        int first_row_;
+
+        // Lines to redraw if the cache is valid otherwise
+        std::vector<LineNumber> dirty_lines_;
+
+        // State of the data when the cache was drawn
+        LinesCount nb_lines_;
+        int line_number_digits_;
+
+        // Set when the pixmap can be scrolled to a new first line
+        // instead of being fully redrawn
+        bool scrollable_;
     };
     struct PullToFollowCache {
         QPixmap pixmap_;
         int nb_columns_;
     };
-    TextAreaCache textAreaCache_ = { {}, true, 0_lnum, 0_lnum, 0 };
+    TextAreaCache textAreaCache_ = { {}, true, 0_lnum, 0_lnum, 0, 0, {}, 0_lcount, 0, false };
     PullToFollowCache pullToFollowCache_ = { {}, 0 };
     QFontMetrics pixmapFontMetrics_;
 
+    // Empty if font is not monospace
+    std::optional<StaticTextCache> staticTextCache_;
+
+    // Frame of the text area painted by a worker if rendering is threaded.
+    // Drawing commands are recorded by drawTextArea on the GUI thread, as it
+    // reads the state of the view, and the worker plays them back. Only one
+    // frame is painted at a time, the cache keeps showing the previous one.
+    // Frame is dropped if the cache is invalidated while it is painted, and
+    // positions scrolled past meanwhile are not painted at all.
+    QFutureWatcher<QImage> frameWatcher_;
+
+    // Screens of lines around the view drawn while it is idle, from lines
+    // already in line cache. Full redraws of the text area are put together
+    // from tiles when they are drawn.
+    RenderedTileCache tileCache_;
+    QBasicTimer tileTimer_;
+    // Times the timer waited for lines of missing tiles to be read
+    int tileWaits_ = 0;
+    // Set while a tile is drawn, lines around it are not prefetched
+    bool isRenderingTile_ = false;
+
+    // Last frame of suspended view, in logical pixels
+    QPixmap suspendedFrame_;
+    bool isSuspended_ = false;
+
     LinesCount getNbVisibleLines() const;
     int getNbVisibleCols() const;
 
     FilePos convertCoordToFilePos( const QPoint& pos ) const;
     OptionalLineNumber convertCoordToLine( int yPos ) const;
+    // Row of wrapped lines at the coordinate
+    uint64_t convertCoordToRow( int yPos ) const;
     int convertCoordToColumn( int xPos ) const;
 
     void displayLine( LineNumber line );
@@ -509,10 +657,28 @@ class AbstractLogView : public QAbstractScrollArea, public SearchableWidgetInter
     void jumpToRightOfScreen();
     void jumpToTop();
     void jumpToBottom();
+    void scrollToBottom();
     void selectWordAtPosition( const FilePos& pos );
 
     void updateSearchLimits();
 
+    // Draws lines read at approximate offset past indexed lines
+    void drawLinesPreview( QPainter& painter, int textStartX, int lineNumberStartX );
+
+    // Writes lines to a file chosen by user, showing progress
+    void saveLinesToFile( LineNumber first, LinesCount count );
+
+    // Counts values of an expression entered by user and shows them in a table
+    void countValues();
+
+    // Shows percentiles of numbers matched by an expression entered by user,
+    // with a sparkline of their medians through the file
+    void summarizeNumbers();
+
+    // Clusters lines into message templates and shows them in a table,
+    // choosing a template shows its lines in the filtered view
+    void findTemplates();
+
     void createMenu();
 
     void considerMouseHovering( int xPos, int yPos );
@@ -528,8 +694,48 @@ class AbstractLogView : public QAbstractScrollArea, public SearchableWidgetInter
     LineNumber verticalScrollToLineNumber( int scrollPosition ) const;
     int lineNumberToVerticalScroll( LineNumber line ) const;
     double verticalScrollMultiplicator() const;
-
-    void drawTextArea( QPaintDevice* paintDevice );
+    int rowToVerticalScroll( uint64_t row ) const;
+    uint64_t verticalScrollToRow( int scrollPosition ) const;
+
+    // Columns long lines are wrapped at
+    int wrapColumns() const;
+    void setWrapLines( bool wrapLines );
+    // Measures rows of the lines if they are not measured yet, the scroll
+    // bar is updated for them and keeps the view at the same rows
+    bool measureRows( LineNumber first, LinesCount count );
+    // Row of the view top
+    uint64_t topRow() const;
+
+    // Draws only the passed lines if there are any, paint device
+    // has the size of the text area cache
+    void drawTextArea( QPaintDevice* paintDevice, const std::vector<LineNumber>& lines = {} );
+    // Starts painting the whole text area into an image by a worker
+    void renderTextAreaFrame();
+    void textAreaFrameRendered();
+
+    // Layout tiles are drawn for, tiles of another one are dropped
+    void updateTileLayout();
+    // Puts the text area cache together from tiles, returns false
+    // if tiles of the current position are not drawn
+    bool drawTextAreaFromTiles();
+    // Draws the nearest tile missing around the view if its lines are cached
+    void renderNextTile();
+
+    // Marks lines of the text area cache and tiles showing them to be redrawn
+    void invalidateLine( LineNumber line );
+    // Marks lines of the text area cache to be redrawn
+    void markLineDirty( LineNumber line );
+    // Marks lines where the selection is drawn differently from the previous one
+    void invalidateSelectionChange( const Selection& previousSelection );
+    // Marks lines where search limits are drawn differently from the previous ones
+    void invalidateSearchLimitsChange( LineNumber previousStart, LineNumber previousEnd );
+    // Moves the text area cache to the current first line,
+    // lines scrolled into view are marked to be redrawn
+    void scrollTextAreaCache();
+
+    // Returns first line index inside given search limits and first one past them
+    std::pair<LineNumber, LineNumber> searchLimitsIndexes( LineNumber startLine,
+                                                          LineNumber endLine ) const;
     QPixmap drawPullToFollowBar( int width, qreal pixelRatio );
 
     void disableFollow();
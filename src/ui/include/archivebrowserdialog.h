@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_ARCHIVEBROWSERDIALOG_H
+#define KLOGG_ARCHIVEBROWSERDIALOG_H
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include <QDialog>
+#include <QFutureWatcher>
+#include <QStringList>
+#include <QTimer>
+
+#include "atomicflag.h"
+#include "decompressor.h"
+
+class QCheckBox;
+class QLabel;
+class QLineEdit;
+class QPushButton;
+class QTableWidget;
+
+// Entries of a multi file archive, with numbers of lines matching a pattern
+// in each of them. Only entries selected by the user are extracted.
+class ArchiveBrowserDialog : public QDialog {
+    Q_OBJECT
+
+  public:
+    ArchiveBrowserDialog( const QString& archiveFilePath, std::vector<ArchiveEntry> entries,
+                          QWidget* parent = nullptr );
+    ~ArchiveBrowserDialog() override;
+
+    ArchiveBrowserDialog( const ArchiveBrowserDialog& ) = delete;
+    ArchiveBrowserDialog& operator=( const ArchiveBrowserDialog& ) = delete;
+
+    // Paths inside the archive of the selected entries
+    QStringList selectedEntries() const;
+
+  private:
+    void startSearch();
+    void stopSearch();
+    void showMatches();
+    void updateProgress();
+
+  private:
+    const QString archiveFilePath_;
+    const std::vector<ArchiveEntry> entries_;
+
+    QLineEdit* patternEdit_;
+    QCheckBox* caseSensitiveBox_;
+    QPushButton* searchButton_;
+    QLabel* statusLabel_;
+    QTableWidget* table_;
+
+    AtomicFlag interrupt_;
+    std::atomic<size_t> searchedEntries_{ 0 };
+    QFutureWatcher<std::vector<uint64_t>> searchWatcher_;
+    QTimer progressTimer_;
+};
+
+#endif
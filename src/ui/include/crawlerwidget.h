@@ -41,28 +41,36 @@
 #define CRAWLERWIDGET_H
 
 #include <cstddef>
+#include <memory>
 #include <optional>
+#include <vector>
 
 #include <QCheckBox>
 #include <QComboBox>
+#include <QFutureWatcher>
 #include <QHBoxLayout>
 #include <QLabel>
 #include <QMenu>
+#include <QPointer>
 #include <QPushButton>
 #include <QSplitter>
+#include <QTimer>
 #include <QToolButton>
 #include <QVBoxLayout>
 
+#include "atomicflag.h"
 #include "colorlabelsmanager.h"
 #include "loadingstatus.h"
 #include "logdata.h"
 #include "logfiltereddata.h"
 #include "filteredview.h"
+#include "highlightercache.h"
 #include "iconloader.h"
 #include "logmainview.h"
 #include "overview.h"
 #include "predefinedfilterscombobox.h"
 #include "signalmux.h"
+#include "timehistogramwidget.h"
 #include "viewinterface.h"
 
 class InfoLine;
@@ -71,6 +79,7 @@ class SavedSearches;
 class QStandardItemModel;
 class QCompleter;
 class OverviewWidget;
+class TailWatcher;
 
 // Implements the central widget of the application.
 // It includes both windows, the search line, the info
@@ -104,11 +113,46 @@ class CrawlerWidget : public QSplitter,
     // suitable to display to the user.
     QString encodingText() const;
 
+    // Memory used by the file, its search results and caches of views,
+    // one part per line, suitable to display to the user.
+    QString memoryUsageText() const;
+
+    // Rate of data appended to the followed file, suitable to display
+    // to the user, empty if it is not growing
+    QString ingestRateText() const;
+
     // Returns whether follow is enabled in this crawler
     bool isFollowEnabled() const;
 
     void registerShortcuts();
 
+    // Text of the search line and the pattern built from it
+    // with the current search options
+    QString searchText() const;
+    RegularExpressionPattern searchPattern() const;
+
+    // Sets search line and options to the pattern and runs the search
+    // with expression compiled once for searches of all tabs
+    void runSharedSearch( const RegularExpressionPattern& pattern,
+                          std::shared_ptr<const RegularExpression> expression );
+
+    // File shown by the widget, null until it is loaded
+    std::shared_ptr<const LogData> logData() const;
+    // Shows the lines in the filtered view instead of search results
+    void showLines( const SearchResultArray& lines );
+
+    // Puts index, cached search results and marks of the file into
+    // the bundle, returns false if the file is not indexed yet
+    bool addAnalysisToBundle( AnalysisBundle& bundle ) const;
+    // Marks lines of the bundle, after the file is loaded if it is not yet
+    void addBundledMarks( const SearchResultArray& marks );
+
+    // Called when the tab becomes inactive, drops caches of views and
+    // decoded lines and stops counting matches for the overview
+    void suspend();
+    // Called when the tab is shown again
+    void resume();
+
   public Q_SLOTS:
     // Stop the asynchoronous loading of the file if one is in progress
     // The file is identified by the view attached to it.
@@ -175,6 +219,16 @@ class CrawlerWidget : public QSplitter,
     // available) has changed
     void dataStatusChanged( DataStatus status );
 
+    // Sent when search of the whole file is done
+    void searchFinished( LinesCount nbMatches );
+
+    // Sent when appended lines match watched filters, message lists
+    // the filters with the number of new matches
+    void watchesMatched( const QString& message );
+    // Sent when the number of watch matches not seen yet has changed,
+    // counters lists all watched filters with their matches so far
+    void watchMatchesChanged( uint64_t unseenMatches, const QString& counters );
+
   private Q_SLOTS:
     // Instructs the widget to start a search using the current search line.
     void startNewSearch();
@@ -187,6 +241,12 @@ class CrawlerWidget : public QSplitter,
     void exitingQuickFind();
     // Called when new data must be displayed in the filtered window.
     void updateFilteredView( LinesCount nbMatches, int progress, LineNumber initialPosition );
+    // Called when a search operation is finished to show time spent in its phases.
+    void updateSearchStats( const OperationStats& searchStats );
+    // Called when matches of a large file are estimated before it is searched.
+    void updateSearchEstimate( LinesCount estimatedMatches );
+    // Called when lines matching the pattern being typed are counted.
+    void showMatchCount( LinesCount nbMatches );
     // Called when a new line has been selected in the filtered view,
     // to instruct the main view to jump to the matching line.
     void jumpToMatchingLine( LineNumber filteredLineNb );
@@ -196,6 +256,22 @@ class CrawlerWidget : public QSplitter,
     void markLinesFromMain( const std::vector<LineNumber>& lines );
     // Mark a line that has been clicked on the filtered (bottom) view.
     void markLinesFromFiltered( const std::vector<LineNumber>& lines );
+    // Remove marks of lines selected in the main view.
+    void unmarkLinesFromMain( const std::vector<LineNumber>& lines );
+    // Remove marks of lines selected in the filtered view.
+    void unmarkLinesFromFiltered( const std::vector<LineNumber>& lines );
+    // Mark all lines matched by the current search.
+    void markAllMatches();
+    // Show lines of a message template chosen in one of the views.
+    void showTemplateLines( const SearchResultArray& lines );
+    // Show numbers of matches and marks in time intervals of the file.
+    void showTimeHistogram();
+    // Order lines of the filtered view by their timestamps or by line numbers.
+    void sortFilteredViewByTime( bool isSorted );
+    // Hide lines of the filtered view equal to the line shown before them.
+    void hideRepeatedLines( bool isHidden );
+    // Show all lines of multi-line records that have lines in the filtered view.
+    void showWholeRecords( bool isShown );
 
     void loadingFinishedHandler( LoadingStatus status );
     // Manages the info lines to inform the user the file has changed.
@@ -237,6 +313,20 @@ class CrawlerWidget : public QSplitter,
 
     // Save current search as predefined filter
     void saveAsPredefinedFilter();
+    // Search current text and all predefined filters in one pass,
+    // results of filters go to the search results cache
+    void searchWithPredefinedFilters();
+    // Search each pattern of the chain in lines kept by the previous one
+    void editFilterChain();
+    // Search pinned predefined filters in the background, see LogFilteredData::prerunSearches
+    void prerunPinnedFilters();
+    // Watched filters are matched in lines appended after the first load
+    void startWatchingTail();
+    void watchAppendedLines();
+    void appendedLinesWatched();
+    // Combine current matches with cached results of a predefined filter
+    void combineWithPredefinedFilter( const PredefinedFilter& filter,
+                                      LogFilteredData::SearchCombination combination );
     void setSearchPatternFromPredefinedFilters( const QList<PredefinedFilter>& filters );
 
     // Search Context Menu
@@ -250,6 +340,9 @@ class CrawlerWidget : public QSplitter,
 
     void setSearchLimits( LineNumber startLine, LineNumber endLine );
     void clearSearchLimits();
+    // Asks for a time range and limits search to lines written in it,
+    // see LogData::getLinesInTimeRange
+    void setSearchTimeRange();
 
     void addColorLabelToSelection( size_t label );
     void addNextColorLabelToSelection();
@@ -310,13 +403,22 @@ class CrawlerWidget : public QSplitter,
     // Private functions
     void setup();
     void setShortcuts();
-    void replaceCurrentSearch( const QString& searchText );
+    void replaceCurrentSearch( const QString& searchText,
+                               const std::vector<RegularExpressionPattern>& additionalPatterns
+                               = {},
+                               std::shared_ptr<const RegularExpression> compiledExpression = {} );
+    RegularExpressionPattern makeSearchPattern( const QString& searchText ) const;
     void updateSearchCombo();
     AbstractLogView* activeView() const;
     void printSearchInfoMessage( LinesCount nbMatches = 0_lcount );
     void changeDataStatus( DataStatus status );
     void updateEncoding();
     void changeTopViewSize( int32_t delta );
+    // Redraws views and overview after marks changed
+    void updateMarks();
+
+    // Counts matches and marks of the histogram again, if it is shown
+    void updateTimeHistogram();
 
     // Reload predefined filters after changing settings
     void reloadPredefinedFilters() const;
@@ -326,6 +428,17 @@ class CrawlerWidget : public QSplitter,
     void setSearchPattern( const QString& searchPattern );
 
     void resetStateOnSearchPatternChanges();
+    // Compiles the pattern of the search line in background
+    void compileSearchPattern();
+    void searchPatternCompiled();
+
+    // Views highlight matches of the pattern if it is enabled in configuration
+    void updateSearchHighlighter( const RegularExpressionPattern& pattern );
+
+    // Finds lines of highlighters shown in the overview in background
+    void updateHighlighterLines();
+    void highlighterLinesFound();
+    void showExpressionError( const QString& errorString );
 
     void updateColorLabels( const ColorLabelsManager::QuickHighlightersCollection& labels );
 
@@ -342,6 +455,9 @@ class CrawlerWidget : public QSplitter,
     // Matches overview
     Overview overview_;
 
+    // Highlighters results shared by both views
+    HighlighterCache highlighterCache_;
+
     std::shared_ptr<QuickFindPattern> quickFindPattern_;
 
     LogMainView* logMainView_;
@@ -356,6 +472,13 @@ class CrawlerWidget : public QSplitter,
 
     QComboBox* searchLineEdit_;
     QMenu* searchLineContextMenu_;
+    QMenu* combineWithFilterMenu_;
+    QAction* sortByTimeAction_;
+    QAction* hideRepeatedLinesAction_;
+    QAction* showWholeRecordsAction_;
+
+    // Counts are updated while the histogram window is open
+    QPointer<TimeHistogramWidget> timeHistogram_;
     QCompleter* searchLineCompleter_;
 
     InfoLine* searchInfoLine_;
@@ -389,6 +512,10 @@ class CrawlerWidget : public QSplitter,
 
     // Current number of matches
     LinesCount nbMatches_;
+    // Matches expected by the running search, see LogFilteredData::searchEstimated
+    std::optional<LinesCount> estimatedMatches_;
+    // Lines matched by each pattern of the last boolean search
+    QString patternHits_;
 
     LineNumber searchStartLine_;
     LineNumber searchEndLine_;
@@ -397,8 +524,51 @@ class CrawlerWidget : public QSplitter,
     // should consider we are loading something.
     bool loadingInProgress_ = true;
     bool firstLoadDone_ = false;
-
-    std::vector<LineNumber> savedMarkedLines_;
+    // Set if the file has only grown since the last loading
+    bool dataAppended_ = false;
+
+    SearchResultArray savedMarks_;
+
+    // Restarts the search once typing pauses in live search mode
+    QTimer liveSearchTimer_;
+    // Otherwise matches of the typed pattern are counted once typing
+    // pauses, the count is shown until the search is started
+    QTimer matchCountTimer_;
+    std::optional<RegularExpressionPattern> countedPattern_;
+
+    // Pattern of the search line is compiled while it is typed, only one
+    // pattern is compiled at a time and only the latest one is queued
+    QFutureWatcher<std::shared_ptr<const RegularExpression>> expressionWatcher_;
+    RegularExpressionPattern compilingPattern_;
+    std::optional<RegularExpressionPattern> queuedPattern_;
+    RegularExpressionPattern compiledPattern_;
+    std::shared_ptr<const RegularExpression> compiledExpression_;
+
+    // Pattern of the search highlighted in views
+    RegularExpressionPattern highlightedPattern_;
+
+    // Lines of highlighters are found by one pass at a time, the pass
+    // is interrupted and started again if highlighters or lines change.
+    // Only appended lines are matched if highlighters are the same.
+    QFutureWatcher<std::vector<SearchResultArray>> highlighterLinesWatcher_;
+    std::shared_ptr<AtomicFlag> highlighterLinesInterrupt_ = std::make_shared<AtomicFlag>();
+    // Fingerprint of highlighters and number of lines they were matched in
+    std::pair<uint64_t, LinesCount> highlighterLinesKey_;
+    LineNumber highlighterLinesFirst_;
+    std::vector<QColor> highlighterLinesColors_;
+
+    // Appended lines are matched by one pass at a time, lines added
+    // while it runs are matched by the next one
+    std::shared_ptr<TailWatcher> tailWatcher_;
+    QFutureWatcher<std::vector<uint64_t>> tailWatchWatcher_;
+    std::shared_ptr<AtomicFlag> tailWatchInterrupt_ = std::make_shared<AtomicFlag>();
+    bool isTailWatchQueued_ = false;
+    bool isTailTruncated_ = false;
+    QStringList watchNames_;
+    // Patterns of the last filter chain, see editFilterChain
+    QStringList filterChain_;
+    std::vector<uint64_t> watchMatches_;
+    uint64_t unseenWatchMatches_ = 0;
 
     // Current encoding setting;
     std::optional<int> encodingMib_;
@@ -19,30 +19,63 @@
 #ifndef KLOGG_DECOMPRESSOR_H
 #define KLOGG_DECOMPRESSOR_H
 
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
 #include <QFile>
 #include <QFuture>
 #include <QFutureWatcher>
+#include <QStringList>
 
 #include "atomicflag.h"
+#include "regularexpressionpattern.h"
 
 enum class DecompressAction { None, Extract, Decompress };
+
+// File in a multi file archive
+struct ArchiveEntry {
+    // Path inside the archive
+    QString path;
+    qint64 size = 0;
+};
+
 class Decompressor : public QObject {
     Q_OBJECT
   public:
     explicit Decompressor( QObject* parent = nullptr );
+    // Interrupts decompression started in background and waits for it
+    ~Decompressor() override;
 
     bool decompress( const QString& path, QFile* outputFile, AtomicFlag& interrupt );
-    bool extract( const QString& archiveFilePath, const QString& destination,
-                  AtomicFlag& interrupt );
+    // Decompressed data is flushed to output file block by block,
+    // so the file can be read while it is written
+    bool decompressInBackground( const QString& path, QFile* outputFile );
+    // Extracts passed entries only, keeping their directories inside destination
+    bool extractEntries( const QString& archiveFilePath, const QStringList& entries,
+                         const QString& destination, AtomicFlag& interrupt );
 
     bool waitForResult();
 
     static DecompressAction action( const QString& archiveFilePath );
 
+    // Files of a zip, 7z or tar archive, empty if it can't be read
+    static std::vector<ArchiveEntry> listEntries( const QString& archiveFilePath );
+
+    // Lines matching the pattern in each of the entries. Entries are streamed
+    // through the matcher without writing them to disk, entries of zip archives
+    // are searched by a few threads, each of them opens the archive.
+    static std::vector<uint64_t> countMatches( const QString& archiveFilePath,
+                                               const std::vector<ArchiveEntry>& entries,
+                                               const RegularExpressionPattern& pattern,
+                                               const AtomicFlag& interrupt,
+                                               std::atomic<size_t>& searchedEntries );
+
   Q_SIGNALS:
     void finished( bool );
 
   private:
+    AtomicFlag interrupt_;
     QFuture<bool> future_;
     QFutureWatcher<bool> watcher_;
 };
@@ -66,6 +66,10 @@ class FilteredView : public AbstractLogView
     LineNumber lineIndex( LineNumber lineNumber ) const override;
     LineNumber maxDisplayLineNumber() const override;
 
+    LinesExporter linesExporter( LineNumber first, LinesCount count ) const override;
+    ValueAggregator valueAggregator() const override;
+    TemplateClusterer templateClusterer() const override;
+
     void doRegisterShortcuts() override;
 
   private:
@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_HIGHLIGHTERCACHE_H
+#define KLOGG_HIGHLIGHTERCACHE_H
+
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+#include <QString>
+
+#include "ansicolors.h"
+#include "highlightedmatch.h"
+#include "highlighterset.h"
+#include "linetypes.h"
+
+// Results of highlighters for lines of a file, shared by the views
+// showing that file. Lines are matched by all highlighters at once
+// and matched again only if the text or the highlighters have changed.
+class HighlighterCache {
+  public:
+    static constexpr size_t MaxLines = 10000;
+
+    // Cached results are dropped if highlighters are different from the previous ones
+    void setHighlighterSet( const HighlighterSet& highlighterSet );
+
+    // Line is the number of the line in the file
+    HighlighterMatchType matchLine( LineNumber line, const QString& text,
+                                    std::vector<HighlightedMatch>& matches );
+
+    // Colors of ANSI sequences of the line, they are parsed
+    // again only if the text of the line has changed
+    std::vector<AnsiColorSpan>
+    lineColors( LineNumber line, const QString& text,
+                const std::function<std::vector<AnsiColorSpan>()>& parseColors );
+
+    void clear();
+
+    // Approximate size of cached lines and matches
+    size_t allocatedSize() const;
+
+  private:
+    struct Entry {
+        QString text;
+        HighlighterMatchType matchType;
+        std::vector<HighlightedMatch> matches;
+    };
+
+    struct ColorsEntry {
+        QString text;
+        std::vector<AnsiColorSpan> colors;
+    };
+
+    HighlighterSet highlighterSet_;
+    uint64_t fingerprint_ = 0;
+    HsSpanMatcher matcher_;
+
+    std::unordered_map<LineNumber::UnderlyingType, Entry> lines_;
+    // Colors do not depend on highlighters, they are kept when highlighters change
+    std::unordered_map<LineNumber::UnderlyingType, ColorsEntry> colors_;
+};
+
+#endif
@@ -39,13 +39,18 @@
 #ifndef highlighterSet_H
 #define highlighterSet_H
 
+#include <cstdint>
+#include <vector>
+
 #include <QColor>
 #include <QMetaType>
 #include <QRegularExpression>
 #include <qcolor.h>
 
 #include "highlightedmatch.h"
+#include "hsspanmatcher.h"
 #include "persistable.h"
+#include "regularexpressionpattern.h"
 
 struct HighlightColor {
     QColor foreColor;
@@ -62,6 +67,17 @@ class Highlighter {
                  const QColor& backColor );
 
     bool matchLine( const QString& line, std::vector<HighlightedMatch>& matches ) const;
+    // Matches are spans the matcher finds for the pattern with the id,
+    // line is matched by the regex if matcher does not support it
+    bool matchLine( const QString& line, const HsSpanMatcher& matcher, unsigned id,
+                    std::vector<HighlightedMatch>& matches ) const;
+
+    // Pattern for matching many highlighters at once
+    RegularExpressionPattern regularExpressionPattern() const;
+
+    // Whether matches can be found by spans of HsSpanMatcher,
+    // which has no captures and merges adjacent matches
+    bool canMatchBySpans() const;
 
     // Accessor functions
     QString pattern() const;
@@ -93,8 +109,12 @@ class Highlighter {
   private:
     std::pair<QColor, QColor> vairateColors( const QString& match ) const;
 
+    // Compiles the regex used by matchLine after pattern or options change
+    void updateMatchingRegex();
+
   private:
     QRegularExpression regexp_;
+    QRegularExpression matchingRegex_;
 
     bool useRegex_ = true;
     bool highlightOnlyMatch_ = false;
@@ -123,8 +143,23 @@ class HighlighterSet {
 
     // Returns weither the passed line match a filter of the set,
     // if so, it returns the fore/back colors the line should use.
-    HighlighterMatchType matchLine( const QString& line,
-                                    std::vector<HighlightedMatch>& matches ) const;
+    // If matcher is passed, matches of supported highlighters are taken
+    // from its spans, other highlighters run their regexes.
+    HighlighterMatchType matchLine( const QString& line, std::vector<HighlightedMatch>& matches,
+                                    const HsSpanMatcher* matcher = nullptr ) const;
+
+    // Creates matcher finding matches of all highlighters with one scan,
+    // ids of highlighters are their positions in the set
+    HsSpanMatcher createMatcher() const;
+
+    // Patterns of all highlighters for matching them in one pass
+    // and colors of lines matched by each of them
+    std::vector<RegularExpressionPattern> patterns() const;
+    std::vector<QColor> lineColors() const;
+
+    // Changes when any highlighter of the set is changed,
+    // so matching results can be cached
+    uint64_t fingerprint() const;
 
     bool isEmpty() const;
 
@@ -57,6 +57,9 @@ class InfoLine : public QLabel {
     // Hide the gauge and make the widget like a normal QLabel
     void hideGauge();
 
+    // Text shown from the context menu, the action is hidden if it is empty
+    void setDetails( const QString& details );
+
   protected:
     void paintEvent( QPaintEvent* paintEvent ) override;
     void contextMenuEvent( QContextMenuEvent* event ) override;
@@ -64,6 +67,8 @@ class InfoLine : public QLabel {
   private:
     // The original palette of the QLabel
     std::optional<QPalette> origPalette_;
+
+    QString details_;
 };
 
 #endif
@@ -63,9 +63,18 @@ class LogMainView : public AbstractLogView
     // Implements the virtual function
     LogData::LineType lineType( LineNumber lineNumber ) const override;
 
+    LinesExporter linesExporter( LineNumber first, LinesCount count ) const override;
+    ValueAggregator valueAggregator() const override;
+    TemplateClusterer templateClusterer() const override;
+
+    LinesCount estimatedNbLines() const override;
+    LinesPreview linesPreview( LineNumber line, LinesCount count ) const override;
+    OptionalLineNumber indexedLineAtOffset( qint64 offset ) const override;
+
     void doRegisterShortcuts() override;
 
   private:
+    const LogData* sourceLogData_;
     LogFilteredData* filteredData_;
 };
 
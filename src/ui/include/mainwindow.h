@@ -40,6 +40,7 @@
 #define MAINWINDOW_H
 
 #include <QMainWindow>
+#include <QPointer>
 #include <QSystemTrayIcon>
 #include <QTemporaryDir>
 
@@ -93,6 +94,8 @@ class MainWindow : public QMainWindow {
     void dropEvent( QDropEvent* event ) override;
 
     bool event( QEvent* event ) override;
+    // Shows memory usage of the current file in the tooltip of its size
+    bool eventFilter( QObject* watched, QEvent* event ) override;
 
   private:
     enum class ActionInitiator { User, App };
@@ -108,12 +111,16 @@ class MainWindow : public QMainWindow {
     void selectAll();
     void copy();
     void find();
+    void searchAllTabs();
+    void compareWithOpenedFile();
     void clearLog();
     void copyFullPath();
     void openContainingFolder();
     void openInEditor();
     void openClipboard();
     void openUrl();
+    void openAnalysisBundle();
+    void exportAnalysisBundle();
     void editHighlighters();
     void editPredefinedFilters( const QString& newFilter = {} );
     void options();
@@ -151,6 +158,8 @@ class MainWindow : public QMainWindow {
     // without the progress gauge and with file info
     // or an error recovery when loading is finished
     void handleLoadingFinished( LoadingStatus status );
+    // Notifies about new lines matching watched filters in a file
+    void showWatchNotification( const QString& fileName, const QString& message );
 
     // Save the new state as default setting when a crawler
     // is changing their view options.
@@ -192,6 +201,7 @@ class MainWindow : public QMainWindow {
     void writeSettings();
     bool loadFile( const QString& fileName, bool followFile = false );
     bool extractAndLoadFile( const QString& fileName );
+    bool decompressAndLoadFile( const QString& fileName );
     void openRemoteFile( const QUrl& url );
     void updateTitleBar( const QString& fileName );
     void addRecentFile( const QString& fileName );
@@ -245,12 +255,16 @@ class MainWindow : public QMainWindow {
     QAction* selectAllAction;
     QAction* goToLineAction;
     QAction* findAction;
+    QAction* searchAllTabsAction;
+    QAction* compareFilesAction;
     QAction* clearLogAction;
     QAction* copyPathToClipboardAction;
     QAction* openContainingFolderAction;
     QAction* openInEditorAction;
     QAction* openClipboardAction;
     QAction* openUrlAction;
+    QAction* openAnalysisBundleAction;
+    QAction* exportAnalysisBundleAction;
     QAction* overviewVisibleAction;
     QAction* lineNumbersVisibleInMainAction;
     QAction* lineNumbersVisibleInFilteredAction;
@@ -304,6 +318,18 @@ class MainWindow : public QMainWindow {
     bool isMaximized_ = false;
     bool isCloseFromTray_ = false;
 
+    // Tabs activated while session is restored are not loaded
+    bool isRestoringSession_ = false;
+
+    // File of the current tab, its work is scheduled before other files
+    QString foregroundFile_;
+
+    // Crawler of the current tab, others are suspended
+    QPointer<CrawlerWidget> activeCrawler_;
+
+    // Owns connections to tabs searched by the last search of all tabs
+    QPointer<QObject> allTabsSearch_;
+
     std::once_flag screenChangesConnect_;
 };
 
@@ -96,6 +96,7 @@ class OptionsDialog : public QDialog, public Ui::OptionsDialog {
     void setupSearchResultsCache();
     void setupLogging();
     void setupArchives();
+    void setupDeviceTuning();
     void setupStyles();
     void setupEncodings();
 
@@ -21,9 +21,14 @@
 #define OVERVIEW_H
 
 #include "linetypes.h"
+#include "logfiltereddataworker.h"
+#include <QColor>
 #include <QList>
 #include <QVector>
 
+#include <utility>
+#include <vector>
+
 class LogFilteredData;
 
 // Class implementing the logic behind the matches overview bar.
@@ -70,6 +75,12 @@ class Overview {
         int weight_;
     };
 
+    // Lines of the file matched by a highlighter
+    struct HighlighterLines {
+        QColor color;
+        SearchResultArray lines;
+    };
+
     Overview();
 
     // Associate the passed filteredData to this Overview
@@ -78,6 +89,9 @@ class Overview {
     // the overview must be updated with the provided total number
     // of line of the file.
     void updateData( LinesCount totalNbLine );
+    // Signal the overview the search has found more matches, only
+    // these matches are added if nothing else has changed.
+    void addNewMatches( LinesCount totalNbLine );
     // Set the visibility flag of this overview.
     void setVisible( bool visible )
     {
@@ -92,11 +106,23 @@ class Overview {
         nbLines_ = LinesCount( lastLine.get() - firstLine.get() );
     }
 
+    // While suspended, e.g. in an inactive tab, matches are not counted,
+    // all lines are recalculated when the overview is shown again.
+    void setSuspended( bool suspended )
+    {
+        suspended_ = suspended;
+        dirty_ = dirty_ || suspended;
+    }
+
     // Returns weither this overview is visible.
     bool isVisible()
     {
         return visible_;
     }
+    // Replaces lines of highlighters, they are found separately from matches
+    void setHighlighterLines( std::vector<HighlighterLines> highlighterLines );
+    // Adds lines found in lines appended to the file to lines of each highlighter
+    void appendHighlighterLines( const std::vector<SearchResultArray>& lines );
     // Signal the overview the height of the display has changed, triggering
     // an update of its cache.
     void updateView( unsigned height );
@@ -106,8 +132,21 @@ class Overview {
     // Returns a list of lines (between 0 and 'height') representing marks.
     // (pointer returned is valid until next call to update*()
     const std::vector<WeightedLine>* getMarkLines() const;
+    // Returns a list of lines (between 0 and 'height') where matches are
+    // expected, but not searched yet.
+    // (pointer returned is valid until next call to update*()
+    const std::vector<WeightedLine>* getEstimatedLines() const;
+    // Returns lines (between 0 and 'height') of each highlighter with its color.
+    // (pointer returned is valid until next call to update*()
+    const std::vector<std::pair<QColor, std::vector<WeightedLine>>>* getHighlighterLines() const;
     // Return a pair of lines (between 0 and 'height') representing the current view.
     std::pair<int, int> getViewLines() const;
+    // Changes every time lists of lines are updated, so clients can keep
+    // what they drew from them until then
+    uint64_t getLinesRevision() const
+    {
+        return linesRevision_;
+    }
 
     // Return the line number corresponding to the passed overview y coordinate.
     LineNumber fileLineFromY( int y ) const;
@@ -121,6 +160,8 @@ class Overview {
     LinesCount linesInFile_;
     // Whether the overview is visible.
     bool visible_;
+    // Whether the overview is in an inactive tab.
+    bool suspended_ = false;
     // First and last line currently viewed.
     LineNumber topLine_;
     LinesCount nbLines_;
@@ -128,10 +169,19 @@ class Overview {
     unsigned height_;
     // Does the cache (matchesLines, markLines) need to be recalculated.
     bool dirty_;
+    uint64_t linesRevision_ = 0;
 
     // List of lines representing matches and marks (are shared with the client)
     std::vector<WeightedLine> matchLines_;
     std::vector<WeightedLine> markLines_;
+    std::vector<WeightedLine> estimatedLines_;
+
+    std::vector<HighlighterLines> highlighters_;
+    std::vector<std::pair<QColor, std::vector<WeightedLine>>> highlighterLines_;
+
+    // Numbers of matched and marked lines shown at each position
+    std::vector<LinesCount::UnderlyingType> matchCounts_;
+    std::vector<LinesCount::UnderlyingType> markCounts_;
 
     void recalculatesLines();
 };
@@ -21,6 +21,7 @@
 #define OVERVIEWWIDGET_H
 
 #include <QBasicTimer>
+#include <QImage>
 #include <QWidget>
 
 #include "linetypes.h"
@@ -37,6 +38,7 @@ class OverviewWidget : public QWidget {
     void setOverview( Overview* overview )
     {
         overview_ = overview;
+        linesImage_ = QImage{};
     }
 
   public Q_SLOTS:
@@ -58,6 +60,7 @@ class OverviewWidget : public QWidget {
   private:
     // Constants
     static constexpr int LINE_MARGIN = 4;
+    static constexpr int HIGHLIGHTER_STRIPE_WIDTH = 2;
     static constexpr int STEP_DURATION_MS = 30;
     static constexpr int INITIAL_TTL_VALUE = 5;
 
@@ -71,7 +74,13 @@ class OverviewWidget : public QWidget {
 
     QBasicTimer highlightTimer_;
 
+    // Lines of matches, marks and highlighters drawn for a revision
+    // of the overview, painting only copies the image
+    QImage linesImage_;
+    uint64_t linesImageRevision_ = 0;
+
     void handleMousePress( int position );
+    QImage drawLinesImage() const;
 };
 
 #endif
@@ -49,6 +49,10 @@ struct PredefinedFilter {
     QString name;
     QString pattern;
     bool useRegex;
+    // Searched in the background when a file is opened, see LogFilteredData::prerunSearches
+    bool isPinned = false;
+    // Matched in lines appended to followed files, see TailWatcher
+    bool isWatched = false;
 };
 
 // Represents collection of filters read from settings file.
@@ -39,6 +39,12 @@
 #ifndef QUICKFIND_H
 #define QUICKFIND_H
 
+#include <functional>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
 #include <QFuture>
 #include <QFutureWatcher>
 #include <QObject>
@@ -46,9 +52,11 @@
 #include <QTime>
 
 #include "atomicflag.h"
+#include "logfiltereddataworker.h"
 #include "qfnotifications.h"
 #include "quickfindpattern.h"
 #include "selection.h"
+#include "synchronization.h"
 
 class QuickFindPattern;
 class AbstractLogData;
@@ -97,15 +105,28 @@ class QuickFind : public QObject {
     Q_OBJECT
 
   public:
+    // Returns already known lines of the file matching a regular expression,
+    // together with the line where these results end
+    using MatchesProvider = std::function<std::optional<std::pair<SearchResultArray, LineNumber>>(
+        const QRegularExpression& )>;
+
     // Construct a search
     explicit QuickFind( const AbstractLogData& logData );
 
+    // Set the source of known matches, it is called from the main thread
+    // before searching so that lines found by the main search are not read again
+    void setMatchesProvider( MatchesProvider provider );
+
     // Set the starting point that will be used by the next search
     void setSearchStartPoint( QPoint startPoint );
 
     // Make the object forget the 'no more match' flag.
     void resetLimits();
 
+    // Make the object forget matching lines found so far,
+    // to be called when the data is changed
+    void resetMatchIndex();
+
   public Q_SLOTS:
     // Used for incremental searches
     // Return the first occurrence of the passed pattern from the starting
@@ -206,13 +227,52 @@ class QuickFind : public QObject {
         Selection initialSelection_;
     };
 
+    // Lines that can match the regular expression of the last search,
+    // known for a contiguous range of scanned lines of the file.
+    // When a literal pattern is extended, lines matching the previous one
+    // are kept as candidates. Used by search threads and the main thread.
+    class MatchIndex {
+      public:
+        // Forget all matches if the regular expression is different
+        void setRegexp( const QRegularExpression& regexp );
+        void reset();
+
+        // Set the lines known to match from the start of the file up to the end line
+        void setMatches( SearchResultArray matches, LineNumber end );
+        // Add matches found by scanning lines, known matches are replaced
+        // if the scanned lines are not next to them
+        void addScanned( const QRegularExpression& regexp, LineNumber begin, LineNumber end,
+                         const std::vector<LineNumber>& matches );
+
+        bool isEmpty() const;
+        bool isScanned( LineNumber line ) const;
+        LineNumber scannedBegin() const;
+        LineNumber scannedEnd() const;
+
+        // First match at or after the line, among the scanned lines
+        OptionalLineNumber nextMatch( LineNumber line ) const;
+        // Last match before the line, among the scanned lines
+        OptionalLineNumber previousMatch( LineNumber line ) const;
+
+      private:
+        mutable Mutex mutex_;
+        QRegularExpression regexp_;
+        SearchResultArray matches_;
+        LineNumber scannedBegin_;
+        LineNumber scannedEnd_;
+    };
+
     // Pointers to external objects
     const AbstractLogData& logData_;
 
+    MatchesProvider matchesProvider_;
+    MatchIndex matchIndex_;
+
     // Owned objects
 
     // Position of the last match in the file
     // (to avoid searching multiple times where there is no result)
+    mutable Mutex limitsMutex_;
     LastMatchPosition lastMatch_;
     LastMatchPosition firstMatch_;
 
@@ -222,14 +282,22 @@ class QuickFind : public QObject {
     IncrementalSearchStatus incrementalSearchStatus_;
 
     // Private functions
-    Portion doSearchForward( const Selection& selection, const QuickFindMatcher& matcher );
+    void prepareMatchIndex( const QuickFindMatcher& matcher );
+    void cancelSearch();
+    void startSearch( std::function<Portion( const AtomicFlag& )> search );
+    bool isAfterLastMatch( const FilePosition& position ) const;
+    bool isBeforeFirstMatch( const FilePosition& position ) const;
     Portion doSearchForward( const FilePosition& start_position, const Selection& selection,
-                             const QuickFindMatcher& matcher );
-    Portion doSearchBackward( const Selection& selection, const QuickFindMatcher& matcher );
+                             const QuickFindMatcher& matcher,
+                             const AtomicFlag& interruptRequested );
     Portion doSearchBackward( const FilePosition& start_position, const Selection& selection,
-                              const QuickFindMatcher& matcher );
+                              const QuickFindMatcher& matcher,
+                              const AtomicFlag& interruptRequested );
 
-    AtomicFlag interruptRequested_;
+    // Each search has its own flag so that a new one can start
+    // without waiting for the cancelled one to stop
+    std::shared_ptr<AtomicFlag> interruptRequested_ = std::make_shared<AtomicFlag>();
+    std::vector<QFuture<Portion>> cancelledSearches_;
     QFuture<Portion> operationFuture_;
     QFutureWatcher<Portion> operationWatcher_;
 };
@@ -64,6 +64,11 @@ class QuickFindMatcher {
         return isActive_;
     }
 
+    const QRegularExpression& regexp() const
+    {
+        return regexp_;
+    }
+
     // Returns whether there is a match in the passed line, starting at
     // the passed column.
     // Results are stored internally.
@@ -72,6 +77,10 @@ class QuickFindMatcher {
     // Same as isLineMatching but search backward
     bool isLineMatchingBackward( const QString& line, int column = -1 ) const;
 
+    // Returns whether there is a match anywhere in the passed line,
+    // does not store results so can be called from several threads.
+    bool hasMatch( const QString& line ) const;
+
     // Must be called when isLineMatching returns 'true', returns
     // the position of the first match found.
     void getLastMatch( int* start_col, int* end_col ) const;
@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_RENDEREDTILECACHE_H
+#define KLOGG_RENDEREDTILECACHE_H
+
+#include <map>
+#include <vector>
+
+#include <QPixmap>
+#include <QSize>
+
+#include "linetypes.h"
+
+// Text area drawn at screens of lines around the view, so a view scrolled
+// or jumped to any line near it is put together from two tiles instead of
+// being drawn again. Each tile has the size of the text area and starts at
+// a multiple of the number of lines it shows.
+// Tiles are drawn for one layout of the view, they are all dropped when
+// it changes. Tiles with lines drawn differently have to be removed.
+class RenderedTileCache {
+  public:
+    // Screens of tiles kept above and below the view at most
+    static constexpr int MaxScreens = 2;
+    // Fewer screens are kept if their pixmaps are bigger than this
+    static constexpr qint64 MaxBytes = 64 * 1024 * 1024;
+
+    struct Layout {
+        LinesCount tileLines;
+        int firstColumn = 0;
+        QSize size;
+        qreal pixelRatio = 1.0;
+
+        bool operator==( const Layout& other ) const
+        {
+            return tileLines == other.tileLines && firstColumn == other.firstColumn
+                   && size == other.size && pixelRatio == other.pixelRatio;
+        }
+        bool operator!=( const Layout& other ) const
+        {
+            return !( *this == other );
+        }
+    };
+
+    // Tiles drawn for another layout are dropped
+    void setLayout( const Layout& layout );
+    const Layout& layout() const;
+
+    // Start of the tile showing the line
+    LineNumber tileStart( LineNumber line ) const;
+
+    // Null pixmap if the tile is not drawn
+    QPixmap find( LineNumber tileStart ) const;
+    bool contains( LineNumber tileStart ) const;
+    void insert( LineNumber tileStart, QPixmap tile );
+
+    // Drops tiles showing any of the lines
+    void removeLines( LineNumber first, LinesCount count );
+    void clear();
+
+    // Drops tiles too far from the view at the line
+    void trim( LineNumber viewLine );
+
+    // Starts of the tiles around the view at the line that are not drawn,
+    // nearest to the view first. Tiles start before the last line.
+    std::vector<LineNumber> missingTiles( LineNumber viewLine, LinesCount nbLines ) const;
+
+    size_t size() const;
+
+  private:
+    // Screens kept around the view for the current layout
+    int screens() const;
+    bool isNearView( LineNumber tileStart, LineNumber viewLine ) const;
+
+  private:
+    Layout layout_;
+    std::map<LineNumber::UnderlyingType, QPixmap> tiles_;
+};
+
+#endif
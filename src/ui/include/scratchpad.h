@@ -20,11 +20,19 @@
 #ifndef SCRATCHPAD_H
 #define SCRATCHPAD_H
 
+#include <QFutureWatcher>
+#include <QTextCursor>
+#include <QTimer>
 #include <QWidget>
 
+#include <atomic>
+#include <cstdint>
 #include <functional>
 #include <qobjectdefs.h>
 
+#include "atomicflag.h"
+
+class QAction;
 class QPlainTextEdit;
 class QStatusBar;
 class QLineEdit;
@@ -34,7 +42,7 @@ class ScratchPad : public QWidget {
   public:
     explicit ScratchPad( QWidget* parent = nullptr );
 
-    ~ScratchPad() = default;
+    ~ScratchPad() override;
     ScratchPad( const ScratchPad& ) = delete;
     ScratchPad& operator=( const ScratchPad& ) = delete;
 
@@ -46,14 +54,22 @@ class ScratchPad : public QWidget {
     void updateTransformation();
 
   private Q_SLOTS:
-    void crc32Hex();
-    void crc32Dec();
+    void crc32();
     void unixTime();
     void fileTime();
     void decToHex();
     void hexToDec();
 
+    void crc32Calculated();
+
+    void transformFinished();
+    void showTransformProgress();
+    void stopTransform();
+
   private:
+    using TextTransform = std::function<QByteArray( const QByteArray&, const AtomicFlag&,
+                                                    std::atomic<uint64_t>& )>;
+
     void decodeBase64();
     void encodeBase64();
 
@@ -65,13 +81,18 @@ class ScratchPad : public QWidget {
 
     void decodeUrl();
 
+    QString selectedText( QTextCursor& cursor ) const;
+
     QString transformText( const std::function<QString( QString )>& transform );
 
-    void transformTextInPlace( const std::function<QString( QString )>& transform );
+    // Runs transform of utf-8 text in background, the result replaces
+    // the text when it is done. Text can't be edited until then.
+    void transformTextInPlace( const TextTransform& transform );
 
   private:
     QPlainTextEdit* textEdit_;
     QStatusBar* statusBar_;
+    QAction* stopTransformAction_;
 
     QLineEdit* crc32HexBox_;
     QLineEdit* crc32DecBox_;
@@ -79,6 +100,17 @@ class ScratchPad : public QWidget {
     QLineEdit* fileTimeBox_;
     QLineEdit* decToHexBox_;
     QLineEdit* hexToDecBox_;
+
+    QFutureWatcher<QString> transformWatcher_;
+    QTextCursor transformCursor_;
+    AtomicFlag transformInterrupt_;
+    std::atomic<uint64_t> transformSize_{};
+    std::atomic<uint64_t> transformedBytes_{};
+    QTimer transformProgressTimer_;
+
+    QFutureWatcher<quint32> crc32Watcher_;
+    // Text changed while its checksum was calculated
+    bool isCrc32Outdated_ = false;
 };
 
 #endif // SCRATCHPAD_H
\ No newline at end of file
@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_SCRATCHPADTRANSFORMS_H
+#define KLOGG_SCRATCHPADTRANSFORMS_H
+
+#include <atomic>
+#include <cstdint>
+
+#include <QByteArray>
+
+#include "atomicflag.h"
+
+// Transformations of scratchpad text. Each of them reads utf-8 text once
+// and writes the result as it goes, without building a document of the text
+// or copying all of it. Bytes of text read so far are stored in processedBytes.
+// If interruption is requested the result written so far is returned.
+namespace scratchpad {
+
+// Pretty prints json starting at the first '{' or '[' up to the end
+// of that value, strings and numbers are kept as they are
+QByteArray formatJson( const QByteArray& text, const AtomicFlag& interruptRequested,
+                       std::atomic<uint64_t>& processedBytes );
+
+// Pretty prints xml starting at the first '<', up to the first error
+QByteArray formatXml( const QByteArray& text, const AtomicFlag& interruptRequested,
+                      std::atomic<uint64_t>& processedBytes );
+
+// Characters outside of base64 and hex alphabets are skipped by decoders
+QByteArray decodeBase64( const QByteArray& text, const AtomicFlag& interruptRequested,
+                         std::atomic<uint64_t>& processedBytes );
+QByteArray encodeBase64( const QByteArray& text, const AtomicFlag& interruptRequested,
+                         std::atomic<uint64_t>& processedBytes );
+
+QByteArray decodeHex( const QByteArray& text, const AtomicFlag& interruptRequested,
+                      std::atomic<uint64_t>& processedBytes );
+QByteArray encodeHex( const QByteArray& text, const AtomicFlag& interruptRequested,
+                      std::atomic<uint64_t>& processedBytes );
+
+QByteArray decodeUrl( const QByteArray& text, const AtomicFlag& interruptRequested,
+                      std::atomic<uint64_t>& processedBytes );
+
+} // namespace scratchpad
+
+#endif // KLOGG_SCRATCHPADTRANSFORMS_H
@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_SEARCHHIGHLIGHTER_H
+#define KLOGG_SEARCHHIGHLIGHTER_H
+
+#include <vector>
+
+#include <QColor>
+#include <QString>
+
+#include "highlightedmatch.h"
+#include "highlighterset.h"
+#include "hsspanmatcher.h"
+#include "regularexpressionpattern.h"
+
+// Highlights matches of the current search in lines of both views.
+// Pattern is compiled once per search into a Hyperscan database with
+// start of match reporting, its spans are the highlighted matches.
+// Patterns Hyperscan rejects are matched by the regular expression.
+class SearchHighlighter {
+  public:
+    SearchHighlighter( const RegularExpressionPattern& pattern, bool variateColors,
+                       const QColor& backColor );
+
+    // Only plain and regular expression patterns are highlighted
+    static bool canHighlight( const RegularExpressionPattern& pattern );
+
+    bool matchLine( const QString& line, std::vector<HighlightedMatch>& matches ) const;
+
+  private:
+    Highlighter highlighter_;
+    HsSpanMatcher matcher_;
+};
+
+#endif
@@ -23,6 +23,8 @@
 #include <QList>
 #include <QString>
 #include <cstddef>
+#include <optional>
+#include <utility>
 
 #include "linetypes.h"
 
@@ -138,6 +140,9 @@ class Selection {
     Portion getPortionForLine( LineNumber line ) const;
     // Get a list of selected line(s), in order.
     std::vector<LineNumber> getLines() const;
+    // Get the first and the number of selected lines,
+    // empty if no whole lines are selected.
+    std::optional<std::pair<LineNumber, LinesCount>> getLineRange() const;
 
     // Returns wether the line passed is selected (entirely).
     bool isLineSelected( LineNumber line ) const;
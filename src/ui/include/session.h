@@ -20,16 +20,21 @@
 #ifndef SESSION_H
 #define SESSION_H
 
+#include <deque>
 #include <functional>
+#include <map>
 #include <memory>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
 #include <QByteArray>
 #include <QDateTime>
+#include <QString>
 
+#include "fileholder.h"
 #include "log.h"
 #include "quickfindpattern.h"
 
@@ -75,6 +80,12 @@ class Session : public std::enable_shared_from_this<Session> {
     // Throw an exception if it does not exist.
     void close( const ViewInterface* view );
 
+    // Start loading of a restored file if it was deferred
+    void loadDeferred( const ViewInterface* view );
+
+    // Load deferred files in background, at most sessionBackgroundLoaders at once
+    void loadDeferredInBackground();
+
     // Get the file name for the passed view.
     QString getFilename( const ViewInterface* view ) const;
 
@@ -112,6 +123,12 @@ class Session : public std::enable_shared_from_this<Session> {
         std::shared_ptr<LogData> logData;
         std::shared_ptr<LogFilteredData> logFilteredData;
         ViewInterface* view;
+
+        // Files restored from session are not loaded until needed,
+        // their size and lines count are taken from the session
+        bool isLoaded = true;
+        uint64_t cachedFileSize = 0;
+        uint64_t cachedNbLines = 0;
     };
 
     // Open a file without checking if it is existing/readable
@@ -119,6 +136,20 @@ class Session : public std::enable_shared_from_this<Session> {
                                const std::function<ViewInterface*()>& view_factory,
                                const QString& view_context );
 
+    // Create a view for a file without starting to load it
+    ViewInterface* openDeferred( const QString& file_name,
+                                 const std::function<ViewInterface*()>& view_factory,
+                                 const QString& view_context, uint64_t file_size,
+                                 uint64_t nb_lines );
+
+    void backgroundLoadingFinished( const ViewInterface* view );
+
+    // Returns data of the file attached for another view if the file
+    // on disk is still the same one, empty otherwise
+    std::shared_ptr<LogData> findSharedLogData( const QString& file_name ) const;
+    // Lets other views of the file use its attached data
+    void shareLogData( const QString& file_name, const std::shared_ptr<LogData>& log_data );
+
     // Find an open file from its associated view
     OpenFile* findOpenFileFromView( const ViewInterface* view );
     const OpenFile* findOpenFileFromView( const ViewInterface* view ) const;
@@ -127,12 +158,24 @@ class Session : public std::enable_shared_from_this<Session> {
     typedef std::unordered_map<const ViewInterface*, OpenFile> OpenFileMap;
     OpenFileMap openFiles_;
 
+    // Data of attached files by their canonical paths. Views of the same
+    // file share its index and file watcher, each has own search results.
+    struct SharedLogData {
+        FileId fileId;
+        std::weak_ptr<LogData> logData;
+    };
+    std::map<QString, SharedLogData> sharedLogData_;
+
     // Global search history
     SavedSearches* savedSearches_;
 
     // Global quickfind pattern
     std::shared_ptr<QuickFindPattern> quickFindPattern_;
 
+    // Restored files waiting to be loaded, in order of tabs
+    std::deque<const ViewInterface*> deferredViews_;
+    std::unordered_set<const ViewInterface*> backgroundLoads_;
+
     bool exitRequested_ = false;
 
     friend class WindowSession;
@@ -158,6 +201,16 @@ class WindowSession {
         return appSession_->open( file_name, view_factory );
     }
 
+    void loadDeferred( const ViewInterface* view )
+    {
+        appSession_->loadDeferred( view );
+    }
+
+    void loadDeferredInBackground()
+    {
+        appSession_->loadDeferredInBackground();
+    }
+
     void close( const ViewInterface* view )
     {
         auto it = std::find( openedFiles_.begin(), openedFiles_.end(), getFilename( view ) );
@@ -200,8 +253,8 @@ class WindowSession {
         return windowIndex_;
     }
 
-    // Open all the files listed in the stored session
-    // (see ::open)
+    // Create views for all the files listed in the stored session,
+    // files are loaded only by loadDeferred or loadDeferredInBackground
     // returns a vector of pairs (file_name, view) and the index of the
     // current file (or -1 if none).
     OpenedFilesList restore( const std::function<ViewInterface*()>& view_factory,
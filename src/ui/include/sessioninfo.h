@@ -67,6 +67,10 @@ class SessionInfo : public Persistable<SessionInfo, session_settings> {
         QString fileName;
         uint64_t topLine;
 
+        // Shown for files that are restored but not loaded yet
+        uint64_t fileSize = 0;
+        uint64_t nbLines = 0;
+
         // The view context contains parameter specific to the view's
         // implementation (such as geometry...)
         QString viewContext;
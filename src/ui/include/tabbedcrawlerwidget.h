@@ -20,6 +20,8 @@
 #ifndef TABBEDCRAWLERWIDGET_H
 #define TABBEDCRAWLERWIDGET_H
 
+#include <cstdint>
+
 #include <QTabBar>
 #include <QTabWidget>
 
@@ -49,6 +51,21 @@ class TabbedCrawlerWidget : public QTabWidget {
             }
         } );
 
+        connect( crawler, &T::watchMatchesChanged, this,
+                 [ this, fileName ]( uint64_t unseenMatches, const QString& counters ) {
+                     const auto tabsCount = count();
+                     for ( int i = 0; i < tabsCount; ++i ) {
+                         if ( tabPathAt( i ) == fileName ) {
+                             setTabWatchMatches( i, unseenMatches, counters );
+                             return;
+                         }
+                     }
+                 } );
+
+        connect( crawler, &T::watchesMatched, this, [ this, fileName ]( const QString& message ) {
+            Q_EMIT watchesMatched( fileName, message );
+        } );
+
         addTabBarItem( index, fileName );
 
         return index;
@@ -56,6 +73,10 @@ class TabbedCrawlerWidget : public QTabWidget {
 
     void removeCrawler( int index );
 
+  Q_SIGNALS:
+    // Sent when lines appended to the file of a tab match watched filters
+    void watchesMatched( const QString& fileName, const QString& message );
+
   protected:
     void keyPressEvent( QKeyEvent* event ) override;
     void mouseReleaseEvent( QMouseEvent* event ) override;
@@ -67,6 +88,8 @@ class TabbedCrawlerWidget : public QTabWidget {
 
     // Set the data status (icon) for the tab number 'index'
     void setTabDataStatus( int index, DataStatus status );
+    // Tab with watch matches not seen yet is highlighted, its tooltip has the counters
+    void setTabWatchMatches( int index, uint64_t unseenMatches, const QString& counters );
 
     void loadIcons();
     void updateIcon( int index );
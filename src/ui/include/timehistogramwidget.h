@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_TIMEHISTOGRAMWIDGET_H
+#define KLOGG_TIMEHISTOGRAMWIDGET_H
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include <QWidget>
+
+#include "linetypes.h"
+#include "logdata.h"
+
+// Bars of matches and marks in consecutive time intervals of a file
+class TimeHistogramWidget : public QWidget {
+    Q_OBJECT
+
+  public:
+    explicit TimeHistogramWidget( QWidget* parent = nullptr );
+
+    void setBuckets( const TimeBuckets& buckets );
+
+    const TimeBuckets& buckets() const
+    {
+        return buckets_;
+    }
+
+    // Numbers of matches and marks in each interval
+    void setCounts( std::vector<uint64_t> matches, std::vector<uint64_t> marks );
+
+    QSize sizeHint() const override;
+
+  Q_SIGNALS:
+    // Sent when the user clicks on an interval, line is the first one of it
+    void lineClicked( LineNumber line );
+
+  protected:
+    void paintEvent( QPaintEvent* paintEvent ) override;
+    void mousePressEvent( QMouseEvent* mouseEvent ) override;
+    void mouseMoveEvent( QMouseEvent* mouseEvent ) override;
+
+  private:
+    std::optional<size_t> bucketAt( int x ) const;
+    QRect barsRect() const;
+
+  private:
+    TimeBuckets buckets_;
+    std::vector<uint64_t> matches_;
+    std::vector<uint64_t> marks_;
+};
+
+#endif
@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_WRAPINDEX_H
+#define KLOGG_WRAPINDEX_H
+
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "linetypes.h"
+
+// Rows lines take when they are wrapped at a number of columns.
+// Lines are grouped in blocks, rows of blocks are summed in a Fenwick
+// tree, so the row of a line and the line at a row are found in log time.
+// Blocks that are not measured count one row per line. They are measured
+// when they are shown, so wrapping a big file does not read all of it.
+class WrapIndex {
+  public:
+    static constexpr LinesCount::UnderlyingType BlockLines = 1024;
+
+    using LineLengthGetter = std::function<LineLength( LineNumber )>;
+
+    // Forgets measured blocks
+    void reset( LinesCount nbLines, int columns );
+
+    // Lines are appended or removed, blocks before the last
+    // one of both old and new lines are kept
+    void resize( LinesCount nbLines );
+
+    LinesCount nbLines() const
+    {
+        return nbLines_;
+    }
+
+    int columns() const
+    {
+        return columns_;
+    }
+
+    uint64_t nbRows() const;
+
+    // Measures blocks of lines in [first, first + count),
+    // returns true if any of them was not measured before
+    bool measure( LineNumber first, LinesCount count, const LineLengthGetter& lineLength );
+
+    // First not measured line of the block closest to the line,
+    // empty if all blocks are measured
+    std::optional<LineNumber> unmeasuredLineNear( LineNumber line ) const;
+
+    size_t measuredBlocks() const
+    {
+        return wrappedLines_.size();
+    }
+
+    int lineRows( LineNumber line ) const;
+
+    // Row of the first part of the line
+    uint64_t firstRow( LineNumber line ) const;
+
+    // Line at the row and the part of it at the row
+    std::pair<LineNumber, int> lineAtRow( uint64_t row ) const;
+
+  private:
+    // Lines with more than one row of a measured block,
+    // offset in the block and the number of rows
+    using WrappedLines = std::vector<std::pair<uint32_t, uint32_t>>;
+
+    size_t nbBlocks() const;
+    LinesCount::UnderlyingType blockSize( size_t block ) const;
+
+    void buildTree();
+    void addRows( size_t block, int64_t rows );
+    // Sum of rows of blocks before the block
+    uint64_t rowsBefore( size_t block ) const;
+
+  private:
+    LinesCount nbLines_;
+    int columns_ = 1;
+
+    std::vector<uint64_t> blockRows_;
+    std::vector<uint64_t> tree_;
+    std::unordered_map<size_t, WrappedLines> wrappedLines_;
+};
+
+#endif
@@ -44,6 +44,7 @@
 // pattern.
 
 #include <algorithm>
+#include <array>
 #include <cassert>
 #include <cmath>
 #include <complex>
@@ -60,6 +61,7 @@
 #include <qpen.h>
 #include <qwidget.h>
 #include <string_view>
+#include <tuple>
 #include <utility>
 #include <vector>
 
@@ -67,36 +69,52 @@
 #include <QActionGroup>
 #include <QApplication>
 #include <QClipboard>
+#include <QDialog>
+#include <QDialogButtonBox>
 #include <QFile>
+#include <QFontDatabase>
+#include <QFontInfo>
 #include <QFileDialog>
 #include <QFontMetrics>
 #include <QGestureEvent>
+#include <QHeaderView>
 #include <QInputDialog>
+#include <QLabel>
+#include <QLineEdit>
 #include <QMenu>
+#include <QMessageBox>
 #include <QPaintEvent>
 #include <QPainter>
 #include <QPalette>
+#include <QPicture>
 #include <QProgressDialog>
 #include <QRect>
+#include <QRegion>
 #include <QScrollBar>
 #include <QShortcut>
+#include <QSignalBlocker>
+#include <QTableWidget>
+#include <QVBoxLayout>
+#include <QtConcurrent>
 #include <QtCore>
 
-#include <tbb/flow_graph.h>
-
 #include "abstractlogview.h"
 #include "linetypes.h"
 
 #include "configuration.h"
+#include "highlightercache.h"
 #include "highlighterset.h"
 #include "highlightersmenu.h"
 #include "log.h"
+#include "logdata.h"
 #include "logmainview.h"
 #include "overview.h"
 #include "quickfind.h"
 #include "quickfindpattern.h"
 #include "regularexpressionpattern.h"
 #include "shortcuts.h"
+#include "tabexpansionindex.h"
+#include "tracezone.h"
 
 #ifdef Q_OS_WIN
 
@@ -139,6 +157,16 @@ inline int countLeadingZeroes( uint64_t value )
 
 namespace {
 
+// Rows of lines around the view are measured in background
+// one block per tick, up to this distance from the view
+constexpr int WrapIndexTimerInterval = 10;
+constexpr LineNumber::UnderlyingType WrapIndexIdleDistance = 1024 * 1024;
+
+// Tiles around the view are drawn one per tick, the timer waits
+// for lines of the tiles to be prefetched at most this many ticks
+constexpr int TileTimerInterval = 20;
+constexpr int MaxTileWaits = 100;
+
 int mapPullToFollowLength( int length );
 
 int intLog2( uint64_t x )
@@ -177,6 +205,15 @@ int countDigits( uint64_t x )
     return ans + 1;
 }
 
+bool canRenderTextInThread()
+{
+#if ( QT_VERSION < QT_VERSION_CHECK( 6, 0, 0 ) )
+    return QFontDatabase::supportsThreadedFontRendering();
+#else
+    return true;
+#endif
+}
+
 int textWidth( const QFontMetrics& fm, const QString& text )
 {
 #if ( QT_VERSION >= QT_VERSION_CHECK( 5, 11, 0 ) )
@@ -205,8 +242,62 @@ QFontMetrics pixmapFontMetrics( const QFont& font )
     return devicePainter->fontMetrics();
 }
 
+// Colors of 256 color xterm: 16 basic colors, 6x6x6 cube and 24 grays
+QColor ansiColor( const AnsiColor& color, const QColor& defaultColor )
+{
+    if ( color.type == AnsiColor::Type::Default ) {
+        return defaultColor;
+    }
+    if ( color.type == AnsiColor::Type::Rgb ) {
+        return QColor( static_cast<QRgb>( color.value ) );
+    }
+
+    static constexpr std::array<QRgb, 16> BasicColors
+        = { 0x000000, 0xcd0000, 0x00cd00, 0xcdcd00, 0x0000ee, 0xcd00cd, 0x00cdcd, 0xe5e5e5,
+            0x7f7f7f, 0xff0000, 0x00ff00, 0xffff00, 0x5c5cff, 0xff00ff, 0x00ffff, 0xffffff };
+    static constexpr std::array<int, 6> CubeLevels = { 0, 95, 135, 175, 215, 255 };
+
+    const auto index = color.value;
+    if ( index < BasicColors.size() ) {
+        return QColor( BasicColors[ index ] );
+    }
+    if ( index < 232 ) {
+        const auto cubeIndex = index - 16;
+        return QColor( CubeLevels[ cubeIndex / 36 ], CubeLevels[ cubeIndex / 6 % 6 ],
+                       CubeLevels[ cubeIndex % 6 ] );
+    }
+
+    const auto gray = static_cast<int>( 8 + ( index - 232 ) * 10 );
+    return QColor( gray, gray, gray );
+}
+
 } // namespace
 
+const StaticTextCache::Text& StaticTextCache::text( const QFontMetrics& fm, const QString& chunk )
+{
+    auto cachedText = texts_.find( chunk );
+    if ( cachedText != texts_.end() ) {
+        return cachedText.value();
+    }
+
+    // Visible chunks are the same while scrolling horizontally or
+    // changing selection, so old ones are not worth tracking
+    if ( texts_.size() >= MaxTexts ) {
+        texts_.clear();
+    }
+
+    QStaticText text( chunk );
+    text.setTextFormat( Qt::PlainText );
+    text.setPerformanceHint( QStaticText::AggressiveCaching );
+
+    return texts_.insert( chunk, Text{ std::move( text ), textWidth( fm, chunk ) } ).value();
+}
+
+void StaticTextCache::clear()
+{
+    texts_.clear();
+}
+
 inline void LineDrawer::addChunk( int firstCol, int lastCol, const QColor& fore,
                                   const QColor& back )
 {
@@ -227,7 +318,8 @@ inline void LineDrawer::addChunk( const LineChunk& chunk )
 }
 
 inline void LineDrawer::draw( QPainter* painter, int initialXPos, int initialYPos, int lineWidth,
-                              const QString& line, int leftExtraBackgroundPx )
+                              const QString& line, int leftExtraBackgroundPx,
+                              StaticTextCache* textCache )
 {
     QFontMetrics fm = painter->fontMetrics();
     const int fontHeight = fm.height();
@@ -240,7 +332,8 @@ inline void LineDrawer::draw( QPainter* painter, int initialXPos, int initialYPo
         // Draw each chunk
         // LOG_DEBUG << "Chunk: " << chunk.start() << " " << chunk.length();
         const auto cutline = line.mid( chunk.start(), chunk.length() );
-        const int chunkWidth = textWidth( fm, cutline );
+        const auto* staticText = textCache ? &textCache->text( fm, cutline ) : nullptr;
+        const int chunkWidth = staticText ? staticText->width : textWidth( fm, cutline );
         if ( xPos == initialXPos ) {
             // First chunk, we extend the left background a bit,
             // it looks prettier.
@@ -252,7 +345,12 @@ inline void LineDrawer::draw( QPainter* painter, int initialXPos, int initialYPo
             painter->fillRect( xPos, yPos, chunkWidth, fontHeight, chunk.backColor() );
         }
         painter->setPen( chunk.foreColor() );
-        painter->drawText( xPos, yPos + fontAscent, cutline );
+        if ( staticText ) {
+            painter->drawStaticText( xPos, yPos, staticText->text );
+        }
+        else {
+            painter->drawText( xPos, yPos + fontAscent, cutline );
+        }
         xPos += chunkWidth;
     }
 
@@ -329,6 +427,8 @@ AbstractLogView::AbstractLogView( const AbstractLogData* newLogData,
              Qt::QueuedConnection );
 
     connect( &followElasticHook_, SIGNAL( lengthChanged() ), this, SLOT( repaint() ) );
+    connect( &frameWatcher_, &QFutureWatcher<QImage>::finished, this,
+             &AbstractLogView::textAreaFrameRendered );
     connect( &followElasticHook_, SIGNAL( hooked( bool ) ), this,
              SIGNAL( followModeChanged( bool ) ) );
 }
@@ -410,8 +510,11 @@ void AbstractLogView::mousePressEvent( QMouseEvent* mouseEvent )
             Q_EMIT newSelection( *line );
         }
 
+        saveSelectionToFileAction_->setEnabled( selection_.getLineRange().has_value() );
+
         if ( selection_.isSingleLine() ) {
             copyAction_->setText( "&Copy this line" );
+            loadMoreOfLineAction_->setEnabled( true );
 
             setSearchStartAction_->setEnabled( true );
             setSearchEndAction_->setEnabled( true );
@@ -422,6 +525,7 @@ void AbstractLogView::mousePressEvent( QMouseEvent* mouseEvent )
         else {
             copyAction_->setText( "&Copy" );
             copyAction_->setStatusTip( tr( "Copy the selection" ) );
+            loadMoreOfLineAction_->setEnabled( false );
 
             setSearchStartAction_->setEnabled( false );
             setSearchEndAction_->setEnabled( false );
@@ -520,8 +624,7 @@ void AbstractLogView::mouseMoveEvent( QMouseEvent* mouseEvent )
 {
     // Selection implementation
     if ( selectionStarted_ ) {
-        // Invalidate our cache
-        textAreaCache_.invalid_ = true;
+        const auto previousSelection = selection_;
 
         const auto thisEndPos = convertCoordToFilePos( mouseEvent->pos() );
 
@@ -552,6 +655,7 @@ void AbstractLogView::mouseMoveEvent( QMouseEvent* mouseEvent )
                 update();
             }
             selectionCurrentEndPos_ = thisEndPos;
+            invalidateSelectionChange( previousSelection );
 
             // Do we need to scroll while extending the selection?
             QRect visible = viewport()->rect();
@@ -629,6 +733,21 @@ void AbstractLogView::timerEvent( QTimerEvent* timerEvent )
                                                         : QAbstractSlider::SliderSingleStepAdd );
         }
     }
+    else if ( timerEvent->timerId() == wrapIndexTimer_.timerId() ) {
+        const auto line = wrapIndex_.unmeasuredLineNear( firstLine_ );
+        const auto distance = line ? std::max( line->get(), firstLine_.get() )
+                                         - std::min( line->get(), firstLine_.get() )
+                                   : 0;
+        if ( !wrapLines_ || !line || distance > WrapIndexIdleDistance ) {
+            wrapIndexTimer_.stop();
+        }
+        else {
+            measureRows( *line, 1_lcount );
+        }
+    }
+    else if ( timerEvent->timerId() == tileTimer_.timerId() ) {
+        renderNextTile();
+    }
     QAbstractScrollArea::timerEvent( timerEvent );
 }
 
@@ -855,34 +974,127 @@ bool AbstractLogView::event( QEvent* e )
 }
 
 int AbstractLogView::lineNumberToVerticalScroll( LineNumber line ) const
+{
+    return rowToVerticalScroll( wrapLines_ ? wrapIndex_.firstRow( line ) : line.get() );
+}
+
+int AbstractLogView::rowToVerticalScroll( uint64_t row ) const
 {
     return static_cast<int>(
-        std::round( static_cast<double>( line.get() ) * verticalScrollMultiplicator() ) );
+        std::round( static_cast<double>( row ) * verticalScrollMultiplicator() ) );
+}
+
+uint64_t AbstractLogView::verticalScrollToRow( int scrollPosition ) const
+{
+    return static_cast<uint64_t>(
+        std::round( static_cast<double>( scrollPosition ) / verticalScrollMultiplicator() ) );
 }
 
 LineNumber AbstractLogView::verticalScrollToLineNumber( int scrollPosition ) const
 {
-    return LineNumber( static_cast<LineNumber::UnderlyingType>(
-        std::round( static_cast<double>( scrollPosition ) / verticalScrollMultiplicator() ) ) );
+    const auto row = verticalScrollToRow( scrollPosition );
+    return wrapLines_ ? wrapIndex_.lineAtRow( row ).first
+                      : LineNumber( static_cast<LineNumber::UnderlyingType>( row ) );
 }
 
 double AbstractLogView::verticalScrollMultiplicator() const
 {
+    const auto nbRows = wrapLines_ ? wrapIndex_.nbRows() : estimatedNbLines().get();
     return verticalScrollBar()->maximum() < std::numeric_limits<int>::max()
                ? 1.0
                : static_cast<double>( std::numeric_limits<int>::max() )
-                     / static_cast<double>( logData_->getNbLine().get() );
+                     / static_cast<double>( nbRows );
+}
+
+int AbstractLogView::wrapColumns() const
+{
+    // The last column may be cut by the edge of the view
+    return std::max( getNbVisibleCols() - 1, 1 );
+}
+
+uint64_t AbstractLogView::topRow() const
+{
+    return wrapIndex_.firstRow( firstLine_ ) + static_cast<uint64_t>( firstRow_ );
+}
+
+bool AbstractLogView::measureRows( LineNumber first, LinesCount count )
+{
+    const auto isMeasured = wrapIndex_.measure(
+        first, count, [ this ]( LineNumber line ) { return logData_->getLineLength( line ); } );
+    firstRow_ = std::min( firstRow_, wrapIndex_.lineRows( firstLine_ ) - 1 );
+
+    if ( !wrapIndexTimer_.isActive() ) {
+        wrapIndexTimer_.start( WrapIndexTimerInterval, this );
+    }
+
+    if ( !isMeasured ) {
+        return false;
+    }
+
+    // Measured lines only get more rows, so the scroll bar
+    // is not moved by the new range and is moved back to the view
+    updateScrollBars();
+    const QSignalBlocker blocker( verticalScrollBar() );
+    verticalScrollBar()->setValue( rowToVerticalScroll( topRow() ) );
+    return true;
+}
+
+void AbstractLogView::setWrapLines( bool wrapLines )
+{
+    const auto topLine = firstLine_;
+
+    wrapLines_ = wrapLines;
+    firstRow_ = 0;
+    firstCol_ = 0;
+    if ( wrapLines_ ) {
+        wrapIndex_.reset( logData_->getNbLine(), wrapColumns() );
+        measureRows( topLine, getNbVisibleLines() );
+    }
+    else {
+        wrapIndexTimer_.stop();
+        wrapIndex_.reset( 0_lcount, 1 );
+    }
+
+    updateScrollBars();
+    verticalScrollBar()->setValue( lineNumberToVerticalScroll( topLine ) );
+    horizontalScrollBar()->setValue( 0 );
+    forceRefresh();
+}
+
+LinesCount AbstractLogView::estimatedNbLines() const
+{
+    return logData_->getNbLine();
+}
+
+LinesPreview AbstractLogView::linesPreview( LineNumber, LinesCount ) const
+{
+    return {};
+}
+
+OptionalLineNumber AbstractLogView::indexedLineAtOffset( qint64 ) const
+{
+    return {};
 }
 
 void AbstractLogView::scrollContentsBy( int dx, int dy )
 {
     LOG_DEBUG << "scrollContentsBy received " << dy << "position " << verticalScrollBar()->value();
 
-    const auto lastTopLine = ( logData_->getNbLine() - getNbVisibleLines() );
+    const auto lastTopLine = ( estimatedNbLines() - getNbVisibleLines() );
 
     const auto scrollPosition = verticalScrollToLineNumber( verticalScrollBar()->value() );
 
-    if ( ( lastTopLine.get() > 0 ) && scrollPosition.get() > lastTopLine.get() ) {
+    if ( wrapLines_ ) {
+        // Rows are scrolled, the last one is aligned at the bottom
+        const auto row = verticalScrollToRow( verticalScrollBar()->value() );
+        const auto nbRows = wrapIndex_.nbRows();
+        const auto nbVisibleRows = getNbVisibleLines().get();
+
+        std::tie( firstLine_, firstRow_ ) = wrapIndex_.lineAtRow( row );
+        lastLineAligned_ = nbRows > nbVisibleRows && row > nbRows - nbVisibleRows;
+        measureRows( firstLine_, getNbVisibleLines() );
+    }
+    else if ( ( lastTopLine.get() > 0 ) && scrollPosition.get() > lastTopLine.get() ) {
         // The user is going further than the last line, we need to lock the last line at the bottom
         LOG_DEBUG << "scrollContentsBy beyond!";
         firstLine_ = scrollPosition;
@@ -930,33 +1142,87 @@ void AbstractLogView::paintEvent( QPaintEvent* paintEvent )
     }
 #endif
 
+    // Thumbnail is shown once, the view is redrawn right after
+    if ( !suspendedFrame_.isNull() ) {
+        const auto frame = std::move( suspendedFrame_ );
+        suspendedFrame_ = QPixmap{};
+        if ( frame.size() == viewport()->size() ) {
+            QPainter devicePainter( viewport() );
+            devicePainter.drawPixmap( 0, 0, frame );
+            QTimer::singleShot( 0, viewport(), qOverload<>( &QWidget::update ) );
+            return;
+        }
+    }
+
     auto start = std::chrono::system_clock::now();
 
-    // Can we use our cache?
-    auto deltaY = textAreaCache_.first_line_.get() - firstLine_.get();
+    // Cache is not changed until the frame painted by the worker is ready
+    const auto isFrameRendering = frameWatcher_.isRunning();
+
+    // Tiles were drawn with the state the cache had
+    if ( textAreaCache_.invalid_ ) {
+        tileCache_.clear();
+    }
 
-    if ( textAreaCache_.invalid_ || ( textAreaCache_.first_column_ != firstCol_ ) ) {
-        // Force a full redraw
-        deltaY = std::numeric_limits<decltype( deltaY )>::max();
+    // Lines have only been appended, we can reuse what is drawn
+    if ( textAreaCache_.scrollable_ && !isFrameRendering && !wrapLines_
+         && !textAreaCache_.invalid_
+         && textAreaCache_.first_column_ == firstCol_
+         && textAreaCache_.first_line_ != firstLine_ ) {
+        scrollTextAreaCache();
     }
+    textAreaCache_.scrollable_ = false;
 
-    if ( deltaY != 0 ) {
-        // Full or partial redraw
-        drawTextArea( &textAreaCache_.pixmap_ );
+    // Can we use our cache?
+    const auto isCacheValid = !textAreaCache_.invalid_ && textAreaCache_.first_line_ == firstLine_
+                              && textAreaCache_.first_column_ == firstCol_
+                              && textAreaCache_.first_row_ == firstRow_;
+
+    if ( !isCacheValid && isFrameRendering ) {
+        // Current position is painted once the running frame is done
+    }
+    else if ( !isCacheValid ) {
+        // Full redraw
+        if ( drawTextAreaFromTiles() ) {
+            // Nothing is read from the file
+        }
+        else if ( Configuration::get().threadedRendering() && !textAreaCache_.pixmap_.isNull()
+                  && canRenderTextInThread() ) {
+            renderTextAreaFrame();
+        }
+        else {
+            drawTextArea( &textAreaCache_.pixmap_ );
+        }
 
         textAreaCache_.invalid_ = false;
         textAreaCache_.first_line_ = firstLine_;
         textAreaCache_.first_column_ = firstCol_;
+        textAreaCache_.first_row_ = firstRow_;
+        textAreaCache_.dirty_lines_.clear();
+        textAreaCache_.nb_lines_ = logData_->getNbLine();
+        textAreaCache_.line_number_digits_ = countDigits( maxDisplayLineNumber().get() );
 
         LOG_DEBUG << "End of writing "
                   << std::chrono::duration_cast<std::chrono::microseconds>(
                          std::chrono::system_clock::now() - start )
                          .count();
     }
+    else if ( !textAreaCache_.dirty_lines_.empty() && !isFrameRendering ) {
+        // Only lines which have changed
+        drawTextArea( &textAreaCache_.pixmap_, textAreaCache_.dirty_lines_ );
+        textAreaCache_.dirty_lines_.clear();
+        textAreaCache_.nb_lines_ = logData_->getNbLine();
+    }
     else {
         // Use the cache as is: nothing to do!
     }
 
+    // Screens around the new position are drawn while the view is idle
+    tileWaits_ = 0;
+    if ( !wrapLines_ && !tileTimer_.isActive() ) {
+        tileTimer_.start( TileTimerInterval, this );
+    }
+
     // Height including the potentially invisible last line
     const auto wholeHeight = static_cast<int>( getNbVisibleLines().get() ) * charHeight_;
     // Height in pixels of the "pull to follow" bottom bar.
@@ -1028,6 +1294,16 @@ LineNumber AbstractLogView::maxDisplayLineNumber() const
     return LineNumber( logData_->getNbLine().get() );
 }
 
+void AbstractLogView::setHighlighterCache( HighlighterCache* highlighterCache )
+{
+    highlighterCache_ = highlighterCache;
+}
+
+void AbstractLogView::setQuickFindMatchesProvider( QuickFind::MatchesProvider provider )
+{
+    quickFind_->setMatchesProvider( std::move( provider ) );
+}
+
 void AbstractLogView::setOverview( Overview* overview, OverviewWidget* overviewWidget )
 {
     overview_ = overview;
@@ -1114,9 +1390,10 @@ void AbstractLogView::allowFollowMode( bool allow )
     followElasticHook_.allowHook( allow );
 }
 
-void AbstractLogView::setSearchPattern( const RegularExpressionPattern& pattern )
+void AbstractLogView::setSearchHighlighter(
+    std::shared_ptr<const SearchHighlighter> searchHighlighter )
 {
-    searchPattern_ = pattern;
+    searchHighlighter_ = std::move( searchHighlighter );
     forceRefresh();
 }
 
@@ -1236,14 +1513,33 @@ void AbstractLogView::markSelected()
     }
 }
 
+void AbstractLogView::unmarkSelected()
+{
+    auto lines = selection_.getLines();
+    if ( !lines.empty() ) {
+        Q_EMIT unmarkLines( lines );
+    }
+}
+
 void AbstractLogView::saveToFile()
+{
+    saveLinesToFile( 0_lnum, logData_->getNbLine() );
+}
+
+void AbstractLogView::saveSelectionToFile()
+{
+    if ( const auto lineRange = selection_.getLineRange() ) {
+        saveLinesToFile( lineRange->first, lineRange->second );
+    }
+}
+
+void AbstractLogView::saveLinesToFile( LineNumber first, LinesCount count )
 {
     auto filename = QFileDialog::getSaveFileName( this, "Save content" );
     if ( filename.isEmpty() ) {
         return;
     }
 
-    const auto totalLines = logData_->getNbLine();
     QSaveFile saveFile{ filename };
     saveFile.open( QIODevice::WriteOnly | QIODevice::Truncate );
     if ( !saveFile.isOpen() ) {
@@ -1251,99 +1547,415 @@ void AbstractLogView::saveToFile()
         return;
     }
 
+    const auto exporter = linesExporter( first, count );
+    const auto totalLines = std::max( exporter.linesCount().get(), uint64_t{ 1 } );
+
+    AtomicFlag interruptRequest;
+    std::atomic<uint64_t> writtenLines{};
+
     QProgressDialog progressDialog( this );
     progressDialog.setLabelText( QString( "Saving content to %1" ).arg( filename ) );
+    progressDialog.setRange( 0, 1000 );
+    progressDialog.setWindowModality( Qt::ApplicationModal );
+    connect( &progressDialog, &QProgressDialog::canceled,
+             [ &interruptRequest ]() { interruptRequest.set(); } );
 
-    std::vector<std::pair<LineNumber, LinesCount>> offsets;
-    auto lineOffset = 0_lnum;
-    const auto chunkSize = 5000_lcount;
+    QTimer progressTimer;
+    connect( &progressTimer, &QTimer::timeout, &progressDialog,
+             [ &progressDialog, &writtenLines, totalLines ]() {
+                 progressDialog.setValue(
+                     static_cast<int>( writtenLines.load() * 1000 / totalLines ) );
+             } );
+
+    // Lines are written on a worker thread, so the dialog shows progress
+    QEventLoop exportLoop;
+    QFutureWatcher<bool> exportWatcher;
+    connect( &exportWatcher, &QFutureWatcher<bool>::finished, &exportLoop, &QEventLoop::quit );
+    exportWatcher.setFuture( QtConcurrent::run( [ &exporter, &saveFile, &interruptRequest,
+                                                  &writtenLines ]() {
+        return exporter.write( saveFile, interruptRequest, writtenLines );
+    } ) );
 
-    for ( ; lineOffset + chunkSize < LineNumber( totalLines.get() );
-          lineOffset += LineNumber( chunkSize.get() ) ) {
-        offsets.emplace_back( lineOffset, chunkSize );
+    progressDialog.open();
+    progressTimer.start( 100 );
+    exportLoop.exec();
+    progressTimer.stop();
+    progressDialog.reset();
+
+    if ( !exportWatcher.result() ) {
+        LOG_ERROR << "Saving file write failed";
+        saveFile.cancelWriting();
+    }
+    else if ( !interruptRequest ) {
+        saveFile.commit();
     }
-    offsets.emplace_back( lineOffset, LinesCount( totalLines.get() % chunkSize.get() ) );
+}
 
-    QTextCodec* codec = logData_->getDisplayEncoding();
-    if ( !codec ) {
-        codec = QTextCodec::codecForName( "utf-8" );
+void AbstractLogView::countValues()
+{
+    bool isAccepted = false;
+    const auto pattern = QInputDialog::getText(
+        this, tr( "Count values" ),
+        tr( "Regular expression, values are its first capture group:" ), QLineEdit::Normal,
+        QString{}, &isAccepted );
+    if ( !isAccepted || pattern.isEmpty() ) {
+        return;
     }
 
+    const QRegularExpression regexp( pattern );
+    if ( !regexp.isValid() ) {
+        QMessageBox::warning( this, tr( "Count values" ),
+                              tr( "Invalid regular expression: %1" ).arg( regexp.errorString() ) );
+        return;
+    }
+
+    const auto aggregator = valueAggregator();
+    const auto totalLines = std::max( aggregator.linesCount().get(), uint64_t{ 1 } );
+
     AtomicFlag interruptRequest;
+    std::atomic<uint64_t> processedLines{};
 
+    QProgressDialog progressDialog( this );
+    progressDialog.setLabelText( tr( "Counting values of %1" ).arg( pattern ) );
     progressDialog.setRange( 0, 1000 );
+    progressDialog.setWindowModality( Qt::ApplicationModal );
     connect( &progressDialog, &QProgressDialog::canceled,
              [ &interruptRequest ]() { interruptRequest.set(); } );
 
-    tbb::flow::graph saveFileGraph;
-    using LinesData = std::pair<std::vector<QString>, bool>;
-    auto lineReader = tbb::flow::input_node<LinesData>(
-        saveFileGraph,
-        [ this, &offsets, &interruptRequest, &progressDialog, offsetIndex = 0u,
-          finalLine = false ]( tbb::flow_control& fc ) mutable -> LinesData {
-            if ( !interruptRequest && offsetIndex < offsets.size() ) {
-                const auto& offset = offsets.at( offsetIndex );
-                LinesData lines{ logData_->getLines( offset.first, offset.second ), true };
-                for ( auto& l : lines.first ) {
-#if !defined( Q_OS_WIN )
-                    l.append( QChar::CarriageReturn );
-#endif
-                    l.append( QChar::LineFeed );
-                }
+    QTimer progressTimer;
+    connect( &progressTimer, &QTimer::timeout, &progressDialog,
+             [ &progressDialog, &processedLines, totalLines ]() {
+                 progressDialog.setValue(
+                     static_cast<int>( processedLines.load() * 1000 / totalLines ) );
+             } );
+
+    using AggregatedValues = std::vector<AggregatedValue>;
+    QEventLoop aggregateLoop;
+    QFutureWatcher<AggregatedValues> aggregateWatcher;
+    connect( &aggregateWatcher, &QFutureWatcher<AggregatedValues>::finished, &aggregateLoop,
+             &QEventLoop::quit );
+    aggregateWatcher.setFuture( QtConcurrent::run(
+        [ &aggregator, &regexp, &interruptRequest, &processedLines ]() {
+            return aggregator.aggregate( regexp, interruptRequest, processedLines );
+        } ) );
 
-                offsetIndex++;
-                progressDialog.setValue( static_cast<int>(
-                    std::floor( static_cast<float>( offsetIndex )
-                                / static_cast<float>( offsets.size() + 1 ) * 1000.f ) ) );
-                return lines;
-            }
-            else if ( !finalLine ) {
-                finalLine = true;
-            }
-            else {
-                fc.stop();
-            }
+    progressDialog.open();
+    progressTimer.start( 100 );
+    aggregateLoop.exec();
+    progressTimer.stop();
+    progressDialog.reset();
 
-            return {};
-        } );
+    if ( interruptRequest ) {
+        return;
+    }
 
-    auto lineWriter = tbb::flow::function_node<LinesData, tbb::flow::continue_msg>(
-        saveFileGraph, 1,
-        [ &interruptRequest, &codec, &saveFile, &progressDialog,
-          linesCount = 0u ]( const LinesData& lines ) mutable {
-            if ( !lines.second ) {
-                if ( !interruptRequest ) {
-                    saveFile.commit();
-                    linesCount++;
-                }
+    const auto values = aggregateWatcher.result();
 
-                progressDialog.finished( 0 );
-                return tbb::flow::continue_msg{};
-            }
+    // Table with too many rows is slow to build, the rarest values are not shown
+    constexpr size_t MaxShownValues = 10000;
+    const auto shownValues = std::min( values.size(), MaxShownValues );
 
-            for ( const auto& l : lines.first ) {
+    QDialog valuesDialog( this );
+    valuesDialog.setWindowTitle( tr( "Values of %1" ).arg( pattern ) );
+    valuesDialog.resize( 640, 480 );
 
-                const auto encodedLine = codec->fromUnicode( l );
-                const auto written = saveFile.write( encodedLine );
+    auto* table = new QTableWidget( static_cast<int>( shownValues ), 4, &valuesDialog );
+    table->setHorizontalHeaderLabels(
+        { tr( "Value" ), tr( "Count" ), tr( "First line" ), tr( "Last line" ) } );
+    table->setEditTriggers( QAbstractItemView::NoEditTriggers );
+    table->setSelectionBehavior( QAbstractItemView::SelectRows );
+    table->verticalHeader()->hide();
+    table->horizontalHeader()->setSectionResizeMode( 0, QHeaderView::Stretch );
 
-                if ( written != encodedLine.size() ) {
-                    LOG_ERROR << "Saving file write failed";
-                    interruptRequest.set();
-                    return tbb::flow::continue_msg{};
-                }
+    const auto numberItem = []( uint64_t number ) {
+        auto* item = new QTableWidgetItem;
+        item->setData( Qt::DisplayRole, static_cast<qulonglong>( number ) );
+        item->setTextAlignment( Qt::AlignRight | Qt::AlignVCenter );
+        return item;
+    };
+    for ( auto row = 0u; row < shownValues; ++row ) {
+        const auto& value = values[ row ];
+        const auto tableRow = static_cast<int>( row );
+        table->setItem( tableRow, 0, new QTableWidgetItem( value.value ) );
+        table->setItem( tableRow, 1, numberItem( value.count ) );
+        table->setItem( tableRow, 2, numberItem( value.firstLine.get() + 1 ) );
+        table->setItem( tableRow, 3, numberItem( value.lastLine.get() + 1 ) );
+    }
+    table->setSortingEnabled( true );
+
+    auto* summary = new QLabel(
+        values.size() > shownValues
+            ? tr( "%1 distinct values, %2 most frequent are shown" )
+                  .arg( values.size() )
+                  .arg( shownValues )
+            : tr( "%1 distinct values" ).arg( values.size() ),
+        &valuesDialog );
+
+    auto* buttonBox = new QDialogButtonBox( QDialogButtonBox::Close, &valuesDialog );
+    connect( buttonBox, &QDialogButtonBox::rejected, &valuesDialog, &QDialog::reject );
+
+    auto* layout = new QVBoxLayout( &valuesDialog );
+    layout->addWidget( summary );
+    layout->addWidget( table );
+    layout->addWidget( buttonBox );
+
+    valuesDialog.exec();
+}
+
+void AbstractLogView::summarizeNumbers()
+{
+    bool isAccepted = false;
+    const auto pattern = QInputDialog::getText(
+        this, tr( "Numeric statistics" ),
+        tr( "Regular expression, numbers are its first capture group:" ), QLineEdit::Normal,
+        QString{}, &isAccepted );
+    if ( !isAccepted || pattern.isEmpty() ) {
+        return;
+    }
 
-                linesCount++;
-            }
-            return tbb::flow::continue_msg{};
-        } );
+    const QRegularExpression regexp( pattern );
+    if ( !regexp.isValid() ) {
+        QMessageBox::warning( this, tr( "Numeric statistics" ),
+                              tr( "Invalid regular expression: %1" ).arg( regexp.errorString() ) );
+        return;
+    }
+
+    // Sparkline has a bar of block characters for each interval
+    constexpr size_t Intervals = 60;
+    static const QString SparkBars
+        = QString::fromUtf8( "\u2581\u2582\u2583\u2584\u2585\u2586\u2587\u2588" );
+
+    const auto aggregator = valueAggregator();
+    const auto totalLines = std::max( aggregator.linesCount().get(), uint64_t{ 1 } );
+
+    AtomicFlag interruptRequest;
+    std::atomic<uint64_t> processedLines{};
+
+    QProgressDialog progressDialog( this );
+    progressDialog.setLabelText( tr( "Summarizing numbers of %1" ).arg( pattern ) );
+    progressDialog.setRange( 0, 1000 );
+    progressDialog.setWindowModality( Qt::ApplicationModal );
+    connect( &progressDialog, &QProgressDialog::canceled,
+             [ &interruptRequest ]() { interruptRequest.set(); } );
+
+    QTimer progressTimer;
+    connect( &progressTimer, &QTimer::timeout, &progressDialog,
+             [ &progressDialog, &processedLines, totalLines ]() {
+                 progressDialog.setValue(
+                     static_cast<int>( processedLines.load() * 1000 / totalLines ) );
+             } );
+
+    QEventLoop summarizeLoop;
+    QFutureWatcher<NumericStatistics> summarizeWatcher;
+    connect( &summarizeWatcher, &QFutureWatcher<NumericStatistics>::finished, &summarizeLoop,
+             &QEventLoop::quit );
+    summarizeWatcher.setFuture( QtConcurrent::run(
+        [ &aggregator, &regexp, &interruptRequest, &processedLines ]() {
+            return aggregator.summarize( regexp, Intervals, interruptRequest, processedLines );
+        } ) );
+
+    progressDialog.open();
+    progressTimer.start( 100 );
+    summarizeLoop.exec();
+    progressTimer.stop();
+    progressDialog.reset();
+
+    if ( interruptRequest ) {
+        return;
+    }
+
+    const auto statistics = summarizeWatcher.result();
+    const auto& values = statistics.values;
+    if ( values.count() == 0 ) {
+        QMessageBox::information( this, tr( "Numeric statistics" ),
+                                  tr( "No numbers matched %1" ).arg( pattern ) );
+        return;
+    }
+
+    // Bars are heights of medians of intervals, intervals without numbers are blank
+    QString sparkline;
+    const auto low = values.min();
+    const auto range = values.max() - low;
+    for ( const auto& interval : statistics.intervals ) {
+        if ( interval.count() == 0 ) {
+            sparkline.append( QChar( ' ' ) );
+            continue;
+        }
+        const auto height = range > 0 ? ( interval.quantile( 0.5 ) - low ) / range : 0.0;
+        const auto bar = std::clamp( static_cast<int>( height * SparkBars.size() ), 0,
+                                     static_cast<int>( SparkBars.size() ) - 1 );
+        sparkline.append( SparkBars.at( bar ) );
+    }
+
+    const std::vector<std::pair<QString, double>> rows = {
+        { tr( "Min" ), values.min() },
+        { tr( "Mean" ), values.mean() },
+        { tr( "p50" ), values.quantile( 0.5 ) },
+        { tr( "p90" ), values.quantile( 0.9 ) },
+        { tr( "p95" ), values.quantile( 0.95 ) },
+        { tr( "p99" ), values.quantile( 0.99 ) },
+        { tr( "Max" ), values.max() },
+    };
 
-    tbb::flow::make_edge( lineReader, lineWriter );
+    QDialog statisticsDialog( this );
+    statisticsDialog.setWindowTitle( tr( "Numeric statistics of %1" ).arg( pattern ) );
 
+    auto* table = new QTableWidget( static_cast<int>( rows.size() ), 2, &statisticsDialog );
+    table->setHorizontalHeaderLabels( { tr( "Statistic" ), tr( "Value" ) } );
+    table->setEditTriggers( QAbstractItemView::NoEditTriggers );
+    table->verticalHeader()->hide();
+    table->horizontalHeader()->setSectionResizeMode( 1, QHeaderView::Stretch );
+    for ( auto row = 0u; row < rows.size(); ++row ) {
+        const auto tableRow = static_cast<int>( row );
+        table->setItem( tableRow, 0, new QTableWidgetItem( rows[ row ].first ) );
+        auto* valueItem = new QTableWidgetItem( QString::number( rows[ row ].second, 'g', 6 ) );
+        valueItem->setTextAlignment( Qt::AlignRight | Qt::AlignVCenter );
+        table->setItem( tableRow, 1, valueItem );
+    }
+
+    auto* summary = new QLabel( tr( "%1 numbers, percentiles are within %2% of exact values" )
+                                    .arg( values.count() )
+                                    .arg( NumericSketch::RelativeAccuracy * 100 ),
+                                &statisticsDialog );
+
+    auto* sparklineLabel = new QLabel( sparkline, &statisticsDialog );
+    sparklineLabel->setFont( QFontDatabase::systemFont( QFontDatabase::FixedFont ) );
+    sparklineLabel->setToolTip( tr( "Median of numbers in consecutive parts of the file" ) );
+
+    auto* buttonBox = new QDialogButtonBox( QDialogButtonBox::Close, &statisticsDialog );
+    connect( buttonBox, &QDialogButtonBox::rejected, &statisticsDialog, &QDialog::reject );
+
+    auto* layout = new QVBoxLayout( &statisticsDialog );
+    layout->addWidget( summary );
+    layout->addWidget( table );
+    layout->addWidget( sparklineLabel );
+    layout->addWidget( buttonBox );
+
+    statisticsDialog.exec();
+}
+
+void AbstractLogView::findTemplates()
+{
+    const auto clusterer = templateClusterer();
+    const auto totalLines = std::max( clusterer.linesCount().get(), uint64_t{ 1 } );
+
+    AtomicFlag interruptRequest;
+    std::atomic<uint64_t> processedLines{};
+
+    QProgressDialog progressDialog( this );
+    progressDialog.setLabelText( tr( "Finding message templates" ) );
+    progressDialog.setRange( 0, 1000 );
     progressDialog.setWindowModality( Qt::ApplicationModal );
+    connect( &progressDialog, &QProgressDialog::canceled,
+             [ &interruptRequest ]() { interruptRequest.set(); } );
+
+    QTimer progressTimer;
+    connect( &progressTimer, &QTimer::timeout, &progressDialog,
+             [ &progressDialog, &processedLines, totalLines ]() {
+                 progressDialog.setValue(
+                     static_cast<int>( processedLines.load() * 1000 / totalLines ) );
+             } );
+
+    using LogTemplates = std::vector<LogTemplate>;
+    QEventLoop clusterLoop;
+    QFutureWatcher<LogTemplates> clusterWatcher;
+    connect( &clusterWatcher, &QFutureWatcher<LogTemplates>::finished, &clusterLoop,
+             &QEventLoop::quit );
+    clusterWatcher.setFuture(
+        QtConcurrent::run( [ &clusterer, &interruptRequest, &processedLines ]() {
+            return clusterer.cluster( interruptRequest, processedLines );
+        } ) );
+
     progressDialog.open();
+    progressTimer.start( 100 );
+    clusterLoop.exec();
+    progressTimer.stop();
+    progressDialog.reset();
+
+    if ( interruptRequest ) {
+        return;
+    }
 
-    lineReader.activate();
-    saveFileGraph.wait_for_all();
+    // Lines of templates are kept by the dialog, so showing them does not search
+    const auto templates = std::make_shared<LogTemplates>( clusterWatcher.result() );
+
+    auto* templatesDialog = new QDialog( this );
+    templatesDialog->setAttribute( Qt::WA_DeleteOnClose );
+    templatesDialog->setWindowTitle( tr( "Message templates" ) );
+    templatesDialog->resize( 800, 480 );
+
+    auto* table = new QTableWidget( static_cast<int>( templates->size() ), 2, templatesDialog );
+    table->setHorizontalHeaderLabels( { tr( "Template" ), tr( "Lines" ) } );
+    table->setEditTriggers( QAbstractItemView::NoEditTriggers );
+    table->setSelectionBehavior( QAbstractItemView::SelectRows );
+    table->setSelectionMode( QAbstractItemView::SingleSelection );
+    table->verticalHeader()->hide();
+    table->horizontalHeader()->setSectionResizeMode( 0, QHeaderView::Stretch );
+
+    for ( auto row = 0u; row < templates->size(); ++row ) {
+        const auto& logTemplate = ( *templates )[ row ];
+        const auto tableRow = static_cast<int>( row );
+
+        auto* textItem = new QTableWidgetItem( logTemplate.text );
+        textItem->setData( Qt::UserRole, static_cast<qulonglong>( row ) );
+        table->setItem( tableRow, 0, textItem );
+
+        auto* countItem = new QTableWidgetItem;
+        countItem->setData( Qt::DisplayRole,
+                            static_cast<qulonglong>( logTemplate.lines.cardinality() ) );
+        countItem->setTextAlignment( Qt::AlignRight | Qt::AlignVCenter );
+        table->setItem( tableRow, 1, countItem );
+    }
+    table->setSortingEnabled( true );
+
+    connect( table, &QTableWidget::cellClicked, this, [ this, table, templates ]( int row ) {
+        const auto index = table->item( row, 0 )->data( Qt::UserRole ).toULongLong();
+        Q_EMIT showTemplateLines( ( *templates )[ index ].lines );
+    } );
+
+    auto* summary = new QLabel(
+        tr( "%1 templates, click a template to show its lines" ).arg( templates->size() ),
+        templatesDialog );
+
+    auto* buttonBox = new QDialogButtonBox( QDialogButtonBox::Close, templatesDialog );
+    connect( buttonBox, &QDialogButtonBox::rejected, templatesDialog, &QDialog::reject );
+
+    auto* layout = new QVBoxLayout( templatesDialog );
+    layout->addWidget( summary );
+    layout->addWidget( table );
+    layout->addWidget( buttonBox );
+
+    templatesDialog->show();
+}
+
+void AbstractLogView::drawLinesPreview( QPainter& painter, int textStartX, int lineNumberStartX )
+{
+    const auto preview = linesPreview( firstLine_, getNbVisibleLines() );
+    if ( preview.lines.empty() ) {
+        previewOffset_.reset();
+        return;
+    }
+
+    previewOffset_ = preview.offset;
+
+    const auto fontAscent = painter.fontMetrics().ascent();
+    const auto nbCols = getNbVisibleCols();
+    const auto& palette = viewport()->palette();
+
+    // Numbers of lines are not known, so the margin shows they are approximate
+    painter.setPen( palette.color( QPalette::Disabled, QPalette::Text ) );
+    for ( auto row = 0u; row < preview.lines.size(); ++row ) {
+        const auto yPos = static_cast<int>( row ) * charHeight_ + fontAscent;
+        if ( lineNumbersVisible_ ) {
+            painter.drawText( lineNumberStartX, yPos, QStringLiteral( "~" ) );
+        }
+
+        auto line = preview.lines[ row ];
+        line.replace( QChar::Tabulation, QStringLiteral( "    " ) );
+        painter.setPen( palette.color( QPalette::Text ) );
+        painter.drawText( textStartX, yPos, line.mid( firstCol_, nbCols ) );
+        painter.setPen( palette.color( QPalette::Disabled, QPalette::Text ) );
+    }
 }
 
 void AbstractLogView::updateSearchLimits()
@@ -1390,20 +2002,72 @@ void AbstractLogView::setSelectionEnd()
 // Public functions
 //
 
+void AbstractLogView::suspend()
+{
+    if ( isSuspended_ ) {
+        return;
+    }
+
+    isSuspended_ = true;
+
+    if ( !textAreaCache_.invalid_ && !viewport()->size().isEmpty() ) {
+        suspendedFrame_ = viewport()->grab();
+        if ( suspendedFrame_.devicePixelRatio() > 1 ) {
+            suspendedFrame_ = suspendedFrame_.scaled( viewport()->size(), Qt::IgnoreAspectRatio,
+                                                      Qt::SmoothTransformation );
+            suspendedFrame_.setDevicePixelRatio( 1 );
+        }
+    }
+
+    textAreaCache_.pixmap_ = QPixmap{};
+    textAreaCache_.invalid_ = true;
+    textAreaCache_.dirty_lines_.clear();
+    pullToFollowCache_ = { {}, 0 };
+    wrapIndexTimer_.stop();
+    tileCache_.clear();
+    tileTimer_.stop();
+    if ( staticTextCache_ ) {
+        staticTextCache_->clear();
+    }
+}
+
+void AbstractLogView::resume()
+{
+    isSuspended_ = false;
+}
+
 void AbstractLogView::updateData()
 {
     LOG_DEBUG << "AbstractLogView::updateData";
 
     const auto lastLineNumber = LineNumber( logData_->getNbLine().get() );
 
+    // Previewed lines get their numbers once they are indexed
+    if ( previewOffset_ ) {
+        if ( const auto indexedLine = indexedLineAtOffset( *previewOffset_ ) ) {
+            LOG_INFO << "Previewed offset " << *previewOffset_ << " is line " << *indexedLine;
+            previewOffset_.reset();
+            firstLine_ = *indexedLine;
+            updateScrollBars();
+            verticalScrollBar()->setValue( lineNumberToVerticalScroll( firstLine_ ) );
+        }
+    }
+
     // Check the top Line is within range
-    if ( firstLine_ >= lastLineNumber ) {
+    if ( firstLine_ >= lastLineNumber && firstLine_ >= LineNumber( estimatedNbLines().get() ) ) {
         firstLine_ = 0_lnum;
         firstCol_ = 0;
         verticalScrollBar()->setValue( 0 );
         horizontalScrollBar()->setValue( 0 );
     }
 
+    // Lines may be different ones, their rows are measured again
+    if ( wrapLines_ ) {
+        wrapIndex_.reset( logData_->getNbLine(), wrapColumns() );
+        firstRow_ = 0;
+        measureRows( firstLine_, getNbVisibleLines() );
+    }
+
     // Crop selection if it become out of range
     selection_.crop( lastLineNumber - 1_lcount );
 
@@ -1412,6 +2076,7 @@ void AbstractLogView::updateData()
 
     // Reset the QuickFind in case we have new stuff to search into
     quickFind_->resetLimits();
+    quickFind_->resetMatchIndex();
 
     if ( followMode_ )
         jumpToBottom();
@@ -1426,10 +2091,58 @@ void AbstractLogView::updateData()
     forceRefresh();
 }
 
+void AbstractLogView::updateAppendedData()
+{
+    LOG_DEBUG << "AbstractLogView::updateAppendedData";
+
+    const auto nbLines = logData_->getNbLine();
+    if ( previewOffset_ || textAreaCache_.invalid_ || nbLines < textAreaCache_.nb_lines_
+         || countDigits( maxDisplayLineNumber().get() )
+                != textAreaCache_.line_number_digits_ ) {
+        // Drawn rows can not be kept
+        updateData();
+        return;
+    }
+
+    if ( wrapLines_ ) {
+        wrapIndex_.resize( nbLines );
+    }
+
+    updateScrollBars();
+
+    // Reset the QuickFind in case we have new stuff to search into
+    quickFind_->resetLimits();
+
+    // Rows below the last line were empty
+    for ( auto line = LineNumber( textAreaCache_.nb_lines_.get() );
+          line < LineNumber( nbLines.get() ); ++line ) {
+        invalidateLine( line );
+    }
+
+    if ( followMode_ ) {
+        textAreaCache_.scrollable_ = true;
+        scrollToBottom();
+    }
+
+    if ( overview_ != nullptr ) {
+        const LineNumber lastLine
+            = qMin( LineNumber( nbLines.get() ), firstLine_ + getNbVisibleLines() );
+        overview_->updateCurrentPosition( firstLine_, lastLine );
+    }
+
+    update();
+}
+
 void AbstractLogView::updateFont( const QFont& font )
 {
     setFont( font );
     pixmapFontMetrics_ = pixmapFontMetrics( font );
+
+    staticTextCache_.reset();
+    if ( QFontInfo( font ).fixedPitch() ) {
+        staticTextCache_.emplace();
+    }
+
     updateDisplaySize();
     update();
 }
@@ -1440,6 +2153,12 @@ void AbstractLogView::updateDisplaySize()
     charHeight_ = std::max( pixmapFontMetrics_.height(), 1 );
     charWidth_ = textWidth( pixmapFontMetrics_, QString( "m" ) );
 
+    if ( wrapLines_ && wrapIndex_.columns() != wrapColumns() ) {
+        wrapIndex_.reset( logData_->getNbLine(), wrapColumns() );
+        firstRow_ = 0;
+        measureRows( firstLine_, getNbVisibleLines() );
+    }
+
     // Update the scroll bars
     updateScrollBars();
     verticalScrollBar()->setPageStep( static_cast<int>( getNbVisibleLines().get() ) );
@@ -1464,6 +2183,8 @@ void AbstractLogView::updateDisplaySize()
                                      * viewport()->devicePixelRatio() ) )
     };
     textAreaCache_.pixmap_.setDevicePixelRatio( viewport()->devicePixelRatio() );
+    // Frames painted by a worker replace it only when they are ready
+    textAreaCache_.pixmap_.fill( viewport()->palette().color( QPalette::Window ) );
 }
 
 LineNumber AbstractLogView::getTopLine() const
@@ -1509,6 +2230,18 @@ void AbstractLogView::selectAndDisplayLine( LineNumber line )
 // subtle: this one always jump, even if the line passed is visible.
 void AbstractLogView::jumpToLine( LineNumber line )
 {
+    if ( wrapLines_ ) {
+        // Rows of lines above the line are measured, so it is put in the middle
+        const auto nbVisibleRows = getNbVisibleLines().get();
+        measureRows( line.get() > nbVisibleRows ? line - LinesCount( nbVisibleRows ) : 0_lnum,
+                     LinesCount( 2 * nbVisibleRows ) );
+
+        const auto lineRow = wrapIndex_.firstRow( line );
+        const auto newTopRow = lineRow > nbVisibleRows / 2 ? lineRow - nbVisibleRows / 2 : 0;
+        verticalScrollBar()->setValue( rowToVerticalScroll( newTopRow ) );
+        return;
+    }
+
     // Put the selected line in the middle if possible
     const auto newTopLine = line - LinesCount( getNbVisibleLines().get() / 2 );
     // This will also trigger a scrollContents event
@@ -1529,10 +2262,14 @@ void AbstractLogView::forceRefresh()
 
 void AbstractLogView::setSearchLimits( LineNumber startLine, LineNumber endLine )
 {
+    const auto previousStart = searchStart_;
+    const auto previousEnd = searchEnd_;
+
     searchStart_ = startLine;
     searchEnd_ = endLine;
 
-    forceRefresh();
+    invalidateSearchLimitsChange( previousStart, previousEnd );
+    update();
 }
 
 //
@@ -1555,6 +2292,13 @@ int AbstractLogView::getNbVisibleCols() const
 // Converts the mouse x, y coordinates to the line number in the file
 OptionalLineNumber AbstractLogView::convertCoordToLine( int yPos ) const
 {
+    if ( wrapLines_ ) {
+        // Rows below the last one are past the last line
+        const auto row = convertCoordToRow( yPos );
+        return row < wrapIndex_.nbRows() ? wrapIndex_.lineAtRow( row ).first
+                                         : LineNumber( wrapIndex_.nbLines().get() );
+    }
+
     const auto offset = ( yPos - drawingTopOffset_ ) / charHeight_;
     const auto linesOffset
         = LinesCount( static_cast<LinesCount::UnderlyingType>( std::abs( offset ) ) );
@@ -1566,6 +2310,13 @@ OptionalLineNumber AbstractLogView::convertCoordToLine( int yPos ) const
     }
 }
 
+uint64_t AbstractLogView::convertCoordToRow( int yPos ) const
+{
+    const auto offset = ( yPos - drawingTopOffset_ ) / charHeight_;
+    const auto row = static_cast<int64_t>( topRow() ) + offset;
+    return static_cast<uint64_t>( std::max( row, int64_t{ 0 } ) );
+}
+
 // Converts the mouse x, y coordinates to the char coordinates (in the file)
 // This function ensure the pos exists in the file.
 AbstractLogView::FilePos AbstractLogView::convertCoordToFilePos( const QPoint& pos ) const
@@ -1574,8 +2325,17 @@ AbstractLogView::FilePos AbstractLogView::convertCoordToFilePos( const QPoint& p
     if ( line >= logData_->getNbLine() )
         line = LineNumber( logData_->getNbLine().get() ) - 1_lcount;
 
+    // Wrapped line is shown from the column of the row
+    auto firstColumn = firstCol_;
+    auto nbColumns = getNbVisibleCols() + 1;
+    if ( wrapLines_ ) {
+        const auto [ rowLine, rowInLine ] = wrapIndex_.lineAtRow( convertCoordToRow( pos.y() ) );
+        firstColumn = rowLine == line ? rowInLine * wrapColumns() : 0;
+        nbColumns = wrapColumns();
+    }
+
     const auto lineText = logData_->getExpandedLineString( line );
-    const auto visibleText = lineText.mid( firstCol_, getNbVisibleCols() + 1 );
+    const auto visibleText = lineText.mid( firstColumn, nbColumns );
 
     std::vector<int> possibleColumns( static_cast<size_t>( visibleText.length() ) );
     std::iota( possibleColumns.begin(), possibleColumns.end(), 0 );
@@ -1591,8 +2351,10 @@ AbstractLogView::FilePos AbstractLogView::convertCoordToFilePos( const QPoint& p
 
     const auto length = static_cast<LineLength::UnderlyingType>( lineText.length() );
 
-    auto column = columnIt != possibleColumns.end() ? *columnIt : length;
-    column += ( firstCol_ - 1 );
+    // Past the end of a wrapped row is the end of the row
+    const auto endColumn = wrapLines_ ? visibleText.length() : length;
+    auto column = columnIt != possibleColumns.end() ? *columnIt : endColumn;
+    column += ( firstColumn - 1 );
     column = std::clamp( column, 0, length - 1 );
 
     LOG_DEBUG << "AbstractLogView::convertCoordToFilePos col=" << column << " line=" << line;
@@ -1604,7 +2366,11 @@ AbstractLogView::FilePos AbstractLogView::convertCoordToFilePos( const QPoint& p
 void AbstractLogView::displayLine( LineNumber line )
 {
     // If the line is already the screen
-    if ( ( line >= firstLine_ ) && ( line < ( firstLine_ + getNbVisibleLines() ) ) ) {
+    const auto isLineVisible
+        = wrapLines_ ? line >= firstLine_
+                           && wrapIndex_.firstRow( line ) < topRow() + getNbVisibleLines().get()
+                     : line >= firstLine_ && line < firstLine_ + getNbVisibleLines();
+    if ( isLineVisible ) {
         // Invalidate our cache
         forceRefresh();
     }
@@ -1694,14 +2460,31 @@ void AbstractLogView::jumpToTop()
 // Jump to the last line
 void AbstractLogView::jumpToBottom()
 {
+    scrollToBottom();
+    forceRefresh();
+}
+
+void AbstractLogView::scrollToBottom()
+{
+    if ( wrapLines_ ) {
+        const auto nbLines = logData_->getNbLine();
+        const auto nbVisibleRows = getNbVisibleLines().get();
+        measureRows( nbLines.get() > nbVisibleRows ? LineNumber( nbLines.get() - nbVisibleRows )
+                                                   : 0_lnum,
+                     getNbVisibleLines() );
+
+        const auto nbRows = wrapIndex_.nbRows();
+        const auto newTopRow = nbRows < nbVisibleRows ? 0 : nbRows - nbVisibleRows + 1;
+        verticalScrollBar()->setValue( rowToVerticalScroll( newTopRow ) );
+        return;
+    }
+
     const auto newTopLine = ( logData_->getNbLine().get() < getNbVisibleLines().get() )
                                 ? 0
                                 : logData_->getNbLine().get() - getNbVisibleLines().get() + 1;
 
     // This will also trigger a scrollContents event
     verticalScrollBar()->setValue( lineNumberToVerticalScroll( LineNumber( newTopLine ) ) );
-
-    forceRefresh();
 }
 
 // Select the word under the given position
@@ -1755,10 +2538,34 @@ void AbstractLogView::createMenu()
     markAction_ = new QAction( tr( "&Mark" ), this );
     connect( markAction_, &QAction::triggered, this, [ this ]( auto ) { this->markSelected(); } );
 
+    unmarkAction_ = new QAction( tr( "&Unmark" ), this );
+    connect( unmarkAction_, &QAction::triggered, this,
+             [ this ]( auto ) { this->unmarkSelected(); } );
+
+    markAllMatchesAction_ = new QAction( tr( "Mark all matches" ), this );
+    connect( markAllMatchesAction_, &QAction::triggered, this,
+             [ this ]( auto ) { Q_EMIT markAllMatches(); } );
+
     saveToFileAction_ = new QAction( tr( "Save to file" ), this );
     connect( saveToFileAction_, &QAction::triggered, this,
              [ this ]( auto ) { this->saveToFile(); } );
 
+    saveSelectionToFileAction_ = new QAction( tr( "Save selection to file" ), this );
+    connect( saveSelectionToFileAction_, &QAction::triggered, this,
+             [ this ]( auto ) { this->saveSelectionToFile(); } );
+
+    countValuesAction_ = new QAction( tr( "Count values..." ), this );
+    connect( countValuesAction_, &QAction::triggered, this,
+             [ this ]( auto ) { this->countValues(); } );
+
+    summarizeNumbersAction_ = new QAction( tr( "Numeric statistics..." ), this );
+    connect( summarizeNumbersAction_, &QAction::triggered, this,
+             [ this ]( auto ) { this->summarizeNumbers(); } );
+
+    findTemplatesAction_ = new QAction( tr( "Find message templates..." ), this );
+    connect( findTemplatesAction_, &QAction::triggered, this,
+             [ this ]( auto ) { this->findTemplates(); } );
+
     // For '#' and '*', shortcuts doesn't seem to work but
     // at least it displays them in the menu, we manually handle those keys
     // as keys event anyway (in keyPressEvent).
@@ -1797,6 +2604,12 @@ void AbstractLogView::createMenu()
     connect( setSearchEndAction_, &QAction::triggered, this,
              [ this ]( auto ) { this->setSearchEnd(); } );
 
+    setSearchTimeRangeAction_ = new QAction( tr( "Set search time range..." ), this );
+    setSearchTimeRangeAction_->setStatusTip(
+        tr( "Limits search to lines with timestamps in a time range" ) );
+    connect( setSearchTimeRangeAction_, &QAction::triggered, this,
+             [ this ]( auto ) { Q_EMIT changeSearchTimeRange(); } );
+
     clearSearchLimitAction_ = new QAction( tr( "Clear search limits" ), this );
     connect( clearSearchLimitAction_, &QAction::triggered, this,
              [ this ]( auto ) { this->clearSearchLimits(); } );
@@ -1821,12 +2634,28 @@ void AbstractLogView::createMenu()
     connect( replaceInScratchpadAction_, &QAction::triggered, this,
              [ this ]( auto ) { Q_EMIT replaceScratchpadWithSelection(); } );
 
+    wrapLinesAction_ = new QAction( tr( "Wrap long lines" ), this );
+    wrapLinesAction_->setCheckable( true );
+    connect( wrapLinesAction_, &QAction::toggled, this,
+             [ this ]( bool checked ) { this->setWrapLines( checked ); } );
+
+    // Long lines are read up to a limit, see LogData::DisplayedLineBytes
+    loadMoreOfLineAction_ = new QAction( tr( "Load more of this line" ), this );
+    connect( loadMoreOfLineAction_, &QAction::triggered, this, [ this ]( auto ) {
+        const auto line = selection_.selectedLine();
+        if ( line && logData_->loadMoreOfLine( *line ) ) {
+            updateData();
+        }
+    } );
+
     popupMenu_ = new QMenu( this );
     highlightersMenu_ = popupMenu_->addMenu( "Highlighters" );
     colorLabelsMenu_ = popupMenu_->addMenu( "Color labels" );
 
     popupMenu_->addSeparator();
     popupMenu_->addAction( markAction_ );
+    popupMenu_->addAction( unmarkAction_ );
+    popupMenu_->addAction( markAllMatchesAction_ );
     popupMenu_->addSeparator();
     popupMenu_->addAction( copyAction_ );
     popupMenu_->addAction( sendToScratchpadAction_ );
@@ -1841,6 +2670,7 @@ void AbstractLogView::createMenu()
     popupMenu_->addSeparator();
     popupMenu_->addAction( setSearchStartAction_ );
     popupMenu_->addAction( setSearchEndAction_ );
+    popupMenu_->addAction( setSearchTimeRangeAction_ );
     popupMenu_->addAction( clearSearchLimitAction_ );
     popupMenu_->addSeparator();
     popupMenu_->addAction( setSelectionStartAction_ );
@@ -1848,6 +2678,14 @@ void AbstractLogView::createMenu()
     popupMenu_->addSeparator();
     popupMenu_->addAction( saveDefaultSplitterSizesAction_ );
     popupMenu_->addAction( saveToFileAction_ );
+    popupMenu_->addAction( saveSelectionToFileAction_ );
+    popupMenu_->addSeparator();
+    popupMenu_->addAction( wrapLinesAction_ );
+    popupMenu_->addAction( loadMoreOfLineAction_ );
+    popupMenu_->addSeparator();
+    popupMenu_->addAction( countValuesAction_ );
+    popupMenu_->addAction( summarizeNumbersAction_ );
+    popupMenu_->addAction( findTemplatesAction_ );
 }
 
 void AbstractLogView::considerMouseHovering( int xPos, int yPos )
@@ -1872,26 +2710,282 @@ void AbstractLogView::considerMouseHovering( int xPos, int yPos )
 
 void AbstractLogView::updateScrollBars()
 {
-    if ( logData_->getNbLine() < getNbVisibleLines() ) {
+    // Wrapped lines are scrolled by rows
+    const auto nbLines = wrapLines_ ? LinesCount( wrapIndex_.nbRows() ) : estimatedNbLines();
+    if ( nbLines < getNbVisibleLines() ) {
         verticalScrollBar()->setRange( 0, 0 );
     }
     else {
         verticalScrollBar()->setRange(
             0, static_cast<int>( qMin(
-                   logData_->getNbLine().get() - getNbVisibleLines().get()
+                   nbLines.get() - getNbVisibleLines().get()
                        + LinesCount::UnderlyingType{ 1 },
                    static_cast<LinesCount::UnderlyingType>( std::numeric_limits<int>::max() ) ) ) );
     }
 
+    scrollBarMaxLength_ = logData_->getMaxLength();
     const int hScrollMaxValue
-        = qMax( 0, static_cast<int>( logData_->getMaxLength().get() ) - getNbVisibleCols() + 1 );
+        = wrapLines_
+              ? 0
+              : qMax( 0, static_cast<int>( scrollBarMaxLength_.get() ) - getNbVisibleCols() + 1 );
 
     horizontalScrollBar()->setRange( 0, hScrollMaxValue );
     horizontalScrollBar()->setPageStep( getNbVisibleCols() * 7 / 8 );
 }
 
-void AbstractLogView::drawTextArea( QPaintDevice* paintDevice )
+void AbstractLogView::invalidateLine( LineNumber line )
+{
+    tileCache_.removeLines( line, 1_lcount );
+    markLineDirty( line );
+}
+
+void AbstractLogView::markLineDirty( LineNumber line )
+{
+    const auto& cacheFirstLine = textAreaCache_.first_line_;
+    if ( line < cacheFirstLine || line >= cacheFirstLine + getNbVisibleLines() ) {
+        return;
+    }
+
+    // Rows of wrapped lines are not at fixed positions
+    if ( wrapLines_ ) {
+        textAreaCache_.invalid_ = true;
+        return;
+    }
+
+    auto& dirtyLines = textAreaCache_.dirty_lines_;
+    if ( std::find( dirtyLines.begin(), dirtyLines.end(), line ) == dirtyLines.end() ) {
+        dirtyLines.push_back( line );
+    }
+}
+
+void AbstractLogView::invalidateSelectionChange( const Selection& previousSelection )
+{
+    const auto selectionState = []( const Selection& selection, LineNumber line ) {
+        const auto portion = selection.getPortionForLine( line );
+        return std::make_tuple( selection.isLineSelected( line ), selection.isSingleLine(),
+                                portion.isValid(), portion.startColumn(), portion.endColumn() );
+    };
+
+    // Tiles of lines around both selections, as selection lines are wider than the row
+    for ( const auto& selection : { std::cref( previousSelection ), std::cref( selection_ ) } ) {
+        if ( const auto range = selection.get().getLineRange() ) {
+            const auto first = range->first > 0_lnum ? range->first - 1_lcount : range->first;
+            tileCache_.removeLines( first, range->second + 2_lcount );
+        }
+    }
+
+    for ( auto row = 0_lcount; row < getNbVisibleLines(); ++row ) {
+        const auto line = textAreaCache_.first_line_ + row;
+        if ( selectionState( previousSelection, line ) == selectionState( selection_, line ) ) {
+            continue;
+        }
+
+        // Selection lines are wider than the row
+        if ( line > 0_lnum ) {
+            invalidateLine( line - 1_lcount );
+        }
+        invalidateLine( line );
+        invalidateLine( line + 1_lcount );
+    }
+}
+
+void AbstractLogView::invalidateSearchLimitsChange( LineNumber previousStart,
+                                                    LineNumber previousEnd )
+{
+    const auto [ previousStartIndex, previousEndIndex ]
+        = searchLimitsIndexes( previousStart, previousEnd );
+    const auto [ startIndex, endIndex ] = searchLimitsIndexes( searchStart_, searchEnd_ );
+
+    // Lines between the old and new limits are drawn differently
+    tileCache_.clear();
+
+    for ( auto row = 0_lcount; row < getNbVisibleLines(); ++row ) {
+        const auto line = textAreaCache_.first_line_ + row;
+        const auto wasInLimits = line >= previousStartIndex && line < previousEndIndex;
+        const auto isInLimits = line >= startIndex && line < endIndex;
+        if ( wasInLimits != isInLimits ) {
+            invalidateLine( line );
+        }
+    }
+}
+
+void AbstractLogView::renderTextAreaFrame()
 {
+    QPicture picture;
+    drawTextArea( &picture );
+
+    frameWatcher_.setFuture( QtConcurrent::run(
+        [ picture, frameSize = textAreaCache_.pixmap_.size(),
+          pixelRatio = textAreaCache_.pixmap_.devicePixelRatio() ]() mutable {
+            QImage frame( frameSize, QImage::Format_ARGB32_Premultiplied );
+            frame.setDevicePixelRatio( pixelRatio );
+
+            QPainter painter( &frame );
+            painter.setRenderHints( QPainter::Antialiasing | QPainter::TextAntialiasing );
+            picture.play( &painter );
+            return frame;
+        } ) );
+}
+
+void AbstractLogView::textAreaFrameRendered()
+{
+    const auto frame = frameWatcher_.result();
+
+    // Cache still describes the position of the frame
+    // unless the view has been invalidated meanwhile
+    if ( !textAreaCache_.invalid_ && frame.size() == textAreaCache_.pixmap_.size() ) {
+        textAreaCache_.pixmap_ = QPixmap::fromImage( frame );
+    }
+    else {
+        textAreaCache_.invalid_ = true;
+    }
+
+    viewport()->update();
+}
+
+void AbstractLogView::updateTileLayout()
+{
+    tileCache_.setLayout( { getNbVisibleLines(), firstCol_, textAreaCache_.pixmap_.size(),
+                            textAreaCache_.pixmap_.devicePixelRatio() } );
+}
+
+bool AbstractLogView::drawTextAreaFromTiles()
+{
+    // Tiles have to be put together at whole device pixels
+    const auto pixelRatio = textAreaCache_.pixmap_.devicePixelRatio();
+    if ( wrapLines_ || textAreaCache_.pixmap_.isNull() || pixelRatio != std::floor( pixelRatio )
+         || firstLine_ >= LineNumber( logData_->getNbLine().get() ) ) {
+        return false;
+    }
+
+    updateTileLayout();
+
+    const auto tileLines = tileCache_.layout().tileLines;
+    const auto tileStart = tileCache_.tileStart( firstLine_ );
+    const auto offset = static_cast<int>( firstLine_.get() - tileStart.get() );
+
+    const auto tile = tileCache_.find( tileStart );
+    const auto nextTile = offset > 0 ? tileCache_.find( tileStart + tileLines ) : QPixmap{};
+    if ( tile.isNull() || ( offset > 0 && nextTile.isNull() ) ) {
+        return false;
+    }
+
+    QPainter painter( &textAreaCache_.pixmap_ );
+    painter.drawPixmap( 0, -offset * charHeight_, tile );
+    if ( offset > 0 ) {
+        const auto nextTileTop = ( static_cast<int>( tileLines.get() ) - offset ) * charHeight_;
+        painter.drawPixmap( 0, nextTileTop, nextTile );
+    }
+
+    return true;
+}
+
+void AbstractLogView::renderNextTile()
+{
+    const auto nbLines = logData_->getNbLine();
+
+    // View is drawn again before tiles are, if it has to be
+    if ( wrapLines_ || isSuspended_ || textAreaCache_.invalid_ || frameWatcher_.isRunning()
+         || textAreaCache_.pixmap_.isNull() || firstLine_ >= LineNumber( nbLines.get() ) ) {
+        tileTimer_.stop();
+        return;
+    }
+
+    updateTileLayout();
+    tileCache_.trim( firstLine_ );
+
+    const auto missingTiles = tileCache_.missingTiles( firstLine_, nbLines );
+    if ( missingTiles.empty() ) {
+        tileTimer_.stop();
+        return;
+    }
+
+    // Tiles are only drawn from cached lines, drawing does not wait for the file
+    const auto tileLines = tileCache_.layout().tileLines;
+    const auto tile = std::find_if( missingTiles.begin(), missingTiles.end(),
+                                    [ this, tileLines ]( LineNumber tileStart ) {
+                                        return logData_->areLinesCached( tileStart, tileLines );
+                                    } );
+
+    if ( tile == missingTiles.end() ) {
+        if ( tileWaits_ == 0 ) {
+            const auto [ first, last ]
+                = std::minmax_element( missingTiles.begin(), missingTiles.end() );
+            logData_->prefetchLines( *first,
+                                     LinesCount( last->get() - first->get() ) + tileLines );
+        }
+
+        if ( ++tileWaits_ > MaxTileWaits ) {
+            tileTimer_.stop();
+        }
+        return;
+    }
+
+    QPixmap tilePixmap( textAreaCache_.pixmap_.size() );
+    tilePixmap.setDevicePixelRatio( textAreaCache_.pixmap_.devicePixelRatio() );
+
+    const auto viewFirstLine = firstLine_;
+    firstLine_ = *tile;
+    isRenderingTile_ = true;
+    drawTextArea( &tilePixmap );
+    isRenderingTile_ = false;
+    firstLine_ = viewFirstLine;
+
+    tileCache_.insert( *tile, std::move( tilePixmap ) );
+}
+
+void AbstractLogView::scrollTextAreaCache()
+{
+    const auto nbVisibleLines = static_cast<int>( getNbVisibleLines().get() );
+    const auto delta = static_cast<int>( firstLine_.get() )
+                       - static_cast<int>( textAreaCache_.first_line_.get() );
+
+    // Scrolled pixels have to map to whole device pixels
+    const auto pixelRatio = textAreaCache_.pixmap_.devicePixelRatio();
+    if ( std::abs( delta ) >= nbVisibleLines || pixelRatio != std::floor( pixelRatio ) ) {
+        textAreaCache_.invalid_ = true;
+        return;
+    }
+
+    const auto deltaPx = static_cast<int>( -delta * charHeight_ * pixelRatio );
+    textAreaCache_.pixmap_.scroll( 0, deltaPx, textAreaCache_.pixmap_.rect() );
+    textAreaCache_.first_line_ = firstLine_;
+
+    auto& dirtyLines = textAreaCache_.dirty_lines_;
+    dirtyLines.erase( std::remove_if( dirtyLines.begin(), dirtyLines.end(),
+                                      [ this ]( LineNumber line ) {
+                                          return line < firstLine_
+                                                 || line >= firstLine_ + getNbVisibleLines();
+                                      } ),
+                      dirtyLines.end() );
+
+    // Exposed rows and the ones next to them,
+    // as selection lines are wider than the row
+    const auto firstExposedRow = delta > 0 ? nbVisibleLines - delta - 1 : 0;
+    const auto lastExposedRow = delta > 0 ? nbVisibleLines : -delta + 1;
+    for ( auto row = std::max( firstExposedRow, 0 ); row < lastExposedRow; ++row ) {
+        markLineDirty( firstLine_ + LinesCount( static_cast<LinesCount::UnderlyingType>( row ) ) );
+    }
+}
+
+std::pair<LineNumber, LineNumber> AbstractLogView::searchLimitsIndexes( LineNumber startLine,
+                                                                       LineNumber endLine ) const
+{
+    const auto startIndex = lineIndex( startLine );
+    auto endIndex = lineIndex( endLine );
+    if ( endLine + 1_lcount != displayLineNumber( endIndex ) ) {
+        // in filtered view lineIndex for "past the end" returns last line
+        // it should not be marked as excluded
+        endIndex = endIndex + 1_lcount;
+    }
+
+    return { startIndex, endIndex };
+}
+
+void AbstractLogView::drawTextArea( QPaintDevice* paintDevice,
+                                    const std::vector<LineNumber>& lines )
+{
+    KLOGG_ZONE( "AbstractLogView::drawTextArea" );
     // LOG_DEBUG << "devicePixelRatio: " << viewport()->devicePixelRatio();
     // LOG_DEBUG << "viewport size: " << viewport()->size().width();
     // LOG_DEBUG << "pixmap size: " << textPixmap.width();
@@ -1904,13 +2998,27 @@ void AbstractLogView::drawTextArea( QPaintDevice* paintDevice )
     const int fontAscent = painter->fontMetrics().ascent();
     const int nbCols = getNbVisibleCols();
 
-    const int paintDeviceHeight
-        = static_cast<int>( std::floor( paintDevice->height() / viewport()->devicePixelRatio() ) );
-    const int paintDeviceWidth
-        = static_cast<int>( std::floor( paintDevice->width() / viewport()->devicePixelRatio() ) );
+    // Recording paint devices have no size of their own
+    const int paintDeviceHeight = static_cast<int>(
+        std::floor( textAreaCache_.pixmap_.height() / viewport()->devicePixelRatio() ) );
+    const int paintDeviceWidth = static_cast<int>(
+        std::floor( textAreaCache_.pixmap_.width() / viewport()->devicePixelRatio() ) );
+
+    // Only given lines are repainted, the rest of the device keeps what it had
+    if ( !lines.empty() ) {
+        QRegion linesRegion;
+        for ( const auto line : lines ) {
+            const auto row = static_cast<int>( line.get() - firstLine_.get() );
+            linesRegion += QRect( 0, row * fontHeight, paintDeviceWidth, fontHeight );
+        }
+        painter->setClipRegion( linesRegion );
+    }
 
     const QPalette& palette = viewport()->palette();
     const auto& highlighterSet = HighlighterSetCollection::get().currentActiveSet();
+    if ( highlighterCache_ ) {
+        highlighterCache_->setHighlighterSet( highlighterSet );
+    }
     const auto& quickHighlighters = HighlighterSetCollection::get().quickHighlighters();
     QColor foreColor, backColor;
 
@@ -1927,11 +3035,19 @@ void AbstractLogView::drawTextArea( QPaintDevice* paintDevice )
     // First check the lines to be drawn are within range (might not be the case if
     // the file has just changed)
     const auto linesInFile = logData_->getNbLine();
+    const auto isPreview = firstLine_ >= LineNumber( linesInFile.get() )
+                           && firstLine_ < LineNumber( estimatedNbLines().get() );
 
-    if ( firstLine_ > linesInFile )
+    if ( !isPreview && firstLine_ > linesInFile )
         firstLine_ = LineNumber( linesInFile.get() ? linesInFile.get() - 1 : 0 );
 
-    const auto nbLines = qMin( getNbVisibleLines(), linesInFile - LinesCount( firstLine_.get() ) );
+    if ( !isPreview ) {
+        previewOffset_.reset();
+    }
+
+    auto nbLines
+        = isPreview ? 0_lcount
+                    : qMin( getNbVisibleLines(), linesInFile - LinesCount( firstLine_.get() ) );
 
     const int bottomOfTextPx = static_cast<int>( nbLines.get() ) * fontHeight;
 
@@ -1985,39 +3101,58 @@ void AbstractLogView::drawTextArea( QPaintDevice* paintDevice )
     // used for mouse calculation etc...
     leftMarginPx_ = contentStartPosX + SeparatorWidth;
 
-    const auto searchStartIndex = lineIndex( searchStart_ );
-    const auto searchEndIndex = [ this ] {
-        auto index = lineIndex( searchEnd_ );
-        if ( searchEnd_ + 1_lcount != displayLineNumber( index ) ) {
-            // in filtered view lineIndex for "past the end" returns last line
-            // it should not be marked as excluded
-            index = index + 1_lcount;
+    if ( isPreview ) {
+        drawLinesPreview( *painter, contentStartPosX + ContentMarginWidth,
+                          lineNumberAreaStartX + LineNumberPadding );
+        return;
+    }
+
+    // Wrapped lines take more rows, fewer of them are shown
+    const auto nbVisibleRows = static_cast<int>( getNbVisibleLines().get() );
+    const auto wrapCols = wrapIndex_.columns();
+    if ( wrapLines_ ) {
+        if ( wrapCols != wrapColumns() ) {
+            // Margin width has changed, rows are measured again
+            QTimer::singleShot( 0, this, [ this ]() {
+                updateDisplaySize();
+                update();
+            } );
         }
+        measureRows( firstLine_, nbLines );
 
-        return index;
-    }();
+        auto nbRows = -firstRow_;
+        auto nbWrappedLines = 0_lcount;
+        while ( nbWrappedLines < nbLines && nbRows < nbVisibleRows ) {
+            nbRows += wrapIndex_.lineRows( firstLine_ + nbWrappedLines );
+            ++nbWrappedLines;
+        }
+        nbLines = nbWrappedLines;
+    }
 
-    // Lines to write
-    const auto expandedLines = logData_->getExpandedLines( firstLine_, nbLines );
+    const auto [ searchStartIndex, searchEndIndex ]
+        = searchLimitsIndexes( searchStart_, searchEnd_ );
 
-    const auto highlightPatternMatches = Configuration::get().mainSearchHighlight();
-    const auto variateHighlightPatternMatches = Configuration::get().variateMainSearchHighlight();
+    // Visible part of lines to write, wrapped lines are cut into rows
+    const auto expandedLines
+        = wrapLines_ ? logData_->getExpandedLinesWindow( firstLine_, nbLines, 0,
+                                                         ( firstRow_ + nbVisibleRows ) * wrapCols )
+                     : logData_->getExpandedLinesWindow( firstLine_, nbLines, firstCol_, nbCols );
 
-    std::optional<Highlighter> patternHighlight;
-    if ( highlightPatternMatches && !searchPattern_.isBoolean && !searchPattern_.isExclude
-         && !searchPattern_.pattern.isEmpty() ) {
-        const auto mainSearchBackColor = Configuration::get().mainSearchBackColor();
-        patternHighlight = Highlighter{};
-        patternHighlight->setHighlightOnlyMatch( true );
-        patternHighlight->setVariateColors( variateHighlightPatternMatches );
-        patternHighlight->setPattern( searchPattern_.pattern );
-        patternHighlight->setIgnoreCase( !searchPattern_.isCaseSensitive );
-        patternHighlight->setUseRegex( !searchPattern_.isPlainText );
+    if ( logData_->getMaxLength() != scrollBarMaxLength_ ) {
+        QTimer::singleShot( 0, this, [ this ]() { updateScrollBars(); } );
+    }
 
-        patternHighlight->setBackColor( mainSearchBackColor );
-        patternHighlight->setForeColor( Qt::black );
+    // Pages above and below are read in background,
+    // so scrolling to them does not wait for the file
+    if ( !isRenderingTile_ ) {
+        const auto prefetchStart = firstLine_.get() > nbLines.get()
+                                       ? LineNumber( firstLine_.get() - nbLines.get() )
+                                       : 0_lnum;
+        logData_->prefetchLines( prefetchStart, LinesCount( 3 * nbLines.get() ) );
     }
 
+    const auto renderAnsiColors = Configuration::get().renderAnsiColors();
+
     std::vector<Highlighter> additionalHighlighters;
     for ( auto i = 0u; i < quickHighlighters_.size(); ++i ) {
         const auto quickHighlighterIndex = static_cast<int>( i );
@@ -2039,12 +3174,27 @@ void AbstractLogView::drawTextArea( QPaintDevice* paintDevice )
     }
 
     // Then draw each line
+    auto row = 0;
     for ( auto currentLine = 0_lcount; currentLine < nbLines; ++currentLine ) {
         const auto lineNumber = firstLine_ + currentLine;
+
+        // Rows of the line shown in the view
+        const auto lineFirstRow = wrapLines_ && currentLine == 0_lcount ? firstRow_ : 0;
+        const auto lineRows = wrapLines_ ? std::min( wrapIndex_.lineRows( lineNumber )
+                                                         - lineFirstRow,
+                                                     nbVisibleRows - row )
+                                         : 1;
+        const auto lineRow = row;
+        row += lineRows;
+
+        if ( !lines.empty() && std::find( lines.begin(), lines.end(), lineNumber ) == lines.end() ) {
+            continue;
+        }
+
         const QString logLine = logData_->getLineString( lineNumber );
 
         // Position in pixel of the base line of the line to print
-        const int yPos = static_cast<int>( currentLine.get() ) * fontHeight;
+        const int yPos = lineRow * fontHeight;
         const int xPos = contentStartPosX + ContentMarginWidth;
 
         std::vector<HighlightedMatch> highlighterMatches;
@@ -2056,7 +3206,11 @@ void AbstractLogView::drawTextArea( QPaintDevice* paintDevice )
             painter->setPen( palette.color( QPalette::Text ) );
         }
         else {
-            const auto highlightType = highlighterSet.matchLine( logLine, highlighterMatches );
+            const auto highlightType
+                = highlighterCache_
+                      ? highlighterCache_->matchLine( displayLineNumber( lineNumber ) - 1_lcount,
+                                                      logLine, highlighterMatches )
+                      : highlighterSet.matchLine( logLine, highlighterMatches );
 
             if ( highlightType == HighlighterMatchType::LineMatch ) {
                 // color applies to whole line
@@ -2075,9 +3229,30 @@ void AbstractLogView::drawTextArea( QPaintDevice* paintDevice )
                 backColor = palette.color( QPalette::Base );
             }
 
-            if ( patternHighlight ) {
+            // Highlighters are drawn over the colors of the file
+            if ( renderAnsiColors ) {
+                const auto parseColors
+                    = [ this, lineNumber ]() { return logData_->getLineColors( lineNumber ); };
+                const auto lineColors
+                    = highlighterCache_
+                          ? highlighterCache_->lineColors(
+                              displayLineNumber( lineNumber ) - 1_lcount, logLine, parseColors )
+                          : parseColors();
+
+                std::vector<HighlightedMatch> colorMatches;
+                colorMatches.reserve( lineColors.size() );
+                for ( const auto& span : lineColors ) {
+                    colorMatches.emplace_back( span.startColumn, span.length,
+                                               ansiColor( span.foreColor, foreColor ),
+                                               ansiColor( span.backColor, backColor ) );
+                }
+                highlighterMatches.insert( highlighterMatches.begin(), colorMatches.begin(),
+                                           colorMatches.end() );
+            }
+
+            if ( searchHighlighter_ ) {
                 std::vector<HighlightedMatch> patternMatches;
-                patternHighlight->matchLine( logLine, patternMatches );
+                searchHighlighter_->matchLine( logLine, patternMatches );
                 highlighterMatches.insert( highlighterMatches.end(), patternMatches.begin(),
                                            patternMatches.end() );
             }
@@ -2090,31 +3265,21 @@ void AbstractLogView::drawTextArea( QPaintDevice* paintDevice )
             }
         }
 
-        const auto untabifyHighlight = [ &logLine ]( const auto& match ) {
-#if QT_VERSION < QT_VERSION_CHECK( 6, 0, 0 )
-            const auto prefix = logLine.leftRef( match.startColumn() );
-#else
-            const auto prefix = QStringView{ logLine }.left( match.startColumn() );
-#endif
-            const auto expandedPrefixLength
-                = static_cast<LineLength::UnderlyingType>( untabify( prefix.toString() ).length() );
-            auto startDelta
-                = static_cast<LineLength::UnderlyingType>( expandedPrefixLength - prefix.length() );
-
-#if QT_VERSION < QT_VERSION_CHECK( 6, 0, 0 )
-            const auto matchPart = logLine.midRef( match.startColumn(), match.length() );
-#else
-            const auto matchPart
-                = QStringView{ logLine }.mid( match.startColumn(), match.length() );
-#endif
-            const auto expandedMatchLength = static_cast<LineLength::UnderlyingType>(
-                untabify( matchPart.toString(), expandedPrefixLength ).length() );
-
-            const auto lengthDelta = static_cast<LineLength::UnderlyingType>(
-                expandedMatchLength - matchPart.length() );
-
-            return HighlightedMatch{ match.startColumn() + startDelta, match.length() + lengthDelta,
-                                     match.foreColor(), match.backColor() };
+        // Has the line got elements to be highlighted
+        std::vector<HighlightedMatch> quickFindMatches;
+        quickFindPattern_->matchLine( logLine, quickFindMatches );
+        highlighterMatches.insert( highlighterMatches.end(),
+                                   std::make_move_iterator( quickFindMatches.begin() ),
+                                   std::make_move_iterator( quickFindMatches.end() ) );
+
+        const auto tabExpansion = TabExpansionIndex( logLine );
+        const auto untabifyHighlight = [ &tabExpansion ]( const auto& match ) {
+            const auto expandedStart = tabExpansion.expandedColumn( match.startColumn() );
+            const auto expandedEnd
+                = tabExpansion.expandedColumn( match.startColumn() + match.length() );
+
+            return HighlightedMatch{ expandedStart, expandedEnd - expandedStart, match.foreColor(),
+                                     match.backColor() };
         };
 
         std::vector<HighlightedMatch> allHighlights;
@@ -2123,15 +3288,7 @@ void AbstractLogView::drawTextArea( QPaintDevice* paintDevice )
                         std::back_inserter( allHighlights ), untabifyHighlight );
 
         // string to print, cut to fit the length and position of the view
-        const QString expandedLine = expandedLines[ currentLine.get() ];
-        const QString cutLine = expandedLine.mid( firstCol_, nbCols );
-
-        // Has the line got elements to be highlighted
-        std::vector<HighlightedMatch> quickFindMatches;
-        quickFindPattern_->matchLine( expandedLine, quickFindMatches );
-        allHighlights.insert( allHighlights.end(),
-                              std::make_move_iterator( quickFindMatches.begin() ),
-                              std::make_move_iterator( quickFindMatches.end() ) );
+        const QString& cutLine = expandedLines[ currentLine.get() ];
 
         // Is there something selected in the line?
         const auto selectionPortion = selection_.getPortionForLine( lineNumber );
@@ -2141,61 +3298,80 @@ void AbstractLogView::drawTextArea( QPaintDevice* paintDevice )
                                         palette.color( QPalette::Highlight ) );
         }
 
-        painter->fillRect( xPos - ContentMarginWidth, yPos, viewport()->width(), fontHeight,
-                           backColor );
-
-        if ( !allHighlights.empty() ) {
-            // We use the LineDrawer and its chunks because the
-            // line has to be somehow highlighted
-            LineDrawer lineDrawer( backColor );
-
-            auto foreColors = std::vector<QColor>( static_cast<size_t>( nbCols + 1 ), foreColor );
-            auto backColors = std::vector<QColor>( static_cast<size_t>( nbCols + 1 ), backColor );
-
-            for ( const auto& match : allHighlights ) {
-                const auto start = match.startColumn() - firstCol_;
-                const auto end = start + match.length();
-
-                // Ignore matches that are *completely* outside view area
-                if ( ( start < 0 && end < 0 ) || start >= nbCols )
-                    continue;
-
-                const auto firstColumn = static_cast<size_t>( qMax( start, 0 ) );
-                const auto lastColumn
-                    = static_cast<size_t>( qMin( start + match.length(), nbCols ) );
-
-                for ( auto column = firstColumn; column < lastColumn; ++column ) {
-                    foreColors[ column ] = match.foreColor();
-                    backColors[ column ] = match.backColor();
+        for ( auto lineRowIndex = 0; lineRowIndex < lineRows; ++lineRowIndex ) {
+            // Wrapped row is the part of the line from its first column
+            const auto rowYPos = yPos + lineRowIndex * fontHeight;
+            const auto rowFirstCol
+                = wrapLines_ ? ( lineFirstRow + lineRowIndex ) * wrapCols : firstCol_;
+            const auto rowCols = wrapLines_ ? wrapCols : nbCols;
+            const auto rowText = wrapLines_ ? cutLine.mid( rowFirstCol, wrapCols ) : cutLine;
+
+            painter->fillRect( xPos - ContentMarginWidth, rowYPos, viewport()->width(), fontHeight,
+                               backColor );
+
+            if ( !allHighlights.empty() ) {
+                // We use the LineDrawer and its chunks because the
+                // line has to be somehow highlighted
+                LineDrawer lineDrawer( backColor );
+
+                auto foreColors
+                    = std::vector<QColor>( static_cast<size_t>( rowCols + 1 ), foreColor );
+                auto backColors
+                    = std::vector<QColor>( static_cast<size_t>( rowCols + 1 ), backColor );
+
+                for ( const auto& match : allHighlights ) {
+                    const auto start = match.startColumn() - rowFirstCol;
+                    const auto end = start + match.length();
+
+                    // Ignore matches that are *completely* outside view area
+                    if ( ( start < 0 && end < 0 ) || start >= rowCols )
+                        continue;
+
+                    const auto firstColumn = static_cast<size_t>( qMax( start, 0 ) );
+                    const auto lastColumn
+                        = static_cast<size_t>( qMin( start + match.length(), rowCols ) );
+
+                    for ( auto column = firstColumn; column < lastColumn; ++column ) {
+                        foreColors[ column ] = match.foreColor();
+                        backColors[ column ] = match.backColor();
+                    }
                 }
-            }
 
-            std::vector<LineChunk> highlightChunks;
-            auto lastMatchStart = 0;
-            for ( auto column = 0u; column < foreColors.size() - 1; ++column ) {
-                if ( foreColors[ column ] != foreColors[ column + 1 ]
-                     || backColors[ column ] != backColors[ column + 1 ] ) {
-                    lineDrawer.addChunk( { lastMatchStart, static_cast<int>( column ),
-                                           foreColors[ column ], backColors[ column ] } );
-                    lastMatchStart = static_cast<int>( column + 1 );
+                std::vector<LineChunk> highlightChunks;
+                auto lastMatchStart = 0;
+                for ( auto column = 0u; column < foreColors.size() - 1; ++column ) {
+                    if ( foreColors[ column ] != foreColors[ column + 1 ]
+                         || backColors[ column ] != backColors[ column + 1 ] ) {
+                        lineDrawer.addChunk( { lastMatchStart, static_cast<int>( column ),
+                                               foreColors[ column ], backColors[ column ] } );
+                        lastMatchStart = static_cast<int>( column + 1 );
+                    }
+                }
+                if ( lastMatchStart < rowCols ) {
+                    lineDrawer.addChunk(
+                        { lastMatchStart, rowCols, foreColors.back(), backColors.back() } );
                 }
+
+                lineDrawer.draw( painter.get(), xPos, rowYPos, viewport()->width(), rowText,
+                                 ContentMarginWidth,
+                                 staticTextCache_ ? &*staticTextCache_ : nullptr );
             }
-            if ( lastMatchStart < nbCols ) {
-                lineDrawer.addChunk(
-                    { lastMatchStart, nbCols, foreColors.back(), backColors.back() } );
+            else {
+                // Nothing to be highlighted, we print the whole line!
+                // painter->fillRect( xPos - ContentMarginWidth, rowYPos, viewport()->width(),
+                //                   fontHeight, backColor );
+                // (the rectangle is extended on the left to cover the small
+                // margin, it looks better (LineDrawer does the same) )
+                painter->setPen( foreColor );
+                if ( staticTextCache_ ) {
+                    painter->drawStaticText(
+                        xPos, rowYPos,
+                        staticTextCache_->text( painter->fontMetrics(), rowText ).text );
+                }
+                else {
+                    painter->drawText( xPos, rowYPos + fontAscent, rowText );
+                }
             }
-
-            lineDrawer.draw( painter.get(), xPos, yPos, viewport()->width(), cutLine,
-                             ContentMarginWidth );
-        }
-        else {
-            // Nothing to be highlighted, we print the whole line!
-            // painter->fillRect( xPos - ContentMarginWidth, yPos, viewport()->width(), fontHeight,
-            //                   backColor );
-            // (the rectangle is extended on the left to cover the small
-            // margin, it looks better (LineDrawer does the same) )
-            painter->setPen( foreColor );
-            painter->drawText( xPos, yPos + fontAscent, cutLine );
         }
 
         if ( ( selection_.isLineSelected( lineNumber ) && selection_.isSingleLine() )
@@ -2206,8 +3382,8 @@ void AbstractLogView::drawTextArea( QPaintDevice* paintDevice )
             painter->drawLine( xPos - ContentMarginWidth + 1, yPos, viewport()->width(), yPos );
             selectionPen.setWidth( 5 );
             painter->setPen( selectionPen );
-            painter->drawLine( xPos - ContentMarginWidth + 2, yPos + fontHeight,
-                               viewport()->width(), yPos + fontHeight );
+            painter->drawLine( xPos - ContentMarginWidth + 2, yPos + lineRows * fontHeight,
+                               viewport()->width(), yPos + lineRows * fontHeight );
         }
 
         // Then draw the bullet
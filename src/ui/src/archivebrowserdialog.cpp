@@ -0,0 +1,210 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "archivebrowserdialog.h"
+
+#include <QCheckBox>
+#include <QDialogButtonBox>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QLabel>
+#include <QLineEdit>
+#include <QPushButton>
+#include <QTableWidget>
+#include <QVBoxLayout>
+#include <QtConcurrent>
+
+#include "configuration.h"
+
+namespace {
+constexpr int EntryColumn = 0;
+constexpr int SizeColumn = 1;
+constexpr int MatchesColumn = 2;
+
+constexpr int ProgressIntervalMs = 200;
+
+QTableWidgetItem* numberItem( qulonglong number )
+{
+    auto* item = new QTableWidgetItem;
+    item->setData( Qt::DisplayRole, number );
+    item->setTextAlignment( Qt::AlignRight | Qt::AlignVCenter );
+    return item;
+}
+} // namespace
+
+ArchiveBrowserDialog::ArchiveBrowserDialog( const QString& archiveFilePath,
+                                            std::vector<ArchiveEntry> entries, QWidget* parent )
+    : QDialog( parent )
+    , archiveFilePath_( archiveFilePath )
+    , entries_( std::move( entries ) )
+{
+    setWindowTitle( tr( "Open file from archive" ) );
+    resize( 720, 480 );
+
+    patternEdit_ = new QLineEdit( this );
+    patternEdit_->setPlaceholderText( tr( "Count lines matching a pattern in each file" ) );
+    caseSensitiveBox_ = new QCheckBox( tr( "Match case" ), this );
+    searchButton_ = new QPushButton( tr( "Search" ), this );
+    searchButton_->setAutoDefault( false );
+
+    statusLabel_ = new QLabel( tr( "%1 files" ).arg( entries_.size() ), this );
+
+    table_ = new QTableWidget( static_cast<int>( entries_.size() ), 3, this );
+    table_->setHorizontalHeaderLabels( { tr( "File" ), tr( "Size" ), tr( "Matches" ) } );
+    table_->setEditTriggers( QAbstractItemView::NoEditTriggers );
+    table_->setSelectionBehavior( QAbstractItemView::SelectRows );
+    table_->setSelectionMode( QAbstractItemView::ExtendedSelection );
+    table_->verticalHeader()->hide();
+    table_->horizontalHeader()->setSectionResizeMode( EntryColumn, QHeaderView::Stretch );
+
+    // Rows are sorted, each of them keeps index of its entry
+    for ( auto index = 0u; index < entries_.size(); ++index ) {
+        const auto row = static_cast<int>( index );
+        auto* entryItem = new QTableWidgetItem( entries_[ index ].path );
+        entryItem->setData( Qt::UserRole, static_cast<qulonglong>( index ) );
+        table_->setItem( row, EntryColumn, entryItem );
+        table_->setItem( row, SizeColumn,
+                         numberItem( static_cast<qulonglong>( entries_[ index ].size ) ) );
+        table_->setItem( row, MatchesColumn, new QTableWidgetItem );
+    }
+    table_->setSortingEnabled( true );
+
+    auto* buttonBox = new QDialogButtonBox( QDialogButtonBox::Open | QDialogButtonBox::Cancel,
+                                            this );
+    auto* openButton = buttonBox->button( QDialogButtonBox::Open );
+    openButton->setEnabled( false );
+
+    connect( buttonBox, &QDialogButtonBox::accepted, this, &QDialog::accept );
+    connect( buttonBox, &QDialogButtonBox::rejected, this, &QDialog::reject );
+    connect( table_, &QTableWidget::itemSelectionChanged, this, [ this, openButton ]() {
+        openButton->setEnabled( !table_->selectionModel()->selectedRows().isEmpty() );
+    } );
+    connect( table_, &QTableWidget::cellDoubleClicked, this, &QDialog::accept );
+
+    connect( searchButton_, &QPushButton::clicked, this, [ this ]() {
+        if ( searchWatcher_.isRunning() ) {
+            stopSearch();
+        }
+        else {
+            startSearch();
+        }
+    } );
+    connect( patternEdit_, &QLineEdit::returnPressed, this, [ this ]() {
+        if ( !searchWatcher_.isRunning() ) {
+            startSearch();
+        }
+    } );
+
+    connect( &searchWatcher_, &QFutureWatcher<std::vector<uint64_t>>::finished, this,
+             &ArchiveBrowserDialog::showMatches );
+    connect( &progressTimer_, &QTimer::timeout, this, &ArchiveBrowserDialog::updateProgress );
+    progressTimer_.setInterval( ProgressIntervalMs );
+
+    auto* searchLayout = new QHBoxLayout;
+    searchLayout->addWidget( patternEdit_ );
+    searchLayout->addWidget( caseSensitiveBox_ );
+    searchLayout->addWidget( searchButton_ );
+
+    auto* layout = new QVBoxLayout( this );
+    layout->addLayout( searchLayout );
+    layout->addWidget( statusLabel_ );
+    layout->addWidget( table_ );
+    layout->addWidget( buttonBox );
+}
+
+ArchiveBrowserDialog::~ArchiveBrowserDialog()
+{
+    interrupt_.set();
+    searchWatcher_.waitForFinished();
+}
+
+QStringList ArchiveBrowserDialog::selectedEntries() const
+{
+    QStringList paths;
+    for ( const auto& index : table_->selectionModel()->selectedRows( EntryColumn ) ) {
+        const auto entry = index.data( Qt::UserRole ).toULongLong();
+        paths.append( entries_[ static_cast<size_t>( entry ) ].path );
+    }
+    return paths;
+}
+
+void ArchiveBrowserDialog::startSearch()
+{
+    const auto& config = Configuration::get();
+    const auto pattern
+        = RegularExpressionPattern( patternEdit_->text(), caseSensitiveBox_->isChecked(), false,
+                                    false,
+                                    config.mainRegexpType() == SearchRegexpType::FixedString );
+
+    interrupt_.clear();
+    searchedEntries_ = 0;
+    caseSensitiveBox_->setEnabled( false );
+    searchButton_->setText( tr( "Stop" ) );
+    updateProgress();
+    progressTimer_.start();
+
+    searchWatcher_.setFuture( QtConcurrent::run( [ this, pattern ]() {
+        return Decompressor::countMatches( archiveFilePath_, entries_, pattern, interrupt_,
+                                           searchedEntries_ );
+    } ) );
+}
+
+void ArchiveBrowserDialog::stopSearch()
+{
+    interrupt_.set();
+}
+
+void ArchiveBrowserDialog::showMatches()
+{
+    progressTimer_.stop();
+    caseSensitiveBox_->setEnabled( true );
+    searchButton_->setText( tr( "Search" ) );
+
+    const auto matches = searchWatcher_.result();
+    const auto isInterrupted = static_cast<bool>( interrupt_ );
+
+    uint64_t totalMatches = 0;
+    table_->setSortingEnabled( false );
+    for ( auto row = 0; row < table_->rowCount(); ++row ) {
+        const auto entry = static_cast<size_t>(
+            table_->item( row, EntryColumn )->data( Qt::UserRole ).toULongLong() );
+        if ( isInterrupted || entry >= matches.size() ) {
+            table_->setItem( row, MatchesColumn, new QTableWidgetItem );
+            continue;
+        }
+        table_->setItem( row, MatchesColumn, numberItem( matches[ entry ] ) );
+        totalMatches += matches[ entry ];
+    }
+    table_->setSortingEnabled( true );
+
+    if ( isInterrupted ) {
+        statusLabel_->setText( tr( "Search stopped" ) );
+    }
+    else {
+        statusLabel_->setText(
+            tr( "%1 matching lines in %2 files" ).arg( totalMatches ).arg( entries_.size() ) );
+        table_->sortByColumn( MatchesColumn, Qt::DescendingOrder );
+    }
+}
+
+void ArchiveBrowserDialog::updateProgress()
+{
+    statusLabel_->setText(
+        tr( "Searched %1 of %2 files" ).arg( searchedEntries_.load() ).arg( entries_.size() ) );
+}
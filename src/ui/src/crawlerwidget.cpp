@@ -48,21 +48,30 @@
 #include <cassert>
 #include <chrono>
 #include <iterator>
+#include <utility>
 
 #include <QAction>
 #include <QApplication>
 #include <QCompleter>
+#include <QDateTimeEdit>
+#include <QDialog>
+#include <QDialogButtonBox>
 #include <QFile>
 #include <QFileInfo>
+#include <QFormLayout>
 #include <QHeaderView>
 #include <QInputDialog>
 #include <QJsonDocument>
 #include <QKeySequence>
 #include <QLineEdit>
 #include <QListView>
+#include <QLocale>
 #include <QShortcut>
+#include <QSignalBlocker>
 #include <QStandardItemModel>
 #include <QStringListModel>
+#include <QVBoxLayout>
+#include <QtConcurrent>
 #include <qglobal.h>
 #include <string>
 
@@ -75,16 +84,23 @@
 #include "fontutils.h"
 #include "infoline.h"
 #include "overview.h"
+#include "patternlinesfinder.h"
 #include "quickfindpattern.h"
 #include "quickfindwidget.h"
+#include "readablesize.h"
 #include "savedsearches.h"
 #include "shortcuts.h"
-
-static constexpr char AnsiColorSequenceRegex[] = "\\x1B\\[([0-9]{1,2}(;[0-9]{1,2})?)?[mK]";
+#include "streamlimits.h"
+#include "tailwatcher.h"
 
 // Palette for error signaling (yellow background)
 const QPalette CrawlerWidget::ErrorPalette( Qt::darkYellow );
 
+namespace {
+// User is warned about searches expected to take longer
+constexpr std::chrono::minutes SlowSearchDuration{ 1 };
+} // namespace
+
 // Implementation of the view context for the CrawlerWidget
 class CrawlerWidgetContext : public ViewContextInterface {
   public:
@@ -93,7 +109,7 @@ class CrawlerWidgetContext : public ViewContextInterface {
     // Construct from the value passsed
     CrawlerWidgetContext( QList<int> sizes, bool ignoreCase, bool autoRefresh, bool followFile,
                           bool useRegexp, bool inverseRegexp, bool useBooleanCombination,
-                          QList<LineNumber> markedLines )
+                          SearchResultArray markedLines )
         : sizes_( sizes )
         , ignoreCase_( ignoreCase )
         , autoRefresh_( autoRefresh )
@@ -101,9 +117,8 @@ class CrawlerWidgetContext : public ViewContextInterface {
         , useRegexp_( useRegexp )
         , inverseRegexp_( inverseRegexp )
         , useBooleanCombination_( useBooleanCombination )
+        , marks_( std::move( markedLines ) )
     {
-        std::transform( markedLines.cbegin(), markedLines.cend(), std::back_inserter( marks_ ),
-                        []( const auto& m ) { return m.get(); } );
     }
 
     // Implementation of the ViewContextInterface function
@@ -140,7 +155,7 @@ class CrawlerWidgetContext : public ViewContextInterface {
         return useBooleanCombination_;
     }
 
-    QList<LineNumber::UnderlyingType> marks() const
+    const SearchResultArray& marks() const
     {
         return marks_;
     }
@@ -159,7 +174,7 @@ class CrawlerWidgetContext : public ViewContextInterface {
     bool inverseRegexp_;
     bool useBooleanCombination_;
 
-    QList<LineNumber::UnderlyingType> marks_;
+    SearchResultArray marks_;
 };
 
 // Constructor only does trivial construction. The real work is done once
@@ -217,6 +232,45 @@ QString CrawlerWidget::encodingText() const
     return encodingText_;
 }
 
+QString CrawlerWidget::ingestRateText() const
+{
+    const auto rate = logData_->getIngestRate();
+    const auto now = QDateTime::currentMSecsSinceEpoch();
+    if ( !isFollowEnabled() || rate.linesPerSecond( now ) <= 0.0 ) {
+        return {};
+    }
+
+    return tr( "%1/s, %2 lines/s" )
+        .arg( readableSize( static_cast<uint64_t>( rate.bytesPerSecond( now ) ) ),
+              QLocale().toString( static_cast<qulonglong>( rate.linesPerSecond( now ) ) ) );
+}
+
+QString CrawlerWidget::memoryUsageText() const
+{
+    auto parts = logData_->memoryUsageParts();
+    const auto searchParts = logFilteredData_->memoryUsageParts();
+    parts.insert( parts.end(), searchParts.begin(), searchParts.end() );
+    parts.emplace_back( "Highlighting", highlighterCache_.allocatedSize() );
+
+    QStringList lines;
+    size_t total = 0;
+    for ( const auto& [ name, size ] : parts ) {
+        lines << QString( "%1: %2" ).arg( name, readableSize( size ) );
+        total += size;
+    }
+    lines << tr( "Total: %1" ).arg( readableSize( total ) );
+
+    // Helps to compare line index backends
+    const auto lineIndexSize = parts.front().second;
+    if ( lineIndexSize > 0 ) {
+        const auto linesPerMb = static_cast<double>( logData_->getNbLine().get() ) * 1024 * 1024
+                                / static_cast<double>( lineIndexSize );
+        lines << tr( "Lines per MiB of line index: %1" ).arg( qRound64( linesPerMb ) );
+    }
+
+    return lines.join( '\n' );
+}
+
 // Return a pointer to the view in which we should do the QuickFind
 SearchableWidgetInterface* CrawlerWidget::doGetActiveSearchable() const
 {
@@ -259,6 +313,7 @@ void CrawlerWidget::stopLoading()
 {
     logFilteredData_->interruptSearch();
     logData_->interruptLoading();
+    tailWatchInterrupt_->set();
 }
 
 void CrawlerWidget::reload()
@@ -351,9 +406,7 @@ void CrawlerWidget::doSetViewContext( const QString& view_context )
     const auto& config = Configuration::get();
     logMainView_->followSet( context.followFile() && config.anyFileWatchEnabled() );
 
-    const auto savedMarks = context.marks();
-    std::transform( savedMarks.cbegin(), savedMarks.cend(), std::back_inserter( savedMarkedLines_ ),
-                    []( const auto& l ) { return LineNumber( l ); } );
+    savedMarks_ = context.marks();
 }
 
 std::shared_ptr<const ViewContextInterface> CrawlerWidget::doGetViewContext() const
@@ -361,7 +414,7 @@ std::shared_ptr<const ViewContextInterface> CrawlerWidget::doGetViewContext() co
     auto context = std::make_shared<const CrawlerWidgetContext>(
         sizes(), ( !matchCaseButton_->isChecked() ), searchRefreshButton_->isChecked(),
         logMainView_->isFollowEnabled(), useRegexpButton_->isChecked(), inverseButton_->isChecked(),
-        booleanButton_->isChecked(), logFilteredData_->getMarks() );
+        booleanButton_->isChecked(), logFilteredData_->getMarkedLines() );
 
     return static_cast<std::shared_ptr<const ViewContextInterface>>( context );
 }
@@ -372,6 +425,8 @@ std::shared_ptr<const ViewContextInterface> CrawlerWidget::doGetViewContext() co
 
 void CrawlerWidget::startNewSearch()
 {
+    liveSearchTimer_.stop();
+
     // Record the search line in the recent list
     // (reload the list first in case another glogg changed it)
     auto& searches = SavedSearches::getSynced();
@@ -384,6 +439,122 @@ void CrawlerWidget::startNewSearch()
     replaceCurrentSearch( searchLineEdit_->currentText() );
 }
 
+void CrawlerWidget::searchWithPredefinedFilters()
+{
+    // Patterns are built the same way as when a filter is selected,
+    // so selecting it later gets results from the cache
+    std::vector<RegularExpressionPattern> filterPatterns;
+    const auto filters = PredefinedFiltersCollection::getSynced().getFilters();
+    for ( const auto& filter : filters ) {
+        filterPatterns.push_back(
+            makeSearchPattern( escapeSearchPattern( filter.pattern, filter.useRegex ) ) );
+    }
+
+    auto& searches = SavedSearches::getSynced();
+    savedSearches_->addRecent( searchLineEdit_->currentText() );
+    searches.save();
+
+    updateSearchCombo();
+    replaceCurrentSearch( searchLineEdit_->currentText(), filterPatterns );
+}
+
+void CrawlerWidget::prerunPinnedFilters()
+{
+    // Patterns are built the same way as when a filter is selected
+    std::vector<RegularExpressionPattern> filterPatterns;
+    const auto filters = PredefinedFiltersCollection::getSynced().getFilters();
+    for ( const auto& filter : filters ) {
+        if ( filter.isPinned ) {
+            filterPatterns.push_back(
+                makeSearchPattern( escapeSearchPattern( filter.pattern, filter.useRegex ) ) );
+        }
+    }
+
+    if ( !filterPatterns.empty() ) {
+        logFilteredData_->prerunSearches( filterPatterns );
+    }
+}
+
+void CrawlerWidget::startWatchingTail()
+{
+    std::vector<RegularExpressionPattern> watchPatterns;
+    watchNames_.clear();
+    const auto filters = PredefinedFiltersCollection::getSynced().getFilters();
+    for ( const auto& filter : filters ) {
+        if ( filter.isWatched ) {
+            watchPatterns.push_back(
+                makeSearchPattern( escapeSearchPattern( filter.pattern, filter.useRegex ) ) );
+            watchNames_.push_back( filter.name );
+        }
+    }
+
+    if ( watchPatterns.empty() ) {
+        return;
+    }
+
+    // Lines loaded so far are not new
+    tailWatcher_ = std::make_shared<TailWatcher>( logData_.get(), std::move( watchPatterns ) );
+    tailWatcher_->skipLines( logData_->getNbLine() );
+    watchMatches_.assign( static_cast<size_t>( watchNames_.size() ), 0 );
+}
+
+void CrawlerWidget::watchAppendedLines()
+{
+    if ( !tailWatcher_ ) {
+        return;
+    }
+
+    if ( tailWatchWatcher_.isRunning() ) {
+        isTailWatchQueued_ = true;
+        return;
+    }
+
+    isTailWatchQueued_ = false;
+    tailWatchInterrupt_ = std::make_shared<AtomicFlag>();
+
+    tailWatchWatcher_.setFuture( QtConcurrent::run(
+        [ logData = logData_, watcher = tailWatcher_, count = logData_->getNbLine(),
+          isTruncated = std::exchange( isTailTruncated_, false ),
+          interrupt = tailWatchInterrupt_ ] {
+            if ( isTruncated ) {
+                watcher->skipLines( 0_lcount );
+            }
+            return watcher->watch( count, *interrupt );
+        } ) );
+}
+
+void CrawlerWidget::appendedLinesWatched()
+{
+    const auto matches = tailWatchWatcher_.result();
+
+    QStringList matchedWatches;
+    for ( auto index = 0u; index < matches.size() && index < watchMatches_.size(); ++index ) {
+        if ( matches[ index ] > 0 ) {
+            watchMatches_[ index ] += matches[ index ];
+            unseenWatchMatches_ += matches[ index ];
+            matchedWatches.push_back( QString( "%1: %2" )
+                                          .arg( watchNames_[ static_cast<int>( index ) ] )
+                                          .arg( matches[ index ] ) );
+        }
+    }
+
+    if ( !matchedWatches.isEmpty() ) {
+        QStringList counters;
+        for ( auto index = 0u; index < watchMatches_.size(); ++index ) {
+            counters.push_back( QString( "%1: %2" )
+                                    .arg( watchNames_[ static_cast<int>( index ) ] )
+                                    .arg( watchMatches_[ index ] ) );
+        }
+
+        Q_EMIT watchesMatched( matchedWatches.join( '\n' ) );
+        Q_EMIT watchMatchesChanged( unseenWatchMatches_, counters.join( '\n' ) );
+    }
+
+    if ( isTailWatchQueued_ ) {
+        watchAppendedLines();
+    }
+}
+
 void CrawlerWidget::stopSearch()
 {
     logFilteredData_->interruptSearch();
@@ -438,10 +609,165 @@ void CrawlerWidget::saveAsPredefinedFilter()
     Q_EMIT saveCurrentSearchAsPredefinedFilter( currentText );
 }
 
+void CrawlerWidget::combineWithPredefinedFilter( const PredefinedFilter& filter,
+                                                 LogFilteredData::SearchCombination combination )
+{
+    const auto filterPattern
+        = makeSearchPattern( escapeSearchPattern( filter.pattern, filter.useRegex ) );
+
+    if ( !logFilteredData_->combineWithCachedSearch( filterPattern, combination ) ) {
+        searchInfoLine_->setPalette( ErrorPalette );
+        searchInfoLine_->setText(
+            tr( "No search results for filter %1, search for it first" ).arg( filter.name ) );
+        searchInfoLine_->show();
+    }
+}
+
+void CrawlerWidget::editFilterChain()
+{
+    bool ok;
+    const auto chainText = QInputDialog::getMultiLineText(
+        this, tr( "klogg" ),
+        tr( "Filter chain, one pattern per line, lines starting with ! are excluded:" ),
+        filterChain_.join( QChar::LineFeed ), &ok );
+
+    if ( !ok ) {
+        return;
+    }
+
+#if QT_VERSION >= QT_VERSION_CHECK( 5, 15, 0 )
+    filterChain_ = chainText.split( QChar::LineFeed, Qt::SkipEmptyParts );
+#else
+    filterChain_ = chainText.split( QChar::LineFeed, QString::SkipEmptyParts );
+#endif
+
+    std::vector<RegularExpressionPattern> stages;
+    for ( const auto& stage : qAsConst( filterChain_ ) ) {
+        const auto isExclude = stage.startsWith( QChar( '!' ) );
+        auto pattern = makeSearchPattern( isExclude ? stage.mid( 1 ) : stage );
+        pattern.isExclude = isExclude;
+
+        const RegularExpression expression( pattern );
+        if ( !expression.isValid() ) {
+            showExpressionError( expression.errorString() );
+            return;
+        }
+        stages.push_back( std::move( pattern ) );
+    }
+
+    if ( stages.empty() ) {
+        return;
+    }
+
+    LOG_INFO << "running filter chain of " << stages.size() << " stages";
+    logFilteredData_->interruptSearch();
+    // Wait for the last update of interrupted search, see replaceCurrentSearch
+    QApplication::processEvents( QEventLoop::ExcludeUserInputEvents );
+
+    nbMatches_ = 0_lcount;
+    estimatedMatches_.reset();
+    patternHits_.clear();
+    searchInfoLine_->setDetails( {} );
+
+    logFilteredData_->runFilterChain( stages );
+    filteredView_->updateData();
+    overview_.updateData( logData_->getNbLine() );
+
+    stopButton_->setEnabled( true );
+    stopButton_->show();
+    searchButton_->hide();
+    searchState_.startSearch();
+    searchInfoLine_->hide();
+    updateSearchHighlighter( {} );
+}
+
 void CrawlerWidget::showSearchContextMenu()
 {
-    if ( searchLineContextMenu_ )
-        searchLineContextMenu_->exec( QCursor::pos() );
+    if ( !searchLineContextMenu_ )
+        return;
+
+    // Filters can be changed in settings, so the list is rebuilt every time
+    combineWithFilterMenu_->clear();
+    const auto filters = PredefinedFiltersCollection::getSynced().getFilters();
+    for ( const auto& filter : filters ) {
+        auto filterMenu = combineWithFilterMenu_->addMenu( filter.name );
+
+        const auto addCombination
+            = [ this, filterMenu, filter ]( const QString& name,
+                                            LogFilteredData::SearchCombination combination ) {
+                  connect( filterMenu->addAction( name ), &QAction::triggered, this,
+                           [ this, filter, combination ]() {
+                               combineWithPredefinedFilter( filter, combination );
+                           } );
+              };
+
+        addCombination( tr( "Add matches" ), LogFilteredData::SearchCombination::Union );
+        addCombination( tr( "Keep common matches" ),
+                        LogFilteredData::SearchCombination::Intersection );
+        addCombination( tr( "Remove matches" ), LogFilteredData::SearchCombination::Difference );
+    }
+    combineWithFilterMenu_->setEnabled( !filters.isEmpty() );
+
+    searchLineContextMenu_->exec( QCursor::pos() );
+}
+
+// Phases of search and indexing tell if the search was limited by disk or CPU
+void CrawlerWidget::updateSearchStats( const OperationStats& searchStats )
+{
+    searchInfoLine_->setDetails( tr( "Search\n%1\n\nIndexing\n%2" )
+                                     .arg( searchStats.toString(),
+                                           logData_->getIndexingStats().toString() ) );
+
+    // Hits of boolean search patterns are shown with the number of matches
+    patternHits_ = searchStats.patternHitsString();
+    if ( !patternHits_.isEmpty() ) {
+        printSearchInfoMessage( nbMatches_ );
+    }
+}
+
+void CrawlerWidget::updateSearchEstimate( LinesCount estimatedMatches )
+{
+    estimatedMatches_ = estimatedMatches;
+
+    auto text = tr( "Search in progress... about %1 match%2 expected." )
+                    .arg( QString::number( estimatedMatches.get() ),
+                          QLatin1String( estimatedMatches.get() > 1 ? "es" : "" ) );
+
+    // Matching speed measured on the sample tells how long the search takes at least
+    const auto& estimate = logFilteredData_->getSearchEstimate();
+    if ( estimate ) {
+        text += tr( " %1 matches %2/s." )
+                    .arg( estimate->engine, readableSize( estimate->bytesPerSecond ) );
+
+        if ( estimate->duration >= SlowSearchDuration ) {
+            const auto minutes = std::chrono::duration_cast<std::chrono::minutes>(
+                                     estimate->duration + std::chrono::seconds( 30 ) )
+                                     .count();
+            text += tr( " Search may take about %1 min, it can be stopped." ).arg( minutes );
+            searchInfoLine_->setPalette( ErrorPalette );
+        }
+    }
+
+    searchInfoLine_->setText( text );
+    searchInfoLine_->show();
+
+    // Overview shows where the matches are expected
+    overview_.updateData( logData_->getNbLine() );
+    logMainView_->refreshOverview();
+}
+
+void CrawlerWidget::showMatchCount( LinesCount nbMatches )
+{
+    // Count of a pattern typed before is dropped
+    if ( !countedPattern_ || !( *countedPattern_ == searchPattern() ) ) {
+        return;
+    }
+
+    searchInfoLine_->setPalette( searchInfoLineDefaultPalette_ );
+    searchInfoLine_->setText( tr( "%1 matching line%2, press Enter to search." )
+                                  .arg( QString::number( nbMatches.get() ),
+                                        QLatin1String( nbMatches.get() != 1 ? "s" : "" ) ) );
+    searchInfoLine_->show();
 }
 
 // When receiving the 'newDataAvailable' signal from LogFilteredData
@@ -454,6 +780,12 @@ void CrawlerWidget::updateFilteredView( LinesCount nbMatches, int progress,
 
     if ( progress == 100 ) {
         // Searching done
+        Q_EMIT searchFinished( nbMatches );
+        estimatedMatches_.reset();
+        if ( !overview_.getEstimatedLines()->empty() ) {
+            overview_.updateData( logData_->getNbLine() );
+            logMainView_->refreshOverview();
+        }
         printSearchInfoMessage( nbMatches );
         searchInfoLine_->hideGauge();
         // De-activate the stop button
@@ -464,7 +796,16 @@ void CrawlerWidget::updateFilteredView( LinesCount nbMatches, int progress,
     else {
         // Search in progress
         // We ignore 0% and 100% to avoid a flash when the search is very short
-        if ( progress > 0 ) {
+        if ( progress > 0 && estimatedMatches_ ) {
+            searchInfoLine_->setText(
+                tr( "Search in progress (%1 %)... %2 match%3 found so far, about %4 expected." )
+                    .arg( QString::number( progress ), QString::number( nbMatches.get() ),
+                          QLatin1String( nbMatches.get() > 1 ? "es" : "" ),
+                          QString::number( estimatedMatches_->get() ) ) );
+
+            searchInfoLine_->displayGauge( progress );
+        }
+        else if ( progress > 0 ) {
             searchInfoLine_->setText(
                 tr( "Search in progress (%1 %)... %2 match%3 found so far." )
                     .arg( QString::number( progress ), QString::number( nbMatches.get() ),
@@ -478,11 +819,13 @@ void CrawlerWidget::updateFilteredView( LinesCount nbMatches, int progress,
     if ( nbMatches != nbMatches_ ) {
         nbMatches_ = nbMatches;
 
+        updateTimeHistogram();
+
         // Recompute the content of the filtered window.
         filteredView_->updateData();
 
         // Update the match overview
-        overview_.updateData( logData_->getNbLine() );
+        overview_.addNewMatches( logData_->getNbLine() );
 
         // New data found icon
         if ( initialPosition > 0_lnum ) {
@@ -520,40 +863,24 @@ void CrawlerWidget::updateLineNumberHandler( LineNumber line )
 
 void CrawlerWidget::markLinesFromMain( const std::vector<LineNumber>& lines )
 {
-    std::vector<LineNumber> alreadyMarkedLines;
-    alreadyMarkedLines.reserve( lines.size() );
-
-    bool markAdded = false;
+    // Lines are marked unless all of them are marked already
+    SearchResultArray linesToMark;
+    bool hasUnmarkedLines = false;
     for ( const auto& line : lines ) {
-        if ( line > logData_->getNbLine() ) {
+        if ( line >= logData_->getNbLine() ) {
             continue;
         }
 
-        if ( !logFilteredData_->lineTypeByLine( line ).testFlag(
-                 AbstractLogData::LineTypeFlags::Mark ) ) {
-            logFilteredData_->addMark( line );
-            markAdded = true;
-        }
-        else {
-            alreadyMarkedLines.push_back( line );
-        }
-    }
-
-    if ( !markAdded ) {
-        for ( const auto& line : alreadyMarkedLines ) {
-            logFilteredData_->toggleMark( line );
-        }
+        linesToMark.add( line.get() );
+        hasUnmarkedLines = hasUnmarkedLines
+                           || !logFilteredData_->lineTypeByLine( line ).testFlag(
+                               AbstractLogData::LineTypeFlags::Mark );
     }
 
-    // Recompute the content of both window.
-    filteredView_->updateData();
-    logMainView_->updateData();
-
-    // Update the match overview
-    overview_.updateData( logData_->getNbLine() );
-
-    // Also update the top window for the coloured bullets.
-    update();
+    logFilteredData_->changeMarks( linesToMark, hasUnmarkedLines
+                                                    ? LogFilteredData::MarksChange::Add
+                                                    : LogFilteredData::MarksChange::Remove );
+    updateMarks();
 }
 
 void CrawlerWidget::markLinesFromFiltered( const std::vector<LineNumber>& lines )
@@ -572,6 +899,142 @@ void CrawlerWidget::markLinesFromFiltered( const std::vector<LineNumber>& lines
     markLinesFromMain( linesInMain );
 }
 
+void CrawlerWidget::unmarkLinesFromMain( const std::vector<LineNumber>& lines )
+{
+    // Selection of the main view is a range of lines
+    if ( !lines.empty() ) {
+        logFilteredData_->unmarkRange( lines.front(), lines.back() + 1_lcount );
+        updateMarks();
+    }
+}
+
+void CrawlerWidget::unmarkLinesFromFiltered( const std::vector<LineNumber>& lines )
+{
+    SearchResultArray linesInMain;
+    for ( const auto& filteredLine : lines ) {
+        if ( filteredLine < logFilteredData_->getNbLine() ) {
+            linesInMain.add( logFilteredData_->getMatchingLineNumber( filteredLine ).get() );
+        }
+    }
+
+    logFilteredData_->changeMarks( linesInMain, LogFilteredData::MarksChange::Remove );
+    updateMarks();
+}
+
+void CrawlerWidget::markAllMatches()
+{
+    logFilteredData_->markAllMatches();
+    updateMarks();
+}
+
+void CrawlerWidget::showTemplateLines( const SearchResultArray& lines )
+{
+    showLines( lines );
+}
+
+std::shared_ptr<const LogData> CrawlerWidget::logData() const
+{
+    return logData_;
+}
+
+bool CrawlerWidget::addAnalysisToBundle( AnalysisBundle& bundle ) const
+{
+    if ( !logData_ || !logData_->addIndexToBundle( bundle ) ) {
+        return false;
+    }
+
+    bundle.searchResults = logFilteredData_->getCachedSearchResults();
+    bundle.marks = logFilteredData_->getMarkedLines();
+    return true;
+}
+
+void CrawlerWidget::addBundledMarks( const SearchResultArray& marks )
+{
+    if ( !firstLoadDone_ ) {
+        savedMarks_ |= marks;
+        return;
+    }
+
+    logFilteredData_->addMarks( marks );
+    updateMarks();
+}
+
+void CrawlerWidget::showLines( const SearchResultArray& lines )
+{
+    logFilteredData_->showLines( lines );
+
+    // Another template can have the same number of lines
+    nbMatches_ = LinesCount( lines.cardinality() );
+    filteredView_->updateData();
+    overview_.updateData( logData_->getNbLine() );
+    logMainView_->refreshOverview();
+    updateTimeHistogram();
+    update();
+}
+
+void CrawlerWidget::updateMarks()
+{
+    // Recompute the content of both window.
+    filteredView_->updateData();
+    logMainView_->updateData();
+
+    // Update the match overview
+    overview_.updateData( logData_->getNbLine() );
+    updateTimeHistogram();
+
+    // Also update the top window for the coloured bullets.
+    update();
+}
+
+void CrawlerWidget::showTimeHistogram()
+{
+    constexpr int HistogramBuckets = 100;
+
+    if ( timeHistogram_ ) {
+        timeHistogram_->window()->raise();
+        timeHistogram_->window()->activateWindow();
+        return;
+    }
+
+    // Intervals are found once, their lines do not change while matches are added
+    QApplication::setOverrideCursor( Qt::WaitCursor );
+    const auto buckets = logData_->getTimeBuckets( HistogramBuckets );
+    QApplication::restoreOverrideCursor();
+
+    if ( !buckets ) {
+        searchInfoLine_->setPalette( ErrorPalette );
+        searchInfoLine_->setText( tr( "File is not indexed with timestamps" ) );
+        searchInfoLine_->show();
+        return;
+    }
+
+    auto* histogramDialog = new QDialog( this );
+    histogramDialog->setAttribute( Qt::WA_DeleteOnClose );
+    histogramDialog->setWindowTitle( tr( "Matches over time" ) );
+
+    timeHistogram_ = new TimeHistogramWidget( histogramDialog );
+    timeHistogram_->setBuckets( *buckets );
+    connect( timeHistogram_, &TimeHistogramWidget::lineClicked, logMainView_,
+             &LogMainView::selectAndDisplayLine );
+
+    auto* layout = new QVBoxLayout( histogramDialog );
+    layout->addWidget( timeHistogram_ );
+
+    updateTimeHistogram();
+    histogramDialog->show();
+}
+
+void CrawlerWidget::updateTimeHistogram()
+{
+    if ( !timeHistogram_ ) {
+        return;
+    }
+
+    auto [ matches, marks ]
+        = logFilteredData_->countLinesBetween( timeHistogram_->buckets().boundaries );
+    timeHistogram_->setCounts( std::move( matches ), std::move( marks ) );
+}
+
 void CrawlerWidget::applyConfiguration()
 {
     const auto& config = Configuration::get();
@@ -590,13 +1053,18 @@ void CrawlerWidget::applyConfiguration()
         font.setStyleStrategy( QFont::PreferAntialias );
     }
 
-    if ( config.hideAnsiColorSequences() ) {
-        logData_->setPrefilter( AnsiColorSequenceRegex );
+    if ( config.hideAnsiColorSequences() || config.renderAnsiColors() ) {
+        logData_->setPrefilter( LinePrefilter::AnsiColorSequences );
     }
     else {
         logData_->setPrefilter( {} );
     }
 
+    // Context lines are found again from current matches
+    logFilteredData_->setContextLines( LinesCount(
+        static_cast<LinesCount::UnderlyingType>( std::max( 0, config.searchContextLines() ) ) ) );
+    filteredView_->updateData();
+
     logMainView_->setLineNumbersVisible( config.mainLineNumbersVisible() );
     filteredView_->setLineNumbersVisible( config.filteredLineNumbersVisible() );
 
@@ -606,6 +1074,10 @@ void CrawlerWidget::applyConfiguration()
 
     overview_.setVisible( config.isOverviewVisible() );
     logMainView_->refreshOverview();
+    updateHighlighterLines();
+
+    // Highlighting options of the search may have changed
+    updateSearchHighlighter( highlightedPattern_ );
 
     logMainView_->updateFont( font );
     filteredView_->updateFont( font );
@@ -652,7 +1124,18 @@ void CrawlerWidget::loadingFinishedHandler( LoadingStatus status )
 
     // FIXME, handle topLine
     // logMainView_->updateData( logData_, topLine );
-    logMainView_->updateData();
+    if ( firstLoadDone_ && dataAppended_ && status == LoadingStatus::Successful ) {
+        logMainView_->updateAppendedData();
+    }
+    if ( firstLoadDone_ && status == LoadingStatus::Successful ) {
+        watchAppendedLines();
+    }
+    else {
+        logMainView_->updateData();
+    }
+    dataAppended_ = false;
+
+    updateHighlighterLines();
 
     // Shall we Forbid starting a search when loading in progress?
     // searchButton_->setEnabled( false );
@@ -668,6 +1151,12 @@ void CrawlerWidget::loadingFinishedHandler( LoadingStatus status )
         else
             logFilteredData_->updateSearch( searchStartLine_, searchEndLine_ );
     }
+    else if ( searchState_.isFileTruncated() && nbMatches_ > 0_lcount ) {
+        // Invalidate the search
+        logFilteredData_->clearSearch();
+        filteredView_->updateData();
+        nbMatches_ = 0_lcount;
+    }
 
     // Set the encoding for the views
     updateEncoding();
@@ -680,8 +1169,14 @@ void CrawlerWidget::loadingFinishedHandler( LoadingStatus status )
     }
     else {
         firstLoadDone_ = true;
-        for ( const auto& m : savedMarkedLines_ ) {
-            logFilteredData_->addMark( m );
+        logFilteredData_->addMarks( savedMarks_ );
+        savedMarks_ = {};
+
+        // Results of pinned filters are cached for the whole file,
+        // they are extended by the search when the file grows
+        if ( status == LoadingStatus::Successful ) {
+            prerunPinnedFilters();
+            startWatchingTail();
         }
     }
 
@@ -691,18 +1186,21 @@ void CrawlerWidget::loadingFinishedHandler( LoadingStatus status )
 
 void CrawlerWidget::fileChangedHandler( MonitoredFileStatus status )
 {
+    dataAppended_ = status == MonitoredFileStatus::DataAdded;
+
     // Handle the case where the file has been truncated
     if ( status == MonitoredFileStatus::Truncated ) {
+        // All lines of the file are new
+        isTailTruncated_ = true;
+
         // Clear all marks (TODO offer the option to keep them)
         logFilteredData_->clearMarks();
         if ( !searchInfoLine_->text().isEmpty() ) {
-            // Invalidate the search
-            constexpr auto DropCache = true;
-            logFilteredData_->clearSearch( DropCache );
-            filteredView_->updateData();
+            // Results match lines of the old index, which is shown until
+            // the file is indexed again, they are invalidated then
+            logFilteredData_->interruptSearch();
             searchState_.truncateFile();
             printSearchInfoMessage();
-            nbMatches_ = 0_lcount;
         }
     }
 }
@@ -749,6 +1247,125 @@ void CrawlerWidget::resetStateOnSearchPatternChanges()
 
     searchState_.changeExpression();
     printSearchInfoMessage( logFilteredData_->getNbMatches() );
+
+    compileSearchPattern();
+}
+
+void CrawlerWidget::compileSearchPattern()
+{
+    if ( searchText().isEmpty() ) {
+        return;
+    }
+
+    auto pattern = searchPattern();
+    if ( expressionWatcher_.isRunning() ) {
+        // Compilation can't be interrupted, result of the stale pattern is dropped
+        queuedPattern_ = pattern == compilingPattern_
+                             ? std::nullopt
+                             : std::make_optional( std::move( pattern ) );
+        return;
+    }
+
+    queuedPattern_.reset();
+    if ( compiledExpression_ && pattern == compiledPattern_ ) {
+        return;
+    }
+
+    // Hyperscan databases are also kept in HsDatabaseCache,
+    // so patterns typed again are not compiled again
+    compilingPattern_ = std::move( pattern );
+    expressionWatcher_.setFuture( QtConcurrent::run( [ pattern = compilingPattern_ ] {
+        return std::make_shared<const RegularExpression>( pattern );
+    } ) );
+}
+
+void CrawlerWidget::searchPatternCompiled()
+{
+    const auto expression = expressionWatcher_.result();
+    const auto isCurrent = !searchText().isEmpty() && compilingPattern_ == searchPattern();
+
+    if ( isCurrent ) {
+        compiledPattern_ = compilingPattern_;
+        compiledExpression_ = expression;
+
+        if ( !expression->isValid() ) {
+            showExpressionError( expression->errorString() );
+        }
+    }
+
+    if ( queuedPattern_ ) {
+        queuedPattern_.reset();
+        compileSearchPattern();
+    }
+}
+
+void CrawlerWidget::updateSearchHighlighter( const RegularExpressionPattern& pattern )
+{
+    highlightedPattern_ = pattern;
+
+    // Pattern is compiled once and shared by both views
+    const auto& config = Configuration::get();
+    std::shared_ptr<const SearchHighlighter> searchHighlighter;
+    if ( config.mainSearchHighlight() && SearchHighlighter::canHighlight( pattern ) ) {
+        searchHighlighter = std::make_shared<const SearchHighlighter>(
+            pattern, config.variateMainSearchHighlight(), config.mainSearchBackColor() );
+    }
+
+    logMainView_->setSearchHighlighter( searchHighlighter );
+    filteredView_->setSearchHighlighter( searchHighlighter );
+}
+
+void CrawlerWidget::updateHighlighterLines()
+{
+    const auto highlighterSet = HighlighterSetCollection::get().currentActiveSet();
+    const auto key = std::make_pair( highlighterSet.fingerprint(), logData_->getNbLine() );
+    if ( !overview_.isVisible() || key == highlighterLinesKey_ ) {
+        return;
+    }
+
+    if ( highlighterLinesWatcher_.isRunning() ) {
+        // Lines are matched again when the running pass stops
+        highlighterLinesInterrupt_->set();
+        return;
+    }
+
+    const auto isAppended
+        = key.first == highlighterLinesKey_.first && key.second > highlighterLinesKey_.second;
+    highlighterLinesFirst_ = isAppended ? LineNumber( highlighterLinesKey_.second.get() ) : 0_lnum;
+    highlighterLinesKey_ = key;
+    highlighterLinesColors_ = highlighterSet.lineColors();
+    highlighterLinesInterrupt_ = std::make_shared<AtomicFlag>();
+
+    highlighterLinesWatcher_.setFuture( QtConcurrent::run(
+        [ logData = logData_, first = highlighterLinesFirst_, count = key.second,
+          patterns = highlighterSet.patterns(), interrupt = highlighterLinesInterrupt_ ] {
+            return PatternLinesFinder( logData.get(), first, count - LinesCount( first.get() ) )
+                .find( patterns, *interrupt );
+        } ) );
+}
+
+void CrawlerWidget::highlighterLinesFound()
+{
+    if ( *highlighterLinesInterrupt_ ) {
+        // Lines found so far are not complete
+        highlighterLinesKey_ = {};
+        updateHighlighterLines();
+        return;
+    }
+
+    const auto lines = highlighterLinesWatcher_.result();
+    if ( highlighterLinesFirst_ > 0_lnum ) {
+        overview_.appendHighlighterLines( lines );
+    }
+    else {
+        std::vector<Overview::HighlighterLines> highlighterLines;
+        for ( auto index = 0u; index < lines.size() && index < highlighterLinesColors_.size();
+              ++index ) {
+            highlighterLines.push_back( { highlighterLinesColors_[ index ], lines[ index ] } );
+        }
+        overview_.setHighlighterLines( std::move( highlighterLines ) );
+    }
+    logMainView_->refreshOverview();
 }
 
 void CrawlerWidget::searchRefreshChangedHandler( bool isRefreshing )
@@ -778,6 +1395,16 @@ void CrawlerWidget::useRegexpChangeHandler( bool )
 void CrawlerWidget::searchTextChangeHandler( QString )
 {
     resetStateOnSearchPatternChanges();
+
+    // Running search is interrupted when typing pauses, a narrower
+    // pattern only reads lines that still can match
+    const auto& config = Configuration::get();
+    if ( config.liveSearch() ) {
+        liveSearchTimer_.start( config.liveSearchDelayMs() );
+    }
+    else {
+        matchCountTimer_.start( config.liveSearchDelayMs() );
+    }
 }
 
 void CrawlerWidget::changeFilteredViewVisibility( int index )
@@ -793,6 +1420,75 @@ void CrawlerWidget::changeFilteredViewVisibility( int index )
     }
 }
 
+void CrawlerWidget::sortFilteredViewByTime( bool isSorted )
+{
+    if ( isSorted && logData_->getTimestampFormat().isEmpty() ) {
+        searchInfoLine_->setPalette( ErrorPalette );
+        searchInfoLine_->setText( tr( "File is not indexed with timestamps" ) );
+        searchInfoLine_->show();
+
+        const QSignalBlocker blocker( sortByTimeAction_ );
+        sortByTimeAction_->setChecked( false );
+        return;
+    }
+
+    QApplication::setOverrideCursor( Qt::WaitCursor );
+    logFilteredData_->setTimeOrdered( isSorted );
+    QApplication::restoreOverrideCursor();
+    filteredView_->updateData();
+
+    if ( logFilteredData_->getNbLine() > 0_lcount ) {
+        const auto lineIndex = logFilteredData_->getLineIndexNumber( currentLineNumber_ );
+        filteredView_->selectAndDisplayLine( lineIndex );
+    }
+}
+
+void CrawlerWidget::hideRepeatedLines( bool isHidden )
+{
+    if ( isHidden && !logData_->hasLineHashes() ) {
+        searchInfoLine_->setPalette( ErrorPalette );
+        searchInfoLine_->setText( tr( "File is not indexed with line hashes" ) );
+        searchInfoLine_->show();
+
+        const QSignalBlocker blocker( hideRepeatedLinesAction_ );
+        hideRepeatedLinesAction_->setChecked( false );
+        return;
+    }
+
+    QApplication::setOverrideCursor( Qt::WaitCursor );
+    logFilteredData_->setRepeatedLinesHidden( isHidden );
+    QApplication::restoreOverrideCursor();
+    filteredView_->updateData();
+
+    if ( logFilteredData_->getNbLine() > 0_lcount ) {
+        const auto lineIndex = logFilteredData_->getLineIndexNumber( currentLineNumber_ );
+        filteredView_->selectAndDisplayLine( lineIndex );
+    }
+}
+
+void CrawlerWidget::showWholeRecords( bool isShown )
+{
+    if ( isShown && !logData_->hasRecordIndex() ) {
+        searchInfoLine_->setPalette( ErrorPalette );
+        searchInfoLine_->setText( tr( "File is not indexed with record starts" ) );
+        searchInfoLine_->show();
+
+        const QSignalBlocker blocker( showWholeRecordsAction_ );
+        showWholeRecordsAction_->setChecked( false );
+        return;
+    }
+
+    QApplication::setOverrideCursor( Qt::WaitCursor );
+    logFilteredData_->setWholeRecordsShown( isShown );
+    QApplication::restoreOverrideCursor();
+    filteredView_->updateData();
+
+    if ( logFilteredData_->getNbLine() > 0_lcount ) {
+        const auto lineIndex = logFilteredData_->getLineIndexNumber( currentLineNumber_ );
+        filteredView_->selectAndDisplayLine( lineIndex );
+    }
+}
+
 void CrawlerWidget::setSearchPatternFromPredefinedFilters( const QList<PredefinedFilter>& filters )
 {
     QString searchPattern;
@@ -885,6 +1581,11 @@ void CrawlerWidget::mouseHoveredOverMatch( LineNumber line )
 void CrawlerWidget::activityDetected()
 {
     changeDataStatus( DataStatus::OLD_DATA );
+
+    if ( unseenWatchMatches_ > 0 ) {
+        unseenWatchMatches_ = 0;
+        Q_EMIT watchMatchesChanged( 0, {} );
+    }
 }
 
 void CrawlerWidget::setSearchLimits( LineNumber startLine, LineNumber endLine )
@@ -901,6 +1602,63 @@ void CrawlerWidget::clearSearchLimits()
     setSearchLimits( 0_lnum, LineNumber( logData_->getNbLine().get() ) );
 }
 
+void CrawlerWidget::setSearchTimeRange()
+{
+    // Time span of the file is the initial range
+    const auto timeSpan = logData_->getTimeBuckets( 1 );
+    if ( !timeSpan ) {
+        searchInfoLine_->setPalette( ErrorPalette );
+        searchInfoLine_->setText( tr( "File is not indexed with timestamps" ) );
+        searchInfoLine_->show();
+        return;
+    }
+
+    // Timestamps are times written in lines taken as UTC, see TimestampParser
+    const auto makeTimeEdit = [ this ]( qint64 timestamp ) {
+        auto* timeEdit = new QDateTimeEdit( this );
+        timeEdit->setTimeSpec( Qt::UTC );
+        timeEdit->setDisplayFormat( "yyyy-MM-dd HH:mm:ss.zzz" );
+        timeEdit->setDateTime( QDateTime::fromMSecsSinceEpoch( timestamp, Qt::UTC ) );
+        return timeEdit;
+    };
+
+    QDialog dialog( this );
+    dialog.setWindowTitle( tr( "Search time range" ) );
+
+    auto* beginEdit = makeTimeEdit( timeSpan->begin );
+    auto* endEdit = makeTimeEdit( timeSpan->begin + timeSpan->duration );
+    auto* buttonBox = new QDialogButtonBox( QDialogButtonBox::Ok | QDialogButtonBox::Cancel );
+    connect( buttonBox, &QDialogButtonBox::accepted, &dialog, &QDialog::accept );
+    connect( buttonBox, &QDialogButtonBox::rejected, &dialog, &QDialog::reject );
+
+    auto* layout = new QFormLayout( &dialog );
+    layout->addRow( tr( "From:" ), beginEdit );
+    layout->addRow( tr( "To:" ), endEdit );
+    layout->addRow( buttonBox );
+
+    if ( dialog.exec() != QDialog::Accepted ) {
+        return;
+    }
+
+    QApplication::setOverrideCursor( Qt::WaitCursor );
+    const auto lines = logData_->getLinesInTimeRange( beginEdit->dateTime(), endEdit->dateTime() );
+    QApplication::restoreOverrideCursor();
+
+    if ( !lines ) {
+        searchInfoLine_->setPalette( ErrorPalette );
+        searchInfoLine_->setText( tr( "File is not indexed with timestamps" ) );
+        searchInfoLine_->show();
+        return;
+    }
+
+    setSearchLimits( lines->first, lines->second );
+
+    // Current search is run again in the new limits
+    if ( !searchLineEdit_->currentText().isEmpty() ) {
+        replaceCurrentSearch( searchLineEdit_->currentText() );
+    }
+}
+
 //
 // Private functions
 //
@@ -927,6 +1685,14 @@ void CrawlerWidget::setup()
     filteredView_ = new FilteredView( logFilteredData_.get(), quickFindPattern_.get() );
     filteredView_->setContentsMargins( 2, 0, 2, 0 );
 
+    logMainView_->setHighlighterCache( &highlighterCache_ );
+    filteredView_->setHighlighterCache( &highlighterCache_ );
+
+    // Lines found by the main search are the quick find matches in the main view
+    logMainView_->setQuickFindMatchesProvider( [ this ]( const QRegularExpression& regexp ) {
+        return logFilteredData_->getCachedMatches( regexp );
+    } );
+
     overviewWidget_->setOverview( &overview_ );
     overviewWidget_->setParent( logMainView_ );
 
@@ -1039,10 +1805,27 @@ void CrawlerWidget::setup()
     QAction* clearSearchHistoryAction = new QAction( "Clear search history", this );
     QAction* editSearchHistoryAction = new QAction( "Edit search history", this );
     QAction* saveAsPredefinedFilterAction = new QAction( "Save as Filter", this );
+    QAction* searchWithPredefinedFiltersAction
+        = new QAction( "Search with all Filters", this );
+    QAction* filterChainAction = new QAction( "Filter chain...", this );
+    QAction* showTimeHistogramAction = new QAction( "Show matches over time", this );
+    sortByTimeAction_ = new QAction( "Sort matches by time", this );
+    sortByTimeAction_->setCheckable( true );
+    hideRepeatedLinesAction_ = new QAction( "Hide repeated lines", this );
+    hideRepeatedLinesAction_->setCheckable( true );
+    showWholeRecordsAction_ = new QAction( "Show whole records", this );
+    showWholeRecordsAction_->setCheckable( true );
 
     searchLineContextMenu_ = searchLineEdit_->lineEdit()->createStandardContextMenu();
     searchLineContextMenu_->addSeparator();
     searchLineContextMenu_->addAction( saveAsPredefinedFilterAction );
+    searchLineContextMenu_->addAction( searchWithPredefinedFiltersAction );
+    combineWithFilterMenu_ = searchLineContextMenu_->addMenu( "Combine with Filter" );
+    searchLineContextMenu_->addAction( filterChainAction );
+    searchLineContextMenu_->addAction( showTimeHistogramAction );
+    searchLineContextMenu_->addAction( sortByTimeAction_ );
+    searchLineContextMenu_->addAction( hideRepeatedLinesAction_ );
+    searchLineContextMenu_->addAction( showWholeRecordsAction_ );
     searchLineContextMenu_->addSeparator();
     searchLineContextMenu_->addAction( editSearchHistoryAction );
     searchLineContextMenu_->addAction( clearSearchHistoryAction );
@@ -1112,6 +1895,38 @@ void CrawlerWidget::setup()
     connect( searchLineEdit_->lineEdit(), &QLineEdit::textEdited, this,
              &CrawlerWidget::searchTextChangeHandler );
 
+    // Live searches are not recorded in the history
+    liveSearchTimer_.setSingleShot( true );
+    connect( &liveSearchTimer_, &QTimer::timeout, this,
+             [ this ] { replaceCurrentSearch( searchLineEdit_->currentText() ); } );
+
+    // Counting does not change results of the current search
+    matchCountTimer_.setSingleShot( true );
+    connect( &matchCountTimer_, &QTimer::timeout, this, [ this ] {
+        if ( searchText().isEmpty() ) {
+            return;
+        }
+
+        auto pattern = searchPattern();
+        if ( compiledExpression_ && compiledPattern_ == pattern
+             && !compiledExpression_->isValid() ) {
+            return;
+        }
+
+        countedPattern_ = std::move( pattern );
+        logFilteredData_->countMatches( *countedPattern_ );
+    } );
+
+    connect( &expressionWatcher_,
+             &QFutureWatcher<std::shared_ptr<const RegularExpression>>::finished, this,
+             &CrawlerWidget::searchPatternCompiled );
+
+    connect( &highlighterLinesWatcher_, &QFutureWatcher<std::vector<SearchResultArray>>::finished,
+             this, &CrawlerWidget::highlighterLinesFound );
+
+    connect( &tailWatchWatcher_, &QFutureWatcher<std::vector<uint64_t>>::finished, this,
+             &CrawlerWidget::appendedLinesWatched );
+
     connect( predefinedFilters_, &PredefinedFiltersComboBox::filterChanged, this,
              &CrawlerWidget::setSearchPatternFromPredefinedFilters );
 
@@ -1119,6 +1934,16 @@ void CrawlerWidget::setup()
              &CrawlerWidget::showSearchContextMenu );
     connect( saveAsPredefinedFilterAction, &QAction::triggered, this,
              &CrawlerWidget::saveAsPredefinedFilter );
+    connect( searchWithPredefinedFiltersAction, &QAction::triggered, this,
+             &CrawlerWidget::searchWithPredefinedFilters );
+    connect( filterChainAction, &QAction::triggered, this, &CrawlerWidget::editFilterChain );
+    connect( showTimeHistogramAction, &QAction::triggered, this,
+             &CrawlerWidget::showTimeHistogram );
+    connect( sortByTimeAction_, &QAction::toggled, this, &CrawlerWidget::sortFilteredViewByTime );
+    connect( hideRepeatedLinesAction_, &QAction::toggled, this,
+             &CrawlerWidget::hideRepeatedLines );
+    connect( showWholeRecordsAction_, &QAction::toggled, this,
+             &CrawlerWidget::showWholeRecords );
     connect( clearSearchHistoryAction, &QAction::triggered, this,
              &CrawlerWidget::clearSearchHistory );
     connect( editSearchHistoryAction, &QAction::triggered, this,
@@ -1141,6 +1966,15 @@ void CrawlerWidget::setup()
 
     connect( logMainView_, &LogMainView::markLines, this, &CrawlerWidget::markLinesFromMain );
     connect( filteredView_, &FilteredView::markLines, this, &CrawlerWidget::markLinesFromFiltered );
+    connect( logMainView_, &LogMainView::unmarkLines, this, &CrawlerWidget::unmarkLinesFromMain );
+    connect( filteredView_, &FilteredView::unmarkLines, this,
+             &CrawlerWidget::unmarkLinesFromFiltered );
+    connect( logMainView_, &LogMainView::markAllMatches, this, &CrawlerWidget::markAllMatches );
+    connect( filteredView_, &FilteredView::markAllMatches, this, &CrawlerWidget::markAllMatches );
+    connect( logMainView_, &LogMainView::showTemplateLines, this,
+             &CrawlerWidget::showTemplateLines );
+    connect( filteredView_, &FilteredView::showTemplateLines, this,
+             &CrawlerWidget::showTemplateLines );
 
     connect( logMainView_, QOverload<const QString&>::of( &LogMainView::addToSearch ), this,
              &CrawlerWidget::addToSearch );
@@ -1179,6 +2013,11 @@ void CrawlerWidget::setup()
     connect( filteredView_, &FilteredView::changeSearchLimits, this,
              &CrawlerWidget::setSearchLimits );
 
+    connect( logMainView_, &LogMainView::changeSearchTimeRange, this,
+             &CrawlerWidget::setSearchTimeRange );
+    connect( filteredView_, &FilteredView::changeSearchTimeRange, this,
+             &CrawlerWidget::setSearchTimeRange );
+
     connect( logMainView_, &LogMainView::clearSearchLimits, this,
              &CrawlerWidget::clearSearchLimits );
     connect( filteredView_, &FilteredView::clearSearchLimits, this,
@@ -1223,13 +2062,34 @@ void CrawlerWidget::setup()
 
     connect( logFilteredData_.get(), &LogFilteredData::searchProgressed, this,
              &CrawlerWidget::updateFilteredView, Qt::QueuedConnection );
+    connect( logFilteredData_.get(), &LogFilteredData::searchFinished, this,
+             &CrawlerWidget::updateSearchStats );
+    connect( logFilteredData_.get(), &LogFilteredData::searchEstimated, this,
+             &CrawlerWidget::updateSearchEstimate );
+    connect( logFilteredData_.get(), &LogFilteredData::matchesCounted, this,
+             &CrawlerWidget::showMatchCount );
 
     // Sent load file update to MainWindow (for status update)
     connect( logData_.get(), &LogData::loadingProgressed, this, &CrawlerWidget::loadingProgressed );
+    // Main view scrolls through the whole file while it is indexed
+    connect( logData_.get(), &LogData::loadingProgressed, this, [ this ]() {
+        if ( logData_->isIndexing() ) {
+            logMainView_->updateAppendedData();
+        }
+    } );
     connect( logData_.get(), &LogData::loadingFinished, this,
              &CrawlerWidget::loadingFinishedHandler );
     connect( logData_.get(), &LogData::fileChanged, this, &CrawlerWidget::fileChangedHandler );
 
+    // Data shared with another view of the file can be loaded already
+    if ( logData_->isLoaded() ) {
+        dispatchToMainThread( [ crawler = QPointer<CrawlerWidget>( this ) ] {
+            if ( crawler ) {
+                crawler->loadingFinishedHandler( LoadingStatus::Successful );
+            }
+        } );
+    }
+
     // Search auto-refresh
     connect( searchRefreshButton_, &QPushButton::toggled, this,
              &CrawlerWidget::searchRefreshChangedHandler );
@@ -1355,11 +2215,67 @@ void CrawlerWidget::loadIcons()
     stopButton_->setIcon( iconLoader_.load( "icons8-delete" ) );
 }
 
+QString CrawlerWidget::searchText() const
+{
+    return searchLineEdit_->currentText();
+}
+
+RegularExpressionPattern CrawlerWidget::searchPattern() const
+{
+    return makeSearchPattern( searchText() );
+}
+
+void CrawlerWidget::runSharedSearch( const RegularExpressionPattern& pattern,
+                                     std::shared_ptr<const RegularExpression> expression )
+{
+    matchCaseButton_->setChecked( pattern.isCaseSensitive );
+    inverseButton_->setChecked( pattern.isExclude );
+    booleanButton_->setChecked( pattern.isBoolean );
+    useRegexpButton_->setChecked( !pattern.isPlainText );
+    searchLineEdit_->setEditText( pattern.pattern );
+
+    replaceCurrentSearch( pattern.pattern, {}, std::move( expression ) );
+}
+
+void CrawlerWidget::suspend()
+{
+    LOG_DEBUG << "CrawlerWidget::suspend";
+
+    logMainView_->suspend();
+    filteredView_->suspend();
+    overview_.setSuspended( true );
+
+    if ( logData_ ) {
+        logData_->releaseMemory( MemoryConsumer::Release::Caches );
+    }
+}
+
+void CrawlerWidget::resume()
+{
+    LOG_DEBUG << "CrawlerWidget::resume";
+
+    overview_.setSuspended( false );
+    logMainView_->resume();
+    filteredView_->resume();
+}
+
 // Create a new search using the text passed, replace the currently
 // used one and destroy the old one.
-void CrawlerWidget::replaceCurrentSearch( const QString& searchText )
+RegularExpressionPattern CrawlerWidget::makeSearchPattern( const QString& searchText ) const
+{
+    return RegularExpressionPattern( searchText, matchCaseButton_->isChecked(),
+                                     inverseButton_->isChecked(), booleanButton_->isChecked(),
+                                     !useRegexpButton_->isChecked() );
+}
+
+void CrawlerWidget::replaceCurrentSearch(
+    const QString& searchText, const std::vector<RegularExpressionPattern>& additionalPatterns,
+    std::shared_ptr<const RegularExpression> compiledExpression )
 {
     LOG_INFO << "replacing current search with " << searchText;
+    matchCountTimer_.stop();
+    countedPattern_.reset();
+
     // Interrupt the search if it's ongoing
     logFilteredData_->interruptSearch();
 
@@ -1373,6 +2289,9 @@ void CrawlerWidget::replaceCurrentSearch( const QString& searchText )
     QApplication::processEvents( QEventLoop::ExcludeUserInputEvents );
 
     nbMatches_ = 0_lcount;
+    estimatedMatches_.reset();
+    patternHits_.clear();
+    searchInfoLine_->setDetails( {} );
 
     // Clear and recompute the content of the filtered window.
     logFilteredData_->clearSearch();
@@ -1384,25 +2303,33 @@ void CrawlerWidget::replaceCurrentSearch( const QString& searchText )
     if ( !searchText.isEmpty() ) {
 
         // Constructs the regexp
-        auto regexpPattern = RegularExpressionPattern(
-            searchText, matchCaseButton_->isChecked(), inverseButton_->isChecked(),
-            booleanButton_->isChecked(), !useRegexpButton_->isChecked() );
+        auto regexpPattern = makeSearchPattern( searchText );
 
-        RegularExpression hsExpression{ regexpPattern };
-        auto isValidExpression = hsExpression.isValid();
+        // Expression compiled while the pattern was typed is used if it is ready,
+        // expression compiled here is passed to the search, so it is compiled only once
+        if ( !compiledExpression && compiledExpression_ && regexpPattern == compiledPattern_ ) {
+            compiledExpression = compiledExpression_;
+        }
+        if ( !compiledExpression ) {
+            compiledExpression = std::make_shared<const RegularExpression>( regexpPattern );
+        }
+        auto isValidExpression = compiledExpression->isValid();
 
         if ( isValidExpression ) {
             // Activate the stop button
             stopButton_->setEnabled( true );
             stopButton_->show();
             searchButton_->hide();
-            // Start a new asynchronous search
-            logFilteredData_->runSearch( regexpPattern, searchStartLine_, searchEndLine_ );
+            // Start a new asynchronous search from the lines the user looks at,
+            // or from the end of the file if it is followed
+            const auto focusLine = isFollowEnabled() ? LineNumber( logData_->getNbLine().get() )
+                                                     : logMainView_->getTopLine();
+            logFilteredData_->runSearch( regexpPattern, searchStartLine_, searchEndLine_,
+                                         additionalPatterns, compiledExpression, focusLine );
             // Accept auto-refresh of the search
             searchState_.startSearch();
             searchInfoLine_->hide();
-            logMainView_->setSearchPattern( regexpPattern );
-            filteredView_->setSearchPattern( regexpPattern );
+            updateSearchHighlighter( regexpPattern );
         }
         else {
             // The regexp is wrong
@@ -1411,21 +2338,9 @@ void CrawlerWidget::replaceCurrentSearch( const QString& searchText )
             searchState_.resetState();
 
             // Inform the user
-            QString errorString = hsExpression.errorString();
-            QString errorMessage = tr( "Error in expression" );
-            // const int offset = regexp.patternErrorOffset();
-            // if ( offset != -1 ) {
-            //     errorMessage += " at position ";
-            //     errorMessage += QString::number( offset );
-            // }
-            errorMessage += ": ";
-            errorMessage += errorString;
-            searchInfoLine_->setPalette( ErrorPalette );
-            searchInfoLine_->setText( errorMessage );
-            searchInfoLine_->show();
+            showExpressionError( compiledExpression->errorString() );
 
-            logMainView_->setSearchPattern( {} );
-            filteredView_->setSearchPattern( {} );
+            updateSearchHighlighter( {} );
         }
     }
     else {
@@ -1434,6 +2349,21 @@ void CrawlerWidget::replaceCurrentSearch( const QString& searchText )
     }
 }
 
+void CrawlerWidget::showExpressionError( const QString& errorString )
+{
+    QString errorMessage = tr( "Error in expression" );
+    // const int offset = regexp.patternErrorOffset();
+    // if ( offset != -1 ) {
+    //     errorMessage += " at position ";
+    //     errorMessage += QString::number( offset );
+    // }
+    errorMessage += ": ";
+    errorMessage += errorString;
+    searchInfoLine_->setPalette( ErrorPalette );
+    searchInfoLine_->setText( errorMessage );
+    searchInfoLine_->show();
+}
+
 // Updates the content of the drop down list for the saved searches,
 // called when the SavedSearch has been changed.
 void CrawlerWidget::updateSearchCombo()
@@ -1464,6 +2394,9 @@ void CrawlerWidget::printSearchInfoMessage( LinesCount nbMatches )
         text = tr( "%1 match%2 found." )
                    .arg( nbMatches.get() )
                    .arg( nbMatches.get() > 1 ? "es" : "" );
+        if ( !patternHits_.isEmpty() ) {
+            text += tr( " Lines matching %1." ).arg( patternHits_ );
+        }
         break;
     case SearchState::FileTruncated:
     case SearchState::TruncatedAutorefreshing:
@@ -1504,6 +2437,11 @@ void CrawlerWidget::updateEncoding()
     QString encodingPrefix = encodingMib_ ? "Displayed as %1" : "Detected as %1";
     encodingText_ = tr( encodingPrefix.arg( textCodec->name().constData() ).toLatin1() );
 
+    // Nothing has to be redrawn when new data keeps the encoding
+    if ( logData_->getDisplayEncoding() == textCodec ) {
+        return;
+    }
+
     logData_->interruptLoading();
 
     logData_->setDisplayEncoding( textCodec->name().constData() );
@@ -1694,10 +2632,22 @@ void CrawlerWidgetContext::loadFromJson( const QString& json )
         useBooleanCombination_ = false;
     }
 
-    if ( properties.contains( "M" ) ) {
+    if ( properties.contains( "MB" ) ) {
+        const auto marks = QByteArray::fromBase64( properties.value( "MB" ).toByteArray() );
+        if ( !marks.isEmpty() ) {
+            if ( auto savedMarks = readBitmap<SearchResultArray>( marks ) ) {
+                marks_ = std::move( *savedMarks );
+            }
+            else {
+                LOG_WARNING << "Failed to read marks of session";
+            }
+        }
+    }
+    else if ( properties.contains( "M" ) ) {
+        // Sessions saved by older versions have list of marks
         const auto marks = properties.value( "M" ).toList();
         for ( const auto& m : marks ) {
-            marks_.append( m.toUInt() );
+            marks_.add( m.toULongLong() );
         }
     }
 }
@@ -1721,7 +2671,14 @@ QString CrawlerWidgetContext::toString() const
     properies[ "RE" ] = useRegexp_;
     properies[ "IR" ] = inverseRegexp_;
     properies[ "BC" ] = useBooleanCombination_;
-    properies[ "M" ] = toVariantList( marks_ );
+
+    if ( !marks_.isEmpty() ) {
+        auto marks = marks_;
+        marks.runOptimize();
+        QByteArray data( static_cast<int>( marks.getSizeInBytes( true ) ), Qt::Uninitialized );
+        marks.write( data.data(), true );
+        properies[ "MB" ] = QString::fromLatin1( data.toBase64() );
+    }
 
     return QJsonDocument::fromVariant( properies ).toJson( QJsonDocument::Compact );
 }
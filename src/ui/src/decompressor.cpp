@@ -17,10 +17,14 @@
  * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
 #include <memory>
+#include <string_view>
 
+#include <QDir>
 #include <QFileInfo>
 #include <QMimeDatabase>
+#include <QThread>
 #include <QtConcurrent>
 
 #include <k7zip.h>
@@ -29,11 +33,15 @@
 #include <kzip.h>
 
 #include "log.h"
+#include "regularexpression.h"
 
 #include "decompressor.h"
 
 namespace {
 
+constexpr int MaxSearchThreads = 4;
+constexpr qint64 SearchBlockSize = 1024 * 1024;
+
 enum class Archive { None, Zip7, Tar, Zip, Gz, Bz2, Xz };
 
 Archive archiveTypeByExtension( const QString& archiveFilePath )
@@ -160,37 +168,116 @@ std::shared_ptr<KCompressionDevice> makeDecompressor( Archive archiveType,
     }
 }
 
-bool doExtract( std::shared_ptr<KArchive> archive, const QString& archiveFilePath,
-                const QString& destination, AtomicFlag& interrupt )
+bool openArchive( KArchive& archive, const QString& archiveFilePath )
 {
-    if ( !archive->open( QIODevice::ReadOnly ) ) {
+    if ( !archive.open( QIODevice::ReadOnly ) ) {
         LOG_WARNING << "Cannot open " << archiveFilePath;
         return false;
     }
 
-    const KArchiveDirectory* root = archive->directory();
-
-    if ( !root ) {
+    if ( !archive.directory() ) {
         LOG_WARNING << "Cannot open root directory" << archiveFilePath;
-        archive->close();
+        archive.close();
         return false;
     }
 
-    auto result = false;
+    return true;
+}
+
+void addEntries( const KArchiveDirectory* directory, const QString& prefix,
+                 std::vector<ArchiveEntry>& entries )
+{
+    for ( const auto& name : directory->entries() ) {
+        const auto* entry = directory->entry( name );
+        const auto path = prefix.isEmpty() ? name : prefix + QChar( '/' ) + name;
+        if ( entry->isDirectory() ) {
+            addEntries( static_cast<const KArchiveDirectory*>( entry ), path, entries );
+        }
+        else if ( entry->isFile() ) {
+            entries.push_back( { path, static_cast<const KArchiveFile*>( entry )->size() } );
+        }
+    }
+}
+
+const KArchiveFile* findFile( const KArchive& archive, const QString& path )
+{
+    const auto* entry = archive.directory()->entry( path );
+    return entry && entry->isFile() ? static_cast<const KArchiveFile*>( entry ) : nullptr;
+}
+
+// Streams the entry through the matcher in blocks, lines are split between blocks
+uint64_t countEntryMatches( const KArchiveFile& file, const PatternMatcher& matcher,
+                            const AtomicFlag& interrupt )
+{
+    std::unique_ptr<QIODevice> device( file.createDevice() );
+    if ( !device || ( !device->isOpen() && !device->open( QIODevice::ReadOnly ) ) ) {
+        return 0;
+    }
+
+    uint64_t matches = 0;
+    QByteArray pending;
+    const auto matchLine = [ &matcher, &matches ]( std::string_view line ) {
+        if ( !line.empty() && line.back() == '\r' ) {
+            line.remove_suffix( 1 );
+        }
+        if ( matcher.hasMatch( line ) ) {
+            ++matches;
+        }
+    };
+
+    while ( !interrupt ) {
+        const auto block = device->read( SearchBlockSize );
+        if ( block.isEmpty() ) {
+            break;
+        }
+
+        pending.append( block );
+        const auto data = std::string_view( pending.constData(),
+                                            static_cast<size_t>( pending.size() ) );
+        size_t lineStart = 0;
+        for ( auto lineEnd = data.find( '\n' ); lineEnd != std::string_view::npos;
+              lineEnd = data.find( '\n', lineStart ) ) {
+            matchLine( data.substr( lineStart, lineEnd - lineStart ) );
+            lineStart = lineEnd + 1;
+        }
+        pending.remove( 0, static_cast<int>( lineStart ) );
+    }
+
+    if ( !pending.isEmpty() && !interrupt ) {
+        matchLine( std::string_view( pending.constData(), static_cast<size_t>( pending.size() ) ) );
+    }
+
+    return matches;
+}
+
+bool doExtractEntries( std::shared_ptr<KArchive> archive, const QString& archiveFilePath,
+                       const QStringList& entries, const QString& destination,
+                       AtomicFlag& interrupt )
+{
+    if ( !openArchive( *archive, archiveFilePath ) ) {
+        return false;
+    }
+
+    auto result = true;
     try {
-        const auto recursive = true;
-#ifdef KLOGG_KARCHIVE
-        result = root->copyTo( destination, interrupt, recursive );
-#else
-        result = root->copyTo( destination, recursive );
-#endif
+        for ( const auto& path : entries ) {
+            if ( interrupt ) {
+                result = false;
+                LOG_INFO << "Interrupted extract of " << archiveFilePath;
+                break;
+            }
+
+            const auto* file = findFile( *archive, path );
+            const auto entryDir = QDir( destination ).filePath( QFileInfo( path ).path() );
+            if ( !file || !QDir().mkpath( entryDir ) || !file->copyTo( entryDir ) ) {
+                LOG_ERROR << "Failed to extract " << path << " from " << archiveFilePath;
+                result = false;
+                break;
+            }
+        }
     } catch ( const std::exception& e ) {
         LOG_ERROR << "Exception during extract: " << e.what();
-    }
-
-    if ( interrupt ) {
         result = false;
-        LOG_INFO << "Interrupted extract of " << archiveFilePath;
     }
 
     archive->close();
@@ -217,7 +304,7 @@ bool doDecompress( std::shared_ptr<KCompressionDevice> input, const QString& arc
             QByteArray data = input->read( 4 * 1024 * 1024 );
             if ( data.size() > 0 ) {
                 const auto writtenBytes = outputFile->write( data );
-                if ( writtenBytes < 0 ) {
+                if ( writtenBytes < 0 || !outputFile->flush() ) {
                     LOG_ERROR << "Error decompressing " << archiveFilePath;
                     success = false;
                     break;
@@ -245,6 +332,12 @@ Decompressor::Decompressor( QObject* parent )
     } );
 }
 
+Decompressor::~Decompressor()
+{
+    interrupt_.set();
+    watcher_.waitForFinished();
+}
+
 bool Decompressor::waitForResult()
 {
     return watcher_.result();
@@ -259,10 +352,12 @@ DecompressAction Decompressor::action( const QString& archiveFilePath )
     case Archive::Zip7:
     case Archive::Tar:
         return DecompressAction::Extract;
-    case Archive::Gz:
     case Archive::Bz2:
     case Archive::Xz:
         return DecompressAction::Decompress;
+    case Archive::Gz:
+        // Log data reads gzip files directly with random access
+        return DecompressAction::None;
     default:
         return DecompressAction::None;
     }
@@ -286,8 +381,88 @@ bool Decompressor::decompress( const QString& archiveFilePath, QFile* outputFile
     return true;
 }
 
-bool Decompressor::extract( const QString& archiveFilePath, const QString& destination,
-                            AtomicFlag& interrupt )
+bool Decompressor::decompressInBackground( const QString& archiveFilePath, QFile* outputFile )
+{
+    return decompress( archiveFilePath, outputFile, interrupt_ );
+}
+
+std::vector<ArchiveEntry> Decompressor::listEntries( const QString& archiveFilePath )
+{
+    auto archive = makeExtractor( archiveType( archiveFilePath ), archiveFilePath );
+    if ( !archive || !openArchive( *archive, archiveFilePath ) ) {
+        return {};
+    }
+
+    std::vector<ArchiveEntry> entries;
+    try {
+        addEntries( archive->directory(), {}, entries );
+    } catch ( const std::exception& e ) {
+        LOG_ERROR << "Exception during listing: " << e.what();
+    }
+
+    archive->close();
+    return entries;
+}
+
+std::vector<uint64_t> Decompressor::countMatches( const QString& archiveFilePath,
+                                                  const std::vector<ArchiveEntry>& entries,
+                                                  const RegularExpressionPattern& pattern,
+                                                  const AtomicFlag& interrupt,
+                                                  std::atomic<size_t>& searchedEntries )
+{
+    std::vector<uint64_t> matches( entries.size() );
+    const auto type = archiveType( archiveFilePath );
+    const RegularExpression regularExpression( pattern );
+    if ( !regularExpression.isValid() ) {
+        return matches;
+    }
+
+    // Zip entries are compressed separately, other archives are decompressed
+    // from their start for each entry, so they are read by one thread
+    const auto threads = type == Archive::Zip
+                             ? std::clamp( QThread::idealThreadCount(), 1, MaxSearchThreads )
+                             : 1;
+
+    std::atomic<size_t> nextEntry{ 0 };
+    const auto searchEntries = [ & ] {
+        auto archive = makeExtractor( type, archiveFilePath );
+        if ( !archive || !openArchive( *archive, archiveFilePath ) ) {
+            return;
+        }
+
+        const auto matcher = regularExpression.createMatcher();
+        try {
+            for ( auto index = nextEntry++; index < entries.size() && !interrupt;
+                  index = nextEntry++ ) {
+                if ( const auto* file = findFile( *archive, entries[ index ].path ) ) {
+                    matches[ index ] = countEntryMatches( *file, *matcher, interrupt );
+                }
+                ++searchedEntries;
+            }
+        } catch ( const std::exception& e ) {
+            LOG_ERROR << "Exception during search: " << e.what();
+        }
+
+        archive->close();
+    };
+
+    std::vector<QFuture<void>> workers;
+    for ( auto thread = 1; thread < threads; ++thread ) {
+        workers.push_back( QtConcurrent::run( searchEntries ) );
+    }
+    searchEntries();
+    for ( auto& worker : workers ) {
+        worker.waitForFinished();
+    }
+
+    LOG_INFO << "Searched " << searchedEntries.load() << " entries of " << archiveFilePath
+             << " in " << threads << " threads";
+
+    return matches;
+}
+
+bool Decompressor::extractEntries( const QString& archiveFilePath, const QStringList& entries,
+                                   const QString& destination, AtomicFlag& interrupt )
 {
     auto archive = makeExtractor( archiveType( archiveFilePath ), archiveFilePath );
     if ( !archive ) {
@@ -295,11 +470,9 @@ bool Decompressor::extract( const QString& archiveFilePath, const QString& desti
         return false;
     }
 
-    // Open the archive
-
     future_ = QtConcurrent::run(
-        [ ar = std::move( archive ), archiveFilePath, destination, &interrupt ] {
-            return doExtract( ar, archiveFilePath, destination, interrupt );
+        [ ar = std::move( archive ), archiveFilePath, entries, destination, &interrupt ] {
+            return doExtractEntries( ar, archiveFilePath, entries, destination, interrupt );
         } );
     watcher_.setFuture( future_ );
 
@@ -85,6 +85,21 @@ LineNumber FilteredView::maxDisplayLineNumber() const
     return LineNumber( logFilteredData_->getNbTotalLines().get() );
 }
 
+LinesExporter FilteredView::linesExporter( LineNumber first, LinesCount count ) const
+{
+    return logFilteredData_->getLinesExporter( first, count );
+}
+
+ValueAggregator FilteredView::valueAggregator() const
+{
+    return logFilteredData_->getValueAggregator();
+}
+
+TemplateClusterer FilteredView::templateClusterer() const
+{
+    return logFilteredData_->getTemplateClusterer();
+}
+
 void FilteredView::doRegisterShortcuts()
 {
     LOG_INFO << "Registering shortcuts for filtered view";
@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "highlightercache.h"
+
+void HighlighterCache::setHighlighterSet( const HighlighterSet& highlighterSet )
+{
+    const auto fingerprint = highlighterSet.fingerprint();
+    if ( fingerprint == fingerprint_ ) {
+        return;
+    }
+
+    lines_.clear();
+    highlighterSet_ = highlighterSet;
+    fingerprint_ = fingerprint;
+    matcher_ = highlighterSet_.createMatcher();
+}
+
+HighlighterMatchType HighlighterCache::matchLine( LineNumber line, const QString& text,
+                                                  std::vector<HighlightedMatch>& matches )
+{
+    const auto cachedLine = lines_.find( line.get() );
+    if ( cachedLine != lines_.end() && cachedLine->second.text == text ) {
+        matches = cachedLine->second.matches;
+        return cachedLine->second.matchType;
+    }
+
+    const auto matchType = highlighterSet_.matchLine( text, matches, &matcher_ );
+
+    // Views show a few hundred lines at most,
+    // so the whole cache is dropped instead of tracking usage
+    if ( lines_.size() >= MaxLines ) {
+        lines_.clear();
+    }
+
+    lines_[ line.get() ] = Entry{ text, matchType, matches };
+    return matchType;
+}
+
+std::vector<AnsiColorSpan>
+HighlighterCache::lineColors( LineNumber line, const QString& text,
+                              const std::function<std::vector<AnsiColorSpan>()>& parseColors )
+{
+    const auto cachedLine = colors_.find( line.get() );
+    if ( cachedLine != colors_.end() && cachedLine->second.text == text ) {
+        return cachedLine->second.colors;
+    }
+
+    auto colors = parseColors();
+
+    if ( colors_.size() >= MaxLines ) {
+        colors_.clear();
+    }
+
+    colors_[ line.get() ] = ColorsEntry{ text, colors };
+    return colors;
+}
+
+void HighlighterCache::clear()
+{
+    lines_.clear();
+    colors_.clear();
+}
+
+size_t HighlighterCache::allocatedSize() const
+{
+    size_t size = 0;
+    for ( const auto& [ line, entry ] : lines_ ) {
+        size += sizeof( line ) + sizeof( entry )
+                + static_cast<size_t>( entry.text.capacity() ) * sizeof( QChar )
+                + entry.matches.capacity() * sizeof( HighlightedMatch );
+    }
+    for ( const auto& [ line, entry ] : colors_ ) {
+        size += sizeof( line ) + sizeof( entry )
+                + static_cast<size_t>( entry.text.capacity() ) * sizeof( QChar )
+                + entry.colors.capacity() * sizeof( AnsiColorSpan );
+    }
+    return size;
+}
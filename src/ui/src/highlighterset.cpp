@@ -38,21 +38,48 @@
 
 // This file implements classes Highlighter and HighlighterSet
 
+#include <algorithm>
+#include <cstdint>
 #include <iterator>
 #include <qcolor.h>
 #include <qnamespace.h>
 #include <random>
+#include <string_view>
 #include <utility>
+#include <vector>
 
+#include <QDataStream>
 #include <QSettings>
 
 #include "crc32.h"
+#include "filedigest.h"
 #include "highlightersetedit.h"
 #include "log.h"
+#include "tracezone.h"
 #include "uuid.h"
 
 #include "highlighterset.h"
 
+namespace {
+// Maps byte offsets in UTF-8 form of the line to its columns
+std::vector<int> utf16Columns( const QByteArray& utf8Line )
+{
+    std::vector<int> columns( static_cast<std::size_t>( utf8Line.size() ) + 1 );
+    int column = 0;
+    for ( auto offset = 0; offset < utf8Line.size(); ++offset ) {
+        columns[ static_cast<std::size_t>( offset ) ] = column;
+
+        const auto byte = static_cast<uint8_t>( utf8Line[ offset ] );
+        if ( ( byte & 0xC0 ) != 0x80 ) {
+            // Characters of 4 bytes are surrogate pairs in UTF-16
+            column += byte >= 0xF0 ? 2 : 1;
+        }
+    }
+    columns.back() = column;
+    return columns;
+}
+} // namespace
+
 QRegularExpression::PatternOptions getPatternOptions( bool ignoreCase )
 {
     QRegularExpression::PatternOptions options = QRegularExpression::UseUnicodePropertiesOption;
@@ -69,6 +96,8 @@ Highlighter::Highlighter( const QString& pattern, bool ignoreCase, bool onlyMatc
     , highlightOnlyMatch_( onlyMatch )
     , color_{ foreColor, backColor }
 {
+    updateMatchingRegex();
+
     LOG_DEBUG << "New Highlighter, fore: " << color_.foreColor.name()
               << " back: " << color_.backColor.name();
 }
@@ -81,6 +110,7 @@ QString Highlighter::pattern() const
 void Highlighter::setPattern( const QString& pattern )
 {
     regexp_.setPattern( pattern );
+    updateMatchingRegex();
 }
 
 bool Highlighter::ignoreCase() const
@@ -91,6 +121,7 @@ bool Highlighter::ignoreCase() const
 void Highlighter::setIgnoreCase( bool ignoreCase )
 {
     regexp_.setPatternOptions( getPatternOptions( ignoreCase ) );
+    updateMatchingRegex();
 }
 
 bool Highlighter::useRegex() const
@@ -101,6 +132,7 @@ bool Highlighter::useRegex() const
 void Highlighter::setUseRegex( bool useRegex )
 {
     useRegex_ = useRegex;
+    updateMatchingRegex();
 }
 
 bool Highlighter::highlightOnlyMatch() const
@@ -171,16 +203,11 @@ bool Highlighter::matchLine( const QString& line, std::vector<HighlightedMatch>&
 {
     matches.clear();
 
-    const auto pattern
-        = useRegex_ ? regexp_.pattern() : QRegularExpression::escape( regexp_.pattern() );
-
-    const auto matchingRegex = QRegularExpression( pattern, regexp_.patternOptions() );
-
-    QRegularExpressionMatchIterator matchIterator = matchingRegex.globalMatch( line );
+    QRegularExpressionMatchIterator matchIterator = matchingRegex_.globalMatch( line );
 
     while ( matchIterator.hasNext() ) {
         QRegularExpressionMatch match = matchIterator.next();
-        if ( matchingRegex.captureCount() > 0 ) {
+        if ( matchingRegex_.captureCount() > 0 ) {
             for ( int i = 1; i <= match.lastCapturedIndex(); ++i ) {
 
                 const auto colors = vairateColors( match.captured( i ) );
@@ -200,6 +227,64 @@ bool Highlighter::matchLine( const QString& line, std::vector<HighlightedMatch>&
     return ( !matches.empty() );
 }
 
+bool Highlighter::matchLine( const QString& line, const HsSpanMatcher& matcher, unsigned id,
+                             std::vector<HighlightedMatch>& matches ) const
+{
+    // Spans cover whole matches, not captured groups
+    if ( !matcher.isSupported( id ) || matchingRegex_.captureCount() > 0 ) {
+        return matchLine( line, matches );
+    }
+
+    matches.clear();
+
+    const auto utf8Line = line.toUtf8();
+    const auto spans = matcher.match(
+        std::string_view( utf8Line.constData(), static_cast<std::size_t>( utf8Line.size() ) ) );
+
+    // Each character of ASCII line is one byte in UTF-8
+    std::vector<int> columns;
+    if ( !spans.empty() && utf8Line.size() != line.size() ) {
+        columns = utf16Columns( utf8Line );
+    }
+    const auto toColumn = [ &columns ]( std::size_t offset ) {
+        return columns.empty() ? static_cast<int>( offset ) : columns[ offset ];
+    };
+
+    for ( const auto& span : spans ) {
+        if ( span.id != id ) {
+            continue;
+        }
+
+        const auto start = toColumn( span.start );
+        const auto length = toColumn( span.end ) - start;
+        const auto colors = vairateColors( line.mid( start, length ) );
+        matches.emplace_back( start, length, colors.first, colors.second );
+    }
+
+    return ( !matches.empty() );
+}
+
+RegularExpressionPattern Highlighter::regularExpressionPattern() const
+{
+    return RegularExpressionPattern( regexp_.pattern(), !ignoreCase(), false, false, !useRegex_ );
+}
+
+bool Highlighter::canMatchBySpans() const
+{
+    // Colors of variated matches depend on the matched text
+    return matchingRegex_.isValid() && matchingRegex_.captureCount() == 0
+           && !( variateColors_ && highlightOnlyMatch_ );
+}
+
+void Highlighter::updateMatchingRegex()
+{
+    const auto pattern
+        = useRegex_ ? regexp_.pattern() : QRegularExpression::escape( regexp_.pattern() );
+
+    matchingRegex_ = QRegularExpression( pattern, regexp_.patternOptions() );
+    matchingRegex_.optimize();
+}
+
 HighlighterSet HighlighterSet::createNewSet( const QString& name )
 {
     return HighlighterSet{ name };
@@ -227,12 +312,48 @@ bool HighlighterSet::isEmpty() const
 }
 
 HighlighterMatchType HighlighterSet::matchLine( const QString& line,
-                                                std::vector<HighlightedMatch>& matches ) const
-{
+                                                std::vector<HighlightedMatch>& matches,
+                                                const HsSpanMatcher* matcher ) const
+{
+    KLOGG_ZONE( "HighlighterSet::matchLine" );
+    QByteArray utf8Line;
+    std::vector<MatchedSpan> spans;
+    if ( matcher ) {
+        utf8Line = line.toUtf8();
+        spans = matcher->match( std::string_view(
+            utf8Line.constData(), static_cast<std::size_t>( utf8Line.size() ) ) );
+    }
+
+    // Each character of ASCII line is one byte in UTF-8
+    std::vector<int> columns;
+    if ( !spans.empty() && utf8Line.size() != line.size() ) {
+        columns = utf16Columns( utf8Line );
+    }
+    const auto toColumn = [ &columns ]( std::size_t offset ) {
+        return columns.empty() ? static_cast<int>( offset ) : columns[ offset ];
+    };
+
     auto matchType = HighlighterMatchType::NoMatch;
     for ( auto hl = highlighterList_.rbegin(); hl != highlighterList_.rend(); ++hl ) {
+        const auto id = static_cast<unsigned>( std::distance( hl, highlighterList_.rend() ) - 1 );
+
         std::vector<HighlightedMatch> thisMatches;
-        if ( !hl->matchLine( line, thisMatches ) ) {
+        if ( matcher && matcher->isSupported( id ) ) {
+            const auto highlighterSpans = std::equal_range(
+                spans.cbegin(), spans.cend(), MatchedSpan{ id, 0, 0 },
+                []( const auto& lhs, const auto& rhs ) { return lhs.id < rhs.id; } );
+
+            for ( auto span = highlighterSpans.first; span != highlighterSpans.second; ++span ) {
+                const auto start = toColumn( span->start );
+                thisMatches.emplace_back( start, toColumn( span->end ) - start, hl->foreColor(),
+                                          hl->backColor() );
+            }
+
+            if ( thisMatches.empty() ) {
+                continue;
+            }
+        }
+        else if ( !hl->matchLine( line, thisMatches ) ) {
             continue;
         }
 
@@ -255,6 +376,58 @@ HighlighterMatchType HighlighterSet::matchLine( const QString& line,
     return matchType;
 }
 
+HsSpanMatcher HighlighterSet::createMatcher() const
+{
+    std::vector<RegularExpressionPattern> patterns;
+    std::vector<unsigned> ids;
+    for ( auto index = 0; index < highlighterList_.size(); ++index ) {
+        const auto& hl = highlighterList_[ index ];
+        if ( hl.canMatchBySpans() ) {
+            patterns.push_back( hl.regularExpressionPattern() );
+            ids.push_back( static_cast<unsigned>( index ) );
+        }
+    }
+
+    if ( patterns.empty() ) {
+        return {};
+    }
+
+    return HsSpanMatcher( patterns, ids );
+}
+
+std::vector<RegularExpressionPattern> HighlighterSet::patterns() const
+{
+    std::vector<RegularExpressionPattern> patterns;
+    for ( const auto& hl : highlighterList_ ) {
+        patterns.push_back( hl.regularExpressionPattern() );
+    }
+    return patterns;
+}
+
+std::vector<QColor> HighlighterSet::lineColors() const
+{
+    std::vector<QColor> colors;
+    for ( const auto& hl : highlighterList_ ) {
+        // Text of matched lines is often black, their background is what stands out
+        colors.push_back( hl.backColor().alpha() > 0 ? hl.backColor() : hl.foreColor() );
+    }
+    return colors;
+}
+
+uint64_t HighlighterSet::fingerprint() const
+{
+    QByteArray highlighters;
+    QDataStream stream( &highlighters, QIODevice::WriteOnly );
+    for ( const auto& hl : highlighterList_ ) {
+        stream << hl.pattern() << hl.ignoreCase() << hl.useRegex() << hl.highlightOnlyMatch()
+               << hl.variateColors() << hl.colorVariance() << hl.foreColor() << hl.backColor();
+    }
+
+    FileDigest digest;
+    digest.addData( highlighters );
+    return digest.digest();
+}
+
 //
 // Persistable virtual functions implementation
 //
@@ -288,6 +461,8 @@ void Highlighter::retrieveFromStorage( QSettings& settings )
     colorVariance_ = settings.value( "color_variance", 15 ).toInt();
     color_.foreColor = QColor( settings.value( "fore_colour" ).toString() );
     color_.backColor = QColor( settings.value( "back_colour" ).toString() );
+
+    updateMatchingRegex();
 }
 
 void HighlighterSet::saveToStorage( QSettings& settings ) const
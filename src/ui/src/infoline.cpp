@@ -44,6 +44,7 @@
 #include <QClipboard>
 #include <QContextMenuEvent>
 #include <QMenu>
+#include <QMessageBox>
 #include <QPainter>
 
 InfoLine::InfoLine()
@@ -79,6 +80,11 @@ void InfoLine::hideGauge()
     origPalette_.reset();
 }
 
+void InfoLine::setDetails( const QString& details )
+{
+    details_ = details;
+}
+
 // Custom painter: draw the background then call QLabel's painter
 void InfoLine::paintEvent( QPaintEvent* paintEvent )
 {
@@ -108,5 +114,13 @@ void InfoLine::contextMenuEvent( QContextMenuEvent* event )
     connect( selectAll, &QAction::triggered,
              [ this ]( auto ) { setSelection( 0, static_cast<int>( this->text().length() ) ); } );
 
+    if ( !details_.isEmpty() ) {
+        menu.addSeparator();
+        auto showDetails = menu.addAction( "Details..." );
+        connect( showDetails, &QAction::triggered, [ this ]( auto ) {
+            QMessageBox::information( this, "Details", details_ );
+        } );
+    }
+
     menu.exec( event->globalPos() );
 }
@@ -53,6 +53,7 @@
 LogMainView::LogMainView( const LogData* newLogData, const QuickFindPattern* const quickFindPattern,
                           Overview* overview, OverviewWidget* overview_widget, QWidget* parent )
     : AbstractLogView( newLogData, quickFindPattern, parent )
+    , sourceLogData_( newLogData )
 {
     filteredData_ = nullptr;
 
@@ -77,6 +78,47 @@ AbstractLogData::LineType LogMainView::lineType( LineNumber lineNumber ) const
     return AbstractLogData::LineTypeFlags::Plain;
 }
 
+LinesExporter LogMainView::linesExporter( LineNumber first, LinesCount count ) const
+{
+    return LinesExporter( sourceLogData_, first, count );
+}
+
+ValueAggregator LogMainView::valueAggregator() const
+{
+    return ValueAggregator( sourceLogData_, 0_lnum, sourceLogData_->getNbLine() );
+}
+
+TemplateClusterer LogMainView::templateClusterer() const
+{
+    return TemplateClusterer( sourceLogData_, 0_lnum, sourceLogData_->getNbLine() );
+}
+
+LinesCount LogMainView::estimatedNbLines() const
+{
+    return sourceLogData_->getEstimatedNbLines();
+}
+
+LinesPreview LogMainView::linesPreview( LineNumber line, LinesCount count ) const
+{
+    // Lines are taken to have the same length as the indexed ones
+    const auto estimatedLines = sourceLogData_->getEstimatedNbLines();
+    const auto indexedLines = sourceLogData_->getNbLine();
+    if ( estimatedLines <= indexedLines ) {
+        return {};
+    }
+
+    const auto indexedSize = sourceLogData_->getFileSize();
+    const auto bytesPerLine = static_cast<double>( indexedSize )
+                              / static_cast<double>( qMax( indexedLines.get(), uint64_t{ 1 } ) );
+    const auto offset = static_cast<qint64>( static_cast<double>( line.get() ) * bytesPerLine );
+    return sourceLogData_->getLinesAtOffset( offset, count );
+}
+
+OptionalLineNumber LogMainView::indexedLineAtOffset( qint64 offset ) const
+{
+    return sourceLogData_->getIndexedLineAtOffset( offset );
+}
+
 void LogMainView::doRegisterShortcuts()
 {
     LOG_INFO << "Registering shortcuts for main view";
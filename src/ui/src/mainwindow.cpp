@@ -47,8 +47,11 @@
 #include <exception>
 #include <iostream>
 
+#include <algorithm>
+#include <chrono>
 #include <cmath>
 #include <iterator>
+#include <optional>
 #include <qaction.h>
 
 #ifdef Q_OS_WIN
@@ -59,9 +62,13 @@
 #include <QAction>
 #include <QClipboard>
 #include <QCloseEvent>
+#include <QDir>
 #include <QDialogButtonBox>
+#include <QEventLoop>
 #include <QFileDialog>
 #include <QFileInfo>
+#include <QFutureWatcher>
+#include <QHelpEvent>
 #include <QInputDialog>
 #include <QListView>
 #include <QMenuBar>
@@ -69,28 +76,36 @@
 #include <QMimeData>
 #include <QProgressDialog>
 #include <QScreen>
+#include <QSettings>
 #include <QShortcut>
 #include <QSortFilterProxyModel>
 #include <QStringListModel>
 #include <QTemporaryFile>
 #include <QTextBrowser>
 #include <QToolBar>
+#include <QTimer>
+#include <QToolTip>
 #include <QUrl>
 #include <QUrlQuery>
 #include <QWindow>
+#include <QtConcurrent>
 
 #include "mainwindow.h"
 
 #include "crawlerwidget.h"
+#include "analysisbundle.h"
+#include "archivebrowserdialog.h"
 #include "decompressor.h"
 #include "dispatch_to.h"
 #include "downloader.h"
 #include "encodings.h"
 #include "favoritefiles.h"
+#include "filewatcher.h"
 #include "highlightersdialog.h"
 #include "highlightersmenu.h"
 #include "issuereporter.h"
 #include "klogg_version.h"
+#include "linehashdiff.h"
 #include "logger.h"
 #include "openfilehelper.h"
 #include "optionsdialog.h"
@@ -98,11 +113,14 @@
 #include "predefinedfiltersdialog.h"
 #include "progress.h"
 #include "readablesize.h"
+#include "remotefile.h"
 #include "recentfiles.h"
 #include "sessioninfo.h"
 #include "shortcuts.h"
 #include "styles.h"
 #include "tabbedcrawlerwidget.h"
+#include "memorygovernor.h"
+#include "workscheduler.h"
 
 namespace {
 
@@ -113,6 +131,71 @@ void signalCrawlerToFollowFile( CrawlerWidget* crawler_widget )
 
 static constexpr auto ClipboardMaxTry = 5;
 
+// Active highlighter sets in the format of exported highlighters
+QByteArray saveActiveHighlighters()
+{
+    const auto& highlighterSets = HighlighterSetCollection::get();
+    const auto activeSetIds = highlighterSets.activeSetIds();
+
+    QList<HighlighterSet> activeSets;
+    for ( const auto& set : highlighterSets.highlighterSets() ) {
+        if ( activeSetIds.contains( set.id() ) ) {
+            activeSets.append( set );
+        }
+    }
+
+    HighlighterSetCollection bundled;
+    bundled.setHighlighterSets( activeSets );
+    for ( const auto& setId : activeSetIds ) {
+        bundled.activateSet( setId );
+    }
+
+    QTemporaryFile file;
+    if ( !file.open() ) {
+        return {};
+    }
+    file.close();
+
+    {
+        QSettings settings{ file.fileName(), QSettings::IniFormat };
+        bundled.saveToStorage( settings );
+    }
+
+    return file.open() ? file.readAll() : QByteArray{};
+}
+
+// Adds sets that are not known yet and activates all of them
+void addBundledHighlighters( const QByteArray& highlighters )
+{
+    QTemporaryFile file;
+    if ( highlighters.isEmpty() || !file.open() || file.write( highlighters ) < 0 ) {
+        return;
+    }
+    file.close();
+
+    HighlighterSetCollection bundled;
+    {
+        QSettings settings{ file.fileName(), QSettings::IniFormat };
+        bundled.retrieveFromStorage( settings );
+    }
+
+    auto& highlighterSets = HighlighterSetCollection::get();
+    auto sets = highlighterSets.highlighterSets();
+    for ( const auto& set : bundled.highlighterSets() ) {
+        if ( !highlighterSets.hasSet( set.id() ) ) {
+            sets.append( set );
+        }
+    }
+    highlighterSets.setHighlighterSets( sets );
+
+    for ( const auto& setId : bundled.activeSetIds() ) {
+        if ( !highlighterSets.activeSetIds().contains( setId ) ) {
+            highlighterSets.activateSet( setId );
+        }
+    }
+    highlighterSets.save();
+}
+
 } // namespace
 
 MainWindow::MainWindow( WindowSession session )
@@ -193,6 +276,8 @@ MainWindow::MainWindow( WindowSession session )
              [ this ]( int index ) { this->closeTab( index, ActionInitiator::User ); } );
     connect( &mainTabWidget_, &TabbedCrawlerWidget::currentChanged, this,
              &MainWindow::currentTabChanged );
+    connect( &mainTabWidget_, &TabbedCrawlerWidget::watchesMatched, this,
+             &MainWindow::showWatchNotification );
 
     // Establish the QuickFindWidget and mux ( to send requests from the
     // QFWidget to the right window )
@@ -248,6 +333,8 @@ void MainWindow::reloadSession()
     const auto openedFiles
         = session_.restore( [] { return new CrawlerWidget(); }, &current_file_index );
 
+    isRestoringSession_ = true;
+
     for ( const auto& open_file : openedFiles ) {
         QString file_name = { open_file.first };
         auto* crawler_widget = static_cast<CrawlerWidget*>( open_file.second );
@@ -269,6 +356,14 @@ void MainWindow::reloadSession()
         }
     }
 
+    isRestoringSession_ = false;
+
+    // Only the visible tab is loaded right away
+    if ( auto* current = currentCrawlerWidget() ) {
+        session_.loadDeferred( current );
+    }
+    session_.loadDeferredInBackground();
+
     updateOpenedFilesMenu();
 }
 
@@ -335,6 +430,18 @@ void MainWindow::createActions()
     findAction->setStatusTip( tr( "Find the text" ) );
     connect( findAction, &QAction::triggered, this, [ this ]( auto ) { this->find(); } );
 
+    searchAllTabsAction = new QAction( tr( "Search in all &tabs" ), this );
+    searchAllTabsAction->setStatusTip(
+        tr( "Search for the pattern of current tab in all opened files" ) );
+    connect( searchAllTabsAction, &QAction::triggered, this,
+             [ this ]( auto ) { this->searchAllTabs(); } );
+
+    compareFilesAction = new QAction( tr( "Compare with opened file..." ), this );
+    compareFilesAction->setStatusTip(
+        tr( "Show lines that are only in the current file or only in another opened file" ) );
+    connect( compareFilesAction, &QAction::triggered, this,
+             [ this ]( auto ) { this->compareWithOpenedFile(); } );
+
     clearLogAction = new QAction( tr( "Clear file..." ), this );
     clearLogAction->setStatusTip( tr( "Clear current file" ) );
     connect( clearLogAction, &QAction::triggered, this, [ this ]( auto ) { this->clearLog(); } );
@@ -363,6 +470,18 @@ void MainWindow::createActions()
     openUrlAction->setStatusTip( tr( "Open URL as log file" ) );
     connect( openUrlAction, &QAction::triggered, this, [ this ]( auto ) { this->openUrl(); } );
 
+    openAnalysisBundleAction = new QAction( tr( "Open analysis bundle..." ), this );
+    openAnalysisBundleAction->setStatusTip(
+        tr( "Open log file with index, search results, marks and highlighters of the bundle" ) );
+    connect( openAnalysisBundleAction, &QAction::triggered, this,
+             [ this ]( auto ) { this->openAnalysisBundle(); } );
+
+    exportAnalysisBundleAction = new QAction( tr( "Export analysis bundle..." ), this );
+    exportAnalysisBundleAction->setStatusTip(
+        tr( "Save index, search results, marks and highlighters of the file into a bundle" ) );
+    connect( exportAnalysisBundleAction, &QAction::triggered, this,
+             [ this ]( auto ) { this->exportAnalysisBundle(); } );
+
     overviewVisibleAction = new QAction( tr( "Matches &overview" ), this );
     overviewVisibleAction->setCheckable( true );
     overviewVisibleAction->setChecked( config.isOverviewVisible() );
@@ -549,6 +668,8 @@ void MainWindow::createMenus()
     fileMenu->addAction( openAction );
     fileMenu->addAction( openClipboardAction );
     fileMenu->addAction( openUrlAction );
+    fileMenu->addAction( openAnalysisBundleAction );
+    fileMenu->addAction( exportAnalysisBundleAction );
     fileMenu->addAction( closeAction );
     fileMenu->addAction( closeAllAction );
     fileMenu->addSeparator();
@@ -568,6 +689,8 @@ void MainWindow::createMenus()
     editMenu->addAction( selectAllAction );
     editMenu->addSeparator();
     editMenu->addAction( findAction );
+    editMenu->addAction( searchAllTabsAction );
+    editMenu->addAction( compareFilesAction );
     editMenu->addSeparator();
     editMenu->addAction( goToLineAction );
     editMenu->addSeparator();
@@ -630,6 +753,7 @@ void MainWindow::createToolBars()
 
     sizeField = new QLabel();
     sizeField->setAlignment( Qt::AlignHCenter | Qt::AlignVCenter );
+    sizeField->installEventFilter( this );
 
     dateField = new QLabel();
     dateField->setAlignment( Qt::AlignHCenter | Qt::AlignVCenter );
@@ -744,6 +868,18 @@ void MainWindow::open()
 
 void MainWindow::openRemoteFile( const QUrl& url )
 {
+    // Files of servers that support range requests are fetched
+    // in blocks as they are read instead of downloading them first
+    QString rangeError;
+    if ( const auto remoteSize = RemoteFile::remoteSize( url, rangeError ) ) {
+        auto cacheFile = new QTemporaryFile( tempDir_.filePath( url.fileName() ), this );
+        if ( cacheFile->open() && RemoteFile::attach( url, *remoteSize, cacheFile->fileName() ) ) {
+            loadFile( cacheFile->fileName() );
+            return;
+        }
+        delete cacheFile;
+    }
+
     Downloader downloader;
 
     QProgressDialog progressDialog;
@@ -889,6 +1025,178 @@ void MainWindow::find()
     displayQuickFindBar( QuickFindMux::Forward );
 }
 
+// Pattern of the current tab is compiled once and shared by searches of all tabs,
+// their flow graphs run in the arenas of WorkScheduler like any other search
+void MainWindow::searchAllTabs()
+{
+    auto* current = currentCrawlerWidget();
+    if ( current == nullptr || current->searchText().isEmpty() ) {
+        return;
+    }
+
+    const auto pattern = current->searchPattern();
+    const auto expression = std::make_shared<const RegularExpression>( pattern );
+    if ( !expression->isValid() ) {
+        QMessageBox::warning( this, "klogg",
+                              tr( "Error in expression: %1" ).arg( expression->errorString() ) );
+        return;
+    }
+
+    struct TabResult {
+        QString fileName;
+        std::optional<LinesCount> nbMatches;
+    };
+
+    // Results of previous search of all tabs are not waited for anymore
+    delete allTabsSearch_;
+    allTabsSearch_ = new QObject( this );
+    auto results = std::make_shared<std::vector<TabResult>>();
+
+    const auto reportFinishedTab = [ this, results, pattern ]( size_t tab,
+                                                               LinesCount nbMatches ) {
+        if ( tab >= results->size() ) {
+            return;
+        }
+
+        ( *results )[ tab ].nbMatches = nbMatches;
+        if ( std::any_of( results->begin(), results->end(),
+                          []( const auto& result ) { return !result.nbMatches; } ) ) {
+            return;
+        }
+
+        QStringList summary;
+        for ( const auto& result : *results ) {
+            summary.append( tr( "%1: %2" ).arg( QFileInfo( result.fileName ).fileName(),
+                                                QString::number( result.nbMatches->get() ) ) );
+        }
+
+        auto* summaryBox = new QMessageBox(
+            QMessageBox::Information, "klogg",
+            tr( "Matches of \"%1\" in opened files:" ).arg( pattern.pattern ), QMessageBox::Ok,
+            this );
+        summaryBox->setInformativeText( summary.join( QChar::LineFeed ) );
+        summaryBox->setAttribute( Qt::WA_DeleteOnClose );
+        summaryBox->setModal( false );
+        summaryBox->show();
+
+        results->clear();
+        allTabsSearch_->deleteLater();
+    };
+
+    for ( auto index = 0; index < mainTabWidget_.count(); ++index ) {
+        auto* crawler = static_cast<CrawlerWidget*>( mainTabWidget_.widget( index ) );
+        const auto tab = results->size();
+        results->push_back( { session_.getFilename( crawler ), {} } );
+
+        connect( crawler, &CrawlerWidget::searchFinished, allTabsSearch_,
+                 [ reportFinishedTab, tab ]( LinesCount nbMatches ) {
+                     reportFinishedTab( tab, nbMatches );
+                 } );
+        // Closed tabs are reported without matches
+        connect( crawler, &QObject::destroyed, allTabsSearch_,
+                 [ reportFinishedTab, tab ]() { reportFinishedTab( tab, 0_lcount ); } );
+    }
+
+    for ( auto index = 0; index < mainTabWidget_.count(); ++index ) {
+        auto* crawler = static_cast<CrawlerWidget*>( mainTabWidget_.widget( index ) );
+        crawler->runSharedSearch( pattern, expression );
+    }
+}
+
+void MainWindow::compareWithOpenedFile()
+{
+    auto* current = currentCrawlerWidget();
+    if ( current == nullptr ) {
+        return;
+    }
+
+    QStringList otherFiles;
+    std::vector<CrawlerWidget*> otherCrawlers;
+    for ( auto index = 0; index < mainTabWidget_.count(); ++index ) {
+        auto* crawler = static_cast<CrawlerWidget*>( mainTabWidget_.widget( index ) );
+        if ( crawler != current ) {
+            otherFiles.append( QDir::toNativeSeparators( session_.getFilename( crawler ) ) );
+            otherCrawlers.push_back( crawler );
+        }
+    }
+
+    if ( otherCrawlers.empty() ) {
+        QMessageBox::information( this, "klogg", tr( "Open another file to compare with." ) );
+        return;
+    }
+
+    bool isSelected = false;
+    const auto otherFile = QInputDialog::getItem(
+        this, tr( "klogg - compare files" ),
+        tr( "Compare %1 with:" ).arg( QFileInfo( session_.getFilename( current ) ).fileName() ),
+        otherFiles, 0, false, &isSelected );
+    if ( !isSelected ) {
+        return;
+    }
+    auto* other = otherCrawlers[ static_cast<size_t>( otherFiles.indexOf( otherFile ) ) ];
+
+    const auto firstData = current->logData();
+    const auto secondData = other->logData();
+    if ( !firstData || !secondData || !firstData->hasLineHashes()
+         || !secondData->hasLineHashes() ) {
+        QMessageBox::warning( this, "klogg",
+                              tr( "Files are compared by hashes of lines. Enable the "
+                                  "perf/useLineHashIndex setting and reload the files." ) );
+        return;
+    }
+
+    const LineHashDiff diff( firstData.get(), secondData.get() );
+    const auto totalLines = std::max( diff.linesCount().get() * 2, uint64_t{ 1 } );
+
+    AtomicFlag interruptRequest;
+    std::atomic<uint64_t> processedLines{};
+
+    QProgressDialog progressDialog( this );
+    progressDialog.setLabelText( tr( "Comparing files" ) );
+    progressDialog.setRange( 0, 1000 );
+    progressDialog.setWindowModality( Qt::ApplicationModal );
+    connect( &progressDialog, &QProgressDialog::canceled,
+             [ &interruptRequest ]() { interruptRequest.set(); } );
+
+    QTimer progressTimer;
+    connect( &progressTimer, &QTimer::timeout, &progressDialog,
+             [ &progressDialog, &processedLines, totalLines ]() {
+                 progressDialog.setValue(
+                     static_cast<int>( processedLines.load() * 1000 / totalLines ) );
+             } );
+
+    QEventLoop compareLoop;
+    QFutureWatcher<LineHashDiff::Result> compareWatcher;
+    connect( &compareWatcher, &QFutureWatcher<LineHashDiff::Result>::finished, &compareLoop,
+             &QEventLoop::quit );
+    compareWatcher.setFuture(
+        QtConcurrent::run( [ &diff, &interruptRequest, &processedLines ]() {
+            return diff.compare( interruptRequest, processedLines );
+        } ) );
+
+    progressDialog.open();
+    progressTimer.start( 100 );
+    compareLoop.exec();
+    progressTimer.stop();
+    progressDialog.reset();
+
+    if ( interruptRequest ) {
+        return;
+    }
+
+    // Tabs could be closed while files were compared
+    const auto result = compareWatcher.result();
+    for ( auto index = 0; index < mainTabWidget_.count(); ++index ) {
+        auto* crawler = static_cast<CrawlerWidget*>( mainTabWidget_.widget( index ) );
+        if ( crawler == current ) {
+            crawler->showLines( result.onlyInFirst );
+        }
+        else if ( crawler == other ) {
+            crawler->showLines( result.onlyInSecond );
+        }
+    }
+}
+
 void MainWindow::clearLog()
 {
     const auto current_file = session_.getFilename( currentCrawlerWidget() );
@@ -953,6 +1261,84 @@ void MainWindow::openUrl()
     }
 }
 
+void MainWindow::openAnalysisBundle()
+{
+    const auto bundlePath = QFileDialog::getOpenFileName(
+        this, tr( "Open analysis bundle" ), "", tr( "Analysis bundles (*.klab)" ) );
+    if ( bundlePath.isEmpty() ) {
+        return;
+    }
+
+    AnalysisBundle bundle;
+    if ( !bundle.load( bundlePath ) ) {
+        QMessageBox::critical( this, "klogg",
+                               tr( "Failed to read analysis bundle %1" ).arg( bundlePath ) );
+        return;
+    }
+
+    // Bundled file is looked for next to the bundle before asking for it
+    auto fileName = QFileInfo( bundlePath )
+                        .dir()
+                        .filePath( QFileInfo( bundle.fileName ).fileName() );
+    if ( !bundle.isBundleOf( fileName ) ) {
+        fileName = QFileDialog::getOpenFileName(
+            this, tr( "Select file of analysis bundle" ), fileName );
+        if ( fileName.isEmpty() ) {
+            return;
+        }
+
+        if ( !bundle.isBundleOf( fileName ) ) {
+            QMessageBox::warning(
+                this, "klogg",
+                tr( "File %1 is not the one the analysis bundle was made of." ).arg( fileName ) );
+            return;
+        }
+    }
+
+    bundle.attach( fileName );
+    addBundledHighlighters( bundle.highlighters );
+    updateHighlightersMenu();
+
+    if ( !loadFile( fileName ) ) {
+        return;
+    }
+
+    if ( auto* crawler = static_cast<CrawlerWidget*>( session_.getViewIfOpen( fileName ) ) ) {
+        crawler->addBundledMarks( bundle.marks );
+        crawler->applyConfiguration();
+    }
+}
+
+void MainWindow::exportAnalysisBundle()
+{
+    auto* current = currentCrawlerWidget();
+    if ( current == nullptr ) {
+        return;
+    }
+
+    const auto fileName = session_.getFilename( current );
+    const auto bundlePath
+        = QFileDialog::getSaveFileName( this, tr( "Export analysis bundle" ), fileName + ".klab",
+                                        tr( "Analysis bundles (*.klab)" ) );
+    if ( bundlePath.isEmpty() ) {
+        return;
+    }
+
+    AnalysisBundle bundle;
+    bundle.fileName = QFileInfo( fileName ).fileName();
+    if ( !current->addAnalysisToBundle( bundle ) ) {
+        QMessageBox::warning( this, "klogg",
+                              tr( "Analysis bundle can be exported when the file is indexed." ) );
+        return;
+    }
+    bundle.highlighters = saveActiveHighlighters();
+
+    if ( !bundle.save( bundlePath ) ) {
+        QMessageBox::critical( this, "klogg",
+                               tr( "Failed to save analysis bundle %1" ).arg( bundlePath ) );
+    }
+}
+
 // Opens the 'Highlighters' dialog box
 void MainWindow::editHighlighters()
 {
@@ -1145,7 +1531,28 @@ void MainWindow::updateLoadingProgress( int progress )
     // We ignore 0% and 100% to avoid a flash when the file (or update)
     // is very short.
     if ( progress > 0 && progress < 100 ) {
-        infoLine->setText( current_file + tr( " - Indexing lines... (%1 %)" ).arg( progress ) );
+        auto text = current_file + tr( " - Indexing lines... (%1 %)" ).arg( progress );
+
+        const auto estimate = currentCrawlerWidget()->logData()->getIndexEstimate();
+        if ( estimate ) {
+            const auto secondsLeft = std::chrono::duration_cast<std::chrono::seconds>(
+                                         estimate->remainingTime( progress ) )
+                                         .count();
+            QString storage;
+            if ( estimate->storage == IndexEstimate::Storage::Sparse ) {
+                storage = tr( ", sparse" );
+            }
+            else if ( estimate->storage == IndexEstimate::Storage::FileBacked ) {
+                storage = tr( ", file backed" );
+            }
+            text += tr( " ~%1 lines, index ~%2%3, about %4 s left" )
+                        .arg( estimate->lines.get() )
+                        .arg( readableSize( estimate->memoryUsage() ) )
+                        .arg( storage )
+                        .arg( secondsLeft );
+        }
+
+        infoLine->setText( text );
         infoLine->displayGauge( progress );
 
         showInfoLabels( false );
@@ -1191,6 +1598,19 @@ memory to hold the index for this file. The file will now be closed." );
     // mainTabWidget_.setEnabled( true );
 }
 
+void MainWindow::showWatchNotification( const QString& fileName, const QString& message )
+{
+    LOG_INFO << "Watched filters matched in " << fileName.toStdString();
+
+    if ( trayIcon_->isVisible() && QSystemTrayIcon::supportsMessages() ) {
+        trayIcon_->showMessage( tr( "New matches in %1" ).arg( QFileInfo( fileName ).fileName() ),
+                                message, QSystemTrayIcon::Information );
+    }
+    else {
+        QApplication::alert( this );
+    }
+}
+
 void MainWindow::handleSearchRefreshChanged( bool isRefreshing )
 {
     auto& config = Configuration::get();
@@ -1229,8 +1649,40 @@ void MainWindow::currentTabChanged( int index )
 {
     LOG_DEBUG << "currentTabChanged";
 
+    auto* currentCrawler
+        = index >= 0 ? static_cast<CrawlerWidget*>( mainTabWidget_.widget( index ) ) : nullptr;
+    const auto currentFile = currentCrawler ? session_.getFilename( currentCrawler ) : QString{};
+    if ( currentFile != foregroundFile_ ) {
+        auto& scheduler = WorkScheduler::get();
+        auto& fileWatcher = FileWatcher::getFileWatcher();
+        if ( !foregroundFile_.isEmpty() ) {
+            scheduler.setForeground( foregroundFile_, false );
+            fileWatcher.setFileActive( foregroundFile_, false );
+        }
+        if ( !currentFile.isEmpty() ) {
+            scheduler.setForeground( currentFile, true );
+            fileWatcher.setFileActive( currentFile, true );
+            MemoryGovernor::get().markUsed( currentFile );
+        }
+        foregroundFile_ = currentFile;
+    }
+
+    if ( currentCrawler != activeCrawler_ ) {
+        if ( activeCrawler_ ) {
+            activeCrawler_->suspend();
+        }
+        if ( currentCrawler ) {
+            currentCrawler->resume();
+        }
+        activeCrawler_ = currentCrawler;
+    }
+
     if ( index >= 0 ) {
         auto* crawler_widget = static_cast<CrawlerWidget*>( mainTabWidget_.widget( index ) );
+        if ( !isRestoringSession_ ) {
+            session_.loadDeferred( crawler_widget );
+        }
+
         signalMux_.setCurrentDocument( crawler_widget );
         quickFindMux_.registerSelector( crawler_widget );
 
@@ -1398,6 +1850,19 @@ bool MainWindow::event( QEvent* event )
     return QMainWindow::event( event );
 }
 
+bool MainWindow::eventFilter( QObject* watched, QEvent* event )
+{
+    if ( watched == sizeField && event->type() == QEvent::ToolTip ) {
+        if ( const auto crawler = currentCrawlerWidget() ) {
+            const auto helpEvent = static_cast<QHelpEvent*>( event );
+            QToolTip::showText( helpEvent->globalPos(), crawler->memoryUsageText(), sizeField );
+        }
+        return true;
+    }
+
+    return QMainWindow::eventFilter( watched, event );
+}
+
 //
 // Private functions
 //
@@ -1420,6 +1885,10 @@ bool MainWindow::extractAndLoadFile( const QString& fileName )
 
     const auto decompressAction = Decompressor::action( fileName );
 
+    if ( decompressAction == DecompressAction::Decompress ) {
+        return decompressAndLoadFile( fileName );
+    }
+
     Decompressor decompressor;
     AtomicFlag decompressInterrupt;
 
@@ -1435,41 +1904,28 @@ bool MainWindow::extractAndLoadFile( const QString& fileName )
                  decompressor.waitForResult();
              } );
 
-    if ( decompressAction == DecompressAction::Decompress ) {
-
-        auto tempFile = new QTemporaryFile(
-            this->tempDir_.filePath( QFileInfo( fileName ).fileName() ), this );
-
-        if ( tempFile->open() && decompressor.decompress( fileName, tempFile, decompressInterrupt )
-             && !progressDialog.exec() ) {
-
-            if ( decompressInterrupt ) {
-                return false;
-            }
-
-            return this->loadFile( tempFile->fileName() );
-        }
-        else {
-            QMessageBox::warning(
-                this, "klogg",
-                QString( "Failed to decompress %1" ).arg( QDir::toNativeSeparators( fileName ) ) );
+    if ( decompressAction == DecompressAction::Extract ) {
+        // Entries are listed and searched in the archive,
+        // only the ones the user opens are extracted
+        ArchiveBrowserDialog archiveBrowser( fileName, Decompressor::listEntries( fileName ),
+                                             this );
+        if ( archiveBrowser.exec() != QDialog::Accepted ) {
+            return false;
         }
-    }
-    else if ( decompressAction == DecompressAction::Extract ) {
+
+        const auto selectedEntries = archiveBrowser.selectedEntries();
         QTemporaryDir archiveDir{ this->tempDir_.filePath( QFileInfo( fileName ).fileName() ) };
         archiveDir.setAutoRemove( false );
-        if ( decompressor.extract( fileName, archiveDir.path(), decompressInterrupt )
+        if ( decompressor.extractEntries( fileName, selectedEntries, archiveDir.path(),
+                                          decompressInterrupt )
              && !progressDialog.exec() ) {
 
             if ( decompressInterrupt ) {
                 return false;
             }
 
-            const auto selectedFiles = QFileDialog::getOpenFileNames(
-                this, tr( "Open file from archive" ), archiveDir.path(), tr( "All files (*)" ) );
-
-            for ( const auto& extractedFile : selectedFiles ) {
-                this->loadFile( extractedFile );
+            for ( const auto& entry : selectedEntries ) {
+                this->loadFile( QDir( archiveDir.path() ).filePath( entry ) );
             }
 
             return true;
@@ -1484,6 +1940,42 @@ bool MainWindow::extractAndLoadFile( const QString& fileName )
     return false;
 }
 
+// Single stream archives are decompressed to a temporary file that is opened
+// right away and indexed as it grows, instead of waiting for the whole file.
+bool MainWindow::decompressAndLoadFile( const QString& fileName )
+{
+    // Decompressor is created first so that it is destroyed,
+    // and stops writing, before the temporary file
+    auto* decompressor = new Decompressor( this );
+    auto* tempFile
+        = new QTemporaryFile( this->tempDir_.filePath( QFileInfo( fileName ).fileName() ), this );
+
+    if ( !tempFile->open() || !decompressor->decompressInBackground( fileName, tempFile ) ) {
+        delete decompressor;
+        delete tempFile;
+        QMessageBox::warning(
+            this, "klogg",
+            QString( "Failed to decompress %1" ).arg( QDir::toNativeSeparators( fileName ) ) );
+        return false;
+    }
+
+    const auto tempFileName = tempFile->fileName();
+    connect( decompressor, &Decompressor::finished, this,
+             [ this, decompressor, fileName, tempFileName ]( bool isOk ) {
+                 decompressor->deleteLater();
+                 if ( !isOk ) {
+                     QMessageBox::warning( this, "klogg",
+                                           QString( "Failed to decompress %1" )
+                                               .arg( QDir::toNativeSeparators( fileName ) ) );
+                 }
+
+                 // Last written data is indexed without waiting for file watcher
+                 FileWatcher::getFileWatcher().fileChangedOnDisk( tempFileName );
+             } );
+
+    return this->loadFile( tempFileName );
+}
+
 // Create a CrawlerWidget for the passed file, start its loading
 // and update the title bar.
 // The loading is done asynchronously.
@@ -1674,7 +2166,10 @@ void MainWindow::updateInfoLine()
 
     infoLine->setText( current_file );
     infoLine->setPath( current_file );
-    sizeField->setText( readableSize( fileSize ) );
+    const auto ingestRate = currentCrawlerWidget()->ingestRateText();
+    sizeField->setText( ingestRate.isEmpty()
+                            ? readableSize( fileSize )
+                            : tr( "%1 (%2)" ).arg( readableSize( fileSize ), ingestRate ) );
     encodingField->setText( currentCrawlerWidget()->encodingText() );
 
     if ( lastModified.isValid() ) {
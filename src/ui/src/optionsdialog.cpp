@@ -42,6 +42,7 @@
 #include <QToolButton>
 #include <QtGui>
 
+#include "devicetuning.h"
 #include "encodings.h"
 #include "fontutils.h"
 #include "highlighteredit.h"
@@ -80,6 +81,12 @@ OptionsDialog::OptionsDialog( QWidget* parent )
 
     connect( extractArchivesCheckBox, &QCheckBox::toggled,
              [ this ]( auto ) { this->setupArchives(); } );
+    connect( deviceTuningCheckBox, &QCheckBox::toggled,
+             [ this ]( auto ) { this->setupDeviceTuning(); } );
+    connect( recalibrateButton, &QPushButton::clicked, [ this ] {
+        DeviceTuning::get().clear();
+        this->setupDeviceTuning();
+    } );
 
     connect( mainSearchColorButton, &QPushButton::clicked, this, &OptionsDialog::changeMainColor );
     connect( quickFindColorButton, &QPushButton::clicked, this, &OptionsDialog::changeQfColor );
@@ -90,6 +97,7 @@ OptionsDialog::OptionsDialog( QWidget* parent )
     setupSearchResultsCache();
     setupLogging();
     setupArchives();
+    setupDeviceTuning();
 }
 
 //
@@ -171,6 +179,7 @@ void OptionsDialog::setupPolling()
 void OptionsDialog::setupSearchResultsCache()
 {
     searchCacheSpinBox->setEnabled( searchResultsCacheCheckBox->isChecked() );
+    persistentSearchCacheCheckBox->setEnabled( searchResultsCacheCheckBox->isChecked() );
 }
 
 void OptionsDialog::setupLogging()
@@ -183,6 +192,32 @@ void OptionsDialog::setupArchives()
     extractArchivesAlwaysCheckBox->setEnabled( extractArchivesCheckBox->isChecked() );
 }
 
+void OptionsDialog::setupDeviceTuning()
+{
+    const auto isTuned = deviceTuningCheckBox->isChecked();
+    indexReadBufferSpinBox->setEnabled( !isTuned );
+    searchReadBufferSpinBox->setEnabled( !isTuned );
+    recalibrateButton->setEnabled( isTuned );
+    deviceTuningLabel->setVisible( isTuned );
+
+    QStringList lines;
+    for ( const auto& calibration : DeviceTuning::get().calibrations() ) {
+        const auto& parameters = calibration.parameters;
+        lines << tr( "%1 (%2): read %3 MiB/s, latency %4 ms, match %5 MiB/s per thread. "
+                     "Search threads %6, index read buffer %7 MiB, search buffer %8 lines." )
+                     .arg( calibration.mountPoint, QString::fromLocal8Bit( calibration.device ) )
+                     .arg( calibration.readMbPerSecond, 0, 'f', 0 )
+                     .arg( calibration.readLatencyMs, 0, 'f', 2 )
+                     .arg( calibration.matchMbPerSecond, 0, 'f', 0 )
+                     .arg( parameters.searchThreadPoolSize )
+                     .arg( parameters.indexReadBufferSizeMb )
+                     .arg( parameters.searchReadBufferSizeLines );
+    }
+    deviceTuningLabel->setText( lines.isEmpty()
+                                    ? tr( "No devices are calibrated yet." )
+                                    : lines.join( '\n' ) );
+}
+
 // Convert a regexp type to its index in the list
 int OptionsDialog::getRegexpTypeIndex( SearchRegexpType syntax ) const
 {
@@ -280,6 +315,8 @@ void OptionsDialog::updateDialogFromConfig()
     }
 
     hideAnsiColorsCheckBox->setChecked( config.hideAnsiColorSequences() );
+    renderAnsiColorsCheckBox->setChecked( config.renderAnsiColors() );
+    threadedRenderingCheckBox->setChecked( config.threadedRendering() );
 
     // Regexp types
     mainSearchBox->setCurrentIndex( getRegexpTypeIndex( config.mainRegexpType() ) );
@@ -293,6 +330,7 @@ void OptionsDialog::updateDialogFromConfig()
 
     highlightMainSearchCheckBox->setChecked( config.mainSearchHighlight() );
     variateHighlightCheckBox->setChecked( config.variateMainSearchHighlight() );
+    contextLinesSpinBox->setValue( config.searchContextLines() );
     incrementalCheckBox->setChecked( config.isQuickfindIncremental() );
 
     // Polling
@@ -318,10 +356,15 @@ void OptionsDialog::updateDialogFromConfig()
     parallelSearchCheckBox->setChecked( config.useParallelSearch() );
     searchResultsCacheCheckBox->setChecked( config.useSearchResultsCache() );
     searchCacheSpinBox->setValue( static_cast<int>( config.searchResultsCacheLines() ) );
+    indexCacheCheckBox->setChecked( config.useIndexCache() );
+    persistentSearchCacheCheckBox->setChecked( config.usePersistentSearchCache() );
+    memoryBudgetSpinBox->setValue( config.memoryBudgetMb() );
     indexReadBufferSpinBox->setValue( config.indexReadBufferSizeMb() );
     searchReadBufferSpinBox->setValue( config.searchReadBufferSizeLines() );
     keepFileClosedCheckBox->setChecked( config.keepFileClosed() );
     optimizeForNotLatinEncodingsCheckBox->setChecked( config.optimizeForNotLatinEncodings() );
+    useMemoryMappedFilesCheckBox->setChecked( config.useMemoryMappedFiles() );
+    deviceTuningCheckBox->setChecked( config.useDeviceTuning() );
 
     // version checking
     checkForNewVersionCheckBox->setChecked( config.versionCheckingEnabled() );
@@ -389,6 +432,7 @@ void OptionsDialog::updateConfigFromDialog()
     config.setMainSearchBackColor( mainSearchColor_ );
     config.setEnableMainSearchHighlight( highlightMainSearchCheckBox->isChecked() );
     config.setVariateMainSearchHighlight( variateHighlightCheckBox->isChecked() );
+    config.setSearchContextLines( contextLinesSpinBox->value() );
     config.setQuickfindRegexpType( getRegexpTypeFromIndex( quickFindSearchBox->currentIndex() ) );
     config.setQfBackColor( qfSearchColor_ );
     config.setQuickfindIncremental( incrementalCheckBox->isChecked() );
@@ -420,10 +464,15 @@ void OptionsDialog::updateConfigFromDialog()
     config.setUseParallelSearch( parallelSearchCheckBox->isChecked() );
     config.setUseSearchResultsCache( searchResultsCacheCheckBox->isChecked() );
     config.setSearchResultsCacheLines( static_cast<unsigned>( searchCacheSpinBox->value() ) );
+    config.setUseIndexCache( indexCacheCheckBox->isChecked() );
+    config.setUsePersistentSearchCache( persistentSearchCacheCheckBox->isChecked() );
+    config.setMemoryBudgetMb( memoryBudgetSpinBox->value() );
     config.setIndexReadBufferSizeMb( indexReadBufferSpinBox->value() );
     config.setSearchReadBufferSizeLines( searchReadBufferSpinBox->value() );
     config.setKeepFileClosed( keepFileClosedCheckBox->isChecked() );
     config.setOptimizeForNotLatinEncodings( optimizeForNotLatinEncodingsCheckBox->isChecked() );
+    config.setUseMemoryMappedFiles( useMemoryMappedFilesCheckBox->isChecked() );
+    config.setUseDeviceTuning( deviceTuningCheckBox->isChecked() );
 
     // version checking
     config.setVersionCheckingEnabled( checkForNewVersionCheckBox->isChecked() );
@@ -437,6 +486,8 @@ void OptionsDialog::updateConfigFromDialog()
 
     config.setStyle( styleComboBox->currentText() );
     config.setHideAnsiColorSequences( hideAnsiColorsCheckBox->isChecked() );
+    config.setRenderAnsiColors( renderAnsiColorsCheckBox->isChecked() );
+    config.setThreadedRendering( threadedRenderingCheckBox->isChecked() );
 
     config.setDefaultEncodingMib( encodingComboBox->currentData().toInt() );
 
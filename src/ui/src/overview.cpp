@@ -21,13 +21,42 @@
 // It provides support for drawing the match overview sidebar but
 // the actual drawing is done in AbstractLogView which uses this class.
 
+#include <numeric>
+
 #include "linetypes.h"
 #include "log.h"
+#include "tracezone.h"
 
 #include "logfiltereddata.h"
 
 #include "overview.h"
 
+namespace {
+// Lines are darker for more lines of file shown at their positions
+void buildWeightedLines( const std::vector<LinesCount::UnderlyingType>& counts,
+                         std::vector<Overview::WeightedLine>& lines )
+{
+    lines.clear();
+    for ( auto position = 0u; position < counts.size(); ++position ) {
+        const auto count = counts[ position ];
+        if ( count == 0 ) {
+            continue;
+        }
+
+        lines.emplace_back( static_cast<int>( position ) );
+        for ( auto step = 1u; step < count && step < Overview::WeightedLine::WEIGHT_STEPS;
+              ++step ) {
+            lines.back().load();
+        }
+    }
+}
+
+LinesCount::UnderlyingType sum( const std::vector<LinesCount::UnderlyingType>& counts )
+{
+    return std::accumulate( counts.begin(), counts.end(), LinesCount::UnderlyingType{ 0 } );
+}
+} // namespace
+
 Overview::Overview()
     : matchLines_()
     , markLines_()
@@ -51,6 +80,59 @@ void Overview::updateData( LinesCount totalNbLine )
     dirty_ = true;
 }
 
+void Overview::addNewMatches( LinesCount totalNbLine )
+{
+    if ( logFilteredData_ == nullptr ) {
+        return;
+    }
+
+    // Positions of all lines change when file grows
+    if ( totalNbLine != linesInFile_ ) {
+        updateData( totalNbLine );
+    }
+
+    const auto newMatches = logFilteredData_->takeNewMatches();
+    if ( dirty_ || suspended_ || linesInFile_.get() == 0 || matchCounts_.size() != height_ ) {
+        // New matches are counted when all lines are recalculated
+        return;
+    }
+
+    // Searched lines no longer show estimated matches
+    if ( !estimatedLines_.empty() ) {
+        dirty_ = true;
+        return;
+    }
+
+    const auto addPosition = [ this ]( uint64_t line, int change,
+                                       std::vector<LinesCount::UnderlyingType>& counts ) {
+        const auto position = static_cast<size_t>( yFromFileLine( LineNumber( line ) ) );
+        if ( position < counts.size() && ( change > 0 || counts[ position ] > 0 ) ) {
+            counts[ position ] = static_cast<LinesCount::UnderlyingType>(
+                static_cast<int64_t>( counts[ position ] ) + change );
+        }
+    };
+
+    for ( const auto line : newMatches.matches ) {
+        addPosition( line, 1, matchCounts_ );
+    }
+    // These lines are shown as matches now
+    for ( const auto line : newMatches.marked ) {
+        addPosition( line, -1, markCounts_ );
+    }
+
+    // Results can also be replaced at once, e.g. from cache,
+    // then counts no longer match all visible lines
+    const auto totals = logFilteredData_->countLinesBefore( LineNumber( linesInFile_.get() ) );
+    if ( sum( matchCounts_ ) != totals.first.get() || sum( markCounts_ ) != totals.second.get() ) {
+        dirty_ = true;
+        return;
+    }
+
+    buildWeightedLines( matchCounts_, matchLines_ );
+    buildWeightedLines( markCounts_, markLines_ );
+    ++linesRevision_;
+}
+
 void Overview::updateView( unsigned height )
 {
     // We don't touch the cache if the height hasn't changed
@@ -71,6 +153,31 @@ const std::vector<Overview::WeightedLine>* Overview::getMarkLines() const
     return &markLines_;
 }
 
+const std::vector<Overview::WeightedLine>* Overview::getEstimatedLines() const
+{
+    return &estimatedLines_;
+}
+
+void Overview::setHighlighterLines( std::vector<HighlighterLines> highlighterLines )
+{
+    highlighters_ = std::move( highlighterLines );
+    dirty_ = true;
+}
+
+void Overview::appendHighlighterLines( const std::vector<SearchResultArray>& lines )
+{
+    for ( auto index = 0u; index < lines.size() && index < highlighters_.size(); ++index ) {
+        highlighters_[ index ].lines |= lines[ index ];
+    }
+    dirty_ = true;
+}
+
+const std::vector<std::pair<QColor, std::vector<Overview::WeightedLine>>>*
+Overview::getHighlighterLines() const
+{
+    return &highlighterLines_;
+}
+
 std::pair<int, int> Overview::getViewLines() const
 {
     int top = 0;
@@ -107,41 +214,59 @@ int Overview::yFromFileLine( LineNumber fileLine ) const
 // Update the internal cache
 void Overview::recalculatesLines()
 {
+    KLOGG_ZONE( "Overview::recalculatesLines" );
     LOG_DEBUG << "OverviewWidget::recalculatesLines";
 
     if ( logFilteredData_ != nullptr ) {
-        matchLines_.clear();
-        markLines_.clear();
+        // All matches found so far are counted below
+        logFilteredData_->takeNewMatches();
+
+        matchCounts_.assign( height_, 0 );
+        markCounts_.assign( height_, 0 );
+        std::vector<LinesCount::UnderlyingType> estimatedCounts( height_, 0 );
+        std::vector<std::vector<LinesCount::UnderlyingType>> highlighterCounts(
+            highlighters_.size(), std::vector<LinesCount::UnderlyingType>( height_, 0 ) );
 
         if ( linesInFile_.get() > 0 ) {
-            logFilteredData_->iterateOverLines( [ this ]( LineNumber line ) {
-                const auto lineType = logFilteredData_->lineTypeByLine( line );
-                const auto position = yFromFileLine( line );
-                if ( lineType.testFlag( LogFilteredData::LineTypeFlags::Match ) ) {
-                    if ( ( !matchLines_.empty() ) && matchLines_.back().position() == position ) {
-                        // If the line is already there, we increase its weight
-                        matchLines_.back().load();
-                    }
-                    else {
-                        // If not we just add it
-                        matchLines_.emplace_back( position );
-                    }
-                }
-                else {
-                    if ( ( !markLines_.empty() ) && markLines_.back().position() == position ) {
-                        // If the line is already there, we increase its weight
-                        markLines_.back().load();
-                    }
-                    else {
-                        // If not we just add it
-                        markLines_.emplace_back( position );
-                    }
+            // Lines of each position are counted by ranks of their range,
+            // so the time does not depend on the number of matches
+            auto countsBefore = std::make_pair( 0_lcount, 0_lcount );
+            auto firstLine = 0_lnum;
+            std::vector<uint64_t> highlighterRanks( highlighters_.size(), 0 );
+            for ( auto position = 0u; position < height_; ++position ) {
+                // First line after the ones shown at position, see yFromFileLine
+                const auto nextLine = LineNumber(
+                    ( ( position + 1 ) * linesInFile_.get() + height_ - 1 ) / height_ );
+                const auto counts = logFilteredData_->countLinesBefore( nextLine );
+
+                matchCounts_[ position ] = ( counts.first - countsBefore.first ).get();
+                markCounts_[ position ] = ( counts.second - countsBefore.second ).get();
+                estimatedCounts[ position ]
+                    = logFilteredData_->getEstimatedMatches( firstLine, nextLine ).get();
+                for ( auto index = 0u; index < highlighters_.size(); ++index ) {
+                    const auto rank = highlighters_[ index ].lines.rank( nextLine.get() - 1 );
+                    highlighterCounts[ index ][ position ] = rank - highlighterRanks[ index ];
+                    highlighterRanks[ index ] = rank;
                 }
-            } );
+
+                countsBefore = counts;
+                firstLine = nextLine;
+            }
+        }
+
+        buildWeightedLines( matchCounts_, matchLines_ );
+        buildWeightedLines( markCounts_, markLines_ );
+        buildWeightedLines( estimatedCounts, estimatedLines_ );
+
+        highlighterLines_.resize( highlighters_.size() );
+        for ( auto index = 0u; index < highlighters_.size(); ++index ) {
+            highlighterLines_[ index ].first = highlighters_[ index ].color;
+            buildWeightedLines( highlighterCounts[ index ], highlighterLines_[ index ].second );
         }
     }
     else
         LOG_DEBUG << "Overview::recalculatesLines: logFilteredData_ == NULL";
 
     dirty_ = false;
+    ++linesRevision_;
 }
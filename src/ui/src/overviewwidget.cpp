@@ -22,6 +22,7 @@
 
 #include <QMouseEvent>
 #include <QPainter>
+#include <algorithm>
 #include <cassert>
 
 #include "log.h"
@@ -129,6 +130,43 @@ const char* const highlight_xpm[][ 14 ] = {
     },
 };
 
+namespace {
+// Blends the color over pixels [left, right] of the row, as painter
+// would draw a line of the color with the opacity
+void blendRow( QRgb* row, int left, int right, const QColor& color, double opacity )
+{
+    const auto alpha = qBound( 0, qRound( color.alphaF() * opacity * 255 ), 255 );
+    const auto source = qPremultiply( qRgba( color.red(), color.green(), color.blue(), alpha ) );
+    for ( auto x = left; x <= right; ++x ) {
+        const auto destination = row[ x ];
+        const auto keep = 255 - alpha;
+        row[ x ] = qRgba( qRed( source ) + qRed( destination ) * keep / 255,
+                          qGreen( source ) + qGreen( destination ) * keep / 255,
+                          qBlue( source ) + qBlue( destination ) * keep / 255,
+                          alpha + qAlpha( destination ) * keep / 255 );
+    }
+}
+
+void blendLines( QImage& image, const std::vector<Overview::WeightedLine>& lines, int left,
+                 int right, const QColor& color, double opacityStep )
+{
+    left = std::max( left, 0 );
+    right = std::min( right, image.width() - 1 );
+    if ( left > right ) {
+        return;
+    }
+
+    for ( const auto& line : lines ) {
+        if ( line.position() < 0 || line.position() >= image.height() ) {
+            continue;
+        }
+        // (allow multiple matches to look 'darker' than a single one.)
+        blendRow( reinterpret_cast<QRgb*>( image.scanLine( line.position() ) ), left, right,
+                  color, opacityStep * ( line.weight() + 1 ) );
+    }
+}
+} // namespace
+
 OverviewWidget::OverviewWidget( QWidget* parent )
     : QWidget( parent )
     , highlightTimer_()
@@ -141,9 +179,6 @@ OverviewWidget::OverviewWidget( QWidget* parent )
 
 void OverviewWidget::paintEvent( QPaintEvent* /* paintEvent */ )
 {
-    static const QColor match_color( "red" );
-    static const QColor mark_color( "dodgerblue" );
-
     static const QPixmap highlight_pixmap[] = {
         QPixmap( highlight_xpm[ 0 ] ), QPixmap( highlight_xpm[ 1 ] ), QPixmap( highlight_xpm[ 2 ] ),
         QPixmap( highlight_xpm[ 3 ] ), QPixmap( highlight_xpm[ 4 ] ), QPixmap( highlight_xpm[ 5 ] ),
@@ -154,6 +189,12 @@ void OverviewWidget::paintEvent( QPaintEvent* /* paintEvent */ )
 
     overview_->updateView( static_cast<unsigned>( height() ) );
 
+    // Lines are only drawn again when they change, not for every scroll
+    if ( linesImage_.size() != size() || linesImageRevision_ != overview_->getLinesRevision() ) {
+        linesImage_ = drawLinesImage();
+        linesImageRevision_ = overview_->getLinesRevision();
+    }
+
     {
         QPainter painter( this );
 
@@ -163,30 +204,9 @@ void OverviewWidget::paintEvent( QPaintEvent* /* paintEvent */ )
         painter.setPen( palette().color( QPalette::Text ) );
         painter.drawLine( 0, 0, 0, height() );
 
-        // The 'match' lines
-        painter.setPen( match_color );
-        const auto matchLines = *( overview_->getMatchLines() );
-        for ( const auto& line : matchLines ) {
-            painter.setOpacity( ( 1.0 / Overview::WeightedLine::WEIGHT_STEPS )
-                                * ( line.weight() + 1 ) );
-            // (allow multiple matches to look 'darker' than a single one.)
-            painter.drawLine( 1 + LINE_MARGIN, line.position(), width() - LINE_MARGIN - 1,
-                              line.position() );
-        }
-
-        // The 'mark' lines
-        painter.setPen( mark_color );
-        const auto markLines = *( overview_->getMarkLines() );
-        for ( const auto& line : markLines ) {
-            painter.setOpacity( ( 1.0 / Overview::WeightedLine::WEIGHT_STEPS )
-                                * ( line.weight() + 1 ) );
-            // (allow multiple matches to look 'darker' than a single one.)
-            painter.drawLine( 1 + LINE_MARGIN, line.position(), width() - LINE_MARGIN - 1,
-                              line.position() );
-        }
+        painter.drawImage( 0, 0, linesImage_ );
 
         // The 'view' lines
-        painter.setOpacity( 1 );
         painter.setPen( palette().color( QPalette::Text ) );
         std::pair<int, int> viewLines = overview_->getViewLines();
         painter.drawLine( 1, viewLines.first, width(), viewLines.first );
@@ -209,6 +229,45 @@ void OverviewWidget::paintEvent( QPaintEvent* /* paintEvent */ )
     }
 }
 
+QImage OverviewWidget::drawLinesImage() const
+{
+    static const QColor match_color( "red" );
+    static const QColor mark_color( "dodgerblue" );
+
+    QImage image( size(), QImage::Format_ARGB32_Premultiplied );
+    image.fill( Qt::transparent );
+
+    constexpr auto opacityStep = 1.0 / Overview::WeightedLine::WEIGHT_STEPS;
+    const auto lineLeft = 1 + LINE_MARGIN;
+    const auto lineRight = width() - LINE_MARGIN - 1;
+
+    // Lines of each highlighter are a narrow stripe from the left, under matches
+    auto stripeLeft = 1;
+    for ( const auto& [ color, lines ] : *overview_->getHighlighterLines() ) {
+        if ( stripeLeft + HIGHLIGHTER_STRIPE_WIDTH > width() ) {
+            break;
+        }
+
+        blendLines( image, lines, stripeLeft, stripeLeft + HIGHLIGHTER_STRIPE_WIDTH - 1, color,
+                    opacityStep );
+        stripeLeft += HIGHLIGHTER_STRIPE_WIDTH;
+    }
+
+    // The 'match' lines
+    blendLines( image, *overview_->getMatchLines(), lineLeft, lineRight, match_color,
+                opacityStep );
+
+    // Lines where matches are expected are shown lighter until they are searched
+    blendLines( image, *overview_->getEstimatedLines(), lineLeft, lineRight, match_color,
+                opacityStep / 2 );
+
+    // The 'mark' lines
+    blendLines( image, *overview_->getMarkLines(), lineLeft, lineRight, mark_color,
+                opacityStep );
+
+    return image;
+}
+
 void OverviewWidget::mousePressEvent( QMouseEvent* mouseEvent )
 {
     if ( mouseEvent->button() == Qt::LeftButton )
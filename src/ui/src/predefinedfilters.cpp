@@ -56,7 +56,9 @@ void PredefinedFiltersCollection::retrieveFromStorage( QSettings& settings )
 
                 filters_.push_back( { settings.value( "name" ).toString(),
                                       settings.value( "filter" ).toString(),
-                                      settings.value( "regex", true ).toBool() } );
+                                      settings.value( "regex", true ).toBool(),
+                                      settings.value( "pinned", false ).toBool(),
+                                      settings.value( "watched", false ).toBool() } );
             }
             settings.endArray();
         }
@@ -83,6 +85,8 @@ void PredefinedFiltersCollection::saveToStorage( QSettings& settings ) const
         settings.setValue( "name", filter.name );
         settings.setValue( "filter", filter.pattern );
         settings.setValue( "regex", filter.useRegex );
+        settings.setValue( "pinned", filter.isPinned );
+        settings.setValue( "watched", filter.isWatched );
 
         arrayIndex++;
     }
@@ -156,11 +156,17 @@ void PredefinedFiltersDialog::populateFiltersTable(
     filtersTableWidget->clear();
 
     filtersTableWidget->setRowCount( static_cast<int>( filters.size() ) );
-    filtersTableWidget->setColumnCount( 3 );
+    filtersTableWidget->setColumnCount( 5 );
 
     filtersTableWidget->setHorizontalHeaderLabels( QStringList() << "Name"
                                                                  << "Pattern"
-                                                                 << "Regex" );
+                                                                 << "Regex"
+                                                                 << "Pinned"
+                                                                 << "Watched" );
+    filtersTableWidget->horizontalHeaderItem( 3 )->setToolTip(
+        tr( "Search for the filter in the background when a file is opened" ) );
+    filtersTableWidget->horizontalHeaderItem( 4 )->setToolTip(
+        tr( "Notify about lines matching the filter added to followed files" ) );
 
     int filterIndex = 0;
     for ( const auto& filter : filters ) {
@@ -169,6 +175,12 @@ void PredefinedFiltersDialog::populateFiltersTable(
         auto* regexCheckbox = new CenteredCheckbox;
         regexCheckbox->setChecked( filter.useRegex );
         filtersTableWidget->setCellWidget( filterIndex, 2, regexCheckbox );
+        auto* pinnedCheckbox = new CenteredCheckbox;
+        pinnedCheckbox->setChecked( filter.isPinned );
+        filtersTableWidget->setCellWidget( filterIndex, 3, pinnedCheckbox );
+        auto* watchedCheckbox = new CenteredCheckbox;
+        watchedCheckbox->setChecked( filter.isWatched );
+        filtersTableWidget->setCellWidget( filterIndex, 4, watchedCheckbox );
 
         filterIndex++;
     }
@@ -202,8 +214,16 @@ PredefinedFiltersCollection::Collection PredefinedFiltersDialog::readFiltersTabl
             = static_cast<CenteredCheckbox*>( filtersTableWidget->cellWidget( i, 2 ) );
         const auto useRegex = useRegexCheckbox ? useRegexCheckbox->isChecked() : false;
 
+        const auto isPinnedCheckbox
+            = static_cast<CenteredCheckbox*>( filtersTableWidget->cellWidget( i, 3 ) );
+        const auto isPinned = isPinnedCheckbox ? isPinnedCheckbox->isChecked() : false;
+
+        const auto isWatchedCheckbox
+            = static_cast<CenteredCheckbox*>( filtersTableWidget->cellWidget( i, 4 ) );
+        const auto isWatched = isWatchedCheckbox ? isWatchedCheckbox->isChecked() : false;
+
         if ( !name.isEmpty() && !value.isEmpty() ) {
-            currentFilters.push_back( { name, value, useRegex } );
+            currentFilters.push_back( { name, value, useRegex, isPinned, isWatched } );
         }
     }
 
@@ -223,6 +243,10 @@ void PredefinedFiltersDialog::addFilterRow( const QString& newFilter )
     filtersTableWidget->setItem( newRow, 0, new QTableWidgetItem( "" ) );
     auto regexCheckBox = new CenteredCheckbox;
     filtersTableWidget->setCellWidget( newRow, 2, regexCheckBox );
+    auto pinnedCheckBox = new CenteredCheckbox;
+    filtersTableWidget->setCellWidget( newRow, 3, pinnedCheckBox );
+    auto watchedCheckBox = new CenteredCheckbox;
+    filtersTableWidget->setCellWidget( newRow, 4, watchedCheckBox );
 
     filtersTableWidget->scrollToItem( filtersTableWidget->item( newRow, 0 ) );
     filtersTableWidget->setCurrentCell( newRow, 0 );
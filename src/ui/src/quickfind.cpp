@@ -42,9 +42,19 @@
 // Search is started just after the selection and the selection is updated
 // if a match is found.
 
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <vector>
+
 #include <QApplication>
 #include <QtConcurrent>
 
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
 #include "abstractlogdata.h"
 #include "dispatch_to.h"
 #include "log.h"
@@ -53,6 +63,71 @@
 
 #include "quickfind.h"
 
+namespace {
+// Lines are read by chunks growing up to the maximum,
+// so matches close to the start are found without reading much
+constexpr LinesCount::UnderlyingType FirstSearchChunkLines = 256;
+constexpr LinesCount::UnderlyingType MaxSearchChunkLines = 16384;
+
+// Returns indexes of all matching lines
+std::vector<size_t> findMatchingLines( const std::vector<QString>& lines,
+                                       const QuickFindMatcher& matcher )
+{
+    std::vector<uint8_t> isMatching( lines.size(), 0 );
+    tbb::parallel_for( tbb::blocked_range<size_t>( 0, lines.size(), 256 ),
+                       [ & ]( const tbb::blocked_range<size_t>& range ) {
+                           for ( auto index = range.begin(); index != range.end(); ++index ) {
+                               isMatching[ index ] = matcher.hasMatch( lines[ index ] );
+                           }
+                       } );
+
+    std::vector<size_t> matches;
+    for ( auto index = 0u; index < isMatching.size(); ++index ) {
+        if ( isMatching[ index ] ) {
+            matches.push_back( index );
+        }
+    }
+
+    return matches;
+}
+
+bool isSameRegexp( const QRegularExpression& lhs, const QRegularExpression& rhs )
+{
+    return lhs.pattern() == rhs.pattern() && lhs.patternOptions() == rhs.patternOptions();
+}
+
+// Whether the pattern needs nothing but literal characters
+bool isLiteralPattern( const QString& pattern )
+{
+    static const QString SpecialCharacters = QStringLiteral( "()[]{}.*+?^$|" );
+
+    for ( auto index = 0; index < pattern.size(); ++index ) {
+        const auto c = pattern.at( index );
+        if ( c == '\\' ) {
+            // Escaped punctuation is literal, escaped letters and digits are not
+            if ( index + 1 >= pattern.size() || pattern.at( index + 1 ).unicode() >= 0x80
+                 || pattern.at( index + 1 ).isLetterOrNumber() ) {
+                return false;
+            }
+            ++index;
+        }
+        else if ( SpecialCharacters.contains( c ) ) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Whether all lines matching the regexp also match the wider one,
+// this is the case when a literal pattern is extended while typing
+bool isNarrowerRegexp( const QRegularExpression& regexp, const QRegularExpression& wider )
+{
+    return regexp.patternOptions() == wider.patternOptions() && isLiteralPattern( regexp.pattern() )
+           && regexp.pattern().startsWith( wider.pattern() );
+}
+} // namespace
+
 void SearchingNotifier::reset()
 {
     dotToDisplay_ = 0;
@@ -118,6 +193,123 @@ bool QuickFind::LastMatchPosition::isSooner( const FilePosition& position ) cons
     return isSooner( position.line(), position.column() );
 }
 
+void QuickFind::MatchIndex::setRegexp( const QRegularExpression& regexp )
+{
+    ScopedLock lock( mutex_ );
+    if ( isSameRegexp( regexp_, regexp ) ) {
+        return;
+    }
+
+    // Matches of the previous regexp are candidates for a narrower one
+    const auto isNarrower = isNarrowerRegexp( regexp, regexp_ );
+    regexp_ = regexp;
+    if ( !isNarrower ) {
+        matches_ = SearchResultArray{};
+        scannedBegin_ = 0_lnum;
+        scannedEnd_ = 0_lnum;
+    }
+}
+
+void QuickFind::MatchIndex::reset()
+{
+    ScopedLock lock( mutex_ );
+    regexp_ = QRegularExpression{};
+    matches_ = SearchResultArray{};
+    scannedBegin_ = 0_lnum;
+    scannedEnd_ = 0_lnum;
+}
+
+void QuickFind::MatchIndex::setMatches( SearchResultArray matches, LineNumber end )
+{
+    ScopedLock lock( mutex_ );
+    matches_ = std::move( matches );
+    scannedBegin_ = 0_lnum;
+    scannedEnd_ = end;
+}
+
+void QuickFind::MatchIndex::addScanned( const QRegularExpression& regexp, LineNumber begin,
+                                        LineNumber end, const std::vector<LineNumber>& matches )
+{
+    ScopedLock lock( mutex_ );
+
+    // Cancelled searches can still add lines scanned for another regexp
+    if ( !isSameRegexp( regexp_, regexp ) && !isNarrowerRegexp( regexp_, regexp ) ) {
+        return;
+    }
+
+    if ( scannedBegin_ == scannedEnd_ || begin > scannedEnd_ || end < scannedBegin_ ) {
+        matches_ = SearchResultArray{};
+        scannedBegin_ = begin;
+        scannedEnd_ = end;
+    }
+    else {
+        scannedBegin_ = std::min( scannedBegin_, begin );
+        scannedEnd_ = std::max( scannedEnd_, end );
+    }
+
+    for ( const auto& match : matches ) {
+        matches_.add( match.get() );
+    }
+}
+
+bool QuickFind::MatchIndex::isEmpty() const
+{
+    ScopedLock lock( mutex_ );
+    return scannedBegin_ == scannedEnd_;
+}
+
+bool QuickFind::MatchIndex::isScanned( LineNumber line ) const
+{
+    ScopedLock lock( mutex_ );
+    return line >= scannedBegin_ && line < scannedEnd_;
+}
+
+LineNumber QuickFind::MatchIndex::scannedBegin() const
+{
+    ScopedLock lock( mutex_ );
+    return scannedBegin_;
+}
+
+LineNumber QuickFind::MatchIndex::scannedEnd() const
+{
+    ScopedLock lock( mutex_ );
+    return scannedEnd_;
+}
+
+OptionalLineNumber QuickFind::MatchIndex::nextMatch( LineNumber line ) const
+{
+    ScopedLock lock( mutex_ );
+    if ( line < scannedBegin_ || line >= scannedEnd_ ) {
+        return {};
+    }
+
+    // Number of matches before the line is the rank of the next one
+    const auto matchRank = line.get() > 0 ? matches_.rank( line.get() - 1 ) : 0;
+    uint64_t match = 0;
+    if ( !matches_.select( matchRank, &match ) || match >= scannedEnd_.get() ) {
+        return {};
+    }
+
+    return LineNumber( match );
+}
+
+OptionalLineNumber QuickFind::MatchIndex::previousMatch( LineNumber line ) const
+{
+    ScopedLock lock( mutex_ );
+    if ( line <= scannedBegin_ || line > scannedEnd_ ) {
+        return {};
+    }
+
+    const auto matchRank = matches_.rank( line.get() - 1 );
+    uint64_t match = 0;
+    if ( matchRank == 0 || !matches_.select( matchRank - 1, &match )
+         || match < scannedBegin_.get() ) {
+        return {};
+    }
+
+    return LineNumber( match );
+}
+
 QuickFind::QuickFind( const AbstractLogData& logData )
     : logData_( logData )
     , searchingNotifier_()
@@ -130,12 +322,30 @@ QuickFind::QuickFind( const AbstractLogData& logData )
              &QuickFind::onSearchFutureReady );
 }
 
+void QuickFind::setMatchesProvider( MatchesProvider provider )
+{
+    matchesProvider_ = std::move( provider );
+}
+
+void QuickFind::prepareMatchIndex( const QuickFindMatcher& matcher )
+{
+    matchIndex_.setRegexp( matcher.regexp() );
+    if ( !matcher.isActive() || !matchesProvider_ || !matchIndex_.isEmpty() ) {
+        return;
+    }
+
+    if ( auto matches = matchesProvider_( matcher.regexp() ) ) {
+        LOG_INFO << "QuickFind uses " << matches->first.cardinality() << " known matches";
+        matchIndex_.setMatches( std::move( matches->first ), matches->second );
+    }
+}
+
 Selection QuickFind::incrementalSearchStop()
 {
     if ( incrementalSearchStatus_.isOngoing() ) {
         Selection s = incrementalSearchStatus_.initialSelection();
         incrementalSearchStatus_ = IncrementalSearchStatus();
-        interruptRequested_.set();
+        interruptRequested_->set();
 
         return s;
     }
@@ -149,7 +359,7 @@ Selection QuickFind::incrementalSearchAbort()
     if ( incrementalSearchStatus_.isOngoing() ) {
         Selection s = incrementalSearchStatus_.initialSelection();
         incrementalSearchStatus_ = IncrementalSearchStatus();
-        interruptRequested_.set();
+        interruptRequested_->set();
         return s;
     }
     else {
@@ -160,8 +370,13 @@ Selection QuickFind::incrementalSearchAbort()
 void QuickFind::stopSearch()
 {
     LOG_INFO << "Stop search for quickfind " << this;
-    interruptRequested_.set();
+    interruptRequested_->set();
     operationWatcher_.waitForFinished();
+
+    for ( auto& search : cancelledSearches_ ) {
+        search.waitForFinished();
+    }
+    cancelledSearches_.clear();
 }
 
 void QuickFind::onSearchFutureReady()
@@ -179,12 +394,40 @@ void QuickFind::onSearchFutureReady()
     }
 }
 
+// The running search is not waited for, it stops at its next check
+// of the interrupt flag and its result is ignored
+void QuickFind::cancelSearch()
+{
+    interruptRequested_->set();
+
+    if ( operationFuture_.isRunning() ) {
+        cancelledSearches_.push_back( operationFuture_ );
+    }
+    cancelledSearches_.erase( std::remove_if( cancelledSearches_.begin(),
+                                              cancelledSearches_.end(),
+                                              []( const QFuture<Portion>& search ) {
+                                                  return search.isFinished();
+                                              } ),
+                              cancelledSearches_.end() );
+}
+
+void QuickFind::startSearch( std::function<Portion( const AtomicFlag& )> search )
+{
+    interruptRequested_ = std::make_shared<AtomicFlag>();
+
+    operationFuture_ = QtConcurrent::run(
+        [ search = std::move( search ), interruptRequested = interruptRequested_ ]() {
+            return search( *interruptRequested );
+        } );
+    operationWatcher_.setFuture( operationFuture_ );
+}
+
 void QuickFind::incrementallySearchForward( Selection selection, QuickFindMatcher matcher )
 {
     LOG_DEBUG << "QuickFind::incrementallySearchForward";
 
-    interruptRequested_.set();
-    operationWatcher_.waitForFinished();
+    cancelSearch();
+    prepareMatchIndex( matcher );
 
     // Position where we start the search from
     FilePosition start_position = selection.getNextPosition();
@@ -200,25 +443,17 @@ void QuickFind::incrementallySearchForward( Selection selection, QuickFindMatche
         incrementalSearchStatus_ = IncrementalSearchStatus( Forward, start_position, selection );
     }
 
-#if QT_VERSION < QT_VERSION_CHECK( 6, 0, 0 )
-    operationFuture_ = QtConcurrent::run( this, &QuickFind::doSearchForward, start_position,
-                                          selection, matcher );
-#else
-    operationFuture_ = QtConcurrent::run(
-        qOverload<const FilePosition&, const Selection&, const QuickFindMatcher&>(
-            &QuickFind::doSearchForward ),
-        this, start_position, selection, matcher );
-#endif
-
-    operationWatcher_.setFuture( operationFuture_ );
+    startSearch( [ this, start_position, selection, matcher ]( const AtomicFlag& interrupt ) {
+        return doSearchForward( start_position, selection, matcher, interrupt );
+    } );
 }
 
 void QuickFind::incrementallySearchBackward( Selection selection, QuickFindMatcher matcher )
 {
     LOG_DEBUG << "QuickFind::incrementallySearchBackward";
 
-    interruptRequested_.set();
-    operationWatcher_.waitForFinished();
+    cancelSearch();
+    prepareMatchIndex( matcher );
 
     // Position where we start the search from
     FilePosition start_position = selection.getPreviousPosition();
@@ -234,63 +469,40 @@ void QuickFind::incrementallySearchBackward( Selection selection, QuickFindMatch
         incrementalSearchStatus_ = IncrementalSearchStatus( Backward, start_position, selection );
     }
 
-#if QT_VERSION < QT_VERSION_CHECK( 6, 0, 0 )
-    operationFuture_ = QtConcurrent::run( this, &QuickFind::doSearchBackward, start_position,
-                                          selection, matcher );
-#else
-    operationFuture_ = QtConcurrent::run(
-        qOverload<const FilePosition&, const Selection&, const QuickFindMatcher&>(
-            &QuickFind::doSearchBackward ),
-        this, start_position, selection, matcher );
-#endif
-    operationWatcher_.setFuture( operationFuture_ );
+    startSearch( [ this, start_position, selection, matcher ]( const AtomicFlag& interrupt ) {
+        return doSearchBackward( start_position, selection, matcher, interrupt );
+    } );
 }
 
 void QuickFind::searchForward( Selection selection, QuickFindMatcher matcher )
 {
     incrementalSearchStatus_ = IncrementalSearchStatus();
-    interruptRequested_.set();
-    operationWatcher_.waitForFinished();
+    cancelSearch();
+    prepareMatchIndex( matcher );
 
-#if QT_VERSION < QT_VERSION_CHECK( 6, 0, 0 )
-    operationFuture_ = QtConcurrent::run( this, &QuickFind::doSearchForward, selection, matcher );
-#else
-    operationFuture_ = QtConcurrent::run(
-        qOverload<const Selection&, const QuickFindMatcher&>( &QuickFind::doSearchForward ), this,
-        selection, matcher );
-#endif
-    operationWatcher_.setFuture( operationFuture_ );
+    startSearch( [ this, selection, matcher ]( const AtomicFlag& interrupt ) {
+        return doSearchForward( selection.getNextPosition(), selection, matcher, interrupt );
+    } );
 }
 
 void QuickFind::searchBackward( Selection selection, QuickFindMatcher matcher )
 {
     incrementalSearchStatus_ = IncrementalSearchStatus();
-    interruptRequested_.set();
-    operationWatcher_.waitForFinished();
+    cancelSearch();
+    prepareMatchIndex( matcher );
 
-#if QT_VERSION < QT_VERSION_CHECK( 6, 0, 0 )
-    operationFuture_ = QtConcurrent::run( this, &QuickFind::doSearchBackward, selection, matcher );
-#else
-    operationFuture_ = QtConcurrent::run(
-        qOverload<const Selection&, const QuickFindMatcher&>( &QuickFind::doSearchBackward ), this,
-        selection, matcher );
-#endif
-    operationWatcher_.setFuture( operationFuture_ );
-}
-
-Portion QuickFind::doSearchForward( const Selection& selection, const QuickFindMatcher& matcher )
-{
-    return doSearchForward( selection.getNextPosition(), selection, matcher );
+    startSearch( [ this, selection, matcher ]( const AtomicFlag& interrupt ) {
+        return doSearchBackward( selection.getPreviousPosition(), selection, matcher, interrupt );
+    } );
 }
 
 // Internal implementation of forward search,
 // returns the line where the pattern is found or -1 if not found.
 // Parameters are the position the search shall start
 Portion QuickFind::doSearchForward( const FilePosition& start_position, const Selection& selection,
-                                    const QuickFindMatcher& matcher )
+                                    const QuickFindMatcher& matcher,
+                                    const AtomicFlag& interruptRequested )
 {
-    interruptRequested_.clear();
-
     bool found = false;
     int found_start_col{};
     int found_end_col{};
@@ -300,7 +512,7 @@ Portion QuickFind::doSearchForward( const FilePosition& start_position, const Se
 
     // Optimisation: if we are already after the last match,
     // we don't do any search at all.
-    if ( lastMatch_.isLater( start_position ) ) {
+    if ( isAfterLastMatch( start_position ) ) {
         // Send a notification
         sendNotification( QFNotificationReachedEndOfFile() );
 
@@ -319,19 +531,60 @@ Portion QuickFind::doSearchForward( const FilePosition& start_position, const Se
         searchingNotifier_.reset();
         // And then the rest of the file
         const auto nb_lines = logData_.getNbLine();
+        auto chunkSize = FirstSearchChunkLines;
         ++line;
         while ( line < nb_lines ) {
-            if ( matcher.isLineMatching( logData_.getExpandedLineString( line ) ) ) {
+            if ( matchIndex_.isScanned( line ) ) {
+                // Known matches are checked again as the file could have changed
+                const auto nextMatch = matchIndex_.nextMatch( line );
+                if ( !nextMatch ) {
+                    line = matchIndex_.scannedEnd();
+                    continue;
+                }
+
+                line = *nextMatch;
+                if ( line < nb_lines
+                     && matcher.isLineMatching( logData_.getExpandedLineString( line ) ) ) {
+                    matcher.getLastMatch( &found_start_col, &found_end_col );
+                    found = true;
+                    break;
+                }
+
+                ++line;
+                if ( interruptRequested ) {
+                    break;
+                }
+                continue;
+            }
+
+            auto chunkLines = std::min( chunkSize, nb_lines.get() - line.get() );
+            if ( matchIndex_.scannedBegin() > line ) {
+                chunkLines = std::min( chunkLines, matchIndex_.scannedBegin().get() - line.get() );
+            }
+            const auto chunkEnd = line + LinesCount( chunkLines );
+            const auto lines = logData_.getExpandedLines( line, LinesCount( chunkLines ) );
+            const auto matches = findMatchingLines( lines, matcher );
+
+            std::vector<LineNumber> matchingLines;
+            matchingLines.reserve( matches.size() );
+            std::transform( matches.begin(), matches.end(), std::back_inserter( matchingLines ),
+                            [ line ]( size_t index ) { return line + LinesCount( index ); } );
+            matchIndex_.addScanned( matcher.regexp(), line, chunkEnd, matchingLines );
+
+            if ( !matches.empty() ) {
+                line = matchingLines.front();
+                matcher.isLineMatching( lines[ matches.front() ] );
                 matcher.getLastMatch( &found_start_col, &found_end_col );
                 found = true;
                 break;
             }
-            ++line;
+            line = chunkEnd;
+            chunkSize = std::min( 2 * chunkSize, MaxSearchChunkLines );
 
             // See if we need to notify of the ongoing search
             searchingNotifier_.ping( line, nb_lines, false );
 
-            if ( interruptRequested_ ) {
+            if ( interruptRequested ) {
                 break;
             }
         }
@@ -344,9 +597,10 @@ Portion QuickFind::doSearchForward( const FilePosition& start_position, const Se
         return Portion{ line, found_start_col, found_end_col };
     }
     else {
-        if ( !interruptRequested_ ) {
+        if ( !interruptRequested ) {
             // Update the position of the last match
             FilePosition last_match_position = selection.getPreviousPosition();
+            ScopedLock lock( limitsMutex_ );
             lastMatch_.set( last_match_position );
 
             // Send a notification
@@ -361,19 +615,13 @@ Portion QuickFind::doSearchForward( const FilePosition& start_position, const Se
     }
 }
 
-Portion QuickFind::doSearchBackward( const Selection& selection, const QuickFindMatcher& matcher )
-{
-    return doSearchBackward( selection.getPreviousPosition(), selection, matcher );
-}
-
 // Internal implementation of backward search,
 // returns the line where the pattern is found or -1 if not found.
 // Parameters are the position the search shall start
 Portion QuickFind::doSearchBackward( const FilePosition& start_position, const Selection& selection,
-                                     const QuickFindMatcher& matcher )
+                                     const QuickFindMatcher& matcher,
+                                     const AtomicFlag& interruptRequested )
 {
-    interruptRequested_.clear();
-
     bool found = false;
     int start_col{};
     int end_col{};
@@ -383,7 +631,7 @@ Portion QuickFind::doSearchBackward( const FilePosition& start_position, const S
 
     // Optimisation: if we are already before the first match,
     // we don't do any search at all.
-    if ( firstMatch_.isSooner( start_position ) ) {
+    if ( isBeforeFirstMatch( start_position ) ) {
         // Send a notification
         sendNotification( QFNotificationReachedBegininningOfFile() );
 
@@ -403,26 +651,64 @@ Portion QuickFind::doSearchBackward( const FilePosition& start_position, const S
         searchingNotifier_.reset();
         // And then the rest of the file
         const auto nb_lines = logData_.getNbLine();
-        if ( line.get() > 0 ) {
-            --line;
-            while ( true ) {
-                if ( matcher.isLineMatchingBackward( logData_.getExpandedLineString( line ) ) ) {
+        auto chunkSize = FirstSearchChunkLines;
+        auto chunkEnd = std::min( line, LineNumber( nb_lines.get() ) );
+        while ( chunkEnd.get() > 0 ) {
+            if ( matchIndex_.isScanned( chunkEnd - 1_lcount ) ) {
+                // Known matches are checked again as the file could have changed
+                const auto previousMatch = matchIndex_.previousMatch( chunkEnd );
+                if ( !previousMatch ) {
+                    chunkEnd = matchIndex_.scannedBegin();
+                    continue;
+                }
+
+                chunkEnd = *previousMatch;
+                if ( matcher.isLineMatchingBackward(
+                         logData_.getExpandedLineString( *previousMatch ) ) ) {
+                    line = *previousMatch;
                     matcher.getLastMatch( &start_col, &end_col );
                     found = true;
                     break;
                 }
-                if ( line.get() == 0 ) {
+
+                if ( interruptRequested ) {
                     break;
                 }
+                continue;
+            }
 
-                --line;
+            auto chunkLines = std::min( chunkSize, chunkEnd.get() );
+            const auto scannedEnd = matchIndex_.scannedEnd();
+            if ( !matchIndex_.isEmpty() && scannedEnd < chunkEnd ) {
+                chunkLines = std::min( chunkLines, chunkEnd.get() - scannedEnd.get() );
+            }
+            const auto chunkStart = chunkEnd - LinesCount( chunkLines );
+            const auto lines = logData_.getExpandedLines( chunkStart, LinesCount( chunkLines ) );
+            const auto matches = findMatchingLines( lines, matcher );
+
+            std::vector<LineNumber> matchingLines;
+            matchingLines.reserve( matches.size() );
+            std::transform( matches.begin(), matches.end(), std::back_inserter( matchingLines ),
+                            [ chunkStart ]( size_t index ) {
+                                return chunkStart + LinesCount( index );
+                            } );
+            matchIndex_.addScanned( matcher.regexp(), chunkStart, chunkEnd, matchingLines );
+
+            if ( !matches.empty() ) {
+                line = matchingLines.back();
+                matcher.isLineMatchingBackward( lines[ matches.back() ] );
+                matcher.getLastMatch( &start_col, &end_col );
+                found = true;
+                break;
+            }
+            chunkEnd = chunkStart;
+            chunkSize = std::min( 2 * chunkSize, MaxSearchChunkLines );
 
-                // See if we need to notify of the ongoing search
-                searchingNotifier_.ping( line, nb_lines, true );
+            // See if we need to notify of the ongoing search
+            searchingNotifier_.ping( chunkEnd, nb_lines, true );
 
-                if ( interruptRequested_ ) {
-                    break;
-                }
+            if ( interruptRequested ) {
+                break;
             }
         }
     }
@@ -434,9 +720,10 @@ Portion QuickFind::doSearchBackward( const FilePosition& start_position, const S
         return Portion{ line, start_col, end_col };
     }
     else {
-        if ( !interruptRequested_ ) {
+        if ( !interruptRequested ) {
             // Update the position of the first match
             FilePosition first_match_position = selection.getNextPosition();
+            ScopedLock lock( limitsMutex_ );
             firstMatch_.set( first_match_position );
 
             // Send a notification
@@ -453,10 +740,28 @@ Portion QuickFind::doSearchBackward( const FilePosition& start_position, const S
 
 void QuickFind::resetLimits()
 {
+    ScopedLock lock( limitsMutex_ );
     lastMatch_.reset();
     firstMatch_.reset();
 }
 
+void QuickFind::resetMatchIndex()
+{
+    matchIndex_.reset();
+}
+
+bool QuickFind::isAfterLastMatch( const FilePosition& position ) const
+{
+    ScopedLock lock( limitsMutex_ );
+    return lastMatch_.isLater( position );
+}
+
+bool QuickFind::isBeforeFirstMatch( const FilePosition& position ) const
+{
+    ScopedLock lock( limitsMutex_ );
+    return firstMatch_.isSooner( position );
+}
+
 void QuickFind::sendNotification( QFNotification notification )
 {
     dispatchToMainThread( [ this, notification ]() { notify( notification ); } );
@@ -94,6 +94,11 @@ bool QuickFindMatcher::isLineMatchingBackward( const QString& line, int column )
     }
 }
 
+bool QuickFindMatcher::hasMatch( const QString& line ) const
+{
+    return isActive_ && regexp_.match( line ).hasMatch();
+}
+
 void QuickFindMatcher::getLastMatch( int* start_col, int* end_col ) const
 {
     *start_col = lastMatchStart_;
@@ -0,0 +1,140 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "renderedtilecache.h"
+
+#include <algorithm>
+
+void RenderedTileCache::setLayout( const Layout& layout )
+{
+    if ( layout != layout_ ) {
+        tiles_.clear();
+        layout_ = layout;
+    }
+}
+
+const RenderedTileCache::Layout& RenderedTileCache::layout() const
+{
+    return layout_;
+}
+
+LineNumber RenderedTileCache::tileStart( LineNumber line ) const
+{
+    const auto tileLines = std::max( layout_.tileLines.get(), LinesCount::UnderlyingType{ 1 } );
+    return LineNumber( line.get() / tileLines * tileLines );
+}
+
+QPixmap RenderedTileCache::find( LineNumber tileStart ) const
+{
+    const auto tile = tiles_.find( tileStart.get() );
+    return tile != tiles_.end() ? tile->second : QPixmap{};
+}
+
+bool RenderedTileCache::contains( LineNumber tileStart ) const
+{
+    return tiles_.count( tileStart.get() ) > 0;
+}
+
+void RenderedTileCache::insert( LineNumber tileStart, QPixmap tile )
+{
+    tiles_[ tileStart.get() ] = std::move( tile );
+}
+
+void RenderedTileCache::removeLines( LineNumber first, LinesCount count )
+{
+    if ( count.get() == 0 ) {
+        return;
+    }
+
+    const auto firstTile = tileStart( first ).get();
+    const auto lastLine = first.get() + count.get() - 1;
+    tiles_.erase( tiles_.lower_bound( firstTile ), tiles_.upper_bound( lastLine ) );
+}
+
+void RenderedTileCache::clear()
+{
+    tiles_.clear();
+}
+
+void RenderedTileCache::trim( LineNumber viewLine )
+{
+    for ( auto tile = tiles_.begin(); tile != tiles_.end(); ) {
+        if ( isNearView( LineNumber( tile->first ), viewLine ) ) {
+            ++tile;
+        }
+        else {
+            tile = tiles_.erase( tile );
+        }
+    }
+}
+
+std::vector<LineNumber> RenderedTileCache::missingTiles( LineNumber viewLine,
+                                                         LinesCount nbLines ) const
+{
+    std::vector<LineNumber> missing;
+    if ( layout_.tileLines.get() == 0 ) {
+        return missing;
+    }
+
+    const auto tileLines = layout_.tileLines.get();
+    const auto viewTile = tileStart( viewLine ).get();
+    const auto addTile = [ & ]( LineNumber::UnderlyingType start ) {
+        if ( start < nbLines.get() && !tiles_.count( start ) ) {
+            missing.emplace_back( start );
+        }
+    };
+
+    // View shows its own tile and the next one
+    addTile( viewTile );
+    addTile( viewTile + tileLines );
+    for ( auto screen = 1; screen <= screens(); ++screen ) {
+        const auto distance = static_cast<LineNumber::UnderlyingType>( screen ) * tileLines;
+        if ( viewTile >= distance ) {
+            addTile( viewTile - distance );
+        }
+        addTile( viewTile + tileLines + distance );
+    }
+
+    return missing;
+}
+
+size_t RenderedTileCache::size() const
+{
+    return tiles_.size();
+}
+
+int RenderedTileCache::screens() const
+{
+    const auto tileBytes = std::max( qint64{ 1 }, static_cast<qint64>( layout_.size.width() )
+                                                      * layout_.size.height() * 4 );
+    // Two tiles are always kept for the view itself
+    const auto tiles = MaxBytes / tileBytes;
+    return static_cast<int>( std::clamp( ( tiles - 2 ) / 2, qint64{ 0 }, qint64{ MaxScreens } ) );
+}
+
+bool RenderedTileCache::isNearView( LineNumber tileStart, LineNumber viewLine ) const
+{
+    const auto tileLines = layout_.tileLines.get();
+    const auto viewTile = this->tileStart( viewLine ).get();
+    const auto distance = static_cast<LineNumber::UnderlyingType>( screens() ) * tileLines;
+
+    const auto windowStart = viewTile > distance ? viewTile - distance : 0;
+    const auto windowEnd = viewTile + tileLines + distance;
+    return tileStart.get() >= windowStart && tileStart.get() <= windowEnd;
+}
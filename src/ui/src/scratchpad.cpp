@@ -19,6 +19,7 @@
 
 #include "scratchpad.h"
 
+#include <algorithm>
 #include <memory>
 
 #include <QAction>
@@ -26,19 +27,18 @@
 #include <QByteArray>
 #include <QClipboard>
 #include <QDateTime>
-#include <QDomDocument>
 #include <QFormLayout>
 #include <QHBoxLayout>
-#include <QJsonDocument>
 #include <QLineEdit>
 #include <QPlainTextEdit>
 #include <QStatusBar>
 #include <QToolBar>
-#include <QUrl>
 #include <QVBoxLayout>
+#include <QtConcurrent>
 #include <qchar.h>
 
 #include "crc32.h"
+#include "scratchpadtransforms.h"
 
 namespace {
 
@@ -55,6 +55,7 @@ QString formatDec( T value )
 }
 
 constexpr int StatusTimeout = 2000;
+constexpr int TransformProgressInterval = 200;
 
 constexpr qint64 FileTimeTicks = 10000000;
 constexpr qint64 SecondsToEpoch = 11644473600LL;
@@ -107,28 +108,43 @@ ScratchPad::ScratchPad( QWidget* parent )
     connect( formatXmlAction.get(), &QAction::triggered, [ this ]( auto ) { formatXml(); } );
     toolBar->addAction( formatXmlAction.release() );
 
+    toolBar->addSeparator();
+
+    auto stopTransformAction = std::make_unique<QAction>( "Stop" );
+    stopTransformAction->setToolTip( "Stop running transformation" );
+    stopTransformAction->setEnabled( false );
+    connect( stopTransformAction.get(), &QAction::triggered, this, &ScratchPad::stopTransform );
+    stopTransformAction_ = stopTransformAction.get();
+    toolBar->addAction( stopTransformAction.release() );
+
     toolBar->setSizePolicy( QSizePolicy::Expanding, QSizePolicy::Minimum );
 
     auto statusBar = std::make_unique<QStatusBar>();
 
     auto transLayout = std::make_unique<QFormLayout>();
 
-    auto addBoxToLayout
-        = [ &transLayout, this ]( const QString& label, QLineEdit** widget, auto changeFunction ) {
-              auto box = std::make_unique<QLineEdit>();
-              box->setReadOnly( true );
-              *widget = box.get();
-              transLayout->addRow( label, box.release() );
-
+    auto addBoxToLayout = [ &transLayout ]( const QString& label, QLineEdit** widget ) {
+        auto box = std::make_unique<QLineEdit>();
+        box->setReadOnly( true );
+        *widget = box.get();
+        transLayout->addRow( label, box.release() );
+    };
+
+    auto addTransformBoxToLayout
+        = [ &addBoxToLayout, this ]( const QString& label, QLineEdit** widget,
+                                     auto changeFunction ) {
+              addBoxToLayout( label, widget );
               connect( this, &ScratchPad::updateTransformation, this, changeFunction );
           };
 
-    addBoxToLayout( "CRC32 hex", &crc32HexBox_, &ScratchPad::crc32Hex );
-    addBoxToLayout( "CRC32 dec", &crc32DecBox_, &ScratchPad::crc32Dec );
-    addBoxToLayout( "Unix time", &unixTimeBox_, &ScratchPad::unixTime );
-    addBoxToLayout( "File time", &fileTimeBox_, &ScratchPad::fileTime );
-    addBoxToLayout( "Dec->Hex", &decToHexBox_, &ScratchPad::decToHex );
-    addBoxToLayout( "Hex->Dec", &hexToDecBox_, &ScratchPad::hexToDec );
+    // Both checksum boxes are filled by one calculation
+    addBoxToLayout( "CRC32 hex", &crc32HexBox_ );
+    addBoxToLayout( "CRC32 dec", &crc32DecBox_ );
+    connect( this, &ScratchPad::updateTransformation, this, &ScratchPad::crc32 );
+    addTransformBoxToLayout( "Unix time", &unixTimeBox_, &ScratchPad::unixTime );
+    addTransformBoxToLayout( "File time", &fileTimeBox_, &ScratchPad::fileTime );
+    addTransformBoxToLayout( "Dec->Hex", &decToHexBox_, &ScratchPad::decToHex );
+    addTransformBoxToLayout( "Hex->Dec", &hexToDecBox_, &ScratchPad::hexToDec );
 
     auto hLayout = std::make_unique<QHBoxLayout>();
     hLayout->addWidget( textEdit.get(), 3 );
@@ -147,6 +163,22 @@ ScratchPad::ScratchPad( QWidget* parent )
     connect( textEdit_, &QPlainTextEdit::textChanged, this, &ScratchPad::updateTransformation );
     connect( textEdit_, &QPlainTextEdit::selectionChanged, this,
              &ScratchPad::updateTransformation );
+
+    connect( &transformWatcher_, &QFutureWatcher<QString>::finished, this,
+             &ScratchPad::transformFinished );
+    connect( &crc32Watcher_, &QFutureWatcher<quint32>::finished, this,
+             &ScratchPad::crc32Calculated );
+
+    transformProgressTimer_.setInterval( TransformProgressInterval );
+    connect( &transformProgressTimer_, &QTimer::timeout, this,
+             &ScratchPad::showTransformProgress );
+}
+
+ScratchPad::~ScratchPad()
+{
+    stopTransform();
+    transformWatcher_.waitForFinished();
+    crc32Watcher_.waitForFinished();
 }
 
 void ScratchPad::addData( QString newData )
@@ -167,32 +199,82 @@ void ScratchPad::replaceData( QString newData )
     textEdit_->setPlainText( newData );
 }
 
-QString ScratchPad::transformText( const std::function<QString( QString )>& transform )
+QString ScratchPad::selectedText( QTextCursor& cursor ) const
 {
-    auto cursor = textEdit_->textCursor();
+    cursor = textEdit_->textCursor();
     auto text = cursor.selectedText();
     if ( text.isEmpty() ) {
         cursor.select( QTextCursor::Document );
         text = cursor.selectedText();
     }
 
-    return transform( text );
+    return text;
 }
 
-void ScratchPad::transformTextInPlace( const std::function<QString( QString )>& transform )
+QString ScratchPad::transformText( const std::function<QString( QString )>& transform )
 {
-    auto cursor = textEdit_->textCursor();
-    auto text = cursor.selectedText();
-    if ( text.isEmpty() ) {
-        cursor.select( QTextCursor::Document );
-        text = cursor.selectedText();
+    QTextCursor cursor;
+    return transform( selectedText( cursor ) );
+}
+
+void ScratchPad::transformTextInPlace( const TextTransform& transform )
+{
+    if ( transformWatcher_.isRunning() ) {
+        statusBar_->showMessage( "Transformation is already running", StatusTimeout );
+        return;
+    }
+
+    auto text = selectedText( transformCursor_ );
+
+    transformInterrupt_.clear();
+    transformSize_ = 0;
+    transformedBytes_ = 0;
+
+    textEdit_->setReadOnly( true );
+    stopTransformAction_->setEnabled( true );
+    transformProgressTimer_.start();
+
+    transformWatcher_.setFuture(
+        QtConcurrent::run( [ this, transform, text = std::move( text ) ]() mutable {
+            // Selected text has paragraph separators instead of line breaks
+            text.replace( QChar::ParagraphSeparator, QChar::LineFeed );
+            const auto utf8Text = text.toUtf8();
+            text.clear();
+
+            transformSize_ = static_cast<uint64_t>( utf8Text.size() );
+            return QString::fromUtf8(
+                transform( utf8Text, transformInterrupt_, transformedBytes_ ) );
+        } ) );
+}
+
+void ScratchPad::stopTransform()
+{
+    transformInterrupt_.set();
+}
+
+void ScratchPad::showTransformProgress()
+{
+    const auto size = std::max( transformSize_.load(), uint64_t{ 1 } );
+    const auto progress = std::min( transformedBytes_.load() * 100 / size, uint64_t{ 100 } );
+    statusBar_->showMessage( QString( "Transforming... %1%" ).arg( progress ) );
+}
+
+void ScratchPad::transformFinished()
+{
+    transformProgressTimer_.stop();
+    stopTransformAction_->setEnabled( false );
+    textEdit_->setReadOnly( false );
+
+    if ( transformInterrupt_ ) {
+        statusBar_->showMessage( "Transformation stopped", StatusTimeout );
+        return;
     }
 
-    auto transformedText = transform( text );
+    const auto transformedText = transformWatcher_.result();
 
     if ( !transformedText.isEmpty() ) {
-        cursor.insertText( transformedText );
-        textEdit_->setTextCursor( cursor );
+        transformCursor_.insertText( transformedText );
+        textEdit_->setTextCursor( transformCursor_ );
 
         QApplication::clipboard()->setText( transformedText );
 
@@ -205,56 +287,52 @@ void ScratchPad::transformTextInPlace( const std::function<QString( QString )>&
 
 void ScratchPad::decodeUrl()
 {
-    transformTextInPlace(
-        []( QString text ) { return QUrl::fromPercentEncoding( text.toUtf8() ); } );
+    transformTextInPlace( scratchpad::decodeUrl );
 }
 
 void ScratchPad::decodeBase64()
 {
-    transformTextInPlace( []( QString text ) {
-        auto decoded = QByteArray::fromBase64( text.toUtf8() );
-        return QString::fromStdString( { decoded.begin(), decoded.end() } );
-    } );
+    transformTextInPlace( scratchpad::decodeBase64 );
 }
 
 void ScratchPad::encodeBase64()
 {
-    transformTextInPlace( []( QString text ) {
-        auto encoded = text.toUtf8().toBase64();
-        return QString::fromLatin1( encoded );
-    } );
+    transformTextInPlace( scratchpad::encodeBase64 );
 }
 
 void ScratchPad::decodeHex()
 {
-    transformTextInPlace( []( QString text ) {
-        auto decoded = QByteArray::fromHex( text.toUtf8() );
-        return QString::fromStdString( { decoded.begin(), decoded.end() } );
-    } );
+    transformTextInPlace( scratchpad::decodeHex );
 }
 
 void ScratchPad::encodeHex()
 {
-    transformTextInPlace( []( QString text ) {
-        auto encoded = text.toUtf8().toHex();
-        return QString::fromLatin1( encoded );
-    } );
+    transformTextInPlace( scratchpad::encodeHex );
 }
 
-void ScratchPad::crc32Hex()
+void ScratchPad::crc32()
 {
-    crc32HexBox_->setText( transformText( []( QString text ) {
-        const auto decoded = Crc32::calculate( text.toUtf8() );
-        return formatHex( decoded ).prepend( "0x" );
-    } ) );
+    if ( crc32Watcher_.isRunning() ) {
+        isCrc32Outdated_ = true;
+        return;
+    }
+
+    QTextCursor cursor;
+    crc32Watcher_.setFuture( QtConcurrent::run(
+        [ text = selectedText( cursor ) ] { return Crc32::calculate( text.toUtf8() ); } ) );
 }
 
-void ScratchPad::crc32Dec()
+void ScratchPad::crc32Calculated()
 {
-    crc32DecBox_->setText( transformText( []( QString text ) {
-        const auto decoded = Crc32::calculate( text.toUtf8() );
-        return formatDec( decoded );
-    } ) );
+    if ( isCrc32Outdated_ ) {
+        isCrc32Outdated_ = false;
+        crc32();
+        return;
+    }
+
+    const auto checksum = crc32Watcher_.result();
+    crc32HexBox_->setText( formatHex( checksum ).prepend( "0x" ) );
+    crc32DecBox_->setText( formatDec( checksum ) );
 }
 
 void ScratchPad::unixTime()
@@ -321,28 +399,10 @@ void ScratchPad::hexToDec()
 
 void ScratchPad::formatJson()
 {
-    transformTextInPlace( []( QString text ) {
-        const auto start = text.indexOf( '{' );
-
-        QJsonParseError parseError;
-        auto json = QJsonDocument::fromJson( text.mid( start ).toUtf8(), &parseError );
-        if ( json.isNull() ) {
-            json = QJsonDocument::fromJson( text.mid( start, parseError.offset ).toUtf8(),
-                                            &parseError );
-        }
-
-        return json.toJson( QJsonDocument::Indented );
-    } );
+    transformTextInPlace( scratchpad::formatJson );
 }
 
 void ScratchPad::formatXml()
 {
-    transformTextInPlace( []( QString text ) {
-        const auto start = text.indexOf( '<' );
-
-        QDomDocument xml;
-        xml.setContent( text.mid( start ).toUtf8() );
-
-        return xml.toString( 2 );
-    } );
+    transformTextInPlace( scratchpad::formatXml );
 }
@@ -0,0 +1,411 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "scratchpadtransforms.h"
+
+#include <algorithm>
+#include <array>
+
+#include <QXmlStreamReader>
+#include <QXmlStreamWriter>
+
+namespace {
+using Size = decltype( QByteArray{}.size() );
+
+constexpr Size ChunkSize = 1024 * 1024;
+// Encoders take whole groups of input bytes in each chunk
+constexpr Size Base64ChunkSize = ChunkSize / 3 * 3;
+
+constexpr int JsonIndent = 4;
+constexpr int XmlIndent = 2;
+constexpr int XmlTokensPerCheck = 4096;
+
+int hexValue( char c )
+{
+    if ( c >= '0' && c <= '9' ) {
+        return c - '0';
+    }
+    if ( c >= 'a' && c <= 'f' ) {
+        return c - 'a' + 10;
+    }
+    if ( c >= 'A' && c <= 'F' ) {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+int base64Value( char c )
+{
+    if ( c >= 'A' && c <= 'Z' ) {
+        return c - 'A';
+    }
+    if ( c >= 'a' && c <= 'z' ) {
+        return c - 'a' + 26;
+    }
+    if ( c >= '0' && c <= '9' ) {
+        return c - '0' + 52;
+    }
+    if ( c == '+' ) {
+        return 62;
+    }
+    if ( c == '/' ) {
+        return 63;
+    }
+    return -1;
+}
+
+// Passes chunks of text starting at start to transform until
+// it returns false or interruption is requested
+template <typename ChunkTransform>
+void forEachChunk( const QByteArray& text, Size start, Size chunkSize,
+                   const AtomicFlag& interruptRequested, std::atomic<uint64_t>& processedBytes,
+                   ChunkTransform transform )
+{
+    for ( auto begin = start; begin < text.size() && !interruptRequested; begin += chunkSize ) {
+        const auto size = std::min( chunkSize, text.size() - begin );
+        const auto isDone = !transform( text.constData() + begin, size );
+        processedBytes += static_cast<uint64_t>( size );
+        if ( isDone ) {
+            return;
+        }
+    }
+}
+
+// Writes json tokens one character at a time, values of objects
+// and arrays are put on their own lines. Empty ones stay on one line.
+class JsonPrinter {
+  public:
+    explicit JsonPrinter( QByteArray& json )
+        : json_( json )
+    {
+    }
+
+    // Returns false after the end of the outermost object or array
+    bool write( char c )
+    {
+        if ( isInString_ ) {
+            json_.append( c );
+            if ( isEscaped_ ) {
+                isEscaped_ = false;
+            }
+            else if ( c == '\\' ) {
+                isEscaped_ = true;
+            }
+            else if ( c == '"' ) {
+                isInString_ = false;
+            }
+            return true;
+        }
+
+        switch ( c ) {
+        case ' ':
+        case '\t':
+        case '\r':
+        case '\n':
+            break;
+        case '{':
+        case '[':
+            startValue();
+            json_.append( c );
+            ++depth_;
+            isContainerOpened_ = true;
+            break;
+        case '}':
+        case ']':
+            --depth_;
+            if ( isContainerOpened_ ) {
+                isContainerOpened_ = false;
+            }
+            else {
+                newLine();
+            }
+            json_.append( c );
+            return depth_ > 0;
+        case ',':
+            json_.append( c );
+            newLine();
+            break;
+        case ':':
+            json_.append( ": " );
+            break;
+        case '"':
+            startValue();
+            json_.append( c );
+            isInString_ = true;
+            break;
+        default:
+            startValue();
+            json_.append( c );
+            break;
+        }
+
+        return true;
+    }
+
+  private:
+    void startValue()
+    {
+        if ( isContainerOpened_ ) {
+            isContainerOpened_ = false;
+            newLine();
+        }
+    }
+
+    void newLine()
+    {
+        json_.append( '\n' );
+        json_.append( depth_ * JsonIndent, ' ' );
+    }
+
+  private:
+    QByteArray& json_;
+    int depth_ = 0;
+    bool isContainerOpened_ = false;
+    bool isInString_ = false;
+    bool isEscaped_ = false;
+};
+
+// Keeps a started percent sequence between chunks
+class PercentDecoder {
+  public:
+    explicit PercentDecoder( QByteArray& decoded )
+        : decoded_( decoded )
+    {
+    }
+
+    void write( char c )
+    {
+        if ( pendingSize_ > 0 ) {
+            const auto value = hexValue( c );
+            if ( value >= 0 && pendingSize_ == 1 ) {
+                pending_[ pendingSize_++ ] = c;
+                return;
+            }
+            if ( value >= 0 ) {
+                decoded_.append( static_cast<char>( hexValue( pending_[ 1 ] ) << 4 | value ) );
+                pendingSize_ = 0;
+                return;
+            }
+
+            // Not an escape sequence, it is kept as is
+            finish();
+        }
+
+        if ( c == '%' ) {
+            pending_[ pendingSize_++ ] = c;
+        }
+        else {
+            decoded_.append( c );
+        }
+    }
+
+    void finish()
+    {
+        decoded_.append( pending_.data(), static_cast<Size>( pendingSize_ ) );
+        pendingSize_ = 0;
+    }
+
+  private:
+    QByteArray& decoded_;
+    std::array<char, 2> pending_{};
+    size_t pendingSize_ = 0;
+};
+} // namespace
+
+namespace scratchpad {
+
+QByteArray formatJson( const QByteArray& text, const AtomicFlag& interruptRequested,
+                       std::atomic<uint64_t>& processedBytes )
+{
+    const auto start = std::find_if( text.cbegin(), text.cend(),
+                                     []( char c ) { return c == '{' || c == '['; } )
+                       - text.cbegin();
+    processedBytes += static_cast<uint64_t>( start );
+
+    QByteArray json;
+    json.reserve( text.size() - static_cast<Size>( start ) );
+
+    JsonPrinter printer( json );
+    forEachChunk( text, static_cast<Size>( start ), ChunkSize, interruptRequested, processedBytes,
+                  [ &printer ]( const char* chunk, Size size ) {
+                      for ( Size i = 0; i < size; ++i ) {
+                          if ( !printer.write( chunk[ i ] ) ) {
+                              return false;
+                          }
+                      }
+                      return true;
+                  } );
+
+    if ( !json.isEmpty() ) {
+        json.append( '\n' );
+    }
+    return json;
+}
+
+QByteArray formatXml( const QByteArray& text, const AtomicFlag& interruptRequested,
+                      std::atomic<uint64_t>& processedBytes )
+{
+    const auto start = text.indexOf( '<' );
+    if ( start < 0 ) {
+        return {};
+    }
+
+    QXmlStreamReader reader(
+        QByteArray::fromRawData( text.constData() + start, text.size() - start ) );
+
+    QByteArray xml;
+    QXmlStreamWriter writer( &xml );
+    writer.setAutoFormatting( true );
+    writer.setAutoFormattingIndent( XmlIndent );
+
+    auto tokens = 0;
+    while ( !reader.atEnd() ) {
+        reader.readNext();
+        if ( reader.hasError() ) {
+            break;
+        }
+
+        // Whitespace between elements is replaced by indentation, xml
+        // declaration is written only if the text had it
+        const auto isSkipped
+            = reader.isWhitespace()
+              || ( reader.isStartDocument() && reader.documentVersion().isEmpty() );
+        if ( !isSkipped ) {
+            writer.writeCurrentToken( reader );
+        }
+
+        if ( ++tokens % XmlTokensPerCheck == 0 ) {
+            processedBytes = static_cast<uint64_t>( start + reader.characterOffset() );
+            if ( interruptRequested ) {
+                break;
+            }
+        }
+    }
+
+    return xml;
+}
+
+QByteArray decodeBase64( const QByteArray& text, const AtomicFlag& interruptRequested,
+                         std::atomic<uint64_t>& processedBytes )
+{
+    QByteArray decoded;
+    decoded.reserve( text.size() / 4 * 3 + 3 );
+
+    uint32_t bits = 0;
+    auto bitsCount = 0;
+    forEachChunk( text, 0, ChunkSize, interruptRequested, processedBytes,
+                  [ & ]( const char* chunk, Size size ) {
+                      for ( Size i = 0; i < size; ++i ) {
+                          const auto value = base64Value( chunk[ i ] );
+                          if ( value < 0 ) {
+                              continue;
+                          }
+
+                          bits = ( bits << 6 ) | static_cast<uint32_t>( value );
+                          bitsCount += 6;
+                          if ( bitsCount >= 8 ) {
+                              bitsCount -= 8;
+                              decoded.append( static_cast<char>( ( bits >> bitsCount ) & 0xff ) );
+                          }
+                      }
+                      return true;
+                  } );
+
+    return decoded;
+}
+
+QByteArray encodeBase64( const QByteArray& text, const AtomicFlag& interruptRequested,
+                         std::atomic<uint64_t>& processedBytes )
+{
+    QByteArray encoded;
+    encoded.reserve( ( text.size() + 2 ) / 3 * 4 );
+
+    forEachChunk( text, 0, Base64ChunkSize, interruptRequested, processedBytes,
+                  [ &encoded ]( const char* chunk, Size size ) {
+                      encoded.append( QByteArray::fromRawData( chunk, size ).toBase64() );
+                      return true;
+                  } );
+
+    return encoded;
+}
+
+QByteArray decodeHex( const QByteArray& text, const AtomicFlag& interruptRequested,
+                      std::atomic<uint64_t>& processedBytes )
+{
+    QByteArray decoded;
+    decoded.reserve( text.size() / 2 );
+
+    auto high = -1;
+    forEachChunk( text, 0, ChunkSize, interruptRequested, processedBytes,
+                  [ & ]( const char* chunk, Size size ) {
+                      for ( Size i = 0; i < size; ++i ) {
+                          const auto value = hexValue( chunk[ i ] );
+                          if ( value < 0 ) {
+                              continue;
+                          }
+
+                          if ( high < 0 ) {
+                              high = value;
+                          }
+                          else {
+                              decoded.append( static_cast<char>( high << 4 | value ) );
+                              high = -1;
+                          }
+                      }
+                      return true;
+                  } );
+
+    return decoded;
+}
+
+QByteArray encodeHex( const QByteArray& text, const AtomicFlag& interruptRequested,
+                      std::atomic<uint64_t>& processedBytes )
+{
+    QByteArray encoded;
+    encoded.reserve( text.size() * 2 );
+
+    forEachChunk( text, 0, ChunkSize, interruptRequested, processedBytes,
+                  [ &encoded ]( const char* chunk, Size size ) {
+                      encoded.append( QByteArray::fromRawData( chunk, size ).toHex() );
+                      return true;
+                  } );
+
+    return encoded;
+}
+
+QByteArray decodeUrl( const QByteArray& text, const AtomicFlag& interruptRequested,
+                      std::atomic<uint64_t>& processedBytes )
+{
+    QByteArray decoded;
+    decoded.reserve( text.size() );
+
+    PercentDecoder decoder( decoded );
+    forEachChunk( text, 0, ChunkSize, interruptRequested, processedBytes,
+                  [ &decoder ]( const char* chunk, Size size ) {
+                      for ( Size i = 0; i < size; ++i ) {
+                          decoder.write( chunk[ i ] );
+                      }
+                      return true;
+                  } );
+    decoder.finish();
+
+    return decoded;
+}
+
+} // namespace scratchpad
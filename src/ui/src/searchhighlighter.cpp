@@ -0,0 +1,47 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "searchhighlighter.h"
+
+SearchHighlighter::SearchHighlighter( const RegularExpressionPattern& pattern, bool variateColors,
+                                      const QColor& backColor )
+    : matcher_( { RegularExpressionPattern( pattern.pattern, pattern.isCaseSensitive, false,
+                                            false, pattern.isPlainText ) },
+                { 0 } )
+{
+    highlighter_.setHighlightOnlyMatch( true );
+    highlighter_.setVariateColors( variateColors );
+    highlighter_.setPattern( pattern.pattern );
+    highlighter_.setIgnoreCase( !pattern.isCaseSensitive );
+    highlighter_.setUseRegex( !pattern.isPlainText );
+
+    highlighter_.setBackColor( backColor );
+    highlighter_.setForeColor( Qt::black );
+}
+
+bool SearchHighlighter::canHighlight( const RegularExpressionPattern& pattern )
+{
+    return !pattern.isBoolean && !pattern.isExclude && !pattern.pattern.isEmpty();
+}
+
+bool SearchHighlighter::matchLine( const QString& line,
+                                   std::vector<HighlightedMatch>& matches ) const
+{
+    return highlighter_.matchLine( line, matcher_, 0, matches );
+}
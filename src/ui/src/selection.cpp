@@ -148,6 +148,21 @@ std::vector<LineNumber> Selection::getLines() const
     return selection;
 }
 
+std::optional<std::pair<LineNumber, LinesCount>> Selection::getLineRange() const
+{
+    if ( selectedLine_.has_value() ) {
+        return std::make_pair( *selectedLine_, 1_lcount );
+    }
+    else if ( selectedPartial_.line.has_value() ) {
+        return {};
+    }
+    else if ( selectedRange_.startLine.has_value() ) {
+        return std::make_pair( *selectedRange_.startLine, selectedRange_.size() );
+    }
+
+    return {};
+}
+
 // The tab behaviour is a bit odd at the moment, full lines are not expanded
 // but partials (part of line) are, they probably should not ideally.
 QString Selection::getSelectedText( const AbstractLogData* logData ) const
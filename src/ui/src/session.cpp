@@ -26,6 +26,7 @@
 #include <cassert>
 #include <cstdint>
 
+#include "configuration.h"
 #include "logdata.h"
 #include "logfiltereddata.h"
 #include "savedsearches.h"
@@ -69,6 +70,98 @@ ViewInterface* Session::open( const QString& file_name,
 void Session::close( const ViewInterface* view )
 {
     openFiles_.erase( openFiles_.find( view ) );
+
+    for ( auto shared = sharedLogData_.begin(); shared != sharedLogData_.end(); ) {
+        if ( shared->second.logData.expired() ) {
+            shared = sharedLogData_.erase( shared );
+        }
+        else {
+            ++shared;
+        }
+    }
+
+    deferredViews_.erase( std::remove( deferredViews_.begin(), deferredViews_.end(), view ),
+                          deferredViews_.end() );
+    if ( backgroundLoads_.erase( view ) > 0 ) {
+        loadDeferredInBackground();
+    }
+}
+
+void Session::loadDeferred( const ViewInterface* view )
+{
+    OpenFile* file = findOpenFileFromView( view );
+    if ( file->isLoaded ) {
+        return;
+    }
+
+    LOG_INFO << "Loading restored file " << file->fileName;
+
+    deferredViews_.erase( std::remove( deferredViews_.begin(), deferredViews_.end(), view ),
+                          deferredViews_.end() );
+    file->isLoaded = true;
+    file->logData->attachFile( file->fileName );
+    shareLogData( file->fileName, file->logData );
+}
+
+void Session::loadDeferredInBackground()
+{
+    const auto maxLoaders
+        = static_cast<size_t>( std::max( 0, Configuration::get().sessionBackgroundLoaders() ) );
+
+    while ( backgroundLoads_.size() < maxLoaders && !deferredViews_.empty() ) {
+        const auto* view = deferredViews_.front();
+        const OpenFile* file = findOpenFileFromView( view );
+
+        // Only the first loading of the file is waited for
+        auto connection = std::make_shared<QMetaObject::Connection>();
+        *connection = QObject::connect(
+            file->logData.get(), &LogData::loadingFinished, file->logData.get(),
+            [ session = weak_from_this(), view, connection ]( LoadingStatus ) {
+                QObject::disconnect( *connection );
+                if ( auto appSession = session.lock() ) {
+                    appSession->backgroundLoadingFinished( view );
+                }
+            } );
+
+        backgroundLoads_.insert( view );
+        loadDeferred( view );
+    }
+}
+
+void Session::backgroundLoadingFinished( const ViewInterface* view )
+{
+    if ( backgroundLoads_.erase( view ) > 0 ) {
+        loadDeferredInBackground();
+    }
+}
+
+std::shared_ptr<LogData> Session::findSharedLogData( const QString& file_name ) const
+{
+    const auto canonicalPath = QFileInfo( file_name ).canonicalFilePath();
+    if ( canonicalPath.isEmpty() ) {
+        return {};
+    }
+
+    const auto shared = sharedLogData_.find( canonicalPath );
+    if ( shared == sharedLogData_.end()
+         || shared->second.fileId != FileId::getFileId( canonicalPath ) ) {
+        return {};
+    }
+
+    auto log_data = shared->second.logData.lock();
+    if ( log_data ) {
+        LOG_INFO << "Sharing data of " << canonicalPath << " opened in another view";
+    }
+    return log_data;
+}
+
+void Session::shareLogData( const QString& file_name, const std::shared_ptr<LogData>& log_data )
+{
+    // Files that do not exist yet can be created with other ids
+    const auto canonicalPath = QFileInfo( file_name ).canonicalFilePath();
+    if ( !canonicalPath.isEmpty() ) {
+        sharedLogData_[ canonicalPath ] = { FileId::getFileId( canonicalPath ), log_data };
+    }
 }
 
 QString Session::getFilename( const ViewInterface* view ) const
@@ -87,6 +180,13 @@ void Session::getFileInfo( const ViewInterface* view, uint64_t* fileSize, uint64
 
     assert( file );
 
+    if ( !file->isLoaded ) {
+        *fileSize = file->cachedFileSize;
+        *fileNbLine = file->cachedNbLines;
+        *lastModified = QFileInfo( file->fileName ).lastModified();
+        return;
+    }
+
     *fileSize = static_cast<uint64_t>( file->logData->getFileSize() );
     *fileNbLine = file->logData->getNbLine().get();
     *lastModified = file->logData->getLastModifiedDate();
@@ -96,8 +196,12 @@ ViewInterface* Session::openAlways( const QString& file_name,
                                     const std::function<ViewInterface*()>& view_factory,
                                     const QString& view_context )
 {
-    // Create the data objects
-    auto log_data = std::make_shared<LogData>();
+    // Create the data objects, file open in another view is not indexed again
+    auto log_data = findSharedLogData( file_name );
+    const auto isShared = log_data != nullptr;
+    if ( !isShared ) {
+        log_data = std::make_shared<LogData>();
+    }
     auto log_filtered_data = std::shared_ptr<LogFilteredData>( log_data->getNewFilteredData() );
 
     ViewInterface* view = view_factory();
@@ -112,7 +216,44 @@ ViewInterface* Session::openAlways( const QString& file_name,
     openFiles_.insert( { view, { file_name, log_data, log_filtered_data, view } } );
 
     // Start loading the file
-    log_data->attachFile( file_name );
+    if ( !isShared ) {
+        log_data->attachFile( file_name );
+        shareLogData( file_name, log_data );
+    }
+
+    return view;
+}
+
+ViewInterface* Session::openDeferred( const QString& file_name,
+                                      const std::function<ViewInterface*()>& view_factory,
+                                      const QString& view_context, uint64_t file_size,
+                                      uint64_t nb_lines )
+{
+    // File already attached for another view does not have to wait
+    auto log_data = findSharedLogData( file_name );
+    const auto isShared = log_data != nullptr;
+    if ( !isShared ) {
+        log_data = std::make_shared<LogData>();
+    }
+    auto log_filtered_data = std::shared_ptr<LogFilteredData>( log_data->getNewFilteredData() );
+
+    ViewInterface* view = view_factory();
+    view->setData( log_data, log_filtered_data );
+    view->setQuickFindPattern( quickFindPattern_ );
+    view->setSavedSearches( savedSearches_ );
+
+    if ( !view_context.isEmpty() )
+        view->setViewContext( view_context );
+
+    OpenFile file{ file_name, log_data, log_filtered_data, view };
+    file.isLoaded = isShared;
+    file.cachedFileSize = file_size;
+    file.cachedNbLines = nb_lines;
+    openFiles_.insert( { view, std::move( file ) } );
+
+    if ( !isShared ) {
+        deferredViews_.push_back( view );
+    }
 
     return view;
 }
@@ -173,7 +314,12 @@ void WindowSession::save(
         assert( file );
 
         LOG_DEBUG << "Saving " << file->fileName.toLocal8Bit().data() << " in session.";
-        session_files.emplace_back( file->fileName, top_line, view_context->toString() );
+        auto& session_file
+            = session_files.emplace_back( file->fileName, top_line, view_context->toString() );
+
+        QDateTime lastModified;
+        appSession_->getFileInfo( view_object, &session_file.fileSize, &session_file.nbLines,
+                                  &lastModified );
     }
 
     auto& session = SessionInfo::getSynced();
@@ -194,8 +340,9 @@ WindowSession::restore( const std::function<ViewInterface*()>& view_factory,
 
     for ( auto file : session_files ) {
         LOG_DEBUG << "Create view for " << file.fileName;
-        ViewInterface* view
-            = appSession_->openAlways( file.fileName, view_factory, file.viewContext );
+        ViewInterface* view = appSession_->openDeferred( file.fileName, view_factory,
+                                                          file.viewContext, file.fileSize,
+                                                          file.nbLines );
         result.emplace_back( file.fileName, view );
         openedFiles_.emplace_back( file.fileName );
     }
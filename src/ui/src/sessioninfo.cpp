@@ -51,7 +51,10 @@ void SessionInfo::retrieveFromStorage( QSettings& settings )
                         QString file_name = settings.value( "fileName" ).toString();
                         uint64_t top_line = settings.value( "topLine" ).toULongLong();
                         QString view_context = settings.value( "viewContext" ).toString();
-                        window.openFiles.emplace_back( file_name, top_line, view_context );
+                        auto& openFile
+                            = window.openFiles.emplace_back( file_name, top_line, view_context );
+                        openFile.fileSize = settings.value( "fileSize" ).toULongLong();
+                        openFile.nbLines = settings.value( "nbLines" ).toULongLong();
                     }
                     settings.endArray();
                 }
@@ -99,6 +102,8 @@ void SessionInfo::saveToStorage( QSettings& settings ) const
             settings.setValue( "fileName", open_file->fileName );
             settings.setValue( "topLine", qint64( open_file->topLine ) );
             settings.setValue( "viewContext", open_file->viewContext );
+            settings.setValue( "fileSize", qint64( open_file->fileSize ) );
+            settings.setValue( "nbLines", qint64( open_file->nbLines ) );
         }
         settings.endArray();
         settings.endGroup(); // OpenFiles
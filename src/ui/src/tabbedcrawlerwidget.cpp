@@ -21,6 +21,7 @@
 
 #include <QApplication>
 #include <QClipboard>
+#include <QColor>
 #include <QDir>
 #include <QFileInfo>
 #include <QInputDialog>
@@ -228,10 +229,13 @@ void TabbedCrawlerWidget::showContextMenu( const QPoint& point )
         }
 
         connect( copyFullPath, &QAction::triggered,
-                 [ this, tab ] { QApplication::clipboard()->setText( tabToolTip( tab ) ); } );
+                 [ this, tab ] {
+                     QApplication::clipboard()->setText(
+                         QDir::toNativeSeparators( tabPathAt( tab ) ) );
+                 } );
 
         connect( openContainingFolder, &QAction::triggered,
-                 [ this, tab ] { showPathInFileExplorer( tabToolTip( tab ) ); } );
+                 [ this, tab ] { showPathInFileExplorer( tabPathAt( tab ) ); } );
 
         connect( renameTab, &QAction::triggered, [ this, tab ] {
             bool isNameEntered = false;
@@ -331,3 +335,20 @@ void TabbedCrawlerWidget::setTabDataStatus( int index, DataStatus status )
 
     updateIcon( index );
 }
+
+void TabbedCrawlerWidget::setTabWatchMatches( int index, uint64_t unseenMatches,
+                                              const QString& counters )
+{
+    const auto tabPath = QDir::toNativeSeparators( tabPathAt( index ) );
+    if ( unseenMatches == 0 ) {
+        myTabBar_.setTabTextColor( index, QColor{} );
+        myTabBar_.setTabToolTip( index, tabPath );
+        return;
+    }
+
+    myTabBar_.setTabTextColor( index, Qt::red );
+    myTabBar_.setTabToolTip( index, QString( "%1\n\n%2 new watch matches\n%3" )
+                                        .arg( tabPath )
+                                        .arg( unseenMatches )
+                                        .arg( counters ) );
+}
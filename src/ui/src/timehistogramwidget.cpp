@@ -0,0 +1,159 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "timehistogramwidget.h"
+
+#include <algorithm>
+#include <utility>
+
+#include <QDateTime>
+#include <QMouseEvent>
+#include <QPainter>
+#include <QToolTip>
+
+namespace {
+constexpr int Margin = 4;
+
+QString formatTime( qint64 timestamp )
+{
+    // Timestamps are the time written in lines taken as UTC
+    return QDateTime::fromMSecsSinceEpoch( timestamp, Qt::UTC )
+        .toString( "yyyy-MM-dd HH:mm:ss.zzz" );
+}
+} // namespace
+
+TimeHistogramWidget::TimeHistogramWidget( QWidget* parent )
+    : QWidget( parent )
+{
+    setBackgroundRole( QPalette::Base );
+    setAutoFillBackground( true );
+    setMouseTracking( true );
+}
+
+void TimeHistogramWidget::setBuckets( const TimeBuckets& buckets )
+{
+    buckets_ = buckets;
+    matches_.clear();
+    marks_.clear();
+    update();
+}
+
+void TimeHistogramWidget::setCounts( std::vector<uint64_t> matches, std::vector<uint64_t> marks )
+{
+    matches_ = std::move( matches );
+    marks_ = std::move( marks );
+    update();
+}
+
+QSize TimeHistogramWidget::sizeHint() const
+{
+    return { 600, 200 };
+}
+
+QRect TimeHistogramWidget::barsRect() const
+{
+    return rect().adjusted( Margin, Margin, -Margin, -Margin - fontMetrics().height() );
+}
+
+std::optional<size_t> TimeHistogramWidget::bucketAt( int x ) const
+{
+    const auto bars = barsRect();
+    if ( matches_.empty() || x < bars.left() || x > bars.right() || bars.width() <= 0 ) {
+        return {};
+    }
+
+    const auto bucket = static_cast<size_t>( x - bars.left() ) * matches_.size()
+                        / static_cast<size_t>( bars.width() );
+    return std::min( bucket, matches_.size() - 1 );
+}
+
+void TimeHistogramWidget::paintEvent( QPaintEvent* )
+{
+    static const QColor MatchColor( "red" );
+    static const QColor MarkColor( "dodgerblue" );
+
+    QPainter painter( this );
+    const auto bars = barsRect();
+
+    if ( matches_.empty() || bars.width() <= 0 || bars.height() <= 0 ) {
+        return;
+    }
+
+    const auto maxCount = std::max(
+        { uint64_t{ 1 }, *std::max_element( matches_.begin(), matches_.end() ),
+          marks_.empty() ? 0 : *std::max_element( marks_.begin(), marks_.end() ) } );
+
+    const auto barHeight = [ &bars, maxCount ]( uint64_t count ) {
+        return static_cast<int>( static_cast<double>( count ) * bars.height() / maxCount );
+    };
+
+    const auto buckets = static_cast<int>( matches_.size() );
+    for ( auto bucket = 0; bucket < buckets; ++bucket ) {
+        const auto left = bars.left() + bucket * bars.width() / buckets;
+        const auto right = bars.left() + ( bucket + 1 ) * bars.width() / buckets;
+        const auto width = std::max( 1, right - left - 1 );
+
+        const auto matchesHeight = barHeight( matches_[ static_cast<size_t>( bucket ) ] );
+        painter.fillRect( left, bars.bottom() - matchesHeight, width, matchesHeight, MatchColor );
+
+        // Marks are drawn over matches as a narrower bar
+        if ( static_cast<size_t>( bucket ) < marks_.size() ) {
+            const auto marksHeight = barHeight( marks_[ static_cast<size_t>( bucket ) ] );
+            painter.fillRect( left + width / 4, bars.bottom() - marksHeight,
+                              std::max( 1, width / 2 ), marksHeight, MarkColor );
+        }
+    }
+
+    painter.setPen( palette().color( QPalette::Text ) );
+    painter.drawLine( bars.bottomLeft(), bars.bottomRight() );
+
+    const auto labelsTop = bars.bottom() + 1;
+    const auto labelsRect = QRect( bars.left(), labelsTop, bars.width(), height() - labelsTop );
+    painter.drawText( labelsRect, Qt::AlignLeft | Qt::AlignVCenter,
+                      formatTime( buckets_.begin ) );
+    painter.drawText( labelsRect, Qt::AlignRight | Qt::AlignVCenter,
+                      formatTime( buckets_.begin + buckets * buckets_.duration ) );
+}
+
+void TimeHistogramWidget::mousePressEvent( QMouseEvent* mouseEvent )
+{
+    const auto bucket = bucketAt( mouseEvent->x() );
+    if ( mouseEvent->button() == Qt::LeftButton && bucket
+         && *bucket < buckets_.boundaries.size() ) {
+        Q_EMIT lineClicked( buckets_.boundaries[ *bucket ] );
+    }
+}
+
+void TimeHistogramWidget::mouseMoveEvent( QMouseEvent* mouseEvent )
+{
+    const auto bucket = bucketAt( mouseEvent->x() );
+    if ( !bucket ) {
+        QToolTip::hideText();
+        return;
+    }
+
+    const auto bucketBegin = buckets_.begin + static_cast<qint64>( *bucket ) * buckets_.duration;
+    QToolTip::showText( mouseEvent->globalPos(),
+                        tr( "%1 - %2\n%3 matches, %4 marks" )
+                            .arg( formatTime( bucketBegin ),
+                                  formatTime( bucketBegin + buckets_.duration ) )
+                            .arg( matches_[ *bucket ] )
+                            .arg( *bucket < marks_.size() ? marks_[ *bucket ] : 0 ),
+                        this );
+}
@@ -0,0 +1,253 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "wrapindex.h"
+
+#include <algorithm>
+
+namespace {
+uint64_t rowsOfLength( LineLength::UnderlyingType length, int columns )
+{
+    return length <= columns ? 1 : static_cast<uint64_t>( ( length + columns - 1 ) / columns );
+}
+} // namespace
+
+size_t WrapIndex::nbBlocks() const
+{
+    return static_cast<size_t>( ( nbLines_.get() + BlockLines - 1 ) / BlockLines );
+}
+
+LinesCount::UnderlyingType WrapIndex::blockSize( size_t block ) const
+{
+    return std::min( BlockLines, nbLines_.get() - block * BlockLines );
+}
+
+void WrapIndex::reset( LinesCount nbLines, int columns )
+{
+    nbLines_ = nbLines;
+    columns_ = std::max( columns, 1 );
+    wrappedLines_.clear();
+
+    blockRows_.resize( nbBlocks() );
+    for ( auto block = 0u; block < blockRows_.size(); ++block ) {
+        blockRows_[ block ] = blockSize( block );
+    }
+    buildTree();
+}
+
+void WrapIndex::resize( LinesCount nbLines )
+{
+    if ( nbLines == nbLines_ ) {
+        return;
+    }
+
+    // The last block of old lines may get new lines or lose some,
+    // it is measured again
+    const auto firstChangedBlock
+        = static_cast<size_t>( std::min( nbLines.get(), nbLines_.get() ) / BlockLines );
+    nbLines_ = nbLines;
+
+    for ( auto block = wrappedLines_.begin(); block != wrappedLines_.end(); ) {
+        if ( block->first >= firstChangedBlock ) {
+            block = wrappedLines_.erase( block );
+        }
+        else {
+            ++block;
+        }
+    }
+
+    blockRows_.resize( nbBlocks() );
+    for ( auto block = firstChangedBlock; block < blockRows_.size(); ++block ) {
+        blockRows_[ block ] = blockSize( block );
+    }
+    buildTree();
+}
+
+void WrapIndex::buildTree()
+{
+    // Each node is added to its parent once, so the tree is built in linear time
+    const auto size = blockRows_.size();
+    tree_.assign( size + 1, 0 );
+    for ( auto block = 0u; block < size; ++block ) {
+        tree_[ block + 1 ] += blockRows_[ block ];
+        const auto parent = ( block + 1 ) + ( ( block + 1 ) & ( ~( block + 1 ) + 1 ) );
+        if ( parent <= size ) {
+            tree_[ parent ] += tree_[ block + 1 ];
+        }
+    }
+}
+
+void WrapIndex::addRows( size_t block, int64_t rows )
+{
+    blockRows_[ block ] += static_cast<uint64_t>( rows );
+    for ( auto node = block + 1; node < tree_.size(); node += node & ( ~node + 1 ) ) {
+        tree_[ node ] += static_cast<uint64_t>( rows );
+    }
+}
+
+uint64_t WrapIndex::rowsBefore( size_t block ) const
+{
+    uint64_t rows = 0;
+    for ( auto node = block; node > 0; node -= node & ( ~node + 1 ) ) {
+        rows += tree_[ node ];
+    }
+    return rows;
+}
+
+uint64_t WrapIndex::nbRows() const
+{
+    return rowsBefore( blockRows_.size() );
+}
+
+bool WrapIndex::measure( LineNumber first, LinesCount count, const LineLengthGetter& lineLength )
+{
+    if ( first >= nbLines_ ) {
+        return false;
+    }
+
+    const auto last = std::min( first.get() + std::max( count.get(), LinesCount::UnderlyingType{ 1 } ),
+                                nbLines_.get() );
+    const auto firstBlock = static_cast<size_t>( first.get() / BlockLines );
+    const auto lastBlock = static_cast<size_t>( ( last - 1 ) / BlockLines );
+
+    bool isMeasured = false;
+    for ( auto block = firstBlock; block <= lastBlock; ++block ) {
+        if ( wrappedLines_.count( block ) > 0 ) {
+            continue;
+        }
+
+        WrappedLines wrappedLines;
+        uint64_t rows = 0;
+        for ( auto offset = 0u; offset < blockSize( block ); ++offset ) {
+            const auto line = LineNumber( block * BlockLines + offset );
+            const auto lineRows = rowsOfLength( lineLength( line ).get(), columns_ );
+            rows += lineRows;
+            if ( lineRows > 1 ) {
+                wrappedLines.emplace_back( offset, static_cast<uint32_t>( lineRows ) );
+            }
+        }
+
+        wrappedLines_.emplace( block, std::move( wrappedLines ) );
+        addRows( block, static_cast<int64_t>( rows ) - static_cast<int64_t>( blockRows_[ block ] ) );
+        isMeasured = true;
+    }
+
+    return isMeasured;
+}
+
+std::optional<LineNumber> WrapIndex::unmeasuredLineNear( LineNumber line ) const
+{
+    const auto blocks = nbBlocks();
+    if ( wrappedLines_.size() >= blocks ) {
+        return {};
+    }
+
+    const auto lineBlock = std::min( static_cast<size_t>( line.get() / BlockLines ), blocks - 1 );
+    for ( size_t distance = 0; distance < blocks; ++distance ) {
+        for ( const auto block : { lineBlock + distance, lineBlock - distance } ) {
+            if ( block < blocks && wrappedLines_.count( block ) == 0 ) {
+                return LineNumber( block * BlockLines );
+            }
+        }
+    }
+
+    return {};
+}
+
+int WrapIndex::lineRows( LineNumber line ) const
+{
+    const auto block = wrappedLines_.find( static_cast<size_t>( line.get() / BlockLines ) );
+    if ( block == wrappedLines_.end() ) {
+        return 1;
+    }
+
+    const auto offset = static_cast<uint32_t>( line.get() % BlockLines );
+    const auto wrappedLine
+        = std::lower_bound( block->second.begin(), block->second.end(), offset,
+                            []( const auto& wrapped, uint32_t o ) { return wrapped.first < o; } );
+    return wrappedLine != block->second.end() && wrappedLine->first == offset
+               ? static_cast<int>( wrappedLine->second )
+               : 1;
+}
+
+uint64_t WrapIndex::firstRow( LineNumber line ) const
+{
+    const auto blockIndex = static_cast<size_t>( line.get() / BlockLines );
+    const auto offset = static_cast<uint32_t>( line.get() % BlockLines );
+
+    auto row = rowsBefore( std::min( blockIndex, blockRows_.size() ) ) + offset;
+
+    const auto block = wrappedLines_.find( blockIndex );
+    if ( block != wrappedLines_.end() ) {
+        for ( const auto& [ wrappedOffset, rows ] : block->second ) {
+            if ( wrappedOffset >= offset ) {
+                break;
+            }
+            row += rows - 1;
+        }
+    }
+
+    return row;
+}
+
+std::pair<LineNumber, int> WrapIndex::lineAtRow( uint64_t row ) const
+{
+    const auto totalRows = nbRows();
+    if ( totalRows == 0 ) {
+        return { 0_lnum, 0 };
+    }
+    row = std::min( row, totalRows - 1 );
+
+    // Descends the tree to the last block starting at or before the row
+    size_t blockIndex = 0;
+    auto step = size_t{ 1 };
+    while ( step * 2 < tree_.size() ) {
+        step *= 2;
+    }
+    for ( ; step > 0; step /= 2 ) {
+        if ( blockIndex + step < tree_.size() && tree_[ blockIndex + step ] <= row ) {
+            blockIndex += step;
+            row -= tree_[ blockIndex ];
+        }
+    }
+
+    const auto blockStart = static_cast<LineNumber::UnderlyingType>( blockIndex * BlockLines );
+    const auto block = wrappedLines_.find( blockIndex );
+    if ( block == wrappedLines_.end() ) {
+        return { LineNumber( blockStart + row ), 0 };
+    }
+
+    // Lines between wrapped ones take one row each
+    uint64_t offset = 0;
+    for ( const auto& [ wrappedOffset, rows ] : block->second ) {
+        if ( row < wrappedOffset - offset ) {
+            return { LineNumber( blockStart + offset + row ), 0 };
+        }
+        row -= wrappedOffset - offset;
+
+        if ( row < rows ) {
+            return { LineNumber( blockStart + wrappedOffset ), static_cast<int>( row ) };
+        }
+        row -= rows;
+        offset = wrappedOffset + 1;
+    }
+
+    return { LineNumber( blockStart + offset + row ), 0 };
+}
@@ -30,6 +30,8 @@ enum class CpuInstructions : unsigned {
     POPCNT = 1 << 5,
     AVX = 1 << 6,
     AVX2 = 1 << 7,
+    // AVX-512 foundation and byte and word instructions
+    AVX512BW = 1 << 8,
 };
 
 inline CpuInstructions& operator|=( CpuInstructions& x, const CpuInstructions& y )
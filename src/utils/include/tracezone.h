@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef KLOGG_TRACEZONE_H
+#define KLOGG_TRACEZONE_H
+
+// KLOGG_ZONE( "name" ) marks the rest of the enclosing scope as a zone of
+// hot path instrumentation. Zones are compiled out by default. Building with
+// KLOGG_USE_TRACY sends them to Tracy profiler, building with KLOGG_TRACE_ZONES
+// records them and saves a Chrome trace (opened by Perfetto) when klogg exits.
+// Zone names have to be string literals.
+
+#if defined( KLOGG_USE_TRACY )
+
+#include <tracy/Tracy.hpp>
+
+#define KLOGG_ZONE( name ) ZoneScopedN( name )
+
+#elif defined( KLOGG_TRACE_ZONES )
+
+#include <chrono>
+
+class TraceZone {
+  public:
+    using Clock = std::chrono::high_resolution_clock;
+
+    explicit TraceZone( const char* name )
+        : name_( name )
+        , start_( Clock::now() )
+    {
+    }
+
+    ~TraceZone()
+    {
+        record( name_, start_, Clock::now() );
+    }
+
+    TraceZone( const TraceZone& ) = delete;
+    TraceZone& operator=( const TraceZone& ) = delete;
+
+  private:
+    static void record( const char* name, Clock::time_point start, Clock::time_point end );
+
+    const char* name_;
+    Clock::time_point start_;
+};
+
+#define KLOGG_ZONE_CONCAT_IMPL( a, b ) a##b
+#define KLOGG_ZONE_CONCAT( a, b ) KLOGG_ZONE_CONCAT_IMPL( a, b )
+#define KLOGG_ZONE( name ) const TraceZone KLOGG_ZONE_CONCAT( kloggZone, __LINE__ )( name )
+
+#else
+
+#define KLOGG_ZONE( name ) static_cast<void>( 0 )
+
+#endif
+
+#endif // KLOGG_TRACEZONE_H
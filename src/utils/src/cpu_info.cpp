@@ -80,6 +80,9 @@ CpuInstructions supportedCpuInstructions()
         if ( f_7_EBX[ 5 ] ) {
             cpuInstructions |= CpuInstructions::AVX2;
         }
+        if ( f_7_EBX[ 16 ] && f_7_EBX[ 30 ] ) {
+            cpuInstructions |= CpuInstructions::AVX512BW;
+        }
     }
 
     return cpuInstructions;
@@ -96,6 +99,9 @@ CpuInstructions supportedCpuInstructions()
         cpuInstructions |= CpuInstructions::SSE41;
         cpuInstructions |= CpuInstructions::AVX;
         cpuInstructions |= CpuInstructions::AVX2;
+        if ( __builtin_cpu_supports( "avx512bw" ) ) {
+            cpuInstructions |= CpuInstructions::AVX512BW;
+        }
     }
     else if ( __builtin_cpu_supports( "avx2" ) ) {
         cpuInstructions |= CpuInstructions::SSE2;
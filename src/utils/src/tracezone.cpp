@@ -0,0 +1,171 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "tracezone.h"
+
+#if defined( KLOGG_TRACE_ZONES ) && !defined( KLOGG_USE_TRACY )
+
+#include <memory>
+#include <vector>
+
+#include <QDateTime>
+#include <QDir>
+#include <QSaveFile>
+
+#include "log.h"
+#include "synchronization.h"
+
+namespace {
+// Zones of each thread are kept in a ring buffer, only the last ones are saved
+constexpr size_t MaxThreadZones = 64 * 1024;
+
+struct Zone {
+    const char* name;
+    int64_t startNs;
+    int64_t durationNs;
+};
+
+struct ThreadZones {
+    explicit ThreadZones( uint32_t id )
+        : threadId( id )
+    {
+        zones.reserve( MaxThreadZones );
+    }
+
+    Mutex mutex;
+    uint32_t threadId;
+    std::vector<Zone> zones;
+    size_t nextZone = 0;
+};
+
+// Zones of all threads, saved when the recorder is destroyed at exit.
+// Buffers outlive their threads, so zones of finished threads are saved too.
+class ZoneRecorder {
+  public:
+    ~ZoneRecorder()
+    {
+        save();
+    }
+
+    TraceZone::Clock::time_point start() const
+    {
+        return start_;
+    }
+
+    std::shared_ptr<ThreadZones> addThread()
+    {
+        ScopedLock lock( mutex_ );
+        threads_.push_back(
+            std::make_shared<ThreadZones>( static_cast<uint32_t>( threads_.size() + 1 ) ) );
+        return threads_.back();
+    }
+
+  private:
+    void save();
+
+    TraceZone::Clock::time_point start_ = TraceZone::Clock::now();
+
+    Mutex mutex_;
+    std::vector<std::shared_ptr<ThreadZones>> threads_;
+};
+
+ZoneRecorder& zoneRecorder()
+{
+    static ZoneRecorder recorder;
+    return recorder;
+}
+
+void ZoneRecorder::save()
+{
+    const auto tracePath = QDir::temp().filePath(
+        QString( "klogg_zones_%1.json" ).arg( QDateTime::currentMSecsSinceEpoch() ) );
+
+    QSaveFile traceFile( tracePath );
+    if ( !traceFile.open( QIODevice::WriteOnly ) ) {
+        LOG_WARNING << "Failed to open zones trace " << tracePath;
+        return;
+    }
+
+    QByteArray trace;
+    trace.append( "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[" );
+
+    size_t zonesCount = 0;
+    ScopedLock lock( mutex_ );
+    for ( const auto& thread : threads_ ) {
+        ScopedLock threadLock( thread->mutex );
+
+        trace.append( QString( "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%1,"
+                               "\"args\":{\"name\":\"thread %1\"}}," )
+                          .arg( thread->threadId )
+                          .toUtf8() );
+
+        // Oldest zone is the next one to be overwritten
+        const auto& zones = thread->zones;
+        const auto firstZone = zones.size() < MaxThreadZones ? 0 : thread->nextZone;
+        for ( auto index = 0u; index < zones.size(); ++index ) {
+            const auto& zone = zones[ ( firstZone + index ) % zones.size() ];
+            trace.append( QString( "{\"name\":\"%1\",\"ph\":\"X\",\"pid\":1,\"tid\":%2,"
+                                   "\"ts\":%3,\"dur\":%4}," )
+                              .arg( zone.name )
+                              .arg( thread->threadId )
+                              .arg( static_cast<double>( zone.startNs ) / 1000.0, 0, 'f', 3 )
+                              .arg( static_cast<double>( zone.durationNs ) / 1000.0, 0, 'f', 3 )
+                              .toUtf8() );
+        }
+        zonesCount += zones.size();
+    }
+
+    if ( trace.endsWith( ',' ) ) {
+        trace.chop( 1 );
+    }
+    trace.append( "]}" );
+
+    traceFile.write( trace );
+    if ( !traceFile.commit() ) {
+        LOG_WARNING << "Failed to save zones trace " << tracePath;
+        return;
+    }
+
+    LOG_INFO << "Saved " << zonesCount << " zones to " << tracePath;
+}
+} // namespace
+
+void TraceZone::record( const char* name, Clock::time_point start, Clock::time_point end )
+{
+    auto& recorder = zoneRecorder();
+    thread_local const auto threadZones = recorder.addThread();
+
+    const Zone zone{
+        name,
+        std::chrono::duration_cast<std::chrono::nanoseconds>( start - recorder.start() ).count(),
+        std::chrono::duration_cast<std::chrono::nanoseconds>( end - start ).count() };
+
+    ScopedLock lock( threadZones->mutex );
+    auto& zones = threadZones->zones;
+    if ( zones.size() < MaxThreadZones ) {
+        zones.push_back( zone );
+    }
+    else {
+        zones[ threadZones->nextZone ] = zone;
+    }
+    threadZones->nextZone = ( threadZones->nextZone + 1 ) % MaxThreadZones;
+}
+
+#endif
@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define CATCH_CONFIG_RUNNER
+#include <catch2/catch.hpp>
+
+#include <QApplication>
+
+#include <logger.h>
+
+#include "configuration.h"
+#include "highlighterset.h"
+#include <persistentinfo.h>
+
+const bool PersistentInfo::ForcePortable = true;
+
+int main( int argc, char* argv[] )
+{
+    QApplication a( argc, argv );
+
+    logging::enableLogging( true, logging::LogLevel::Warning );
+
+    qRegisterMetaType<LinesCount>( "LinesCount" );
+    qRegisterMetaType<LineNumber>( "LineNumber" );
+    qRegisterMetaType<LineLength>( "LineLength" );
+
+    // Every run has to start from scratch
+    auto& config = Configuration::getSynced();
+    config.setUseIndexCache( false );
+    config.setUseSearchResultsCache( false );
+    config.setUsePersistentSearchCache( false );
+    config.setUseHyperscanDatabaseCache( false );
+    config.setPollingEnabled( false );
+    config.setNativeFileWatchEnabled( false );
+
+    HighlighterSetCollection::getSynced();
+
+    return Catch::Session().run( argc, argv );
+}
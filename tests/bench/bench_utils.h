@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_BENCH_UTILS_H
+#define KLOGG_BENCH_UTILS_H
+
+#include <random>
+
+#include <QString>
+#include <QTemporaryFile>
+
+#include "test_utils.h"
+
+#include "logdata.h"
+#include "logfiltereddata.h"
+
+// Synthetic log files used by benchmarks. Generators are seeded
+// with a constant, so every run works on the same bytes.
+enum class Corpus { ShortLines, JsonLines, Utf16, CrLf, Tabs };
+
+inline QString generateLine( Corpus corpus, std::mt19937& generator, int index )
+{
+    std::uniform_int_distribution<int> level( 0, 3 );
+    std::uniform_int_distribution<int> value( 0, 999'999 );
+
+    static const char* const Levels[] = { "DEBUG", "INFO", "WARNING", "ERROR" };
+    const auto timestamp = QString( "2021-03-14 15:%1:%2.%3" )
+                               .arg( ( index / 60'000 ) % 60, 2, 10, QChar( '0' ) )
+                               .arg( ( index / 1000 ) % 60, 2, 10, QChar( '0' ) )
+                               .arg( index % 1000, 3, 10, QChar( '0' ) );
+
+    switch ( corpus ) {
+    case Corpus::JsonLines: {
+        QString line = QString( "{\"time\":\"%1\",\"level\":\"%2\",\"request\":%3,\"tags\":[" )
+                           .arg( timestamp, Levels[ level( generator ) ] )
+                           .arg( value( generator ) );
+        for ( auto tag = 0; tag < 24; ++tag ) {
+            line += QString( "{\"name\":\"tag%1\",\"value\":%2}," )
+                        .arg( tag )
+                        .arg( value( generator ) );
+        }
+        line += "{}],\"message\":\"connection to backend closed\"}";
+        return line;
+    }
+    case Corpus::Tabs:
+        return QString( "%1\t%2\tworker-%3\t\tprocessed request\t%4\tbytes" )
+            .arg( timestamp, Levels[ level( generator ) ] )
+            .arg( index % 16 )
+            .arg( value( generator ) );
+    case Corpus::ShortLines:
+    case Corpus::Utf16:
+    case Corpus::CrLf:
+        break;
+    }
+
+    return QString( "%1 %2 worker-%3 processed request %4" )
+        .arg( timestamp, Levels[ level( generator ) ] )
+        .arg( index % 16 )
+        .arg( value( generator ) );
+}
+
+inline void writeCorpus( QTemporaryFile& file, Corpus corpus, int linesCount )
+{
+    std::mt19937 generator( 42 );
+
+    file.open();
+    if ( corpus == Corpus::Utf16 ) {
+        file.write( "\xFF\xFE", 2 );
+    }
+
+    QByteArray block;
+    for ( auto index = 0; index < linesCount; ++index ) {
+        const auto line = generateLine( corpus, generator, index );
+        if ( corpus == Corpus::Utf16 ) {
+            for ( const auto character : line + QChar( '\n' ) ) {
+                block.append( static_cast<char>( character.unicode() & 0xFF ) );
+                block.append( static_cast<char>( character.unicode() >> 8 ) );
+            }
+        }
+        else {
+            block.append( line.toUtf8() );
+            block.append( corpus == Corpus::CrLf ? "\r\n" : "\n" );
+        }
+
+        if ( block.size() > 1024 * 1024 ) {
+            file.write( block );
+            block.clear();
+        }
+    }
+    file.write( block );
+    file.flush();
+}
+
+inline void loadLogData( LogData& logData, const QString& fileName )
+{
+    SafeQSignalSpy loadingSpy( &logData, SIGNAL( loadingFinished( LoadingStatus ) ) );
+    logData.attachFile( fileName );
+    loadingSpy.safeWait( 60'000 );
+}
+
+inline LinesCount searchLogData( LogFilteredData& filteredData,
+                                 const RegularExpressionPattern& pattern )
+{
+    SafeQSignalSpy progressSpy( &filteredData,
+                                SIGNAL( searchProgressed( LinesCount, int, LineNumber ) ) );
+    filteredData.runSearch( pattern );
+
+    auto progress = 0;
+    while ( progress < 100 && progressSpy.wait( 60'000 ) ) {
+        progress = progressSpy.last().at( 1 ).toInt();
+    }
+    return filteredData.getNbMatches();
+}
+
+#endif
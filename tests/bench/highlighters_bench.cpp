@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+
+#include <QSettings>
+
+#include "bench_utils.h"
+
+#include "highlighterset.h"
+
+namespace {
+
+struct HighlighterDefinition {
+    QString regexp;
+    bool ignoreCase;
+    bool matchOnly;
+};
+
+// Sets can only be created by collection, so they are read
+// from settings in the same format that is used to persist them
+HighlighterSet makeHighlighterSet( const std::vector<HighlighterDefinition>& highlighters )
+{
+    QTemporaryFile settingsFile;
+    settingsFile.open();
+    QSettings settings( settingsFile.fileName(), QSettings::IniFormat );
+
+    settings.beginGroup( "HighlighterSet" );
+    settings.setValue( "version", 3 );
+    settings.setValue( "name", "Benchmark" );
+    settings.beginWriteArray( "highlighters" );
+    for ( auto index = 0u; index < highlighters.size(); ++index ) {
+        settings.setArrayIndex( static_cast<int>( index ) );
+        settings.setValue( "regexp", highlighters[ index ].regexp );
+        settings.setValue( "ignore_case", highlighters[ index ].ignoreCase );
+        settings.setValue( "match_only", highlighters[ index ].matchOnly );
+        settings.setValue( "fore_colour", "#000000" );
+        settings.setValue( "back_colour", "#ffff00" );
+    }
+    settings.endArray();
+    settings.endGroup();
+
+    auto highlighterSet = HighlighterSet::createNewSet( "Benchmark" );
+    highlighterSet.retrieveFromStorage( settings );
+    return highlighterSet;
+}
+
+} // namespace
+
+TEST_CASE( "Matching highlighters", "[highlighters]" )
+{
+    std::mt19937 generator( 42 );
+    std::vector<QString> lines;
+    for ( auto index = 0; index < 10'000; ++index ) {
+        lines.push_back( generateLine( Corpus::ShortLines, generator, index ) );
+    }
+
+    const auto highlighterSet = makeHighlighterSet( {
+        { "ERROR", false, false },
+        { "warning", true, true },
+        { "worker-1[0-5]", false, true },
+        { "request \\d+7$", false, false },
+        { "15:0\\d:", false, true },
+    } );
+    const auto matcher = highlighterSet.createMatcher();
+
+    std::vector<HighlightedMatch> matches;
+
+    BENCHMARK( "Highlighter regexes" )
+    {
+        auto matchedLines = 0u;
+        for ( const auto& line : lines ) {
+            matches.clear();
+            matchedLines += highlighterSet.matchLine( line, matches )
+                            != HighlighterMatchType::NoMatch;
+        }
+        return matchedLines;
+    };
+
+    BENCHMARK( "Highlighter span matcher" )
+    {
+        auto matchedLines = 0u;
+        for ( const auto& line : lines ) {
+            matches.clear();
+            matchedLines += highlighterSet.matchLine( line, matches, &matcher )
+                            != HighlighterMatchType::NoMatch;
+        }
+        return matchedLines;
+    };
+}
@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+
+#include "bench_utils.h"
+
+#include "logdataworker.h"
+
+namespace {
+
+LinesCount indexFile( const QString& fileName )
+{
+    auto indexingData = std::make_shared<IndexingData>();
+    AtomicFlag interruptRequest;
+
+    FullIndexOperation operation( fileName, indexingData, interruptRequest );
+    operation.run();
+
+    return indexingData->getPublishedNbLines();
+}
+
+} // namespace
+
+TEST_CASE( "Indexing synthetic files", "[indexing]" )
+{
+    const auto linesCount = 1'000'000;
+
+    QTemporaryFile shortLines;
+    writeCorpus( shortLines, Corpus::ShortLines, linesCount );
+    BENCHMARK( "Short lines" )
+    {
+        return indexFile( shortLines.fileName() );
+    };
+
+    QTemporaryFile jsonLines;
+    writeCorpus( jsonLines, Corpus::JsonLines, linesCount / 10 );
+    BENCHMARK( "Long JSON lines" )
+    {
+        return indexFile( jsonLines.fileName() );
+    };
+
+    QTemporaryFile utf16Lines;
+    writeCorpus( utf16Lines, Corpus::Utf16, linesCount );
+    BENCHMARK( "UTF-16 lines" )
+    {
+        return indexFile( utf16Lines.fileName() );
+    };
+
+    QTemporaryFile crlfLines;
+    writeCorpus( crlfLines, Corpus::CrLf, linesCount );
+    BENCHMARK( "CRLF lines" )
+    {
+        return indexFile( crlfLines.fileName() );
+    };
+
+    QTemporaryFile tabLines;
+    writeCorpus( tabLines, Corpus::Tabs, linesCount );
+    BENCHMARK( "Lines with tabs" )
+    {
+        return indexFile( tabLines.fileName() );
+    };
+}
@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define CATCH_CONFIG_EXTERNAL_INTERFACES
+#include <catch2/catch.hpp>
+
+#include <iomanip>
+#include <vector>
+
+namespace {
+
+std::string escapeJson( const std::string& text )
+{
+    std::string escaped;
+    for ( const auto c : text ) {
+        if ( c == '"' || c == '\\' ) {
+            escaped.push_back( '\\' );
+            escaped.push_back( c );
+        }
+        else if ( static_cast<unsigned char>( c ) < 0x20 ) {
+            escaped.push_back( ' ' );
+        }
+        else {
+            escaped.push_back( c );
+        }
+    }
+    return escaped;
+}
+
+} // namespace
+
+// Writes results of all benchmarks as one JSON document,
+// nanoseconds are used for all durations.
+class JsonBenchmarkReporter : public Catch::StreamingReporterBase<JsonBenchmarkReporter> {
+  public:
+    using StreamingReporterBase::StreamingReporterBase;
+
+    static std::string getDescription()
+    {
+        return "Reports benchmark results in JSON format";
+    }
+
+    void assertionStarting( const Catch::AssertionInfo& ) override
+    {
+    }
+
+    bool assertionEnded( const Catch::AssertionStats& ) override
+    {
+        return true;
+    }
+
+    void benchmarkEnded( const Catch::BenchmarkStats<>& stats ) override
+    {
+        results_.push_back( { currentTestCaseInfo->name, stats.info.name, stats.info.samples,
+                              stats.info.iterations, stats.mean.point.count(),
+                              stats.mean.lower_bound.count(), stats.mean.upper_bound.count(),
+                              stats.standardDeviation.point.count() } );
+    }
+
+    void testRunEnded( const Catch::TestRunStats& stats ) override
+    {
+        stream << std::setprecision( 12 ) << "{\n  \"benchmarks\": [";
+
+        for ( auto index = 0u; index < results_.size(); ++index ) {
+            const auto& result = results_[ index ];
+            stream << ( index > 0 ? "," : "" ) << "\n    {"
+                   << "\"test_case\": \"" << escapeJson( result.testCase ) << "\", "
+                   << "\"name\": \"" << escapeJson( result.name ) << "\", "
+                   << "\"samples\": " << result.samples << ", "
+                   << "\"iterations\": " << result.iterations << ", "
+                   << "\"mean_ns\": " << result.mean << ", "
+                   << "\"mean_lower_bound_ns\": " << result.meanLowerBound << ", "
+                   << "\"mean_upper_bound_ns\": " << result.meanUpperBound << ", "
+                   << "\"std_dev_ns\": " << result.standardDeviation << "}";
+        }
+
+        stream << "\n  ],\n  \"failed_assertions\": " << stats.totals.assertions.failed
+               << "\n}\n";
+
+        StreamingReporterBase::testRunEnded( stats );
+    }
+
+  private:
+    struct Result {
+        std::string testCase;
+        std::string name;
+        int samples;
+        int iterations;
+        double mean;
+        double meanLowerBound;
+        double meanUpperBound;
+        double standardDeviation;
+    };
+
+    std::vector<Result> results_;
+};
+
+CATCH_REGISTER_REPORTER( "json", JsonBenchmarkReporter )
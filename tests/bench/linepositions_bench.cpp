@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "compressedlinestorage.h"
+
+TEST_CASE( "Line positions storage", "[linepositions]" )
+{
+    const auto linesCount = 1'000'000u;
+
+    std::mt19937 generator( 42 );
+    std::uniform_int_distribution<int64_t> shortLine( 20, 200 );
+    std::uniform_int_distribution<int64_t> longLine( 4'000, 20'000 );
+
+    std::vector<LineOffset> shortLines;
+    std::vector<LineOffset> longLines;
+    int64_t shortPos = 0;
+    int64_t longPos = 0;
+    for ( auto i = 0u; i < linesCount; ++i ) {
+        shortPos += shortLine( generator );
+        longPos += longLine( generator );
+        shortLines.emplace_back( shortPos );
+        longLines.emplace_back( longPos );
+    }
+
+    BENCHMARK( "Append short lines" )
+    {
+        CompressedLinePositionStorage storage;
+        for ( const auto& pos : shortLines ) {
+            storage.append( pos );
+        }
+        return storage.size();
+    };
+
+    BENCHMARK( "Append long lines" )
+    {
+        CompressedLinePositionStorage storage;
+        for ( const auto& pos : longLines ) {
+            storage.append( pos );
+        }
+        return storage.size();
+    };
+
+    CompressedLinePositionStorage storage;
+    for ( const auto& pos : shortLines ) {
+        storage.append( pos );
+    }
+
+    std::uniform_int_distribution<uint32_t> index( 0, linesCount - 1 );
+    std::vector<uint32_t> randomIndex( 100'000 );
+    std::generate( randomIndex.begin(), randomIndex.end(), [ & ] { return index( generator ); } );
+
+    BENCHMARK( "Sequential access" )
+    {
+        CompressedLinePositionStorage::Cache cache;
+        int64_t sum = 0;
+        for ( auto i = 0u; i < linesCount; ++i ) {
+            sum += storage.at( i, &cache ).get();
+        }
+        return sum;
+    };
+
+    BENCHMARK( "Random access" )
+    {
+        int64_t sum = 0;
+        for ( auto i : randomIndex ) {
+            sum += storage.at( i ).get();
+        }
+        return sum;
+    };
+}
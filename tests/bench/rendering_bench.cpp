@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+
+#include <QPixmap>
+
+#include "bench_utils.h"
+
+#include "logmainview.h"
+#include "overviewwidget.h"
+#include "quickfindpattern.h"
+
+namespace {
+
+// Views are drawn into pixmaps, run with -platform offscreen
+// to benchmark without a display.
+struct RenderedView {
+    RenderedView( Corpus corpus, int linesCount )
+        : linesCount_( linesCount )
+    {
+        writeCorpus( file_, corpus, linesCount );
+        loadLogData( logData_, file_.fileName() );
+
+        view_.resize( 1600, 1200 );
+        view_.updateData();
+    }
+
+    // Each frame shows other lines, so the whole text area is drawn again
+    qint64 renderFrame()
+    {
+        line_ = LineNumber( ( line_.get() + 997 ) % static_cast<unsigned>( linesCount_ ) );
+        view_.selectAndDisplayLine( line_ );
+        return view_.viewport()->grab().cacheKey();
+    }
+
+    int linesCount_;
+    LineNumber line_ = 0_lnum;
+
+    QTemporaryFile file_;
+    LogData logData_;
+    QuickFindPattern quickFindPattern_;
+    OverviewWidget overviewWidget_;
+    LogMainView view_{ &logData_, &quickFindPattern_, nullptr, &overviewWidget_ };
+};
+
+} // namespace
+
+TEST_CASE( "Rendering log view", "[rendering]" )
+{
+    RenderedView shortLines( Corpus::ShortLines, 100'000 );
+    BENCHMARK( "Short lines" )
+    {
+        return shortLines.renderFrame();
+    };
+
+    RenderedView jsonLines( Corpus::JsonLines, 10'000 );
+    BENCHMARK( "Long JSON lines" )
+    {
+        return jsonLines.renderFrame();
+    };
+
+    RenderedView tabLines( Corpus::Tabs, 100'000 );
+    BENCHMARK( "Lines with tabs" )
+    {
+        return tabLines.renderFrame();
+    };
+}
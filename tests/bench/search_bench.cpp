@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+
+#include "bench_utils.h"
+
+TEST_CASE( "Searching synthetic file", "[search]" )
+{
+    QTemporaryFile file;
+    writeCorpus( file, Corpus::ShortLines, 1'000'000 );
+
+    LogData logData;
+    loadLogData( logData, file.fileName() );
+    auto filteredData = logData.getNewFilteredData();
+
+    BENCHMARK( "Literal pattern" )
+    {
+        const RegularExpressionPattern pattern( "request 4242", true, false, false, true );
+        return searchLogData( *filteredData, pattern );
+    };
+
+    BENCHMARK( "Case insensitive literal pattern" )
+    {
+        return searchLogData( *filteredData,
+                              RegularExpressionPattern( "WORKER-7", false, false, false, true ) );
+    };
+
+    BENCHMARK( "Regular expression" )
+    {
+        return searchLogData( *filteredData,
+                              RegularExpressionPattern( "ERROR worker-1[0-5] .* 9\\d{4}$" ) );
+    };
+
+    BENCHMARK( "Boolean expression" )
+    {
+        return searchLogData( *filteredData,
+                              RegularExpressionPattern( "\"ERROR\" and not \"worker-3 \"", true,
+                                                        false, true, false ) );
+    };
+}
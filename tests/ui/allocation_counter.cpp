@@ -0,0 +1,134 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "allocation_counter.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+
+#include <malloc.h>
+
+extern "C" {
+void* __libc_malloc( size_t size );
+void* __libc_calloc( size_t count, size_t size );
+void* __libc_realloc( void* ptr, size_t size );
+void* __libc_memalign( size_t alignment, size_t size );
+void __libc_free( void* ptr );
+}
+
+namespace {
+std::atomic<uint64_t> allocations{ 0 };
+std::atomic<int64_t> usedBytes{ 0 };
+std::atomic<int64_t> peakUsedBytes{ 0 };
+std::atomic<int64_t> baseUsedBytes{ 0 };
+
+// Usable size is what free returns, so used bytes stay balanced
+void* allocated( void* ptr )
+{
+    if ( ptr == nullptr ) {
+        return ptr;
+    }
+
+    allocations.fetch_add( 1, std::memory_order_relaxed );
+    const auto size = static_cast<int64_t>( malloc_usable_size( ptr ) );
+    const auto used = usedBytes.fetch_add( size, std::memory_order_relaxed ) + size;
+
+    auto peak = peakUsedBytes.load( std::memory_order_relaxed );
+    while ( used > peak
+            && !peakUsedBytes.compare_exchange_weak( peak, used, std::memory_order_relaxed ) ) {
+    }
+    return ptr;
+}
+
+void released( void* ptr )
+{
+    if ( ptr != nullptr ) {
+        usedBytes.fetch_sub( static_cast<int64_t>( malloc_usable_size( ptr ) ),
+                             std::memory_order_relaxed );
+    }
+}
+} // namespace
+
+extern "C" {
+void* malloc( size_t size )
+{
+    return allocated( __libc_malloc( size ) );
+}
+
+void* calloc( size_t count, size_t size )
+{
+    return allocated( __libc_calloc( count, size ) );
+}
+
+void* realloc( void* ptr, size_t size )
+{
+    // Old block is kept if realloc fails, zero size frees it
+    const auto oldSize = ptr != nullptr ? static_cast<int64_t>( malloc_usable_size( ptr ) ) : 0;
+    auto* newPtr = __libc_realloc( ptr, size );
+    if ( newPtr != nullptr || size == 0 ) {
+        usedBytes.fetch_sub( oldSize, std::memory_order_relaxed );
+    }
+    return allocated( newPtr );
+}
+
+void* memalign( size_t alignment, size_t size )
+{
+    return allocated( __libc_memalign( alignment, size ) );
+}
+
+void* aligned_alloc( size_t alignment, size_t size )
+{
+    return allocated( __libc_memalign( alignment, size ) );
+}
+
+int posix_memalign( void** ptr, size_t alignment, size_t size )
+{
+    *ptr = allocated( __libc_memalign( alignment, size ) );
+    return *ptr != nullptr || size == 0 ? 0 : ENOMEM;
+}
+
+void free( void* ptr )
+{
+    released( ptr );
+    __libc_free( ptr );
+}
+}
+
+namespace allocation_counter {
+
+void reset()
+{
+    allocations = 0;
+    baseUsedBytes = usedBytes.load();
+    peakUsedBytes = baseUsedBytes.load();
+}
+
+Stats stats()
+{
+    Stats stats;
+    stats.allocations = allocations.load();
+    stats.peakBytes = static_cast<uint64_t>(
+        std::max( int64_t{ 0 }, peakUsedBytes.load() - baseUsedBytes.load() ) );
+    return stats;
+}
+
+} // namespace allocation_counter
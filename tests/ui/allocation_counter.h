@@ -0,0 +1,44 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef KLOGG_ALLOCATION_COUNTER_H
+#define KLOGG_ALLOCATION_COUNTER_H
+
+#include <cstdint>
+
+// Counts heap allocations of all threads of the test executable.
+// malloc family is replaced, so allocations of Qt containers are
+// counted along with operator new. Only built on Linux with glibc
+// when no sanitizer replaces malloc itself.
+namespace allocation_counter {
+
+struct Stats {
+    // malloc, calloc, realloc and aligned allocations since reset
+    uint64_t allocations = 0;
+    // Most bytes in use at once above the usage at reset
+    uint64_t peakBytes = 0;
+};
+
+void reset();
+Stats stats();
+
+} // namespace allocation_counter
+
+#endif
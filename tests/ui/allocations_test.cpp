@@ -0,0 +1,152 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <catch2/catch.hpp>
+
+#include <QPixmap>
+#include <QTemporaryFile>
+
+#include "allocation_counter.h"
+#include "log.h"
+#include "test_utils.h"
+
+#include "linebatch.h"
+#include "logdata.h"
+#include "logfiltereddata.h"
+#include "logmainview.h"
+#include "overviewwidget.h"
+#include "quickfindpattern.h"
+
+// Budgets are loose on purpose, they catch work that allocates
+// for every line of the file rather than small changes.
+namespace {
+constexpr int FileLines = 100'000;
+constexpr uint64_t FileLinesBudget = FileLines / 10;
+
+constexpr LinesCount::UnderlyingType PageLines = 1000;
+
+void writeLines( QTemporaryFile& file )
+{
+    file.open();
+    QByteArray block;
+    for ( auto index = 0; index < FileLines; ++index ) {
+        block.append( QString( "2021-03-14 15:%1:%2 INFO worker-%3 processed request %4\n" )
+                          .arg( ( index / 60 ) % 60, 2, 10, QChar( '0' ) )
+                          .arg( index % 60, 2, 10, QChar( '0' ) )
+                          .arg( index % 16 )
+                          .arg( index )
+                          .toUtf8() );
+    }
+    file.write( block );
+    file.flush();
+}
+
+allocation_counter::Stats loadFile( LogData& logData, const QString& fileName )
+{
+    SafeQSignalSpy loadingSpy( &logData, SIGNAL( loadingFinished( LoadingStatus ) ) );
+
+    allocation_counter::reset();
+    logData.attachFile( fileName );
+    REQUIRE( loadingSpy.safeWait( 60'000 ) );
+    return allocation_counter::stats();
+}
+
+void logStats( const char* operation, const allocation_counter::Stats& stats )
+{
+    LOG_INFO << operation << ": " << stats.allocations << " allocations, peak "
+             << stats.peakBytes << " bytes";
+}
+} // namespace
+
+TEST_CASE( "Allocations of log data operations", "[allocations]" )
+{
+    QTemporaryFile file{ "allocations_test_XXXXXX" };
+    writeLines( file );
+
+    LogData logData;
+    const auto indexing = loadFile( logData, file.fileName() );
+    logStats( "Indexing", indexing );
+    REQUIRE( logData.getNbLine() == LinesCount( FileLines ) );
+    REQUIRE( indexing.allocations < FileLinesBudget );
+    REQUIRE( indexing.peakBytes < static_cast<uint64_t>( file.size() ) * 4 + 64 * 1024 * 1024 );
+
+    SECTION( "Searching" )
+    {
+        auto filteredData = logData.getNewFilteredData();
+        SafeQSignalSpy progressSpy( filteredData.get(),
+                                    SIGNAL( searchProgressed( LinesCount, int, LineNumber ) ) );
+
+        allocation_counter::reset();
+        filteredData->runSearch( RegularExpressionPattern( "worker-3 " ) );
+        auto progress = 0;
+        while ( progress < 100 && progressSpy.wait( 60'000 ) ) {
+            progress = progressSpy.last().at( 1 ).toInt();
+        }
+        const auto searching = allocation_counter::stats();
+        logStats( "Searching", searching );
+
+        REQUIRE( filteredData->getNbMatches() == LinesCount( FileLines / 16 ) );
+        REQUIRE( searching.allocations < FileLinesBudget );
+    }
+
+    SECTION( "Fetching lines" )
+    {
+        // First read fills caches, the next one is measured
+        LineBatch batch;
+        logData.getLinesBatch( 5000_lnum, LinesCount( PageLines ), batch );
+        logData.getLines( 5000_lnum, LinesCount( PageLines ) );
+
+        allocation_counter::reset();
+        logData.getLinesBatch( 6000_lnum, LinesCount( PageLines ), batch );
+        const auto batchRead = allocation_counter::stats();
+        logStats( "Reading lines batch", batchRead );
+
+        allocation_counter::reset();
+        const auto lines = logData.getLines( 6000_lnum, LinesCount( PageLines ) );
+        const auto pageRead = allocation_counter::stats();
+        logStats( "Reading lines", pageRead );
+
+        REQUIRE( batch.size() == PageLines );
+        REQUIRE( lines.size() == PageLines );
+        // Batch keeps lines in one buffer, page has a string per line
+        REQUIRE( batchRead.allocations < PageLines / 10 );
+        REQUIRE( pageRead.allocations < PageLines * 3 );
+    }
+
+    SECTION( "Rendering a frame" )
+    {
+        QuickFindPattern quickFindPattern;
+        OverviewWidget overviewWidget;
+        LogMainView view{ &logData, &quickFindPattern, nullptr, &overviewWidget };
+        view.resize( 1600, 1200 );
+        view.updateData();
+
+        view.selectAndDisplayLine( 1000_lnum );
+        view.viewport()->grab();
+
+        allocation_counter::reset();
+        view.selectAndDisplayLine( 50'000_lnum );
+        view.viewport()->grab();
+        const auto rendering = allocation_counter::stats();
+        logStats( "Rendering", rendering );
+
+        REQUIRE( rendering.allocations < FileLinesBudget );
+    }
+}
@@ -0,0 +1,304 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QScrollBar>
+#include <QTemporaryFile>
+#include <QTest>
+#include <QToolButton>
+
+#include "configuration.h"
+#include "log.h"
+#include "savedsearches.h"
+#include "session.h"
+#include "test_utils.h"
+
+#include "logdata.h"
+#include "logfiltereddata.h"
+#include "logmainview.h"
+#include "quickfindpattern.h"
+
+#include "crawlerwidget.h"
+
+// Replays a script of user interactions on a large generated file and
+// writes latency percentiles of each action to a JSON report. Size of the
+// file in megabytes is read from KLOGG_REPLAY_FILE_MB, path of the report
+// from KLOGG_REPLAY_REPORT.
+namespace {
+constexpr int DefaultFileMb = 2048;
+constexpr int LoadingTimeoutMs = 30 * 60 * 1000;
+
+constexpr int PageDownCount = 1000;
+constexpr int JumpToEndCount = 20;
+constexpr int SearchCount = 5;
+constexpr int FollowToggleCount = 20;
+constexpr int QuickFindCount = 100;
+
+int replayFileMb()
+{
+    bool isNumber = false;
+    const auto fileMb = qEnvironmentVariableIntValue( "KLOGG_REPLAY_FILE_MB", &isNumber );
+    return isNumber && fileMb > 0 ? fileMb : DefaultFileMb;
+}
+
+QString replayReportPath()
+{
+    const auto path = qEnvironmentVariable( "KLOGG_REPLAY_REPORT" );
+    return path.isEmpty() ? QStringLiteral( "ui_latency.json" ) : path;
+}
+
+// Lines differ in their numbers only, so the file is written fast
+// and the same size always has the same bytes
+void writeReplayFile( QTemporaryFile& file, qint64 size )
+{
+    static const char* const Levels[] = { "DEBUG", "INFO", "WARNING", "ERROR" };
+
+    file.open();
+    QByteArray block;
+    qint64 written = 0;
+    for ( qint64 index = 0; written < size; ++index ) {
+        block.append( QString( "2021-03-14 15:%1:%2.%3 %4 worker-%5 processed request %6\n" )
+                          .arg( ( index / 60'000 ) % 60, 2, 10, QChar( '0' ) )
+                          .arg( ( index / 1000 ) % 60, 2, 10, QChar( '0' ) )
+                          .arg( index % 1000, 3, 10, QChar( '0' ) )
+                          .arg( Levels[ ( index * 7 ) % 4 ] )
+                          .arg( index % 16 )
+                          .arg( index )
+                          .toLatin1() );
+
+        if ( block.size() > 4 * 1024 * 1024 ) {
+            written += file.write( block );
+            block.clear();
+        }
+    }
+    file.write( block );
+    file.flush();
+}
+
+// Runs until the check passes, events are processed meanwhile
+template <typename F>
+bool waitFor( F&& checkFunc, int timeoutMs )
+{
+    QElapsedTimer timer;
+    timer.start();
+    while ( !checkFunc() ) {
+        if ( timer.elapsed() > timeoutMs ) {
+            return false;
+        }
+        QCoreApplication::processEvents( QEventLoop::AllEvents, 10 );
+    }
+    return true;
+}
+
+// Durations of the samples of each action, in milliseconds
+class LatencyRecorder {
+  public:
+    // Runs the action and waits for the view to repaint
+    void measure( const std::string& action, const std::function<void()>& run,
+                  QWidget* repaintedWidget )
+    {
+        QElapsedTimer timer;
+        timer.start();
+        run();
+        repaintedWidget->repaint();
+        QCoreApplication::processEvents();
+        record( action, timer );
+    }
+
+    void record( const std::string& action, const QElapsedTimer& timer )
+    {
+        samples_[ action ].push_back( static_cast<double>( timer.nsecsElapsed() ) / 1e6 );
+    }
+
+    QJsonArray toJson() const
+    {
+        QJsonArray actions;
+        for ( const auto& actionSamples : samples_ ) {
+            auto durations = actionSamples.second;
+            std::sort( durations.begin(), durations.end() );
+            // Nearest rank percentile
+            const auto percentile = [ &durations ]( double rank ) {
+                const auto index = static_cast<size_t>(
+                    std::max( 0.0, rank * static_cast<double>( durations.size() ) - 1.0 ) );
+                return durations[ std::min( index, durations.size() - 1 ) ];
+            };
+
+            const auto action = QString::fromStdString( actionSamples.first );
+            actions.append( QJsonObject{ { "action", action },
+                                         { "samples", static_cast<int>( durations.size() ) },
+                                         { "p50_ms", percentile( 0.5 ) },
+                                         { "p90_ms", percentile( 0.9 ) },
+                                         { "p99_ms", percentile( 0.99 ) },
+                                         { "max_ms", durations.back() } } );
+        }
+        return actions;
+    }
+
+  private:
+    std::map<std::string, std::vector<double>> samples_;
+};
+} // namespace
+
+struct InteractionsReplayPrivate {
+};
+
+template <>
+struct CrawlerWidget::access_by<InteractionsReplayPrivate> {
+    std::unique_ptr<CrawlerWidget> crawler;
+
+    bool isLoadingFinished() const
+    {
+        return !crawler->loadingInProgress_;
+    }
+
+    LinesCount getLogNbLines() const
+    {
+        return crawler->logData_->getNbLine();
+    }
+
+    LogMainView* mainView() const
+    {
+        return crawler->logMainView_;
+    }
+
+    QWidget* filteredView() const
+    {
+        return crawler->filteredView_;
+    }
+
+    void startSearch( const QString& pattern )
+    {
+        crawler->searchLineEdit_->setEditText( pattern );
+        QTest::mouseClick( crawler->searchButton_, Qt::LeftButton );
+    }
+
+    bool isSearchFinished() const
+    {
+        return crawler->stopButton_->isHidden();
+    }
+};
+
+using ReplayVisitor = CrawlerWidget::access_by<InteractionsReplayPrivate>;
+
+TEST_CASE( "Replay of user interactions", "[replay]" )
+{
+    // Test runner reads files in tiny buffers, interactions
+    // are measured with buffers users have
+    const Configuration defaultConfig;
+    auto& config = Configuration::get();
+    config.setSearchReadBufferSizeLines( defaultConfig.searchReadBufferSizeLines() );
+    config.setIndexReadBufferSizeMb( defaultConfig.indexReadBufferSizeMb() );
+
+    const auto fileMb = replayFileMb();
+    QTemporaryFile file{ "replay_test_XXXXXX" };
+    writeReplayFile( file, static_cast<qint64>( fileMb ) * 1024 * 1024 );
+
+    Session session;
+    session.savedSearches().clear();
+
+    LatencyRecorder recorder;
+    ReplayVisitor visitor;
+
+    QElapsedTimer openTimer;
+    openTimer.start();
+    visitor.crawler.reset( static_cast<CrawlerWidget*>(
+        session.open( file.fileName(), []() { return new CrawlerWidget(); } ) ) );
+    visitor.crawler->resize( 1280, 800 );
+    visitor.crawler->show();
+    REQUIRE( waitFor( [ &visitor ]() { return visitor.isLoadingFinished(); },
+                      LoadingTimeoutMs ) );
+    recorder.record( "open", openTimer );
+
+    auto* mainView = visitor.mainView();
+    const auto lastLine = LineNumber( visitor.getLogNbLines().get() - 1 );
+    REQUIRE( lastLine > 0_lnum );
+
+    for ( auto index = 0; index < PageDownCount; ++index ) {
+        recorder.measure(
+            "page_down",
+            [ mainView ]() {
+                mainView->verticalScrollBar()->triggerAction( QScrollBar::SliderPageStepAdd );
+            },
+            mainView );
+    }
+
+    for ( auto index = 0; index < JumpToEndCount; ++index ) {
+        recorder.measure(
+            "jump_to_end", [ mainView, lastLine ]() { mainView->selectAndDisplayLine( lastLine ); },
+            mainView );
+        recorder.measure(
+            "jump_to_start", [ mainView ]() { mainView->selectAndDisplayLine( 0_lnum ); },
+            mainView );
+    }
+
+    // Searches can't use cached results, they are disabled for tests
+    for ( auto index = 0; index < SearchCount; ++index ) {
+        QElapsedTimer searchTimer;
+        searchTimer.start();
+        visitor.startSearch( QString( "worker-%1 processed" ).arg( index ) );
+        QTest::qWait( 1 );
+        REQUIRE( waitFor( [ &visitor ]() { return visitor.isSearchFinished(); },
+                          LoadingTimeoutMs ) );
+        visitor.filteredView()->repaint();
+        recorder.record( "search", searchTimer );
+    }
+
+    for ( auto index = 0; index < FollowToggleCount; ++index ) {
+        recorder.measure(
+            "follow_on", [ mainView ]() { mainView->followSet( true ); }, mainView );
+        recorder.measure(
+            "follow_off", [ mainView ]() { mainView->followSet( false ); }, mainView );
+    }
+
+    // Every 4th line is an error, quick find moves a few lines each time
+    session.getQuickFindPattern()->changeSearchPattern( "ERROR" );
+    mainView->selectAndDisplayLine( 0_lnum );
+    for ( auto index = 0; index < QuickFindCount; ++index ) {
+        SafeQSignalSpy foundSpy( mainView, SIGNAL( updateLineNumber( LineNumber ) ) );
+        QElapsedTimer quickFindTimer;
+        quickFindTimer.start();
+        mainView->searchForward();
+        REQUIRE( foundSpy.safeWait( LoadingTimeoutMs ) );
+        mainView->repaint();
+        recorder.record( "quickfind_next", quickFindTimer );
+    }
+
+    const auto report = QJsonObject{ { "file_mb", fileMb },
+                                     { "lines", static_cast<double>( lastLine.get() + 1 ) },
+                                     { "actions", recorder.toJson() } };
+
+    QFile reportFile( replayReportPath() );
+    REQUIRE( reportFile.open( QIODevice::WriteOnly | QIODevice::Truncate ) );
+    reportFile.write( QJsonDocument( report ).toJson() );
+    LOG_INFO << "Interaction latencies written to " << reportFile.fileName();
+}
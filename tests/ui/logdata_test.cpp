@@ -132,6 +132,132 @@ TEST_CASE( "Logdata decoding lines", "[logdata]" )
     REQUIRE( rawLines.endOfLines.size() == utf8View.size() );
 }
 
+TEST_CASE( "Logdata reading giant lines", "[logdata]" )
+{
+    QTemporaryFile file{ "testgiantline_XXXXXX" };
+    REQUIRE( file.open() );
+
+    const auto giantLineBytes = LogData::GiantLineBytes + 1024;
+    QByteArray giantLine( static_cast<int>( giantLineBytes ), 'a' );
+    giantLine.replace( static_cast<int>( giantLineBytes - 6 ), 6, "needle" );
+    file.write( "first line\n" );
+    file.write( giantLine );
+    file.write( "\nlast line\n" );
+    file.flush();
+
+    LogData logData;
+    SafeQSignalSpy finishedSpy( &logData, SIGNAL( loadingFinished( LoadingStatus ) ) );
+    logData.attachFile( file.fileName() );
+    REQUIRE( finishedSpy.safeWait() );
+    REQUIRE( logData.getNbLine() == 3_lcount );
+
+    WHEN( "Lines are read for search" )
+    {
+        const auto rawLines
+            = logData.getLinesRaw( 0_lnum, 3_lcount, LogData::LineLimit::Search );
+
+        THEN( "Giant line is cut" )
+        {
+            REQUIRE( rawLines.cutLines.size() == 1 );
+            REQUIRE( rawLines.cutLines.front().index == 1 );
+            REQUIRE( rawLines.cutLines.front().lineBytes == giantLineBytes );
+
+            const auto lines = rawLines.buildUtf8View();
+            REQUIRE( lines.size() == 3 );
+            REQUIRE( lines[ 0 ] == "first line" );
+            REQUIRE( static_cast<qint64>( lines[ 1 ].size() ) == LogData::GiantLineBytes );
+            REQUIRE( lines[ 2 ] == "last line" );
+        }
+
+        THEN( "Rest of the line is read in parts" )
+        {
+            LogData::RawLines part;
+            logData.getLinePart( 1_lnum, LogData::GiantLineBytes, LogData::GiantLineBytes, part );
+            const auto lines = part.buildUtf8View();
+            REQUIRE( lines.size() == 1 );
+            REQUIRE( lines.front().size() == 1024 );
+            REQUIRE( lines.front().substr( 1018 ) == "needle" );
+        }
+    }
+
+    WHEN( "Lines are read for display" )
+    {
+        const auto line = logData.getLineString( 1_lnum );
+
+        THEN( "Only the start of giant line is decoded" )
+        {
+            REQUIRE( line.size() < LogData::DisplayedLineBytes + 100 );
+            REQUIRE( line.endsWith( "are not loaded]" ) );
+            REQUIRE( logData.getLineString( 2_lnum ) == "last line" );
+        }
+
+        AND_WHEN( "More of the line is loaded" )
+        {
+            REQUIRE( logData.loadMoreOfLine( 1_lnum ) );
+
+            THEN( "Longer part is decoded" )
+            {
+                REQUIRE( logData.getLineString( 1_lnum ).size() > line.size() );
+            }
+        }
+    }
+}
+
+TEST_CASE( "Logdata reading binary regions", "[logdata]" )
+{
+    QTemporaryFile file{ "testbinary_XXXXXX" };
+    REQUIRE( file.open() );
+
+    const auto zeros = QByteArray( 3 * static_cast<int>( BinaryRegionIndex::ChunkSize ), '\0' );
+    file.write( "first line\n" );
+    file.write( zeros );
+    file.write( "\nlast line\n" );
+    file.flush();
+
+    LogData logData;
+    SafeQSignalSpy finishedSpy( &logData, SIGNAL( loadingFinished( LoadingStatus ) ) );
+    logData.attachFile( file.fileName() );
+    REQUIRE( finishedSpy.safeWait() );
+    REQUIRE( logData.getNbLine() == 3_lcount );
+
+    WHEN( "Lines are read for search" )
+    {
+        const auto rawLines
+            = logData.getLinesRaw( 0_lnum, 3_lcount, LogData::LineLimit::Search );
+
+        THEN( "Binary line is seen as empty" )
+        {
+            REQUIRE( rawLines.binaryLines == std::vector<size_t>{ 1 } );
+            const auto lines = rawLines.buildUtf8View();
+            REQUIRE( lines.size() == 3 );
+            REQUIRE( lines[ 0 ] == "first line" );
+            REQUIRE( lines[ 1 ].empty() );
+            REQUIRE( lines[ 2 ] == "last line" );
+        }
+    }
+
+    WHEN( "Lines are read without limit" )
+    {
+        const auto rawLines = logData.getLinesRaw( 0_lnum, 3_lcount );
+
+        THEN( "Binary lines are not looked for" )
+        {
+            REQUIRE( rawLines.binaryLines.empty() );
+        }
+    }
+
+    WHEN( "Lines are read for display" )
+    {
+        THEN( "Binary line is shown as placeholder" )
+        {
+            REQUIRE( logData.getLineString( 0_lnum ) == "first line" );
+            REQUIRE( logData.getLineString( 1_lnum )
+                     == QString( "[KLOGG: %1 bytes of binary data]" ).arg( zeros.size() ) );
+            REQUIRE( logData.getLineString( 2_lnum ) == "last line" );
+        }
+    }
+}
+
 TEST_CASE( "Logdata reading changing file", "[logdata]" )
 {
 
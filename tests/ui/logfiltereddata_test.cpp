@@ -118,6 +118,58 @@ SCENARIO( "marks in filtered log data", "[logdata]" )
             }
         }
 
+        WHEN( "Adding several marks at once" )
+        {
+            SearchResultArray lines;
+            lines.add( 10u );
+            lines.add( 25u );
+            lines.add( static_cast<uint64_t>( SL_NB_LINES + 25 ) );
+            filtered_data->addMarks( lines );
+
+            THEN( "Marks inside file are stored" )
+            {
+                REQUIRE( filtered_data->getNbMarks() == 2_lcount );
+                REQUIRE( filtered_data->lineTypeByLine( 25_lnum ).testFlag( LineTypeFlags::Mark ) );
+                REQUIRE( filtered_data->getMarkedLines().cardinality() == 2 );
+            }
+        }
+
+        WHEN( "Changing several marks at once" )
+        {
+            SearchResultArray lines;
+            lines.addRange( 10u, 20u );
+            filtered_data->addMarks( lines );
+
+            AND_WHEN( "Range is unmarked" )
+            {
+                filtered_data->unmarkRange( 15_lnum, 30_lnum );
+
+                THEN( "Marks before range are kept" )
+                {
+                    REQUIRE( filtered_data->getNbMarks() == 5_lcount );
+                    REQUIRE(
+                        filtered_data->lineTypeByLine( 14_lnum ).testFlag( LineTypeFlags::Mark ) );
+                    REQUIRE( !filtered_data->getMarkAfter( 14_lnum ).has_value() );
+                }
+            }
+
+            AND_WHEN( "Marks are toggled" )
+            {
+                SearchResultArray toggled;
+                toggled.addRange( 18u, 22u );
+                filtered_data->changeMarks( toggled, LogFilteredData::MarksChange::Toggle );
+
+                THEN( "Marked lines are unmarked and others are marked" )
+                {
+                    REQUIRE( filtered_data->getNbMarks() == 10_lcount );
+                    REQUIRE( !filtered_data->lineTypeByLine( 19_lnum ).testFlag(
+                        LineTypeFlags::Mark ) );
+                    REQUIRE(
+                        filtered_data->lineTypeByLine( 21_lnum ).testFlag( LineTypeFlags::Mark ) );
+                }
+            }
+        }
+
         WHEN( "Adding marks in log file" )
         {
             filtered_data->addMark( 10_lnum );
@@ -254,6 +306,211 @@ SCENARIO( "search for regex", "[logdata]" )
     }
 }
 
+SCENARIO( "bounded search for regex", "[logdata]" )
+{
+    LogDataLoader logDataLoader;
+
+    GIVEN( "loaded log data" )
+    {
+        auto filtered_data = logDataLoader.log_data.getNewFilteredData();
+
+        auto& config = Configuration::getSynced();
+        config.setSearchThreadPoolSize( 2 );
+        config.setUseParallelSearch( true );
+        // Matches of the limit are in different chunks
+        const auto readBufferSizeLines = config.searchReadBufferSizeLines();
+        config.setSearchReadBufferSizeLines( 16 );
+
+        SafeQSignalSpy searchProgressSpy{ filtered_data.get(),
+                                          &LogFilteredData::searchProgressed };
+
+        const auto runBoundedSearch = [ & ]( SearchLimit limit ) {
+            QTimer::singleShot( 50, [ & ]() {
+                filtered_data->runBoundedSearch(
+                    RegularExpressionPattern( "this is line [0-9]{5}9" ), limit );
+            } );
+
+            int progress = 0;
+            do {
+                REQUIRE( searchProgressSpy.wait() );
+                progress = searchProgressSpy.last().at( 1 ).toInt();
+            } while ( progress < 100 );
+        };
+
+        WHEN( "First matches are searched" )
+        {
+            runBoundedSearch( { 7, SearchLimit::Direction::FromStart } );
+
+            THEN( "Only the first matching lines are in data" )
+            {
+                REQUIRE( filtered_data->getNbMatches() == 7_lcount );
+                REQUIRE( filtered_data->getMatchingLineNumber( 0_lnum ) == 9_lnum );
+                REQUIRE( filtered_data->getMatchingLineNumber( 6_lnum ) == 69_lnum );
+            }
+        }
+
+        WHEN( "Last matches are searched" )
+        {
+            runBoundedSearch( { 7, SearchLimit::Direction::FromEnd } );
+
+            THEN( "Only the last matching lines are in data" )
+            {
+                REQUIRE( filtered_data->getNbMatches() == 7_lcount );
+                REQUIRE( filtered_data->getMatchingLineNumber( 0_lnum ) == 439_lnum );
+                REQUIRE( filtered_data->getMatchingLineNumber( 6_lnum ) == 499_lnum );
+            }
+        }
+
+        config.setSearchReadBufferSizeLines( readBufferSizeLines );
+    }
+}
+
+SCENARIO( "count of matches", "[logdata]" )
+{
+    LogDataLoader logDataLoader;
+
+    GIVEN( "loaded log data" )
+    {
+        auto filtered_data = logDataLoader.log_data.getNewFilteredData();
+
+        auto& config = Configuration::getSynced();
+        config.setSearchThreadPoolSize( 2 );
+        config.setUseParallelSearch( true );
+
+        SafeQSignalSpy countSpy{ filtered_data.get(), &LogFilteredData::matchesCounted };
+
+        WHEN( "Matches are counted" )
+        {
+            QTimer::singleShot( 50, [ & ]() {
+                filtered_data->countMatches(
+                    RegularExpressionPattern( "this is line [0-9]{5}9" ) );
+            } );
+            REQUIRE( countSpy.wait() );
+
+            THEN( "Count is sent and matches are not kept" )
+            {
+                REQUIRE( qvariant_cast<LinesCount>( countSpy.last().at( 0 ) ) == 50_lcount );
+                REQUIRE( filtered_data->getNbMatches() == 0_lcount );
+            }
+        }
+    }
+}
+
+SCENARIO( "filter chain", "[logdata]" )
+{
+    LogDataLoader logDataLoader;
+
+    GIVEN( "loaded log data" )
+    {
+        auto filtered_data = logDataLoader.log_data.getNewFilteredData();
+
+        auto& config = Configuration::getSynced();
+        config.setSearchThreadPoolSize( 2 );
+        config.setUseParallelSearch( true );
+
+        SafeQSignalSpy searchProgressSpy{ filtered_data.get(),
+                                          &LogFilteredData::searchProgressed };
+
+        const auto runFilterChain = [ & ]( const std::vector<RegularExpressionPattern>& stages ) {
+            QTimer::singleShot( 50, [ & ]() { filtered_data->runFilterChain( stages ); } );
+
+            int progress = 0;
+            do {
+                REQUIRE( searchProgressSpy.wait() );
+                progress = searchProgressSpy.last().at( 1 ).toInt();
+            } while ( progress < 100 );
+        };
+
+        const auto linesPattern = RegularExpressionPattern( "this is line" );
+
+        WHEN( "Lines are kept and then excluded" )
+        {
+            runFilterChain(
+                { linesPattern,
+                  RegularExpressionPattern( "[0-9]{5}9", true, true, false, false ) } );
+
+            THEN( "Lines of the last stage are in data" )
+            {
+                REQUIRE( filtered_data->getNbMatches() == 450_lcount );
+                REQUIRE( filtered_data->getMatchingLineNumber( 9_lnum ) == 10_lnum );
+            }
+
+            AND_WHEN( "Last stage is changed" )
+            {
+                runFilterChain(
+                    { linesPattern,
+                      RegularExpressionPattern( "[0-9]{5}[89]", true, true, false, false ) } );
+
+                THEN( "Only lines kept by the first stage are searched" )
+                {
+                    REQUIRE( filtered_data->getNbMatches() == 400_lcount );
+                }
+            }
+        }
+    }
+}
+
+SCENARIO( "combined search results", "[logdata]" )
+{
+    LogDataLoader logDataLoader;
+
+    GIVEN( "loaded log data" )
+    {
+        auto filtered_data = logDataLoader.log_data.getNewFilteredData();
+
+        auto& config = Configuration::getSynced();
+        config.setUseSearchResultsCache( true );
+
+        SafeQSignalSpy searchProgressSpy{ filtered_data.get(),
+                                          &LogFilteredData::searchProgressed };
+
+        const auto filterPattern = RegularExpressionPattern( "this is line [0-9]{5}8" );
+        runSearch( filtered_data.get(), filterPattern.pattern, searchProgressSpy );
+        runSearch( filtered_data.get(), "this is line [0-9]{5}9", searchProgressSpy );
+
+        WHEN( "Matches of cached search are added" )
+        {
+            REQUIRE( filtered_data->combineWithCachedSearch(
+                filterPattern, LogFilteredData::SearchCombination::Union ) );
+            REQUIRE( filtered_data->getNbMatches() == 100_lcount );
+
+            AND_WHEN( "Lines are added to the file and search is updated" )
+            {
+                char newLine[ 90 ];
+                for ( int i = SL_NB_LINES; i < SL_NB_LINES + 10; i++ ) {
+                    snprintf( newLine, 89,
+                              "LOGDATA \t is a part of glogg, we are going to test it "
+                              "thoroughly, this is line %06d\n",
+                              i );
+                    logDataLoader.file.write( newLine, static_cast<qint64>( qstrlen( newLine ) ) );
+                }
+                logDataLoader.file.flush();
+
+                auto& logData = logDataLoader.log_data;
+                REQUIRE( waitUiState( [ &logData ] {
+                    return logData.getNbLine() == LinesCount( SL_NB_LINES + 10 );
+                } ) );
+
+                QTimer::singleShot( 50, [ & ]() {
+                    filtered_data->updateSearch( 0_lnum, LineNumber( SL_NB_LINES + 10 ) );
+                } );
+                int progress = 0;
+                do {
+                    REQUIRE( searchProgressSpy.wait() );
+                    progress = searchProgressSpy.last().at( 1 ).toInt();
+                } while ( progress < 100 );
+
+                THEN( "Count of combined matches is kept" )
+                {
+                    REQUIRE( qvariant_cast<LinesCount>( searchProgressSpy.last().at( 0 ) )
+                             == 101_lcount );
+                    REQUIRE( filtered_data->getNbMatches() == 101_lcount );
+                }
+            }
+        }
+    }
+}
+
 SCENARIO( "marks and matches in filtered log data", "[logdata]" )
 {
     LogDataLoader logDataLoader;
@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+
+#include <QDataStream>
+#include <QFile>
+#include <QTemporaryDir>
+
+#include "analysisbundle.h"
+
+namespace {
+QByteArray readFile( const QString& fileName )
+{
+    QFile file( fileName );
+    REQUIRE( file.open( QIODevice::ReadOnly ) );
+    return file.readAll();
+}
+
+void writeFile( const QString& fileName, const QByteArray& data )
+{
+    QFile file( fileName );
+    REQUIRE( file.open( QIODevice::WriteOnly ) );
+    REQUIRE( file.write( data ) == data.size() );
+}
+
+QByteArray saveIndex( const IndexingData& data )
+{
+    QByteArray saved;
+    QDataStream stream( &saved, QIODevice::WriteOnly );
+    stream.setVersion( QDataStream::Qt_5_9 );
+    IndexingData::ConstAccessor( &data ).saveIndex( stream );
+    return saved;
+}
+} // namespace
+
+SCENARIO( "Analysis bundle exported and opened", "[analysisbundle]" )
+{
+    QTemporaryDir directory;
+    REQUIRE( directory.isValid() );
+    const auto fileName = directory.filePath( "test.log" );
+    const auto bundlePath = directory.filePath( "test.klab" );
+
+    QByteArray data;
+    for ( auto i = 0; i < 5000; ++i ) {
+        data.append( ( i % 7 == 0 ? "match " : "other " ) + QByteArray::number( i * i ) + '\n' );
+    }
+    writeFile( fileName, data );
+
+    AtomicFlag interruptRequest;
+    auto indexingData = std::make_shared<IndexingData>();
+    REQUIRE( FullIndexOperation( fileName, indexingData, interruptRequest ).run() );
+
+    AnalysisBundle bundle;
+    bundle.fileName = "test.log";
+    REQUIRE( bundle.setIndex( IndexingData::ConstAccessor( indexingData.get() ) ) );
+
+    PersistentSearchCache::Entry entry;
+    entry.pattern = RegularExpressionPattern( "match" );
+    entry.startLine = 0_lnum;
+    entry.endLine = 5000_lnum;
+    entry.maxLength = 14_length;
+    for ( auto i = 0u; i < 5000; i += 7 ) {
+        entry.matchingLines.add( i );
+    }
+    bundle.searchResults.push_back( entry );
+    bundle.marks.add( 42u );
+    bundle.highlighters = "highlighters";
+
+    REQUIRE( bundle.save( bundlePath ) );
+    const auto saved = readFile( bundlePath );
+
+    WHEN( "Bundle is opened" )
+    {
+        AnalysisBundle loaded;
+        REQUIRE( loaded.load( bundlePath ) );
+
+        THEN( "It has the exported analysis" )
+        {
+            REQUIRE( loaded.fileName == "test.log" );
+            REQUIRE( loaded.isBundleOf( fileName ) );
+            REQUIRE( loaded.searchResults.size() == 1 );
+            REQUIRE( loaded.searchResults[ 0 ].matchingLines == entry.matchingLines );
+            REQUIRE( loaded.marks == bundle.marks );
+            REQUIRE( loaded.highlighters == bundle.highlighters );
+        }
+
+        THEN( "Attached index has the same line offsets" )
+        {
+            loaded.attach( fileName );
+
+            IndexingData attachedData;
+            IndexingData::MutateAccessor accessor( &attachedData );
+            REQUIRE( AnalysisBundle::loadAttachedIndex( fileName, accessor ) );
+
+            const IndexingData::ConstAccessor original( indexingData.get() );
+            REQUIRE( accessor.getNbLines() == original.getNbLines() );
+            for ( auto i = 0u; i < original.getNbLines().get(); ++i ) {
+                REQUIRE( accessor.getEndOfLineOffset( LineNumber( i ) )
+                         == original.getEndOfLineOffset( LineNumber( i ) ) );
+            }
+
+            REQUIRE( AnalysisBundle::takeAttachedSearchResults( fileName ).size() == 1 );
+        }
+    }
+
+    WHEN( "Bundled index is damaged" )
+    {
+        const auto index = saveIndex( *indexingData );
+        const auto indexPosition = saved.indexOf( index );
+        REQUIRE( indexPosition > 0 );
+
+        auto damaged = saved;
+        const auto damagedPosition = indexPosition + index.size() / 2;
+        damaged[ damagedPosition ] = static_cast<char>( ~damaged.at( damagedPosition ) );
+        writeFile( bundlePath, damaged );
+
+        THEN( "Bundle is not opened" )
+        {
+            REQUIRE( !AnalysisBundle().load( bundlePath ) );
+        }
+    }
+
+    WHEN( "Bundle is truncated" )
+    {
+        for ( auto size : { 8, saved.size() / 3, saved.size() / 2, saved.size() - 1 } ) {
+            writeFile( bundlePath, saved.left( size ) );
+            REQUIRE( !AnalysisBundle().load( bundlePath ) );
+        }
+    }
+}
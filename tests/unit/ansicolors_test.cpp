@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <catch2/catch.hpp>
+
+#include <string>
+
+#include "ansicolors.h"
+
+namespace {
+AnsiColor indexed( uint32_t index )
+{
+    return { AnsiColor::Type::Indexed, index };
+}
+
+void requireSpan( const AnsiColorSpan& span, int startColumn, int length, AnsiColor foreColor,
+                  AnsiColor backColor )
+{
+    REQUIRE( span.startColumn == startColumn );
+    REQUIRE( span.length == length );
+    REQUIRE( span.foreColor == foreColor );
+    REQUIRE( span.backColor == backColor );
+}
+} // namespace
+
+SCENARIO( "ANSI color sequences parsing", "[ansicolors]" )
+{
+    WHEN( "Line has no sequences" )
+    {
+        REQUIRE( ansi_colors::parseLine( "plain line" ).empty() );
+    }
+
+    WHEN( "Colors are set and reset" )
+    {
+        const auto spans = ansi_colors::parseLine( "\x1B[31merror\x1B[0m: \x1B[1;92mok\x1B[m" );
+        REQUIRE( spans.size() == 2 );
+        requireSpan( spans[ 0 ], 0, 5, indexed( 1 ), {} );
+        requireSpan( spans[ 1 ], 7, 2, indexed( 10 ), {} );
+    }
+
+    WHEN( "Foreground and background are changed separately" )
+    {
+        const auto spans = ansi_colors::parseLine( "a\x1B[33mb\x1B[44mc\x1B[39md\x1B[Ke" );
+        REQUIRE( spans.size() == 3 );
+        requireSpan( spans[ 0 ], 1, 1, indexed( 3 ), {} );
+        requireSpan( spans[ 1 ], 2, 1, indexed( 3 ), indexed( 4 ) );
+        requireSpan( spans[ 2 ], 3, 2, {}, indexed( 4 ) );
+    }
+
+    WHEN( "Line has extended colors" )
+    {
+        const auto spans = ansi_colors::parseLine( "\x1B[38;5;196mred\x1B[48;2;1;2;3mrgb" );
+        REQUIRE( spans.size() == 2 );
+        requireSpan( spans[ 0 ], 0, 3, indexed( 196 ), {} );
+        requireSpan( spans[ 1 ], 3, 3, indexed( 196 ), { AnsiColor::Type::Rgb, 0x010203 } );
+    }
+
+    WHEN( "Columns are counted in UTF-16 characters" )
+    {
+        // Cyrillic letter is one character, emoji is a surrogate pair
+        const auto spans = ansi_colors::parseLine( "\xD0\xB6\xF0\x9F\x98\x80\x1B[32mgreen" );
+        REQUIRE( spans.size() == 1 );
+        requireSpan( spans[ 0 ], 3, 5, indexed( 2 ), {} );
+    }
+
+    WHEN( "Escape character doesn't start a sequence" )
+    {
+        const auto spans = ansi_colors::parseLine( "\x1B[31m\x1B[1;mx" );
+        REQUIRE( spans.size() == 1 );
+        requireSpan( spans[ 0 ], 0, 6, indexed( 1 ), {} );
+    }
+}
@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+
+#include <string>
+
+#include <QBuffer>
+#include <QDataStream>
+
+#include "binaryregionindex.h"
+#include "linescanner.h"
+
+TEST_CASE( "Binary bytes are counted", "[binaryregionindex]" )
+{
+    REQUIRE( line_scanner::countBinaryBytes( "plain text\twith tabs\r\n" ) == 0 );
+    REQUIRE( line_scanner::countBinaryBytes( "\x1b[31mcolored\x1b[0m" ) == 0 );
+    REQUIRE( line_scanner::countBinaryBytes( std::string( 100, '\0' ) ) == 100 );
+
+    auto mixed = std::string( 37, 'a' );
+    mixed[ 3 ] = '\x01';
+    mixed[ 20 ] = '\x7f';
+    mixed[ 36 ] = '\x1f';
+    REQUIRE( line_scanner::countBinaryBytes( mixed ) == 2 );
+}
+
+SCENARIO( "Binary region index", "[binaryregionindex]" )
+{
+    const auto chunkSize = static_cast<size_t>( BinaryRegionIndex::ChunkSize );
+
+    GIVEN( "Block with text, zeros and text" )
+    {
+        std::string block = std::string( chunkSize, 'a' ) + std::string( 2 * chunkSize, '\0' )
+                            + std::string( chunkSize, 'b' );
+
+        const auto chunks = BinaryRegionIndex::findBinaryChunks( 0, block, EncodingParameters{} );
+        REQUIRE( chunks == std::vector<uint64_t>{ 1, 2 } );
+
+        BinaryRegionIndex index;
+        index.append( chunks );
+
+        THEN( "Only ranges overlapping zeros have binary chunks" )
+        {
+            REQUIRE( !index.hasBinaryChunks( 0, BinaryRegionIndex::ChunkSize ) );
+            REQUIRE( index.hasBinaryChunks( 0, BinaryRegionIndex::ChunkSize + 1 ) );
+            REQUIRE( index.hasBinaryChunks( 3 * BinaryRegionIndex::ChunkSize - 1,
+                                            4 * BinaryRegionIndex::ChunkSize ) );
+            REQUIRE( !index.hasBinaryChunks( 3 * BinaryRegionIndex::ChunkSize,
+                                             4 * BinaryRegionIndex::ChunkSize ) );
+        }
+
+        WHEN( "Index is truncated" )
+        {
+            index.truncate( BinaryRegionIndex::ChunkSize + 10 );
+
+            THEN( "Chunks past size are dropped" )
+            {
+                REQUIRE( index.hasBinaryChunks( BinaryRegionIndex::ChunkSize,
+                                                BinaryRegionIndex::ChunkSize + 1 ) );
+                REQUIRE( !index.hasBinaryChunks( 2 * BinaryRegionIndex::ChunkSize,
+                                                 3 * BinaryRegionIndex::ChunkSize ) );
+            }
+        }
+
+        WHEN( "Index is saved and loaded" )
+        {
+            QBuffer buffer;
+            buffer.open( QIODevice::ReadWrite );
+            QDataStream stream( &buffer );
+            index.save( stream );
+
+            buffer.seek( 0 );
+            BinaryRegionIndex loaded;
+            REQUIRE( loaded.load( stream ) );
+            REQUIRE( loaded.hasBinaryChunks( 2 * BinaryRegionIndex::ChunkSize,
+                                             2 * BinaryRegionIndex::ChunkSize + 1 ) );
+        }
+
+        WHEN( "Saved chunks are truncated" )
+        {
+            QBuffer buffer;
+            buffer.open( QIODevice::ReadWrite );
+            QDataStream stream( &buffer );
+            index.save( stream );
+
+            buffer.seek( 0 );
+            QByteArray data;
+            stream >> data;
+
+            buffer.buffer().clear();
+            buffer.seek( 0 );
+            stream << data.left( data.size() - 1 );
+
+            buffer.seek( 0 );
+            BinaryRegionIndex loaded;
+            REQUIRE( !loaded.load( stream ) );
+        }
+    }
+
+    GIVEN( "Block that starts inside a chunk" )
+    {
+        const auto offset = BinaryRegionIndex::ChunkSize - 100;
+        std::string block = std::string( 100, 'a' ) + std::string( chunkSize, '\x02' );
+
+        const auto chunks
+            = BinaryRegionIndex::findBinaryChunks( offset, block, EncodingParameters{} );
+        REQUIRE( chunks == std::vector<uint64_t>{ 1 } );
+    }
+
+    GIVEN( "Text of wide encoding" )
+    {
+        EncodingParameters encodingParams;
+        encodingParams.lineFeedWidth = 2;
+
+        const auto chunks = BinaryRegionIndex::findBinaryChunks(
+            0, std::string( chunkSize, '\0' ), encodingParams );
+        REQUIRE( chunks.empty() );
+    }
+
+    THEN( "Text is binary when it has many control bytes" )
+    {
+        REQUIRE( !BinaryRegionIndex::isBinary( "" ) );
+        REQUIRE( !BinaryRegionIndex::isBinary( "2021-01-01 INFO started\r" ) );
+        REQUIRE( BinaryRegionIndex::isBinary( std::string( 10, '\0' ) ) );
+        REQUIRE( BinaryRegionIndex::isBinary( std::string( "text\x03\x04", 6 ) ) );
+    }
+}
@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+
+#include "devicetuning.h"
+
+SCENARIO( "Device tuning", "[devicetuning]" )
+{
+    WHEN( "Device is fast" )
+    {
+        const auto parameters = DeviceTuning::tune( 3000, 0.1, 500, 16 );
+
+        THEN( "Read ahead is limited" )
+        {
+            REQUIRE( parameters.searchThreadPoolSize == 8 );
+            REQUIRE( parameters.indexReadBufferSizeMb == 256 );
+            REQUIRE( parameters.searchReadBufferSizeLines == 105000 );
+        }
+    }
+
+    WHEN( "Device is slow" )
+    {
+        const auto parameters = DeviceTuning::tune( 200, 4, 500, 16 );
+
+        THEN( "Half of cores match lines" )
+        {
+            REQUIRE( parameters.searchThreadPoolSize == 8 );
+            REQUIRE( parameters.indexReadBufferSizeMb == 57 );
+            REQUIRE( parameters.searchReadBufferSizeLines == 300000 );
+        }
+    }
+
+    WHEN( "Matching is slow" )
+    {
+        const auto parameters = DeviceTuning::tune( 3000, 0.1, 100, 16 );
+
+        THEN( "Threads are limited to cores" )
+        {
+            REQUIRE( parameters.searchThreadPoolSize == 16 );
+        }
+    }
+
+    WHEN( "Device has very high latency" )
+    {
+        const auto parameters = DeviceTuning::tune( 1, 1000, 500, 1 );
+
+        THEN( "Buffers are limited" )
+        {
+            REQUIRE( parameters.searchThreadPoolSize == 1 );
+            REQUIRE( parameters.indexReadBufferSizeMb == 9 );
+            REQUIRE( parameters.searchReadBufferSizeLines == 1000000 );
+        }
+    }
+}
@@ -0,0 +1,50 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+
+#include <vector>
+
+#include "fanoutsearch.h"
+
+SCENARIO( "Matching lines of hosts merged by timestamps", "[fanoutsearch]" )
+{
+    WHEN( "Hosts have interleaved timestamps" )
+    {
+        const std::vector<std::vector<qint64>> timestamps
+            = { { 10, 20, 20, 50 }, {}, { 5, 20, 60 } };
+        const auto lineMap = FanOutSearch::mergeByTimestamps( timestamps );
+
+        REQUIRE( lineMap.size() == 7_lcount );
+
+        // Equal timestamps are taken from the first host
+        const std::vector<size_t> sources = { 2, 0, 0, 0, 2, 0, 2 };
+        for ( auto index = 0u; index < sources.size(); ++index ) {
+            REQUIRE( lineMap.sourceLine( LineNumber( index ) ).source == sources[ index ] );
+        }
+
+        REQUIRE( lineMap.sourceLine( 4_lnum ).line == 1_lnum );
+    }
+
+    WHEN( "No host has matching lines" )
+    {
+        const auto lineMap = FanOutSearch::mergeByTimestamps( { {}, {} } );
+        REQUIRE( lineMap.size() == 0_lcount );
+    }
+}
@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+
+#include <string_view>
+#include <vector>
+
+#include "fieldindex.h"
+
+namespace {
+std::vector<LineNumber::UnderlyingType> toVector( const roaring::Roaring64Map& lines )
+{
+    std::vector<LineNumber::UnderlyingType> numbers;
+    for ( const auto line : lines ) {
+        numbers.push_back( line );
+    }
+    return numbers;
+}
+} // namespace
+
+SCENARIO( "Field query parsing", "[fieldindex]" )
+{
+    const QStringList fields{ "level", "service" };
+
+    WHEN( "Query has conditions of indexed fields" )
+    {
+        const auto conditions
+            = parseFieldQuery( "level=ERROR and service = \"pay ments\"", fields );
+        REQUIRE( conditions.has_value() );
+        REQUIRE( conditions->size() == 2 );
+        REQUIRE( ( *conditions )[ 0 ].field == "level" );
+        REQUIRE( ( *conditions )[ 0 ].value == "ERROR" );
+        REQUIRE( ( *conditions )[ 1 ].value == "pay ments" );
+    }
+
+    WHEN( "Query is not about indexed fields" )
+    {
+        REQUIRE( !parseFieldQuery( "trace_id=42", fields ).has_value() );
+        REQUIRE( !parseFieldQuery( "connection refused", fields ).has_value() );
+        REQUIRE( !parseFieldQuery( "level=ERROR", {} ).has_value() );
+    }
+}
+
+SCENARIO( "Field values of lines", "[fieldindex]" )
+{
+    WHEN( "Line is JSON object" )
+    {
+        const std::string_view line = R"({"ts":1,"level": "ERROR","service":"payments"})";
+        REQUIRE( FieldIndex::keyValueField( line, "level" ) == "ERROR" );
+        REQUIRE( FieldIndex::keyValueField( line, "service" ) == "payments" );
+        REQUIRE( !FieldIndex::keyValueField( line, "trace_id" ).has_value() );
+    }
+
+    WHEN( "Line has logfmt pairs" )
+    {
+        const std::string_view line = "ts=1 level=WARN msg=\"slow query\" loglevel=INFO";
+        REQUIRE( FieldIndex::keyValueField( line, "level" ) == "WARN" );
+        REQUIRE( FieldIndex::keyValueField( line, "msg" ) == "slow query" );
+    }
+
+    WHEN( "Line is CSV" )
+    {
+        const auto columns = FieldIndex::csvColumns( "1, \"a,b\",ERROR\r" );
+        REQUIRE( columns.size() == 3 );
+        REQUIRE( columns[ 1 ] == "\"a,b\"" );
+        REQUIRE( columns[ 2 ] == "ERROR" );
+    }
+}
+
+SCENARIO( "Field index search", "[fieldindex]" )
+{
+    FieldIndex index( { "level", "service" } );
+
+    GIVEN( "Key value lines" )
+    {
+        index.append( { R"({"level":"ERROR","service":"payments"})",
+                        "level=INFO service=payments", "  at Main.run(Main.java:10)" } );
+        index.append( { "level=ERROR service=payments", "level=ERROR service=orders" } );
+
+        REQUIRE( index.size() == 5_lcount );
+
+        WHEN( "All conditions are matched" )
+        {
+            const auto lines = index.find(
+                { { "level", "ERROR" }, { "service", "payments" } }, 0_lnum, 5_lnum );
+            REQUIRE( toVector( lines ) == std::vector<LineNumber::UnderlyingType>{ 0, 3 } );
+        }
+
+        WHEN( "Lines are limited" )
+        {
+            const auto lines = index.find( { { "level", "ERROR" } }, 1_lnum, 4_lnum );
+            REQUIRE( toVector( lines ) == std::vector<LineNumber::UnderlyingType>{ 3 } );
+        }
+
+        WHEN( "Value is not on any line" )
+        {
+            REQUIRE( index.find( { { "level", "DEBUG" } }, 0_lnum, 5_lnum ).isEmpty() );
+        }
+
+        WHEN( "Last lines are added again" )
+        {
+            index.truncate( 3_lcount );
+            index.append( { "level=DEBUG service=orders" } );
+
+            REQUIRE( index.size() == 4_lcount );
+            REQUIRE( toVector( index.find( { { "level", "DEBUG" } }, 0_lnum, 4_lnum ) )
+                     == std::vector<LineNumber::UnderlyingType>{ 3 } );
+        }
+    }
+
+    GIVEN( "CSV lines" )
+    {
+        index.append( { "time,level,service", "1,ERROR,payments", "2,INFO,payments" } );
+
+        const auto lines = index.find( { { "service", "payments" } }, 0_lnum, 3_lnum );
+        REQUIRE( toVector( lines ) == std::vector<LineNumber::UnderlyingType>{ 1, 2 } );
+    }
+}
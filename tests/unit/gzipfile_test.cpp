@@ -0,0 +1,177 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+
+#include <QTemporaryFile>
+
+#include <zlib.h>
+
+#include "gzipfile.h"
+
+namespace {
+QByteArray gzipMember( const QByteArray& data )
+{
+    z_stream stream{};
+    deflateInit2( &stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY );
+
+    QByteArray compressed( static_cast<int>( deflateBound( &stream, data.size() ) ),
+                           Qt::Uninitialized );
+    stream.next_in = reinterpret_cast<Bytef*>( const_cast<char*>( data.constData() ) );
+    stream.avail_in = static_cast<uInt>( data.size() );
+    stream.next_out = reinterpret_cast<Bytef*>( compressed.data() );
+    stream.avail_out = static_cast<uInt>( compressed.size() );
+    deflate( &stream, Z_FINISH );
+
+    compressed.resize( static_cast<int>( stream.total_out ) );
+    deflateEnd( &stream );
+    return compressed;
+}
+
+// Member with BC extra field as written by bgzip
+QByteArray bgzipMember( const QByteArray& data )
+{
+    z_stream stream{};
+    deflateInit2( &stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY );
+
+    QByteArray compressed( static_cast<int>( deflateBound( &stream, data.size() ) ),
+                           Qt::Uninitialized );
+    stream.next_in = reinterpret_cast<Bytef*>( const_cast<char*>( data.constData() ) );
+    stream.avail_in = static_cast<uInt>( data.size() );
+    stream.next_out = reinterpret_cast<Bytef*>( compressed.data() );
+    stream.avail_out = static_cast<uInt>( compressed.size() );
+    deflate( &stream, Z_FINISH );
+
+    compressed.resize( static_cast<int>( stream.total_out ) );
+    deflateEnd( &stream );
+
+    const auto appendLittleEndian = []( QByteArray& bytes, quint32 value, int size ) {
+        for ( auto byte = 0; byte < size; ++byte ) {
+            bytes.append( static_cast<char>( ( value >> ( 8 * byte ) ) & 0xff ) );
+        }
+    };
+
+    QByteArray member( "\x1f\x8b\x08\x04\x00\x00\x00\x00\x00\xff\x06\x00"
+                       "BC\x02\x00",
+                       16 );
+    appendLittleEndian( member, static_cast<quint32>( 18 + compressed.size() + 8 - 1 ), 2 );
+    member.append( compressed );
+    appendLittleEndian(
+        member,
+        static_cast<quint32>( crc32( 0, reinterpret_cast<const Bytef*>( data.constData() ),
+                                     static_cast<uInt>( data.size() ) ) ),
+        4 );
+    appendLittleEndian( member, static_cast<quint32>( data.size() ), 4 );
+    return member;
+}
+
+QByteArray logLines( int first, int count )
+{
+    QByteArray lines;
+    for ( auto line = first; line < first + count; ++line ) {
+        lines.append( QByteArray( "request " ) + QByteArray::number( line * 7919 % 100003 )
+                      + " handled in " + QByteArray::number( line % 977 ) + " ms\n" );
+    }
+    return lines;
+}
+} // namespace
+
+SCENARIO( "Random access to gzip file", "[gzipfile]" )
+{
+    // Two members with more than one checkpoint span of data
+    const auto firstPart = logLines( 0, 400000 );
+    const auto secondPart = logLines( 400000, 300000 );
+    const auto data = firstPart + secondPart;
+
+    QTemporaryFile compressedFile;
+    REQUIRE( compressedFile.open() );
+    compressedFile.write( gzipMember( firstPart ) + gzipMember( secondPart ) );
+    compressedFile.close();
+
+    REQUIRE( GzipFile::isGzipFile( compressedFile.fileName() ) );
+
+    GzipFile file( compressedFile.fileName() );
+    REQUIRE( file.open( QIODevice::ReadOnly ) );
+
+    WHEN( "File is read sequentially" )
+    {
+        QByteArray decompressed;
+        while ( !file.atEnd() ) {
+            const auto block = file.read( 1024 * 1024 );
+            if ( block.isEmpty() ) {
+                break;
+            }
+            decompressed.append( block );
+        }
+
+        REQUIRE( decompressed == data );
+        REQUIRE( file.size() == data.size() );
+
+        THEN( "Any part can be read after seek" )
+        {
+            for ( auto offset : { data.size() - 100, 10, firstPart.size() - 5,
+                                  data.size() / 2, 0, firstPart.size() + 20 } ) {
+                REQUIRE( file.seek( offset ) );
+                REQUIRE( file.read( 64 ) == data.mid( offset, 64 ) );
+            }
+        }
+
+        THEN( "Other device reads the same file" )
+        {
+            GzipFile other( compressedFile.fileName() );
+            REQUIRE( other.open( QIODevice::ReadOnly ) );
+            REQUIRE( other.size() == data.size() );
+            REQUIRE( other.seek( data.size() - 1000 ) );
+            REQUIRE( other.read( 2000 ) == data.right( 1000 ) );
+        }
+    }
+}
+
+SCENARIO( "Random access to bgzip file", "[gzipfile]" )
+{
+    const auto data = logLines( 0, 700000 );
+
+    QTemporaryFile compressedFile;
+    REQUIRE( compressedFile.open() );
+    for ( auto offset = 0; offset < data.size(); offset += 0xff00 ) {
+        compressedFile.write( bgzipMember( data.mid( offset, 0xff00 ) ) );
+    }
+    compressedFile.write( bgzipMember( {} ) );
+    compressedFile.close();
+
+    GzipFile file( compressedFile.fileName() );
+    REQUIRE( file.open( QIODevice::ReadOnly ) );
+
+    QByteArray decompressed;
+    while ( !file.atEnd() ) {
+        const auto block = file.read( 1024 * 1024 );
+        if ( block.isEmpty() ) {
+            break;
+        }
+        decompressed.append( block );
+    }
+
+    REQUIRE( decompressed == data );
+    REQUIRE( file.size() == data.size() );
+
+    for ( auto offset : { data.size() - 100, 10, data.size() / 2, 0xff00 - 3, 0 } ) {
+        REQUIRE( file.seek( offset ) );
+        REQUIRE( file.read( 64 ) == data.mid( offset, 64 ) );
+    }
+}
@@ -0,0 +1,260 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+
+#include <QBuffer>
+#include <QDataStream>
+#include <QFile>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+#include <QTextCodec>
+
+#include "configuration.h"
+#include "indexcache.h"
+#include "logdataworker.h"
+
+namespace {
+QByteArray saveIndex( const IndexingData& data )
+{
+    QByteArray saved;
+    QBuffer buffer( &saved );
+    buffer.open( QIODevice::WriteOnly );
+    QDataStream stream( &buffer );
+    stream.setVersion( QDataStream::Qt_5_9 );
+    IndexingData::ConstAccessor( &data ).saveIndex( stream );
+    return saved;
+}
+
+bool loadIndex( QByteArray saved, IndexingData& data, const IndexedHash& hash )
+{
+    QBuffer buffer( &saved );
+    buffer.open( QIODevice::ReadOnly );
+    QDataStream stream( &buffer );
+    stream.setVersion( QDataStream::Qt_5_9 );
+    return IndexingData::MutateAccessor( &data ).loadIndex( stream, hash );
+}
+
+// Line offsets that differ from the ones of the expected index
+int countDifferentLines( const IndexingData& data, const IndexingData& expected )
+{
+    const IndexingData::ConstAccessor accessor( &data );
+    const IndexingData::ConstAccessor expectedAccessor( &expected );
+    auto differentLines = 0;
+    for ( auto i = 0u; i < expectedAccessor.getNbLines().get(); ++i ) {
+        if ( accessor.getEndOfLineOffset( LineNumber( i ) )
+             != expectedAccessor.getEndOfLineOffset( LineNumber( i ) ) ) {
+            ++differentLines;
+        }
+    }
+    return differentLines;
+}
+} // namespace
+
+SCENARIO( "Index saved to cache", "[indexcache]" )
+{
+    QByteArray block;
+    FastLinePositionArray positions;
+    for ( auto i = 0; i < 5000; ++i ) {
+        block.append( "line " + QByteArray::number( i * i ) + '\n' );
+        positions.append( LineOffset( block.size() ) );
+    }
+
+    IndexingData data;
+    IndexingData::MutateAccessor( &data ).addAll( block, 14_length, false, positions,
+                                                  QTextCodec::codecForName( "UTF-8" ) );
+
+    const auto hash = IndexingData::ConstAccessor( &data ).getHash();
+    const auto saved = saveIndex( data );
+
+    WHEN( "Saved index is loaded" )
+    {
+        IndexingData loaded;
+        const auto generation = loaded.getGeneration();
+        REQUIRE( loadIndex( saved, loaded, hash ) );
+        REQUIRE( loaded.getGeneration() != generation );
+
+        THEN( "Line offsets are the same" )
+        {
+            const IndexingData::ConstAccessor original( &data );
+            const IndexingData::ConstAccessor accessor( &loaded );
+            REQUIRE( accessor.getNbLines() == original.getNbLines() );
+            REQUIRE( accessor.getMaxLength() == original.getMaxLength() );
+            for ( auto i = 0u; i < original.getNbLines().get(); ++i ) {
+                REQUIRE( accessor.getEndOfLineOffset( LineNumber( i ) )
+                         == original.getEndOfLineOffset( LineNumber( i ) ) );
+            }
+        }
+    }
+
+    WHEN( "Index is cleared" )
+    {
+        const auto generation = data.getGeneration();
+        IndexingData::MutateAccessor( &data ).clear();
+
+        THEN( "Lines read before are known to be stale" )
+        {
+            REQUIRE( data.getGeneration() != generation );
+        }
+    }
+
+    WHEN( "Saved index is truncated" )
+    {
+        for ( auto size : { 1, saved.size() / 3, saved.size() / 2, saved.size() - 1 } ) {
+            IndexingData loaded;
+            REQUIRE( !loadIndex( saved.left( size ), loaded, hash ) );
+            REQUIRE( IndexingData::ConstAccessor( &loaded ).getNbLines() == 0_lcount );
+        }
+    }
+}
+
+SCENARIO( "Hash saved to cache", "[indexcache]" )
+{
+    IndexedHash hash;
+    hash.size = 150;
+    hash.headerSize = 100;
+    hash.headerDigest = 1;
+    hash.tailSize = 50;
+    hash.tailOffset = 100;
+    hash.tailDigest = 2;
+    hash.blockDigests = { { 0, 100, 3 }, { 100, 50, 4 } };
+    hash.sampleDigests = { { 0, 10, 5 } };
+
+    QByteArray saved;
+    QBuffer buffer( &saved );
+    buffer.open( QIODevice::ReadWrite );
+    QDataStream stream( &buffer );
+
+    WHEN( "Saved hash is loaded" )
+    {
+        IndexCache::saveHash( stream, hash );
+        buffer.seek( 0 );
+
+        const auto loaded = IndexCache::loadHash( stream );
+        REQUIRE( stream.status() == QDataStream::Ok );
+        REQUIRE( loaded.size == hash.size );
+        REQUIRE( loaded.tailDigest == hash.tailDigest );
+        REQUIRE( loaded.blockDigests.size() == 2 );
+        REQUIRE( loaded.blockDigests[ 1 ].offset == 100 );
+        REQUIRE( loaded.blockDigests[ 1 ].digest == 4 );
+        REQUIRE( loaded.sampleDigests.size() == 1 );
+    }
+
+    WHEN( "Count of digests is bigger than the data left" )
+    {
+        stream << hash.size << hash.headerSize << hash.headerDigest << hash.tailSize
+               << hash.tailOffset << hash.tailDigest << hash.lastModified;
+        stream << static_cast<quint64>( 1ull << 60 );
+        stream << hash.blockDigests[ 0 ].offset << hash.blockDigests[ 0 ].size
+               << hash.blockDigests[ 0 ].digest;
+        buffer.seek( 0 );
+
+        const auto loaded = IndexCache::loadHash( stream );
+        REQUIRE( stream.status() != QDataStream::Ok );
+        REQUIRE( loaded.blockDigests.empty() );
+    }
+}
+
+SCENARIO( "Indexing resumed from checkpoint", "[indexcache]" )
+{
+    QStandardPaths::setTestModeEnabled( true );
+
+    auto& config = Configuration::getSynced();
+    const auto useIndexCache = config.useIndexCache();
+    const auto fastModificationDetection = config.fastModificationDetection();
+    const auto checkpointIntervalMb = config.indexCheckpointIntervalMb();
+    config.setUseIndexCache( true );
+    config.setFastModificationDetection( true );
+    config.setIndexCheckpointIntervalMb(
+        static_cast<int>( IndexCache::MinCachedFileSize / 1024 / 1024 ) );
+
+    QTemporaryDir directory;
+    REQUIRE( directory.isValid() );
+    const auto fileName = directory.filePath( "test.log" );
+
+    // Checkpoint is taken at the first interval, the rest is indexed after reopening
+    const auto fileSize = IndexCache::MinCachedFileSize * 3 / 2;
+    {
+        QFile file( fileName );
+        REQUIRE( file.open( QIODevice::WriteOnly ) );
+        QByteArray block;
+        for ( auto i = 0; file.size() + block.size() < fileSize; ++i ) {
+            block.append( "line " + QByteArray::number( i ) + ' ' + QByteArray( i % 97, 'x' )
+                          + '\n' );
+            if ( block.size() > 1024 * 1024 ) {
+                REQUIRE( file.write( block ) == block.size() );
+                block.clear();
+            }
+        }
+        REQUIRE( file.write( block ) == block.size() );
+    }
+
+    AtomicFlag interruptRequest;
+
+    GIVEN( "Indexing interrupted after checkpoint" )
+    {
+        {
+            auto indexingData = std::make_shared<IndexingData>();
+            FullIndexOperation operation( fileName, indexingData, interruptRequest );
+
+            // Progress is reported by the parser before the checkpoint
+            // of the same block, so interrupting past it keeps the checkpoint
+            QObject::connect( &operation, &IndexOperation::indexingProgressed,
+                              [ &interruptRequest ]( int progress ) {
+                                  if ( progress >= 80 ) {
+                                      interruptRequest.set();
+                                  }
+                              } );
+            REQUIRE( !operation.run() );
+        }
+
+        IndexingData checkpoint;
+        {
+            IndexingData::MutateAccessor accessor( &checkpoint );
+            REQUIRE( IndexCache( fileName ).load( accessor ) );
+            REQUIRE( accessor.getIndexedSize() >= IndexCache::MinCachedFileSize );
+            REQUIRE( accessor.getIndexedSize() < fileSize );
+        }
+
+        WHEN( "File is indexed again" )
+        {
+            interruptRequest.clear();
+            auto resumedData = std::make_shared<IndexingData>();
+            REQUIRE( FullIndexOperation( fileName, resumedData, interruptRequest ).run() );
+
+            config.setUseIndexCache( false );
+            auto fullData = std::make_shared<IndexingData>();
+            REQUIRE( FullIndexOperation( fileName, fullData, interruptRequest ).run() );
+
+            THEN( "Line offsets are the same as of the full index" )
+            {
+                const IndexingData::ConstAccessor resumed( resumedData.get() );
+                const IndexingData::ConstAccessor full( fullData.get() );
+                REQUIRE( resumed.getNbLines() == full.getNbLines() );
+                REQUIRE( resumed.getIndexedSize() == full.getIndexedSize() );
+                REQUIRE( resumed.getMaxLength() == full.getMaxLength() );
+                REQUIRE( countDifferentLines( *resumedData, *fullData ) == 0 );
+            }
+        }
+    }
+
+    config.setUseIndexCache( useIndexCache );
+    config.setFastModificationDetection( fastModificationDetection );
+    config.setIndexCheckpointIntervalMb( checkpointIntervalMb );
+}
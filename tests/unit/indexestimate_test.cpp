@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+
+#include <QBuffer>
+
+#include "indexestimate.h"
+
+namespace {
+QByteArray makeLines( int count, int length )
+{
+    QByteArray line( length - 1, 'a' );
+    line.append( '\n' );
+    return line.repeated( count );
+}
+} // namespace
+
+SCENARIO( "Index estimate", "[indexestimate]" )
+{
+    WHEN( "Small file is sampled" )
+    {
+        auto data = makeLines( 1000, 100 );
+        QBuffer buffer( &data );
+        buffer.open( QIODevice::ReadOnly );
+
+        const auto estimate = IndexEstimate::sample( buffer, 0 );
+        REQUIRE( estimate );
+        // Empty text after the last line feed is counted as a line
+        REQUIRE( estimate->lines.get() == 1001 );
+        REQUIRE( estimate->sparseBytes < estimate->compressedBytes );
+    }
+
+    WHEN( "Big file is sampled" )
+    {
+        const auto lineCount = 20 * 1024 * 1024 / 64;
+        auto data = makeLines( lineCount, 64 );
+        QBuffer buffer( &data );
+        buffer.open( QIODevice::ReadOnly );
+
+        const auto estimate = IndexEstimate::sample( buffer, sizeof( uint64_t ) );
+        REQUIRE( estimate );
+        REQUIRE( estimate->lines.get() == Approx( lineCount ).epsilon( 0.01 ) );
+        REQUIRE( estimate->compressedBytes > lineCount * sizeof( uint64_t ) );
+    }
+
+    WHEN( "Empty file is sampled" )
+    {
+        QByteArray data;
+        QBuffer buffer( &data );
+        buffer.open( QIODevice::ReadOnly );
+        REQUIRE( !IndexEstimate::sample( buffer, 0 ) );
+    }
+
+    WHEN( "Storage is chosen" )
+    {
+        IndexEstimate estimate;
+        estimate.compressedBytes = 1000;
+        estimate.sparseBytes = 100;
+
+        REQUIRE( estimate.chooseStorage( 0 ) == IndexEstimate::Storage::Compressed );
+        REQUIRE( estimate.chooseStorage( 1000 ) == IndexEstimate::Storage::Compressed );
+        REQUIRE( estimate.chooseStorage( 500 ) == IndexEstimate::Storage::Sparse );
+        REQUIRE( estimate.chooseStorage( 50 ) == IndexEstimate::Storage::FileBacked );
+    }
+}
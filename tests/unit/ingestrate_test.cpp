@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+
+#include "ingestrate.h"
+
+SCENARIO( "Rate of data appended to followed file", "[ingestrate]" )
+{
+    IngestRate rate;
+
+    WHEN( "Nothing was appended" )
+    {
+        REQUIRE( rate.linesPerSecond( 1000 ) == 0.0 );
+        REQUIRE( rate.refreshIntervalMs( 1000 ) == 0 );
+    }
+
+    WHEN( "File grows steadily" )
+    {
+        rate.reset( 0 );
+        for ( qint64 time = 100; time <= 10000; time += 100 ) {
+            rate.addAppend( time, 10000, 100 );
+        }
+
+        THEN( "Rates approach the growth" )
+        {
+            REQUIRE( rate.bytesPerSecond( 10000 ) == Approx( 100000.0 ).epsilon( 0.01 ) );
+            REQUIRE( rate.linesPerSecond( 10000 ) == Approx( 1000.0 ).epsilon( 0.01 ) );
+        }
+
+        THEN( "Slowly growing file is refreshed immediately" )
+        {
+            REQUIRE( rate.refreshIntervalMs( 10000 ) == 0 );
+        }
+
+        THEN( "Rates drop after file stops growing" )
+        {
+            REQUIRE( rate.linesPerSecond( 10000 + IngestRate::IdleTimeMs + 1 ) == 0.0 );
+        }
+    }
+
+    WHEN( "File grows fast" )
+    {
+        rate.reset( 0 );
+        for ( qint64 time = 250; time <= 10000; time += 250 ) {
+            rate.addAppend( time, 5000000, 50000 );
+        }
+
+        THEN( "Refreshes are batched" )
+        {
+            REQUIRE( rate.refreshIntervalMs( 10000 ) == Approx( 250 ).margin( 3 ) );
+        }
+
+        THEN( "Refreshes are not delayed past the limit" )
+        {
+            for ( qint64 time = 10100; time <= 20000; time += 100 ) {
+                rate.addAppend( time, 50000000, 500000 );
+            }
+            REQUIRE( rate.refreshIntervalMs( 20000 ) == IngestRate::MaxRefreshIntervalMs );
+        }
+    }
+}
@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <catch2/catch.hpp>
+
+#include <memory>
+#include <stdexcept>
+
+#include "jsonquery.h"
+
+namespace {
+bool matches( const char* query, const char* line, bool isCaseSensitive = true )
+{
+    const JsonQueryMatcher matcher(
+        std::make_shared<const JsonQuery>( query, isCaseSensitive ) );
+    return matcher.hasMatch( line );
+}
+} // namespace
+
+SCENARIO( "JSON query matching", "[jsonquery]" )
+{
+    const auto* line = R"({"level":"error","latency_ms":750,"user":{"name":"alice"},)"
+                       R"("tags":["db","slow"],"retry":false,"parent":null})";
+
+    WHEN( "Fields are compared" )
+    {
+        REQUIRE( matches( R"(.level == "error" && .latency_ms > 500)", line ) );
+        REQUIRE( matches( R"(.user.name == "alice")", line ) );
+        REQUIRE( matches( R"(.tags[1] == "slow")", line ) );
+        REQUIRE( matches( R"(.level >= "a" and .latency_ms <= 750)", line ) );
+        REQUIRE_FALSE( matches( R"(.level == "error" && .latency_ms > 1000)", line ) );
+        REQUIRE_FALSE( matches( R"(.level == 1)", line ) );
+    }
+
+    WHEN( "Conditions are combined" )
+    {
+        REQUIRE( matches( R"(.level == "info" || (.retry == false && !.parent))", line ) );
+        REQUIRE( matches( R"(not .retry and .user)", line ) );
+        REQUIRE_FALSE( matches( R"(!(.level == "error"))", line ) );
+    }
+
+    WHEN( "Fields are missing" )
+    {
+        REQUIRE( matches( R"(.missing == null && .user.id != 5)", line ) );
+        REQUIRE_FALSE( matches( R"(.missing < 5)", line ) );
+        REQUIRE_FALSE( matches( R"(.missing)", line ) );
+    }
+
+    WHEN( "Strings are compared ignoring case" )
+    {
+        REQUIRE( matches( R"(.level == "ERROR")", line, false ) );
+        REQUIRE_FALSE( matches( R"(.level == "ERROR")", line, true ) );
+    }
+
+    WHEN( "Line is not a JSON object" )
+    {
+        REQUIRE_FALSE( matches( R"(.level != "info")", "level=error" ) );
+        REQUIRE_FALSE( matches( R"(.level != "info")", R"({"level":)" ) );
+    }
+}
+
+SCENARIO( "JSON query parsing", "[jsonquery]" )
+{
+    REQUIRE( JsonQuery::isJsonQuery( R"(.level == "error")" ) );
+    REQUIRE( JsonQuery::isJsonQuery( R"(!(.retry))" ) );
+    REQUIRE_FALSE( JsonQuery::isJsonQuery( R"("error" and "timeout")" ) );
+    REQUIRE_FALSE( JsonQuery::isJsonQuery( ".*error" ) );
+
+    REQUIRE_THROWS_AS( JsonQuery( R"(.level == )", true ), std::runtime_error );
+    REQUIRE_THROWS_AS( JsonQuery( R"(.level == "error)", true ), std::runtime_error );
+    REQUIRE_THROWS_AS( JsonQuery( R"((.level)", true ), std::runtime_error );
+
+    const JsonQuery query( R"(.log.level == "error" && (.a || .b) && .c != "x")", true );
+    REQUIRE( query.fieldPointers()
+             == std::vector<std::string>{ "/log/level", "/a", "/b", "/c" } );
+    REQUIRE( query.prefilters().size() == 2 );
+    REQUIRE( query.prefilters()[ 0 ].literal() == R"("error")" );
+    REQUIRE( query.prefilters()[ 1 ].literal() == R"("level")" );
+}
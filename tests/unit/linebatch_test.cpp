@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <catch2/catch.hpp>
+
+#include "linebatch.h"
+
+SCENARIO( "Lines in one buffer", "[linebatch]" )
+{
+    LineBatch batch;
+    batch.append( u"first line" );
+    batch.append( QStringView{} );
+    batch.append( QString( "third é line" ) );
+
+    REQUIRE( batch.size() == 3 );
+    REQUIRE( batch.line( 0 ) == QString( "first line" ) );
+    REQUIRE( batch.line( 1 ).isEmpty() );
+    REQUIRE( batch.line( 2 ) == QString( "third é line" ) );
+
+    WHEN( "Line is written to the buffer" )
+    {
+        auto* output = batch.beginLine( 10 );
+        output[ 0 ] = u'o';
+        output[ 1 ] = u'k';
+        batch.finishLine( 2 );
+
+        REQUIRE( batch.size() == 4 );
+        REQUIRE( batch.line( 3 ) == QString( "ok" ) );
+        REQUIRE( batch.line( 0 ) == QString( "first line" ) );
+    }
+
+    WHEN( "Batch is filled again" )
+    {
+        batch.clear();
+        REQUIRE( batch.empty() );
+
+        batch.append( u"new" );
+        REQUIRE( batch.size() == 1 );
+        REQUIRE( batch.line( 0 ) == QString( "new" ) );
+    }
+}
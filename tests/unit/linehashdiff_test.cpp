@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <catch2/catch.hpp>
+
+#include <atomic>
+#include <vector>
+
+#include "linehashdiff.h"
+
+namespace {
+std::vector<LineNumber::UnderlyingType> toVector( const SearchResultArray& lines )
+{
+    std::vector<LineNumber::UnderlyingType> numbers;
+    for ( const auto line : lines ) {
+        numbers.push_back( line );
+    }
+    return numbers;
+}
+
+using Lines = std::vector<LineNumber::UnderlyingType>;
+} // namespace
+
+SCENARIO( "Lines compared by hashes", "[linehashdiff]" )
+{
+    AtomicFlag interruptRequested;
+    std::atomic<uint64_t> processedLines{};
+
+    WHEN( "Hashes are sorted" )
+    {
+        REQUIRE( LineHashDiff::sortedHashes( { 30, 0, 10, 30, 20, 0 } )
+                 == std::vector<uint64_t>{ 10, 20, 30 } );
+        REQUIRE( LineHashDiff::sortedHashes( {} ).empty() );
+    }
+
+    WHEN( "Lines are only in one file" )
+    {
+        const std::vector<uint64_t> first = { 1, 2, 3, 2, 0, 5 };
+        const std::vector<uint64_t> second = { 5, 6, 1, 0, 7 };
+
+        const auto onlyInFirst = LineHashDiff::linesNotIn(
+            first, LineHashDiff::sortedHashes( second ), interruptRequested, processedLines );
+        const auto onlyInSecond = LineHashDiff::linesNotIn(
+            second, LineHashDiff::sortedHashes( first ), interruptRequested, processedLines );
+
+        REQUIRE( toVector( onlyInFirst ) == Lines{ 1, 2, 3 } );
+        REQUIRE( toVector( onlyInSecond ) == Lines{ 1, 4 } );
+        REQUIRE( processedLines.load() == first.size() + second.size() );
+    }
+
+    WHEN( "Lines are in many chunks" )
+    {
+        std::vector<uint64_t> first( 200000 );
+        std::vector<uint64_t> second( 150000 );
+        for ( auto line = 0u; line < first.size(); ++line ) {
+            first[ line ] = line % 1000 + 1;
+        }
+        for ( auto line = 0u; line < second.size(); ++line ) {
+            second[ line ] = line % 999 + 2;
+        }
+
+        const auto onlyInFirst = LineHashDiff::linesNotIn(
+            first, LineHashDiff::sortedHashes( second ), interruptRequested, processedLines );
+
+        REQUIRE( onlyInFirst.cardinality() == first.size() / 1000 );
+        REQUIRE( onlyInFirst.minimum() == 0 );
+        REQUIRE( onlyInFirst.maximum() == first.size() - 1000 );
+    }
+}
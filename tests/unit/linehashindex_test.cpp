@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <catch2/catch.hpp>
+
+#include <QBuffer>
+#include <QDataStream>
+
+#include "linehashindex.h"
+
+SCENARIO( "Line hash index lookups", "[linehashindex]" )
+{
+    LineHashIndex index( true );
+    index.append( { "first line", "repeated line", "repeated line", "Repeated line", {}, "" } );
+
+    REQUIRE( index.size() == 6_lcount );
+
+    WHEN( "Lines are equal" )
+    {
+        REQUIRE( index.hash( 1_lnum ).has_value() );
+        REQUIRE( index.hash( 1_lnum ) == index.hash( 2_lnum ) );
+    }
+
+    WHEN( "Lines are different" )
+    {
+        REQUIRE( index.hash( 0_lnum ) != index.hash( 1_lnum ) );
+        REQUIRE( index.hash( 2_lnum ) != index.hash( 3_lnum ) );
+        REQUIRE( index.hash( 5_lnum ).has_value() );
+    }
+
+    WHEN( "Line text is not known" )
+    {
+        REQUIRE( !index.hash( 4_lnum ).has_value() );
+        REQUIRE( !index.hash( 6_lnum ).has_value() );
+    }
+
+    WHEN( "Last lines are added again" )
+    {
+        index.truncate( 2_lcount );
+        index.append( { "first line" } );
+
+        REQUIRE( index.size() == 3_lcount );
+        REQUIRE( index.hash( 2_lnum ) == index.hash( 0_lnum ) );
+    }
+
+    WHEN( "Index is saved and loaded" )
+    {
+        QBuffer buffer;
+        buffer.open( QIODevice::ReadWrite );
+        QDataStream stream( &buffer );
+        index.save( stream );
+
+        buffer.seek( 0 );
+        LineHashIndex loadedIndex( true );
+        REQUIRE( loadedIndex.load( stream ) );
+        REQUIRE( loadedIndex.size() == 6_lcount );
+        REQUIRE( loadedIndex.hash( 1_lnum ) == index.hash( 1_lnum ) );
+        REQUIRE( !loadedIndex.hash( 4_lnum ).has_value() );
+
+        buffer.seek( 0 );
+        LineHashIndex disabledIndex;
+        REQUIRE( disabledIndex.load( stream ) );
+        REQUIRE( disabledIndex.size() == 0_lcount );
+    }
+}
+
+SCENARIO( "Disabled line hash index", "[linehashindex]" )
+{
+    LineHashIndex index;
+    index.append( { "line" } );
+
+    REQUIRE( index.size() == 0_lcount );
+    REQUIRE( !index.hash( 0_lnum ).has_value() );
+}
@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+
+#include <string>
+
+#include "linelengthindex.h"
+
+SCENARIO( "Line length index lookups", "[linelengthindex]" )
+{
+    const std::string longLine( 1000, 'a' );
+
+    LineLengthIndex index( true );
+    index.append( { "short line", "a\tb\r", longLine, "caf\xc3\xa9", {}, "" } );
+
+    REQUIRE( index.size() == 6_lcount );
+
+    WHEN( "Line is ASCII" )
+    {
+        REQUIRE( index.length( 0_lnum ) == LineLength( 10 ) );
+        REQUIRE( index.length( 5_lnum ) == LineLength( 0 ) );
+    }
+
+    WHEN( "Line has tabs and carriage return" )
+    {
+        REQUIRE( index.length( 1_lnum ) == LineLength( TabStop + 1 ) );
+    }
+
+    WHEN( "Line is long" )
+    {
+        REQUIRE( index.length( 2_lnum ) == LineLength( 1000 ) );
+    }
+
+    WHEN( "Line length is not known" )
+    {
+        REQUIRE( !index.length( 3_lnum ).has_value() );
+        REQUIRE( !index.length( 4_lnum ).has_value() );
+        REQUIRE( !index.length( 6_lnum ).has_value() );
+    }
+
+    WHEN( "Last lines are added again" )
+    {
+        index.truncate( 2_lcount );
+        index.append( { "abc" } );
+
+        REQUIRE( index.size() == 3_lcount );
+        REQUIRE( index.length( 2_lnum ) == LineLength( 3 ) );
+    }
+}
+
+SCENARIO( "Disabled line length index", "[linelengthindex]" )
+{
+    LineLengthIndex index;
+    index.append( { "line" } );
+
+    REQUIRE( index.size() == 0_lcount );
+    REQUIRE( !index.length( 0_lnum ).has_value() );
+}
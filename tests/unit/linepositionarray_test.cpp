@@ -19,6 +19,10 @@
 
 #include <catch2/catch.hpp>
 
+#include <QBuffer>
+#include <QDataStream>
+#include <QTextCodec>
+
 #include "log.h"
 
 #include "linepositionarray.h"
@@ -266,3 +270,467 @@ SCENARIO( "LinePositionArray with UINT32_MAX offsets", "[linepositionarray]" )
         }
     }
 }
+
+SCENARIO( "LinePositionArray with many blocks of lines", "[linepositionarray]" )
+{
+    GIVEN( "LinePositionArray with lines of various sizes" )
+    {
+        std::mt19937 g( 42 );
+        std::uniform_int_distribution<int64_t> shortLine( 1, 200 );
+        std::uniform_int_distribution<int64_t> longLine( 1, 100000 );
+
+        std::vector<LineOffset> offsets;
+        LinePositionArray line_array;
+
+        int64_t pos = 0;
+        for ( auto i = 0; i < 10000; ++i ) {
+            pos += ( i % 100 == 0 ) ? longLine( g ) : shortLine( g );
+            offsets.emplace_back( pos );
+            line_array.append( offsets.back() );
+        }
+
+        WHEN( "Access items in random order" )
+        {
+            std::uniform_int_distribution<size_t> index( 0, offsets.size() - 1 );
+
+            THEN( "Corrent offsets returned" )
+            {
+                for ( auto i = 0; i < 10000; ++i ) {
+                    const auto lineIndex = index( g );
+                    REQUIRE( line_array.at( lineIndex ) == offsets[ lineIndex ] );
+                }
+            }
+        }
+
+        WHEN( "Access items by range" )
+        {
+            std::vector<qint64> positions;
+            line_array.range( 1000_lnum, 3000_lcount, positions );
+
+            THEN( "Corrent offsets returned" )
+            {
+                REQUIRE( positions.size() == 3000 );
+                for ( auto i = 0u; i < positions.size(); ++i ) {
+                    REQUIRE( LineOffset( positions[ i ] ) == offsets[ 1000 + i ] );
+                }
+            }
+        }
+
+        WHEN( "Truncating at the end of a line" )
+        {
+            line_array.truncate( offsets[ 2999 ].get() );
+
+            THEN( "Lines after it are dropped" )
+            {
+                REQUIRE( line_array.size() == 3000_lcount );
+                REQUIRE( line_array.at( 2999 ) == offsets[ 2999 ] );
+            }
+        }
+
+        WHEN( "Truncating in the middle of a line" )
+        {
+            const auto size = ( offsets[ 2999 ].get() + offsets[ 3000 ].get() ) / 2;
+            line_array.truncate( size );
+            line_array.append( offsets[ 3000 ] );
+
+            THEN( "Fake line feed is replaced by the line continued after it" )
+            {
+                REQUIRE( line_array.size() == 3001_lcount );
+                REQUIRE( line_array.at( 2999 ) == offsets[ 2999 ] );
+                REQUIRE( line_array.at( 3000 ) == offsets[ 3000 ] );
+            }
+        }
+    }
+}
+
+SCENARIO( "LinePositionArray appending lists of whole blocks", "[linepositionarray]" )
+{
+    std::mt19937 g( 42 );
+    std::uniform_int_distribution<int64_t> lineLength( 1, 300 );
+    std::uniform_int_distribution<int64_t> longLine( 1, 1LL << 40 );
+
+    const auto makeList = [ & ]( int64_t& pos, size_t count ) {
+        FastLinePositionArray list;
+        for ( auto i = 0u; i < count; ++i ) {
+            pos += ( i % 500 == 0 ) ? longLine( g ) % 100000 : lineLength( g );
+            list.append( LineOffset( pos ) );
+        }
+        return list;
+    };
+
+    const auto requireSame = []( const LinePositionArray& batch,
+                                 const LinePositionArray& oneByOne ) {
+        REQUIRE( batch.size() == oneByOne.size() );
+        for ( auto i = 0u; i < oneByOne.size().get(); ++i ) {
+            REQUIRE( batch.at( i ) == oneByOne.at( i ) );
+        }
+        std::vector<qint64> positions;
+        batch.range( 0_lnum, batch.size(), positions );
+        REQUIRE( positions.size() == batch.size().get() );
+        REQUIRE( LineOffset( positions.back() ) == oneByOne.at( oneByOne.size().get() - 1 ) );
+    };
+
+    GIVEN( "Array with part of a block" )
+    {
+        int64_t pos = 0;
+        LinePositionArray batch;
+        LinePositionArray oneByOne;
+        for ( auto i = 0; i < 100; ++i ) {
+            pos += lineLength( g );
+            batch.append( LineOffset( pos ) );
+            oneByOne.append( LineOffset( pos ) );
+        }
+
+        WHEN( "Appending lists of several blocks" )
+        {
+            for ( auto count : { 1000u, 256u, 7u, 2048u } ) {
+                const auto list = makeList( pos, count );
+                batch.append_list( list );
+                for ( auto i = 0u; i < count; ++i ) {
+                    oneByOne.append( list.at( i ) );
+                }
+            }
+
+            THEN( "Positions are the same as appended one by one" )
+            {
+                requireSame( batch, oneByOne );
+            }
+        }
+
+        WHEN( "Appending list crossing UINT32_MAX" )
+        {
+            pos = static_cast<int64_t>( UINT32_MAX ) - 1000 * 100;
+            const auto list = makeList( pos, 3000 );
+            batch.append_list( list );
+            for ( auto i = 0u; i < 3000; ++i ) {
+                oneByOne.append( list.at( i ) );
+            }
+
+            THEN( "Positions are the same as appended one by one" )
+            {
+                requireSame( batch, oneByOne );
+                REQUIRE( batch.at( 3099 ) == LineOffset( pos ) );
+            }
+        }
+
+        WHEN( "Appending list with very long lines" )
+        {
+            FastLinePositionArray list;
+            for ( auto i = 0u; i < 600; ++i ) {
+                pos += longLine( g );
+                list.append( LineOffset( pos ) );
+            }
+            batch.append_list( list );
+            for ( auto i = 0u; i < 600; ++i ) {
+                oneByOne.append( list.at( i ) );
+            }
+
+            THEN( "Positions are the same as appended one by one" )
+            {
+                requireSame( batch, oneByOne );
+            }
+        }
+    }
+}
+
+SCENARIO( "LinePositionArray saved and loaded", "[linepositionarray]" )
+{
+    std::mt19937 g( 42 );
+    std::uniform_int_distribution<int64_t> lineLength( 1, 300 );
+
+    LinePositionArray line_array;
+    int64_t pos = 0;
+    for ( auto i = 0u; i < 3000; ++i ) {
+        pos += ( i == 1500 ) ? static_cast<int64_t>( UINT32_MAX ) : lineLength( g );
+        line_array.append( LineOffset( pos ) );
+    }
+    line_array.setFakeFinalLF();
+
+    QByteArray data;
+    {
+        QBuffer buffer( &data );
+        buffer.open( QIODevice::WriteOnly );
+        QDataStream stream( &buffer );
+        line_array.save( stream );
+    }
+
+    WHEN( "Saved data is loaded" )
+    {
+        QBuffer buffer( &data );
+        buffer.open( QIODevice::ReadOnly );
+        QDataStream stream( &buffer );
+
+        LinePositionArray loaded;
+        REQUIRE( loaded.load( stream ) );
+
+        THEN( "Positions are the same" )
+        {
+            REQUIRE( loaded.size() == line_array.size() );
+            for ( auto i = 0u; i < line_array.size().get(); ++i ) {
+                REQUIRE( loaded.at( i ) == line_array.at( i ) );
+            }
+        }
+    }
+
+    WHEN( "Saved data is truncated" )
+    {
+        for ( auto size : { 1, data.size() / 4, data.size() / 2, data.size() - 1 } ) {
+            auto truncated = data.left( size );
+            QBuffer buffer( &truncated );
+            buffer.open( QIODevice::ReadOnly );
+            QDataStream stream( &buffer );
+
+            LinePositionArray loaded;
+            REQUIRE( !loaded.load( stream ) );
+        }
+    }
+}
+
+SCENARIO( "SparseLinePositionArray compared to LinePositionArray", "[linepositionarray]" )
+{
+    constexpr auto Interval = SparseLinePositionStorage::CheckpointInterval;
+
+    std::mt19937 g( 42 );
+    std::uniform_int_distribution<int> lineLength( 0, 100 );
+
+    QByteArray data;
+    std::vector<LineOffset> ends;
+    const auto appendLines = [ & ]( size_t count ) {
+        for ( auto i = 0u; i < count; ++i ) {
+            data.append( QByteArray( lineLength( g ), 'a' ) );
+            data.append( '\n' );
+            ends.push_back( LineOffset( data.size() ) );
+        }
+    };
+
+    const auto makeSparse = [ &data ]() {
+        SparseLinePositionArray sparse{ SparseLinePositionStorage(
+            [ &data ]( LineOffset::UnderlyingType offset, LineOffset::UnderlyingType size ) {
+                return data.mid( static_cast<int>( offset ), static_cast<int>( size ) );
+            } ) };
+        sparse.storage().setEncodingParameters(
+            EncodingParameters( QTextCodec::codecForName( "UTF-8" ) ) );
+        return sparse;
+    };
+
+    const auto requireSame = []( const SparseLinePositionArray& sparse,
+                                 const LinePositionArray& compressed ) {
+        REQUIRE( sparse.size() == compressed.size() );
+        for ( auto i = 0u; i < compressed.size().get(); ++i ) {
+            REQUIRE( sparse.at( i ) == compressed.at( i ) );
+        }
+        std::vector<qint64> sparseRange;
+        std::vector<qint64> compressedRange;
+        sparse.range( 0_lnum, sparse.size(), sparseRange );
+        compressed.range( 0_lnum, compressed.size(), compressedRange );
+        REQUIRE( sparseRange == compressedRange );
+    };
+
+    auto sparse = makeSparse();
+    LinePositionArray compressed;
+
+    GIVEN( "Two full blocks of lines and a tail" )
+    {
+        appendLines( 2 * Interval + 100 );
+        for ( auto end : ends ) {
+            sparse.append( end );
+            compressed.append( end );
+        }
+
+        THEN( "Positions are the same" )
+        {
+            requireSame( sparse, compressed );
+        }
+
+        WHEN( "Last lines are popped across a checkpoint" )
+        {
+            for ( auto i = 0; i < 110; ++i ) {
+                sparse.storage().pop_back();
+                compressed.storage().pop_back();
+            }
+
+            THEN( "Positions of the last block are restored" )
+            {
+                requireSame( sparse, compressed );
+                REQUIRE( sparse.at( 2 * Interval - 11 ) == ends[ 2 * Interval - 11 ] );
+            }
+
+            AND_WHEN( "Lines are appended again" )
+            {
+                for ( auto i = 2 * Interval - 10; i < ends.size(); ++i ) {
+                    sparse.append( ends[ i ] );
+                    compressed.append( ends[ i ] );
+                }
+                requireSame( sparse, compressed );
+            }
+        }
+
+        WHEN( "Positions are saved and loaded" )
+        {
+            QByteArray saved;
+            {
+                QBuffer buffer( &saved );
+                buffer.open( QIODevice::WriteOnly );
+                QDataStream stream( &buffer );
+                sparse.save( stream );
+            }
+
+            QBuffer buffer( &saved );
+            buffer.open( QIODevice::ReadOnly );
+            QDataStream stream( &buffer );
+
+            auto loaded = makeSparse();
+            REQUIRE( loaded.load( stream ) );
+            requireSame( loaded, compressed );
+
+            auto truncated = saved.left( saved.size() - 1 );
+            QBuffer truncatedBuffer( &truncated );
+            truncatedBuffer.open( QIODevice::ReadOnly );
+            QDataStream truncatedStream( &truncatedBuffer );
+            REQUIRE( !makeSparse().load( truncatedStream ) );
+        }
+
+        WHEN( "Missing blocks are decoded outside of the storage" )
+        {
+            auto missing = sparse.storage().missingBlocks( 0_lnum, sparse.size() );
+            REQUIRE( missing.blocks.size() == 2 );
+            missing.decode();
+            sparse.storage().addDecodedBlocks( missing );
+
+            THEN( "Decoded blocks are kept" )
+            {
+                REQUIRE( sparse.storage().missingBlocks( 0_lnum, sparse.size() ).blocks.empty() );
+                requireSame( sparse, compressed );
+            }
+        }
+
+        WHEN( "Storage changes while missing blocks are decoded" )
+        {
+            auto missing = sparse.storage().missingBlocks( 0_lnum, sparse.size() );
+            missing.decode();
+            for ( auto i = 0; i < 110; ++i ) {
+                sparse.storage().pop_back();
+                compressed.storage().pop_back();
+            }
+            sparse.storage().addDecodedBlocks( missing );
+
+            THEN( "Only blocks that are not changed are kept" )
+            {
+                REQUIRE( sparse.storage().missingBlocks( 0_lnum, sparse.size() ).blocks.empty() );
+                requireSame( sparse, compressed );
+            }
+        }
+
+        WHEN( "File changed and a block has less lines" )
+        {
+            data[ static_cast<int>( ends[ 10 ].get() ) - 1 ] = 'a';
+
+            THEN( "Lines past the end of short block end at the checkpoint" )
+            {
+                REQUIRE( sparse.at( 9 ) == ends[ 9 ] );
+                REQUIRE( sparse.at( 10 ) == ends[ 11 ] );
+                REQUIRE( sparse.at( Interval - 2 ) == ends[ Interval - 1 ] );
+                REQUIRE( sparse.at( Interval - 1 ) == ends[ Interval - 1 ] );
+                REQUIRE( sparse.at( Interval + 10 ) == ends[ Interval + 10 ] );
+            }
+        }
+    }
+
+    GIVEN( "File without final line feed ending at a checkpoint" )
+    {
+        appendLines( Interval );
+        data.chop( 1 );
+        ends.back() = LineOffset( data.size() + 1 );
+        for ( auto end : ends ) {
+            sparse.append( end );
+            compressed.append( end );
+        }
+        sparse.setFakeFinalLF();
+        compressed.setFakeFinalLF();
+
+        THEN( "Positions are the same" )
+        {
+            requireSame( sparse, compressed );
+        }
+
+        WHEN( "Last line is completed and more lines are appended" )
+        {
+            FastLinePositionArray list;
+            data.append( '\n' );
+            const auto completedEnd = LineOffset( data.size() );
+            list.append( completedEnd );
+            appendLines( 10 );
+            for ( auto i = Interval; i < ends.size(); ++i ) {
+                list.append( ends[ i ] );
+            }
+
+            sparse.append_list( list );
+            compressed.append_list( list );
+
+            THEN( "Fake line feed is replaced" )
+            {
+                requireSame( sparse, compressed );
+                REQUIRE( sparse.at( Interval - 1 ) == completedEnd );
+            }
+        }
+    }
+}
+
+TEST_CASE( "LinePositionArray access performance", "[.][benchmark]" )
+{
+    std::mt19937 g( 42 );
+    std::uniform_int_distribution<int64_t> lineLength( 20, 200 );
+
+    const auto linesCount = 10'000'000u;
+
+    LinePositionArray compressedArray;
+    FastLinePositionArray plainArray;
+
+    int64_t pos = 0;
+    for ( auto i = 0u; i < linesCount; ++i ) {
+        pos += lineLength( g );
+        compressedArray.append( LineOffset( pos ) );
+        plainArray.append( LineOffset( pos ) );
+    }
+
+    std::uniform_int_distribution<uint32_t> index( 0, linesCount - 1 );
+    std::vector<uint32_t> randomIndex( 100000 );
+    std::generate( randomIndex.begin(), randomIndex.end(), [ & ] { return index( g ); } );
+
+    BENCHMARK( "Compressed sequential access" )
+    {
+        CompressedLinePositionStorage::Cache cache;
+        int64_t sum = 0;
+        for ( auto i = 0u; i < linesCount; ++i ) {
+            sum += compressedArray.at( i, &cache ).get();
+        }
+        return sum;
+    };
+
+    BENCHMARK( "Uncompressed sequential access" )
+    {
+        int64_t sum = 0;
+        for ( auto i = 0u; i < linesCount; ++i ) {
+            sum += plainArray.at( i ).get();
+        }
+        return sum;
+    };
+
+    BENCHMARK( "Compressed random access" )
+    {
+        int64_t sum = 0;
+        for ( auto i : randomIndex ) {
+            sum += compressedArray.at( i ).get();
+        }
+        return sum;
+    };
+
+    BENCHMARK( "Uncompressed random access" )
+    {
+        int64_t sum = 0;
+        for ( auto i : randomIndex ) {
+            sum += plainArray.at( i ).get();
+        }
+        return sum;
+    };
+}
@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+
+#include <string>
+
+#include "lineprefilter.h"
+
+namespace {
+std::string stripBytes( const LinePrefilter& prefilter, std::string text )
+{
+    text.resize( prefilter.stripBytes( text.data(), text.size(), text.data() ) );
+    return text;
+}
+} // namespace
+
+SCENARIO( "ANSI color sequences prefilter", "[lineprefilter]" )
+{
+    const LinePrefilter prefilter( LinePrefilter::AnsiColorSequences );
+    REQUIRE( prefilter.isActive() );
+    REQUIRE( prefilter.canStripBytes() );
+
+    WHEN( "Line has color sequences" )
+    {
+        REQUIRE( stripBytes( prefilter, "\x1B[31merror\x1B[0m: failed" ) == "error: failed" );
+        REQUIRE( stripBytes( prefilter, "\x1B[1;32mok\x1B[m\x1B[K" ) == "ok" );
+        REQUIRE( stripBytes( prefilter, "\x1B[0M\x1B[1k" ) == "" );
+        REQUIRE( stripBytes( prefilter, "\x1B[38;5;196mred\x1B[48;2;0;0;255m" ) == "red" );
+    }
+
+    WHEN( "Escape character doesn't start color sequence" )
+    {
+        REQUIRE( stripBytes( prefilter, "\x1B[1234m" ) == "\x1B[1234m" );
+        REQUIRE( stripBytes( prefilter, "\x1B[1;m" ) == "\x1B[1;m" );
+        REQUIRE( stripBytes( prefilter, "a\x1B" ) == "a\x1B" );
+        REQUIRE( stripBytes( prefilter, "\x1B\x1B[2m" ) == "\x1B" );
+    }
+
+    WHEN( "Line has no escape characters" )
+    {
+        REQUIRE( stripBytes( prefilter, "plain line" ) == "plain line" );
+    }
+}
+
+SCENARIO( "Regular expression prefilter", "[lineprefilter]" )
+{
+    const LinePrefilter prefilter( "^\\d+ " );
+    REQUIRE( prefilter.isActive() );
+    REQUIRE_FALSE( prefilter.canStripBytes() );
+
+    QString line = "12345 message";
+    prefilter.strip( line );
+    REQUIRE( line == "message" );
+}
@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+
+#include <string>
+
+#include "literalprefilter.h"
+
+SCENARIO( "Required literal of regular expression", "[literalprefilter]" )
+{
+    WHEN( "Pattern is a sequence of characters" )
+    {
+        REQUIRE( LiteralPrefilter::requiredLiteral( "error" ) == "error" );
+        REQUIRE( LiteralPrefilter::requiredLiteral( "^err: \\d+ failed$" ) == " failed" );
+        REQUIRE( LiteralPrefilter::requiredLiteral( "a\\.b" ) == "a.b" );
+    }
+
+    WHEN( "Characters are optional or repeated" )
+    {
+        REQUIRE( LiteralPrefilter::requiredLiteral( "errors?" ) == "error" );
+        REQUIRE( LiteralPrefilter::requiredLiteral( "ab*cd" ) == "cd" );
+        REQUIRE( LiteralPrefilter::requiredLiteral( "abc+d" ) == "abc" );
+        REQUIRE( LiteralPrefilter::requiredLiteral( "abcx{0,3}y" ) == "abc" );
+    }
+
+    WHEN( "Pattern has groups and classes" )
+    {
+        REQUIRE( LiteralPrefilter::requiredLiteral( "(foo|bar) request [0-9a-f]+ done" )
+                 == " request " );
+        REQUIRE( LiteralPrefilter::requiredLiteral( "[]x] timeout" ) == " timeout" );
+        REQUIRE( LiteralPrefilter::requiredLiteral( "[[:alpha:]]+ timeout" ) == " timeout" );
+    }
+
+    WHEN( "Pattern has no required literal" )
+    {
+        REQUIRE( LiteralPrefilter::requiredLiteral( "error|warning" ).empty() );
+        REQUIRE( LiteralPrefilter::requiredLiteral( "(?i)error" ).empty() );
+        REQUIRE( LiteralPrefilter::requiredLiteral( "\\Qa.b\\E" ).empty() );
+        REQUIRE( LiteralPrefilter::requiredLiteral( ".*" ).empty() );
+    }
+
+    WHEN( "Pattern has escapes with arguments" )
+    {
+        REQUIRE( LiteralPrefilter::requiredLiteral( "\\x41BC" ).empty() );
+        REQUIRE( LiteralPrefilter::requiredLiteral( "\\x{263A}ok" ).empty() );
+        REQUIRE( LiteralPrefilter::requiredLiteral( "(?<n>ab)\\k<n>" ).empty() );
+        REQUIRE( LiteralPrefilter::requiredLiteral( "\\cAz" ).empty() );
+        REQUIRE( LiteralPrefilter::requiredLiteral( "\\012abc" ).empty() );
+    }
+}
+
+SCENARIO( "Literal prefilter", "[literalprefilter]" )
+{
+    WHEN( "Pattern is case sensitive" )
+    {
+        LiteralPrefilter prefilter( "conn.* refused", false, true );
+        REQUIRE( prefilter.mayMatch( "connection refused" ) );
+        REQUIRE_FALSE( prefilter.mayMatch( "connection REFUSED" ) );
+    }
+
+    WHEN( "Pattern is case insensitive" )
+    {
+        LiteralPrefilter prefilter( "Timeout", true, false );
+        REQUIRE( prefilter.literal() == "timeout" );
+        REQUIRE( prefilter.mayMatch( "read TIMEOUT" ) );
+        REQUIRE_FALSE( prefilter.mayMatch( "read time out" ) );
+    }
+
+    WHEN( "Letters can match non ASCII text" )
+    {
+        LiteralPrefilter prefilter( "disk", true, false );
+        REQUIRE( prefilter.literal() == "di" );
+    }
+}
+
+SCENARIO( "Plain text search", "[literalprefilter]" )
+{
+    const std::string prefix( 100, '.' );
+
+    WHEN( "Plain text is searched case sensitively" )
+    {
+        LiteralPrefilter prefilter( "a.b", true, true );
+        REQUIRE( prefilter.isExact() );
+        REQUIRE( prefilter.mayMatch( prefix + "a.b" ) );
+        REQUIRE( prefilter.mayMatch( "a.b" + prefix ) );
+        REQUIRE_FALSE( prefilter.mayMatch( prefix + "axb" + prefix ) );
+        REQUIRE_FALSE( prefilter.mayMatch( prefix + "A.b" ) );
+    }
+
+    WHEN( "Plain text is searched case insensitively" )
+    {
+        LiteralPrefilter prefilter( "Error:", true, false );
+        REQUIRE( prefilter.isExact() );
+        REQUIRE( prefilter.mayMatch( prefix + "ERROR:" + prefix ) );
+        REQUIRE( prefilter.mayMatch( "eRRoR:" ) );
+        REQUIRE_FALSE( prefilter.mayMatch( prefix + "error;" + prefix ) );
+        REQUIRE_FALSE( prefilter.mayMatch( prefix + "%RROR:" ) );
+    }
+
+    WHEN( "Plain text can't be searched by bytes" )
+    {
+        REQUIRE_FALSE( LiteralPrefilter( "disk", true, false ).isExact() );
+        REQUIRE_FALSE( LiteralPrefilter( "ошибка", true, false ).isExact() );
+        REQUIRE_FALSE( LiteralPrefilter( "error", false, true ).isExact() );
+    }
+}
@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+
+#include <vector>
+
+#include "mergedlinemap.h"
+
+SCENARIO( "Lines of merged files", "[mergedlinemap]" )
+{
+    // Three files interleaved over several checkpoints
+    const auto linesCount = MergedLineMap::CheckpointInterval * 3 + 17;
+    std::vector<size_t> sources;
+    for ( auto index = 0u; index < linesCount; ++index ) {
+        sources.push_back( ( index * 7 / 5 ) % 3 );
+    }
+
+    MergedLineMap lineMap( 3 );
+    for ( const auto source : sources ) {
+        lineMap.append( source );
+    }
+
+    REQUIRE( lineMap.size() == LinesCount( linesCount ) );
+
+    WHEN( "Merged lines are mapped to lines of files" )
+    {
+        std::vector<LineNumber::UnderlyingType> sourceLines( 3 );
+        for ( auto index = 0u; index < linesCount; ++index ) {
+            const auto sourceLine = lineMap.sourceLine( LineNumber( index ) );
+            REQUIRE( sourceLine.source == sources[ index ] );
+            REQUIRE( sourceLine.line == LineNumber( sourceLines[ sources[ index ] ]++ ) );
+
+            REQUIRE( lineMap.mergedLine( sourceLine.source, sourceLine.line )
+                     == LineNumber( index ) );
+        }
+
+        REQUIRE_FALSE( lineMap.mergedLine( 0, LineNumber( sourceLines[ 0 ] ) ) );
+    }
+
+    WHEN( "Merged lines are split into runs" )
+    {
+        const auto first = LineNumber( MergedLineMap::CheckpointInterval - 3 );
+        const auto runs = lineMap.runs( first, 10_lcount );
+
+        auto index = first.get();
+        for ( const auto& run : runs ) {
+            for ( auto line = 0u; line < run.count.get(); ++line, ++index ) {
+                REQUIRE( run.source == sources[ index ] );
+                REQUIRE( lineMap.sourceLine( LineNumber( index ) ).line
+                         == run.firstLine + LinesCount( line ) );
+            }
+        }
+        REQUIRE( index == first.get() + 10 );
+    }
+}
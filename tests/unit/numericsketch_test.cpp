@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+
+#include <cmath>
+
+#include "numericsketch.h"
+
+namespace {
+bool isClose( double value, double expected )
+{
+    return std::abs( value - expected ) <= std::abs( expected ) * NumericSketch::RelativeAccuracy;
+}
+} // namespace
+
+SCENARIO( "Numeric sketch quantiles", "[numericsketch]" )
+{
+    NumericSketch sketch;
+
+    WHEN( "Sketch is empty" )
+    {
+        REQUIRE( sketch.count() == 0 );
+        REQUIRE( sketch.quantile( 0.5 ) == 0.0 );
+        REQUIRE( sketch.max() == 0.0 );
+    }
+
+    WHEN( "Numbers from 1 to 1000 are added" )
+    {
+        for ( auto value = 1; value <= 1000; ++value ) {
+            sketch.add( value );
+        }
+
+        REQUIRE( sketch.count() == 1000 );
+        REQUIRE( sketch.min() == 1.0 );
+        REQUIRE( sketch.max() == 1000.0 );
+        REQUIRE( sketch.mean() == 500.5 );
+        REQUIRE( isClose( sketch.quantile( 0.5 ), 500 ) );
+        REQUIRE( isClose( sketch.quantile( 0.99 ), 990 ) );
+        REQUIRE( sketch.quantile( 0.0 ) == 1.0 );
+        REQUIRE( sketch.quantile( 1.0 ) == 1000.0 );
+    }
+
+    WHEN( "Numbers have different signs" )
+    {
+        for ( const auto value : { -200.0, -10.0, 0.0, 0.0, 30.0 } ) {
+            sketch.add( value );
+        }
+
+        REQUIRE( isClose( sketch.quantile( 0.0 ), -200 ) );
+        REQUIRE( isClose( sketch.quantile( 0.25 ), -10 ) );
+        REQUIRE( sketch.quantile( 0.5 ) == 0.0 );
+        REQUIRE( isClose( sketch.quantile( 1.0 ), 30 ) );
+    }
+
+    WHEN( "Value is not finite" )
+    {
+        sketch.add( std::nan( "" ) );
+        sketch.add( INFINITY );
+
+        REQUIRE( sketch.count() == 0 );
+    }
+}
+
+SCENARIO( "Merged numeric sketches", "[numericsketch]" )
+{
+    NumericSketch all;
+    NumericSketch even;
+    NumericSketch odd;
+    for ( auto value = 1; value <= 500; ++value ) {
+        all.add( value * 1.5 );
+        ( value % 2 == 0 ? even : odd ).add( value * 1.5 );
+    }
+
+    NumericSketch merged;
+    merged.merge( even );
+    merged.merge( odd );
+
+    REQUIRE( merged.count() == all.count() );
+    REQUIRE( merged.min() == all.min() );
+    REQUIRE( merged.max() == all.max() );
+    REQUIRE( merged.sum() == all.sum() );
+    for ( const auto q : { 0.1, 0.5, 0.9, 0.95, 0.99 } ) {
+        REQUIRE( merged.quantile( q ) == all.quantile( q ) );
+    }
+}
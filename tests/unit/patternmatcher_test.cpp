@@ -19,6 +19,12 @@
 
 #include <catch2/catch.hpp>
 
+#include <algorithm>
+#include <array>
+#include <string>
+#include <utility>
+#include <vector>
+
 #include "regularexpression.h"
 
 SCENARIO( "Pattern matcher in boolean mode", "[patternmatcher]" )
@@ -49,6 +55,16 @@ SCENARIO( "Pattern matcher in boolean mode", "[patternmatcher]" )
         REQUIRE_FALSE( matcher->hasMatch( matchLine ) );
     }
 
+    WHEN( "Using many patterns" )
+    {
+        RegularExpression expression( RegularExpressionPattern(
+            "\"This\" and not (\"q\" or \"w\" or \"y\" or \"z\") and \"pattern\"", false,
+            false, true, true ) );
+        const auto matcher = expression.createMatcher();
+        REQUIRE( matcher->hasMatch( matchLine ) );
+        REQUIRE_FALSE( matcher->hasMatch( "\"This\" is z pattern" ) );
+    }
+
     WHEN( "Using pattern with escaped quotes" )
     {
         RegularExpression expression(
@@ -65,3 +81,170 @@ SCENARIO( "Pattern matcher in boolean mode", "[patternmatcher]" )
         REQUIRE_FALSE( expression.isValid() );
     }
 }
+
+SCENARIO( "Pattern matcher with lookarounds", "[patternmatcher]" )
+{
+    WHEN( "Pattern has negative lookahead" )
+    {
+        RegularExpression expression(
+            RegularExpressionPattern( "error(?!: retrying)", true, false, false, false ) );
+        REQUIRE( expression.isValid() );
+
+        const auto matcher = expression.createMatcher();
+        REQUIRE( matcher->hasMatch( "connection error: closed" ) );
+        REQUIRE_FALSE( matcher->hasMatch( "connection error: retrying" ) );
+        REQUIRE_FALSE( matcher->hasMatch( "connection closed" ) );
+    }
+
+    WHEN( "Pattern has backreference" )
+    {
+        RegularExpression expression(
+            RegularExpressionPattern( "(\\w+) \\1", true, false, false, false ) );
+        REQUIRE( expression.isValid() );
+
+        const auto matcher = expression.createMatcher();
+        REQUIRE( matcher->hasMatch( "retry retry failed" ) );
+        REQUIRE_FALSE( matcher->hasMatch( "retry once failed" ) );
+    }
+
+    WHEN( "Lookbehind is one of boolean patterns" )
+    {
+        RegularExpression expression( RegularExpressionPattern(
+            "\"(?<=user=)admin\" and not \"denied\"", true, false, true, false ) );
+        REQUIRE( expression.isValid() );
+
+        const auto matcher = expression.createMatcher();
+        REQUIRE( matcher->hasMatch( "user=admin granted" ) );
+        REQUIRE_FALSE( matcher->hasMatch( "user=admin denied" ) );
+        REQUIRE_FALSE( matcher->hasMatch( "group=admin granted" ) );
+    }
+}
+
+SCENARIO( "Pattern matcher evaluating boolean combination lazily", "[patternmatcher]" )
+{
+    // First lines are matched with all patterns, the rest
+    // only with patterns needed to know the outcome
+    std::vector<std::string> lines;
+    for ( auto index = 0; index < 5000; ++index ) {
+        std::string line = "line " + std::to_string( index );
+        if ( index % 3 == 0 ) {
+            line += " error";
+        }
+        if ( index % 5 == 0 ) {
+            line += " retrying";
+        }
+        if ( index % 7 == 0 ) {
+            line += " user=admin";
+        }
+        lines.push_back( std::move( line ) );
+    }
+
+    const auto countMatches = []( const RegularExpression& expression,
+                                  const std::vector<std::string>& matchedLines ) {
+        const auto matcher = expression.createMatcher();
+        return std::count_if(
+            matchedLines.begin(), matchedLines.end(),
+            [ &matcher ]( const auto& line ) { return matcher->hasMatch( line ); } );
+    };
+
+    WHEN( "Patterns are combined with and" )
+    {
+        RegularExpression expression( RegularExpressionPattern(
+            "\"err[o]r\" and not \"retry(ing)?\"", true, false, true, false ) );
+        REQUIRE( expression.isValid() );
+        REQUIRE( countMatches( expression, lines ) == 1333 );
+    }
+
+    WHEN( "Patterns are combined with or" )
+    {
+        RegularExpression expression( RegularExpressionPattern(
+            "\"(?<=user=)admin\" or (\"err[o]r\" and \"retry(ing)?\")", true, false, true,
+            false ) );
+        REQUIRE( expression.isValid() );
+        REQUIRE( countMatches( expression, lines ) == 1001 );
+    }
+}
+
+SCENARIO( "Pattern matcher on lines of a chunk", "[patternmatcher]" )
+{
+    const std::vector<std::string_view> lines{ "error: disk full", "request done", "error: timeout",
+                                               "request started" };
+
+    const auto matchLines = []( const RegularExpressionPattern& pattern,
+                                const std::vector<std::string_view>& chunkLines ) {
+        RegularExpression expression( pattern );
+        const auto matcher = expression.createMatcher();
+
+        std::vector<uint32_t> matchingLines;
+        std::vector<uint32_t> rejectedLines;
+        matcher->withSpecializedMatcher( [ & ]( const auto& specialized ) {
+            specialized.matchLines( chunkLines, matchingLines );
+            specialized.rejectLines( chunkLines, rejectedLines );
+        } );
+        return std::make_pair( matchingLines, rejectedLines );
+    };
+
+    WHEN( "Search is not inverse" )
+    {
+        const auto [ matching, rejected ]
+            = matchLines( RegularExpressionPattern( "error", true, false, false, true ), lines );
+        REQUIRE( matching == std::vector<uint32_t>{ 0, 2 } );
+        REQUIRE( rejected == std::vector<uint32_t>{ 1, 3 } );
+    }
+
+    WHEN( "Search is inverse" )
+    {
+        const auto [ matching, rejected ]
+            = matchLines( RegularExpressionPattern( "error", true, true, false, true ), lines );
+        REQUIRE( matching == std::vector<uint32_t>{ 1, 3 } );
+        REQUIRE( rejected == std::vector<uint32_t>{ 0, 2 } );
+    }
+
+    WHEN( "Matching is interrupted" )
+    {
+        const std::vector<std::string_view> manyLines( 10'000, "error: disk full" );
+        RegularExpression expression(
+            RegularExpressionPattern( "err(o|u)r", true, false, false, false ) );
+        const auto matcher = expression.createMatcher();
+
+        AtomicFlag interrupt( true );
+        std::vector<uint32_t> matchingLines;
+        matcher->withSpecializedMatcher( [ & ]( const auto& specialized ) {
+            specialized.matchLines( manyLines, matchingLines, &interrupt );
+        } );
+        REQUIRE( matchingLines.size() < manyLines.size() );
+    }
+}
+
+TEST_CASE( "Pattern matcher per line overhead", "[.][benchmark]" )
+{
+    const auto linesCount = 100'000'000u;
+
+    std::array<std::string, 16> lines;
+    for ( auto i = 0u; i < lines.size(); ++i ) {
+        lines[ i ] = "line " + std::to_string( i );
+    }
+
+    RegularExpression expression( RegularExpressionPattern( "x", true, false, false, true ) );
+    const auto matcher = expression.createMatcher();
+
+    BENCHMARK( "Dispatch on every line" )
+    {
+        auto matches = 0u;
+        for ( auto i = 0u; i < linesCount; ++i ) {
+            matches += matcher->hasMatch( lines[ i % lines.size() ] );
+        }
+        return matches;
+    };
+
+    BENCHMARK( "Specialized matcher" )
+    {
+        return matcher->withSpecializedMatcher( [ &lines ]( const auto& specialized ) {
+            auto matches = 0u;
+            for ( auto i = 0u; i < linesCount; ++i ) {
+                matches += specialized.hasMatch( lines[ i % lines.size() ] );
+            }
+            return matches;
+        } );
+    };
+}
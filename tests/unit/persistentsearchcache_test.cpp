@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+
+#include <QFile>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+
+#include "filedigest.h"
+#include "persistentsearchcache.h"
+
+namespace {
+void writeFile( const QString& fileName, const QByteArray& data, QIODevice::OpenMode mode )
+{
+    QFile file( fileName );
+    REQUIRE( file.open( mode ) );
+    REQUIRE( file.write( data ) == data.size() );
+}
+
+IndexedHash hashOf( const QByteArray& data )
+{
+    IndexedHash hash;
+    hash.size = data.size();
+    hash.headerSize = data.size() / 2;
+    hash.headerDigest = FileDigest().addData( data.left( data.size() / 2 ) ).digest();
+    hash.tailOffset = data.size() / 2;
+    hash.tailSize = data.size() - hash.tailOffset;
+    hash.tailDigest = FileDigest().addData( data.mid( data.size() / 2 ) ).digest();
+    return hash;
+}
+} // namespace
+
+SCENARIO( "Search results saved to persistent cache", "[persistentsearchcache]" )
+{
+    QStandardPaths::setTestModeEnabled( true );
+
+    QTemporaryDir directory;
+    REQUIRE( directory.isValid() );
+    const auto fileName = directory.filePath( "test.log" );
+
+    QByteArray data;
+    for ( auto i = 0; i < 100; ++i ) {
+        data.append( ( i % 3 == 0 ? "match " : "other " ) + QByteArray::number( i ) + '\n' );
+    }
+    writeFile( fileName, data, QIODevice::WriteOnly );
+
+    PersistentSearchCache::Entry entry;
+    entry.pattern = RegularExpressionPattern( "match" );
+    entry.startLine = 0_lnum;
+    entry.endLine = 100_lnum;
+    entry.maxLength = 8_length;
+    entry.lastUsed = 42;
+    for ( auto i = 0u; i < 100; i += 3 ) {
+        entry.matchingLines.add( i );
+    }
+
+    const PersistentSearchCache cache( fileName );
+    cache.save( hashOf( data ), { entry } );
+
+    WHEN( "Results are loaded for unchanged file" )
+    {
+        const auto entries = PersistentSearchCache( fileName ).load();
+
+        THEN( "They are the saved ones" )
+        {
+            REQUIRE( entries.size() == 1 );
+            REQUIRE( entries[ 0 ].pattern.pattern == "match" );
+            REQUIRE( entries[ 0 ].startLine == 0_lnum );
+            REQUIRE( entries[ 0 ].endLine == 100_lnum );
+            REQUIRE( entries[ 0 ].maxLength == 8_length );
+            REQUIRE( entries[ 0 ].lastUsed == 42 );
+            REQUIRE( entries[ 0 ].matchingLines == entry.matchingLines );
+        }
+    }
+
+    WHEN( "Lines are appended to the file" )
+    {
+        writeFile( fileName, "match 100\n", QIODevice::Append );
+
+        THEN( "Results of the indexed part are loaded" )
+        {
+            REQUIRE( PersistentSearchCache( fileName ).load().size() == 1 );
+        }
+    }
+
+    WHEN( "Indexed part of the file is changed" )
+    {
+        data[ 0 ] = 'M';
+        writeFile( fileName, data, QIODevice::WriteOnly );
+
+        THEN( "Results are dropped" )
+        {
+            REQUIRE( PersistentSearchCache( fileName ).load().empty() );
+        }
+    }
+
+    WHEN( "File is truncated" )
+    {
+        writeFile( fileName, data.left( 10 ), QIODevice::WriteOnly );
+
+        THEN( "Results are dropped" )
+        {
+            REQUIRE( PersistentSearchCache( fileName ).load().empty() );
+        }
+    }
+}
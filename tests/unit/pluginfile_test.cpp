@@ -0,0 +1,210 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+
+#include <cstring>
+
+#include <QTemporaryFile>
+
+#include "pluginfile.h"
+
+namespace {
+// Records of test format are a type byte, a length byte and the text of line.
+// File starts with a header record that is not shown.
+constexpr char HeaderRecord[] = "H\x04KTST";
+
+int probeRecords( const char*, const unsigned char* header, size_t headerSize )
+{
+    return headerSize >= sizeof( HeaderRecord ) - 1
+           && std::memcmp( header, HeaderRecord, sizeof( HeaderRecord ) - 1 ) == 0;
+}
+
+klogg_format_decoder* createDecoder()
+{
+    static char decoder;
+    return reinterpret_cast<klogg_format_decoder*>( &decoder );
+}
+
+void destroyDecoder( klogg_format_decoder* )
+{
+}
+
+klogg_decode_status decodeRecords( klogg_format_decoder*, const unsigned char* input,
+                                   size_t inputSize, int, char* output, size_t outputCapacity,
+                                   size_t* consumed, size_t* written )
+{
+    *consumed = 0;
+    *written = 0;
+    while ( *consumed + 2 <= inputSize ) {
+        const auto type = input[ *consumed ];
+        const size_t length = input[ *consumed + 1 ];
+        if ( *consumed + 2 + length > inputSize ) {
+            break;
+        }
+
+        if ( type == 'L' ) {
+            if ( *written + length + 1 > outputCapacity ) {
+                return *consumed == 0 ? KLOGG_DECODE_OUTPUT_TOO_SMALL : KLOGG_DECODE_OK;
+            }
+            std::memcpy( output + *written, input + *consumed + 2, length );
+            output[ *written + length ] = '\n';
+            *written += length + 1;
+        }
+        else if ( type != 'H' ) {
+            return KLOGG_DECODE_ERROR;
+        }
+
+        *consumed += 2 + length;
+    }
+
+    return KLOGG_DECODE_OK;
+}
+
+const klogg_format_plugin TestPlugin = { KLOGG_FORMAT_PLUGIN_ABI_VERSION,
+                                         "Test records",
+                                         probeRecords,
+                                         createDecoder,
+                                         destroyDecoder,
+                                         decodeRecords };
+
+QByteArray logLines( int first, int count )
+{
+    QByteArray lines;
+    for ( auto line = first; line < first + count; ++line ) {
+        lines.append( QByteArray( "request " ) + QByteArray::number( line * 7919 % 100003 )
+                      + " handled in " + QByteArray::number( line % 977 ) + " ms\n" );
+    }
+    return lines;
+}
+
+QByteArray records( const QByteArray& lines )
+{
+    QByteArray encoded( HeaderRecord, sizeof( HeaderRecord ) - 1 );
+    for ( const auto& line : lines.split( '\n' ) ) {
+        if ( !line.isEmpty() ) {
+            encoded.append( 'L' );
+            encoded.append( static_cast<char>( line.size() ) );
+            encoded.append( line );
+        }
+    }
+    return encoded;
+}
+
+QByteArray readAll( PluginFile& file )
+{
+    QByteArray decoded;
+    while ( !file.atEnd() ) {
+        const auto block = file.read( 1024 * 1024 );
+        if ( block.isEmpty() ) {
+            break;
+        }
+        decoded.append( block );
+    }
+    return decoded;
+}
+} // namespace
+
+SCENARIO( "Random access to file decoded by plugin", "[pluginfile]" )
+{
+    REQUIRE( PluginFile::addPlugin( &TestPlugin ) );
+
+    // More than one checkpoint span of decoded data
+    const auto data = logLines( 0, 700000 );
+
+    QTemporaryFile encodedFile;
+    REQUIRE( encodedFile.open() );
+    encodedFile.write( records( data ) );
+    encodedFile.close();
+
+    REQUIRE( PluginFile::findPlugin( encodedFile.fileName() ) == &TestPlugin );
+
+    PluginFile file( encodedFile.fileName(), &TestPlugin );
+    REQUIRE( file.open( QIODevice::ReadOnly ) );
+
+    WHEN( "File is read sequentially" )
+    {
+        REQUIRE( readAll( file ) == data );
+        REQUIRE( file.size() == data.size() );
+
+        THEN( "Any part can be read after seek" )
+        {
+            for ( auto offset : { data.size() - 100, 10, data.size() / 2, 0, data.size() / 3 } ) {
+                REQUIRE( file.seek( offset ) );
+                REQUIRE( file.read( 64 ) == data.mid( offset, 64 ) );
+            }
+        }
+
+        THEN( "Other device reads the same file" )
+        {
+            PluginFile other( encodedFile.fileName(), &TestPlugin );
+            REQUIRE( other.open( QIODevice::ReadOnly ) );
+            REQUIRE( other.size() == data.size() );
+            REQUIRE( other.seek( data.size() - 1000 ) );
+            REQUIRE( other.read( 2000 ) == data.right( 1000 ) );
+        }
+    }
+}
+
+SCENARIO( "File decoded by plugin ends with broken record", "[pluginfile]" )
+{
+    REQUIRE( PluginFile::addPlugin( &TestPlugin ) );
+
+    const auto data = logLines( 0, 1000 );
+
+    QTemporaryFile encodedFile;
+    REQUIRE( encodedFile.open() );
+
+    WHEN( "Last record is not complete" )
+    {
+        encodedFile.write( records( data ) + "L\x20partial" );
+        encodedFile.close();
+
+        PluginFile file( encodedFile.fileName(), &TestPlugin );
+        REQUIRE( file.open( QIODevice::ReadOnly ) );
+        REQUIRE( readAll( file ) == data );
+        REQUIRE( file.size() == data.size() );
+    }
+
+    WHEN( "Record is corrupted" )
+    {
+        encodedFile.write( records( data ) + "X\x01?" + records( data ) );
+        encodedFile.close();
+
+        PluginFile file( encodedFile.fileName(), &TestPlugin );
+        REQUIRE( file.open( QIODevice::ReadOnly ) );
+        REQUIRE( readAll( file ) == data );
+    }
+}
+
+SCENARIO( "Plugins are chosen by header of file", "[pluginfile]" )
+{
+    REQUIRE( PluginFile::addPlugin( &TestPlugin ) );
+
+    auto unsupported = TestPlugin;
+    unsupported.abi_version = KLOGG_FORMAT_PLUGIN_ABI_VERSION + 1;
+    REQUIRE( !PluginFile::addPlugin( &unsupported ) );
+
+    QTemporaryFile textFile;
+    REQUIRE( textFile.open() );
+    textFile.write( logLines( 0, 10 ) );
+    textFile.close();
+
+    REQUIRE( PluginFile::findPlugin( textFile.fileName() ) == nullptr );
+}
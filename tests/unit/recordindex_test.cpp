@@ -0,0 +1,140 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <catch2/catch.hpp>
+
+#include <vector>
+
+#include <QBuffer>
+#include <QDataStream>
+
+#include "recordindex.h"
+
+namespace {
+std::vector<LineNumber::UnderlyingType> toVector( const roaring::Roaring64Map& lines )
+{
+    std::vector<LineNumber::UnderlyingType> numbers;
+    for ( const auto line : lines ) {
+        numbers.push_back( line );
+    }
+    return numbers;
+}
+
+roaring::Roaring64Map toLines( const std::vector<LineNumber::UnderlyingType>& numbers )
+{
+    roaring::Roaring64Map lines;
+    for ( const auto number : numbers ) {
+        lines.add( number );
+    }
+    return lines;
+}
+
+using Lines = std::vector<LineNumber::UnderlyingType>;
+
+const std::vector<std::string_view> RecordLines
+    = { "  continued", "2021-01-01 first", "  at a", "  at b",
+        "2021-01-02 second", "2021-01-03 third", "  at c" };
+} // namespace
+
+SCENARIO( "Record index lookups", "[recordindex]" )
+{
+    for ( const auto* pattern : { "^2021-", "^\\d{4}-" } ) {
+        RecordIndex index( pattern );
+        index.append( RecordLines );
+
+        REQUIRE( index.size() == 7_lcount );
+
+        WHEN( "Line is in a record" )
+        {
+            REQUIRE( index.recordStart( 0_lnum ) == 0_lnum );
+            REQUIRE( index.recordStart( 3_lnum ) == 1_lnum );
+            REQUIRE( index.recordStart( 4_lnum ) == 4_lnum );
+            REQUIRE( index.recordStart( 6_lnum ) == 5_lnum );
+        }
+
+        WHEN( "Lines are expanded" )
+        {
+            REQUIRE( toVector( index.expand( toLines( { 2 } ) ) ) == Lines{ 1, 2, 3 } );
+            REQUIRE( toVector( index.expand( toLines( { 1, 3, 4 } ) ) ) == Lines{ 1, 2, 3, 4 } );
+            REQUIRE( toVector( index.expand( toLines( { 0, 5 } ) ) ) == Lines{ 0, 5, 6 } );
+            REQUIRE( toVector( index.expand( toLines( { 6, 9 } ) ) ) == Lines{ 5, 6, 9 } );
+        }
+
+        WHEN( "Last lines are added again" )
+        {
+            index.truncate( 5_lcount );
+            index.append( { "  at d", "2021-01-04 fourth" } );
+
+            REQUIRE( toVector( index.expand( toLines( { 4 } ) ) ) == Lines{ 4, 5 } );
+            REQUIRE( toVector( index.expand( toLines( { 6 } ) ) ) == Lines{ 6 } );
+        }
+
+        WHEN( "Index is saved and loaded" )
+        {
+            QBuffer buffer;
+            buffer.open( QIODevice::ReadWrite );
+            QDataStream stream( &buffer );
+            index.save( stream );
+
+            buffer.seek( 0 );
+            RecordIndex loadedIndex( pattern );
+            REQUIRE( loadedIndex.load( stream ) );
+            REQUIRE( loadedIndex.size() == 7_lcount );
+            REQUIRE( loadedIndex.recordStart( 3_lnum ) == 1_lnum );
+
+            buffer.seek( 0 );
+            RecordIndex otherPattern( "^2022-" );
+            REQUIRE( otherPattern.load( stream ) );
+            REQUIRE( otherPattern.size() == 0_lcount );
+        }
+
+        WHEN( "Saved starts are truncated" )
+        {
+            QBuffer buffer;
+            buffer.open( QIODevice::ReadWrite );
+            QDataStream stream( &buffer );
+            index.save( stream );
+
+            buffer.seek( 0 );
+            QByteArray startPattern;
+            quint64 size = 0;
+            QByteArray data;
+            stream >> startPattern >> size >> data;
+
+            buffer.buffer().clear();
+            buffer.seek( 0 );
+            stream << startPattern << size << data.left( data.size() - 1 );
+
+            buffer.seek( 0 );
+            RecordIndex loadedIndex( pattern );
+            REQUIRE( !loadedIndex.load( stream ) );
+        }
+    }
+}
+
+SCENARIO( "Disabled record index", "[recordindex]" )
+{
+    RecordIndex index;
+    index.append( RecordLines );
+
+    REQUIRE( index.size() == 0_lcount );
+    REQUIRE( toVector( index.expand( toLines( { 2 } ) ) ) == Lines{ 2 } );
+    REQUIRE( !RecordIndex( "(" ).isEnabled() );
+}
@@ -0,0 +1,146 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+
+#include <QDataStream>
+
+#include "remoteprotocol.h"
+
+namespace {
+template <typename MessageT>
+std::optional<MessageT> roundTrip( const MessageT& message )
+{
+    auto received = remote::encode( message );
+    bool isBroken = false;
+    const auto framed = remote::takeMessage( received, isBroken );
+    REQUIRE( framed );
+    REQUIRE( !isBroken );
+    REQUIRE( received.isEmpty() );
+    return remote::decode<MessageT>( *framed );
+}
+} // namespace
+
+SCENARIO( "Remote protocol messages", "[remoteprotocol]" )
+{
+    WHEN( "Lines are sent" )
+    {
+        remote::LinesReply reply;
+        reply.generation = 3;
+        reply.firstLine = 1024;
+        reply.lines = { "first line", "", QString::fromUtf8( "\xd0\xbb\xd0\xbe\xd0\xb3" ),
+                        "\ttabbed" };
+
+        const auto decoded = roundTrip( reply );
+        REQUIRE( decoded );
+        REQUIRE( decoded->generation == 3 );
+        REQUIRE( decoded->firstLine == 1024 );
+        REQUIRE( decoded->lines == reply.lines );
+    }
+
+    WHEN( "One empty line is sent" )
+    {
+        remote::LinesReply reply;
+        reply.lines = { "" };
+
+        const auto decoded = roundTrip( reply );
+        REQUIRE( decoded );
+        REQUIRE( decoded->lines.size() == 1 );
+    }
+
+    WHEN( "Search results are sent" )
+    {
+        remote::SearchResults results;
+        results.searchId = 7;
+        results.matches.addRange( 10, 5000 );
+        results.matches.add( uint64_t{ 1 } << 33 );
+
+        const auto decoded = roundTrip( results );
+        REQUIRE( decoded );
+        REQUIRE( decoded->searchId == 7 );
+        REQUIRE( decoded->matches == results.matches );
+    }
+
+    WHEN( "Search results have damaged bitmap" )
+    {
+        SearchResultArray matches;
+        matches.addRange( 10, 5000 );
+        QByteArray serialized( static_cast<int>( matches.getSizeInBytes( true ) ),
+                               Qt::Uninitialized );
+        matches.write( serialized.data(), true );
+
+        QByteArray body;
+        QDataStream stream( &body, QIODevice::WriteOnly );
+        stream.setVersion( QDataStream::Qt_5_9 );
+        stream << quint32{ 7 } << serialized.left( serialized.size() - 1 );
+
+        remote::Message message{ remote::MessageType::SearchResults, body };
+        REQUIRE( !remote::decode<remote::SearchResults>( message ) );
+    }
+
+    WHEN( "Search is requested" )
+    {
+        remote::SearchRequest request;
+        request.searchId = 2;
+        request.pattern = RegularExpressionPattern( "err.*", false, true, false, false );
+
+        const auto decoded = roundTrip( request );
+        REQUIRE( decoded );
+        REQUIRE( decoded->searchId == 2 );
+        REQUIRE( decoded->pattern == request.pattern );
+    }
+
+    WHEN( "Message of other type is decoded" )
+    {
+        remote::Message message{ remote::MessageType::Lines,
+                                 remote::encodeBody( remote::FileInfo{} ) };
+        REQUIRE( !remote::decode<remote::FileInfo>( message ) );
+    }
+}
+
+SCENARIO( "Remote protocol framing", "[remoteprotocol]" )
+{
+    remote::FileInfo fileInfo;
+    fileInfo.nbLines = 42;
+    const auto frame = remote::encode( fileInfo );
+
+    WHEN( "Message is received in parts" )
+    {
+        QByteArray received = frame.left( 3 );
+        bool isBroken = false;
+        REQUIRE( !remote::takeMessage( received, isBroken ) );
+
+        received.append( frame.mid( 3 ) );
+        received.append( frame );
+
+        const auto first = remote::takeMessage( received, isBroken );
+        REQUIRE( first );
+        REQUIRE( remote::decode<remote::FileInfo>( *first )->nbLines == 42 );
+        REQUIRE( received == frame );
+        REQUIRE( !isBroken );
+    }
+
+    WHEN( "Message size is too big" )
+    {
+        QByteArray received( 5, '\xff' );
+        bool isBroken = false;
+        REQUIRE( !remote::takeMessage( received, isBroken ) );
+        REQUIRE( isBroken );
+    }
+}
@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+
+#include <vector>
+
+#include "renderedtilecache.h"
+
+namespace {
+RenderedTileCache::Layout layout( int size, int firstColumn = 0 )
+{
+    return { 50_lcount, firstColumn, QSize( size, size ), 1.0 };
+}
+
+std::vector<LineNumber> lines( std::initializer_list<LineNumber::UnderlyingType> values )
+{
+    std::vector<LineNumber> result;
+    for ( const auto value : values ) {
+        result.emplace_back( value );
+    }
+    return result;
+}
+
+void insertMissing( RenderedTileCache& cache, LineNumber viewLine )
+{
+    for ( const auto tile : cache.missingTiles( viewLine, 1000_lcount ) ) {
+        cache.insert( tile, QPixmap( cache.layout().size ) );
+    }
+}
+} // namespace
+
+SCENARIO( "Rendered tiles around the view", "[renderedtilecache]" )
+{
+    RenderedTileCache cache;
+    cache.setLayout( layout( 100 ) );
+
+    REQUIRE( cache.tileStart( 120_lnum ) == 100_lnum );
+
+    WHEN( "View is in the middle of the file" )
+    {
+        THEN( "Nearest tiles are missing first" )
+        {
+            REQUIRE( cache.missingTiles( 120_lnum, 1000_lcount )
+                     == lines( { 100, 150, 50, 200, 0, 250 } ) );
+        }
+
+        THEN( "Tiles past the last line are not missing" )
+        {
+            REQUIRE( cache.missingTiles( 120_lnum, 180_lcount ) == lines( { 100, 150, 50, 0 } ) );
+        }
+    }
+
+    WHEN( "View is at the start of the file" )
+    {
+        REQUIRE( cache.missingTiles( 20_lnum, 1000_lcount ) == lines( { 0, 50, 100, 150 } ) );
+    }
+
+    WHEN( "Tiles are drawn" )
+    {
+        insertMissing( cache, 120_lnum );
+        REQUIRE( cache.size() == 6 );
+        REQUIRE( cache.missingTiles( 120_lnum, 1000_lcount ).empty() );
+        REQUIRE( !cache.find( 150_lnum ).isNull() );
+
+        THEN( "Tiles of removed lines are missing" )
+        {
+            cache.removeLines( 149_lnum, 2_lcount );
+            REQUIRE( !cache.contains( 100_lnum ) );
+            REQUIRE( !cache.contains( 150_lnum ) );
+            REQUIRE( cache.contains( 200_lnum ) );
+            REQUIRE( cache.missingTiles( 120_lnum, 1000_lcount ) == lines( { 100, 150 } ) );
+        }
+
+        THEN( "Tiles far from the view are trimmed" )
+        {
+            cache.trim( 160_lnum );
+            REQUIRE( cache.size() == 5 );
+            REQUIRE( !cache.contains( 0_lnum ) );
+        }
+
+        THEN( "Tiles are dropped when layout changes" )
+        {
+            cache.setLayout( layout( 100 ) );
+            REQUIRE( cache.size() == 6 );
+
+            cache.setLayout( layout( 100, 10 ) );
+            REQUIRE( cache.size() == 0 );
+        }
+    }
+
+    WHEN( "Tiles are big" )
+    {
+        cache.setLayout( layout( 4096 ) );
+        REQUIRE( cache.missingTiles( 120_lnum, 1000_lcount ) == lines( { 100, 150 } ) );
+    }
+}
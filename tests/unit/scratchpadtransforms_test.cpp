@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+
+#include <atomic>
+#include <cstdint>
+
+#include <QByteArray>
+
+#include "atomicflag.h"
+#include "scratchpadtransforms.h"
+
+SCENARIO( "Scratchpad transformations", "[scratchpad]" )
+{
+    AtomicFlag interruptRequested;
+    std::atomic<uint64_t> processedBytes{};
+
+    WHEN( "Json is formatted" )
+    {
+        const QByteArray text = R"(log: {"a":[1, 2,{}],"b" : "x\"}{", "c":{"d":null}} trailing)";
+        const auto json = scratchpad::formatJson( text, interruptRequested, processedBytes );
+
+        REQUIRE( json
+                 == "{\n    \"a\": [\n        1,\n        2,\n        {}\n    ],\n"
+                    "    \"b\": \"x\\\"}{\",\n    \"c\": {\n        \"d\": null\n    }\n}\n" );
+    }
+
+    WHEN( "Text has no json" )
+    {
+        REQUIRE( scratchpad::formatJson( "no json", interruptRequested, processedBytes )
+                     .isEmpty() );
+    }
+
+    WHEN( "Xml is formatted" )
+    {
+        const auto xml
+            = scratchpad::formatXml( "log: <a><b x=\"1\">text</b> <c/></a>", interruptRequested,
+                                     processedBytes );
+
+        REQUIRE( xml == "<a>\n  <b x=\"1\">text</b>\n  <c/>\n</a>\n" );
+    }
+
+    WHEN( "Text is encoded and decoded" )
+    {
+        const QByteArray text( 3 * 1024 * 1024 + 1, 'x' );
+
+        const auto base64 = scratchpad::encodeBase64( text, interruptRequested, processedBytes );
+        REQUIRE( base64 == text.toBase64() );
+        REQUIRE( scratchpad::decodeBase64( base64, interruptRequested, processedBytes ) == text );
+
+        const auto hex = scratchpad::encodeHex( text, interruptRequested, processedBytes );
+        REQUIRE( hex == text.toHex() );
+        REQUIRE( scratchpad::decodeHex( hex, interruptRequested, processedBytes ) == text );
+    }
+
+    WHEN( "Url is decoded" )
+    {
+        REQUIRE( scratchpad::decodeUrl( "a%20b%zz%4%41%", interruptRequested, processedBytes )
+                 == "a b%zz%4A%" );
+    }
+
+    WHEN( "Interruption is requested" )
+    {
+        interruptRequested.set();
+        REQUIRE( scratchpad::encodeHex( "text", interruptRequested, processedBytes ).isEmpty() );
+        REQUIRE( processedBytes == 0 );
+    }
+}
@@ -0,0 +1,178 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <catch2/catch.hpp>
+
+#include <vector>
+
+#include "searchplanner.h"
+
+namespace {
+using Lines = std::vector<LineNumber::UnderlyingType>;
+
+std::vector<LineNumber::UnderlyingType> toVector( const roaring::Roaring64Map& lines )
+{
+    std::vector<LineNumber::UnderlyingType> numbers;
+    for ( const auto line : lines ) {
+        numbers.push_back( line );
+    }
+    return numbers;
+}
+
+roaring::Roaring64Map toLines( const Lines& numbers )
+{
+    roaring::Roaring64Map lines;
+    for ( const auto number : numbers ) {
+        lines.add( number );
+    }
+    return lines;
+}
+
+bool firstAndSecond( std::string_view matched )
+{
+    return matched[ 0 ] && matched[ 1 ];
+}
+
+bool firstOrSecond( std::string_view matched )
+{
+    return matched[ 0 ] || matched[ 1 ];
+}
+} // namespace
+
+SCENARIO( "Search planner for conjunction", "[searchplanner]" )
+{
+    SearchPlanner planner( 2, firstAndSecond, 0_lnum, 10_lnum );
+
+    WHEN( "No term is looked up" )
+    {
+        REQUIRE( !planner.plan().has_value() );
+    }
+
+    WHEN( "One term has candidates" )
+    {
+        planner.setCandidateLines( 0, toLines( { 1, 5, 7 } ) );
+
+        const auto plan = planner.plan();
+        REQUIRE( plan.has_value() );
+        REQUIRE( plan->matchingLines.isEmpty() );
+        REQUIRE( toVector( plan->scannedLines ) == Lines{ 1, 5, 7 } );
+    }
+
+    WHEN( "Terms have candidates" )
+    {
+        planner.setCandidateLines( 0, toLines( { 1, 5, 7 } ) );
+        planner.setCandidateLines( 1, toLines( { 2, 5, 7, 9 } ) );
+
+        const auto plan = planner.plan();
+        REQUIRE( plan->matchingLines.isEmpty() );
+        REQUIRE( toVector( plan->scannedLines ) == Lines{ 5, 7 } );
+    }
+
+    WHEN( "Terms have exact lines" )
+    {
+        planner.setMatchingLines( 0, toLines( { 1, 5, 7 } ) );
+        planner.setMatchingLines( 1, toLines( { 2, 5, 7, 9 } ) );
+
+        const auto plan = planner.plan();
+        REQUIRE( toVector( plan->matchingLines ) == Lines{ 5, 7 } );
+        REQUIRE( plan->scannedLines.isEmpty() );
+    }
+
+    WHEN( "Term has exact lines and another one has candidates" )
+    {
+        planner.setMatchingLines( 0, toLines( { 1, 5, 7 } ) );
+        planner.setCandidateLines( 1, toLines( { 2, 5, 9 } ) );
+
+        const auto plan = planner.plan();
+        REQUIRE( plan->matchingLines.isEmpty() );
+        REQUIRE( toVector( plan->scannedLines ) == Lines{ 5 } );
+    }
+
+    WHEN( "Candidates are replaced by exact lines" )
+    {
+        planner.setMatchingLines( 0, toLines( { 1, 5 } ) );
+        planner.setCandidateLines( 0, toLines( { 1, 5, 7 } ) );
+        planner.setMatchingLines( 1, toLines( { 1 } ) );
+
+        const auto plan = planner.plan();
+        REQUIRE( toVector( plan->matchingLines ) == Lines{ 1 } );
+        REQUIRE( plan->scannedLines.isEmpty() );
+    }
+}
+
+SCENARIO( "Search planner for disjunction", "[searchplanner]" )
+{
+    SearchPlanner planner( 2, firstOrSecond, 0_lnum, 10_lnum );
+
+    WHEN( "Only one term is looked up" )
+    {
+        planner.setCandidateLines( 0, toLines( { 1, 5 } ) );
+
+        const auto plan = planner.plan();
+        REQUIRE( plan->matchingLines.isEmpty() );
+        REQUIRE( plan->scannedLines.cardinality() == 10 );
+    }
+
+    WHEN( "Both terms are looked up" )
+    {
+        planner.setMatchingLines( 0, toLines( { 1, 5 } ) );
+        planner.setCandidateLines( 1, toLines( { 5, 8 } ) );
+
+        const auto plan = planner.plan();
+        REQUIRE( toVector( plan->matchingLines ) == Lines{ 1, 5 } );
+        REQUIRE( toVector( plan->scannedLines ) == Lines{ 8 } );
+    }
+}
+
+SCENARIO( "Search planner for negated terms", "[searchplanner]" )
+{
+    WHEN( "Expression is true without terms" )
+    {
+        SearchPlanner planner(
+            1, []( std::string_view matched ) { return !matched[ 0 ]; }, 0_lnum, 10_lnum );
+        planner.setCandidateLines( 0, toLines( { 1, 5 } ) );
+
+        REQUIRE( !planner.plan().has_value() );
+    }
+
+    WHEN( "Term is excluded from another one" )
+    {
+        SearchPlanner planner(
+            2, []( std::string_view matched ) { return matched[ 0 ] && !matched[ 1 ]; }, 0_lnum,
+            10_lnum );
+        planner.setCandidateLines( 0, toLines( { 1, 5, 7 } ) );
+        planner.setMatchingLines( 1, toLines( { 5 } ) );
+
+        const auto plan = planner.plan();
+        REQUIRE( plan->matchingLines.isEmpty() );
+        REQUIRE( toVector( plan->scannedLines ) == Lines{ 1, 7 } );
+    }
+
+    WHEN( "Lines are limited" )
+    {
+        SearchPlanner planner( 2, firstAndSecond, 4_lnum, 8_lnum );
+        planner.setMatchingLines( 0, toLines( { 1, 5, 7, 9 } ) );
+        planner.setMatchingLines( 1, toLines( { 1, 5, 9 } ) );
+
+        const auto plan = planner.plan();
+        REQUIRE( toVector( plan->matchingLines ) == Lines{ 5 } );
+        REQUIRE( plan->scannedLines.isEmpty() );
+    }
+}
@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+
+#include "linetypes.h"
+#include "tabexpansionindex.h"
+
+SCENARIO( "Tabs are expanded to the next tab stop", "[tabexpansionindex]" )
+{
+    WHEN( "Line has several tabs" )
+    {
+        REQUIRE( untabify( QString( "a\tbc\t\tdef" ) )
+                 == "a" + QString( 7, QChar::Space ) + "bc" + QString( 14, QChar::Space )
+                        + "def" );
+    }
+
+    WHEN( "Line starts past the first column" )
+    {
+        REQUIRE( untabify( QString( "\tx\ty" ), 3 )
+                 == QString( 5, QChar::Space ) + "x" + QString( 7, QChar::Space ) + "y" );
+    }
+
+    WHEN( "Line has null characters" )
+    {
+        REQUIRE( untabify( QString( "a" ) + QChar::Null + "\tb" )
+                 == "a" + QString( 7, QChar::Space ) + "b" );
+    }
+}
+
+SCENARIO( "Tab expansion index", "[tabexpansionindex]" )
+{
+    const auto expandedWindow = []( const QString& line, int firstColumn, int nbColumns ) {
+        return untabify( QString( line ) ).mid( firstColumn, nbColumns );
+    };
+
+    WHEN( "Line is short" )
+    {
+        const QString line = "a\tbc\t\tdef";
+        TabExpansionIndex index( line );
+
+        REQUIRE( index.expandedLength() == untabify( QString( line ) ).size() );
+        REQUIRE( index.expandedColumn( 0 ) == 0 );
+        REQUIRE( index.expandedColumn( 2 ) == 8 );
+        REQUIRE( index.expandedColumn( 5 ) == 16 );
+        REQUIRE( index.expandedColumn( line.size() ) == index.expandedLength() );
+
+        for ( auto firstColumn = 0; firstColumn < index.expandedLength() + 2; ++firstColumn ) {
+            REQUIRE( index.expandedWindow( firstColumn, 5 )
+                     == expandedWindow( line, firstColumn, 5 ) );
+        }
+    }
+
+    WHEN( "Line is longer than index step" )
+    {
+        QString line;
+        for ( auto i = 0; i < 5000; ++i ) {
+            line.append( i % 7 == 0 ? QChar::Tabulation : QChar( 'a' + i % 26 ) );
+        }
+        TabExpansionIndex index( line );
+
+        REQUIRE( index.expandedLength() == untabify( QString( line ) ).size() );
+        for ( auto firstColumn : { 0, 1023, 1024, 3000, 5001 } ) {
+            REQUIRE( index.expandedWindow( firstColumn, 120 )
+                     == expandedWindow( line, firstColumn, 120 ) );
+        }
+    }
+}
+
+SCENARIO( "Tab positions", "[tabexpansionindex]" )
+{
+    WHEN( "Line has no tabs" )
+    {
+        const QString line = "no tabs in this line, it is longer than a vector";
+        const TabPositions tabPositions( line );
+
+        REQUIRE( tabPositions.isEmpty() );
+        REQUIRE( untabify( QString( line ) ) == line );
+    }
+
+    WHEN( "Tabs are on both sides of vector boundary" )
+    {
+        QString line( 40, QChar( 'a' ) );
+        for ( auto position : { 0, 15, 16, 31, 39 } ) {
+            line[ position ] = QChar::Tabulation;
+        }
+        const TabPositions tabPositions( line );
+
+        REQUIRE( tabPositions.tabs() == std::vector<int>{ 0, 15, 16, 31, 39 } );
+        REQUIRE( !tabPositions.hasNulls() );
+        REQUIRE( tabPositions.expandedLength( line.size() )
+                 == untabify( QString( line ) ).size() );
+    }
+
+    WHEN( "Line is expanded" )
+    {
+        REQUIRE( untabify( QString( "a\tbc\t\tdef" ) ) == "a       bc              def" );
+        REQUIRE( untabify( QString( "a\tb" ), 3 ) == "a    b" );
+        REQUIRE( untabify( QString( "a" ) + QChar::Null + "b\tc" ) == "a b     c" );
+    }
+}
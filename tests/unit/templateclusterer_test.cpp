@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+
+#include <string>
+#include <vector>
+
+#include "templateclusterer.h"
+
+SCENARIO( "Template mining", "[templateclusterer]" )
+{
+    TemplateMiner miner;
+
+    WHEN( "Lines differ by numbers" )
+    {
+        const auto first = miner.add( "connection from 10.0.0.1 closed" );
+        const auto second = miner.add( "connection  from 10.0.0.2\tclosed" );
+
+        REQUIRE( first == second );
+        REQUIRE( miner.text( first ) == "connection from <*> closed" );
+    }
+
+    WHEN( "Lines differ by words" )
+    {
+        const auto first = miner.add( "user alice logged in" );
+        const auto second = miner.add( "user bob logged in" );
+        const auto third = miner.add( "user bob logged out" );
+
+        REQUIRE( first == second );
+        REQUIRE( first == third );
+        REQUIRE( miner.text( first ) == "user <*> logged <*>" );
+    }
+
+    WHEN( "Lines are not similar" )
+    {
+        const auto first = miner.add( "request started by alice" );
+        const auto second = miner.add( "request failed with timeout" );
+        const auto third = miner.add( "request started" );
+
+        REQUIRE( first != second );
+        REQUIRE( first != third );
+        REQUIRE( miner.size() == 3 );
+        REQUIRE( miner.text( first ) == "request started by alice" );
+    }
+
+    WHEN( "Templates of other miners are added" )
+    {
+        const auto first = miner.add( "user alice logged in" );
+        miner.add( "user bob logged in" );
+
+        TemplateMiner mergedMiner;
+        mergedMiner.add( "user carol logged in" );
+        const auto merged = mergedMiner.addTemplate( miner.tokens( first ) );
+
+        REQUIRE( mergedMiner.size() == 1 );
+        REQUIRE( mergedMiner.text( merged ) == "user <*> logged in" );
+    }
+}
@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#include "timeorder.h"
+
+SCENARIO( "Timestamps radix sort", "[timeorder]" )
+{
+    WHEN( "Timestamps are sorted" )
+    {
+        const std::vector<qint64> timestamps = { 30, -5, 20, 30, 10, -5 };
+        REQUIRE( TimeOrder::sortedRanks( timestamps )
+                 == std::vector<uint64_t>{ 1, 5, 4, 2, 0, 3 } );
+    }
+
+    WHEN( "All timestamps are the same" )
+    {
+        const std::vector<qint64> timestamps( 5, 1000 );
+        REQUIRE( TimeOrder::sortedRanks( timestamps ) == std::vector<uint64_t>{ 0, 1, 2, 3, 4 } );
+    }
+
+    WHEN( "There are no timestamps" )
+    {
+        REQUIRE( TimeOrder::sortedRanks( {} ).empty() );
+    }
+
+    WHEN( "Timestamps are sorted in many chunks" )
+    {
+        std::mt19937_64 generator( 42 );
+        std::uniform_int_distribution<qint64> distribution( -1000000, 1LL << 42 );
+        std::vector<qint64> timestamps( 300000 );
+        for ( auto& timestamp : timestamps ) {
+            timestamp = distribution( generator ) / 1000 * 1000;
+        }
+
+        std::vector<uint64_t> expectedRanks( timestamps.size() );
+        std::iota( expectedRanks.begin(), expectedRanks.end(), 0 );
+        std::stable_sort( expectedRanks.begin(), expectedRanks.end(),
+                          [ &timestamps ]( uint64_t lhs, uint64_t rhs ) {
+                              return timestamps[ lhs ] < timestamps[ rhs ];
+                          } );
+
+        REQUIRE( TimeOrder::sortedRanks( timestamps ) == expectedRanks );
+    }
+}
@@ -0,0 +1,190 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+
+#include <string>
+
+#include "timestampindex.h"
+
+SCENARIO( "Timestamp parsing", "[timestampindex]" )
+{
+    const TimestampParser parser( "yyyy-MM-dd HH:mm:ss" );
+
+    WHEN( "Line starts with timestamp" )
+    {
+        const auto timestamp = parser.parse( "2021-03-04 10:20:30 request done" );
+        REQUIRE( timestamp.has_value() );
+        REQUIRE( *timestamp
+                 == TimestampParser::toTimestamp( QDateTime( QDate( 2021, 3, 4 ),
+                                                             QTime( 10, 20, 30 ) ) ) );
+    }
+
+    WHEN( "Line has no timestamp" )
+    {
+        REQUIRE( !parser.parse( "    at Main.run(Main.java:10)" ).has_value() );
+        REQUIRE( !parser.parse( "2021-03-04" ).has_value() );
+    }
+
+    WHEN( "Block starts with continuation lines" )
+    {
+        const std::string block = "tail\n  at Main.run\n2021-03-04 10:20:30 error\n";
+        const auto sample = parser.findInBlock( block, 5 );
+        REQUIRE( sample.has_value() );
+        REQUIRE( sample->offset == 19 );
+    }
+}
+
+SCENARIO( "Timestamp layouts", "[timestampindex]" )
+{
+    const auto expected = TimestampParser::toTimestamp(
+        QDateTime( QDate( 2021, 3, 4 ), QTime( 10, 20, 30, 123 ) ) );
+
+    WHEN( "Format has quoted literals" )
+    {
+        const TimestampParser parser( "yyyy-MM-dd'T'HH:mm:ss.zzz" );
+        REQUIRE( parser.parse( "2021-03-04T10:20:30.123Z started" ) == expected );
+        REQUIRE( !parser.parse( "2021-03-04 10:20:30.123Z started" ).has_value() );
+        REQUIRE( !parser.parse( "2021-02-30T10:20:30.123Z started" ).has_value() );
+        REQUIRE( !parser.parse( "2021-03-04T10:2x:30.123Z started" ).has_value() );
+    }
+
+    WHEN( "Day is padded with a space" )
+    {
+        const TimestampParser parser( "MMM dd HH:mm:ss" );
+        const auto timestamp = parser.parse( "Mar  4 10:20:30 host sshd[42]: accepted" );
+        REQUIRE( timestamp
+                 == TimestampParser::toTimestamp(
+                     QDateTime( QDate( 1900, 3, 4 ), QTime( 10, 20, 30 ) ) ) );
+        REQUIRE( !parser.parse( "Mxr  4 10:20:30 host" ).has_value() );
+    }
+
+    WHEN( "Format starts with a bracket" )
+    {
+        const TimestampParser parser( "[dd/MMM/yyyy:HH:mm:ss" );
+        REQUIRE( parser.parse( "10.0.0.1 - bob [04/Mar/2021:10:20:30 +0000] \"GET / HTTP/1.1\"" )
+                 == expected - 123 );
+    }
+
+    WHEN( "Lines start with milliseconds since epoch" )
+    {
+        const TimestampParser parser( TimestampParser::EpochMillisFormat );
+        REQUIRE( parser.parse( "1614853230123 started" ) == expected );
+        REQUIRE( !parser.parse( "16148532301234 started" ).has_value() );
+        REQUIRE( !parser.parse( "0000000000042 started" ).has_value() );
+    }
+}
+
+SCENARIO( "Timestamp format detection", "[timestampindex]" )
+{
+    REQUIRE( TimestampParser::detectFormat( "2021-03-04 10:20:30,123 INFO started\n"
+                                            "    at Main.run(Main.java:10)\n"
+                                            "2021-03-04 10:20:31,456 INFO done\n" )
+             == "yyyy-MM-dd HH:mm:ss,zzz" );
+    REQUIRE( TimestampParser::detectFormat( "2021-03-04T10:20:30Z started\n" )
+             == "yyyy-MM-dd'T'HH:mm:ss" );
+    REQUIRE( TimestampParser::detectFormat( "Mar  4 10:20:30 host sshd[42]: accepted\n" )
+             == "MMM dd HH:mm:ss" );
+    REQUIRE( TimestampParser::detectFormat( "10.0.0.1 - - [04/Mar/2021:10:20:30 +0000] GET\n" )
+             == "[dd/MMM/yyyy:HH:mm:ss" );
+    REQUIRE( TimestampParser::detectFormat( "1614853230123 started\n" )
+             == TimestampParser::EpochMillisFormat );
+    REQUIRE( TimestampParser::detectFormat( "no time\nin these lines\n" ).isEmpty() );
+}
+
+SCENARIO( "Timestamp index of file blocks", "[timestampindex]" )
+{
+    TimestampIndex index;
+    index.reset( "yyyy-MM-dd HH:mm:ss" );
+
+    GIVEN( "Format detected from the beginning of file" )
+    {
+        index.reset( TimestampParser::AutoFormat );
+        REQUIRE( index.format().isEmpty() );
+
+        index.detectFormat( "2021-03-04 10:20:30 started\n" );
+        REQUIRE( index.format() == "yyyy-MM-dd HH:mm:ss" );
+        REQUIRE( index.setting() == TimestampParser::AutoFormat );
+    }
+
+    GIVEN( "Samples of consecutive blocks" )
+    {
+        index.append( 0, 100, TimestampSample{ 10, 1000 } );
+        index.append( 100, 200, TimestampSample{ 110, 2000 } );
+        index.append( 200, 300, TimestampSample{ 210, 3000 } );
+
+        WHEN( "Timestamp is between samples" )
+        {
+            const auto range = index.find( 1500 );
+            REQUIRE( range.has_value() );
+            REQUIRE( range->begin == 10 );
+            REQUIRE( range->end == 110 );
+        }
+
+        WHEN( "Timestamp is before the first sample" )
+        {
+            const auto range = index.find( 500 );
+            REQUIRE( range.has_value() );
+            REQUIRE( range->begin == 0 );
+            REQUIRE( range->end == 10 );
+        }
+
+        WHEN( "Timestamp is after the last sample" )
+        {
+            const auto range = index.find( 5000 );
+            REQUIRE( range.has_value() );
+            REQUIRE( range->begin == 210 );
+            REQUIRE( range->end == 300 );
+        }
+
+        WHEN( "Time span is asked for" )
+        {
+            const auto span = index.timeSpan();
+            REQUIRE( span.has_value() );
+            REQUIRE( span->first == 1000 );
+            REQUIRE( span->second == 3000 );
+        }
+    }
+
+    GIVEN( "Sample older than the one before it" )
+    {
+        index.append( 0, 100, TimestampSample{ 10, 1000 } );
+        index.append( 100, 200, TimestampSample{ 110, 3000 } );
+        index.append( 200, 300, TimestampSample{ 210, 2000 } );
+        index.append( 300, 400, TimestampSample{ 310, 4000 } );
+
+        THEN( "Out of order sample is not kept" )
+        {
+            const auto range = index.find( 2500 );
+            REQUIRE( range.has_value() );
+            REQUIRE( range->begin == 10 );
+            REQUIRE( range->end == 110 );
+            REQUIRE( index.find( 3500 )->begin == 110 );
+            REQUIRE( index.find( 3500 )->end == 310 );
+        }
+    }
+
+    GIVEN( "Blocks that do not start at the beginning of file" )
+    {
+        index.append( 100, 200, TimestampSample{ 110, 2000 } );
+
+        REQUIRE( !index.find( 1500 ).has_value() );
+        REQUIRE( !index.timeSpan().has_value() );
+    }
+}
@@ -0,0 +1,149 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+
+#include <vector>
+
+#include <QBuffer>
+#include <QDataStream>
+
+#include "tokenindex.h"
+
+namespace {
+std::vector<LineNumber::UnderlyingType> toVector( const roaring::Roaring64Map& lines )
+{
+    std::vector<LineNumber::UnderlyingType> numbers;
+    for ( const auto line : lines ) {
+        numbers.push_back( line );
+    }
+    return numbers;
+}
+
+using Lines = std::vector<LineNumber::UnderlyingType>;
+} // namespace
+
+SCENARIO( "Token index lookups", "[tokenindex]" )
+{
+    TokenIndex index( "" );
+    index.append( { "request 550e8400-e29b-41d4-a716-446655440000 started",
+                    "user=alice action=login", "trace_id:ABC123 done",
+                    "request 550e8400-e29b-41d4-a716-446655440000 done" } );
+
+    REQUIRE( index.size() == 4_lcount );
+
+    WHEN( "Text is a token" )
+    {
+        const auto lines
+            = index.find( "550e8400-e29b-41d4-a716-446655440000", 0_lnum, 4_lnum );
+        REQUIRE( lines.has_value() );
+        REQUIRE( toVector( *lines ) == Lines{ 0, 3 } );
+    }
+
+    WHEN( "Token has other case" )
+    {
+        const auto lines = index.find( "abc123", 0_lnum, 4_lnum );
+        REQUIRE( lines.has_value() );
+        REQUIRE( toVector( *lines ) == Lines{ 2 } );
+    }
+
+    WHEN( "Lines are limited" )
+    {
+        const auto lines = index.find( "request", 1_lnum, 4_lnum );
+        REQUIRE( lines.has_value() );
+        REQUIRE( toVector( *lines ) == Lines{ 3 } );
+    }
+
+    WHEN( "Text is part of a token" )
+    {
+        const auto lines = index.find( "alic", 0_lnum, 4_lnum );
+        REQUIRE( lines.has_value() );
+        REQUIRE( lines->isEmpty() );
+    }
+
+    WHEN( "Text is not a single token" )
+    {
+        REQUIRE( !index.find( "user=alice", 0_lnum, 4_lnum ).has_value() );
+        REQUIRE( !index.find( "id", 0_lnum, 4_lnum ).has_value() );
+    }
+
+    WHEN( "Last line is added again" )
+    {
+        index.truncate( 3_lcount );
+        index.append( { "request finished" } );
+
+        REQUIRE( toVector( *index.find( "request", 0_lnum, 4_lnum ) ) == Lines{ 0, 3 } );
+        REQUIRE( toVector( *index.find( "done", 0_lnum, 4_lnum ) ) == Lines{ 2 } );
+    }
+
+    WHEN( "Several lines are dropped" )
+    {
+        index.truncate( 1_lcount );
+        index.append( { "trace_id:DEF456 done" } );
+
+        REQUIRE( index.size() == 2_lcount );
+        REQUIRE( toVector( *index.find( "request", 0_lnum, 4_lnum ) ) == Lines{ 0 } );
+        REQUIRE( toVector( *index.find( "done", 0_lnum, 4_lnum ) ) == Lines{ 1 } );
+        REQUIRE( index.find( "alice", 0_lnum, 4_lnum )->isEmpty() );
+    }
+
+    WHEN( "Index is saved and loaded" )
+    {
+        QBuffer buffer;
+        buffer.open( QIODevice::ReadWrite );
+        QDataStream stream( &buffer );
+        index.save( stream );
+
+        buffer.seek( 0 );
+        TokenIndex loadedIndex( "" );
+        REQUIRE( loadedIndex.load( stream ) );
+        REQUIRE( loadedIndex.size() == 4_lcount );
+        REQUIRE( toVector( *loadedIndex.find( "alice", 0_lnum, 4_lnum ) ) == Lines{ 1 } );
+
+        buffer.seek( 0 );
+        TokenIndex otherDelimiters( " " );
+        REQUIRE( otherDelimiters.load( stream ) );
+        REQUIRE( otherDelimiters.size() == 0_lcount );
+    }
+
+    WHEN( "Lines of a token are damaged" )
+    {
+        QBuffer buffer;
+        buffer.open( QIODevice::ReadWrite );
+        QDataStream stream( &buffer );
+
+        // Portable bitmap header that claims more containers than there are
+        const QByteArray damaged( "\x3a\x30\x00\x00\xff\xff\x00\x00", 8 );
+        stream << QByteArray( "" ) << quint64{ 4 } << quint64{ 1 } << quint64{ 42 } << damaged
+               << quint64{ 0 };
+
+        buffer.seek( 0 );
+        TokenIndex loadedIndex( "" );
+        REQUIRE( !loadedIndex.load( stream ) );
+    }
+}
+
+SCENARIO( "Disabled token index", "[tokenindex]" )
+{
+    TokenIndex index;
+    index.append( { "request started" } );
+
+    REQUIRE( index.size() == 0_lcount );
+    REQUIRE( !index.find( "request", 0_lnum, 1_lnum ).has_value() );
+}
@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+
+#include <string>
+
+#include <QBuffer>
+#include <QDataStream>
+
+#include "trigramindex.h"
+
+namespace {
+void appendBlock( TrigramIndex& index, std::string_view data, size_t begin, size_t end )
+{
+    const auto block = data.substr( begin, end - begin );
+    auto filter = std::make_shared<TrigramFilter>();
+    filter->addData( block );
+    index.append( static_cast<LineOffset::UnderlyingType>( begin ), std::move( filter ), block );
+}
+} // namespace
+
+SCENARIO( "Trigram index of file blocks", "[trigramindex]" )
+{
+    const std::string data = "first line\nsecond line with REQ-12345 id\nthird line\n";
+    const auto size = static_cast<LineOffset::UnderlyingType>( data.size() );
+
+    GIVEN( "Text split into blocks at every position" )
+    {
+        const auto hashes = TrigramFilter::textHashes( "REQ-12345", true );
+        REQUIRE( !hashes.empty() );
+
+        for ( size_t split = 0; split <= data.size(); ++split ) {
+            TrigramIndex index;
+            appendBlock( index, data, 0, split );
+            appendBlock( index, data, split, data.size() );
+
+            REQUIRE( index.mayContain( 0, size, hashes ) );
+        }
+    }
+
+    GIVEN( "Text split into one byte blocks" )
+    {
+        TrigramIndex index;
+        for ( size_t pos = 0; pos < data.size(); ++pos ) {
+            appendBlock( index, data, pos, pos + 1 );
+        }
+
+        WHEN( "Searching for existing text" )
+        {
+            REQUIRE( index.mayContain( 0, size, TrigramFilter::textHashes( "REQ-12345", true ) ) );
+            REQUIRE( index.mayContain( 0, size, TrigramFilter::textHashes( "req-12345", false ) ) );
+        }
+
+        WHEN( "Searching for missing text" )
+        {
+            REQUIRE( !index.mayContain( 0, size, TrigramFilter::textHashes( "REQ-99999", true ) ) );
+        }
+    }
+
+    GIVEN( "Index loaded from saved data" )
+    {
+        TrigramIndex savedIndex;
+        appendBlock( savedIndex, data, 0, 30 );
+
+        QBuffer buffer;
+        buffer.open( QIODevice::ReadWrite );
+        QDataStream stream( &buffer );
+        savedIndex.save( stream );
+        buffer.seek( 0 );
+
+        TrigramIndex index;
+        REQUIRE( index.load( stream ) );
+
+        // Text crosses the boundary of saved block
+        appendBlock( index, data, 30, data.size() );
+        REQUIRE( index.mayContain( 0, size, TrigramFilter::textHashes( "REQ-12345", true ) ) );
+        REQUIRE( !index.mayContain( 0, size, TrigramFilter::textHashes( "REQ-99999", true ) ) );
+    }
+
+    GIVEN( "Text not covered by index" )
+    {
+        TrigramIndex index;
+        appendBlock( index, data, 0, 10 );
+
+        REQUIRE( index.mayContain( 0, size, TrigramFilter::textHashes( "REQ-99999", true ) ) );
+    }
+
+    GIVEN( "Text that can not be checked by filter" )
+    {
+        REQUIRE( TrigramFilter::textHashes( "id", true ).empty() );
+        REQUIRE( TrigramFilter::textHashes( "\xd0\xb8\xd0\xb4\xd0\xb8", true ).empty() );
+    }
+}
@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+
+#include <utility>
+
+#include "wrapindex.h"
+
+namespace {
+// Every third line is 25 columns long, others are 5 columns long
+LineLength lineLength( LineNumber line )
+{
+    return LineLength( line.get() % 3 == 0 ? 25 : 5 );
+}
+
+// Lines of three rows in [first, last)
+uint64_t wrappedLines( uint64_t first, uint64_t last )
+{
+    return ( last + 2 ) / 3 - ( first + 2 ) / 3;
+}
+
+constexpr auto Lines = 3 * WrapIndex::BlockLines;
+} // namespace
+
+SCENARIO( "Wrap index rows", "[wrapindex]" )
+{
+    WrapIndex index;
+    index.reset( LinesCount( Lines ), 10 );
+
+    REQUIRE( index.nbRows() == Lines );
+    REQUIRE( index.lineAtRow( 5 ) == std::make_pair( 5_lnum, 0 ) );
+
+    WHEN( "Block is measured" )
+    {
+        REQUIRE( index.measure( LineNumber( WrapIndex::BlockLines + 1 ), 1_lcount, lineLength ) );
+        REQUIRE( !index.measure( LineNumber( WrapIndex::BlockLines ), 5_lcount, lineLength ) );
+        REQUIRE( index.measuredBlocks() == 1 );
+
+        const auto firstWrapped = LineNumber( WrapIndex::BlockLines + 2 );
+        const auto blockWrapped = wrappedLines( WrapIndex::BlockLines, 2 * WrapIndex::BlockLines );
+        REQUIRE( index.nbRows() == Lines + 2 * blockWrapped );
+        REQUIRE( index.lineRows( firstWrapped ) == 3 );
+        REQUIRE( index.lineRows( firstWrapped + 1_lcount ) == 1 );
+        REQUIRE( index.lineRows( 0_lnum ) == 1 );
+
+        REQUIRE( index.firstRow( firstWrapped ) == firstWrapped.get() );
+        REQUIRE( index.firstRow( firstWrapped + 1_lcount ) == firstWrapped.get() + 3 );
+        REQUIRE( index.lineAtRow( firstWrapped.get() + 2 ) == std::make_pair( firstWrapped, 2 ) );
+        REQUIRE( index.lineAtRow( firstWrapped.get() + 3 )
+                 == std::make_pair( firstWrapped + 1_lcount, 0 ) );
+
+        // Lines after the block are moved by its rows
+        const auto nextBlock = LineNumber( 2 * WrapIndex::BlockLines );
+        const auto nextBlockRow = index.firstRow( nextBlock );
+        REQUIRE( nextBlockRow == nextBlock.get() + 2 * blockWrapped );
+        REQUIRE( index.lineAtRow( nextBlockRow ) == std::make_pair( nextBlock, 0 ) );
+    }
+
+    WHEN( "All blocks are measured" )
+    {
+        for ( auto line = index.unmeasuredLineNear( 0_lnum ); line.has_value();
+              line = index.unmeasuredLineNear( 0_lnum ) ) {
+            index.measure( *line, 1_lcount, lineLength );
+        }
+
+        REQUIRE( index.measuredBlocks() == 3 );
+        REQUIRE( index.nbRows() == Lines + 2 * wrappedLines( 0, Lines ) );
+        REQUIRE( index.lineAtRow( index.nbRows() - 1 )
+                 == std::make_pair( LineNumber( Lines - 1 ), 0 ) );
+        REQUIRE( index.lineAtRow( index.nbRows() + 10 )
+                 == std::make_pair( LineNumber( Lines - 1 ), 0 ) );
+    }
+
+    WHEN( "Lines are appended" )
+    {
+        index.measure( 0_lnum, LinesCount( Lines ), lineLength );
+        index.resize( LinesCount( Lines + 10 ) );
+
+        // Full blocks are kept
+        REQUIRE( index.measuredBlocks() == 3 );
+        REQUIRE( index.nbRows() == Lines + 10 + 2 * wrappedLines( 0, Lines ) );
+    }
+
+    WHEN( "Lines are removed" )
+    {
+        index.measure( 0_lnum, LinesCount( Lines ), lineLength );
+        index.resize( LinesCount( Lines - 10 ) );
+
+        // The last block is measured again
+        REQUIRE( index.measuredBlocks() == 2 );
+        REQUIRE( index.nbRows()
+                 == Lines - 10 + 2 * wrappedLines( 0, 2 * WrapIndex::BlockLines ) );
+    }
+}
@@ -1,13 +1,609 @@
-#include <iostream>
-#include <limits>
+// Generates synthetic log files for benchmarks and bug reports.
+//
+// Output depends only on the options: the same options and seed
+// produce the same bytes on every platform, so multi-GB workloads
+// can be reproduced from a command line instead of being shared.
+//
+// Example:
+//   gen_big_file --size 4G --seed 7 --eol crlf --match "connection refused:0.001" -o big.log
 
-int main()
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+namespace {
+
+enum class Encoding { Utf8, Utf16Le, ShiftJis };
+
+struct MatchPattern {
+    std::string text;
+    double density = 0;
+};
+
+struct Options {
+    uint64_t seed = 1;
+    uint64_t maxLines = 0;
+    uint64_t maxSize = 0;
+    Encoding encoding = Encoding::Utf8;
+    bool crlf = false;
+    double ansiColors = 0;
+    double stackTraces = 0.2;
+    double unicodeLines = 0;
+    double longLines = 0.01;
+    uint64_t maxLineLength = 10'000;
+    std::vector<MatchPattern> patterns;
+    std::string output;
+};
+
+// Standard distributions are implementation defined, so generator
+// and distributions are implemented here to keep output portable.
+class Random {
+  public:
+    explicit Random( uint64_t seed )
+        : state_( seed )
+    {
+    }
+
+    // splitmix64
+    uint64_t next()
+    {
+        auto z = ( state_ += 0x9E3779B97F4A7C15ull );
+        z = ( z ^ ( z >> 30 ) ) * 0xBF58476D1CE4E5B9ull;
+        z = ( z ^ ( z >> 27 ) ) * 0x94D049BB133111EBull;
+        return z ^ ( z >> 31 );
+    }
+
+    // Uniform in [min, max]
+    uint64_t between( uint64_t min, uint64_t max )
+    {
+        return min + next() % ( max - min + 1 );
+    }
+
+    bool chance( double probability )
+    {
+        return static_cast<double>( next() >> 11 ) * 0x1.0p-53 < probability;
+    }
+
+    template <typename Container>
+    const auto& pick( const Container& items )
+    {
+        return items[ next() % items.size() ];
+    }
+
+  private:
+    uint64_t state_;
+};
+
+// Word with its Shift-JIS form, ASCII words have the same bytes in both encodings
+struct Word {
+    const char* utf8;
+    const char* shiftJis;
+};
+
+const std::vector<Word> AsciiWords = {
+    { "request", nullptr },    { "session", nullptr },   { "started", nullptr },
+    { "finished", nullptr },   { "client", nullptr },    { "server", nullptr },
+    { "timeout", nullptr },    { "retrying", nullptr },  { "cache", nullptr },
+    { "miss", nullptr },       { "hit", nullptr },       { "user", nullptr },
+    { "id=", nullptr },        { "bytes", nullptr },     { "sent", nullptr },
+    { "received", nullptr },   { "queue", nullptr },     { "size", nullptr },
+    { "elapsed", nullptr },    { "ms", nullptr },        { "handler", nullptr },
+    { "payload", nullptr },    { "accepted", nullptr },  { "closed", nullptr },
+    { "transaction", nullptr }, { "commit", nullptr },   { "rollback", nullptr },
+    { "worker", nullptr },     { "scheduled", nullptr }, { "value", nullptr },
+};
+
+const std::vector<Word> JapaneseWords = {
+    { "\xE6\x97\xA5\xE6\x9C\xAC\xE8\xAA\x9E", "\x93\xFA\x96\x7B\x8C\xEA" },
+    { "\xE6\x8E\xA5\xE7\xB6\x9A", "\x90\xDA\x91\xB1" },
+    { "\xE3\x82\xA8\xE3\x83\xA9\xE3\x83\xBC", "\x83\x47\x83\x89\x81\x5B" },
+    { "\xE5\xAE\x8C\xE4\xBA\x86", "\x8A\xAE\x97\xB9" },
+    { "\xE5\x87\xA6\xE7\x90\x86", "\x8F\x88\x97\x9D" },
+    { "\xE5\xA4\xB1\xE6\x95\x97", "\x8E\xB8\x94\x73" },
+    { "\xE8\xA8\xAD\xE5\xAE\x9A", "\x90\xDD\x92\xE8" },
+    // Second bytes of these are '\' and '@'
+    { "\xE8\xA1\xA8\xE7\xA4\xBA", "\x95\x5C\x8E\xA6" },
+    { "\xE3\x82\xBD\xE3\x83\xBC\xE3\x82\xB9", "\x83\x5C\x81\x5B\x83\x58" },
+    { "\xE3\x83\x95\xE3\x82\xA1\xE3\x82\xA4\xE3\x83\xAB", "\x83\x74\x83\x40\x83\x43\x83\x8B" },
+};
+
+// Can not be encoded in Shift-JIS
+const std::vector<Word> OtherUnicodeWords = {
+    { "caf\xC3\xA9", nullptr },
+    { "na\xC3\xAFve", nullptr },
+    { "\xD0\x9F\xD1\x80\xD0\xB8\xD0\xB2\xD0\xB5\xD1\x82", nullptr },
+    { "\xCE\xB1\xCE\xBB\xCF\x86\xCE\xB1", nullptr },
+    { "\xE4\xB8\xAD\xE6\x96\x87", nullptr },
+    { "\xE2\x9C\x93", nullptr },
+    { "\xF0\x9F\x9A\x80", nullptr },
+};
+
+struct Level {
+    const char* name;
+    const char* color;
+    unsigned weight;
+};
+
+const std::vector<Level> Levels = {
+    { "DEBUG", "\x1B[36m", 30 },
+    { "INFO", "\x1B[32m", 55 },
+    { "WARN", "\x1B[33m", 10 },
+    { "ERROR", "\x1B[31m", 5 },
+};
+
+const std::vector<const char*> Components = {
+    "http.Server", "db.ConnectionPool", "cache.Store", "auth.TokenService",
+    "queue.Consumer", "scheduler.Timer", "storage.BlobWriter",
+};
+
+const std::vector<const char*> Exceptions = {
+    "java.lang.IllegalStateException: unexpected state",
+    "java.io.IOException: connection reset by peer",
+    "java.util.concurrent.TimeoutException: operation timed out",
+    "java.lang.NullPointerException",
+};
+
+// Appends line in output encoding
+class Writer {
+  public:
+    Writer( std::FILE* file, const Options& options )
+        : file_( file )
+        , encoding_( options.encoding )
+        , eol_( options.crlf ? "\r\n" : "\n" )
+    {
+        buffer_.reserve( BufferSize + 64 * 1024 );
+        if ( encoding_ == Encoding::Utf16Le ) {
+            buffer_.append( "\xFF\xFE" );
+        }
+    }
+
+    ~Writer()
+    {
+        flush();
+    }
+
+    Writer( const Writer& ) = delete;
+    Writer& operator=( const Writer& ) = delete;
+
+    void writeLine( const std::string& line )
+    {
+        if ( encoding_ == Encoding::Utf16Le ) {
+            appendUtf16( line );
+            appendUtf16( eol_ );
+        }
+        else {
+            buffer_.append( line );
+            buffer_.append( eol_ );
+        }
+
+        if ( buffer_.size() >= BufferSize ) {
+            flush();
+        }
+    }
+
+    uint64_t size() const
+    {
+        return written_ + buffer_.size();
+    }
+
+    void flush()
+    {
+        std::fwrite( buffer_.data(), 1, buffer_.size(), file_ );
+        written_ += buffer_.size();
+        buffer_.clear();
+    }
+
+  private:
+    void appendUnit( uint32_t unit )
+    {
+        buffer_.push_back( static_cast<char>( unit & 0xFF ) );
+        buffer_.push_back( static_cast<char>( unit >> 8 ) );
+    }
+
+    // Input is valid UTF-8 built from the tables above
+    void appendUtf16( const std::string& utf8 )
+    {
+        for ( size_t pos = 0; pos < utf8.size(); ) {
+            const auto lead = static_cast<uint8_t>( utf8[ pos ] );
+            const auto length = lead < 0x80 ? 1 : lead < 0xE0 ? 2 : lead < 0xF0 ? 3 : 4;
+
+            uint32_t codePoint = length == 1   ? lead
+                                 : length == 2 ? lead & 0x1Fu
+                                 : length == 3 ? lead & 0x0Fu
+                                               : lead & 0x07u;
+            for ( auto i = 1; i < length; ++i ) {
+                codePoint = ( codePoint << 6 ) | ( static_cast<uint8_t>( utf8[ pos + i ] ) & 0x3F );
+            }
+            pos += static_cast<size_t>( length );
+
+            if ( codePoint >= 0x10000 ) {
+                codePoint -= 0x10000;
+                appendUnit( 0xD800 + ( codePoint >> 10 ) );
+                appendUnit( 0xDC00 + ( codePoint & 0x3FF ) );
+            }
+            else {
+                appendUnit( codePoint );
+            }
+        }
+    }
+
+    static constexpr size_t BufferSize = 4 * 1024 * 1024;
+
+    std::FILE* file_;
+    Encoding encoding_;
+    std::string eol_;
+    std::string buffer_;
+    uint64_t written_ = 0;
+};
+
+class Generator {
+  public:
+    explicit Generator( const Options& options )
+        : options_( options )
+        , random_( options.seed )
+    {
+        for ( const auto& level : Levels ) {
+            levelsWeight_ += level.weight;
+        }
+    }
+
+    // Writes one record, possibly followed by stack trace lines,
+    // returns number of lines written
+    uint64_t writeRecord( Writer& writer )
+    {
+        timestampMs_ += random_.between( 0, 50 );
+
+        const auto& level = pickLevel();
+        std::string line = timestamp();
+        line += ' ';
+        if ( random_.chance( options_.ansiColors ) ) {
+            line += level.color;
+            line += level.name;
+            line += "\x1B[0m";
+        }
+        else {
+            line += level.name;
+        }
+        line += " [worker-" + std::to_string( random_.between( 1, 32 ) ) + "] ";
+        line += random_.pick( Components );
+        line += ": ";
+
+        appendMessage( line );
+        writer.writeLine( line );
+        ++record_;
+
+        auto linesCount = 1ull;
+        if ( std::strcmp( level.name, "ERROR" ) == 0 && random_.chance( options_.stackTraces ) ) {
+            linesCount += writeStackTrace( writer );
+        }
+        return linesCount;
+    }
+
+  private:
+    const Level& pickLevel()
+    {
+        auto value = random_.between( 1, levelsWeight_ );
+        for ( const auto& level : Levels ) {
+            if ( value <= level.weight ) {
+                return level;
+            }
+            value -= level.weight;
+        }
+        return Levels.back();
+    }
+
+    uint64_t messageLength()
+    {
+        if ( random_.chance( options_.longLines ) ) {
+            return random_.between( 1000, std::max<uint64_t>( 1000, options_.maxLineLength ) );
+        }
+        return random_.chance( 0.8 ) ? random_.between( 20, 120 ) : random_.between( 120, 1000 );
+    }
+
+    void appendWord( std::string& line, const Word& word ) const
+    {
+        const auto useShiftJis = options_.encoding == Encoding::ShiftJis && word.shiftJis;
+        line += useShiftJis ? word.shiftJis : word.utf8;
+    }
+
+    void appendMessage( std::string& line )
+    {
+        const auto isUnicodeLine = random_.chance( options_.unicodeLines );
+        const auto& unicodeWords
+            = options_.encoding == Encoding::ShiftJis || random_.chance( 0.5 ) ? JapaneseWords
+                                                                                : OtherUnicodeWords;
+
+        // Patterns are placed before the words of the message
+        // at an exact density, independent of the random sequence
+        for ( const auto& pattern : options_.patterns ) {
+            const auto before = std::floor( static_cast<double>( record_ ) * pattern.density );
+            const auto after = std::floor( static_cast<double>( record_ + 1 ) * pattern.density );
+            if ( after > before ) {
+                line += pattern.text;
+                line += ' ';
+            }
+        }
+
+        const auto messageEnd = line.size() + messageLength();
+        while ( line.size() < messageEnd ) {
+            if ( isUnicodeLine && random_.chance( 0.3 ) ) {
+                appendWord( line, random_.pick( unicodeWords ) );
+            }
+            else {
+                appendWord( line, random_.pick( AsciiWords ) );
+            }
+
+            if ( random_.chance( 0.2 ) ) {
+                line += std::to_string( random_.between( 0, 99'999 ) );
+            }
+            line += ' ';
+        }
+        line.pop_back();
+    }
+
+    uint64_t writeStackTrace( Writer& writer )
+    {
+        writer.writeLine( random_.pick( Exceptions ) );
+
+        const auto framesCount = random_.between( 3, 20 );
+        for ( auto frame = 0ull; frame < framesCount; ++frame ) {
+            const std::string component = random_.pick( Components );
+            const auto className = component.substr( component.find( '.' ) + 1 );
+            writer.writeLine( "\tat com.example." + component + ".handle" + className + "("
+                              + className + ".java:" + std::to_string( random_.between( 10, 900 ) )
+                              + ")" );
+        }
+        return framesCount + 1;
+    }
+
+    // Formatted without gmtime, so it does not depend on time zone or platform
+    std::string timestamp() const
+    {
+        const auto seconds = timestampMs_ / 1000;
+        auto days = static_cast<int64_t>( seconds / 86400 );
+
+        // Civil date from days since 1970-01-01
+        days += 719468;
+        const auto era = days / 146097;
+        const auto dayOfEra = days - era * 146097;
+        const auto yearOfEra
+            = ( dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096 ) / 365;
+        const auto dayOfYear = dayOfEra - ( 365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100 );
+        const auto monthIndex = ( 5 * dayOfYear + 2 ) / 153;
+        const auto day = dayOfYear - ( 153 * monthIndex + 2 ) / 5 + 1;
+        const auto month = monthIndex < 10 ? monthIndex + 3 : monthIndex - 9;
+        const auto year = yearOfEra + era * 400 + ( month <= 2 ? 1 : 0 );
+
+        char buffer[ 32 ];
+        std::snprintf( buffer, sizeof( buffer ), "%04d-%02d-%02d %02d:%02d:%02d.%03d",
+                       static_cast<int>( year ), static_cast<int>( month ),
+                       static_cast<int>( day ), static_cast<int>( seconds / 3600 % 24 ),
+                       static_cast<int>( seconds / 60 % 60 ), static_cast<int>( seconds % 60 ),
+                       static_cast<int>( timestampMs_ % 1000 ) );
+        return buffer;
+    }
+
+    const Options& options_;
+    Random random_;
+    unsigned levelsWeight_ = 0;
+
+    // 2021-01-01 00:00:00 UTC
+    uint64_t timestampMs_ = 1'609'459'200'000ull;
+    uint64_t record_ = 0;
+};
+
+void printUsage()
+{
+    std::fprintf(
+        stderr,
+        "Usage: gen_big_file [options]\n"
+        "  -o, --output FILE          write to FILE instead of standard output\n"
+        "  --lines N                  stop after N lines (default 1000000)\n"
+        "  --size N[K|M|G]            stop when output reaches N bytes\n"
+        "  --seed N                   seed of the random sequence (default 1)\n"
+        "  --encoding ENC             utf8, utf16le or shift-jis (default utf8)\n"
+        "  --eol lf|crlf              line endings (default lf)\n"
+        "  --ansi P                   fraction of lines with ANSI colored level\n"
+        "  --stack-traces P           fraction of errors followed by stack trace (default 0.2)\n"
+        "  --unicode P                fraction of lines with non ASCII words\n"
+        "  --long-lines P             fraction of lines longer than 1000 (default 0.01)\n"
+        "  --max-line-length N        length limit of long lines (default 10000)\n"
+        "  --match TEXT:DENSITY       put TEXT into exactly DENSITY of records, can repeat\n"
+        "\n"
+        "Options take effect only through the generated data, so the same\n"
+        "options produce the same file on all platforms.\n" );
+}
+
+bool parseNumber( const char* text, uint64_t& value )
 {
-    std::cout << std::numeric_limits<unsigned int>::max() << std::endl;
-    for (auto line = 0ull; line < std::numeric_limits<unsigned int>::max(); ++line)
+    char* end = nullptr;
+    value = std::strtoull( text, &end, 10 );
+    if ( end == text ) {
+        return false;
+    }
+
+    switch ( *end ) {
+    case '\0':
+        return true;
+    case 'K':
+    case 'k':
+        value <<= 10;
+        break;
+    case 'M':
+    case 'm':
+        value <<= 20;
+        break;
+    case 'G':
+    case 'g':
+        value <<= 30;
+        break;
+    default:
+        return false;
+    }
+    return end[ 1 ] == '\0';
+}
+
+bool parseFraction( const char* text, double& value )
+{
+    char* end = nullptr;
+    value = std::strtod( text, &end );
+    return end != text && *end == '\0' && value >= 0 && value <= 1;
+}
+
+bool parsePattern( const std::string& text, MatchPattern& pattern )
+{
+    const auto separator = text.rfind( ':' );
+    if ( separator == std::string::npos || separator == 0 ) {
+        return false;
+    }
+    pattern.text = text.substr( 0, separator );
+    return parseFraction( text.c_str() + separator + 1, pattern.density );
+}
+
+bool isAscii( const std::string& text )
+{
+    for ( const auto c : text ) {
+        if ( static_cast<uint8_t>( c ) >= 0x80 ) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool parseOptions( int argc, char* argv[], Options& options )
+{
+    for ( auto i = 1; i < argc; ++i ) {
+        const std::string name = argv[ i ];
+        if ( name == "-h" || name == "--help" || i + 1 >= argc ) {
+            return false;
+        }
+
+        const char* value = argv[ ++i ];
+        auto isValid = true;
+        if ( name == "-o" || name == "--output" ) {
+            options.output = value;
+        }
+        else if ( name == "--lines" ) {
+            isValid = parseNumber( value, options.maxLines );
+        }
+        else if ( name == "--size" ) {
+            isValid = parseNumber( value, options.maxSize );
+        }
+        else if ( name == "--seed" ) {
+            isValid = parseNumber( value, options.seed );
+        }
+        else if ( name == "--max-line-length" ) {
+            isValid = parseNumber( value, options.maxLineLength );
+        }
+        else if ( name == "--ansi" ) {
+            isValid = parseFraction( value, options.ansiColors );
+        }
+        else if ( name == "--stack-traces" ) {
+            isValid = parseFraction( value, options.stackTraces );
+        }
+        else if ( name == "--unicode" ) {
+            isValid = parseFraction( value, options.unicodeLines );
+        }
+        else if ( name == "--long-lines" ) {
+            isValid = parseFraction( value, options.longLines );
+        }
+        else if ( name == "--eol" ) {
+            isValid = std::strcmp( value, "lf" ) == 0 || std::strcmp( value, "crlf" ) == 0;
+            options.crlf = std::strcmp( value, "crlf" ) == 0;
+        }
+        else if ( name == "--encoding" ) {
+            if ( std::strcmp( value, "utf8" ) == 0 ) {
+                options.encoding = Encoding::Utf8;
+            }
+            else if ( std::strcmp( value, "utf16le" ) == 0 ) {
+                options.encoding = Encoding::Utf16Le;
+            }
+            else if ( std::strcmp( value, "shift-jis" ) == 0 ) {
+                options.encoding = Encoding::ShiftJis;
+            }
+            else {
+                isValid = false;
+            }
+        }
+        else if ( name == "--match" ) {
+            MatchPattern pattern;
+            isValid = parsePattern( value, pattern );
+            options.patterns.push_back( pattern );
+        }
+        else {
+            isValid = false;
+        }
+
+        if ( !isValid ) {
+            std::fprintf( stderr, "Invalid value of %s: %s\n", name.c_str(), value );
+            return false;
+        }
+    }
+
+    if ( options.encoding == Encoding::ShiftJis ) {
+        for ( const auto& pattern : options.patterns ) {
+            if ( !isAscii( pattern.text ) ) {
+                std::fprintf( stderr, "Only ASCII patterns can be used with Shift-JIS\n" );
+                return false;
+            }
+        }
+    }
+
+    if ( options.maxLines == 0 && options.maxSize == 0 ) {
+        options.maxLines = 1'000'000;
+    }
+
+    return true;
+}
+
+} // namespace
+
+int main( int argc, char* argv[] )
+{
+    Options options;
+    if ( !parseOptions( argc, argv, options ) ) {
+        printUsage();
+        return 1;
+    }
+
+    std::FILE* file = stdout;
+    if ( !options.output.empty() ) {
+        file = std::fopen( options.output.c_str(), "wb" );
+        if ( file == nullptr ) {
+            std::fprintf( stderr, "Failed to open %s\n", options.output.c_str() );
+            return 1;
+        }
+    }
+#ifdef _WIN32
+    else {
+        _setmode( _fileno( stdout ), _O_BINARY );
+    }
+#endif
+
+    uint64_t linesCount = 0;
     {
-        std::cout << (line % 10) << "\n";
+        Generator generator( options );
+        Writer writer( file, options );
+
+        while ( ( options.maxLines == 0 || linesCount < options.maxLines )
+                && ( options.maxSize == 0 || writer.size() < options.maxSize ) ) {
+            linesCount += generator.writeRecord( writer );
+        }
+    }
+
+    if ( file != stdout ) {
+        std::fclose( file );
     }
 
+    std::fprintf( stderr, "Generated %llu lines\n", static_cast<unsigned long long>( linesCount ) );
     return 0;
-}
\ No newline at end of file
+}